@@ -138,6 +138,9 @@ set(EN_RDMA 0 CACHE STRING "Enable RDMA stack")
 # Number of RDMA streams, per vFPGA
 set(N_RDMA_AXI 1 CACHE STRING "Number of RDMA streams")
 
+# Hold RDMA retransmissions until the retransmission buffer slot they replay is written
+set(EN_RDMA_RETRANS_FENCE 0 CACHE STRING "Enable RDMA retransmission fence")
+
 # Enable TCP/IP stack
 set(EN_TCP 0 CACHE STRING "Enable TCP/IP stack.")
 
@@ -1056,6 +1059,47 @@ macro(gen_targets)
     add_subdirectory(${CYT_DIR}/sim/hw/dpi ${CMAKE_BINARY_DIR}/dpi)
     add_dependencies(sim sim_dpi_c)
 
+    # Precompiled Verilator model of the same testbench (optional, only if Verilator is available)
+    # Run by the simulation target with COYOTE_SIM_BACKEND=verilator, see sim/README.md
+    find_program(VERILATOR_BINARY verilator)
+    if(VERILATOR_BINARY)
+        set(SIM_VERILATOR_DIR "${CMAKE_BINARY_DIR}/sim/verilator")
+        set(SIM_VFPGA_DIR "${CMAKE_SOURCE_DIR}/${APPS_VFPGA_C0_0}")
+        file(GLOB SIM_VERILATOR_PKGS "${CYT_DIR}/hw/hdl/pkg/*.sv")
+        file(GLOB_RECURSE SIM_VERILATOR_COMMON "${CYT_DIR}/hw/hdl/common/*.sv" "${CYT_DIR}/hw/hdl/common/*.v")
+        file(GLOB_RECURSE SIM_VERILATOR_USER "${SIM_VFPGA_DIR}/hdl/*.sv" "${SIM_VFPGA_DIR}/hdl/*.v")
+        file(GLOB SIM_VERILATOR_DPI "${CYT_DIR}/sim/hw/dpi/*.c")
+
+        add_custom_target(sim_verilator
+            COMMAND ${CMAKE_COMMAND} -E make_directory ${SIM_VERILATOR_DIR}
+            COMMAND /usr/bin/python3 ${CMAKE_BINARY_DIR}/write_hdl.py 3 0 0
+            COMMAND ${VERILATOR_BINARY} --binary --timing -j 0 -Wno-fatal -Wno-lint -Wno-style
+                -DEN_RANDOMIZATION -DEN_INTERACTIVE
+                --top-module tb_user -Mdir ${SIM_VERILATOR_DIR} -o Vtb_user
+                -I${CYT_DIR}/sim/hw -I${CYT_DIR}/hw/hdl/pkg -I${SIM_VFPGA_DIR}
+                ${CMAKE_BINARY_DIR}/sim/lynx_pkg.sv ${SIM_VERILATOR_PKGS} ${CYT_DIR}/sim/hw/sim_pkg.sv
+                ${SIM_VERILATOR_COMMON} ${SIM_VERILATOR_USER} ${CMAKE_BINARY_DIR}/sim/user_logic_c0_0.sv
+                ${CYT_DIR}/sim/hw/tb_user.sv ${SIM_VERILATOR_DPI}
+            WORKING_DIRECTORY ${CMAKE_BINARY_DIR}
+        )
+
+        # Self-checking testbench of the RDMA retransmission fence, with behavioral models of the FIFO IP cores
+        set(SIM_RETRANS_DIR "${CMAKE_BINARY_DIR}/sim/rdma_retrans")
+        add_custom_target(sim_rdma_retrans
+            COMMAND ${CMAKE_COMMAND} -E make_directory ${SIM_RETRANS_DIR}
+            COMMAND /usr/bin/python3 ${CMAKE_BINARY_DIR}/write_hdl.py 3 0 0
+            COMMAND ${VERILATOR_BINARY} --binary --timing -j 0 -Wno-fatal -Wno-lint -Wno-style
+                --top-module tb_rdma_mux_retrans -Mdir ${SIM_RETRANS_DIR} -o Vtb_rdma_mux_retrans
+                -I${CYT_DIR}/hw/hdl/pkg
+                ${CMAKE_BINARY_DIR}/sim/lynx_pkg.sv ${SIM_VERILATOR_PKGS}
+                ${CYT_DIR}/hw/hdl/common/queues/fifo.sv ${CYT_DIR}/hw/hdl/common/queues/queue_stream.sv
+                ${CYT_DIR}/hw/hdl/common/queues/meta_queue.sv ${CYT_DIR}/hw/hdl/network/rdma/rdma_mux_retrans.sv
+                ${CYT_DIR}/sim/hw/network/axis_fifo_models.sv ${CYT_DIR}/sim/hw/network/tb_rdma_mux_retrans.sv
+            COMMAND ${SIM_RETRANS_DIR}/Vtb_rdma_mux_retrans
+            WORKING_DIRECTORY ${CMAKE_BINARY_DIR}
+        )
+    endif()
+
     # Project
     # -----------------------------------
     if(BUILD_STATIC)
@@ -93,6 +93,9 @@
 #define IOCTL_NET_DROP _IOW('D', 36, unsigned long) // net dropper
 #define IOCTL_TEST_INTERRUPT _IO('D', 37)
 
+#define IOCTL_MAP_USER_BATCH _IOW('D', 38, unsigned long)   // map many, struct guest_map_req
+#define IOCTL_UNMAP_USER_BATCH _IOW('D', 39, unsigned long)
+
 /* BAR2 offsets */
 #define REGISTER_PID_OFFSET 0x00
 #define UNREGISTER_PID_OFFSET 0x08
@@ -101,9 +104,16 @@
 #define READ_CNFG_OFFSET 0x20
 #define PUT_ALL_USER_PAGES 0x28
 #define TEST_INTERRUPT_OFFSET 0x30
-
-/* Interrupts */
-#define NUM_USER_INTERRUPTS 1
+#define REGISTER_PGD_OFFSET 0x38
+#define SETUP_QUEUE_OFFSET 0x40
+#define KICK_QUEUE_OFFSET 0x48
+
+/*
+ * Interrupts: the hypervisor raises page faults of ctid on vector
+ * ctid % NUM_INTERRUPTS (vector 0 if that one is not enabled), so that
+ * faults of different guest processes are served by different vCPUs.
+ */
+#define NUM_USER_INTERRUPTS 8
 
 /* LTLB values */
 // TODO: read the config from the device to popoulate those
@@ -182,6 +192,11 @@ struct vfpga
     } pci_resources;
 
     struct msix_entry irq_entry[32];
+    int n_irqs; // vectors enabled, at most NUM_USER_INTERRUPTS
+
+    // paravirtual submission queue, NULL if the hypervisor has none
+    struct pv_queue *pv_queue;
+    spinlock_t pv_lock;
 
     // Control region
     uint64_t fpga_phys_addr_ctrl;
@@ -202,6 +217,49 @@ struct user_pages
     struct page **hpages;
 };
 
+/*
+ * Paravirtual submission queue, shared with the hypervisor (SETUP_QUEUE).
+ * Descriptors are filled at head and served, with their status written
+ * back, by one kick of KICK_QUEUE for the whole batch.
+ */
+#define PV_QUEUE_SIZE 64
+
+#define PV_OP_MAP 1   // notifier: hypervisor_map_notifier, as for MAP_USER
+#define PV_OP_UNMAP 2 // notifier: hypervisor_map_notifier, as for UNMAP_USER
+
+struct pv_desc
+{
+    uint64_t op;
+    uint64_t notifier; // gpa of the notifier
+    int64_t status;    // 0 or error code, written by the hypervisor
+    uint64_t reserved;
+};
+
+struct pv_queue
+{
+    uint64_t head; // next descriptor filled by the guest
+    uint64_t tail; // next descriptor served by the hypervisor
+    struct pv_desc desc[PV_QUEUE_SIZE];
+};
+
+/* Entry of IOCTL_MAP_USER_BATCH and IOCTL_UNMAP_USER_BATCH (len is unused for unmaps) */
+#define MAX_BATCH_REQS 4096
+
+struct guest_map_req
+{
+    uint64_t vaddr;
+    uint64_t len;
+    uint64_t cpid;
+};
+
+/* Granularity of the gpas of a huge notifier (large fpga TLB pages) */
+#define LARGE_PAGE_SHIFT 21
+#define LARGE_PAGE_SIZE (1UL << LARGE_PAGE_SHIFT)
+
+/*
+ * Map/unmap request for the hypervisor. gpas holds one guest physical
+ * address per 4K page, or per large page (LARGE_PAGE_SIZE) if is_huge is set.
+ */
 struct hypervisor_map_notifier
 {
     uint64_t npages;
@@ -21,6 +21,10 @@
 
 #include "guest_fops.h"
 
+static bool host_faults = false;
+module_param(host_faults, bool, 0444);
+MODULE_PARM_DESC(host_faults, "Let the hypervisor resolve fpga TLB misses on huge pages without interrupting the vm");
+
 /**
  * @brief file operations that handle this device
  * 
@@ -81,7 +85,8 @@ int guest_release(struct inode *inode, struct file *f)
  * @brief guest version of register pid.
  * Writes to the REGISTER_PID register to
  * notify hypervisor of pid and then reads the same register
- * to get a cpid
+ * to get a cpid. With host_faults set, the page table root of the
+ * calling process is registered as well (REGISTER_PGD).
  *
  * @param d vfpga struct
  * @param pid pid of the process
@@ -108,6 +113,14 @@ static int32_t register_pid(struct vfpga *d, pid_t pid)
     // store for bookkeeping
     d->pid_array[cpid] = pid;
 
+    // hand the page table of the process to the hypervisor,
+    // the walk on the host only knows 4-level paging
+    if (host_faults && current->mm && !pgtable_l5_enabled())
+    {
+        addr = (unsigned long)d->pci_resources.bar2 + REGISTER_PGD_OFFSET;
+        writeq((uint64_t)__pa(current->mm->pgd) | cpid, (void __iomem *)addr);
+    }
+
     return cpid;
 }
 
@@ -150,6 +163,11 @@ static void unregister_pid(struct vfpga *d, pid_t cpid)
  * - IOCTL_UNMAP_USER
  * Called with vaddr and cpid. Unmaps a previously mapped region.
  * 
+ * - IOCTL_MAP_USER_BATCH / IOCTL_UNMAP_USER_BATCH
+ * Called with a pointer to an array of struct guest_map_req and its length.
+ * Like IOCTL_MAP_USER / IOCTL_UNMAP_USER for every entry, but handed to the
+ * hypervisor in batches through the submission queue.
+ * 
  * - IOCTL_READ_SHELL_CONFIG
  * Called without any arguments and returns a number that encodes
  * the platform configuration.
@@ -250,6 +268,43 @@ long guest_ioctl(struct file *f, unsigned int cmd, unsigned long arg)
         ret_val = guest_put_user_pages(d, tmp[0], (int32_t)tmp[1], 1);
         return ret_val;
     }
+    case IOCTL_MAP_USER_BATCH:
+    case IOCTL_UNMAP_USER_BATCH:
+    {
+        struct guest_map_req *reqs;
+
+        // read pointer to the requests + number of requests
+        ret_val = copy_from_user(&tmp, (unsigned long *)arg, sizeof(unsigned long) * 2);
+        if (ret_val)
+        {
+            pr_info("could not get batch info from user\n");
+            return ret_val;
+        }
+
+        if (tmp[1] == 0 || tmp[1] > MAX_BATCH_REQS)
+            return -EINVAL;
+
+        reqs = kvmalloc_array(tmp[1], sizeof(struct guest_map_req), GFP_KERNEL);
+        if (!reqs)
+            return -ENOMEM;
+
+        ret_val = copy_from_user(reqs, (void __user *)tmp[0], tmp[1] * sizeof(struct guest_map_req));
+        if (ret_val)
+        {
+            pr_info("could not get batch from user\n");
+            kvfree(reqs);
+            return -EFAULT;
+        }
+
+        dbg_info("%s %llu user buffers\n", cmd == IOCTL_MAP_USER_BATCH ? "Mapping" : "Putting", tmp[1]);
+        if (cmd == IOCTL_MAP_USER_BATCH)
+            ret_val = guest_get_user_pages_batch(d, reqs, tmp[1]);
+        else
+            ret_val = guest_put_user_pages_batch(d, reqs, tmp[1], 1);
+
+        kvfree(reqs);
+        return ret_val;
+    }
     case IOCTL_READ_SHELL_CONFIG:
     {
         tmp[0] = readq((void __iomem *)d->pci_resources.bar2 + READ_CNFG_OFFSET);
@@ -62,92 +62,260 @@ int guest_put_all_user_pages(struct vfpga *d, int dirtied)
     return 0;
 }
 
+/* Request of a batch, with its notifier until the hypervisor served it */
+struct batch_entry
+{
+    struct user_pages *user_pg;
+    struct hypervisor_map_notifier *notifier;
+    int64_t status;
+};
+
 /**
- * @brief explictly unmap an existing mapping. 
- * Takes the vaddr and cpid and unmaps an existing mapping
- * from the fpga. It also removes this mapping from the hashtable.
+ * @brief Hands the notifiers of a batch to the hypervisor. With a submission
+ * queue, all of them are posted and served by a single kick; otherwise each
+ * is written to its BAR2 register, as before. Entries without a notifier
+ * are skipped.
+ * 
+ * @param d vfpga device
+ * @param op PV_OP_MAP or PV_OP_UNMAP
+ * @param e batch, status is set for every entry with a notifier
+ * @param n number of entries, at most PV_QUEUE_SIZE
+ */
+static void submit_batch(struct vfpga *d, uint64_t op, struct batch_entry *e, int n)
+{
+    struct pv_queue *q;
+    struct pv_desc *desc;
+    unsigned long flags;
+    uint64_t first;
+    int i;
+
+    BUG_ON(n > PV_QUEUE_SIZE);
+
+    if (!d->pv_queue)
+    {
+        for (i = 0; i < n; i++)
+        {
+            if (!e[i].notifier)
+                continue;
+
+            writeq(virt_to_phys(e[i].notifier),
+                   d->pci_resources.bar2 + (op == PV_OP_MAP ? MAP_USER_OFFSET : UNMAP_USER_OFFSET));
+            e[i].status = 0;
+        }
+        return;
+    }
+
+    q = d->pv_queue;
+
+    spin_lock_irqsave(&d->pv_lock, flags);
+
+    // post
+    first = q->head;
+    for (i = 0; i < n; i++)
+    {
+        if (!e[i].notifier)
+            continue;
+
+        desc = &q->desc[q->head % PV_QUEUE_SIZE];
+        desc->op = op;
+        desc->notifier = virt_to_phys(e[i].notifier);
+        desc->status = -EINPROGRESS;
+        q->head++;
+    }
+
+    // served before the write returns
+    if (q->head != first)
+        writeq(0, d->pci_resources.bar2 + KICK_QUEUE_OFFSET);
+
+    // collect, unserved requests keep -EINPROGRESS
+    for (i = 0; i < n; i++)
+    {
+        if (!e[i].notifier)
+            continue;
+
+        e[i].status = q->desc[first % PV_QUEUE_SIZE].status;
+        first++;
+    }
+
+    if (q->tail != q->head)
+    {
+        pr_info("submission queue not drained, head %llu, tail %llu\n", q->head, q->tail);
+        q->tail = q->head;
+    }
+
+    spin_unlock_irqrestore(&d->pv_lock, flags);
+}
+
+/**
+ * @brief Puts the pages of a mapping and frees it.
+ * 
+ * @param user_pg mapping, no longer in the hash table
+ * @param dirtied mark pages as dirty prior to putting them
+ */
+static void release_user_pages(struct user_pages *user_pg, int dirtied)
+{
+    int i;
+
+    for (i = 0; i < user_pg->n_pages; i++)
+    {
+        if (dirtied)
+            SetPageDirty(user_pg->hpages[i]);
+        put_page(user_pg->hpages[i]);
+    }
+
+    kfree(user_pg->hpages);
+    kfree(user_pg);
+}
+
+/**
+ * @brief Removes the mapping of vaddr and cpid from the hashtable, puts its
+ * pages and prepares the unmap notifier for the hypervisor.
  * 
  * @param d vfpga device
  * @param vaddr start address that is to be unmapped
  * @param cpid cpid that mapped this address
  * @param dirtied mark pages as dirty prior to putting them
+ * @param e batch entry, gets the notifier; none if nothing was mapped
  * @return int 
  */
-int guest_put_user_pages(struct vfpga *d, uint64_t vaddr, int32_t cpid, int dirtied)
+static int unmap_user_buffer(struct vfpga *d, uint64_t vaddr, int32_t cpid, int dirtied, struct batch_entry *e)
 {
-    int i;
     struct user_pages *tmp_buff;
-    struct hypervisor_map_notifier *notifier;
-    uint64_t notifier_addr;
+    struct hlist_node *tmp;
 
-    BUG_ON(!d);
+    e->user_pg = NULL;
+    e->notifier = NULL;
+    e->status = 0;
 
     /*
     Iterate through all possible buckets there the vaddr could be mapped
     to. Check if the found the correct entry and if so, remove it.
-
-    The unmapping involves a call to the hypervisor.
     */
-    hash_for_each_possible(user_sbuff_map, tmp_buff, entry, vaddr)
+    hash_for_each_possible_safe(user_sbuff_map, tmp_buff, tmp, entry, vaddr)
     {
         if (tmp_buff->vaddr == vaddr && tmp_buff->cpid == cpid)
         {
-            if (dirtied)
-            {
-                for (i = 0; i < tmp_buff->n_pages; i++)
-                    SetPageDirty(tmp_buff->hpages[i]);
-            }
+            hash_del(&tmp_buff->entry);
+            release_user_pages(tmp_buff, dirtied);
 
-            for (i = 0; i < tmp_buff->n_pages; i++)
-            {
-                put_page(tmp_buff->hpages[i]);
-            }
+            if (e->notifier)
+                continue;
 
             // Notifiy hypervisor of unmap
-            notifier = kzalloc(sizeof(struct hypervisor_map_notifier), GFP_KERNEL);
-            if (!notifier)
+            e->notifier = kzalloc(sizeof(struct hypervisor_map_notifier), GFP_KERNEL);
+            if (!e->notifier)
             {
                 pr_info("failed to allocate memory for the hypervisor notifier");
                 return -ENOMEM;
             }
 
             // populate notifier
-            notifier->gva = vaddr;
-            notifier->cpid = cpid;
-            notifier->dirtied = dirtied;
+            e->notifier->gva = vaddr;
+            e->notifier->cpid = cpid;
+            e->notifier->dirtied = dirtied;
+        }
+    }
 
-            // notify
-            notifier_addr = virt_to_phys(notifier);
-            writeq(notifier_addr, d->pci_resources.bar2 + UNMAP_USER_OFFSET);
+    return 0;
+}
 
-            // free
-            kfree(notifier);
+/**
+ * @brief explictly unmap an existing mapping. 
+ * Takes the vaddr and cpid and unmaps an existing mapping
+ * from the fpga. It also removes this mapping from the hashtable.
+ * 
+ * @param d vfpga device
+ * @param vaddr start address that is to be unmapped
+ * @param cpid cpid that mapped this address
+ * @param dirtied mark pages as dirty prior to putting them
+ * @return int 
+ */
+int guest_put_user_pages(struct vfpga *d, uint64_t vaddr, int32_t cpid, int dirtied)
+{
+    struct guest_map_req req;
 
-            // Clean up
-            hash_del(&tmp_buff->entry);
-            kfree(tmp_buff->hpages);
-            // kfree(tmp_buff);
+    req.vaddr = vaddr;
+    req.len = 0;
+    req.cpid = cpid;
+
+    return guest_put_user_pages_batch(d, &req, 1, dirtied);
+}
+
+/**
+ * @brief Unmaps many mappings like guest_put_user_pages, with one call
+ * to the hypervisor per PV_QUEUE_SIZE mappings.
+ * 
+ * @param d vfpga device
+ * @param reqs vaddr and cpid of every mapping
+ * @param n number of mappings
+ * @param dirtied mark pages as dirty prior to putting them
+ * @return int 0 or the last error
+ */
+int guest_put_user_pages_batch(struct vfpga *d, struct guest_map_req *reqs, int n, int dirtied)
+{
+    struct batch_entry e[1];
+    struct batch_entry *batch;
+    int n_batch;
+    int ret_val, tmp_ret;
+    int i, j;
+
+    BUG_ON(!d);
+
+    // single unmaps need no allocation
+    batch = (n > 1) ? kcalloc(min(n, PV_QUEUE_SIZE), sizeof(struct batch_entry), GFP_KERNEL) : e;
+    if (!batch)
+        return -ENOMEM;
+
+    ret_val = 0;
+    for (i = 0; i < n; i += n_batch)
+    {
+        n_batch = min(n - i, PV_QUEUE_SIZE);
+
+        for (j = 0; j < n_batch; j++)
+        {
+            tmp_ret = unmap_user_buffer(d, reqs[i + j].vaddr, (int32_t)reqs[i + j].cpid, dirtied, &batch[j]);
+            if (tmp_ret)
+                ret_val = tmp_ret;
+        }
+
+        submit_batch(d, PV_OP_UNMAP, batch, n_batch);
+
+        for (j = 0; j < n_batch; j++)
+        {
+            if (!batch[j].notifier)
+                continue;
+
+            if (batch[j].status)
+                ret_val = batch[j].status;
+            kfree(batch[j].notifier);
         }
     }
 
-    return 0;
+    if (batch != e)
+        kfree(batch);
+
+    return ret_val;
 }
 
 /**
- * @brief Pins a user buffer so that it will not be evicted from cache and makes
- * it readable to the vfpga by a call to the hypervisor.
+ * @brief Pins a user buffer so that it will not be evicted from cache and
+ * prepares the map notifier for the hypervisor.
+ * Buffers in hugetlb mappings are pinned and passed to the hypervisor
+ * one large page at a time, so that they are mapped with large TLB entries.
  * 
  * @param d vfpga device
  * @param start start address
  * @param count number of bytes that should be mapped
  * @param cpid cpid of the calling process
  * @param pid pid of the calling process
+ * @param e batch entry, gets the mapping and the notifier; none for empty buffers
  * @return int 
  */
-int guest_get_user_pages(struct vfpga *d, uint64_t start, size_t count, int32_t cpid, pid_t pid)
+static int pin_user_buffer(struct vfpga *d, uint64_t start, size_t count, int32_t cpid, pid_t pid,
+                           struct batch_entry *e)
 {
     uint64_t first, last;
-    uint64_t notifier_addr;
+    uint64_t vaddr;
     int n_pages;
     int ret_val;
     int i;
@@ -165,6 +333,15 @@ int guest_get_user_pages(struct vfpga *d, uint64_t start, size_t count, int32_t
     ret_val = 0;
     BUG_ON(!d);
 
+    e->user_pg = NULL;
+    e->notifier = NULL;
+    e->status = 0;
+
+    if (start + count < start)
+        return -EINVAL;
+    if (count == 0)
+        return 0;
+
     // get mmu context
     curr_task = pid_task(find_vpid(pid), PIDTYPE_PID);
     if (!curr_task)
@@ -175,20 +352,26 @@ int guest_get_user_pages(struct vfpga *d, uint64_t start, size_t count, int32_t
     dbg_info("pid found %d", pid);
     curr_mm = curr_task->mm;
 
-    // Determine if hugepages
+    // Determine if hugepages, large fpga pages need guest pages at least as large
     vma_area_init = find_vma(curr_mm, start);
-    hugepages = is_vm_hugetlb_page(vma_area_init);
+    if (!vma_area_init)
+        return -EFAULT;
+    hugepages = is_vm_hugetlb_page(vma_area_init) &&
+                vma_kernel_pagesize(vma_area_init) >= LARGE_PAGE_SIZE;
 
     // number of pages
-    first = (start & PAGE_MASK) >> PAGE_SHIFT;
-    last = ((start + count - 1) & PAGE_MASK) >> PAGE_SHIFT;
+    if (hugepages)
+    {
+        first = start >> LARGE_PAGE_SHIFT;
+        last = (start + count - 1) >> LARGE_PAGE_SHIFT;
+    }
+    else
+    {
+        first = (start & PAGE_MASK) >> PAGE_SHIFT;
+        last = ((start + count - 1) & PAGE_MASK) >> PAGE_SHIFT;
+    }
     n_pages = last - first + 1;
 
-    if (start + count < start)
-        return -EINVAL;
-    if (count == 0)
-        return 0;
-
     // alloc user_pages
     user_pg = kzalloc(sizeof(struct user_pages), GFP_KERNEL);
     if (!user_pg)
@@ -213,11 +396,30 @@ int guest_get_user_pages(struct vfpga *d, uint64_t start, size_t count, int32_t
     dbg_info("hugepages: %d\n", hugepages);
 
     // Pin the pages
+    if (hugepages)
+    {
+        // Pinning any page of a huge page pins all of it, take the first 4K of every large page
+        for (i = 0; i < n_pages; i++)
+        {
+            vaddr = (first + i) << LARGE_PAGE_SHIFT;
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 9, 0)
-    ret_val = get_user_pages_remote(curr_mm, (unsigned long)start, n_pages, 1, user_pg->hpages, NULL, NULL);
+            ret_val = get_user_pages_remote(curr_mm, (unsigned long)vaddr, 1, 1, user_pg->hpages + i, NULL, NULL);
 #else
-    ret_val = get_user_pages_remote(curr_task, curr_mm, (unsigned long)start, n_pages, 1, user_pg->hpages, NULL);
+            ret_val = get_user_pages_remote(curr_task, curr_mm, (unsigned long)vaddr, 1, 1, user_pg->hpages + i, NULL);
 #endif
+            if (ret_val != 1)
+                break;
+        }
+        ret_val = i;
+    }
+    else
+    {
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 9, 0)
+        ret_val = get_user_pages_remote(curr_mm, (unsigned long)start, n_pages, 1, user_pg->hpages, NULL, NULL);
+#else
+        ret_val = get_user_pages_remote(curr_task, curr_mm, (unsigned long)start, n_pages, 1, user_pg->hpages, NULL);
+#endif
+    }
 
     // It was not possible to pin all pages
     if (ret_val < n_pages)
@@ -240,6 +442,7 @@ int guest_get_user_pages(struct vfpga *d, uint64_t start, size_t count, int32_t
     if (!notifier)
     {
         pr_info("Could not allocate notifier\n");
+        ret_val = -ENOMEM;
         goto err_notifier;
     }
 
@@ -253,6 +456,7 @@ int guest_get_user_pages(struct vfpga *d, uint64_t start, size_t count, int32_t
     /*
     Do the first step of the page table walk inside the vm
     and pass the guest physical addresses to the hypervisor.
+    For hugepages these are the addresses of the large pages.
     */
     for (i = 0; i < n_pages; i++)
     {
@@ -262,18 +466,8 @@ int guest_get_user_pages(struct vfpga *d, uint64_t start, size_t count, int32_t
 
     dbg_info("populated notifier with %lld pages\n", notifier->npages);
 
-    /*
-    Pass physical address to the hypervisor
-    */
-    notifier_addr = virt_to_phys(notifier);
-    writeq(notifier_addr, d->pci_resources.bar2 + MAP_USER_OFFSET);
-
-    dbg_info("Notified hypervisor with notifier at addr 0x%llx\n", notifier_addr);
-
-    kfree(notifier);
-
-    // Add to the hash table
-    hash_add(user_sbuff_map, &user_pg->entry, start);
+    e->user_pg = user_pg;
+    e->notifier = notifier;
 
     return 0;
     
@@ -295,4 +489,117 @@ fail_host_unmap:
     kfree(user_pg->hpages);
     kfree(user_pg);
     return -ENOMEM;
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Installs the pinned buffers of a batch on the fpga through the
+ * hypervisor and keeps track of the ones that were mapped.
+ * 
+ * @param d vfpga device
+ * @param e batch, as prepared by pin_user_buffer
+ * @param n number of entries, at most PV_QUEUE_SIZE
+ * @return int 0 or the last error
+ */
+static int map_batch(struct vfpga *d, struct batch_entry *e, int n)
+{
+    int ret_val;
+    int i;
+
+    submit_batch(d, PV_OP_MAP, e, n);
+
+    ret_val = 0;
+    for (i = 0; i < n; i++)
+    {
+        if (e[i].status)
+            ret_val = e[i].status;
+
+        if (!e[i].notifier)
+            continue;
+
+        kfree(e[i].notifier);
+
+        if (e[i].status)
+        {
+            pr_info("hypervisor failed to map vaddr %llx, %lld\n", e[i].user_pg->vaddr, e[i].status);
+            release_user_pages(e[i].user_pg, 0);
+            continue;
+        }
+
+        // Add to the hash table
+        hash_add(user_sbuff_map, &e[i].user_pg->entry, e[i].user_pg->vaddr);
+    }
+
+    return ret_val;
+}
+
+/**
+ * @brief Pins a user buffer so that it will not be evicted from cache and makes
+ * it readable to the vfpga by a call to the hypervisor.
+ * 
+ * @param d vfpga device
+ * @param start start address
+ * @param count number of bytes that should be mapped
+ * @param cpid cpid of the calling process
+ * @param pid pid of the calling process
+ * @return int 
+ */
+int guest_get_user_pages(struct vfpga *d, uint64_t start, size_t count, int32_t cpid, pid_t pid)
+{
+    struct batch_entry e;
+    int ret_val;
+
+    ret_val = pin_user_buffer(d, start, count, cpid, pid, &e);
+    if (ret_val)
+        return ret_val;
+
+    return map_batch(d, &e, 1);
+}
+
+/**
+ * @brief Maps many user buffers like guest_get_user_pages, with one call
+ * to the hypervisor per PV_QUEUE_SIZE buffers.
+ * 
+ * @param d vfpga device
+ * @param reqs vaddr, len and cpid of every buffer
+ * @param n number of buffers
+ * @return int 0 or the last error; buffers that could be mapped stay mapped
+ */
+int guest_get_user_pages_batch(struct vfpga *d, struct guest_map_req *reqs, int n)
+{
+    struct batch_entry *batch;
+    int n_batch;
+    int ret_val, tmp_ret;
+    int i, j;
+
+    BUG_ON(!d);
+
+    batch = kcalloc(min(n, PV_QUEUE_SIZE), sizeof(struct batch_entry), GFP_KERNEL);
+    if (!batch)
+        return -ENOMEM;
+
+    ret_val = 0;
+    for (i = 0; i < n; i += n_batch)
+    {
+        n_batch = min(n - i, PV_QUEUE_SIZE);
+
+        for (j = 0; j < n_batch; j++)
+        {
+            if (reqs[i + j].cpid >= N_CTID_MAX)
+            {
+                batch[j].notifier = NULL;
+                batch[j].status = -EINVAL;
+                continue;
+            }
+
+            batch[j].status = pin_user_buffer(d, reqs[i + j].vaddr, reqs[i + j].len, (int32_t)reqs[i + j].cpid,
+                                              d->pid_array[reqs[i + j].cpid], &batch[j]);
+        }
+
+        tmp_ret = map_batch(d, batch, n_batch);
+        if (tmp_ret)
+            ret_val = tmp_ret;
+    }
+
+    kfree(batch);
+    return ret_val;
+}
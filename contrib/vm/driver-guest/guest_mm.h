@@ -27,5 +27,7 @@
 int guest_put_all_user_pages(struct vfpga *d, int dirtied);
 int guest_get_user_pages(struct vfpga *d, uint64_t start, size_t count, int32_t cpid, pid_t pid);
 int guest_put_user_pages(struct vfpga *d, uint64_t vaddr, int32_t cpid, int dirtied);
+int guest_get_user_pages_batch(struct vfpga *d, struct guest_map_req *reqs, int n);
+int guest_put_user_pages_batch(struct vfpga *d, struct guest_map_req *reqs, int n, int dirtied);
 
 #endif
\ No newline at end of file
@@ -24,9 +24,34 @@
 dev_t devt;
 struct vfpga vfpga;
 
+/**
+ * @brief Releases the msix interrupts requested by register_msix.
+ *
+ * @param pdev
+ */
+static void unregister_msix(struct pci_dev *pdev)
+{
+    int i;
+
+    for (i = 0; i < vfpga.n_irqs; i++)
+    {
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 17, 0)
+        irq_update_affinity_hint(vfpga.irq_entry[i].vector, NULL);
+#else
+        irq_set_affinity_hint(vfpga.irq_entry[i].vector, NULL);
+#endif
+        free_irq(vfpga.irq_entry[i].vector, &vfpga);
+    }
+    vfpga.n_irqs = 0;
+
+    pci_disable_msix(pdev);
+}
+
 /**
  * @brief Sets-up the msix interrupts such that the hypervisor can interrupt
- * in a case of a page fault on the system.
+ * in a case of a page fault on the system. The hypervisor spreads faults
+ * over the vectors by ctid; every vector gets the page fault handler and
+ * is pinned to its own vCPU, like the vFPGA vectors of the host driver.
  *
  * @param pdev
  * @return int
@@ -46,25 +71,39 @@ static int register_msix(struct pci_dev *pdev)
     }
 
     /* Enable as many interrupts as possible */
-    ret_val = pci_enable_msix_range(pdev, vfpga.irq_entry, 0, nvecs);
+    ret_val = pci_enable_msix_range(pdev, vfpga.irq_entry, 1, nvecs);
     if (ret_val < 0)
     {
         dbg_info("Failed to allocate all msix vectors");
         return ret_val;
     }
+    nvecs = ret_val;
 
-    /* For now, the guest only needs one interrupt, for the page fault
-     this will be extended eventaully to support user interrupts*/
-
-    ret_val = request_irq(vfpga.irq_entry[0].vector,
-                          guest_fpga_tlb_miss_isr, 0, COYOTE_DRIVER_NAME, &vfpga);
-
-    if (ret_val)
+    vfpga.n_irqs = 0;
+    for (i = 0; i < nvecs; i++)
     {
-        dbg_info("could not register irq!\n");
-        return ret_val;
+        ret_val = request_irq(vfpga.irq_entry[i].vector,
+                              guest_fpga_tlb_miss_isr, 0, COYOTE_DRIVER_NAME, &vfpga);
+        if (ret_val)
+        {
+            dbg_info("could not register irq %d!\n", i);
+            unregister_msix(pdev);
+            return ret_val;
+        }
+        vfpga.n_irqs++;
+
+        /* Only a hint, the vector still works if it cannot be applied */
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 17, 0)
+        irq_set_affinity_and_hint(vfpga.irq_entry[i].vector,
+                                  cpumask_of(cpumask_local_spread(i, dev_to_node(&pdev->dev))));
+#else
+        irq_set_affinity_hint(vfpga.irq_entry[i].vector,
+                              cpumask_of(cpumask_local_spread(i, dev_to_node(&pdev->dev))));
+#endif
     }
 
+    dbg_info("registered %d msix vectors\n", nvecs);
+
     return 0;
 }
 
@@ -85,6 +124,38 @@ static void load_fpga_config(struct vfpga *d)
     d->en_avx = config & 0x01;
 }
 
+/**
+ * @brief Sets up the submission queue shared with the hypervisor.
+ * The hypervisor echoes the address back if it supports the queue,
+ * otherwise requests keep going through the single BAR2 registers.
+ *
+ * @param d vfpga struct
+ */
+static void setup_pv_queue(struct vfpga *d)
+{
+    uint64_t gpa;
+
+    d->pv_queue = (struct pv_queue *)get_zeroed_page(GFP_KERNEL);
+    if (!d->pv_queue)
+    {
+        dbg_info("Failed to allocate submission queue\n");
+        return;
+    }
+
+    gpa = virt_to_phys(d->pv_queue);
+    writeq(gpa, (volatile __iomem void *)d->pci_resources.bar2 + SETUP_QUEUE_OFFSET);
+
+    if (readq((volatile __iomem void *)d->pci_resources.bar2 + SETUP_QUEUE_OFFSET) != gpa)
+    {
+        dbg_info("No submission queue support in the hypervisor\n");
+        free_page((unsigned long)d->pv_queue);
+        d->pv_queue = NULL;
+        return;
+    }
+
+    dbg_info("Submission queue at gpa %llx\n", gpa);
+}
+
 /**
  * @brief Called upon the bus picks up the emulated
  * pci device. Creates chardevs, claims resources
@@ -184,6 +255,10 @@ int guest_probe(struct pci_dev *pdev, const struct pci_device_id *id)
     // Init locks
     spin_lock_init(&vfpga.cpid_lock);
     spin_lock_init(&vfpga.lock);
+    spin_lock_init(&vfpga.pv_lock);
+
+    /* Batch map requests to the hypervisor */
+    setup_pv_queue(&vfpga);
 
     /* Create kernel device */
     vfpga.dev = device_create(guest_class, NULL, devt, NULL, "fpga0");
@@ -199,8 +274,12 @@ int guest_probe(struct pci_dev *pdev, const struct pci_device_id *id)
     return 0;
 
 err_device_create:
-    pci_free_irq_vectors(pdev);
-    pci_disable_msix(pdev);
+    if (vfpga.pv_queue)
+    {
+        free_page((unsigned long)vfpga.pv_queue);
+        vfpga.pv_queue = NULL;
+    }
+    unregister_msix(pdev);
 err_interrupt:
     pci_iounmap(pdev, (void __iomem *)vfpga.pci_resources.bar0);
     pci_iounmap(pdev, (void __iomem *)vfpga.pci_resources.bar2);
@@ -230,6 +309,14 @@ void guest_remove(struct pci_dev *pdev)
     // Destory device
     device_destroy(guest_class, devt);
 
+    // Tear down the submission queue
+    if (vfpga.pv_queue)
+    {
+        writeq(0, (void __iomem *)vfpga.pci_resources.bar2 + SETUP_QUEUE_OFFSET);
+        free_page((unsigned long)vfpga.pv_queue);
+        vfpga.pv_queue = NULL;
+    }
+
     // Unmap pci regions
     pci_iounmap(pdev, (void __iomem *)vfpga.pci_resources.bar0);
     pci_iounmap(pdev, (void __iomem *)vfpga.pci_resources.bar2);
@@ -239,8 +326,7 @@ void guest_remove(struct pci_dev *pdev)
     pci_release_regions(pdev);
 
     // Disable device
-    free_irq(vfpga.irq_entry[0].vector, &vfpga);
-    pci_disable_msix(pdev);
+    unregister_msix(pdev);
     pci_disable_device(pdev);
     cdev_del(&vfpga.cdev);
     unregister_chrdev_region(devt, 1);
@@ -24,10 +24,20 @@
 
 #include "../coyote_dev.h"
 #include <linux/eventfd.h>
+#include <linux/mutex.h>
+#include <linux/workqueue.h>
+#include <linux/version.h>
+#include <linux/vfio.h>
 
 // #define HYPERVISOR_TEST
 
-#define NUM_INTERRUPTS 1
+// Live migration needs the VFIO migration region (v1 protocol)
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 8, 0)
+#define HYPERVISOR_MIGRATION
+#endif
+
+// page faults are spread over the vectors by cpid (fire_fault_interrupt)
+#define NUM_INTERRUPTS 8
 #define MAX_VMS 16
 
 #define COYOTE_HYPERVISOR_CONFIG_SIZE 0x100
@@ -41,6 +51,13 @@
 
 #define BAR0_INDEX_SHIFT 16
 
+/*
+ * Parts of BAR0 the guest may mmap (sparse mmap areas): the user and config
+ * registers, so that cThread commands reach the hardware without a VM exit.
+ * The TLB pages are left out; guest accesses to them trap.
+ */
+#define BAR0_N_MMAP_AREAS 2
+
 #define COYOTE_REGION_OFFSET 32
 #define COYOTE_GET_INDEX(__addr) (__addr >> COYOTE_REGION_OFFSET)
 #define COYOTE_INDEX_TO_ADDR(__index) (__index << COYOTE_REGION_OFFSET);
@@ -54,6 +71,9 @@
 #define READ_CNFG_OFFSET 0x20
 #define PUT_ALL_USER_PAGES 0x28
 #define TEST_INTERRUPT_OFFSET 0x30
+#define REGISTER_PGD_OFFSET 0x38
+#define SETUP_QUEUE_OFFSET 0x40
+#define KICK_QUEUE_OFFSET 0x48
 
 #define INVALID_CPID 0xffffffffffffffff
 
@@ -66,6 +86,20 @@
 #define LARGE_TABLE_SHIFT 21
 #define LARGE_TABLE_SIZE (1 << 21)
 
+/* Guest pages kept pinned after unmap, per VM (see hypervisor_mmu.c) */
+#define PIN_CACHE_TABLE_ORDER 10
+#define PIN_CACHE_BUCKETS (1 << PIN_CACHE_TABLE_ORDER)
+#define PIN_CACHE_MAX_PAGES (1 << 16)
+
+/* Guest processes whose TLB misses can be resolved on the host (REGISTER_PGD) */
+#define HYPERVISOR_N_CPID_MAX 64
+
+/* Migration region: state fields, then a window for the device state */
+#define MIGRATION_REGION_INDEX VFIO_PCI_NUM_REGIONS
+#define MIGRATION_DATA_OFFSET 0x1000
+#define MIGRATION_DATA_SIZE 0x10000
+#define COYOTE_HYPERVISOR_MIGRATION_SIZE ((uint64_t)(MIGRATION_DATA_OFFSET + MIGRATION_DATA_SIZE))
+
 #define MSIX_OFFSET 0x40
 #define MSIX_SIZE sizeof(struct msix_cap_header)
 
@@ -129,6 +163,10 @@ struct pci_config_space
     uint8_t cap_section[0xbf];     // 0x40
 } __packed;
 
+/*
+ * Map/unmap request from the guest. gpas holds one guest physical address
+ * per 4K page, or per large page (LARGE_TABLE_SIZE) if is_huge is set.
+ */
 struct hypervisor_map_notifier
 {
     uint64_t npages;
@@ -140,6 +178,48 @@ struct hypervisor_map_notifier
     uint64_t gpas[0];
 };
 
+/*
+ * Paravirtual submission queue in guest memory (SETUP_QUEUE). The guest
+ * fills descriptors at head and kicks once per batch (KICK_QUEUE); the
+ * hypervisor serves all of them before the kick returns, writing back the
+ * status of each and the new tail.
+ */
+#define PV_QUEUE_SIZE 64
+
+#define PV_OP_MAP 1   // notifier: hypervisor_map_notifier, as for MAP_USER
+#define PV_OP_UNMAP 2 // notifier: hypervisor_map_notifier, as for UNMAP_USER
+
+struct pv_desc
+{
+    uint64_t op;
+    uint64_t notifier; // gpa of the notifier
+    int64_t status;    // 0 or error code, written by the hypervisor
+    uint64_t reserved;
+};
+
+struct pv_queue
+{
+    uint64_t head; // next descriptor filled by the guest
+    uint64_t tail; // next descriptor served by the hypervisor
+    struct pv_desc desc[PV_QUEUE_SIZE];
+};
+
+/* Installed user mapping, kept to re-install it after a migration */
+struct saved_mapping
+{
+    struct list_head list;
+    struct hypervisor_map_notifier notifier; // last, followed by the gpas
+};
+
+/* Pinned guest page, cached by guest frame number */
+struct pinned_page
+{
+    uint64_t gfn;
+    struct page *page;
+    struct hlist_node entry;
+    struct list_head lru;
+};
+
 /* Mediated vFPGA management data */
 struct m_fpga_dev
 {
@@ -159,6 +239,40 @@ struct m_fpga_dev
 
     struct hlist_head sbuff_map[HASH_TABLE_BUCKETS];
 
+    // pinned page cache, most recently used first
+    struct hlist_head pin_cache[PIN_CACHE_BUCKETS];
+    struct list_head pin_lru;
+    uint64_t n_pinned;
+    uint64_t pin_cache_gen;
+    spinlock_t pin_cache_lock;
+
+    // serializes the user mappings of the guest and of the fault worker
+    struct mutex sbuff_lock;
+
+    // paravirtual submission queue, gpa (0 = not set up)
+    uint64_t pv_queue_gpa;
+
+    // guest pid per registered cpid
+    uint64_t cpid_pid[HYPERVISOR_N_CPID_MAX];
+
+    // live migration, see hypervisor_migration.c
+    struct list_head saved_maps;
+    int saved_maps_lost;
+#ifdef HYPERVISOR_MIGRATION
+    struct vfio_device_migration_info mig_info;
+    void *mig_data;
+    uint64_t mig_size;
+    uint64_t mig_cursor;
+    void *mig_window;
+#endif
+
+    // host-side TLB miss resolution, guest page table root per cpid (0 = forward to the guest)
+    uint64_t cpid_pgd[HYPERVISOR_N_CPID_MAX];
+    struct work_struct fault_work;
+    uint64_t fault_vaddr;
+    uint32_t fault_len;
+    int32_t fault_cpid;
+
     spinlock_t lock;
 };
 
@@ -20,6 +20,7 @@
  */
 
 #include "hypervisor_interrupts.h"
+#include "hypervisor_mmu.h"
 
 /**
  * @brief Set the up msix header.
@@ -167,9 +168,16 @@ int handle_set_irq_msix(struct m_fpga_dev *d, struct vfio_irq_set *irq_set)
     int ret_val;
     int start, end;
     int mask_val;
+    int32_t *fds;
 
     ret_val = 0;
 
+    if (irq_set->start >= NUM_INTERRUPTS || irq_set->count > NUM_INTERRUPTS - irq_set->start)
+    {
+        dbg_info("Invalid interrupt range, start: %u, count: %u\n", irq_set->start, irq_set->count);
+        return -EINVAL;
+    }
+
     // Disable all interrupts
     if ((irq_set->flags & VFIO_IRQ_SET_ACTION_TRIGGER) && (irq_set->flags & VFIO_IRQ_SET_DATA_NONE) && (irq_set->count == 0))
     {
@@ -182,6 +190,8 @@ int handle_set_irq_msix(struct m_fpga_dev *d, struct vfio_irq_set *irq_set)
         // start and end allows to only specify a range of interrupts to set
         start = irq_set->start;
         end = start + irq_set->count;
+        // one eventfd (int32) per interrupt
+        fds = (int32_t *)irq_set->data;
 
         for (i = start; i < end; i++)
         {
@@ -192,13 +202,13 @@ int handle_set_irq_msix(struct m_fpga_dev *d, struct vfio_irq_set *irq_set)
             }
 
             // Register the interrupt and get the eventfd context
-            d->msix_vector[i].eventfd = irq_set->data[i - start];
-            d->msix_vector[i].ctx = eventfd_ctx_fdget(irq_set->data[i - start]);
+            d->msix_vector[i].eventfd = fds[i - start];
+            d->msix_vector[i].ctx = eventfd_ctx_fdget(fds[i - start]);
             if (IS_ERR_OR_NULL(d->msix_vector[i].ctx))
             {
                 dbg_info("Failed to get eventfd ctx, fd: %d, ctx: %p", d->msix_vector[i].eventfd, d->msix_vector[i].ctx);
             }
-            dbg_info("Set interrupt %d to %d, ctx: %p\n", i, irq_set->data[i - start], d->msix_vector[i].ctx);
+            dbg_info("Set interrupt %d to %d, ctx: %p\n", i, fds[i - start], d->msix_vector[i].ctx);
         }
     }
 
@@ -264,13 +274,35 @@ inline uint64_t fire_interrupt(struct msix_interrupt *inter)
     return eventfd_signal(inter->ctx, 0);
 }
 
+/**
+ * @brief Forwards a page fault of cpid to the vm. Faults are spread over
+ * the msix vectors by cpid, so that the guest serves faults of different
+ * processes on different vCPUs. Falls back to vector 0 if the guest
+ * enabled fewer vectors.
+ * 
+ * @param md mediated device
+ * @param cpid faulting cpid
+ * @return uint64_t eventfd_signal value. Can be discarded for our use.
+ */
+uint64_t fire_fault_interrupt(struct m_fpga_dev *md, int32_t cpid)
+{
+    struct msix_interrupt *inter;
+
+    inter = &md->msix_vector[(uint32_t)cpid % NUM_INTERRUPTS];
+    if (IS_ERR_OR_NULL(inter->ctx))
+        inter = &md->msix_vector[0];
+
+    return fire_interrupt(inter);
+}
+
 /**
  * @brief Hypervisor version of the tlb miss interrupt
  * service routine. This function uses the same registers from the
- * fpga to read the faulting address. Instead of handling the page fault
- * it is forwarded to the vm to be handled there. This is because 
- * the fault address will be a guest virtual address and cannot be 
- * resolved from the hypervisor. 
+ * fpga to read the faulting address. The fault address is a guest
+ * virtual address: unless the guest registered the page table of the
+ * faulting process, the fault is forwarded to the vm to be handled there.
+ * Otherwise it is handed to the fault worker, which tries to resolve
+ * it on the host (see hypervisor_mmu.c).
  * 
  * @param irq interrupt request number
  * @param dev_id pointer to device, given then registered the interrupt
@@ -283,7 +315,7 @@ irqreturn_t hypervisor_tlb_miss_isr(int irq, void *dev_id)
     int32_t cpid;
     struct fpga_dev *d;
     struct bus_drvdata *pd;
-    uint64_t tmp;
+    uint64_t vaddr, tmp;
 
     dbg_info("(irq=%d) page fault ISR\n", irq);
     BUG_ON(!dev_id);
@@ -301,11 +333,13 @@ irqreturn_t hypervisor_tlb_miss_isr(int irq, void *dev_id)
     // tmp cointains the cpid.
     if (pd->en_avx)
     {
+        vaddr = d->fpga_cnfg_avx->vaddr_miss;
         tmp = d->fpga_cnfg_avx->len_miss;
         cpid = (int32_t)HIGH_32(tmp);
     }
     else
     {
+        vaddr = d->cnfg_regs->vaddr_miss;
         tmp = d->cnfg_regs->len_miss;
         cpid = (int32_t)HIGH_32(tmp);
     }
@@ -314,12 +348,67 @@ irqreturn_t hypervisor_tlb_miss_isr(int irq, void *dev_id)
     md = d->vdevs[cpid];
     BUG_ON(!md);
 
-    // Fire interrupt in vm
-    fire_interrupt(&md->msix_vector[0]);
-    // dbg_info("Interrupt forwarded to vm!\n");
+    if (cpid < HYPERVISOR_N_CPID_MAX && md->cpid_pgd[cpid])
+    {
+        // Resolve on the host, pinning pages may sleep
+        md->fault_vaddr = vaddr;
+        md->fault_len = LOW_32(tmp);
+        md->fault_cpid = cpid;
+        schedule_work(&md->fault_work);
+    }
+    else
+    {
+        // Fire interrupt in vm
+        fire_fault_interrupt(md, cpid);
+        // dbg_info("Interrupt forwarded to vm!\n");
+    }
 
     // unlock
     spin_unlock_irqrestore(&(d->lock), flags);
 
     return IRQ_HANDLED;
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Resolves a tlb miss recorded by hypervisor_tlb_miss_isr on
+ * the host. On success the engine is restarted without involving the vm,
+ * otherwise the fault is forwarded to the vm like any other. The guest reads
+ * the fault from the same registers, they are only cleared by the restart.
+ * 
+ * @param work fault_work of the mediated device
+ */
+void hypervisor_fault_work(struct work_struct *work)
+{
+    struct m_fpga_dev *md;
+    struct fpga_dev *d;
+    struct bus_drvdata *pd;
+    unsigned long flags;
+    int ret_val;
+
+    md = container_of(work, struct m_fpga_dev, fault_work);
+    d = md->fpga;
+    BUG_ON(!d);
+    pd = d->pd;
+    BUG_ON(!pd);
+
+    ret_val = hypervisor_resolve_fault(md, md->fault_vaddr, md->fault_len, md->fault_cpid);
+
+    spin_lock_irqsave(&(d->lock), flags);
+
+    if (ret_val)
+    {
+        fire_fault_interrupt(md, md->fault_cpid);
+    }
+    else
+    {
+#ifndef HYPERVISOR_TEST
+        // restart the engine
+        if (pd->en_avx)
+            d->fpga_cnfg_avx->ctrl[0] = FPGA_CNFG_CTRL_IRQ_RESTART;
+        else
+            d->cnfg_regs->ctrl = FPGA_CNFG_CTRL_IRQ_RESTART;
+#endif
+    }
+
+    spin_unlock_irqrestore(&(d->lock), flags);
+}
@@ -32,6 +32,8 @@ size_t write_to_msix_header(void *cfg, uint8_t offset, uint32_t val, uint8_t cou
 void msix_unset_all_interrupts(struct m_fpga_dev *d);
 int handle_set_irq_msix(struct m_fpga_dev *d, struct vfio_irq_set *irq_set);
 uint64_t fire_interrupt(struct msix_interrupt *inter);
+uint64_t fire_fault_interrupt(struct m_fpga_dev *md, int32_t cpid);
 irqreturn_t hypervisor_tlb_miss_isr(int irq, void *dev_id);
+void hypervisor_fault_work(struct work_struct *work);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,587 @@
+/**
+ * Copyright (c) 2025,  Systems Group, ETH Zurich
+ * All rights reserved.
+ *
+ * This file is part of the Coyote VM driver for Linux.
+ * Coyote can be found at: https://github.com/fpgasystems/Coyote
+ *
+ * This source code is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * The full GNU General Public License is included in this distribution in
+ * the file called "COPYING". If not found, a copy of the GNU General Public
+ * License can be found <https://www.gnu.org/licenses/>.
+ */
+
+#include "hypervisor_migration.h"
+#include "hypervisor_mmu.h"
+
+/*
+ * Live migration
+ *
+ * The mediated device exposes a VFIO migration region (v1 protocol) next to
+ * the PCI regions. QEMU drives it through the device_state field: entering
+ * the stop-and-copy phase (SAVING without RUNNING) captures the software
+ * state of the vFPGA, which QEMU then reads out through the data window and
+ * writes into the migration region of the vFPGA on the destination host
+ * (RESUMING). Leaving RESUMING restores the state there:
+ *
+ *  - the emulated PCI config space and the paravirtual queue,
+ *  - the cpids of the guest processes, with their guest pid and the page
+ *    table root for host-side fault resolution. The guest driver keeps
+ *    using its cpids, so the destination must hand out the same ones,
+ *  - the user mappings, re-installed from their notifiers: the guest pages
+ *    are pinned again on the destination and the TLB of its fpga is filled.
+ *
+ * Guest memory is not tracked here, the pages are pinned behind the back of
+ * VFIO and QEMU transfers all of it. State that only lives on the fpga can
+ * not be moved: a vFPGA on a shell with card memory or a network stack
+ * refuses to enter SAVING and the migration is aborted.
+ */
+
+#ifdef HYPERVISOR_MIGRATION
+
+#define MIGRATION_MAGIC 0x4359564d
+#define MIGRATION_VERSION 1
+
+// upper bound of the device state accepted on the destination
+#define MIGRATION_MAX_BYTES (64ULL << 20)
+
+/* Device state: header, one mig_cpid per cpid, then the saved notifiers */
+struct mig_header
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t size; // total bytes, header included
+    uint32_t n_cpids;
+    uint32_t n_maps;
+    uint64_t pv_queue_gpa;
+    struct pci_config_space pci_config;
+};
+
+struct mig_cpid
+{
+    uint64_t cpid;
+    uint64_t pid;
+    uint64_t pgd;
+};
+
+#define MIGRATION_HEADER_BYTES ALIGN(sizeof(struct mig_header), 8)
+
+/**
+ * @brief Drops the captured or received device state
+ *
+ * @param md mediated device
+ */
+static void free_state(struct m_fpga_dev *md)
+{
+    kvfree(md->mig_data);
+    md->mig_data = NULL;
+    md->mig_size = 0;
+    md->mig_cursor = 0;
+    md->mig_info.data_size = 0;
+}
+
+/**
+ * @brief Checks that the complete state of the vFPGA is known to the hypervisor
+ *
+ * @param md mediated device
+ * @return int 0 if the vFPGA can be migrated
+ */
+static int migratable(struct m_fpga_dev *md)
+{
+    struct bus_drvdata *pd;
+
+    pd = md->fpga->pd;
+
+    // card memory and connections are only held by the fpga
+    if (pd->en_mem || pd->en_rdma_0 || pd->en_rdma_1 || pd->en_tcp_0 || pd->en_tcp_1)
+    {
+        pr_err("%s.%u: vfpga %d keeps state on the card, not migratable\n", __func__, __LINE__, md->id);
+        return -EOPNOTSUPP;
+    }
+
+    if (md->saved_maps_lost)
+    {
+        pr_err("%s.%u: mappings of vfpga %d were not recorded, not migratable\n", __func__, __LINE__, md->id);
+        return -ENOMEM;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Captures the state of the stopped vm into md->mig_data
+ *
+ * @param md mediated device
+ * @return int 0 on success
+ */
+static int save_state(struct m_fpga_dev *md)
+{
+    DECLARE_BITMAP(cpids, HYPERVISOR_N_CPID_MAX);
+    struct bus_drvdata *pd;
+    struct saved_mapping *saved;
+    struct mig_header *hdr;
+    struct mig_cpid *entry;
+    uint64_t size, bytes;
+    uint32_t n_maps;
+    void *data, *p;
+    int i;
+
+    pd = md->fpga->pd;
+    bitmap_zero(cpids, HYPERVISOR_N_CPID_MAX);
+
+    // the vcpus are stopped, wait for a fault still being resolved
+    flush_work(&md->fault_work);
+
+    mutex_lock(&md->sbuff_lock);
+
+    spin_lock(&pd->stat_lock);
+    for (i = 0; i < HYPERVISOR_N_CPID_MAX; i++)
+    {
+        if (md->fpga->vdevs[i] == md)
+            set_bit(i, cpids);
+    }
+    spin_unlock(&pd->stat_lock);
+
+    size = MIGRATION_HEADER_BYTES + bitmap_weight(cpids, HYPERVISOR_N_CPID_MAX) * sizeof(struct mig_cpid);
+    n_maps = 0;
+    list_for_each_entry(saved, &md->saved_maps, list)
+    {
+        size += sizeof(struct hypervisor_map_notifier) + saved->notifier.npages * sizeof(uint64_t);
+        n_maps++;
+    }
+
+    data = kvzalloc(size, GFP_KERNEL);
+    if (!data)
+    {
+        mutex_unlock(&md->sbuff_lock);
+        return -ENOMEM;
+    }
+
+    hdr = data;
+    hdr->magic = MIGRATION_MAGIC;
+    hdr->version = MIGRATION_VERSION;
+    hdr->size = size;
+    hdr->n_cpids = bitmap_weight(cpids, HYPERVISOR_N_CPID_MAX);
+    hdr->n_maps = n_maps;
+    hdr->pv_queue_gpa = md->pv_queue_gpa;
+    hdr->pci_config = md->pci_config;
+
+    p = data + MIGRATION_HEADER_BYTES;
+    for_each_set_bit(i, cpids, HYPERVISOR_N_CPID_MAX)
+    {
+        entry = p;
+        entry->cpid = i;
+        entry->pid = md->cpid_pid[i];
+        entry->pgd = md->cpid_pgd[i];
+        p += sizeof(struct mig_cpid);
+    }
+
+    list_for_each_entry(saved, &md->saved_maps, list)
+    {
+        bytes = sizeof(struct hypervisor_map_notifier) + saved->notifier.npages * sizeof(uint64_t);
+        memcpy(p, &saved->notifier, bytes);
+        p += bytes;
+    }
+
+    mutex_unlock(&md->sbuff_lock);
+
+    free_state(md);
+    md->mig_data = data;
+    md->mig_size = size;
+
+    dbg_info("captured state of vfpga %d, %llu bytes, %u cpids, %u mappings\n",
+             md->id, size, hdr->n_cpids, n_maps);
+    return 0;
+}
+
+/**
+ * @brief Undoes a partial restore: removes the mappings and releases the cpids
+ *
+ * @param md mediated device
+ */
+static void undo_restore(struct m_fpga_dev *md)
+{
+    struct bus_drvdata *pd;
+    int i;
+
+    pd = md->fpga->pd;
+
+    mutex_lock(&md->sbuff_lock);
+    hypervisor_tlb_put_user_pages_all(md, 0);
+    mutex_unlock(&md->sbuff_lock);
+
+    spin_lock(&pd->stat_lock);
+    for (i = 0; i < HYPERVISOR_N_CPID_MAX; i++)
+    {
+        if (md->fpga->vdevs[i] != md)
+            continue;
+
+        unregister_pid(md->fpga, i);
+        md->fpga->vdevs[i] = NULL;
+        md->cpid_pid[i] = 0;
+        md->cpid_pgd[i] = 0;
+    }
+    spin_unlock(&pd->stat_lock);
+}
+
+/**
+ * @brief Restores the state received in md->mig_data
+ *
+ * @param md mediated device
+ * @return int 0 on success
+ */
+static int restore_state(struct m_fpga_dev *md)
+{
+    struct bus_drvdata *pd;
+    struct mig_header *hdr;
+    struct mig_cpid *entry;
+    struct hypervisor_map_notifier *notifier;
+    uint64_t cpid, bytes;
+    void *p, *end;
+    int ret_val;
+    uint32_t i;
+
+    pd = md->fpga->pd;
+    hdr = md->mig_data;
+
+    if (!hdr || md->mig_cursor != md->mig_size || !md->kvm)
+    {
+        pr_err("%s.%u: incomplete state for vfpga %d\n", __func__, __LINE__, md->id);
+        return -EINVAL;
+    }
+
+    if (hdr->version != MIGRATION_VERSION ||
+        MIGRATION_HEADER_BYTES + (uint64_t)hdr->n_cpids * sizeof(struct mig_cpid) > md->mig_size)
+    {
+        pr_err("%s.%u: invalid state for vfpga %d\n", __func__, __LINE__, md->id);
+        return -EINVAL;
+    }
+
+    md->pci_config = hdr->pci_config;
+    md->pv_queue_gpa = hdr->pv_queue_gpa;
+
+    // the guest driver keeps its cpids, they have to be free here as well
+    p = md->mig_data + MIGRATION_HEADER_BYTES;
+    for (i = 0; i < hdr->n_cpids; i++)
+    {
+        entry = p;
+        p += sizeof(struct mig_cpid);
+
+        if (entry->cpid >= HYPERVISOR_N_CPID_MAX)
+        {
+            ret_val = -EINVAL;
+            goto err_restore;
+        }
+
+        spin_lock(&pd->stat_lock);
+        cpid = register_pid(md->fpga, entry->pid | (md->id << 16));
+        if (cpid != entry->cpid)
+        {
+            if (cpid != -1)
+                unregister_pid(md->fpga, cpid);
+            spin_unlock(&pd->stat_lock);
+
+            pr_err("%s.%u: cpid %llu of vfpga %d is taken on this host\n", __func__, __LINE__, entry->cpid, md->id);
+            ret_val = -EBUSY;
+            goto err_restore;
+        }
+
+        md->fpga->vdevs[cpid] = md;
+        spin_unlock(&pd->stat_lock);
+
+        md->cpid_pid[cpid] = entry->pid;
+        md->cpid_pgd[cpid] = entry->pgd;
+    }
+
+    // pin the guest pages again and fill the TLB
+    end = md->mig_data + md->mig_size;
+    for (i = 0; i < hdr->n_maps; i++)
+    {
+        notifier = p;
+        if (p + sizeof(struct hypervisor_map_notifier) > end || notifier->npages == 0 ||
+            notifier->npages > (end - p - sizeof(struct hypervisor_map_notifier)) / sizeof(uint64_t))
+        {
+            ret_val = -EINVAL;
+            goto err_restore;
+        }
+        bytes = sizeof(struct hypervisor_map_notifier) + notifier->npages * sizeof(uint64_t);
+
+        mutex_lock(&md->sbuff_lock);
+        ret_val = hypervisor_tlb_get_user_pages(md, notifier);
+        mutex_unlock(&md->sbuff_lock);
+        if (ret_val)
+            goto err_restore;
+
+        p += bytes;
+    }
+
+    dbg_info("restored state of vfpga %d, %u cpids, %u mappings\n", md->id, hdr->n_cpids, hdr->n_maps);
+    return 0;
+
+err_restore:
+    pr_err("%s.%u: failed to restore vfpga %d, %d\n", __func__, __LINE__, md->id, ret_val);
+    undo_restore(md);
+    return ret_val;
+}
+
+/**
+ * @brief Appends a chunk written to the data window to the received state.
+ * The first chunk starts with the header, which carries the total size.
+ *
+ * @param md mediated device
+ * @param size bytes written to the data window
+ * @return int 0 on success
+ */
+static int receive_chunk(struct m_fpga_dev *md, uint64_t size)
+{
+    struct mig_header *hdr;
+
+    if (size > MIGRATION_DATA_SIZE)
+        return -EINVAL;
+
+    if (!md->mig_data)
+    {
+        hdr = md->mig_window;
+        if (size < MIGRATION_HEADER_BYTES || hdr->magic != MIGRATION_MAGIC ||
+            hdr->size < MIGRATION_HEADER_BYTES || hdr->size > MIGRATION_MAX_BYTES)
+        {
+            pr_err("%s.%u: invalid state for vfpga %d\n", __func__, __LINE__, md->id);
+            return -EINVAL;
+        }
+
+        md->mig_data = kvzalloc(hdr->size, GFP_KERNEL);
+        if (!md->mig_data)
+            return -ENOMEM;
+
+        md->mig_size = hdr->size;
+        md->mig_cursor = 0;
+    }
+
+    if (md->mig_cursor + size > md->mig_size)
+        return -EINVAL;
+
+    memcpy(md->mig_data + md->mig_cursor, md->mig_window, size);
+    md->mig_cursor += size;
+    md->mig_info.data_size = size;
+
+    return 0;
+}
+
+/**
+ * @brief Stages the next chunk of the captured state in the data window
+ *
+ * @param md mediated device
+ */
+static void send_chunk(struct m_fpga_dev *md)
+{
+    uint64_t size;
+
+    size = min_t(uint64_t, md->mig_size - md->mig_cursor, MIGRATION_DATA_SIZE);
+    if (size)
+        memcpy(md->mig_window, md->mig_data + md->mig_cursor, size);
+
+    md->mig_cursor += size;
+    md->mig_info.data_size = size;
+}
+
+/**
+ * @brief Moves the device to a new migration state
+ *
+ * @param md mediated device
+ * @param state new device state
+ * @return int 0 on success, an error aborts the migration
+ */
+static int set_state(struct m_fpga_dev *md, uint32_t state)
+{
+    uint32_t old;
+    int ret_val;
+
+    old = md->mig_info.device_state;
+    if (!VFIO_DEVICE_STATE_VALID(state) || (state & ~VFIO_DEVICE_STATE_MASK))
+        return -EINVAL;
+
+    dbg_info("vfpga %d migration state %u -> %u\n", md->id, old, state);
+
+    if ((state & (VFIO_DEVICE_STATE_SAVING | VFIO_DEVICE_STATE_RESUMING)) && !md->mig_window)
+    {
+        md->mig_window = kvzalloc(MIGRATION_DATA_SIZE, GFP_KERNEL);
+        if (!md->mig_window)
+            return -ENOMEM;
+    }
+
+    if ((state & VFIO_DEVICE_STATE_SAVING) && !(old & VFIO_DEVICE_STATE_SAVING))
+    {
+        ret_val = migratable(md);
+        if (ret_val)
+            return ret_val;
+        free_state(md);
+    }
+
+    // stop-and-copy, nothing is sent while the vm is still running
+    if (state == VFIO_DEVICE_STATE_SAVING && old != state)
+    {
+        ret_val = save_state(md);
+        if (ret_val)
+            return ret_val;
+    }
+
+    if (!(state & VFIO_DEVICE_STATE_SAVING) && (old & VFIO_DEVICE_STATE_SAVING))
+        free_state(md);
+
+    if ((state & VFIO_DEVICE_STATE_RESUMING) && !(old & VFIO_DEVICE_STATE_RESUMING))
+        free_state(md);
+
+    if (!(state & VFIO_DEVICE_STATE_RESUMING) && (old & VFIO_DEVICE_STATE_RESUMING))
+    {
+        ret_val = restore_state(md);
+        free_state(md);
+        if (ret_val)
+            return ret_val;
+    }
+
+    md->mig_info.device_state = state;
+    return 0;
+}
+
+/**
+ * @brief Handles an access to the migration region
+ *
+ * @param md mediated device
+ * @param buf user buffer
+ * @param count bytes to access
+ * @param pos position in the region
+ * @param write read(0) or write(1)
+ * @return ssize_t bytes accessed or an error
+ */
+ssize_t hypervisor_migration_access(struct m_fpga_dev *md, char __user *buf,
+                                    size_t count, loff_t pos, int write)
+{
+    loff_t offset;
+    uint64_t val;
+    uint32_t state;
+    int ret_val;
+
+    offset = pos & HYPERVISOR_OFFSET_MASK;
+
+    // data window
+    if (offset >= MIGRATION_DATA_OFFSET)
+    {
+        offset -= MIGRATION_DATA_OFFSET;
+        if (!md->mig_window || offset + count > MIGRATION_DATA_SIZE)
+            return -EINVAL;
+
+        if (write)
+            ret_val = copy_from_user(md->mig_window + offset, buf, count);
+        else
+            ret_val = copy_to_user(buf, md->mig_window + offset, count);
+
+        return ret_val ? -EFAULT : count;
+    }
+
+    switch (offset)
+    {
+    case offsetof(struct vfio_device_migration_info, device_state):
+    {
+        if (count != sizeof(state))
+            return -EINVAL;
+
+        if (!write)
+            return copy_to_user(buf, &md->mig_info.device_state, count) ? -EFAULT : count;
+
+        if (copy_from_user(&state, buf, count))
+            return -EFAULT;
+
+        ret_val = set_state(md, state);
+        return ret_val ? ret_val : count;
+    }
+    case offsetof(struct vfio_device_migration_info, pending_bytes):
+    {
+        if (write || count != sizeof(val))
+            return -EINVAL;
+
+        val = (md->mig_info.device_state & VFIO_DEVICE_STATE_SAVING) ? md->mig_size - md->mig_cursor : 0;
+        return copy_to_user(buf, &val, count) ? -EFAULT : count;
+    }
+    case offsetof(struct vfio_device_migration_info, data_offset):
+    {
+        if (write || count != sizeof(val))
+            return -EINVAL;
+
+        // reading the offset asks for the next chunk
+        if (md->mig_info.device_state & VFIO_DEVICE_STATE_SAVING)
+            send_chunk(md);
+
+        val = MIGRATION_DATA_OFFSET;
+        return copy_to_user(buf, &val, count) ? -EFAULT : count;
+    }
+    case offsetof(struct vfio_device_migration_info, data_size):
+    {
+        if (count != sizeof(val))
+            return -EINVAL;
+
+        if (!write)
+            return copy_to_user(buf, &md->mig_info.data_size, count) ? -EFAULT : count;
+
+        if (!(md->mig_info.device_state & VFIO_DEVICE_STATE_RESUMING))
+            return -EINVAL;
+
+        if (copy_from_user(&val, buf, count))
+            return -EFAULT;
+
+        ret_val = receive_chunk(md, val);
+        return ret_val ? ret_val : count;
+    }
+    default:
+    {
+        pr_err("%s.%u: invalid migration region access at %lld\n", __func__, __LINE__, offset);
+        return -EINVAL;
+    }
+    }
+}
+
+#endif
+
+/**
+ * @brief Sets up the migration state of a freshly opened device
+ *
+ * @param md mediated device
+ */
+void hypervisor_migration_init(struct m_fpga_dev *md)
+{
+    INIT_LIST_HEAD(&md->saved_maps);
+    md->saved_maps_lost = 0;
+    memset(md->cpid_pid, 0, sizeof(md->cpid_pid));
+
+#ifdef HYPERVISOR_MIGRATION
+    memset(&md->mig_info, 0, sizeof(md->mig_info));
+    md->mig_info.device_state = VFIO_DEVICE_STATE_RUNNING;
+    md->mig_data = NULL;
+    md->mig_size = 0;
+    md->mig_cursor = 0;
+    md->mig_window = NULL;
+#endif
+}
+
+/**
+ * @brief Releases the migration state when the device is closed
+ *
+ * @param md mediated device
+ */
+void hypervisor_migration_release(struct m_fpga_dev *md)
+{
+    hypervisor_saved_maps_flush(md);
+
+#ifdef HYPERVISOR_MIGRATION
+    free_state(md);
+    kvfree(md->mig_window);
+    md->mig_window = NULL;
+#endif
+}
@@ -1,8 +1,8 @@
-/*
+/**
  * Copyright (c) 2025,  Systems Group, ETH Zurich
  * All rights reserved.
  *
- * This file is part of the Coyote device driver for Linux.
+ * This file is part of the Coyote VM driver for Linux.
  * Coyote can be found at: https://github.com/fpgasystems/Coyote
  *
  * This source code is free software; you can redistribute it and/or modify it
@@ -15,32 +15,23 @@
  * more details.
  *
  * The full GNU General Public License is included in this distribution in
- * the file called "COPYING". If not found, a copy of the GNU General Public  
+ * the file called "COPYING". If not found, a copy of the GNU General Public
  * License can be found <https://www.gnu.org/licenses/>.
  */
 
-#ifndef __ECI_DEV_H__
-#define __ECI_DEV_H__
+#ifndef __HYPERVISOR_MIGRATION_H__
+#define __HYPERVISOR_MIGRATION_H__
 
 #include "../coyote_dev.h"
-#include "../vfpga_dev.h"
+#include "../fpga_fops.h"
+#include "hypervisor.h"
 
-/*
-███████╗ ██████╗██╗
-██╔════╝██╔════╝██║
-█████╗  ██║     ██║
-██╔══╝  ██║     ██║
-███████╗╚██████╗██║
-╚══════╝ ╚═════╝╚═╝
-*/
+void hypervisor_migration_init(struct m_fpga_dev *md);
+void hypervisor_migration_release(struct m_fpga_dev *md);
 
-/* Physical address (ECI) */
-#define IO_PHYS_ADDR 0x900000000000UL
+#ifdef HYPERVISOR_MIGRATION
+ssize_t hypervisor_migration_access(struct m_fpga_dev *md, char __user *buf,
+                                    size_t count, loff_t pos, int write);
+#endif
 
-/* Probe */
-int shell_eci_init(struct bus_driver_data *d);
-void shell_eci_remove(struct bus_driver_data *d);
-int eci_init(void);
-void eci_exit(void);
-
-#endif // ECI device
\ No newline at end of file
+#endif
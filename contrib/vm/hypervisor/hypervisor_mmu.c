@@ -21,13 +21,292 @@
 
 #include "hypervisor_mmu.h"
 
+/*
+ * Pinned page cache
+ *
+ * Guests tend to map and unmap the same DMA buffers over and over. Every
+ * guest page pinned by hypervisor_tlb_get_user_pages is therefore also kept
+ * in a per-VM cache, keyed by guest frame number, which holds its own page
+ * reference: unmapping a buffer drops the reference of the mapping only, so
+ * re-mapping it skips the GPA->HVA translation and the remote pinning. The
+ * cache is bounded by PIN_CACHE_MAX_PAGES and evicts the least recently
+ * mapped pages first. It is flushed when the VM closes the device and when
+ * KVM's memory slots change (a GPA may then be backed by another page).
+ */
+
+static void pin_cache_evict(struct m_fpga_dev *md, struct pinned_page *pp)
+{
+    hash_del(&pp->entry);
+    list_del(&pp->lru);
+    put_page(pp->page);
+    kfree(pp);
+    md->n_pinned--;
+}
+
+/**
+ * @brief Sets up the empty pinned page cache of a mediated device
+ *
+ * @param md mediated device
+ */
+void hypervisor_pin_cache_init(struct m_fpga_dev *md)
+{
+    hash_init(md->pin_cache);
+    INIT_LIST_HEAD(&md->pin_lru);
+    md->n_pinned = 0;
+    md->pin_cache_gen = 0;
+    spin_lock_init(&md->pin_cache_lock);
+}
+
+/**
+ * @brief Releases all the pages held by the pinned page cache.
+ * Pages still mapped on the fpga stay pinned by their mapping.
+ *
+ * @param md mediated device
+ */
+void hypervisor_pin_cache_flush(struct m_fpga_dev *md)
+{
+    struct pinned_page *pp, *tmp;
+
+    spin_lock(&md->pin_cache_lock);
+    list_for_each_entry_safe(pp, tmp, &md->pin_lru, lru)
+    {
+        pin_cache_evict(md, pp);
+    }
+    spin_unlock(&md->pin_cache_lock);
+}
+
+/**
+ * @brief Drops the cache if the memory slots of the vm changed since it was filled
+ *
+ * @param md mediated device
+ */
+static void pin_cache_validate(struct m_fpga_dev *md)
+{
+    struct kvm *kvm;
+    uint64_t gen;
+    int idx;
+
+    kvm = md->kvm;
+    idx = srcu_read_lock(&kvm->srcu);
+    gen = kvm_memslots(kvm)->generation;
+    srcu_read_unlock(&kvm->srcu, idx);
+
+    if (gen != md->pin_cache_gen)
+    {
+        hypervisor_pin_cache_flush(md);
+        md->pin_cache_gen = gen;
+    }
+}
+
+/**
+ * @brief Looks up a guest page in the cache
+ *
+ * @param md mediated device
+ * @param gfn guest frame number
+ * @return the page with an additional reference for the caller, NULL on a miss
+ */
+static struct page *pin_cache_get(struct m_fpga_dev *md, uint64_t gfn)
+{
+    struct pinned_page *pp;
+    struct page *page = NULL;
+
+    spin_lock(&md->pin_cache_lock);
+    hash_for_each_possible(md->pin_cache, pp, entry, gfn)
+    {
+        if (pp->gfn == gfn)
+        {
+            get_page(pp->page);
+            list_move(&pp->lru, &md->pin_lru);
+            page = pp->page;
+            break;
+        }
+    }
+    spin_unlock(&md->pin_cache_lock);
+
+    return page;
+}
+
+/**
+ * @brief Adds a freshly pinned guest page to the cache, evicting the least
+ * recently used pages beyond PIN_CACHE_MAX_PAGES
+ *
+ * @param md mediated device
+ * @param gfn guest frame number
+ * @param page pinned page; the cache takes its own reference
+ */
+static void pin_cache_add(struct m_fpga_dev *md, uint64_t gfn, struct page *page)
+{
+    struct pinned_page *pp, *tmp;
+
+    // not caching is always correct, the mapping holds its own reference
+    pp = kzalloc(sizeof(struct pinned_page), GFP_KERNEL);
+    if (!pp)
+        return;
+
+    pp->gfn = gfn;
+    pp->page = page;
+
+    spin_lock(&md->pin_cache_lock);
+    hash_for_each_possible(md->pin_cache, tmp, entry, gfn)
+    {
+        if (tmp->gfn == gfn)
+        {
+            spin_unlock(&md->pin_cache_lock);
+            kfree(pp);
+            return;
+        }
+    }
+
+    get_page(page);
+    hash_add(md->pin_cache, &pp->entry, gfn);
+    list_add(&pp->lru, &md->pin_lru);
+    md->n_pinned++;
+
+    while (md->n_pinned > PIN_CACHE_MAX_PAGES)
+    {
+        pin_cache_evict(md, list_last_entry(&md->pin_lru, struct pinned_page, lru));
+    }
+    spin_unlock(&md->pin_cache_lock);
+}
+
+/**
+ * @brief Checks that the pinned host pages behind the large pages of a huge
+ * notifier are large and aligned themselves, so that each can be mapped with
+ * a single large TLB entry. This is not the case if the vm memory is not
+ * backed by hugepages on the host.
+ *
+ * @param pages first host page of each large page
+ * @param n_pages number of large pages
+ * @return int 1 if all can be mapped as large pages
+ */
+static int huge_backed(struct page **pages, int n_pages)
+{
+    int i;
+    struct page *head;
+
+    for (i = 0; i < n_pages; i++)
+    {
+        head = compound_head(pages[i]);
+        if ((PAGE_SIZE << compound_order(head)) < LARGE_TABLE_SIZE ||
+            (page_to_phys(pages[i]) & (LARGE_TABLE_SIZE - 1)))
+            return 0;
+    }
+
+    return 1;
+}
+
+/**
+ * @brief Expands a huge notifier (one gpa per large page) into a notifier
+ * with one gpa per 4K page of the mapped range.
+ *
+ * @param notifier huge notifier
+ * @return the new notifier, to be freed by the caller, NULL if out of memory
+ */
+static struct hypervisor_map_notifier *split_huge_notifier(struct hypervisor_map_notifier *notifier)
+{
+    struct hypervisor_map_notifier *small;
+    uint64_t n_pages, i, vaddr, idx;
+
+    n_pages = ((notifier->gva + notifier->len - 1) >> PAGE_SHIFT) - (notifier->gva >> PAGE_SHIFT) + 1;
+
+    small = kzalloc(sizeof(struct hypervisor_map_notifier) + n_pages * sizeof(uint64_t), GFP_KERNEL);
+    if (!small)
+        return NULL;
+
+    *small = *notifier;
+    small->npages = n_pages;
+    small->is_huge = 0;
+
+    for (i = 0; i < n_pages; i++)
+    {
+        vaddr = (notifier->gva & PAGE_MASK) + i * PAGE_SIZE;
+        idx = (vaddr >> LARGE_TABLE_SHIFT) - (notifier->gva >> LARGE_TABLE_SHIFT);
+        small->gpas[i] = (notifier->gpas[idx] & ~((uint64_t)LARGE_TABLE_SIZE - 1)) +
+                         (vaddr & (LARGE_TABLE_SIZE - 1));
+    }
+
+    return small;
+}
+
+/*
+ * Saved mappings
+ *
+ * The notifier of every mapping installed on the fpga is kept on the
+ * saved_maps list of the mediated device, so that the mappings can be sent
+ * along with a live migration and re-installed on the destination host
+ * (see hypervisor_migration.c). The list is protected by sbuff_lock, like
+ * the sbuff map.
+ */
+
+/**
+ * @brief Records the notifier of an installed mapping
+ *
+ * @param md mediated device
+ * @param notifier notifier of the mapping
+ * @param n_gpas number of gpas the mapping used
+ */
+static void save_mapping(struct m_fpga_dev *md, struct hypervisor_map_notifier *notifier, int n_gpas)
+{
+    struct saved_mapping *saved;
+
+    saved = kzalloc(sizeof(struct saved_mapping) + n_gpas * sizeof(uint64_t), GFP_KERNEL);
+    if (!saved)
+    {
+        // the mapping works, but the vm can no longer be migrated
+        md->saved_maps_lost = 1;
+        return;
+    }
+
+    memcpy(&saved->notifier, notifier, sizeof(struct hypervisor_map_notifier) + n_gpas * sizeof(uint64_t));
+    saved->notifier.npages = n_gpas;
+    list_add_tail(&saved->list, &md->saved_maps);
+}
+
+/**
+ * @brief Drops the record of a mapping that was removed from the fpga
+ *
+ * @param md mediated device
+ * @param user_pg removed mapping
+ */
+static void forget_mapping(struct m_fpga_dev *md, struct user_pages *user_pg)
+{
+    struct saved_mapping *saved, *tmp;
+
+    list_for_each_entry_safe(saved, tmp, &md->saved_maps, list)
+    {
+        if (saved->notifier.gva == user_pg->vaddr && saved->notifier.cpid == user_pg->cpid)
+        {
+            list_del(&saved->list);
+            kfree(saved);
+        }
+    }
+}
+
+/**
+ * @brief Drops the records of all mappings, the mappings themselves are not touched
+ *
+ * @param md mediated device
+ */
+void hypervisor_saved_maps_flush(struct m_fpga_dev *md)
+{
+    struct saved_mapping *saved, *tmp;
+
+    list_for_each_entry_safe(saved, tmp, &md->saved_maps, list)
+    {
+        list_del(&saved->list);
+        kfree(saved);
+    }
+    md->saved_maps_lost = 0;
+}
+
 /**
  * @brief Pin user pages allocated in a vm.
  *  This is a modified version to work on the notifier that is passed
  *  down from the vm. 
  *  
  * The function reads the notifier and pins the pages from the vm.
- * The notifier contains gpa addresses. So first the function performs
+ * The notifier contains gpa addresses. Pages found in the pinned page cache
+ * are reused as they are; for the others the function first performs
  * a page table walk from guest physical address (gpa) to host virtual address (hva).
  * We use the hva to pin the corresponding physical pages.
  * 
@@ -37,6 +316,9 @@
  * is passed down from the hypervisor. This is because if the vm runs with
  * huge pages all pages inside the vm are seen as huge pages by the hypervisor
  * so we have to pass through the intent on the user with the hypervisor.
+ * A huge notifier carries one gpa per large page (LARGE_TABLE_SIZE) and only
+ * the first host page of each is pinned. If the host pages behind it are
+ * not large themselves, the notifier is split and mapped with small pages.
  * 
  * In a last step, we actual fire the mapping to the fpga.
  *
@@ -53,14 +335,14 @@ int hypervisor_tlb_get_user_pages(struct m_fpga_dev *d, struct hypervisor_map_no
     struct task_struct *curr_task;
     struct kvm *kvm;
     pid_t pid;
-    uint64_t first, last;
-    uint64_t curr_vaddr, last_vaddr, vaddr_tmp, gva;
+    uint64_t vaddr_tmp, gva;
     int n_pages, n_pages_huge;
     int hugepages;
     struct user_pages *user_pg;
+    struct hypervisor_map_notifier *small;
     uint64_t *hpages_phys, *map_array;
     uint64_t count;
-    uint64_t *kvm_hvas;
+    uint64_t gfn, hva;
 
     ret_val = 0;
 
@@ -84,26 +366,27 @@ int hypervisor_tlb_get_user_pages(struct m_fpga_dev *d, struct hypervisor_map_no
     pid = kvm->userspace_pid;
     curr_task = pid_task(find_vpid(pid), PIDTYPE_PID);
 
-    // get first host virtual address in kvm space
-    kvm_hvas = kcalloc(notifier->npages, sizeof(uint64_t), GFP_KERNEL);
-    if (!kvm_hvas)
-    {
-        goto err_hvas;
-    }
-
-    for (i = 0; i < n_pages; i++)
-    {
-        kvm_hvas[i] = gfn_to_hva(kvm, gpa_to_gfn(notifier->gpas[i]));
-    }
     count = notifier->len;
 
     // hugepages support passed from vm
     hugepages = (int) notifier->is_huge;
 
+    // overflow check
+    if (gva + count < gva)
+        return -EINVAL;
+    if (count == 0)
+        return 0;
+
     if (hugepages)
     {
-        if (n_pages > MAX_N_MAP_HUGE_PAGES)
-            n_pages = MAX_N_MAP_HUGE_PAGES;
+        // one gpa per large page
+        n_pages_huge = ((gva + count - 1) >> LARGE_TABLE_SHIFT) - (gva >> LARGE_TABLE_SHIFT) + 1;
+        if (n_pages < n_pages_huge)
+            return -EINVAL;
+
+        if (n_pages_huge > MAX_N_MAP_HUGE_PAGES)
+            n_pages_huge = MAX_N_MAP_HUGE_PAGES;
+        n_pages = n_pages_huge;
     }
     else
     {
@@ -111,12 +394,6 @@ int hypervisor_tlb_get_user_pages(struct m_fpga_dev *d, struct hypervisor_map_no
             n_pages = MAX_N_MAP_PAGES;
     }
 
-    // overflow check
-    if (gva + count < gva)
-        return -EINVAL;
-    if (count == 0)
-        return 0;
-
     // allocate management structs
     user_pg = kzalloc(sizeof(struct user_pages), GFP_KERNEL);
     if (!user_pg)
@@ -132,14 +409,26 @@ int hypervisor_tlb_get_user_pages(struct m_fpga_dev *d, struct hypervisor_map_no
         goto err_hpages;
     }
 
+    pin_cache_validate(d);
+
     // Pin all pages obtained from the vm
     for (i = 0; i < n_pages; i++)
     {
+        gfn = gpa_to_gfn(notifier->gpas[i]);
+
+        // still pinned from an earlier mapping
+        user_pg->hpages[i] = pin_cache_get(d, gfn);
+        if (user_pg->hpages[i])
+            continue;
+
+        // host virtual address in kvm space
+        hva = gfn_to_hva(kvm, gfn);
+
         // pin pages of the kvm
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 9, 0)
-        ret_val = get_user_pages_remote(curr_mm, (unsigned long)kvm_hvas[i], 1, 1, user_pg->hpages + i, NULL, NULL);
+        ret_val = get_user_pages_remote(curr_mm, (unsigned long)hva, 1, 1, user_pg->hpages + i, NULL, NULL);
 #else
-        ret_val = get_user_pages_remote(curr_task, curr_mm, (unsigned long)kvm_hvas[i], n_pages, 1, user_pg->hpages + i, NULL);
+        ret_val = get_user_pages_remote(curr_task, curr_mm, (unsigned long)hva, n_pages, 1, user_pg->hpages + i, NULL);
 #endif
         if (ret_val != 1 || !user_pg->hpages[i])
         {
@@ -147,6 +436,8 @@ int hypervisor_tlb_get_user_pages(struct m_fpga_dev *d, struct hypervisor_map_no
             goto err_pin_pages;
         }
         // dbg_info("pinned page hpa: %llx\n", page_to_phys(user_pg->hpages[i]));
+
+        pin_cache_add(d, gfn, user_pg->hpages[i]);
     }
 
     dbg_info("Pinned pages\n");
@@ -154,6 +445,27 @@ int hypervisor_tlb_get_user_pages(struct m_fpga_dev *d, struct hypervisor_map_no
     // Reset ret_val
     ret_val = 0;
 
+    // Large TLB entries need large host pages, map with small pages otherwise
+    if (hugepages && (pd->ltlb_order->page_size != LARGE_TABLE_SIZE || !huge_backed(user_pg->hpages, n_pages)))
+    {
+        dbg_info("vm memory at gva %llx is not backed by hugepages, splitting\n", gva);
+
+        for (i = 0; i < n_pages; i++)
+        {
+            put_page(user_pg->hpages[i]);
+        }
+        kfree(user_pg->hpages);
+        kfree(user_pg);
+
+        small = split_huge_notifier(notifier);
+        if (!small)
+            return -ENOMEM;
+
+        ret_val = hypervisor_tlb_get_user_pages(d, small);
+        kfree(small);
+        return ret_val;
+    }
+
     // flush cache
     for (i = 0; i < n_pages; i++)
     {
@@ -162,6 +474,7 @@ int hypervisor_tlb_get_user_pages(struct m_fpga_dev *d, struct hypervisor_map_no
 
     // populate map entry
     user_pg->vaddr = gva;
+    user_pg->cpid = notifier->cpid;
     user_pg->n_hpages = n_pages;
     user_pg->huge = hugepages;
     
@@ -171,10 +484,6 @@ int hypervisor_tlb_get_user_pages(struct m_fpga_dev *d, struct hypervisor_map_no
 
     if (hugepages) // For hugepages
     {
-        // Shift page numbers to work on huge pages
-        first = (gva & pd->ltlb_order->page_mask) >> pd->ltlb_order->page_shift;
-        last = ((gva + count - 1) & pd->ltlb_order->page_mask) >> pd->ltlb_order->page_shift;
-        n_pages_huge = last - first + 1;
         user_pg->n_pages = n_pages_huge;
 
         // allocate pages array
@@ -185,22 +494,10 @@ int hypervisor_tlb_get_user_pages(struct m_fpga_dev *d, struct hypervisor_map_no
             goto err_phys_pages;
         }
 
-        j = 0;
-        curr_vaddr = gva;
-        last_vaddr = -1;
-
-        // Get the hpa for the huge pages
-        for (i = 0; i < n_pages; i++)
+        // Get the hpa for the huge pages, one pinned page each
+        for (i = 0; i < n_pages_huge; i++)
         {
-            // Only store an entry if we encounter a new huge page
-            if (((curr_vaddr & pd->ltlb_order->page_mask) >> pd->ltlb_order->page_shift) !=
-                ((last_vaddr & pd->ltlb_order->page_mask) >> pd->ltlb_order->page_shift))
-            {
-                hpages_phys[j] = page_to_phys(user_pg->hpages[i]) & pd->ltlb_order->page_mask;
-                last_vaddr = curr_vaddr;
-                j++;
-            }
-            curr_vaddr += PAGE_SIZE;
+            hpages_phys[i] = page_to_phys(user_pg->hpages[i]) & pd->ltlb_order->page_mask;
         }
 
         // If we have memory attached on the card we want to allocate
@@ -319,6 +616,9 @@ int hypervisor_tlb_get_user_pages(struct m_fpga_dev *d, struct hypervisor_map_no
     // later on.
     hash_add(d->sbuff_map, &user_pg->entry, notifier->gva);
 
+    // keep the notifier to re-install the mapping after a migration
+    save_mapping(d, notifier, n_pages);
+
     return ret_val;
 
 err_pin_pages:
@@ -329,7 +629,6 @@ err_pin_pages:
 
     kfree(user_pg->hpages);
     kfree(user_pg);
-    kfree(kvm_hvas);
     return -ENOMEM;
 
 err_map_buffer:
@@ -346,8 +645,6 @@ err_phys_pages:
 err_hpages:
     kfree(user_pg);
 err_user_pg:
-    kfree(kvm_hvas);
-err_hvas:
     return ret_val;
 }
 
@@ -494,6 +791,7 @@ int hypervisor_tlb_put_user_pages(struct m_fpga_dev *md, struct hypervisor_map_n
         {
             // unmap from TLB
             unmap_entry(md, tmp_buff, dirtied);
+            forget_mapping(md, tmp_buff);
             // delete from hashtable
             hash_del(&tmp_buff->entry);
             // free memory
@@ -530,6 +828,7 @@ int hypervisor_tlb_put_user_pages_all(struct m_fpga_dev *md, int dirtied)
     {
         // unmap from TLB
         unmap_entry(md, tmp_buff, dirtied);
+        forget_mapping(md, tmp_buff);
         // delete from hash table
         hash_del(&tmp_buff->entry);
         // free memory
@@ -537,4 +836,174 @@ int hypervisor_tlb_put_user_pages_all(struct m_fpga_dev *md, int dirtied)
         kfree(tmp_buff);
     }
     return 0;
-}
\ No newline at end of file
+}
+/**
+ * @brief Similar to hypervisor_tlb_put_user_pages_all but only put the
+ * mappings of a single cpid. Used when the guest unregisters a process,
+ * for the mappings installed by host-side fault resolution.
+ *
+ * @param md mediated device
+ * @param cpid cpid of the guest process
+ * @param dirtied indicates if all pages should be marked dirty before putting
+ * @return int 0 if successfull
+ */
+int hypervisor_tlb_put_user_pages_cpid(struct m_fpga_dev *md, int32_t cpid, int dirtied)
+{
+    int bkt;
+    struct hlist_node *tmp;
+    struct user_pages *tmp_buff;
+
+    BUG_ON(!md);
+
+    hash_for_each_safe(md->sbuff_map, bkt, tmp, tmp_buff, entry)
+    {
+        if (tmp_buff->cpid != cpid)
+            continue;
+
+        unmap_entry(md, tmp_buff, dirtied);
+        forget_mapping(md, tmp_buff);
+        hash_del(&tmp_buff->entry);
+        kfree(tmp_buff->hpages);
+        kfree(tmp_buff);
+    }
+    return 0;
+}
+
+/*
+ * Host-side TLB miss resolution
+ *
+ * By default a TLB miss of a guest process is forwarded to the vm: the guest
+ * driver pins the pages and writes a MAP_USER notifier back to BAR2, so every
+ * fault costs an interrupt injection and several VM exits. If the guest driver
+ * registered the page table root of the process (REGISTER_PGD), the hypervisor
+ * walks the guest page table itself (GVA->GPA) and installs the mapping
+ * through the same path as MAP_USER (GPA->HPA), then restarts the engine.
+ *
+ * Only faults on guest huge pages are resolved this way: the guest kernel
+ * neither swaps nor migrates them, so the translation stays valid without
+ * the guest pinning the pages. Any other fault is forwarded as before.
+ */
+
+#define GUEST_PTE_ADDR_MASK GENMASK_ULL(51, 12)
+#define GUEST_PT_LEVELS 4
+#define GUEST_PT_INDEX_BITS 9
+
+/**
+ * @brief Walks the 4-level x86-64 page table of a guest process.
+ * The caller holds kvm->srcu.
+ *
+ * @param kvm vm the page table lives in
+ * @param pgd guest physical address of the page table root
+ * @param gva guest virtual address to translate
+ * @param gpa guest physical address of gva
+ * @param leaf_size size of the guest page gva lies in
+ * @return int 0 if the page is present and writable by the process
+ */
+static int guest_walk(struct kvm *kvm, uint64_t pgd, uint64_t gva, uint64_t *gpa, uint64_t *leaf_size)
+{
+    uint64_t table, entry;
+    int level, shift;
+
+    table = pgd;
+    for (level = GUEST_PT_LEVELS; level > 0; level--)
+    {
+        shift = PAGE_SHIFT + GUEST_PT_INDEX_BITS * (level - 1);
+        if (kvm_read_guest(kvm, table + ((gva >> shift) & GENMASK_ULL(GUEST_PT_INDEX_BITS - 1, 0)) * sizeof(uint64_t),
+                           &entry, sizeof(entry)))
+            return -EFAULT;
+
+        if (!(entry & _PAGE_PRESENT) || !(entry & _PAGE_USER) || !(entry & _PAGE_RW))
+            return -EFAULT;
+
+        // leaf: 4K page, or 2M/1G page with the PSE bit set
+        if (level == 1 || (level < GUEST_PT_LEVELS && (entry & _PAGE_PSE)))
+        {
+            *leaf_size = 1ULL << shift;
+            *gpa = (entry & GUEST_PTE_ADDR_MASK & ~(*leaf_size - 1)) | (gva & (*leaf_size - 1));
+            return 0;
+        }
+
+        table = entry & GUEST_PTE_ADDR_MASK;
+    }
+
+    return -EFAULT;
+}
+
+/**
+ * @brief Resolves a TLB miss of a guest process on the host. Maps the huge
+ * pages covering [vaddr, vaddr + len) like a MAP_USER from the guest would.
+ *
+ * @param md mediated device
+ * @param vaddr faulting guest virtual address
+ * @param len length of the faulting access
+ * @param cpid cpid of the guest process
+ * @return int 0 if the mapping was installed, an error if the fault has to
+ *  be forwarded to the guest
+ */
+int hypervisor_resolve_fault(struct m_fpga_dev *md, uint64_t vaddr, uint32_t len, int32_t cpid)
+{
+    struct hypervisor_map_notifier *notifier;
+    struct kvm *kvm;
+    uint64_t pgd, first, last, gva, gpa, leaf_size;
+    uint64_t n_pages, i;
+    int idx, ret_val;
+
+    BUG_ON(!md);
+    kvm = md->kvm;
+
+    if (cpid < 0 || cpid >= HYPERVISOR_N_CPID_MAX || !kvm || len == 0)
+        return -EINVAL;
+
+    pgd = md->cpid_pgd[cpid];
+    if (!pgd)
+        return -EINVAL;
+
+    first = vaddr & ~((uint64_t)LARGE_TABLE_SIZE - 1);
+    last = ALIGN(vaddr + len, (uint64_t)LARGE_TABLE_SIZE);
+    n_pages = (last - first) >> LARGE_TABLE_SHIFT;
+    if (n_pages > MAX_N_MAP_HUGE_PAGES)
+        return -E2BIG;
+
+    notifier = kzalloc(sizeof(struct hypervisor_map_notifier) + n_pages * sizeof(uint64_t), GFP_KERNEL);
+    if (!notifier)
+        return -ENOMEM;
+
+    // GVA -> GPA, one walk per huge page
+    ret_val = 0;
+    i = 0;
+    idx = srcu_read_lock(&kvm->srcu);
+    for (gva = first; gva < last; gva += LARGE_TABLE_SIZE)
+    {
+        ret_val = guest_walk(kvm, pgd, gva, &gpa, &leaf_size);
+        if (!ret_val && leaf_size < LARGE_TABLE_SIZE)
+            ret_val = -EAGAIN;
+        if (ret_val)
+            break;
+
+        notifier->gpas[i++] = gpa;
+    }
+    srcu_read_unlock(&kvm->srcu, idx);
+
+    if (ret_val)
+    {
+        dbg_info("fault at gva %llx not resolved on the host, %d\n", vaddr, ret_val);
+        goto out;
+    }
+
+    notifier->npages = n_pages;
+    notifier->len = last - first;
+    notifier->gva = first;
+    notifier->cpid = cpid;
+    notifier->is_huge = 1;
+
+    // GPA -> HPA and install
+    mutex_lock(&md->sbuff_lock);
+    ret_val = hypervisor_tlb_get_user_pages(md, notifier);
+    mutex_unlock(&md->sbuff_lock);
+
+    dbg_info("resolved fault at gva %llx on the host, cpid %d, %d\n", vaddr, cpid, ret_val);
+
+out:
+    kfree(notifier);
+    return ret_val;
+}
@@ -29,5 +29,10 @@
 int hypervisor_tlb_get_user_pages(struct m_fpga_dev *d, struct hypervisor_map_notifier *notifier);
 int hypervisor_tlb_put_user_pages(struct m_fpga_dev *md, struct hypervisor_map_notifier *notifier);
 int hypervisor_tlb_put_user_pages_all(struct m_fpga_dev *md, int dirtied);
+int hypervisor_tlb_put_user_pages_cpid(struct m_fpga_dev *md, int32_t cpid, int dirtied);
+int hypervisor_resolve_fault(struct m_fpga_dev *md, uint64_t vaddr, uint32_t len, int32_t cpid);
+void hypervisor_pin_cache_init(struct m_fpga_dev *md);
+void hypervisor_pin_cache_flush(struct m_fpga_dev *md);
+void hypervisor_saved_maps_flush(struct m_fpga_dev *md);
 
 #endif
\ No newline at end of file
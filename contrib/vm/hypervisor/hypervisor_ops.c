@@ -359,6 +359,18 @@ static int hypervisor_vfpga_open(struct mdev_device *mdev)
 
     // Init memory maps
     hash_init(vfpga->sbuff_map);
+    hypervisor_pin_cache_init(vfpga);
+    mutex_init(&vfpga->sbuff_lock);
+
+    // No submission queue until the guest sets one up
+    vfpga->pv_queue_gpa = 0;
+
+    // Faults are forwarded to the vm until the guest registers a page table
+    memset(vfpga->cpid_pgd, 0, sizeof(vfpga->cpid_pgd));
+    INIT_WORK(&vfpga->fault_work, hypervisor_fault_work);
+
+    // Nothing to migrate yet
+    hypervisor_migration_init(vfpga);
 
     /* We know that this is the only thread accessing this device */
 
@@ -409,10 +421,19 @@ static void hypervisor_vfpga_close(struct mdev_device *mdev)
     vfpga->in_use = 0;
     spin_unlock(&vfpga->lock);
 
+    // wait for a fault being resolved on the host
+    cancel_work_sync(&vfpga->fault_work);
+
+    // drop the migration state
+    hypervisor_migration_release(vfpga);
+
     // free allocated memory
     kfree(vfpga->msix_table);
     kfree(vfpga->msix_vector);
 
+    // release the pages kept pinned for the vm
+    hypervisor_pin_cache_flush(vfpga);
+
     // Unregister vfio notifier
     ret_val = vfio_unregister_notifier(mdev_dev(mdev), VFIO_GROUP_NOTIFY, &vfpga->notifier);
     if (ret_val)
@@ -481,7 +502,8 @@ static ssize_t hypervisor_access_kvm(struct m_fpga_dev *vfpga,
  * calls that would be mmap in a not vm scenario. BAR0 acts as a passthrough
  * for this cases and are mmaped in the vm. Therefore this function is 
  * not used and should not be used since the trap comes at a very high cost 
- * and should be avoided whenever possible!
+ * and should be avoided whenever possible! The exception are the TLB pages,
+ * which are not mmaped and are refused here.
  *
  * @param vfpga mediated vfpga
  * @param buf read/write buffer
@@ -525,13 +547,16 @@ static ssize_t handle_bar0_access(struct m_fpga_dev *vfpga, char __user *buf,
         mappings. This is happening here. This is one of the reasons why a trap
         is not very efficent.
         */
-        if (offset >= FPGA_CTRL_LTLB_OFFS && offset < FPGA_CTRL_LTLB_SIZE + FPGA_CTRL_LTLB_OFFS)
-        {
-            ioaddr = (void __iomem *)vfpga->fpga->fpga_lTlb + (offset - FPGA_CTRL_LTLB_OFFS);
-        }
-        else if (offset >= FPGA_CTRL_STLB_OFFS && offset < FPGA_CTRL_STLB_SIZE + FPGA_CTRL_STLB_OFFS)
+        if ((offset >= FPGA_CTRL_LTLB_OFFS && offset < FPGA_CTRL_LTLB_SIZE + FPGA_CTRL_LTLB_OFFS) ||
+            (offset >= FPGA_CTRL_STLB_OFFS && offset < FPGA_CTRL_STLB_SIZE + FPGA_CTRL_STLB_OFFS))
         {
-            ioaddr = (void __iomem *)vfpga->fpga->fpga_sTlb + (offset - FPGA_CTRL_STLB_OFFS);
+            /*
+            The TLBs are shared by all vms on the vFPGA and only programmed by the
+            hypervisor (MAP_USER_OFFSET). They are not part of the guest mmap, so
+            guest accesses end up here and are refused.
+            */
+            dbg_info("Refused guest access to the TLB at offset %#llx\n", offset);
+            return -EPERM;
         }
         else if (offset >= FPGA_CTRL_USER_OFFS && offset < FPGA_CTRL_USER_OFFS + FPGA_CTRL_USER_SIZE)
         {
@@ -589,6 +614,159 @@ static ssize_t handle_bar0_access(struct m_fpga_dev *vfpga, char __user *buf,
     return count;
 }
 
+/**
+ * @brief Maps a user buffer described by a notifier in guest memory
+ * (MAP_USER). The notifier is copied from the vm, the pages are pinned
+ * and the mappings installed on the fpga.
+ *
+ * @param vfpga mediated vfpga
+ * @param gpa guest physical address of the notifier
+ * @return int 0 if successfull
+ */
+static int map_from_guest(struct m_fpga_dev *vfpga, uint64_t gpa)
+{
+    int ret_val;
+    struct hypervisor_map_notifier map_notifier, *full_map_notifier;
+    uint64_t map_full_size;
+
+    // read notifier header from guest
+    ret_val = hypervisor_access_kvm(vfpga, gpa, sizeof(struct hypervisor_map_notifier), &map_notifier, 0);
+    if (ret_val)
+    {
+        pr_info("%s.%d: Failed to read from guest", __func__, __LINE__);
+        return -EIO;
+    }
+
+    // read complete notifier from guest
+    map_full_size = sizeof(struct hypervisor_map_notifier) + map_notifier.npages * sizeof(uint64_t);
+    full_map_notifier = kzalloc(map_full_size, GFP_KERNEL);
+    if (!full_map_notifier)
+        return -ENOMEM;
+
+    ret_val = hypervisor_access_kvm(vfpga, gpa, map_full_size, full_map_notifier, 0);
+    if (ret_val)
+    {
+        pr_info("%s.%d: Failed to read from guest", __func__, __LINE__);
+        kfree(full_map_notifier);
+        return -EIO;
+    }
+
+    dbg_info("Mapping user pages from hypervisor: gva: %llx, len: %llu, cpid: %llu", full_map_notifier->gva,
+             full_map_notifier->len, full_map_notifier->cpid);
+
+    // Pin pages and install user mappings onto fpga.
+    mutex_lock(&vfpga->sbuff_lock);
+    ret_val = hypervisor_tlb_get_user_pages(vfpga, full_map_notifier);
+    mutex_unlock(&vfpga->sbuff_lock);
+    if (ret_val)
+    {
+        pr_info("%s.%d: Failed to get all user pages", __func__, __LINE__);
+    }
+    else
+    {
+        dbg_info("Successfully mapped user buffer\n");
+    }
+
+    kfree(full_map_notifier);
+    return ret_val;
+}
+
+/**
+ * @brief Unmaps a user buffer described by a notifier in guest memory
+ * (UNMAP_USER). The range has to be mapped previously.
+ *
+ * @param vfpga mediated vfpga
+ * @param gpa guest physical address of the notifier
+ * @return int 0 if successfull
+ */
+static int unmap_from_guest(struct m_fpga_dev *vfpga, uint64_t gpa)
+{
+    int ret_val;
+    struct hypervisor_map_notifier map_notifier;
+
+    // read gva + cpid from kvm
+    ret_val = hypervisor_access_kvm(vfpga, gpa, sizeof(struct hypervisor_map_notifier), &map_notifier, 0);
+    if (ret_val)
+    {
+        pr_info("%s.%d: Failed to read from kvm", __func__, __LINE__);
+        return -EFAULT;
+    }
+
+    mutex_lock(&vfpga->sbuff_lock);
+    ret_val = hypervisor_tlb_put_user_pages(vfpga, &map_notifier);
+    mutex_unlock(&vfpga->sbuff_lock);
+    if (ret_val)
+    {
+        pr_info("%s.%d: Failed to put all user pages", __func__, __LINE__);
+    }
+    else
+    {
+        dbg_info("Successfully unmapped user buffer\n");
+    }
+
+    return ret_val;
+}
+
+/**
+ * @brief Serves all descriptors the guest posted to its submission queue
+ * since the last kick, in order. The status of every descriptor and the
+ * new tail are written back before the kick returns to the guest.
+ *
+ * @param vfpga mediated vfpga
+ * @return int 0 if the queue could be accessed
+ */
+static int drain_pv_queue(struct m_fpga_dev *vfpga)
+{
+    int ret_val;
+    uint64_t gpa, head, tail, desc_gpa;
+    struct pv_desc desc;
+
+    gpa = vfpga->pv_queue_gpa;
+    if (!gpa)
+        return -EINVAL;
+
+    ret_val = hypervisor_access_kvm(vfpga, gpa + offsetof(struct pv_queue, head), sizeof(head), &head, 0);
+    ret_val |= hypervisor_access_kvm(vfpga, gpa + offsetof(struct pv_queue, tail), sizeof(tail), &tail, 0);
+    if (ret_val)
+        return -EFAULT;
+
+    // never more than a full queue
+    if (head - tail > PV_QUEUE_SIZE)
+    {
+        pr_err("%s.%u: invalid submission queue state, head %llu, tail %llu\n", __func__, __LINE__, head, tail);
+        return -EINVAL;
+    }
+
+    for (; tail != head; tail++)
+    {
+        desc_gpa = gpa + offsetof(struct pv_queue, desc) + (tail % PV_QUEUE_SIZE) * sizeof(struct pv_desc);
+        if (hypervisor_access_kvm(vfpga, desc_gpa, sizeof(desc), &desc, 0))
+            return -EFAULT;
+
+        switch (desc.op)
+        {
+        case PV_OP_MAP:
+            desc.status = map_from_guest(vfpga, desc.notifier);
+            break;
+        case PV_OP_UNMAP:
+            desc.status = unmap_from_guest(vfpga, desc.notifier);
+            break;
+        default:
+            desc.status = -EINVAL;
+            break;
+        }
+
+        if (hypervisor_access_kvm(vfpga, desc_gpa + offsetof(struct pv_desc, status), sizeof(desc.status),
+                                  &desc.status, 1))
+            return -EFAULT;
+    }
+
+    if (hypervisor_access_kvm(vfpga, gpa + offsetof(struct pv_queue, tail), sizeof(tail), &tail, 1))
+        return -EFAULT;
+
+    return 0;
+}
+
 /**
  * @brief BAR2 is for communication between the hypervisor
  * and the guest driver. These are virtualized versions of the IOCTL
@@ -605,6 +783,10 @@ static ssize_t handle_bar0_access(struct m_fpga_dev *vfpga, char __user *buf,
  * READ_CNFG:
  * Read through of the the corresponding ioctl call. Returns key 
  * configuration parameters of the fpga platform.
+ * 
+ * SETUP_QUEUE:
+ * Returns the guest physical address of the submission queue, 0 if
+ * none is set up.
  *
  * @param vfpga mediated vfpga
  * @param buf read buffer
@@ -682,6 +864,18 @@ static ssize_t handle_bar2_read(struct m_fpga_dev *vfpga, char __user *buf,
 
         return count;
     }
+    case SETUP_QUEUE_OFFSET:
+    {
+        // lets the guest check that the queue is set up
+        ret_val = copy_to_user(buf, &vfpga->pv_queue_gpa, min(count, sizeof(vfpga->pv_queue_gpa)));
+        if (ret_val)
+        {
+            pr_err("%s.%u: Failed to read\n", __func__, __LINE__);
+            return -EFAULT;
+        }
+
+        return count;
+    }
     default:
     {
         // Not mapped, return no meaningful data
@@ -788,6 +982,19 @@ static ssize_t hypervisor_vfpga_read(struct mdev_device *mdev, char __user *buf,
 
         return handle_bar4_access(vfpga, buf, count, pos, 0);
     }
+#ifdef HYPERVISOR_MIGRATION
+    case MIGRATION_REGION_INDEX:
+    {
+        // Check bounds
+        if (offset + count > COYOTE_HYPERVISOR_MIGRATION_SIZE)
+        {
+            pr_err("%s.%u: Out of bound read\n", __func__, __LINE__);
+            return -EFAULT;
+        }
+
+        return hypervisor_migration_access(vfpga, buf, count, pos, 0);
+    }
+#endif
     default:
     {
         // Not a valid region to read
@@ -965,6 +1172,21 @@ static int handle_pci_cfg_write(struct m_fpga_dev *fpga, char __user *buf, size_
  * TEST_INTERRUPT:
  * TODO: delete
  * 
+ * REGISTER_PGD:
+ * Optional, written by the guest after REGISTER_PID. The value is the
+ * guest physical address of the page table root of the process, with the
+ * CPID in the lower bits. TLB misses of this CPID are then resolved on the
+ * host if possible, instead of being forwarded to the vm. Writing 0 as the
+ * address switches back to forwarding.
+ * 
+ * SETUP_QUEUE:
+ * The guest writes the guest physical address of its submission queue
+ * (struct pv_queue) to this offset, 0 to tear it down.
+ * 
+ * KICK_QUEUE:
+ * Serves all descriptors posted to the submission queue: MAP_USER and
+ * UNMAP_USER requests, one exit per batch instead of one per request.
+ * 
  * @param vfpga mediated vfpga
  * @param buf write buffer
  * @param count bytes to write
@@ -980,8 +1202,6 @@ static ssize_t handle_bar2_write(struct m_fpga_dev *vfpga, const char __user *bu
     uint64_t cpid;
     struct bus_drvdata *pd;
     uint64_t tmp[MAX_USER_ARGS + 2];
-    struct hypervisor_map_notifier map_notifier, *full_map_notifier;
-    uint64_t map_full_size;
 
     ret_val = 0;
     offset = pos & HYPERVISOR_OFFSET_MASK;
@@ -1023,6 +1243,10 @@ static ssize_t handle_bar2_write(struct m_fpga_dev *vfpga, const char __user *bu
 
         vfpga->current_cpid = cpid;
 
+        // guest pid, needed to register the cpid again after a migration
+        if (cpid < HYPERVISOR_N_CPID_MAX)
+            vfpga->cpid_pid[cpid] = pid;
+
         spin_unlock(&pd->stat_lock);
         spin_unlock(&vfpga->current_cpid_lock);
 
@@ -1043,6 +1267,17 @@ static ssize_t handle_bar2_write(struct m_fpga_dev *vfpga, const char __user *bu
         cpid = tmp[0];
         dbg_info("Unregistering cpid %llu\n", cpid);
 
+        // Stop resolving faults on the host and drop the mappings installed for the process
+        if (cpid < HYPERVISOR_N_CPID_MAX && vfpga->cpid_pgd[cpid])
+        {
+            vfpga->cpid_pgd[cpid] = 0;
+            flush_work(&vfpga->fault_work);
+
+            mutex_lock(&vfpga->sbuff_lock);
+            hypervisor_tlb_put_user_pages_cpid(vfpga, cpid, 1);
+            mutex_unlock(&vfpga->sbuff_lock);
+        }
+
         // Unregister cpid
         spin_lock(&pd->stat_lock);
 
@@ -1056,6 +1291,8 @@ static ssize_t handle_bar2_write(struct m_fpga_dev *vfpga, const char __user *bu
 
         // Remove reverse mapping, cpid is not in use anymore
         vfpga->fpga->vdevs[cpid] = NULL;
+        if (cpid < HYPERVISOR_N_CPID_MAX)
+            vfpga->cpid_pid[cpid] = 0;
         dbg_info("unregestration succesfull in hypervisor pid: %lld id: %d\n", pid, vfpga->id);
         spin_unlock(&pd->stat_lock);
         return count;
@@ -1070,43 +1307,8 @@ static ssize_t handle_bar2_write(struct m_fpga_dev *vfpga, const char __user *bu
             return -EFAULT;
         }
 
-        // read notifier header from guest
-        ret_val = hypervisor_access_kvm(vfpga, tmp[0], sizeof(struct hypervisor_map_notifier), &map_notifier, 0);
-        if (ret_val)
-        {
-            pr_info("%s.%d: Failed to read from guest", __func__, __LINE__);
-            return -EIO;
-        }
-
-        // read complete notifier from guest
-        map_full_size = sizeof(struct hypervisor_map_notifier) + map_notifier.npages * sizeof(uint64_t);
-        full_map_notifier = kzalloc(map_full_size, GFP_KERNEL);
-
-        ret_val = hypervisor_access_kvm(vfpga, tmp[0], map_full_size, full_map_notifier, 0);
-        if (ret_val)
-        {
-            pr_info("%s.%d: Failed to read from guest", __func__, __LINE__);
-            kfree(full_map_notifier);
-            return -EIO;
-        }
-
-        dbg_info("Mapping user pages from hypervisor: gva: %llx, len: %llu, cpid: %llu", full_map_notifier->gva,
-                 full_map_notifier->len, full_map_notifier->cpid);
-        
-        // Pin pages and install user mappings onto fpga.
-        ret_val = hypervisor_tlb_get_user_pages(vfpga, full_map_notifier);
-        if (ret_val)
-        {
-            pr_info("%s.%d: Failed to get all user pages", __func__, __LINE__);
-        }
-        else
-        {
-            ret_val = count;
-            dbg_info("Successfully mapped user buffer\n");
-        }
-
-        kfree(full_map_notifier);
-        return ret_val;
+        ret_val = map_from_guest(vfpga, tmp[0]);
+        return ret_val ? ret_val : count;
     }
     case UNMAP_USER_OFFSET:
     {
@@ -1118,27 +1320,8 @@ static ssize_t handle_bar2_write(struct m_fpga_dev *vfpga, const char __user *bu
             return -EFAULT;
         }
 
-        // read gva + cpid from kvm
-        ret_val = hypervisor_access_kvm(vfpga, tmp[0], sizeof(struct hypervisor_map_notifier), &map_notifier,
-                                        0);
-        if (ret_val)
-        {
-            pr_info("%s.%d: Failed to read from kvm", __func__, __LINE__);
-            return -EFAULT;
-        }
-
-        ret_val = hypervisor_tlb_put_user_pages(vfpga, &map_notifier);
-        if (ret_val)
-        {
-            pr_info("%s.%d: Failed to put all user pages", __func__, __LINE__);
-        }
-        else
-        {
-            ret_val = count;
-            dbg_info("Successfully unmapped user buffer\n");
-        }
-
-        return ret_val;
+        ret_val = unmap_from_guest(vfpga, tmp[0]);
+        return ret_val ? ret_val : count;
     }
     case PUT_ALL_USER_PAGES:
     {
@@ -1151,7 +1334,9 @@ static ssize_t handle_bar2_write(struct m_fpga_dev *vfpga, const char __user *bu
         }
 
         // put all user pages 
+        mutex_lock(&vfpga->sbuff_lock);
         ret_val = hypervisor_tlb_put_user_pages_all(vfpga, tmp[0]);
+        mutex_unlock(&vfpga->sbuff_lock);
         if (ret_val)
         {
             pr_info("could not put all user pages\n");
@@ -1165,6 +1350,50 @@ static ssize_t handle_bar2_write(struct m_fpga_dev *vfpga, const char __user *bu
         dbg_info("Fired interrupt with ret_val %llu!\n", fire_interrupt(&vfpga->msix_vector[0]));
         return count;
     }
+    case SETUP_QUEUE_OFFSET:
+    {
+        ret_val = copy_from_user(&tmp, buf, count);
+        if (ret_val)
+        {
+            pr_err("%s.%u: Failed to copy data from user\n", __func__, __LINE__);
+            return -EFAULT;
+        }
+
+        vfpga->pv_queue_gpa = tmp[0];
+        dbg_info("Submission queue at gpa %llx\n", tmp[0]);
+        return count;
+    }
+    case KICK_QUEUE_OFFSET:
+    {
+        ret_val = drain_pv_queue(vfpga);
+        return ret_val ? ret_val : count;
+    }
+    case REGISTER_PGD_OFFSET:
+    {
+        ret_val = copy_from_user(&tmp, buf, count);
+        if (ret_val)
+        {
+            pr_err("%s.%u: Failed to copy data from user\n", __func__, __LINE__);
+            return -EFAULT;
+        }
+
+        cpid = tmp[0] & ~PAGE_MASK;
+
+        // Only processes of this vm
+        spin_lock(&pd->stat_lock);
+        if (cpid >= HYPERVISOR_N_CPID_MAX || vfpga->fpga->vdevs[cpid] != vfpga)
+        {
+            pr_err("page table registration for foreign cpid %llu, id: %d\n", cpid, vfpga->id);
+            spin_unlock(&pd->stat_lock);
+            return -EINVAL;
+        }
+
+        vfpga->cpid_pgd[cpid] = tmp[0] & PAGE_MASK;
+        spin_unlock(&pd->stat_lock);
+
+        dbg_info("Resolving faults of cpid %llu on the host, pgd %llx\n", cpid, tmp[0] & PAGE_MASK);
+        return count;
+    }
     default:
     {
         // Not used, should not cause any state change
@@ -1252,6 +1481,19 @@ static ssize_t hypervisor_vfpga_write(struct mdev_device *mdev, const char __use
 
         return handle_bar4_access(vfpga, (char *)buf, count, pos, 1);
     }
+#ifdef HYPERVISOR_MIGRATION
+    case MIGRATION_REGION_INDEX:
+    {
+        // Check bounds
+        if (offset + count > COYOTE_HYPERVISOR_MIGRATION_SIZE)
+        {
+            pr_err("%s.%u: Out of bound write\n", __func__, __LINE__);
+            return -EFAULT;
+        }
+
+        return hypervisor_migration_access(vfpga, (char __user *)buf, count, pos, 1);
+    }
+#endif
     default:
     {
         // Not a valid region to read
@@ -1301,6 +1543,12 @@ static long hypervisor_vfpga_ioctl(struct mdev_device *mdev, unsigned int cmd, u
     struct vfio_region_info region_info;
     struct vfio_irq_info irq_info;
     struct vfio_irq_set *irq_set;
+    struct vfio_region_info_cap_sparse_mmap *sparse;
+#ifdef HYPERVISOR_MIGRATION
+    struct vfio_region_info_cap_type mig_type;
+#endif
+    struct vfio_info_cap caps = { .buf = NULL, .size = 0 };
+    size_t sparse_size;
     int ret_val;
     unsigned int bytes;
     void __user *argp;
@@ -1342,6 +1590,10 @@ static long hypervisor_vfpga_ioctl(struct mdev_device *mdev, unsigned int cmd, u
 
         // Propagate default values from the framework
         dev_info.num_regions = VFIO_PCI_NUM_REGIONS;
+#ifdef HYPERVISOR_MIGRATION
+        // device specific migration region after the pci regions
+        dev_info.num_regions++;
+#endif
         dev_info.num_irqs = VFIO_PCI_NUM_IRQS;
 
         // Copy the updated info struct back to the user
@@ -1386,8 +1638,31 @@ static long hypervisor_vfpga_ioctl(struct mdev_device *mdev, unsigned int cmd, u
         case VFIO_PCI_BAR0_REGION_INDEX:
         {
             region_info.size = COYOTE_HYPERVISOR_BAR0_SIZE;
-            // direct pass through, for high performance, do not trap this instructions
+            // direct pass through of the user and config registers, for high performance, 
+            // do not trap this instructions; the TLB pages stay trapped
             region_info.flags |= VFIO_REGION_INFO_FLAG_MMAP;
+
+            sparse_size = sizeof(*sparse) + BAR0_N_MMAP_AREAS * sizeof(struct vfio_region_sparse_mmap_area);
+            sparse = kzalloc(sparse_size, GFP_KERNEL);
+            if (!sparse)
+            {
+                return -ENOMEM;
+            }
+
+            sparse->header.id = VFIO_REGION_INFO_CAP_SPARSE_MMAP;
+            sparse->header.version = 1;
+            sparse->nr_areas = BAR0_N_MMAP_AREAS;
+            sparse->areas[0].offset = FPGA_CTRL_USER_OFFS;
+            sparse->areas[0].size = FPGA_CTRL_USER_SIZE;
+            sparse->areas[1].offset = FPGA_CTRL_CNFG_OFFS;
+            sparse->areas[1].size = FPGA_CTRL_CNFG_SIZE;
+
+            ret_val = vfio_info_add_capability(&caps, &sparse->header, sparse_size);
+            kfree(sparse);
+            if (ret_val)
+            {
+                return ret_val;
+            }
             break;
         }
         case VFIO_PCI_BAR2_REGION_INDEX:
@@ -1402,6 +1677,25 @@ static long hypervisor_vfpga_ioctl(struct mdev_device *mdev, unsigned int cmd, u
             region_info.flags |= VFIO_REGION_INFO_FLAG_MMAP;
             break;
         }
+#ifdef HYPERVISOR_MIGRATION
+        case MIGRATION_REGION_INDEX:
+        {
+            region_info.size = COYOTE_HYPERVISOR_MIGRATION_SIZE;
+
+            // QEMU finds the region by its type
+            mig_type.header.id = VFIO_REGION_INFO_CAP_TYPE;
+            mig_type.header.version = 1;
+            mig_type.type = VFIO_REGION_TYPE_MIGRATION;
+            mig_type.subtype = VFIO_REGION_SUBTYPE_MIGRATION;
+
+            ret_val = vfio_info_add_capability(&caps, &mig_type.header, sizeof(mig_type));
+            if (ret_val)
+            {
+                return ret_val;
+            }
+            break;
+        }
+#endif
         default:
         {
             region_info.size = 0;
@@ -1414,6 +1708,30 @@ static long hypervisor_vfpga_ioctl(struct mdev_device *mdev, unsigned int cmd, u
         // Allow read and write
         region_info.flags |= VFIO_REGION_INFO_FLAG_READ | VFIO_REGION_INFO_FLAG_WRITE;
 
+        // Capabilities follow the info struct, if the user made room for them
+        if (caps.size)
+        {
+            region_info.flags |= VFIO_REGION_INFO_FLAG_CAPS;
+            if (region_info.argsz < sizeof(region_info) + caps.size)
+            {
+                region_info.argsz = sizeof(region_info) + caps.size;
+                region_info.cap_offset = 0;
+            }
+            else
+            {
+                vfio_info_cap_shift(&caps, sizeof(region_info));
+                ret_val = copy_to_user(argp + sizeof(region_info), caps.buf, caps.size);
+                if (ret_val)
+                {
+                    pr_err("%s.%u: Failed to copy to user space", __func__, __LINE__);
+                    kfree(caps.buf);
+                    return -EFAULT;
+                }
+                region_info.cap_offset = sizeof(region_info);
+            }
+            kfree(caps.buf);
+        }
+
         // Copy the updated info struct back to the user
         ret_val = copy_to_user(argp, &region_info, bytes);
         if (ret_val)
@@ -1523,6 +1841,8 @@ static long hypervisor_vfpga_ioctl(struct mdev_device *mdev, unsigned int cmd, u
  * into the pci region and from this we can determine which BAR is mapped.
  * BAR 0 and BAR 4 are seperated from each other. This allows to adjust sizes of 
  * these control registers later on without to much effort to change the hypervisor. 
+ * Of BAR 0 only the user and config registers can be mapped (the sparse mmap areas
+ * reported by VFIO_DEVICE_GET_REGION_INFO); the TLBs stay with the hypervisor.
  * 
  * @param mdev 
  * @param vma 
@@ -1533,6 +1853,7 @@ int hypervisor_vfpga_mmap(struct mdev_device *mdev, struct vm_area_struct *vma)
     int region;
     unsigned long vaddr;
     unsigned long offset;
+    unsigned long size;
 
     struct m_fpga_dev *md;
     struct fpga_dev *d;
@@ -1553,6 +1874,7 @@ int hypervisor_vfpga_mmap(struct mdev_device *mdev, struct vm_area_struct *vma)
     region = COYOTE_GET_INDEX(vaddr);
     // offset into this region
     offset = vaddr & HYPERVISOR_OFFSET_MASK;
+    size = vma->vm_end - vma->vm_start;
     ret_val = 0;
 
     dbg_info("MMAP with vaddr %lu, VFIO region index %d, offset %lu\n", vaddr, region, offset);
@@ -1563,17 +1885,23 @@ int hypervisor_vfpga_mmap(struct mdev_device *mdev, struct vm_area_struct *vma)
     // Allow passthrough to hardware
     if (region == VFIO_PCI_BAR0_REGION_INDEX)
     {
-        // BAR0 is for the address ctrl registers
-        ret_val = remap_pfn_range(vma, vma->vm_start, d->fpga_phys_addr_ctrl >> PAGE_SHIFT,
-                                  FPGA_CTRL_SIZE, vma->vm_page_prot);
+        // BAR0 is for the address ctrl registers, only the user and config pages
+        if (!(offset >= FPGA_CTRL_USER_OFFS && offset + size <= FPGA_CTRL_USER_OFFS + FPGA_CTRL_USER_SIZE) &&
+            !(offset >= FPGA_CTRL_CNFG_OFFS && offset + size <= FPGA_CTRL_CNFG_OFFS + FPGA_CTRL_CNFG_SIZE))
+        {
+            dbg_info("Refused mmap of BAR0 at offset %lx with size %lx\n", offset, size);
+            return -EPERM;
+        }
+
+        ret_val = remap_pfn_range(vma, vma->vm_start, (d->fpga_phys_addr_ctrl + offset) >> PAGE_SHIFT,
+                                  size, vma->vm_page_prot);
         if (ret_val)
         {
             dbg_info("Failed to mmap BAR0.\n");
         }
         else
         {
-            dbg_info("Mapped addr %llx with size %u\n", d->fpga_phys_addr_ctrl,
-                     FPGA_CTRL_SIZE);
+            dbg_info("Mapped addr %llx with size %lx\n", d->fpga_phys_addr_ctrl + offset, size);
         }
     }
     else if (region == VFIO_PCI_BAR4_REGION_INDEX)
@@ -26,6 +26,7 @@
 #include "../fpga_fops.h"
 #include "hypervisor_mmu.h"
 #include "hypervisor_interrupts.h"
+#include "hypervisor_migration.h"
 
 struct mdev_parent_ops *hypervisor_get_ops(struct fpga_dev *vfpga);
 
@@ -47,6 +47,7 @@
 #include <linux/pagemap.h>
 #include <linux/vmalloc.h>
 #include <linux/mm.h>
+#include <linux/hugetlb.h>
 #include <linux/memremap.h>
 #include <linux/sched/mm.h>
 #include <linux/highmem.h>
@@ -61,6 +62,12 @@
 #include <linux/rwsem.h>
 #include <asm/set_memory.h>
 #include <linux/hashtable.h>
+#include <linux/interval_tree_generic.h>
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 7, 0)
+#include <linux/io_uring/cmd.h>
+#elif LINUX_VERSION_CODE >= KERNEL_VERSION(5, 19, 0)
+#include <linux/io_uring.h>
+#endif
 #include <linux/moduleparam.h>
 #include <linux/stat.h>
 #include <linux/sysfs.h>
@@ -81,12 +88,16 @@
 #include <linux/dma-direct.h>
 #include <linux/dma-resv.h>
 #include <linux/dma-mapping.h>
+#include <linux/genalloc.h>
+#include <linux/random.h>
 
 // Driver arguments; see coyote_driver.c for details
 extern char *ip_addr;
 extern char *mac_addr;
 extern long int eost;
 extern bool en_hmm;
+extern bool en_lazy_unpin;
+extern int irq_affinity;
 
 //////////////////////////////////////////////
 //                CONSTANTS                //
@@ -165,6 +176,8 @@ extern bool en_hmm;
 #define QDMA_RD_QUEUE_START_IDX 1                     // Starting index of streaming queues for H2C operations; queues (QDMA_RD_QUEUE_START_IDX, QDMA_RD_QUEUE_START_IDX + QDMA_N_ACTIVE_QUEUES) can be used for reads
 #define QDMA_WR_QUEUE_START_IDX (QDMA_N_QUEUES / 2)   // Starting index of streaming queues for C2H operations; queues (QDMA_WR_QUEUE_START_IDX, QDMA_WR_QUEUE_START_IDX + QDMA_N_ACTIVE_QUEUES) can be used for writes
 
+// The queue layout is fixed by the static layer (qdma_rd_wrapper, qdma_wr_wrapper): one H2C queue per data channel and N_OUTSTANDING C2H queues per channel, 
+// shared by all vFPGAs through the shell's arbiters; the queues are not assigned to vFPGAs by software
 // Number of enabled queues (per direction); QDMA_N_ACTIVE_QUEUES must be >= N_OUTSANDING * 3; otherwise, a write request will target an invalid queue
 // Additionally, the maximum number of active C2H queues in bypass mode is 64, due to the limited number of prefetch tags (6 bits)
 // Therefore, QDMA_N_ACTIVE_QUEUES cannot be set to more than 64
@@ -172,6 +185,11 @@ extern bool en_hmm;
 
 #define QDMA_N_MAX_IRQ 16   
 
+// SR-IOV; each virtual function exposes one vFPGA and is given its own window of queues, after those of the PF (see pci_sriov_configure)
+// The QDMA must be configured with at least QDMA_VF_QUEUE_BASE + N_REGIONS * QDMA_VF_N_QUEUES queues; e.g., CPM5 supports up to 2048
+#define QDMA_VF_QUEUE_BASE QDMA_N_QUEUES
+#define QDMA_VF_N_QUEUES 8
+
 // QDMA registers, see p301 of the QDMA specification from PG347 (v3.4) 
 #define QDMA_CTX_CLR 0  
 #define QDMA_CTX_WR 1
@@ -319,14 +337,21 @@ extern bool en_hmm;
 #define DMA_MAX_SLEEP_CMD 50
 #define DMA_CTRL_START_MIDDLE 0x1
 #define DMA_CTRL_START_LAST 0x7
+#define DMA_MAX_XFER_LEN (1UL << 27)    /* Largest coalesced off-load/sync descriptor; the shell's length field is LEN_BITS = 28 wide */
 
 // TLB constants
 #define TLB_VADDR_RANGE 48
 #define TLB_PADDR_RANGE 44
 #define PID_SIZE 6
 #define STRM_SIZE 2
-#define MAX_N_MAP_PAGES 256  
+#define MAX_N_MAP_PAGES 256 // TLB entries written per burst, i.e., while holding mmu_lock
 #define MAX_N_MAP_HUGE_PAGES 256
+#define MAX_N_PREFAULT_RANGES 64
+#define MAX_N_BATCH_OPS 256
+#define MAX_N_INVLDT_PAGES (1 << 15) // 128 MB; the invalidation length must fit in the MMU's LEN_BITS
+#define FAULT_AHEAD_DEFAULT -1
+#define PINGPONG_WINDOW_MS 100  /* Migrations of a buffer less than this apart (in opposite directions) count as ping-pong */
+#define PINGPONG_THRESHOLD 4    /* Default number of successive ping-pong migrations after which a buffer is split; see vfpga_gup.c */
 #define MAX_N_REGIONS 16
 #define BUFF_NEEDS_EXP_SYNC_RET_CODE 99
 
@@ -335,8 +360,9 @@ extern bool en_hmm;
 // accross the entire memory; i.e. 4 GB for regular and 4 GB for huge pages
 // If more needed, change value and recompile driver. On UltraScale+ devices,
 // there is no fine-grained control over the memory bank to which a buffer is
-// allocated; that is N_MEM_BLOCKS is equal to 1
-#ifdef PLATFORM_ULTRASCALE_PLUS
+// allocated; that is N_MEM_BLOCKS is equal to 1. The same holds for Enzian,
+// whose FPGA is an UltraScale+ device attached over ECI instead of PCIe
+#if defined(PLATFORM_ULTRASCALE_PLUS) || defined(PLATFORM_ENZIAN)
     #define N_MEM_BLOCKS 1
     #define MEM_BLOCK_SIZE 0    // doesn't matter; effectively unused in this case but needed to compile
     #define MEM_START (256UL * 1024UL * 1024UL)
@@ -358,15 +384,18 @@ extern bool en_hmm;
 #endif
 
 // Reconfiguration constants
-#define RECONFIG_THRESHOLD 32
+#define RECONFIG_FIFO_DEPTH 32          /* Depth of the PR descriptor FIFO in the static layer (axis_data_fifo_static_slave) */
 #define RECONFIG_MIN_SLEEP_CMD 10
 #define RECONFIG_MAX_SLEEP_CMD 50
+#define RECONFIG_DEFAULT_BW 400         /* Configuration bandwidth estimate, in MB/s, until the first reconfiguration is measured */
 
 #define RECONFIG_CTRL_START_MIDDLE 0x1
 #define RECONFIG_CTRL_START_LAST 0x7
 #define RECONFIG_CTRL_IRQ_CLR_PENDING 0x4
 
 #define MAX_RECONFIG_BUFF_NUM 128
+#define RECONFIG_CACHE_MAX_PAGES 256    /* Capacity of the bitstream cache, in reconfiguration hugepages (512 MB) */
+#define RECONFIG_CACHE_HASH_CHUNK (16UL * 1024 * 1024)  /* Chunk size of the bitstream hash; must match BITSTREAM_LOAD_CHUNK in cDefs.hpp */
 
 // Use 2 MB "hugepages" for reconfiguration buffers
 #define RECONFIG_BUFF_PAGE_SHIFT 21  
@@ -380,6 +409,42 @@ extern bool en_hmm;
 #define IRQ_NOTIFY 4
 #define IRQ_RCNFG 5
 
+// User interrupt (notification) delivery modes, set per Coyote thread; see vfpga_uisr.h for more details
+#define NOTIFY_MODE_EVENTFD 0
+#define NOTIFY_MODE_COALESCED 1
+#define NOTIFY_MODE_POLL 2
+
+// Operations on user buffers in a batch (IOCTL_BATCH_USER_MEM); the same as the corresponding single-buffer IOCTL calls
+#define BATCH_OP_MAP 0
+#define BATCH_OP_UNMAP 1
+#define BATCH_OP_OFFLOAD 2
+#define BATCH_OP_OFFLOAD_HOST_UNCHANGED 3
+#define BATCH_OP_SYNC 4
+
+// Flags of an explicit buffer mapping (IOCTL_MAP_USER_MEM)
+// MAP_USER_RESIDENT: the buffer is already resident (e.g., mlocked or populated with MAP_POPULATE); it is mapped exactly, 
+// without the fault-ahead window, and its pages are pinned with the lockless fast path when mapped from the owning process
+#define MAP_USER_RESIDENT 0x1
+// MAP_USER_READ_ONLY: the vFPGA only reads the buffer (host-to-card); its pages are pinned without FOLL_WRITE, DMA-mapped to-device only
+// (so the IOMMU, if any, rejects writes) and never dirtied on release, and a card copy is never copied back to the host
+// MAP_USER_WRITE_ONLY: the vFPGA only writes the buffer (card-to-host); its pages are DMA-mapped from-device only and its host contents 
+// are not copied to the card on migrations, i.e., the parts not written by the vFPGA are undefined once the buffer resided on the card
+// Both hints map the buffer exactly, without the fault-ahead window, and are mutually exclusive
+#define MAP_USER_READ_ONLY 0x2
+#define MAP_USER_WRITE_ONLY 0x4
+#define MAP_USER_ACCESS_MASK (MAP_USER_READ_ONLY | MAP_USER_WRITE_ONLY)
+
+// Number of entries in a notification ring (power of 2); there is one ring per Coyote thread, see struct notify_ring
+#define NOTIFY_RING_ENTRIES 512
+#define NOTIFY_RINGS_SIZE (PAGE_ALIGN(N_CTID_MAX * sizeof(struct notify_ring)))
+
+// Version of the layout of struct vfpga_stats_page, and its size (mapped with MMAP_STATS)
+#define VFPGA_STATS_VERSION 1
+
+// Flags of struct vfpga_stats_page: user buffers are tracked by the MMU notifier (en_lazy_unpin), so freed buffers are invalidated by the driver
+#define VFPGA_STATS_FLAG_LAZY_UNPIN 0x1
+#define VFPGA_STATS_SIZE (PAGE_ALIGN(sizeof(struct vfpga_stats_page)))
+
 // Dynamic major numbers for the char devices
 #define VFPGA_DEV_MAJOR 0
 #define RECONFIG_DEV_MAJOR 0 
@@ -392,6 +457,9 @@ extern bool en_hmm;
 #define MMAP_CNFG 0x1
 #define MMAP_CNFG_AVX 0x2
 #define MMAP_CTRL 0x3
+#define MMAP_NOTIFY 0x4
+#define MMAP_STATS 0x5
+#define MMAP_CNFG_AVX_WC 0x6
 #define MMAP_RECONFIG 0x100
 
 // vFPGA IOCTL calls; see vfpga_ops.c for more details
@@ -414,6 +482,20 @@ extern bool en_hmm;
 #define IOCTL_SHELL_NET_STATS _IOR('F', 17, unsigned long)
 #define IOCTL_SET_NOTIFICATION_PROCESSED _IOR('F', 18, unsigned long)
 #define IOCTL_GET_NOTIFICATION_VALUE _IOR('F', 19, unsigned long)
+#define IOCTL_PREFAULT_USER_MEM _IOW('F', 20, unsigned long)
+#define IOCTL_SET_FAULT_AHEAD _IOW('F', 21, unsigned long)
+#define IOCTL_SET_NOTIFY_MODE _IOW('F', 22, unsigned long)
+#define IOCTL_BATCH_USER_MEM _IOW('F', 23, unsigned long)
+#define IOCTL_NEIGH_LOOKUP _IOWR('F', 24, unsigned long)
+#define IOCTL_MAP_CARD_MEM _IOW('F', 25, unsigned long)
+#define IOCTL_UNMAP_CARD_MEM _IOW('F', 26, unsigned long)
+#define IOCTL_COPY_CARD_MEM _IOW('F', 27, unsigned long)
+#define IOCTL_SHARE_CARD_MEM _IOWR('F', 28, unsigned long)
+#define IOCTL_ATTACH_CARD_MEM _IOWR('F', 29, unsigned long)
+#define IOCTL_EXPORT_P2P_WINDOW _IOR('F', 30, unsigned long)
+#define IOCTL_PERSIST_CARD_MEM _IOWR('F', 31, unsigned long)
+#define IOCTL_LOOKUP_CARD_MEM _IOWR('F', 32, unsigned long)
+#define IOCTL_UNPERSIST_CARD_MEM _IOW('F', 33, unsigned long)
 
 // Reconfiguration IOCTL calls; see reconfig_ops.c for more details
 #define IOCTL_ALLOC_HOST_RECONFIG_MEM _IOW('P', 1, unsigned long)
@@ -422,12 +504,20 @@ extern bool en_hmm;
 #define IOCTL_RECONFIGURE_SHELL _IOW('P', 4, unsigned long)
 #define IOCTL_PR_CNFG _IOR('P', 5, unsigned long)
 #define IOCTL_PR_WB_STATS _IOR('P', 6, unsigned long)
+#define IOCTL_RECONFIGURE_APP_ASYNC _IOW('P', 7, unsigned long)
+#define IOCTL_RECONFIGURE_APP_RESULT _IOR('P', 8, unsigned long)
+#define IOCTL_ADD_RECONFIG_CACHE _IOW('P', 9, unsigned long)
+#define IOCTL_GET_RECONFIG_CACHE _IOW('P', 10, unsigned long)
 
 // Sizes of hash tables
-#define USER_HASH_TABLE_ORDER 8
 #define PID_HASH_TABLE_ORDER 8
 #define RECONFIG_HASH_TABLE_ORDER 8
 #define HMM_HASH_TABLE_ORDER 8
+#define NEIGH_HASH_TABLE_ORDER 8
+#define CARD_SHARED_HASH_TABLE_ORDER 6
+
+// Maximum length of the name of persistent card memory, including the terminating NUL
+#define CARD_MEM_NAME_LEN 64
 
 // Writeback buffer configuration
 #define N_CTID_MAX 64
@@ -440,6 +530,7 @@ extern bool en_hmm;
 #define N_HDMA_STAT_REGS 12             /* Shell (streaming data & sync/offload) host DMA channel statistics; implemented in dma_stats.sv */
 #define N_HDMA_STAT_CH_REGS (N_HDMA_STAT_REGS / XDMA_MAX_NUM_CHANNELS)
 #define N_NET_STAT_REGS 10              /* Network statistics */
+#define HDMA_BEAT_BYTES 64              /* Bytes per data beat counted by the host DMA statistics (AXI_DATA_BITS / 8) */
 
 // Maximum number of user arguments for IOCTL calls passed from the user space
 #define MAX_USER_ARGS 32
@@ -601,6 +692,10 @@ struct vfpga_cnfg_regs {
     uint64_t sync_card_offs;
     uint64_t sync_len;
     uint64_t sync_stat;
+    uint64_t hdma_share;    // Host DMA bandwidth share in MB/s, [31:0] reads and [63:32] writes; 0 is unlimited
+    uint64_t hdma_xfer;     // Host DMA bytes granted in the last ms, [31:0] reads and [63:32] writes
+    uint64_t rsrvd_1;
+    uint64_t net_arp;       // ARP lookup of an IP address; at the same offset in the AVX register map (NET_ARP_REG)
     // Rest is user space
 } __packed;
 
@@ -722,8 +817,11 @@ struct hpid_ctid_pages {
  * including mapping, unmapping, and migrating pages between host and card memory.
  */
 struct user_pages {
-    /// Hast table entry of this struct for easy lookups of user_buff_map in vfpga_gup.c
-    struct hlist_node entry;
+    /// Interval tree node of this struct, for lookups by address in user_buff_map in vfpga_gup.c
+    struct rb_node it_node;
+
+    /// Last page covered by the subtree of it_node; maintained by the interval tree
+    uint64_t it_last;
 
     /// Buffer starting virtual address
     uint64_t vaddr;
@@ -740,9 +838,12 @@ struct user_pages {
     /// Set to true if the buffer is currently residing on the host, false if not
     int32_t host;
     
-    /// The actual pages holding the buffer
+    /// The pinned pages holding the buffer; for hugepage buffers, only the first page of each large page is pinned (and held here)
     struct page **pages;
 
+    /// Number of entries in pages, i.e., of pins held: one per large page for hugepage buffers, one per page otherwise
+    uint64_t n_pins;
+
     /** 
      * dma_buf represents a shared DMA buffer; acting as a reference to the memory that is shared between multiple devices
      * The buffer is allocated by a producer device (GPU) and exported for other devices to access (FPGA)
@@ -763,6 +864,90 @@ struct user_pages {
 
     /// Set to true if explicit synchronization (i.e. dma_sync_single_for_{device,cpu}) is needed for this buffer, false otherwise
     bool needs_explicit_sync;
+
+    /// Set to true if the exporter moved the buffer (a dmabuf) and its new placement is not mapped in the TLB yet; protected by the dmabuf's reservation lock
+    bool dmabuf_pending;
+
+    /// Fault-ahead window, in bytes, for this buffer; FAULT_AHEAD_DEFAULT uses the device-wide window (bus_driver_data.fault_ahead)
+    int64_t fault_ahead;
+
+    /// Access hint of the buffer, MAP_USER_READ_ONLY, MAP_USER_WRITE_ONLY or 0 (the vFPGA reads and writes it); see IOCTL_MAP_USER_MEM
+    uint32_t access;
+
+    /// vFPGA the buffer is mapped to; needed by the MMU notifier callback
+    struct vfpga_dev *device;
+
+    /// MMU interval notifier, tracking the buffer's virtual address range when lazy unpinning (en_lazy_unpin) is enabled
+    struct mmu_interval_notifier notifier;
+
+    /// Set to true if the notifier was successfully registered and has not been removed yet
+    bool notifier_registered;
+
+    /// Set to 1 once the notifier has invalidated the buffer; stale buffers are skipped in lookups and released by work_release
+    atomic_t stale;
+
+    /// Deferred release of a stale buffer; the notifier cannot be removed from its own callback
+    struct work_struct work_release;
+
+    /// Set to true if the card copy of the buffer holds the same data as the host copy; i.e. after an off-load or a sync, until the vFPGA writes to the card copy
+    bool card_valid;
+
+    /// Entry in the vFPGA's card memory LRU list (vfpga_dev.card_lru); empty for buffers without card memory or with evicted card memory (cpages == NULL)
+    struct list_head lru;
+
+    /// Target memory block and stripe of the card memory, as requested by the user; kept to re-allocate evicted card memory
+    int32_t mem_block;
+    uint32_t mem_stripe;
+
+    /// Number of migrations of the buffer (whole or by range), and the time (in jiffies) of the last whole-buffer migration
+    uint64_t n_migrations;
+    unsigned long last_migration;
+
+    /// Number of successive whole-buffer migrations, each within PINGPONG_WINDOW_MS of the previous one
+    uint32_t n_pingpong;
+
+    /**
+     * Per-page residency (set bit: page resides on the card) of a split buffer, NULL otherwise
+     * Buffers which ping-pong between the host and the card are split; their faults only migrate the faulting range,
+     * and host is ignored until an explicit off-load or sync makes the whole buffer reside on one side again
+     */
+    unsigned long *card_pages;
+
+    /**
+     * Set to true for card-only buffers (IOCTL_MAP_CARD_MEM), which have card memory but no host pages (pages and hpages are NULL)
+     * They always reside on the card; they are never migrated, split or evicted, and are only copied to and from host buffers explicitly
+     */
+    bool card_only;
+
+    /// Shared card memory of a card-only buffer (IOCTL_SHARE_CARD_MEM, IOCTL_ATTACH_CARD_MEM), NULL if the card memory is private; cpages then belongs to it
+    struct card_shared_buff *shared;
+};
+
+/**
+ * @brief Card memory shared by the card-only buffers of several Coyote threads (possibly of different processes and vFPGAs) on a card
+ *
+ * Created from a card-only buffer with IOCTL_SHARE_CARD_MEM; other Coyote threads map the same card memory with IOCTL_ATTACH_CARD_MEM, by handle.
+ * Each mapping holds a reference; the card memory is released with the last one. Named, persistent card memory holds one more reference.
+ */
+struct card_shared_buff {
+    /// Hash table entry in bus_driver_data->card_shared_map, by handle
+    struct hlist_node entry;
+
+    /// Handle, by which the buffer is attached; random, so that it can't be guessed by unrelated processes
+    uint64_t handle;
+
+    /// Card pages, number of (regular) pages and whether they were allocated as huge pages
+    uint64_t *cpages;
+    uint64_t n_pages;
+    bool huge;
+
+    /// Number of card-only buffers mapping the card memory, plus one if persistent; protected by bus_driver_data->card_shared_lock
+    uint32_t ref_cnt;
+
+    /// Persistent card memory (IOCTL_PERSIST_CARD_MEM) outlives its mappings, until IOCTL_UNPERSIST_CARD_MEM or the driver is removed;
+    /// it is found again by its name (IOCTL_LOOKUP_CARD_MEM), e.g., by a restarted process
+    bool persistent;
+    char name[CARD_MEM_NAME_LEN];
 };
 
 /**
@@ -808,11 +993,44 @@ struct reconfig_buff_metadata {
     /// Number of pages in the buffer
     uint32_t n_pages;
 
-    /// The actual pages holding the buffer
+    /// The pinned pages holding the buffer; for hugepage buffers, only the first page of each large page is pinned (and held here)
     struct page **pages;
 
+    /// Number of entries in pages, i.e., of pins held: one per large page for hugepage buffers, one per page otherwise
+    uint64_t n_pins;
+
     /// Array of physical addresses on the host, one for each page in the pages array
     uint64_t *hpages;
+
+    /// Cached bitstream mapped by this buffer, or NULL for a private buffer; pages and hpages of a cached buffer belong to the cache entry
+    struct reconfig_cache_entry *cached;
+};
+
+/**
+ * @brief Bitstream cache entry
+ *
+ * A bitstream registered in the driver-wide, content-addressed bitstream cache (reconfig_cache_map), by the hash of its contents.
+ * Any process can then map the cached bitstream (read-only) and reconfigure with it, instead of loading its own copy.
+ * Entries which are not mapped by any buffer stay cached, and are evicted in LRU order once the cache is full
+ */
+struct reconfig_cache_entry {
+    /// Hash table entry for lookups in reconfig_cache_map, by hash
+    struct hlist_node entry;
+
+    /// Entry in the LRU list of the cache (reconfig_dev->cache_lru); least recently used first
+    struct list_head lru;
+
+    /// Hash of the bitstream contents (chunked FNV-1a, as in cRcnfg.cpp; verified by the driver) and bitstream length in bytes
+    uint64_t hash;
+    uint64_t len;
+
+    /// Number of pages, the pages holding the bitstream and their physical addresses on the host
+    uint32_t n_pages;
+    struct page **pages;
+    uint64_t *hpages;
+
+    /// Number of reconfiguration buffers mapping this entry; only entries without users can be evicted
+    uint32_t n_users;
 };
 
 /**
@@ -830,26 +1048,211 @@ struct dma_buf_move_notify_private {
 
     /// Associated Coyote thread ID (CTID)
     int ctid;
+
+    /// Mapping of the buffer; set once the buffer is attached, so that p2p_move_notify doesn't need to look it up
+    struct user_pages *user_pg;
 };
 
+/**
+ * @brief Peer-to-peer window of a vFPGA, exported as a DMA Buffer
+ *
+ * A region of the vFPGA's BAR which other devices (e.g., a vFPGA on another card in the same host) can DMA to
+ * directly, over PCIe, by importing the DMA Buffer (IOCTL_MAP_DMABUF). Private data of the exported DMA Buffer.
+ */
+struct p2p_export_private {
+    /// vFPGA device exporting the window
+    struct vfpga_dev *device;
+
+    /// Physical (bus) address of the window
+    phys_addr_t phys;
+
+    /// Size of the window, in bytes
+    uint64_t size;
+};
+
+/**
+ * @brief Notification ring
+ * Single-producer, single-consumer ring of user interrupt (notification) values of one Coyote thread, in the coalesced and polling modes
+ * The driver pushes the values from the ISR, the user space drains them from its mapping of the rings (MMAP_NOTIFY); head and tail are free-running
+ * The layout must match notifyRing in sw/include/coyote/cDefs.hpp
+ */
+struct notify_ring {
+    /// Number of values pushed by the driver
+    uint32_t head;
+
+    /// Number of values consumed by the user space
+    uint32_t tail;
+
+    /// Set by the user space before it waits on the eventfd (coalesced mode); the driver only signals the eventfd if set, and clears it
+    uint32_t armed;
+
+    /// Number of values dropped since the ring was full
+    uint32_t dropped;
+
+    /// Padding, keeping the values in a separate cache line
+    uint32_t reserved[12];
+
+    /// Notification values
+    int32_t values[NOTIFY_RING_ENTRIES];
+};
+
+/**
+ * @brief Statistics of one Coyote thread, maintained by the driver as it handles the thread's events
+ * The counters are free-running and only cleared when the ctid is registered; readers should compare generation before 
+ * and after reading the counters, to detect a new thread. The layout must match vfpgaCtidStats in sw/include/coyote/cDefs.hpp
+ */
+struct vfpga_ctid_stats {
+    /// Incremented whenever the ctid is registered (and each counter is cleared)
+    atomic64_t generation;
+
+    /// Host process ID of the thread
+    atomic64_t hpid;
+
+    /// Page faults (TLB misses) raised by the vFPGA, by stream (CARD_ACCESS, HOST_ACCESS)
+    atomic64_t pfaults[2];
+
+    /// Page faults which could not be handled (and were dropped)
+    atomic64_t pfault_errors;
+
+    /// Total time spent handling the page faults, in ns
+    atomic64_t pfault_ns;
+
+    /// TLB entries written (on page faults and user-space mappings)
+    atomic64_t tlb_maps;
+
+    /// TLB invalidations (of a buffer each)
+    atomic64_t tlb_invalidations;
+
+    /// Buffer migrations, by destination stream (CARD_ACCESS, HOST_ACCESS)
+    atomic64_t migrations[2];
+
+    /// Explicit off-loads and syncs
+    atomic64_t offloads;
+    atomic64_t syncs;
+
+    /// User interrupts (notifications)
+    atomic64_t notifications;
+
+    /// Buffers split because they ping-ponged between the host and the card
+    atomic64_t pingpong_splits;
+
+    /// Buffers invalidated by the MMU notifier (lazy unpinning), e.g., since they were unmapped or freed; see user_pg_invalidate
+    atomic64_t mmu_invalidations;
+
+    atomic64_t reserved[1];
+};
+
+/**
+ * @brief Statistics page of a vFPGA, mapped read-only to user space (MMAP_STATS), so monitoring can sample it without system calls
+ * Completion counters are not included, since the vFPGA itself writes them per ctid to the writeback region (MMAP_WB)
+ * The layout must match vfpgaStatsPage in sw/include/coyote/cDefs.hpp
+ */
+struct vfpga_stats_page {
+    /// Layout version, VFPGA_STATS_VERSION
+    uint64_t version;
+
+    /// Driver configuration relevant to user space, VFPGA_STATS_FLAG_*
+    uint64_t flags;
+
+    uint64_t reserved[6];
+
+    /// Statistics of each Coyote thread, by ctid
+    struct vfpga_ctid_stats ctids[N_CTID_MAX];
+};
+
+/// Phases of the page fault handler, timed for the coyote_pfault tracepoint and the page fault histograms
+enum pfault_phase {
+    PFAULT_LOCK = 0,    // Waiting for the vFPGA's mmu_lock
+    PFAULT_PIN = 1,     // Pinning user pages
+    PFAULT_MAP = 2,     // Writing TLB entries
+    PFAULT_TOTAL = 3,   // Whole handler
+    N_PFAULT_PHASES = 4
+};
+
+/// Affinity policies of the vFPGA interrupts; see the irq_affinity driver argument in coyote_driver.c
+enum irq_affinity_policy {
+    IRQ_AFFINITY_NONE = 0,
+    IRQ_AFFINITY_SPREAD = 1,
+    IRQ_AFFINITY_FOLLOW = 2
+};
+
+// Number of buckets of the page fault histograms; bucket i counts the faults taking [2^(i-1), 2^i) us, the last one also all longer ones
+#define PFAULT_HIST_BUCKETS 24
+
+/// Time spent in each phase by the page fault being handled for a Coyote thread, in ns; see vfpga_dev.pf_trace
+struct pfault_trace {
+    uint64_t ns[N_PFAULT_PHASES];
+};
+
+// Neighbor table of the network stack; see coyote_neigh.c
+#define NEIGH_SETTLE_NS (100 * NSEC_PER_USEC)   /* Time for an ARP lookup to resolve; must match SLEEP_TIME (in us) in cDefs.hpp */
+#define NEIGH_MAX_ENTRIES 4096
+
+/// An IP address looked up by the ARP server of the network stack
+struct neigh_entry {
+    /// Hash table entry in bus_driver_data->neigh_map, by IP address
+    struct hlist_node entry;
+
+    uint32_t ip_addr;
+
+    /// Time (ktime_get_ns) the lookup was issued
+    uint64_t issued;
+};
+
+/// Latency histograms of the page faults of all the vFPGAs, by phase; reported and cleared through sysfs (cyt_attr_pfault_hist)
+struct pfault_hist {
+    atomic64_t buckets[N_PFAULT_PHASES][PFAULT_HIST_BUCKETS];
+    atomic64_t sum_ns[N_PFAULT_PHASES];
+    atomic64_t count;
+};
+
+// Adds ns to a phase of the page fault being handled for a Coyote thread, if any (e.g., not for user-space mappings)
+#define PFAULT_TRACE_ADD(device, ctid, phase, delta) \
+    do { \
+        if ((ctid) >= 0 && (ctid) < N_CTID_MAX && (device)->pf_trace[(ctid)]) \
+            (device)->pf_trace[(ctid)]->ns[(phase)] += (delta); \
+    } while (0)
+
+// Adds n to a counter of a Coyote thread in the statistics page of a vFPGA
+#define VFPGA_STAT_ADD(device, ctid, field, n) \
+    do { \
+        if ((device)->stats && (ctid) >= 0 && (ctid) < N_CTID_MAX) \
+            atomic64_add((n), &(device)->stats->ctids[(ctid)].field); \
+    } while (0)
+
 /// Table of Coyote thread IDs (CTIDs) mapped to host process IDs (hpid); per vFPGA
 extern struct hlist_head hpid_ctid_map[MAX_N_REGIONS][1 << (PID_HASH_TABLE_ORDER)];
 
-/// Table of buffers mapped to vFPGA TLBs; entries per vFPGA and Coyote thread ID
-extern struct hlist_head user_buff_map[MAX_N_REGIONS][N_CTID_MAX][1 << (USER_HASH_TABLE_ORDER)]; 
+/// Buffers mapped to vFPGA TLBs, as interval trees keyed by the buffers' page ranges; per vFPGA and Coyote thread ID
+extern struct rb_root_cached user_buff_map[MAX_N_REGIONS][N_CTID_MAX];
+
+/// Locks for the buffer tables above; held while pinning, mapping or releasing the buffers of a Coyote thread
+extern struct mutex user_buff_lock[MAX_N_REGIONS][N_CTID_MAX];
 
 /// Table of buffers used for reconfiguration
 extern struct hlist_head reconfig_buffs_map[1 << (RECONFIG_HASH_TABLE_ORDER)];
 
+/// Table of reconfiguration buffers which were allocated but not yet mapped to user space, indexed by the host PID; at most one per process
+extern struct hlist_head reconfig_pending_map[1 << (RECONFIG_HASH_TABLE_ORDER)];
+
+/// Bitstream cache, indexed by the hash of the bitstream contents
+extern struct hlist_head reconfig_cache_map[1 << (RECONFIG_HASH_TABLE_ORDER)];
+
 /// The associated eventfd contexts for user interrupts; one per vFPGA and Coyote thread ID; see vfpga_uisr.c for more details
 extern struct eventfd_ctx *user_notifier[MAX_N_REGIONS][N_CTID_MAX];
 
-/// Interrupt locks, ensuring that only one interrupt (per vFPGA and cThread) is processed at a time and that the user space can safely read/write to the eventfd context
-extern struct mutex user_notifier_lock[MAX_N_REGIONS][N_CTID_MAX];
+/// Set while a notification (per vFPGA and cThread) is delivered through the eventfd and not yet acknowledged, so that only one is processed at a time; protected by the vFPGA's irq_lock
+extern bool notify_busy[MAX_N_REGIONS][N_CTID_MAX];
+
+/// Number of notifications (per vFPGA and cThread) waiting in the notification workqueue for the previous one to be acknowledged; protected by the vFPGA's irq_lock
+extern uint32_t notify_queued[MAX_N_REGIONS][N_CTID_MAX];
 
 /// Interrupt values used to pass values between vpfga_isr and vpfga_ops
 extern int32_t interrupt_value[MAX_N_REGIONS][N_CTID_MAX];
 
+/// Notification delivery mode (NOTIFY_MODE_*) of each vFPGA and Coyote thread; see vfpga_uisr.c
+extern int32_t notify_mode[MAX_N_REGIONS][N_CTID_MAX];
+
 #ifdef HMM_KERNEL
 extern struct list_head migrated_pages[MAX_N_REGIONS][N_CTID_MAX];
 #endif
@@ -873,11 +1276,16 @@ struct chunk {
  * Therefore, on Versal devices, one instance of this struct is created for each HBM "block"
  * (pseudo-channel) is created. On UltraScale+, there is only instance of this struct, 
  * representing the entire memory 
+ *
+ * The memory is managed by a bitmap allocator (genalloc) with a granularity of one regular page;
+ * freed pages are coalesced with their free neighbours, so that large, aligned (e.g., huge page) 
+ * allocations keep succeeding as long as there is sufficient contiguous memory
  */
 struct memory_partition {
-    struct chunk *chunks;   /* Array of available chunks */
-    struct chunk *alloc;    /* Array of allocated chunks */
-    int32_t free_chunks;    /* Number of free chunks */
+    struct gen_pool *pool;  /* Bitmap allocator over the partition; NULL until the first allocation from the partition */
+    uint64_t base;          /* Card physical address of the first page in the partition */
+    uint64_t size;          /* Size of the partition, in bytes */
+    uint64_t n_fallbacks;   /* Number of buffers that could not be allocated contiguously (i.e. page by page); indicator of fragmentation */
 };
 
 /**
@@ -958,6 +1366,9 @@ struct vfpga_dev {
 
     /// Number of times this vFPGA device has been opened; typically equal to the number of active Coyote threads associated with this vFPGA
     uint32_t ref_cnt;
+
+    /// Set while the vFPGA is exposed to a guest through an SR-IOV virtual function; the host char device can't be opened (see pci_qdma.c)
+    bool vf_owned;
     
     /// Physical address of the control region (vfpga_cnfg_regs) in the vFPGA 
     uint64_t vfpga_cnfg_phys_addr;
@@ -971,6 +1382,18 @@ struct vfpga_dev {
     /// Physical address of the writeback region
     uint64_t wb_phys_addr;
 
+    /// Notification rings of all the Coyote threads (N_CTID_MAX); allocated on the first IOCTL_SET_NOTIFY_MODE and mapped with MMAP_NOTIFY
+    struct notify_ring *notify_rings;
+
+    /// Statistics of all the Coyote threads; allocated with the device and mapped (read-only) with MMAP_STATS
+    struct vfpga_stats_page *stats;
+
+    /// Timing of the page fault being handled, by Coyote thread; set by vfpga_pfault_handler under user_buff_lock, NULL otherwise
+    struct pfault_trace *pf_trace[N_CTID_MAX];
+
+    /// CPU the vFPGA's interrupt is pinned to, -1 if not pinned; the page fault and notification work is queued on the same NUMA node
+    int irq_cpu;
+
     /// Pointer to the large page TLB registers in the vFPGA; memory mapped during driver initialization
     volatile uint64_t *fpga_lTlb;
     
@@ -998,8 +1421,12 @@ struct vfpga_dev {
     /// Pointer to chunks used for PID allocation; used in conjuction with the list of Coyote threads
     struct chunk *pid_alloc;
 
-    /// Mutex for MMU operations (TLB mapping, unmapping, DMA Buff operations), ensuring atomic operations
+    /// Mutex for TLB writes (mapping, unmapping, invalidation, MMU restart); only held for the hardware accesses,
+    /// the buffer state of each Coyote thread is protected by user_buff_lock, so page faults of different threads proceed in parallel
     struct mutex mmu_lock;
+
+    /// Number of user-space MMU requests in progress; the hardware TLB is locked while non-zero (see lock_tlb)
+    int32_t tlb_lock_cnt;
     
     /// Mutex for off-load operations, ensuring atomic data movement between host and card memory
     struct mutex offload_lock;
@@ -1007,12 +1434,21 @@ struct vfpga_dev {
     /// Mutex for sync operations, ensuring atomic data movement between host and card memory
     struct mutex sync_lock;
 
+    /// Buffers with card memory, from least to most recently used; when the card memory runs out, the card memory of buffers residing on the host is evicted in this order
+    struct list_head card_lru;
+
+    /// Spinlock protecting card_lru
+    spinlock_t card_lru_lock;
+
     /// Workqueue for handling page faults; allows for asynchronous processing of page faults
     struct workqueue_struct *wqueue_pfault;
     
     /// Workqueue for handling user notifications; allows for asynchronous processing of user interrupts (notifications)
     struct workqueue_struct *wqueue_notify;
 
+    /// Waitqueue for the acknowledgement of user notifications (see notify_busy)
+    wait_queue_head_t waitqueue_notify;
+
     /// Waitqueue for TLB invalidation
     wait_queue_head_t waitqueue_invldt;
     
@@ -1039,6 +1475,29 @@ struct vfpga_dev {
     #endif 
 };
 
+/**
+ * @brief Asynchronous app reconfiguration request
+ *
+ * Issued with IOCTL_RECONFIGURE_APP_ASYNC; the ioctl returns immediately, the reconfiguration is executed by a work item
+ * and its completion is signalled through an eventfd
+ */
+struct reconfig_async {
+    /// Work item, executing the reconfiguration on the system's unbound workqueue
+    struct work_struct work;
+
+    /// Reconfiguration device the request belongs to
+    struct reconfig_dev *device;
+
+    /// Bitstream virtual address, bitstream length, host PID and configuration ID (crid), as passed to reconfigure_start
+    uint64_t args[4];
+
+    /// eventfd context signalled on completion
+    struct eventfd_ctx *efd;
+
+    /// Return value of the last reconfiguration of the vFPGA; read with IOCTL_RECONFIGURE_APP_RESULT
+    int ret_val;
+};
+
 /**
  * @brief Reconfig char device structure
  *
@@ -1058,20 +1517,51 @@ struct reconfig_dev {
     /// Spinlock for IRQ handling; prevents multiple interrupts being processed simultaneously
     spinlock_t irq_lock; 
 
-    /// Reconfiguration mutex, ensuring there is only ever one reconfiguration happening at a time
-    struct mutex rcnfg_lock;
+    /**
+     * The ICAP is granted to one reconfiguration at a time, in FIFO order: each reconfiguration takes a ticket (icap_next)
+     * and waits on waitqueue_icap until it's served (icap_serving); see icap_acquire in reconfig_hw.c
+     */
+    atomic64_t icap_next;
+    atomic64_t icap_serving;
+    wait_queue_head_t waitqueue_icap;
+
+    /// Per-vFPGA reconfiguration locks, held from decoupling until coupling the vFPGA; independent regions don't block each other
+    struct mutex region_lock[MAX_N_REGIONS];
 
-    /// Memory lock, ensuring no conditions occur when allocating buffers for reconfiguration
+    /// Memory lock, protecting the tables of reconfiguration buffers (reconfig_buffs_map and reconfig_pending_map) and the bitstream cache
     spinlock_t mem_lock;
 
+    /// Bitstream cache entries in LRU order (least recently used first) and the number of pages they hold
+    struct list_head cache_lru;
+    uint32_t cache_pages;
+
+    /// Bitstream cache statistics: lookups which found the bitstream, bitstreams added and evicted
+    uint64_t cache_hits;
+    uint64_t cache_adds;
+    uint64_t cache_evictions;
+
     /// Waitqueue for the reconfiguration
     wait_queue_head_t waitqueue_rcnfg;
 
     /// Atomic flag when waiting for reconfiguration to complete; cleared once reconfiguration is done
     atomic_t wait_rcnfg;
 
-    /// The buffer (holding the partial bitstream) currently being used for dynamic reconfiguration
-    struct reconfig_buff_metadata curr_buff;
+    /// Start time (ns) and length (bytes) of the ongoing reconfiguration
+    uint64_t start_ns;
+    uint64_t curr_len;
+
+    /// Duration (ns) and length (bytes) of the last completed reconfiguration
+    uint64_t last_ns;
+    uint64_t last_len;
+
+    /// Achieved configuration bandwidth of the last reconfiguration, in MB/s; used to pace the descriptor writes
+    uint64_t bw;
+
+    /// Asynchronous app reconfigurations (IOCTL_RECONFIGURE_APP_ASYNC), one per vFPGA; see reconfig_ops.c
+    struct reconfig_async async_req[MAX_N_REGIONS];
+
+    /// Bitmap of the vFPGAs with an asynchronous reconfiguration in progress
+    unsigned long async_pending;
 };
 
 /// Placeholder for an empty kobject, used to avoid NULL pointer dereferences when removing the sysfs
@@ -1087,13 +1577,15 @@ static const struct kobject cyt_kobj_empty;
  * which ensures its state and accessability throughout the driver lifecycle. This occurs in
  * pci_xdma.c (or pci_qdma.c), in the pci_probe() function. Many of the attributes here are not specific to a single vFPGA
  * or reconfiguration device; instead these are used througout Coyote. 
- * Additionally, this structure holds some underlying bus (e.g., PCI, ECI) variables and metadata. In the past
- * Enzian (ECI) used to be supported, but has since been deprecated. 
+ * Additionally, this structure holds some underlying bus (e.g., PCI, ECI) variables and metadata. On Enzian (ECI),
+ * the structure is associated with a platform device instead, in eci_probe() (eci.c), and pci_dev is NULL.
  */
 struct bus_driver_data {
     /// PCI device
     int dev_id;                             /* PCI device ID */
-    struct pci_dev *pci_dev;                /* Associated PCI device structure */
+    struct pci_dev *pci_dev;                /* Associated PCI device structure; NULL on Enzian (ECI) */
+    struct device *dma_dev;                 /* Device used for the DMA mappings and allocations; the PCI device's, or the ECI platform device's */
+    bool coherent;                          /* Host memory is accessed cache-coherently (ECI); user pages need no DMA mapping or cache maintenance */
     
     // Char devices metadata
     char vfpga_dev_name[MAX_CHAR_FDEV];     /* Template for vFPGA device names; each vFPGA device will have a unique name based on this template */
@@ -1128,6 +1620,8 @@ struct bus_driver_data {
     uint probe_shell;                       /* Shell layer probe */
     int n_fpga_chan;                        /* Number of shell data/command channels */
     int n_fpga_reg;                         /* Number of vFPGA regions */
+    uint64_t shell_ctrl_cnfg;               /* Raw control configuration of the shell; compared on shell reconfiguration, see reload_shell_config */
+    uint64_t shell_mem_cnfg;                /* Raw memory configuration of the shell; compared on shell reconfiguration, see reload_shell_config */
     int en_avx;                             /* Shell is built with AVX support */
     int en_wb;                              /* Shell is built with writeback support */
     int en_strm;                            /* Streaming interfaces from host are enabled */
@@ -1144,6 +1638,9 @@ struct bus_driver_data {
     uint32_t net_ip_addr;                   /* The FPGA's IP address */
     uint64_t net_mac_addr;                  /* The FPGA's MAC address */
     uint64_t eost;                          /* End of start-up time; see coyote_driver.c for details */
+    uint64_t fault_ahead;                   /* Default fault-ahead window, in bytes, mapped past each page fault; see coyote_sysfs.c */
+    uint32_t pingpong_threshold;            /* Ping-pong migrations after which a buffer is migrated by range only, 0 to disable; see vfpga_gup.c */
+    struct pfault_hist pfault_hist;         /* Latency histograms of the page faults; see vfpga_isr.c and coyote_sysfs.c */
 
     /// Pointer to the static layer configuration registers; memory mapped during driver initialization
     volatile struct cyt_stat_cnfg_regs *stat_cnfg;
@@ -1182,6 +1679,16 @@ struct bus_driver_data {
     // Locks
     spinlock_t stat_lock;                    /* Static layer spinlock, ensuring atomic setting of IP and MAC address */
     spinlock_t card_lock;                    /* Card memory spinlock, ensuring atomic allocation of card memory */
+    struct mutex card_init_lock;             /* Serializes the (lazy) creation of the card memory allocators */
+    spinlock_t neigh_lock;                   /* Neighbor table spinlock */
+
+    // Neighbor table; shared by all the vFPGAs, since they share the network stack
+    DECLARE_HASHTABLE(neigh_map, NEIGH_HASH_TABLE_ORDER);
+    uint32_t n_neigh;                        /* Number of entries in the neighbor table */
+
+    // Shared card memory, by handle; shared by all the vFPGAs, since they allocate from the same card memory
+    DECLARE_HASHTABLE(card_shared_map, CARD_SHARED_HASH_TABLE_ORDER);
+    struct mutex card_shared_lock;           /* Protects card_shared_map and the reference counts (taken within user_buff_lock) */
 
     // IRQ
     int msix_enabled;                        /* True if MSI-X interrupts are supported on the target platform */
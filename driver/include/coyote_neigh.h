@@ -0,0 +1,63 @@
+/*
+ * Copyright (c) 2025,  Systems Group, ETH Zurich
+ * All rights reserved.
+ *
+ * This file is part of the Coyote device driver for Linux.
+ * Coyote can be found at: https://github.com/fpgasystems/Coyote
+ *
+ * This source code is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * The full GNU General Public License is included in this distribution in
+ * the file called "COPYING". If not found, a copy of the GNU General Public  
+ * License can be found <https://www.gnu.org/licenses/>.
+ */
+
+
+/**
+ * @file coyote_neigh.h
+ * @brief Neighbor (ARP) table of the FPGA network stack
+ *
+ * The ARP server of the network stack resolves an IP address when it is written to a vFPGA's NET_ARP_REG,
+ * but it doesn't report when the lookup completes; user space waits for a fixed settle time (NEIGH_SETTLE_NS) instead.
+ * The driver keeps track of the addresses looked up, and when, so that each address is looked up once per device,
+ * no matter how many Coyote threads or processes connect to it; later users wait only for the remainder of the settle time, if any.
+ * Addresses can also be looked up ahead of time through sysfs (cyt_attr_neigh), e.g., from the host's ARP table,
+ * in which case the driver writes the ARP register of the first vFPGA itself.
+ * The table is flushed whenever the shell is released, since the ARP server of the new shell starts empty.
+ */
+
+#ifndef _COYOTE_NEIGH_H_
+#define _COYOTE_NEIGH_H_
+
+#include "coyote_defs.h"
+
+/// Initializes the (empty) neighbor table of a device
+void neigh_init(struct bus_driver_data *data);
+
+/// Removes all the entries from the neighbor table
+void neigh_flush(struct bus_driver_data *data);
+
+/**
+ * @brief Looks up an IP address in the neighbor table, adding it if not present
+ *
+ * @param data bus driver data of the device
+ * @param ip_addr IP address to be looked up
+ * @param wait_ns set to the time left until the lookup of the address completes (0 if already completed)
+ * @return 1 if the caller must issue the ARP lookup (the address is then recorded as issued), 0 if already issued, negative on error
+ */
+int neigh_lookup(struct bus_driver_data *data, uint32_t ip_addr, uint64_t *wait_ns);
+
+/// Looks up an address from the driver (sysfs), unless already looked up; returns 0 on success
+int neigh_add(struct bus_driver_data *data, uint32_t ip_addr);
+
+/// Prints the neighbor table to buff, at most size bytes
+ssize_t neigh_print(struct bus_driver_data *data, char *buff, size_t size);
+
+#endif // _COYOTE_NEIGH_H_
@@ -39,6 +39,17 @@
  */
 int read_shell_config(struct bus_driver_data *data);
 
+/**
+ * @brief Re-reads the shell configuration after a shell reconfiguration, if it is compatible with the current one
+ *
+ * Compatible shells have the same number of vFPGAs and channels, the same control (AVX, writeback, TLB) 
+ * and memory configuration, so that the vFPGA devices, their TLB contents and card memory can be kept;
+ * only the remaining options (reconfiguration, networking) are updated
+ *
+ * @return 0 if compatible, -EINVAL otherwise, in which case the driver state is left unchanged
+ */
+int reload_shell_config(struct bus_driver_data *data);
+
 /// Allocates and initializes metadata structs used for managing card memory, if enabled 
 int allocate_card_resources(struct bus_driver_data *data);
 
@@ -66,6 +77,22 @@ void teardown_vfpga_devices(struct bus_driver_data *data);
 /// Frees the allocated vFPGA char devices and unregisters it from the OS; opposite of alloc_vfpga_devices
 void free_vfpga_devices(struct bus_driver_data *data);
 
+/**
+ * @brief Quiesces the vFPGA devices ahead of a shell reconfiguration, without releasing them
+ *
+ * Blocks the registration of Coyote threads and all operations on their buffers, and migrates 
+ * the buffers residing in card memory to the host; the vFPGA interrupts must still be enabled
+ */
+void quiesce_vfpga_devices(struct bus_driver_data *data);
+
+/**
+ * @brief Resumes the vFPGA devices after a shell reconfiguration; opposite of quiesce_vfpga_devices
+ *
+ * @param restore If true, the writeback addresses and the TLB mappings of all the buffers are re-programmed into the new shell; 
+ *                if false, the devices are only unblocked, e.g., so that they can be torn down
+ */
+void resume_vfpga_devices(struct bus_driver_data *data, bool restore);
+
 /// Allocates a char reconfig_device which is used to interact with the static layer for shell reconfiguration
 int alloc_reconfig_device(struct bus_driver_data *data, dev_t device);
 
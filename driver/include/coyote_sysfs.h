@@ -38,6 +38,8 @@
 #define _COYOTE_SYSFS_H_
 
 #include "coyote_defs.h"
+#include "pci_util.h"
+#include "coyote_neigh.h"
 
 /// Get FPGA IP address
 ssize_t cyt_attr_ip_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf);
@@ -57,15 +59,57 @@ ssize_t cyt_attr_eost_show(struct kobject *kobj, struct kobj_attribute *attr, ch
 /// Set PR end of start-up (EOS) time
 ssize_t cyt_attr_eost_store(struct kobject *kobj, struct kobj_attribute *attr, const char *buf, size_t count);
 
+/// Get the default fault-ahead window, in bytes
+ssize_t cyt_attr_fault_ahead_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf);
+
+/// Set the default fault-ahead window, in bytes; applies to all buffers without a per-buffer window
+ssize_t cyt_attr_fault_ahead_store(struct kobject *kobj, struct kobj_attribute *attr, const char *buf, size_t count);
+
+/// Get the ping-pong threshold; the number of successive back-and-forth migrations after which a buffer is migrated by range only
+ssize_t cyt_attr_pingpong_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf);
+
+/// Set the ping-pong threshold; 0 disables splitting, so buffers are always migrated whole
+ssize_t cyt_attr_pingpong_store(struct kobject *kobj, struct kobj_attribute *attr, const char *buf, size_t count);
+
+/// Get the page fault latency histograms (lock wait, pinning, TLB mapping, total), in power-of-two us buckets
+ssize_t cyt_attr_pfault_hist_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf);
+
+/// Clear the page fault latency histograms (any write)
+ssize_t cyt_attr_pfault_hist_store(struct kobject *kobj, struct kobj_attribute *attr, const char *buf, size_t count);
+
+/// Get the CPU (and NUMA node) the interrupt of each vFPGA is pinned to
+ssize_t cyt_attr_irq_affinity_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf);
+
+/// Pin the interrupt of a vFPGA to a CPU; the input is "<vFPGA ID> <CPU>", a CPU of -1 unpins the interrupt
+ssize_t cyt_attr_irq_affinity_store(struct kobject *kobj, struct kobj_attribute *attr, const char *buf, size_t count);
+
+/// Get the host DMA bandwidth share of each vFPGA and the bandwidth it achieved in the last ms, in MB/s
+ssize_t cyt_attr_hdma_share_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf);
+
+/// Set the host DMA bandwidth share of a vFPGA; the input is "<vFPGA ID> <read MB/s> <write MB/s>", 0 is unlimited
+ssize_t cyt_attr_hdma_share_store(struct kobject *kobj, struct kobj_attribute *attr, const char *buf, size_t count);
+
+/// Get the neighbor (ARP) table of the network stack
+ssize_t cyt_attr_neigh_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf);
+
+/// Look up IP addresses (hex, whitespace-separated) ahead of time, or flush the neighbor table ("flush")
+ssize_t cyt_attr_neigh_store(struct kobject *kobj, struct kobj_attribute *attr, const char *buf, size_t count);
+
 /// Get network stats on port QSFP0
 ssize_t cyt_attr_nstats_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf);
 
 /// Get host DMA (XDMA/QDMA) stats: number of commands, completion and data beats
 ssize_t cyt_attr_hstats_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf);
 
+/// Get card memory allocator stats: free memory, largest free contiguous extent and fragmentation fallbacks, per memory block
+ssize_t cyt_attr_memstats_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf);
+
 /// Get partial reconfiguration stats
 ssize_t cyt_attr_prstats_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf);
 
+/// Get the host DMA, reconfiguration and network counters as "key value" lines, for monitoring tools
+ssize_t cyt_attr_metrics_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf);
+
 #ifdef PLATFORM_ULTRASCALE_PLUS
 /// Get XDMA engine stats
 ssize_t cyt_attr_engines_show(struct kobject *kobj, struct kobj_attribute *attr, char *buf);
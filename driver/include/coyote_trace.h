@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2025,  Systems Group, ETH Zurich
+ * All rights reserved.
+ *
+ * This file is part of the Coyote device driver for Linux.
+ * Coyote can be found at: https://github.com/fpgasystems/Coyote
+ *
+ * This source code is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * The full GNU General Public License is included in this distribution in
+ * the file called "COPYING". If not found, a copy of the GNU General Public  
+ * License can be found <https://www.gnu.org/licenses/>.
+ */
+
+/**
+ * @file coyote_trace.h
+ * @brief Tracepoints of the Coyote driver
+ *
+ * The events are in the "coyote" trace system, e.g., /sys/kernel/tracing/events/coyote/coyote_pfault,
+ * and can be consumed with ftrace, perf or eBPF (e.g., bpftrace -e 'tracepoint:coyote:coyote_pfault { ... }')
+ * The tracepoints are defined (CREATE_TRACE_POINTS) in vfpga_isr.c
+ */
+
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM coyote
+
+#if !defined(_COYOTE_TRACE_H_) || defined(TRACE_HEADER_MULTI_READ)
+#define _COYOTE_TRACE_H_
+
+#include <linux/tracepoint.h>
+
+/**
+ * A page fault (TLB miss) raised by a vFPGA, once it has been handled; the times are in ns
+ * lock_ns is the time spent waiting for the vFPGA's mmu_lock, pin_ns the time spent pinning user pages and
+ * map_ns the time spent writing the TLB entries (excluding the lock waits); total_ns covers the whole handler
+ */
+TRACE_EVENT(coyote_pfault,
+    TP_PROTO(int vfid, int ctid, int hpid, u64 vaddr, u64 len, int stream, int wr, 
+             u64 lock_ns, u64 pin_ns, u64 map_ns, u64 total_ns, int ret),
+
+    TP_ARGS(vfid, ctid, hpid, vaddr, len, stream, wr, lock_ns, pin_ns, map_ns, total_ns, ret),
+
+    TP_STRUCT__entry(
+        __field(int, vfid)
+        __field(int, ctid)
+        __field(int, hpid)
+        __field(u64, vaddr)
+        __field(u64, len)
+        __field(int, stream)
+        __field(int, wr)
+        __field(u64, lock_ns)
+        __field(u64, pin_ns)
+        __field(u64, map_ns)
+        __field(u64, total_ns)
+        __field(int, ret)
+    ),
+
+    TP_fast_assign(
+        __entry->vfid = vfid;
+        __entry->ctid = ctid;
+        __entry->hpid = hpid;
+        __entry->vaddr = vaddr;
+        __entry->len = len;
+        __entry->stream = stream;
+        __entry->wr = wr;
+        __entry->lock_ns = lock_ns;
+        __entry->pin_ns = pin_ns;
+        __entry->map_ns = map_ns;
+        __entry->total_ns = total_ns;
+        __entry->ret = ret;
+    ),
+
+    TP_printk("vfid=%d ctid=%d hpid=%d vaddr=0x%llx len=%llu stream=%d wr=%d lock_ns=%llu pin_ns=%llu map_ns=%llu total_ns=%llu ret=%d",
+        __entry->vfid, __entry->ctid, __entry->hpid, __entry->vaddr, __entry->len, __entry->stream, __entry->wr,
+        __entry->lock_ns, __entry->pin_ns, __entry->map_ns, __entry->total_ns, __entry->ret)
+);
+
+#endif // _COYOTE_TRACE_H_
+
+// Out-of-tree module: the header is found through the driver's include path (-I include), see the Makefile
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE coyote_trace
+#include <trace/define_trace.h>
@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2025,  Systems Group, ETH Zurich
+ * All rights reserved.
+ *
+ * This file is part of the Coyote device driver for Linux.
+ * Coyote can be found at: https://github.com/fpgasystems/Coyote
+ *
+ * This source code is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * The full GNU General Public License is included in this distribution in
+ * the file called "COPYING". If not found, a copy of the GNU General Public  
+ * License can be found <https://www.gnu.org/licenses/>.
+ */
+
+
+/**
+ * @file eci.h
+ * @brief Contains functions for loading and setting up the Coyote driver on Enzian, with the FPGA attached over the Enzian Coherent Interconnect (ECI).
+ *
+ * Over ECI, the vFPGAs access host memory cache-coherently; therefore, the user pages are not mapped through the IOMMU, 
+ * nor flushed from the CPU caches, before being placed in the TLBs (see vfpga_gup.c). The FPGA is described to the kernel as 
+ * a platform device (device tree node with the compatible string "ethz,enzian-coyote"), with the following resources:
+ *  - reg: the static layer configuration registers (index 0) and the shell configuration registers (index 1), in the FPGA's I/O space
+ *  - interrupts: one interrupt per vFPGA, in order of the vFPGA IDs
+ * Partial (and shell) reconfiguration is not supported over ECI, since there is no host DMA engine to stream the bitstreams to the ICAP.
+ */
+
+#ifdef PLATFORM_ENZIAN
+
+#ifndef _ECI_H_
+#define _ECI_H_
+
+#include <linux/of.h>
+#include <linux/platform_device.h>
+
+#include "pci_util.h"
+#include "coyote_defs.h"
+#include "coyote_setup.h"
+
+/// Platform device resources holding the static layer and shell configuration registers
+#define ECI_RES_STAT_CONFIG 0
+#define ECI_RES_SHELL_CONFIG 1
+
+/// Assign a unique ID to each Coyote-enabled FPGA and set the unique device name
+void assign_device_id(struct bus_driver_data *data);
+
+//////////////////////////////////////////////
+//                INTERRUPTS               //
+////////////////////////////////////////////  
+
+/**
+ * @brief Sets up the vFPGA IRQs, as described by the platform device's interrupt resources
+ *
+ * @param data Pointer to the bus driver data structure, containing Coyote device information
+ * @param pdev Pointer to the platform device associated with the Coyote device
+ * @return 0 on success, negative error code on failure.
+ */
+int irq_setup(struct bus_driver_data *data, struct platform_device *pdev);
+
+/**
+ * @brief Removes previously set-up IRQs (opposite of irq_setup)
+ *
+ * @param data Pointer to the bus driver data structure, containing Coyote device information
+ */
+void irq_teardown(struct bus_driver_data *data);
+
+//////////////////////////////////////////////
+//                DRIVER                   //
+//////////////////////////////////////////// 
+
+/**
+ * @brief Top-level ECI initialization function for the Coyote driver.
+ *
+ * Called when the platform device is matched; maps the configuration registers,
+ * reads the shell configuration, sets up the card memory resources, the vFPGA char devices and their interrupts.
+ */
+int eci_probe(struct platform_device *pdev);
+
+/**
+ * @brief Top-level ECI device removal function for the Coyote driver
+ *
+ * Opposite of eci_probe; releases the interrupts, vFPGA devices, card memory resources and sysfs entry
+ */
+void eci_remove(struct platform_device *pdev);
+
+/// Top-level entry function, called by coyote_init; registers the ECI platform driver
+int eci_init(void);
+
+/// Top-level exit function, called by coyote_exit; unregisters the ECI platform driver
+void eci_exit(void);
+
+#endif // _ECI_H_
+
+#endif // PLATFORM_ENZIAN
@@ -157,6 +157,16 @@ void invalidate_ctx_reg(struct bus_driver_data *bd_data, int32_t qid, int32_t se
  */
 int enable_queue(struct bus_driver_data *data, int32_t qid, bool c2h, bool is_mm, uint32_t mm_chn);
 
+/**
+ * @brief Writes the function map context of a PCIe function (physical or virtual), i.e. the window of queues it owns
+ *
+ * @param data Pointer to the bus driver data structure, containing Coyote device information
+ * @param func Function ID; 0 for the PF, the routing ID offset for the VFs
+ * @param qbase First queue of the function
+ * @param n_queues Number of queues of the function; 0 clears the context
+ */
+void write_fmap(struct bus_driver_data *data, uint32_t func, uint32_t qbase, uint32_t n_queues);
+
 /**
  * @brief Enable QDMA C2H and H2C queues
  *
@@ -201,6 +211,30 @@ int shell_pci_init(struct bus_driver_data *data);
  */
 void shell_pci_remove(struct bus_driver_data *data);
 
+/**
+ * @brief Disables and removes the vFPGA interrupts ahead of a shell reconfiguration, keeping the vFPGA devices
+ *
+ * Followed by either shell_pci_resume, if the new shell is compatible (see reload_shell_config), or shell_pci_release
+ *
+ * @param data Pointer to the bus driver data structure, containing Coyote device information
+ */
+void shell_pci_quiesce(struct bus_driver_data *data);
+
+/**
+ * @brief Re-enables the vFPGA interrupts of a compatible shell, loaded after shell_pci_quiesce
+ *
+ * @param data Pointer to the bus driver data structure, containing Coyote device information
+ * @return 0 on success, negative error code on failure.
+ */
+int shell_pci_resume(struct bus_driver_data *data);
+
+/**
+ * @brief Releases the vFPGA devices, card memory resources and sysfs entry of a shell quiesced with shell_pci_quiesce
+ *
+ * @param data Pointer to the bus driver data structure, containing Coyote device information
+ */
+void shell_pci_release(struct bus_driver_data *data);
+
 /**
  * @brief Top-level PCI initialization function for the Coyote driver.
  *
@@ -210,6 +244,19 @@ void shell_pci_remove(struct bus_driver_data *data);
  */
 int pci_probe(struct pci_dev *pdev, const struct pci_device_id *id);
 
+/**
+ * @brief Enables or disables the SR-IOV virtual functions; called by the PCI core when writing to sriov_numvfs in sysfs
+ *
+ * Each virtual function exposes one vFPGA (VF i owns vFPGA i) and is given its own window of QDMA queues, 
+ * so that it can be assigned to a guest (e.g., with vfio-pci) and submit and DMA without the hypervisor's involvement.
+ * While a vFPGA is owned by a VF, its host char device can't be opened.
+ *
+ * @param pdev Pointer to the PCI device structure (PF)
+ * @param num_vfs Number of virtual functions to enable, at most the number of vFPGAs; 0 to disable them
+ * @return Number of enabled virtual functions on success, negative error code on failure
+ */
+int pci_sriov_configure(struct pci_dev *pdev, int num_vfs);
+
 /**
  * @brief Top-level PCI device removal function for the Coyote driver
  *
@@ -62,5 +62,24 @@ bool msix_capable(struct pci_dev *pdev);
  */
 uint32_t build_vector_reg(uint32_t a, uint32_t b, uint32_t c, uint32_t d);
 
+/**
+ * @brief Pins the interrupt of a vFPGA to a CPU (affinity and hint), as well as its page fault and notification work (to the CPU's node)
+ *
+ * Called for each vFPGA by irq_setup, according to the irq_affinity policy; with IRQ_AFFINITY_SPREAD (and IRQ_AFFINITY_FOLLOW), 
+ * the vFPGAs are assigned to the CPUs of the device's NUMA node round-robin (cpumask_local_spread). 
+ * irqbalance and user-space can still override the affinity.
+ *
+ * @param device vFPGA device; its IRQ must have been requested
+ * @param cpu Target CPU; -1 clears the affinity hint and unpins the work
+ * @return 0 on success, negative error code on failure
+ */
+int vfpga_set_irq_affinity(struct vfpga_dev *device, int cpu);
+
+/**
+ * @brief Clears the affinity hint of an interrupt; must be called before the interrupt is freed
+ *
+ * @param vector IRQ number
+ */
+void irq_clear_affinity(uint32_t vector);
 
 #endif // _PCI_UTIL_H_
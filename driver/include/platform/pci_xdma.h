@@ -295,6 +295,30 @@ int shell_pci_init(struct bus_driver_data *data);
  */
 void shell_pci_remove(struct bus_driver_data *data);
 
+/**
+ * @brief Disables and removes the vFPGA interrupts ahead of a shell reconfiguration, keeping the vFPGA devices
+ *
+ * Followed by either shell_pci_resume, if the new shell is compatible (see reload_shell_config), or shell_pci_release
+ *
+ * @param data Pointer to the bus driver data structure, containing Coyote device information
+ */
+void shell_pci_quiesce(struct bus_driver_data *data);
+
+/**
+ * @brief Re-enables the vFPGA interrupts of a compatible shell, loaded after shell_pci_quiesce
+ *
+ * @param data Pointer to the bus driver data structure, containing Coyote device information
+ * @return 0 on success, negative error code on failure.
+ */
+int shell_pci_resume(struct bus_driver_data *data);
+
+/**
+ * @brief Releases the vFPGA devices, card memory resources and sysfs entry of a shell quiesced with shell_pci_quiesce
+ *
+ * @param data Pointer to the bus driver data structure, containing Coyote device information
+ */
+void shell_pci_release(struct bus_driver_data *data);
+
 /**
  * @brief Top-level PCI initialization function for the Coyote driver.
  *
@@ -41,4 +41,54 @@
  */
 int reconfigure_start(struct reconfig_dev *device, uint64_t vaddr, uint64_t len, pid_t pid, uint32_t crid);
 
+/**
+ * @brief Waits until the reconfiguration started by reconfigure_start completes (reconfiguration IRQ)
+ * 
+ * Records the duration and the achieved configuration bandwidth, which paces the descriptor writes of the next reconfiguration
+ * and is reported in sysfs (cyt_attr_prstats)
+ *
+ * @param device reconfig_device being reconfigured
+ */
+void reconfigure_wait(struct reconfig_dev *device);
+
+/**
+ * @brief Waits until the ICAP is granted to the caller
+ *
+ * The ICAP is the only configuration port, so reconfigurations are serialized; they are granted the ICAP in the order they
+ * request it (ticket queue), so no region is starved by the reconfigurations of the others
+ *
+ * @param device reconfig_device whose ICAP is requested
+ */
+void icap_acquire(struct reconfig_dev *device);
+
+/**
+ * @brief Releases the ICAP, granting it to the next queued reconfiguration
+ *
+ * @param device reconfig_device whose ICAP is released
+ */
+void icap_release(struct reconfig_dev *device);
+
+/**
+ * @brief Reconfigures a vFPGA: decouples it, loads the partial bitstream, waits until completion and couples it again
+ *
+ * Blocks until the reconfiguration completes; reconfigurations of the same vFPGA are serialized (region_lock),
+ * while those of different vFPGAs only queue for the ICAP (icap_acquire)
+ * 
+ * @param device reconfig_device to be reconfigured
+ * @param vaddr bitstream buffer virtual address; obtained from alloc_buffer and mmap
+ * @param len bitstream length, in bytes
+ * @param pid host process ID
+ * @param crid configuration ID 
+ * @param vfid vFPGA to reconfigure
+ * @return 0 on success, negative on failure
+ */
+int reconfigure_app(struct reconfig_dev *device, uint64_t vaddr, uint64_t len, pid_t pid, uint32_t crid, uint32_t vfid);
+
+/**
+ * @brief Work function of an asynchronous app reconfiguration (struct reconfig_async)
+ *
+ * Executes reconfigure_app, stores its return value and signals the request's eventfd
+ */
+void reconfigure_app_work(struct work_struct *work);
+
 #endif // _RECONFIG_HW_H_
\ No newline at end of file
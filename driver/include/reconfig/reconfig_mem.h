@@ -46,6 +46,18 @@
  */
 int alloc_reconfig_buffer(struct reconfig_dev *device, unsigned long n_pages, pid_t pid, uint32_t crid);
 
+/**
+ * @brief Maps the buffer allocated by the calling process (alloc_reconfig_buffer) to user-space
+ *
+ * The buffer is then moved to the table of mapped buffers (reconfig_buffs_map), where it's found by its virtual address
+ *
+ * @param device reconfig_device for which the bitstream buffer was allocated
+ * @param vma user-space virtual memory area to map the buffer to
+ * @param vaddr buffer virtual address, aligned to RECONFIG_BUFF_PAGE_SIZE and within vma
+ * @return 0 on success, negative on failure (e.g., no buffer was allocated by the calling process)
+ */
+int map_reconfig_buffer(struct reconfig_dev *device, struct vm_area_struct *vma, uint64_t vaddr);
+
 /**
  * @brief De-allocates host-side, kernel-space reconfiguration buffer
  *
@@ -59,4 +71,43 @@ int alloc_reconfig_buffer(struct reconfig_dev *device, unsigned long n_pages, pi
  */
 int free_reconfig_buffer(struct reconfig_dev *device, uint64_t vaddr, pid_t pid, uint32_t crid);
 
+/**
+ * @brief Adds a bitstream to the bitstream cache
+ *
+ * The bitstream, loaded into a buffer of the calling process, is copied into pages owned by the cache
+ * and its hash is verified; other processes can then find it by the hash (get_reconfig_cache) instead of loading it.
+ * If needed, cached bitstreams which are not mapped by any process are evicted in LRU order to make room.
+ *
+ * @param device reconfig_device for which the bitstream buffer was allocated
+ * @param vaddr virtual address of the buffer holding the bitstream
+ * @param len bitstream length, in bytes
+ * @param pid host process ID
+ * @param crid configuration ID
+ * @param hash hash of the bitstream contents, as computed in user-space (cRcnfg.cpp)
+ * @return 0 if the bitstream is cached (including when it already was), negative on failure (e.g., hash mismatch or cache full)
+ */
+int add_reconfig_cache(struct reconfig_dev *device, uint64_t vaddr, uint64_t len, pid_t pid, uint32_t crid, uint64_t hash);
+
+/**
+ * @brief Looks up a bitstream in the bitstream cache
+ *
+ * On a hit, a buffer sharing the pages of the cached bitstream is allocated for the calling process, 
+ * the same way as with alloc_reconfig_buffer; it's then mapped (read-only) with mmap and released with free_reconfig_buffer.
+ *
+ * @param device reconfig_device to look up the bitstream for
+ * @param hash hash of the bitstream contents
+ * @param len bitstream length, in bytes
+ * @param pid host process ID
+ * @param crid configuration ID
+ * @return number of pages of the cached bitstream, 0 if it isn't cached and negative on failure
+ */
+int get_reconfig_cache(struct reconfig_dev *device, uint64_t hash, uint64_t len, pid_t pid, uint32_t crid);
+
+/**
+ * @brief Frees all the bitstreams in the bitstream cache; to be used when the reconfiguration device is removed
+ *
+ * @param device reconfig_device whose cache should be freed
+ */
+void free_reconfig_cache(struct reconfig_dev *device);
+
 #endif // _RECONFIG_MEM_H_
\ No newline at end of file
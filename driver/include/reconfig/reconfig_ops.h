@@ -35,6 +35,10 @@
 #include "pci_xdma.h"
 #endif
 
+#ifdef PLATFORM_ENZIAN
+#include "eci.h"
+#endif
+
 #include "coyote_defs.h"
 #include "reconfig_hw.h"
 #include "reconfig_isr.h"
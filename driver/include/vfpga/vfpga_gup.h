@@ -28,7 +28,7 @@
  * NOTE: GUP stands for "Get User Pages", which is a Linux kernel mechanism to pin user-space pages in memory and Coyote swaps the pages between host and card.
  * NOTE: Previously (currently in LEGACY), there was an alternative memory management mechanism, using Linux's Hetereogeneous Memory Management (HMM) framework.
  *
- * The mapped user pages are stored in a hash_table, called user_buff_map
+ * The mapped user pages are stored in an interval tree (per vFPGA and Coyote thread), called user_buff_map
  * Functions in this file implement high-level logic for managing Coyote memory
  * And call functions in vfpga_hw.h that handle the low-level logic by writing to the memory-mapped registers in the FPGA
  * Additionally, this file provides functions for peer-to-peer DMA Buffer management, enabling direct FPGA-GPU communication.
@@ -56,9 +56,46 @@
  * @param stream Access type: HOST (1) or CARD (0)
  * @param hpid Host process ID
  * @param mem_block Target memory block for card memory; only applicable to Versal devices
+ * @param mem_stripe Number of memory blocks the card memory is interleaved across (1 to disable); only applicable to Versal devices without block memory
+ * @param flags Mapping flags, see MAP_USER_RESIDENT and the access hints (MAP_USER_READ_ONLY, MAP_USER_WRITE_ONLY); 0 for page faults
  * @return 0 on success, negative error code on failure
  */
-int mmu_handler_gup(struct vfpga_dev *device, uint64_t vaddr, uint64_t len, int32_t ctid, int32_t stream, pid_t hpid, int32_t mem_block);
+int mmu_handler_gup(struct vfpga_dev *device, uint64_t vaddr, uint64_t len, int32_t ctid, int32_t stream, pid_t hpid, int32_t mem_block, uint32_t mem_stripe, uint32_t flags);
+
+/**
+ * @brief Pins and maps a complete user buffer into the vFPGA's TLB
+ *
+ * The buffer is split into one chunk per VMA and all of them are mapped, so that
+ * subsequent accesses to the buffer never raise a page fault. Chunks are also split at the
+ * buffers already pinned in the range, which are re-used; only the remaining gaps are pinned.
+ * Used for explicit mappings (IOCTL_MAP_USER_MEM, IOCTL_BATCH_USER_MEM) and prefaulting.
+ *
+ * @param device vFPGA char device
+ * @param vaddr Buffer virtual address
+ * @param len Length, in bytes, of the buffer
+ * @param ctid Coyote thread ID
+ * @param stream Access type: HOST (1) or CARD (0)
+ * @param hpid Host process ID
+ * @param mem_block Target memory block for card memory; only applicable to Versal devices
+ * @param mem_stripe Number of memory blocks the card memory is interleaved across (1 to disable); only applicable to Versal devices without block memory
+ * @param flags Mapping flags, see MAP_USER_RESIDENT and the access hints (MAP_USER_READ_ONLY, MAP_USER_WRITE_ONLY)
+ * @return 0 on success, negative error code on failure
+ */
+int mmu_map_range_gup(struct vfpga_dev *device, uint64_t vaddr, uint64_t len, int32_t ctid, int32_t stream, pid_t hpid, int32_t mem_block, uint32_t mem_stripe, uint32_t flags);
+
+/**
+ * @brief Sets the fault-ahead window of a mapped buffer
+ *
+ * On a page fault inside the buffer, the window following the faulting range 
+ * is pinned and mapped as well (capped to the VMA)
+ *
+ * @param device vFPGA char device
+ * @param vaddr Starting virtual address of the buffer
+ * @param ctid Coyote thread ID
+ * @param window Fault-ahead window, in bytes; FAULT_AHEAD_DEFAULT to use the device-wide window
+ * @return 0 on success, negative error code if no such buffer is mapped
+ */
+int set_fault_ahead(struct vfpga_dev *device, uint64_t vaddr, int32_t ctid, int64_t window);
 
 /**
  * @brief Checks if a mapping is already present in the user buffer map
@@ -72,6 +109,8 @@ struct user_pages* map_present(struct vfpga_dev *device, struct pf_aligned_desc
 /**
  * @brief Creates a TLB mapping for the given user pages
  *
+ * All the pages in the page fault descriptor are mapped, in bursts of MAX_N_MAP_PAGES TLB entries
+ *
  * @param device vFPGA char device
  * @param pf_desc Aligned page fault descriptor; holds info about virtual address, length etc.
  * @param user_pg User pages structure
@@ -88,6 +127,18 @@ void tlb_map_gup(struct vfpga_dev *device, struct pf_aligned_desc *pf_desc, stru
  */
 void tlb_unmap_gup(struct vfpga_dev *device, struct user_pages *user_pg, pid_t hpid);
 
+/**
+ * @brief Removes the TLB mappings of all the buffers of a Coyote thread
+ *
+ * Equivalent to calling tlb_unmap_gup for every buffer of the Coyote thread, but issues
+ * a single invalidation per buffer and waits only once for the whole Coyote thread
+ *
+ * @param device vFPGA char device
+ * @param ctid Coyote thread ID
+ * @param hpid Host process ID
+ */
+void tlb_unmap_gup_ctid(struct vfpga_dev *device, int32_t ctid, pid_t hpid);
+
 /**
  * @brief Pins user pages and prepares them for TLB mapping
  *
@@ -105,9 +156,11 @@ void tlb_unmap_gup(struct vfpga_dev *device, struct user_pages *user_pg, pid_t h
  * @param curr_task Current task structure
  * @param curr_mm Current memory management structure
  * @param mem_block Target memory block for card memory; only applicable to Versal devices
+ * @param mem_stripe Number of memory blocks the card memory is interleaved across (1 to disable); only applicable to Versal devices without block memory
+ * @param flags Mapping flags, see MAP_USER_RESIDENT and the access hints (MAP_USER_READ_ONLY, MAP_USER_WRITE_ONLY)
  * @return Pointer to the user_pages structure on success, NULL on failure
  */
-struct user_pages* tlb_get_user_pages(struct vfpga_dev *device, struct pf_aligned_desc *pf_desc, pid_t hpid, struct task_struct *curr_task, struct mm_struct *curr_mm, int32_t mem_block);
+struct user_pages* tlb_get_user_pages(struct vfpga_dev *device, struct pf_aligned_desc *pf_desc, pid_t hpid, struct task_struct *curr_task, struct mm_struct *curr_mm, int32_t mem_block, uint32_t mem_stripe, uint32_t flags);
 
 /**
  * @brief Releases user pages and removes their TLB mappings.
@@ -121,6 +174,22 @@ struct user_pages* tlb_get_user_pages(struct vfpga_dev *device, struct pf_aligne
  */
 int tlb_put_user_pages(struct vfpga_dev *device, uint64_t vaddr, int32_t ctid, pid_t hpid, int dirtied);
 
+/**
+ * @brief Releases multiple buffers and removes their TLB mappings, with a single TLB invalidation wait
+ *
+ * Same as calling tlb_put_user_pages for each address, but all the TLB entries are cleared first,
+ * and the invalidations of all the buffers are completed with one interrupt, instead of one per buffer
+ *
+ * @param device vFPGA char device
+ * @param vaddrs Starting virtual addresses of the buffers
+ * @param n_vaddrs Number of addresses
+ * @param ctid Coyote thread ID for which the pages were mapped
+ * @param hpid Host process ID for which the pages were mapped
+ * @param dirtied Indicates if the pages were modified
+ * @return 0 on success, negative error code on failure
+ */
+int tlb_put_user_pages_batch(struct vfpga_dev *device, uint64_t *vaddrs, uint32_t n_vaddrs, int32_t ctid, pid_t hpid, int dirtied);
+
 /**
  * @brief Releases all user pages for a given Coyote thread
  *
@@ -132,6 +201,28 @@ int tlb_put_user_pages(struct vfpga_dev *device, uint64_t vaddr, int32_t ctid, p
  */
 int tlb_put_user_pages_ctid(struct vfpga_dev *device, int32_t ctid, pid_t hpid, int dirtied);
 
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 10, 0)
+/**
+ * @brief MMU notifier callback, invalidates a lazily unpinned buffer (see en_lazy_unpin)
+ *
+ * Clears the buffer's TLB entries and schedules its release via user_pg_release_work;
+ * called by the kernel whenever the buffer's virtual address range changes (e.g., munmap, process exit)
+ *
+ * @param mni MMU interval notifier of the buffer
+ * @param range Virtual address range being invalidated
+ * @param cur_seq Current notifier sequence number
+ * @return true if the invalidation was handled, false if the invalidation can't block
+ */
+bool user_pg_invalidate(struct mmu_interval_notifier *mni, const struct mmu_notifier_range *range, unsigned long cur_seq);
+
+/**
+ * @brief Worker, removes the MMU notifier of an invalidated buffer and releases its pages
+ *
+ * @param work work_release of the buffer
+ */
+void user_pg_release_work(struct work_struct *work);
+#endif
+
 /**
  * @brief Helper function, migrates user pages to card memory
  *
@@ -148,6 +239,26 @@ void migrate_to_card(struct vfpga_dev *device, struct user_pages *user_pg);
  */
 void migrate_to_host(struct vfpga_dev *device, struct user_pages *user_pg);
 
+/**
+ * @brief Migrates all the buffers of a Coyote thread to the host memory, ahead of a shell reconfiguration
+ *
+ * The buffers keep their card memory, but their card copy is no longer valid; the TLB entries
+ * are not touched, since the TLBs are re-programmed with tlb_restore_gup once the new shell is up
+ *
+ * @param device vFPGA char device
+ * @param ctid Coyote thread ID; the caller must hold its user_buff_lock
+ */
+void tlb_evacuate_gup(struct vfpga_dev *device, int32_t ctid);
+
+/**
+ * @brief Re-creates the TLB mappings of all the buffers of a Coyote thread, after a shell reconfiguration
+ *
+ * @param device vFPGA char device
+ * @param ctid Coyote thread ID; the caller must hold its user_buff_lock
+ * @param hpid Host process ID
+ */
+void tlb_restore_gup(struct vfpga_dev *device, int32_t ctid, pid_t hpid);
+
 /**
  * @brief Trigger off-load operation; moving pages from host to card & updating mappings
  *
@@ -155,9 +266,13 @@ void migrate_to_host(struct vfpga_dev *device, struct user_pages *user_pg);
  * @param vaddr Starting virtual address of the buffer to be offloaded
  * @param len Length, in bytes, of the buffer to be offloaded
  * @param ctid Coyote thread ID
+ * @param host_clean Set if the host copy of the buffer was not written since the last sync/off-load; 
+ *                   in that case, a still valid card copy is re-used instead of copying the buffer again
  * @return 0 on success, negative error code on failure
+ *
+ * @note If the card memory runs out, the card memory of the least recently used buffers residing on the host is evicted
  */
-int offload_user_pages(struct vfpga_dev *device, uint64_t vaddr, uint32_t len, int32_t ctid);
+int offload_user_pages(struct vfpga_dev *device, uint64_t vaddr, uint32_t len, int32_t ctid, bool host_clean);
 
 /**
  * @brief Trigger sync operation; moving pages from card to host & updating mappings
@@ -170,16 +285,124 @@ int offload_user_pages(struct vfpga_dev *device, uint64_t vaddr, uint32_t len, i
  */
 int sync_user_pages(struct vfpga_dev *device, uint64_t vaddr, uint32_t len, int32_t ctid);
 
+/**
+ * @brief Maps a card-only buffer; card memory is allocated and mapped to the TLB, without any host pages backing the buffer
+ *
+ * The virtual address range only needs to be reserved in the process (e.g., mmap with PROT_NONE); it is never accessed by the driver.
+ * Large TLB entries are used if the range is aligned to the large TLB page size. The buffer is released with tlb_put_user_pages
+ *
+ * @param device vFPGA char device
+ * @param vaddr Starting virtual address of the buffer
+ * @param len Length, in bytes, of the buffer
+ * @param ctid Coyote thread ID
+ * @param hpid Host process ID
+ * @param mem_block Target memory block for card memory; only applicable to Versal devices
+ * @param mem_stripe Number of memory blocks the card memory is striped across; only applicable to Versal devices
+ * @return 0 on success, negative error code on failure
+ */
+int tlb_get_card_pages(struct vfpga_dev *device, uint64_t vaddr, uint64_t len, int32_t ctid, pid_t hpid, int32_t mem_block, uint32_t mem_stripe);
+
+/**
+ * @brief Shares the card memory of a card-only buffer, so that other Coyote threads (of any process or vFPGA) on the card can attach to it
+ *
+ * @param device vFPGA char device
+ * @param vaddr Starting virtual address of the card-only buffer
+ * @param ctid Coyote thread ID
+ * @param handle Set to the handle by which the card memory can be attached (the same one, if already shared)
+ * @return 0 on success, negative error code on failure
+ */
+int share_card_pages(struct vfpga_dev *device, uint64_t vaddr, int32_t ctid, uint64_t *handle);
+
+/**
+ * @brief Maps shared card memory as a card-only buffer of a Coyote thread; the card memory is released with its last mapping
+ *
+ * @param device vFPGA char device
+ * @param handle Handle of the shared card memory, as returned by share_card_pages
+ * @param vaddr Starting virtual address of a reserved range; aligned to the large TLB pages if the card memory uses huge pages. If 0, only len is returned
+ * @param ctid Coyote thread ID
+ * @param hpid Host process ID
+ * @param len Set to the size of the shared card memory, in bytes
+ * @return 0 on success, negative error code on failure
+ */
+int attach_card_pages(struct vfpga_dev *device, uint64_t handle, uint64_t vaddr, int32_t ctid, pid_t hpid, uint64_t *len);
+
+/**
+ * @brief Makes the card memory of a card-only buffer persistent under a name; it then outlives all its mappings (e.g., a process restart)
+ *
+ * @param device vFPGA char device
+ * @param vaddr Starting virtual address of the card-only buffer
+ * @param ctid Coyote thread ID
+ * @param name Name of the persistent card memory, unique on the card
+ * @param handle Set to the handle by which the card memory can be attached
+ * @return 0 on success, negative error code on failure (-EEXIST if the name is taken)
+ */
+int persist_card_pages(struct vfpga_dev *device, uint64_t vaddr, int32_t ctid, const char *name, uint64_t *handle);
+
+/**
+ * @brief Looks up persistent card memory by name
+ *
+ * @param device vFPGA char device
+ * @param name Name of the persistent card memory
+ * @param handle Set to the handle by which the card memory can be attached, with attach_card_pages
+ * @return 0 on success, -ENOENT if there is no persistent card memory with the name
+ */
+int lookup_card_pages(struct vfpga_dev *device, const char *name, uint64_t *handle);
+
+/**
+ * @brief Drops the persistence of named card memory; it is released now, or with its last mapping
+ *
+ * @param device vFPGA char device
+ * @param name Name of the persistent card memory
+ * @return 0 on success, -ENOENT if there is no persistent card memory with the name
+ */
+int unpersist_card_pages(struct vfpga_dev *device, const char *name);
+
+/**
+ * @brief Releases all the persistent card memory of the card; called when the vFPGA devices are torn down
+ *
+ * @param bd_data Bus driver data of the card
+ */
+void release_persistent_card_pages(struct bus_driver_data *bd_data);
+
+/**
+ * @brief Copies between a card-only buffer and a mapped host buffer, with the shell's off-load (dst = CARD_ACCESS) or sync (dst = HOST_ACCESS) engine
+ *
+ * @param device vFPGA char device
+ * @param card_vaddr Virtual address in the card-only buffer; page-aligned
+ * @param host_vaddr Virtual address in the host buffer, which must be mapped and reside on the host; page-aligned
+ * @param len Length, in bytes, of the copy; a multiple of the page size
+ * @param ctid Coyote thread ID
+ * @param dst Destination of the copy, CARD_ACCESS or HOST_ACCESS
+ * @return 0 on success, negative error code on failure
+ */
+int copy_card_pages(struct vfpga_dev *device, uint64_t card_vaddr, uint64_t host_vaddr, uint64_t len, int32_t ctid, int32_t dst);
+
 /**
  * @brief Callback for handling page movement notifications in peer-to-peer DMA
  *
- * To manage page movements in GPU memory, this routines deletes TLB entries and retrieves new entries
+ * Called by the exporter (with the dmabuf's reservation lock held) before it moves the buffer; the new placement is 
+ * mapped straight away and compared with the current one. If no page moved, the TLB is left untouched; otherwise, 
+ * the buffer's TLB entries are invalidated and the new ones are only written on the next page fault in the buffer 
+ * (p2p_revalidate_dma_buf), once the move completed, rather than tearing down and re-creating the whole attachment.
  * It is passed as a parameter to the dma_buf_attach_ops struct, which is used when attaching the DMA Buffer
  *
  * @param attach DMA buffer attachment structure
  */
 void p2p_move_notify(struct dma_buf_attachment *attach);
 
+/**
+ * @brief Re-validates the TLB mapping of a DMA buffer, on a page fault in the buffer
+ *
+ * Waits for the exporter's pending move (the kernel fences of the reservation object) and maps the whole buffer
+ * to the TLB at its current placement, so a moved buffer takes a single page fault. Called by mmu_handler_gup.
+ *
+ * @param device vFPGA device
+ * @param user_pg Mapping of the DMA buffer
+ * @param hpid Host process ID
+ * @return 0 on success, negative error code on failure
+ */
+int p2p_revalidate_dma_buf(struct vfpga_dev *device, struct user_pages *user_pg, pid_t hpid);
+
 /**
  * @brief Attaches a DMA buffer to the vFPGA
  *
@@ -219,4 +442,17 @@ int p2p_attach_dma_buf(struct vfpga_dev *device, int buf_fd, uint64_t vaddr, int
  */
 int p2p_detach_dma_buf(struct vfpga_dev *device, uint64_t vaddr, int32_t ctid, int dirtied);
 
+/**
+ * @brief Exports the vFPGA's peer-to-peer window as a DMA Buffer
+ *
+ * The window is the vFPGA's user control region (axi_ctrl) in the shell BAR; it is the only region of a vFPGA that 
+ * is backed by a BAR, as card memory and streams are not exposed over PCIe. A vFPGA on another card imports the
+ * DMA Buffer with p2p_attach_dma_buf and then writes to (or reads from) the window directly, without host memory.
+ * The window is mapped for each importer with dma_map_resource, so that it is also reachable behind an IOMMU.
+ *
+ * @param device vFPGA char device
+ * @return File descriptor of the DMA Buffer on success, negative error code on failure
+ */
+int p2p_export_dma_buf(struct vfpga_dev *device);
+
 #endif // _VFPGA_GUP_H_
@@ -93,6 +93,19 @@ void restart_mmu(struct vfpga_dev *device, bool write, int32_t ctid);
  */
 void invalidate_tlb_entry(struct vfpga_dev *device, uint64_t vaddr, uint32_t n_pages, int32_t hpid, bool last);
 
+/**
+ * @brief Invalidate a contiguous range of TLB entries
+ *
+ * Issues as few invalidations as possible (one per MAX_N_INVLDT_PAGES), instead of one per page
+ *
+ * @param device vFPGA char device
+ * @param vaddr starting virtual address of the range to be invalidated, in pages
+ * @param n_pages number of consecutive pages to be invalidated
+ * @param hpid host process ID
+ * @param last is this the last range of the invalidation; the completion IRQ is only raised for the last one
+ */
+void invalidate_tlb_range(struct vfpga_dev *device, uint64_t vaddr, uint64_t n_pages, int32_t hpid, bool last);
+
 /**
  * @brief Locks or unlocks the TLB, potentially prevent new entries (if locked)
  *
@@ -100,6 +113,23 @@ void invalidate_tlb_entry(struct vfpga_dev *device, uint64_t vaddr, uint32_t n_p
  */
 void change_tlb_lock(struct vfpga_dev *device);
 
+/**
+ * @brief Locks the TLB for a user-space MMU request (map, unmap etc.)
+ *
+ * Requests from different Coyote threads can overlap, so the hardware lock is 
+ * only toggled by the first request and released by the last one (see unlock_tlb)
+ *
+ * @param device vFPGA char device
+ */
+void lock_tlb(struct vfpga_dev *device);
+
+/**
+ * @brief Releases the TLB lock taken by lock_tlb
+ *
+ * @param device vFPGA char device
+ */
+void unlock_tlb(struct vfpga_dev *device);
+
 /**
  * @brief Create a TLB mapping
  *
@@ -134,8 +164,9 @@ void create_tlb_unmapping(struct vfpga_dev *device, struct tlb_metadata *tlb_met
  * @param card_address - target virtual address on the card 
  * @param n_pages - number of pages in the buffer to be off-loaded
  * @param huge - whether the buffer is using hugepages or regular pages
+ * @return number of DMA descriptors issued; physically contiguous pages are coalesced into one descriptor
  */
-void trigger_dma_offload(struct vfpga_dev *device, uint64_t *host_address, uint64_t *card_address, uint32_t n_pages, bool huge);
+int trigger_dma_offload(struct vfpga_dev *device, uint64_t *host_address, uint64_t *card_address, uint32_t n_pages, bool huge);
 
 /**
  * @brief Triggers DMA sync from card memory to host memory (asynchronous)
@@ -145,8 +176,9 @@ void trigger_dma_offload(struct vfpga_dev *device, uint64_t *host_address, uint6
  * @param card_address - virtual address of the buffer on the card 
  * @param n_pages - number of pages in the buffer to be synced
  * @param huge - whether the buffer is using hugepages or regular pages
+ * @return number of DMA descriptors issued; physically contiguous pages are coalesced into one descriptor
  */
-void trigger_dma_sync(struct vfpga_dev *device, uint64_t *host_address, uint64_t *card_address, uint32_t n_pages, bool huge);
+int trigger_dma_sync(struct vfpga_dev *device, uint64_t *host_address, uint64_t *card_address, uint32_t n_pages, bool huge);
 
 /**
  * @brief Allocates memory on the card's HBM or DDR memory and updates the card_physical_address parameter with the allocated addresses
@@ -155,11 +187,13 @@ void trigger_dma_sync(struct vfpga_dev *device, uint64_t *host_address, uint64_t
  * @param card_physical_address initially null/empty, set by the function to reflect the physical address of the allocated pages
  * @param n_pages number of pages to be allocated
  * @param huge whether the memory is using hugepages or regular pages
- * @param mem_block Target memory block; only applicable to Versal devices with fine-grained memory allocation
- *          If -1, driver automatically selects the next free block
+ * @param mem_blocks Target memory blocks; only applicable to Versal devices with fine-grained memory allocation
+ *          A single block of -1 lets the driver automatically select the next free block
+ *          With more than one block, the buffer is interleaved (striped) across the blocks, one (huge) page at a time
+ * @param n_blocks Number of entries in mem_blocks
  * @return whether the allocation was successful; can fail if there is insufficient space on the card
  */
-int alloc_card_memory(struct vfpga_dev *device, uint64_t *card_physical_address, uint32_t n_pages, bool huge, int32_t mem_block);
+int alloc_card_memory(struct vfpga_dev *device, uint64_t *card_physical_address, uint32_t n_pages, bool huge, const int32_t *mem_blocks, uint32_t n_blocks);
 
 /**
  * @brief Release memory on the card; opposite of the above alloc_card_memory function
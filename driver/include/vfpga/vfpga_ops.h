@@ -21,7 +21,7 @@
 
 /**
  * @file vfpga_ops.h
- * @brief Standard device operations for the vfpga_dev char device: open, release, ioctl and memory map (mmap)
+ * @brief Standard device operations for the vfpga_dev char device: open, release, ioctl, io_uring commands and memory map (mmap)
  */
 
 #ifndef _VFPGA_OPS_H_
@@ -29,6 +29,7 @@
 
 #include "coyote_setup.h"
 #include "coyote_defs.h"
+#include "pci_util.h"
 #include "vfpga_isr.h"
 #include "vfpga_uisr.h"
 
@@ -41,6 +42,11 @@ int vfpga_dev_release(struct inode *inode, struct file *file);
 /// vfpga_dev IOCTL calls
 long vfpga_dev_ioctl(struct file *file, unsigned int cmd, unsigned long arg);
 
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 19, 0)
+/// vfpga_dev io_uring commands; a subset of the IOCTL calls, submitted as IORING_OP_URING_CMD
+int vfpga_dev_uring_cmd(struct io_uring_cmd *ioucmd, unsigned int issue_flags);
+#endif
+
 /// vfpga_dev memory map; maps user control region, vFPGA config and writeback regions
 int vfpga_dev_mmap(struct file *file, struct vm_area_struct *vma);
 
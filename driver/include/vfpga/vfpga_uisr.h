@@ -33,6 +33,16 @@
  * In Coyote, an eventfd is created from the user-space and registered by the driver using the method vfpga_register_eventfd
  * Then, when an interrupt from the FPGA is picked up by the driver (see vfpga_isr.c), the driver writes to the appropariate eventfd
  * The user-space software polls on the same eventfd, and, when a change is detected, executes the appropriate callback (see sw/bThread.cpp)
+ *
+ * At high notification rates, a workqueue item, an eventfd wake-up and two IOCTLs per notification are costly; therefore 
+ * a Coyote thread can switch to one of two ring-based modes (IOCTL_SET_NOTIFY_MODE), where the ISR pushes the values to a
+ * per-thread ring, which is memory mapped to the user space (MMAP_NOTIFY):
+ *  - NOTIFY_MODE_COALESCED: the eventfd is only signalled if the user space armed the ring before waiting, so one wake-up covers a batch of values
+ *  - NOTIFY_MODE_POLL: the eventfd is never signalled; the user space polls the ring
+ *
+ * In the default (eventfd) mode, a notification is signalled directly from the ISR if the previous one of the same thread was 
+ * already acknowledged (IOCTL_SET_NOTIFICATION_PROCESSED); only notifications arriving while one is being processed go through 
+ * the workqueue, which waits for the acknowledgement, so that the values are delivered one by one and in order
  */
 
 #ifndef _VFPGA_UISR_H_
@@ -58,4 +68,44 @@ int vfpga_register_eventfd(struct vfpga_dev *device, int ctid, int eventfd);
  */
 void vfpga_unregister_eventfd(struct vfpga_dev *device, int ctid);
 
+/**
+ * @brief Sets the notification delivery mode of a Coyote thread and resets its ring; allocates the vFPGA's notification rings, if needed
+ *
+ * @param device vfpga_dev of the Coyote thread
+ * @param ctid Coyote thread ID
+ * @param mode One of NOTIFY_MODE_EVENTFD, NOTIFY_MODE_COALESCED and NOTIFY_MODE_POLL
+ * @return 0 on success, negative error code otherwise
+ */
+int vfpga_set_notify_mode(struct vfpga_dev *device, int ctid, int32_t mode);
+
+/// Signals (increments) an eventfd; safe in interrupt context. Returns 1 on success
+int vfpga_signal_eventfd(struct eventfd_ctx *ctx);
+
+/**
+ * @brief Signals a notification through the eventfd directly, if no other notification of the Coyote thread is unacknowledged or queued; 
+ * called from the ISR, with irq_lock held. Otherwise, the notification is counted as queued, and must be passed to the workqueue
+ *
+ * @param device vfpga_dev which issued the notification
+ * @param ctid Coyote thread ID of the notification
+ * @param value Notification value
+ * @return true if the notification was signalled (or dropped, if the eventfd couldn't be signalled), false if it must be queued
+ */
+bool vfpga_signal_notification(struct vfpga_dev *device, int ctid, int32_t value);
+
+/// Waits until the previous notification of a Coyote thread is acknowledged, and takes the turn of a queued one; sleeps
+void vfpga_notification_wait(struct vfpga_dev *device, int ctid);
+
+/// Marks the notification of a Coyote thread as acknowledged (processed by the user space), releasing the next queued one
+void vfpga_notification_done(struct vfpga_dev *device, int ctid);
+
+/**
+ * @brief Pushes a notification to the ring of a Coyote thread, if it's in one of the ring-based modes; called from the ISR, with irq_lock held
+ *
+ * @param device vfpga_dev which issued the notification
+ * @param ctid Coyote thread ID of the notification
+ * @param value Notification value
+ * @return true if the notification was handled (pushed or dropped), false if it should be delivered through the eventfd
+ */
+bool vfpga_push_notification(struct vfpga_dev *device, int ctid, int32_t value);
+
 #endif // _VFPGA_UISR_H_
\ No newline at end of file
@@ -49,17 +49,42 @@ bool en_hmm = false;
 module_param(en_hmm, bool, 0000);
 MODULE_PARM_DESC(en_hmm, "Enable HMM");
 
+/// Enable (true) lazy unpinning of user buffers; only applicable when HMM is disabled and on Linux >= 5.10
+/// When enabled, unmapping a buffer from user-space keeps it pinned and mapped in the TLB, so that re-mapping it is (almost) free
+/// The buffer is released once the kernel invalidates its virtual address range (e.g., munmap, process exit), via an MMU interval notifier
+bool en_lazy_unpin = false;
+module_param(en_lazy_unpin, bool, 0000);
+MODULE_PARM_DESC(en_lazy_unpin, "Keep user buffers pinned until their address range is invalidated");
+
+/// Affinity policy of the vFPGA interrupts and of their page fault / notification work (see enum irq_affinity_policy):
+///  0 - none, the kernel (or irqbalance) places the interrupts
+///  1 - spread the vFPGAs across the CPUs of the FPGA's NUMA node, one CPU per vFPGA (round-robin; default)
+///  2 - as 1, but each vFPGA follows the CPU of the Coyote thread which registered last, so the fault handling runs next to it
+/// The CPU of each vFPGA can also be set through sysfs (cyt_attr_irq_affinity)
+int irq_affinity = IRQ_AFFINITY_SPREAD;
+module_param(irq_affinity, int, 0000);
+MODULE_PARM_DESC(irq_affinity, "vFPGA interrupt affinity policy: 0 none, 1 spread over the NUMA node (default), 2 follow the Coyote threads");
+
 // Include the DMA Buffer mechanism to enable peer-to-peer DMA transfers between FPGAs and GPUs
 MODULE_IMPORT_NS(DMA_BUF);
 
 static int __init coyote_init(void) {
-    pr_info("Loading Coyote PCIe driver...\n");
-    return pci_init();
+    #ifdef PLATFORM_ENZIAN
+        pr_info("Loading Coyote ECI driver...\n");
+        return eci_init();
+    #else
+        pr_info("Loading Coyote PCIe driver...\n");
+        return pci_init();
+    #endif
 }
 
 static void __exit coyote_exit(void) {
     pr_info("Removing Coyote driver...\n");
-    pci_exit();
+    #ifdef PLATFORM_ENZIAN
+        eci_exit();
+    #else
+        pci_exit();
+    #endif
 }
 
 module_init(coyote_init);
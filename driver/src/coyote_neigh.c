@@ -0,0 +1,148 @@
+/*
+ * Copyright (c) 2025,  Systems Group, ETH Zurich
+ * All rights reserved.
+ *
+ * This file is part of the Coyote device driver for Linux.
+ * Coyote can be found at: https://github.com/fpgasystems/Coyote
+ *
+ * This source code is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * The full GNU General Public License is included in this distribution in
+ * the file called "COPYING". If not found, a copy of the GNU General Public  
+ * License can be found <https://www.gnu.org/licenses/>.
+ */
+
+
+#include "coyote_neigh.h"
+
+// Must be called with neigh_lock held
+static struct neigh_entry *neigh_find(struct bus_driver_data *data, uint32_t ip_addr) {
+    struct neigh_entry *tmp_entry;
+
+    hash_for_each_possible(data->neigh_map, tmp_entry, entry, ip_addr) {
+        if (tmp_entry->ip_addr == ip_addr) {
+            return tmp_entry;
+        }
+    }
+
+    return NULL;
+}
+
+void neigh_init(struct bus_driver_data *data) {
+    spin_lock_init(&data->neigh_lock);
+    hash_init(data->neigh_map);
+    data->n_neigh = 0;
+}
+
+void neigh_flush(struct bus_driver_data *data) {
+    int bkt;
+    struct neigh_entry *tmp_entry;
+    struct hlist_node *tmp_node;
+
+    spin_lock(&data->neigh_lock);
+    hash_for_each_safe(data->neigh_map, bkt, tmp_node, tmp_entry, entry) {
+        hash_del(&tmp_entry->entry);
+        kfree(tmp_entry);
+    }
+    data->n_neigh = 0;
+    spin_unlock(&data->neigh_lock);
+
+    dbg_info("neighbor table flushed\n");
+}
+
+int neigh_lookup(struct bus_driver_data *data, uint32_t ip_addr, uint64_t *wait_ns) {
+    struct neigh_entry *tmp_entry, *new_entry;
+    uint64_t now, elapsed;
+    int ret_val = 0;
+
+    // Allocated upfront, to avoid allocating with the lock held; freed if not needed
+    new_entry = kzalloc(sizeof(struct neigh_entry), GFP_KERNEL);
+    if (!new_entry) {
+        pr_warn("could not allocate neighbor table entry\n");
+        return -ENOMEM;
+    }
+
+    spin_lock(&data->neigh_lock);
+    now = ktime_get_ns();
+    tmp_entry = neigh_find(data, ip_addr);
+
+    if (tmp_entry) {
+        elapsed = now - tmp_entry->issued;
+        *wait_ns = elapsed < NEIGH_SETTLE_NS ? NEIGH_SETTLE_NS - elapsed : 0;
+    } else if (data->n_neigh >= NEIGH_MAX_ENTRIES) {
+        // Table full; the caller looks the address up, without it being recorded
+        *wait_ns = NEIGH_SETTLE_NS;
+        ret_val = 1;
+    } else {
+        new_entry->ip_addr = ip_addr;
+        new_entry->issued = now;
+        hash_add(data->neigh_map, &new_entry->entry, ip_addr);
+        data->n_neigh++;
+        new_entry = NULL;
+        *wait_ns = NEIGH_SETTLE_NS;
+        ret_val = 1;
+    }
+    spin_unlock(&data->neigh_lock);
+
+    kfree(new_entry);
+    dbg_info("neighbor lookup %08x, issue %d, wait %lld ns\n", ip_addr, ret_val, *wait_ns);
+    return ret_val;
+}
+
+int neigh_add(struct bus_driver_data *data, uint32_t ip_addr) {
+    struct neigh_entry *new_entry;
+    int ret_val = 0;
+
+    new_entry = kzalloc(sizeof(struct neigh_entry), GFP_KERNEL);
+    if (!new_entry) {
+        pr_warn("could not allocate neighbor table entry\n");
+        return -ENOMEM;
+    }
+    new_entry->ip_addr = ip_addr;
+
+    spin_lock(&data->neigh_lock);
+    if (neigh_find(data, ip_addr)) {
+        // Already looked up
+    } else if (data->n_neigh >= NEIGH_MAX_ENTRIES) {
+        ret_val = -ENOSPC;
+    } else {
+        // The ARP server is shared by all the vFPGAs, so the lookup can be issued through any of them
+        new_entry->issued = ktime_get_ns();
+        data->vfpga_dev[0].cnfg_regs->net_arp = ip_addr;
+        hash_add(data->neigh_map, &new_entry->entry, ip_addr);
+        data->n_neigh++;
+        new_entry = NULL;
+    }
+    spin_unlock(&data->neigh_lock);
+
+    kfree(new_entry);
+    return ret_val;
+}
+
+ssize_t neigh_print(struct bus_driver_data *data, char *buff, size_t size) {
+    int bkt;
+    struct neigh_entry *tmp_entry;
+    uint64_t now;
+    ssize_t len = 0;
+
+    spin_lock(&data->neigh_lock);
+    now = ktime_get_ns();
+    len += scnprintf(buff + len, size - len, "Neighbors: %u\n", data->n_neigh);
+    hash_for_each(data->neigh_map, bkt, tmp_entry, entry) {
+        if (now - tmp_entry->issued < NEIGH_SETTLE_NS) {
+            len += scnprintf(buff + len, size - len, "%08x looking up\n", tmp_entry->ip_addr);
+        } else {
+            len += scnprintf(buff + len, size - len, "%08x looked up %llu s ago\n", tmp_entry->ip_addr, (now - tmp_entry->issued) / NSEC_PER_SEC);
+        }
+    }
+    spin_unlock(&data->neigh_lock);
+
+    return len;
+}
@@ -37,6 +37,9 @@ int read_shell_config(struct bus_driver_data *data) {
     data->n_fpga_reg = data->shell_cnfg->n_regions;
     dbg_info("detected %d virtual FPGA regions, %d FPGA channels\n", data->n_fpga_reg, data->n_fpga_chan);
 
+    data->shell_ctrl_cnfg = data->shell_cnfg->ctrl_cnfg;
+    data->shell_mem_cnfg = data->shell_cnfg->mem_cnfg;
+
     data->en_avx = (data->shell_cnfg->ctrl_cnfg & EN_AVX_MASK) >> EN_AVX_SHIFT;
     data->en_wb = (data->shell_cnfg->ctrl_cnfg & EN_WB_MASK) >> EN_WB_SHIFT;
     dbg_info("enabled AVX %d, enabled writeback %d\n", data->en_avx,data->en_wb);
@@ -94,6 +97,7 @@ int read_shell_config(struct bus_driver_data *data) {
 
     data->card_reg_offs = 0;
     data->card_huge_offs = N_SMALL_CHUNKS * data->stlb_meta->page_size;
+    data->pingpong_threshold = PINGPONG_THRESHOLD;
 
     data->en_shell_pblock = (data->shell_cnfg->shell_pblock_cnfg & EN_SHELL_PBLOCK_MASK) >> EN_SHELL_PBLOCK_SHIFT;
     dbg_info("enabled shell pblock %d\n", data->en_shell_pblock);
@@ -129,6 +133,39 @@ int read_shell_config(struct bus_driver_data *data) {
     return ret_val;
 }
 
+int reload_shell_config(struct bus_driver_data *data) {
+    // The vFPGA devices, their register mappings, TLBs and card memory are kept, so their layout must not change
+    if (
+        data->shell_cnfg->n_regions != data->n_fpga_reg || data->shell_cnfg->n_chan != data->n_fpga_chan ||
+        data->shell_cnfg->ctrl_cnfg != data->shell_ctrl_cnfg || data->shell_cnfg->mem_cnfg != data->shell_mem_cnfg
+    ) {
+        dbg_info("new shell configuration differs in its vFPGA, TLB or memory set-up\n");
+        return -EINVAL;
+    }
+
+    data->probe_shell = data->shell_cnfg->probe;
+    dbg_info("deployment shell probe %08x\n", data->probe_shell);
+
+    data->en_shell_pblock = (data->shell_cnfg->shell_pblock_cnfg & EN_SHELL_PBLOCK_MASK) >> EN_SHELL_PBLOCK_SHIFT;
+    data->en_pr = (data->shell_cnfg->pr_cnfg & EN_PR_MASK) >> EN_PR_SHIFT;
+    data->en_rdma = (data->shell_cnfg->rdma_cnfg & EN_RDMA_MASK) >> EN_RDMA_SHIFT;
+    data->qsfp = (data->shell_cnfg->rdma_cnfg & QSFP_MASK) >> QSFP_SHIFT;
+    data->en_tcp = (data->shell_cnfg->tcp_cnfg & EN_TCP_MASK) >> EN_TCP_SHIFT;
+    data->en_net = data->en_rdma | data->en_tcp;
+    dbg_info(
+        "enabled shell pblock %d, partial (app) reconfiguration %d, RDMA %d, TCP/IP %d, port %d\n", 
+        data->en_shell_pblock, data->en_pr, data->en_rdma, data->en_tcp, data->qsfp
+    );
+
+    // The network addresses were already parsed when the driver was loaded
+    if (data->en_net) {
+        data->shell_cnfg->net_ip = data->net_ip_addr;
+        data->shell_cnfg->net_mac = data->net_mac_addr;
+    }
+
+    return 0;
+}
+
 ////////////////////////////////////////////////
 //      CARD MEMORY RESOURCES & SPIN LOCKS    //  
 ////////////////////////////////////////////////   
@@ -153,63 +190,19 @@ int allocate_card_resources(struct bus_driver_data *data) {
         goto err_alloc_sblocks;
     }
     
-    // The chunk struct (defined in coyote_defs.h) is used to keep track of the next chunk to use for allocation, no. of free chunks etc.
-    // Separate allocations for large and small chunks, corresponding to regular and huge pages
-    int i;
-    for (i = 0; i < N_MEM_BLOCKS; i++) {
-        // All chunks are initially free
-        data->card_lblocks[i].free_chunks = N_LARGE_CHUNKS;
-        data->card_sblocks[i].free_chunks = N_SMALL_CHUNKS;
-
-        // Set-up huge pages region
-        data->card_lblocks[i].chunks = vzalloc(N_LARGE_CHUNKS * sizeof(struct chunk));
-        if (!data->card_lblocks[i].chunks) {
-            pr_err("card memory regison for huge pages could not obtained\n");
-            goto err_alloc_lchunks;
-        }
-        for (int j = 0; j < N_LARGE_CHUNKS; j++) {
-            data->card_lblocks[i].chunks[j].id = j;
-            data->card_lblocks[i].chunks[j].used = false;
-            if (j == N_LARGE_CHUNKS - 1) {
-                data->card_lblocks[i].chunks[j].next = &data->card_lblocks[i].chunks[0];
-            } else {
-                data->card_lblocks[i].chunks[j].next = &data->card_lblocks[i].chunks[j + 1];
-            }
-        }
-
-        // Set-up regular pages region
-        data->card_sblocks[i].chunks = vzalloc(N_SMALL_CHUNKS * sizeof(struct chunk));
-        if (!data->card_sblocks[i].chunks) {
-            pr_err("card memory regison for regular pages could not obtained\n");
-            goto err_alloc_schunks;
-        }
-        for (int j = 0; j < N_SMALL_CHUNKS; j++) {
-            data->card_sblocks[i].chunks[j].id = j;
-            data->card_sblocks[i].chunks[j].used = false;
-            if (j == N_SMALL_CHUNKS - 1) {
-                data->card_sblocks[i].chunks[j].next = &data->card_sblocks[i].chunks[0];
-            } else {
-                data->card_sblocks[i].chunks[j].next = &data->card_sblocks[i].chunks[j + 1];
-            }
-        }
-
-        // Point to first chunk for new allocations
-        data->card_lblocks[i].alloc = &data->card_lblocks[i].chunks[0];
-        data->card_sblocks[i].alloc = &data->card_sblocks[i].chunks[0];
+    // Each memory block is split into a regular pages region and a huge pages region (see card_reg_offs and card_huge_offs),
+    // each of which is managed by its own bitmap allocator, with a granularity of one regular page; the allocators are only
+    // created on the first allocation from the block (see init_card_partition), since building the bitmaps for all the (HBM) 
+    // blocks at probe time is costly, while most applications only ever touch a few of them
+    for (int i = 0; i < N_MEM_BLOCKS; i++) {
+        data->card_lblocks[i].base = data->card_huge_offs + (i * MEM_BLOCK_SIZE) + MEM_START;
+        data->card_lblocks[i].size = N_LARGE_CHUNKS * data->stlb_meta->page_size;
+        data->card_sblocks[i].base = data->card_reg_offs + (i * MEM_BLOCK_SIZE) + MEM_START;
+        data->card_sblocks[i].size = N_SMALL_CHUNKS * data->stlb_meta->page_size;
     }
 
     goto end;
 
-err_alloc_schunks:
-    vfree(data->card_lblocks[i].chunks);
-
-err_alloc_lchunks: 
-    for (int k = 0; k < i; k++) {
-        vfree(data->card_sblocks[k].chunks);
-        vfree(data->card_lblocks[k].chunks);
-    }
-    vfree(data->card_sblocks);
-
 err_alloc_sblocks:
     vfree(data->card_lblocks);
 
@@ -222,10 +215,15 @@ end:
 
 void free_card_resources(struct bus_driver_data *data) {
     // Free the dynamically allocated card memory structs from allocate_card_resources
+    // Note, gen_pool_destroy requires all the memory to be returned to the pool; this is the case, since all the buffers are released before
     if (data->en_mem) {
         for (int i = 0; i < N_MEM_BLOCKS; i++) {
-            vfree(data->card_lblocks[i].chunks);
-            vfree(data->card_sblocks[i].chunks);
+            if (data->card_lblocks[i].pool) {
+                gen_pool_destroy(data->card_lblocks[i].pool);
+            }
+            if (data->card_sblocks[i].pool) {
+                gen_pool_destroy(data->card_sblocks[i].pool);
+            }
         }
 
         vfree(data->card_lblocks);
@@ -237,7 +235,11 @@ void free_card_resources(struct bus_driver_data *data) {
 
 void init_spin_locks(struct bus_driver_data *data) {
     spin_lock_init(&data->card_lock);
+    mutex_init(&data->card_init_lock);
     spin_lock_init(&data->stat_lock);
+    neigh_init(data);
+    hash_init(data->card_shared_map);
+    mutex_init(&data->card_shared_lock);
 }
 
 ////////////////////////////////////////////////
@@ -249,11 +251,19 @@ static struct kobj_attribute kobj_attr_mac = __ATTR(cyt_attr_mac, 0664, cyt_attr
 static struct kobj_attribute kobj_attr_nstats = __ATTR_RO(cyt_attr_nstats);
 static struct kobj_attribute kobj_attr_hstats = __ATTR_RO(cyt_attr_hstats);
 static struct kobj_attribute kobj_attr_prstats = __ATTR_RO(cyt_attr_prstats);
+static struct kobj_attribute kobj_attr_memstats = __ATTR_RO(cyt_attr_memstats);
+static struct kobj_attribute kobj_attr_metrics = __ATTR_RO(cyt_attr_metrics);
 #ifdef PLATFORM_ULTRASCALE_PLUS
 static struct kobj_attribute kobj_attr_engines = __ATTR_RO(cyt_attr_engines);
 #endif
 static struct kobj_attribute kobj_attr_cnfg = __ATTR_RO(cyt_attr_cnfg);
 static struct kobj_attribute kobj_attr_eost = __ATTR(cyt_attr_eost, 0664, cyt_attr_eost_show, cyt_attr_eost_store);
+static struct kobj_attribute kobj_attr_fault_ahead = __ATTR(cyt_attr_fault_ahead, 0664, cyt_attr_fault_ahead_show, cyt_attr_fault_ahead_store);
+static struct kobj_attribute kobj_attr_pingpong = __ATTR(cyt_attr_pingpong, 0664, cyt_attr_pingpong_show, cyt_attr_pingpong_store);
+static struct kobj_attribute kobj_attr_irq_affinity = __ATTR(cyt_attr_irq_affinity, 0664, cyt_attr_irq_affinity_show, cyt_attr_irq_affinity_store);
+static struct kobj_attribute kobj_attr_pfault_hist = __ATTR(cyt_attr_pfault_hist, 0664, cyt_attr_pfault_hist_show, cyt_attr_pfault_hist_store);
+static struct kobj_attribute kobj_attr_hdma_share = __ATTR(cyt_attr_hdma_share, 0664, cyt_attr_hdma_share_show, cyt_attr_hdma_share_store);
+static struct kobj_attribute kobj_attr_neigh = __ATTR(cyt_attr_neigh, 0664, cyt_attr_neigh_show, cyt_attr_neigh_store);
 #ifdef PLATFORM_VERSAL
 static struct kobj_attribute kobj_attr_qdma_debug_regs = __ATTR_RO(cyt_attr_qdma_debug_regs);
 #endif
@@ -264,11 +274,19 @@ static struct attribute *attrs[] = {
     &kobj_attr_nstats.attr,
     &kobj_attr_hstats.attr,
     &kobj_attr_prstats.attr,
+    &kobj_attr_memstats.attr,
+    &kobj_attr_metrics.attr,
     #ifdef PLATFORM_ULTRASCALE_PLUS
     &kobj_attr_engines.attr,
     #endif
     &kobj_attr_cnfg.attr,
     &kobj_attr_eost.attr,
+    &kobj_attr_fault_ahead.attr,
+    &kobj_attr_pingpong.attr,
+    &kobj_attr_pfault_hist.attr,
+    &kobj_attr_irq_affinity.attr,
+    &kobj_attr_hdma_share.attr,
+    &kobj_attr_neigh.attr,
     #ifdef PLATFORM_VERSAL
     &kobj_attr_qdma_debug_regs.attr,
     #endif
@@ -321,6 +339,9 @@ struct file_operations vfpga_ops = {
     .open = vfpga_dev_open,
     .release = vfpga_dev_release,
     .unlocked_ioctl = vfpga_dev_ioctl,
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 19, 0)
+    .uring_cmd = vfpga_dev_uring_cmd,
+#endif
     .mmap = vfpga_dev_mmap,
 };
 
@@ -420,6 +441,17 @@ int setup_vfpga_devices(struct bus_driver_data *data) {
             goto err_alloc_pid_array;
         }
 
+        // Statistics of the Coyote threads; mapped to user space, hence vmalloc_user (zeroed, page-aligned)
+        data->vfpga_dev[i].stats = vmalloc_user(VFPGA_STATS_SIZE);
+        if (!data->vfpga_dev[i].stats) {
+            pr_err("memory region for statistics not obtained\n");
+            goto err_alloc_stats;
+        }
+        data->vfpga_dev[i].stats->version = VFPGA_STATS_VERSION;
+        data->vfpga_dev[i].stats->flags = en_lazy_unpin ? VFPGA_STATS_FLAG_LAZY_UNPIN : 0;
+        memset(data->vfpga_dev[i].pf_trace, 0, sizeof(data->vfpga_dev[i].pf_trace));
+        data->vfpga_dev[i].irq_cpu = -1;
+
         // Variable housekeeping for Coyote threads; ID starts from 0, increments by 1
         for (int j = 0; j < N_CTID_MAX - 1; j++) {
             data->vfpga_dev[i].ctid_chunks[j].id = j;
@@ -431,12 +463,16 @@ int setup_vfpga_devices(struct bus_driver_data *data) {
         // Initialize device spinlocks and mutexes
         spin_lock_init(&data->vfpga_dev[i].irq_lock);
         mutex_init(&data->vfpga_dev[i].mmu_lock);
+        data->vfpga_dev[i].tlb_lock_cnt = 0;
         mutex_init(&data->vfpga_dev[i].offload_lock);
         mutex_init(&data->vfpga_dev[i].sync_lock);
+        INIT_LIST_HEAD(&data->vfpga_dev[i].card_lru);
+        spin_lock_init(&data->vfpga_dev[i].card_lru_lock);
         mutex_init(&data->vfpga_dev[i].pid_lock);
+        data->vfpga_dev[i].notify_rings = NULL;
 
-        // Initialize workqueues
-        data->vfpga_dev[i].wqueue_pfault = alloc_workqueue(COYOTE_DRIVER_NAME, WQ_UNBOUND | WQ_MEM_RECLAIM, 1);
+        // Initialize workqueues; page faults are serialized per Coyote thread (user_buff_lock), so up to N_CTID_MAX can be handled in parallel
+        data->vfpga_dev[i].wqueue_pfault = alloc_workqueue(COYOTE_DRIVER_NAME, WQ_UNBOUND | WQ_MEM_RECLAIM, N_CTID_MAX);
         if(!data->vfpga_dev[i].wqueue_pfault) {
             pr_err("page fault work queue not initialized\n");
             goto err_pfault_wqueue;
@@ -449,6 +485,7 @@ int setup_vfpga_devices(struct bus_driver_data *data) {
         }
 
         // initialize waitqueues
+        init_waitqueue_head(&data->vfpga_dev[i].waitqueue_notify);
         init_waitqueue_head(&data->vfpga_dev[i].waitqueue_invldt);
         atomic_set(&data->vfpga_dev[i].wait_invldt, 0);
         
@@ -460,7 +497,7 @@ int setup_vfpga_devices(struct bus_driver_data *data) {
 
         // Set-up writeback memory if enabled; used for polling transfer completions
         if (data->en_wb) {
-            data->vfpga_dev[i].wb_addr_virt  = dma_alloc_coherent(&data->pci_dev->dev, WB_SIZE, &data->vfpga_dev[i].wb_phys_addr, GFP_KERNEL);
+            data->vfpga_dev[i].wb_addr_virt  = dma_alloc_coherent(data->dma_dev, WB_SIZE, &data->vfpga_dev[i].wb_phys_addr, GFP_KERNEL);
             if (!data->vfpga_dev[i].wb_addr_virt) {
                 pr_err("failed to allocate writeback memory\n");
                 goto err_wb;
@@ -483,19 +520,21 @@ int setup_vfpga_devices(struct bus_driver_data *data) {
         }
 
         // Create and initialize the device, by specifying its file operations; major number was obtained in alloc_reconfig_device
+        // The PCI device is set as the parent, so that its attributes (e.g., numa_node) are reachable from the vFPGA device in sysfs
         int device_number = MKDEV(data->vfpga_major, i);
 
         sprintf(vf_dev_name_tmp, "%s_v%d", data->vfpga_dev_name, i);
-        device_create(data->vfpga_class, NULL, device_number, NULL, vf_dev_name_tmp, i);
+        device_create(data->vfpga_class, data->dma_dev, device_number, NULL, vf_dev_name_tmp, i);
         dbg_info("virtual FPGA device %d created\n", i);
 
         cdev_init(&data->vfpga_dev[i].cdev, &vfpga_ops);
         data->vfpga_dev[i].cdev.owner = THIS_MODULE;
         data->vfpga_dev[i].cdev.ops = &vfpga_ops;
 
-        // Initialize hashmaps; in this case only one which is used for keeping track of memory buffers and TLB mappings
+        // Initialize the maps keeping track of memory buffers and TLB mappings
         for (int j = 0; j < N_CTID_MAX; j++) {
-            hash_init(user_buff_map[i][j]);
+            user_buff_map[i][j] = RB_ROOT_CACHED;
+            mutex_init(&user_buff_lock[i][j]);
         }
 
         // Register each char vFPGA device with the kernel through cdev_add and the previously allocated unique device number
@@ -531,13 +570,13 @@ err_char_reg:
 	}
     if (data->en_wb) {
         set_memory_wb((uint64_t)data->vfpga_dev[i].wb_addr_virt, N_WB_PAGES);
-        dma_free_coherent(&data->pci_dev->dev, WB_SIZE, data->vfpga_dev[i].wb_addr_virt, data->vfpga_dev[i].wb_phys_addr);
+        dma_free_coherent(data->dma_dev, WB_SIZE, data->vfpga_dev[i].wb_addr_virt, data->vfpga_dev[i].wb_phys_addr);
     }
 err_wb:
     if (data->en_wb) {
         for (int j = 0; j < i; j++) {
             set_memory_wb((uint64_t)data->vfpga_dev[j].wb_addr_virt, N_WB_PAGES);
-            dma_free_coherent(&data->pci_dev->dev, WB_SIZE, data->vfpga_dev[j].wb_addr_virt, data->vfpga_dev[j].wb_phys_addr);
+            dma_free_coherent(data->dma_dev, WB_SIZE, data->vfpga_dev[j].wb_addr_virt, data->vfpga_dev[j].wb_phys_addr);
         }
     }
     destroy_workqueue(data->vfpga_dev[i].wqueue_notify);
@@ -550,6 +589,11 @@ err_pfault_wqueue:
     for (int j = 0; j < i; j++) {
         destroy_workqueue(data->vfpga_dev[j].wqueue_pfault);
     }
+    vfree(data->vfpga_dev[i].stats);
+err_alloc_stats:
+    for (int j = 0; j < i; j++) {
+        vfree(data->vfpga_dev[j].stats);
+    }
     vfree(data->vfpga_dev[i].pid_array);
 err_alloc_pid_array:
     for (int j = 0; j < i; j++) {
@@ -566,6 +610,9 @@ end:
 }
 
 void teardown_vfpga_devices(struct bus_driver_data *data) {
+    // Persistent card memory only lives as long as the driver
+    release_persistent_card_pages(data);
+
     // Iterate through all the vFPGA devices; releasing memory, work-queues etc.
     for (int i = 0; i < data->n_fpga_reg; i++) {
         device_destroy(data->vfpga_class, MKDEV(data->vfpga_major, i));
@@ -587,16 +634,21 @@ void teardown_vfpga_devices(struct bus_driver_data *data) {
 
         if(data->en_wb) {
             set_memory_wb((uint64_t)data->vfpga_dev[i].wb_addr_virt, N_WB_PAGES);
-            dma_free_coherent(&data->pci_dev->dev, WB_SIZE, data->vfpga_dev[i].wb_addr_virt, data->vfpga_dev[i].wb_phys_addr);
+            dma_free_coherent(data->dma_dev, WB_SIZE, data->vfpga_dev[i].wb_addr_virt, data->vfpga_dev[i].wb_phys_addr);
         }
 
         destroy_workqueue(data->vfpga_dev[i].wqueue_notify);
         destroy_workqueue(data->vfpga_dev[i].wqueue_pfault);
 
+        vfree(data->vfpga_dev[i].notify_rings);
+        vfree(data->vfpga_dev[i].stats);
         vfree(data->vfpga_dev[i].pid_array);
         vfree(data->vfpga_dev[i].ctid_chunks);
     }
 
+    // The ARP server of the network stack is reset with the shell
+    neigh_flush(data);
+
     dbg_info("vFPGA devices deleted\n");
 }
 
@@ -611,6 +663,45 @@ void free_vfpga_devices(struct bus_driver_data *data) {
     dbg_info("unregistered char vFPGA devices\n");
 }
 
+void quiesce_vfpga_devices(struct bus_driver_data *data) {
+    for (int i = 0; i < data->n_fpga_reg; i++) {
+        struct vfpga_dev *device = &data->vfpga_dev[i];
+
+        // No Coyote threads can be registered or released, and no buffers mapped, migrated or released, until resume_vfpga_devices
+        mutex_lock(&device->pid_lock);
+        for (int j = 0; j < N_CTID_MAX; j++) {
+            mutex_lock(&user_buff_lock[i][j]);
+            if (device->ctid_chunks[j].used) {
+                tlb_evacuate_gup(device, j);
+            }
+        }
+    }
+
+    dbg_info("vFPGA devices quiesced\n");
+}
+
+void resume_vfpga_devices(struct bus_driver_data *data, bool restore) {
+    for (int i = 0; i < data->n_fpga_reg; i++) {
+        struct vfpga_dev *device = &data->vfpga_dev[i];
+
+        if (restore && data->en_wb) {
+            for (int j = 0; j < WB_BLOCKS; j++) {
+                device->cnfg_regs->wback[j] = device->wb_phys_addr + j * (N_CTID_MAX * sizeof(uint32_t));
+            }
+        }
+
+        for (int j = 0; j < N_CTID_MAX; j++) {
+            if (restore && device->ctid_chunks[j].used) {
+                tlb_restore_gup(device, j, device->pid_array[j]);
+            }
+            mutex_unlock(&user_buff_lock[i][j]);
+        }
+        mutex_unlock(&device->pid_lock);
+    }
+
+    dbg_info("vFPGA devices resumed, state restored %d\n", restore);
+}
+
 ////////////////////////////////////////////////
 //          RECONFIGURATION DEVICE            //  
 ////////////////////////////////////////////////    
@@ -671,11 +762,24 @@ int setup_reconfig_device(struct bus_driver_data *data) {
 
     // Initialize variables held by reconfig device
     hash_init(reconfig_buffs_map);
-    mutex_init(&data->reconfig_dev->rcnfg_lock);
+    hash_init(reconfig_pending_map);
+    hash_init(reconfig_cache_map);
+    INIT_LIST_HEAD(&data->reconfig_dev->cache_lru);
+    atomic64_set(&data->reconfig_dev->icap_next, 0);
+    atomic64_set(&data->reconfig_dev->icap_serving, 0);
+    init_waitqueue_head(&data->reconfig_dev->waitqueue_icap);
+    for (int i = 0; i < MAX_N_REGIONS; i++) {
+        mutex_init(&data->reconfig_dev->region_lock[i]);
+    }
     spin_lock_init(&data->reconfig_dev->irq_lock);
     spin_lock_init(&data->reconfig_dev->mem_lock);
     init_waitqueue_head(&data->reconfig_dev->waitqueue_rcnfg);
     atomic_set(&data->reconfig_dev->wait_rcnfg, FLAG_CLR);
+    data->reconfig_dev->bw = RECONFIG_DEFAULT_BW;
+    for (int i = 0; i < MAX_N_REGIONS; i++) {
+        data->reconfig_dev->async_req[i].device = data->reconfig_dev;
+        INIT_WORK(&data->reconfig_dev->async_req[i].work, reconfigure_app_work);
+    }
 
     // Create and initialize the device, by specifying its file operations; major number was obtained in alloc_reconfig_device
     // Returns a unique device number (major + minor no.) for the reconfiguration device
@@ -705,9 +809,17 @@ end:
 }
 
 void teardown_reconfig_device(struct bus_driver_data *data) {
+    // Asynchronous reconfigurations still in progress must complete before the device is gone
+    for (int i = 0; i < MAX_N_REGIONS; i++) {
+        flush_work(&data->reconfig_dev->async_req[i].work);
+    }
+
     device_destroy(data->reconfig_class, MKDEV(data->reconfig_major, 0));
     cdev_del(&data->reconfig_dev->cdev);
     dbg_info("reconfig device deleted\n");
+
+    free_reconfig_cache(data->reconfig_dev);
+    dbg_info("bitstream cache freed\n");
 }
 
 void free_reconfig_device(struct bus_driver_data *data) {
@@ -78,6 +78,206 @@ ssize_t cyt_attr_eost_store(struct kobject *kobj, struct kobj_attribute *attr, c
     return count;
 }
 
+ssize_t cyt_attr_fault_ahead_show(struct kobject *kobj, struct kobj_attribute *attr, char *buff) {   
+    struct bus_driver_data *bus_data = container_of(kobj, struct bus_driver_data, cyt_kobj);
+    BUG_ON(!bus_data); 
+
+    dbg_info("coyote-sysfs:  current fault-ahead window [bytes]: %lld\n", bus_data->fault_ahead);
+    return sprintf(buff, "Fault-ahead: %lld\n", bus_data->fault_ahead);
+}
+
+ssize_t cyt_attr_fault_ahead_store(struct kobject *kobj, struct kobj_attribute *attr, const char *buff, size_t count) {
+    struct bus_driver_data *bus_data = container_of(kobj, struct bus_driver_data, cyt_kobj);
+    BUG_ON(!bus_data); 
+
+    long long fault_ahead;
+    if (kstrtoll(buff, 0, &fault_ahead) || fault_ahead < 0) {
+        pr_warn("coyote-sysfs:  invalid fault-ahead window, expected a non-negative number of bytes\n");
+        return -EINVAL;
+    }
+
+    bus_data->fault_ahead = fault_ahead;
+    dbg_info("coyote-sysfs:  setting fault-ahead window to: %lld bytes\n", bus_data->fault_ahead);
+
+    return count;
+}
+
+ssize_t cyt_attr_pingpong_show(struct kobject *kobj, struct kobj_attribute *attr, char *buff) {   
+    struct bus_driver_data *bus_data = container_of(kobj, struct bus_driver_data, cyt_kobj);
+    BUG_ON(!bus_data); 
+
+    dbg_info("coyote-sysfs:  current ping-pong threshold: %u\n", bus_data->pingpong_threshold);
+    return sprintf(buff, "Ping-pong threshold: %u\n", bus_data->pingpong_threshold);
+}
+
+ssize_t cyt_attr_pingpong_store(struct kobject *kobj, struct kobj_attribute *attr, const char *buff, size_t count) {
+    struct bus_driver_data *bus_data = container_of(kobj, struct bus_driver_data, cyt_kobj);
+    BUG_ON(!bus_data); 
+
+    sscanf(buff,"%u",&bus_data->pingpong_threshold);
+    dbg_info("coyote-sysfs:  setting ping-pong threshold to: %u\n", bus_data->pingpong_threshold);
+
+    return count;
+}
+
+ssize_t cyt_attr_pfault_hist_show(struct kobject *kobj, struct kobj_attribute *attr, char *buff) {   
+    struct bus_driver_data *bus_data = container_of(kobj, struct bus_driver_data, cyt_kobj);
+    BUG_ON(!bus_data); 
+
+    static const char *phases[N_PFAULT_PHASES] = { "lock", "pin", "map", "total" };
+    struct pfault_hist *hist = &bus_data->pfault_hist;
+    uint64_t count = atomic64_read(&hist->count);
+    ssize_t len = 0;
+
+    dbg_info("coyote-sysfs:  page fault histograms, %lld faults\n", count);
+    len += scnprintf(buff + len, PAGE_SIZE - len, "Page faults: %lld\n", count);
+    len += scnprintf(buff + len, PAGE_SIZE - len, "Buckets [us]: <1");
+    for (int j = 1; j < PFAULT_HIST_BUCKETS - 1; j++) {
+        len += scnprintf(buff + len, PAGE_SIZE - len, " <%ld", 1L << j);
+    }
+    len += scnprintf(buff + len, PAGE_SIZE - len, " >=%ld\n", 1L << (PFAULT_HIST_BUCKETS - 2));
+
+    for (int i = 0; i < N_PFAULT_PHASES; i++) {
+        uint64_t sum_ns = atomic64_read(&hist->sum_ns[i]);
+        len += scnprintf(buff + len, PAGE_SIZE - len, "%s (mean %lld ns):", phases[i], count ? div64_u64(sum_ns, count) : 0);
+        for (int j = 0; j < PFAULT_HIST_BUCKETS; j++) {
+            len += scnprintf(buff + len, PAGE_SIZE - len, " %lld", atomic64_read(&hist->buckets[i][j]));
+        }
+        len += scnprintf(buff + len, PAGE_SIZE - len, "\n");
+    }
+
+    return len;
+}
+
+ssize_t cyt_attr_pfault_hist_store(struct kobject *kobj, struct kobj_attribute *attr, const char *buff, size_t count) {
+    struct bus_driver_data *bus_data = container_of(kobj, struct bus_driver_data, cyt_kobj);
+    BUG_ON(!bus_data); 
+
+    // Faults being recorded concurrently may be partially cleared; the histograms are only approximate while faults are in flight
+    struct pfault_hist *hist = &bus_data->pfault_hist;
+    for (int i = 0; i < N_PFAULT_PHASES; i++) {
+        for (int j = 0; j < PFAULT_HIST_BUCKETS; j++) {
+            atomic64_set(&hist->buckets[i][j], 0);
+        }
+        atomic64_set(&hist->sum_ns[i], 0);
+    }
+    atomic64_set(&hist->count, 0);
+    dbg_info("coyote-sysfs:  page fault histograms cleared\n");
+
+    return count;
+}
+
+ssize_t cyt_attr_irq_affinity_show(struct kobject *kobj, struct kobj_attribute *attr, char *buff) {   
+    struct bus_driver_data *bus_data = container_of(kobj, struct bus_driver_data, cyt_kobj);
+    BUG_ON(!bus_data); 
+
+    ssize_t len = scnprintf(buff, PAGE_SIZE, "Policy: %d\n", irq_affinity);
+    for (int i = 0; i < bus_data->n_fpga_reg; i++) {
+        int cpu = READ_ONCE(bus_data->vfpga_dev[i].irq_cpu);
+        if (cpu >= 0) {
+            len += scnprintf(buff + len, PAGE_SIZE - len, "vFPGA %d: IRQ#%d CPU %d (node %d)\n", i, bus_data->irq_entry[i].vector, cpu, cpu_to_node(cpu));
+        } else {
+            len += scnprintf(buff + len, PAGE_SIZE - len, "vFPGA %d: IRQ#%d not pinned\n", i, bus_data->irq_entry[i].vector);
+        }
+    }
+
+    return len;
+}
+
+ssize_t cyt_attr_irq_affinity_store(struct kobject *kobj, struct kobj_attribute *attr, const char *buff, size_t count) {
+    struct bus_driver_data *bus_data = container_of(kobj, struct bus_driver_data, cyt_kobj);
+    BUG_ON(!bus_data); 
+
+    int vfid, cpu;
+    if (sscanf(buff, "%d %d", &vfid, &cpu) != 2 || vfid < 0 || vfid >= bus_data->n_fpga_reg) {
+        pr_warn("coyote-sysfs:  invalid IRQ affinity, expected <vFPGA ID> <CPU>\n");
+        return -EINVAL;
+    }
+
+    int ret_val = vfpga_set_irq_affinity(&bus_data->vfpga_dev[vfid], cpu);
+    if (ret_val) {
+        return ret_val;
+    }
+    dbg_info("coyote-sysfs:  IRQ of vFPGA %d pinned to CPU %d\n", vfid, cpu);
+
+    return count;
+}
+
+ssize_t cyt_attr_hdma_share_show(struct kobject *kobj, struct kobj_attribute *attr, char *buff) {   
+    struct bus_driver_data *bus_data = container_of(kobj, struct bus_driver_data, cyt_kobj);
+    BUG_ON(!bus_data); 
+
+    if (!bus_data->en_strm) {
+        return scnprintf(buff, PAGE_SIZE, "Host streams not enabled\n");
+    }
+
+    // Shares are in MB/s (B/us), achieved bandwidth is reported as bytes per ms
+    ssize_t len = 0;
+    for (int i = 0; i < bus_data->n_fpga_reg; i++) {
+        uint64_t share = bus_data->vfpga_dev[i].cnfg_regs->hdma_share;
+        uint64_t xfer = bus_data->vfpga_dev[i].cnfg_regs->hdma_xfer;
+        len += scnprintf(buff + len, PAGE_SIZE - len, "vFPGA %d: RD share %u MB/s, achieved %u MB/s; WR share %u MB/s, achieved %u MB/s\n", i, 
+            (uint32_t) LOW_32(share), (uint32_t) LOW_32(xfer) / 1000, (uint32_t) HIGH_32(share), (uint32_t) HIGH_32(xfer) / 1000);
+    }
+
+    return len;
+}
+
+ssize_t cyt_attr_hdma_share_store(struct kobject *kobj, struct kobj_attribute *attr, const char *buff, size_t count) {
+    struct bus_driver_data *bus_data = container_of(kobj, struct bus_driver_data, cyt_kobj);
+    BUG_ON(!bus_data); 
+
+    int vfid;
+    uint32_t rd_share, wr_share;
+    if (sscanf(buff, "%d %u %u", &vfid, &rd_share, &wr_share) != 3 || vfid < 0 || vfid >= bus_data->n_fpga_reg) {
+        pr_warn("coyote-sysfs:  invalid host DMA share, expected <vFPGA ID> <read MB/s> <write MB/s>\n");
+        return -EINVAL;
+    }
+    if (!bus_data->en_strm) {
+        return -EOPNOTSUPP;
+    }
+
+    bus_data->vfpga_dev[vfid].cnfg_regs->hdma_share = ((uint64_t) wr_share << 32) | rd_share;
+    dbg_info("coyote-sysfs:  host DMA share of vFPGA %d set to %u MB/s RD, %u MB/s WR\n", vfid, rd_share, wr_share);
+
+    return count;
+}
+
+ssize_t cyt_attr_neigh_show(struct kobject *kobj, struct kobj_attribute *attr, char *buff) {   
+    struct bus_driver_data *bus_data = container_of(kobj, struct bus_driver_data, cyt_kobj);
+    BUG_ON(!bus_data); 
+
+    return neigh_print(bus_data, buff, PAGE_SIZE);
+}
+
+ssize_t cyt_attr_neigh_store(struct kobject *kobj, struct kobj_attribute *attr, const char *buff, size_t count) {
+    struct bus_driver_data *bus_data = container_of(kobj, struct bus_driver_data, cyt_kobj);
+    BUG_ON(!bus_data); 
+
+    if (sysfs_streq(buff, "flush")) {
+        neigh_flush(bus_data);
+        return count;
+    }
+    if (!bus_data->en_net) {
+        return -EOPNOTSUPP;
+    }
+
+    // One or more whitespace-separated IP addresses, in hex (same as cyt_attr_ip)
+    int ret_val, n;
+    uint32_t ip_addr;
+    const char *pos = buff;
+    while (sscanf(pos, "%x%n", &ip_addr, &n) == 1) {
+        ret_val = neigh_add(bus_data, ip_addr);
+        if (ret_val) {
+            return ret_val;
+        }
+        dbg_info("coyote-sysfs:  looking up IP address %08x\n", ip_addr);
+        pos += n;
+    }
+
+    return count;
+}
+
 ssize_t cyt_attr_nstats_show(struct kobject *kobj, struct kobj_attribute *attr, char *buff) {   
     struct bus_driver_data *bus_data = container_of(kobj, struct bus_driver_data, cyt_kobj);
     BUG_ON(!bus_data); 
@@ -165,6 +365,66 @@ ssize_t cyt_attr_hstats_show(struct kobject *kobj, struct kobj_attribute *attr,
     return sw;
 }
 
+// Utility function, called for each chunk of a card memory pool; records the largest run of free pages in the chunk's bitmap
+static void largest_free_extent(struct gen_pool *pool, struct gen_pool_chunk *chunk, void *data) {
+    uint64_t *max_extent = (uint64_t *) data;
+    unsigned long n_bits = (chunk->end_addr - chunk->start_addr + 1) >> pool->min_alloc_order;
+
+    unsigned long start = find_first_zero_bit(chunk->bits, n_bits);
+    while (start < n_bits) {
+        unsigned long end = find_next_bit(chunk->bits, n_bits, start);
+        *max_extent = max(*max_extent, (uint64_t) (end - start) << pool->min_alloc_order);
+        start = find_next_zero_bit(chunk->bits, n_bits, end);
+    }
+}
+
+ssize_t cyt_attr_memstats_show(struct kobject *kobj, struct kobj_attribute *attr, char *buff) {   
+    struct bus_driver_data *bus_data = container_of(kobj, struct bus_driver_data, cyt_kobj);
+    BUG_ON(!bus_data);
+
+    if (!bus_data->en_mem) {
+        return sprintf(buff, "Card memory not enabled\n");
+    }
+
+    int sw = 0;
+    sw += scnprintf(buff, PAGE_SIZE, "\n -- \033[31m\e[1mCARD MEMORY STATS\033[0m\e[0m\n\n");
+    sw += scnprintf(buff + sw, PAGE_SIZE - sw, "block: regular free / total / largest free [MB], huge free / total / largest free [MB], fallbacks (regular, huge)\n");
+
+    // Only the blocks in use are listed, to stay within one page on devices with many (HBM) blocks
+    uint64_t total_free = 0;
+    for (int i = 0; i < N_MEM_BLOCKS; i++) {
+        struct memory_partition *sblock = &bus_data->card_sblocks[i];
+        struct memory_partition *lblock = &bus_data->card_lblocks[i];
+
+        // Partitions whose allocators haven't been created yet (see init_card_partition) were never allocated from
+        struct gen_pool *spool = smp_load_acquire(&sblock->pool);
+        struct gen_pool *lpool = smp_load_acquire(&lblock->pool);
+        uint64_t sfree = spool ? gen_pool_avail(spool) : sblock->size;
+        uint64_t lfree = lpool ? gen_pool_avail(lpool) : lblock->size;
+        total_free += sfree + lfree;
+
+        if (sfree == sblock->size && lfree == lblock->size && !sblock->n_fallbacks && !lblock->n_fallbacks) {
+            continue;
+        }
+
+        uint64_t smax = spool ? 0 : sblock->size, lmax = lpool ? 0 : lblock->size;
+        if (spool) {
+            gen_pool_for_each_chunk(spool, largest_free_extent, &smax);
+        }
+        if (lpool) {
+            gen_pool_for_each_chunk(lpool, largest_free_extent, &lmax);
+        }
+
+        sw += scnprintf(buff + sw, PAGE_SIZE - sw, "%d: %lld / %lld / %lld, %lld / %lld / %lld, %lld %lld\n", i, 
+            sfree >> 20, sblock->size >> 20, smax >> 20, lfree >> 20, lblock->size >> 20, lmax >> 20, 
+            sblock->n_fallbacks, lblock->n_fallbacks
+        );
+    }
+    sw += scnprintf(buff + sw, PAGE_SIZE - sw, "total free [MB]: %lld\n", total_free >> 20);
+
+    return sw;
+}
+
 ssize_t cyt_attr_prstats_show(struct kobject *kobj, struct kobj_attribute *attr, char *buff) {   
     struct bus_driver_data *bus_data = container_of(kobj, struct bus_driver_data, cyt_kobj);
     BUG_ON(!bus_data); 
@@ -197,6 +457,88 @@ ssize_t cyt_attr_prstats_show(struct kobject *kobj, struct kobj_attribute *attr,
     );
     #endif
 
+    if (bus_data->reconfig_dev) {
+        struct reconfig_dev *reconfig_dev = bus_data->reconfig_dev;
+        uint64_t last_us = div64_u64(reconfig_dev->last_ns, 1000);
+        sw += sprintf(buff + strlen(buff), 
+            "\nRECONFIGURATION:\n"
+            "completed: %d\n"
+            "last length [B]: %lld\n"
+            "last duration [us]: %lld\n"
+            "last bandwidth [MB/s]: %lld\n"
+            "\nBITSTREAM CACHE:\n"
+            "pages: %d/%d\n"
+            "hits: %lld\n"
+            "added: %lld\n"
+            "evicted: %lld\n",
+
+            bus_data->stat_cnfg->reconfig_cnt,
+            reconfig_dev->last_len,
+            last_us,
+            last_us ? div64_u64(reconfig_dev->last_len, last_us) : 0,
+            reconfig_dev->cache_pages,
+            RECONFIG_CACHE_MAX_PAGES,
+            reconfig_dev->cache_hits,
+            reconfig_dev->cache_adds,
+            reconfig_dev->cache_evictions
+        );
+    }
+
+    return sw;
+}
+
+ssize_t cyt_attr_metrics_show(struct kobject *kobj, struct kobj_attribute *attr, char *buff) {   
+    struct bus_driver_data *bus_data = container_of(kobj, struct bus_driver_data, cyt_kobj);
+    BUG_ON(!bus_data);
+
+    // One "key value" pair per line, no formatting, so that it can be parsed by monitoring tools (e.g. coyote_metrics)
+    // The counters are cumulative and wrap around at 32 bits; rates are computed by the reader from consecutive samples
+    int sw = 0;
+    sw += scnprintf(buff + sw, PAGE_SIZE - sw, "timestamp_ns %lld\n", ktime_get_ns());
+    sw += scnprintf(buff + sw, PAGE_SIZE - sw, "hdma_beat_bytes %d\n", HDMA_BEAT_BYTES);
+
+    // Shell host DMA channels; three registers per channel, as in cyt_attr_hstats
+    for (int i = 0; i < bus_data->n_fpga_chan && (i + 1) * 3 <= N_HDMA_STAT_REGS; i++) {
+        uint64_t req = bus_data->shell_cnfg->hdma_debug[3 * i];
+        uint64_t cmpl = bus_data->shell_cnfg->hdma_debug[3 * i + 1];
+        uint64_t beats = bus_data->shell_cnfg->hdma_debug[3 * i + 2];
+        sw += scnprintf(buff + sw, PAGE_SIZE - sw, 
+            "hdma_%d_req_h2c %lld\nhdma_%d_req_c2h %lld\n"
+            "hdma_%d_cmpl_h2c %lld\nhdma_%d_cmpl_c2h %lld\n"
+            "hdma_%d_beats_h2c %lld\nhdma_%d_beats_c2h %lld\n",
+            i, LOW_32(req), i, HIGH_32(req), 
+            i, LOW_32(cmpl), i, HIGH_32(cmpl), 
+            i, LOW_32(beats), i, HIGH_32(beats)
+        );
+    }
+
+    // Partial reconfiguration channel
+    sw += scnprintf(buff + sw, PAGE_SIZE - sw, 
+        "pr_req_h2c %d\npr_req_c2h %d\npr_cmpl_h2c %d\npr_cmpl_c2h %d\npr_beats_h2c %d\npr_beats_c2h %d\n",
+        bus_data->stat_cnfg->hdma_debug[0], bus_data->stat_cnfg->hdma_debug[1], bus_data->stat_cnfg->hdma_debug[2],
+        bus_data->stat_cnfg->hdma_debug[3], bus_data->stat_cnfg->hdma_debug[4], bus_data->stat_cnfg->hdma_debug[5]
+    );
+    sw += scnprintf(buff + sw, PAGE_SIZE - sw, "reconfig_cnt %d\n", bus_data->stat_cnfg->reconfig_cnt);
+    if (bus_data->reconfig_dev) {
+        sw += scnprintf(buff + sw, PAGE_SIZE - sw, "reconfig_cache_hits %lld\nreconfig_cache_evictions %lld\n",
+            bus_data->reconfig_dev->cache_hits, bus_data->reconfig_dev->cache_evictions
+        );
+    }
+
+    // Network stack; same registers as cyt_attr_nstats
+    if (bus_data->en_net) {
+        static const char *net_keys[] = {
+            "net_rx_pkts", "net_tx_pkts", "net_arp_rx_pkts", "net_arp_tx_pkts", "net_icmp_rx_pkts", "net_icmp_tx_pkts",
+            "net_tcp_rx_pkts", "net_tcp_tx_pkts", "net_roce_rx_pkts", "net_roce_tx_pkts", "net_ibv_rx_pkts", "net_ibv_tx_pkts",
+            "net_psn_drops", "net_retrans"
+        };
+        for (int i = 0; i < ARRAY_SIZE(net_keys); i++) {
+            uint64_t reg = bus_data->shell_cnfg->net_debug[i / 2];
+            sw += scnprintf(buff + sw, PAGE_SIZE - sw, "%s %lld\n", net_keys[i], (i % 2) ? HIGH_32(reg) : LOW_32(reg));
+        }
+        sw += scnprintf(buff + sw, PAGE_SIZE - sw, "net_tcp_sessions %lld\n", LOW_32(bus_data->shell_cnfg->net_debug[7]));
+    }
+
     return sw;
 }
 
@@ -257,6 +599,7 @@ ssize_t cyt_attr_cnfg_show(struct kobject *kobj, struct kobj_attribute *attr, ch
         "enabled TCP/IP: %d\n"
         "enabled AVX: %d\n"
         "enabled writeback: %d\n"
+        "coherent host memory: %d\n"
         "tlb regular order: %lld\n"
         "tlb regular assoc: %d\n"
         "tlb regular page size: %lld\n"
@@ -274,6 +617,7 @@ ssize_t cyt_attr_cnfg_show(struct kobject *kobj, struct kobj_attribute *attr, ch
         bus_data->en_tcp,
         bus_data->en_avx,
         bus_data->en_wb,
+        bus_data->coherent,
         bus_data->stlb_meta->key_size,
         bus_data->stlb_meta->assoc,
         bus_data->stlb_meta->page_size,
@@ -0,0 +1,267 @@
+/*
+ * Copyright (c) 2025,  Systems Group, ETH Zurich
+ * All rights reserved.
+ *
+ * This file is part of the Coyote device driver for Linux.
+ * Coyote can be found at: https://github.com/fpgasystems/Coyote
+ *
+ * This source code is free software; you can redistribute it and/or modify it
+ * under the terms and conditions of the GNU General Public License,
+ * version 2, as published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * The full GNU General Public License is included in this distribution in
+ * the file called "COPYING". If not found, a copy of the GNU General Public  
+ * License can be found <https://www.gnu.org/licenses/>.
+ */
+
+#include "eci.h"
+
+static uint32_t current_device = 0;
+
+void assign_device_id(struct bus_driver_data *bd_data) {
+    bd_data->dev_id = current_device++;
+    dbg_info("fpga device id %d, eci device %s\n", bd_data->dev_id, dev_name(bd_data->dma_dev));
+    sprintf(bd_data->vfpga_dev_name, "%s_%d", DEV_FPGA_NAME, bd_data->dev_id);
+    sprintf(bd_data->reconfig_dev_name, "%s_reconfig", bd_data->vfpga_dev_name);
+}
+
+int irq_setup(struct bus_driver_data *bd_data, struct platform_device *pdev) {
+    BUG_ON(!bd_data);
+
+    // vFPGA IRQ; unlike on PCI platforms, there is no DMA core whose interrupt vectors need to be programmed
+    int i, ret_val;
+    for (i = 0; i < bd_data->n_fpga_reg; i++) {
+        int vector = platform_get_irq(pdev, i);
+        if (vector < 0) {
+            pr_err("no interrupt described for vFPGA %d, ret=%d\n", i, vector);
+            ret_val = vector;
+            goto err_user;
+        }
+
+        bd_data->irq_entry[i].vector = vector;
+        ret_val = request_irq(vector, vfpga_isr, 0, COYOTE_DRIVER_NAME, &bd_data->vfpga_dev[i]);
+
+        if (ret_val) {
+            pr_err("couldn't use IRQ#%d, ret=%d\n", vector, ret_val);
+            goto err_user;
+        }
+
+        if (irq_affinity != IRQ_AFFINITY_NONE) {
+            vfpga_set_irq_affinity(&bd_data->vfpga_dev[i], cpumask_local_spread(i, dev_to_node(&pdev->dev)));
+        }
+        dbg_info("using IRQ#%d with vFPGA %d\n", vector, bd_data->vfpga_dev[i].id);
+    }
+
+    return 0;
+
+err_user:
+    while (--i >= 0) { 
+        irq_clear_affinity(bd_data->irq_entry[i].vector);
+        free_irq(bd_data->irq_entry[i].vector, &bd_data->vfpga_dev[i]); 
+    }
+    return ret_val;
+}
+
+void irq_teardown(struct bus_driver_data *bd_data) {
+    BUG_ON(!bd_data);
+
+    for (int i = 0; i < bd_data->n_fpga_reg; i++) {
+        dbg_info("releasing user IRQ%d\n", bd_data->irq_entry[i].vector);
+        irq_clear_affinity(bd_data->irq_entry[i].vector);
+        free_irq(bd_data->irq_entry[i].vector, &bd_data->vfpga_dev[i]);
+    }
+}
+
+int eci_probe(struct platform_device *pdev) {
+    int ret_val = 0;
+    dbg_info("probe (pdev = 0x%p)\n", pdev);
+
+    // Allocate memory for the device instance
+    struct bus_driver_data *bd_data = devm_kzalloc(&pdev->dev, sizeof(struct bus_driver_data), GFP_KERNEL);
+    if (!bd_data) {
+        dev_err(&pdev->dev, "device memory region not obtained\n");
+        ret_val = -ENOMEM;
+        goto err_alloc;
+    }
+
+    // Set device private bd_data; there is no PCI device, the platform device is used for the DMA allocations (e.g., writeback)
+    // Host memory is accessed coherently over ECI, so the user pages are neither mapped through the IOMMU nor flushed (see vfpga_gup.c)
+    bd_data->dma_dev = &pdev->dev;
+    bd_data->coherent = true;
+    platform_set_drvdata(pdev, bd_data);
+
+    // Obtain a (dynamic) major number for the vFPGA devices
+    bd_data->vfpga_major = VFPGA_DEV_MAJOR;
+    dev_t dev_vfpga = MKDEV(bd_data->vfpga_major, 0);
+
+    // Set unique ID for this FPGA
+    assign_device_id(bd_data);
+
+    // Memory map the static layer and shell configuration registers into the kernel space
+    void __iomem *stat_cnfg = devm_platform_ioremap_resource(pdev, ECI_RES_STAT_CONFIG);
+    void __iomem *shell_cnfg = devm_platform_ioremap_resource(pdev, ECI_RES_SHELL_CONFIG);
+    if (IS_ERR(stat_cnfg) || IS_ERR(shell_cnfg)) {
+        dev_err(&pdev->dev, "mapping of the configuration registers failed\n");
+        ret_val = IS_ERR(stat_cnfg) ? PTR_ERR(stat_cnfg) : PTR_ERR(shell_cnfg);
+        goto err_map;
+    }
+    bd_data->stat_cnfg = stat_cnfg;
+    bd_data->shell_cnfg = shell_cnfg;
+
+    // DMA addressing
+    ret_val = dma_set_mask_and_coherent(&pdev->dev, DMA_BIT_MASK(64));
+    if (ret_val) {
+        dev_err(&pdev->dev, "failed to set 64b DMA mask\n");
+        goto err_mask;
+    }
+
+    // Initialize spin locks
+    init_spin_locks(bd_data);
+
+    // Assert shell reset
+    bd_data->stat_cnfg->reconfig_eost_reset = 0x0;
+    wmb();
+    usleep_range(DMA_MIN_SLEEP_CMD, DMA_MIN_SLEEP_CMD);
+
+    bd_data->stat_cnfg->reconfig_eost_reset = 0x1;
+    wmb();
+    usleep_range(DMA_MIN_SLEEP_CMD, DMA_MIN_SLEEP_CMD);
+
+    // Read shell config
+    ret_val = read_shell_config(bd_data);
+    if (ret_val) {
+        dev_err(&pdev->dev, "cannot read shell config\n");
+        goto err_read_shell_cnfg;
+    }
+
+    // Bitstreams can only be streamed to the ICAP through the host DMA engine, which ECI does not have
+    if (bd_data->en_pr || bd_data->en_shell_pblock) {
+        dev_warn(&pdev->dev, "partial reconfiguration is not supported over ECI, the reconfiguration device is not created\n");
+    }
+
+    // Create sysfs entry
+    ret_val = create_sysfs_entry(bd_data);
+    if (ret_val) {
+        dev_err(&pdev->dev, "cannot create a sysfs entry\n");
+        goto err_sysfs;
+    }
+
+    // Allocate card memory resources
+    ret_val = allocate_card_resources(bd_data);
+    if (ret_val) {
+        dev_err(&pdev->dev, "card memory resources could not be allocated\n");
+        goto err_card_alloc; 
+    }
+
+    // Create vFPGA devices and register major
+    ret_val = alloc_vfpga_devices(bd_data, dev_vfpga);
+    if (ret_val) {
+        dev_err(&pdev->dev, "could not allocate vfpga devices\n");
+        goto err_create_fpga_dev; 
+    }
+
+    // Set-up vFPGA devices
+    ret_val = setup_vfpga_devices(bd_data);
+    if (ret_val) {
+        dev_err(&pdev->dev, "could not set-up vfpga devices\n");
+        goto err_init_fpga_dev;
+    }
+
+    // Set-up IRQs
+    ret_val = irq_setup(bd_data, pdev);
+    if (ret_val) {
+        dev_err(&pdev->dev, "IRQ setup error\n");
+        goto err_irq;
+    }
+
+    if (ret_val == 0)
+        goto end;
+
+err_irq:
+    teardown_vfpga_devices(bd_data);
+err_init_fpga_dev:
+    free_vfpga_devices(bd_data);
+err_create_fpga_dev:
+    free_card_resources(bd_data);
+err_card_alloc:
+    remove_sysfs_entry(bd_data);
+err_sysfs:
+err_read_shell_cnfg:
+err_mask:
+err_map:
+err_alloc:
+end:
+    dbg_info("probe returning %d\n", ret_val);
+    return ret_val;
+}
+
+void eci_remove(struct platform_device *pdev) {
+    struct bus_driver_data *bd_data = (struct bus_driver_data *) platform_get_drvdata(pdev);
+
+    // Remove interrupts
+    irq_teardown(bd_data);
+    dbg_info("interrupts disabled\n");
+
+    // Clear and release vFPGA devices 
+    teardown_vfpga_devices(bd_data);
+    free_vfpga_devices(bd_data);
+    dbg_info("vfpga devices released\n");
+
+    // Deallocate card resources
+    free_card_resources(bd_data);
+    dbg_info("card memory resources released\n");
+
+    // Remove sysfs entry
+    remove_sysfs_entry(bd_data);
+    dbg_info("sysfs remove\n");
+
+    // The configuration registers and the device bd_data memory are released with the platform device (devm_*)
+    dbg_info("removal completed\n");
+}
+
+#if LINUX_VERSION_CODE < KERNEL_VERSION(6, 11, 0)
+// Before Linux 6.11, the remove callback of a platform driver returns an int
+static int eci_remove_legacy(struct platform_device *pdev) {
+    eci_remove(pdev);
+    return 0;
+}
+#endif
+
+// Device tree nodes of the Coyote-enabled FPGAs on Enzian; see eci.h for the expected resources
+static const struct of_device_id eci_ids[] = {
+    { .compatible = "ethz,enzian-coyote", },
+    {}
+};
+MODULE_DEVICE_TABLE(of, eci_ids);
+
+static struct platform_driver eci_driver = {
+    .driver = {
+        .name = COYOTE_DRIVER_NAME,
+        .of_match_table = eci_ids,
+    },
+    .probe = eci_probe,
+    #if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 11, 0)
+    .remove = eci_remove,
+    #else
+    .remove = eci_remove_legacy,
+    #endif
+};
+
+int eci_init(void) {
+    int ret_val = platform_driver_register(&eci_driver);
+    if (ret_val) {
+        pr_err("failed to register coyote eci driver, ret_val %d\n", ret_val);
+        return ret_val;
+    }
+
+    return 0;
+}
+
+void eci_exit(void) {
+    platform_driver_unregister(&eci_driver);
+}
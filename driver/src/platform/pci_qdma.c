@@ -52,6 +52,9 @@ int irq_setup(struct bus_driver_data *bd_data, struct pci_dev *pdev, bool enable
             goto err_user;
         }
 
+        if (irq_affinity != IRQ_AFFINITY_NONE) {
+            vfpga_set_irq_affinity(&bd_data->vfpga_dev[i], cpumask_local_spread(i, dev_to_node(&pdev->dev)));
+        }
         dbg_info("using IRQ#%d with vFPGA %d\n", vector, bd_data->vfpga_dev[i].id);
     }
 
@@ -72,11 +75,17 @@ int irq_setup(struct bus_driver_data *bd_data, struct pci_dev *pdev, bool enable
     return ret_val;
 
 err_reconfig:
-    for (i = 0; i < bd_data->n_fpga_reg; i++) { free_irq(bd_data->irq_entry[i].vector, &bd_data->vfpga_dev[i]); }
+    for (i = 0; i < bd_data->n_fpga_reg; i++) { 
+        irq_clear_affinity(bd_data->irq_entry[i].vector);
+        free_irq(bd_data->irq_entry[i].vector, &bd_data->vfpga_dev[i]); 
+    }
     return ret_val;
 
 err_user:
-    while (--i >= 0) { free_irq(bd_data->irq_entry[i].vector, &bd_data->vfpga_dev[i]); }
+    while (--i >= 0) { 
+        irq_clear_affinity(bd_data->irq_entry[i].vector);
+        free_irq(bd_data->irq_entry[i].vector, &bd_data->vfpga_dev[i]); 
+    }
     return ret_val;
 }
 
@@ -85,6 +94,7 @@ void irq_teardown(struct bus_driver_data *bd_data, bool enable_reconfig_irq) {
 
     for (int i = 0; i < bd_data->n_fpga_reg; i++) {
         dbg_info("releasing user IRQ%d\n", bd_data->irq_entry[i].vector);
+        irq_clear_affinity(bd_data->irq_entry[i].vector);
         free_irq(bd_data->irq_entry[i].vector, &bd_data->vfpga_dev[i]);
     }
         
@@ -479,28 +489,23 @@ fail:
     return -1;
 }
 
-int enable_queues(struct bus_driver_data *bd_data) {
-    BUG_ON(!bd_data);
-    int ret_val = 0;
-
+void write_fmap(struct bus_driver_data *bd_data, uint32_t func, uint32_t qbase, uint32_t n_queues) {
     // Initialize the register mask to all 1s, i.e. all bits in data registers are valid    
     for (int i = 0; i < QDMA_CTX_N_DATA_REGS; i++) {
         iowrite32(QDMA_CXT_MASK_DEF_VAL, bd_data->bar[BAR_DMA_CONFIG] + QDMA_CTX_MASK_REG_START + i * 4);
         wmb();
     }
-    usleep_range(DMA_MIN_SLEEP_CMD, DMA_MIN_SLEEP_CMD);
 
-    // Populate the function map table, per Table 149 in QDMA specification from PG347 (v3.4) 
-    // The QDMA allows to separate queues per physical function, providing full isolation between functions
-    // Currently, Coyote only supports one PF per FPGA, hence we will enable all queues for this PF
+    // Function map context, per Table 149 in QDMA specification from PG347 (v3.4): QID base, followed by the number of queues
+    // The QDMA allows to separate queues per function (physical or virtual), providing full isolation between functions
     for (int i = 0; i < QDMA_CTX_N_DATA_REGS; i++) {
         if (i == 0) {   
             // Set QID base
-            iowrite32(0, bd_data->bar[BAR_DMA_CONFIG] + QDMA_CTX_DATA_REG_START + i * 4);
+            iowrite32(qbase, bd_data->bar[BAR_DMA_CONFIG] + QDMA_CTX_DATA_REG_START + i * 4);
             wmb();
         } else if (i == 1) {
             // Set maximum queue ID
-            iowrite32(QDMA_N_QUEUES - 1, bd_data->bar[BAR_DMA_CONFIG] + QDMA_CTX_DATA_REG_START + i * 4);
+            iowrite32(n_queues ? n_queues - 1 : 0, bd_data->bar[BAR_DMA_CONFIG] + QDMA_CTX_DATA_REG_START + i * 4);
             wmb();
         } else {
             iowrite32(0, bd_data->bar[BAR_DMA_CONFIG] + QDMA_CTX_DATA_REG_START + i * 4);
@@ -508,13 +513,23 @@ int enable_queues(struct bus_driver_data *bd_data) {
         }
     }
 
+    // For the function map, the QID field of the context command holds the function ID
     int32_t reg_val = QDMA_CTX_BUSY_VAL_DEAULT |
                       ((QDMA_CTXT_SELC_FMAP & QDMA_CTX_SEL_MASK) << QDMA_CTX_SEL_SHIFT) |
-                      ((QDMA_CTX_WR & QDMA_CTX_OP_MASK) << QDMA_CTX_OP_SHIFT) |
-                      ((0 & QDMA_CTX_QID_MASK) << QDMA_CTX_QID_SHIFT);
+                      (((n_queues ? QDMA_CTX_WR : QDMA_CTX_CLR) & QDMA_CTX_OP_MASK) << QDMA_CTX_OP_SHIFT) |
+                      ((func & QDMA_CTX_QID_MASK) << QDMA_CTX_QID_SHIFT);
     iowrite32(reg_val, bd_data->bar[BAR_DMA_CONFIG] + QDMA_CTX_CMD_REG);
     wmb();
     usleep_range(DMA_MIN_SLEEP_CMD, DMA_MIN_SLEEP_CMD);
+}
+
+int enable_queues(struct bus_driver_data *bd_data) {
+    BUG_ON(!bd_data);
+    int ret_val = 0;
+
+    // Populate the function map table; the PF (function 0) owns the first QDMA_N_QUEUES queues
+    // The queues of the SR-IOV virtual functions, if any, are mapped in pci_sriov_configure
+    write_fmap(bd_data, 0, 0, QDMA_N_QUEUES);
     dbg_info("initialized function map table");
 
     // Program host profile (required for MM transfers)
@@ -709,19 +724,25 @@ end:
     return ret_val;
 }
 
-void shell_pci_remove(struct bus_driver_data *bd_data) {
-    dbg_info("removing shell...\n");
-
-    // Free HMM chunks
-    #ifdef HMM_KERNEL    
-        free_mem_regions(bd_data);
-        dbg_info("freed svm private pages");
-    #endif
-
+void shell_pci_quiesce(struct bus_driver_data *bd_data) {
     // Disable and remove vFPGA interrupts
     irq_teardown(bd_data, false);
     dbg_info("vfpga interrupts disabled\n");
+}
 
+int shell_pci_resume(struct bus_driver_data *bd_data) {
+    // Set-up vFPGAs IRQs of the new shell; the vFPGA devices themselves are kept
+    int ret_val = irq_setup(bd_data, bd_data->pci_dev, false);
+    if (ret_val) {
+        pr_err("IRQ setup error\n");
+        return ret_val;
+    }
+
+    dbg_info("vfpga interrupts enabled\n");
+    return 0;
+}
+
+void shell_pci_release(struct bus_driver_data *bd_data) {
     // Clear and release vFPGAs devices
     teardown_vfpga_devices(bd_data);
     free_vfpga_devices(bd_data);
@@ -738,6 +759,19 @@ void shell_pci_remove(struct bus_driver_data *bd_data) {
     dbg_info("shell removed\n");
 }
 
+void shell_pci_remove(struct bus_driver_data *bd_data) {
+    dbg_info("removing shell...\n");
+
+    // Free HMM chunks
+    #ifdef HMM_KERNEL    
+        free_mem_regions(bd_data);
+        dbg_info("freed svm private pages");
+    #endif
+
+    shell_pci_quiesce(bd_data);
+    shell_pci_release(bd_data);
+}
+
 int pci_probe(struct pci_dev *pdev, const struct pci_device_id *id) {
     int ret_val = 0;
     dbg_info("probe (pdev = 0x%p, pci_id = 0x%p)\n", pdev, id);
@@ -751,6 +785,7 @@ int pci_probe(struct pci_dev *pdev, const struct pci_device_id *id) {
 
     // Set device private bd_data; so that we can access it later (both the PCI device and the bus driver bd_data)
     bd_data->pci_dev = pdev;
+    bd_data->dma_dev = &pdev->dev;
     dev_set_drvdata(&pdev->dev, bd_data);
 
     // Obtain a (dynamic) major and minor number for the vFPGA device and reconfig device
@@ -930,9 +965,71 @@ end:
     return ret_val;
 }
 
+int pci_sriov_configure(struct pci_dev *pdev, int num_vfs) {
+    struct bus_driver_data *bd_data = (struct bus_driver_data *) dev_get_drvdata(&pdev->dev);
+    BUG_ON(!bd_data);
+
+    // Disable; the VFs are removed (and detached from their guests) before the vFPGAs are returned to the host
+    if (num_vfs == 0) {
+        int n_vfs = pci_num_vf(pdev);
+        pci_disable_sriov(pdev);
+        for (int i = 0; i < n_vfs; i++) {
+            write_fmap(bd_data, pci_iov_virtfn_devfn(pdev, i) & 0xff, 0, 0);
+            bd_data->vfpga_dev[i].vf_owned = false;
+        }
+        dev_info(&pdev->dev, "disabled %d virtual functions\n", n_vfs);
+        return 0;
+    }
+
+    // The number of VFs can only be changed by disabling them first (standard sriov_numvfs semantics)
+    if (pci_num_vf(pdev)) {
+        return -EBUSY;
+    }
+
+    // Each VF exposes exactly one vFPGA; VF i owns vFPGA i
+    if (num_vfs > bd_data->n_fpga_reg || num_vfs > pci_sriov_get_totalvfs(pdev)) {
+        dev_err(&pdev->dev, "cannot enable %d virtual functions, %d vFPGAs and %d VFs available\n", 
+            num_vfs, bd_data->n_fpga_reg, pci_sriov_get_totalvfs(pdev));
+        return -EINVAL;
+    }
+
+    // vFPGAs used by host processes can't be handed to a guest
+    for (int i = 0; i < num_vfs; i++) {
+        if (bd_data->vfpga_dev[i].ref_cnt) {
+            dev_err(&pdev->dev, "vFPGA %d is in use, cannot expose it as a virtual function\n", i);
+            return -EBUSY;
+        }
+    }
+
+    // Give each VF a disjoint window of queues, after those of the PF, before any VF driver can probe
+    // The DMA of a VF carries its own requester ID, and is therefore translated by the IOMMU domain of the guest it is assigned to
+    for (int i = 0; i < num_vfs; i++) {
+        bd_data->vfpga_dev[i].vf_owned = true;
+        write_fmap(bd_data, pci_iov_virtfn_devfn(pdev, i) & 0xff, QDMA_VF_QUEUE_BASE + i * QDMA_VF_N_QUEUES, QDMA_VF_N_QUEUES);
+    }
+
+    int ret_val = pci_enable_sriov(pdev, num_vfs);
+    if (ret_val) {
+        dev_err(&pdev->dev, "could not enable %d virtual functions, ret_val %d\n", num_vfs, ret_val);
+        for (int i = 0; i < num_vfs; i++) {
+            write_fmap(bd_data, pci_iov_virtfn_devfn(pdev, i) & 0xff, 0, 0);
+            bd_data->vfpga_dev[i].vf_owned = false;
+        }
+        return ret_val;
+    }
+
+    dev_info(&pdev->dev, "enabled %d virtual functions\n", num_vfs);
+    return num_vfs;
+}
+
 void pci_remove(struct pci_dev *pdev) {
     struct bus_driver_data *bd_data = (struct bus_driver_data *) dev_get_drvdata(&pdev->dev);
 
+    // Remove the virtual functions, if any
+    if (pci_num_vf(pdev)) {
+        pci_sriov_configure(pdev, 0);
+    }
+
     // Free HMM chunks
     #ifdef HMM_KERNEL    
         free_mem_regions(bd_data);
@@ -1016,6 +1113,7 @@ static struct pci_driver pci_driver = {
     .id_table = pci_ids,
     .probe = pci_probe,
     .remove = pci_remove,
+    .sriov_configure = pci_sriov_configure,
 };
 
 int pci_init(void) {
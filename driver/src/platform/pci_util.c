@@ -52,4 +52,43 @@ uint32_t build_vector_reg(uint32_t a, uint32_t b, uint32_t c, uint32_t d) {
     reg_val |= (d & 0x1f) << 24;
 
     return reg_val;
-}
\ No newline at end of file
+}
+
+int vfpga_set_irq_affinity(struct vfpga_dev *device, int cpu) {
+    BUG_ON(!device);
+    uint32_t vector = device->bd_data->irq_entry[device->id].vector;
+
+    if (cpu < 0) {
+        irq_clear_affinity(vector);
+        device->irq_cpu = -1;
+        return 0;
+    }
+
+    if (cpu >= nr_cpu_ids || !cpu_online(cpu)) {
+        pr_warn("cannot pin IRQ#%d of vFPGA %d to CPU %d, CPU not online\n", vector, device->id, cpu);
+        return -EINVAL;
+    }
+
+    #if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 17, 0)
+    int ret_val = irq_set_affinity_and_hint(vector, cpumask_of(cpu));
+    #else
+    int ret_val = irq_set_affinity_hint(vector, cpumask_of(cpu));
+    #endif
+
+    if (ret_val) {
+        pr_warn("could not set the affinity of IRQ#%d to CPU %d, ret=%d\n", vector, cpu, ret_val);
+        return ret_val;
+    }
+
+    device->irq_cpu = cpu;
+    dbg_info("IRQ#%d of vFPGA %d affine to CPU %d\n", vector, device->id, cpu);
+    return 0;
+}
+
+void irq_clear_affinity(uint32_t vector) {
+    #if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 17, 0)
+    irq_update_affinity_hint(vector, NULL);
+    #else
+    irq_set_affinity_hint(vector, NULL);
+    #endif
+}
@@ -106,6 +106,9 @@ int irq_setup(struct bus_driver_data *bd_data, struct pci_dev *pdev, bool enable
             goto err_user;
         }
 
+        if (irq_affinity != IRQ_AFFINITY_NONE) {
+            vfpga_set_irq_affinity(&bd_data->vfpga_dev[i], cpumask_local_spread(i, dev_to_node(&pdev->dev)));
+        }
         dbg_info("using IRQ#%d with vFPGA %d\n", vector, bd_data->vfpga_dev[i].id);
     }
 
@@ -130,11 +133,17 @@ int irq_setup(struct bus_driver_data *bd_data, struct pci_dev *pdev, bool enable
     return ret_val;
 
 err_reconfig:
-    for (i = 0; i < bd_data->n_fpga_reg; i++) { free_irq(bd_data->irq_entry[i].vector, &bd_data->vfpga_dev[i]); }
+    for (i = 0; i < bd_data->n_fpga_reg; i++) { 
+        irq_clear_affinity(bd_data->irq_entry[i].vector);
+        free_irq(bd_data->irq_entry[i].vector, &bd_data->vfpga_dev[i]); 
+    }
     return ret_val;
 
 err_user:
-    while (--i >= 0) { free_irq(bd_data->irq_entry[i].vector, &bd_data->vfpga_dev[i]); }
+    while (--i >= 0) { 
+        irq_clear_affinity(bd_data->irq_entry[i].vector);
+        free_irq(bd_data->irq_entry[i].vector, &bd_data->vfpga_dev[i]); 
+    }
     return ret_val;
 }
 
@@ -143,6 +152,7 @@ void irq_teardown(struct bus_driver_data *bd_data, bool enable_reconfig_irq) {
 
     for (int i = 0; i < bd_data->n_fpga_reg; i++) {
         dbg_info("releasing user IRQ%d\n", bd_data->irq_entry[i].vector);
+        irq_clear_affinity(bd_data->irq_entry[i].vector);
         free_irq(bd_data->irq_entry[i].vector, &bd_data->vfpga_dev[i]);
     }
         
@@ -520,20 +530,28 @@ end:
     return ret_val;
 }
 
-void shell_pci_remove(struct bus_driver_data *bd_data) {
-    dbg_info("removing shell...\n");
-
-    // Free HMM chunks
-    #ifdef HMM_KERNEL    
-        free_mem_regions(bd_data);
-        dbg_info("freed svm private pages");
-    #endif
-
+void shell_pci_quiesce(struct bus_driver_data *bd_data) {
     // Disable and remove vFPGA interrupts
     vfpga_interrupts_disable(bd_data);
     irq_teardown(bd_data, false);
     dbg_info("vfpga interrupts disabled\n");
+}
+
+int shell_pci_resume(struct bus_driver_data *bd_data) {
+    // Set-up vFPGAs IRQs of the new shell; the vFPGA devices themselves are kept
+    int ret_val = irq_setup(bd_data, bd_data->pci_dev, false);
+    if (ret_val) {
+        pr_err("IRQ setup error\n");
+        return ret_val;
+    }
+    vfpga_interrupts_enable(bd_data);
+    read_interrupts(bd_data);
 
+    dbg_info("vfpga interrupts enabled\n");
+    return 0;
+}
+
+void shell_pci_release(struct bus_driver_data *bd_data) {
     // Clear and release vFPGAs devices
     teardown_vfpga_devices(bd_data);
     free_vfpga_devices(bd_data);
@@ -550,6 +568,19 @@ void shell_pci_remove(struct bus_driver_data *bd_data) {
     dbg_info("shell removed\n");
 }
 
+void shell_pci_remove(struct bus_driver_data *bd_data) {
+    dbg_info("removing shell...\n");
+
+    // Free HMM chunks
+    #ifdef HMM_KERNEL    
+        free_mem_regions(bd_data);
+        dbg_info("freed svm private pages");
+    #endif
+
+    shell_pci_quiesce(bd_data);
+    shell_pci_release(bd_data);
+}
+
 int pci_probe(struct pci_dev *pdev, const struct pci_device_id *id) {
     int ret_val = 0;
     dbg_info("probe (pdev = 0x%p, pci_id = 0x%p)\n", pdev, id);
@@ -563,6 +594,7 @@ int pci_probe(struct pci_dev *pdev, const struct pci_device_id *id) {
 
     // Set device private bd_data; so that we can access it later (both the PCI device and the bus driver bd_data)
     bd_data->pci_dev = pdev;
+    bd_data->dma_dev = &pdev->dev;
     dev_set_drvdata(&pdev->dev, bd_data);
 
     // Obtain a (dynamic) major and minor number for the vFPGA device and reconfig device
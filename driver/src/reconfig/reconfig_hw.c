@@ -21,6 +21,17 @@
 
 #include "reconfig_hw.h"
 
+// Writes one PR descriptor to the static layer's descriptor FIFO
+static void write_reconfig_desc(struct bus_driver_data *bus_data, uint64_t paddr, uint64_t len, bool last) {
+    bus_data->stat_cnfg->reconfig_addr_low = LOW_32(paddr);
+    bus_data->stat_cnfg->reconfig_addr_high = HIGH_32(paddr);
+    bus_data->stat_cnfg->reconfig_len = len;
+    wmb();
+
+    bus_data->stat_cnfg->reconfig_ctrl = last ? RECONFIG_CTRL_START_LAST : RECONFIG_CTRL_START_MIDDLE;
+    wmb();
+}
+
 int reconfigure_start(struct reconfig_dev *device, uint64_t vaddr, uint64_t len, pid_t pid, uint32_t crid) {
     int ret_val = 1;
 
@@ -31,52 +42,46 @@ int reconfigure_start(struct reconfig_dev *device, uint64_t vaddr, uint64_t len,
 
     // Iterate through all the entries of allocated buffers
     // Where the virtual address, PID and configuration ID (crid) match, trigger reconfig by writing to FPGA memory
-    int cmd_sent = 0;
     struct reconfig_buff_metadata *tmp_buff;
     hash_for_each_possible(reconfig_buffs_map, tmp_buff, entry, vaddr) {
         if (tmp_buff->vaddr == vaddr && tmp_buff->pid == pid && tmp_buff->crid == crid) {
+            if (len > (uint64_t) tmp_buff->n_pages * RECONFIG_BUFF_PAGE_SIZE) {
+                pr_warn("bitstream length %lld B exceeds the reconfig buffer, %d pages\n", len, tmp_buff->n_pages);
+                break;
+            }
+
             uint64_t n_bistream_full_pages = len / RECONFIG_BUFF_PAGE_SIZE;
             uint64_t partial_bitsream_size = len % RECONFIG_BUFF_PAGE_SIZE;
+            uint64_t n_desc = n_bistream_full_pages + (partial_bitsream_size > 0);
             dbg_info(
                 "reconfig bitstream: full pages %lld (hugepages), partial %lld B\n", 
                 n_bistream_full_pages, partial_bitsream_size
             );
 
-            // Write full pages, sequentially; but make sure not to over-saturate with writes (cmd_sent)
-            for (int i = 0; i < n_bistream_full_pages; i++) {
-                while (cmd_sent >= RECONFIG_THRESHOLD) {
-                    cmd_sent = bus_data->stat_cnfg->reconfig_ctrl;
+            device->start_ns = ktime_get_ns();
+            device->curr_len = len;
+
+            // The descriptor FIFO drops descriptors written while it's full, so its occupancy (read from reconfig_ctrl) bounds each batch
+            // Each batch fills the FIFO completely; the driver then sleeps until about half of it was consumed by the ICAP,
+            // based on the bandwidth of the last reconfiguration, so the FIFO never runs empty while the CPU is mostly idle
+            uint64_t drain_us = div64_u64((RECONFIG_FIFO_DEPTH / 2) * RECONFIG_BUFF_PAGE_SIZE, max_t(uint64_t, device->bw, 1));
+            uint64_t i = 0;
+            while (i < n_desc) {
+                uint32_t used = bus_data->stat_cnfg->reconfig_ctrl;
+                uint32_t n_free = (used < RECONFIG_FIFO_DEPTH) ? RECONFIG_FIFO_DEPTH - used : 0;
+                if (n_free == 0) {
                     usleep_range(RECONFIG_MIN_SLEEP_CMD, RECONFIG_MAX_SLEEP_CMD);
+                    continue;
                 }
 
-                bus_data->stat_cnfg->reconfig_addr_low = LOW_32(tmp_buff->hpages[i]);
-                bus_data->stat_cnfg->reconfig_addr_high = HIGH_32(tmp_buff->hpages[i]);
-                bus_data->stat_cnfg->reconfig_len = RECONFIG_BUFF_PAGE_SIZE;
-                wmb();
-                
-                if (partial_bitsream_size == 0 && i == n_bistream_full_pages - 1) {
-                    bus_data->stat_cnfg->reconfig_ctrl = RECONFIG_CTRL_START_LAST;
-                } else {
-                    bus_data->stat_cnfg->reconfig_ctrl = RECONFIG_CTRL_START_MIDDLE;
+                for (; n_free > 0 && i < n_desc; n_free--, i++) {
+                    uint64_t desc_len = (i < n_bistream_full_pages) ? RECONFIG_BUFF_PAGE_SIZE : partial_bitsream_size;
+                    write_reconfig_desc(bus_data, tmp_buff->hpages[i], desc_len, i == n_desc - 1);
                 }
-                wmb();
-            }
 
-            // Write the last partial page
-            if (partial_bitsream_size > 0) {
-                while(cmd_sent >= RECONFIG_THRESHOLD) {
-                    cmd_sent = bus_data->stat_cnfg->reconfig_ctrl;
-                    usleep_range(RECONFIG_MIN_SLEEP_CMD, RECONFIG_MAX_SLEEP_CMD);
+                if (i < n_desc) {
+                    usleep_range(drain_us, drain_us + drain_us / 4);
                 }
-                
-                bus_data->stat_cnfg->reconfig_addr_low = LOW_32(tmp_buff->hpages[n_bistream_full_pages]);
-                bus_data->stat_cnfg->reconfig_addr_high = HIGH_32(tmp_buff->hpages[n_bistream_full_pages]);
-                bus_data->stat_cnfg->reconfig_len = partial_bitsream_size;
-                wmb();
-
-                bus_data->stat_cnfg->reconfig_ctrl = RECONFIG_CTRL_START_LAST;
-                wmb();
-                cmd_sent++;
             }
 
             ret_val = 0;
@@ -84,4 +89,92 @@ int reconfigure_start(struct reconfig_dev *device, uint64_t vaddr, uint64_t len,
     }
 
     return ret_val;
-}
\ No newline at end of file
+}
+
+void reconfigure_wait(struct reconfig_dev *device) {
+    BUG_ON(!device);
+
+    // The static layer raises the reconfiguration IRQ once the end of start-up is reached; see reconfig_isr.c
+    wait_event_interruptible(device->waitqueue_rcnfg, atomic_read(&device->wait_rcnfg) == FLAG_SET);
+    atomic_set(&device->wait_rcnfg, FLAG_CLR);
+
+    // Bytes per us equal MB/s
+    device->last_ns = ktime_get_ns() - device->start_ns;
+    device->last_len = device->curr_len;
+    uint64_t last_us = div64_u64(device->last_ns, 1000);
+    if (last_us > 0 && device->last_len >= RECONFIG_BUFF_PAGE_SIZE) {
+        device->bw = div64_u64(device->last_len, last_us);
+    }
+
+    dbg_info("reconfiguration of %lld B took %lld us, %lld MB/s\n", device->last_len, last_us, last_us ? div64_u64(device->last_len, last_us) : 0);
+}
+
+void icap_acquire(struct reconfig_dev *device) {
+    // Uninterruptible, since a ticket which is never served would stall all the reconfigurations queued behind it
+    uint64_t ticket = atomic64_inc_return(&device->icap_next) - 1;
+    dbg_info("waiting for the ICAP, ticket %lld\n", ticket);
+    wait_event(device->waitqueue_icap, atomic64_read(&device->icap_serving) == ticket);
+}
+
+void icap_release(struct reconfig_dev *device) {
+    atomic64_inc(&device->icap_serving);
+    wake_up_all(&device->waitqueue_icap);
+}
+
+int reconfigure_app(struct reconfig_dev *device, uint64_t vaddr, uint64_t len, pid_t pid, uint32_t crid, uint32_t vfid) {
+    BUG_ON(!device);
+    struct bus_driver_data *bus_data = device->bd_data;
+    BUG_ON(!bus_data);
+
+    dbg_info("trying to obtain reconfig lock, vFPGA %d\n", vfid);
+    uint64_t start_time = ktime_get_ns();
+    
+    // Lock the region, to avoid multiple reconfigurations of the same vFPGA at the same time
+    mutex_lock(&device->region_lock[vfid]);
+
+    // Decouple; the vFPGA stays decoupled while the reconfiguration waits for the ICAP
+    bus_data->shell_cnfg->reconfig_dcpl_app_set = (1 << vfid);
+    icap_acquire(device);
+
+    // Reconfigure and wait until completion
+    int ret_val = reconfigure_start(device, vaddr, len, pid, crid);
+    if (ret_val != 0) {
+        pr_warn("app reconfiguration not successful, return %d\n", ret_val);
+        icap_release(device);
+        bus_data->shell_cnfg->reconfig_dcpl_app_clr = (1 << vfid);
+        mutex_unlock(&device->region_lock[vfid]);
+        return -1;
+    }
+
+    reconfigure_wait(device);
+    icap_release(device);
+
+    // Couple and unlock the region
+    dbg_info("app reconfiguration complete, coupling the design and unlocking the region\n");
+    bus_data->shell_cnfg->reconfig_dcpl_app_clr = (1 << vfid);
+    mutex_unlock(&device->region_lock[vfid]);
+
+    uint64_t stop_time = ktime_get_ns();
+    dbg_info("app reconfiguration time %llu ms\n", (stop_time - start_time) / (1000 * 1000));
+    return 0;
+}
+
+void reconfigure_app_work(struct work_struct *work) {
+    struct reconfig_async *req = container_of(work, struct reconfig_async, work);
+    struct reconfig_dev *device = req->device;
+    uint32_t vfid = req - device->async_req;
+
+    req->ret_val = reconfigure_app(device, req->args[0], req->args[1], req->args[2], req->args[3], vfid);
+
+    // The result must be visible before the vFPGA can be reconfigured again and before the user space is woken up
+    struct eventfd_ctx *efd = req->efd;
+    req->efd = NULL;
+    clear_bit_unlock(vfid, &device->async_pending);
+
+    #if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 8, 0)
+        eventfd_signal(efd);
+    #else
+        eventfd_signal(efd, 1);
+    #endif
+    eventfd_ctx_put(efd);
+}
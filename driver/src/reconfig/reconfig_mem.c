@@ -25,121 +25,430 @@
 // Data-type of each entry is reconfig_buff_metadata (see coyote_dev.h)
 struct hlist_head reconfig_buffs_map[1 << (RECONFIG_HASH_TABLE_ORDER)]; 
 
-int alloc_reconfig_buffer(struct reconfig_dev *device, unsigned long n_pages, pid_t pid, uint32_t crid) {
-    BUG_ON(!device);
-    
-    // Reconfig buffers are first allocated, then mapped to user-space and finally, used to load the bitstream
-    // Whenever buffers have been allocated and mapped, the variable n_pages is reset to 0
-    // When different than zero, it means multiple allocations have occured but haven't been propagated to the user-space
-    // Ideally, this should be prevented, as it means there are kernel-space allocated buffers that the user doesn't use
-    if (device->curr_buff.n_pages) {
-        pr_warn("allocated reconfig buffers exist but have not been mapped\n");
-        return -1;
+// Buffers allocated, but not yet mapped to the user space; indexed by the host PID, since mmap doesn't carry any other identifier
+struct hlist_head reconfig_pending_map[1 << (RECONFIG_HASH_TABLE_ORDER)];
+
+// Bitstream cache, indexed by the hash of the bitstream contents; entries are also kept in LRU order (reconfig_dev->cache_lru)
+struct hlist_head reconfig_cache_map[1 << (RECONFIG_HASH_TABLE_ORDER)];
+
+// FNV-1a, 64-bit; must match hashBytes in cRcnfg.cpp
+#define FNV_OFFSET_BASIS 0xcbf29ce484222325ULL
+#define FNV_PRIME 0x100000001b3ULL
+
+static uint64_t fnv1a(const uint8_t *data, uint64_t len, uint64_t hash) {
+    for (uint64_t i = 0; i < len; i++) {
+        hash = (hash ^ data[i]) * FNV_PRIME;
     }
+    return hash;
+}
 
-    // Lock, preventing multiple simultaneous allocations
-    spin_lock(&device->mem_lock);
+// Returns the pending buffer of a process, if any; must be called with mem_lock held
+static struct reconfig_buff_metadata *find_pending_buffer(pid_t pid) {
+    struct reconfig_buff_metadata *tmp_buff;
+    hash_for_each_possible(reconfig_pending_map, tmp_buff, entry, pid) {
+        if (tmp_buff->pid == pid) {
+            return tmp_buff;
+        }
+    }
+    return NULL;
+}
 
-    if (n_pages > MAX_RECONFIG_BUFF_NUM) {
-        dbg_info("requested reconfig buffer too large: %lu pages, max %d pages\n", n_pages, MAX_RECONFIG_BUFF_NUM); 
-        spin_unlock(&device->mem_lock); 
-        return -ENOMEM;
-    } else {
-        device->curr_buff.n_pages = n_pages;
+// Returns the cache entry of a bitstream, if any; must be called with mem_lock held
+static struct reconfig_cache_entry *find_cache_entry(uint64_t hash, uint64_t len) {
+    struct reconfig_cache_entry *cached;
+    hash_for_each_possible(reconfig_cache_map, cached, entry, hash) {
+        if (cached->hash == hash && cached->len == len) {
+            return cached;
+        }
     }
-    
+    return NULL;
+}
+
+// Allocates reconfiguration pages and maps them for DMA; the allocation may sleep, so no lock may be held
+static int alloc_reconfig_pages(struct reconfig_dev *device, uint32_t n_pages, struct page ***pages, uint64_t **hpages) {
     // Allocate page pointer array; each entry is a pointer to a page allocated below (alloc_pages) 
-    device->curr_buff.pages = vmalloc(n_pages * sizeof(*device->curr_buff.pages));
-    if (device->curr_buff.pages == NULL) {
+    *pages = vmalloc(n_pages * sizeof(**pages));
+    if (*pages == NULL) {
         pr_warn("failed to allocate page pointer array for reconfig buffers");
         return -ENOMEM;
     }
     dbg_info(
-        "allocated %lu bytes for page pointer array for %ld n_pages of a reconfig buffer, ptr 0x%p\n",
-        n_pages * sizeof(*device->curr_buff.pages), n_pages, device->curr_buff.pages
+        "allocated %lu bytes for page pointer array for %d n_pages of a reconfig buffer, ptr 0x%p\n",
+        n_pages * sizeof(**pages), n_pages, *pages
     );
     
-    // Allocate the pages for this buffer
     int i;
-    for (i = 0; i < device->curr_buff.n_pages; i++) {
-        device->curr_buff.pages[i] = alloc_pages(GFP_ATOMIC, RECONFIG_BUFF_PAGE_SHIFT - PAGE_SHIFT);
-        if (!device->curr_buff.pages[i]) {
+    for (i = 0; i < n_pages; i++) {
+        (*pages)[i] = alloc_pages(GFP_KERNEL, RECONFIG_BUFF_PAGE_SHIFT - PAGE_SHIFT);
+        if (!(*pages)[i]) {
             pr_warn("reconfig buffer page %d could not be allocated\n", i);
             goto fail_alloc;
         }
     }
 
     // Obtain physical addresses for each page
-    device->curr_buff.hpages = vmalloc(device->curr_buff.n_pages * sizeof(uint64_t));
-    if (device->curr_buff.hpages == NULL) {
+    *hpages = vmalloc(n_pages * sizeof(uint64_t));
+    if (*hpages == NULL) {
         pr_warn("failed to allocate physical address array for reconfig buffers");
         goto fail_alloc;
     }
 
-    for (i = 0; i < device->curr_buff.n_pages; i++) {
-        device->curr_buff.hpages[i] = dma_map_single(
-            &device->bd_data->pci_dev->dev,
-            page_to_virt(device->curr_buff.pages[i]),
+    for (i = 0; i < n_pages; i++) {
+        (*hpages)[i] = dma_map_single(
+            device->bd_data->dma_dev,
+            page_to_virt((*pages)[i]),
             RECONFIG_BUFF_PAGE_SIZE,
             DMA_TO_DEVICE
         );
 
-        if (dma_mapping_error(&device->bd_data->pci_dev->dev, device->curr_buff.hpages[i])) {
+        if (dma_mapping_error(device->bd_data->dma_dev, (*hpages)[i])) {
             pr_warn("failed to map reconfig page %d and obtain its physical address", i);
             goto fail_dma_map;
         }
     }
-
-    device->curr_buff.pid = pid;
-    device->curr_buff.crid = crid;
-    spin_unlock(&device->mem_lock);
     return 0;
 
 fail_dma_map:
     // Unmap DMA
     for (int j = 0; j < i; j++) {
-        dma_unmap_single(&device->bd_data->pci_dev->dev, device->curr_buff.hpages[j], RECONFIG_BUFF_PAGE_SIZE, DMA_TO_DEVICE);
+        dma_unmap_single(device->bd_data->dma_dev, (*hpages)[j], RECONFIG_BUFF_PAGE_SIZE, DMA_TO_DEVICE);
     }
-    vfree(device->curr_buff.hpages);
-    i = device->curr_buff.n_pages;
+    vfree(*hpages);
+    i = n_pages;
 
 fail_alloc:
     // Couldn't allocate all the required pages; free the ones that were actually allocated
     while (i) {
-        __free_pages(device->curr_buff.pages[--i], RECONFIG_BUFF_PAGE_SHIFT - PAGE_SHIFT);
+        __free_pages((*pages)[--i], RECONFIG_BUFF_PAGE_SHIFT - PAGE_SHIFT);
     }
-    device->curr_buff.n_pages = 0;
-    vfree(device->curr_buff.pages);
+    vfree(*pages);
 
-    spin_unlock(&device->mem_lock);
     return -ENOMEM;
 }
 
+// Unmaps and frees pages allocated with alloc_reconfig_pages
+static void free_reconfig_pages(struct reconfig_dev *device, uint32_t n_pages, struct page **pages, uint64_t *hpages) {
+    for (int i = 0; i < n_pages; i++) {
+        dma_unmap_single(device->bd_data->dma_dev, hpages[i], RECONFIG_BUFF_PAGE_SIZE, DMA_TO_DEVICE);
+        __free_pages(pages[i], RECONFIG_BUFF_PAGE_SHIFT - PAGE_SHIFT);
+    }
+    vfree(pages);
+    vfree(hpages);
+}
+
+// Frees a list of cache entries, which were already removed from the cache; vfree may sleep, so mem_lock must not be held
+static void free_cache_entries(struct reconfig_dev *device, struct list_head *entries) {
+    struct reconfig_cache_entry *cached, *tmp;
+    list_for_each_entry_safe(cached, tmp, entries, lru) {
+        list_del(&cached->lru);
+        free_reconfig_pages(device, cached->n_pages, cached->pages, cached->hpages);
+        kfree(cached);
+    }
+}
+
+// Reserves room for n_pages in the cache, by evicting unused entries in LRU order to the evicted list; must be called with mem_lock held
+static bool reserve_cache_pages(struct reconfig_dev *device, uint32_t n_pages, struct list_head *evicted) {
+    struct reconfig_cache_entry *cached, *tmp;
+    list_for_each_entry_safe(cached, tmp, &device->cache_lru, lru) {
+        if (device->cache_pages + n_pages <= RECONFIG_CACHE_MAX_PAGES) {
+            break;
+        }
+
+        if (cached->n_users == 0) {
+            hash_del(&cached->entry);
+            list_move_tail(&cached->lru, evicted);
+            device->cache_pages -= cached->n_pages;
+            device->cache_evictions++;
+        }
+    }
+
+    if (device->cache_pages + n_pages > RECONFIG_CACHE_MAX_PAGES) {
+        return false;
+    }
+    device->cache_pages += n_pages;
+    return true;
+}
+
+// Releases a buffer and its metadata; the pages of a cached bitstream stay in the cache, only its user count drops
+static void release_reconfig_buffer(struct reconfig_dev *device, struct reconfig_buff_metadata *buff) {
+    if (buff->cached) {
+        spin_lock(&device->mem_lock);
+        buff->cached->n_users--;
+        spin_unlock(&device->mem_lock);
+    } else {
+        free_reconfig_pages(device, buff->n_pages, buff->pages, buff->hpages);
+    }
+    kfree(buff);
+}
+
+int alloc_reconfig_buffer(struct reconfig_dev *device, unsigned long n_pages, pid_t pid, uint32_t crid) {
+    BUG_ON(!device);
+    
+    // Reconfig buffers are first allocated, then mapped to user-space and finally, used to load the bitstream
+    // Between the allocation and the mapping, the buffer is pending; each process can only have one pending buffer,
+    // so that mmap can tell which buffer to map. Processes don't block each other, since their pending buffers are independent
+    spin_lock(&device->mem_lock);
+    bool pending = find_pending_buffer(pid) != NULL;
+    spin_unlock(&device->mem_lock);
+    if (pending) {
+        pr_warn("allocated reconfig buffers exist but have not been mapped, pid %d\n", pid);
+        return -1;
+    }
+
+    if (n_pages > MAX_RECONFIG_BUFF_NUM) {
+        dbg_info("requested reconfig buffer too large: %lu pages, max %d pages\n", n_pages, MAX_RECONFIG_BUFF_NUM); 
+        return -ENOMEM;
+    }
+
+    struct reconfig_buff_metadata *buff = kzalloc(sizeof(struct reconfig_buff_metadata), GFP_KERNEL);
+    if (!buff) {
+        return -ENOMEM;
+    }
+    buff->pid = pid;
+    buff->crid = crid;
+    
+    // Allocate the pages for this buffer; no lock is held, so the allocation may sleep
+    if (alloc_reconfig_pages(device, n_pages, &buff->pages, &buff->hpages)) {
+        kfree(buff);
+        return -ENOMEM;
+    }
+    buff->n_pages = n_pages;
+
+    // Publish the buffer, unless another thread of the same process raced with this allocation
+    spin_lock(&device->mem_lock);
+    if (find_pending_buffer(pid)) {
+        spin_unlock(&device->mem_lock);
+        pr_warn("allocated reconfig buffers exist but have not been mapped, pid %d\n", pid);
+        release_reconfig_buffer(device, buff);
+        return -1;
+    }
+    hash_add(reconfig_pending_map, &buff->entry, pid);
+    spin_unlock(&device->mem_lock);
+    return 0;
+}
+
+int map_reconfig_buffer(struct reconfig_dev *device, struct vm_area_struct *vma, uint64_t vaddr) {
+    BUG_ON(!device);
+
+    spin_lock(&device->mem_lock);
+    struct reconfig_buff_metadata *buff = find_pending_buffer(current->pid);
+    if (buff) {
+        hash_del(&buff->entry);
+    }
+    spin_unlock(&device->mem_lock);
+
+    if (!buff) {
+        pr_warn("no reconfig buffers allocated for pid %d\n", current->pid);
+        return -EINVAL;
+    }
+
+    // Cached bitstreams are shared between processes, so they can only be mapped read-only
+    if (buff->cached) {
+        if (vma->vm_flags & VM_WRITE) {
+            pr_warn("cached bitstreams can only be mapped read-only\n");
+            release_reconfig_buffer(device, buff);
+            return -EPERM;
+        }
+        #if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 3, 0)
+            vm_flags_clear(vma, VM_MAYWRITE);
+        #else
+            vma->vm_flags &= ~VM_MAYWRITE;
+        #endif
+    }
+    
+    // Remap each page to user-space
+    uint64_t virtual_address_tmp = vaddr;
+    for (int i = 0; i < buff->n_pages; i++) {
+        if (remap_pfn_range(vma, virtual_address_tmp, page_to_pfn(buff->pages[i]), RECONFIG_BUFF_PAGE_SIZE, vma->vm_page_prot)) {
+            pr_warn("failed to remap, virtual address 0x%llx\n", virtual_address_tmp);
+            release_reconfig_buffer(device, buff);
+            return -EIO;
+        }
+        virtual_address_tmp += RECONFIG_BUFF_PAGE_SIZE;
+    }
+
+    // Store the buffer to the map of mapped buffers (reconfig_buffs_map), so it can be used for reconfiguration
+    buff->vaddr = vaddr;
+    spin_lock(&device->mem_lock);
+    hash_add(reconfig_buffs_map, &buff->entry, vaddr);
+    spin_unlock(&device->mem_lock);
+
+    return 0;
+}
+
 int free_reconfig_buffer(struct reconfig_dev *device, uint64_t vaddr, pid_t pid, uint32_t crid) {
     BUG_ON(!device);
 
-    // Iterate through metadata map of allocated buffers and free pages, delete map entry
-    struct reconfig_buff_metadata *tmp_buff;
+    // Find the buffer in the metadata map of allocated buffers and delete the map entry; the pages are freed outside the lock
+    struct reconfig_buff_metadata *tmp_buff, *buff = NULL;
+    spin_lock(&device->mem_lock);
     hash_for_each_possible(reconfig_buffs_map, tmp_buff, entry, vaddr) {
         if (tmp_buff->vaddr == vaddr && tmp_buff->pid == pid && tmp_buff->crid == crid) {
-            for (int i = 0; i < tmp_buff->n_pages; i++) {
-                if (tmp_buff->pages[i]) {
-                    dma_unmap_single(
-                        &device->bd_data->pci_dev->dev,
-                        tmp_buff->hpages[i],
-                        RECONFIG_BUFF_PAGE_SIZE,
-                        DMA_TO_DEVICE
-                    );
-                    __free_pages(tmp_buff->pages[i], RECONFIG_BUFF_PAGE_SHIFT - PAGE_SHIFT);
-                }
-            }
-            vfree(tmp_buff->pages);
-            vfree(tmp_buff->hpages);
             hash_del(&tmp_buff->entry);
+            buff = tmp_buff;
+            break;
         }
     }
+    spin_unlock(&device->mem_lock);
+
+    if (buff) {
+        release_reconfig_buffer(device, buff);
+    }
 
     // NOTE: All the functions from above (__free_pages, vfree, hash_del are void)
     // Therefore; there is no error handling, and hence, always return 0
     return 0;
 }
+
+int add_reconfig_cache(struct reconfig_dev *device, uint64_t vaddr, uint64_t len, pid_t pid, uint32_t crid, uint64_t hash) {
+    BUG_ON(!device);
+    uint32_t n_pages = (len + RECONFIG_BUFF_PAGE_SIZE - 1) >> RECONFIG_BUFF_PAGE_SHIFT;
+    LIST_HEAD(evicted);
+
+    spin_lock(&device->mem_lock);
+    if (find_cache_entry(hash, len)) {
+        spin_unlock(&device->mem_lock);
+        dbg_info("bitstream 0x%llx already cached\n", hash);
+        return 0;
+    }
+
+    // Find the (private) buffer holding the bitstream; it's taken out of the table while it's copied, so it can't be freed meanwhile
+    struct reconfig_buff_metadata *tmp_buff, *buff = NULL;
+    hash_for_each_possible(reconfig_buffs_map, tmp_buff, entry, vaddr) {
+        if (tmp_buff->vaddr == vaddr && tmp_buff->pid == pid && tmp_buff->crid == crid) {
+            buff = tmp_buff;
+            break;
+        }
+    }
+    if (!buff || buff->cached || len == 0 || n_pages > buff->n_pages) {
+        spin_unlock(&device->mem_lock);
+        pr_warn("no reconfig buffer holding a bitstream of %lld B at virtual address 0x%llx, pid %d\n", len, vaddr, pid);
+        return -EINVAL;
+    }
+
+    if (!reserve_cache_pages(device, n_pages, &evicted)) {
+        spin_unlock(&device->mem_lock);
+        free_cache_entries(device, &evicted);
+        pr_warn("bitstream cache full, %d pages in use\n", device->cache_pages);
+        return -ENOMEM;
+    }
+    hash_del(&buff->entry);
+    spin_unlock(&device->mem_lock);
+    free_cache_entries(device, &evicted);
+
+    int ret_val = 0;
+    struct reconfig_cache_entry *cached = kzalloc(sizeof(struct reconfig_cache_entry), GFP_KERNEL);
+    if (!cached || alloc_reconfig_pages(device, n_pages, &cached->pages, &cached->hpages)) {
+        kfree(cached);
+        cached = NULL;
+        ret_val = -ENOMEM;
+        goto restore_buff;
+    }
+    cached->hash = hash;
+    cached->len = len;
+    cached->n_pages = n_pages;
+
+    // The bitstream is copied, so that the cached one can't be changed by the process which loaded it anymore
+    // The hash is verified on the copy, in the same chunks as in user space (RECONFIG_CACHE_HASH_CHUNK), since other processes rely on it
+    uint64_t chunk_hash = FNV_OFFSET_BASIS, bitstream_hash = len, offs = 0;
+    for (int i = 0; i < n_pages; i++) {
+        uint64_t page_len = min_t(uint64_t, len - offs, RECONFIG_BUFF_PAGE_SIZE);
+        uint8_t *page = page_to_virt(cached->pages[i]);
+        memcpy(page, page_to_virt(buff->pages[i]), page_len);
+        dma_sync_single_for_device(device->bd_data->dma_dev, cached->hpages[i], RECONFIG_BUFF_PAGE_SIZE, DMA_TO_DEVICE);
+
+        chunk_hash = fnv1a(page, page_len, chunk_hash);
+        offs += page_len;
+        if (offs % RECONFIG_CACHE_HASH_CHUNK == 0 || offs == len) {
+            bitstream_hash = fnv1a((uint8_t *) &chunk_hash, sizeof(chunk_hash), bitstream_hash);
+            chunk_hash = FNV_OFFSET_BASIS;
+        }
+        cond_resched();
+    }
+
+    if (bitstream_hash != hash) {
+        pr_warn("bitstream hash mismatch, expected 0x%llx, computed 0x%llx\n", hash, bitstream_hash);
+        ret_val = -EINVAL;
+    }
+
+restore_buff:
+    // Publish the entry, unless another process cached the same bitstream meanwhile
+    spin_lock(&device->mem_lock);
+    hash_add(reconfig_buffs_map, &buff->entry, vaddr);
+    if (ret_val == 0 && !find_cache_entry(hash, len)) {
+        hash_add(reconfig_cache_map, &cached->entry, hash);
+        list_add_tail(&cached->lru, &device->cache_lru);
+        device->cache_adds++;
+        cached = NULL;
+    } else {
+        device->cache_pages -= n_pages;
+    }
+    spin_unlock(&device->mem_lock);
+
+    if (cached) {
+        free_reconfig_pages(device, cached->n_pages, cached->pages, cached->hpages);
+        kfree(cached);
+    }
+
+    dbg_info("bitstream 0x%llx of %lld B cached, return %d\n", hash, len, ret_val);
+    return ret_val;
+}
+
+int get_reconfig_cache(struct reconfig_dev *device, uint64_t hash, uint64_t len, pid_t pid, uint32_t crid) {
+    BUG_ON(!device);
+
+    struct reconfig_buff_metadata *buff = kzalloc(sizeof(struct reconfig_buff_metadata), GFP_KERNEL);
+    if (!buff) {
+        return -ENOMEM;
+    }
+    buff->pid = pid;
+    buff->crid = crid;
+
+    // Same as alloc_reconfig_buffer, the buffer is pending until it's mapped; at most one per process
+    spin_lock(&device->mem_lock);
+    if (find_pending_buffer(pid)) {
+        spin_unlock(&device->mem_lock);
+        kfree(buff);
+        pr_warn("allocated reconfig buffers exist but have not been mapped, pid %d\n", pid);
+        return -1;
+    }
+
+    struct reconfig_cache_entry *cached = find_cache_entry(hash, len);
+    if (!cached) {
+        spin_unlock(&device->mem_lock);
+        kfree(buff);
+        dbg_info("bitstream 0x%llx not cached\n", hash);
+        return 0;
+    }
+
+    // The buffer shares the pages of the cache entry, which can't be evicted while the buffer exists
+    buff->cached = cached;
+    buff->n_pages = cached->n_pages;
+    buff->pages = cached->pages;
+    buff->hpages = cached->hpages;
+    cached->n_users++;
+    list_move_tail(&cached->lru, &device->cache_lru);
+    device->cache_hits++;
+    hash_add(reconfig_pending_map, &buff->entry, pid);
+    spin_unlock(&device->mem_lock);
+
+    dbg_info("bitstream 0x%llx found in cache, n_pages %d\n", hash, buff->n_pages);
+    return buff->n_pages;
+}
+
+void free_reconfig_cache(struct reconfig_dev *device) {
+    BUG_ON(!device);
+    LIST_HEAD(entries);
+
+    // Called once the device is gone, so no buffer can map a cached bitstream anymore
+    struct reconfig_cache_entry *cached, *tmp;
+    spin_lock(&device->mem_lock);
+    list_for_each_entry_safe(cached, tmp, &device->cache_lru, lru) {
+        hash_del(&cached->entry);
+        list_move_tail(&cached->lru, &entries);
+    }
+    device->cache_pages = 0;
+    spin_unlock(&device->mem_lock);
+
+    free_cache_entries(device, &entries);
+}
@@ -70,7 +70,7 @@ long reconfig_dev_ioctl(struct file *file, unsigned int command, unsigned long a
                 if (ret_val != 0) {
                     pr_warn("reconfig buffers could not be allocated, return %d\n", ret_val);
                 } else {
-                    dbg_info("allocated reconfig buffers, n_pages %d\n", device->curr_buff.n_pages);
+                    dbg_info("allocated reconfig buffers, n_pages %ld\n", tmp[0]);
                 }
             }
             break;
@@ -92,6 +92,11 @@ long reconfig_dev_ioctl(struct file *file, unsigned int command, unsigned long a
         // Reconfigure shell
         // Args: bitstream virtual address, buffer length, host PID, configuration ID (crid)
         case IOCTL_RECONFIGURE_SHELL:
+            #ifdef PLATFORM_ENZIAN
+                // Not reachable; the reconfiguration device is not created over ECI (see eci.h)
+                ret_val = -EOPNOTSUPP;
+                break;
+            #else
             ret_val = copy_from_user(&tmp, (unsigned long *)arg, 4 * sizeof(unsigned long));
             if (ret_val != 0) {
                 pr_warn("user data could not be coppied, return %d\n", ret_val);
@@ -105,11 +110,18 @@ long reconfig_dev_ioctl(struct file *file, unsigned int command, unsigned long a
                 dbg_info("starting shell reconfiguration, pid %d\n", current->pid);
                 uint64_t start_time = ktime_get_ns();
 
-                // Lock mutex, to avoid multiple reconfigurations at the same time
-                mutex_lock(&device->rcnfg_lock);
-
-                // Clean up current shell state
-                shell_pci_remove(bus_data);
+                // Wait for the ICAP, to avoid multiple reconfigurations at the same time
+                icap_acquire(device);
+
+                // Quiesce the current shell; the vFPGA devices, Coyote threads and their buffers are kept, 
+                // so that they can be carried over to the new shell if it is compatible with the current one
+                // With HMM, the device-private pages belong to the shell, so it is always re-initialized from scratch
+                #ifdef HMM_KERNEL
+                    shell_pci_remove(bus_data);
+                #else
+                    quiesce_vfpga_devices(bus_data);
+                    shell_pci_quiesce(bus_data);
+                #endif
                 
                 // Decouple
                 bus_data->stat_cnfg->reconfig_dcpl_set = 0x1;
@@ -118,27 +130,55 @@ long reconfig_dev_ioctl(struct file *file, unsigned int command, unsigned long a
                 ret_val = reconfigure_start(device, tmp[0], tmp[1], tmp[2], tmp[3]);
                 if (ret_val != 0) {
                     pr_warn("shell reconfiguration not successful, return %d\n", ret_val);
+
+                    // The bitstream was never loaded, so the current shell can simply be resumed
+                    #ifndef HMM_KERNEL
+                        bus_data->stat_cnfg->reconfig_dcpl_clr = 0x1;
+                        if (shell_pci_resume(bus_data)) {
+                            pr_err("could not resume the current shell\n");
+                        }
+                        resume_vfpga_devices(bus_data, true);
+                    #endif
+                    
+                    icap_release(device);
                     return -1;
                 }
 
-                wait_event_interruptible(device->waitqueue_rcnfg, atomic_read(&device->wait_rcnfg) == FLAG_SET);
-                atomic_set(&device->wait_rcnfg, FLAG_CLR);
+                reconfigure_wait(device);
 
                 // Reset end-of-start up time (active-low)
                 bus_data->stat_cnfg->reconfig_eost_reset = 0x0;
                 bus_data->stat_cnfg->reconfig_eost_reset = 0x1;
 
-                // Couple and re-init the shell, unlock mutex
-                dbg_info("shell reconfiguration complete, coupling the design and unlocking mutex\n");
+                // Couple the design and re-init the shell
+                dbg_info("shell reconfiguration complete, coupling the design\n");
                 bus_data->stat_cnfg->reconfig_dcpl_clr = 0x1;
-                shell_pci_init(bus_data);
-                mutex_unlock(&device->rcnfg_lock);
+
+                #ifdef HMM_KERNEL
+                    shell_pci_init(bus_data);
+                #else
+                    if (!reload_shell_config(bus_data) && !shell_pci_resume(bus_data)) {
+                        // Hot swap: the Coyote threads stay valid; only the TLBs are re-programmed
+                        resume_vfpga_devices(bus_data, true);
+                        dbg_info("shell swapped, vFPGA state carried over\n");
+                    } else {
+                        // Incompatible shell: the vFPGA devices are re-created, invalidating all the Coyote threads
+                        pr_warn("new shell is not compatible with the previous one, re-initializing the vFPGA devices\n");
+                        resume_vfpga_devices(bus_data, false);
+                        shell_pci_release(bus_data);
+                        shell_pci_init(bus_data);
+                    }
+                #endif
+
+                // Release the ICAP
+                icap_release(device);
 
                 uint64_t stop_time = ktime_get_ns();
                 dbg_info("shell reconfiguration time %llu ms\n", (stop_time - start_time) / (1000 * 1000));
                 
             }
             break;
+            #endif
         
         // Reconfigure app
         // Args: virtual address, buffer length, host PID, configuration ID (crid), vFPGA ID
@@ -153,32 +193,100 @@ long reconfig_dev_ioctl(struct file *file, unsigned int command, unsigned long a
                     return ret_val;
                 }
 
-                dbg_info("trying to obtain reconfig lock, pid %d\n", current->pid);
-                uint64_t start_time = ktime_get_ns();
-                
-                // Lock mutex, to avoid multiple reconfigurations at the same time
-                mutex_lock(&device->rcnfg_lock);
+                ret_val = reconfigure_app(device, tmp[0], tmp[1], tmp[2], tmp[3], tmp[4]);
+            }
+            break;
 
-                // Decouple
-                bus_data->shell_cnfg->reconfig_dcpl_app_set = (1 << (uint32_t) tmp[4]);
+        // Reconfigure app, without waiting for completion; only one asynchronous reconfiguration per vFPGA can be in progress
+        // The eventfd is signalled once the reconfiguration completes; its result is then read with IOCTL_RECONFIGURE_APP_RESULT
+        // The bitstream buffer must not be freed before completion
+        // Args: virtual address, buffer length, host PID, configuration ID (crid), vFPGA ID, eventfd
+        case IOCTL_RECONFIGURE_APP_ASYNC:
+            ret_val = copy_from_user(&tmp, (unsigned long *) arg, 6 * sizeof(unsigned long));
+            if (ret_val != 0) {
+                pr_warn("user data could not be coppied, return %d\n", ret_val);
+            } else {
+                if (!bus_data->en_pr || tmp[4] >= bus_data->n_fpga_reg) {
+                    ret_val = -1;
+                    pr_warn("partial reconfiguration not enabled or invalid vFPGA, cannot reconfigure app, return %d\n", ret_val);
+                    return ret_val;
+                }
 
-                // Reconfigure and wait until completion
-                ret_val = reconfigure_start(device, tmp[0], tmp[1], tmp[2], tmp[3]);
-                if (ret_val != 0) {
-                    pr_warn("app reconfiguration not successful, return %d\n", ret_val);
-                    return -1;
+                if (test_and_set_bit_lock(tmp[4], &device->async_pending)) {
+                    pr_warn("asynchronous reconfiguration of vFPGA %ld already in progress\n", tmp[4]);
+                    return -EBUSY;
                 }
 
-                wait_event_interruptible(device->waitqueue_rcnfg, atomic_read(&device->wait_rcnfg) == FLAG_SET);
-                atomic_set(&device->wait_rcnfg, FLAG_CLR);
+                struct reconfig_async *req = &device->async_req[tmp[4]];
+                req->efd = eventfd_ctx_fdget(tmp[5]);
+                if (IS_ERR_OR_NULL(req->efd)) {
+                    ret_val = req->efd ? PTR_ERR(req->efd) : -EINVAL;
+                    req->efd = NULL;
+                    clear_bit_unlock(tmp[4], &device->async_pending);
+                    pr_warn("eventfd could not be obtained, return %d\n", ret_val);
+                    return ret_val;
+                }
 
-                // Couple and unlock mutex
-                dbg_info("app reconfiguration complete, coupling the design and unlocking mutex\n");
-                bus_data->shell_cnfg->reconfig_dcpl_app_clr = (1 << (uint32_t)tmp[3]);
-                mutex_unlock(&device->rcnfg_lock);
+                for (int i = 0; i < 4; i++) {
+                    req->args[i] = tmp[i];
+                }
 
-                uint64_t stop_time = ktime_get_ns();
-                dbg_info("app reconfiguration time %llu ms\n", (stop_time - start_time) / (1000 * 1000));
+                dbg_info("queueing asynchronous app reconfiguration, vFPGA %ld, pid %d\n", tmp[4], current->pid);
+                queue_work(system_unbound_wq, &req->work);
+            }
+            break;
+
+        // Read the result of the last asynchronous reconfiguration of a vFPGA
+        // Args: vFPGA ID
+        // Return: 0 if the reconfiguration succeeded, non-zero otherwise
+        case IOCTL_RECONFIGURE_APP_RESULT:
+            ret_val = copy_from_user(&tmp, (unsigned long *) arg, sizeof(unsigned long));
+            if (ret_val != 0) {
+                pr_warn("user data could not be coppied, return %d\n", ret_val);
+            } else if (tmp[0] >= bus_data->n_fpga_reg) {
+                pr_warn("invalid vFPGA ID %ld\n", tmp[0]);
+                ret_val = -EINVAL;
+            } else {
+                tmp[0] = (unsigned long) device->async_req[tmp[0]].ret_val;
+                ret_val = copy_to_user((unsigned long *) arg, &tmp, sizeof(unsigned long));
+                if (ret_val != 0) {
+                    pr_warn("could not copy data to user space, return %d\n", ret_val);
+                }
+            }
+            break;
+
+        // Add a loaded bitstream to the bitstream cache, so that other processes can reconfigure with it without loading it
+        // Args: virtual address, bitstream length, host PID, configuration ID (crid), hash of the bitstream contents
+        case IOCTL_ADD_RECONFIG_CACHE:
+            ret_val = copy_from_user(&tmp, (unsigned long *) arg, 5 * sizeof(unsigned long));
+            if (ret_val != 0) {
+                pr_warn("user data could not be coppied, return %d\n", ret_val);
+            } else {
+                ret_val = add_reconfig_cache(device, tmp[0], tmp[1], tmp[2], tmp[3], tmp[4]);
+                if (ret_val != 0) {
+                    pr_warn("bitstream could not be cached, return %d\n", ret_val);
+                }
+            }
+            break;
+
+        // Look up a bitstream in the bitstream cache; on a hit, the cached bitstream is then mapped (read-only) with mmap
+        // Args: hash of the bitstream contents, bitstream length, host PID, configuration ID (crid)
+        // Return: number of pages of the cached bitstream; 0 if it isn't cached
+        case IOCTL_GET_RECONFIG_CACHE:
+            ret_val = copy_from_user(&tmp, (unsigned long *) arg, 4 * sizeof(unsigned long));
+            if (ret_val != 0) {
+                pr_warn("user data could not be coppied, return %d\n", ret_val);
+            } else {
+                ret_val = get_reconfig_cache(device, tmp[0], tmp[1], tmp[2], tmp[3]);
+                if (ret_val < 0) {
+                    pr_warn("bitstream cache lookup failed, return %d\n", ret_val);
+                } else {
+                    tmp[0] = (unsigned long) ret_val;
+                    ret_val = copy_to_user((unsigned long *) arg, &tmp, sizeof(unsigned long));
+                    if (ret_val != 0) {
+                        pr_warn("could not copy data to user space, return %d\n", ret_val);
+                    }
+                }
             }
             break;
 
@@ -229,41 +337,12 @@ int reconfig_dev_mmap(struct file *file, struct vm_area_struct *vma) {
         // Align virtual address (vma->vm_start) to page boundary
         uint64_t vaddr = ((vma->vm_start + RECONFIG_BUFF_PAGE_SIZE - 1) >> RECONFIG_BUFF_PAGE_SHIFT) << RECONFIG_BUFF_PAGE_SHIFT;
 
-        // Check pages have been allocated and the current process was the one that allocated them 
-        if (device->curr_buff.n_pages != 0 && device->curr_buff.pid == current->pid) {
-            spin_lock(&device->mem_lock);
-
-            // Store metadata about the recently allocated buffer to the map (reconfig_buffs_map)
-            struct reconfig_buff_metadata *new_buff = kzalloc(sizeof(struct reconfig_buff_metadata), GFP_KERNEL);
-            BUG_ON(!new_buff);
-            new_buff->vaddr = vaddr;
-            new_buff->pid = current->pid;
-            new_buff->crid = device->curr_buff.crid;
-            new_buff->n_pages = device->curr_buff.n_pages;
-            new_buff->pages = device->curr_buff.pages;
-            new_buff->hpages = device->curr_buff.hpages;
-            hash_add(reconfig_buffs_map, &new_buff->entry, vaddr);
-            
-            // Remap each page to user-space
-            uint64_t virtual_address_tmp = vaddr;
-            for (int i = 0; i < new_buff->n_pages; i++) {
-                if (remap_pfn_range(
-                        vma, virtual_address_tmp, 
-                        page_to_pfn(device->curr_buff.pages[i]), RECONFIG_BUFF_PAGE_SIZE, vma->vm_page_prot)
-                    ) {
-                        pr_warn("failed to remap, virtual address 0x%llx\n", virtual_address_tmp);
-                        return -EIO;
-                    }
-                virtual_address_tmp += RECONFIG_BUFF_PAGE_SIZE;
-            }
-
-            // Mark current buff as empty, to allo future mmaps (see first if in this function)
-            device->curr_buff.n_pages = 0;
-
-            spin_unlock(&device->mem_lock);
+        // Map the buffer which the current process allocated (IOCTL_ALLOC_HOST_RECONFIG_MEM)
+        int ret_val = map_reconfig_buffer(device, vma, vaddr);
+        if (!ret_val) {
             dbg_info("reconfig device, completed mmap\n");
-            return 0;
         }
+        return ret_val;
     }
 
     return -EINVAL;
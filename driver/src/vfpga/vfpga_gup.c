@@ -22,46 +22,168 @@
 #include "vfpga_gup.h"
 
 /// A map of allocated user buffers, per vFPGA and Coyote thread
-struct hlist_head user_buff_map[MAX_N_REGIONS][N_CTID_MAX][1 << (USER_HASH_TABLE_ORDER)]; // main alloc
+struct rb_root_cached user_buff_map[MAX_N_REGIONS][N_CTID_MAX]; // main alloc
+struct mutex user_buff_lock[MAX_N_REGIONS][N_CTID_MAX];
+
+// The buffers are kept in an interval tree, keyed by their (inclusive) range of pages; 
+// so looking up the buffer holding an address, or all the buffers overlapping a range, is logarithmic in the number of buffers
+#define USER_PG_START(user_pg) ((user_pg)->vaddr)
+#define USER_PG_LAST(user_pg) ((user_pg)->vaddr + (user_pg)->n_pages - 1)
+INTERVAL_TREE_DEFINE(struct user_pages, it_node, uint64_t, it_last, USER_PG_START, USER_PG_LAST, static, user_pg_tree)
+
+#define for_each_user_pg(root, user_pg, first, last) \
+    for (user_pg = user_pg_tree_iter_first(root, first, last); user_pg; user_pg = user_pg_tree_iter_next(user_pg, first, last))
+
+// Same as above, but the current buffer may be removed from the tree (and released) while iterating
+#define for_each_user_pg_safe(root, user_pg, next, first, last) \
+    for (user_pg = user_pg_tree_iter_first(root, first, last), next = user_pg ? user_pg_tree_iter_next(user_pg, first, last) : NULL; \
+         user_pg; user_pg = next, next = user_pg ? user_pg_tree_iter_next(user_pg, first, last) : NULL)
+
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 10, 0)
+static const struct mmu_interval_notifier_ops user_pg_notifier_ops = {
+    .invalidate = user_pg_invalidate,
+};
+#endif
+
+static int get_card_memory(struct vfpga_dev *device, struct user_pages *user_pg);
+static void touch_card_lru(struct vfpga_dev *device, struct user_pages *user_pg);
+static bool note_migration(struct vfpga_dev *device, struct user_pages *user_pg);
+static int split_user_pages(struct vfpga_dev *device, struct user_pages *user_pg);
+static void migrate_range_gup(struct vfpga_dev *device, struct pf_aligned_desc *pf_desc, struct user_pages *user_pg, int32_t stream, pid_t hpid);
+static void merge_user_pages(struct vfpga_dev *device, struct user_pages *user_pg, int32_t dst, pid_t hpid);
+static void put_card_shared(struct vfpga_dev *device, struct card_shared_buff *shared);
+
+// Resolves the card memory placement requested by the user (mem_block, mem_stripe) into the memory blocks passed to alloc_card_memory
+// Returns the number of blocks written to target_blocks (at most N_MEM_BLOCKS) or a negative error code
+static int get_target_blocks(struct vfpga_dev *device, int32_t mem_block, uint32_t mem_stripe, int32_t *target_blocks) {
+    #if defined(PLATFORM_ULTRASCALE_PLUS) || defined(PLATFORM_ENZIAN)
+    // On UltraScale+ devices (and Enzian), each memory channel can access the entire memory
+    // Therefore, mem_block is ignored, since the entire memory is treated as one
+    // partition with no fine-grained control over memory allocation
+    if (mem_block != -1 || mem_stripe > 1) {
+        dbg_info("memory block or stripe specified, but UltraScale+ devices do not support block memory; ignoring...\n");
+    }
+    target_blocks[0] = -1;
+    return 1;
+    #endif
+
+    #ifdef PLATFORM_VERSAL
+    int32_t target_block = -1;
+    if (mem_block != -1) {
+        // User specified memory block; realign to current vFPGA (i.e. HBM_AXI_%d)
+        target_block = device->id * device->bd_data->n_card_axi + mem_block;
+
+        // Find correct HBM pseudo-channel by applying spacing transformation from cr_hbm.tcl
+        target_block = DIV_ROUND_CLOSEST(N_MEM_BLOCKS * (target_block + 1), device->bd_data->n_fpga_reg * device->bd_data->n_card_axi + 1) - 1;
+    } else if (device->bd_data->en_block_mem) {
+        // No memory block specified; throw error
+        dbg_info("no target block specified, but shell was synthesized with block HBM enabled\n");
+        return -EINVAL;
+    }
+
+    // With block memory, each card AXI interface can only access its own block, so buffers can't be striped
+    if (mem_stripe <= 1 || device->bd_data->en_block_mem) {
+        if (mem_stripe > 1) {
+            dbg_info("memory stripe specified, but shell was synthesized with block HBM enabled; ignoring...\n");
+        }
+        target_blocks[0] = target_block;
+        return 1;
+    }
+
+    // Unified implementation; spread the stripe evenly over the memory (and therefore the HBM stacks), starting from the requested block
+    mem_stripe = min_t(uint32_t, mem_stripe, N_MEM_BLOCKS);
+    uint32_t stride = N_MEM_BLOCKS / mem_stripe;
+    for (int i = 0; i < mem_stripe; i++) {
+        target_blocks[i] = (max(target_block, 0) + i * stride) % N_MEM_BLOCKS;
+    }
+    return mem_stripe;
+    #endif
+}
+
+static void align_pf_desc(struct bus_driver_data *bd_data, struct pf_aligned_desc *pf_desc, uint64_t vaddr, uint64_t len) {
+    struct tlb_metadata *tlb_meta = pf_desc->hugepages ? bd_data->ltlb_meta : bd_data->stlb_meta;
+
+    // Align to a page boundary and calculate the number of pages bust on the buffer lenght (in bytes)
+    pf_desc->vaddr = (vaddr & tlb_meta->page_mask) >> tlb_meta->page_shift;
+    uint64_t last = ((vaddr + len - 1) & tlb_meta->page_mask) >> tlb_meta->page_shift;
+    pf_desc->n_pages = last - pf_desc->vaddr + 1;
+    if (pf_desc->hugepages) {
+        pf_desc->n_pages = pf_desc->n_pages * bd_data->n_pages_in_huge;
+        pf_desc->vaddr = pf_desc->vaddr << bd_data->dif_order_page_shift;
+    }
+}
 
-int mmu_handler_gup(struct vfpga_dev *device, uint64_t vaddr, uint64_t len, int32_t ctid, int32_t stream, pid_t hpid, int32_t mem_block) {
+int mmu_handler_gup(struct vfpga_dev *device, uint64_t vaddr, uint64_t len, int32_t ctid, int32_t stream, pid_t hpid, int32_t mem_block, uint32_t mem_stripe, uint32_t flags) {
     int ret_val = 0;
     struct user_pages *user_pg;
     struct bus_driver_data *bd_data = device->bd_data;
 
+    // GPU buffers (dmabufs) are always mapped whole; they only fault after the exporter moved them
+    struct pf_aligned_desc pf_desc;
+    pf_desc.ctid = ctid;
+    pf_desc.hugepages = false;
+    align_pf_desc(bd_data, &pf_desc, vaddr, len);
+    user_pg = map_present(device, &pf_desc);
+    if (user_pg && user_pg->buf) {
+        dbg_info("dmabuf access, re-validating the mapping\n");
+        return p2p_revalidate_dma_buf(device, user_pg, hpid);
+    }
+
+    // Card-only buffers are always mapped whole and never migrated; they only fault after their TLB entries were lost
+    if (user_pg && user_pg->card_only) {
+        dbg_info("card-only buffer, updating TLB\n");
+        pf_desc.vaddr = user_pg->vaddr;
+        pf_desc.n_pages = user_pg->n_pages;
+        pf_desc.hugepages = user_pg->huge;
+        tlb_map_gup(device, &pf_desc, user_pg, hpid);
+        return 0;
+    }
+
     // Find context (host process ID)
     struct task_struct *curr_task = pid_task(find_vpid(hpid), PIDTYPE_PID);
     dbg_info("hpid found = %d", hpid);
     struct mm_struct *curr_mm = curr_task->mm;
 
     // Check if the request area is huge page or not
+    // Large TLB entries are only used if the host pages are at least as large as the shell's large TLB pages;
+    // otherwise (e.g., 2MB host pages with 1GB TLB pages), the buffer is handled as regular pages, which are coalesced where possible
     struct vm_area_struct *vma_area_init = find_vma(curr_mm, vaddr);
-    int hugepages = is_vm_hugetlb_page(vma_area_init);
-    struct tlb_metadata *tlb_meta = hugepages ? bd_data->ltlb_meta : bd_data->stlb_meta;
-
-    // Align to a page boundary and calculate the number of pages bust on the buffer lenght (in bytes)
-    struct pf_aligned_desc pf_desc;
-    pf_desc.vaddr = (vaddr & tlb_meta->page_mask) >> tlb_meta->page_shift;
-    uint64_t last = ((vaddr + len - 1) & tlb_meta->page_mask) >> tlb_meta->page_shift;
-    pf_desc.n_pages = last - pf_desc.vaddr + 1;
-    if (hugepages) {
-        pf_desc.n_pages = pf_desc.n_pages * bd_data->n_pages_in_huge;
-        pf_desc.vaddr = pf_desc.vaddr << bd_data->dif_order_page_shift;
-    }
+    uint64_t host_pg_size = vma_kernel_pagesize(vma_area_init);
+    int hugepages = is_vm_hugetlb_page(vma_area_init) && (host_pg_size >= bd_data->ltlb_meta->page_size);
 
-    // Populate rest of the page fault descriptor
-    pf_desc.ctid = ctid;
+    // Populate the page fault descriptor
     pf_desc.hugepages = hugepages;
+    align_pf_desc(bd_data, &pf_desc, vaddr, len);
 
     // Check if mapping is already present
     user_pg = map_present(device, &pf_desc);
 
+    // Fault-ahead: also pin and map the window following the faulting range, within the same VMA,
+    // so that sequential accesses fault once per window instead of once per chunk; resident buffers and buffers with an access hint are mapped exactly
+    uint64_t fault_ahead = (user_pg && user_pg->fault_ahead != FAULT_AHEAD_DEFAULT) ? user_pg->fault_ahead : bd_data->fault_ahead;
+    if (flags & (MAP_USER_RESIDENT | MAP_USER_ACCESS_MASK)) {
+        fault_ahead = 0;
+    }
+    if (fault_ahead) {
+        len = max_t(uint64_t, len, min_t(uint64_t, vaddr + len + fault_ahead, vma_area_init->vm_end) - vaddr);
+        align_pf_desc(bd_data, &pf_desc, vaddr, len);
+        user_pg = map_present(device, &pf_desc);
+        dbg_info("fault-ahead window %llx, extending fault to len %llx\n", fault_ahead, len);
+    }
+
     // Handle the different cases, based on if the mapping is alread present or not, and if its HOST or CARD access
+    // Buffers which ping-pong between the host and the card are split, after which only the faulting ranges are migrated
     if(user_pg) {
-        if(stream == HOST_ACCESS) {
+        if(user_pg->card_pages && (stream == HOST_ACCESS || stream == CARD_ACCESS)) {
+            dbg_info("split buffer, migrating the faulting range\n");
+            migrate_range_gup(device, &pf_desc, user_pg, stream, hpid);
+        } else if(stream == HOST_ACCESS) {
             if(user_pg->host == HOST_ACCESS) {
                 dbg_info("host access, map present, updating TLB\n");
                 tlb_map_gup(device, &pf_desc, user_pg, hpid);
+            } else if(note_migration(device, user_pg) && !split_user_pages(device, user_pg)) {
+                dbg_info("card access, map present, ping-pong, splitting buffer\n");
+                migrate_range_gup(device, &pf_desc, user_pg, stream, hpid);
             } else {
                 dbg_info("card access, map present, migration\n");
                 tlb_unmap_gup(device, user_pg, hpid);
@@ -72,12 +194,26 @@ int mmu_handler_gup(struct vfpga_dev *device, uint64_t vaddr, uint64_t len, int3
         } else if(stream == CARD_ACCESS) {
             if(user_pg->host == HOST_ACCESS) {
                 dbg_info("host access, map present, migration\n");
-                tlb_unmap_gup(device, user_pg, hpid);
-                user_pg->host = CARD_ACCESS;
-                migrate_to_card(device, user_pg);
-                tlb_map_gup(device, &pf_desc, user_pg, hpid);
+
+                // The card memory of the buffer may have been evicted while it resided on the host
+                ret_val = get_card_memory(device, user_pg);
+                if (ret_val) {
+                    pr_err("card memory could not be obtained, vFPGA %d\n", device->id);
+                    return ret_val;
+                }
+
+                if(note_migration(device, user_pg) && !split_user_pages(device, user_pg)) {
+                    dbg_info("host access, map present, ping-pong, splitting buffer\n");
+                    migrate_range_gup(device, &pf_desc, user_pg, stream, hpid);
+                } else {
+                    tlb_unmap_gup(device, user_pg, hpid);
+                    user_pg->host = CARD_ACCESS;
+                    migrate_to_card(device, user_pg);
+                    tlb_map_gup(device, &pf_desc, user_pg, hpid);
+                }
             } else {
                 dbg_info("card access, map present, updating TLB\n");
+                touch_card_lru(device, user_pg);
                 tlb_map_gup(device, &pf_desc, user_pg, hpid);
             }
         } else {
@@ -86,7 +222,28 @@ int mmu_handler_gup(struct vfpga_dev *device, uint64_t vaddr, uint64_t len, int3
         }
     } else {
         dbg_info("map not present\n");
-        user_pg = tlb_get_user_pages(device, &pf_desc, hpid, curr_task, curr_mm, mem_block);
+
+        // Host pages larger than the large TLB pages (e.g., 1GB host pages with 2MB TLB pages) are physically contiguous
+        // and always resident, so the whole host page is pinned at once and mapped from the faulting address onwards,
+        // instead of taking a page fault for every large TLB page within it
+        struct pf_aligned_desc pin_desc = pf_desc;
+        if (hugepages && host_pg_size > bd_data->ltlb_meta->page_size) {
+            uint64_t start = max_t(uint64_t, vaddr & ~(host_pg_size - 1), vma_area_init->vm_start);
+            uint64_t end = min_t(uint64_t, ALIGN(vaddr + len, host_pg_size), vma_area_init->vm_end);
+            align_pf_desc(bd_data, &pin_desc, start, end - start);
+
+            // Only extend if no existing mapping overlaps the start of the host page or truncates it before the faulting range
+            if (map_present(device, &pin_desc) || pin_desc.vaddr + pin_desc.n_pages < pf_desc.vaddr + pf_desc.n_pages) {
+                pin_desc = pf_desc;
+            } else {
+                pf_desc.n_pages = pin_desc.vaddr + pin_desc.n_pages - pf_desc.vaddr;
+                dbg_info("host page size %llx, pinning vaddr %llx, n_pages %d\n", host_pg_size, pin_desc.vaddr, pin_desc.n_pages);
+            }
+        }
+
+        ktime_t pin_time = ktime_get();
+        user_pg = tlb_get_user_pages(device, &pin_desc, hpid, curr_task, curr_mm, mem_block, mem_stripe, flags);
+        PFAULT_TRACE_ADD(device, ctid, PFAULT_PIN, ktime_to_ns(ktime_sub(ktime_get(), pin_time)));
         if(!user_pg) {
             pr_err("user pages could not be obtained\n");
             return -ENOMEM;
@@ -111,12 +268,77 @@ int mmu_handler_gup(struct vfpga_dev *device, uint64_t vaddr, uint64_t len, int3
     return ret_val;
 }
 
+int mmu_map_range_gup(struct vfpga_dev *device, uint64_t vaddr, uint64_t len, int32_t ctid, int32_t stream, pid_t hpid, int32_t mem_block, uint32_t mem_stripe, uint32_t flags) {
+    int ret_val = 0;
+    struct bus_driver_data *bd_data = device->bd_data;
+    uint64_t end = vaddr + len;
+
+    // Find context (host process ID)
+    struct task_struct *curr_task = pid_task(find_vpid(hpid), PIDTYPE_PID);
+    struct mm_struct *curr_mm = curr_task->mm;
+
+    while (vaddr < end) {
+        struct vm_area_struct *vma_area = find_vma(curr_mm, vaddr);
+        if (!vma_area || vma_area->vm_start > vaddr) {
+            pr_err("prefault address %llx not mapped by process %d\n", vaddr, hpid);
+            return -EFAULT;
+        }
+
+        // A chunk spans the rest of the range within this VMA; mmu_handler_gup maps all of it
+        int hugepages = is_vm_hugetlb_page(vma_area) && (vma_kernel_pagesize(vma_area) >= bd_data->ltlb_meta->page_size);
+        uint64_t chunk_end = min_t(uint64_t, end, vma_area->vm_end);
+
+        // Don't let the chunk cross into another pinned buffer; map_present would otherwise truncate it
+        // The pinned buffers overlapping the range are re-used as they are, only the gaps between them are pinned
+        struct pf_aligned_desc pf_desc;
+        pf_desc.ctid = ctid;
+        pf_desc.hugepages = hugepages;
+        align_pf_desc(bd_data, &pf_desc, vaddr, chunk_end - vaddr);
+        map_present(device, &pf_desc);
+        chunk_end = min_t(uint64_t, chunk_end, (pf_desc.vaddr + pf_desc.n_pages) << PAGE_SHIFT);
+
+        int ret_chunk = mmu_handler_gup(device, vaddr, chunk_end - vaddr, ctid, stream, hpid, mem_block, mem_stripe, flags);
+        if (ret_chunk == BUFF_NEEDS_EXP_SYNC_RET_CODE) {
+            ret_val = ret_chunk;
+        } else if (ret_chunk) {
+            return ret_chunk;
+        }
+
+        vaddr = chunk_end;
+    }
+
+    return ret_val;
+}
+
+int set_fault_ahead(struct vfpga_dev *device, uint64_t vaddr, int32_t ctid, int64_t window) {
+    BUG_ON(!device);
+    struct bus_driver_data *bd_data = device->bd_data;
+    BUG_ON(!bd_data);
+
+    uint64_t vaddr_tmp = (vaddr & bd_data->stlb_meta->page_mask) >> bd_data->stlb_meta->page_shift;
+
+    struct user_pages *tmp_entry = user_pg_tree_iter_first(&user_buff_map[device->id][ctid], vaddr_tmp, vaddr_tmp);
+    if (tmp_entry) {
+        tmp_entry->fault_ahead = window;
+        dbg_info("fault-ahead window for buffer %llx set to %lld\n", vaddr, window);
+        return 0;
+    }
+
+    pr_warn("no mapped buffer at %llx for ctid %d, fault-ahead not set\n", vaddr, ctid);
+    return -EINVAL;
+}
+
 struct user_pages* map_present(struct vfpga_dev *device, struct pf_aligned_desc *pf_desc) {
-    int bkt;
     struct user_pages *tmp_entry;
+    uint64_t first = pf_desc->vaddr, last = pf_desc->vaddr + pf_desc->n_pages - 1;
+
+    // Iterate through the buffers overlapping the faulting range, in ascending order of their starting address
+    for_each_user_pg(&user_buff_map[device->id][pf_desc->ctid], tmp_entry, first, last) {
+        // Buffers invalidated by the MMU notifier are about to be released
+        if (atomic_read(&tmp_entry->stale)) {
+            continue;
+        }
 
-    // Iterate through the hash table to find a matching user page
-    hash_for_each(user_buff_map[device->id][pf_desc->ctid], bkt, tmp_entry, entry) {
         if(pf_desc->vaddr >= tmp_entry->vaddr && pf_desc->vaddr < tmp_entry->vaddr + tmp_entry->n_pages) {
             // Hit
             if(pf_desc->vaddr + pf_desc->n_pages > tmp_entry->vaddr + tmp_entry->n_pages)
@@ -124,54 +346,99 @@ struct user_pages* map_present(struct vfpga_dev *device, struct pf_aligned_desc
 
             return tmp_entry;
         } else if(pf_desc->vaddr < tmp_entry->vaddr && pf_desc->vaddr + pf_desc->n_pages > tmp_entry->vaddr) {
-            // Partial hit; modify the page fault descriptor to include the overlapping pages
+            // Partial hit; modify the page fault descriptor to exclude the overlapping pages
+            // No later buffer can be a hit, since they all start at or after this one
             pf_desc->n_pages = tmp_entry->vaddr - pf_desc->vaddr;
+            return 0;
         }
     }
 
     return 0;
 }
 
+// Memory in which page i of a buffer resides; split buffers track it per page, all others for the whole buffer
+static inline int32_t page_residency(struct user_pages *user_pg, uint64_t i) {
+    if (user_pg->card_pages) {
+        return test_bit(i, user_pg->card_pages) ? CARD_ACCESS : HOST_ACCESS;
+    }
+    return user_pg->host;
+}
+
+// Physical address of page i of a buffer, in the memory it currently resides in
+static inline uint64_t page_paddr(struct user_pages *user_pg, uint64_t i) {
+    return (page_residency(user_pg, i) == HOST_ACCESS) ? user_pg->hpages[i] : user_pg->cpages[i];
+}
+
+// Ends a burst of TLB writes after every MAX_N_MAP_PAGES entries, by briefly releasing mmu_lock
+// Returns true if the MMU notifier invalidated the buffer in the meantime; the rest of it must then not be mapped
+static inline bool tlb_map_burst(struct vfpga_dev *device, struct user_pages *user_pg, int32_t n_pg_mapped) {
+    if (n_pg_mapped % MAX_N_MAP_PAGES == 0) {
+        mutex_unlock(&device->mmu_lock);
+        cond_resched();
+        mutex_lock(&device->mmu_lock);
+        return atomic_read(&user_pg->stale);
+    }
+    return false;
+}
+
 void tlb_map_gup(struct vfpga_dev *device, struct pf_aligned_desc *pf_desc, struct user_pages *user_pg, pid_t hpid) {
     BUG_ON(!device);
     struct bus_driver_data *bd_data = device->bd_data;
     BUG_ON(!bd_data);
 
+    // Only the TLB writes are serialized across Coyote threads
+    ktime_t lock_time = ktime_get();
+    mutex_lock(&device->mmu_lock);
+    ktime_t map_time = ktime_get();
+    PFAULT_TRACE_ADD(device, user_pg->ctid, PFAULT_LOCK, ktime_to_ns(ktime_sub(map_time, lock_time)));
+
+    // A buffer invalidated by the MMU notifier is about to be released and must not be mapped again;
+    // the notifier sets stale before it takes mmu_lock to clear the TLB, so checking it under the lock is enough
+    if (atomic_read(&user_pg->stale)) {
+        mutex_unlock(&device->mmu_lock);
+        dbg_info("skipped mapping invalidated buffer %llx, vFPGA %d, ctid %d\n", user_pg->vaddr << PAGE_SHIFT, device->id, user_pg->ctid);
+        return;
+    }
+
     // Find the first page that's in the page fault and then the first page that has already been mapped; calculate offset
     uint64_t pg_offs = pf_desc->vaddr - user_pg->vaddr;
     uint32_t n_pages = pf_desc->n_pages;
 
+    // The whole range is mapped, in bursts of MAX_N_MAP_PAGES entries; mmu_lock is dropped in-between,
+    // so that mapping a large buffer doesn't stall the page faults of the other Coyote threads; if the MMU notifier
+    // invalidated the buffer while the lock was released, mapping stops and the notifier clears what was mapped
     int32_t n_pg_mapped = 0;
     uint64_t vaddr_tmp = pf_desc->vaddr;
     if (user_pg->huge) {
         // Do mappings - huge pages
-        for (int i = 0; (i < n_pages) && (n_pg_mapped < MAX_N_MAP_PAGES); i+=bd_data->n_pages_in_huge) {
+        for (int i = 0; i < n_pages; i+=bd_data->n_pages_in_huge) {
             create_tlb_mapping(
                 device, bd_data->ltlb_meta, vaddr_tmp, 
-                (user_pg->host == HOST_ACCESS) ? user_pg->hpages[i + pg_offs] : user_pg->cpages[i + pg_offs],
-                user_pg->host, user_pg->ctid, hpid
+                page_paddr(user_pg, i + pg_offs), page_residency(user_pg, i + pg_offs), user_pg->ctid, hpid
             );
 
             vaddr_tmp += bd_data->n_pages_in_huge;
-            n_pg_mapped++;
+            if (tlb_map_burst(device, user_pg, ++n_pg_mapped)) {
+                break;
+            }
         }
     } else {
         // Do mappings - regular + regular pages coalesced into huge pages
         int i = 0;
         uint64_t paddr_tmp, paddr_curr;
 
-        while((i < n_pages) && (n_pg_mapped < MAX_N_MAP_PAGES)) {
+        while(i < n_pages) {
             // Coalesce, if possible
             bool is_huge = false;
             if (n_pages >= bd_data->n_pages_in_huge) {
                 if (i <= n_pages - bd_data->n_pages_in_huge) {
                     if ((vaddr_tmp & bd_data->dif_order_page_mask) == 0) {
-                        paddr_tmp = (user_pg->host == HOST_ACCESS) ? user_pg->hpages[i + pg_offs] : user_pg->cpages[i + pg_offs];
+                        paddr_tmp = page_paddr(user_pg, i + pg_offs);
                         if ((paddr_tmp & ~bd_data->ltlb_meta->page_mask) == 0) {
                             is_huge = true; 
                             for (int j = i + 1; j < i + bd_data->n_pages_in_huge; j++) {
-                                paddr_curr = (user_pg->host == HOST_ACCESS) ? user_pg->hpages[j + pg_offs] : user_pg->cpages[j + pg_offs];
-                                if (paddr_curr != paddr_tmp + PAGE_SIZE) {
+                                paddr_curr = page_paddr(user_pg, j + pg_offs);
+                                if (paddr_curr != paddr_tmp + PAGE_SIZE || page_residency(user_pg, j + pg_offs) != page_residency(user_pg, i + pg_offs)) {
                                     is_huge = false;
                                     break;
                                 } else {
@@ -186,27 +453,32 @@ void tlb_map_gup(struct vfpga_dev *device, struct pf_aligned_desc *pf_desc, stru
             // Call HW fucntion to do mapping
             create_tlb_mapping(
                 device, is_huge ? bd_data->ltlb_meta : bd_data->stlb_meta, vaddr_tmp, 
-                (user_pg->host == HOST_ACCESS) ? user_pg->hpages[i + pg_offs] : user_pg->cpages[i + pg_offs],
-                user_pg->host, user_pg->ctid, hpid
+                page_paddr(user_pg, i + pg_offs), page_residency(user_pg, i + pg_offs), user_pg->ctid, hpid
             );
             
             // Proceed to next page
             vaddr_tmp += is_huge ? bd_data->n_pages_in_huge : 1;
             i += is_huge ? bd_data->n_pages_in_huge : 1;
-            n_pg_mapped++;
+            if (tlb_map_burst(device, user_pg, ++n_pg_mapped)) {
+                break;
+            }
         }
     }
+
+    mutex_unlock(&device->mmu_lock);
+    PFAULT_TRACE_ADD(device, user_pg->ctid, PFAULT_MAP, ktime_to_ns(ktime_sub(ktime_get(), map_time)));
+    VFPGA_STAT_ADD(device, user_pg->ctid, tlb_maps, n_pg_mapped);
 }
 
-void tlb_unmap_gup(struct vfpga_dev *device, struct user_pages *user_pg, pid_t hpid) {
+// Clears the TLB entries of n_pages pages of a buffer, starting at page pg_offs, without invalidating in-flight translations
+// The caller must hold mmu_lock
+static void tlb_clear_entries(struct vfpga_dev *device, struct user_pages *user_pg, uint64_t pg_offs, uint32_t n_pages, pid_t hpid) {
     BUG_ON(!device);
     struct bus_driver_data *bd_data = device->bd_data;
     BUG_ON(!bd_data);
 
     // Metadata
-    uint32_t n_pages = user_pg->n_pages;
-    int32_t pg_inc = user_pg->huge ? bd_data->n_pages_in_huge : 1;
-    uint64_t vaddr_tmp = user_pg->vaddr;
+    uint64_t vaddr_tmp = user_pg->vaddr + pg_offs;
 
     if(user_pg->huge) {
         // Unmap - huge pages
@@ -224,12 +496,12 @@ void tlb_unmap_gup(struct vfpga_dev *device, struct user_pages *user_pg, pid_t h
             if (n_pages >= bd_data->n_pages_in_huge) {
                 if (i <= n_pages - bd_data->n_pages_in_huge) {
                     if ((vaddr_tmp & bd_data->dif_order_page_mask) == 0) {
-                        paddr_tmp = (user_pg->host == HOST_ACCESS) ? user_pg->hpages[i] : user_pg->cpages[i];
+                        paddr_tmp = page_paddr(user_pg, i + pg_offs);
                         if ((paddr_tmp & ~bd_data->ltlb_meta->page_mask) == 0) {
                             is_huge = true; 
                             for (int j = i + 1; j < i + bd_data->n_pages_in_huge; j++) {
-                                paddr_curr = (user_pg->host == HOST_ACCESS) ? user_pg->hpages[j] : user_pg->cpages[j];
-                                if(paddr_curr != paddr_tmp + PAGE_SIZE) {
+                                paddr_curr = page_paddr(user_pg, j + pg_offs);
+                                if(paddr_curr != paddr_tmp + PAGE_SIZE || page_residency(user_pg, j + pg_offs) != page_residency(user_pg, i + pg_offs)) {
                                     is_huge = false;
                                     break;
                                 } else {
@@ -249,20 +521,194 @@ void tlb_unmap_gup(struct vfpga_dev *device, struct user_pages *user_pg, pid_t h
             i += is_huge ? bd_data->n_pages_in_huge : 1;
         }
     }
-    
-    // Invalidate TLB entry
-    vaddr_tmp = user_pg->vaddr;
-    for (int i = 0; i < n_pages; i += pg_inc) {
-        invalidate_tlb_entry(device, vaddr_tmp, pg_inc, hpid, i == (n_pages - pg_inc));
-        vaddr_tmp += pg_inc;
-    }
+}
+
+// Unmaps n_pages pages of a buffer, starting at page pg_offs, from the TLB and waits until in-flight translations are invalidated
+static void tlb_unmap_range(struct vfpga_dev *device, struct user_pages *user_pg, uint64_t pg_offs, uint32_t n_pages, pid_t hpid) {
+    BUG_ON(!device);
 
-    // Wait for completion
+    // Only the TLB writes and the invalidation are serialized across Coyote threads
+    mutex_lock(&device->mmu_lock);
+
+    tlb_clear_entries(device, user_pg, pg_offs, n_pages, hpid);
+
+    // Invalidate the whole range at once and wait for completion
+    invalidate_tlb_range(device, user_pg->vaddr + pg_offs, n_pages, hpid, true);
     wait_event_interruptible(device->waitqueue_invldt, atomic_read(&device->wait_invldt) == FLAG_SET);
     atomic_set(&device->wait_invldt, FLAG_CLR);
+
+    mutex_unlock(&device->mmu_lock);
+    VFPGA_STAT_ADD(device, user_pg->ctid, tlb_invalidations, 1);
+}
+
+void tlb_unmap_gup(struct vfpga_dev *device, struct user_pages *user_pg, pid_t hpid) {
+    tlb_unmap_range(device, user_pg, 0, user_pg->n_pages, hpid);
+}
+
+void tlb_unmap_gup_ctid(struct vfpga_dev *device, int32_t ctid, pid_t hpid) {
+    int n_buffs = 0, i = 0;
+    struct user_pages *tmp_entry;
+    BUG_ON(!device);
+
+    mutex_lock(&device->mmu_lock);
+
+    for_each_user_pg(&user_buff_map[device->id][ctid], tmp_entry, 0, U64_MAX) {
+        tlb_clear_entries(device, tmp_entry, 0, tmp_entry->n_pages, hpid);
+        n_buffs++;
+    }
+
+    // One invalidation per buffer; only the last one raises the completion IRQ, so there is a single wait for the Coyote thread
+    if (n_buffs > 0) {
+        for_each_user_pg(&user_buff_map[device->id][ctid], tmp_entry, 0, U64_MAX) {
+            invalidate_tlb_range(device, tmp_entry->vaddr, tmp_entry->n_pages, hpid, ++i == n_buffs);
+        }
+
+        wait_event_interruptible(device->waitqueue_invldt, atomic_read(&device->wait_invldt) == FLAG_SET);
+        atomic_set(&device->wait_invldt, FLAG_CLR);
+    }
+
+    mutex_unlock(&device->mmu_lock);
+    VFPGA_STAT_ADD(device, ctid, tlb_invalidations, n_buffs);
+}
+
+// Marks the buffer as the most recently used one in the vFPGA's card memory LRU list
+static void touch_card_lru(struct vfpga_dev *device, struct user_pages *user_pg) {
+    spin_lock(&device->card_lru_lock);
+    if (!list_empty(&user_pg->lru)) {
+        list_move_tail(&user_pg->lru, &device->card_lru);
+    }
+    spin_unlock(&device->card_lru_lock);
+}
+
+// Evicts the card memory of the least recently used buffer of the vFPGA which resides on the host (i.e. whose card copy is not needed)
+// Split buffers are never evicted, since some of their pages may reside on the card
+// The caller holds user_buff_lock of Coyote thread ctid; the buffers of other Coyote threads are only evicted if their lock is free
+// Returns 0 if some card memory was evicted, -ENOMEM if there is no buffer which can be evicted
+static int evict_card_memory(struct vfpga_dev *device, int32_t ctid) {
+    struct user_pages *tmp_entry, *victim = NULL;
+
+    spin_lock(&device->card_lru_lock);
+    list_for_each_entry(tmp_entry, &device->card_lru, lru) {
+        // The buffers of other Coyote threads may be in use (e.g., under migration); trylock doesn't sleep, so it's safe under the spinlock
+        if (tmp_entry->ctid != ctid && !mutex_trylock(&user_buff_lock[device->id][tmp_entry->ctid])) {
+            continue;
+        }
+
+        if (tmp_entry->host == HOST_ACCESS && !tmp_entry->card_pages && !atomic_read(&tmp_entry->stale)) {
+            victim = tmp_entry;
+            list_del_init(&victim->lru);
+            break;
+        }
+
+        if (tmp_entry->ctid != ctid) {
+            mutex_unlock(&user_buff_lock[device->id][tmp_entry->ctid]);
+        }
+    }
+    spin_unlock(&device->card_lru_lock);
+
+    if (!victim) {
+        return -ENOMEM;
+    }
+
+    dbg_info("evicting card memory of buffer %llx, vFPGA %d, ctid %d\n", victim->vaddr << PAGE_SHIFT, device->id, victim->ctid);
+    free_card_memory(device, victim->cpages, victim->n_pages, victim->huge);
+    vfree(victim->cpages);
+    victim->cpages = NULL;
+    victim->card_valid = false;
+
+    if (victim->ctid != ctid) {
+        mutex_unlock(&user_buff_lock[device->id][victim->ctid]);
+    }
+
+    return 0;
+}
+
+// Allocates the card memory of a buffer, if it doesn't have any (i.e. newly pinned or evicted); 
+// when the card memory runs out, the card memory of the least recently used buffers residing on the host is evicted
+// The caller must hold user_buff_lock of the buffer's Coyote thread
+static int get_card_memory(struct vfpga_dev *device, struct user_pages *user_pg) {
+    if (user_pg->cpages) {
+        touch_card_lru(device, user_pg);
+        return 0;
+    }
+
+    int32_t target_blocks[N_MEM_BLOCKS];
+    int n_blocks = get_target_blocks(device, user_pg->mem_block, user_pg->mem_stripe, target_blocks);
+    if (n_blocks < 0) {
+        return n_blocks;
+    }
+
+    user_pg->cpages = vmalloc(user_pg->n_pages * sizeof(uint64_t));
+    BUG_ON(!user_pg->cpages);
+
+    int ret_val;
+    do {
+        ret_val = alloc_card_memory(device, user_pg->cpages, user_pg->n_pages, user_pg->huge, target_blocks, n_blocks);
+    } while (ret_val == -ENOMEM && !evict_card_memory(device, user_pg->ctid));
+    
+    if (ret_val) {
+        vfree(user_pg->cpages);
+        user_pg->cpages = NULL;
+        return ret_val;
+    }
+
+    user_pg->card_valid = false;
+    spin_lock(&device->card_lru_lock);
+    list_add_tail(&user_pg->lru, &device->card_lru);
+    spin_unlock(&device->card_lru_lock);
+
+    return 0;
+}
+
+// Pins n_pages user pages from start onwards; returns the number of pages pinned, or a negative error code
+// On newer kernels, pin_user_pages_remote is preferred over get_user_pages_remote for DMA,
+// as it guarantees that the pages remain pinned (and not just the page struct) until explicitly unpinned
+// Resident buffers mapped by their own process are pinned with the fast path, which walks the page tables 
+// without the mmap lock; pages which turn out not to be resident are still faulted in, through the slow path
+// Read-only buffers are pinned without FOLL_WRITE, so no write fault (e.g., copy-on-write break) is taken on file-backed or shared pages
+static long pin_pages(struct task_struct *curr_task, struct mm_struct *curr_mm, unsigned long start, unsigned long n_pages, uint32_t flags, struct page **pages) {
+    unsigned int gup_flags = (flags & MAP_USER_READ_ONLY) ? FOLL_LONGTERM : FOLL_WRITE | FOLL_LONGTERM;
+
+    #if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 9, 0)
+    if ((flags & MAP_USER_RESIDENT) && curr_mm == current->mm) {
+        return pin_user_pages_fast(start, n_pages, gup_flags, pages);
+    }
+    #endif
+
+    #if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 5, 0)
+        return pin_user_pages_remote(curr_mm, start, n_pages, gup_flags, pages, NULL);
+    #elif LINUX_VERSION_CODE >= KERNEL_VERSION(5, 9, 0)
+        return pin_user_pages_remote(curr_mm, start, n_pages, gup_flags, pages, NULL, NULL);
+    #elif LINUX_VERSION_CODE >= KERNEL_VERSION(5, 4, 0)
+        return pin_user_pages_remote(curr_task, curr_mm, start, n_pages, gup_flags, pages, NULL, NULL);
+    #else
+        return get_user_pages_remote(curr_task, curr_mm, start, n_pages, (flags & MAP_USER_READ_ONLY) ? 0 : 1, pages, NULL, NULL);
+    #endif
+}
+
+// DMA direction of the host pages of a buffer, as given by its access hint (see MAP_USER_READ_ONLY, MAP_USER_WRITE_ONLY)
+static inline enum dma_data_direction user_pg_dma_dir(uint32_t access) {
+    if (access & MAP_USER_READ_ONLY) {
+        return DMA_TO_DEVICE;
+    } else if (access & MAP_USER_WRITE_ONLY) {
+        return DMA_FROM_DEVICE;
+    } else {
+        return DMA_BIDIRECTIONAL;
+    }
+}
+
+// Releases the pins taken by tlb_get_user_pages (one per entry of pages)
+static void unpin_pages(struct page **pages, uint64_t n_pins) {
+    #if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 4, 0)
+        unpin_user_pages(pages, n_pins);
+    #else
+        for (uint64_t i = 0; i < n_pins; i++) {
+            put_page(pages[i]);
+        }
+    #endif
 }
 
-struct user_pages* tlb_get_user_pages(struct vfpga_dev *device, struct pf_aligned_desc *pf_desc, pid_t hpid, struct task_struct *curr_task, struct mm_struct *curr_mm, int32_t mem_block) {
+struct user_pages* tlb_get_user_pages(struct vfpga_dev *device, struct pf_aligned_desc *pf_desc, pid_t hpid, struct task_struct *curr_task, struct mm_struct *curr_mm, int32_t mem_block, uint32_t mem_stripe, uint32_t flags) {
     int ret_val = 0;
     int pg_inc, pg_size;
     struct bus_driver_data *bd_data = device->bd_data;
@@ -278,44 +724,70 @@ struct user_pages* tlb_get_user_pages(struct vfpga_dev *device, struct pf_aligne
     // Allocate struct to hold the metadata, the actual pages and an array for the physical addresses
     struct user_pages *user_pg = kzalloc(sizeof(struct user_pages), GFP_KERNEL);
     BUG_ON(!user_pg);
-
-    user_pg->pages = vmalloc(pf_desc->n_pages * sizeof(*user_pg->pages));
-    BUG_ON(!user_pg->pages);
-    for (int i = 0; i < pf_desc->n_pages; i++) {
-        user_pg->pages[i] = NULL;
+    INIT_LIST_HEAD(&user_pg->lru);
+    user_pg->access = flags & MAP_USER_ACCESS_MASK;
+
+    /*
+     * Hugepage buffers only pin the first page of each large page: the pin holds the whole (compound) hugepage and all 
+     * the addresses are derived from its first page, so a large page costs one pin, one cache flush and one DMA mapping, 
+     * rather than one per 4KB page. The other buffers pin every page.
+     */
+    uint64_t pin_stride = pf_desc->hugepages ? bd_data->n_pages_in_huge : 1;
+    uint64_t n_pins = pf_desc->n_pages / pin_stride;
+
+    // Small buffers get their page arrays from the slab, only large ones fall back to vmalloc
+    user_pg->pages = kvcalloc(n_pins, sizeof(*user_pg->pages), GFP_KERNEL);
+    user_pg->hpages = kvmalloc_array(pf_desc->n_pages, sizeof(uint64_t), GFP_KERNEL);
+    if (!user_pg->pages || !user_pg->hpages) {
+        pr_warn("could not allocate page arrays for %d pages\n", pf_desc->n_pages);
+        kvfree(user_pg->pages);
+        kvfree(user_pg->hpages);
+        kfree(user_pg);
+        return NULL;
     }
-
-    user_pg->hpages = vmalloc(pf_desc->n_pages * sizeof(uint64_t));
-    BUG_ON(!user_pg->hpages);
     
     dbg_info(
-        "allocated %lu bytes for page pointer array for %d pages @0x%p\n",
-        pf_desc->n_pages * sizeof(*user_pg->pages), pf_desc->n_pages, user_pg->pages
+        "allocated %llu bytes for page pointer array for %d pages @0x%p\n",
+        n_pins * sizeof(*user_pg->pages), pf_desc->n_pages, user_pg->pages
     );
     dbg_info("pages=0x%p\n", user_pg->pages);
 
     // Pin the pages
-    // On newer kernels, pin_user_pages_remote is preferred over get_user_pages_remote for DMA,
-    // as it guarantees that the pages remain pinned (and not just the page struct) until explicitly unpinned
-    #if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 5, 0)
-        ret_val = pin_user_pages_remote(curr_mm, (unsigned long) pf_desc->vaddr << PAGE_SHIFT, pf_desc->n_pages, FOLL_WRITE | FOLL_LONGTERM, user_pg->pages, NULL);
-    #elif LINUX_VERSION_CODE >= KERNEL_VERSION(5, 9, 0)
-        ret_val = pin_user_pages_remote(curr_mm, (unsigned long) pf_desc->vaddr << PAGE_SHIFT, pf_desc->n_pages, FOLL_WRITE | FOLL_LONGTERM, user_pg->pages, NULL, NULL);
-    #elif LINUX_VERSION_CODE >= KERNEL_VERSION(5, 4, 0)
-        ret_val = pin_user_pages_remote(curr_task, curr_mm, (unsigned long) pf_desc->vaddr << PAGE_SHIFT, pf_desc->n_pages, FOLL_WRITE | FOLL_LONGTERM, user_pg->pages, NULL, NULL);
-    #else
-        ret_val = get_user_pages_remote(curr_task, curr_mm, (unsigned long) pf_desc->vaddr << PAGE_SHIFT, pf_desc->n_pages, 1, user_pg->pages, NULL, NULL);
-    #endif
-    dbg_info("pin_user_pages_remote(%llx, n_pages = %d, page start = %lx, hugepages = %d)\n", pf_desc->vaddr, pf_desc->n_pages, page_to_pfn(user_pg->pages[0]), pf_desc->hugepages);
+    if (pf_desc->hugepages) {
+        ret_val = 0;
+        for (uint64_t i = 0; i < n_pins; i++) {
+            unsigned long start = (unsigned long) (pf_desc->vaddr + i * pin_stride) << PAGE_SHIFT;
+            long pinned = pin_pages(curr_task, curr_mm, start, 1, flags, &user_pg->pages[i]);
+            if (pinned < 1) {
+                break;
+            }
+            ret_val++;
+        }
+    } else {
+        ret_val = pin_pages(curr_task, curr_mm, (unsigned long) pf_desc->vaddr << PAGE_SHIFT, n_pins, flags, user_pg->pages);
+    }
+    dbg_info("pinned user pages (%llx, n_pages = %d, n_pins = %d, hugepages = %d)\n", pf_desc->vaddr, pf_desc->n_pages, ret_val, pf_desc->hugepages);
 
-    if (ret_val < pf_desc->n_pages) {
+    if (ret_val < (int) n_pins) {
         pr_warn("could not get all user pages, %d\n", ret_val);
         goto fail_host_alloc;
     }
-
-    // Flush cache
-    for (int i = 0; i < pf_desc->n_pages; i++) {
-        flush_dcache_page(user_pg->pages[i]);
+    user_pg->n_pins = n_pins;
+
+    // Flush cache; once per hugepage, where possible
+    // On cache-coherent platforms (ECI), the vFPGA snoops the CPU caches, so there is nothing to flush
+    for (uint64_t i = 0; i < n_pins && !device->bd_data->coherent; i++) {
+        if (pf_desc->hugepages) {
+            #if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 16, 0)
+                flush_dcache_folio(page_folio(user_pg->pages[i]));
+            #else
+                for (uint64_t j = 0; j < pin_stride; j++) {
+                    flush_dcache_page(nth_page(user_pg->pages[i], j));
+                }
+            #endif
+        } else {
+            flush_dcache_page(user_pg->pages[i]);
+        }
     }
 
     // Find the physical address of the pages
@@ -325,27 +797,33 @@ struct user_pages* tlb_get_user_pages(struct vfpga_dev *device, struct pf_aligne
     // Therefore, we use the dma_map_single to obtain a physical address
     // suitable for FPGA accesses.
     user_pg->needs_explicit_sync = false;
-    if (pf_desc->hugepages) {
+    if (device->bd_data->coherent) {
+        // On cache-coherent platforms (ECI), there is no IOMMU between the vFPGA and host memory; 
+        // the FPGA accesses the CPU's physical addresses directly, without any cache maintenance
+        for (int i = 0; i < pf_desc->n_pages; i++) {
+            user_pg->hpages[i] = page_to_phys(user_pg->pages[i / pin_stride]) + (i % pin_stride) * PAGE_SIZE;
+        }
+    } else if (pf_desc->hugepages) {
         // Map each hugepage (e.g., 2MB) chunk
         for (int i = 0; i < pf_desc->n_pages; i+=device->bd_data->n_pages_in_huge) {
             // Obtain the physical address of this hugepage chunk
             // Generally, for the hardware TLB, only the starting address of the page is needed
             // The exact physical address is calculated from the starting address and the virtual address offset
             user_pg->hpages[i] = dma_map_single(
-                &device->bd_data->pci_dev->dev,
-                page_to_virt(user_pg->pages[i]),
+                device->bd_data->dma_dev,
+                page_to_virt(user_pg->pages[i / pin_stride]),
                 device->bd_data->ltlb_meta->page_size,
-                DMA_BIDIRECTIONAL
+                user_pg_dma_dir(user_pg->access)
             );
 
-            if (dma_mapping_error(&device->bd_data->pci_dev->dev, user_pg->hpages[i])) {
+            if (dma_mapping_error(device->bd_data->dma_dev, user_pg->hpages[i])) {
                 pr_warn("failed to map user pages and obtain physical address");
                 goto fail_dma_map;
             }
 
-            if (dma_need_sync(&device->bd_data->pci_dev->dev, user_pg->hpages[i])) {
+            if (dma_need_sync(device->bd_data->dma_dev, user_pg->hpages[i])) {
                 pr_warn("the DMA buffer with virt_addr %lx, phys_addr %lx, may be subject to cache coherency issues and may require explicit synchronization which is not supported out of the box by Coyote\n", 
-                    (unsigned long) page_to_virt(user_pg->pages[i]), (unsigned long) user_pg->hpages[i]
+                    (unsigned long) page_to_virt(user_pg->pages[i / pin_stride]), (unsigned long) user_pg->hpages[i]
                 );
                 user_pg->needs_explicit_sync = true;
             }
@@ -367,18 +845,18 @@ struct user_pages* tlb_get_user_pages(struct vfpga_dev *device, struct pf_aligne
         // and obtain its physical address
         for (int i = 0; i < pf_desc->n_pages; i++) {
             user_pg->hpages[i] = dma_map_single(
-                &device->bd_data->pci_dev->dev,
+                device->bd_data->dma_dev,
                 page_to_virt(user_pg->pages[i]),
                 PAGE_SIZE,
-                DMA_BIDIRECTIONAL
+                user_pg_dma_dir(user_pg->access)
             );
 
-            if (dma_mapping_error(&device->bd_data->pci_dev->dev, user_pg->hpages[i])) {
+            if (dma_mapping_error(device->bd_data->dma_dev, user_pg->hpages[i])) {
                 pr_warn("failed to map user pages and obtain physical address");
                 goto fail_dma_map;
             }
 
-            if (dma_need_sync(&device->bd_data->pci_dev->dev, user_pg->hpages[i])) {
+            if (dma_need_sync(device->bd_data->dma_dev, user_pg->hpages[i])) {
                 pr_warn("the DMA buffer with virt_addr %lx, phys_addr %lx, may be subject to cache coherency issues and may require explicit synchronization which is not supported out of the box by Coyote\n", 
                     (unsigned long) page_to_virt(user_pg->pages[i]), (unsigned long) user_pg->hpages[i]
                 );
@@ -387,79 +865,56 @@ struct user_pages* tlb_get_user_pages(struct vfpga_dev *device, struct pf_aligne
         }
     }
 
+    // Populate metadata
+    user_pg->vaddr = pf_desc->vaddr;
+    user_pg->n_pages = pf_desc->n_pages;
+    user_pg->huge = pf_desc->hugepages;
+    user_pg->fault_ahead = FAULT_AHEAD_DEFAULT;
+    user_pg->ctid = pf_desc->ctid;
+    user_pg->host = HOST_ACCESS;
+    user_pg->device = device;
+    user_pg->mem_block = mem_block;
+    user_pg->mem_stripe = mem_stripe;
+
     // Allocate memory on the card if available
     if(bd_data->en_mem) {
-        user_pg->cpages = vmalloc(pf_desc->n_pages * sizeof(uint64_t));
-        BUG_ON(!user_pg->cpages);
-
-        int32_t target_block;
-        #ifdef PLATFORM_ULTRASCALE_PLUS
-        // On UltraScale+ devices, each memory channel can access the entire memory
-        // Therefore, mem_block is ignored, since the entire memory is treated as one
-        // partition with no fine-grained control over memory allocation
-        if (mem_block != -1) {
-            dbg_info("memory block specified, but UltraScale+ devices do not support block memory; ignoring...\n");
-        }
-        target_block = -1;
-        #endif
-
-        #ifdef PLATFORM_VERSAL
-        if (device->bd_data->en_block_mem) {
-            if (mem_block != -1) {
-                // User specified memory block; realign to current vFPGA (i.e. HBM_AXI_%d)
-                target_block = device->id * device->bd_data->n_card_axi + mem_block;
-
-                // Find correct HBM pseudo-channel by applying spacing transformation from cr_hbm.tcl
-                target_block = DIV_ROUND_CLOSEST(N_MEM_BLOCKS * (target_block + 1), device->bd_data->n_fpga_reg * device->bd_data->n_card_axi + 1) - 1;
-
-            } else {
-                // No memory block specified; throw error
-                dbg_info("no target block specified, but shell was synthesized with block HBM enabled\n");
-                ret_val = -EINVAL;
-                goto fail_card_alloc;
-            }
-        } else {
-            // Unified implementation, allows access to entire memory as well as fine-grained allocations
-            if (mem_block != -1) {
-                target_block = device->id * device->bd_data->n_card_axi + mem_block;
-                target_block = DIV_ROUND_CLOSEST(N_MEM_BLOCKS * (target_block + 1), device->bd_data->n_fpga_reg * device->bd_data->n_card_axi + 1) - 1;
-            } else {
-                target_block = -1;
-            }
-        }
-        #endif
- 
-        ret_val = alloc_card_memory(device, user_pg->cpages, pf_desc->n_pages, pf_desc->hugepages, target_block);
+        ret_val = get_card_memory(device, user_pg);
         if (ret_val) {
             dbg_info("could not get all card pages, %d\n", ret_val);
             goto fail_card_alloc;
         }
     }
 
-    // Populate metadata and store to hash table
-    user_pg->vaddr = pf_desc->vaddr;
-    user_pg->n_pages = pf_desc->n_pages;
-    user_pg->huge = pf_desc->hugepages;
-    user_pg->ctid = pf_desc->ctid;
-    user_pg->host = HOST_ACCESS;
+    // With lazy unpinning, the buffer stays pinned and mapped until the kernel invalidates its virtual address range 
+    // (e.g., munmap, process exit), rather than being released when user-space unmaps it
+    #if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 10, 0)
+        if (en_lazy_unpin) {
+            INIT_WORK(&user_pg->work_release, user_pg_release_work);
+            ret_val = mmu_interval_notifier_insert(
+                &user_pg->notifier, curr_mm, pf_desc->vaddr << PAGE_SHIFT, pf_desc->n_pages << PAGE_SHIFT, &user_pg_notifier_ops
+            );
+            if (ret_val) {
+                pr_warn("could not register MMU notifier, buffer will be released eagerly, ret_val: %d\n", ret_val);
+            } else {
+                user_pg->notifier_registered = true;
+            }
+        }
+    #endif
 
-    hash_add(user_buff_map[device->id][pf_desc->ctid], &user_pg->entry, pf_desc->vaddr);
+    // Store to the buffer map
+    user_pg_tree_insert(user_pg, &user_buff_map[device->id][pf_desc->ctid]);
 
     return user_pg;
 
 fail_host_alloc:
     // Unpin the pages
-    #if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 4, 0)
-        unpin_user_pages(user_pg->pages, ret_val);
-    #else
-        for(int i = 0; i < ret_val; i++) {
-            put_page(user_pg->pages[i]);
-        }
-    #endif
+    if (ret_val > 0) {
+        unpin_pages(user_pg->pages, ret_val);
+    }
 
     // Free the dynamically allocated memory
-    vfree(user_pg->pages);
-    vfree(user_pg->hpages);
+    kvfree(user_pg->pages);
+    kvfree(user_pg->hpages);
     kfree(user_pg);
 
     return NULL;
@@ -469,253 +924,539 @@ fail_dma_map:
     pg_inc = pf_desc->hugepages ? device->bd_data->n_pages_in_huge : 1;
     pg_size = pf_desc->hugepages ? device->bd_data->ltlb_meta->page_size : PAGE_SIZE;
     for (int i = 0; i < pf_desc->n_pages; i+=pg_inc) {
-        dma_unmap_single(&device->bd_data->pci_dev->dev, user_pg->hpages[i], pg_size, DMA_BIDIRECTIONAL);
+        dma_unmap_single(device->bd_data->dma_dev, user_pg->hpages[i], pg_size, user_pg_dma_dir(user_pg->access));
     }
 
     // Unpin the pages
-    #if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 4, 0)
-        unpin_user_pages(user_pg->pages, pf_desc->n_pages);
-    #else
-        for(int i = 0; i < pf_desc->n_pages; i++) {
-            put_page(user_pg->pages[i]);
-        }
-    #endif
+    unpin_pages(user_pg->pages, n_pins);
     
     // Free the dynamically allocated memory
-    vfree(user_pg->pages);
-    vfree(user_pg->hpages);
+    kvfree(user_pg->pages);
+    kvfree(user_pg->hpages);
     kfree(user_pg);
 
     return NULL;
 
 fail_card_alloc:
-    // Unmap DMA
+    // Unmap DMA; the pages are not mapped on cache-coherent platforms
     pg_inc = pf_desc->hugepages ? device->bd_data->n_pages_in_huge : 1;
     pg_size = pf_desc->hugepages ? device->bd_data->ltlb_meta->page_size : PAGE_SIZE;
-    for (int i = 0; i < pf_desc->n_pages; i+=pg_inc) {
-        dma_unmap_single(&device->bd_data->pci_dev->dev, user_pg->hpages[i], pg_size, DMA_BIDIRECTIONAL);
+    for (int i = 0; i < pf_desc->n_pages && !device->bd_data->coherent; i+=pg_inc) {
+        dma_unmap_single(device->bd_data->dma_dev, user_pg->hpages[i], pg_size, user_pg_dma_dir(user_pg->access));
     }
 
     // Unpin the pages
-    #if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 4, 0)
-        unpin_user_pages(user_pg->pages, pf_desc->n_pages);
-    #else
-        for(int i = 0; i < pf_desc->n_pages; i++) {
-            put_page(user_pg->pages[i]);
-        }
-    #endif
+    unpin_pages(user_pg->pages, n_pins);
 
     // Free the dynamically allocated memory
-    vfree(user_pg->pages);
-    vfree(user_pg->hpages);
+    kvfree(user_pg->pages);
+    kvfree(user_pg->hpages);
     vfree(user_pg->cpages);
     kfree(user_pg);
 
     return NULL;
 }
 
-int tlb_put_user_pages(struct vfpga_dev *device, uint64_t vaddr, int32_t ctid, pid_t hpid, int dirtied) {
-    BUG_ON(!device);
-    struct bus_driver_data * bd_data = device->bd_data;
-    BUG_ON(!bd_data);
+// Releases the card memory and the host pages of a buffer, removes it from the buffer map and frees it
+// The buffer must have been unmapped from the TLB beforehand; the caller must hold user_buff_lock
+static int release_user_pg(struct vfpga_dev *device, struct user_pages *tmp_entry, int dirtied) {
+    struct bus_driver_data *bd_data = device->bd_data;
 
-    uint64_t vaddr_tmp = (vaddr & bd_data->stlb_meta->page_mask) >> bd_data->stlb_meta->page_shift;
+    // Release card memory, unless it was already evicted; shared card memory is only released with its last mapping
+    if (tmp_entry->shared) {
+        put_card_shared(device, tmp_entry->shared);
+    } else if(bd_data->en_mem && tmp_entry->cpages) {
+        spin_lock(&device->card_lru_lock);
+        list_del_init(&tmp_entry->lru);
+        spin_unlock(&device->card_lru_lock);
+
+        free_card_memory(device, tmp_entry->cpages, tmp_entry->n_pages, tmp_entry->huge);
+        vfree(tmp_entry->cpages);
+    }     
+    
+    // Release host pages
+    if(tmp_entry->dma_attach) {
+        #if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 2, 0)
+            // Unmap buffer from vFPGA bus address space
+            dma_resv_lock(tmp_entry->buf->resv, NULL);
+            dma_buf_unmap_attachment(tmp_entry->dma_attach, tmp_entry->sgt, DMA_BIDIRECTIONAL);
+            dma_resv_unlock(tmp_entry->buf->resv);
 
-    struct user_pages *tmp_entry;
-    hash_for_each_possible(user_buff_map[device->id][ctid], tmp_entry, entry, vaddr_tmp) {
-        if(vaddr_tmp >= tmp_entry->vaddr && vaddr_tmp <= tmp_entry->vaddr + tmp_entry->n_pages) {
-            // Unmap from TLB
-            tlb_unmap_gup(device, tmp_entry, hpid);
+            // Detach vFPGA from DMABuff
+            kfree(tmp_entry->dma_attach->importer_priv);
+            dma_buf_detach(tmp_entry->buf, tmp_entry->dma_attach);
 
-            // Release card memory
-            if(bd_data->en_mem) {
-                free_card_memory(device, tmp_entry->cpages, tmp_entry->n_pages, tmp_entry->huge);
-                vfree(tmp_entry->cpages);
-            }     
-            
-            // Release host pages
-            if(tmp_entry->dma_attach) {
-                #if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 2, 0)
-                    // Unmap buffer from vFPGA bus address space
-                    dma_resv_lock(tmp_entry->buf->resv, NULL);
-                    dma_buf_unmap_attachment(tmp_entry->dma_attach, tmp_entry->sgt, DMA_BIDIRECTIONAL);
-                    dma_resv_unlock(tmp_entry->buf->resv);
-
-                    // Detach vFPGA from DMABuff
-                    kfree(tmp_entry->dma_attach->importer_priv);
-                    dma_buf_detach(tmp_entry->buf, tmp_entry->dma_attach);
-
-                    // Decrease DMABuf refcount
-                    dma_buf_put(tmp_entry->buf);
-                #else
-                    pr_warn("Error releasing user pages! DMA Bufs for Coyote GPU integration is only available on Linux >= 6.2.0. If you're seeing this message and your driver compiled: this is likely a bug; please report it to the Coyote team\n");
-                    return -1;
-                #endif
-            } else {
-                if(dirtied) {
-                    for(int i = 0; i < tmp_entry->n_pages; i++) {
-                        SetPageDirty(tmp_entry->pages[i]);
-                    }
-                }
-
-                // Unmap DMA
-                int pg_inc = tmp_entry->huge ? device->bd_data->n_pages_in_huge : 1;
-                int pg_size = tmp_entry->huge ? device->bd_data->ltlb_meta->page_size : PAGE_SIZE;
-                for (int i = 0; i < tmp_entry->n_pages; i+=pg_inc) {
-                    dma_unmap_single(&device->bd_data->pci_dev->dev, tmp_entry->hpages[i], pg_size, DMA_BIDIRECTIONAL);
-                }
-                
-                // Unpin the pages
-                #if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 4, 0)
-                    unpin_user_pages(tmp_entry->pages, tmp_entry->n_pages);
-                #else
-                    for(int i = 0; i < tmp_entry->n_pages; i++) {
-                        put_page(tmp_entry->pages[i]);
-                    }
-                #endif
-                
-                // Release memory to hold pages
-                vfree(tmp_entry->pages);
+            // Decrease DMABuf refcount
+            dma_buf_put(tmp_entry->buf);
+        #else
+            pr_warn("Error releasing user pages! DMA Bufs for Coyote GPU integration is only available on Linux >= 6.2.0. If you're seeing this message and your driver compiled: this is likely a bug; please report it to the Coyote team\n");
+            return -1;
+        #endif
+    } else if (!tmp_entry->card_only) {
+        // Hugepage buffers only hold their first page of each large page, which marks the whole hugepage dirty
+        // Read-only buffers are never written by the vFPGA, so their pages are left clean (no write-back of file-backed pages)
+        if(dirtied && !(tmp_entry->access & MAP_USER_READ_ONLY)) {
+            for(uint64_t i = 0; i < tmp_entry->n_pins; i++) {
+                SetPageDirty(tmp_entry->pages[i]);
             }
+        }
 
-            // Release memory to hold physical addresses
-            vfree(tmp_entry->hpages);
-
-            // Remove from map
-            hash_del(&tmp_entry->entry);
+        // Unmap DMA; the pages are not mapped on cache-coherent platforms
+        int pg_inc = tmp_entry->huge ? device->bd_data->n_pages_in_huge : 1;
+        int pg_size = tmp_entry->huge ? device->bd_data->ltlb_meta->page_size : PAGE_SIZE;
+        for (int i = 0; i < tmp_entry->n_pages && !device->bd_data->coherent; i+=pg_inc) {
+            dma_unmap_single(device->bd_data->dma_dev, tmp_entry->hpages[i], pg_size, user_pg_dma_dir(tmp_entry->access));
         }
+        
+        // Unpin the pages
+        unpin_pages(tmp_entry->pages, tmp_entry->n_pins);
+        
+        // Release memory to hold pages
+        kvfree(tmp_entry->pages);
     }
 
+    // Release memory to hold physical addresses
+    kvfree(tmp_entry->hpages);
+    bitmap_free(tmp_entry->card_pages);
+
+    // Remove from map
+    user_pg_tree_remove(tmp_entry, &user_buff_map[device->id][tmp_entry->ctid]);
+    kfree(tmp_entry);
+
     return 0;
 }
 
-int tlb_put_user_pages_ctid(struct vfpga_dev *device, int32_t ctid, pid_t hpid, int dirtied) {
-    int i, bkt;
-    struct user_pages *tmp_entry;
+// Stops the MMU notifier of a buffer (if any); returns false if the notifier has already invalidated 
+// the buffer, in which case the buffer is released by user_pg_release_work and must not be touched by the caller
+static bool stop_user_pg_notifier(struct user_pages *tmp_entry) {
+    #if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 10, 0)
+        if (tmp_entry->notifier_registered) {
+            // Waits for any invalidation in progress to complete
+            mmu_interval_notifier_remove(&tmp_entry->notifier);
+            tmp_entry->notifier_registered = false;
+        }
+    #endif
+    return !atomic_read(&tmp_entry->stale);
+}
 
+int tlb_put_user_pages(struct vfpga_dev *device, uint64_t vaddr, int32_t ctid, pid_t hpid, int dirtied) {
     BUG_ON(!device);
-    struct bus_driver_data *bd_data = device->bd_data;
+    struct bus_driver_data * bd_data = device->bd_data;
     BUG_ON(!bd_data);
 
-    hash_for_each(user_buff_map[device->id][ctid], bkt, tmp_entry, entry) {
+    uint64_t vaddr_tmp = (vaddr & bd_data->stlb_meta->page_mask) >> bd_data->stlb_meta->page_shift;
+
+    struct user_pages *tmp_entry, *tmp_next;
+    for_each_user_pg_safe(&user_buff_map[device->id][ctid], tmp_entry, tmp_next, vaddr_tmp, vaddr_tmp) {
+        if (!stop_user_pg_notifier(tmp_entry)) {
+            continue;
+        }
+
         // Unmap from TLB
         tlb_unmap_gup(device, tmp_entry, hpid);
-        
-        // Release card memory
-        if(bd_data->en_mem) {
-            free_card_memory(device, tmp_entry->cpages, tmp_entry->n_pages, tmp_entry->huge);
-            vfree(tmp_entry->cpages);
+
+        int ret_val = release_user_pg(device, tmp_entry, dirtied);
+        if (ret_val) {
+            return ret_val;
         }
+    }
 
-        if(tmp_entry->dma_attach) {
-            #if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 2, 0)  
-                // Unmap buffer from vFPGA bus address space
-                dma_resv_lock(tmp_entry->buf->resv, NULL);
-                dma_buf_unmap_attachment(tmp_entry->dma_attach, tmp_entry->sgt, DMA_BIDIRECTIONAL);
-                dma_resv_unlock(tmp_entry->buf->resv);
+    return 0;
+}
 
-                // Detach vFPGA from DMABuff
-                kfree(tmp_entry->dma_attach->importer_priv);
-                dma_buf_detach(tmp_entry->buf, tmp_entry->dma_attach);
+// Unmaps a set of buffers from the TLB with a single invalidation wait and releases them; see tlb_put_user_pages_batch
+static int put_user_pages_set(struct vfpga_dev *device, struct user_pages **user_pgs, uint32_t n_pgs, int32_t ctid, pid_t hpid, int dirtied) {
+    if (n_pgs == 0) {
+        return 0;
+    }
 
-                // Decrease DMABuf refcount
-                dma_buf_put(tmp_entry->buf);
-            #else
-                pr_warn("Error releasing user pages! DMA Bufs for Coyote GPU integration is only available on Linux >= 6.2.0. If you're seeing this message and your driver compiled: this is likely a bug; please report it to the Coyote team\n");
-                return -1;
-            #endif
-        } else {
-            if (dirtied) {
-                for (i = 0; i < tmp_entry->n_pages; i++) {
-                    SetPageDirty(tmp_entry->pages[i]);
-                }
+    mutex_lock(&device->mmu_lock);
+
+    for (int i = 0; i < n_pgs; i++) {
+        tlb_clear_entries(device, user_pgs[i], 0, user_pgs[i]->n_pages, hpid);
+    }
+
+    // One invalidation per buffer; only the last one raises the completion IRQ, so there is a single wait for the whole set
+    for (int i = 0; i < n_pgs; i++) {
+        invalidate_tlb_range(device, user_pgs[i]->vaddr, user_pgs[i]->n_pages, hpid, i == n_pgs - 1);
+    }
+    wait_event_interruptible(device->waitqueue_invldt, atomic_read(&device->wait_invldt) == FLAG_SET);
+    atomic_set(&device->wait_invldt, FLAG_CLR);
+
+    mutex_unlock(&device->mmu_lock);
+    VFPGA_STAT_ADD(device, ctid, tlb_invalidations, n_pgs);
+
+    for (int i = 0; i < n_pgs; i++) {
+        int ret_val = release_user_pg(device, user_pgs[i], dirtied);
+        if (ret_val) {
+            return ret_val;
+        }
+    }
+
+    return 0;
+}
+
+int tlb_put_user_pages_batch(struct vfpga_dev *device, uint64_t *vaddrs, uint32_t n_vaddrs, int32_t ctid, pid_t hpid, int dirtied) {
+    BUG_ON(!device);
+    struct bus_driver_data * bd_data = device->bd_data;
+    BUG_ON(!bd_data);
+
+    struct user_pages **user_pgs = kmalloc_array(n_vaddrs, sizeof(struct user_pages *), GFP_KERNEL);
+    if (!user_pgs) {
+        return -ENOMEM;
+    }
+
+    // Same lookup as in tlb_put_user_pages; a buffer listed more than once is only released once
+    int ret_val = 0;
+    uint32_t n_pgs = 0;
+    for (int i = 0; i < n_vaddrs && !ret_val; i++) {
+        uint64_t vaddr_tmp = (vaddrs[i] & bd_data->stlb_meta->page_mask) >> bd_data->stlb_meta->page_shift;
+
+        bool full = false;
+        struct user_pages *tmp_entry;
+        for_each_user_pg(&user_buff_map[device->id][ctid], tmp_entry, vaddr_tmp, vaddr_tmp) {
+            bool listed = false;
+            for (int j = 0; j < n_pgs; j++) {
+                listed |= (user_pgs[j] == tmp_entry);
             }
-            
-            // Unmap DMA
-            int pg_inc = tmp_entry->huge ? device->bd_data->n_pages_in_huge : 1;
-            int pg_size = tmp_entry->huge ? device->bd_data->ltlb_meta->page_size : PAGE_SIZE;
-            for (int i = 0; i < tmp_entry->n_pages; i+=pg_inc) {
-                dma_unmap_single(&device->bd_data->pci_dev->dev, tmp_entry->hpages[i], pg_size, DMA_BIDIRECTIONAL);
+            if (listed) {
+                continue;
+            }
+
+            if (n_pgs == n_vaddrs) {
+                full = true;
+                break;
+            }
+
+            if (stop_user_pg_notifier(tmp_entry)) {
+                user_pgs[n_pgs++] = tmp_entry;
             }
-            
-            // Unpin the pages
-            #if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 4, 0)
-                unpin_user_pages(tmp_entry->pages, tmp_entry->n_pages);
-            #else
-                for(int i = 0; i < tmp_entry->n_pages; i++) {
-                    put_page(tmp_entry->pages[i]);
-                }
-            #endif
-                
-            
-            // Release memory to hold pages
-            vfree(tmp_entry->pages);
         }
 
-        // Release memory to hold physical addresses
-        vfree(tmp_entry->hpages);
+        // More buffers matched than there are addresses; release the ones collected so far and look the address up again
+        if (full) {
+            ret_val = put_user_pages_set(device, user_pgs, n_pgs, ctid, hpid, dirtied);
+            n_pgs = 0;
+            i--;
+        }
+    }
 
-        // Remove from map
-        hash_del(&tmp_entry->entry);
+    if (!ret_val) {
+        ret_val = put_user_pages_set(device, user_pgs, n_pgs, ctid, hpid, dirtied);
+    }
+
+    kfree(user_pgs);
+    return ret_val;
+}
+
+int tlb_put_user_pages_ctid(struct vfpga_dev *device, int32_t ctid, pid_t hpid, int dirtied) {
+    struct user_pages *tmp_entry, *tmp_next;
+
+    BUG_ON(!device);
+    struct bus_driver_data *bd_data = device->bd_data;
+    BUG_ON(!bd_data);
+
+    // Unmap all the buffers from the TLB in one go
+    tlb_unmap_gup_ctid(device, ctid, hpid);
+
+    for_each_user_pg_safe(&user_buff_map[device->id][ctid], tmp_entry, tmp_next, 0, U64_MAX) {
+        if (!stop_user_pg_notifier(tmp_entry)) {
+            continue;
+        }
+
+        int ret_val = release_user_pg(device, tmp_entry, dirtied);
+        if (ret_val) {
+            return ret_val;
+        }
     }
 
     return 0;
 }
 
-void migrate_to_card(struct vfpga_dev *device, struct user_pages *user_pg) {
-    mutex_lock(&device->offload_lock);
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 10, 0)
+void user_pg_release_work(struct work_struct *work) {
+    struct user_pages *user_pg = container_of(work, struct user_pages, work_release);
+    struct vfpga_dev *device = user_pg->device;
+    int32_t ctid = user_pg->ctid;
+
+    // The notifier can't be removed from its own callback, so it is removed here; the TLB was already cleared in the callback 
+    mutex_lock(&user_buff_lock[device->id][ctid]);
+    if (user_pg->notifier_registered) {
+        mmu_interval_notifier_remove(&user_pg->notifier);
+        user_pg->notifier_registered = false;
+    }
+    release_user_pg(device, user_pg, 1);
+    mutex_unlock(&user_buff_lock[device->id][ctid]);
 
-    trigger_dma_offload(device, user_pg->hpages, user_pg->cpages, user_pg->n_pages, user_pg->huge);
-    
-    wait_event_interruptible(device->waitqueue_offload, atomic_read(&device->wait_offload) == FLAG_SET);
-    atomic_set(&device->wait_offload, FLAG_CLR);
+    dbg_info("released invalidated buffer, vFPGA %d, ctid %d\n", device->id, ctid);
+}
+
+bool user_pg_invalidate(struct mmu_interval_notifier *mni, const struct mmu_notifier_range *range, unsigned long cur_seq) {
+    struct user_pages *user_pg = container_of(mni, struct user_pages, notifier);
+    struct vfpga_dev *device = user_pg->device;
+
+    // Clearing the TLB requires to sleep (to wait for the invalidation to complete)
+    if (!mmu_notifier_range_blockable(range)) {
+        return false;
+    }
+
+    mmu_interval_set_seq(mni, cur_seq);
+
+    // Only the first invalidation clears the TLB and schedules the release of the buffer 
+    if (!atomic_xchg(&user_pg->stale, 1)) {
+        dbg_info("MMU notifier invalidated buffer %llx, vFPGA %d, ctid %d\n", user_pg->vaddr << PAGE_SHIFT, device->id, user_pg->ctid);
+        tlb_unmap_gup(device, user_pg, device->pid_array[user_pg->ctid]);
+        VFPGA_STAT_ADD(device, user_pg->ctid, mmu_invalidations, 1);
+        queue_work(device->wqueue_pfault, &user_pg->work_release);
+    }
+
+    return true;
+}
+#endif
+
+// Copies n_pages pages between the host (hpages) and the card (cpages), to the card (dst = CARD_ACCESS) or to the host (dst = HOST_ACCESS), and waits for the copy
+static void dma_copy_pages(struct vfpga_dev *device, uint64_t *hpages, uint64_t *cpages, uint32_t n_pages, bool huge, int32_t dst) {
+    // Completion is only signalled if at least one descriptor was issued
+    if (dst == CARD_ACCESS) {
+        mutex_lock(&device->offload_lock);
+        if (trigger_dma_offload(device, hpages, cpages, n_pages, huge)) {
+            wait_event_interruptible(device->waitqueue_offload, atomic_read(&device->wait_offload) == FLAG_SET);
+            atomic_set(&device->wait_offload, FLAG_CLR);
+        }
+        mutex_unlock(&device->offload_lock);
+    } else {
+        mutex_lock(&device->sync_lock);
+        if (trigger_dma_sync(device, hpages, cpages, n_pages, huge)) {
+            wait_event_interruptible(device->waitqueue_sync, atomic_read(&device->wait_sync) == FLAG_SET);
+            atomic_set(&device->wait_sync, FLAG_CLR);
+        }
+        mutex_unlock(&device->sync_lock);
+    }
+}
+
+// Copies n_pages pages of a buffer, starting at page pg_offs, to the card (dst = CARD_ACCESS) or to the host (dst = HOST_ACCESS)
+// The copy is skipped where the access hint guarantees it is not needed: the card copy of a read-only buffer equals the host copy, 
+// and the host contents of a write-only buffer are never read by the vFPGA; the residency is tracked as for any other buffer
+static void migrate_range(struct vfpga_dev *device, struct user_pages *user_pg, uint64_t pg_offs, uint32_t n_pages, int32_t dst) {
+    if ((dst == HOST_ACCESS && (user_pg->access & MAP_USER_READ_ONLY)) || (dst == CARD_ACCESS && (user_pg->access & MAP_USER_WRITE_ONLY))) {
+        dbg_info("buffer %llx has access hint %x, skipping migration\n", user_pg->vaddr << PAGE_SHIFT, user_pg->access);
+    } else {
+        dma_copy_pages(device, user_pg->hpages + pg_offs, user_pg->cpages + pg_offs, n_pages, user_pg->huge, dst);
+    }
 
-    mutex_unlock(&device->offload_lock);
+    user_pg->n_migrations++;
+    VFPGA_STAT_ADD(device, user_pg->ctid, migrations[dst], 1);
+}
+
+void migrate_to_card(struct vfpga_dev *device, struct user_pages *user_pg) {
+    migrate_range(device, user_pg, 0, user_pg->n_pages, CARD_ACCESS);
+    user_pg->card_valid = true;
 }
 
 void migrate_to_host(struct vfpga_dev *device, struct user_pages *user_pg) {
-    mutex_lock(&device->sync_lock);
+    migrate_range(device, user_pg, 0, user_pg->n_pages, HOST_ACCESS);
+    user_pg->card_valid = true;
+}
 
-    trigger_dma_sync(device, user_pg->hpages, user_pg->cpages, user_pg->n_pages, user_pg->huge);
-    
-    wait_event_interruptible(device->waitqueue_sync, atomic_read(&device->wait_sync) == FLAG_SET);
-    atomic_set(&device->wait_sync, FLAG_CLR);
+// Records a whole-buffer migration, which always reverses the previous one; returns true once the buffer ping-pongs,
+// i.e. it was migrated pingpong_threshold times in a row, each time within PINGPONG_WINDOW_MS of the previous migration
+static bool note_migration(struct vfpga_dev *device, struct user_pages *user_pg) {
+    unsigned long now = jiffies;
+    if (user_pg->n_migrations && time_before(now, user_pg->last_migration + msecs_to_jiffies(PINGPONG_WINDOW_MS))) {
+        user_pg->n_pingpong++;
+    } else {
+        user_pg->n_pingpong = 0;
+    }
+    user_pg->last_migration = now;
 
-    mutex_unlock(&device->sync_lock);
+    return device->bd_data->pingpong_threshold && user_pg->n_pingpong >= device->bd_data->pingpong_threshold;
 }
 
-int offload_user_pages(struct vfpga_dev *device, uint64_t vaddr, uint32_t len, int32_t ctid) {
+// Switches a buffer to per-page residency, starting from its current (whole-buffer) residency
+// The buffer must have card memory; the card copy is no longer considered valid, since the two copies now diverge page by page
+static int split_user_pages(struct vfpga_dev *device, struct user_pages *user_pg) {
+    user_pg->card_pages = bitmap_zalloc(user_pg->n_pages, GFP_KERNEL);
+    if (!user_pg->card_pages) {
+        pr_warn("could not split buffer %llx, migrating it whole\n", user_pg->vaddr << PAGE_SHIFT);
+        return -ENOMEM;
+    }
+
+    if (user_pg->host == CARD_ACCESS) {
+        bitmap_fill(user_pg->card_pages, user_pg->n_pages);
+    }
+    user_pg->card_valid = false;
+
+    dbg_info("buffer %llx ping-pongs between host and card, %lld migrations, splitting\n", user_pg->vaddr << PAGE_SHIFT, user_pg->n_migrations);
+    VFPGA_STAT_ADD(device, user_pg->ctid, pingpong_splits, 1);
+    return 0;
+}
+
+// Migrates the pages of a split buffer in [first, last) which don't reside in dst, one DMA transfer per contiguous run
+static void migrate_split_pages(struct vfpga_dev *device, struct user_pages *user_pg, uint64_t first, uint64_t last, int32_t dst) {
+    bool to_card = (dst == CARD_ACCESS);
+    uint64_t run = to_card ? find_next_zero_bit(user_pg->card_pages, last, first) : find_next_bit(user_pg->card_pages, last, first);
+
+    while (run < last) {
+        uint64_t run_end = to_card ? find_next_bit(user_pg->card_pages, last, run) : find_next_zero_bit(user_pg->card_pages, last, run);
+        migrate_range(device, user_pg, run, run_end - run, dst);
+
+        if (to_card) {
+            bitmap_set(user_pg->card_pages, run, run_end - run);
+            run = find_next_zero_bit(user_pg->card_pages, last, run_end);
+        } else {
+            bitmap_clear(user_pg->card_pages, run, run_end - run);
+            run = find_next_bit(user_pg->card_pages, last, run_end);
+        }
+    }
+}
+
+// Handles a page fault on a split buffer: only the faulting range is migrated to the memory of the stream and remapped,
+// the rest of the buffer stays (and remains mapped) where it is
+static void migrate_range_gup(struct vfpga_dev *device, struct pf_aligned_desc *pf_desc, struct user_pages *user_pg, int32_t stream, pid_t hpid) {
+    struct bus_driver_data *bd_data = device->bd_data;
+
+    // Extend the range to whole large TLB pages, so that no coalesced TLB entry spans pages in different memories
+    uint64_t first = max_t(uint64_t, ALIGN_DOWN(pf_desc->vaddr, bd_data->n_pages_in_huge), user_pg->vaddr) - user_pg->vaddr;
+    uint64_t last = min_t(uint64_t, ALIGN(pf_desc->vaddr + pf_desc->n_pages, bd_data->n_pages_in_huge), user_pg->vaddr + user_pg->n_pages) - user_pg->vaddr;
+
+    struct pf_aligned_desc range_desc = *pf_desc;
+    range_desc.vaddr = user_pg->vaddr + first;
+    range_desc.n_pages = last - first;
+
+    bool misplaced = (stream == CARD_ACCESS) ? 
+        find_next_zero_bit(user_pg->card_pages, last, first) < last : 
+        find_next_bit(user_pg->card_pages, last, first) < last;
+
+    if (misplaced) {
+        tlb_unmap_range(device, user_pg, first, last - first, hpid);
+        migrate_split_pages(device, user_pg, first, last, stream);
+    }
+
+    if (stream == CARD_ACCESS) {
+        touch_card_lru(device, user_pg);
+    }
+    tlb_map_gup(device, &range_desc, user_pg, hpid);
+}
+
+// Migrates the misplaced pages of a split buffer, so that the whole buffer resides in dst again, and switches it back to whole-buffer residency
+static void merge_user_pages(struct vfpga_dev *device, struct user_pages *user_pg, int32_t dst, pid_t hpid) {
+    struct pf_aligned_desc pf_desc;
+    pf_desc.vaddr = user_pg->vaddr;
+    pf_desc.n_pages = user_pg->n_pages;
+    pf_desc.ctid = user_pg->ctid;
+    pf_desc.hugepages = user_pg->huge;
+
+    dbg_info("merging split buffer %llx, destination stream %d\n", user_pg->vaddr << PAGE_SHIFT, dst);
+    tlb_unmap_gup(device, user_pg, hpid);
+    migrate_split_pages(device, user_pg, 0, user_pg->n_pages, dst);
+
+    bitmap_free(user_pg->card_pages);
+    user_pg->card_pages = NULL;
+    user_pg->host = dst;
+    user_pg->n_pingpong = 0;
+    tlb_map_gup(device, &pf_desc, user_pg, hpid);
+}
+
+void tlb_evacuate_gup(struct vfpga_dev *device, int32_t ctid) {
+    struct user_pages *tmp_entry;
+
+    for_each_user_pg(&user_buff_map[device->id][ctid], tmp_entry, 0, U64_MAX) {
+        // Card-only buffers have no host copy to evacuate to; their contents don't survive the shell reconfiguration
+        if (tmp_entry->card_only) {
+            continue;
+        }
+
+        if (tmp_entry->card_pages) {
+            migrate_split_pages(device, tmp_entry, 0, tmp_entry->n_pages, HOST_ACCESS);
+            bitmap_free(tmp_entry->card_pages);
+            tmp_entry->card_pages = NULL;
+            tmp_entry->n_pingpong = 0;
+        } else if (tmp_entry->host == CARD_ACCESS) {
+            migrate_to_host(device, tmp_entry);
+        }
+
+        // Card memory isn't guaranteed to survive the shell reconfiguration, so the card copy must be re-offloaded
+        tmp_entry->host = HOST_ACCESS;
+        tmp_entry->card_valid = false;
+    }
+}
+
+void tlb_restore_gup(struct vfpga_dev *device, int32_t ctid, pid_t hpid) {
+    struct user_pages *tmp_entry;
+    struct pf_aligned_desc pf_desc;
+
+    for_each_user_pg(&user_buff_map[device->id][ctid], tmp_entry, 0, U64_MAX) {
+        if (atomic_read(&tmp_entry->stale)) {
+            continue;
+        }
+
+        pf_desc.vaddr = tmp_entry->vaddr;
+        pf_desc.n_pages = tmp_entry->n_pages;
+        pf_desc.ctid = ctid;
+        pf_desc.hugepages = tmp_entry->huge;
+        tlb_map_gup(device, &pf_desc, tmp_entry, hpid);
+    }
+}
+
+int offload_user_pages(struct vfpga_dev *device, uint64_t vaddr, uint32_t len, int32_t ctid, bool host_clean) {
     int ret_val = 1;
 
     BUG_ON(!device);
     struct bus_driver_data *bd_data = device->bd_data;
     BUG_ON(!bd_data);
+    VFPGA_STAT_ADD(device, ctid, offloads, 1);
 
     // Metadata
     pid_t hpid = device->pid_array[ctid];
     uint64_t vaddr_tmp = (vaddr & bd_data->stlb_meta->page_mask) >> bd_data->stlb_meta->page_shift;
     uint64_t vaddr_last = ((vaddr + len - 1) & bd_data->stlb_meta->page_mask) >> bd_data->stlb_meta->page_shift;
 
+    // Each mapped buffer overlapping the range is off-loaded once; parts of the range not backed by a buffer are skipped
     struct user_pages *tmp_entry;
-    while (vaddr_tmp <= vaddr_last) {
-        hash_for_each_possible(user_buff_map[device->id][ctid], tmp_entry, entry, vaddr_tmp) {
-            if(vaddr_tmp >= tmp_entry->vaddr && vaddr_tmp < tmp_entry->vaddr + tmp_entry->n_pages) {
-                struct pf_aligned_desc pf_desc;
-                pf_desc.vaddr = tmp_entry->vaddr;
-                pf_desc.n_pages = tmp_entry->n_pages;
-                pf_desc.ctid = ctid;
-                pf_desc.hugepages = tmp_entry->huge;
-
-                dbg_info("user triggered migration to card, vaddr %llx, ctid %d, last %llx\n", vaddr_tmp, ctid, vaddr_last);
-                tlb_unmap_gup(device, tmp_entry, hpid);
-                tmp_entry->host = CARD_ACCESS;
-                migrate_to_card(device, tmp_entry);
-                tlb_map_gup(device, &pf_desc, tmp_entry, hpid);
-                ret_val = 0;
-
-                vaddr_tmp += tmp_entry->n_pages;
-            }
+    while (vaddr_tmp <= vaddr_last && (tmp_entry = user_pg_tree_iter_first(&user_buff_map[device->id][ctid], vaddr_tmp, vaddr_last))) {
+        struct pf_aligned_desc pf_desc;
+        pf_desc.vaddr = tmp_entry->vaddr;
+        pf_desc.n_pages = tmp_entry->n_pages;
+        pf_desc.ctid = ctid;
+        pf_desc.hugepages = tmp_entry->huge;
+
+        // Card-only buffers always reside on the card
+        if (tmp_entry->card_only) {
+            ret_val = 0;
+            vaddr_tmp = tmp_entry->vaddr + tmp_entry->n_pages;
+            continue;
         }
+
+        // An explicit off-load moves the whole buffer, so split buffers are first merged back
+        if (tmp_entry->card_pages) {
+            merge_user_pages(device, tmp_entry, CARD_ACCESS, hpid);
+        }
+
+        if (tmp_entry->host == CARD_ACCESS && host_clean) {
+            // Already resident on the card and the host copy wasn't written since; nothing to do
+            dbg_info("user triggered migration to card, vaddr %llx already resident\n", vaddr_tmp);
+            touch_card_lru(device, tmp_entry);
+            ret_val = 0;
+        } else if (tmp_entry->host == HOST_ACCESS && host_clean && tmp_entry->card_valid && tmp_entry->cpages) {
+            // The card copy is still up-to-date, so only the TLB needs to be pointed back to it
+            dbg_info("user triggered migration to card, vaddr %llx, card copy valid, remapping\n", vaddr_tmp);
+            tlb_unmap_gup(device, tmp_entry, hpid);
+            tmp_entry->host = CARD_ACCESS;
+            touch_card_lru(device, tmp_entry);
+            tlb_map_gup(device, &pf_desc, tmp_entry, hpid);
+            ret_val = 0;
+        } else if (!get_card_memory(device, tmp_entry)) {
+            dbg_info("user triggered migration to card, vaddr %llx, ctid %d, last %llx\n", vaddr_tmp, ctid, vaddr_last);
+            tlb_unmap_gup(device, tmp_entry, hpid);
+            tmp_entry->host = CARD_ACCESS;
+            migrate_to_card(device, tmp_entry);
+            tlb_map_gup(device, &pf_desc, tmp_entry, hpid);
+            ret_val = 0;
+        } else {
+            pr_warn("card memory could not be obtained, vaddr %llx, ctid %d\n", vaddr_tmp, ctid);
+        }
+
+        vaddr_tmp = tmp_entry->vaddr + tmp_entry->n_pages;
     }
 
     return ret_val;
@@ -728,6 +1469,7 @@ int sync_user_pages(struct vfpga_dev *device, uint64_t vaddr, uint32_t len, int3
     BUG_ON(!device);
     struct bus_driver_data *bd_data = device->bd_data;
     BUG_ON(!bd_data);
+    VFPGA_STAT_ADD(device, ctid, syncs, 1);
 
     // Metadata
     pid_t hpid = device->pid_array[ctid];
@@ -736,30 +1478,395 @@ int sync_user_pages(struct vfpga_dev *device, uint64_t vaddr, uint32_t len, int3
 
     // Iterate, until all the pages have been synced
     struct user_pages *tmp_entry;
-    while (vaddr_tmp <= vaddr_last) {
-        hash_for_each_possible(user_buff_map[device->id][ctid], tmp_entry, entry, vaddr_tmp) {
-            if(vaddr_tmp >= tmp_entry->vaddr && vaddr_tmp < tmp_entry->vaddr + tmp_entry->n_pages) {
-                struct pf_aligned_desc pf_desc;
-                pf_desc.vaddr = tmp_entry->vaddr;
-                pf_desc.n_pages = tmp_entry->n_pages;
-                pf_desc.ctid = ctid;
-                pf_desc.hugepages = tmp_entry->huge;
-                
-                dbg_info("user triggered migration to host, vaddr %llx, ctid %d, last %llx\n", vaddr_tmp, ctid, vaddr_last);
-                tlb_unmap_gup(device, tmp_entry, hpid);
-                tmp_entry->host = HOST_ACCESS;
-                migrate_to_host(device, tmp_entry);
-                tlb_map_gup(device, &pf_desc, tmp_entry, hpid);
-                ret_val = 0;
-
-                vaddr_tmp += tmp_entry->n_pages;
-            }
+    while (vaddr_tmp <= vaddr_last && (tmp_entry = user_pg_tree_iter_first(&user_buff_map[device->id][ctid], vaddr_tmp, vaddr_last))) {
+        struct pf_aligned_desc pf_desc;
+        pf_desc.vaddr = tmp_entry->vaddr;
+        pf_desc.n_pages = tmp_entry->n_pages;
+        pf_desc.ctid = ctid;
+        pf_desc.hugepages = tmp_entry->huge;
+
+        // Card-only buffers have no host copy; they are copied to host buffers with copy_card_pages
+        if (tmp_entry->card_only) {
+            ret_val = 0;
+            vaddr_tmp = tmp_entry->vaddr + tmp_entry->n_pages;
+            continue;
+        }
+        
+        // An explicit sync moves the whole buffer, so split buffers are first merged back
+        if (tmp_entry->card_pages) {
+            merge_user_pages(device, tmp_entry, HOST_ACCESS, hpid);
+        }
+
+        // If the buffer already resides on the host, the card holds nothing newer than the host copy
+        if (tmp_entry->host == CARD_ACCESS) {
+            dbg_info("user triggered migration to host, vaddr %llx, ctid %d, last %llx\n", vaddr_tmp, ctid, vaddr_last);
+            tlb_unmap_gup(device, tmp_entry, hpid);
+            tmp_entry->host = HOST_ACCESS;
+            migrate_to_host(device, tmp_entry);
+            tlb_map_gup(device, &pf_desc, tmp_entry, hpid);
+            touch_card_lru(device, tmp_entry);
+        } else {
+            dbg_info("user triggered migration to host, vaddr %llx already resident\n", vaddr_tmp);
         }
+        ret_val = 0;
+
+        vaddr_tmp = tmp_entry->vaddr + tmp_entry->n_pages;
     }
 
     return ret_val;
 }
 
+// Completes a card-only buffer over its card pages (user_pg->cpages), adds it to the buffer map and maps it to the TLB
+// It is not added to the card memory LRU list, so that it is never evicted
+static void map_card_user_pg(struct vfpga_dev *device, struct pf_aligned_desc *pf_desc, struct user_pages *user_pg, pid_t hpid) {
+    user_pg->vaddr = pf_desc->vaddr;
+    user_pg->n_pages = pf_desc->n_pages;
+    user_pg->ctid = pf_desc->ctid;
+    user_pg->huge = pf_desc->hugepages;
+    user_pg->host = CARD_ACCESS;
+    user_pg->card_only = true;
+    user_pg->fault_ahead = FAULT_AHEAD_DEFAULT;
+    user_pg->device = device;
+    user_pg_tree_insert(user_pg, &user_buff_map[device->id][pf_desc->ctid]);
+
+    tlb_map_gup(device, pf_desc, user_pg, hpid);
+}
+
+// Must be called with card_shared_lock held
+static struct card_shared_buff *find_card_shared(struct vfpga_dev *device, uint64_t handle) {
+    struct card_shared_buff *tmp_entry;
+
+    hash_for_each_possible(device->bd_data->card_shared_map, tmp_entry, entry, handle) {
+        if (tmp_entry->handle == handle) {
+            return tmp_entry;
+        }
+    }
+
+    return NULL;
+}
+
+int tlb_get_card_pages(struct vfpga_dev *device, uint64_t vaddr, uint64_t len, int32_t ctid, pid_t hpid, int32_t mem_block, uint32_t mem_stripe) {
+    int ret_val;
+
+    BUG_ON(!device);
+    struct bus_driver_data *bd_data = device->bd_data;
+    BUG_ON(!bd_data);
+
+    if (len == 0 || vaddr + len < vaddr) {
+        return -EINVAL;
+    }
+
+    // Large TLB entries are used if the range is aligned to (and a multiple of) the large TLB pages
+    struct pf_aligned_desc pf_desc;
+    pf_desc.ctid = ctid;
+    pf_desc.hugepages = ((vaddr | len) & ~bd_data->ltlb_meta->page_mask) == 0;
+    align_pf_desc(bd_data, &pf_desc, vaddr, len);
+
+    if (user_pg_tree_iter_first(&user_buff_map[device->id][ctid], pf_desc.vaddr, pf_desc.vaddr + pf_desc.n_pages - 1)) {
+        pr_warn("card memory range %llx overlaps a mapped buffer, ctid %d\n", vaddr, ctid);
+        return -EEXIST;
+    }
+
+    int32_t target_blocks[N_MEM_BLOCKS];
+    int n_blocks = get_target_blocks(device, mem_block, mem_stripe, target_blocks);
+    if (n_blocks < 0) {
+        return n_blocks;
+    }
+
+    struct user_pages *user_pg = kzalloc(sizeof(struct user_pages), GFP_KERNEL);
+    if (!user_pg) {
+        return -ENOMEM;
+    }
+    INIT_LIST_HEAD(&user_pg->lru);
+
+    user_pg->cpages = vmalloc(pf_desc.n_pages * sizeof(uint64_t));
+    if (!user_pg->cpages) {
+        kfree(user_pg);
+        return -ENOMEM;
+    }
+
+    // The card memory of buffers residing on the host is evicted to make room, same as for regular buffers
+    do {
+        ret_val = alloc_card_memory(device, user_pg->cpages, pf_desc.n_pages, pf_desc.hugepages, target_blocks, n_blocks);
+    } while (ret_val == -ENOMEM && !evict_card_memory(device, ctid));
+
+    if (ret_val) {
+        dbg_info("could not get all card pages, %d\n", ret_val);
+        vfree(user_pg->cpages);
+        kfree(user_pg);
+        return ret_val;
+    }
+
+    user_pg->mem_block = mem_block;
+    user_pg->mem_stripe = mem_stripe;
+    map_card_user_pg(device, &pf_desc, user_pg, hpid);
+
+    dbg_info("card-only buffer mapped, vaddr %llx, n_pages %d, huge %d\n", vaddr, pf_desc.n_pages, pf_desc.hugepages);
+    return 0;
+}
+
+// Drops a reference to shared card memory, releasing the card memory with the last one
+static void put_card_shared(struct vfpga_dev *device, struct card_shared_buff *shared) {
+    mutex_lock(&device->bd_data->card_shared_lock);
+    if (--shared->ref_cnt == 0) {
+        hash_del(&shared->entry);
+        free_card_memory(device, shared->cpages, shared->n_pages, shared->huge);
+        vfree(shared->cpages);
+        dbg_info("shared card memory %llx released\n", shared->handle);
+        kfree(shared);
+    }
+    mutex_unlock(&device->bd_data->card_shared_lock);
+}
+
+int share_card_pages(struct vfpga_dev *device, uint64_t vaddr, int32_t ctid, uint64_t *handle) {
+    BUG_ON(!device);
+    struct bus_driver_data *bd_data = device->bd_data;
+    BUG_ON(!bd_data);
+
+    uint64_t vaddr_tmp = (vaddr & bd_data->stlb_meta->page_mask) >> bd_data->stlb_meta->page_shift;
+    struct user_pages *user_pg = user_pg_tree_iter_first(&user_buff_map[device->id][ctid], vaddr_tmp, vaddr_tmp);
+    if (!user_pg || !user_pg->card_only || user_pg->vaddr != vaddr_tmp) {
+        pr_warn("no card-only buffer starting at %llx, ctid %d\n", vaddr, ctid);
+        return -EINVAL;
+    }
+
+    // Already shared; the same handle is returned again
+    if (user_pg->shared) {
+        *handle = user_pg->shared->handle;
+        return 0;
+    }
+
+    struct card_shared_buff *shared = kzalloc(sizeof(struct card_shared_buff), GFP_KERNEL);
+    if (!shared) {
+        return -ENOMEM;
+    }
+
+    // The buffer hands its card pages over to the shared card memory, holding the first reference
+    shared->cpages = user_pg->cpages;
+    shared->n_pages = user_pg->n_pages;
+    shared->huge = user_pg->huge;
+    shared->ref_cnt = 1;
+
+    mutex_lock(&device->bd_data->card_shared_lock);
+    do {
+        shared->handle = get_random_u64();
+    } while (!shared->handle || find_card_shared(device, shared->handle));
+    hash_add(device->bd_data->card_shared_map, &shared->entry, shared->handle);
+    mutex_unlock(&device->bd_data->card_shared_lock);
+
+    user_pg->shared = shared;
+    *handle = shared->handle;
+
+    dbg_info("card-only buffer %llx shared, handle %llx\n", vaddr, shared->handle);
+    return 0;
+}
+
+int attach_card_pages(struct vfpga_dev *device, uint64_t handle, uint64_t vaddr, int32_t ctid, pid_t hpid, uint64_t *len) {
+    BUG_ON(!device);
+    struct bus_driver_data *bd_data = device->bd_data;
+    BUG_ON(!bd_data);
+
+    mutex_lock(&device->bd_data->card_shared_lock);
+    struct card_shared_buff *shared = find_card_shared(device, handle);
+    if (!shared) {
+        mutex_unlock(&device->bd_data->card_shared_lock);
+        pr_warn("no shared card memory with handle %llx, vFPGA %d\n", handle, device->id);
+        return -ENOENT;
+    }
+    *len = shared->n_pages << PAGE_SHIFT;
+
+    // Without an address, only the size is queried, so that the caller can reserve a range
+    if (!vaddr) {
+        mutex_unlock(&device->bd_data->card_shared_lock);
+        return 0;
+    }
+
+    struct pf_aligned_desc pf_desc;
+    pf_desc.ctid = ctid;
+    pf_desc.hugepages = shared->huge;
+    if (shared->huge && (vaddr & ~bd_data->ltlb_meta->page_mask)) {
+        mutex_unlock(&device->bd_data->card_shared_lock);
+        pr_warn("shared card memory must be attached at an address aligned to the large TLB pages, vaddr %llx\n", vaddr);
+        return -EINVAL;
+    }
+    align_pf_desc(bd_data, &pf_desc, vaddr, *len);
+
+    if (user_pg_tree_iter_first(&user_buff_map[device->id][ctid], pf_desc.vaddr, pf_desc.vaddr + pf_desc.n_pages - 1)) {
+        mutex_unlock(&device->bd_data->card_shared_lock);
+        pr_warn("card memory range %llx overlaps a mapped buffer, ctid %d\n", vaddr, ctid);
+        return -EEXIST;
+    }
+
+    struct user_pages *user_pg = kzalloc(sizeof(struct user_pages), GFP_KERNEL);
+    if (!user_pg) {
+        mutex_unlock(&device->bd_data->card_shared_lock);
+        return -ENOMEM;
+    }
+    INIT_LIST_HEAD(&user_pg->lru);
+
+    shared->ref_cnt++;
+    mutex_unlock(&device->bd_data->card_shared_lock);
+
+    user_pg->cpages = shared->cpages;
+    user_pg->shared = shared;
+    user_pg->mem_block = -1;
+    user_pg->mem_stripe = 1;
+    map_card_user_pg(device, &pf_desc, user_pg, hpid);
+
+    dbg_info("shared card memory %llx attached at %llx, ctid %d\n", handle, vaddr, ctid);
+    return 0;
+}
+
+// Must be called with card_shared_lock held
+static struct card_shared_buff *find_card_persistent(struct bus_driver_data *bd_data, const char *name) {
+    struct card_shared_buff *tmp_entry;
+    int bkt;
+
+    hash_for_each(bd_data->card_shared_map, bkt, tmp_entry, entry) {
+        if (tmp_entry->persistent && !strncmp(tmp_entry->name, name, CARD_MEM_NAME_LEN)) {
+            return tmp_entry;
+        }
+    }
+
+    return NULL;
+}
+
+int persist_card_pages(struct vfpga_dev *device, uint64_t vaddr, int32_t ctid, const char *name, uint64_t *handle) {
+    BUG_ON(!device);
+    struct bus_driver_data *bd_data = device->bd_data;
+    BUG_ON(!bd_data);
+
+    if (!name[0]) {
+        return -EINVAL;
+    }
+
+    // Persistent card memory is shared card memory with a name and one more reference
+    int ret_val = share_card_pages(device, vaddr, ctid, handle);
+    if (ret_val) {
+        return ret_val;
+    }
+
+    mutex_lock(&bd_data->card_shared_lock);
+    struct card_shared_buff *shared = find_card_shared(device, *handle);
+    struct card_shared_buff *named = find_card_persistent(bd_data, name);
+    if (named && named != shared) {
+        ret_val = -EEXIST;
+        pr_warn("persistent card memory %s already exists\n", name);
+    } else if (shared->persistent && strncmp(shared->name, name, CARD_MEM_NAME_LEN)) {
+        ret_val = -EINVAL;
+        pr_warn("card memory %llx is already persistent, as %s\n", vaddr, shared->name);
+    } else if (!shared->persistent) {
+        strscpy(shared->name, name, CARD_MEM_NAME_LEN);
+        shared->persistent = true;
+        shared->ref_cnt++;
+        dbg_info("card memory %llx persistent as %s, handle %llx\n", vaddr, name, *handle);
+    }
+    mutex_unlock(&bd_data->card_shared_lock);
+
+    return ret_val;
+}
+
+int lookup_card_pages(struct vfpga_dev *device, const char *name, uint64_t *handle) {
+    BUG_ON(!device);
+    struct bus_driver_data *bd_data = device->bd_data;
+    BUG_ON(!bd_data);
+
+    mutex_lock(&bd_data->card_shared_lock);
+    struct card_shared_buff *named = find_card_persistent(bd_data, name);
+    if (named) {
+        *handle = named->handle;
+    }
+    mutex_unlock(&bd_data->card_shared_lock);
+
+    return named ? 0 : -ENOENT;
+}
+
+int unpersist_card_pages(struct vfpga_dev *device, const char *name) {
+    BUG_ON(!device);
+    struct bus_driver_data *bd_data = device->bd_data;
+    BUG_ON(!bd_data);
+
+    mutex_lock(&bd_data->card_shared_lock);
+    struct card_shared_buff *named = find_card_persistent(bd_data, name);
+    if (named) {
+        named->persistent = false;
+    }
+    mutex_unlock(&bd_data->card_shared_lock);
+
+    if (!named) {
+        return -ENOENT;
+    }
+
+    // The card memory is released now, unless it is still mapped
+    dbg_info("card memory %s no longer persistent\n", name);
+    put_card_shared(device, named);
+    return 0;
+}
+
+void release_persistent_card_pages(struct bus_driver_data *bd_data) {
+    struct card_shared_buff *tmp_entry;
+    struct hlist_node *tmp;
+    int bkt;
+
+    // All the Coyote threads are released by now, so persistent card memory only holds its own reference
+    hash_for_each_safe(bd_data->card_shared_map, bkt, tmp, tmp_entry, entry) {
+        if (tmp_entry->persistent) {
+            tmp_entry->persistent = false;
+            put_card_shared(&bd_data->vfpga_dev[0], tmp_entry);
+        }
+    }
+}
+
+int copy_card_pages(struct vfpga_dev *device, uint64_t card_vaddr, uint64_t host_vaddr, uint64_t len, int32_t ctid, int32_t dst) {
+    BUG_ON(!device);
+    struct bus_driver_data *bd_data = device->bd_data;
+    BUG_ON(!bd_data);
+
+    // The copy is done page by page, so both buffers must be aligned the same way
+    if (len == 0 || ((card_vaddr | host_vaddr | len) & ~PAGE_MASK)) {
+        pr_warn("card memory copy must be page-aligned, card %llx, host %llx, len %llx\n", card_vaddr, host_vaddr, len);
+        return -EINVAL;
+    }
+
+    uint64_t card_first = card_vaddr >> PAGE_SHIFT;
+    uint64_t card_last = card_first + (len >> PAGE_SHIFT) - 1;
+    struct user_pages *card_pg = user_pg_tree_iter_first(&user_buff_map[device->id][ctid], card_first, card_last);
+    if (!card_pg || !card_pg->card_only || card_first < card_pg->vaddr || card_last >= card_pg->vaddr + card_pg->n_pages) {
+        pr_warn("no card-only buffer at %llx, len %llx, ctid %d\n", card_vaddr, len, ctid);
+        return -EINVAL;
+    }
+
+    // The host range may span several buffers (e.g., when mapped over several VMAs); each of them must be mapped and reside on the host
+    uint64_t host_first = host_vaddr >> PAGE_SHIFT;
+    uint64_t host_last = host_first + (len >> PAGE_SHIFT) - 1;
+    uint64_t pg = host_first;
+    while (pg <= host_last) {
+        struct user_pages *host_pg = user_pg_tree_iter_first(&user_buff_map[device->id][ctid], pg, pg);
+        if (!host_pg || host_pg->card_only || host_pg->card_pages || host_pg->host != HOST_ACCESS || atomic_read(&host_pg->stale)) {
+            pr_warn("host buffer at %llx is not mapped or doesn't reside on the host, ctid %d\n", pg << PAGE_SHIFT, ctid);
+            return -EINVAL;
+        }
+
+        // The host pages of read-only (write-only) buffers are DMA-mapped for reads (writes) only
+        if ((dst == HOST_ACCESS && (host_pg->access & MAP_USER_READ_ONLY)) || (dst == CARD_ACCESS && (host_pg->access & MAP_USER_WRITE_ONLY))) {
+            pr_warn("host buffer at %llx was mapped with access hint %x, which doesn't allow the copy, ctid %d\n", pg << PAGE_SHIFT, host_pg->access, ctid);
+            return -EPERM;
+        }
+
+        uint32_t n_pages = min_t(uint64_t, host_last + 1, host_pg->vaddr + host_pg->n_pages) - pg;
+        dma_copy_pages(
+            device, host_pg->hpages + (pg - host_pg->vaddr), card_pg->cpages + (card_first + (pg - host_first) - card_pg->vaddr), 
+            n_pages, card_pg->huge, dst
+        );
+
+        pg += n_pages;
+    }
+
+    VFPGA_STAT_ADD(device, ctid, migrations[dst], 1);
+    dbg_info("card memory copied, card %llx, host %llx, len %llx, destination %d\n", card_vaddr, host_vaddr, len, dst);
+    return 0;
+}
+
 #if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 2, 0)
 
 const struct dma_buf_attach_ops gpu_importer_ops = {
@@ -767,62 +1874,128 @@ const struct dma_buf_attach_ops gpu_importer_ops = {
     .move_notify = p2p_move_notify 
 };
 
+/// Returns the number of pages of a dmabuf's scatter-gather table and, if hpages is non-NULL, stores their bus addresses (at most n_pages)
+static uint64_t p2p_sgt_pages(struct sg_table *sgt, uint64_t *hpages, uint64_t n_pages) {
+    uint64_t cnt = 0;
+    for (struct scatterlist *tmp_sgl = sgt->sgl; tmp_sgl; tmp_sgl = sg_next(tmp_sgl)) {
+        for (int i = 0; i < sg_dma_len(tmp_sgl) >> PAGE_SHIFT; i++) {
+            if (hpages && cnt < n_pages) {
+                hpages[cnt] = sg_dma_address(tmp_sgl) + i * PAGE_SIZE;
+            }
+            cnt++;
+        }
+    }
+    return cnt;
+}
+
 void p2p_move_notify(struct dma_buf_attachment *attach) {
     struct dma_buf_move_notify_private *importer_priv = (struct dma_buf_move_notify_private *) attach->importer_priv;
     struct vfpga_dev *device = importer_priv->device;
     BUG_ON(!device);
+    struct user_pages *user_pg = importer_priv->user_pg;
+    if (!user_pg) {
+        // Still being attached; p2p_attach_dma_buf maps the current placement
+        return;
+    }
 
     // Metadata
-    uint64_t vaddr_tmp = importer_priv->vaddr;
-    int32_t ctid = importer_priv->ctid;
-    pid_t hpid = device->pid_array[ctid];
-    struct user_pages *tmp_entry;
+    pid_t hpid = device->pid_array[importer_priv->ctid];
+    dma_resv_assert_held(attach->dmabuf->resv);
+
+    // Map the new placement; the exporter's move may still be in flight, so the TLB is only updated on the next fault
+    struct sg_table *sgt = dma_buf_map_attachment(attach, DMA_BIDIRECTIONAL);
+    if (IS_ERR(sgt)) {
+        // The buffer can't be mapped at the moment; stop the vFPGA from using it and retry on the next fault
+        pr_warn("dmabuf could not be re-mapped after a move, vFPGA %d, ctid %d\n", device->id, importer_priv->ctid);
+        if (!user_pg->dmabuf_pending) {
+            tlb_unmap_gup(device, user_pg, hpid);
+        }
+        if (user_pg->sgt) {
+            dma_buf_unmap_attachment(attach, user_pg->sgt, DMA_BIDIRECTIONAL);
+        }
+        user_pg->sgt = NULL;
+        user_pg->dmabuf_pending = true;
+        return;
+    }
 
-    hash_for_each_possible(user_buff_map[device->id][ctid], tmp_entry, entry, vaddr_tmp) {
-        if(vaddr_tmp >= tmp_entry->vaddr && vaddr_tmp <= tmp_entry->vaddr + tmp_entry->n_pages) {
-            // Unmap any previous entry from TLB
-            tlb_unmap_gup(device, tmp_entry, hpid);
+    // Only invalidate the TLB entries if some page actually moved
+    bool moved = (p2p_sgt_pages(sgt, NULL, 0) != user_pg->n_pages);
+    uint64_t cnt = 0;
+    for (struct scatterlist *tmp_sgl = sgt->sgl; tmp_sgl && !moved; tmp_sgl = sg_next(tmp_sgl)) {
+        for (int i = 0; i < sg_dma_len(tmp_sgl) >> PAGE_SHIFT && !moved; i++, cnt++) {
+            moved = (user_pg->hpages[cnt] != sg_dma_address(tmp_sgl) + i * PAGE_SIZE);
+        }
+    }
 
-            // Unmap buffer from vFPGA bus address space
-            dma_buf_unmap_attachment(tmp_entry->dma_attach, tmp_entry->sgt, DMA_BIDIRECTIONAL);
+    if (moved && !user_pg->dmabuf_pending) {
+        tlb_unmap_gup(device, user_pg, hpid);
+    }
 
-            // Remap 
-            tmp_entry->sgt = dma_buf_map_attachment(attach, DMA_BIDIRECTIONAL);
+    if (user_pg->sgt) {
+        dma_buf_unmap_attachment(attach, user_pg->sgt, DMA_BIDIRECTIONAL);
+    }
+    user_pg->sgt = sgt;
 
-            // Find physical addresses
-            struct scatterlist *sgl = tmp_entry->sgt->sgl;
-            BUG_ON(!sgl);
+    if (moved) {
+        p2p_sgt_pages(sgt, user_pg->hpages, user_pg->n_pages);
+        user_pg->dmabuf_pending = true;
+        VFPGA_STAT_ADD(device, importer_priv->ctid, migrations[HOST_ACCESS], 1);
+    }
+    dbg_info("dmabuf moved, vFPGA %d, ctid %d, pages moved %d\n", device->id, importer_priv->ctid, moved);
+}
 
-            int cnt = 0;
-            struct scatterlist *tmp_sgl = sgl;
-            while (tmp_sgl) {
-                for (int i = 0; i < sg_dma_len(tmp_sgl) >> PAGE_SHIFT; i++) {
-                    tmp_entry->hpages[cnt + i] = sg_dma_address(tmp_sgl) + i * PAGE_SIZE;
-                }
-                cnt = sg_dma_len(tmp_sgl) >> PAGE_SHIFT;
-                tmp_sgl = sg_next(tmp_sgl);
-            }
+int p2p_revalidate_dma_buf(struct vfpga_dev *device, struct user_pages *user_pg, pid_t hpid) {
+    int ret_val = 0;
+    struct dma_resv *resv = user_pg->buf->resv;
 
-            // Map to TLB
-            struct pf_aligned_desc pf_desc;
-            pf_desc.vaddr = vaddr_tmp;
-            pf_desc.n_pages = tmp_entry->n_pages;
-            pf_desc.ctid = ctid;
-            pf_desc.hugepages = false;
+    dma_resv_lock(resv, NULL);
 
-            tlb_map_gup(device, &pf_desc, tmp_entry, hpid);
+    // The mapping failed in p2p_move_notify; retry now
+    if (!user_pg->sgt) {
+        struct sg_table *sgt = dma_buf_map_attachment(user_pg->dma_attach, DMA_BIDIRECTIONAL);
+        if (IS_ERR(sgt)) {
+            pr_err("dmabuf could not be mapped, vFPGA %d\n", device->id);
+            ret_val = PTR_ERR(sgt);
+            goto out;
+        }
+        if (p2p_sgt_pages(sgt, user_pg->hpages, user_pg->n_pages) != user_pg->n_pages) {
+            pr_err("dmabuf changed size, vFPGA %d\n", device->id);
+            dma_buf_unmap_attachment(user_pg->dma_attach, sgt, DMA_BIDIRECTIONAL);
+            ret_val = -EINVAL;
+            goto out;
+        }
+        user_pg->sgt = sgt;
+    }
 
-            tmp_entry->buf = attach->dmabuf;
-            tmp_entry->dma_attach = attach;
+    // Wait for the exporter's move to complete, before the vFPGA accesses the new placement
+    if (user_pg->dmabuf_pending) {
+        long timeout = dma_resv_wait_timeout(resv, DMA_RESV_USAGE_KERNEL, false, MAX_SCHEDULE_TIMEOUT);
+        if (timeout <= 0) {
+            pr_err("waiting for the dmabuf move failed, vFPGA %d\n", device->id);
+            ret_val = timeout ? timeout : -ETIMEDOUT;
+            goto out;
         }
+        user_pg->dmabuf_pending = false;
     }
+
+    // Map the whole buffer, so that a moved buffer faults once rather than once per page
+    struct pf_aligned_desc pf_desc;
+    pf_desc.vaddr = user_pg->vaddr;
+    pf_desc.n_pages = user_pg->n_pages;
+    pf_desc.ctid = user_pg->ctid;
+    pf_desc.hugepages = false;
+    tlb_map_gup(device, &pf_desc, user_pg, hpid);
+
+out:
+    dma_resv_unlock(resv);
+    return ret_val;
 }
 
 int p2p_attach_dma_buf(struct vfpga_dev *device, int buf_fd, uint64_t vaddr, int32_t ctid, int32_t mem_block) {
     int ret_val = 0;
     
     BUG_ON(!device);
-    struct device *dev = &device->bd_data->pci_dev->dev;
+    struct device *dev = device->bd_data->dma_dev;
     struct bus_driver_data *bd_data = device->bd_data;
     BUG_ON(!dev);
     BUG_ON(!bd_data);
@@ -834,6 +2007,7 @@ int p2p_attach_dma_buf(struct vfpga_dev *device, int buf_fd, uint64_t vaddr, int
     // Allocate memory to hold the user pages struct 
     struct user_pages *user_pg = kzalloc(sizeof(struct user_pages), GFP_KERNEL);
     BUG_ON(!user_pg);
+    INIT_LIST_HEAD(&user_pg->lru);
 
     // Retrieve dmabuf
     struct dma_buf *buf = dma_buf_get(buf_fd);
@@ -861,9 +2035,9 @@ int p2p_attach_dma_buf(struct vfpga_dev *device, int buf_fd, uint64_t vaddr, int
     }
 
     // Map DMA Buff into FPGA bus address space
+    // The reservation lock is held until the buffer is mapped to the TLB, so that moves in the meantime are seen by p2p_move_notify
     dma_resv_lock(buf->resv, NULL);
     user_pg->sgt = dma_buf_map_attachment(user_pg->dma_attach, DMA_BIDIRECTIONAL);
-    dma_resv_unlock(buf->resv);
 
     if(IS_ERR(user_pg->sgt)) {
         pr_err("sg_table is NULL\n");
@@ -872,76 +2046,32 @@ int p2p_attach_dma_buf(struct vfpga_dev *device, int buf_fd, uint64_t vaddr, int
 
     // Calculate number of pages
     struct scatterlist *sgl = user_pg->sgt->sgl;
-    struct scatterlist *tmp_sgl = sgl;
     if(sgl == NULL) {
         pr_err("scatterlist is NULL\n");
         goto err_sglist;
     }
 
     // Get the number of pages
-    uint32_t n_pages = 0;
-    while(tmp_sgl) {
-        n_pages += sg_dma_len(tmp_sgl) >> PAGE_SHIFT;
-        tmp_sgl = sg_next(tmp_sgl);
-    }
+    uint32_t n_pages = p2p_sgt_pages(user_pg->sgt, NULL, 0);
 
     // Allocate space to hold the physical addresses of the pages and calculate physical addresses
     user_pg->hpages = vmalloc(n_pages * sizeof(uint64_t));
     BUG_ON(!user_pg->hpages);
-
-    tmp_sgl = sgl;
-    int cnt = 0;
-    while (tmp_sgl) {
-        for (int i = 0; i < sg_dma_len(tmp_sgl) >> PAGE_SHIFT; i++) {
-            user_pg->hpages[cnt + i] = sg_dma_address(tmp_sgl) + i * PAGE_SIZE;
-        }
-        cnt += sg_dma_len(tmp_sgl) >> PAGE_SHIFT;
-        tmp_sgl = sg_next(tmp_sgl);
-    }
+    p2p_sgt_pages(user_pg->sgt, user_pg->hpages, n_pages);
 
     // Allocate card memory, if available
     if(bd_data->en_mem) {
         user_pg->cpages = vmalloc(n_pages * sizeof(uint64_t));
         BUG_ON(!user_pg->cpages);
 
-        int32_t target_block;
-        #ifdef PLATFORM_ULTRASCALE_PLUS
-        // On UltraScale+ devices, each memory channel can access the entire memory
-        // Therefore, mem_block is ignored, since the entire memory is treated as one
-        // partition with no fine-grained control over memory allocation
-        if (mem_block != -1) {
-            dbg_info("memory block specified, but UltraScale+ devices do not support block memory; ignoring...\n");
-        }
-        target_block = -1;
-        #endif
-
-        #ifdef PLATFORM_VERSAL
-        if (device->bd_data->en_block_mem) {
-            if (mem_block != -1) {
-                // User specified memory block; realign to current vFPGA (i.e. HBM_AXI_%d)
-                target_block = device->id * device->bd_data->n_card_axi + mem_block;
-
-                // Find correct HBM pseudo-channel by applying spacing transformation from cr_hbm.tcl
-                target_block = DIV_ROUND_CLOSEST(N_MEM_BLOCKS * (target_block + 1), device->bd_data->n_fpga_reg * device->bd_data->n_card_axi + 1) - 1;
-
-            } else {
-                // No memory block specified; throw error
-                dbg_info("no target block specified, but shell was synthesized with block HBM enabled\n");
-                ret_val = -EINVAL;
-                goto err_card_unmap;
-            }
-        } else {
-            // Unified implementation, allows access to entire memory as well as fine-grained allocations
-            if (mem_block != -1) {
-                target_block = device->id * device->bd_data->n_card_axi + mem_block;
-                target_block = DIV_ROUND_CLOSEST(N_MEM_BLOCKS * (target_block + 1), device->bd_data->n_fpga_reg * device->bd_data->n_card_axi + 1) - 1;
-            } else {
-                target_block = -1;
-            }
+        int32_t target_blocks[N_MEM_BLOCKS];
+        int n_blocks = get_target_blocks(device, mem_block, 1, target_blocks);
+        if (n_blocks < 0) {
+            ret_val = n_blocks;
+            goto err_card_unmap;
         }
-        #endif
 
-        ret_val = alloc_card_memory(device, user_pg->cpages, n_pages, false, target_block);
+        ret_val = alloc_card_memory(device, user_pg->cpages, n_pages, false, target_blocks, n_blocks);
         if (ret_val) {
             dbg_info("could not get all card pages, %d\n", ret_val);
             goto err_card_unmap;
@@ -952,9 +2082,10 @@ int p2p_attach_dma_buf(struct vfpga_dev *device, int buf_fd, uint64_t vaddr, int
     user_pg->vaddr = vaddr_tmp;
     user_pg->n_pages = n_pages;
     user_pg->huge = false;
+    user_pg->fault_ahead = FAULT_AHEAD_DEFAULT;
     user_pg->ctid = ctid;
     user_pg->host = HOST_ACCESS;
-    hash_add(user_buff_map[device->id][ctid], &user_pg->entry, user_pg->vaddr);
+    user_pg_tree_insert(user_pg, &user_buff_map[device->id][ctid]);
 
     // Map to TLB
     struct pf_aligned_desc pf_desc;
@@ -964,6 +2095,9 @@ int p2p_attach_dma_buf(struct vfpga_dev *device, int buf_fd, uint64_t vaddr, int
     pf_desc.hugepages = false;
     tlb_map_gup(device, &pf_desc, user_pg, hpid);
 
+    importer_priv->user_pg = user_pg;
+    dma_resv_unlock(buf->resv);
+
     dbg_info("dmabuf attached, n_pages %d\n", n_pages);
     return 0;
 
@@ -972,6 +2106,7 @@ err_card_unmap:
     vfree(user_pg->cpages);
 err_sglist:
 err_sg:
+    dma_resv_unlock(buf->resv);
     dma_buf_detach(buf, user_pg->dma_attach);
 err_attach:
     kfree(user_pg->dma_attach->importer_priv);
@@ -991,41 +2126,136 @@ int p2p_detach_dma_buf(struct vfpga_dev *device, uint64_t vaddr, int32_t ctid, i
     uint64_t vaddr_tmp = (vaddr & bd_data->stlb_meta->page_mask) >> bd_data->stlb_meta->page_shift;
     pid_t hpid = device->pid_array[ctid];
 
-    struct user_pages *tmp_entry;
-    hash_for_each_possible(user_buff_map[device->id][ctid], tmp_entry, entry, vaddr_tmp) {
-        if(vaddr_tmp >= tmp_entry->vaddr && vaddr_tmp <= tmp_entry->vaddr + tmp_entry->n_pages) {
-            // Unmap from TLB
+    struct user_pages *tmp_entry, *tmp_next;
+    for_each_user_pg_safe(&user_buff_map[device->id][ctid], tmp_entry, tmp_next, vaddr_tmp, vaddr_tmp) {
+        // Unmap from TLB (unless a move already invalidated it) and from the vFPGA bus address space;
+        // under the reservation lock, so that it doesn't race with p2p_move_notify
+        struct dma_buf_move_notify_private *importer_priv = tmp_entry->dma_attach->importer_priv;
+        dma_resv_lock(tmp_entry->buf->resv, NULL);
+        if (!tmp_entry->dmabuf_pending) {
             tlb_unmap_gup(device, tmp_entry, hpid);
-        
-            // Release card memory
-            if(bd_data->en_mem) {
-                free_card_memory(device, tmp_entry->cpages, tmp_entry->n_pages, tmp_entry->huge);
-                vfree(tmp_entry->cpages);
-            }
-            
-            // Unmap buffer from vFPGA bus address space
-            dma_resv_lock(tmp_entry->buf->resv, NULL);
+        }
+        if (tmp_entry->sgt) {
             dma_buf_unmap_attachment(tmp_entry->dma_attach, tmp_entry->sgt, DMA_BIDIRECTIONAL);
-            dma_resv_unlock(tmp_entry->buf->resv);
+        }
+        importer_priv->user_pg = NULL;
+        dma_resv_unlock(tmp_entry->buf->resv);
+    
+        // Release card memory
+        if(bd_data->en_mem) {
+            free_card_memory(device, tmp_entry->cpages, tmp_entry->n_pages, tmp_entry->huge);
+            vfree(tmp_entry->cpages);
+        }
 
-            // Detach vFPGA from DMABuf
-            kfree(tmp_entry->dma_attach->importer_priv);
-            dma_buf_detach(tmp_entry->buf, tmp_entry->dma_attach);
+        // Detach vFPGA from DMABuf
+        kfree(tmp_entry->dma_attach->importer_priv);
+        dma_buf_detach(tmp_entry->buf, tmp_entry->dma_attach);
 
-            // Decrease DMABuf refcount
-            dma_buf_put(tmp_entry->buf);
+        // Decrease DMABuf refcount
+        dma_buf_put(tmp_entry->buf);
 
-            // Release host pages
-            vfree(tmp_entry->hpages);
-            
-            // Remove from map
-            hash_del(&tmp_entry->entry);
-        }
+        // Release host pages
+        vfree(tmp_entry->hpages);
+        
+        // Remove from map
+        user_pg_tree_remove(tmp_entry, &user_buff_map[device->id][ctid]);
     }
     
     return 0;
 }
 
+static int p2p_export_attach(struct dma_buf *buf, struct dma_buf_attachment *attach) {
+    // The window is device memory (MMIO); it can only be accessed peer-to-peer, never through struct pages
+    if (!attach->peer2peer) {
+        dbg_info("importer does not support peer-to-peer DMA\n");
+        return -EOPNOTSUPP;
+    }
+
+    return 0;
+}
+
+static struct sg_table *p2p_export_map(struct dma_buf_attachment *attach, enum dma_data_direction dir) {
+    struct p2p_export_private *exporter_priv = (struct p2p_export_private *) attach->dmabuf->priv;
+
+    struct sg_table *sgt = kzalloc(sizeof(struct sg_table), GFP_KERNEL);
+    if (!sgt) {
+        return ERR_PTR(-ENOMEM);
+    }
+
+    if (sg_alloc_table(sgt, 1, GFP_KERNEL)) {
+        kfree(sgt);
+        return ERR_PTR(-ENOMEM);
+    }
+
+    // Bus address of the window, as seen by the importing device
+    dma_addr_t addr = dma_map_resource(attach->dev, exporter_priv->phys, exporter_priv->size, dir, DMA_ATTR_SKIP_CPU_SYNC);
+    if (dma_mapping_error(attach->dev, addr)) {
+        pr_err("P2P window of vFPGA %d could not be mapped for %s\n", exporter_priv->device->id, dev_name(attach->dev));
+        sg_free_table(sgt);
+        kfree(sgt);
+        return ERR_PTR(-EIO);
+    }
+
+    sg_dma_address(sgt->sgl) = addr;
+    sg_dma_len(sgt->sgl) = exporter_priv->size;
+
+    return sgt;
+}
+
+static void p2p_export_unmap(struct dma_buf_attachment *attach, struct sg_table *sgt, enum dma_data_direction dir) {
+    dma_unmap_resource(attach->dev, sg_dma_address(sgt->sgl), sg_dma_len(sgt->sgl), dir, DMA_ATTR_SKIP_CPU_SYNC);
+    sg_free_table(sgt);
+    kfree(sgt);
+}
+
+static void p2p_export_release(struct dma_buf *buf) {
+    kfree(buf->priv);
+}
+
+static const struct dma_buf_ops p2p_export_ops = {
+    .attach = p2p_export_attach,
+    .map_dma_buf = p2p_export_map,
+    .unmap_dma_buf = p2p_export_unmap,
+    .release = p2p_export_release
+};
+
+int p2p_export_dma_buf(struct vfpga_dev *device) {
+    BUG_ON(!device);
+
+    struct p2p_export_private *exporter_priv = kzalloc(sizeof(struct p2p_export_private), GFP_KERNEL);
+    if (!exporter_priv) {
+        pr_err("could not allocate memory for the P2P window\n");
+        return -ENOMEM;
+    }
+
+    exporter_priv->device = device;
+    exporter_priv->phys = device->vfpga_cnfg_phys_addr + VFPGA_CTRL_USER_OFFS;
+    exporter_priv->size = VFPGA_CTRL_USER_SIZE;
+
+    DEFINE_DMA_BUF_EXPORT_INFO(exp_info);
+    exp_info.ops = &p2p_export_ops;
+    exp_info.size = exporter_priv->size;
+    exp_info.flags = O_RDWR;
+    exp_info.priv = exporter_priv;
+
+    struct dma_buf *buf = dma_buf_export(&exp_info);
+    if (IS_ERR(buf)) {
+        pr_err("P2P window of vFPGA %d could not be exported\n", device->id);
+        kfree(exporter_priv);
+        return PTR_ERR(buf);
+    }
+
+    // From here on, exporter_priv is released with the DMA Buffer
+    int buf_fd = dma_buf_fd(buf, O_CLOEXEC);
+    if (buf_fd < 0) {
+        dma_buf_put(buf);
+        return buf_fd;
+    }
+
+    dbg_info("P2P window of vFPGA %d exported, fd %d, size %lld\n", device->id, buf_fd, exporter_priv->size);
+    return buf_fd;
+}
+
 #else
 void p2p_move_notify(struct dma_buf_attachment *attach){
     pr_warn("DMA Bufs for Coyote GPU integration is only available on Linux >= 6.2.0. If you're seeing this message and your driver compiled: this is likely a bug; please report it to the Coyote team\n");
@@ -1036,9 +2266,19 @@ int p2p_attach_dma_buf(struct vfpga_dev *device, int buf_fd, uint64_t vaddr, int
     return -1;
 }
 
+int p2p_revalidate_dma_buf(struct vfpga_dev *device, struct user_pages *user_pg, pid_t hpid) {
+    pr_warn("DMA Bufs for Coyote GPU integration is only available on Linux >= 6.2.0. If you're seeing this message and your driver compiled: this is likely a bug; please report it to the Coyote team\n");
+    return -1;
+}
+
 int p2p_detach_dma_buf(struct vfpga_dev *device, uint64_t vaddr, int32_t ctid, int dirtied) {
     pr_warn("DMA Bufs for Coyote GPU integration is only available on Linux >= 6.2.0. If you're seeing this message and your driver compiled: this is likely a bug; please report it to the Coyote team\n");
     return -1;
 }
 
+int p2p_export_dma_buf(struct vfpga_dev *device) {
+    pr_warn("DMA Bufs for Coyote P2P DMA are only available on Linux >= 6.2.0. If you're seeing this message and your driver compiled: this is likely a bug; please report it to the Coyote team\n");
+    return -1;
+}
+
 #endif
\ No newline at end of file
@@ -72,11 +72,39 @@ void invalidate_tlb_entry(struct vfpga_dev *device, uint64_t vaddr, uint32_t n_p
     device->cnfg_regs->isr_ctrl = last ? FPGA_CNFG_CTRL_IRQ_INVLDT_LAST : FPGA_CNFG_CTRL_IRQ_INVLDT;
 }
 
+void invalidate_tlb_range(struct vfpga_dev *device, uint64_t vaddr, uint64_t n_pages, int32_t hpid, bool last) {
+    BUG_ON(!device);
+    while (n_pages > 0) {
+        uint32_t n_pages_tmp = min_t(uint64_t, n_pages, MAX_N_INVLDT_PAGES);
+        invalidate_tlb_entry(device, vaddr, n_pages_tmp, hpid, last && (n_pages_tmp == n_pages));
+        vaddr += n_pages_tmp;
+        n_pages -= n_pages_tmp;
+    }
+}
+
 void change_tlb_lock(struct vfpga_dev *device) {
     BUG_ON(!device);
     device->cnfg_regs->isr_ctrl = FPGA_CNFG_CTRL_IRQ_LOCK;
 }
 
+void lock_tlb(struct vfpga_dev *device) {
+    BUG_ON(!device);
+    mutex_lock(&device->mmu_lock);
+    if (device->tlb_lock_cnt++ == 0) {
+        change_tlb_lock(device);
+    }
+    mutex_unlock(&device->mmu_lock);
+}
+
+void unlock_tlb(struct vfpga_dev *device) {
+    BUG_ON(!device);
+    mutex_lock(&device->mmu_lock);
+    if (--device->tlb_lock_cnt == 0) {
+        change_tlb_lock(device);
+    }
+    mutex_unlock(&device->mmu_lock);
+}
+
 void create_tlb_mapping(
     struct vfpga_dev *device, struct tlb_metadata *tlb_meta, uint64_t vaddr, 
     uint64_t physical_address, int32_t host, int32_t ctid, pid_t hpid
@@ -133,187 +161,313 @@ void create_tlb_unmapping(struct vfpga_dev *device, struct tlb_metadata *tlb_met
     }
 }
 
-void trigger_dma_offload(struct vfpga_dev *device, uint64_t *host_address, uint64_t *card_address, uint32_t n_pages, bool huge) {
-    // Parse device data and check non-null
-    BUG_ON(!device);
+/**
+ * Issues the descriptors of a migration (off-load or sync) to one of the shell's DMA request queues
+ * Physically contiguous runs of pages (on both the host and the card) are coalesced into a single descriptor of up to DMA_MAX_XFER_LEN bytes,
+ * and up to DMA_THRSH descriptors are kept in flight; the queue occupancy is only polled once the threshold is reached
+ * The descriptor for a run is written once the next run is known, so that the last one issued is always flagged with DMA_CTRL_START_LAST (raising the completion interrupt)
+ * Returns the number of descriptors issued; if zero, no completion interrupt will be raised
+ */
+static int trigger_dma_migration(
+    struct vfpga_dev *device, volatile uint64_t *ctrl, volatile uint64_t *host_offs, volatile uint64_t *card_offs, 
+    uint64_t *host_address, uint64_t *card_address, uint32_t n_pages
+) {
     struct bus_driver_data *bus_data = device->bd_data;
-    BUG_ON(!bus_data);
+    uint64_t pg_size = bus_data->stlb_meta->page_size;
 
-    int cmd_sent = 0;
+    int cmd_sent = 0, n_desc = 0;
+    bool pending = false;
+    uint64_t run_host = 0, run_card = 0, run_len = 0;
 
-    // Off-load all the pages
-    // To avoid bottlenecking the system, there is a limit on the number of pages that can be off-loaded simultaneously
-    for (int i = 0; i < n_pages; i++) {
-        if (host_address[i] == 0 || card_address[i] == 0) {
+    for (int i = 0; i <= n_pages; i++) {
+        bool done = (i == n_pages);
+        if (!done && (host_address[i] == 0 || card_address[i] == 0)) {
             continue;
         }
 
-        // Sleep until some of the off-loads have been marked as processed and the current number becomes smaller than the limit
-        while (cmd_sent >= DMA_THRSH) {
-            cmd_sent = device->cnfg_regs->offl_ctrl;
-            usleep_range(DMA_MIN_SLEEP_CMD, DMA_MAX_SLEEP_CMD);
+        // Extend the current run, if the page is contiguous to it on both sides
+        if (!done && pending && host_address[i] == run_host + run_len && card_address[i] == run_card + run_len && run_len + pg_size <= DMA_MAX_XFER_LEN) {
+            run_len += pg_size;
+            continue;
+        }
+
+        if (pending) {
+            // Sleep until some of the descriptors have been processed and the queue occupancy drops below the limit
+            while (cmd_sent >= DMA_THRSH) {
+                cmd_sent = *ctrl;
+                usleep_range(DMA_MIN_SLEEP_CMD, DMA_MAX_SLEEP_CMD);
+            }
+
+            // Write to registers; the control register triggers the actual transfer
+            *host_offs = run_host;
+            *card_offs = run_card;
+            *ctrl = (run_len << 32) | (done ? DMA_CTRL_START_LAST : DMA_CTRL_START_MIDDLE);
+            
+            cmd_sent++;
+            n_desc++;
         }
 
-        // Write to registers for off-loading; the last one triggers the actual off-load
-        device->cnfg_regs->offl_host_offs = host_address[i];
-        device->cnfg_regs->offl_card_offs = card_address[i];
-        device->cnfg_regs->offl_ctrl = (bus_data->stlb_meta->page_size << 32) | ((i == n_pages - 1) ? DMA_CTRL_START_LAST : DMA_CTRL_START_MIDDLE);
-        
-        cmd_sent++;
+        // Start a new run
+        if (!done) {
+            run_host = host_address[i];
+            run_card = card_address[i];
+            run_len = pg_size;
+            pending = true;
+        }
     }
+
+    dbg_info("issued %d DMA descriptors for %d pages, vFPGA %d\n", n_desc, n_pages, device->id);
+    return n_desc;
 }
 
-void trigger_dma_sync(struct vfpga_dev *device, uint64_t *host_address, uint64_t *card_address, uint32_t n_pages, bool huge) {
+int trigger_dma_offload(struct vfpga_dev *device, uint64_t *host_address, uint64_t *card_address, uint32_t n_pages, bool huge) {
     // Parse device data and check non-null
     BUG_ON(!device);
     struct bus_driver_data *bus_data = device->bd_data;
     BUG_ON(!bus_data);
 
-    int cmd_sent = 0;
-
-    // Sync all the pages
-    // To avoid bottlenecking the system, there is a limit on the number of pages that can be synced simultaneously
-    for (int i = 0; i < n_pages; i++) {
-        
-        // Sleep until some of the syncs have been marked as processed and the current number becomes smaller than the limit
-        while (cmd_sent >= DMA_THRSH) {
-            cmd_sent = device->cnfg_regs->sync_ctrl;
-            usleep_range(DMA_MIN_SLEEP_CMD, DMA_MAX_SLEEP_CMD);
-        }
-
-        // Write to registers for syncing; the last one triggers the actual sync
-        device->cnfg_regs->sync_host_offs = host_address[i]; 
-        device->cnfg_regs->sync_card_offs = card_address[i];
-        device->cnfg_regs->sync_ctrl = (bus_data->stlb_meta->page_size << 32) | ((i == n_pages - 1) ? DMA_CTRL_START_LAST : DMA_CTRL_START_MIDDLE);
-
-        cmd_sent++;
-    }
+    return trigger_dma_migration(
+        device, &device->cnfg_regs->offl_ctrl, &device->cnfg_regs->offl_host_offs, &device->cnfg_regs->offl_card_offs,
+        host_address, card_address, n_pages
+    );
 }
 
-int alloc_card_memory(struct vfpga_dev *device, uint64_t *card_physical_address, uint32_t n_pages, bool huge, int32_t mem_block) {
+int trigger_dma_sync(struct vfpga_dev *device, uint64_t *host_address, uint64_t *card_address, uint32_t n_pages, bool huge) {
     // Parse device data and check non-null
     BUG_ON(!device);
     struct bus_driver_data *bus_data = device->bd_data;
     BUG_ON(!bus_data);
 
-    // Check memory block is within range
-    if (mem_block != -1 && mem_block >= N_MEM_BLOCKS) {
-        pr_warn("requested invalid memory block\n");
-        return -EINVAL;
+    return trigger_dma_migration(
+        device, &device->cnfg_regs->sync_ctrl, &device->cnfg_regs->sync_host_offs, &device->cnfg_regs->sync_card_offs,
+        host_address, card_address, n_pages
+    );
+}
+
+/**
+ * Creates the bitmap allocator of a card memory partition, if not yet created; the allocators are set up lazily, on the first 
+ * allocation from the partition, rather than at probe time. Sleeps, so it must be called without card_lock held
+ */
+static int init_card_partition(struct bus_driver_data *bus_data, struct memory_partition *part) {
+    // Fast path; the allocator is published only once fully populated
+    if (smp_load_acquire(&part->pool)) {
+        return 0;
     }
 
-    // If mem_block = -1, find first block with free space to store the buffer
-    // Otherwise, use user-requested memory block
-    int32_t target_block = mem_block;
-    if (target_block == -1) {
-        for (int i = 0; i < N_MEM_BLOCKS; i++) {
-            if (huge && (bus_data->card_lblocks[i].free_chunks > n_pages)) {
-                target_block = i;
-                break;
+    int ret_val = 0;
+    mutex_lock(&bus_data->card_init_lock);
+    if (!part->pool) {
+        struct gen_pool *pool = gen_pool_create(bus_data->stlb_meta->page_shift, -1);
+        if (!pool || gen_pool_add(pool, part->base, part->size, -1)) {
+            pr_err("card memory partition @ %llx could not be initialized\n", part->base);
+            if (pool) {
+                gen_pool_destroy(pool);
             }
+            ret_val = -ENOMEM;
+        } else {
+            smp_store_release(&part->pool, pool);
+            dbg_info("card memory partition @ %llx initialized, size %lld\n", part->base, part->size);
+        }
+    }
+    mutex_unlock(&bus_data->card_init_lock);
 
-            if (!huge && (bus_data->card_sblocks[i].free_chunks > n_pages)) {
-                target_block = i;
-                break;
-            }
+    return ret_val;
+}
+
+/**
+ * Allocates n_pages regular pages from a card memory partition, in units of unit bytes (a regular or a huge page), aligned to unit
+ * The whole buffer is first allocated contiguously (so that it can be migrated with few, large DMA descriptors);
+ * if the partition is too fragmented, each unit is allocated on its own. Must be called with card_lock held
+ */
+static int alloc_card_partition(struct memory_partition *part, uint64_t *card_physical_address, uint32_t n_pages, uint64_t pg_size, uint64_t unit) {
+    uint64_t len = ALIGN(n_pages * pg_size, unit);
+    uint32_t pages_per_unit = unit / pg_size;
+    struct genpool_data_align align = { .align = unit };
+
+    if (gen_pool_avail(part->pool) < len) {
+        return -ENOMEM;
+    }
+
+    uint64_t addr = gen_pool_alloc_algo(part->pool, len, gen_pool_first_fit_align, &align);
+    if (addr) {
+        for (int i = 0; i < n_pages; i++) {
+            card_physical_address[i] = addr + i * pg_size;
         }
+        return 0;
+    }
 
-        // No block with sufficient space found, return
-        if (target_block == -1) {
-            pr_warn("insufficient memory on card to store buffer\n");
+    part->n_fallbacks++;
+    for (int i = 0; i < n_pages; i += pages_per_unit) {
+        addr = gen_pool_alloc_algo(part->pool, unit, gen_pool_first_fit_align, &align);
+        if (!addr) {
+            // Insufficient aligned space; release the units allocated so far
+            for (int j = 0; j < i; j += pages_per_unit) {
+                gen_pool_free(part->pool, card_physical_address[j], unit);
+            }
             return -ENOMEM;
         }
+
+        for (int j = i; j < i + pages_per_unit && j < n_pages; j++) {
+            card_physical_address[j] = addr + (j - i) * pg_size;
+        }
     }
-    
-    spin_lock(&bus_data->card_lock);
-    if (huge) {
-        // Check sufficient space is available 
-        if (bus_data->card_lblocks[target_block].free_chunks < n_pages) {
-            pr_warn("insufficient memory on card to store buffer\n");
+
+    return 0;
+}
+
+/**
+ * Allocates n_pages regular pages, interleaved across n_blocks card memory partitions one unit (a regular or a huge page) at a time
+ * If the next partition in turn is full, the unit is allocated from the following one. Must be called with card_lock held
+ */
+static int alloc_card_striped(
+    struct memory_partition *blocks, const int32_t *mem_blocks, uint32_t n_blocks, 
+    uint64_t *card_physical_address, uint32_t n_pages, uint64_t pg_size, uint64_t unit
+) {
+    uint32_t pages_per_unit = unit / pg_size;
+    struct genpool_data_align align = { .align = unit };
+
+    for (int i = 0; i < n_pages; i += pages_per_unit) {
+        uint64_t addr = 0;
+        for (int k = 0; k < n_blocks && !addr; k++) {
+            addr = gen_pool_alloc_algo(blocks[mem_blocks[(i / pages_per_unit + k) % n_blocks]].pool, unit, gen_pool_first_fit_align, &align);
+        }
+
+        if (!addr) {
+            // Insufficient space in all the partitions; release the units allocated so far, each to the partition it came from
+            for (int j = 0; j < i; j += pages_per_unit) {
+                for (int k = 0; k < n_blocks; k++) {
+                    struct gen_pool *pool = blocks[mem_blocks[k]].pool;
+                    #if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 5, 0)
+                    if (gen_pool_has_addr(pool, card_physical_address[j], unit)) {
+                    #else
+                    if (addr_in_gen_pool(pool, card_physical_address[j], unit)) {
+                    #endif
+                        gen_pool_free(pool, card_physical_address[j], unit);
+                        break;
+                    }
+                }
+            }
             return -ENOMEM;
         }
 
-        // Obtain the next available physical address, mark it as used and update the card_physical_address list with this page
-        for (int i = 0; i < n_pages; i++) {
-            card_physical_address[i] = (bus_data->card_lblocks[target_block].alloc->id << bus_data->stlb_meta->page_shift) + bus_data->card_huge_offs + (target_block * MEM_BLOCK_SIZE) + MEM_START;
+        for (int j = i; j < i + pages_per_unit && j < n_pages; j++) {
+            card_physical_address[j] = addr + (j - i) * pg_size;
+        }
+    }
+
+    return 0;
+}
+
+int alloc_card_memory(struct vfpga_dev *device, uint64_t *card_physical_address, uint32_t n_pages, bool huge, const int32_t *mem_blocks, uint32_t n_blocks) {
+    // Parse device data and check non-null
+    BUG_ON(!device);
+    struct bus_driver_data *bus_data = device->bd_data;
+    BUG_ON(!bus_data);
+
+    // Check memory blocks are within range; a stripe can't include automatic (-1) block selection
+    for (int i = 0; i < n_blocks; i++) {
+        if (mem_blocks[i] >= N_MEM_BLOCKS || mem_blocks[i] < -1 || (n_blocks > 1 && mem_blocks[i] == -1)) {
+            pr_warn("requested invalid memory block\n");
+            return -EINVAL;
+        }
+    }
+    int32_t mem_block = n_blocks ? mem_blocks[0] : -1;
+
+    // Huge pages are allocated from the huge pages region, aligned to the huge page size, so that they can be mapped by the lTLB
+    struct memory_partition *blocks = huge ? bus_data->card_lblocks : bus_data->card_sblocks;
+    uint64_t pg_size = bus_data->stlb_meta->page_size;
+    uint64_t unit = huge ? bus_data->ltlb_meta->page_size : pg_size;
+
+    // If mem_block = -1, use the first block which can hold the buffer; the blocks are initialized one by one, 
+    // so that the following ones are only set up once the preceding ones are full
+    // Otherwise, use user-requested memory block(s)
+    int ret_val = -ENOMEM;
+    int32_t target_block = mem_block;
+    if (target_block == -1) {
+        for (int i = 0; i < N_MEM_BLOCKS && ret_val == -ENOMEM; i++) {
+            if (init_card_partition(bus_data, &blocks[i])) {
+                break;
+            }
 
-            bus_data->card_lblocks[target_block].free_chunks--;
-            bus_data->card_lblocks[target_block].alloc->used = true;
-            bus_data->card_lblocks[target_block].alloc = bus_data->card_lblocks[target_block].alloc->next;
+            spin_lock(&bus_data->card_lock);
+            ret_val = alloc_card_partition(&blocks[i], card_physical_address, n_pages, pg_size, unit);
+            spin_unlock(&bus_data->card_lock);
+            target_block = i;
         }
     } else {
-        // Check sufficient space in card memory is available 
-        if (bus_data->card_sblocks[target_block].free_chunks < n_pages) {
-            pr_warn("insufficient memory on card to store buffer\n");
-            return -ENOMEM;
+        for (int i = 0; i < n_blocks; i++) {
+            if (init_card_partition(bus_data, &blocks[mem_blocks[i]])) {
+                return -ENOMEM;
+            }
         }
 
-        // Obtain the next available physical address, mark it as used and update the card_physical_address list with this page
-        for (int i = 0; i < n_pages; i++) {
-            card_physical_address[i] = (bus_data->card_sblocks[target_block].alloc->id << bus_data->stlb_meta->page_shift) + bus_data->card_reg_offs + (target_block * MEM_BLOCK_SIZE) + MEM_START;
-
-            bus_data->card_sblocks[target_block].free_chunks--;
-            bus_data->card_sblocks[target_block].alloc->used = true;
-            bus_data->card_sblocks[target_block].alloc = bus_data->card_sblocks[target_block].alloc->next;
+        spin_lock(&bus_data->card_lock);
+        if (n_blocks > 1) {
+            ret_val = alloc_card_striped(blocks, mem_blocks, n_blocks, card_physical_address, n_pages, pg_size, unit);
+        } else {
+            ret_val = alloc_card_partition(&blocks[target_block], card_physical_address, n_pages, pg_size, unit);
         }
+        spin_unlock(&bus_data->card_lock);
     }
 
-    dbg_info("user card buffer allocated @ %llx, n_pages %d, huge %d, device %d, block %d\n", card_physical_address[0], n_pages, huge, device->id, target_block);
-    spin_unlock(&bus_data->card_lock);
+    if (ret_val) {
+        pr_warn("insufficient memory on card to store buffer\n");
+        return ret_val;
+    }
+
+    dbg_info("user card buffer allocated @ %llx, n_pages %d, huge %d, device %d, block %d, striped over %d blocks\n", card_physical_address[0], n_pages, huge, device->id, target_block, n_blocks);
     return 0;
 }
- 
+
 void free_card_memory(struct vfpga_dev *device, uint64_t *card_physical_address, uint32_t n_pages, bool huge) {
     // Parse device data and check non-null
     BUG_ON(!device);
     struct bus_driver_data *bus_data = device->bd_data;
     BUG_ON(!bus_data);
 
+    struct memory_partition *blocks = huge ? bus_data->card_lblocks : bus_data->card_sblocks;
+    uint64_t pg_size = bus_data->stlb_meta->page_size;
+    uint64_t unit = huge ? bus_data->ltlb_meta->page_size : pg_size;
+    uint32_t pages_per_unit = unit / pg_size;
+
     spin_lock(&bus_data->card_lock);
 
-    // Iterate over the pages and mark them as free
-    if (huge) {
-        for (int i = n_pages - 1; i >= 0; i--) {
-            // Find the block to which the page was stored 
-            #ifdef PLATFORM_ULTRASCALE_PLUS
+    // Return the memory unit by unit, merging contiguous units into a single free (allocations never span memory blocks)
+    uint64_t run_addr = 0, run_len = 0;
+    for (int i = 0; ; i += pages_per_unit) {
+        bool done = (i >= n_pages);
+        if (!done && run_len && card_physical_address[i] == run_addr + run_len) {
+            run_len += unit;
+            continue;
+        }
+
+        if (run_len) {
+            // Find the block to which the pages were stored
+            #if defined(PLATFORM_ULTRASCALE_PLUS) || defined(PLATFORM_ENZIAN)
                 int32_t target_block = 0;
             #endif
-            
+
             #ifdef PLATFORM_VERSAL
-                int32_t target_block = (card_physical_address[i] - MEM_START) / MEM_BLOCK_SIZE;
+                int32_t target_block = (run_addr - MEM_START) / MEM_BLOCK_SIZE;
             #endif
 
-            // Mark free
-            int32_t tmp_id = (card_physical_address[i] - bus_data->card_huge_offs - (target_block * MEM_BLOCK_SIZE) - MEM_START) >> bus_data->stlb_meta->page_shift;
-            if (bus_data->card_lblocks[target_block].chunks[tmp_id].used) {
-                bus_data->card_lblocks[target_block].free_chunks++;
-                bus_data->card_lblocks[target_block].chunks[tmp_id].used = false;
-                bus_data->card_lblocks[target_block].alloc = &bus_data->card_lblocks[target_block].chunks[tmp_id];
-            } else {
-                pr_warn("likely bug: freeing card memory with used=false");
-            }
-        }
-    } else {
-        for (int i = n_pages - 1; i >= 0; i--) {
-            // Find the block to which the page was stored 
-            #ifdef PLATFORM_ULTRASCALE_PLUS
-                int32_t target_block = 0;
+            #if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 5, 0)
+            if (blocks[target_block].pool && gen_pool_has_addr(blocks[target_block].pool, run_addr, run_len)) {
+            #else
+            if (blocks[target_block].pool && addr_in_gen_pool(blocks[target_block].pool, run_addr, run_len)) {
             #endif
-            
-            #ifdef PLATFORM_VERSAL
-                int32_t target_block = (card_physical_address[i] - MEM_START) / MEM_BLOCK_SIZE;
-            #endif
-            
-            // Mark free
-            int32_t tmp_id = (card_physical_address[i] - bus_data->card_reg_offs - (target_block * MEM_BLOCK_SIZE) - MEM_START) >> bus_data->stlb_meta->page_shift;
-            if (bus_data->card_sblocks[target_block].chunks[tmp_id].used) {
-                bus_data->card_sblocks[target_block].free_chunks++;
-                bus_data->card_sblocks[target_block].chunks[tmp_id].used = false;
-                bus_data->card_sblocks[target_block].alloc = &bus_data->card_sblocks[target_block].chunks[tmp_id];
+                gen_pool_free(blocks[target_block].pool, run_addr, run_len);
             } else {
-                pr_warn("likely bug: freeing card memory with used=false");
+                pr_warn("likely bug: freeing card memory which does not belong to the partition");
             }
         }
+
+        if (done) {
+            break;
+        }
+
+        run_addr = card_physical_address[i];
+        run_len = unit;
     }
 
     spin_unlock(&bus_data->card_lock);
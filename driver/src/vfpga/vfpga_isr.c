@@ -21,6 +21,28 @@
 
 #include "vfpga_isr.h"
 
+#define CREATE_TRACE_POINTS
+#include "coyote_trace.h"
+
+/// Queues the work of an interrupt; on the NUMA node of the CPU the vFPGA's interrupt is pinned to, so that it runs close to the interrupt (and the Coyote thread)
+static bool vfpga_queue_work(struct vfpga_dev *device, struct workqueue_struct *wq, struct work_struct *work) {
+    int cpu = READ_ONCE(device->irq_cpu);
+    if (cpu >= 0) {
+        return queue_work_node(cpu_to_node(cpu), wq, work);
+    }
+    return queue_work(wq, work);
+}
+
+/// Records a handled page fault in the page fault histograms; each phase goes to bucket ceil(log2(us)), capped at the last bucket
+static void record_pfault_hist(struct bus_driver_data *bd_data, struct pfault_trace *trace) {
+    for (int i = 0; i < N_PFAULT_PHASES; i++) {
+        int bucket = min_t(int, fls64(trace->ns[i] / NSEC_PER_USEC), PFAULT_HIST_BUCKETS - 1);
+        atomic64_inc(&bd_data->pfault_hist.buckets[i][bucket]);
+        atomic64_add(trace->ns[i], &bd_data->pfault_hist.sum_ns[i]);
+    }
+    atomic64_inc(&bd_data->pfault_hist.count);
+}
+
 irqreturn_t vfpga_isr(int irq, void *d) {
     dbg_info("(irq=%d) ISR entry\n", irq);
     struct vfpga_dev *device = (struct vfpga_dev *) d;
@@ -66,7 +88,7 @@ irqreturn_t vfpga_isr(int irq, void *d) {
 
             INIT_WORK(&irq_pf->work_pfault, vfpga_pfault_handler);
 
-            if(!queue_work(device->wqueue_pfault, &irq_pf->work_pfault)) {
+            if(!vfpga_queue_work(device, device->wqueue_pfault, &irq_pf->work_pfault)) {
                 pr_err("could not enqueue a workqueue, page fault ISR\n");
                 kfree(irq_pf);
             }
@@ -75,16 +97,32 @@ irqreturn_t vfpga_isr(int irq, void *d) {
         case IRQ_NOTIFY:
             // vFPGA issued a user interrupt (notification); issue asynchronous work via vfpga_notify_handler to handle the user interrupt
             dbg_info("(irq=%d) notify, vFPGA %d\n", irq, device->id);
+            struct vfpga_irq_notify irq_val;
+            read_irq_notify(device, &irq_val);
+            VFPGA_STAT_ADD(device, irq_val.ctid, notifications, 1);
+
+            // Coyote threads in the coalesced or polling mode receive the value through their notification ring, without the workqueue
+            if (vfpga_push_notification(device, irq_val.ctid, irq_val.notification_value)) {
+                break;
+            }
+
+            // In the eventfd mode, the eventfd is signalled right away, unless the previous notification is still being processed
+            if (vfpga_signal_notification(device, irq_val.ctid, irq_val.notification_value)) {
+                break;
+            }
+
             struct vfpga_irq_notify *irq_not = kzalloc(sizeof(struct vfpga_irq_notify), GFP_ATOMIC);
             BUG_ON(!irq_not);
 
             irq_not->device = device;
-            read_irq_notify(device, irq_not);
+            irq_not->ctid = irq_val.ctid;
+            irq_not->notification_value = irq_val.notification_value;
 
             INIT_WORK(&irq_not->work_notify, vfpga_notify_handler);
 
-            if(!queue_work(device->wqueue_notify, &irq_not->work_notify)) {
+            if(!vfpga_queue_work(device, device->wqueue_notify, &irq_not->work_notify)) {
                 pr_err("could not enqueue a workqueue, notify ISR\n");
+                notify_queued[device->id][irq_val.ctid]--;
                 kfree(irq_not);
             }
             break;
@@ -107,16 +145,21 @@ void vfpga_notify_handler(struct work_struct *work) {
     struct vfpga_dev *device = irq_not->device;
     BUG_ON(!device);
     
-    // Mutex, preventing multiple simultaneous user interrupts (notifications)
-    // Typically, the hardware can issue interrupts faster than the software can process them; therefore a mutex (to prevent some interrupts being dropped)
-    // In case the notification cannot be parsed, the mutex is unlocked immediately; otherwise it's unlocked form the user-space via IOCTL_SET_NOTIFICATION_PROCESSED
-    mutex_lock(&user_notifier_lock[device->id][irq_not->ctid]);
+    // Only one notification per Coyote thread is processed at a time; typically, the hardware can issue interrupts faster than the 
+    // software can process them. The notification is released from the user-space via IOCTL_SET_NOTIFICATION_PROCESSED, 
+    // or right away in case it cannot be delivered. Note, the workqueue has a single worker, so the queued notifications keep their order
+    vfpga_notification_wait(device, irq_not->ctid);
     dbg_info("notify vFPGA %d, notification value %d, ctid %d\n", device->id, irq_not->notification_value, irq_not->ctid);
 
-    // Check an eventfd exists for this vFPGA and Coyote thread (must have been registered using vfpga_register_eventfd(...))
-    if (!user_notifier[device->id][irq_not->ctid]) {
+    // Check an eventfd exists for this vFPGA and Coyote thread (must have been registered using vfpga_register_eventfd(...));
+    // it's signalled under irq_lock, so that it can't be released in-between
+    unsigned long flags;
+    spin_lock_irqsave(&device->irq_lock, flags);
+    struct eventfd_ctx *ctx = user_notifier[device->id][irq_not->ctid];
+    if (!ctx) {
+        spin_unlock_irqrestore(&device->irq_lock, flags);
         pr_warn("dropped notify event because there is no recpient\n");
-        mutex_unlock(&user_notifier_lock[device->id][irq_not->ctid]);
+        vfpga_notification_done(device, irq_not->ctid);
         kfree(irq_not);
         return;
     }
@@ -131,23 +174,12 @@ void vfpga_notify_handler(struct work_struct *work) {
     // process.
     interrupt_value[device->id][irq_not->ctid] = irq_not->notification_value;
 
-    // Write the notification value to the eventfd; the value is polled on in the user-space (see bThread.cpp)
-    
-    #if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 8, 0)
-        // In recent kernel versions, the function signature of eventfd_signal changed.
-        // The function is now a void and automatically increments the eventfd
-        // counter by 1 instead of by a provided value.
-        eventfd_signal(user_notifier[device->id][irq_not->ctid]);
-        int ret_val = 1;
-    #else
-        // Note, the return value is equal to the value written.
-        // For polling in user-space to work, this value must be non-zero;
-        int ret_val = eventfd_signal(user_notifier[device->id][irq_not->ctid], 1);
-    #endif
-
-    if (ret_val != 1) {
+    // Signal the eventfd; the value is then read by the user-space (see cThread.cpp)
+    int signalled = vfpga_signal_eventfd(ctx);
+    spin_unlock_irqrestore(&device->irq_lock, flags);
+    if (signalled != 1) {
         pr_warn("could not signal eventfd\n");
-        mutex_unlock(&user_notifier_lock[device->id][irq_not->ctid]);
+        vfpga_notification_done(device, irq_not->ctid);
     }
 
     kfree(irq_not);
@@ -160,13 +192,19 @@ void vfpga_pfault_handler(struct work_struct *work) {
     struct vfpga_dev *device = irq_pf->device;
     BUG_ON(!device);
 
-    mutex_lock(&device->mmu_lock);
+    // Only faults (and user-space MMU requests) from the same Coyote thread are serialized; the TLB itself is locked in tlb_(un)map_gup
+    mutex_lock(&user_buff_lock[device->id][irq_pf->ctid]);
     pid_t hpid = device->pid_array[irq_pf->ctid];
     dbg_info("page fault vFPGA %d, virtual address %llx, length %d, stream %d, ctid %d, hpid %d\n", 
         device->id, irq_pf->vaddr, irq_pf->len, irq_pf->stream, irq_pf->ctid, hpid
     );
 
     int ret_val = -1;
+    ktime_t start_time = ktime_get(), lock_time;
+    struct pfault_trace trace = { 0 };
+    device->pf_trace[irq_pf->ctid] = &trace;
+    VFPGA_STAT_ADD(device, irq_pf->ctid, pfaults[irq_pf->stream ? HOST_ACCESS : CARD_ACCESS], 1);
+
     #ifdef HMM_KERNEL
         // User enabled unified memory (heteregenous memory management)
         if(en_hmm)
@@ -176,24 +214,43 @@ void vfpga_pfault_handler(struct work_struct *work) {
         // Alternative memory management, via the get_user_pages mechanism (default)
         // Target block doesn't matter for page faults - when a page fault occurs, the card memory would
         // have already been allocated (?)
-        ret_val = mmu_handler_gup(device, irq_pf->vaddr, irq_pf->len, irq_pf->ctid, irq_pf->stream, hpid, -1);
+        ret_val = mmu_handler_gup(device, irq_pf->vaddr, irq_pf->len, irq_pf->ctid, irq_pf->stream, hpid, -1, 1, 0);
     #endif
 
     if (ret_val && ret_val != BUFF_NEEDS_EXP_SYNC_RET_CODE) {
+        lock_time = ktime_get();
+        mutex_lock(&device->mmu_lock);
+        trace.ns[PFAULT_LOCK] += ktime_to_ns(ktime_sub(ktime_get(), lock_time));
         drop_irq_pfault(device, irq_pf->wr, irq_pf->ctid);
+        mutex_unlock(&device->mmu_lock);
+        VFPGA_STAT_ADD(device, irq_pf->ctid, pfault_errors, 1);
         pr_err("MMU handler error, vFPGA %d, error %d\n", device->id, ret_val);
         goto err_mmu;
     }
 
     // Restart MMU and unlock mutex
+    lock_time = ktime_get();
+    mutex_lock(&device->mmu_lock);
+    trace.ns[PFAULT_LOCK] += ktime_to_ns(ktime_sub(ktime_get(), lock_time));
     restart_mmu(device, irq_pf->wr, irq_pf->ctid);
     mutex_unlock(&device->mmu_lock);
+    trace.ns[PFAULT_TOTAL] = ktime_to_ns(ktime_sub(ktime_get(), start_time));
+    VFPGA_STAT_ADD(device, irq_pf->ctid, pfault_ns, trace.ns[PFAULT_TOTAL]);
     dbg_info("page fault vFPGA %d handled\n", device->id);
-    kfree(irq_pf);
-    return;
 
 err_mmu:
-    mutex_unlock(&device->mmu_lock);
+    // Trace the fault (also when it failed) and record it in the histograms
+    device->pf_trace[irq_pf->ctid] = NULL;
+    if (!trace.ns[PFAULT_TOTAL]) {
+        trace.ns[PFAULT_TOTAL] = ktime_to_ns(ktime_sub(ktime_get(), start_time));
+    }
+    trace_coyote_pfault(
+        device->id, irq_pf->ctid, hpid, irq_pf->vaddr, irq_pf->len, irq_pf->stream, irq_pf->wr,
+        trace.ns[PFAULT_LOCK], trace.ns[PFAULT_PIN], trace.ns[PFAULT_MAP], trace.ns[PFAULT_TOTAL], ret_val
+    );
+    record_pfault_hist(device->bd_data, &trace);
+
+    mutex_unlock(&user_buff_lock[device->id][irq_pf->ctid]);
     kfree(irq_pf);
     return;
 }
\ No newline at end of file
@@ -37,6 +37,12 @@ int vfpga_dev_open(struct inode *inode, struct file *file) {
     BUG_ON(!device);
     dbg_info("vFPGA device %d opened, hpid %d, ref_cnt %d\n", minor, current->pid, device->ref_cnt);
 
+    // The vFPGA is assigned to a guest, through an SR-IOV virtual function
+    if (device->vf_owned) {
+        pr_warn("vFPGA %d is exposed as a virtual function, cannot be opened from the host\n", device->id);
+        return -EBUSY;
+    }
+
     // Set file private data, so the attributes of the opened vfpga_dev can be accessed in other methods
     file->private_data = (void *) device;
     device->ref_cnt++;
@@ -66,7 +72,11 @@ int vfpga_dev_release(struct inode *inode, struct file *file) {
                         free_card_mem(device, l_entry->ctid);
                     else 
                 #endif                            
+                {
+                    mutex_lock(&user_buff_lock[device->id][l_entry->ctid]);
                     tlb_put_user_pages_ctid(device, l_entry->ctid, tmp_h_entry->hpid, 1);
+                    mutex_unlock(&user_buff_lock[device->id][l_entry->ctid]);
+                }
 
                 // Unregister Coyote thread (if registered)
                 device->ctid_chunks[l_entry->ctid].next = device->pid_alloc;
@@ -97,6 +107,250 @@ int vfpga_dev_release(struct inode *inode, struct file *file) {
     return 0;
 }
 
+// Processes a batch of (virtual address, length, operation) triples in order, until the first failure; see IOCTL_BATCH_USER_MEM
+// The TLB is locked for maps and unmaps only; consecutive unmaps are deferred, so that they share a single TLB invalidation
+// The caller must hold user_buff_lock
+static int vfpga_batch_user_ops(struct vfpga_dev *device, uint64_t *ops, uint64_t n_ops, int32_t ctid, int32_t mem_block, uint32_t mem_stripe) {
+    pid_t hpid = device->pid_array[ctid];
+
+    uint64_t *unmaps = kmalloc_array(n_ops, sizeof(uint64_t), GFP_KERNEL);
+    if (!unmaps) {
+        return -ENOMEM;
+    }
+
+    int ret_val = 0;
+    uint32_t n_unmaps = 0;
+    bool tlb_locked = false;
+    for (int i = 0; i < n_ops && (!ret_val || ret_val == BUFF_NEEDS_EXP_SYNC_RET_CODE); i++) {
+        uint64_t vaddr = ops[3 * i];
+        uint64_t len = ops[3 * i + 1];
+        uint64_t op = ops[3 * i + 2];
+
+        if (op != BATCH_OP_UNMAP && n_unmaps > 0) {
+            ret_val = tlb_put_user_pages_batch(device, unmaps, n_unmaps, ctid, hpid, 1);
+            n_unmaps = 0;
+            if (ret_val) {
+                break;
+            }
+        }
+
+        // Off-loads and syncs migrate the buffers with the TLB unlocked, same as IOCTL_OFFLOAD_REQ and IOCTL_SYNC_REQ
+        bool tlb_op = (op == BATCH_OP_MAP || op == BATCH_OP_UNMAP);
+        if (tlb_op != tlb_locked) {
+            if (tlb_op) {
+                lock_tlb(device);
+            } else {
+                unlock_tlb(device);
+            }
+            tlb_locked = tlb_op;
+        }
+
+        int ret_op = 0;
+        switch (op) {
+            case BATCH_OP_MAP:
+                #ifdef HMM_KERNEL
+                    if(en_hmm) 
+                        ret_op = mmu_handler_hmm(device, vaddr, len, ctid, true, hpid);
+                    else
+                #endif
+                    ret_op = mmu_map_range_gup(device, vaddr, len, ctid, true, hpid, mem_block, mem_stripe, 0);
+                break;
+
+            // With lazy unpinning, the buffer is kept pinned and mapped, same as for IOCTL_UNMAP_USER_MEM
+            case BATCH_OP_UNMAP:
+                if (!en_hmm && !en_lazy_unpin) {
+                    unmaps[n_unmaps++] = vaddr;
+                }
+                break;
+
+            case BATCH_OP_OFFLOAD:
+            case BATCH_OP_OFFLOAD_HOST_UNCHANGED:
+            case BATCH_OP_SYNC:
+                if (!device->bd_data->en_mem || len > U32_MAX) {
+                    pr_warn("cannot off-load or sync buffer %llx, length %llu, shell memory enabled %d\n", vaddr, len, device->bd_data->en_mem);
+                    ret_op = -EINVAL;
+                } else if (!en_hmm) {
+                    if (op == BATCH_OP_SYNC) {
+                        ret_op = sync_user_pages(device, vaddr, (uint32_t) len, ctid);
+                    } else {
+                        ret_op = offload_user_pages(device, vaddr, (uint32_t) len, ctid, op == BATCH_OP_OFFLOAD_HOST_UNCHANGED);
+                    }
+                }
+                break;
+
+            default:
+                pr_warn("unknown batch operation %llu\n", op);
+                ret_op = -EINVAL;
+                break;
+        }
+
+        if (ret_op) {
+            dbg_info("batch operation %d (%llu) on buffer %llx failed, ret_val: %d\n", i, op, vaddr, ret_op);
+            ret_val = ret_op;
+        }
+    }
+
+    if (n_unmaps > 0 && (!ret_val || ret_val == BUFF_NEEDS_EXP_SYNC_RET_CODE)) {
+        int ret_unmap = tlb_put_user_pages_batch(device, unmaps, n_unmaps, ctid, hpid, 1);
+        ret_val = ret_unmap ? ret_unmap : ret_val;
+    }
+    if (tlb_locked) {
+        unlock_tlb(device);
+    }
+
+    kfree(unmaps);
+    return ret_val;
+}
+
+// The following handle the buffer IOCTL calls; shared between vfpga_dev_ioctl and vfpga_dev_uring_cmd, args are as documented for the IOCTL call
+
+static int vfpga_map_user_mem(struct vfpga_dev *device, uint64_t *args) {
+    int ret_val;
+    int32_t ctid = (int32_t) args[2];
+    int32_t mem_block = (int32_t) args[3];
+    uint32_t mem_stripe = (uint32_t) args[4];
+    uint32_t flags = (uint32_t) args[5];
+    pid_t hpid = device->pid_array[ctid];
+
+    if ((flags & MAP_USER_ACCESS_MASK) == MAP_USER_ACCESS_MASK) {
+        pr_warn("buffer can't be mapped both read-only and write-only\n");
+        return -EINVAL;
+    }
+
+    mutex_lock(&user_buff_lock[device->id][ctid]);
+    lock_tlb(device);
+
+    #ifdef HMM_KERNEL
+        if(en_hmm) 
+            ret_val = mmu_handler_hmm(device, args[0], args[1], ctid, true, hpid);
+        else
+    #endif
+        ret_val = mmu_map_range_gup(device, args[0], args[1], ctid, true, hpid, mem_block, mem_stripe, flags);
+    
+    if (ret_val && ret_val != BUFF_NEEDS_EXP_SYNC_RET_CODE) {
+        dbg_info("buffer could not be mapped, ret_val: %d\n", ret_val);
+    }
+
+    unlock_tlb(device);
+    mutex_unlock(&user_buff_lock[device->id][ctid]);
+
+    dbg_info("user mapping vFPGA %d handled\n", device->id);
+    return ret_val;
+}
+
+static int vfpga_unmap_user_mem(struct vfpga_dev *device, uint64_t *args) {
+    if(!en_hmm) {
+        int32_t ctid = (int32_t) args[1];
+        pid_t hpid = device->pid_array[ctid];
+
+        // With lazy unpinning, the buffer is kept pinned and mapped; it is released by the MMU notifier or on cThread release
+        if (en_lazy_unpin) {
+            dbg_info("user unmapping vFPGA %d deferred, lazy unpinning enabled\n", device->id);
+            return 0;
+        }
+
+        mutex_lock(&user_buff_lock[device->id][ctid]);
+        lock_tlb(device);
+        tlb_put_user_pages(device, args[0], ctid, hpid, 1);
+        unlock_tlb(device);
+        mutex_unlock(&user_buff_lock[device->id][ctid]);
+
+        dbg_info("user unmapping vFPGA %d handled\n", device->id);
+    }
+
+    return 0;
+}
+
+static int vfpga_batch_user_mem(struct vfpga_dev *device, uint64_t *args) {
+    int ret_val;
+    uint64_t n_ops = args[1];
+    int32_t ctid = (int32_t) args[2];
+    int32_t mem_block = (int32_t) args[3];
+    uint32_t mem_stripe = (uint32_t) args[4];
+
+    if (n_ops == 0 || n_ops > MAX_N_BATCH_OPS) {
+        pr_warn("too many batch operations %llu, max %d\n", n_ops, MAX_N_BATCH_OPS);
+        return -EINVAL;
+    }
+
+    uint64_t *ops = kmalloc_array(3 * n_ops, sizeof(uint64_t), GFP_KERNEL);
+    if (!ops) {
+        return -ENOMEM;
+    }
+
+    ret_val = copy_from_user(ops, (unsigned long *) args[0], 3 * n_ops * sizeof(uint64_t));
+    if (ret_val != 0) {
+        pr_warn("batch operations could not be coppied, return %d\n", ret_val);
+        kfree(ops);
+        return -EFAULT;
+    }
+
+    mutex_lock(&user_buff_lock[device->id][ctid]);
+    ret_val = vfpga_batch_user_ops(device, ops, n_ops, ctid, mem_block, mem_stripe);
+    mutex_unlock(&user_buff_lock[device->id][ctid]);
+    kfree(ops);
+
+    dbg_info("user batch vFPGA %d handled, %llu operations\n", device->id, n_ops);
+    return ret_val;
+}
+
+static int vfpga_offload_user_mem(struct vfpga_dev *device, uint64_t *args) {
+    int ret_val = 0;
+
+    if (!device->bd_data->en_mem) {
+        pr_warn("cannot off-load buffer when shell is built without memory\n");
+        return -1;
+    }
+
+    if(!en_hmm) {
+        int32_t ctid = (int32_t) args[2];
+        bool host_clean = (bool) args[3];
+
+        mutex_lock(&user_buff_lock[device->id][ctid]);
+        ret_val = offload_user_pages(device, args[0], (uint32_t) args[1], ctid, host_clean);
+        mutex_unlock(&user_buff_lock[device->id][ctid]);
+
+        if(ret_val) {
+            dbg_info("buffer could not be offloaded, ret_val: %d\n", ret_val);
+        }
+    }
+
+    return ret_val;
+}
+
+static int vfpga_sync_user_mem(struct vfpga_dev *device, uint64_t *args) {
+    int ret_val = 0;
+
+    if (!device->bd_data->en_mem) {
+        pr_warn("cannot sync buffer when shell is built without memory\n");
+        return -1;
+    }
+
+    if(!en_hmm) {
+        int32_t ctid = (int32_t) args[2];
+
+        mutex_lock(&user_buff_lock[device->id][ctid]);
+        ret_val = sync_user_pages(device, args[0], (uint32_t) args[1], ctid);
+        mutex_unlock(&user_buff_lock[device->id][ctid]);
+
+        if (ret_val) {
+            dbg_info("buffer could not be synced, ret_val: %d\n", ret_val);
+        }
+    }
+
+    return ret_val;
+}
+
+static void vfpga_notification_processed(struct vfpga_dev *device, uint64_t *args) {
+    int32_t ctid = (int32_t) args[0];
+    if (ctid < 0 || ctid >= N_CTID_MAX) {
+        pr_warn("invalid ctid %d\n", ctid);
+        return;
+    }
+    dbg_info("marking notification with vfpga ID %d, ctid %d as processed\n", device->id, ctid);
+    vfpga_notification_done(device, ctid);
+}
+
 long vfpga_dev_ioctl(struct file *file, unsigned int command, unsigned long arg) {
     int ret_val = 0;
         
@@ -190,6 +444,21 @@ long vfpga_dev_ioctl(struct file *file, unsigned int command, unsigned long arg)
                     INIT_LIST_HEAD(&migrated_pages[device->id][ctid]);
                 #endif            
 
+                // Fresh statistics for the new Coyote thread; the generation is incremented last, so readers 
+                // which raced with the clearing see it change and read again
+                struct vfpga_ctid_stats *stats = &device->stats->ctids[ctid];
+                atomic64_set(&stats->hpid, hpid);
+                for (atomic64_t *cnt = &stats->pfaults[0]; cnt < (atomic64_t *) (stats + 1); cnt++) {
+                    atomic64_set(cnt, 0);
+                }
+                smp_wmb();
+                atomic64_inc(&stats->generation);
+
+                // Move the vFPGA's interrupt next to the new Coyote thread
+                if (irq_affinity == IRQ_AFFINITY_FOLLOW) {
+                    vfpga_set_irq_affinity(device, raw_smp_processor_id());
+                }
+
                 dbg_info("registration succeeded, ctid %d, hpid %d, spid %d\n", ctid, hpid, spid);
 
                 // Return ctid and unlock
@@ -230,7 +499,11 @@ long vfpga_dev_ioctl(struct file *file, unsigned int command, unsigned long arg)
                                         free_card_mem(device, ctid);
                                     else 
                                 #endif                            
+                                {
+                                    mutex_lock(&user_buff_lock[device->id][ctid]);
                                     tlb_put_user_pages_ctid(device, ctid, hpid, 1);
+                                    mutex_unlock(&user_buff_lock[device->id][ctid]);
+                                }
 
                                 // Unregister Coyote thread and delete entry from list
                                 device->ctid_chunks[l_entry->ctid].next = device->pid_alloc;
@@ -254,6 +527,9 @@ long vfpga_dev_ioctl(struct file *file, unsigned int command, unsigned long arg)
 
                 dbg_info("unregistration succeeded, ctid %d, hpid %d, spid %d\n", ctid, hpid, spid);
                 mutex_unlock(&device->pid_lock);
+
+                // The next thread holding this ctid starts with the default (eventfd) notifications
+                vfpga_set_notify_mode(device, ctid, NOTIFY_MODE_EVENTFD);
                 
             }
             break;
@@ -285,59 +561,320 @@ long vfpga_dev_ioctl(struct file *file, unsigned int command, unsigned long arg)
             break;
         
         // Explicit mapping of user pages; will map the user pages into the vFPGA's TLB and set-up corresponding card buffers, if enabled
-        // Args: Virtual address, length, Coyote thread ID (ctid), target memory block (applicable only to Versal devices)
+        // Args: Virtual address, length, Coyote thread ID (ctid), target memory block and memory stripe (applicable only to Versal devices), 
+        //       flags (see MAP_USER_RESIDENT, MAP_USER_READ_ONLY, MAP_USER_WRITE_ONLY); buffers already pinned in the range are re-used, with their own access hint
         case IOCTL_MAP_USER_MEM:
+            ret_val = copy_from_user(&tmp, (unsigned long *) arg, 6 * sizeof(unsigned long));
+            if (ret_val != 0) {
+                pr_warn("user data could not be coppied, return %d\n", ret_val);
+            } else {
+                ret_val = vfpga_map_user_mem(device, tmp);
+            }
+            break;
+
+        // Pin and map a batch of user buffers, installing all the TLB entries up-front
+        // Args: Pointer to an array of (virtual address, length) pairs, number of pairs, Coyote thread ID (ctid), stream (HOST or CARD)
+        case IOCTL_PREFAULT_USER_MEM:
             ret_val = copy_from_user(&tmp, (unsigned long *) arg, 4 * sizeof(unsigned long));
             if (ret_val != 0) {
                 pr_warn("user data could not be coppied, return %d\n", ret_val);
             } else {
-                int32_t ctid = (int32_t)tmp[2];
+                uint64_t n_ranges = tmp[1];
+                int32_t ctid = (int32_t) tmp[2];
+                int32_t stream = (int32_t) tmp[3];
                 pid_t hpid = device->pid_array[ctid];
 
-                mutex_lock(&device->mmu_lock);
-                change_tlb_lock(device);
+                if (n_ranges == 0 || n_ranges > MAX_N_PREFAULT_RANGES) {
+                    pr_warn("too many prefault ranges %llu, max %d\n", n_ranges, MAX_N_PREFAULT_RANGES);
+                    return -EINVAL;
+                }
 
-                #ifdef HMM_KERNEL
-                    if(en_hmm) 
-                        ret_val = mmu_handler_hmm(device, tmp[0], tmp[1], ctid, true, hpid);
-                    else
-                #endif
-                    int32_t mem_block = (int32_t) tmp[3];           
-                    ret_val = mmu_handler_gup(device, tmp[0], tmp[1], ctid, true, hpid, mem_block);
-                
-                if (ret_val && ret_val != BUFF_NEEDS_EXP_SYNC_RET_CODE) {
-                    dbg_info("buffer could not be mapped, ret_val: %d\n", ret_val);
+                uint64_t *ranges = kmalloc_array(2 * n_ranges, sizeof(uint64_t), GFP_KERNEL);
+                if (!ranges) {
+                    return -ENOMEM;
+                }
+
+                ret_val = copy_from_user(ranges, (unsigned long *) tmp[0], 2 * n_ranges * sizeof(uint64_t));
+                if (ret_val != 0) {
+                    pr_warn("prefault ranges could not be coppied, return %d\n", ret_val);
+                    kfree(ranges);
+                    return -EFAULT;
                 }
 
-                change_tlb_lock(device);
-                mutex_unlock(&device->mmu_lock);
+                // The locks are only taken once for the whole batch
+                mutex_lock(&user_buff_lock[device->id][ctid]);
+                lock_tlb(device);
 
-                dbg_info("user mapping vFPGA %d handled\n", device->id);
+                for (int i = 0; i < n_ranges; i++) {
+                    int ret_range;
+                    #ifdef HMM_KERNEL
+                        if(en_hmm) 
+                            ret_range = mmu_handler_hmm(device, ranges[2 * i], ranges[2 * i + 1], ctid, stream, hpid);
+                        else
+                    #endif
+                        ret_range = mmu_map_range_gup(device, ranges[2 * i], ranges[2 * i + 1], ctid, stream, hpid, -1, 1, 0);
+
+                    if (ret_range && ret_range != BUFF_NEEDS_EXP_SYNC_RET_CODE) {
+                        dbg_info("buffer %llx could not be prefaulted, ret_val: %d\n", ranges[2 * i], ret_range);
+                        ret_val = ret_range;
+                        break;
+                    }
+                    if (ret_range) {
+                        ret_val = ret_range;
+                    }
+                }
+
+                unlock_tlb(device);
+                mutex_unlock(&user_buff_lock[device->id][ctid]);
+                kfree(ranges);
+
+                dbg_info("user prefault vFPGA %d handled, %llu ranges\n", device->id, n_ranges);
             }
             break;
 
-        // Explictily unmap (release) user pages 
-        // Args: Virtual address, Coyote thread ID (ctid)
-        case IOCTL_UNMAP_USER_MEM:
-            ret_val = copy_from_user(&tmp, (unsigned long *) arg, 2 * sizeof(unsigned long));
+        // Map, unmap, off-load or sync a batch of user buffers, in order; user_buff_lock is only taken once for the whole batch
+        // Args: Pointer to an array of (virtual address, length, operation) triples (see BATCH_OP_*), number of triples, 
+        //       Coyote thread ID (ctid), target memory block and memory stripe of the mapped buffers (applicable only to Versal devices)
+        // Return: 0 (or BUFF_NEEDS_EXP_SYNC_RET_CODE, same as IOCTL_MAP_USER_MEM) on success; the error of the first failed entry otherwise
+        case IOCTL_BATCH_USER_MEM:
+            ret_val = copy_from_user(&tmp, (unsigned long *) arg, 5 * sizeof(unsigned long));
+            if (ret_val != 0) {
+                pr_warn("user data could not be coppied, return %d\n", ret_val);
+            } else {
+                ret_val = vfpga_batch_user_mem(device, tmp);
+            }
+            break;
+
+        // Look up an IP address in the neighbor table of the network stack; see coyote_neigh.c
+        // Args: IP address
+        // Return: 1 if the caller must issue the ARP lookup (NET_ARP_REG), 0 otherwise; time left until the lookup completes, in ns
+        case IOCTL_NEIGH_LOOKUP:
+            ret_val = copy_from_user(&tmp, (unsigned long *) arg, sizeof(unsigned long));
             if (ret_val != 0) {
                 pr_warn("user data could not be coppied, return %d\n", ret_val);
             } else {
+                if (!device_data->en_net) {
+                    ret_val = -EOPNOTSUPP;
+                    break;
+                }
+
+                ret_val = neigh_lookup(device_data, (uint32_t) tmp[0], &tmp[1]);
+                if (ret_val < 0) {
+                    break;
+                }
+                tmp[0] = ret_val;
+
+                ret_val = copy_to_user((unsigned long *) arg, &tmp, 2 * sizeof(unsigned long));
+                if (ret_val != 0) {
+                    pr_warn("could not copy data to user space, return %d\n", ret_val);
+                }
+            }
+            break;
+
+        // Set the fault-ahead window of a mapped buffer
+        // Args: Virtual address, Coyote thread ID (ctid), window (in bytes; FAULT_AHEAD_DEFAULT for the device-wide window)
+        case IOCTL_SET_FAULT_AHEAD:
+            ret_val = copy_from_user(&tmp, (unsigned long *) arg, 3 * sizeof(unsigned long));
+            if (ret_val != 0) {
+                pr_warn("user data could not be coppied, return %d\n", ret_val);
+            } else {
+                int64_t window = (int64_t) tmp[2];
+                if (window < 0 && window != FAULT_AHEAD_DEFAULT) {
+                    pr_warn("invalid fault-ahead window %lld\n", window);
+                    return -EINVAL;
+                }
+
                 if(!en_hmm) {
                     int32_t ctid = (int32_t) tmp[1];
-                    pid_t hpid = device->pid_array[ctid];
 
-                    mutex_lock(&device->mmu_lock);
-                    change_tlb_lock(device);
-                    tlb_put_user_pages(device, tmp[0], ctid, hpid, 1);
-                    change_tlb_lock(device);
-                    mutex_unlock(&device->mmu_lock);
+                    mutex_lock(&user_buff_lock[device->id][ctid]);
+                    ret_val = set_fault_ahead(device, tmp[0], ctid, window);
+                    mutex_unlock(&user_buff_lock[device->id][ctid]);
+                }
+            }
+            break;
 
-                    dbg_info("user unmapping vFPGA %d handled\n", device->id);
+        // Map a card-only buffer: card memory is allocated and mapped to the TLB, without host pages; see tlb_get_card_pages
+        // Args: Virtual address (of a reserved range), length, Coyote thread ID (ctid), target memory block and memory stripe (applicable only to Versal devices)
+        case IOCTL_MAP_CARD_MEM:
+            ret_val = copy_from_user(&tmp, (unsigned long *) arg, 5 * sizeof(unsigned long));
+            if (ret_val != 0) {
+                pr_warn("user data could not be coppied, return %d\n", ret_val);
+            } else {
+                if (!device_data->en_mem || en_hmm) {
+                    pr_warn("card-only buffers require a shell with memory and are not supported with HMM\n");
+                    return -EOPNOTSUPP;
+                }
+
+                int32_t ctid = (int32_t) tmp[2];
+                mutex_lock(&user_buff_lock[device->id][ctid]);
+                lock_tlb(device);
+                ret_val = tlb_get_card_pages(device, tmp[0], tmp[1], ctid, device->pid_array[ctid], (int32_t) tmp[3], (uint32_t) tmp[4]);
+                unlock_tlb(device);
+                mutex_unlock(&user_buff_lock[device->id][ctid]);
+            }
+            break;
+
+        // Unmap a card-only buffer and release its card memory; unlike IOCTL_UNMAP_USER_MEM, never deferred by lazy unpinning
+        // Args: Virtual address, Coyote thread ID (ctid)
+        case IOCTL_UNMAP_CARD_MEM:
+            ret_val = copy_from_user(&tmp, (unsigned long *) arg, 2 * sizeof(unsigned long));
+            if (ret_val != 0) {
+                pr_warn("user data could not be coppied, return %d\n", ret_val);
+            } else if (!en_hmm) {
+                int32_t ctid = (int32_t) tmp[1];
+                mutex_lock(&user_buff_lock[device->id][ctid]);
+                lock_tlb(device);
+                ret_val = tlb_put_user_pages(device, tmp[0], ctid, device->pid_array[ctid], 1);
+                unlock_tlb(device);
+                mutex_unlock(&user_buff_lock[device->id][ctid]);
+            }
+            break;
+
+        // Share the card memory of a card-only buffer with other Coyote threads and processes on the vFPGA; see share_card_pages
+        // Args: Virtual address of the card-only buffer, Coyote thread ID (ctid)
+        // Return: Handle of the shared card memory
+        case IOCTL_SHARE_CARD_MEM:
+            ret_val = copy_from_user(&tmp, (unsigned long *) arg, 2 * sizeof(unsigned long));
+            if (ret_val != 0) {
+                pr_warn("user data could not be coppied, return %d\n", ret_val);
+            } else if (!en_hmm) {
+                int32_t ctid = (int32_t) tmp[1];
+                mutex_lock(&user_buff_lock[device->id][ctid]);
+                ret_val = share_card_pages(device, tmp[0], ctid, &tmp[0]);
+                mutex_unlock(&user_buff_lock[device->id][ctid]);
+
+                if (!ret_val) {
+                    ret_val = copy_to_user((unsigned long *) arg, &tmp, sizeof(unsigned long));
+                    if (ret_val != 0) {
+                        pr_warn("could not copy data to user space, return %d\n", ret_val);
+                    }
+                }
+            }
+            break;
+
+        // Map shared card memory, by handle, as a card-only buffer; see attach_card_pages
+        // Args: Handle, virtual address (of a reserved range; 0 to only query the size), Coyote thread ID (ctid)
+        // Return: Size of the shared card memory, in bytes
+        case IOCTL_ATTACH_CARD_MEM:
+            ret_val = copy_from_user(&tmp, (unsigned long *) arg, 3 * sizeof(unsigned long));
+            if (ret_val != 0) {
+                pr_warn("user data could not be coppied, return %d\n", ret_val);
+            } else if (!en_hmm) {
+                int32_t ctid = (int32_t) tmp[2];
+                mutex_lock(&user_buff_lock[device->id][ctid]);
+                lock_tlb(device);
+                ret_val = attach_card_pages(device, tmp[0], tmp[1], ctid, device->pid_array[ctid], &tmp[0]);
+                unlock_tlb(device);
+                mutex_unlock(&user_buff_lock[device->id][ctid]);
+
+                if (!ret_val) {
+                    ret_val = copy_to_user((unsigned long *) arg, &tmp, sizeof(unsigned long));
+                    if (ret_val != 0) {
+                        pr_warn("could not copy data to user space, return %d\n", ret_val);
+                    }
+                }
+            }
+            break;
+
+        // Make the card memory of a card-only buffer persistent under a name, so that it outlives the process; see persist_card_pages
+        // Args: Virtual address of the card-only buffer, Coyote thread ID (ctid), pointer to the name (NUL-terminated, < CARD_MEM_NAME_LEN)
+        // Return: Handle of the shared card memory
+        case IOCTL_PERSIST_CARD_MEM:
+            ret_val = copy_from_user(&tmp, (unsigned long *) arg, 3 * sizeof(unsigned long));
+            if (ret_val != 0) {
+                pr_warn("user data could not be coppied, return %d\n", ret_val);
+            } else if (!en_hmm) {
+                char name[CARD_MEM_NAME_LEN];
+                long name_len = strncpy_from_user(name, (const char __user *) tmp[2], CARD_MEM_NAME_LEN);
+                if (name_len < 0 || name_len == CARD_MEM_NAME_LEN) {
+                    ret_val = -EINVAL;
+                    break;
+                }
+
+                int32_t ctid = (int32_t) tmp[1];
+                mutex_lock(&user_buff_lock[device->id][ctid]);
+                ret_val = persist_card_pages(device, tmp[0], ctid, name, &tmp[0]);
+                mutex_unlock(&user_buff_lock[device->id][ctid]);
+
+                if (!ret_val) {
+                    ret_val = copy_to_user((unsigned long *) arg, &tmp, sizeof(unsigned long));
+                    if (ret_val != 0) {
+                        pr_warn("could not copy data to user space, return %d\n", ret_val);
+                    }
                 }
             }
             break;
 
+        // Look up persistent card memory by name, e.g., after a process restart; see lookup_card_pages
+        // Args: Pointer to the name (NUL-terminated, < CARD_MEM_NAME_LEN)
+        // Return: Handle of the shared card memory, to be attached with IOCTL_ATTACH_CARD_MEM
+        case IOCTL_LOOKUP_CARD_MEM:
+            ret_val = copy_from_user(&tmp, (unsigned long *) arg, sizeof(unsigned long));
+            if (ret_val != 0) {
+                pr_warn("user data could not be coppied, return %d\n", ret_val);
+            } else if (!en_hmm) {
+                char name[CARD_MEM_NAME_LEN];
+                long name_len = strncpy_from_user(name, (const char __user *) tmp[0], CARD_MEM_NAME_LEN);
+                if (name_len < 0 || name_len == CARD_MEM_NAME_LEN) {
+                    ret_val = -EINVAL;
+                    break;
+                }
+
+                ret_val = lookup_card_pages(device, name, &tmp[0]);
+                if (!ret_val) {
+                    ret_val = copy_to_user((unsigned long *) arg, &tmp, sizeof(unsigned long));
+                    if (ret_val != 0) {
+                        pr_warn("could not copy data to user space, return %d\n", ret_val);
+                    }
+                }
+            }
+            break;
+
+        // Drop the persistence of named card memory; it is released now, or with its last mapping; see unpersist_card_pages
+        // Args: Pointer to the name (NUL-terminated, < CARD_MEM_NAME_LEN)
+        case IOCTL_UNPERSIST_CARD_MEM:
+            ret_val = copy_from_user(&tmp, (unsigned long *) arg, sizeof(unsigned long));
+            if (ret_val != 0) {
+                pr_warn("user data could not be coppied, return %d\n", ret_val);
+            } else if (!en_hmm) {
+                char name[CARD_MEM_NAME_LEN];
+                long name_len = strncpy_from_user(name, (const char __user *) tmp[0], CARD_MEM_NAME_LEN);
+                if (name_len < 0 || name_len == CARD_MEM_NAME_LEN) {
+                    ret_val = -EINVAL;
+                    break;
+                }
+
+                ret_val = unpersist_card_pages(device, name);
+            }
+            break;
+
+        // Copy between a card-only buffer and a mapped host buffer; see copy_card_pages
+        // Args: Virtual address in the card-only buffer, virtual address in the host buffer, length, Coyote thread ID (ctid), 
+        //       destination (CARD_ACCESS: host to card, HOST_ACCESS: card to host)
+        case IOCTL_COPY_CARD_MEM:
+            ret_val = copy_from_user(&tmp, (unsigned long *) arg, 5 * sizeof(unsigned long));
+            if (ret_val != 0) {
+                pr_warn("user data could not be coppied, return %d\n", ret_val);
+            } else if (!en_hmm) {
+                int32_t ctid = (int32_t) tmp[3];
+                mutex_lock(&user_buff_lock[device->id][ctid]);
+                ret_val = copy_card_pages(device, tmp[0], tmp[1], tmp[2], ctid, tmp[4] == CARD_ACCESS ? CARD_ACCESS : HOST_ACCESS);
+                mutex_unlock(&user_buff_lock[device->id][ctid]);
+            }
+            break;
+
+        // Explictily unmap (release) user pages 
+        // Args: Virtual address, Coyote thread ID (ctid)
+        case IOCTL_UNMAP_USER_MEM:
+            ret_val = copy_from_user(&tmp, (unsigned long *) arg, 2 * sizeof(unsigned long));
+            if (ret_val != 0) {
+                pr_warn("user data could not be coppied, return %d\n", ret_val);
+            } else {
+                ret_val = vfpga_unmap_user_mem(device, tmp);
+            }
+            break;
+
         // Map (attach) DMA Buffer
         // Args: DMA Buffer file descriptor (fd), virtual address, Coyote thread ID (ctid), target memory block (applicable only to Versal devices)
         case IOCTL_MAP_DMABUF:
@@ -350,8 +887,8 @@ long vfpga_dev_ioctl(struct file *file, unsigned int command, unsigned long arg)
 
                     dbg_info("mapping dmabuff for vFPGA %d, fd %d, virtual address %llx, ctid %d\n", device->id, (int) tmp[0], tmp[1], ctid);
 
-                    mutex_lock(&device->mmu_lock);
-                    change_tlb_lock(device);                    
+                    mutex_lock(&user_buff_lock[device->id][ctid]);
+                    lock_tlb(device);
                     
                     int32_t mem_block = (int32_t) tmp[3];
                     ret_val = p2p_attach_dma_buf(device, tmp[0], tmp[1], ctid, mem_block);
@@ -359,8 +896,8 @@ long vfpga_dev_ioctl(struct file *file, unsigned int command, unsigned long arg)
                         dbg_info("buffer could not be mapped, ret_val: %d\n", ret_val);
                     }
 
-                    change_tlb_lock(device);
-                    mutex_unlock(&device->mmu_lock);
+                    unlock_tlb(device);
+                    mutex_unlock(&user_buff_lock[device->id][ctid]);
                 }
             #else
                 pr_warn("Failed to map DMABUF! DMA Bufs for Coyote GPU integration is only available on Linux >= 6.2.0. If you're seeing this message and your driver compiled: this is likely a bug; please report it to the Coyote team\n");
@@ -381,11 +918,11 @@ long vfpga_dev_ioctl(struct file *file, unsigned int command, unsigned long arg)
 
                         dbg_info("unmapping dmabuff for vFPGA %d, ctid %d\n", device->id, ctid);
                         
-                        mutex_lock(&device->mmu_lock);
-                        change_tlb_lock(device);
+                        mutex_lock(&user_buff_lock[device->id][ctid]);
+                        lock_tlb(device);
                         p2p_detach_dma_buf(device, tmp[0], ctid, 1);
-                        change_tlb_lock(device);
-                        mutex_unlock(&device->mmu_lock);
+                        unlock_tlb(device);
+                        mutex_unlock(&user_buff_lock[device->id][ctid]);
                     }
                 }
             #else
@@ -393,46 +930,45 @@ long vfpga_dev_ioctl(struct file *file, unsigned int command, unsigned long arg)
                 ret_val = -1;
             #endif  
             break;
+
+        // Export the vFPGA's peer-to-peer window as a DMA Buffer, to be mapped by a vFPGA on another card with IOCTL_MAP_DMABUF
+        // Args: None
+        // Return: DMA Buffer file descriptor (fd)
+        case IOCTL_EXPORT_P2P_WINDOW:
+            #if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 2, 0)
+                ret_val = p2p_export_dma_buf(device);
+                if (ret_val >= 0) {
+                    tmp[0] = ret_val;
+                    ret_val = copy_to_user((unsigned long *) arg, &tmp, sizeof(unsigned long));
+                    if (ret_val != 0) {
+                        pr_warn("could not copy data to user space, return %d\n", ret_val);
+                    }
+                }
+            #else
+                pr_warn("Failed to export the P2P window! DMA Bufs for Coyote P2P DMA are only available on Linux >= 6.2.0. If you're seeing this message and your driver compiled: this is likely a bug; please report it to the Coyote team\n");
+                ret_val = -1;
+            #endif
+            break;
         
         // Off-load user buffer to card memory
-        // Args: virtual address, buffer length, Coyote thread ID (ctid)
+        // Args: virtual address, buffer length, Coyote thread ID (ctid), host copy unchanged since last sync/off-load
         case IOCTL_OFFLOAD_REQ:
-            if (!device_data->en_mem) {
-                pr_warn("cannot off-load buffer when shell is built without memory\n");
-                return -1;
-            }
-
-            ret_val = copy_from_user(&tmp, (unsigned long *) arg, 3 * sizeof(unsigned long));
+            ret_val = copy_from_user(&tmp, (unsigned long *) arg, 4 * sizeof(unsigned long));
             if (ret_val != 0) {
                 pr_warn("user data could not be coppied, return %d\n", ret_val);
             } else {
-                if(!en_hmm) {
-                    ret_val = offload_user_pages(device, tmp[0], (uint32_t) tmp[1], (int32_t) tmp[2]);
-                    if(ret_val) {
-                        dbg_info("buffer could not be offloaded, ret_val: %d\n", ret_val);
-                    }
-                }
+                ret_val = vfpga_offload_user_mem(device, tmp);
             }
             break;
 
         // Sync user buffer from card memory
         // Args: virtual address, buffer length, Coyote thread ID (ctid)
         case IOCTL_SYNC_REQ:
-            if (!device_data->en_mem) {
-                pr_warn("cannot sync buffer when shell is built without memory\n");
-                return -1;
-            }
-
             ret_val = copy_from_user(&tmp, (unsigned long *) arg, 3 * sizeof(unsigned long));
             if (ret_val != 0) {
                 pr_warn("user data could not be coppied, return %d\n", ret_val);
             } else {
-                if(!en_hmm) {
-                    ret_val = sync_user_pages(device, tmp[0], (uint32_t) tmp[1], (int32_t) tmp[2]);
-                    if (ret_val) {
-                        dbg_info("buffer could not be synced, ret_val: %d\n", ret_val);
-                    }
-                }
+                ret_val = vfpga_sync_user_mem(device, tmp);
             }
             break;
 
@@ -503,7 +1039,7 @@ long vfpga_dev_ioctl(struct file *file, unsigned int command, unsigned long arg)
         case IOCTL_READ_SHELL_CONFIG:
             tmp[0] = ((uint64_t)device_data->n_fpga_chan << 32) | ((uint64_t)device_data->n_fpga_reg << 48) |
                      ((uint64_t)device_data->en_avx) | ((uint64_t)device_data->en_wb << 1) |
-                     ((uint64_t)device_data->en_strm << 2) | ((uint64_t)device_data->en_mem << 3) | ((uint64_t)device_data->en_pr << 4) | 
+                     ((uint64_t)device_data->en_strm << 2) | ((uint64_t)device_data->en_mem << 3) | ((uint64_t)device_data->en_pr << 4) | ((uint64_t)device_data->coherent << 5) | 
                      ((uint64_t)device_data->en_rdma << 16) | ((uint64_t)device_data->en_tcp << 17);
 
             tmp[1] = ((uint64_t)device_data->shell_cnfg->ctrl_cnfg);
@@ -552,9 +1088,7 @@ long vfpga_dev_ioctl(struct file *file, unsigned int command, unsigned long arg)
             if (ret_val != 0) {
                 pr_warn("user data could not be copied, return %d\n", ret_val);
             } else {
-                int32_t ctid = (int32_t) tmp[0];
-                dbg_info("marking notification with vfpga ID %d, ctid %d as processed\n", device->id, ctid);
-                mutex_unlock(&user_notifier_lock[device->id][ctid]);
+                vfpga_notification_processed(device, tmp);
             }
             break;
         
@@ -578,6 +1112,18 @@ long vfpga_dev_ioctl(struct file *file, unsigned int command, unsigned long arg)
             }
             break;
 
+        // Sets how user interrupts (notifications) are delivered to a Coyote thread: eventfd (default), coalesced or polled, see vfpga_uisr.h
+        // In the latter two modes, the values are read from the thread's notification ring (MMAP_NOTIFY)
+        // Args: Coyote thread ID (ctid), mode (NOTIFY_MODE_*)
+        case IOCTL_SET_NOTIFY_MODE:
+            ret_val = copy_from_user(&tmp, (unsigned long *) arg, 2 * sizeof(unsigned long));
+            if (ret_val != 0) {
+                pr_warn("user data could not be copied, return %d\n", ret_val);
+            } else {
+                ret_val = vfpga_set_notify_mode(device, (int32_t) tmp[0], (int32_t) tmp[1]);
+            }
+            break;
+
         default:
             dbg_info("vFPGA device %d received unknown IOCTL call %d\n", device->id, command);
             ret_val = 1;
@@ -587,11 +1133,145 @@ long vfpga_dev_ioctl(struct file *file, unsigned int command, unsigned long arg)
     return ret_val;
 }
 
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(5, 19, 0)
+int vfpga_dev_uring_cmd(struct io_uring_cmd *ioucmd, unsigned int issue_flags) {
+    // Parse device; the command opcode is the IOCTL number and the arguments are passed inline in the SQE command area
+    struct vfpga_dev *device = (struct vfpga_dev *) ioucmd->file->private_data;
+    BUG_ON(!device);
+
+    #if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 5, 0)
+        const uint64_t *cmd = io_uring_sqe_cmd(ioucmd->sqe);
+    #else
+        const uint64_t *cmd = ioucmd->cmd;
+    #endif
+    
+    // 16 bytes of command area in a regular SQE, 80 bytes when the ring is set up with IORING_SETUP_SQE128
+    size_t cmd_size = (issue_flags & IO_URING_F_SQE128) ? 80 : 16;
+    uint32_t n_args;
+    switch (ioucmd->cmd_op) {
+        case IOCTL_MAP_USER_MEM: n_args = 6; break;
+        case IOCTL_BATCH_USER_MEM: n_args = 5; break;
+        case IOCTL_UNMAP_USER_MEM: n_args = 2; break;
+        case IOCTL_OFFLOAD_REQ: n_args = 4; break;
+        case IOCTL_SYNC_REQ: n_args = 3; break;
+        case IOCTL_SET_NOTIFICATION_PROCESSED: n_args = 1; break;
+        default:
+            dbg_info("vFPGA device %d received unsupported io_uring command %d\n", device->id, ioucmd->cmd_op);
+            return -EOPNOTSUPP;
+    }
+
+    if (n_args * sizeof(uint64_t) > cmd_size) {
+        pr_warn("io_uring command %d needs %u arguments, ring must be set up with IORING_SETUP_SQE128\n", ioucmd->cmd_op, n_args);
+        return -EINVAL;
+    }
+
+    // Marking a notification processed never blocks; everything else takes user_buff_lock and possibly waits 
+    // for the TLB invalidation or the DMA, so it is punted to the io_uring worker threads instead of stalling the submitter
+    if (ioucmd->cmd_op == IOCTL_SET_NOTIFICATION_PROCESSED) {
+        uint64_t args[1] = { READ_ONCE(cmd[0]) };
+        vfpga_notification_processed(device, args);
+        return 0;
+    }
+
+    if (issue_flags & IO_URING_F_NONBLOCK) {
+        return -EAGAIN;
+    }
+
+    // The SQE may be shared with user-space, hence the arguments are copied out once
+    uint64_t args[MAX_USER_ARGS];
+    for (uint32_t i = 0; i < n_args; i++) {
+        args[i] = READ_ONCE(cmd[i]);
+    }
+
+    switch (ioucmd->cmd_op) {
+        case IOCTL_MAP_USER_MEM:
+            return vfpga_map_user_mem(device, args);
+        case IOCTL_BATCH_USER_MEM:
+            return vfpga_batch_user_mem(device, args);
+        case IOCTL_UNMAP_USER_MEM:
+            return vfpga_unmap_user_mem(device, args);
+        case IOCTL_OFFLOAD_REQ:
+            return vfpga_offload_user_mem(device, args);
+        default:
+            return vfpga_sync_user_mem(device, args);
+    }
+}
+#endif
+
 int vfpga_dev_mmap(struct file *file, struct vm_area_struct *vma) {
     // Obtain vFPGA device from file private data (set during open) and check device is not NULL
     struct vfpga_dev *device = (struct vfpga_dev *) file->private_data;
     BUG_ON(!device);
 
+    // Memory map the notification rings; regular (cached) kernel memory, hence mapped before setting the protection to non-cached
+    if (vma->vm_pgoff == MMAP_NOTIFY) {
+        if (!device->notify_rings) {
+            pr_warn("notification rings not allocated; set the notification mode first\n");
+            return -EINVAL;
+        }
+
+        dbg_info("fpga dev. %d, memory mapping notification rings of size %lx\n", device->id, NOTIFY_RINGS_SIZE);
+        int ret_val = remap_vmalloc_range(vma, device->notify_rings, 0);
+        if (ret_val) {
+            pr_warn("remap_vmalloc_range failed for notification rings, ret_val: %d\n", ret_val);
+            return -EIO;
+        } else {
+            return 0;
+        }
+    }
+
+    // Memory map the statistics page; read-only, since the counters are only maintained by the driver
+    if (vma->vm_pgoff == MMAP_STATS) {
+        if (vma->vm_flags & VM_WRITE) {
+            pr_warn("statistics page can only be mapped read-only\n");
+            return -EPERM;
+        }
+        #if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 3, 0)
+            vm_flags_clear(vma, VM_MAYWRITE);
+        #else
+            vma->vm_flags &= ~VM_MAYWRITE;
+        #endif
+
+        dbg_info("fpga dev. %d, memory mapping statistics page of size %lx\n", device->id, VFPGA_STATS_SIZE);
+        int ret_val = remap_vmalloc_range(vma, device->stats, 0);
+        if (ret_val) {
+            pr_warn("remap_vmalloc_range failed for statistics page, ret_val: %d\n", ret_val);
+            return -EIO;
+        } else {
+            return 0;
+        }
+    }
+
+    // Memory map the first page of the vFPGA config AVX region (holding the command register), write-combined
+    // A 256-bit command is then written to the vFPGA in a single PCIe write; user-space must fence after every command, 
+    // since write-combining would otherwise merge successive commands to the same register. Registers are read through MMAP_CNFG_AVX
+    if (vma->vm_pgoff == MMAP_CNFG_AVX_WC) {
+        if (!device->bd_data->en_avx) {
+            pr_warn("write-combined command register requires a shell built with AVX support\n");
+            return -EINVAL;
+        }
+        if (vma->vm_end - vma->vm_start > PAGE_SIZE) {
+            pr_warn("write-combined command register mapping is limited to one page\n");
+            return -EINVAL;
+        }
+
+        vma->vm_page_prot = pgprot_writecombine(vma->vm_page_prot);
+        dbg_info("fpga dev. %d, memory mapping write-combined config AVX region at %llx\n", device->id, device->vfpga_cnfg_avx_phys_addr);
+        int ret_val = remap_pfn_range(
+            vma, 
+            vma->vm_start, 
+            device->vfpga_cnfg_avx_phys_addr >> PAGE_SHIFT,
+            PAGE_SIZE, 
+            vma->vm_page_prot
+        );
+        if (ret_val) {
+            pr_warn("remap_pfn_range failed for write-combined config AVX region, ret_val: %d\n", ret_val);
+            return -EIO;
+        } else {
+            return 0;
+        }
+    }
+
     vma->vm_page_prot = pgprot_noncached(vma->vm_page_prot);
 
     // Memory map user registers (CSR) in vFPGAs; the ones parsed from axi_ctrl interface in the vFPGA
@@ -666,7 +1346,7 @@ int vfpga_dev_mmap(struct file *file, struct vm_area_struct *vma) {
         
         // dma_mmap_coherent expects vma->pg_offs to be 0; hence MMAP_WB was changed to 0 and MMAP_CTRL to 3
         int ret_val = dma_mmap_coherent(
-            &device->bd_data->pci_dev->dev, vma, (void *) device->wb_addr_virt, device->wb_phys_addr, WB_SIZE 
+            device->bd_data->dma_dev, vma, (void *) device->wb_addr_virt, device->wb_phys_addr, WB_SIZE 
         );
 
         if (ret_val) {
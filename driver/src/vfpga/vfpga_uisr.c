@@ -24,34 +24,175 @@
 /// List of eventfd contexts for all possible vFPGAs and Coyote threads
 struct eventfd_ctx *user_notifier[MAX_N_REGIONS][N_CTID_MAX];
 
-/// Every time a user interrupt is issued, the mutex is locked, avoiding race conditions until the interrupt has been handled
-struct mutex user_notifier_lock[MAX_N_REGIONS][N_CTID_MAX];
+/// Every time a user interrupt is delivered through the eventfd, the flag is set, until the user space acknowledges it
+bool notify_busy[MAX_N_REGIONS][N_CTID_MAX];
+
+/// Notifications queued to the workqueue, because the previous one wasn't acknowledged yet
+uint32_t notify_queued[MAX_N_REGIONS][N_CTID_MAX];
 
 /// List of values that have been set for a interrupt for a vFPGA and Coyote thread.
 /// Values are set in vfpga_isr and read in vfpga_ops via ioctl.
 int32_t interrupt_value[MAX_N_REGIONS][N_CTID_MAX];
 
+/// Notification delivery mode of each vFPGA and Coyote thread; NOTIFY_MODE_EVENTFD (0) by default
+int32_t notify_mode[MAX_N_REGIONS][N_CTID_MAX];
+
+int vfpga_signal_eventfd(struct eventfd_ctx *ctx) {
+    #if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 8, 0)
+        // In recent kernel versions, the function signature of eventfd_signal changed.
+        // The function is now a void and automatically increments the eventfd counter by 1 instead of by a provided value.
+        eventfd_signal(ctx);
+        return 1;
+    #else
+        // Note, the return value is equal to the value written; for polling in user-space to work, this value must be non-zero
+        return eventfd_signal(ctx, 1);
+    #endif
+}
+
 int vfpga_register_eventfd(struct vfpga_dev *device, int ctid, int eventfd) {
     int ret_val = 0;
     BUG_ON(!device);
     
-    mutex_init(&user_notifier_lock[device->id][ctid]);
+    // A notification left unacknowledged by the previous owner of the ctid must not block the new one
+    vfpga_notification_done(device, ctid);
 
     // Retrieve the kernel context from the eventfd file descriptor
-    user_notifier[device->id][ctid] = eventfd_ctx_fdget(eventfd);
-    if (IS_ERR_OR_NULL(user_notifier[device->id][ctid])) {
-        ret_val = PTR_ERR(user_notifier[device->id][ctid]);
-        user_notifier[device->id][ctid] = NULL;
+    struct eventfd_ctx *ctx = eventfd_ctx_fdget(eventfd);
+    if (IS_ERR_OR_NULL(ctx)) {
+        ret_val = PTR_ERR(ctx);
+        ctx = NULL;
         pr_warn("Could not retrieve eventfd kernel context, ret_val %d", ret_val);
     }
 
+    // The ISR signals the eventfd, so the context is only swapped under irq_lock; the previous one is released afterwards
+    unsigned long flags;
+    spin_lock_irqsave(&device->irq_lock, flags);
+    struct eventfd_ctx *prev = user_notifier[device->id][ctid];
+    user_notifier[device->id][ctid] = ctx;
+    spin_unlock_irqrestore(&device->irq_lock, flags);
+
+    if (prev) {
+        eventfd_ctx_put(prev);
+    }
+
     return ret_val;
 }
 
 void vfpga_unregister_eventfd(struct vfpga_dev *device, int ctid) {
-    // Release the kernel context and set the list entry to a nullptr
-    if (user_notifier[device->id][ctid]) {
-        eventfd_ctx_put(user_notifier[device->id][ctid]);
-    }
+    // Clear the list entry under irq_lock, so that the ISR can't signal the context once it's released
+    unsigned long flags;
+    spin_lock_irqsave(&device->irq_lock, flags);
+    struct eventfd_ctx *ctx = user_notifier[device->id][ctid];
     user_notifier[device->id][ctid] = NULL;
+    spin_unlock_irqrestore(&device->irq_lock, flags);
+
+    if (ctx) {
+        eventfd_ctx_put(ctx);
+    }
+
+    // Release the queued notifications, which are then dropped, since there is no recipient
+    vfpga_notification_done(device, ctid);
+}
+
+bool vfpga_signal_notification(struct vfpga_dev *device, int ctid, int32_t value) {
+    // Signalled directly only if it can't overtake or overwrite another notification; otherwise, it's queued to the workqueue
+    if (notify_busy[device->id][ctid] || notify_queued[device->id][ctid] || !user_notifier[device->id][ctid]) {
+        notify_queued[device->id][ctid]++;
+        return false;
+    }
+
+    notify_busy[device->id][ctid] = true;
+    interrupt_value[device->id][ctid] = value;
+    if (vfpga_signal_eventfd(user_notifier[device->id][ctid]) != 1) {
+        pr_warn("could not signal eventfd\n");
+        notify_busy[device->id][ctid] = false;
+    }
+    return true;
+}
+
+// Takes the turn of a queued notification, if the previous one was acknowledged
+static bool vfpga_notification_take(struct vfpga_dev *device, int ctid) {
+    unsigned long flags;
+    bool taken = false;
+    spin_lock_irqsave(&device->irq_lock, flags);
+    if (!notify_busy[device->id][ctid]) {
+        notify_busy[device->id][ctid] = true;
+        notify_queued[device->id][ctid]--;
+        taken = true;
+    }
+    spin_unlock_irqrestore(&device->irq_lock, flags);
+    return taken;
+}
+
+void vfpga_notification_wait(struct vfpga_dev *device, int ctid) {
+    wait_event(device->waitqueue_notify, vfpga_notification_take(device, ctid));
+}
+
+void vfpga_notification_done(struct vfpga_dev *device, int ctid) {
+    unsigned long flags;
+    spin_lock_irqsave(&device->irq_lock, flags);
+    notify_busy[device->id][ctid] = false;
+    spin_unlock_irqrestore(&device->irq_lock, flags);
+    wake_up(&device->waitqueue_notify);
+}
+
+int vfpga_set_notify_mode(struct vfpga_dev *device, int ctid, int32_t mode) {
+    BUG_ON(!device);
+    if (ctid < 0 || ctid >= N_CTID_MAX || mode < NOTIFY_MODE_EVENTFD || mode > NOTIFY_MODE_POLL) {
+        pr_warn("invalid notification mode %d or ctid %d\n", mode, ctid);
+        return -EINVAL;
+    }
+
+    // The rings are only allocated once a Coyote thread requests them; they are shared by all the threads of the vFPGA
+    mutex_lock(&device->pid_lock);
+    if (mode != NOTIFY_MODE_EVENTFD && !device->notify_rings) {
+        device->notify_rings = vmalloc_user(NOTIFY_RINGS_SIZE);
+        if (!device->notify_rings) {
+            mutex_unlock(&device->pid_lock);
+            pr_warn("could not allocate notification rings\n");
+            return -ENOMEM;
+        }
+    }
+
+    // Reset the ring under the IRQ lock, so that the ISR doesn't push to it concurrently
+    unsigned long flags;
+    spin_lock_irqsave(&device->irq_lock, flags);
+    if (device->notify_rings) {
+        memset(&device->notify_rings[ctid], 0, sizeof(struct notify_ring));
+    }
+    notify_mode[device->id][ctid] = mode;
+    spin_unlock_irqrestore(&device->irq_lock, flags);
+    mutex_unlock(&device->pid_lock);
+
+    dbg_info("notification mode of vFPGA %d, ctid %d set to %d\n", device->id, ctid, mode);
+    return 0;
+}
+
+bool vfpga_push_notification(struct vfpga_dev *device, int ctid, int32_t value) {
+    int32_t mode = notify_mode[device->id][ctid];
+    if (mode == NOTIFY_MODE_EVENTFD) {
+        return false;
+    }
+
+    // Push the value; the hardware can't be back-pressured, so values are dropped (and counted) if the user space falls behind
+    struct notify_ring *ring = &device->notify_rings[ctid];
+    uint32_t head = ring->head;
+    if (head - READ_ONCE(ring->tail) >= NOTIFY_RING_ENTRIES) {
+        ring->dropped++;
+        return true;
+    }
+    ring->values[head & (NOTIFY_RING_ENTRIES - 1)] = value;
+    smp_wmb();
+    WRITE_ONCE(ring->head, head + 1);
+
+    // Coalesced mode: wake up the user space only if it's waiting; values pushed while it's draining the ring need no further signal
+    // eventfd_signal is safe in interrupt context, so neither the workqueue nor the notification lock are needed
+    if (mode == NOTIFY_MODE_COALESCED) {
+        smp_mb();
+        if (xchg(&ring->armed, 0) && user_notifier[device->id][ctid]) {
+            vfpga_signal_eventfd(user_notifier[device->id][ctid]);
+        }
+    }
+
+    return true;
 }
@@ -0,0 +1,93 @@
+/**
+ * This file is part of the Coyote <https://github.com/fpgasystems/Coyote>
+ *
+ * MIT Licence
+ * Copyright (c) 2025, Systems Group, ETH Zurich
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _COYOTE_CEMU_HPP_
+#define _COYOTE_CEMU_HPP_
+
+#include <cstdint>
+#include <functional>
+
+namespace coyote {
+
+/**
+ * @brief Emulated vFPGA, as seen by a kernel model of the emulation target (emu/sw)
+ *
+ * The emulation target replaces the cThread with an in-process model of the vFPGA: LOCAL_READs pass the data of 
+ * the host buffer to the kernel model of the vFPGA, which produces output data with send(); LOCAL_WRITEs consume 
+ * this output, in order, per destination stream. The control registers, completion (writeback) counters and 
+ * notifications are plain memory, so operations complete at memory speed.
+ *
+ * Kernel models are called with the data path of the vFPGA locked; the methods below must only be called from 
+ * within a kernel model or a CSR hook, never concurrently from other threads.
+ */
+class cEmuVfpga {
+public:
+    virtual ~cEmuVfpga() = default;
+
+    /// Virtual FPGA ID of the emulated vFPGA
+    virtual int32_t getVfid() const = 0;
+
+    /// Sends len bytes on the output stream axis_host_send[dest]; filled into the pending LOCAL_WRITEs to dest, in order
+    virtual void send(uint32_t dest, const void *data, uint64_t len) = 0;
+
+    /// Reads a control register (axi_ctrl), as last set by the software or the kernel model
+    virtual uint64_t getCSR(uint32_t offs) const = 0;
+
+    /// Sets a control register (axi_ctrl), e.g., a status register read by the software; does not call the CSR hook
+    virtual void setCSR(uint64_t val, uint32_t offs) = 0;
+
+    /// Raises a user interrupt (notification) with the given value, as on the notify interface of the vFPGA
+    virtual void notify(uint32_t value) = 0;
+};
+
+/**
+ * @brief Kernel model of an emulated vFPGA
+ *
+ * Called for the data of every LOCAL_READ (and the read side of every LOCAL_TRANSFER) to axis_host_recv[dest], 
+ * in the thread issuing the operation; last is the last flag of the operation. The default model is a loopback, 
+ * sending all data back on the same destination stream.
+ */
+using cEmuKernel = std::function<void(cEmuVfpga &vfpga, uint32_t dest, const char *data, uint64_t len, bool last)>;
+
+/// Called after every cThread::setCSR() on an emulated vFPGA, with the register offset and the new value
+using cEmuCsrHook = std::function<void(cEmuVfpga &vfpga, uint32_t offs, uint64_t val)>;
+
+/**
+ * @brief Installs the kernel model (and, optionally, a CSR hook) of a vFPGA in the emulation target
+ *
+ * Applies to the vFPGA from the next operation on, including the cThreads which are already running on it.
+ *
+ * @param vfid Virtual FPGA ID
+ * @param kernel Kernel model; nullptr restores the default loopback
+ * @param csr_hook CSR hook, if any
+ *
+ * @note Only available when linking against the emulation target (CoyoteEmulation)
+ */
+void setEmuKernel(int32_t vfid, cEmuKernel kernel, cEmuCsrHook csr_hook = nullptr);
+
+}
+
+#endif
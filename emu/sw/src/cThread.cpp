@@ -0,0 +1,1005 @@
+/**
+ * This file is part of the Coyote <https://github.com/fpgasystems/Coyote>
+ *
+ * MIT Licence
+ * Copyright (c) 2025, Systems Group, ETH Zurich
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <bitset>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <malloc.h>
+#include <sys/mman.h>
+
+#include <coyote/cThread.hpp>
+#include <coyote/cEmu.hpp>
+
+namespace coyote {
+
+/// Pending LOCAL_WRITE, filled with the output of the kernel model
+struct emuWrite {
+    int32_t ctid;
+    char *addr;
+    uint64_t len;
+    uint64_t filled;
+    bool last;
+};
+
+/**
+ * Emulated vFPGA, shared by all the cThreads of the process on the same vFPGA. The data path (kernel model, output 
+ * streams and pending writes) is serialized by a single lock, as the single data path of the vFPGA; the control 
+ * registers are atomics, the writeback counters are only written with the lock held.
+ */
+class emuVfpga : public cEmuVfpga {
+public:
+    explicit emuVfpga(int32_t vfid) : vfid(vfid), ctrl(new std::atomic<uint64_t>[N_CTRL_REGS]), wback(N_WBACKS * N_CTID_MAX, 0) {
+        for (uint32_t i = 0; i < N_CTRL_REGS; i++) {
+            ctrl[i] = 0;
+        }
+    }
+
+    int32_t getVfid() const override { return vfid; }
+
+    void send(uint32_t dest, const void *data, uint64_t len) override {
+        const char *src = static_cast<const char*>(data);
+        auto &pending = writes[dest];
+        while (len && !pending.empty()) {
+            emuWrite &wr = pending.front();
+            uint64_t n = std::min(len, wr.len - wr.filled);
+            memcpy(wr.addr + wr.filled, src, n);
+            wr.filled += n;
+            src += n;
+            len -= n;
+            if (wr.filled == wr.len) {
+                complete(wr);
+                pending.pop_front();
+            }
+        }
+
+        // Output without a pending write is kept until the next write to the stream
+        if (len) {
+            auto &buffered = out[dest];
+            buffered.insert(buffered.end(), src, src + len);
+        }
+    }
+
+    uint64_t getCSR(uint32_t offs) const override { return ctrl[checkCSR(offs)].load(std::memory_order_acquire); }
+
+    void setCSR(uint64_t val, uint32_t offs) override { ctrl[checkCSR(offs)].store(val, std::memory_order_release); }
+
+    void notify(uint32_t value) override {
+        std::lock_guard<std::mutex> lock(irq_mtx);
+        irqs.push_back(value);
+        irq_cv.notify_one();
+    }
+
+    /// Passes the data of a LOCAL_READ to the kernel model
+    void read(int32_t ctid, uint32_t dest, const char *data, uint64_t len, bool last) {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (kernel) {
+            kernel(*this, dest, data, len, last);
+        } else {
+            send(dest, data, len);
+        }
+        if (last) {
+            wback[ctid + RD_WBACK * N_CTID_MAX]++;
+        }
+    }
+
+    /// Queues a LOCAL_WRITE, filled from the data already sent to the stream and then from the data sent later on
+    void write(int32_t ctid, uint32_t dest, char *addr, uint64_t len, bool last) {
+        std::lock_guard<std::mutex> lock(mtx);
+        emuWrite wr = {ctid, addr, len, 0, last};
+        auto &pending = writes[dest];
+        auto &buffered = out[dest];
+        if (pending.empty() && !buffered.empty()) {
+            wr.filled = std::min<uint64_t>(len, buffered.size());
+            std::copy(buffered.begin(), buffered.begin() + wr.filled, addr);
+            buffered.erase(buffered.begin(), buffered.begin() + wr.filled);
+        }
+
+        if (wr.filled == wr.len) {
+            complete(wr);
+        } else {
+            pending.push_back(wr);
+        }
+    }
+
+    /// Sets a control register from the software, followed by the CSR hook
+    void setCSRFromHost(uint64_t val, uint32_t offs) {
+        setCSR(val, offs);
+        if (csr_hook) {
+            std::lock_guard<std::mutex> lock(mtx);
+            csr_hook(*this, offs, val);
+        }
+    }
+
+    /// Drops the pending writes of a ctid, whose buffers are about to be released
+    void dropWrites(int32_t ctid) {
+        std::lock_guard<std::mutex> lock(mtx);
+        for (auto &pending : writes) {
+            auto &queue = pending.second;
+            for (auto it = queue.begin(); it != queue.end();) {
+                it = it->ctid == ctid ? queue.erase(it) : it + 1;
+            }
+        }
+    }
+
+    void clearCounters(int32_t ctid) {
+        std::lock_guard<std::mutex> lock(mtx);
+        for (unsigned long i = 0; i < N_WBACKS; i++) {
+            wback[ctid + i * N_CTID_MAX] = 0;
+        }
+    }
+
+    const int32_t vfid;
+
+    /// Data path lock; held while the kernel model and the CSR hook run
+    std::mutex mtx;
+    cEmuKernel kernel;
+    cEmuCsrHook csr_hook;
+
+    std::unique_ptr<std::atomic<uint64_t>[]> ctrl;
+
+    /// Completion counters, laid out as the writeback region of the hardware; mapped into the cThreads as wback
+    std::vector<uint32_t> wback;
+
+    /// ctids in use
+    std::bitset<N_CTID_MAX> ctids;
+
+    /// Pending notifications, delivered by the interrupt thread or by cThread::pollNotifications()
+    std::mutex irq_mtx;
+    std::condition_variable irq_cv;
+    std::deque<uint32_t> irqs;
+
+    /// Interrupt thread, started by the first cThread with an interrupt routine (irq_owner), which it calls
+    std::thread irq_thread;
+    int32_t irq_owner = { -1 };
+    bool irq_stop = { false };
+
+    /// In-process vFPGA lock, see cThread::lock()
+    std::mutex user_lock;
+
+private:
+    /// Output sent by the kernel model without a pending write, per destination stream
+    std::map<uint32_t, std::deque<char>> out;
+
+    /// Pending writes, per destination stream, in order
+    std::map<uint32_t, std::deque<emuWrite>> writes;
+
+    void complete(const emuWrite &wr) {
+        if (wr.last) {
+            wback[wr.ctid + WR_WBACK * N_CTID_MAX]++;
+        }
+    }
+
+    static uint32_t checkCSR(uint32_t offs) {
+        if (offs >= N_CTRL_REGS) {
+            throw std::runtime_error("ERROR: CSR offset " + std::to_string(offs) + " outside of the control region of the emulated vFPGA");
+        }
+        return offs;
+    }
+};
+
+/// Emulated vFPGAs of the process and the kernel models installed with setEmuKernel(); never destroyed, as cThreads may outlive static destruction
+struct emuRegistry {
+    std::mutex mtx;
+    std::map<int32_t, std::weak_ptr<emuVfpga>> vfpgas;
+    std::map<int32_t, std::pair<cEmuKernel, cEmuCsrHook>> kernels;
+
+    static emuRegistry &get() {
+        static emuRegistry *registry = new emuRegistry;
+        return *registry;
+    }
+
+    /// Returns the emulated vFPGA, creating it (with its kernel model) if no cThread uses it
+    std::shared_ptr<emuVfpga> attach(int32_t vfid) {
+        std::lock_guard<std::mutex> lock(mtx);
+        auto vfpga = vfpgas[vfid].lock();
+        if (!vfpga) {
+            vfpga = std::make_shared<emuVfpga>(vfid);
+            auto it = kernels.find(vfid);
+            if (it != kernels.end()) {
+                vfpga->kernel = it->second.first;
+                vfpga->csr_hook = it->second.second;
+            }
+            vfpgas[vfid] = vfpga;
+        }
+        return vfpga;
+    }
+};
+
+void setEmuKernel(int32_t vfid, cEmuKernel kernel, cEmuCsrHook csr_hook) {
+    auto &registry = emuRegistry::get();
+    std::lock_guard<std::mutex> lock(registry.mtx);
+    registry.kernels[vfid] = {kernel, csr_hook};
+
+    auto vfpga = registry.vfpgas[vfid].lock();
+    if (vfpga) {
+        std::lock_guard<std::mutex> vfpga_lock(vfpga->mtx);
+        vfpga->kernel = kernel;
+        vfpga->csr_hook = csr_hook;
+    }
+}
+
+/**
+ * State of the emulation for a cThread: the emulated vFPGA it runs on. Syncs and off-loads are counted in 
+ * the cThread itself (sync_completed), as in hardware.
+ */
+class cThread::AdditionalState {
+public:
+    std::shared_ptr<emuVfpga> vfpga;
+    bool write_combining = { false }; // Only kept, see setWriteCombining()
+};
+
+static inline int syncIdx(CoyoteOper oper) { return oper == CoyoteOper::LOCAL_OFFLOAD ? 0 : 1; }
+
+cThread::cThread(int32_t vfid, pid_t hpid, uint32_t device, std::function<void(int)> uisr, CoyoteNotify notify, cNotifyReactor *reactor):
+  vfid(vfid), hpid(hpid), device(device), uisr(uisr), notify_mode(notify),
+  vlock(boost::interprocess::open_or_create, ("vpga_mtx_user_" + std::to_string(std::time(nullptr))).c_str()),
+  additional_state(std::make_shared<AdditionalState>()) { // Timestamp for plock, only the in-process lock is used by the emulation
+    auto &vfpga = additional_state->vfpga;
+    vfpga = emuRegistry::get().attach(vfid);
+
+    {
+        std::lock_guard<std::mutex> lock(vfpga->mtx);
+        ctid = -1;
+        for (int32_t i = 0; i < N_CTID_MAX; i++) {
+            if (!vfpga->ctids[i]) {
+                vfpga->ctids[i] = true;
+                ctid = i;
+                break;
+            }
+        }
+    }
+    if (ctid < 0) {
+        throw std::runtime_error("ERROR: cThread, no free ctid on the emulated vFPGA " + std::to_string(vfid) + ", exiting...");
+    }
+    vfpga->clearCounters(ctid);
+
+    // The completion counters are read from the emulated writeback region, as in hardware with writeback enabled
+    fcnfg.en_wb = true;
+    wback = vfpga->wback.data();
+
+    // The interrupt thread of a vFPGA calls the routine of the first cThread that provided one (outside of CoyoteNotify::POLL)
+    if (uisr && notify != CoyoteNotify::POLL) {
+        std::lock_guard<std::mutex> lock(vfpga->irq_mtx);
+        if (vfpga->irq_owner < 0) {
+            vfpga->irq_owner = ctid;
+            vfpga->irq_stop = false;
+            vfpga->irq_thread = std::thread([vfpga = vfpga.get(), uisr] {
+                std::unique_lock<std::mutex> lock(vfpga->irq_mtx);
+                while (true) {
+                    vfpga->irq_cv.wait(lock, [vfpga] { return vfpga->irq_stop || !vfpga->irqs.empty(); });
+                    if (vfpga->irq_stop) {
+                        return;
+                    }
+                    uint32_t value = vfpga->irqs.front();
+                    vfpga->irqs.pop_front();
+                    lock.unlock();
+                    uisr(value);
+                    lock.lock();
+                }
+            });
+        }
+    }
+}
+
+cThread::~cThread() {
+    auto &vfpga = additional_state->vfpga;
+    vfpga->dropWrites(ctid);
+
+    while (!mapped_pages.empty()) {
+        freeMem(mapped_pages.begin()->first);
+    }
+
+    std::thread irq_thread;
+    {
+        std::lock_guard<std::mutex> lock(vfpga->irq_mtx);
+        if (vfpga->irq_owner == ctid) {
+            vfpga->irq_stop = true;
+            vfpga->irq_owner = -1;
+            vfpga->irq_cv.notify_all();
+            irq_thread = std::move(vfpga->irq_thread);
+        }
+    }
+    if (irq_thread.joinable()) {
+        irq_thread.join();
+    }
+
+    if (lock_acquired) {
+        vfpga->user_lock.unlock();
+    }
+
+    std::lock_guard<std::mutex> lock(vfpga->mtx);
+    vfpga->ctids[ctid] = false;
+}
+
+void cThread::postCmd(uint64_t offs_3, uint64_t offs_2, uint64_t offs_1, uint64_t offs_0) {
+    // Do nothing because protected function
+}
+
+void cThread::postCmdBatch(const std::vector<std::array<uint64_t, 4>> &cmds) {
+    // Do nothing because protected function
+}
+
+uint32_t cThread::waitCmdCredits() {
+    // Do nothing because protected function
+    return CMD_FIFO_DEPTH;
+}
+
+std::array<uint64_t, 4> cThread::localCmd(CoyoteOper oper, const localSg &sg, uint64_t offs, uint64_t len, bool last) const {
+    // Do nothing because protected function
+    return {0, 0, 0, 0};
+}
+
+std::array<uint64_t, 4> cThread::rdmaCmd(CoyoteOper oper, const rdmaSg &sg, uint64_t offs, uint64_t len, bool last) const {
+    // Do nothing because protected function
+    return {0, 0, 0, 0};
+}
+
+void cThread::buildLocalCmds(std::vector<std::array<uint64_t, 4>> &cmds, CoyoteOper oper, const localSg &sg, bool last) const {
+    // Do nothing because protected function
+}
+
+void cThread::buildTransferCmds(std::vector<std::array<uint64_t, 4>> &cmds, const localSg &src_sg, const localSg &dst_sg, bool last) const {
+    // Do nothing because protected function
+}
+
+void cThread::buildRdmaCmds(std::vector<std::array<uint64_t, 4>> &cmds, CoyoteOper oper, const rdmaSg &sg, bool last) const {
+    // Do nothing because protected function
+}
+
+void cThread::bindNuma(void *mem, size_t size, int32_t node) const {
+    // Do nothing because protected function
+}
+
+void* cThread::allocHugePages(uint64_t size, int32_t numa_node) {
+    // Do nothing because protected function
+    return nullptr;
+}
+
+void cThread::mmapFpga() {
+    // Do nothing because protected function
+}
+
+void cThread::munmapFpga() {
+    // Do nothing because protected function
+}
+
+void cThread::userMap(void *vaddr, uint64_t len, int32_t mem_block, uint32_t mem_stripe, bool resident, CoyoteAccess access) {
+    // The emulated vFPGA accesses the host memory directly; the mapping is only recorded for isMapped()
+    mapped_regions[reinterpret_cast<uint64_t>(vaddr)] = reinterpret_cast<uint64_t>(vaddr) + len;
+}
+
+void cThread::userUnmap(void *vaddr) {
+    if (!mapped_regions.erase(reinterpret_cast<uint64_t>(vaddr))) {
+        throw std::runtime_error("ERROR: cThread::userUnmap() called for a buffer which is not mapped, exiting...");
+    }
+}
+
+void cThread::prefault(void *vaddr, uint64_t len, uint32_t stream) {
+    // Do nothing because the emulation has no page faults
+}
+
+void cThread::prefault(const std::vector<std::pair<void*, uint64_t>> &buffs, uint32_t stream) {
+    // Do nothing because the emulation has no page faults
+}
+
+void cThread::userMemBatch(const std::vector<memOpSg> &ops, int32_t mem_block, uint32_t mem_stripe) {
+    for (auto &op : ops) {
+        switch (op.op) {
+            case CoyoteMemOp::MAP: 
+                userMap(op.addr, op.len, mem_block, mem_stripe);
+                break;
+            case CoyoteMemOp::UNMAP:
+                userUnmap(op.addr);
+                break;
+            case CoyoteMemOp::OFFLOAD:
+            case CoyoteMemOp::OFFLOAD_HOST_UNCHANGED:
+                invoke(CoyoteOper::LOCAL_OFFLOAD, syncSg{op.addr, op.len, op.op == CoyoteMemOp::OFFLOAD_HOST_UNCHANGED});
+                break;
+            case CoyoteMemOp::SYNC:
+                invoke(CoyoteOper::LOCAL_SYNC, syncSg{op.addr, op.len});
+                break;
+        }
+    }
+}
+
+void cThread::setFaultAhead(void *vaddr, int64_t window) {
+    // Do nothing because the emulation has no page faults
+}
+
+void cThread::setAutoRegister(bool enable) {
+    // Do nothing because the emulation accesses any user buffer directly
+}
+
+void* cThread::getMem(CoyoteAlloc&& alloc) {
+    if (alloc.remote) {
+        throw std::runtime_error("ERROR: cThread::getMem(), networking is not supported by the emulation target, exiting...");
+    }
+
+    void *mem = nullptr;
+    if (alloc.size > 0) {
+        switch (alloc.alloc) {
+            // The emulation has no separate card memory, so card-only buffers are regular host memory
+            case CoyoteAllocType::REG : case CoyoteAllocType::CARD : {
+                mem = aligned_alloc(PAGE_SIZE, ((alloc.size + PAGE_SIZE - 1) / PAGE_SIZE) * PAGE_SIZE);
+                break;
+            }
+            case CoyoteAllocType::THP : {
+                if (posix_memalign(&mem, HUGE_PAGE_SIZE, alloc.size) != 0) {
+                    mem = nullptr;
+                }
+                break;
+            }
+            case CoyoteAllocType::HPF : {
+                mem = mmap(NULL, alloc.size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+                if (mem == MAP_FAILED) {
+                    mem = nullptr;
+                }
+                break;
+            }
+            // Huge pages, falling back to transparent huge pages
+            case CoyoteAllocType::AUTO : {
+                mem = mmap(NULL, alloc.size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+                alloc.alloc = CoyoteAllocType::HPF;
+                if (mem == MAP_FAILED) {
+                    alloc.alloc = CoyoteAllocType::THP;
+                    if (posix_memalign(&mem, HUGE_PAGE_SIZE, alloc.size) != 0) {
+                        mem = nullptr;
+                    }
+                }
+                break;
+            }
+            case CoyoteAllocType::HPF_1G : {
+                alloc.size = ((alloc.size + HUGE_PAGE_1G_SIZE - 1) >> HUGE_PAGE_1G_SHIFT) << HUGE_PAGE_1G_SHIFT;
+                mem = mmap(NULL, alloc.size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | (HUGE_PAGE_1G_SHIFT << MAP_HUGE_SHIFT), -1, 0);
+                if (mem == MAP_FAILED) {
+                    mem = nullptr;
+                }
+                break;
+            }
+            default: 
+                throw std::runtime_error("ERROR: cThread::getMem(), CoyoteAllocType not supported by the emulation target, exiting...");
+        }
+
+        if (!mem) {
+            throw std::runtime_error("ERROR: cThread::getMem(), could not allocate " + std::to_string(alloc.size) + " bytes, exiting...");
+        }
+        userMap(mem, alloc.size);
+        mapped_pages.emplace(mem, alloc);
+    }
+
+    return mem;
+}
+
+void cThread::reserveHugePages(uint64_t size, int32_t numa_node) {
+    // Nothing to reserve, the emulation allocates huge pages on demand
+}
+
+void cThread::freeMem(void* vaddr) {
+    auto it = mapped_pages.find(vaddr);
+    if (it == mapped_pages.end()) {
+        return;
+    }
+
+    userUnmap(vaddr);
+    switch (it->second.alloc) {
+        case CoyoteAllocType::HPF: case CoyoteAllocType::HPF_1G:
+            munmap(vaddr, it->second.size);
+            break;
+        default: 
+            free(vaddr);
+            break;
+    }
+    mapped_pages.erase(it);
+}
+
+void cThread::syncCardMem(void *host_mem, void *card_mem, uint64_t size) {
+    memcpy(host_mem, card_mem, size);
+}
+
+void cThread::offloadCardMem(void *card_mem, void *host_mem, uint64_t size) {
+    memcpy(card_mem, host_mem, size);
+}
+
+uint64_t cThread::shareCardMem(void *card_mem) {
+    throw std::runtime_error("ERROR: Sharing card memory is not supported by the emulation target, exiting...");
+}
+
+void* cThread::attachCardMem(uint64_t handle) {
+    throw std::runtime_error("ERROR: Sharing card memory is not supported by the emulation target, exiting...");
+}
+
+uint64_t cThread::persistCardMem(void *card_mem, const std::string &name) {
+    throw std::runtime_error("ERROR: Persistent card memory is not supported by the emulation target, exiting...");
+}
+
+void* cThread::attachCardMem(const std::string &name) {
+    throw std::runtime_error("ERROR: Persistent card memory is not supported by the emulation target, exiting...");
+}
+
+void cThread::unpersistCardMem(const std::string &name) {
+    throw std::runtime_error("ERROR: Persistent card memory is not supported by the emulation target, exiting...");
+}
+
+int cThread::exportP2PWindow() {
+    throw std::runtime_error("ERROR: Peer-to-peer DMA is not supported by the emulation target, exiting...");
+}
+
+void* cThread::importP2PWindow(int dmabuf_fd) {
+    throw std::runtime_error("ERROR: Peer-to-peer DMA is not supported by the emulation target, exiting...");
+}
+
+bool cThread::isMapped(const void *vaddr, uint64_t len) const {
+    uint64_t start = reinterpret_cast<uint64_t>(vaddr);
+    auto it = mapped_regions.upper_bound(start);
+    if (it == mapped_regions.begin()) {
+        return false;
+    }
+    --it;
+    return start + len <= it->second;
+}
+
+const CoyoteAlloc* cThread::getAlloc(const void *vaddr) const {
+    auto it = mapped_pages.upper_bound(const_cast<void*>(vaddr));
+    if (it == mapped_pages.begin()) {
+        return nullptr;
+    }
+    --it;
+    if (reinterpret_cast<uint64_t>(vaddr) >= reinterpret_cast<uint64_t>(it->first) + it->second.size) {
+        return nullptr;
+    }
+    return &it->second;
+}
+
+void cThread::setCSR(uint64_t val, uint32_t offs) {
+    additional_state->vfpga->setCSRFromHost(val, offs);
+}
+
+uint64_t cThread::getCSR(uint32_t offs) const {
+    return additional_state->vfpga->getCSR(offs);
+}
+
+void cThread::setCSRs(const std::vector<std::pair<uint32_t, uint64_t>> &csrs) {
+    for (const auto &csr : csrs) {
+        setCSR(csr.second, csr.first);
+    }
+}
+
+void cThread::getCSRs(std::vector<std::pair<uint32_t, uint64_t>> &csrs) const {
+    for (auto &csr : csrs) {
+        csr.second = getCSR(csr.first);
+    }
+}
+
+csrWindow cThread::mapCSRs(uint32_t base, uint32_t n_regs) {
+    if (base >= N_CTRL_REGS || n_regs > N_CTRL_REGS - base) {
+        throw std::runtime_error("ERROR: cThread::mapCSRs() called with a window outside of the control region, exiting...");
+    }
+    // The window forwards to setCSR() and getCSR(), so that the CSR hook sees all the writes
+    return csrWindow(this, nullptr, base, n_regs);
+}
+
+void cThread::invoke(CoyoteOper oper, syncSg sg) {
+    if (!isLocalSync(oper)) {
+        throw std::runtime_error("ERROR: cThread::invoke() called with syncSg flags, but the operation is not a LOCAL_SYNC or LOCAL_OFFLOAD; exiting...");
+    }
+
+    // The emulation has no card memory; syncs and off-loads complete immediately
+    sync_submitted[syncIdx(oper)]++;
+    sync_completed[syncIdx(oper)]++;
+}
+
+uint32_t cThread::invokeAsync(CoyoteOper oper, syncSg sg) {
+    invoke(oper, sg);
+    return sync_submitted[syncIdx(oper)];
+}
+
+void cThread::invoke(CoyoteOper oper, localSg sg, bool last) {
+    if (!isLocalRead(oper) && !isLocalWrite(oper)) {
+        throw std::runtime_error("ERROR: cThread::invoke() called with localSg flags, but the operation is not a LOCAL_READ or LOCAL_WRITE; exiting...");
+    }
+
+    if (isLocalRead(oper) && isLocalWrite(oper)) {
+        throw std::runtime_error("ERROR: cThread::invoke() called with one localSg for a LOCAL_TRANSFER; exiting...");
+    }
+
+    // Transfers are not split at MAX_TRANSFER_SIZE, the emulated data path has no limit on the length
+    if (isLocalRead(oper)) {
+        additional_state->vfpga->read(ctid, sg.dest, static_cast<const char*>(sg.addr), sg.len, last);
+    } else {
+        additional_state->vfpga->write(ctid, sg.dest, static_cast<char*>(sg.addr), sg.len, last);
+    }
+}
+
+void cThread::invoke(CoyoteOper oper, localSg src_sg, localSg dst_sg, bool last) {
+    if (!(isLocalRead(oper) && isLocalWrite(oper))) {
+        throw std::runtime_error("ERROR: cThread::invoke() called with two localSg flags, but the operation is not a LOCAL_TRANSFER; exiting...");
+    }
+
+    // The write is queued first, so the output of the kernel model goes straight into the destination buffer
+    additional_state->vfpga->write(ctid, dst_sg.dest, static_cast<char*>(dst_sg.addr), dst_sg.len, last);
+    additional_state->vfpga->read(ctid, src_sg.dest, static_cast<const char*>(src_sg.addr), src_sg.len, last);
+}
+
+void cThread::invoke(CoyoteOper oper, cardCopySg sg, bool last) {
+    if (!isLocalCardCopy(oper)) {
+        throw std::runtime_error("ERROR: cThread::invoke() called with cardCopySg flags, but the operation is not a LOCAL_CARD_COPY; exiting...");
+    }
+
+    // Same as in hardware, the copy goes through the card streams of the vFPGA
+    localSg src_sg = { .addr = sg.src_addr, .len = sg.len, .stream = STRM_CARD, .dest = sg.dest };
+    localSg dst_sg = { .addr = sg.dst_addr, .len = sg.len, .stream = STRM_CARD, .dest = sg.dest };
+    invoke(oper, src_sg, dst_sg, last);
+}
+
+void cThread::invoke(CoyoteOper oper, rdmaSg sg, bool last) {
+    throw std::runtime_error("ERROR: Networking is not supported by the emulation target, exiting...");
+}
+
+void cThread::invoke(CoyoteOper oper, tcpSg sg, bool last) {
+    throw std::runtime_error("ERROR: Networking is not supported by the emulation target, exiting...");
+}
+
+localPrep cThread::prepare(CoyoteOper oper, const localSg &sg, bool last) const {
+    if (!isLocalRead(oper) && !isLocalWrite(oper)) {
+        throw std::runtime_error("ERROR: cThread::prepare() called with localSg flags, but the operation is not a LOCAL_READ or LOCAL_WRITE; exiting...");
+    }
+
+    if (isLocalRead(oper) && isLocalWrite(oper)) {
+        throw std::runtime_error("ERROR: cThread::prepare() called with one localSg for a LOCAL_TRANSFER; exiting...");
+    }
+
+    // The emulation has no command encoding; the prepared operation just keeps the entries
+    localPrep prep;
+    prep.oper = oper;
+    prep.last = last;
+    if (isLocalRead(oper)) {
+        prep.src_sg = sg;
+    } else {
+        prep.dst_sg = sg;
+    }
+    return prep;
+}
+
+localPrep cThread::prepare(CoyoteOper oper, const localSg &src_sg, const localSg &dst_sg, bool last) const {
+    if (!(isLocalRead(oper) && isLocalWrite(oper))) {
+        throw std::runtime_error("ERROR: cThread::prepare() called with two localSg flags, but the operation is not a LOCAL_TRANSFER; exiting...");
+    }
+
+    localPrep prep;
+    prep.oper = oper;
+    prep.src_sg = src_sg;
+    prep.dst_sg = dst_sg;
+    prep.last = last;
+    return prep;
+}
+
+void cThread::invoke(const localPrep &prep) {
+    invokePrepared(prep, 0, prep.src_sg.len, prep.dst_sg.len);
+}
+
+void cThread::invoke(const localPrep &prep, uint64_t offs, uint64_t len) {
+    invokePrepared(prep, offs, len, len);
+}
+
+void cThread::invokePrepared(const localPrep &prep, uint64_t offs, uint64_t src_len, uint64_t dst_len) {
+    localSg src_sg = prep.src_sg, dst_sg = prep.dst_sg;
+    src_sg.addr = (void *) ((uint64_t) src_sg.addr + offs);
+    src_sg.len = src_len;
+    dst_sg.addr = (void *) ((uint64_t) dst_sg.addr + offs);
+    dst_sg.len = dst_len;
+
+    if (isLocalRead(prep.oper) && isLocalWrite(prep.oper)) {
+        invoke(prep.oper, src_sg, dst_sg, prep.last);
+    } else {
+        invoke(prep.oper, isLocalRead(prep.oper) ? src_sg : dst_sg, prep.last);
+    }
+}
+
+void cThread::invokeLocalBatch(CoyoteOper oper, const localSg *sgs, size_t n) {
+    if (isLocalRead(oper) && isLocalWrite(oper)) {
+        throw std::runtime_error("ERROR: cThread::invokeBatch() does not support LOCAL_TRANSFER; exiting...");
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        invoke(oper, sgs[i], i == n - 1);
+    }
+}
+
+void cThread::invokeBatch(CoyoteOper oper, const std::vector<localSg> &sgs) {
+    invokeLocalBatch(oper, sgs.data(), sgs.size());
+}
+
+void cThread::invoke(CoyoteOper oper, const localSg *sgs, size_t n) {
+    for (size_t i = 1; i < n; i++) {
+        if (sgs[i].dest != sgs[0].dest || sgs[i].stream != sgs[0].stream) {
+            throw std::runtime_error("ERROR: cThread::invoke() - all the entries of a vectored operation must target the same stream and dest, exiting...");
+        }
+    }
+
+    invokeLocalBatch(oper, sgs, n);
+}
+
+void cThread::invokeBatch(CoyoteOper oper, const std::vector<rdmaSg> &sgs) {
+    throw std::runtime_error("ERROR: Networking is not supported by the emulation target, exiting...");
+}
+
+void cThread::invokeChain(CoyoteOper oper, const rdmaSg &tmpl, const std::vector<rdmaChainSg> &chain) {
+    throw std::runtime_error("ERROR: Networking is not supported by the emulation target, exiting...");
+}
+
+uint32_t cThread::checkCompleted(CoyoteOper oper) const {
+    // Same order as in hardware: writes before reads, since LOCAL_TRANSFER is both
+    if (isLocalSync(oper)) {
+        return sync_completed[syncIdx(oper)];
+    } else if (isLocalWrite(oper)) {
+        return wback[ctid + WR_WBACK * N_CTID_MAX];
+    } else if (isLocalRead(oper)) {
+        return wback[ctid + RD_WBACK * N_CTID_MAX];
+    } else if (isRemoteRdma(oper) || isRemoteTcp(oper)) {
+        throw std::runtime_error("ERROR: Networking is not supported by the emulation target, exiting...");
+    } else {
+        return 0;
+    }
+}
+
+uint32_t cThread::checkCompleted(CoyoteOper oper, uint32_t qp) const {
+    throw std::runtime_error("ERROR: Networking is not supported by the emulation target, exiting...");
+}
+
+bool cThread::waitCompleted(CoyoteOper oper, uint32_t target, std::chrono::nanoseconds timeout, std::chrono::nanoseconds spin) const {
+    // Writes complete in the thread issuing the read which produces their data, so the waiting thread only has to poll
+    auto start = std::chrono::steady_clock::now();
+    while (checkCompleted(oper) < target) {
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        if (timeout.count() >= 0 && elapsed >= timeout) {
+            return false;
+        }
+
+        if (elapsed < spin) {
+            std::this_thread::yield();
+        } else {
+            std::this_thread::sleep_for(std::chrono::nanoseconds(SLEEP_TIME));
+        }
+    }
+    return true;
+}
+
+void cThread::clearCompleted() {
+    for (int i = 0; i < 2; i++) {
+        sync_submitted[i] = 0;
+        sync_completed[i] = 0;
+    }
+    additional_state->vfpga->clearCounters(ctid);
+}
+
+void cThread::doArpLookup(uint32_t ip_addr) {
+    throw std::runtime_error("ERROR: Networking is not supported by the emulation target, exiting...");
+}
+
+#ifdef EN_TCP_EXPERIMENTAL
+bool cThread::tcpListen(uint16_t port, uint32_t dest) {
+    throw std::runtime_error("ERROR: Networking is not supported by the emulation target, exiting...");
+}
+
+bool cThread::tcpOpen(uint32_t ip_addr, uint16_t port, uint32_t dest) {
+    throw std::runtime_error("ERROR: Networking is not supported by the emulation target, exiting...");
+}
+
+void cThread::tcpClose(uint32_t dest) {
+    throw std::runtime_error("ERROR: Networking is not supported by the emulation target, exiting...");
+}
+#endif
+
+void cThread::writeQpContext(uint32_t port, uint32_t qp) {
+    throw std::runtime_error("ERROR: Networking is not supported by the emulation target, exiting...");
+}
+ 
+uint32_t cThread::readAck() {
+    throw std::runtime_error("ERROR: Networking is not supported by the emulation target, exiting...");
+}
+
+void cThread::sendAck(uint32_t ack) {
+    throw std::runtime_error("ERROR: Networking is not supported by the emulation target, exiting...");
+}
+
+void cThread::connSync(bool client) {
+    throw std::runtime_error("ERROR: Networking is not supported by the emulation target, exiting...");
+}
+
+void cThread::rdmaSync(uint32_t qp) {
+    throw std::runtime_error("ERROR: Networking is not supported by the emulation target, exiting...");
+}
+
+void cThread::rdmaBarrier(const std::vector<uint32_t> &qps, uint32_t rank) {
+    throw std::runtime_error("ERROR: Networking is not supported by the emulation target, exiting...");
+}
+
+void* cThread::initRDMA(uint32_t buffer_size, uint16_t port, const char* server_address) {
+    throw std::runtime_error("ERROR: Networking is not supported by the emulation target, exiting...");
+}
+
+std::vector<uint32_t> cThread::connectPeers(const std::vector<std::string> &peers, uint32_t rank, void *buffer, uint32_t size, uint16_t port) {
+    throw std::runtime_error("ERROR: Networking is not supported by the emulation target, exiting...");
+}
+
+uint32_t cThread::registerMr(void *vaddr, uint64_t size) {
+    throw std::runtime_error("ERROR: Networking is not supported by the emulation target, exiting...");
+}
+
+uint32_t cThread::getNumRemoteMrs(uint32_t qp) const { return 0; }
+
+uint32_t cThread::addQp() {
+    throw std::runtime_error("ERROR: Networking is not supported by the emulation target, exiting...");
+}
+
+void cThread::connectQp(uint32_t qp, void *buffer, uint32_t size, uint16_t port, const char* server_address) {
+    throw std::runtime_error("ERROR: Networking is not supported by the emulation target, exiting...");
+}
+
+void cThread::reconnectQp(uint32_t qp, uint16_t port, const char* server_address) {
+    throw std::runtime_error("ERROR: Networking is not supported by the emulation target, exiting...");
+}
+
+void cThread::closeConn() {
+    throw std::runtime_error("ERROR: Networking is not supported by the emulation target, exiting...");
+}
+
+// The vFPGA lock only excludes the cThreads of the process, regardless of the lock backend
+void cThread::lock() {
+    if (!lock_acquired) {
+        additional_state->vfpga->user_lock.lock();
+        lock_acquired = true;
+    }
+}
+
+void cThread::unlock() {
+    if (lock_acquired) {
+        additional_state->vfpga->user_lock.unlock();
+        lock_acquired = false;
+    }
+}
+
+void cThread::reset(pid_t hpid) {
+    if (uisr) {
+        throw std::runtime_error("ERROR: cThread::reset() called on a cThread with a user interrupt routine, exiting...");
+    }
+
+    additional_state->vfpga->dropWrites(ctid);
+    while (!mapped_pages.empty()) {
+        freeMem(mapped_pages.begin()->first);
+    }
+    mapped_regions.clear();
+    clearCompleted();
+    this->hpid = hpid;
+}
+
+void cThread::setLockBackend(CoyoteLock backend) { lock_backend = backend; }
+
+CoyoteLock cThread::getLockBackend() const { return lock_backend; }
+
+void cThread::setBackoff(CoyoteBackoff policy) { backoff = policy; }
+
+CoyoteBackoff cThread::getBackoff() const { return backoff; }
+
+// Operations are emulated in-process, so there is no write-combined mapping to set up
+void cThread::setWriteCombining(bool enable) { additional_state->write_combining = enable; }
+
+bool cThread::getWriteCombining() const { return additional_state->write_combining; }
+
+// RDMA WRITEs are not paced in the emulation, since networking is not supported; the settings are only kept
+void cThread::setRdmaPacing(CoyotePacing mode, uint32_t max_window) {
+    if (!max_window) {
+        throw std::runtime_error("ERROR: cThread::setRdmaPacing() called with an empty window");
+    }
+    pacing_mode = mode;
+    pacing_max_window = max_window;
+}
+
+CoyotePacing cThread::getRdmaPacing() const { return pacing_mode; }
+
+uint32_t cThread::getRdmaWindow(uint32_t qp) const { return pacing_max_window; }
+
+uint32_t cThread::pollNotifications() {
+    if (notify_mode != CoyoteNotify::POLL || !uisr) {
+        return 0;
+    }
+
+    auto &vfpga = additional_state->vfpga;
+    std::deque<uint32_t> irqs;
+    {
+        std::lock_guard<std::mutex> lock(vfpga->irq_mtx);
+        irqs.swap(vfpga->irqs);
+    }
+    for (uint32_t value : irqs) {
+        uisr(value);
+    }
+    return irqs.size();
+}
+
+uint32_t cThread::getDroppedNotifications() const { return 0; }
+
+CoyoteNotify cThread::getNotifyMode() const { return notify_mode; }
+
+int32_t cThread::getNumaNode() const { return numa_node; }
+
+int32_t cThread::getVfid() const { return vfid;};
+
+int32_t cThread::getCtid() const { return ctid; };
+
+pid_t  cThread::getHpid() const { return hpid; };
+
+ibvQp* cThread::getQpair(uint32_t qp) const { return qpAt(qp); }
+
+uint32_t cThread::getNumQps() const { return 1 + extra_qpairs.size(); }
+
+ibvQp* cThread::qpAt(uint32_t qp) const {
+    if (qp == 0) {
+        return qpair.get();
+    }
+    if (qp > extra_qpairs.size()) {
+        throw std::runtime_error("ERROR: QP index out of range");
+    }
+    return extra_qpairs[qp - 1].second.get();
+}
+
+int32_t cThread::qpCtid(uint32_t qp) const {
+    return qp == 0 ? ctid : extra_qpairs.at(qp - 1).first;
+}
+
+void cThread::printDebug() const {
+    std::cout << std::setw(35) << "Completed local reads: \t" << checkCompleted(CoyoteOper::LOCAL_READ) << std::endl;
+    std::cout << std::setw(35) << "Completed local writes: \t" << checkCompleted(CoyoteOper::LOCAL_WRITE) << std::endl;
+    std::cout << std::setw(35) << "Sent remote reads: \t" << 0 << std::endl;
+    std::cout << std::setw(35) << "Sent remote writes: \t" << 0 << std::endl;
+
+    std::cout << std::setw(35) << "Invalidations received: \t-" << std::endl;
+    std::cout << std::setw(35) << "Page faults received: \t-" << std::endl;
+    std::cout << std::setw(35) << "Notifications received: \t-" << std::endl;	
+} 
+
+void cThread::setTimingTrace(bool enable) {
+    if (enable) {
+        throw std::runtime_error("ERROR: Timing reports are only available in simulation");
+    }
+}
+
+std::vector<simReqTiming> cThread::getTimings() const {
+    throw std::runtime_error("ERROR: Timing reports are only available in simulation");
+}
+
+void cThread::printTimingSummary() const {
+    throw std::runtime_error("ERROR: Timing reports are only available in simulation");
+}
+
+void cThread::writeTimingCsv(const std::string &file_name) const {
+    throw std::runtime_error("ERROR: Timing reports are only available in simulation");
+}
+
+}
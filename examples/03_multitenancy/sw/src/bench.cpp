@@ -0,0 +1,170 @@
+/**
+ * This file is part of the Coyote <https://github.com/fpgasystems/Coyote>
+ *
+ * MIT Licence
+ * Copyright (c) 2025, Systems Group, ETH Zurich
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <string>
+#include <sstream>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+// External library, Boost, for easier parsing of CLI arguments
+#include <boost/program_options.hpp>
+
+// Coyote-specific includes
+#include <coyote/cBench.hpp>
+#include <coyote/cThread.hpp>
+
+// Registers, corresponding to the ones in aes_axi_ctrl_parser
+#define KEY_LOW_REG  0
+#define KEY_HIGH_REG 1
+
+// 128-bit encryption key, same as in main.cpp
+constexpr uint64_t KEY_LOW  = 0x6167717a7a767668;
+constexpr uint64_t KEY_HIGH = 0x6a64727366626362;
+
+/**
+ * A tenant is one vFPGA, driven by its own (pinned) benchmark thread
+ * Streaming tenants keep several transfers in flight, while latency tenants issue one small transfer at a time
+ */
+struct tenant {
+    std::unique_ptr<coyote::cThread> coyote_thread;
+    coyote::localSg src_sg;
+    coyote::localSg dst_sg;
+    unsigned int depth;
+    uint32_t issued = 0;
+};
+
+// Parses a comma-separated list of CPUs, e.g. "2,4,6,8"
+std::vector<int> parse_cpus(const std::string &list) {
+    std::vector<int> cpus;
+    std::stringstream ss(list);
+    std::string cpu;
+    while (std::getline(ss, cpu, ',')) {
+        cpus.emplace_back(std::stoi(cpu));
+    }
+    return cpus;
+}
+
+void print_result(const std::string &name, const coyote::cBenchResult &result) {
+    std::cout << std::setw(10) << name << ": " 
+              << std::setw(8) << std::fixed << std::setprecision(3) << result.getGBps() << " GB/s; "
+              << "latency [us] avg " << std::setw(8) << result.getAvg() / 1e3 
+              << ", P50 " << std::setw(8) << result.getPercentile(50) / 1e3
+              << ", P99 " << std::setw(8) << result.getPercentile(99) / 1e3 
+              << ", P99.9 " << std::setw(8) << result.getPercentile(99.9) / 1e3 
+              << ", max " << std::setw(8) << result.getMax() / 1e3 << std::endl;
+}
+
+int main(int argc, char *argv[])  {
+    unsigned int n_vfpga, n_latency, n_runs, duration_ms, stream_size, stream_depth, latency_size;
+    std::string cpu_list, csv_file;
+
+    boost::program_options::options_description runtime_options("Coyote multi-tenant benchmark options");
+    runtime_options.add_options()
+        ("n_vfpga,n", boost::program_options::value<unsigned int>(&n_vfpga)->default_value(1), "Number of vFPGAs (tenants) to use simultaneously")
+        ("n_latency,l", boost::program_options::value<unsigned int>(&n_latency)->default_value(0), "Number of latency tenants, taken from the last vFPGAs; the others stream")
+        ("runs,r", boost::program_options::value<unsigned int>(&n_runs)->default_value(1000), "Operations per tenant (unless a duration is set)")
+        ("duration,t", boost::program_options::value<unsigned int>(&duration_ms)->default_value(0), "Duration of the run in ms; 0 runs a fixed number of operations")
+        ("stream_size,s", boost::program_options::value<unsigned int>(&stream_size)->default_value(1024 * 1024), "Transfer size of streaming tenants")
+        ("stream_depth,d", boost::program_options::value<unsigned int>(&stream_depth)->default_value(4), "Transfers in flight per streaming tenant")
+        ("latency_size,x", boost::program_options::value<unsigned int>(&latency_size)->default_value(64), "Transfer size of latency tenants")
+        ("cpus,c", boost::program_options::value<std::string>(&cpu_list)->default_value(""), "Comma-separated CPUs to pin the tenant threads to; by default, the threads are not pinned")
+        ("csv,o", boost::program_options::value<std::string>(&csv_file)->default_value(""), "File to write the per-tenant results to, as CSV");
+    boost::program_options::variables_map command_line_arguments;
+    boost::program_options::store(boost::program_options::parse_command_line(argc, argv, runtime_options), command_line_arguments);
+    boost::program_options::notify(command_line_arguments);
+
+    if (n_latency > n_vfpga) { throw std::runtime_error("More latency tenants than vFPGAs; exiting..."); }
+
+    HEADER("CLI PARAMETERS:");
+    std::cout << "Number of Coyote vFPGAs: " << n_vfpga << " (streaming: " << n_vfpga - n_latency << ", latency: " << n_latency << ")" << std::endl;
+    if (duration_ms) {
+        std::cout << "Duration: " << duration_ms << " ms" << std::endl;
+    } else {
+        std::cout << "Operations per tenant: " << n_runs << std::endl;
+    }
+    std::cout << "Streaming transfer size: " << stream_size << " x " << stream_depth << " in flight" << std::endl;
+    std::cout << "Latency transfer size: " << latency_size << std::endl;
+    std::cout << "Pinned to CPUs: " << (cpu_list.empty() ? "none" : cpu_list) << std::endl;
+
+    // Set up the tenants; each transfer encrypts a buffer: CPU MEM => vFPGA (AES) => CPU MEM
+    std::vector<tenant> tenants(n_vfpga);
+    coyote::cBenchLoad load;
+    load.n_threads = n_vfpga;
+    load.duration = std::chrono::milliseconds(duration_ms);
+    load.cpus = parse_cpus(cpu_list);
+    for (unsigned int i = 0; i < n_vfpga; i++) {
+        bool latency = i >= n_vfpga - n_latency;
+        unsigned int size = latency ? latency_size : stream_size;
+
+        tenants[i].coyote_thread.reset(new coyote::cThread(i, getpid()));
+        tenants[i].depth = latency ? 1 : stream_depth;
+
+        char *src_mem = (char *) tenants[i].coyote_thread->getMem({coyote::CoyoteAllocType::HPF, size});
+        char *dst_mem = (char *) tenants[i].coyote_thread->getMem({coyote::CoyoteAllocType::HPF, size});
+        if (!src_mem || !dst_mem) { throw std::runtime_error("Could not allocate memory; exiting..."); }
+        for (unsigned int k = 0; k < size; k++) {
+            src_mem[k] = 'A' + (random() % 26);
+        }
+        memset(dst_mem, 0, size);
+
+        tenants[i].src_sg = { .addr = src_mem, .len = size };
+        tenants[i].dst_sg = { .addr = dst_mem, .len = size };
+        tenants[i].coyote_thread->setCSR(KEY_LOW, KEY_LOW_REG);
+        tenants[i].coyote_thread->setCSR(KEY_HIGH, KEY_HIGH_REG);
+        tenants[i].coyote_thread->clearCompleted();
+
+        load.thread_bytes_per_op.emplace_back((uint64_t) size * tenants[i].depth);
+    }
+
+    // One operation of a tenant: submit its transfers and wait for all of them to complete
+    // The completion counter is not cleared between operations, so no operation pays for an extra register write
+    auto bench_fn = [&](unsigned int t) {
+        tenant &tn = tenants[t];
+        for (unsigned int k = 0; k < tn.depth; k++) {
+            tn.coyote_thread->invoke(coyote::CoyoteOper::LOCAL_TRANSFER, tn.src_sg, tn.dst_sg);
+        }
+        tn.issued += tn.depth;
+        while (tn.coyote_thread->checkCompleted(coyote::CoyoteOper::LOCAL_TRANSFER) < tn.issued) {}
+    };
+
+    // The threads start the measured phase together, after their warm-ups
+    coyote::cBench bench(n_runs, 10, false);
+    bench.run(load, bench_fn, [](unsigned int) {});
+
+    HEADER("RESULTS:");
+    for (unsigned int i = 0; i < n_vfpga; i++) {
+        print_result((i >= n_vfpga - n_latency ? "LAT " : "STRM ") + std::to_string(i), bench.getResult(i));
+    }
+    print_result("ALL", bench.getResult());
+
+    if (!csv_file.empty()) {
+        std::ofstream out(csv_file);
+        bench.writeCsv(out);
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,128 @@
+/*
+ * This file is part of the Coyote <https://github.com/fpgasystems/Coyote>
+ *
+ * MIT Licence
+ * Copyright (c) 2025, Systems Group, ETH Zurich
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * Measures the latency of user interrupts (notifications), from issuing the read which makes the vFPGA raise the interrupt 
+ * until the interrupt callback runs, in each of the delivery modes (CoyoteNotify); as a reference, it also measures the 
+ * latency of the same read without an interrupt, from issuing it until its completion is observed.
+ */
+
+// Includes
+#include <atomic>
+#include <iomanip>
+#include <iostream>
+#include <boost/program_options.hpp>
+
+#include <coyote/cBench.hpp>
+#include <coyote/cThread.hpp>
+
+// Constants
+#define DATA_SIZE_BYTES 64
+#define DEFAULT_VFPGA_ID 0
+
+// The vFPGA raises an interrupt if the first integer read is equal to this value
+#define INTERRUPT_VALUE 73
+
+void print_result(const std::string &name, coyote::cBench &bench) {
+    std::cout << std::left << std::setw(20) << name << std::right << std::fixed << std::setprecision(2)
+              << "P50: " << std::setw(8) << bench.getP50() / 1e3 << " us; "
+              << "P95: " << std::setw(8) << bench.getP95() / 1e3 << " us; "
+              << "P99: " << std::setw(8) << bench.getP99() / 1e3 << " us; "
+              << "max: " << std::setw(8) << bench.getMax() / 1e3 << " us" << std::endl;
+}
+
+void run_bench(coyote::CoyoteNotify mode, const std::string &name, unsigned int n_runs) {
+    std::atomic<int> received = { 0 };
+    coyote::cThread coyote_thread(DEFAULT_VFPGA_ID, getpid(), 0, [&](int value) { received = value; }, mode);
+
+    int *data = (int *) coyote_thread.getMem({coyote::CoyoteAllocType::REG, DATA_SIZE_BYTES});
+    data[0] = INTERRUPT_VALUE;
+    coyote::localSg sg = { .addr = data, .len = DATA_SIZE_BYTES };
+
+    // The time until the callback is measured; the completion of the read is awaited before the next one, but not measured
+    coyote::cBench bench(n_runs, n_runs / 10);
+    bench.execute(
+        [&]() {
+            coyote_thread.invoke(coyote::CoyoteOper::LOCAL_READ, sg);
+            while (!received) {
+                if (mode == coyote::CoyoteNotify::POLL) {
+                    coyote_thread.pollNotifications();
+                }
+            }
+            while (coyote_thread.checkCompleted(coyote::CoyoteOper::LOCAL_READ) != 1) {}
+        },
+        [&]() {
+            coyote_thread.clearCompleted();
+            received = 0;
+        }
+    );
+    print_result(name, bench);
+
+    if (coyote_thread.getDroppedNotifications()) {
+        std::cout << "WARNING: " << coyote_thread.getDroppedNotifications() << " notifications dropped" << std::endl;
+    }
+    coyote_thread.freeMem(data);
+}
+
+void run_reference(unsigned int n_runs) {
+    coyote::cThread coyote_thread(DEFAULT_VFPGA_ID, getpid());
+
+    int *data = (int *) coyote_thread.getMem({coyote::CoyoteAllocType::REG, DATA_SIZE_BYTES});
+    data[0] = INTERRUPT_VALUE + 1;
+    coyote::localSg sg = { .addr = data, .len = DATA_SIZE_BYTES };
+
+    coyote::cBench bench(n_runs, n_runs / 10);
+    bench.execute(
+        [&]() {
+            coyote_thread.invoke(coyote::CoyoteOper::LOCAL_READ, sg);
+            while (coyote_thread.checkCompleted(coyote::CoyoteOper::LOCAL_READ) != 1) {}
+        },
+        [&]() { coyote_thread.clearCompleted(); }
+    );
+    print_result("completion (ref.)", bench);
+
+    coyote_thread.freeMem(data);
+}
+
+int main(int argc, char *argv[]) {
+    // CLI arguments
+    unsigned int n_runs;
+
+    boost::program_options::options_description runtime_options("Coyote User Interrupt Latency Options");
+    runtime_options.add_options()
+        ("runs,r", boost::program_options::value<unsigned int>(&n_runs)->default_value(10000), "Number of interrupts per mode");
+    boost::program_options::variables_map command_line_arguments;
+    boost::program_options::store(boost::program_options::parse_command_line(argc, argv, runtime_options), command_line_arguments);
+    boost::program_options::notify(command_line_arguments);
+
+    HEADER("USER INTERRUPT LATENCY");
+    run_reference(n_runs);
+    run_bench(coyote::CoyoteNotify::EVENTFD, "eventfd", n_runs);
+    run_bench(coyote::CoyoteNotify::COALESCED, "coalesced", n_runs);
+    run_bench(coyote::CoyoteNotify::POLL, "poll", n_runs);
+
+    return EXIT_SUCCESS;
+}
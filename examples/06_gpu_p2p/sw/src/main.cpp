@@ -25,6 +25,7 @@
  */
 
 #include <iostream>
+#include <chrono>
 #include <cstdlib>
 
 // AMD GPU management & run-time libraries
@@ -36,6 +37,7 @@
 // Coyote-specific includes
 #include <coyote/cBench.hpp>
 #include <coyote/cThread.hpp>
+#include <coyote/cGpuPipeline.hpp>
 
 // Constants
 #define N_LATENCY_REPS 1
@@ -43,6 +45,51 @@
 
 #define DEFAULT_GPU_ID 0
 #define DEFAULT_VFPGA_ID 0
+#define N_PIPELINE_ITEMS 1024
+#define GPU_BLOCK_SIZE 256
+
+// First GPU stage of the pipeline: generates the item's data, directly in the buffer streamed to the vFPGA
+__global__ void produce(int *src, size_t n, uint64_t item) {
+    size_t i = blockIdx.x * blockDim.x + threadIdx.x;
+    if (i < n) { src[i] = (int) ((i + item) % 1024) - 512; }
+}
+
+// Second GPU stage of the pipeline: checks the vFPGA output (every element incremented by 1) and counts the mismatches
+__global__ void consume(const int *src, const int *dst, size_t n, unsigned int *errors) {
+    size_t i = blockIdx.x * blockDim.x + threadIdx.x;
+    if (i < n && dst[i] != src[i] + 1) { atomicAdd(errors, 1); }
+}
+
+// Streams N_PIPELINE_ITEMS items of size bytes through GPU kernel -> vFPGA -> GPU kernel, without any host round-trips
+// Returns the mean time per item, in ns
+double run_pipeline(coyote::cThread &coyote_thread, uint size, uint n_slots) {
+    coyote::cGpuPipeline pipeline(coyote_thread, size, n_slots, DEFAULT_GPU_ID);
+    size_t n = size / sizeof(int);
+    uint blocks = (n + GPU_BLOCK_SIZE - 1) / GPU_BLOCK_SIZE;
+
+    unsigned int *errors;
+    if (hipMalloc(&errors, sizeof(unsigned int)) || hipMemset(errors, 0, sizeof(unsigned int))) { 
+        throw std::runtime_error("Couldn't allocate the error counter!"); 
+    }
+
+    pipeline.setPreStage([&](coyote::cGpuSlot &slot) {
+        hipLaunchKernelGGL(produce, dim3(blocks), dim3(GPU_BLOCK_SIZE), 0, slot.stream, (int *) slot.src, n, slot.item);
+    });
+    pipeline.setPostStage([&](coyote::cGpuSlot &slot) {
+        hipLaunchKernelGGL(consume, dim3(blocks), dim3(GPU_BLOCK_SIZE), 0, slot.stream, (int *) slot.src, (int *) slot.dst, n, errors);
+    });
+
+    auto begin = std::chrono::high_resolution_clock::now();
+    pipeline.run(N_PIPELINE_ITEMS, size);
+    auto end = std::chrono::high_resolution_clock::now();
+
+    unsigned int n_errors;
+    if (hipMemcpy(&n_errors, errors, sizeof(unsigned int), hipMemcpyDeviceToHost)) { throw std::runtime_error("Couldn't read the error counter!"); }
+    hipFree(errors);
+    if (n_errors) { throw std::runtime_error("Wrong result!"); }
+
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count() / (double) N_PIPELINE_ITEMS;
+}
 
 // Note, how the Coyote thread is passed by reference; to avoid creating a copy of 
 // the thread object which can lead to undefined behaviour and bugs. 
@@ -94,12 +141,13 @@ double run_bench(
 
 int main(int argc, char *argv[])  {
     // CLI arguments
-    unsigned int min_size, max_size, n_runs;
+    unsigned int min_size, max_size, n_runs, n_slots;
     boost::program_options::options_description runtime_options("Coyote Perf GPU Options");
     runtime_options.add_options()
         ("runs,r", boost::program_options::value<unsigned int>(&n_runs)->default_value(50), "Number of times to repeat the test")
         ("min_size,x", boost::program_options::value<unsigned int>(&min_size)->default_value(64), "Starting (minimum) transfer size")
-        ("max_size,X", boost::program_options::value<unsigned int>(&max_size)->default_value(4 * 1024 * 1024), "Ending (maximum) transfer size");
+        ("max_size,X", boost::program_options::value<unsigned int>(&max_size)->default_value(4 * 1024 * 1024), "Ending (maximum) transfer size")
+        ("pipeline,p", boost::program_options::value<unsigned int>(&n_slots)->default_value(0), "Run the GPU -> FPGA -> GPU pipeline with this many slots (0: plain transfers)");
     boost::program_options::variables_map command_line_arguments;
     boost::program_options::store(boost::program_options::parse_command_line(argc, argv, runtime_options), command_line_arguments);
     boost::program_options::notify(command_line_arguments);
@@ -107,7 +155,8 @@ int main(int argc, char *argv[])  {
     HEADER("CLI PARAMETERS:");
     std::cout << "Number of test runs: " << n_runs << std::endl;
     std::cout << "Starting transfer size: " << min_size << std::endl;
-    std::cout << "Ending transfer size: " << max_size << std::endl << std::endl;
+    std::cout << "Ending transfer size: " << max_size << std::endl;
+    std::cout << "Pipeline slots: " << n_slots << std::endl << std::endl;
 
     // GPU memory will be allocated on the GPU set using hipSetDevice(...)
     if (hipSetDevice(DEFAULT_GPU_ID)) { throw std::runtime_error("Couldn't select GPU!"); }
@@ -115,6 +164,18 @@ int main(int argc, char *argv[])  {
     // Obtain a Coyote thread and allocate memory
     // Note, the only difference from Example 1 is the way memory is allocated
     coyote::cThread coyote_thread(DEFAULT_VFPGA_ID, getpid());
+
+    if (n_slots) {
+        HEADER("PERF GPU PIPELINE");
+        for (unsigned int curr_size = min_size; curr_size <= max_size; curr_size *= 2) {
+            double item_time = run_pipeline(coyote_thread, curr_size, n_slots);
+            double throughput = (double) curr_size / (1024.0 * 1024.0 * item_time * 1e-9);
+            std::cout << "Size: " << std::setw(8) << curr_size << "; Throughput: " << std::setw(8) << throughput << " MB/s; ";
+            std::cout << "Time per item: " << std::setw(8) << item_time / 1e3 << " us" << std::endl;
+        }
+        return EXIT_SUCCESS;
+    }
+
     int *src_mem = (int *) coyote_thread.getMem({coyote::CoyoteAllocType::GPU, max_size, false, DEFAULT_GPU_ID});
     int *dst_mem = (int *) coyote_thread.getMem({coyote::CoyoteAllocType::GPU, max_size, false, DEFAULT_GPU_ID});
     if (!src_mem || !dst_mem) { throw std::runtime_error("Could not allocate memory; exiting..."); }
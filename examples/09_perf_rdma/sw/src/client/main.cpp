@@ -50,10 +50,10 @@ double run_bench(
     }
     
     // Before every benchmark, clear previous completion flags and sync with server
-    // Sync is in a way equivalent to MPI_Barrier()
+    // Sync is in a way equivalent to MPI_Barrier(); it is done over RDMA, rather than the out-of-band TCP connection
     auto prep_fn = [&]() {
         coyote_thread.clearCompleted();
-        coyote_thread.connSync(IS_CLIENT);
+        coyote_thread.rdmaSync();
     };
     
     /* Benchmark function; as eplained in the README
@@ -51,7 +51,7 @@ void run_bench(
     for (int i = 0; i < n_runs; i++) {
         // Clear previous completion flags and sync with client
         coyote_thread.clearCompleted();
-        coyote_thread.connSync(IS_CLIENT);
+        coyote_thread.rdmaSync();
 
         // For writes, wait until client has written the targer number of messages; then write them back
         if (operation) {
@@ -0,0 +1,298 @@
+/**
+ * This file is part of the Coyote <https://github.com/fpgasystems/Coyote>
+ *
+ * MIT Licence
+ * Copyright (c) 2021-2025, Systems Group, ETH Zurich
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <deque>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <iostream>
+#include <algorithm>
+#include <cstdlib>
+
+// External library for easier parsing of CLI arguments by the executable
+#include <boost/program_options.hpp>
+
+// Coyote-specific includes
+#include <coyote/cBench.hpp>
+#include <coyote/cThread.hpp>
+#include <constants.hpp>
+
+/*
+ * RDMA sweep benchmark
+ *
+ * Unlike the client/server pair, every node of the job runs the same executable, with the same list of peers.
+ * For every combination of message size, outstanding operations (depth), QPs per peer and READ/WRITE mix, 
+ * each active node issues operations to all of its peers, round-robin over its QPs, keeping up to depth 
+ * operations in flight per QP. Only rank 0 is active by default; in bidirectional mode all the nodes are.
+ * Each QP per peer is served by its own cThread, connected with connectPeers() on its own port.
+ */
+
+// One benchmark configuration
+struct sweepConfig {
+    unsigned int size;
+    unsigned int depth;
+    unsigned int n_qps;
+    unsigned int read_pct;
+};
+
+// Results of one configuration, as measured by one node
+struct sweepResult {
+    sweepConfig cnfg;
+    double gbps;
+    double run_p50_us;
+    double lat_p50_us, lat_p95_us, lat_p99_us, lat_max_us;
+};
+
+// Parses a comma-separated list of unsigned integers
+std::vector<unsigned int> parse_list(const std::string &list) {
+    std::vector<unsigned int> values;
+    std::stringstream ss(list);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        if (!item.empty()) { values.push_back(std::stoul(item)); }
+    }
+    return values;
+}
+
+// Percentile of a sorted vector of latencies
+double percentile(const std::vector<double> &sorted, double pct) {
+    if (sorted.empty()) { return 0; }
+    size_t idx = std::min(sorted.size() - 1, (size_t) (pct / 100.0 * sorted.size()));
+    return sorted[idx];
+}
+
+// One QP of a node: the cThread serving it and its index within the cThread
+struct sweepQp {
+    coyote::cThread *thread;
+    uint32_t qp;
+};
+
+// Operations in flight on a QP, for one operation type; they complete in order
+struct inflightOps {
+    uint32_t base = 0;
+    uint32_t completed = 0;
+    std::deque<std::chrono::high_resolution_clock::time_point> issued;
+};
+
+sweepResult run_config(
+    std::vector<coyote::cThread*> &threads, const std::vector<std::vector<uint32_t>> &qps, unsigned int rank, 
+    const sweepConfig &cnfg, bool active, unsigned int n_ops, unsigned int n_runs
+) {
+    // The QPs used in this configuration: the first n_qps cThreads, each with one QP per peer
+    std::vector<sweepQp> active_qps;
+    for (unsigned int t = 0; t < cnfg.n_qps; t++) {
+        for (unsigned int peer = 0; peer < qps[t].size(); peer++) {
+            if (peer != rank) { active_qps.push_back({threads[t], qps[t][peer]}); }
+        }
+    }
+
+    unsigned int run = 0;
+    std::vector<double> latencies;
+
+    // Before every run, synchronize all the nodes, so that the active ones start together
+    auto prep_fn = [&]() {
+        threads[0]->rdmaBarrier(qps[0], rank);
+        run++;
+    };
+
+    auto bench_fn = [&]() {
+        if (!active) { return; }
+
+        // Completion counters are cumulative, so each run starts from the current value ([0] for WRITE, [1] for READ)
+        std::vector<std::array<inflightOps, 2>> inflight(active_qps.size());
+        for (size_t i = 0; i < active_qps.size(); i++) {
+            inflight[i][0].base = active_qps[i].thread->checkCompleted(coyote::CoyoteOper::REMOTE_RDMA_WRITE, active_qps[i].qp);
+            inflight[i][1].base = active_qps[i].thread->checkCompleted(coyote::CoyoteOper::REMOTE_RDMA_READ, active_qps[i].qp);
+        }
+
+        unsigned int issued = 0, completed = 0;
+        size_t next_qp = 0;
+        while (completed < n_ops) {
+            // Issue to the next QP with room; the operation type follows the READ percentage
+            sweepQp &target = active_qps[next_qp];
+            auto &ops = inflight[next_qp];
+            if (issued < n_ops && ops[0].issued.size() + ops[1].issued.size() < cnfg.depth) {
+                bool read = (issued % 100) < cnfg.read_pct;
+                coyote::rdmaSg sg = { .len = cnfg.size, .qp = target.qp };
+                ops[read].issued.push_back(std::chrono::high_resolution_clock::now());
+                target.thread->invoke(read ? coyote::CoyoteOper::REMOTE_RDMA_READ : coyote::CoyoteOper::REMOTE_RDMA_WRITE, sg);
+                issued++;
+            }
+            next_qp = (next_qp + 1) % active_qps.size();
+
+            // Record the latencies of the completed operations
+            for (size_t i = 0; i < active_qps.size(); i++) {
+                for (int read = 0; read < 2; read++) {
+                    inflightOps &op = inflight[i][read];
+                    if (op.issued.empty()) { continue; }
+
+                    coyote::CoyoteOper oper = read ? coyote::CoyoteOper::REMOTE_RDMA_READ : coyote::CoyoteOper::REMOTE_RDMA_WRITE;
+                    uint32_t done = active_qps[i].thread->checkCompleted(oper, active_qps[i].qp) - op.base;
+                    auto now = std::chrono::high_resolution_clock::now();
+                    while (op.completed < done && !op.issued.empty()) {
+                        if (run > 1) {
+                            latencies.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(now - op.issued.front()).count());
+                        }
+                        op.issued.pop_front();
+                        op.completed++;
+                        completed++;
+                    }
+                }
+            }
+        }
+    };
+
+    // One warm-up run, not recorded
+    coyote::cBench bench(n_runs, 1);
+    bench.execute(bench_fn, prep_fn);
+
+    sweepResult result = { cnfg };
+    if (active) {
+        std::sort(latencies.begin(), latencies.end());
+        result.gbps = ((double) n_ops * (double) cnfg.size * 8.0) / bench.getAvg();
+        result.run_p50_us = percentile(bench.getAll(), 50) / 1e3;
+        result.lat_p50_us = percentile(latencies, 50) / 1e3;
+        result.lat_p95_us = percentile(latencies, 95) / 1e3;
+        result.lat_p99_us = percentile(latencies, 99) / 1e3;
+        result.lat_max_us = latencies.empty() ? 0 : latencies.back() / 1e3;
+    }
+    return result;
+}
+
+void write_results(const std::vector<sweepResult> &results, const std::string &path, const std::string &format, unsigned int rank) {
+    std::ofstream out(path);
+    if (!out) { throw std::runtime_error("Could not open " + path + " for writing; exiting..."); }
+
+    if (format == "json") {
+        out << "[" << std::endl;
+        for (size_t i = 0; i < results.size(); i++) {
+            const sweepResult &r = results[i];
+            out << "  {\"rank\": " << rank << ", \"size\": " << r.cnfg.size << ", \"depth\": " << r.cnfg.depth 
+                << ", \"qps\": " << r.cnfg.n_qps << ", \"read_pct\": " << r.cnfg.read_pct << ", \"gbps\": " << r.gbps 
+                << ", \"run_p50_us\": " << r.run_p50_us << ", \"lat_p50_us\": " << r.lat_p50_us << ", \"lat_p95_us\": " << r.lat_p95_us 
+                << ", \"lat_p99_us\": " << r.lat_p99_us << ", \"lat_max_us\": " << r.lat_max_us << "}" << (i + 1 < results.size() ? "," : "") << std::endl;
+        }
+        out << "]" << std::endl;
+    } else {
+        out << "rank,size,depth,qps,read_pct,gbps,run_p50_us,lat_p50_us,lat_p95_us,lat_p99_us,lat_max_us" << std::endl;
+        for (const sweepResult &r : results) {
+            out << rank << "," << r.cnfg.size << "," << r.cnfg.depth << "," << r.cnfg.n_qps << "," << r.cnfg.read_pct << "," 
+                << r.gbps << "," << r.run_p50_us << "," << r.lat_p50_us << "," << r.lat_p95_us << "," << r.lat_p99_us << "," << r.lat_max_us << std::endl;
+        }
+    }
+}
+
+int main(int argc, char *argv[])  {
+    // CLI arguments
+    std::string peers_list, sizes_list, depths_list, qps_list, mix_list, output, format;
+    unsigned int rank, n_runs, n_ops, port;
+    bool bidirectional;
+
+    boost::program_options::options_description runtime_options("Coyote Perf RDMA Sweep Options");
+    runtime_options.add_options()
+        ("peers,p", boost::program_options::value<std::string>(&peers_list)->required(), "Comma-separated IP addresses of all the nodes' CPUs, in rank order")
+        ("rank,k", boost::program_options::value<unsigned int>(&rank)->required(), "Rank of this node, i.e., its index in the list of peers")
+        ("port,P", boost::program_options::value<unsigned int>(&port)->default_value(coyote::DEF_PORT), "Base port for the out-of-band connections; one port per QP")
+        ("sizes,s", boost::program_options::value<std::string>(&sizes_list)->default_value(""), "Comma-separated message sizes; default: powers of two from 64 B to 1 MB")
+        ("depths,d", boost::program_options::value<std::string>(&depths_list)->default_value("1,8,32"), "Comma-separated numbers of outstanding operations per QP")
+        ("qps,q", boost::program_options::value<std::string>(&qps_list)->default_value("1"), "Comma-separated numbers of QPs per peer")
+        ("mix,m", boost::program_options::value<std::string>(&mix_list)->default_value("0,100"), "Comma-separated percentages of READs; the other operations are WRITEs")
+        ("bidirectional,b", boost::program_options::value<bool>(&bidirectional)->default_value(false), "All the nodes issue operations (1), or only rank 0 (0)")
+        ("ops,n", boost::program_options::value<unsigned int>(&n_ops)->default_value(N_THROUGHPUT_REPS * 32), "Number of operations per run")
+        ("runs,r", boost::program_options::value<unsigned int>(&n_runs)->default_value(N_RUNS_DEFAULT), "Number of times to repeat each configuration")
+        ("output,O", boost::program_options::value<std::string>(&output)->default_value(""), "File to write the results of this node to")
+        ("format,f", boost::program_options::value<std::string>(&format)->default_value("csv"), "Format of the output file: csv or json");
+    boost::program_options::variables_map command_line_arguments;
+    boost::program_options::store(boost::program_options::parse_command_line(argc, argv, runtime_options), command_line_arguments);
+    boost::program_options::notify(command_line_arguments);
+
+    std::vector<std::string> peers;
+    std::stringstream ss(peers_list);
+    for (std::string peer; std::getline(ss, peer, ',');) { peers.push_back(peer); }
+
+    std::vector<unsigned int> sizes = parse_list(sizes_list);
+    if (sizes.empty()) {
+        for (unsigned int size = MIN_TRANSFER_SIZE_DEFAULT; size <= MAX_TRANSFER_SIZE_DEFAULT; size *= 2) { sizes.push_back(size); }
+    }
+    std::vector<unsigned int> depths = parse_list(depths_list), n_qps = parse_list(qps_list), mix = parse_list(mix_list);
+    if (peers.size() < 2 || rank >= peers.size() || depths.empty() || n_qps.empty() || mix.empty()) {
+        throw std::runtime_error("Invalid arguments: at least two peers, a valid rank and non-empty sweeps are required; exiting...");
+    }
+    unsigned int max_size = *std::max_element(sizes.begin(), sizes.end());
+    unsigned int max_qps = *std::max_element(n_qps.begin(), n_qps.end());
+
+    HEADER("CLI PARAMETERS:");
+    std::cout << "Rank: " << rank << " of " << peers.size() << std::endl;
+    std::cout << "Direction: " << (bidirectional ? "bidirectional" : "unidirectional, from rank 0") << std::endl;
+    std::cout << "Operations per run: " << n_ops << ", runs: " << n_runs << std::endl;
+    std::cout << "QPs per peer: up to " << max_qps << ", maximum message size: " << max_size << std::endl << std::endl;
+
+    /* Each QP per peer is served by its own cThread, which connects to all the peers with connectPeers();
+     * connectPeers() retries until the peers are listening, so the nodes can be started in any order
+     */
+    std::vector<coyote::cThread*> threads;
+    std::vector<std::vector<uint32_t>> qps;
+    for (unsigned int t = 0; t < max_qps; t++) {
+        threads.push_back(new coyote::cThread(DEFAULT_VFPGA_ID, getpid(), 0));
+        void *mem = threads[t]->getMem({coyote::CoyoteAllocType::HPF, max_size, true});
+        if (!mem) { throw std::runtime_error("Could not allocate memory; exiting..."); }
+        qps.push_back(threads[t]->connectPeers(peers, rank, mem, max_size, port + t));
+    }
+
+    // Sweep
+    HEADER("RDMA SWEEP BENCHMARK");
+    bool active = bidirectional || rank == 0;
+    std::vector<sweepResult> results;
+    for (unsigned int q : n_qps) {
+        for (unsigned int read_pct : mix) {
+            for (unsigned int depth : depths) {
+                for (unsigned int size : sizes) {
+                    sweepConfig cnfg = { size, depth, q, std::min(read_pct, 100u) };
+                    sweepResult result = run_config(threads, qps, rank, cnfg, active, n_ops, n_runs);
+                    if (!active) { continue; }
+
+                    results.push_back(result);
+                    std::cout << "Size: " << std::setw(8) << size << "; depth: " << std::setw(3) << depth << "; QPs: " << std::setw(2) << q 
+                              << "; READ: " << std::setw(3) << cnfg.read_pct << "%; " << std::setw(8) << std::fixed << std::setprecision(2) 
+                              << result.gbps << " Gb/s; latency P50/P95/P99: " << result.lat_p50_us << "/" << result.lat_p95_us << "/" 
+                              << result.lat_p99_us << " us" << std::endl;
+                }
+            }
+        }
+    }
+
+    if (active && !output.empty()) {
+        write_results(results, output, format, rank);
+        std::cout << std::endl << "Results written to " << output << std::endl;
+    }
+
+    // Final sync, so that no node tears its QPs down while others are still running
+    threads[0]->rdmaBarrier(qps[0], rank);
+    for (coyote::cThread *thread : threads) { delete thread; }
+    return EXIT_SUCCESS;
+}
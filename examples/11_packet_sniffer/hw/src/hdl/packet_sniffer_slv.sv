@@ -40,18 +40,22 @@ module packet_sniffer_slv (
   output logic [0:0]                  sniffer_ctrl_1,
   output logic [63:0]                 sniffer_ctrl_filter,
   input  logic [1:0]                  sniffer_state,
-  input  logic [31:0]                 sniffer_size,
+  input  logic [63:0]                 sniffer_size,
   input  logic [63:0]                 sniffer_timer,
   output logic [VADDR_BITS-1:0]       sniffer_host_vaddr,
   output logic [LEN_BITS-1:0]         sniffer_host_len,
   output logic [PID_BITS-1:0]         sniffer_ctid,
-  output logic [DEST_BITS-1:0]        sniffer_host_dest
+  output logic [DEST_BITS-1:0]        sniffer_host_dest,
+  output logic [0:0]                  sniffer_ring,
+  output logic [63:0]                 sniffer_tail,
+  input  logic [63:0]                 sniffer_head,
+  input  logic [31:0]                 sniffer_dropped
 );
 
 // -- Decl ----------------------------------------------------------
 // ------------------------------------------------------------------
 // Constants
-localparam integer N_REGS = 10;
+localparam integer N_REGS = 14;
 localparam integer ADDR_LSB = $clog2(AXIL_DATA_BITS/8);
 localparam integer ADDR_MSB = $clog2(N_REGS);
 localparam integer AXI_ADDR_BITS = ADDR_LSB + ADDR_MSB;
@@ -98,6 +102,14 @@ localparam integer SNIFFER_LEN_REG    = 7;
 localparam integer SNIFFER_CTID_REG   = 8;
 // 9 (WR)   : Location of the buffer to store captured packets (written by host)
 localparam integer SNIFFER_DEST_REG   = 9; // 0 for FPGA memory and 1 for host memory, only 0 is supported now
+// 10 (WR)  : 1 to use the buffer as a ring, consumed by the host while sniffing (written by host)
+localparam integer SNIFFER_RING_REG   = 10;
+// 11 (WR)  : Ring mode, bytes consumed by the host so far (written by host)
+localparam integer SNIFFER_TAIL_REG   = 11;
+// 12 (RO)  : Bytes written to the buffer so far, in whole requests
+localparam integer SNIFFER_HEAD_REG   = 12;
+// 13 (RO)  : Ring mode, packets dropped because the ring was full
+localparam integer SNIFFER_DROP_REG   = 13;
 
 // Write process
 assign slv_reg_wren = axi_wready && axi_ctrl.wvalid && axi_awready && axi_ctrl.awvalid;
@@ -152,6 +164,18 @@ always_ff @(posedge aclk) begin
               slv_reg[SNIFFER_DEST_REG][(i*8)+:8] <= axi_ctrl.wdata[(i*8)+:8];
             end
           end
+        SNIFFER_RING_REG: // Ring mode
+          for (int i = 0; i < (AXIL_DATA_BITS/8); i++) begin
+            if(axi_ctrl.wstrb[i]) begin
+              slv_reg[SNIFFER_RING_REG][(i*8)+:8] <= axi_ctrl.wdata[(i*8)+:8];
+            end
+          end
+        SNIFFER_TAIL_REG: // Consumed bytes
+          for (int i = 0; i < (AXIL_DATA_BITS/8); i++) begin
+            if(axi_ctrl.wstrb[i]) begin
+              slv_reg[SNIFFER_TAIL_REG][(i*8)+:8] <= axi_ctrl.wdata[(i*8)+:8];
+            end
+          end
         default : ;
       endcase
     end
@@ -179,7 +203,7 @@ always_ff @(posedge aclk) begin
         SNIFFER_STATE_REG:
           axi_rdata[1:0] <= sniffer_state;
         SNIFFER_SIZE_REG:
-          axi_rdata[31:0] <= sniffer_size;
+          axi_rdata[63:0] <= sniffer_size;
         SNIFFER_TIMER_REG:
           axi_rdata[63:0] <= sniffer_timer;
         SNIFFER_VADDR_REG:
@@ -190,6 +214,14 @@ always_ff @(posedge aclk) begin
           axi_rdata[PID_BITS-1:0] <= slv_reg[SNIFFER_CTID_REG][PID_BITS-1:0];
         SNIFFER_DEST_REG:
           axi_rdata[DEST_BITS-1:0] <= slv_reg[SNIFFER_DEST_REG][DEST_BITS-1:0];
+        SNIFFER_RING_REG:
+          axi_rdata[0:0] <= slv_reg[SNIFFER_RING_REG][0:0];
+        SNIFFER_TAIL_REG:
+          axi_rdata[63:0] <= slv_reg[SNIFFER_TAIL_REG][63:0];
+        SNIFFER_HEAD_REG:
+          axi_rdata[63:0] <= sniffer_head;
+        SNIFFER_DROP_REG:
+          axi_rdata[31:0] <= sniffer_dropped;
         default: ;
       endcase
     end
@@ -205,6 +237,8 @@ always_comb begin
   sniffer_host_len     = slv_reg[SNIFFER_LEN_REG][LEN_BITS-1:0];
   sniffer_ctid         = slv_reg[SNIFFER_CTID_REG][PID_BITS-1:0];
   sniffer_host_dest    = slv_reg[SNIFFER_DEST_REG][DEST_BITS-1:0];
+  sniffer_ring         = slv_reg[SNIFFER_RING_REG][0:0];
+  sniffer_tail         = slv_reg[SNIFFER_TAIL_REG][63:0];
 end
 
 
@@ -28,16 +28,32 @@
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
-#include <sys/time.h>
+#include <cerrno>
+#include <climits>
+#include <stdexcept>
+#include <exception>
+#include <algorithm>
+#include <thread>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/uio.h>
 
 #include "include/conversion.hpp"
 
-struct filter_config {
-    bool ignore_udp_ipv4_payload;
-    bool ignore_udp_ipv6_payload;
-    bool ignore_tcp_ipv4_payload;
-    bool ignore_rocev2_ipv4_payload;
-} filter_cfg;
+// Binary raw files start with this magic, followed by the filter configuration and the captured data
+static const char RAW_MAGIC[8] = {'C', 'Y', 'T', 'S', 'N', 'I', 'F', '1'};
+
+// Packets are padded to the width of the data bus
+static constexpr uint64_t SLOT_SIZE = 64;
+
+// Records (two iovecs each) written per call
+static constexpr size_t RECORDS_PER_WRITE = IOV_MAX / 2;
+
+// Fewer packets are not worth another thread
+static constexpr size_t MIN_PACKETS_PER_WORKER = 4096;
+
+// Raw files are converted in pieces of this size
+static constexpr size_t RAW_CHUNK_SIZE = 16 * 1024 * 1024;
 
 // Definitions copied from pcap.h
 struct pcap_file_header {
@@ -49,130 +65,349 @@ struct pcap_file_header {
 	u_int snaplen;	/* max length saved portion of each pkt */
 	u_int linktype;	/* data link type (LINKTYPE_*) */
 };
-struct pcap_pkthdr {
-	struct timeval ts;	/* time stamp */
-	u_int caplen;	/* length of portion present */
-	u_int len;	/* length of this packet (off wire) */
-};
 
-void pcap_conversion(std::string raw, std::string pcap) {
-    FILE *raw_f = fopen(raw.c_str(), "r");
-    FILE *pcap_f = fopen(pcap.c_str(), "wb");
+static inline uint64_t slot_len(uint32_t caplen) { return (caplen - 1) / SLOT_SIZE * SLOT_SIZE + SLOT_SIZE; }
 
-    // Parsing filter configuration written at the very first of the raw file
-    uint64_t raw_filter_config = 0;
-    int err = fscanf(raw_f, "%lx", &raw_filter_config);
-    if (err == EOF) {
-        fprintf(stderr, "Error reading raw file!\n");
-        fclose(raw_f);
-        fclose(pcap_f);
-        return;
+static void write_all(int fd, const void *data, size_t len) {
+    const char *ptr = static_cast<const char *>(data);
+    while (len > 0) {
+        ssize_t n = write(fd, ptr, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            throw std::runtime_error("ERROR: Failed to write capture file: " + std::string(strerror(errno)));
+        }
+        ptr += n;
+        len -= n;
+    }
+}
+
+pcap_writer::pcap_writer(std::string pcap, uint64_t filter_config, unsigned workers) :
+    filter_config(filter_config), workers(workers) {
+    fd = open(pcap.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("ERROR: Failed to open " + pcap + ": " + std::string(strerror(errno)));
+    }
+
+    if (this->workers == 0) {
+        this->workers = std::max(1u, std::thread::hardware_concurrency());
     }
-    filter_cfg.ignore_udp_ipv4_payload = (raw_filter_config & (1ULL << 23)) ? true : false;
-    filter_cfg.ignore_udp_ipv6_payload = (raw_filter_config & (1ULL << 25)) ? true : false;
-    filter_cfg.ignore_tcp_ipv4_payload = (raw_filter_config & (1ULL << 27)) ? true : false;
-    filter_cfg.ignore_rocev2_ipv4_payload = (raw_filter_config & (1ULL << 31)) ? true : false;
 
     // Write PCAP Header
     struct pcap_file_header pcap_hdr = {0xa1b2c3d4, 2, 4, 0, 0, 65535, 1};
-    fwrite(&pcap_hdr, 1, 24, pcap_f);
+    write_all(fd, &pcap_hdr, 24);
+    file_offs = 24;
+}
 
-    // Read Output
-    char tmp[100];
-    unsigned char *buf = (unsigned char *)malloc(100 * 1024 * 1024); // 100M
-    int buf_len = 0;
-    while (fscanf(raw_f, "%s", tmp) != EOF) {
-        // We expect raw file to be padded to be multiples of 8 bytes
-        for (int i = 0; i < 8; ++i) {
-            err = fscanf(raw_f, "%hhx", (buf + (buf_len++))); // read one byte
-            if (err == EOF) {
-                fprintf(stderr, "Error reading raw file!\n");
-                free(buf);
-                fclose(raw_f);
-                fclose(pcap_f);
-                return;
+pcap_writer::~pcap_writer() {
+    if (!carry.empty()) {
+        fprintf(stderr, "Dropping %zu bytes of a truncated packet at the end of the capture\n", carry.size());
+    }
+    close(fd);
+}
+
+// Returns false if more than avail bytes are needed to tell the length of the packet
+bool pcap_writer::packet_length(const uint8_t *buf, uint64_t avail, uint32_t &caplen, uint32_t &len) const {
+    bool ignore_udp_ipv4_payload = (filter_config & (1ULL << 23)) ? true : false;
+    bool ignore_udp_ipv6_payload = (filter_config & (1ULL << 25)) ? true : false;
+    bool ignore_tcp_ipv4_payload = (filter_config & (1ULL << 27)) ? true : false;
+    bool ignore_rocev2_ipv4_payload = (filter_config & (1ULL << 31)) ? true : false;
+
+    // Every packet takes at least one slot
+    if (avail < SLOT_SIZE) {
+        return false;
+    }
+
+    caplen = 14; // eth frame header len
+    len = 14;
+    if (buf[12] == 0x86 && buf[13] == 0xdd) { // IPv6
+        if (ignore_udp_ipv6_payload && buf[20] == 0x11) { // ignore UDP payload
+            caplen += 40; // IPv6 header len
+            caplen += 8; // UDP header len
+        } else {
+            caplen += 40; // IPv6 header len
+            caplen += buf[18] * 256 + buf[19]; // IPv6 payload len
+            if (caplen < 64) caplen = 64; // possible padding
+        }
+        len += 40;
+        len += buf[18] * 256 + buf[19];
+        if (len < 64) len = 64;
+    } else if (buf[12] == 0x08 && buf[13] == 0x00) { // IPv4
+        if (ignore_udp_ipv4_payload && buf[23] == 0x11) { // ignore UDP payload
+            caplen += 20; // IPv4 header (min) len
+            caplen += 8; // UDP header len
+        } else if (ignore_tcp_ipv4_payload && buf[23] == 0x06) { // ignore TCP payload
+            caplen += 20; // IPv4 header (min) len
+            caplen += 20; // TCP header (min) len
+        } else if (ignore_rocev2_ipv4_payload && buf[23] == 0x11 && buf[36] == 0xb7 && buf[37] == 0x12) { // ignore RoCEv2 payload
+            caplen += 20; // IPv4 header (min) len
+            caplen += 8; // UDP header len
+            caplen += 12; // RoCEv2 header len
+            // determine roce optional header len
+            if (buf[42] == 0x10 || buf[42] == 0x0d || buf[42] == 0x0f || buf[42] == 0x11) {
+                // AETH
+                caplen += 4;
+            } else if (buf[42] == 0x0a || buf[42] == 0x06 || buf[42] == 0x0b || buf[42] == 0x0c) {
+                // RETH
+                caplen += 16;
+            }
+        } else {
+            caplen += buf[16] * 256 + buf[17]; // IPv4 total len
+            if (caplen < 64) caplen = 64; // possible padding
+        }
+        len += buf[16] * 256 + buf[17];
+        if (len < 64) len = 64;
+    } else { // Other 
+        if (buf[12] == 0x88 && buf[13] == 0xcc) { // LLDP
+            uint64_t cnt = 0;
+            while (true) {
+                if (16 + cnt > avail) {
+                    return false;
+                }
+                if (buf[14 + cnt] == 0x00 && buf[15 + cnt] == 0x00) {
+                    break;
+                }
+                int tlv_len = (buf[14 + cnt] * 256 + buf[15 + cnt]) & 0b111111111;
+                cnt += (tlv_len + 2);
             }
+            cnt += 2; // end of LLDPDU
+            caplen += cnt;
+            len += cnt;
+        } else if (buf[12] == 0x08 && buf[13] == 0x06) { // ARP
+            caplen += 28;
+            len += 28;
+        } else { // Assume IEEE 802.3 Ethernet Header
+            int eth_len = buf[12] * 256 + buf[13];
+            caplen += eth_len;
+            len += eth_len;
         }
     }
 
-    // Process packets
-    int n_packet = 0; // how many packets processed, we also use this as timestamp seconds
-    int n_bytes_read = 0; // how many bytes processed
-    struct pcap_pkthdr pkt_hdr;
-    while (n_bytes_read < buf_len) {
-        pkt_hdr.ts.tv_sec = n_packet;
-        pkt_hdr.ts.tv_usec = 0;
-        pkt_hdr.caplen = 14; // eth frame header len
-        pkt_hdr.len = 14;
-        if (buf[n_bytes_read + 12] == 0x86 && buf[n_bytes_read + 13] == 0xdd) { // IPv6
-            if (filter_cfg.ignore_udp_ipv6_payload && buf[n_bytes_read + 20] == 0x11) { // ignore UDP payload
-                pkt_hdr.caplen += 40; // IPv6 header len
-                pkt_hdr.caplen += 8; // UDP header len
-            } else {
-                pkt_hdr.caplen += 40; // IPv6 header len
-                pkt_hdr.caplen += buf[n_bytes_read + 18] * 256 + buf[n_bytes_read + 19]; // IPv6 payload len
-                if (pkt_hdr.caplen < 64) pkt_hdr.caplen = 64; // possible padding
+    return true;
+}
+
+void pcap_writer::write_range(const packet_desc *pkts, size_t n, uint64_t first_packet, uint64_t offs) const {
+    std::vector<pcap_record> records(std::min(n, RECORDS_PER_WRITE));
+    std::vector<struct iovec> iov(2 * records.size());
+
+    for (size_t done = 0; done < n; ) {
+        size_t cnt = std::min(n - done, RECORDS_PER_WRITE);
+        for (size_t i = 0; i < cnt; ++i) {
+            const packet_desc &p = pkts[done + i];
+
+            // Unknown types were taken as IEEE 802.3 length by packet_length
+            int eth_type = p.pkt[12] * 256 + p.pkt[13];
+            if (eth_type > 1500 && eth_type != 0x0800 && eth_type != 0x86dd && eth_type != 0x88cc && eth_type != 0x0806) {
+                // https://notes.networklessons.com/ethernet-frame-types
+                fprintf(stderr, "Unrecognized Ethernet Frame Type %04x!\n", eth_type);
             }
-            pkt_hdr.len += 40;
-            pkt_hdr.len += buf[n_bytes_read + 18] * 256 + buf[n_bytes_read + 19];
-            if (pkt_hdr.len < 64) pkt_hdr.len = 64;
-        } else if (buf[n_bytes_read + 12] == 0x08 && buf[n_bytes_read + 13] == 0x00) { // IPv4
-            if (filter_cfg.ignore_udp_ipv4_payload && buf[n_bytes_read + 23] == 0x11) { // ignore UDP payload
-                pkt_hdr.caplen += 20; // IPv4 header (min) len
-                pkt_hdr.caplen += 8; // UDP header len
-            } else if (filter_cfg.ignore_tcp_ipv4_payload && buf[n_bytes_read + 23] == 0x06) { // ignore TCP payload
-                pkt_hdr.caplen += 20; // IPv4 header (min) len
-                pkt_hdr.caplen += 20; // TCP header (min) len
-            } else if (filter_cfg.ignore_rocev2_ipv4_payload && buf[n_bytes_read + 23] == 0x11 && buf[n_bytes_read + 36] == 0xb7 && buf[n_bytes_read + 37] == 0x12) { // ignore RoCEv2 payload
-                pkt_hdr.caplen += 20; // IPv4 header (min) len
-                pkt_hdr.caplen += 8; // UDP header len
-                pkt_hdr.caplen += 12; // RoCEv2 header len
-                // determine roce optional header len
-                if (buf[n_bytes_read + 42] == 0x10 || buf[n_bytes_read + 42] == 0x0d || buf[n_bytes_read + 42] == 0x0f || buf[n_bytes_read + 42] == 0x11) {
-                    // AETH
-                    pkt_hdr.caplen += 4;
-                } else if (buf[n_bytes_read + 42] == 0x0a || buf[n_bytes_read + 42] == 0x06 || buf[n_bytes_read + 42] == 0x0b || buf[n_bytes_read + 42] == 0x0c) {
-                    // RETH
-                    pkt_hdr.caplen += 16;
-                }
-            } else {
-                pkt_hdr.caplen += buf[n_bytes_read + 16] * 256 + buf[n_bytes_read + 17]; // IPv4 total len
-                if (pkt_hdr.caplen < 64) pkt_hdr.caplen = 64; // possible padding
+
+            records[i] = {static_cast<uint32_t>(first_packet + done + i), 0, p.caplen, p.len};
+            iov[2 * i] = {&records[i], sizeof(pcap_record)};
+            iov[2 * i + 1] = {const_cast<uint8_t *>(p.pkt), p.caplen};
+        }
+
+        // Skip what was written, a short write may end within an iovec
+        size_t j = 0;
+        while (j < 2 * cnt) {
+            ssize_t w = pwritev(fd, iov.data() + j, 2 * cnt - j, offs);
+            if (w < 0) {
+                if (errno == EINTR) continue;
+                throw std::runtime_error("ERROR: Failed to write pcap file: " + std::string(strerror(errno)));
             }
-            pkt_hdr.len += buf[n_bytes_read + 16] * 256 + buf[n_bytes_read + 17];
-            if (pkt_hdr.len < 64) pkt_hdr.len = 64;
-        } else { // Other 
-            if (buf[n_bytes_read + 12] == 0x88 && buf[n_bytes_read + 13] == 0xcc) { // LLDP
-                int cnt = 0;
-                while (!(buf[n_bytes_read + 14 + cnt] == 0x00 && buf[n_bytes_read + 15 + cnt] == 0x00)) {
-                    int tlv_len = (buf[n_bytes_read + 14 + cnt] * 256 + buf[n_bytes_read + 15 + cnt]) & 0b111111111;
-                    cnt += (tlv_len + 2);
-                }
-                cnt += 2; // end of LLDPDU
-                pkt_hdr.caplen += cnt;
-                pkt_hdr.len += cnt;
-            } else if (buf[n_bytes_read + 12] == 0x08 && buf[n_bytes_read + 13] == 0x06) { // ARP
-                pkt_hdr.caplen += 28;
-                pkt_hdr.len += 28;
-            } else { // Assume IEEE 802.3 Ethernet Header
-                int eth_len = buf[n_bytes_read + 12] * 256 + buf[n_bytes_read + 13];
-                pkt_hdr.caplen += eth_len;
-                pkt_hdr.len += eth_len;
-                if (eth_len > 1500) {
-                    // https://notes.networklessons.com/ethernet-frame-types
-                    fprintf(stderr, "Unrecognized Ethernet Frame Type %04x!\n", eth_len);
+
+            offs += w;
+            while (w > 0) {
+                if (static_cast<size_t>(w) >= iov[j].iov_len) {
+                    w -= iov[j].iov_len;
+                    ++j;
+                } else {
+                    iov[j].iov_base = static_cast<char *>(iov[j].iov_base) + w;
+                    iov[j].iov_len -= w;
+                    w = 0;
                 }
             }
         }
-        // fprintf(stdout, "packet len %d\n", pkt_hdr.caplen);
-        fwrite(&pkt_hdr.ts, 1, 8, pcap_f);
-        fwrite(&pkt_hdr.caplen, 1, 4, pcap_f);
-        fwrite(&pkt_hdr.len, 1, 4, pcap_f);
-        fwrite(buf + n_bytes_read, 1, pkt_hdr.caplen, pcap_f);
-        ++n_packet;
-        n_bytes_read += ((pkt_hdr.caplen - 1) / 64 * 64 + 64);
+
+        done += cnt;
+    }
+}
+
+void pcap_writer::write_batch() {
+    size_t n = batch.size();
+    unsigned n_workers = std::max<size_t>(1, std::min<size_t>(workers, n / MIN_PACKETS_PER_WORKER));
+
+    // The file offset of each share is known from the packet lengths, so the shares are written in any order
+    std::vector<std::thread> threads;
+    std::vector<std::exception_ptr> errors(n_workers);
+    uint64_t offs = file_offs;
+    size_t begin = 0;
+    for (unsigned w = 0; w < n_workers; ++w) {
+        size_t end = n * (w + 1) / n_workers;
+        auto work = [this, begin, end, offs, &errors, w] {
+            try {
+                write_range(batch.data() + begin, end - begin, n_packet + begin, offs);
+            } catch (...) {
+                errors[w] = std::current_exception();
+            }
+        };
+
+        for (size_t i = begin; i < end; ++i) {
+            offs += sizeof(pcap_record) + batch[i].caplen;
+        }
+
+        // The last share is written by the calling thread
+        if (w + 1 < n_workers) {
+            threads.emplace_back(work);
+        } else {
+            work();
+        }
+        begin = end;
+    }
+
+    for (auto &t : threads) {
+        t.join();
+    }
+    for (auto &e : errors) {
+        if (e) std::rethrow_exception(e);
+    }
+
+    file_offs = offs;
+    n_packet += n;
+    batch.clear();
+}
+
+void pcap_writer::append(const uint8_t *data, uint64_t len) {
+    uint64_t offs = 0;
+    uint32_t caplen, wire_len;
+
+    // Complete the packet started in the previous piece
+    if (!carry.empty()) {
+        bool complete = false;
+        while (true) {
+            // Slots are a multiple of SLOT_SIZE, so up to the next multiple still belongs to the packet
+            uint64_t need = (carry.size() / SLOT_SIZE + 1) * SLOT_SIZE;
+            if (packet_length(carry.data(), carry.size(), caplen, wire_len)) {
+                need = slot_len(caplen);
+                complete = carry.size() >= need;
+            }
+            if (complete || offs == len) {
+                break;
+            }
+
+            uint64_t take = std::min(need - carry.size(), len - offs);
+            carry.insert(carry.end(), data + offs, data + offs + take);
+            offs += take;
+        }
+
+        // The whole piece belongs to the carried packet
+        if (!complete) {
+            return;
+        }
+        batch.push_back({carry.data(), caplen, wire_len});
+    }
+
+    // Find the packet boundaries; each length locates the next header, so this is a walk over the headers only
+    while (offs < len && packet_length(data + offs, len - offs, caplen, wire_len) && slot_len(caplen) <= len - offs) {
+        batch.push_back({data + offs, caplen, wire_len});
+        offs += slot_len(caplen);
+    }
+
+    // The batch points into data and the carry, so it is written before either changes
+    write_batch();
+    carry.assign(data + offs, data + len);
+}
+
+void write_raw_capture(std::string raw, uint64_t filter_config, const void *data, uint64_t len) {
+    int fd = open(raw.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("ERROR: Failed to open " + raw + ": " + std::string(strerror(errno)));
+    }
+
+    try {
+        write_all(fd, RAW_MAGIC, sizeof(RAW_MAGIC));
+        write_all(fd, &filter_config, sizeof(filter_config));
+        write_all(fd, data, len);
+    } catch (...) {
+        close(fd);
+        throw;
+    }
+    close(fd);
+}
+
+// Raw files of earlier versions: the filter configuration, then one line of 8 hex bytes per 8 captured bytes
+static void convert_text(FILE *raw_f, std::string pcap, unsigned workers) {
+    uint64_t raw_filter_config = 0;
+    if (fscanf(raw_f, "%lx", &raw_filter_config) != 1) {
+        fprintf(stderr, "Error reading raw file!\n");
+        return;
+    }
+
+    pcap_writer writer(pcap, raw_filter_config, workers);
+    std::vector<uint8_t> buf;
+    buf.reserve(RAW_CHUNK_SIZE);
+
+    char *line = NULL;
+    size_t line_cap = 0;
+    while (getline(&line, &line_cap, raw_f) != -1) {
+        // Skip the offset
+        char *ptr = strchr(line, ':');
+        if (!ptr) {
+            continue;
+        }
+        ++ptr;
+
+        // We expect raw file to be padded to be multiples of 8 bytes
+        for (int i = 0; i < 8; ++i) {
+            char *end;
+            unsigned long byte = strtoul(ptr, &end, 16);
+            if (end == ptr) {
+                fprintf(stderr, "Error reading raw file!\n");
+                free(line);
+                return;
+            }
+            buf.push_back(static_cast<uint8_t>(byte));
+            ptr = end;
+        }
+
+        if (buf.size() >= RAW_CHUNK_SIZE) {
+            writer.append(buf.data(), buf.size());
+            buf.clear();
+        }
+    }
+    free(line);
+
+    writer.append(buf.data(), buf.size());
+}
+
+void pcap_conversion(std::string raw, std::string pcap, unsigned workers) {
+    FILE *raw_f = fopen(raw.c_str(), "rb");
+    if (!raw_f) {
+        fprintf(stderr, "Error opening raw file %s!\n", raw.c_str());
+        return;
+    }
+
+    char magic[sizeof(RAW_MAGIC)];
+    if (fread(magic, 1, sizeof(magic), raw_f) != sizeof(magic) || memcmp(magic, RAW_MAGIC, sizeof(magic))) {
+        rewind(raw_f);
+        convert_text(raw_f, pcap, workers);
+        fclose(raw_f);
+        return;
+    }
+
+    // Parsing filter configuration written right after the magic
+    uint64_t raw_filter_config = 0;
+    if (fread(&raw_filter_config, 1, sizeof(raw_filter_config), raw_f) != sizeof(raw_filter_config)) {
+        fprintf(stderr, "Error reading raw file!\n");
+        fclose(raw_f);
+        return;
+    }
+
+    pcap_writer writer(pcap, raw_filter_config, workers);
+    std::vector<uint8_t> buf(RAW_CHUNK_SIZE);
+    size_t n;
+    while ((n = fread(buf.data(), 1, buf.size(), raw_f)) > 0) {
+        writer.append(buf.data(), n);
     }
 
     fclose(raw_f);
-    fclose(pcap_f);
-}
\ No newline at end of file
+}
@@ -28,10 +28,71 @@
 #define CONVERSION_H
 
 #include <string>
+#include <vector>
+#include <cstdint>
 
-/// @brief Convert raw captured data to pcap file
+/// Record header of a packet in a pcap file
+struct pcap_record {
+    uint32_t ts_sec;
+    uint32_t ts_usec;
+    uint32_t caplen;    /* length of portion present */
+    uint32_t len;       /* length of this packet (off wire) */
+};
+
+/// @brief Streaming pcap writer for data captured by the sniffer
+///
+/// Captured data is a sequence of packets, each padded to a multiple of 64 bytes. It can be appended in
+/// arbitrary pieces (e.g. one ring segment at a time); a packet spanning two pieces is stitched together.
+/// The packet boundaries of a piece are found in a single pass; the packets are then split among the
+/// worker threads, each writing its share with pwritev at the file offset it ends up at.
+class pcap_writer {
+public:
+    /// @brief Creates the pcap file and writes its header
+    /// @param pcap filename of pcap file to be created
+    /// @param filter_config filter configuration the data was captured with
+    /// @param workers threads writing the packets; 0 uses all cores
+    pcap_writer(std::string pcap, uint64_t filter_config, unsigned workers = 0);
+    ~pcap_writer();
+
+    /// @brief Writes the packets of the next piece of captured data; the data can be reused once this returns
+    void append(const uint8_t *data, uint64_t len);
+
+    /// @brief Number of packets written so far
+    uint64_t packets() const { return n_packet; }
+
+private:
+    /// A packet found in the captured data
+    struct packet_desc {
+        const uint8_t *pkt;
+        uint32_t caplen;
+        uint32_t len;
+    };
+
+    int fd;
+    uint64_t filter_config;
+    unsigned workers;
+    uint64_t n_packet = 0;      // also used as timestamp seconds
+    uint64_t file_offs = 0;     // end of the pcap file
+
+    std::vector<packet_desc> batch;
+    std::vector<uint8_t> carry; // start of a packet from the previous piece
+
+    bool packet_length(const uint8_t *buf, uint64_t avail, uint32_t &caplen, uint32_t &len) const;
+    void write_batch();
+    void write_range(const packet_desc *pkts, size_t n, uint64_t first_packet, uint64_t offs) const;
+};
+
+/// @brief Write captured data to a binary raw file, which can later be converted with pcap_conversion
 /// @param raw filename of raw captured data
+/// @param filter_config filter configuration the data was captured with
+/// @param data captured data
+/// @param len bytes of captured data
+void write_raw_capture(std::string raw, uint64_t filter_config, const void *data, uint64_t len);
+
+/// @brief Convert raw captured data to pcap file
+/// @param raw filename of raw captured data, binary or in the hex-text format of earlier versions
 /// @param pcap filename of pcap file to be created
-void pcap_conversion(std::string raw, std::string pcap);
+/// @param workers threads writing the packets; 0 uses all cores
+void pcap_conversion(std::string raw, std::string pcap, unsigned workers = 0);
 
-#endif
\ No newline at end of file
+#endif
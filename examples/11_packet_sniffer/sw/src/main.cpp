@@ -26,6 +26,11 @@
 
 #include <iostream>
 #include <cstdio>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <memory>
+#include <sys/mman.h>
 #include <boost/program_options.hpp>
 
 #include <coyote/cThread.hpp>
@@ -36,6 +41,8 @@ constexpr auto const defDevice = 0;
 constexpr auto const defTargetVfid = 0;
 constexpr auto const defHostMemPages = 8;
 constexpr auto const defFilterConfig = 0;
+constexpr auto const defRingMode = false;
+constexpr auto const defWorkers = 0;
 
 enum class SnifferCSRs : uint32_t {
     CTRL_0 = 0, // to start sniffing
@@ -47,7 +54,11 @@ enum class SnifferCSRs : uint32_t {
     HOST_VADDR = 6,
     HOST_LEN = 7,
     SNIFFER_CTID = 8,
-    HOST_DEST = 9
+    HOST_DEST = 9,
+    RING = 10, // to wrap around the buffer while the host consumes it
+    RING_TAIL = 11,
+    RING_HEAD = 12,
+    RING_DROPPED = 13
 };
 
 enum class SnifferState : uint8_t {
@@ -66,7 +77,49 @@ void getAllCSRs(coyote::cThread &t) {
               << "HOST_VADDR:    " << t.getCSR(static_cast<uint32_t>(SnifferCSRs::HOST_VADDR)) << std::endl
               << "HOST_LEN:      " << t.getCSR(static_cast<uint32_t>(SnifferCSRs::HOST_LEN)) << std::endl
               << "SNIFFER_CTID:  " << t.getCSR(static_cast<uint32_t>(SnifferCSRs::SNIFFER_CTID)) << std::endl
-              << "HOST_DEST:     " << t.getCSR(static_cast<uint32_t>(SnifferCSRs::HOST_DEST)) << std::endl;
+              << "HOST_DEST:     " << t.getCSR(static_cast<uint32_t>(SnifferCSRs::HOST_DEST)) << std::endl
+              << "RING:          " << t.getCSR(static_cast<uint32_t>(SnifferCSRs::RING)) << std::endl
+              << "RING_TAIL:     " << t.getCSR(static_cast<uint32_t>(SnifferCSRs::RING_TAIL)) << std::endl
+              << "RING_HEAD:     " << t.getCSR(static_cast<uint32_t>(SnifferCSRs::RING_HEAD)) << std::endl
+              << "RING_DROPPED:  " << t.getCSR(static_cast<uint32_t>(SnifferCSRs::RING_DROPPED)) << std::endl;
+}
+
+// Ring mode: passes the captured data to the pcap writer one huge page (segment) at a time, while sniffing.
+// A segment is synced back from card memory once the vFPGA filled it, and handed back to the vFPGA through
+// RING_TAIL once it was written out.
+void drainRing(coyote::cThread &t, uint8_t *ring, uint64_t ring_len, pcap_writer &writer, std::atomic<bool> &stopped) {
+    uint64_t tail = 0;
+    try {
+        while (true) {
+            // Read before the head, so that the final head is seen once the sniffer stopped
+            bool last = stopped.load();
+            uint64_t head = t.getCSR(static_cast<uint32_t>(SnifferCSRs::RING_HEAD));
+
+            // The last request is padded, only the captured size is valid
+            uint64_t valid = last ? t.getCSR(static_cast<uint32_t>(SnifferCSRs::SNIFFER_SIZE)) : head;
+
+            if (head - tail < coyote::HUGE_PAGE_SIZE && !(last && head > tail)) {
+                if (last) break;
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+                continue;
+            }
+
+            uint8_t *seg = ring + tail % ring_len;
+            coyote::syncSg seg_sg = { .addr = seg, .len = coyote::HUGE_PAGE_SIZE };
+            t.invoke(coyote::CoyoteOper::LOCAL_SYNC, seg_sg);
+            writer.append(seg, std::min<uint64_t>(coyote::HUGE_PAGE_SIZE, valid > tail ? valid - tail : 0));
+
+            // Only read on the host, so the copy still on the card is re-used
+            seg_sg.host_unchanged = true;
+            t.invoke(coyote::CoyoteOper::LOCAL_OFFLOAD, seg_sg);
+
+            tail += coyote::HUGE_PAGE_SIZE;
+            t.setCSR(tail, static_cast<uint32_t>(SnifferCSRs::RING_TAIL));
+        }
+    } catch (const std::exception &e) {
+        // The sniffer drops packets once the ring is full
+        fprintf(stderr, "Draining the ring failed: %s\n", e.what());
+    }
 }
 
 int main(int argc, char *argv[]) {
@@ -93,7 +146,9 @@ int main(int argc, char *argv[]) {
         ("no-roce-payload-v4", boost::program_options::value<bool>(), "Ignore RoCEv2 Payload on IPv4")
         ("raw-filename,r", boost::program_options::value<std::string>(), "Filename to save raw captured data")
         ("pcap-filename,p", boost::program_options::value<std::string>(), "Filename to save converted pcap data")
-        ("conversion-only,c", boost::program_options::value<bool>(), "Only convert previously captured data");
+        ("conversion-only,c", boost::program_options::value<bool>(), "Only convert previously captured data")
+        ("ring,g", boost::program_options::value<bool>(), "Stream the capture to the pcap file while sniffing")
+        ("workers,w", boost::program_options::value<uint32_t>(), "Threads writing the pcap file (0: all cores)");
     
     boost::program_options::variables_map commandLineArgs;
     boost::program_options::store(boost::program_options::parse_command_line(argc, argv, programDescription), commandLineArgs);
@@ -106,6 +161,8 @@ int main(int argc, char *argv[]) {
     std::string raw_file = "capture.txt";
     std::string pcap_file = "capture.pcap";
     bool conversion_only = false;
+    bool ring_mode = defRingMode;
+    uint32_t workers = defWorkers;
 
     if (commandLineArgs.count("raw-filename") > 0) raw_file = commandLineArgs["raw-filename"].as<std::string>();
     if (commandLineArgs.count("pcap-filename") > 0) pcap_file = commandLineArgs["pcap-filename"].as<std::string>();
@@ -129,6 +186,8 @@ int main(int argc, char *argv[]) {
     if (commandLineArgs.count("no-roce-payload-v4") > 0) filter_config |= (1ULL << 31);
 
     if (commandLineArgs.count("conversion-only") > 0) conversion_only = true;
+    if (commandLineArgs.count("ring") > 0) ring_mode = commandLineArgs["ring"].as<bool>();
+    if (commandLineArgs.count("workers") > 0) workers = commandLineArgs["workers"].as<uint32_t>();
 
     HEADER("PARAMS");
     if (conversion_only) {
@@ -140,12 +199,13 @@ int main(int argc, char *argv[]) {
         printf("Target vFPGA ID: %d\n", target_vfid);
         printf("Number of Mmeory Pages: %d\n", host_mem_pages);
         printf("Filter Config: %lx\n", filter_config);
-        printf("Raw captured data file: %s\n", raw_file.c_str());
+        printf("Ring Mode: %d\n", ring_mode);
+        if (!ring_mode) printf("Raw captured data file: %s\n", raw_file.c_str());
         printf("PCAP file: %s\n", pcap_file.c_str());
     }
 
     if (conversion_only) {
-        pcap_conversion(raw_file, pcap_file);
+        pcap_conversion(raw_file, pcap_file, workers);
         return 0;
     }
 
@@ -156,15 +216,34 @@ int main(int argc, char *argv[]) {
 
     // vfpga handler and mem alloc
     coyote::cThread cthread(target_vfid, getpid(), cs_device);
-    void *hMem = cthread.getMem({coyote::CoyoteAllocType::HPF, (uint32_t)coyote::HUGE_PAGE_SIZE * host_mem_pages});
-    memset(hMem, 0, coyote::HUGE_PAGE_SIZE * host_mem_pages);
-    // offload memory to card for buffering captured packets
-    coyote::syncSg hmem_sg = { .addr = (void *)((uintptr_t)hMem), .len = coyote::HUGE_PAGE_SIZE * host_mem_pages };
-    cthread.invoke(coyote::CoyoteOper::LOCAL_OFFLOAD, hmem_sg);
+    uint64_t host_mem_size = coyote::HUGE_PAGE_SIZE * host_mem_pages;
+    void *hMem;
+    coyote::syncSg hmem_sg = { .addr = nullptr, .len = host_mem_size };
+    if (ring_mode) {
+        // Every huge page is mapped on its own, so that the ring segments can be synced back one at a time
+        hMem = mmap(NULL, host_mem_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (hMem == MAP_FAILED) {
+            fprintf(stderr, "Failed to allocate huge pages for the ring!\n");
+            return EXIT_FAILURE;
+        }
+        memset(hMem, 0, host_mem_size);
+        for (uint32_t i = 0; i < host_mem_pages; ++i) {
+            coyote::syncSg seg_sg = { .addr = (void *)((uintptr_t)hMem + i * coyote::HUGE_PAGE_SIZE), .len = coyote::HUGE_PAGE_SIZE };
+            cthread.userMap(seg_sg.addr, seg_sg.len);
+            cthread.invoke(coyote::CoyoteOper::LOCAL_OFFLOAD, seg_sg);
+        }
+    } else {
+        hMem = cthread.getMem({coyote::CoyoteAllocType::HPF, (uint32_t)host_mem_size});
+        memset(hMem, 0, host_mem_size);
+        // offload memory to card for buffering captured packets
+        hmem_sg.addr = hMem;
+        cthread.invoke(coyote::CoyoteOper::LOCAL_OFFLOAD, hmem_sg);
+    }
 
     // Reset CSRs
     cthread.setCSR(0, static_cast<uint32_t>(SnifferCSRs::CTRL_0));
     cthread.setCSR(0, static_cast<uint32_t>(SnifferCSRs::CTRL_1));
+    cthread.setCSR(0, static_cast<uint32_t>(SnifferCSRs::RING_TAIL));
 
     HEADER("STARTUP CHECK");
     getAllCSRs(cthread);
@@ -173,9 +252,10 @@ int main(int argc, char *argv[]) {
     // Set Memory Address
     // ---------------------------------------------------------------
     cthread.setCSR(reinterpret_cast<uint64_t>(hMem), static_cast<uint32_t>(SnifferCSRs::HOST_VADDR));
-    cthread.setCSR(coyote::HUGE_PAGE_SIZE * host_mem_pages, static_cast<uint32_t>(SnifferCSRs::HOST_LEN));
+    cthread.setCSR(host_mem_size, static_cast<uint32_t>(SnifferCSRs::HOST_LEN));
     cthread.setCSR(cthread.getCtid(), static_cast<uint32_t>(SnifferCSRs::SNIFFER_CTID));
     cthread.setCSR(0, static_cast<uint32_t>(SnifferCSRs::HOST_DEST));
+    cthread.setCSR(ring_mode, static_cast<uint32_t>(SnifferCSRs::RING));
     cthread.setCSR(1, static_cast<uint32_t>(SnifferCSRs::CTRL_1)); // Use this CSR to indicate memory info ready
 
     HEADER("MEMORY SET");
@@ -210,6 +290,16 @@ int main(int argc, char *argv[]) {
     HEADER("SNIFFER STARTED");
     getAllCSRs(cthread);
 
+    // In ring mode, the capture is written out while sniffing
+    std::atomic<bool> stopped(false);
+    std::unique_ptr<pcap_writer> ring_writer;
+    std::thread ring_drainer;
+    if (ring_mode) {
+        ring_writer.reset(new pcap_writer(pcap_file, filter_config, workers));
+        ring_drainer = std::thread(drainRing, std::ref(cthread), static_cast<uint8_t *>(hMem), host_mem_size,
+                                   std::ref(*ring_writer), std::ref(stopped));
+    }
+
     // ---------------------------------------------------------------
     // Stop Sniffer
     // ---------------------------------------------------------------
@@ -238,37 +328,47 @@ int main(int argc, char *argv[]) {
     HEADER("SNIFFER STOPPED");
     getAllCSRs(cthread);
 
-    // ---------------------------------------------------------------
-    // Sync Back Memory
-    // ---------------------------------------------------------------
-    sleep(1); // Do we need this?
-    cthread.invoke(coyote::CoyoteOper::LOCAL_SYNC, hmem_sg);
-
-    // Save raw data into a file
-    HEADER("SAVING DATA");
-    uint32_t captured_sz = static_cast<uint32_t>(cthread.getCSR(static_cast<uint32_t>(SnifferCSRs::SNIFFER_SIZE)));
-    printf("Captured size: %u Bytes\n", captured_sz);
-    printf("Total Memory size: %llu Bytes\n", coyote::HUGE_PAGE_SIZE * host_mem_pages);
-    FILE *raw_f = fopen(raw_file.c_str(), "w");
-    fprintf(raw_f, "%lx\n", filter_config);
-    for (uint32_t i = 0; i * 8 < captured_sz && i * 8 < coyote::HUGE_PAGE_SIZE * host_mem_pages; ++i) {
-    // for (uint32_t i = 0; i * 8 < 128; ++i) {
-        uint64_t *ptr = ((uint64_t *)hMem) + i;
-        uint8_t *ptr_u8 = (uint8_t *)ptr;
-        fprintf(raw_f, "%08x: ", i * 8);
-        fprintf(raw_f, "%02x %02x %02x %02x %02x %02x %02x %02x\n",
-                *(ptr_u8 + 0), *(ptr_u8 + 1), *(ptr_u8 + 2), *(ptr_u8 + 3), 
-                *(ptr_u8 + 4), *(ptr_u8 + 5), *(ptr_u8 + 6), *(ptr_u8 + 7));
-    }
-    fclose(raw_f);
+    uint64_t captured_sz = cthread.getCSR(static_cast<uint32_t>(SnifferCSRs::SNIFFER_SIZE));
+    if (ring_mode) {
+        // Write out what is left in the ring
+        HEADER("DRAINING RING");
+        stopped = true;
+        ring_drainer.join();
+        printf("Captured size: %lu Bytes\n", captured_sz);
+        printf("Packets written: %lu\n", ring_writer->packets());
+        printf("Packets dropped (ring full): %lu\n", cthread.getCSR(static_cast<uint32_t>(SnifferCSRs::RING_DROPPED)));
+        ring_writer.reset();
+    } else {
+        // ---------------------------------------------------------------
+        // Sync Back Memory
+        // ---------------------------------------------------------------
+        sleep(1); // Do we need this?
+        cthread.invoke(coyote::CoyoteOper::LOCAL_SYNC, hmem_sg);
+
+        // Save raw data into a file
+        HEADER("SAVING DATA");
+        printf("Captured size: %lu Bytes\n", captured_sz);
+        printf("Total Memory size: %lu Bytes\n", host_mem_size);
+        if (captured_sz > host_mem_size) captured_sz = host_mem_size;
+        write_raw_capture(raw_file, filter_config, hMem, captured_sz);
 
-    // Convert raw file to PCAP
-    pcap_conversion(raw_file, pcap_file);
+        // Convert to PCAP, straight from memory
+        pcap_writer writer(pcap_file, filter_config, workers);
+        writer.append(static_cast<uint8_t *>(hMem), captured_sz);
+    }
 
     HEADER("CLEAN UP");
     // Cleanup CSRs
     cthread.setCSR(0, static_cast<uint32_t>(SnifferCSRs::CTRL_0));
     cthread.setCSR(0, static_cast<uint32_t>(SnifferCSRs::CTRL_1));
+    cthread.setCSR(0, static_cast<uint32_t>(SnifferCSRs::RING));
+
+    if (ring_mode) {
+        for (uint32_t i = 0; i < host_mem_pages; ++i) {
+            cthread.userUnmap((void *)((uintptr_t)hMem + i * coyote::HUGE_PAGE_SIZE));
+        }
+        munmap(hMem, host_mem_size);
+    }
 
     return 0;
 }
@@ -10,6 +10,8 @@
 
 #include "mmio_handler.hpp"
 #include "shmem.hpp"
+#include "doorbell.hpp"
+#include "vm_daemon.hpp"
 
 // Constants
 #define CLOCK_PERIOD_NS 4
@@ -32,6 +34,28 @@ void run_bench( coyote::cThread &coyote_thread)
 
 int main(int argc, char *argv[])
 {
+    // CLI arguments
+    doorbell_config doorbell;
+    vm_daemon_config daemon;
+    boost::program_options::options_description opts("Jigsaw Baseline Options");
+    doorbell_add_options(opts, doorbell);
+    vm_daemon_add_options(opts, daemon);
+
+    boost::program_options::variables_map vm;
+    boost::program_options::store(
+        boost::program_options::parse_command_line(argc, argv, opts), vm);
+    boost::program_options::notify(vm);
+
+    if (doorbell_init(doorbell) != 0) {
+        return EXIT_FAILURE;
+    }
+
+    // Several guests: serve all of them from one daemon (vm_daemon.hpp)
+    if (!daemon.vms.empty()) {
+        HEADER("JIGSAW BASELINE, MULTI-VM");
+        return run_vm_daemon(daemon, doorbell);
+    }
+
     // Create Coyote thread and allocate memory for the transfer
     void *shmem = init_shared_memory();
     if (!shmem) {
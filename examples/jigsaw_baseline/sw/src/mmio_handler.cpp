@@ -4,52 +4,65 @@
 #include <cstdint>
 #include <cstdio>
 
+// Registers only the driver writes are shadowed, so the driver reading back what it just
+// wrote costs no PCIe round trip. Not shadowed, since the vFPGA updates them: DMA_CMD_REG
+// (self-clearing start bit), DMA_STATUS_REG, START_COMPUTATION_REG (self-clearing) and
+// COYOTE_DMA_TX_LEN_REG.
+coyote::csrWindow jigsaw_map_regs(coyote::cThread &coyote_thread)
+{
+    coyote::csrWindow window = coyote_thread.mapCSRs(0, N_JIGSAW_REGS);
+    for (JigsawRegisters reg : {JigsawRegisters::DMA_SRC_ADDR_REG, JigsawRegisters::DMA_DST_ADDR_REG,
+                                JigsawRegisters::DMA_H2D_LEN_REG, JigsawRegisters::DMA_D2H_LEN_REG,
+                                JigsawRegisters::CYCLES_PER_COMPUTATION_REG, JigsawRegisters::COYOTE_PID_REG}) {
+        window.setHostOwned(static_cast<uint32_t>(reg));
+    }
+    return window;
+}
+
+// Direct view of the register file, mapped on first use; the single-VM daemon drives a single cThread
+static coyote::csrWindow &jigsaw_regs(coyote::cThread &coyote_thread)
+{
+    static coyote::csrWindow regs = jigsaw_map_regs(coyote_thread);
+    return regs;
+}
+
+// Value forwarded for a guest write; the guest cannot know the Coyote thread ID, so COYOTE_PID_REG always gets ours
+static uint64_t edu_write_value(coyote::cThread &coyote_thread, uint32_t reg, uint64_t val)
+{
+    if (reg == static_cast<uint32_t>(JigsawRegisters::COYOTE_PID_REG)) {
+        return coyote_thread.getCtid();
+    }
+    return val;
+}
+
 void edu_mmio_read(coyote::cThread &coyote_thread, char *data, uint64_t offset)
+{
+    edu_mmio_read(coyote_thread, jigsaw_regs(coyote_thread), data, offset);
+}
+
+void edu_mmio_write(coyote::cThread &coyote_thread, char *data, uint64_t offset)
+{
+    edu_mmio_write(coyote_thread, jigsaw_regs(coyote_thread), data, offset);
+}
+
+void edu_mmio_write_batch(coyote::cThread &coyote_thread, const std::vector<std::pair<uint64_t, uint64_t>> &writes)
+{
+    edu_mmio_write_batch(coyote_thread, jigsaw_regs(coyote_thread), writes);
+}
+
+void edu_mmio_read(coyote::cThread &coyote_thread, coyote::csrWindow &regs, char *data, uint64_t offset)
 {
     uint32_t reg = offset / sizeof(uint64_t);
-    uint64_t val = 0;
-
-    switch (reg) {
-        case static_cast<uint32_t>(JigsawRegisters::DMA_CMD_REG):
-            val = coyote_thread.getCSR(static_cast<uint32_t>(JigsawRegisters::DMA_CMD_REG));
-            break;
-        case static_cast<uint32_t>(JigsawRegisters::DMA_SRC_ADDR_REG):
-            val = coyote_thread.getCSR(static_cast<uint32_t>(JigsawRegisters::DMA_SRC_ADDR_REG));
-            break;
-        case static_cast<uint32_t>(JigsawRegisters::DMA_DST_ADDR_REG):
-            val = coyote_thread.getCSR(static_cast<uint32_t>(JigsawRegisters::DMA_DST_ADDR_REG));
-            break;
-        case static_cast<uint32_t>(JigsawRegisters::DMA_H2D_LEN_REG):
-            val = coyote_thread.getCSR(static_cast<uint32_t>(JigsawRegisters::DMA_H2D_LEN_REG));
-            break;
-        case static_cast<uint32_t>(JigsawRegisters::DMA_STATUS_REG):
-            val = coyote_thread.getCSR(static_cast<uint32_t>(JigsawRegisters::DMA_STATUS_REG));
-            break;
-        case static_cast<uint32_t>(JigsawRegisters::START_COMPUTATION_REG):
-            val = coyote_thread.getCSR(static_cast<uint32_t>(JigsawRegisters::START_COMPUTATION_REG));
-            break;
-        case static_cast<uint32_t>(JigsawRegisters::CYCLES_PER_COMPUTATION_REG):
-            val = coyote_thread.getCSR(static_cast<uint32_t>(JigsawRegisters::CYCLES_PER_COMPUTATION_REG));
-            break;
-        case static_cast<uint32_t>(JigsawRegisters::COYOTE_PID_REG):
-            val = coyote_thread.getCSR(static_cast<uint32_t>(JigsawRegisters::COYOTE_PID_REG));
-            break;
-        case static_cast<uint32_t>(JigsawRegisters::COYOTE_DMA_TX_LEN_REG):
-            val = coyote_thread.getCSR(static_cast<uint32_t>(JigsawRegisters::COYOTE_DMA_TX_LEN_REG));
-            break;
-        case static_cast<uint32_t>(JigsawRegisters::DMA_D2H_LEN_REG):
-            val = coyote_thread.getCSR(static_cast<uint32_t>(JigsawRegisters::DMA_D2H_LEN_REG));
-            break;
-        default:
-            break;
-    }
+
+    // Registers outside of the register file read as 0
+    uint64_t val = reg < N_JIGSAW_REGS ? regs.get(reg) : 0;
 
     // std::printf("edu_mmio_read offset 0x%lx -> csr %u, got value 0x%lx\n", offset, reg, val);
 
     std::memcpy(data, &val, sizeof(val));
 }
 
-void edu_mmio_write(coyote::cThread &coyote_thread, char *data, uint64_t offset)
+void edu_mmio_write(coyote::cThread &coyote_thread, coyote::csrWindow &regs, char *data, uint64_t offset)
 {
     uint32_t reg = offset / sizeof(uint64_t);
     
@@ -58,38 +71,23 @@ void edu_mmio_write(coyote::cThread &coyote_thread, char *data, uint64_t offset)
 
     // std::printf("edu_mmio_write offset 0x%lx -> csr %u, val: 0x%lx\n", offset, reg, val);
 
-    switch (reg) {
-        case static_cast<uint32_t>(JigsawRegisters::DMA_CMD_REG):
-            coyote_thread.setCSR(val, static_cast<uint32_t>(JigsawRegisters::DMA_CMD_REG));
-            break;
-        case static_cast<uint32_t>(JigsawRegisters::DMA_SRC_ADDR_REG):
-            coyote_thread.setCSR(val, static_cast<uint32_t>(JigsawRegisters::DMA_SRC_ADDR_REG));
-            break;
-        case static_cast<uint32_t>(JigsawRegisters::DMA_DST_ADDR_REG):
-            coyote_thread.setCSR(val, static_cast<uint32_t>(JigsawRegisters::DMA_DST_ADDR_REG));
-            break;
-        case static_cast<uint32_t>(JigsawRegisters::DMA_H2D_LEN_REG):
-            coyote_thread.setCSR(val, static_cast<uint32_t>(JigsawRegisters::DMA_H2D_LEN_REG));
-            break;
-        case static_cast<uint32_t>(JigsawRegisters::DMA_STATUS_REG):
-            coyote_thread.setCSR(val, static_cast<uint32_t>(JigsawRegisters::DMA_STATUS_REG));
-            break;
-        case static_cast<uint32_t>(JigsawRegisters::START_COMPUTATION_REG):
-            coyote_thread.setCSR(val, static_cast<uint32_t>(JigsawRegisters::START_COMPUTATION_REG));
-            break;
-        case static_cast<uint32_t>(JigsawRegisters::CYCLES_PER_COMPUTATION_REG):
-            coyote_thread.setCSR(val, static_cast<uint32_t>(JigsawRegisters::CYCLES_PER_COMPUTATION_REG));
-            break;
-        case static_cast<uint32_t>(JigsawRegisters::COYOTE_PID_REG):
-            coyote_thread.setCSR(coyote_thread.getCtid(), static_cast<uint32_t>(JigsawRegisters::COYOTE_PID_REG));
-            break;
-        case static_cast<uint32_t>(JigsawRegisters::COYOTE_DMA_TX_LEN_REG):
-            coyote_thread.setCSR(val, static_cast<uint32_t>(JigsawRegisters::COYOTE_DMA_TX_LEN_REG));
-            break;
-        case static_cast<uint32_t>(JigsawRegisters::DMA_D2H_LEN_REG):
-            coyote_thread.setCSR(val, static_cast<uint32_t>(JigsawRegisters::DMA_D2H_LEN_REG));
-            break;
-        default:
-            break;
+    // Writes outside of the register file are dropped
+    if (reg < N_JIGSAW_REGS) {
+        regs.set(reg, edu_write_value(coyote_thread, reg, val));
     }
 }
+
+void edu_mmio_write_batch(coyote::cThread &coyote_thread, coyote::csrWindow &regs, const std::vector<std::pair<uint64_t, uint64_t>> &writes)
+{
+    std::vector<std::pair<uint32_t, uint64_t>> csrs;
+    csrs.reserve(writes.size());
+
+    for (const auto &write : writes) {
+        uint32_t reg = write.first / sizeof(uint64_t);
+        if (reg < N_JIGSAW_REGS) {
+            csrs.emplace_back(reg, edu_write_value(coyote_thread, reg, write.second));
+        }
+    }
+
+    regs.set(csrs);
+}
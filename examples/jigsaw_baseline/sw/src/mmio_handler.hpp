@@ -2,6 +2,8 @@
 #define MMIO_HANDLER_HPP
 
 #include <cstdint>
+#include <utility>
+#include <vector>
 
 #include <coyote/cThread.hpp>
 
@@ -19,7 +21,21 @@ enum class JigsawRegisters: uint32_t {
     COYOTE_PID_REG = 9
 };
 
+// Size of the register file; the guest's BAR maps it 1:1 (register = BAR offset / 8)
+constexpr uint32_t N_JIGSAW_REGS = 10;
+
 void edu_mmio_write(coyote::cThread &coyote_thread, char *data, uint64_t offset);
 void edu_mmio_read(coyote::cThread &coyote_thread, char *data, uint64_t offset);
 
+// Forwards posted guest writes, given as (BAR offset, value), in order with as few PCIe writes as possible
+void edu_mmio_write_batch(coyote::cThread &coyote_thread, const std::vector<std::pair<uint64_t, uint64_t>> &writes);
+
+// Register file of the cThread's vFPGA, with the registers only the driver writes shadowed
+coyote::csrWindow jigsaw_map_regs(coyote::cThread &coyote_thread);
+
+// Same as above, on a given register file; the single-VM daemon uses the one of its only cThread
+void edu_mmio_write(coyote::cThread &coyote_thread, coyote::csrWindow &regs, char *data, uint64_t offset);
+void edu_mmio_read(coyote::cThread &coyote_thread, coyote::csrWindow &regs, char *data, uint64_t offset);
+void edu_mmio_write_batch(coyote::cThread &coyote_thread, coyote::csrWindow &regs, const std::vector<std::pair<uint64_t, uint64_t>> &writes);
+
 #endif // MMIO_HANDERL_HPP
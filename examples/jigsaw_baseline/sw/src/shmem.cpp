@@ -11,17 +11,23 @@
 #include <cstdint>
 
 #include "shmem.hpp"
+#include "doorbell.hpp"
+#include "mmio_ring.hpp"
 #include "mmio_handler.hpp"
 
 #include <coyote/cThread.hpp>
 
+static_assert(MMIO_RING_OFFSET + sizeof(struct mmio_ring) <= DMA_REGION_OFFSET,
+              "MMIO ring must fit below the DMA region");
+
 static void *shmem = NULL;
 static volatile uint8_t *read_doorbell = NULL;
 static volatile uint8_t *write_doorbell = NULL;
 
-static int create_or_open_shmem_file()
+static int create_or_open_shmem_file(const char *path)
 {
-    int fd = open(SHMEM_FILE, O_RDWR | O_CREAT, 0666);
+    // With irq doorbells the region is the one handed out by ivshmem-server
+    int fd = doorbell_shm_fd() >= 0 ? dup(doorbell_shm_fd()) : open(path, O_RDWR | O_CREAT, 0666);
     if (fd < 0) {
         perror("Failed to open or create shared memory file");
         return -1;
@@ -48,50 +54,69 @@ static int create_or_open_shmem_file()
     return fd;
 }
 
-void *init_shared_memory()
+void *map_shared_memory(const char *path)
 {
-    int fd = create_or_open_shmem_file();
+    int fd = create_or_open_shmem_file(path);
     if (fd < 0) {
         return nullptr;
     }
 
-    shmem = mmap(NULL, SHMEM_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
-    if (shmem == MAP_FAILED) {
+    char *base = reinterpret_cast<char *>(mmap(NULL, SHMEM_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0));
+    close(fd);
+    if (base == MAP_FAILED) {
         perror("Failed to mmap shared memory");
-        close(fd);
         return nullptr;
     }
 
-    read_doorbell = (volatile uint8_t *)shmem + READ_DOORBELL_OFFSET;
-    write_doorbell = (volatile uint8_t *)shmem + WRITE_DOORBELL_OFFSET;
-    close(fd);
-
     // Initialize doorbells to 0
-    *read_doorbell = 0;
-    *write_doorbell = 0;
+    *((volatile uint8_t *)base + READ_DOORBELL_OFFSET) = 0;
+    *((volatile uint8_t *)base + WRITE_DOORBELL_OFFSET) = 0;
 
     // write proxyShmem address into shmem
-    *reinterpret_cast<uint64_t *>((reinterpret_cast<char *>(shmem) + OFFSET_PROXY_SHMEM)) = reinterpret_cast<uint64_t>(shmem) + DMA_REGION_OFFSET;
+    *reinterpret_cast<uint64_t *>(base + OFFSET_PROXY_SHMEM) = reinterpret_cast<uint64_t>(base) + DMA_REGION_OFFSET;
+
+    // tell the guest driver whether and where to ring the ivshmem doorbell
+    doorbell_publish(reinterpret_cast<volatile uint32_t *>(base + OFFSET_DOORBELL_PEER));
+    mmio_ring_reset(reinterpret_cast<struct mmio_ring *>(base + MMIO_RING_OFFSET));
 
-    msync(shmem, TOTAL_DOORBELL_SIZE, MS_SYNC);
+    msync(base, TOTAL_DOORBELL_SIZE, MS_SYNC);
+
+    return base;
+}
+
+void *init_shared_memory()
+{
+    shmem = map_shared_memory(SHMEM_FILE);
+    if (!shmem) {
+        return nullptr;
+    }
+
+    read_doorbell = (volatile uint8_t *)shmem + READ_DOORBELL_OFFSET;
+    write_doorbell = (volatile uint8_t *)shmem + WRITE_DOORBELL_OFFSET;
+    mmio_ring_init(reinterpret_cast<char *>(shmem) + MMIO_RING_OFFSET);
 
     return shmem;
 }
 
 static void wait_for_write_doorbell_set()
 {
-    while (__atomic_load_n(write_doorbell, __ATOMIC_ACQUIRE) == 0) { }
+    doorbell_wait(write_doorbell, true, true);
 }
 
 static void wait_for_read_doorbell_clear()
 {
-    while (__atomic_load_n(read_doorbell, __ATOMIC_ACQUIRE) != 0) { }
+    doorbell_wait(read_doorbell, false, false);
 }
 
 static int ivshmem_mmio_region_read(void *buf)
 {
     wait_for_write_doorbell_set();
 
+    // Rung for the MMIO ring, the message slot is not in use
+    if (mmio_ring_enabled()) {
+        return 1;
+    }
+
     memcpy(buf, reinterpret_cast<char *>(shmem) + MMIO_REGION_OFFSET, sizeof(struct mmio_message_header));
 
     __atomic_store_n(write_doorbell, 0, __ATOMIC_RELEASE);
@@ -106,6 +131,7 @@ static int ivshmem_mmio_region_write(void *buf, size_t count)
     memcpy(reinterpret_cast<char *>(shmem) + MMIO_REGION_OFFSET, buf, count);
 
     __atomic_store_n(read_doorbell, 1, __ATOMIC_RELEASE);
+    doorbell_notify_guest();
 
     return 0;
 }
@@ -117,10 +143,51 @@ static int ivshmem_write(void *buf, size_t count, size_t offset)
     memcpy(reinterpret_cast<char *>(shmem) + offset, buf, count);
 
     __atomic_store_n(read_doorbell, 1, __ATOMIC_RELEASE);
+    doorbell_notify_guest();
 
     return 0;
 }
 
+// Serves every request posted to the MMIO ring, in order; consecutive posted
+// writes are forwarded as one batch, flushed before a read or when the ring is empty
+static void drain_mmio_ring(coyote::cThread &coyote_thread)
+{
+    struct mmio_ring_slot req;
+    std::vector<std::pair<uint64_t, uint64_t>> writes;
+    char data[8];
+
+    writes.reserve(MMIO_RING_SLOTS);
+
+    while (mmio_ring_pop(&req)) {
+        switch (req.operation) {
+            case OP_READ:
+                edu_mmio_write_batch(coyote_thread, writes);
+                writes.clear();
+
+                edu_mmio_read(coyote_thread, data, req.address);
+
+                if (ivshmem_write(data, sizeof(data), 16) != 0) {
+                    perror("Failed to write response");
+                }
+                break;
+
+            case OP_WRITE:
+                writes.emplace_back(req.address, req.value);
+                if (writes.size() == MMIO_RING_SLOTS) {
+                    edu_mmio_write_batch(coyote_thread, writes);
+                    writes.clear();
+                }
+                break;
+
+            default:
+                fprintf(stderr, "Unknown operation: %d\n", req.operation);
+                break;
+        }
+    }
+
+    edu_mmio_write_batch(coyote_thread, writes);
+}
+
 void *run_shmem_app(coyote::cThread &coyote_thread)
 {
     printf("SHMEM application started. Waiting for messages...\n");
@@ -129,8 +196,19 @@ void *run_shmem_app(coyote::cThread &coyote_thread)
     loff_t offset;
 
     while (1) {
+        // With the MMIO ring the doorbell only wakes us up: it is cleared
+        // before draining, so requests posted meanwhile set it again
+        if (mmio_ring_enabled()) {
+            __atomic_store_n(write_doorbell, 0, __ATOMIC_RELEASE);
+            drain_mmio_ring(coyote_thread);
+        }
+
         mmio_message_header header;
-        if (ivshmem_mmio_region_read(&header) != 0) {
+        int ret = ivshmem_mmio_region_read(&header);
+        if (ret > 0) {
+            continue;
+        }
+        if (ret != 0) {
             perror("Failed to read message");
             continue;
         }
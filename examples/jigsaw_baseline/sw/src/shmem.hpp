@@ -26,9 +26,14 @@
 
 /* Offsets in the shared memory with special values */
 #define OFFSET_PROXY_SHMEM (256)
+#define OFFSET_DOORBELL_PEER (264)  // uint32: ivshmem peer ID + 1 of the daemon, 0 = no doorbell interrupts
+#define MMIO_RING_OFFSET (512)  // struct mmio_ring (jigsaw_ivshmem/mmio_ring.hpp)
 
 void *init_shared_memory();
 
+// Maps and initializes the ivshmem region at path; used for every VM in the multi-VM daemon (vm_daemon.hpp)
+void *map_shared_memory(const char *path);
+
 void *run_shmem_app(coyote::cThread &coyote_thread);
 
 /**
@@ -0,0 +1,296 @@
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "vm_daemon.hpp"
+#include "shmem.hpp"
+#include "mmio_ring.hpp"
+#include "mmio_handler.hpp"
+
+#include <coyote/cThread.hpp>
+
+// Offset of the read response in the ivshmem region
+#define RESPONSE_OFFSET 16
+
+// Poller: spin window after the last request, before backing off with sleeps
+#define POLL_SLEEP_MIN_NS 1000
+
+// vFPGA of the pool, with its cThread and register file
+struct vfpga_slot
+{
+    int vfid;
+    std::unique_ptr<coyote::cThread> thread;
+    coyote::csrWindow regs;
+    bool assigned = false;
+};
+
+// Guest served by the daemon
+struct vm_bridge
+{
+    std::string path;
+    char *shmem = nullptr;
+    volatile uint8_t *read_doorbell = nullptr;
+    volatile uint8_t *write_doorbell = nullptr;
+    struct mmio_ring *ring = nullptr;
+
+    // Assigned by the poller on the first doorbell
+    vfpga_slot *slot = nullptr;
+    bool waiting = false;
+
+    // Read response held back until the guest cleared the read doorbell
+    bool has_response = false;
+    uint64_t response = 0;
+
+    // Set while the guest is queued or served by a worker
+    std::atomic<bool> queued{false};
+};
+
+static uint64_t now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+void vm_daemon_add_options(boost::program_options::options_description &opts, vm_daemon_config &cfg)
+{
+    opts.add_options()
+        ("vm", boost::program_options::value<std::vector<std::string>>(&cfg.vms)->composing(),
+         "ivshmem file of a guest; once per guest, selects the multi-VM daemon")
+        ("vfpga", boost::program_options::value<std::vector<int>>(&cfg.vfpgas)->composing(),
+         "vFPGA the guests can be assigned to; once per vFPGA (default: 0)")
+        ("workers", boost::program_options::value<uint32_t>(&cfg.workers)->default_value(cfg.workers),
+         "Worker threads of the multi-VM daemon")
+        ("budget", boost::program_options::value<uint32_t>(&cfg.budget)->default_value(cfg.budget),
+         "Requests served per guest and turn in the multi-VM daemon");
+}
+
+// Publishes a read response; false if the guest did not consume the previous one yet
+static bool post_response(vm_bridge &vm, uint64_t val)
+{
+    if (__atomic_load_n(vm.read_doorbell, __ATOMIC_ACQUIRE)) {
+        return false;
+    }
+
+    memcpy(vm.shmem + RESPONSE_OFFSET, &val, sizeof(val));
+    __atomic_store_n(vm.read_doorbell, 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+// Serves a read; the response is held back if the guest did not consume the previous one
+static void serve_read(vm_bridge &vm, uint64_t address)
+{
+    uint64_t val;
+    edu_mmio_read(*vm.slot->thread, vm.slot->regs, reinterpret_cast<char *>(&val), address);
+
+    if (!post_response(vm, val)) {
+        vm.has_response = true;
+        vm.response = val;
+    }
+}
+
+// Serves up to budget requests of a guest, in order; same protocol as run_shmem_app()
+static void serve(vm_bridge &vm, uint32_t budget)
+{
+    coyote::cThread &thread = *vm.slot->thread;
+    coyote::csrWindow &regs = vm.slot->regs;
+
+    if (vm.has_response) {
+        if (!post_response(vm, vm.response)) {
+            return;
+        }
+        vm.has_response = false;
+    }
+
+    if (mmio_ring_enabled(vm.ring)) {
+        // The doorbell only wakes us up; requests posted while draining set it again
+        __atomic_store_n(vm.write_doorbell, 0, __ATOMIC_RELEASE);
+
+        struct mmio_ring_slot req;
+        std::vector<std::pair<uint64_t, uint64_t>> writes;
+        while (budget-- && !vm.has_response && mmio_ring_pop(vm.ring, &req)) {
+            switch (req.operation) {
+                case OP_READ:
+                    edu_mmio_write_batch(thread, regs, writes);
+                    writes.clear();
+                    serve_read(vm, req.address);
+                    break;
+
+                case OP_WRITE:
+                    writes.emplace_back(req.address, req.value);
+                    break;
+
+                default:
+                    fprintf(stderr, "VM %s: unknown operation: %d\n", vm.path.c_str(), req.operation);
+                    break;
+            }
+        }
+        edu_mmio_write_batch(thread, regs, writes);
+
+    } else if (__atomic_load_n(vm.write_doorbell, __ATOMIC_ACQUIRE)) {
+        mmio_message_header header;
+        memcpy(&header, vm.shmem + MMIO_REGION_OFFSET, sizeof(header));
+        __atomic_store_n(vm.write_doorbell, 0, __ATOMIC_RELEASE);
+
+        switch (header.operation) {
+            case OP_READ:
+                serve_read(vm, header.address);
+                break;
+
+            case OP_WRITE:
+                edu_mmio_write(thread, regs, reinterpret_cast<char *>(&header.value), header.address);
+                break;
+
+            default:
+                fprintf(stderr, "VM %s: unknown operation: %d\n", vm.path.c_str(), header.operation);
+                break;
+        }
+    }
+}
+
+// Whether the guest has requests to serve, or a held back response it can take now
+static bool has_work(const vm_bridge &vm)
+{
+    if (vm.has_response) {
+        return !__atomic_load_n(vm.read_doorbell, __ATOMIC_ACQUIRE);
+    }
+    return __atomic_load_n(vm.write_doorbell, __ATOMIC_ACQUIRE) ||
+           (mmio_ring_enabled(vm.ring) && mmio_ring_pending(vm.ring));
+}
+
+// Assigns a free vFPGA to the guest; false if all of them are taken
+static bool assign(vm_bridge &vm, std::vector<vfpga_slot> &pool)
+{
+    for (vfpga_slot &slot : pool) {
+        if (!slot.assigned) {
+            slot.thread->userMap(vm.shmem + DMA_REGION_OFFSET, DMA_SIZE);
+            slot.regs.set(static_cast<uint32_t>(JigsawRegisters::COYOTE_PID_REG), slot.thread->getCtid());
+            slot.assigned = true;
+            vm.slot = &slot;
+            printf("VM %s: assigned to vFPGA %d, ctid %d\n", vm.path.c_str(), slot.vfid, slot.thread->getCtid());
+            return true;
+        }
+    }
+
+    if (!vm.waiting) {
+        printf("VM %s: all vFPGAs are assigned, waiting\n", vm.path.c_str());
+        vm.waiting = true;
+    }
+    return false;
+}
+
+int run_vm_daemon(vm_daemon_config &cfg, const doorbell_config &doorbell)
+{
+    if (doorbell.mode == "irq") {
+        fprintf(stderr, "The irq doorbell mode serves a single VM, use spin or sleep with --vm\n");
+        return EXIT_FAILURE;
+    }
+    if (cfg.vfpgas.empty()) {
+        cfg.vfpgas.push_back(0);
+    }
+    if (!cfg.workers || !cfg.budget) {
+        fprintf(stderr, "--workers and --budget must be at least 1\n");
+        return EXIT_FAILURE;
+    }
+
+    std::vector<vfpga_slot> pool(cfg.vfpgas.size());
+    for (size_t i = 0; i < pool.size(); i++) {
+        pool[i].vfid = cfg.vfpgas[i];
+        pool[i].thread = std::make_unique<coyote::cThread>(cfg.vfpgas[i], getpid());
+        pool[i].regs = jigsaw_map_regs(*pool[i].thread);
+    }
+
+    std::vector<std::unique_ptr<vm_bridge>> vms;
+    for (const std::string &path : cfg.vms) {
+        std::unique_ptr<vm_bridge> vm = std::make_unique<vm_bridge>();
+        vm->path = path;
+        vm->shmem = reinterpret_cast<char *>(map_shared_memory(path.c_str()));
+        if (!vm->shmem) {
+            fprintf(stderr, "VM %s: could not map the shared memory\n", path.c_str());
+            return EXIT_FAILURE;
+        }
+        vm->read_doorbell = (volatile uint8_t *)vm->shmem + READ_DOORBELL_OFFSET;
+        vm->write_doorbell = (volatile uint8_t *)vm->shmem + WRITE_DOORBELL_OFFSET;
+        vm->ring = reinterpret_cast<struct mmio_ring *>(vm->shmem + MMIO_RING_OFFSET);
+        vms.push_back(std::move(vm));
+    }
+
+    // Guests with pending requests, served in FIFO order
+    std::mutex queue_lock;
+    std::condition_variable queue_cv;
+    std::deque<vm_bridge *> queue;
+
+    std::vector<std::thread> workers;
+    for (uint32_t i = 0; i < cfg.workers; i++) {
+        workers.emplace_back([&] {
+            while (true) {
+                vm_bridge *vm;
+                {
+                    std::unique_lock<std::mutex> lock(queue_lock);
+                    queue_cv.wait(lock, [&] { return !queue.empty(); });
+                    vm = queue.front();
+                    queue.pop_front();
+                }
+
+                serve(*vm, cfg.budget);
+
+                // The poller queues the guest again if it still has requests
+                vm->queued.store(false, std::memory_order_release);
+            }
+        });
+    }
+
+    printf("Multi-VM daemon started: %zu VMs, %zu vFPGAs, %u workers. Waiting for messages...\n",
+           vms.size(), pool.size(), cfg.workers);
+
+    // Poller; starts every scan at the next guest, so that none is favoured
+    bool backoff = doorbell.mode == "sleep";
+    uint64_t spin_ns = doorbell.spin_us * 1000ULL;
+    uint64_t max_sleep_ns = doorbell.max_sleep_us * 1000ULL;
+    uint64_t sleep_ns = POLL_SLEEP_MIN_NS;
+    uint64_t last_work = now_ns();
+    size_t first = 0;
+
+    while (true) {
+        bool found = false;
+        for (size_t n = 0; n < vms.size(); n++) {
+            vm_bridge &vm = *vms[(first + n) % vms.size()];
+            if (vm.queued.load(std::memory_order_acquire) || !has_work(vm)) {
+                continue;
+            }
+            if (!vm.slot && !assign(vm, pool)) {
+                continue;
+            }
+            found = true;
+
+            vm.queued.store(true, std::memory_order_relaxed);
+            {
+                std::lock_guard<std::mutex> lock(queue_lock);
+                queue.push_back(&vm);
+            }
+            queue_cv.notify_one();
+        }
+        first = (first + 1) % vms.size();
+
+        if (found) {
+            last_work = now_ns();
+            sleep_ns = POLL_SLEEP_MIN_NS;
+        } else if (backoff && now_ns() - last_work > spin_ns) {
+            struct timespec ts = { 0, (long)sleep_ns };
+            nanosleep(&ts, NULL);
+            sleep_ns = std::min(sleep_ns * 2, max_sleep_ns);
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,57 @@
+#ifndef VM_DAEMON_HPP
+#define VM_DAEMON_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <boost/program_options.hpp>
+
+#include "doorbell.hpp"
+
+/*
+ * Multi-VM daemon mode, selected by passing --vm once per guest.
+ *
+ * Instead of one daemon (with its own cThread and a spinning core) per
+ * guest, a single daemon serves the ivshmem regions of many guests:
+ *
+ *  - One poller thread scans the doorbells (and MMIO rings) of all guests,
+ *    round-robin, and queues the guests with pending requests. It spins
+ *    while guests are active and backs off with sleeps of up to
+ *    --max_sleep_us once all of them are idle (not in spin mode).
+ *  - A pool of --workers threads serves the queued guests, at most
+ *    --budget requests per guest and turn; a guest with more pending
+ *    requests is queued again behind the others, so a busy guest can't
+ *    starve the rest. A guest is only served by one worker at a time, so
+ *    its requests stay in order.
+ *  - The vFPGAs given with --vfpga (0 by default) form a pool of cThreads.
+ *    A guest is assigned a free vFPGA when it first rings, and keeps it;
+ *    its DMA region is mapped into that vFPGA's TLB and COYOTE_PID_REG
+ *    gets the cThread's ctid. Guests beyond the number of vFPGAs wait
+ *    until one is free; the register file is per vFPGA, so guests can't
+ *    share one.
+ *
+ * A read response is only published once the guest cleared the read
+ * doorbell of the previous one; until then the guest is not served, but
+ * no worker waits for it. The irq doorbell mode is single-guest only.
+ */
+
+struct vm_daemon_config
+{
+    std::vector<std::string> vms;   /** ivshmem files, one per guest */
+    std::vector<int> vfpgas;        /** vFPGAs the guests are assigned to */
+    uint32_t workers = 2;           /** Worker threads */
+    uint32_t budget = 32;           /** Requests served per guest and turn */
+};
+
+/**
+ * @brief Registers --vm, --vfpga, --workers and --budget
+ */
+void vm_daemon_add_options(boost::program_options::options_description &opts, vm_daemon_config &cfg);
+
+/**
+ * @brief Serves the guests of cfg until the process is killed; returns EXIT_FAILURE if the set-up failed
+ */
+int run_vm_daemon(vm_daemon_config &cfg, const doorbell_config &doorbell);
+
+#endif // VM_DAEMON_HPP
@@ -5,13 +5,13 @@
 #include <sstream>
 #include <vector>
 #include <string>
-#include <map>
 #include <stdexcept>
 
 #include <thread>
 #include <iostream>
 #include <boost/program_options.hpp>
 
+#include <coyote/cTrace.hpp>
 #include <coyote/cThread.hpp>
 
 // Constants
@@ -211,7 +211,7 @@ void run_computation_bench(
 }
 
 // ---------------------------------------------------------------------------
-// Trace Replay (bundled, embedded via traces.hpp)
+// Trace Replay (coyote::cTraceReplay, traces loaded from --traces)
 //
 // Each app's trace is a sequence of three event kinds:
 //   BULK_H2D : standalone H2D DMA (data preload, kernel binary).
@@ -220,57 +220,20 @@ void run_computation_bench(
 //              (kernel args + flag resets) + busy-wait compute + D2H-out
 //              (flag readbacks) atomically.
 //
-// Bitstream quirks (still relevant for the BULK paths):
-//   1. Minimum length is one cacheline (64 B).
-//   2. Length register cannot decrease between same-direction transfers.
-// Mitigations: floor at MIN_DMA_BYTES, pad up to running max per direction.
+// The bitstream moves the data itself, driven by its registers, so the
+// events are carried out by an executor instead of cThread::invoke; the
+// replay clamps the sizes (64 B cacheline multiples, capped at the buffer).
 //
-// Timing: parameter MMIOs staged OUTSIDE the timed window. total_us covers
-// only kick MMIO + completion poll.
+// Timing: parameter MMIOs staged OUTSIDE the timed window (prepare step).
+// total_us covers only the per-event address/length MMIOs, kick and poll.
 // ---------------------------------------------------------------------------
-#include "traces.hpp"
-using namespace jigsaw_traces_ns;
-
-static constexpr uint32_t MIN_DMA_BYTES = 64;
-
 static constexpr int TRACE_N_RUNS = 5;
 
-struct TraceResult {
-    std::string app;
-    int run_idx;
-    int event_idx;
-    uint8_t kind;       // BULK_H2D / BULK_D2H / BUNDLE
-    uint64_t h2d_size;
-    uint64_t d2h_size;
-    uint64_t cycles;
-    double total_us;
-    int original_count;
-};
-
-static uint64_t clamp_dma(uint64_t raw, uint64_t mem_cap) {
-    uint64_t sz = (raw > mem_cap) ? mem_cap : raw;
-    // Keep raw==0 as 0 so computation_engine skips that phase entirely.
-    // Non-zero sizes are rounded UP to a cacheline multiple — Coyote's
-    // 512-bit AXI streams move data one 64-byte beat at a time, and
-    // non-aligned lengths desync the meta/payload pipeline.
-    if (sz != 0)
-    {
-        sz = (sz + MIN_DMA_BYTES - 1) & ~static_cast<uint64_t>(MIN_DMA_BYTES - 1);
-        if (sz > mem_cap)
-        {
-            sz = mem_cap & ~static_cast<uint64_t>(MIN_DMA_BYTES - 1);
-        }
-    }
-    return sz;
-}
-
 static void run_trace_benchmark(coyote::cThread &coyote_thread, int *mem,
                                 uint64_t mem_bytes,
-                                std::vector<TraceResult> &results)
+                                const std::vector<coyote::cTrace> &traces,
+                                std::vector<coyote::cTraceResult> &results)
 {
-    using clk = std::chrono::high_resolution_clock;
-    auto secs = [](auto a, auto b) { return std::chrono::duration<double>(b - a).count(); };
-
     // PID is set once at the start of the trace run instead of being re-asserted
     // per event. In real Coyote use the PID is bound at vFPGA acquisition; the
     // per-event re-assertion in the original benchmark_run lambda was inherited
@@ -278,10 +241,7 @@ static void run_trace_benchmark(coyote::cThread &coyote_thread, int *mem,
     // future bitstream proves otherwise, move it back inside do_bulk/do_bundle.
     coyote_thread.setCSR(coyote_thread.getCtid(), static_cast<uint32_t>(JigsawRegisters::COYOTE_PID_REG));
 
-    // CYCLES_PER_COMPUTATION is a benchmark-only register (no analogue on a real
-    // accelerator), so it's staged outside the timed window per BUNDLE event.
-    auto do_bulk = [&](uint32_t size, bool d2h) -> double {
-        auto start = clk::now();
+    auto do_bulk = [&](uint32_t size, bool d2h) {
         coyote_thread.setCSR(reinterpret_cast<uint64_t>(mem),  static_cast<uint32_t>(JigsawRegisters::DMA_SRC_ADDR_REG));
         coyote_thread.setCSR(reinterpret_cast<uint64_t>(mem),  static_cast<uint32_t>(JigsawRegisters::DMA_DST_ADDR_REG));
         if (d2h) coyote_thread.setCSR(static_cast<uint64_t>(size), static_cast<uint32_t>(JigsawRegisters::DMA_D2H_LEN_REG));
@@ -291,22 +251,10 @@ static void run_trace_benchmark(coyote::cThread &coyote_thread, int *mem,
         uint64_t cmd = d2h ? 3 : 1;
         coyote_thread.setCSR(cmd,                              static_cast<uint32_t>(JigsawRegisters::DMA_CMD_REG));
         while (coyote_thread.getCSR(static_cast<uint32_t>(JigsawRegisters::DMA_STATUS_REG)) != 1) {}
-        auto end = clk::now();
         coyote_thread.setCSR(static_cast<uint64_t>(0),         static_cast<uint32_t>(JigsawRegisters::DMA_STATUS_REG));
-        return secs(start, end);
     };
 
-    auto do_bundle = [&](uint32_t h2d, uint32_t d2h, uint64_t cycles) -> double {
-        // Synthetic compute-cycle knob: not a real-device register, stage outside.
-        coyote_thread.setCSR(cycles,                           static_cast<uint32_t>(JigsawRegisters::CYCLES_PER_COMPUTATION_REG));
-        const uint64_t cycles_readback = coyote_thread.getCSR(static_cast<uint32_t>(JigsawRegisters::CYCLES_PER_COMPUTATION_REG));
-        if (cycles_readback != cycles) {
-            std::cerr << "[ERROR] CYCLES_PER_COMPUTATION_REG readback mismatch: wrote "
-                      << cycles << ", read " << cycles_readback << std::endl;
-            throw std::runtime_error("CYCLES_PER_COMPUTATION_REG readback mismatch");
-        }
-
-        auto start = clk::now();
+    auto do_bundle = [&](uint32_t h2d, uint32_t d2h) {
         coyote_thread.setCSR(reinterpret_cast<uint64_t>(mem),  static_cast<uint32_t>(JigsawRegisters::DMA_SRC_ADDR_REG));
         coyote_thread.setCSR(reinterpret_cast<uint64_t>(mem),  static_cast<uint32_t>(JigsawRegisters::DMA_DST_ADDR_REG));
         coyote_thread.setCSR(static_cast<uint64_t>(h2d),       static_cast<uint32_t>(JigsawRegisters::DMA_H2D_LEN_REG));
@@ -315,82 +263,64 @@ static void run_trace_benchmark(coyote::cThread &coyote_thread, int *mem,
 
         coyote_thread.setCSR(static_cast<uint64_t>(1),         static_cast<uint32_t>(JigsawRegisters::START_COMPUTATION_REG));
         while ((coyote_thread.getCSR(static_cast<uint32_t>(JigsawRegisters::DMA_STATUS_REG)) & 0x2) == 0) {}
-        auto end = clk::now();
         coyote_thread.setCSR(static_cast<uint64_t>(0),         static_cast<uint32_t>(JigsawRegisters::DMA_STATUS_REG));
-        return secs(start, end);
     };
 
-    auto kind_str = [](uint8_t k) -> const char * {
-        switch (k) {
-            case TRACE_BULK_H2D: return "BULK_H2D";
-            case TRACE_BULK_D2H: return "BULK_D2H";
-            case TRACE_BUNDLE:   return "BUNDLE  ";
-            default:             return "UNKNOWN ";
+    // CYCLES_PER_COMPUTATION is a benchmark-only register (no analogue on a real
+    // accelerator), so it's staged in the (untimed) prepare step per BUNDLE event.
+    auto prepare = [&](uint64_t i, const coyote::traceEvent &ev, uint64_t h2d, uint64_t d2h) {
+        std::cerr << "[trace]   ev=" << i
+                  << " kind=" << static_cast<int>(ev.kind)
+                  << " h2d=" << h2d << " d2h=" << d2h
+                  << " cycles=" << ev.cycles << std::endl;
+
+        if (ev.kind == coyote::CoyoteTraceKind::BUNDLE) {
+            coyote_thread.setCSR(ev.cycles, static_cast<uint32_t>(JigsawRegisters::CYCLES_PER_COMPUTATION_REG));
+            const uint64_t cycles_readback = coyote_thread.getCSR(static_cast<uint32_t>(JigsawRegisters::CYCLES_PER_COMPUTATION_REG));
+            if (cycles_readback != ev.cycles) {
+                std::cerr << "[ERROR] CYCLES_PER_COMPUTATION_REG readback mismatch: wrote "
+                          << ev.cycles << ", read " << cycles_readback << std::endl;
+                throw std::runtime_error("CYCLES_PER_COMPUTATION_REG readback mismatch");
+            }
         }
     };
 
-    constexpr size_t n_apps = sizeof(jigsaw_traces) / sizeof(jigsaw_traces[0]);
-    for (size_t a = 0; a < n_apps; a++) {
-        const auto &app = jigsaw_traces[a];
-        std::cerr << "[trace] " << app.name << " (" << app.n << " events, "
-                  << TRACE_N_RUNS << " runs)" << std::endl;
-
-      for (int run = 0; run < TRACE_N_RUNS; run++) {
-        std::cerr << "[trace] " << app.name << " run " << run << "/" << TRACE_N_RUNS << std::endl;
-        for (size_t i = 0; i < app.n; i++) {
-            const auto &ev = app.events[i];
-            double total_s = 0;
-            uint64_t h2d = 0, d2h = 0;
-
-            std::cerr << "[trace]   " << app.name
-                      << " ev=" << i << "/" << app.n
-                      << " kind=" << kind_str(ev.kind)
-                      << " h2d_raw=" << ev.h2d_size
-                      << " d2h_raw=" << ev.d2h_size
-                      << " cycles=" << ev.cycles
-                      << " ... " << std::flush;
-
-            switch (ev.kind) {
-            case TRACE_BULK_H2D:
-                h2d = clamp_dma(ev.h2d_size, mem_bytes);
-                std::cerr << "(h2d=" << h2d << ") " << std::flush;
-                total_s = do_bulk(static_cast<uint32_t>(h2d), false);
-                break;
-            case TRACE_BULK_D2H:
-                d2h = clamp_dma(ev.d2h_size, mem_bytes);
-                std::cerr << "(d2h=" << d2h << ") " << std::flush;
-                total_s = do_bulk(static_cast<uint32_t>(d2h), true);
-                break;
-            case TRACE_BUNDLE:
-                h2d = clamp_dma(ev.h2d_size, mem_bytes);
-                d2h = clamp_dma(ev.d2h_size, mem_bytes);
-                std::cerr << "(h2d=" << h2d << " d2h=" << d2h << ") " << std::flush;
-                total_s = do_bundle(static_cast<uint32_t>(h2d), static_cast<uint32_t>(d2h), ev.cycles);
-                break;
-            default:
-                std::cerr << "[warn] unknown kind " << (int)ev.kind << std::endl;
-                continue;
-            }
+    auto execute = [&](uint64_t i, const coyote::traceEvent &ev, uint64_t h2d, uint64_t d2h) {
+        switch (ev.kind) {
+        case coyote::CoyoteTraceKind::BULK_H2D:
+            do_bulk(static_cast<uint32_t>(h2d), false);
+            break;
+        case coyote::CoyoteTraceKind::BULK_D2H:
+            do_bulk(static_cast<uint32_t>(d2h), true);
+            break;
+        case coyote::CoyoteTraceKind::BUNDLE:
+            do_bundle(static_cast<uint32_t>(h2d), static_cast<uint32_t>(d2h));
+            break;
+        }
+    };
 
-            std::cerr << "done " << std::fixed << std::setprecision(3)
-                      << (total_s * 1e6) << " us" << std::endl;
+    coyote::cTraceReplay replay(&coyote_thread, mem, mem_bytes);
+    replay.setExecutor(execute, prepare);
 
-            results.push_back({app.name, run, static_cast<int>(i), ev.kind,
-                               ev.h2d_size, ev.d2h_size, ev.cycles,
-                               total_s * 1e6,
-                               ev.original_count});
+    for (const auto &trace : traces) {
+        std::cerr << "[trace] " << trace.getName() << " (" << trace.size() << " events, "
+                  << TRACE_N_RUNS << " runs)" << std::endl;
+        for (int run = 0; run < TRACE_N_RUNS; run++) {
+            std::cerr << "[trace] " << trace.getName() << " run " << run << "/" << TRACE_N_RUNS << std::endl;
+            results.push_back(replay.replay(trace));
         }
-      }
     }
 }
 
 int main(int argc, char *argv[]) {
     bool skip_comp = false;
+    std::string trace_dir = JIGSAW_TRACE_DIR;
 
     // Command line options
     boost::program_options::options_description opts("Jigsaw Baseline Options");
     opts.add_options()
-        ("skip_comp,s", boost::program_options::bool_switch(&skip_comp), "Skip computation benchmarks");
+        ("skip_comp,s", boost::program_options::bool_switch(&skip_comp), "Skip computation benchmarks")
+        ("traces,t", boost::program_options::value<std::string>(&trace_dir), "Directory with the traces (*.trace) to replay");
 
     boost::program_options::variables_map vm;
     boost::program_options::store(boost::program_options::parse_command_line(argc, argv, opts), vm);
@@ -443,77 +373,33 @@ int main(int argc, char *argv[]) {
     }
 
     // =========================================================================
-    // Trace Benchmark (embedded apps from traces.hpp)
+    // Trace Benchmark (traces loaded from the trace directory)
     // =========================================================================
     std::cout << "\n=== TRACE BENCHMARK ===" << std::endl;
     {
-        std::vector<TraceResult> trace_results;
-        run_trace_benchmark(coyote_thread, mem, mem_bytes, trace_results);
-
-        // Per-app aggregate summary
-        struct AppAgg {
-            int n_events = 0;
-            int n_bulk_h2d = 0, n_bulk_d2h = 0, n_bundle = 0;
-            double total_h2d_us = 0;     // time in BULK_H2D events
-            double total_d2h_us = 0;     // time in BULK_D2H events
-            double total_bundle_us = 0;  // time in BUNDLE events
-            uint64_t total_h2d_bytes = 0;
-            uint64_t total_d2h_bytes = 0;
-            uint64_t total_cycles = 0;
-        };
-        struct AppKey {
-            std::string app;
-            int run_idx;
-        };
-        std::vector<std::pair<AppKey, AppAgg>> ordered;
-        std::map<std::pair<std::string, int>, size_t> idx;
-        for (const auto &r : trace_results) {
-            auto key = std::make_pair(r.app, r.run_idx);
-            auto it = idx.find(key);
-            if (it == idx.end()) {
-                idx[key] = ordered.size();
-                ordered.push_back({{r.app, r.run_idx}, AppAgg{}});
-                it = idx.find(key);
-            }
-            auto &a = ordered[it->second].second;
-            a.n_events++;
-            switch (r.kind) {
-            case TRACE_BULK_H2D:
-                a.n_bulk_h2d++;
-                a.total_h2d_us += r.total_us;
-                a.total_h2d_bytes += r.h2d_size;
-                break;
-            case TRACE_BULK_D2H:
-                a.n_bulk_d2h++;
-                a.total_d2h_us += r.total_us;
-                a.total_d2h_bytes += r.d2h_size;
-                break;
-            case TRACE_BUNDLE:
-                a.n_bundle++;
-                a.total_bundle_us += r.total_us;
-                a.total_h2d_bytes += r.h2d_size;
-                a.total_d2h_bytes += r.d2h_size;
-                a.total_cycles += r.cycles;
-                break;
-            }
-        }
+        std::vector<coyote::cTrace> traces = coyote::cTrace::loadDir(trace_dir);
+        std::vector<coyote::cTraceResult> trace_results;
+        run_trace_benchmark(coyote_thread, mem, mem_bytes, traces, trace_results);
 
+        // Per-app summary; the runs of an app are consecutive
         std::cout << std::endl << "# per-app summary (one row per (app, run))" << std::endl;
         std::cout << "app, run, n_events, n_bulk_h2d, n_bulk_d2h, n_bundle, "
                   << "total_h2d_us, total_d2h_us, total_bundle_us, total_us, "
                   << "total_h2d_bytes, total_d2h_bytes, total_cycles" << std::endl;
-        for (const auto &p : ordered) {
-            const auto &a = p.second;
-            double total_us = a.total_h2d_us + a.total_d2h_us + a.total_bundle_us;
-            std::cout << p.first.app << ", " << p.first.run_idx << ", "
-                      << a.n_events << ", "
-                      << a.n_bulk_h2d << ", " << a.n_bulk_d2h << ", " << a.n_bundle << ", "
+        for (size_t i = 0; i < trace_results.size(); i++) {
+            const auto &r = trace_results[i];
+            std::cout << r.trace << ", " << (i % TRACE_N_RUNS) << ", "
+                      << r.result.getOps() << ", "
+                      << r.n_events[0] << ", " << r.n_events[1] << ", " << r.n_events[2] << ", "
                       << std::fixed << std::setprecision(3)
-                      << a.total_h2d_us << ", " << a.total_d2h_us << ", "
-                      << a.total_bundle_us << ", " << total_us << ", "
-                      << a.total_h2d_bytes << ", " << a.total_d2h_bytes << ", "
-                      << a.total_cycles << std::endl;
+                      << r.kind_time[0] / 1e3 << ", " << r.kind_time[1] / 1e3 << ", "
+                      << r.kind_time[2] / 1e3 << ", " << (r.kind_time[0] + r.kind_time[1] + r.kind_time[2]) / 1e3 << ", "
+                      << r.h2d_bytes << ", " << r.d2h_bytes << ", "
+                      << r.cycles << std::endl;
         }
+
+        std::cout << std::endl << "# per-trace throughput and latency" << std::endl;
+        coyote::cTraceReplay::writeCsv(std::cout, trace_results);
     }
 
     // =========================================================================
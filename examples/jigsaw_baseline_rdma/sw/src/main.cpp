@@ -37,6 +37,9 @@ void print_help(char **argv)
     printf("usage: %s\n", argv[0]);
     printf("\t--localAddress [IP address of local interface]           or -a\n");
     printf("\t--localPort [Local port to use]                          or -p\n");
+    printf("\t--sqDepth [Work requests in flight; 1 for blocking mode]   or -d\n");
+    printf("\t--chunkSize [Bytes per work request, in windowed mode]    or -c\n");
+    printf("\t--signalEvery [Signal every n-th work request]           or -s\n");
 }
 
 void setup(int argc, char **argv)
@@ -45,15 +48,19 @@ void setup(int argc, char **argv)
 	int op, ret;
 	char *localAddr = NULL;
 	char *localPort = NULL;
+	struct rdma_window window = { 1, DEFAULT_CHUNK_SIZE, 0 };
 
 	/*** Read command line arguments ***/
 	struct option long_opts[] = {
 		{ "localAddress", 1, NULL, 'a' },
 		{ "localPort", 1, NULL, 'p' },
+		{ "sqDepth", 1, NULL, 'd' },
+		{ "chunkSize", 1, NULL, 'c' },
+		{ "signalEvery", 1, NULL, 's' },
 		{ NULL, 0, NULL, 0 }
 	};
 
-	while ((op = getopt_long(argc, argv, "a:p:", long_opts, NULL)) != -1) {
+	while ((op = getopt_long(argc, argv, "a:p:d:c:s:", long_opts, NULL)) != -1) {
 		switch (op) {
 			case 'a':
 				localAddr = optarg;
@@ -61,6 +68,15 @@ void setup(int argc, char **argv)
 			case 'p':
 				localPort = optarg;
 				break;
+			case 'd':
+				window.sq_depth = atoi(optarg);
+				break;
+			case 'c':
+				window.chunk_size = atol(optarg);
+				break;
+			case 's':
+				window.signal_every = atoi(optarg);
+				break;
 			default:
                 print_help(argv);
 				exit(EXIT_FAILURE);
@@ -73,7 +89,13 @@ void setup(int argc, char **argv)
 		exit(EXIT_FAILURE);
 	}
 
-	regions = init_rdma(localAddr, localPort);
+	if (window.sq_depth < 1 || window.chunk_size < 1) {
+		printf("The send queue depth and chunk size have to be positive\n");
+        print_help(argv);
+		exit(EXIT_FAILURE);
+	}
+
+	regions = init_rdma(localAddr, localPort, &window);
 	if (regions == NULL) {
         fprintf(stderr, "init_rdma failed\n");
 		exit(EXIT_FAILURE);
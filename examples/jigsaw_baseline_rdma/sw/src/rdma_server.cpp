@@ -42,10 +42,80 @@
 
 static struct rdma_cm_id *listen_id, *id;
 static int send_flags;
+static struct rdma_window window = { 1, DMA_SIZE, 1 };
 
 // Contains the buffers and registered memory regions and rkey of remote
 struct disagg_regions_rdma regions_rdma;
 
+/*
+ * Windowed transfer: posts the chunks of the dma_buf as a list of work requests, keeping up to window.sq_depth in flight
+ * Since only some work requests are signalled, the wr_id of a signalled one is the number of work requests 
+ * (of this transfer) completed, once its completion is polled
+ */
+static int rdma_post_window(enum ibv_wr_opcode opcode, uint64_t raddr, size_t count)
+{
+	struct ibv_send_wr wrs[MAX_SQ_DEPTH];
+	struct ibv_sge sges[MAX_SQ_DEPTH];
+	struct ibv_send_wr *bad_wr;
+	struct ibv_wc wcs[WC_BATCH];
+	uint64_t n_chunks = (count + window.chunk_size - 1) / window.chunk_size;
+	uint64_t posted = 0, completed = 0;
+	int ret;
+
+	while (completed < n_chunks) {
+		// Refill the window with a single post
+		unsigned n = 0;
+		while (posted < n_chunks && posted - completed < window.sq_depth) {
+			uint64_t offs = posted * window.chunk_size;
+			size_t len = (count - offs < window.chunk_size) ? count - offs : window.chunk_size;
+			posted++;
+
+			sges[n].addr = (uint64_t) regions_rdma.dma_buf + offs;
+			sges[n].length = len;
+			sges[n].lkey = regions_rdma.mr_dma_buf->lkey;
+
+			memset(&wrs[n], 0, sizeof(wrs[n]));
+			wrs[n].wr_id = posted;
+			wrs[n].sg_list = &sges[n];
+			wrs[n].num_sge = 1;
+			wrs[n].opcode = opcode;
+			wrs[n].send_flags = (posted % window.signal_every == 0 || posted == n_chunks) ? IBV_SEND_SIGNALED : 0;
+			wrs[n].wr.rdma.remote_addr = raddr + offs;
+			wrs[n].wr.rdma.rkey = regions_rdma.rkey;
+			wrs[n].next = NULL;
+			if (n > 0)
+				wrs[n - 1].next = &wrs[n];
+			n++;
+		}
+
+		if (n > 0) {
+			ret = ibv_post_send(id->qp, &wrs[0], &bad_wr);
+			if (ret) {
+				errno = ret;
+				perror("ibv_post_send");
+				return -1;
+			}
+		}
+
+		ret = ibv_poll_cq(id->send_cq, WC_BATCH, wcs);
+		if (ret < 0) {
+			perror("ibv_poll_cq");
+			return -1;
+		}
+
+		for (int i = 0; i < ret; i++) {
+			if (wcs[i].status != IBV_WC_SUCCESS) {
+				fprintf(stderr, "work request failed: %s\n", ibv_wc_status_str(wcs[i].status));
+				return -1;
+			}
+			if (wcs[i].wr_id > completed)
+				completed = wcs[i].wr_id;
+		}
+	}
+
+	return 0;
+}
+
 int rdma_write(uint64_t raddr, size_t count)
 {
 #ifdef CONFIG_DISAGG_DEBUG_DMA_SEC
@@ -54,7 +124,10 @@ int rdma_write(uint64_t raddr, size_t count)
 	int ret;
 	struct ibv_wc wc;
 
-	ret = rdma_post_write(id, NULL, regions_rdma.dma_buf, count, regions_rdma.mr_dma_buf, 0, raddr, regions_rdma.rkey);
+	if (window.sq_depth > 1)
+		return rdma_post_window(IBV_WR_RDMA_WRITE, raddr, count);
+
+	ret = rdma_post_write(id, NULL, regions_rdma.dma_buf, count, regions_rdma.mr_dma_buf, IBV_SEND_SIGNALED, raddr, regions_rdma.rkey);
 
 	if (ret != 0) {
 		perror("rdma_post_write failed\n");
@@ -77,7 +150,10 @@ int rdma_read(uint64_t raddr, size_t count)
 	int ret;
 	struct ibv_wc wc;
 
-	ret = rdma_post_read(id, NULL, regions_rdma.dma_buf, count, regions_rdma.mr_dma_buf, 0, raddr, regions_rdma.rkey);
+	if (window.sq_depth > 1)
+		return rdma_post_window(IBV_WR_RDMA_READ, raddr, count);
+
+	ret = rdma_post_read(id, NULL, regions_rdma.dma_buf, count, regions_rdma.mr_dma_buf, IBV_SEND_SIGNALED, raddr, regions_rdma.rkey);
 
 	if (ret != 0) {
 		perror("rdma_post_read failed\n");
@@ -97,7 +173,7 @@ int rdma_send(void *buf, size_t size)
 	int ret; 
 	struct ibv_wc wc;
 
-	ret = rdma_post_send(id, NULL, buf, size, regions_rdma.mr_send_buf, send_flags);
+	ret = rdma_post_send(id, NULL, buf, size, regions_rdma.mr_send_buf, send_flags | IBV_SEND_SIGNALED);
 	if (ret) {
 		perror("rdma_post_send");
 		goto out;
@@ -248,7 +324,7 @@ out:
 }
 
 struct disagg_regions_rdma *
-init_rdma(const char *serverIP, const char *port)
+init_rdma(const char *serverIP, const char *port, const struct rdma_window *cnfg)
 {
 	struct rdma_addrinfo hints, *res;
 	struct ibv_qp_init_attr init_attr;
@@ -258,6 +334,18 @@ init_rdma(const char *serverIP, const char *port)
 
 	printf("rdma_server: start\n");
 
+	if (cnfg && cnfg->sq_depth > 1) {
+		window.sq_depth = (cnfg->sq_depth < MAX_SQ_DEPTH) ? cnfg->sq_depth : MAX_SQ_DEPTH;
+		window.chunk_size = cnfg->chunk_size ? cnfg->chunk_size : DEFAULT_CHUNK_SIZE;
+		window.signal_every = cnfg->signal_every ? cnfg->signal_every : cnfg->sq_depth / 2;
+
+		// At least one work request in flight has to be signalled, otherwise the window never opens again
+		if (window.signal_every > window.sq_depth)
+			window.signal_every = window.sq_depth;
+		printf("rdma_server: windowed mode, send queue depth %u, chunk size %zu, signalling every %u\n", 
+				window.sq_depth, window.chunk_size, window.signal_every);
+	}
+
 	// Uses serverIP and port to get address informations
 	memset(&hints, 0, sizeof hints);
 	hints.ai_flags = RAI_PASSIVE;
@@ -271,9 +359,12 @@ init_rdma(const char *serverIP, const char *port)
 	// Configures attributes
 	memset(&init_attr, 0, sizeof init_attr);
 	init_attr.cap.max_send_wr = init_attr.cap.max_recv_wr = NUM_RECV_BUFS / 2;
+	if (window.sq_depth > init_attr.cap.max_send_wr)
+		init_attr.cap.max_send_wr = window.sq_depth;
 	init_attr.cap.max_send_sge = init_attr.cap.max_recv_sge = 1;
 	init_attr.cap.max_inline_data = BUFS_SIZE;
-	init_attr.sq_sig_all = 1;
+	// Work requests are signalled selectively, see IBV_SEND_SIGNALED
+	init_attr.sq_sig_all = 0;
 	init_attr.qp_type = IBV_QPT_RC;
 	ret = rdma_create_ep(&listen_id, res, NULL, &init_attr);
 	if (ret) {
@@ -11,7 +11,28 @@
 #define BUFS_SIZE 92
 #define DMA_SIZE (1024*64) 
 
-struct disagg_regions_rdma *init_rdma(const char *serverIP, const char *port);
+// Windowed mode defaults
+#define DEFAULT_CHUNK_SIZE (1024*8)
+#define MAX_SQ_DEPTH 128
+#define WC_BATCH 16
+
+/*
+ * Configuration of the send queue for rdma_write/rdma_read
+ * With sq_depth == 1, every transfer is a single blocking, signalled work request (the original behaviour).
+ * Otherwise (windowed mode), a transfer is split into chunks of chunk_size, posted as separate work requests, 
+ * of which up to sq_depth are in flight; only every signal_every-th (and the last) is signalled, and the
+ * completions are polled in batches of up to WC_BATCH.
+ */
+struct rdma_window {
+	unsigned sq_depth;
+	size_t chunk_size;
+	unsigned signal_every;
+};
+
+/*
+ * Sets up the connection; @window configures the send queue (NULL for the blocking mode)
+ */
+struct disagg_regions_rdma *init_rdma(const char *serverIP, const char *port, const struct rdma_window *window);
 
 /* 
  * Send the @buf of @size to remote 
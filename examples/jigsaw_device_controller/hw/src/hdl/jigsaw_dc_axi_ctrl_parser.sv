@@ -9,6 +9,7 @@ import lynxTypes::*;
  * @param[in] aresetn Active low reset signal
  * @param[in/out] axi_ctrl AXI Lite Control signal
  * @param[out] coyote_pid: PID of the Coyote process
+ * @param[out] snap_vaddr/snap_period/snap_req: debug counter snapshot control, see counter_snapshot
  */
 module jigsaw_dc_axi_ctrl_parser (
   input  logic                        aclk,
@@ -18,14 +19,17 @@ module jigsaw_dc_axi_ctrl_parser (
 
   output logic [PID_BITS - 1:0] coyote_pid,
   output logic [VADDR_BITS-1:0] remote_vaddr,
-  input  logic [23:0][AXIL_DATA_BITS-1:0] debug_counters
+  input  logic [23:0][AXIL_DATA_BITS-1:0] debug_counters,
+  output logic [VADDR_BITS-1:0] snap_vaddr,
+  output logic [31:0] snap_period,
+  output logic snap_req
 );
 
 /////////////////////////////////////
 //          CONSTANTS             //
 ///////////////////////////////////
 localparam integer DEBUG_COUNT = 24;
-localparam integer N_REGS = 2 + DEBUG_COUNT;
+localparam integer N_REGS = 5 + DEBUG_COUNT;
 localparam integer ADDR_MSB = $clog2(N_REGS);
 localparam integer ADDR_LSB = $clog2(AXIL_DATA_BITS/8);
 localparam integer AXI_ADDR_BITS = ADDR_LSB + ADDR_MSB;
@@ -56,6 +60,12 @@ localparam COYOTE_PID_REG = 0;
 localparam REMOTE_VADDR_REG = 1;
 // 2..25 (RO) - txn_generator debug counters
 localparam DEBUG_BASE_REG = 2;
+// 26 (RW) - Host buffer for debug counter snapshots (0 disables them)
+localparam SNAP_VADDR_REG = DEBUG_BASE_REG + DEBUG_COUNT;
+// 27 (RW) - Cycles between periodic snapshots (0: on request only)
+localparam SNAP_PERIOD_REG = SNAP_VADDR_REG + 1;
+// 28 (W) - Writing 1 requests a snapshot
+localparam SNAP_CTRL_REG = SNAP_VADDR_REG + 2;
 
 /////////////////////////////////////
 //         WRITE PROCESS          //
@@ -81,6 +91,18 @@ always_ff @(posedge aclk) begin
               ctrl_reg[REMOTE_VADDR_REG][(i*8)+:8] <= axi_ctrl.wdata[(i*8)+:8];
             end
           end
+        SNAP_VADDR_REG:
+          for (int i = 0; i < (AXIL_DATA_BITS/8); i++) begin
+            if(axi_ctrl.wstrb[i]) begin
+              ctrl_reg[SNAP_VADDR_REG][(i*8)+:8] <= axi_ctrl.wdata[(i*8)+:8];
+            end
+          end
+        SNAP_PERIOD_REG:
+          for (int i = 0; i < (AXIL_DATA_BITS/8); i++) begin
+            if(axi_ctrl.wstrb[i]) begin
+              ctrl_reg[SNAP_PERIOD_REG][(i*8)+:8] <= axi_ctrl.wdata[(i*8)+:8];
+            end
+          end
         default: ;
       endcase
     end
@@ -104,6 +126,10 @@ always_ff @(posedge aclk) begin
           axi_rdata <= ctrl_reg[COYOTE_PID_REG];
         REMOTE_VADDR_REG:
           axi_rdata <= ctrl_reg[REMOTE_VADDR_REG];
+        SNAP_VADDR_REG:
+          axi_rdata <= ctrl_reg[SNAP_VADDR_REG];
+        SNAP_PERIOD_REG:
+          axi_rdata <= ctrl_reg[SNAP_PERIOD_REG];
         default:
           if ((axi_araddr[ADDR_LSB+:ADDR_MSB] >= DEBUG_BASE_REG) &&
               (axi_araddr[ADDR_LSB+:ADDR_MSB] < DEBUG_BASE_REG + DEBUG_COUNT)) begin
@@ -120,6 +146,10 @@ end
 always_comb begin
   coyote_pid = ctrl_reg[COYOTE_PID_REG];
   remote_vaddr = ctrl_reg[REMOTE_VADDR_REG];
+  snap_vaddr = ctrl_reg[SNAP_VADDR_REG];
+  snap_period = ctrl_reg[SNAP_PERIOD_REG][31:0];
+  // Single-cycle request, on a write of 1 to the control register
+  snap_req = ctrl_reg_wren && (axi_awaddr[ADDR_LSB+:ADDR_MSB] == SNAP_CTRL_REG) && axi_ctrl.wstrb[0] && axi_ctrl.wdata[0];
 end
 
 /////////////////////////////////////
@@ -17,36 +17,36 @@
 
 #include <array>
 #include <atomic>
-#include <cerrno>
 #include <chrono>
+#include <condition_variable>
 #include <csignal>
 #include <cstring>
 #include <cstdlib>
 #include <functional>
 #include <iomanip>
 #include <iostream>
+#include <mutex>
 #include <stdexcept>
 #include <string>
 #include <thread>
+#include <vector>
 
-#include <arpa/inet.h>
-#include <netinet/in.h>
-#include <sys/select.h>
-#include <sys/socket.h>
 #include <unistd.h>
 
 #include <coyote/cThread.hpp>
 
+#include "telemetry.hpp"
+
 // ---------------------------------------------------------------------------
 // Constants
 // ---------------------------------------------------------------------------
 #define DEFAULT_VFPGA_ID     0
 // The host_controller's HW DMAs straight into this RDMA-registered buffer,
 // so it must hold the largest single h2d transfer driven by the host.
-// JIGSAW_TRACE_MAX_BYTES in traces.hpp (used by jigsaw_host_controller/
-// sw_no_vm) is currently 14550656 bytes; rounded up to a 2 MiB hugepage
-// multiple gives 16 MiB. Bump in lockstep if extract_traces.py emits
-// larger events.
+// The largest event of examples/jigsaw_traces/full (replayed by
+// jigsaw_host_controller/sw_no_vm) is currently 14550656 bytes; rounded up
+// to a 2 MiB hugepage multiple gives 16 MiB. Bump in lockstep if larger
+// traces are added.
 #define RDMA_BUFFER_SIZE     (16U * 1024 * 1024)  // 16 MiB
 static constexpr uint16_t DEBUG_PORT_OFFSET = 1;
 
@@ -88,14 +88,83 @@ static const std::array<const char *, DC_DEBUG_COUNT> DC_DEBUG_NAMES = {
     "last_rdma_pkt_len",
 };
 
-static void dump_debug_counters(const coyote::cThread &ct, const std::string &label = "") {
-    std::cout << "\n--- DEVICE LOCAL DEBUG CSRS";
+// Debug counter snapshots (counter_snapshot in HW): on request, the vFPGA
+// DMAs the whole counter bank into a host buffer in one burst. Requesting
+// one is a single posted write, so dumping no longer issues 24 non-posted
+// CSR reads that compete with the data path being measured.
+// Layout: word 0 = sequence number, words 1..24 = counters, last word =
+// sequence number again (written last).
+static constexpr uint32_t DC_SNAP_VADDR_REG  = 26;
+static constexpr uint32_t DC_SNAP_PERIOD_REG = 27;
+static constexpr uint32_t DC_SNAP_CTRL_REG   = 28;
+static constexpr uint32_t DC_SNAP_WORDS      = 32;  // 4 x 512-bit beats
+static constexpr auto DC_SNAP_TIMEOUT = std::chrono::milliseconds(10);
+
+static volatile uint64_t *g_snap_buf = nullptr;
+static uint64_t g_snap_seq = 0;
+static std::mutex g_snap_mtx;
+
+static void setup_debug_snapshots(coyote::cThread &ct) {
+    void *buf = ct.getMem({coyote::CoyoteAllocType::REG, DC_SNAP_WORDS * sizeof(uint64_t)});
+    if (!buf) {
+        throw std::runtime_error("could not allocate debug snapshot buffer");
+    }
+    std::memset(buf, 0, DC_SNAP_WORDS * sizeof(uint64_t));
+    g_snap_buf = static_cast<volatile uint64_t *>(buf);
+    ct.setCSR(0, DC_SNAP_PERIOD_REG);
+    ct.setCSR(reinterpret_cast<uint64_t>(buf), DC_SNAP_VADDR_REG);
+}
+
+// Requests a snapshot and waits for it to land; false if none arrived in time
+static bool read_debug_snapshot(coyote::cThread &ct, uint64_t *values) {
+    if (!g_snap_buf) {
+        return false;
+    }
+    ct.setCSR(1, DC_SNAP_CTRL_REG);
+    const auto deadline = std::chrono::steady_clock::now() + DC_SNAP_TIMEOUT;
+    do {
+        // Trailing sequence number first, leading one last: if they match, no
+        // newer snapshot started landing while the counters were copied
+        uint64_t seq = g_snap_buf[DC_SNAP_WORDS - 1];
+        if (seq > g_snap_seq) {
+            std::atomic_thread_fence(std::memory_order_acquire);
+            for (uint32_t i = 0; i < DC_DEBUG_COUNT; i++) {
+                values[i] = g_snap_buf[1 + i];
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (g_snap_buf[0] == seq) {
+                g_snap_seq = seq;
+                return true;
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(10));
+    } while (std::chrono::steady_clock::now() < deadline);
+    return false;
+}
+
+// Reads the counter bank from a snapshot, falling back to CSR reads
+static bool read_debug_counters(coyote::cThread &ct, uint64_t *values) {
+    std::lock_guard<std::mutex> lock(g_snap_mtx);
+    if (read_debug_snapshot(ct, values)) {
+        return true;
+    }
+    for (uint32_t i = 0; i < DC_DEBUG_COUNT; i++) {
+        values[i] = ct.getCSR(DC_DEBUG_BASE + i);
+    }
+    return false;
+}
+
+static void dump_debug_counters(coyote::cThread &ct, const std::string &label = "") {
+    std::array<uint64_t, DC_DEBUG_COUNT> values;
+    bool snapshot = read_debug_counters(ct, values.data());
+
+    std::cout << "\n--- DEVICE LOCAL DEBUG " << (snapshot ? "SNAPSHOT" : "CSRS");
     if (!label.empty()) {
         std::cout << " [" << label << "]";
     }
     std::cout << " ---" << std::endl;
     for (uint32_t i = 0; i < DC_DEBUG_COUNT; i++) {
-        uint64_t value = ct.getCSR(DC_DEBUG_BASE + i);
+        uint64_t value = values[i];
         std::cout << "DC_DBG[" << std::setw(2) << i << "] "
                   << std::left << std::setw(26) << DC_DEBUG_NAMES[i]
                   << " = 0x" << std::hex << value << std::dec
@@ -104,157 +173,66 @@ static void dump_debug_counters(const coyote::cThread &ct, const std::string &la
     std::cout << std::right;
 }
 
-static bool starts_with(const std::string &value, const char *prefix) {
-    return value.rfind(prefix, 0) == 0;
-}
-
-static int make_debug_server_socket(uint16_t port) {
-    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
-    if (fd < 0) {
-        throw std::runtime_error("debug socket creation failed");
-    }
-
-    int one = 1;
-    if (::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) < 0) {
-        ::close(fd);
-        throw std::runtime_error("debug socket setsockopt failed");
-    }
-
-    sockaddr_in addr = {};
-    addr.sin_family = AF_INET;
-    addr.sin_addr.s_addr = htonl(INADDR_ANY);
-    addr.sin_port = htons(port);
+// Run tracking for the telemetry commands (START/DONE from sw_no_vm); while
+// a run is active, the watchdog dumps the counters every interval
+struct DebugRunState {
+    std::mutex mtx;
+    std::condition_variable cv;
+    bool active = false;
+    bool stopping = false;
+    uint64_t generation = 0;
+    std::string label;
+};
 
-    if (::bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0) {
-        ::close(fd);
-        throw std::runtime_error("debug socket bind failed");
-    }
-    if (::listen(fd, 1) < 0) {
-        ::close(fd);
-        throw std::runtime_error("debug socket listen failed");
+static void handle_debug_command(coyote::cThread &ct, DebugRunState &run,
+                                 telem_type type, const std::string &label) {
+    switch (type) {
+    case TELEM_START: {
+        std::lock_guard<std::mutex> lock(run.mtx);
+        run.label = label;
+        run.active = true;
+        run.generation++;
+        run.cv.notify_all();
+        std::cout << "\n--- DEVICE DEBUG RUN START [" << label << "] ---" << std::endl;
+        break;
     }
-    return fd;
-}
-
-static void process_debug_message(const coyote::cThread &ct,
-                                  const std::string &message,
-                                  bool &run_active,
-                                  std::string &active_label,
-                                  std::chrono::steady_clock::time_point &next_watchdog,
-                                  std::chrono::microseconds watchdog_interval,
-                                  std::atomic<bool> &keep_running) {
-    if (starts_with(message, "START ")) {
-        active_label = message.substr(6);
-        run_active = true;
-        next_watchdog = std::chrono::steady_clock::now() + watchdog_interval;
-        std::cout << "\n--- DEVICE DEBUG RUN START [" << active_label << "] ---" << std::endl;
-    } else if (starts_with(message, "DONE ")) {
-        std::string label = message.substr(5);
+    case TELEM_DONE: {
         dump_debug_counters(ct, "DONE " + label);
-        run_active = false;
-    } else if (starts_with(message, "DUMP ")) {
-        dump_debug_counters(ct, message.substr(5));
-    } else if (message == "STOP") {
-        keep_running.store(false);
+        std::lock_guard<std::mutex> lock(run.mtx);
+        run.active = false;
+        run.generation++;
+        run.cv.notify_all();
+        break;
+    }
+    case TELEM_DUMP:
+        dump_debug_counters(ct, label);
+        break;
+    default:
+        break;
     }
 }
 
-static void debug_server_loop(const coyote::cThread &ct,
-                              std::atomic<bool> &keep_running,
-                              std::atomic<bool> &server_ready,
-                              std::atomic<bool> &server_failed,
-                              uint16_t port,
-                              uint64_t watchdog_us) {
-    int listen_fd = -1;
-    int client_fd = -1;
-    std::string rx_buffer;
-    bool run_active = false;
-    std::string active_label;
-    const auto watchdog_interval = std::chrono::microseconds(watchdog_us);
-    auto next_watchdog = std::chrono::steady_clock::now() + watchdog_interval;
-
-    try {
-        listen_fd = make_debug_server_socket(port);
-        std::cout << "Device debug server listening on port " << port << std::endl;
-        server_ready.store(true);
-
-        while (keep_running.load()) {
-            fd_set readfds;
-            FD_ZERO(&readfds);
-            FD_SET(listen_fd, &readfds);
-            int max_fd = listen_fd;
-            if (client_fd >= 0) {
-                FD_SET(client_fd, &readfds);
-                if (client_fd > max_fd) {
-                    max_fd = client_fd;
-                }
-            }
-
-            timeval tv = {};
-            tv.tv_sec = 0;
-            tv.tv_usec = 100000;
-            int rc = ::select(max_fd + 1, &readfds, nullptr, nullptr, &tv);
-            if (rc < 0) {
-                if (errno == EINTR) {
-                    continue;
-                }
-                throw std::runtime_error("debug socket select failed");
-            }
-
-            if (run_active && std::chrono::steady_clock::now() >= next_watchdog) {
-                dump_debug_counters(ct, "WATCHDOG " + active_label);
-                next_watchdog = std::chrono::steady_clock::now() + watchdog_interval;
-            }
-
-            if (rc == 0) {
-                continue;
-            }
-
-            if (FD_ISSET(listen_fd, &readfds)) {
-                int new_fd = ::accept(listen_fd, nullptr, nullptr);
-                if (new_fd >= 0) {
-                    if (client_fd >= 0) {
-                        ::close(client_fd);
-                    }
-                    client_fd = new_fd;
-                    rx_buffer.clear();
-                    std::cout << "Device debug client connected." << std::endl;
-                }
-            }
-
-            if (client_fd >= 0 && FD_ISSET(client_fd, &readfds)) {
-                char data[512];
-                ssize_t n = ::recv(client_fd, data, sizeof(data), 0);
-                if (n <= 0) {
-                    ::close(client_fd);
-                    client_fd = -1;
-                    rx_buffer.clear();
-                    continue;
-                }
+static void debug_watchdog_loop(coyote::cThread &ct, DebugRunState &run,
+                                std::chrono::microseconds interval) {
+    std::unique_lock<std::mutex> lock(run.mtx);
+    while (!run.stopping) {
+        if (!run.active) {
+            run.cv.wait(lock);
+            continue;
+        }
 
-                rx_buffer.append(data, static_cast<size_t>(n));
-                size_t pos = 0;
-                while ((pos = rx_buffer.find('\n')) != std::string::npos) {
-                    std::string line = rx_buffer.substr(0, pos);
-                    rx_buffer.erase(0, pos + 1);
-                    if (!line.empty() && line.back() == '\r') {
-                        line.pop_back();
-                    }
-                    process_debug_message(ct, line, run_active, active_label,
-                                          next_watchdog, watchdog_interval, keep_running);
-                }
-            }
+        // A new START or a DONE restarts the wait
+        uint64_t generation = run.generation;
+        if (run.cv.wait_for(lock, interval, [&] {
+                return run.stopping || run.generation != generation;
+            })) {
+            continue;
         }
-    } catch (const std::exception &e) {
-        server_failed.store(true);
-        std::cerr << "Device debug server error: " << e.what() << std::endl;
-    }
 
-    if (client_fd >= 0) {
-        ::close(client_fd);
-    }
-    if (listen_fd >= 0) {
-        ::close(listen_fd);
+        std::string label = run.label;
+        lock.unlock();
+        dump_debug_counters(ct, "WATCHDOG " + label);
+        lock.lock();
     }
 }
 
@@ -263,6 +241,7 @@ static void debug_server_loop(const coyote::cThread &ct,
 // ---------------------------------------------------------------------------
 int main(int argc, char *argv[]) {
     bool dump_debug = false;
+    bool telemetry = false;
     bool sigusr1_debug = false;
     uint64_t dump_debug_us = 1000000;
 
@@ -271,6 +250,8 @@ int main(int argc, char *argv[]) {
             sigusr1_debug = true;
         } else if (std::strcmp(argv[i], "--dump-debug") == 0) {
             dump_debug = true;
+        } else if (std::strcmp(argv[i], "--telemetry") == 0) {
+            telemetry = true;
         } else if (std::strcmp(argv[i], "--dump-debug-us") == 0) {
             dump_debug = true;
             if (i + 1 < argc && std::strncmp(argv[i + 1], "--", 2) != 0) {
@@ -287,7 +268,7 @@ int main(int argc, char *argv[]) {
             }
         } else {
             std::cerr << "Usage: " << argv[0]
-                      << " [--debug] [--dump-debug] [--dump-debug-us <us>]"
+                      << " [--debug] [--dump-debug] [--dump-debug-us <us>] [--telemetry]"
                       << std::endl;
             return EXIT_FAILURE;
         }
@@ -326,6 +307,10 @@ int main(int argc, char *argv[]) {
     std::cout << "  Using RDMA WRITE" << std::endl;
     std::cout << std::endl;
 
+    if (sigusr1_debug || dump_debug || telemetry) {
+        setup_debug_snapshots(ct);
+    }
+
     // SIGUSR1 → snapshot device-side debug counters (opt-in via --debug;
     // measurement runs stay clean). The existing --dump-debug TCP server
     // only fires while a client (sw_no_vm) has sent START, so it produces
@@ -333,7 +318,7 @@ int main(int argc, char *argv[]) {
     // on demand:  kill -USR1 <device-pid>
     if (sigusr1_debug) {
         static std::atomic<bool> sigusr1_pending{false};
-        static const coyote::cThread *sigusr1_ct = &ct;
+        static coyote::cThread *sigusr1_ct = &ct;
         std::signal(SIGUSR1, [](int) { sigusr1_pending.store(true); });
         std::cout << "Device debug SIGUSR1 armed (PID " << getpid()
                   << " — kill -USR1 " << getpid() << " for snapshot)" << std::endl;
@@ -348,28 +333,26 @@ int main(int argc, char *argv[]) {
         sig_dumper.detach();
     }
 
-    std::atomic<bool> keep_dumping{dump_debug};
-    std::atomic<bool> debug_server_ready{!dump_debug};
-    std::atomic<bool> debug_server_failed{false};
-    std::thread debug_thread;
+    // Telemetry server (--dump-debug or --telemetry): run commands from
+    // sw_no_vm and counter streams for any number of clients; the watchdog
+    // only runs with --dump-debug
+    std::vector<std::string> debug_names(DC_DEBUG_NAMES.begin(), DC_DEBUG_NAMES.end());
+    DebugRunState debug_run;
+    TelemetryServer telemetry_server(
+        debug_names,
+        [&ct](std::vector<uint64_t> &values) { read_debug_counters(ct, values.data()); },
+        [&ct, &debug_run](telem_type type, const std::string &label) {
+            handle_debug_command(ct, debug_run, type, label);
+        });
+    std::thread watchdog_thread;
+    if (dump_debug || telemetry) {
+        uint16_t port = static_cast<uint16_t>(coyote::DEF_PORT + DEBUG_PORT_OFFSET);
+        telemetry_server.start(port);
+        std::cout << "Device telemetry server listening on port " << port << std::endl;
+    }
     if (dump_debug) {
-        debug_thread = std::thread(debug_server_loop,
-                                   std::cref(ct),
-                                   std::ref(keep_dumping),
-                                   std::ref(debug_server_ready),
-                                   std::ref(debug_server_failed),
-                                   static_cast<uint16_t>(coyote::DEF_PORT + DEBUG_PORT_OFFSET),
-                                   dump_debug_us);
-        while (!debug_server_ready.load() && !debug_server_failed.load()) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(1));
-        }
-        if (debug_server_failed.load()) {
-            keep_dumping.store(false);
-            if (debug_thread.joinable()) {
-                debug_thread.join();
-            }
-            throw std::runtime_error("device debug server failed to start");
-        }
+        watchdog_thread = std::thread(debug_watchdog_loop, std::ref(ct), std::ref(debug_run),
+                                      std::chrono::microseconds(dump_debug_us));
     }
 
     // Signal host that we are ready
@@ -378,9 +361,14 @@ int main(int argc, char *argv[]) {
 
     // Wait for host to signal completion
     ct.connSync(false);
-    keep_dumping.store(false);
-    if (debug_thread.joinable()) {
-        debug_thread.join();
+    telemetry_server.stop();
+    if (watchdog_thread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(debug_run.mtx);
+            debug_run.stopping = true;
+        }
+        debug_run.cv.notify_all();
+        watchdog_thread.join();
     }
     std::cout << "Host signalled completion." << std::endl;
 
@@ -15,6 +15,7 @@ import lynxTypes::*;
  * @param[in] mmio_write_done: write done signal for MMIO write request
  * @param[in] mmio_read_done: read done signal for MMIO read response
  * @param[out] coyote_pid: PID of the Coyote process on the host
+ * @param[out] snap_vaddr/snap_period/snap_req: debug counter snapshot control, see counter_snapshot
  */
 module jigsaw_hc_axi_ctrl_parser (
   input  logic                        aclk,
@@ -34,14 +35,17 @@ module jigsaw_hc_axi_ctrl_parser (
   output logic [63:0] mmio_data,
   input logic [63:0] mmio_read_data_in,
   input logic mmio_read_data_in_valid,
-  input logic [23:0][AXIL_DATA_BITS-1:0] debug_counters
+  input logic [23:0][AXIL_DATA_BITS-1:0] debug_counters,
+  output logic [VADDR_BITS-1:0] snap_vaddr,
+  output logic [31:0] snap_period,
+  output logic snap_req
 );
 
 /////////////////////////////////////
 //          CONSTANTS             //
 ///////////////////////////////////
 localparam integer DEBUG_COUNT = 24;
-localparam integer N_REGS = 11 + DEBUG_COUNT;
+localparam integer N_REGS = 15 + DEBUG_COUNT;
 localparam integer ADDR_MSB = $clog2(N_REGS);
 localparam integer ADDR_LSB = $clog2(AXIL_DATA_BITS/8);
 localparam integer AXI_ADDR_BITS = ADDR_LSB + ADDR_MSB;
@@ -94,8 +98,19 @@ localparam DEBUG_BASE_REG = 10;
 // 34 (RW) - FIFO overflow sticky bit. HW sets to 1 if a SW push to MMIO_CTRL_REG
 //   arrives while the request FIFO is full (request was dropped). SW clears
 //   by writing 0. Diagnostic only — with FIFO_DEPTH=32 and the current SW
-//   pattern (max 7-deep burst), this should never fire in practice.
+//   pattern (max 7-deep burst), this should never fire in practice. SW that
+//   respects the credits in MMIO_FIFO_CREDITS_REG never triggers it.
 localparam MMIO_FIFO_DROPPED_REG = DEBUG_BASE_REG + DEBUG_COUNT;
+// 35 (RW) - Host buffer for debug counter snapshots (0 disables them)
+localparam SNAP_VADDR_REG = MMIO_FIFO_DROPPED_REG + 1;
+// 36 (RW) - Cycles between periodic snapshots (0: on request only)
+localparam SNAP_PERIOD_REG = MMIO_FIFO_DROPPED_REG + 2;
+// 37 (W) - Writing 1 requests a snapshot
+localparam SNAP_CTRL_REG = MMIO_FIFO_DROPPED_REG + 3;
+// 38 (RO) - Request FIFO credits: [31:0] requests popped since reset (wraps),
+//   [47:32] FIFO depth. SW counts its own pushes and only pushes while
+//   pushed - popped < depth, so it backs off instead of overflowing the FIFO.
+localparam MMIO_FIFO_CREDITS_REG = MMIO_FIFO_DROPPED_REG + 4;
 
 /////////////////////////////////////
 //        REQUEST FIFO            //
@@ -115,6 +130,7 @@ localparam integer ENTRY_W    = 8 + 64 + 64; // op | addr | data
 reg  [ENTRY_W-1:0] req_fifo [0:FIFO_DEPTH-1];
 reg  [FIFO_AW:0]   fifo_wptr;
 reg  [FIFO_AW:0]   fifo_rptr;
+reg  [31:0]        fifo_popped;
 
 wire fifo_empty = (fifo_wptr == fifo_rptr);
 wire fifo_full  = (fifo_wptr[FIFO_AW] != fifo_rptr[FIFO_AW])
@@ -138,6 +154,7 @@ always_ff @(posedge aclk) begin
     if (!aresetn) begin
         fifo_wptr <= 0;
         fifo_rptr <= 0;
+        fifo_popped <= 0;
     end else begin
         if (fifo_push) begin
             req_fifo[fifo_wptr[FIFO_AW-1:0]] <= {push_data, push_addr, push_op};
@@ -145,6 +162,7 @@ always_ff @(posedge aclk) begin
         end
         if (fifo_pop) begin
             fifo_rptr <= fifo_rptr + 1'b1;
+            fifo_popped <= fifo_popped + 1'b1;
         end
     end
 end
@@ -231,6 +249,18 @@ always_ff @(posedge aclk) begin
               ctrl_reg[MMIO_FIFO_DROPPED_REG][(i*8)+:8] <= axi_ctrl.wdata[(i*8)+:8];
             end
           end
+        SNAP_VADDR_REG:   // Debug counter snapshot buffer
+          for (int i = 0; i < (AXIL_DATA_BITS/8); i++) begin
+            if(axi_ctrl.wstrb[i]) begin
+              ctrl_reg[SNAP_VADDR_REG][(i*8)+:8] <= axi_ctrl.wdata[(i*8)+:8];
+            end
+          end
+        SNAP_PERIOD_REG:  // Debug counter snapshot period
+          for (int i = 0; i < (AXIL_DATA_BITS/8); i++) begin
+            if(axi_ctrl.wstrb[i]) begin
+              ctrl_reg[SNAP_PERIOD_REG][(i*8)+:8] <= axi_ctrl.wdata[(i*8)+:8];
+            end
+          end
         default: ;
       endcase
     end
@@ -304,6 +334,12 @@ always_ff @(posedge aclk) begin
           axi_rdata <= ctrl_reg[MMIO_READ_DATA_REG];
         MMIO_FIFO_DROPPED_REG: // FIFO overflow sticky bit
           axi_rdata <= ctrl_reg[MMIO_FIFO_DROPPED_REG];
+        SNAP_VADDR_REG:   // Debug counter snapshot buffer
+          axi_rdata <= ctrl_reg[SNAP_VADDR_REG];
+        SNAP_PERIOD_REG:  // Debug counter snapshot period
+          axi_rdata <= ctrl_reg[SNAP_PERIOD_REG];
+        MMIO_FIFO_CREDITS_REG: // Request FIFO credits
+          axi_rdata <= {16'(FIFO_DEPTH), fifo_popped};
         default:
           if ((axi_araddr[ADDR_LSB+:ADDR_MSB] >= DEBUG_BASE_REG) &&
               (axi_araddr[ADDR_LSB+:ADDR_MSB] < DEBUG_BASE_REG + DEBUG_COUNT)) begin
@@ -321,6 +357,10 @@ always_comb begin
   mmio_vaddr = ctrl_reg[MMIO_VADDR_REG];
   coyote_pid = ctrl_reg[COYOTE_PID_REG];
   remote_vaddr = ctrl_reg[REMOTE_VADDR_REG];
+  snap_vaddr = ctrl_reg[SNAP_VADDR_REG];
+  snap_period = ctrl_reg[SNAP_PERIOD_REG][31:0];
+  // Single-cycle request, on a write of 1 to the control register
+  snap_req = ctrl_reg_wren && (axi_awaddr[ADDR_LSB+:ADDR_MSB] == SNAP_CTRL_REG) && axi_ctrl.wstrb[0] && axi_ctrl.wdata[0];
   // Outputs to host_controller now come from the FIFO head, not the staging
   // registers. mmio_ctrl signals "request available"; mmio_clear pops it.
   mmio_ctrl = !fifo_empty;
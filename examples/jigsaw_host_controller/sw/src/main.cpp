@@ -18,8 +18,11 @@
 #include <chrono>
 #include <csignal>
 #include <cstdlib>
+#include <cstring>
 #include <iomanip>
 #include <iostream>
+#include <mutex>
+#include <stdexcept>
 #include <string>
 #include <thread>
 #include <unistd.h>
@@ -29,6 +32,7 @@
 #include <coyote/cThread.hpp>
 
 #include "shmem.hpp"
+#include "doorbell.hpp"
 
 // SIGUSR1 → dump host_controller's 24 local debug counters. Lets us snapshot
 // pipeline state when the daemon appears wedged inside mmio_read polling, so
@@ -50,11 +54,91 @@ static const std::array<const char *, HC_DEBUG_COUNT> HC_DEBUG_NAMES = {
 
 static std::atomic<bool> g_dump_pending{false};
 
+// Debug counter snapshots (counter_snapshot in HW): on request, the vFPGA
+// DMAs the whole counter bank into a host buffer in one burst. Requesting
+// one is a single posted write, so dumping no longer issues 24 non-posted
+// CSR reads that compete with the data path being measured.
+// Layout: word 0 = sequence number, words 1..24 = counters, last word =
+// sequence number again (written last).
+static constexpr uint32_t HC_SNAP_VADDR_REG  = 35;
+static constexpr uint32_t HC_SNAP_PERIOD_REG = 36;
+static constexpr uint32_t HC_SNAP_CTRL_REG   = 37;
+static constexpr uint32_t HC_SNAP_WORDS      = 32;  // 4 x 512-bit beats
+static constexpr auto HC_SNAP_TIMEOUT = std::chrono::milliseconds(10);
+
+static volatile uint64_t *g_snap_buf = nullptr;
+static uint64_t g_snap_seq = 0;
+static std::mutex g_snap_mtx;
+
+static void setup_debug_snapshots(coyote::cThread &ct)
+{
+    void *buf = ct.getMem({coyote::CoyoteAllocType::REG, HC_SNAP_WORDS * sizeof(uint64_t)});
+    if (!buf)
+    {
+        throw std::runtime_error("could not allocate debug snapshot buffer");
+    }
+    std::memset(buf, 0, HC_SNAP_WORDS * sizeof(uint64_t));
+    g_snap_buf = static_cast<volatile uint64_t *>(buf);
+    ct.setCSR(0, HC_SNAP_PERIOD_REG);
+    ct.setCSR(reinterpret_cast<uint64_t>(buf), HC_SNAP_VADDR_REG);
+}
+
+// Requests a snapshot and waits for it to land; false if none arrived in time
+static bool read_debug_snapshot(coyote::cThread &ct, std::array<uint64_t, HC_DEBUG_COUNT> &values)
+{
+    if (!g_snap_buf)
+    {
+        return false;
+    }
+    ct.setCSR(1, HC_SNAP_CTRL_REG);
+    const auto deadline = std::chrono::steady_clock::now() + HC_SNAP_TIMEOUT;
+    do
+    {
+        // Trailing sequence number first, leading one last: if they match, no
+        // newer snapshot started landing while the counters were copied
+        uint64_t seq = g_snap_buf[HC_SNAP_WORDS - 1];
+        if (seq > g_snap_seq)
+        {
+            std::atomic_thread_fence(std::memory_order_acquire);
+            for (uint32_t i = 0; i < HC_DEBUG_COUNT; i++)
+            {
+                values[i] = g_snap_buf[1 + i];
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (g_snap_buf[0] == seq)
+            {
+                g_snap_seq = seq;
+                return true;
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(10));
+    } while (std::chrono::steady_clock::now() < deadline);
+    return false;
+}
+
+// Reads the counter bank from a snapshot, falling back to CSR reads
+static bool read_debug_counters(coyote::cThread &ct, std::array<uint64_t, HC_DEBUG_COUNT> &values)
+{
+    if (read_debug_snapshot(ct, values))
+    {
+        return true;
+    }
+    for (uint32_t i = 0; i < HC_DEBUG_COUNT; i++)
+    {
+        values[i] = ct.getCSR(HC_DEBUG_BASE + i);
+    }
+    return false;
+}
+
 static void dump_hc_debug(coyote::cThread &ct, const char *label)
 {
-    std::cout << "\n--- HC DEBUG CSRS [" << label << "] ---" << std::endl;
+    std::lock_guard<std::mutex> lock(g_snap_mtx);
+    std::array<uint64_t, HC_DEBUG_COUNT> values;
+    bool snapshot = read_debug_counters(ct, values);
+    std::cout << "\n--- HC DEBUG " << (snapshot ? "SNAPSHOT" : "CSRS")
+              << " [" << label << "] ---" << std::endl;
     for (uint32_t i = 0; i < HC_DEBUG_COUNT; i++) {
-        uint64_t v = ct.getCSR(HC_DEBUG_BASE + i);
+        uint64_t v = values[i];
         std::cout << "HC_DBG[" << std::setw(2) << i << "] "
                   << std::left << std::setw(26) << HC_DEBUG_NAMES[i]
                   << " = 0x" << std::hex << v << std::dec
@@ -82,6 +166,7 @@ static void run_app(coyote::cThread &ct, void *mem, bool debug_watcher)
     // ever becomes non-zero (silent request drop). Also serves SIGUSR1 for
     // on-demand snapshots when the daemon looks wedged.
     if (debug_watcher) {
+        setup_debug_snapshots(ct);
         std::signal(SIGUSR1, on_sigusr1);
         std::cout << "HC debug watcher armed (PID " << getpid()
                   << " — kill -USR1 " << getpid() << " for snapshot)" << std::endl;
@@ -111,6 +196,7 @@ static void run_app(coyote::cThread &ct, void *mem, bool debug_watcher)
 int main(int argc, char *argv[]) {
     std::string device_ip;
     bool debug_watcher = false;
+    doorbell_config doorbell;
 
     boost::program_options::options_description opts("Jigsaw Host Controller Options");
     opts.add_options()
@@ -120,6 +206,7 @@ int main(int argc, char *argv[]) {
         ("debug,d",
             boost::program_options::bool_switch(&debug_watcher),
             "Enable the HC debug watcher (SIGUSR1 snapshots + FIFO-drop autodump); off by default");
+    doorbell_add_options(opts, doorbell);
 
     boost::program_options::variables_map vm;
     boost::program_options::store(
@@ -155,12 +242,17 @@ int main(int argc, char *argv[]) {
     std::cout << "  Remote VADDR = 0x" << std::hex << remote_vaddr << std::dec << std::endl;
     std::cout << std::endl;
 
-    // Init shared memory and tell coyote via register write
+    // Init shared memory (from ivshmem-server with irq doorbells) and tell coyote via register write
+    if (doorbell_init(doorbell) != 0) {
+        return EXIT_FAILURE;
+    }
     void *shmem = init_shared_memory();
     if (!shmem) {
         printf("SHMEM: init_shared_memory failed\n");
     }
     ct.userMap(reinterpret_cast<char *>(shmem), SHMEM_SIZE);
+    // Install all the TLB entries now, so the first guest DMAs don't stall on vFPGA page faults
+    ct.prefault(shmem, SHMEM_SIZE);
     
     // Sync with device before starting
     ct.connSync(true);
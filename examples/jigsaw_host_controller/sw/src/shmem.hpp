@@ -33,7 +33,8 @@ enum class HCReg : uint32_t {
     MMIO_OP             = 6,
     MMIO_ADDR           = 7,
     MMIO_DATA           = 8,
-    MMIO_READ_DATA      = 9
+    MMIO_READ_DATA      = 9,
+    MMIO_FIFO_CREDITS   = 38
 };
 
 
@@ -60,6 +61,8 @@ enum class HCReg : uint32_t {
 
 /* Offsets in the shared memory with special values */
 #define OFFSET_PROXY_SHMEM (256)
+#define OFFSET_DOORBELL_PEER (264)  // uint32: ivshmem peer ID + 1 of the daemon, 0 = no doorbell interrupts
+#define MMIO_RING_OFFSET (512)  // struct mmio_ring (jigsaw_ivshmem/mmio_ring.hpp)
 
 void *init_shared_memory();
 
@@ -13,6 +13,7 @@
  *   ./test -i <device_oob_ip>
  */
 
+#include <algorithm>
 #include <array>
 #include <cerrno>
 #include <chrono>
@@ -20,22 +21,23 @@
 #include <cstdlib>
 #include <iomanip>
 #include <iostream>
-#include <map>
+#include <mutex>
 #include <sstream>
 #include <stdexcept>
 #include <string>
 #include <thread>
 #include <vector>
 
-#include <netdb.h>
-#include <sys/socket.h>
 #include <unistd.h>
 
 #include <boost/program_options.hpp>
 
+#include <coyote/cTrace.hpp>
 #include <coyote/cThread.hpp>
 #include <immintrin.h>
 
+#include "telemetry.hpp"
+
 // ---------------------------------------------------------------------------
 // Constants
 // ---------------------------------------------------------------------------
@@ -44,9 +46,9 @@
 #define RDMA_BUFFER_SIZE (2 * 1024 * 1024) // 2 MiB
 static constexpr uint16_t DEBUG_PORT_OFFSET = 1;
 
-// Trace replay buffer must hold the largest single transfer in traces.hpp
-// (JIGSAW_TRACE_MAX_BYTES) plus the 4 KiB offset reserved at the start of
-// the buffer for the protocol header. Rounded up to a 2 MiB hugepage
+// Trace replay buffer must hold the largest single transfer of the replayed
+// traces (cTrace::getMaxBytes()) plus the 4 KiB offset reserved at the start
+// of the buffer for the protocol header. Rounded up to a 2 MiB hugepage
 // multiple so HPF gets a clean allocation.
 static constexpr uint64_t TRACE_DMA_OFFSET = 4096;
 
@@ -62,6 +64,11 @@ static constexpr uint64_t TRACE_DMA_OFFSET = 4096;
 // end-of-test as a sanity check; nonzero means a lost setup write and
 // unreliable results above. Index 34 = DEBUG_BASE_REG (10) + DEBUG_COUNT
 // (24), placed after the read-only debug-counter region.
+//
+// MMIO_FIFO_CREDITS reports the FIFO depth and how many requests HW has
+// popped; write_mmio()/read_mmio() take a credit per push (see
+// acquire_mmio_credit()), so bursts deeper than the FIFO back off instead
+// of tripping MMIO_FIFO_DROPPED.
 enum class HCReg : uint32_t
 {
     MMIO_VADDR = 0,
@@ -74,7 +81,8 @@ enum class HCReg : uint32_t
     MMIO_ADDR = 7,
     MMIO_DATA = 8,
     MMIO_READ_DATA = 9,
-    MMIO_FIFO_DROPPED = 34
+    MMIO_FIFO_DROPPED = 34,
+    MMIO_FIFO_CREDITS = 38
 };
 
 // ---------------------------------------------------------------------------
@@ -149,149 +157,151 @@ static const std::array<const char *, HC_DEBUG_COUNT> HC_DEBUG_NAMES = {
     "last_h2d_len",
 };
 
-static void dump_host_debug_counters(coyote::cThread &ct, const std::string &label = "")
+// Debug counter snapshots (counter_snapshot in HW): on request, the vFPGA
+// DMAs the whole counter bank into a host buffer in one burst. Requesting
+// one is a single posted write, so dumping no longer issues 24 non-posted
+// CSR reads that compete with the data path being measured.
+// Layout: word 0 = sequence number, words 1..24 = counters, last word =
+// sequence number again (written last).
+static constexpr uint32_t HC_SNAP_VADDR_REG  = 35;
+static constexpr uint32_t HC_SNAP_PERIOD_REG = 36;
+static constexpr uint32_t HC_SNAP_CTRL_REG   = 37;
+static constexpr uint32_t HC_SNAP_WORDS      = 32;  // 4 x 512-bit beats
+static constexpr auto HC_SNAP_TIMEOUT = std::chrono::milliseconds(10);
+
+static volatile uint64_t *g_snap_buf = nullptr;
+static uint64_t g_snap_seq = 0;
+static std::mutex g_snap_mtx;
+
+static void setup_debug_snapshots(coyote::cThread &ct)
 {
-    std::cerr << "\n--- HOST LOCAL DEBUG CSRS";
-    if (!label.empty())
-    {
-        std::cerr << " [" << label << "]";
-    }
-    std::cerr << " ---" << std::endl;
-    for (uint32_t i = 0; i < HC_DEBUG_COUNT; i++)
+    void *buf = ct.getMem({coyote::CoyoteAllocType::REG, HC_SNAP_WORDS * sizeof(uint64_t)});
+    if (!buf)
     {
-        uint64_t value = ct.getCSR(HC_DEBUG_BASE + i);
-        std::cerr << "HC_DBG[" << std::setw(2) << i << "] "
-                  << std::left << std::setw(26) << HC_DEBUG_NAMES[i]
-                  << " = 0x" << std::hex << value << std::dec
-                  << " (" << value << ")" << std::endl;
+        throw std::runtime_error("could not allocate debug snapshot buffer");
     }
-    std::cerr << std::right;
+    std::memset(buf, 0, HC_SNAP_WORDS * sizeof(uint64_t));
+    g_snap_buf = static_cast<volatile uint64_t *>(buf);
+    ct.setCSR(0, HC_SNAP_PERIOD_REG);
+    ct.setCSR(reinterpret_cast<uint64_t>(buf), HC_SNAP_VADDR_REG);
 }
 
-static void dump_host_debug_after_run(coyote::cThread &ct, const std::string &label)
+// Requests a snapshot and waits for it to land; false if none arrived in time
+static bool read_debug_snapshot(coyote::cThread &ct, std::array<uint64_t, HC_DEBUG_COUNT> &values)
 {
-    if (g_dump_host_debug)
+    if (!g_snap_buf)
     {
-        dump_host_debug_counters(ct, "DONE " + label);
+        return false;
     }
+    ct.setCSR(1, HC_SNAP_CTRL_REG);
+    const auto deadline = std::chrono::steady_clock::now() + HC_SNAP_TIMEOUT;
+    do
+    {
+        // Trailing sequence number first, leading one last: if they match, no
+        // newer snapshot started landing while the counters were copied
+        uint64_t seq = g_snap_buf[HC_SNAP_WORDS - 1];
+        if (seq > g_snap_seq)
+        {
+            std::atomic_thread_fence(std::memory_order_acquire);
+            for (uint32_t i = 0; i < HC_DEBUG_COUNT; i++)
+            {
+                values[i] = g_snap_buf[1 + i];
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (g_snap_buf[0] == seq)
+            {
+                g_snap_seq = seq;
+                return true;
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(10));
+    } while (std::chrono::steady_clock::now() < deadline);
+    return false;
 }
 
-static void maybe_dump_host_debug(coyote::cThread &ct, uint64_t polls)
+// Reads the counter bank from a snapshot, falling back to CSR reads
+static bool read_debug_counters(coyote::cThread &ct, std::array<uint64_t, HC_DEBUG_COUNT> &values)
 {
-    if (g_dump_host_debug && (polls % 1000000 == 0))
+    if (read_debug_snapshot(ct, values))
+    {
+        return true;
+    }
+    for (uint32_t i = 0; i < HC_DEBUG_COUNT; i++)
     {
-        dump_host_debug_counters(ct, "POLL WAIT");
+        values[i] = ct.getCSR(HC_DEBUG_BASE + i);
     }
+    return false;
 }
 
-class DeviceDebugClient
+static void dump_host_debug_counters(coyote::cThread &ct, const std::string &label = "")
 {
-public:
-    ~DeviceDebugClient()
+    std::lock_guard<std::mutex> lock(g_snap_mtx);
+    std::array<uint64_t, HC_DEBUG_COUNT> values;
+    bool snapshot = read_debug_counters(ct, values);
+    std::cerr << "\n--- HOST LOCAL DEBUG " << (snapshot ? "SNAPSHOT" : "CSRS");
+    if (!label.empty())
     {
-        close();
+        std::cerr << " [" << label << "]";
     }
-
-    void connect_to(const std::string &host, uint16_t port)
+    std::cerr << " ---" << std::endl;
+    for (uint32_t i = 0; i < HC_DEBUG_COUNT; i++)
     {
-        std::string port_str = std::to_string(port);
-        addrinfo hints = {};
-        hints.ai_family = AF_INET;
-        hints.ai_socktype = SOCK_STREAM;
-
-        addrinfo *result = nullptr;
-        int rc = ::getaddrinfo(host.c_str(), port_str.c_str(), &hints, &result);
-        if (rc != 0)
-        {
-            throw std::runtime_error(std::string("debug getaddrinfo failed: ") + gai_strerror(rc));
-        }
-
-        for (int attempt = 0; attempt < 100 && fd_ < 0; attempt++)
-        {
-            for (addrinfo *rp = result; rp != nullptr && fd_ < 0; rp = rp->ai_next)
-            {
-                int candidate = ::socket(rp->ai_family, rp->ai_socktype, rp->ai_protocol);
-                if (candidate < 0)
-                {
-                    continue;
-                }
-                if (::connect(candidate, rp->ai_addr, rp->ai_addrlen) == 0)
-                {
-                    fd_ = candidate;
-                    break;
-                }
-                ::close(candidate);
-            }
-
-            if (fd_ < 0)
-            {
-                std::this_thread::sleep_for(std::chrono::milliseconds(50));
-            }
-        }
-
-        ::freeaddrinfo(result);
-        if (fd_ < 0)
-        {
-            throw std::runtime_error("could not connect to device debug server");
-        }
+        uint64_t value = values[i];
+        std::cerr << "HC_DBG[" << std::setw(2) << i << "] "
+                  << std::left << std::setw(26) << HC_DEBUG_NAMES[i]
+                  << " = 0x" << std::hex << value << std::dec
+                  << " (" << value << ")" << std::endl;
     }
+    std::cerr << std::right;
+}
 
-    bool connected() const
-    {
-        return fd_ >= 0;
-    }
+// Device counters streamed over the telemetry channel (--device_telemetry_us);
+// printed next to the host dumps without a round trip to the device
+static TelemetryClient *g_device_telemetry = nullptr;
 
-    void send_line(const std::string &line)
+static void dump_device_telemetry(const std::string &label)
+{
+    std::vector<std::string> names;
+    std::vector<uint64_t> values;
+    std::chrono::steady_clock::duration age;
+    if (!g_device_telemetry || !g_device_telemetry->latest(names, values, age))
     {
-        if (fd_ < 0)
-        {
-            return;
-        }
-
-        std::string payload = line + "\n";
-        const char *ptr = payload.data();
-        size_t remaining = payload.size();
-        while (remaining != 0)
-        {
-            ssize_t written = ::send(fd_, ptr, remaining, MSG_NOSIGNAL);
-            if (written <= 0)
-            {
-                throw std::runtime_error("could not write to device debug socket");
-            }
-            ptr += written;
-            remaining -= static_cast<size_t>(written);
-        }
+        return;
     }
 
-    void start_run(const std::string &label)
+    std::cerr << "\n--- DEVICE STREAMED DEBUG [" << label << "] ("
+              << std::chrono::duration_cast<std::chrono::microseconds>(age).count()
+              << " us old) ---" << std::endl;
+    for (size_t i = 0; i < values.size(); i++)
     {
-        send_line("START " + label);
+        std::cerr << "DC_DBG[" << std::setw(2) << i << "] "
+                  << std::left << std::setw(26) << names[i]
+                  << " = 0x" << std::hex << values[i] << std::dec
+                  << " (" << values[i] << ")" << std::endl;
     }
+    std::cerr << std::right;
+}
 
-    void done_run(const std::string &label)
+static void dump_host_debug_after_run(coyote::cThread &ct, const std::string &label)
+{
+    if (g_dump_host_debug)
     {
-        send_line("DONE " + label);
+        dump_host_debug_counters(ct, "DONE " + label);
     }
+    dump_device_telemetry("DONE " + label);
+}
 
-    void close()
+static void maybe_dump_host_debug(coyote::cThread &ct, uint64_t polls)
+{
+    if (polls % 1000000 == 0)
     {
-        if (fd_ >= 0)
+        if (g_dump_host_debug)
         {
-            try
-            {
-                send_line("STOP");
-            }
-            catch (...)
-            {
-            }
-            ::close(fd_);
-            fd_ = -1;
+            dump_host_debug_counters(ct, "POLL WAIT");
         }
+        dump_device_telemetry("POLL WAIT");
     }
-
-private:
-    int fd_ = -1;
-};
+}
 
 static std::string make_dma_debug_label(const char *direction, uint32_t size, int iteration)
 {
@@ -324,6 +334,42 @@ static void trace_wait(const char *op, const char *phase, uint64_t addr, uint64_
 // MMIO helpers
 // ---------------------------------------------------------------------------
 
+/**
+ * @brief Take a credit for one push into the HW MMIO request FIFO.
+ *
+ * The pop count is only re-read from MMIO_FIFO_CREDITS once the local
+ * credits (FIFO depth - requests in flight) run out, so the common case
+ * costs no PCIe read. Bitstreams without the register report depth 0 and
+ * are not flow-controlled.
+ */
+static void acquire_mmio_credit(coyote::cThread &ct)
+{
+    static uint32_t depth = 0;
+    static uint32_t pushed = 0;
+    static uint32_t popped = 0;
+    static bool initialized = false;
+
+    if (!initialized)
+    {
+        uint64_t credits = ct.getCSR(static_cast<uint32_t>(HCReg::MMIO_FIFO_CREDITS));
+        depth = (credits >> 32) & 0xffff;
+        popped = pushed = static_cast<uint32_t>(credits);
+        initialized = true;
+    }
+    if (depth == 0)
+    {
+        return;
+    }
+
+    uint64_t wait_polls = 0;
+    while (pushed - popped >= depth)
+    {
+        popped = static_cast<uint32_t>(ct.getCSR(static_cast<uint32_t>(HCReg::MMIO_FIFO_CREDITS)));
+        maybe_dump_host_debug(ct, ++wait_polls);
+    }
+    pushed++;
+}
+
 /**
  * @brief Read a device register over the jigsaw protocol.
  *
@@ -345,6 +391,7 @@ static uint64_t read_mmio(coyote::cThread &ct, void *mem, uint64_t addr)
     // final wait on READ_STATUS=1, which is set when the network response
     // packet arrives (mmio_read_done).
     ct.setCSR(0, static_cast<uint32_t>(HCReg::MMIO_READ_STATUS));
+    acquire_mmio_credit(ct);
     ct.setCSR(0, static_cast<uint32_t>(HCReg::MMIO_OP)); // 0 = Read
     ct.setCSR(addr, static_cast<uint32_t>(HCReg::MMIO_ADDR));
     ct.setCSR(1, static_cast<uint32_t>(HCReg::MMIO_CTRL));
@@ -382,6 +429,9 @@ static uint64_t read_mmio(coyote::cThread &ct, void *mem, uint64_t addr)
  * implicitly waits for the entire enqueued write sequence to drain (the
  * status read can't be dispatched until all preceding FIFO entries are
  * consumed by the host_controller).
+ *
+ * Each push takes a FIFO credit, so a burst deeper than the FIFO waits
+ * for the host_controller to drain it rather than dropping requests.
  */
 static void write_mmio(coyote::cThread &ct, void *mem, uint64_t addr, uint64_t data)
 {
@@ -392,6 +442,7 @@ static void write_mmio(coyote::cThread &ct, void *mem, uint64_t addr, uint64_t d
                   << " data=0x" << data << std::dec << std::endl;
     }
 
+    acquire_mmio_credit(ct);
     ct.setCSR(1, static_cast<uint32_t>(HCReg::MMIO_OP)); // 1 = Write
     ct.setCSR(addr, static_cast<uint32_t>(HCReg::MMIO_ADDR));
     ct.setCSR(data, static_cast<uint32_t>(HCReg::MMIO_DATA));
@@ -509,60 +560,21 @@ static std::pair<double, double> run_computation_test(coyote::cThread &ct, void
 }
 
 // ---------------------------------------------------------------------------
-// Trace Replay (bundled, embedded via traces.hpp)
+// Trace Replay (coyote::cTraceReplay, traces loaded from --traces)
 //
 // Mirrors the trace replay in jigsaw_baseline/sw_no_vm and jigsaw_minus_nw/sw_no_vm.
 // Differences here: device registers are accessed over the jigsaw protocol
 // via write_mmio/read_mmio (RDMA round-trip), and DevReg offsets are byte
 // offsets into the device-side AXI-Lite map.
 // ---------------------------------------------------------------------------
-#include "traces.hpp"
-using namespace jigsaw_traces_ns;
-
 static constexpr uint32_t MIN_DMA_BYTES = 64;
-
-// Round JIGSAW_TRACE_MAX_BYTES + TRACE_DMA_OFFSET up to a 2 MiB hugepage
-// multiple so the HPF allocator can serve it as N contiguous hugepages.
 static constexpr uint64_t HUGEPAGE_BYTES = 2ULL * 1024 * 1024;
-static constexpr uint64_t TRACE_MEM_BYTES =
-    ((JIGSAW_TRACE_MAX_BYTES + TRACE_DMA_OFFSET + HUGEPAGE_BYTES - 1) /
-     HUGEPAGE_BYTES) * HUGEPAGE_BYTES;
-
 static constexpr int TRACE_N_RUNS = 5;
 
-struct TraceResult
-{
-    std::string app;
-    int run_idx;
-    int event_idx;
-    uint8_t kind;
-    uint64_t h2d_size, d2h_size, cycles;
-    double total_us;
-    int original_count;
-};
-
-static uint64_t clamp_dma(uint64_t raw, uint64_t mem_cap)
-{
-    uint64_t sz = (raw > mem_cap) ? mem_cap : raw;
-    // Keep raw==0 as 0 so computation_engine skips that phase entirely.
-    // Non-zero sizes are rounded UP to a cacheline multiple — host RDMA
-    // fetches in 64-byte beats while the device DMA truncates to 64-byte
-    // multiples, so a non-aligned length desyncs the meta/payload pipeline
-    // (observed: h2d=74 wedges the device RDMA SQ).
-    if (sz != 0)
-    {
-        sz = (sz + MIN_DMA_BYTES - 1) & ~static_cast<uint64_t>(MIN_DMA_BYTES - 1);
-        if (sz > mem_cap)
-        {
-            sz = mem_cap & ~static_cast<uint64_t>(MIN_DMA_BYTES - 1);
-        }
-    }
-    return sz;
-}
-
 static void run_trace_benchmark(coyote::cThread &ct, void *mem, uint64_t mem_bytes,
-                                DeviceDebugClient &device_debug,
-                                std::vector<TraceResult> &results)
+                                TelemetryClient &device_debug,
+                                const std::vector<coyote::cTrace> &traces,
+                                std::vector<coyote::cTraceResult> &results)
 {
     uint64_t mem_addr = reinterpret_cast<uint64_t>(mem);
     uint64_t dma_addr = mem_addr + TRACE_DMA_OFFSET;
@@ -570,15 +582,9 @@ static void run_trace_benchmark(coyote::cThread &ct, void *mem, uint64_t mem_byt
 
     ct.setCSR(mem_addr, static_cast<uint32_t>(HCReg::MMIO_VADDR));
 
-    using clk = std::chrono::high_resolution_clock;
-    auto secs = [](auto a, auto b) { return std::chrono::duration<double>(b - a).count(); };
-
-    // CYCLES_COMPUTE is a benchmark-only register (no analogue on a real
-    // accelerator), so it's staged outside the timed window per BUNDLE event.
-    // Per-event addresses and lengths stay inside since they would be set per
-    // request in a real workload too.
-    auto do_bulk = [&](uint32_t size, bool d2h) -> double {
-        auto start = clk::now();
+    // Per-event addresses and lengths stay inside the timed window since they
+    // would be set per request in a real workload too.
+    auto do_bulk = [&](uint32_t size, bool d2h) {
         write_mmio(ct, mem, static_cast<uint64_t>(DevReg::DMA_SRC_ADDR), dma_addr);
         write_mmio(ct, mem, static_cast<uint64_t>(DevReg::DMA_DST_ADDR), dma_addr);
         write_mmio(ct, mem,
@@ -594,21 +600,9 @@ static void run_trace_benchmark(coyote::cThread &ct, void *mem, uint64_t mem_byt
         {
             maybe_dump_host_debug(ct, ++poll_count);
         }
-        auto end = clk::now();
-        return secs(start, end);
     };
 
-    auto do_bundle = [&](uint32_t h2d, uint32_t d2h, uint64_t cycles) -> double {
-        // Synthetic compute-cycle knob: not a real-device register, stage outside.
-        write_mmio(ct, mem, static_cast<uint64_t>(DevReg::CYCLES_COMPUTE), cycles);
-        const uint64_t cycles_readback = read_mmio(ct, mem, static_cast<uint64_t>(DevReg::CYCLES_COMPUTE));
-        if (cycles_readback != cycles) {
-            std::cerr << "[ERROR] CYCLES_COMPUTE readback mismatch: wrote "
-                      << cycles << ", read " << cycles_readback << std::endl;
-            throw std::runtime_error("CYCLES_COMPUTE readback mismatch");
-        }
-
-        auto start = clk::now();
+    auto do_bundle = [&](uint32_t h2d, uint32_t d2h) {
         write_mmio(ct, mem, static_cast<uint64_t>(DevReg::DMA_SRC_ADDR), dma_addr);
         write_mmio(ct, mem, static_cast<uint64_t>(DevReg::DMA_DST_ADDR), dma_addr);
         write_mmio(ct, mem, static_cast<uint64_t>(DevReg::DMA_H2D_LEN), h2d);
@@ -621,130 +615,105 @@ static void run_trace_benchmark(coyote::cThread &ct, void *mem, uint64_t mem_byt
         {
             maybe_dump_host_debug(ct, ++poll_count);
         }
-        auto end = clk::now();
-        return secs(start, end);
     };
 
-    auto kind_str = [](uint8_t k) -> const char * {
+    auto kind_str = [](coyote::CoyoteTraceKind k) -> const char * {
         switch (k) {
-            case TRACE_BULK_H2D: return "BULK_H2D";
-            case TRACE_BULK_D2H: return "BULK_D2H";
-            case TRACE_BUNDLE:   return "BUNDLE  ";
-            default:             return "UNKNOWN ";
+            case coyote::CoyoteTraceKind::BULK_H2D: return "BULK_H2D";
+            case coyote::CoyoteTraceKind::BULK_D2H: return "BULK_D2H";
+            case coyote::CoyoteTraceKind::BUNDLE:   return "BUNDLE  ";
+            default:                                return "UNKNOWN ";
         }
     };
 
-    auto trace_debug_label = [&](const char *app_name, size_t event_idx, const char *kind,
-                                 uint64_t h2d, uint64_t d2h, uint64_t cycles) {
+    const std::string *trace_name = nullptr;
+    auto trace_debug_label = [&](uint64_t event_idx, const coyote::traceEvent &ev,
+                                 uint64_t h2d, uint64_t d2h) {
         std::ostringstream os;
-        os << "TRACE app=" << app_name
+        os << "TRACE app=" << *trace_name
            << " event=" << event_idx
-           << " kind=" << kind
+           << " kind=" << kind_str(ev.kind)
            << " h2d=" << h2d
            << " d2h=" << d2h
-           << " cycles=" << cycles;
+           << " cycles=" << ev.cycles;
         return os.str();
     };
 
-    constexpr size_t n_apps = sizeof(jigsaw_traces) / sizeof(jigsaw_traces[0]);
-    for (size_t a = 0; a < n_apps; a++)
-    {
-        const auto &app = jigsaw_traces[a];
-        std::cerr << "[trace] " << app.name << " (" << app.n << " events, "
-                  << TRACE_N_RUNS << " runs)" << std::endl;
+    // CYCLES_COMPUTE is a benchmark-only register (no analogue on a real
+    // accelerator), so it's staged in the (untimed) prepare step per BUNDLE
+    // event, together with the device debug sideband.
+    auto prepare = [&](uint64_t i, const coyote::traceEvent &ev, uint64_t h2d, uint64_t d2h) {
+        std::cerr << "[trace]   " << *trace_name
+                  << " ev=" << i
+                  << " kind=" << kind_str(ev.kind)
+                  << " h2d_raw=" << ev.h2d_size
+                  << " d2h_raw=" << ev.d2h_size
+                  << " cycles=" << ev.cycles
+                  << " (h2d=" << h2d << " d2h=" << d2h << ")" << std::endl;
+
+        if (ev.kind == coyote::CoyoteTraceKind::BUNDLE) {
+            write_mmio(ct, mem, static_cast<uint64_t>(DevReg::CYCLES_COMPUTE), ev.cycles);
+            const uint64_t cycles_readback = read_mmio(ct, mem, static_cast<uint64_t>(DevReg::CYCLES_COMPUTE));
+            if (cycles_readback != ev.cycles) {
+                std::cerr << "[ERROR] CYCLES_COMPUTE readback mismatch: wrote "
+                          << ev.cycles << ", read " << cycles_readback << std::endl;
+                throw std::runtime_error("CYCLES_COMPUTE readback mismatch");
+            }
+        }
+
+        if (device_debug.connected())
+        {
+            device_debug.start_run(trace_debug_label(i, ev, h2d, d2h));
+        }
+    };
 
-      for (int run = 0; run < TRACE_N_RUNS; run++)
-      {
-        std::cerr << "[trace] " << app.name << " run " << run << "/" << TRACE_N_RUNS << std::endl;
-        for (size_t i = 0; i < app.n; i++)
+    auto execute = [&](uint64_t i, const coyote::traceEvent &ev, uint64_t h2d, uint64_t d2h) {
+        switch (ev.kind)
         {
-            const auto &ev = app.events[i];
-            double total_s = 0;
-            uint64_t h2d = 0, d2h = 0;
-
-            std::cerr << "[trace]   " << app.name
-                      << " ev=" << i << "/" << app.n
-                      << " kind=" << kind_str(ev.kind)
-                      << " h2d_raw=" << ev.h2d_size
-                      << " d2h_raw=" << ev.d2h_size
-                      << " cycles=" << ev.cycles
-                      << " ... " << std::flush;
-
-            switch (ev.kind)
+        case coyote::CoyoteTraceKind::BULK_H2D:
+            do_bulk(static_cast<uint32_t>(h2d), false);
+            break;
+        case coyote::CoyoteTraceKind::BULK_D2H:
+            do_bulk(static_cast<uint32_t>(d2h), true);
+            break;
+        case coyote::CoyoteTraceKind::BUNDLE:
+            // Device fires d2h_dma_start regardless of DMA_D2H_LEN, so a
+            // 0-byte D2H still emits a meta packet through an already-
+            // congested RDMA SQ and wedges the pipeline. Same for h2d.
+            // Floor to a cacheline so the DMA carries real payload.
+            // if (d2h == 0) d2h = MIN_DMA_BYTES;
+            // if (h2d == 0) h2d = MIN_DMA_BYTES;
+            do_bundle(static_cast<uint32_t>(h2d), static_cast<uint32_t>(d2h));
+            break;
+        }
+
+        // Only active with --dump-device-debug / --dump_host_debug, which
+        // perturb the timing anyway.
+        if (device_debug.connected() || g_dump_host_debug)
+        {
+            std::string debug_label = trace_debug_label(i, ev, h2d, d2h);
+            if (device_debug.connected())
             {
-            case TRACE_BULK_H2D:
-                h2d = clamp_dma(ev.h2d_size, dma_capacity);
-                std::cerr << "(h2d=" << h2d << ") " << std::flush;
-                {
-                    std::string debug_label = trace_debug_label(app.name, i, kind_str(ev.kind), h2d, 0, ev.cycles);
-                    if (device_debug.connected())
-                    {
-                        device_debug.start_run(debug_label);
-                    }
-                    total_s = do_bulk(static_cast<uint32_t>(h2d), false);
-                    if (device_debug.connected())
-                    {
-                        device_debug.done_run(debug_label);
-                    }
-                    dump_host_debug_after_run(ct, debug_label);
-                }
-                break;
-            case TRACE_BULK_D2H:
-                d2h = clamp_dma(ev.d2h_size, dma_capacity);
-                std::cerr << "(d2h=" << d2h << ") " << std::flush;
-                {
-                    std::string debug_label = trace_debug_label(app.name, i, kind_str(ev.kind), 0, d2h, ev.cycles);
-                    if (device_debug.connected())
-                    {
-                        device_debug.start_run(debug_label);
-                    }
-                    total_s = do_bulk(static_cast<uint32_t>(d2h), true);
-                    if (device_debug.connected())
-                    {
-                        device_debug.done_run(debug_label);
-                    }
-                    dump_host_debug_after_run(ct, debug_label);
-                }
-                break;
-            case TRACE_BUNDLE:
-                h2d = clamp_dma(ev.h2d_size, dma_capacity);
-                d2h = clamp_dma(ev.d2h_size, dma_capacity);
-                // Device fires d2h_dma_start regardless of DMA_D2H_LEN, so a
-                // 0-byte D2H still emits a meta packet through an already-
-                // congested RDMA SQ and wedges the pipeline. Same for h2d.
-                // Floor to a cacheline so the DMA carries real payload.
-                // if (d2h == 0) d2h = MIN_DMA_BYTES;
-                // if (h2d == 0) h2d = MIN_DMA_BYTES;
-                std::cerr << "(h2d=" << h2d << " d2h=" << d2h << ") " << std::flush;
-                {
-                    std::string debug_label = trace_debug_label(app.name, i, kind_str(ev.kind), h2d, d2h, ev.cycles);
-                    if (device_debug.connected())
-                    {
-                        device_debug.start_run(debug_label);
-                    }
-                    total_s = do_bundle(static_cast<uint32_t>(h2d), static_cast<uint32_t>(d2h), ev.cycles);
-                    if (device_debug.connected())
-                    {
-                        device_debug.done_run(debug_label);
-                    }
-                    dump_host_debug_after_run(ct, debug_label);
-                }
-                break;
-            default:
-                std::cerr << "[warn] unknown kind " << (int)ev.kind << std::endl;
-                continue;
+                device_debug.done_run(debug_label);
             }
+            dump_host_debug_after_run(ct, debug_label);
+        }
+    };
 
-            std::cerr << "done " << std::fixed << std::setprecision(3)
-                      << (total_s * 1e6) << " us" << std::endl;
+    coyote::cTraceReplay replay(&ct, reinterpret_cast<void *>(dma_addr), dma_capacity);
+    replay.setExecutor(execute, prepare);
 
-            results.push_back({app.name, run, static_cast<int>(i), ev.kind,
-                               ev.h2d_size, ev.d2h_size, ev.cycles,
-                               total_s * 1e6,
-                               ev.original_count});
+    for (const auto &trace : traces)
+    {
+        trace_name = &trace.getName();
+        std::cerr << "[trace] " << trace.getName() << " (" << trace.size() << " events, "
+                  << TRACE_N_RUNS << " runs)" << std::endl;
 
+        for (int run = 0; run < TRACE_N_RUNS; run++)
+        {
+            std::cerr << "[trace] " << trace.getName() << " run " << run << "/" << TRACE_N_RUNS << std::endl;
+            results.push_back(replay.replay(trace));
         }
-      }
     }
 }
 
@@ -754,16 +723,20 @@ static void run_trace_benchmark(coyote::cThread &ct, void *mem, uint64_t mem_byt
 int main(int argc, char *argv[])
 {
     std::string device_ip;
+    std::string trace_dir = JIGSAW_TRACE_DIR;
 
     bool skip_comp = false;
     bool trace_mmio = false;
     bool dump_host_debug = false;
     bool dump_device_debug = false;
     bool dump_device_debug_alias = false;
+    uint32_t device_telemetry_us = 0;
     boost::program_options::options_description opts("Jigsaw Host Controller Options");
     opts.add_options()("ip_address,i",
                        boost::program_options::value<std::string>(&device_ip),
-                       "Device-side OOB TCP/IP address (for QP exchange)")("skip_comp,s",
+                       "Device-side OOB TCP/IP address (for QP exchange)")("traces,t",
+                                                                           boost::program_options::value<std::string>(&trace_dir),
+                                                                           "Directory with the traces (*.trace) to replay")("skip_comp,s",
                                                                            boost::program_options::bool_switch(&skip_comp),
                                                                            "Skip computation benchmarks")("trace_mmio",
                                                                                                            boost::program_options::bool_switch(&trace_mmio),
@@ -773,7 +746,9 @@ int main(int argc, char *argv[])
                                                                                                                                                                                                                          boost::program_options::bool_switch(&dump_device_debug),
                                                                                                                                                                                                                          "Ask device software to dump debug CSRs after each benchmark run")("dump_device_debug",
                                                                                                                                                                                                                                                                                          boost::program_options::bool_switch(&dump_device_debug_alias),
-                                                                                                                                                                                                                                                                                         "Alias for --dump-device-debug");
+                                                                                                                                                                                                                                                                                         "Alias for --dump-device-debug")("device_telemetry_us",
+                                                                                                                                                                                                                                                                                                                                          boost::program_options::value<uint32_t>(&device_telemetry_us),
+                                                                                                                                                                                                                                                                                                                                          "Stream the device debug counters every <us> (device runs with --telemetry or --dump-debug) and print them with the host dumps");
 
     boost::program_options::variables_map vm;
     boost::program_options::store(
@@ -812,26 +787,50 @@ int main(int argc, char *argv[])
     // Write remote buffer address to HW for RDMA WRITE targeting
     uint64_t remote_vaddr = (uint64_t)ct.getQpair()->remote.vaddr;
     ct.setCSR(remote_vaddr, static_cast<uint32_t>(HCReg::REMOTE_VADDR));
+
+    if (g_dump_host_debug)
+    {
+        setup_debug_snapshots(ct);
+    }
     std::cout << "  Remote VADDR = 0x" << std::hex << remote_vaddr << std::dec << std::endl;
     std::cout << std::endl;
 
-    DeviceDebugClient device_debug;
+    // Run commands and the counter stream use separate connections, so
+    // streaming does not make the device dump on every run
+    TelemetryClient device_debug;
     if (dump_device_debug)
     {
         device_debug.connect_to(device_ip, static_cast<uint16_t>(coyote::DEF_PORT + DEBUG_PORT_OFFSET));
         std::cout << "Device debug sideband connected." << std::endl;
     }
+    TelemetryClient device_telemetry;
+    if (device_telemetry_us)
+    {
+        device_telemetry.connect_to(device_ip, static_cast<uint16_t>(coyote::DEF_PORT + DEBUG_PORT_OFFSET));
+        device_telemetry.subscribe(device_telemetry_us);
+        g_device_telemetry = &device_telemetry;
+        std::cout << "Device telemetry streaming every " << device_telemetry_us << " us." << std::endl;
+    }
 
     // Sync with device before starting
     ct.connSync(true);
 
-    // Size jigsaw_mem to fit the largest single transfer in the embedded
-    // trace set (JIGSAW_TRACE_MAX_BYTES) plus the 4 KiB DMA offset. The
-    // earlier 2 MiB allocation forced clamp_dma() to truncate every event
-    // larger than 2 MiB, so the trace benchmark was not actually exercising
-    // the full per-event sizes recorded in traces.hpp.
+    // Size jigsaw_mem to fit the largest single transfer of the trace set
+    // (and of the 1 MiB DMA sweeps) plus the 4 KiB DMA offset. The earlier
+    // 2 MiB allocation forced the replay to clamp every event larger than
+    // 2 MiB, so the trace benchmark was not actually exercising the full
+    // per-event sizes recorded in the traces.
+    std::vector<coyote::cTrace> traces = coyote::cTrace::loadDir(trace_dir);
+    uint64_t trace_max_bytes = 1024 * 1024;
+    for (const auto &trace : traces)
+    {
+        trace_max_bytes = std::max(trace_max_bytes, trace.getMaxBytes());
+    }
+    const uint64_t trace_mem_bytes =
+        ((trace_max_bytes + TRACE_DMA_OFFSET + HUGEPAGE_BYTES - 1) / HUGEPAGE_BYTES) * HUGEPAGE_BYTES;
+
     int *jigsaw_mem = (int *)ct.getMem({coyote::CoyoteAllocType::HPF,
-                                        static_cast<uint32_t>(TRACE_MEM_BYTES)});
+                                        static_cast<uint32_t>(trace_mem_bytes)});
     if (!jigsaw_mem)
     {
         throw std::runtime_error("Could not allocate memory; exiting...");
@@ -970,79 +969,35 @@ int main(int argc, char *argv[])
     }
 
     // =========================================================================
-    // Trace Benchmark (embedded apps from traces.hpp)
+    // Trace Benchmark (traces loaded from the trace directory)
     // =========================================================================
     std::cout << "\n=== TRACE BENCHMARK ===" << std::endl;
     {
-        std::vector<TraceResult> trace_results;
-        run_trace_benchmark(ct, jigsaw_mem, TRACE_MEM_BYTES, device_debug, trace_results);
-
-        struct AppAgg
-        {
-            int n_events = 0;
-            int n_bulk_h2d = 0, n_bulk_d2h = 0, n_bundle = 0;
-            double total_h2d_us = 0, total_d2h_us = 0, total_bundle_us = 0;
-            uint64_t total_h2d_bytes = 0, total_d2h_bytes = 0, total_cycles = 0;
-        };
-        struct AppKey
-        {
-            std::string app;
-            int run_idx;
-        };
-        std::vector<std::pair<AppKey, AppAgg>> ordered;
-        std::map<std::pair<std::string, int>, size_t> idx;
-        for (const auto &r : trace_results)
-        {
-            auto key = std::make_pair(r.app, r.run_idx);
-            auto it = idx.find(key);
-            if (it == idx.end())
-            {
-                idx[key] = ordered.size();
-                ordered.push_back({{r.app, r.run_idx}, AppAgg{}});
-                it = idx.find(key);
-            }
-            auto &a = ordered[it->second].second;
-            a.n_events++;
-            switch (r.kind)
-            {
-            case TRACE_BULK_H2D:
-                a.n_bulk_h2d++;
-                a.total_h2d_us += r.total_us;
-                a.total_h2d_bytes += r.h2d_size;
-                break;
-            case TRACE_BULK_D2H:
-                a.n_bulk_d2h++;
-                a.total_d2h_us += r.total_us;
-                a.total_d2h_bytes += r.d2h_size;
-                break;
-            case TRACE_BUNDLE:
-                a.n_bundle++;
-                a.total_bundle_us += r.total_us;
-                a.total_h2d_bytes += r.h2d_size;
-                a.total_d2h_bytes += r.d2h_size;
-                a.total_cycles += r.cycles;
-                break;
-            }
-        }
+        std::vector<coyote::cTraceResult> trace_results;
+        run_trace_benchmark(ct, jigsaw_mem, trace_mem_bytes, device_debug, traces, trace_results);
 
+        // Per-app summary; the runs of an app are consecutive
         std::cout << std::endl
                   << "# per-app summary (one row per (app, run))" << std::endl;
         std::cout << "app, run, n_events, n_bulk_h2d, n_bulk_d2h, n_bundle, "
                   << "total_h2d_us, total_d2h_us, total_bundle_us, total_us, "
                   << "total_h2d_bytes, total_d2h_bytes, total_cycles" << std::endl;
-        for (const auto &p : ordered)
+        for (size_t i = 0; i < trace_results.size(); i++)
         {
-            const auto &a = p.second;
-            double total_us = a.total_h2d_us + a.total_d2h_us + a.total_bundle_us;
-            std::cout << p.first.app << ", " << p.first.run_idx << ", "
-                      << a.n_events << ", "
-                      << a.n_bulk_h2d << ", " << a.n_bulk_d2h << ", " << a.n_bundle << ", "
+            const auto &r = trace_results[i];
+            std::cout << r.trace << ", " << (i % TRACE_N_RUNS) << ", "
+                      << r.result.getOps() << ", "
+                      << r.n_events[0] << ", " << r.n_events[1] << ", " << r.n_events[2] << ", "
                       << std::fixed << std::setprecision(3)
-                      << a.total_h2d_us << ", " << a.total_d2h_us << ", "
-                      << a.total_bundle_us << ", " << total_us << ", "
-                      << a.total_h2d_bytes << ", " << a.total_d2h_bytes << ", "
-                      << a.total_cycles << std::endl;
+                      << r.kind_time[0] / 1e3 << ", " << r.kind_time[1] / 1e3 << ", "
+                      << r.kind_time[2] / 1e3 << ", " << (r.kind_time[0] + r.kind_time[1] + r.kind_time[2]) / 1e3 << ", "
+                      << r.h2d_bytes << ", " << r.d2h_bytes << ", "
+                      << r.cycles << std::endl;
         }
+
+        std::cout << std::endl
+                  << "# per-trace throughput and latency" << std::endl;
+        coyote::cTraceReplay::writeCsv(std::cout, trace_results);
     }
 
     // =========================================================================
@@ -1070,6 +1025,8 @@ int main(int argc, char *argv[])
     }
 
     device_debug.close();
+    g_device_telemetry = nullptr;
+    device_telemetry.close();
 
     // FIFO overflow sanity check (see HCReg comment). A nonzero value
     // means at least one MMIO push was dropped during this run —
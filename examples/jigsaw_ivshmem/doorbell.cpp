@@ -0,0 +1,361 @@
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <immintrin.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#include "doorbell.hpp"
+
+// ivshmem-server protocol version (QEMU docs/specs/ivshmem-spec.rst)
+#define IVSHMEM_PROTOCOL_VERSION 0
+
+// Shortest adaptive spin window and the wait (in spin windows) after which
+// the guest is considered idle and the window is halved
+#define SPIN_MIN_NS 1000
+#define SPIN_IDLE_FACTOR 16
+
+static enum doorbell_mode mode = DOORBELL_SPIN;
+static uint64_t spin_max_ns = 0;
+static uint64_t spin_ns = 0;
+static uint64_t max_sleep_ns = 0;
+
+// irq mode: connection to ivshmem-server, our own interrupt (rung by the
+// guest) and the guest's vector 0 (rung by us)
+static int sock_fd = -1;
+static int shm_fd = -1;
+static int own_fd = -1;
+static int guest_fd = -1;
+static int64_t own_id = -1;
+static int64_t guest_id = -1;
+
+static uint64_t now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+// Receives one server message: an int64 and an optional file descriptor.
+// Returns 1 if a message was received, 0 if none is pending (non-blocking)
+// and -1 if the server went away.
+static int server_recv(int64_t *msg, int *fd, bool block)
+{
+    struct iovec iov = { msg, sizeof(*msg) };
+    union
+    {
+        struct cmsghdr align;
+        char buf[CMSG_SPACE(sizeof(int))];
+    } ctl;
+
+    struct msghdr mh;
+    memset(&mh, 0, sizeof(mh));
+    mh.msg_iov = &iov;
+    mh.msg_iovlen = 1;
+    mh.msg_control = ctl.buf;
+    mh.msg_controllen = sizeof(ctl.buf);
+
+    ssize_t n = recvmsg(sock_fd, &mh, block ? 0 : MSG_DONTWAIT);
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK) && !block)
+    {
+        return 0;
+    }
+    if (n != sizeof(*msg))
+    {
+        return -1;
+    }
+
+    *fd = -1;
+    for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&mh); cmsg; cmsg = CMSG_NXTHDR(&mh, cmsg))
+    {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS)
+        {
+            memcpy(fd, CMSG_DATA(cmsg), sizeof(int));
+        }
+    }
+
+    return 1;
+}
+
+// Peer notifications: an ID with an eventfd (one message per MSI-X vector)
+// announces a peer, an ID without one reports that it left. The first other
+// peer is the VM; only vector 0 is used in either direction.
+static void server_handle(int64_t id, int fd)
+{
+    if (fd < 0)
+    {
+        if (id == guest_id)
+        {
+            printf("ivshmem: guest peer %ld disconnected\n", (long)id);
+            close(guest_fd);
+            guest_fd = -1;
+            guest_id = -1;
+        }
+        return;
+    }
+
+    if (id == own_id && own_fd < 0)
+    {
+        own_fd = fd;
+    }
+    else if (id != own_id && guest_id < 0)
+    {
+        printf("ivshmem: guest peer %ld connected\n", (long)id);
+        guest_id = id;
+        guest_fd = fd;
+    }
+    else
+    {
+        close(fd);
+    }
+}
+
+static void server_drain()
+{
+    int64_t id;
+    int fd;
+    int ret;
+
+    while (sock_fd >= 0 && (ret = server_recv(&id, &fd, false)) != 0)
+    {
+        if (ret < 0)
+        {
+            fprintf(stderr, "ivshmem: server connection lost, guest interrupts disabled\n");
+            close(sock_fd);
+            sock_fd = -1;
+            return;
+        }
+        server_handle(id, fd);
+    }
+}
+
+static int server_connect(const std::string &path)
+{
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path))
+    {
+        fprintf(stderr, "ivshmem: socket path too long: %s\n", path.c_str());
+        return -1;
+    }
+    strcpy(addr.sun_path, path.c_str());
+
+    sock_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (sock_fd < 0)
+    {
+        perror("Failed to create ivshmem-server socket");
+        return -1;
+    }
+    if (connect(sock_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+    {
+        perror("Failed to connect to ivshmem-server");
+        close(sock_fd);
+        sock_fd = -1;
+        return -1;
+    }
+
+    // Greeting: protocol version, our peer ID, then the shared memory
+    int64_t msg;
+    int fd;
+    if (server_recv(&msg, &fd, true) != 1 || msg != IVSHMEM_PROTOCOL_VERSION)
+    {
+        fprintf(stderr, "ivshmem: unsupported server protocol\n");
+        return -1;
+    }
+    if (server_recv(&own_id, &fd, true) != 1 || own_id < 0)
+    {
+        fprintf(stderr, "ivshmem: failed to receive peer ID\n");
+        return -1;
+    }
+    if (server_recv(&msg, &shm_fd, true) != 1 || msg != -1 || shm_fd < 0)
+    {
+        fprintf(stderr, "ivshmem: failed to receive shared memory\n");
+        return -1;
+    }
+
+    // Already connected peers come first, our own vectors last
+    while (own_fd < 0)
+    {
+        if (server_recv(&msg, &fd, true) != 1)
+        {
+            fprintf(stderr, "ivshmem: failed to receive interrupt vectors\n");
+            return -1;
+        }
+        server_handle(msg, fd);
+    }
+
+    printf("ivshmem: connected to %s as peer %ld\n", path.c_str(), (long)own_id);
+    return 0;
+}
+
+void doorbell_add_options(boost::program_options::options_description &opts, doorbell_config &cfg)
+{
+    opts.add_options()
+        ("doorbell",
+            boost::program_options::value<std::string>(&cfg.mode)->default_value(cfg.mode),
+            "Doorbell wait: spin, sleep (spin, then back off) or irq (spin, then block on the ivshmem interrupt)")
+        ("ivshmem_socket",
+            boost::program_options::value<std::string>(&cfg.socket_path),
+            "ivshmem-server socket (irq doorbells)")
+        ("spin_us",
+            boost::program_options::value<uint32_t>(&cfg.spin_us)->default_value(cfg.spin_us),
+            "Longest busy-poll window before sleeping or blocking [us]")
+        ("max_sleep_us",
+            boost::program_options::value<uint32_t>(&cfg.max_sleep_us)->default_value(cfg.max_sleep_us),
+            "Longest backoff sleep [us]");
+}
+
+int doorbell_init(const doorbell_config &cfg)
+{
+    if (cfg.mode == "spin")
+    {
+        mode = DOORBELL_SPIN;
+    }
+    else if (cfg.mode == "sleep")
+    {
+        mode = DOORBELL_SLEEP;
+    }
+    else if (cfg.mode == "irq")
+    {
+        mode = DOORBELL_IRQ;
+    }
+    else
+    {
+        fprintf(stderr, "Unknown doorbell mode %s (spin, sleep or irq)\n", cfg.mode.c_str());
+        return -1;
+    }
+
+    spin_max_ns = std::max<uint64_t>(cfg.spin_us * 1000ULL, SPIN_MIN_NS);
+    spin_ns = spin_max_ns;
+    max_sleep_ns = std::max<uint64_t>(cfg.max_sleep_us * 1000ULL, 1000);
+
+    if (mode != DOORBELL_IRQ)
+    {
+        return 0;
+    }
+
+    if (cfg.socket_path.empty())
+    {
+        fprintf(stderr, "irq doorbells require --ivshmem_socket\n");
+        return -1;
+    }
+    return server_connect(cfg.socket_path);
+}
+
+int doorbell_shm_fd()
+{
+    return shm_fd;
+}
+
+void doorbell_publish(volatile uint32_t *slot)
+{
+    *slot = (mode == DOORBELL_IRQ) ? static_cast<uint32_t>(own_id + 1) : 0;
+}
+
+static void block_on_interrupt()
+{
+    struct pollfd fds[2];
+    fds[0] = { own_fd, POLLIN, 0 };
+    fds[1] = { sock_fd, POLLIN, 0 };
+
+    int n = poll(fds, sock_fd >= 0 ? 2 : 1, DOORBELL_IRQ_TIMEOUT_MS);
+    if (n <= 0)
+    {
+        return;
+    }
+
+    if (fds[0].revents & POLLIN)
+    {
+        uint64_t count;
+        if (read(own_fd, &count, sizeof(count)) < 0 && errno != EAGAIN)
+        {
+            perror("Failed to read ivshmem interrupt");
+        }
+    }
+    if (sock_fd >= 0 && fds[1].revents)
+    {
+        server_drain();
+    }
+}
+
+void doorbell_wait(volatile uint8_t *bell, bool set, bool rung)
+{
+    auto done = [&] { return (__atomic_load_n(bell, __ATOMIC_ACQUIRE) != 0) == set; };
+
+    if (mode == DOORBELL_SPIN)
+    {
+        while (!done())
+        {
+            _mm_pause();
+        }
+        return;
+    }
+
+    // Spin while the guest is likely to answer soon
+    uint64_t deadline = now_ns() + spin_ns;
+    while (!done())
+    {
+        _mm_pause();
+        if (now_ns() < deadline)
+        {
+            continue;
+        }
+
+        // Then block (irq) or back off
+        uint64_t blocked = now_ns();
+        uint64_t sleep_ns = SPIN_MIN_NS;
+        while (!done())
+        {
+            if (mode == DOORBELL_IRQ && rung)
+            {
+                block_on_interrupt();
+            }
+            else
+            {
+                struct timespec ts = { (time_t)(sleep_ns / 1000000000ULL), (long)(sleep_ns % 1000000000ULL) };
+                nanosleep(&ts, NULL);
+                sleep_ns = std::min(2 * sleep_ns, max_sleep_ns);
+            }
+        }
+
+        uint64_t waited = now_ns() - blocked;
+        if (waited < spin_ns)
+        {
+            spin_ns = std::min(2 * spin_ns, spin_max_ns);
+        }
+        else if (waited > SPIN_IDLE_FACTOR * spin_max_ns)
+        {
+            spin_ns = std::max<uint64_t>(spin_ns / 2, SPIN_MIN_NS);
+        }
+        return;
+    }
+}
+
+void doorbell_notify_guest()
+{
+    if (mode != DOORBELL_IRQ)
+    {
+        return;
+    }
+
+    if (guest_fd < 0)
+    {
+        server_drain();
+        if (guest_fd < 0)
+        {
+            return;
+        }
+    }
+
+    uint64_t one = 1;
+    if (write(guest_fd, &one, sizeof(one)) < 0 && errno != EAGAIN)
+    {
+        perror("Failed to raise guest interrupt");
+    }
+}
@@ -0,0 +1,97 @@
+#ifndef JIGSAW_IVSHMEM_DOORBELL_HPP
+#define JIGSAW_IVSHMEM_DOORBELL_HPP
+
+#include <cstdint>
+#include <string>
+
+#include <boost/program_options.hpp>
+
+/*
+ * Doorbell waits for the ivshmem bridges (jigsaw_baseline/sw,
+ * jigsaw_minus_nw/sw, jigsaw_host_controller/sw, jigsaw_sw_forwarder/sw_host).
+ *
+ * The guest and the host daemon hand MMIO requests over through the two
+ * doorbell bytes at the start of the ivshmem region. How the daemon waits
+ * for a doorbell is selected with --doorbell:
+ *
+ *  - spin:  busy-poll the byte (default; one host core at 100% per VM, works
+ *           with any guest driver).
+ *  - sleep: busy-poll for an adaptive window, then back off with
+ *           exponentially growing sleeps up to --max_sleep_us. Works with any
+ *           guest driver; idle VMs cost next to nothing, at the price of up
+ *           to --max_sleep_us extra latency on the first request after idling.
+ *  - irq:   busy-poll for an adaptive window, then block on the eventfd that
+ *           QEMU signals when the guest rings the ivshmem Doorbell register
+ *           (ivshmem-doorbell device, connected to ivshmem-server at
+ *           --ivshmem_socket). Read completions are signalled back to the
+ *           guest through its MSI-X vector 0 (irqfd). The shared memory is
+ *           the one handed out by ivshmem-server, and the daemon's peer ID
+ *           is published at OFFSET_DOORBELL_PEER (as ID + 1, 0 = no
+ *           interrupts) so the guest driver knows where to ring. A guest
+ *           that never rings still makes progress: each block is bounded
+ *           by DOORBELL_IRQ_TIMEOUT_MS.
+ *
+ * The spin window adapts between 1 us and --spin_us: it doubles when a
+ * doorbell arrives shortly after the daemon gave up spinning (a busy guest
+ * whose requests just missed the window) and halves when the daemon blocked
+ * for long (an idle guest), so bursts are served at polling latency while
+ * idle periods go to sleep quickly.
+ */
+
+// Upper bound of a single eventfd block in irq mode, so requests from a guest
+// driver that does not ring the Doorbell register are still picked up
+#define DOORBELL_IRQ_TIMEOUT_MS 10
+
+enum doorbell_mode
+{
+    DOORBELL_SPIN = 0,
+    DOORBELL_SLEEP = 1,
+    DOORBELL_IRQ = 2
+};
+
+struct doorbell_config
+{
+    std::string mode = "spin";  /** spin, sleep or irq */
+    std::string socket_path;    /** ivshmem-server UNIX socket (irq mode) */
+    uint32_t spin_us = 50;      /** Upper bound of the adaptive spin window */
+    uint32_t max_sleep_us = 100; /** Longest backoff sleep */
+};
+
+/**
+ * @brief Registers --doorbell, --ivshmem_socket, --spin_us and --max_sleep_us
+ */
+void doorbell_add_options(boost::program_options::options_description &opts, doorbell_config &cfg);
+
+/**
+ * @brief Sets up the selected mode; in irq mode, connects to ivshmem-server
+ * and receives the shared memory and the eventfds. Must be called before
+ * init_shared_memory(). Returns 0 on success, -1 on error.
+ */
+int doorbell_init(const doorbell_config &cfg);
+
+/**
+ * @brief File descriptor of the shared memory handed out by ivshmem-server,
+ * -1 if the daemon opens SHMEM_FILE itself (spin and sleep modes)
+ */
+int doorbell_shm_fd();
+
+/**
+ * @brief Publishes the daemon's peer ID for the guest driver (0 unless in irq mode)
+ */
+void doorbell_publish(volatile uint32_t *slot);
+
+/**
+ * @brief Waits until the doorbell byte is set (non-zero) or clear
+ *
+ * @param rung Whether the guest rings the Doorbell register after updating
+ *             the byte (new requests); clears done by the guest are not
+ *             rung and back off with sleeps instead of blocking
+ */
+void doorbell_wait(volatile uint8_t *bell, bool set, bool rung);
+
+/**
+ * @brief Raises the guest's interrupt after a read response was published (irq mode only)
+ */
+void doorbell_notify_guest();
+
+#endif // JIGSAW_IVSHMEM_DOORBELL_HPP
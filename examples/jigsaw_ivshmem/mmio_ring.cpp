@@ -0,0 +1,61 @@
+#include <cstring>
+
+#include "mmio_ring.hpp"
+
+static struct mmio_ring *ring = NULL;
+
+void mmio_ring_init(void *base)
+{
+    ring = reinterpret_cast<struct mmio_ring *>(base);
+    mmio_ring_reset(ring);
+}
+
+bool mmio_ring_enabled()
+{
+    return mmio_ring_enabled(ring);
+}
+
+bool mmio_ring_pop(struct mmio_ring_slot *req)
+{
+    return mmio_ring_pop(ring, req);
+}
+
+void mmio_ring_reset(struct mmio_ring *ring)
+{
+    memset(ring, 0, sizeof(*ring));
+    ring->head = 1;
+    __atomic_store_n(&ring->slots, MMIO_RING_SLOTS, __ATOMIC_RELEASE);
+}
+
+bool mmio_ring_enabled(const struct mmio_ring *ring)
+{
+    return ring && __atomic_load_n(&ring->enabled, __ATOMIC_ACQUIRE) != 0;
+}
+
+bool mmio_ring_pending(const struct mmio_ring *ring)
+{
+    uint64_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    return __atomic_load_n(&ring->slot[head % MMIO_RING_SLOTS].seq, __ATOMIC_ACQUIRE) == head;
+}
+
+bool mmio_ring_pop(struct mmio_ring *ring, struct mmio_ring_slot *req)
+{
+    // Only the daemon writes head
+    uint64_t head = ring->head;
+    struct mmio_ring_slot *slot = &ring->slot[head % MMIO_RING_SLOTS];
+
+    if (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != head)
+    {
+        return false;
+    }
+
+    req->seq = head;
+    req->address = __atomic_load_n(&slot->address, __ATOMIC_RELAXED);
+    req->value = __atomic_load_n(&slot->value, __ATOMIC_RELAXED);
+    req->operation = __atomic_load_n(&slot->operation, __ATOMIC_RELAXED);
+
+    // The slot was copied out, the guest may reuse it
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+
+    return true;
+}
@@ -0,0 +1,81 @@
+#ifndef JIGSAW_IVSHMEM_MMIO_RING_HPP
+#define JIGSAW_IVSHMEM_MMIO_RING_HPP
+
+#include <cstdint>
+
+/*
+ * Multi-slot MMIO request ring in the ivshmem region (at MMIO_RING_OFFSET).
+ *
+ * The legacy protocol carries one request at a time in the message slot at
+ * MMIO_REGION_OFFSET, so every register write costs the guest a full round
+ * trip to the host daemon. With the ring, the guest posts requests into
+ * consecutive slots and the daemon drains all of them per doorbell:
+ *
+ *  - Requests carry sequence numbers, starting at 1. The guest fills a slot
+ *    (index seq % slots), stores its sequence number last (release), then
+ *    sets the write doorbell (and rings the ivshmem interrupt in irq mode).
+ *  - The daemon serves requests strictly in sequence order and publishes
+ *    the sequence number of the next one it will serve in head; a slot may
+ *    be reused once head moved past it, so at most `slots` requests are
+ *    outstanding.
+ *  - Writes are posted: the guest does not wait for them. A read completes
+ *    like in the legacy protocol (value at offset 16, read doorbell set) and
+ *    is only served after every request posted before it.
+ *
+ * The guest driver opts in by setting enabled; slots is 0 on daemons
+ * without ring support. Switching back (clearing enabled) is allowed once
+ * all posted requests were served.
+ */
+
+#define MMIO_RING_SLOTS 64
+
+struct mmio_ring_slot
+{
+    uint64_t seq;       /** Sequence number, written last by the guest */
+    uint64_t address;   /** Memory address for the operation */
+    uint64_t value;     /** Value in case of optype write */
+    uint8_t operation;  /** OP_READ or OP_WRITE */
+    uint8_t reserved[7];
+};
+
+struct mmio_ring
+{
+    uint32_t slots;     /** Number of slots, published by the daemon */
+    uint32_t enabled;   /** Set by the guest driver to post through the ring */
+    uint64_t head;      /** Sequence number of the next request to serve */
+    uint8_t reserved[48];
+    struct mmio_ring_slot slot[MMIO_RING_SLOTS];
+};
+
+static_assert(sizeof(struct mmio_ring_slot) == 32, "MMIO ring slots are part of the guest ABI");
+static_assert(sizeof(struct mmio_ring) == 64 + MMIO_RING_SLOTS * 32, "MMIO ring layout is part of the guest ABI");
+
+/**
+ * @brief Resets the ring at the given address and publishes its size
+ */
+void mmio_ring_init(void *base);
+
+/*
+ * Same operations on a given ring, for daemons serving several ivshmem
+ * regions; the functions above act on the ring of mmio_ring_init().
+ */
+void mmio_ring_reset(struct mmio_ring *ring);
+bool mmio_ring_enabled(const struct mmio_ring *ring);
+bool mmio_ring_pop(struct mmio_ring *ring, struct mmio_ring_slot *req);
+
+/**
+ * @brief Whether the guest posted a request which was not popped yet
+ */
+bool mmio_ring_pending(const struct mmio_ring *ring);
+
+/**
+ * @brief Whether the guest driver posts its requests through the ring
+ */
+bool mmio_ring_enabled();
+
+/**
+ * @brief Takes the next posted request, in sequence order; false if none is pending
+ */
+bool mmio_ring_pop(struct mmio_ring_slot *req);
+
+#endif // JIGSAW_IVSHMEM_MMIO_RING_HPP
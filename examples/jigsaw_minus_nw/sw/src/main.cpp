@@ -8,6 +8,7 @@
 #include <coyote/cThread.hpp>
 
 #include "shmem.hpp"
+#include "doorbell.hpp"
 
 // Note, how the Coyote thread is passed by reference; to avoid creating a copy of 
 // the thread object which can lead to undefined behaviour and bugs. 
@@ -30,6 +31,20 @@ void run_bench(
 }
 
 int main(int argc, char *argv[]) {
+    // CLI arguments
+    doorbell_config doorbell;
+    boost::program_options::options_description opts("Jigsaw minus NW Options");
+    doorbell_add_options(opts, doorbell);
+
+    boost::program_options::variables_map vm;
+    boost::program_options::store(
+        boost::program_options::parse_command_line(argc, argv, opts), vm);
+    boost::program_options::notify(vm);
+
+    if (doorbell_init(doorbell) != 0) {
+        return EXIT_FAILURE;
+    }
+
     // Create Coyote thread and allocate memory for the transfer
     void *shmem = init_shared_memory();
     if (!shmem) {
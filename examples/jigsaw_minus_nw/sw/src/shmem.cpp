@@ -11,17 +11,23 @@
 #include <cstdint>
 
 #include "shmem.hpp"
+#include "doorbell.hpp"
+#include "mmio_ring.hpp"
 
 #include <coyote/cThread.hpp>
 
 #define CONFIG_DISAGG_DEBUG_MMIO
 
+static_assert(MMIO_RING_OFFSET + sizeof(struct mmio_ring) <= DMA_REGION_OFFSET,
+              "MMIO ring must fit below the DMA region");
+
 static void *shmem = NULL;
 static volatile uint8_t *read_doorbell = NULL;
 static volatile uint8_t *write_doorbell = NULL;
 
 static int create_or_open_shmem_file() {
-    int fd = open(SHMEM_FILE, O_RDWR | O_CREAT, 0666);
+    // With irq doorbells the region is the one handed out by ivshmem-server
+    int fd = doorbell_shm_fd() >= 0 ? dup(doorbell_shm_fd()) : open(SHMEM_FILE, O_RDWR | O_CREAT, 0666);
     if (fd < 0) {
         perror("Failed to open or create shared memory file");
         return -1;
@@ -72,23 +78,32 @@ void *init_shared_memory() {
     // write proxyShmem address into shmem
     *reinterpret_cast<uint64_t *>((reinterpret_cast<char *>(shmem) + OFFSET_PROXY_SHMEM)) = reinterpret_cast<uint64_t>(shmem) + DMA_REGION_OFFSET;
 
+    // tell the guest driver whether and where to ring the ivshmem doorbell
+    doorbell_publish(reinterpret_cast<volatile uint32_t *>(reinterpret_cast<char *>(shmem) + OFFSET_DOORBELL_PEER));
+    mmio_ring_init(reinterpret_cast<char *>(shmem) + MMIO_RING_OFFSET);
+
     msync(shmem, TOTAL_DOORBELL_SIZE, MS_SYNC);
 
     return shmem;
 }
 
 static void wait_for_write_doorbell_set() {
-    while (__atomic_load_n(write_doorbell, __ATOMIC_ACQUIRE) == 0) { }
+    doorbell_wait(write_doorbell, true, true);
 }
 
 static void wait_for_read_doorbell_clear() {
-    while (__atomic_load_n(read_doorbell, __ATOMIC_ACQUIRE) != 0) { }
+    doorbell_wait(read_doorbell, false, false);
 }
 
 static int ivshmem_mmio_region_read(void *buf) {
 
     wait_for_write_doorbell_set();
 
+    // Rung for the MMIO ring, the message slot is not in use
+    if (mmio_ring_enabled()) {
+        return 1;
+    }
+
     memcpy(buf, reinterpret_cast<char *>(shmem) + MMIO_REGION_OFFSET, sizeof(struct mmio_message_header));
 
     return 0;
@@ -101,6 +116,7 @@ static int ivshmem_mmio_region_write(void *buf, size_t count) {
     memcpy(reinterpret_cast<char *>(shmem) + MMIO_REGION_OFFSET, buf, count);
 
     __atomic_store_n(read_doorbell, 1, __ATOMIC_RELEASE);
+    doorbell_notify_guest();
 
     return 0;
 }
@@ -126,6 +142,7 @@ void mmio_read(coyote::cThread &coyote_thread, uint64_t addr) {
     *(uint64_t *)((char *)shmem + 16) = data;
 
     __atomic_store_n(read_doorbell, 1, __ATOMIC_RELEASE);
+    doorbell_notify_guest();
 }
 
 void mmio_write(coyote::cThread &coyote_thread, uint64_t addr, uint64_t data) {
@@ -147,6 +164,27 @@ void mmio_write(coyote::cThread &coyote_thread, uint64_t addr, uint64_t data) {
 };
 
 
+// Serves every request posted to the MMIO ring, in order
+static void drain_mmio_ring(coyote::cThread &coyote_thread) {
+    struct mmio_ring_slot req;
+
+    while (mmio_ring_pop(&req)) {
+        switch (req.operation) {
+            case OP_READ:
+                mmio_read(coyote_thread, req.address);
+                break;
+
+            case OP_WRITE:
+                mmio_write(coyote_thread, req.address, req.value);
+                break;
+
+            default:
+                fprintf(stderr, "Unknown operation: %d\n", req.operation);
+                break;
+        }
+    }
+}
+
 void *run_shmem_app(coyote::cThread &coyote_thread) {
 
     printf("connection.c: In shmem app\n");
@@ -158,8 +196,18 @@ void *run_shmem_app(coyote::cThread &coyote_thread) {
     while (1) {
         __atomic_store_n(write_doorbell, 0, __ATOMIC_RELEASE);
 
+        // With the MMIO ring the doorbell only wakes us up: it is cleared
+        // before draining, so requests posted meanwhile set it again
+        if (mmio_ring_enabled()) {
+            drain_mmio_ring(coyote_thread);
+        }
+
         mmio_message_header header;
-        if (ivshmem_mmio_region_read(&header) != 0) {
+        int ret = ivshmem_mmio_region_read(&header);
+        if (ret > 0) {
+            continue;
+        }
+        if (ret != 0) {
             perror("Failed to read message");
             continue;
         }
@@ -7,12 +7,12 @@
 #include <sstream>
 #include <vector>
 #include <string>
-#include <map>
 #include <stdexcept>
 #include <thread>
 #include <iostream>
 #include <boost/program_options.hpp>
 
+#include <coyote/cTrace.hpp>
 #include <coyote/cThread.hpp>
 
 // Constants
@@ -230,48 +230,18 @@ void run_bench(
 }
 
 // ---------------------------------------------------------------------------
-// Trace Replay (bundled, embedded via traces.hpp)
+// Trace Replay (coyote::cTraceReplay, traces loaded from --traces)
 //
-// Three event kinds: BULK_H2D / BULK_D2H / BUNDLE. See REPLAY.md.
-// Bitstream quirks: 64-B minimum + no-shrink — mitigated by floor + running
-// max per direction.
+// Three event kinds: BULK_H2D / BULK_D2H / BUNDLE, see coyote/cTrace.hpp.
+// The device DMA engine moves the data, driven over MMIO, so the events are
+// carried out by an executor; the replay clamps the sizes to 64-B multiples.
 // ---------------------------------------------------------------------------
-#include "traces.hpp"
-using namespace jigsaw_traces_ns;
-
-static constexpr uint32_t MIN_DMA_BYTES = 64;
 static constexpr int TRACE_N_RUNS = 5;
 
-struct TraceResult {
-    std::string app;
-    int run_idx;
-    int event_idx;
-    uint8_t kind;
-    uint64_t h2d_size, d2h_size, cycles;
-    double total_us;
-    int original_count;
-};
-
-static uint64_t clamp_dma(uint64_t raw, uint64_t mem_cap) {
-    uint64_t sz = (raw > mem_cap) ? mem_cap : raw;
-    // Keep raw==0 as 0 so computation_engine skips that phase entirely.
-    // Non-zero sizes are rounded UP to a cacheline multiple — Coyote's
-    // 512-bit AXI streams move data one 64-byte beat at a time, and
-    // non-aligned lengths desync the meta/payload pipeline.
-    if (sz != 0)
-    {
-        sz = (sz + MIN_DMA_BYTES - 1) & ~static_cast<uint64_t>(MIN_DMA_BYTES - 1);
-        if (sz > mem_cap)
-        {
-            sz = mem_cap & ~static_cast<uint64_t>(MIN_DMA_BYTES - 1);
-        }
-    }
-    return sz;
-}
-
 static void run_trace_benchmark(coyote::cThread &coyote_thread, int *mem,
                                 uint64_t mem_bytes,
-                                std::vector<TraceResult> &results)
+                                const std::vector<coyote::cTrace> &traces,
+                                std::vector<coyote::cTraceResult> &results)
 {
     uint64_t mem_addr = reinterpret_cast<uint64_t>(mem);
     uint64_t dma_addr = mem_addr + 4096;
@@ -280,13 +250,7 @@ static void run_trace_benchmark(coyote::cThread &coyote_thread, int *mem,
     coyote_thread.setCSR(coyote_thread.getCtid(), static_cast<uint32_t>(JigsawHostControlRegisters::COYOTE_PID_REG));
     coyote_thread.setCSR(mem_addr, static_cast<uint32_t>(JigsawHostControlRegisters::MMIO_VADDR_REG));
 
-    using clk = std::chrono::high_resolution_clock;
-    auto secs = [](auto a, auto b) { return std::chrono::duration<double>(b - a).count(); };
-
-    // CYCLES_PER_COMP is a benchmark-only register (no analogue on a real
-    // accelerator), so it's staged outside the timed window per BUNDLE event.
-    auto do_bulk = [&](uint32_t size, bool d2h) -> double {
-        auto start = clk::now();
+    auto do_bulk = [&](uint32_t size, bool d2h) {
         write_mmio(coyote_thread, static_cast<uint32_t>(DMAEngineRegisters::DMA_SRC_ADDR_REG), dma_addr);
         write_mmio(coyote_thread, static_cast<uint32_t>(DMAEngineRegisters::DMA_DST_ADDR_REG), dma_addr);
         if (d2h) write_mmio(coyote_thread, static_cast<uint32_t>(DMAEngineRegisters::DMA_D2H_LEN_REG), size);
@@ -296,21 +260,9 @@ static void run_trace_benchmark(coyote::cThread &coyote_thread, int *mem,
         uint64_t cmd = d2h ? 3 : 1;
         write_mmio(coyote_thread, static_cast<uint32_t>(DMAEngineRegisters::DMA_CMD_REG), cmd);
         while ((read_mmio(coyote_thread, static_cast<uint32_t>(DMAEngineRegisters::DMA_STATUS_REG)) & 0x1) != 1) {}
-        auto end = clk::now();
-        return secs(start, end);
     };
 
-    auto do_bundle = [&](uint32_t h2d, uint32_t d2h, uint64_t cycles) -> double {
-        // Synthetic compute-cycle knob: not a real-device register, stage outside.
-        write_mmio(coyote_thread, static_cast<uint32_t>(DMAEngineRegisters::CYCLES_PER_COMP_REG), cycles);
-        const uint64_t cycles_readback = read_mmio(coyote_thread, static_cast<uint32_t>(DMAEngineRegisters::CYCLES_PER_COMP_REG));
-        if (cycles_readback != cycles) {
-            std::cerr << "[ERROR] CYCLES_PER_COMP_REG readback mismatch: wrote "
-                      << cycles << ", read " << cycles_readback << std::endl;
-            throw std::runtime_error("CYCLES_PER_COMP_REG readback mismatch");
-        }
-
-        auto start = clk::now();
+    auto do_bundle = [&](uint32_t h2d, uint32_t d2h) {
         write_mmio(coyote_thread, static_cast<uint32_t>(DMAEngineRegisters::DMA_SRC_ADDR_REG), dma_addr);
         write_mmio(coyote_thread, static_cast<uint32_t>(DMAEngineRegisters::DMA_DST_ADDR_REG), dma_addr);
         write_mmio(coyote_thread, static_cast<uint32_t>(DMAEngineRegisters::DMA_H2D_LEN_REG), h2d);
@@ -319,81 +271,63 @@ static void run_trace_benchmark(coyote::cThread &coyote_thread, int *mem,
 
         write_mmio(coyote_thread, static_cast<uint32_t>(DMAEngineRegisters::START_COMPUTATION_REG), 1);
         while ((read_mmio(coyote_thread, static_cast<uint32_t>(DMAEngineRegisters::DMA_STATUS_REG)) & 0x3) != 0x3) {}
-        auto end = clk::now();
-        return secs(start, end);
     };
 
-    auto kind_str = [](uint8_t k) -> const char * {
-        switch (k) {
-            case TRACE_BULK_H2D: return "BULK_H2D";
-            case TRACE_BULK_D2H: return "BULK_D2H";
-            case TRACE_BUNDLE:   return "BUNDLE  ";
-            default:             return "UNKNOWN ";
+    // CYCLES_PER_COMP is a benchmark-only register (no analogue on a real
+    // accelerator), so it's staged in the (untimed) prepare step per BUNDLE event.
+    auto prepare = [&](uint64_t i, const coyote::traceEvent &ev, uint64_t h2d, uint64_t d2h) {
+        std::cerr << "[trace]   ev=" << i
+                  << " kind=" << static_cast<int>(ev.kind)
+                  << " h2d=" << h2d << " d2h=" << d2h
+                  << " cycles=" << ev.cycles << std::endl;
+
+        if (ev.kind == coyote::CoyoteTraceKind::BUNDLE) {
+            write_mmio(coyote_thread, static_cast<uint32_t>(DMAEngineRegisters::CYCLES_PER_COMP_REG), ev.cycles);
+            const uint64_t cycles_readback = read_mmio(coyote_thread, static_cast<uint32_t>(DMAEngineRegisters::CYCLES_PER_COMP_REG));
+            if (cycles_readback != ev.cycles) {
+                std::cerr << "[ERROR] CYCLES_PER_COMP_REG readback mismatch: wrote "
+                          << ev.cycles << ", read " << cycles_readback << std::endl;
+                throw std::runtime_error("CYCLES_PER_COMP_REG readback mismatch");
+            }
         }
     };
 
-    constexpr size_t n_apps = sizeof(jigsaw_traces) / sizeof(jigsaw_traces[0]);
-    for (size_t a = 0; a < n_apps; a++) {
-        const auto &app = jigsaw_traces[a];
-        std::cerr << "[trace] " << app.name << " (" << app.n << " events, "
-                  << TRACE_N_RUNS << " runs)" << std::endl;
-
-      for (int run = 0; run < TRACE_N_RUNS; run++) {
-        std::cerr << "[trace] " << app.name << " run " << run << "/" << TRACE_N_RUNS << std::endl;
-        for (size_t i = 0; i < app.n; i++) {
-            const auto &ev = app.events[i];
-            double total_s = 0;
-            uint64_t h2d = 0, d2h = 0;
-
-            std::cerr << "[trace]   " << app.name
-                      << " ev=" << i << "/" << app.n
-                      << " kind=" << kind_str(ev.kind)
-                      << " h2d_raw=" << ev.h2d_size
-                      << " d2h_raw=" << ev.d2h_size
-                      << " cycles=" << ev.cycles
-                      << " ... " << std::flush;
-
-            switch (ev.kind) {
-            case TRACE_BULK_H2D:
-                h2d = clamp_dma(ev.h2d_size, dma_capacity);
-                std::cerr << "(h2d=" << h2d << ") " << std::flush;
-                total_s = do_bulk(static_cast<uint32_t>(h2d), false);
-                break;
-            case TRACE_BULK_D2H:
-                d2h = clamp_dma(ev.d2h_size, dma_capacity);
-                std::cerr << "(d2h=" << d2h << ") " << std::flush;
-                total_s = do_bulk(static_cast<uint32_t>(d2h), true);
-                break;
-            case TRACE_BUNDLE:
-                h2d = clamp_dma(ev.h2d_size, dma_capacity);
-                d2h = clamp_dma(ev.d2h_size, dma_capacity);
-                std::cerr << "(h2d=" << h2d << " d2h=" << d2h << ") " << std::flush;
-                total_s = do_bundle(static_cast<uint32_t>(h2d), static_cast<uint32_t>(d2h), ev.cycles);
-                break;
-            default:
-                std::cerr << "[warn] unknown kind " << (int)ev.kind << std::endl;
-                continue;
-            }
+    auto execute = [&](uint64_t i, const coyote::traceEvent &ev, uint64_t h2d, uint64_t d2h) {
+        switch (ev.kind) {
+        case coyote::CoyoteTraceKind::BULK_H2D:
+            do_bulk(static_cast<uint32_t>(h2d), false);
+            break;
+        case coyote::CoyoteTraceKind::BULK_D2H:
+            do_bulk(static_cast<uint32_t>(d2h), true);
+            break;
+        case coyote::CoyoteTraceKind::BUNDLE:
+            do_bundle(static_cast<uint32_t>(h2d), static_cast<uint32_t>(d2h));
+            break;
+        }
+    };
 
-            std::cerr << "done " << std::fixed << std::setprecision(3)
-                      << (total_s * 1e6) << " us" << std::endl;
+    coyote::cTraceReplay replay(&coyote_thread, reinterpret_cast<void*>(dma_addr), dma_capacity);
+    replay.setExecutor(execute, prepare);
 
-            results.push_back({app.name, run, static_cast<int>(i), ev.kind,
-                               ev.h2d_size, ev.d2h_size, ev.cycles,
-                               total_s * 1e6,
-                               ev.original_count});
+    for (const auto &trace : traces) {
+        std::cerr << "[trace] " << trace.getName() << " (" << trace.size() << " events, "
+                  << TRACE_N_RUNS << " runs)" << std::endl;
+        for (int run = 0; run < TRACE_N_RUNS; run++) {
+            std::cerr << "[trace] " << trace.getName() << " run " << run << "/" << TRACE_N_RUNS << std::endl;
+            results.push_back(replay.replay(trace));
         }
-      }
     }
 }
 
 int main(int argc, char *argv[]) {
     bool skip_comp = false;
+    std::string trace_dir = JIGSAW_TRACE_DIR;
 
     // Command line options
     boost::program_options::options_description opts("Jigsaw Minus-NW Options");
     opts.add_options()
-        ("skip_comp,s", boost::program_options::bool_switch(&skip_comp), "Skip computation benchmarks (No-op in Minus-NW)");
+        ("skip_comp,s", boost::program_options::bool_switch(&skip_comp), "Skip computation benchmarks (No-op in Minus-NW)")
+        ("traces,t", boost::program_options::value<std::string>(&trace_dir), "Directory with the traces (*.trace) to replay");
 
     boost::program_options::variables_map vm;
     boost::program_options::store(boost::program_options::parse_command_line(argc, argv, opts), vm);
@@ -521,72 +455,33 @@ int main(int argc, char *argv[]) {
     // Asymmetric DMA Length Test
     // =========================================================================
     // =========================================================================
-    // Trace Benchmark (embedded apps from traces.hpp)
+    // Trace Benchmark (traces loaded from the trace directory)
     // =========================================================================
     std::cout << "\n=== TRACE BENCHMARK ===" << std::endl;
     {
-        std::vector<TraceResult> trace_results;
-        run_trace_benchmark(coyote_thread, mem, mem_bytes, trace_results);
-
-        struct AppAgg {
-            int n_events = 0;
-            int n_bulk_h2d = 0, n_bulk_d2h = 0, n_bundle = 0;
-            double total_h2d_us = 0, total_d2h_us = 0, total_bundle_us = 0;
-            uint64_t total_h2d_bytes = 0, total_d2h_bytes = 0, total_cycles = 0;
-        };
-        struct AppKey {
-            std::string app;
-            int run_idx;
-        };
-        std::vector<std::pair<AppKey, AppAgg>> ordered;
-        std::map<std::pair<std::string, int>, size_t> idx;
-        for (const auto &r : trace_results) {
-            auto key = std::make_pair(r.app, r.run_idx);
-            auto it = idx.find(key);
-            if (it == idx.end()) {
-                idx[key] = ordered.size();
-                ordered.push_back({{r.app, r.run_idx}, AppAgg{}});
-                it = idx.find(key);
-            }
-            auto &a = ordered[it->second].second;
-            a.n_events++;
-            switch (r.kind) {
-            case TRACE_BULK_H2D:
-                a.n_bulk_h2d++;
-                a.total_h2d_us += r.total_us;
-                a.total_h2d_bytes += r.h2d_size;
-                break;
-            case TRACE_BULK_D2H:
-                a.n_bulk_d2h++;
-                a.total_d2h_us += r.total_us;
-                a.total_d2h_bytes += r.d2h_size;
-                break;
-            case TRACE_BUNDLE:
-                a.n_bundle++;
-                a.total_bundle_us += r.total_us;
-                a.total_h2d_bytes += r.h2d_size;
-                a.total_d2h_bytes += r.d2h_size;
-                a.total_cycles += r.cycles;
-                break;
-            }
-        }
+        std::vector<coyote::cTrace> traces = coyote::cTrace::loadDir(trace_dir);
+        std::vector<coyote::cTraceResult> trace_results;
+        run_trace_benchmark(coyote_thread, mem, mem_bytes, traces, trace_results);
 
+        // Per-app summary; the runs of an app are consecutive
         std::cout << std::endl << "# per-app summary (one row per (app, run))" << std::endl;
         std::cout << "app, run, n_events, n_bulk_h2d, n_bulk_d2h, n_bundle, "
                   << "total_h2d_us, total_d2h_us, total_bundle_us, total_us, "
                   << "total_h2d_bytes, total_d2h_bytes, total_cycles" << std::endl;
-        for (const auto &p : ordered) {
-            const auto &a = p.second;
-            double total_us = a.total_h2d_us + a.total_d2h_us + a.total_bundle_us;
-            std::cout << p.first.app << ", " << p.first.run_idx << ", "
-                      << a.n_events << ", "
-                      << a.n_bulk_h2d << ", " << a.n_bulk_d2h << ", " << a.n_bundle << ", "
+        for (size_t i = 0; i < trace_results.size(); i++) {
+            const auto &r = trace_results[i];
+            std::cout << r.trace << ", " << (i % TRACE_N_RUNS) << ", "
+                      << r.result.getOps() << ", "
+                      << r.n_events[0] << ", " << r.n_events[1] << ", " << r.n_events[2] << ", "
                       << std::fixed << std::setprecision(3)
-                      << a.total_h2d_us << ", " << a.total_d2h_us << ", "
-                      << a.total_bundle_us << ", " << total_us << ", "
-                      << a.total_h2d_bytes << ", " << a.total_d2h_bytes << ", "
-                      << a.total_cycles << std::endl;
+                      << r.kind_time[0] / 1e3 << ", " << r.kind_time[1] / 1e3 << ", "
+                      << r.kind_time[2] / 1e3 << ", " << (r.kind_time[0] + r.kind_time[1] + r.kind_time[2]) / 1e3 << ", "
+                      << r.h2d_bytes << ", " << r.d2h_bytes << ", "
+                      << r.cycles << std::endl;
         }
+
+        std::cout << std::endl << "# per-trace throughput and latency" << std::endl;
+        coyote::cTraceReplay::writeCsv(std::cout, trace_results);
     }
 
     std::cout << "\n=== ASYMMETRIC DMA TEST ===" << std::endl;
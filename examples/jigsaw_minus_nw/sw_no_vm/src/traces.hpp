@@ -1,503 +0,0 @@
-/* AUTO-GENERATED by extract_traces.py. Do not edit. */
-/* Include from exactly one translation unit. */
-#ifndef JIGSAW_TRACES_HPP
-#define JIGSAW_TRACES_HPP
-
-#include <cstdint>
-#include <cstddef>
-
-enum trace_kind {
-    TRACE_BULK_H2D = 0,
-    TRACE_BULK_D2H = 1,
-    TRACE_BUNDLE   = 2,
-};
-
-struct trace_event {
-    uint8_t  kind;
-    uint64_t h2d_size;       /* bytes; BULK_H2D, BUNDLE */
-    uint64_t d2h_size;       /* bytes; BULK_D2H, BUNDLE */
-    uint64_t cycles;         /* BUNDLE only */
-    int original_count; /* raw events folded into this entry */
-};
-
-#define JIGSAW_TRACE_MAX_BYTES 14550656ULL
-#define JIGSAW_BUNDLE_THRESHOLD 256ULL  /* small <=> <= this */
-
-namespace jigsaw_traces_ns {
-
-static const struct trace_event tr_bfs[] = {
-    { 0, 32768ULL, 0ULL, 0ULL, 1 },
-    { 0, 32768ULL, 0ULL, 0ULL, 1 },
-    { 0, 98304ULL, 0ULL, 0ULL, 1 },
-    { 0, 98304ULL, 0ULL, 0ULL, 1 },
-    { 0, 4096ULL, 0ULL, 0ULL, 1 },
-    { 0, 4096ULL, 0ULL, 0ULL, 1 },
-    { 0, 4096ULL, 0ULL, 0ULL, 1 },
-    { 0, 4096ULL, 0ULL, 0ULL, 1 },
-    { 0, 4096ULL, 0ULL, 0ULL, 1 },
-    { 0, 4096ULL, 0ULL, 0ULL, 1 },
-    { 0, 16384ULL, 0ULL, 0ULL, 1 },
-    { 0, 16384ULL, 0ULL, 0ULL, 1 },
-    { 0, 29896ULL, 0ULL, 0ULL, 1 },
-    { 2, 74ULL, 0ULL, 149573ULL, 4 },
-    { 2, 64ULL, 1ULL, 136420ULL, 3 },
-    { 2, 73ULL, 0ULL, 140956ULL, 3 },
-    { 2, 64ULL, 1ULL, 130555ULL, 3 },
-    { 2, 73ULL, 0ULL, 148911ULL, 3 },
-    { 2, 64ULL, 1ULL, 135888ULL, 3 },
-    { 2, 73ULL, 0ULL, 193950ULL, 3 },
-    { 2, 64ULL, 1ULL, 147829ULL, 3 },
-    { 2, 73ULL, 0ULL, 318273ULL, 3 },
-    { 2, 64ULL, 1ULL, 146858ULL, 3 },
-    { 2, 73ULL, 0ULL, 284353ULL, 3 },
-    { 2, 64ULL, 1ULL, 135383ULL, 3 },
-    { 2, 73ULL, 0ULL, 151490ULL, 3 },
-    { 2, 64ULL, 1ULL, 136141ULL, 3 },
-    { 2, 73ULL, 0ULL, 134923ULL, 3 },
-    { 2, 64ULL, 1ULL, 129448ULL, 3 },
-    { 1, 0ULL, 16384ULL, 0ULL, 1 },
-};
-
-static const struct trace_event tr_blackscholes[] = {
-    { 0, 1024ULL, 0ULL, 0ULL, 1 },
-    { 0, 1024ULL, 0ULL, 0ULL, 1 },
-    { 0, 1024ULL, 0ULL, 0ULL, 1 },
-    { 0, 33608ULL, 0ULL, 0ULL, 1 },
-    { 2, 76ULL, 0ULL, 3102206ULL, 2 },
-    { 1, 0ULL, 1024ULL, 0ULL, 1 },
-    { 1, 0ULL, 1024ULL, 0ULL, 1 },
-};
-
-static const struct trace_event tr_conv3[] = {
-    { 0, 266256ULL, 0ULL, 0ULL, 1 },
-    { 0, 29736ULL, 0ULL, 0ULL, 1 },
-    { 2, 100ULL, 0ULL, 2410300ULL, 3 },
-    { 1, 0ULL, 262144ULL, 0ULL, 1 },
-};
-
-static const struct trace_event tr_dotproduct[] = {
-    { 0, 1048576ULL, 0ULL, 0ULL, 1 },
-    { 0, 1048576ULL, 0ULL, 0ULL, 1 },
-    { 0, 29592ULL, 0ULL, 0ULL, 1 },
-    { 2, 60ULL, 0ULL, 3056195ULL, 2 },
-    { 1, 0ULL, 262144ULL, 0ULL, 1 },
-};
-
-static const struct trace_event tr_guassian[] = {
-    { 0, 65536ULL, 0ULL, 0ULL, 1 },
-    { 0, 512ULL, 0ULL, 0ULL, 1 },
-    { 0, 65536ULL, 0ULL, 0ULL, 1 },
-    { 0, 29880ULL, 0ULL, 0ULL, 1 },
-    { 2, 64ULL, 0ULL, 37941ULL, 2 },
-    { 2, 64ULL, 0ULL, 648474ULL, 2 },
-    { 2, 64ULL, 0ULL, 32781ULL, 2 },
-    { 2, 64ULL, 0ULL, 638744ULL, 2 },
-    { 2, 64ULL, 0ULL, 33016ULL, 2 },
-    { 2, 64ULL, 0ULL, 635635ULL, 2 },
-    { 2, 64ULL, 0ULL, 32953ULL, 2 },
-    { 2, 64ULL, 0ULL, 631667ULL, 2 },
-    { 2, 64ULL, 0ULL, 32948ULL, 2 },
-    { 2, 64ULL, 0ULL, 647421ULL, 2 },
-    { 2, 64ULL, 0ULL, 32871ULL, 2 },
-    { 2, 64ULL, 0ULL, 613296ULL, 2 },
-    { 2, 64ULL, 0ULL, 32969ULL, 2 },
-    { 2, 64ULL, 0ULL, 616873ULL, 2 },
-    { 2, 64ULL, 0ULL, 32918ULL, 2 },
-    { 2, 64ULL, 0ULL, 610030ULL, 2 },
-    { 2, 64ULL, 0ULL, 32840ULL, 2 },
-    { 2, 64ULL, 0ULL, 588007ULL, 2 },
-    { 2, 64ULL, 0ULL, 32788ULL, 2 },
-    { 2, 64ULL, 0ULL, 617502ULL, 2 },
-    { 2, 64ULL, 0ULL, 32870ULL, 2 },
-    { 2, 64ULL, 0ULL, 616931ULL, 2 },
-    { 2, 64ULL, 0ULL, 32978ULL, 2 },
-    { 2, 64ULL, 0ULL, 605101ULL, 2 },
-    { 2, 64ULL, 0ULL, 32612ULL, 2 },
-    { 2, 64ULL, 0ULL, 599702ULL, 2 },
-    { 2, 64ULL, 0ULL, 32644ULL, 2 },
-    { 2, 64ULL, 0ULL, 598644ULL, 2 },
-    { 2, 64ULL, 0ULL, 32747ULL, 2 },
-    { 2, 64ULL, 0ULL, 585620ULL, 2 },
-    { 2, 64ULL, 0ULL, 32501ULL, 2 },
-    { 2, 64ULL, 0ULL, 584391ULL, 2 },
-    { 2, 64ULL, 0ULL, 32836ULL, 2 },
-    { 2, 64ULL, 0ULL, 591900ULL, 2 },
-    { 2, 64ULL, 0ULL, 32265ULL, 2 },
-    { 2, 64ULL, 0ULL, 589244ULL, 2 },
-    { 2, 64ULL, 0ULL, 32657ULL, 2 },
-    { 2, 64ULL, 0ULL, 596673ULL, 2 },
-    { 2, 64ULL, 0ULL, 32369ULL, 2 },
-    { 2, 64ULL, 0ULL, 605185ULL, 2 },
-    { 2, 64ULL, 0ULL, 32538ULL, 2 },
-    { 2, 64ULL, 0ULL, 573978ULL, 2 },
-    { 2, 64ULL, 0ULL, 32254ULL, 2 },
-    { 2, 64ULL, 0ULL, 589064ULL, 2 },
-    { 2, 64ULL, 0ULL, 32553ULL, 2 },
-    { 2, 64ULL, 0ULL, 587854ULL, 2 },
-    { 2, 64ULL, 0ULL, 32733ULL, 2 },
-    { 2, 64ULL, 0ULL, 578238ULL, 2 },
-    { 2, 64ULL, 0ULL, 32451ULL, 2 },
-    { 2, 64ULL, 0ULL, 564164ULL, 2 },
-    { 2, 64ULL, 0ULL, 32474ULL, 2 },
-    { 2, 64ULL, 0ULL, 570896ULL, 2 },
-    { 2, 64ULL, 0ULL, 32625ULL, 2 },
-    { 2, 64ULL, 0ULL, 572900ULL, 2 },
-    { 2, 64ULL, 0ULL, 32479ULL, 2 },
-    { 2, 64ULL, 0ULL, 579110ULL, 2 },
-    { 2, 64ULL, 0ULL, 32710ULL, 2 },
-    { 2, 64ULL, 0ULL, 567784ULL, 2 },
-    { 2, 64ULL, 0ULL, 32342ULL, 2 },
-    { 2, 64ULL, 0ULL, 565691ULL, 2 },
-    { 2, 64ULL, 0ULL, 32469ULL, 2 },
-    { 2, 64ULL, 0ULL, 555609ULL, 2 },
-    { 2, 64ULL, 0ULL, 32589ULL, 2 },
-    { 2, 64ULL, 0ULL, 562493ULL, 2 },
-    { 2, 64ULL, 0ULL, 32545ULL, 2 },
-    { 2, 64ULL, 0ULL, 571652ULL, 2 },
-    { 2, 64ULL, 0ULL, 32630ULL, 2 },
-    { 2, 64ULL, 0ULL, 575742ULL, 2 },
-    { 2, 64ULL, 0ULL, 32525ULL, 2 },
-    { 2, 64ULL, 0ULL, 572698ULL, 2 },
-    { 2, 64ULL, 0ULL, 32644ULL, 2 },
-    { 2, 64ULL, 0ULL, 569173ULL, 2 },
-    { 2, 64ULL, 0ULL, 32425ULL, 2 },
-    { 2, 64ULL, 0ULL, 558697ULL, 2 },
-    { 2, 64ULL, 0ULL, 32270ULL, 2 },
-    { 2, 64ULL, 0ULL, 554010ULL, 2 },
-    { 2, 64ULL, 0ULL, 33405ULL, 2 },
-    { 2, 64ULL, 0ULL, 551599ULL, 2 },
-    { 2, 64ULL, 0ULL, 32317ULL, 2 },
-    { 2, 64ULL, 0ULL, 556181ULL, 2 },
-    { 2, 64ULL, 0ULL, 33581ULL, 2 },
-    { 2, 64ULL, 0ULL, 550566ULL, 2 },
-    { 2, 64ULL, 0ULL, 32489ULL, 2 },
-    { 2, 64ULL, 0ULL, 552520ULL, 2 },
-    { 2, 64ULL, 0ULL, 32241ULL, 2 },
-    { 2, 64ULL, 0ULL, 551097ULL, 2 },
-    { 2, 64ULL, 0ULL, 32396ULL, 2 },
-    { 2, 64ULL, 0ULL, 541313ULL, 2 },
-    { 2, 64ULL, 0ULL, 32426ULL, 2 },
-    { 2, 64ULL, 0ULL, 542204ULL, 2 },
-    { 2, 64ULL, 0ULL, 33338ULL, 2 },
-    { 2, 64ULL, 0ULL, 537299ULL, 2 },
-    { 2, 64ULL, 0ULL, 33213ULL, 2 },
-    { 2, 64ULL, 0ULL, 540619ULL, 2 },
-    { 2, 64ULL, 0ULL, 32108ULL, 2 },
-    { 2, 64ULL, 0ULL, 538881ULL, 2 },
-    { 2, 64ULL, 0ULL, 32188ULL, 2 },
-    { 2, 64ULL, 0ULL, 552808ULL, 2 },
-    { 2, 64ULL, 0ULL, 32376ULL, 2 },
-    { 2, 64ULL, 0ULL, 539070ULL, 2 },
-    { 2, 64ULL, 0ULL, 32302ULL, 2 },
-    { 2, 64ULL, 0ULL, 543176ULL, 2 },
-    { 2, 64ULL, 0ULL, 32347ULL, 2 },
-    { 2, 64ULL, 0ULL, 535967ULL, 2 },
-    { 2, 64ULL, 0ULL, 32194ULL, 2 },
-    { 2, 64ULL, 0ULL, 533928ULL, 2 },
-    { 2, 64ULL, 0ULL, 32328ULL, 2 },
-    { 2, 64ULL, 0ULL, 542222ULL, 2 },
-    { 2, 64ULL, 0ULL, 32223ULL, 2 },
-    { 2, 64ULL, 0ULL, 535411ULL, 2 },
-    { 2, 64ULL, 0ULL, 32409ULL, 2 },
-    { 2, 64ULL, 0ULL, 526077ULL, 2 },
-    { 2, 64ULL, 0ULL, 33437ULL, 2 },
-    { 2, 64ULL, 0ULL, 523020ULL, 2 },
-    { 2, 64ULL, 0ULL, 33593ULL, 2 },
-    { 2, 64ULL, 0ULL, 528500ULL, 2 },
-    { 2, 64ULL, 0ULL, 32548ULL, 2 },
-    { 2, 64ULL, 0ULL, 525224ULL, 2 },
-    { 2, 64ULL, 0ULL, 33696ULL, 2 },
-    { 2, 64ULL, 0ULL, 520275ULL, 2 },
-    { 2, 64ULL, 0ULL, 33539ULL, 2 },
-    { 2, 64ULL, 0ULL, 520591ULL, 2 },
-    { 2, 64ULL, 0ULL, 33475ULL, 2 },
-    { 2, 64ULL, 0ULL, 512487ULL, 2 },
-    { 2, 64ULL, 0ULL, 32283ULL, 2 },
-    { 2, 64ULL, 0ULL, 518010ULL, 2 },
-    { 2, 64ULL, 0ULL, 33586ULL, 2 },
-    { 2, 64ULL, 0ULL, 513149ULL, 2 },
-    { 2, 64ULL, 0ULL, 33367ULL, 2 },
-    { 2, 64ULL, 0ULL, 517938ULL, 2 },
-    { 2, 64ULL, 0ULL, 32131ULL, 2 },
-    { 2, 64ULL, 0ULL, 520232ULL, 2 },
-    { 2, 64ULL, 0ULL, 33004ULL, 2 },
-    { 2, 64ULL, 0ULL, 519924ULL, 2 },
-    { 2, 64ULL, 0ULL, 33066ULL, 2 },
-    { 2, 64ULL, 0ULL, 512135ULL, 2 },
-    { 2, 64ULL, 0ULL, 33102ULL, 2 },
-    { 2, 64ULL, 0ULL, 501510ULL, 2 },
-    { 2, 64ULL, 0ULL, 33062ULL, 2 },
-    { 2, 64ULL, 0ULL, 503743ULL, 2 },
-    { 2, 64ULL, 0ULL, 32974ULL, 2 },
-    { 2, 64ULL, 0ULL, 501552ULL, 2 },
-    { 2, 64ULL, 0ULL, 32917ULL, 2 },
-    { 2, 64ULL, 0ULL, 497490ULL, 2 },
-    { 2, 64ULL, 0ULL, 32806ULL, 2 },
-    { 2, 64ULL, 0ULL, 499533ULL, 2 },
-    { 2, 64ULL, 0ULL, 32894ULL, 2 },
-    { 2, 64ULL, 0ULL, 492695ULL, 2 },
-    { 2, 64ULL, 0ULL, 33357ULL, 2 },
-    { 2, 64ULL, 0ULL, 496278ULL, 2 },
-    { 2, 64ULL, 0ULL, 33324ULL, 2 },
-    { 2, 64ULL, 0ULL, 487181ULL, 2 },
-    { 2, 64ULL, 0ULL, 33191ULL, 2 },
-    { 2, 64ULL, 0ULL, 484012ULL, 2 },
-    { 2, 64ULL, 0ULL, 33232ULL, 2 },
-    { 2, 64ULL, 0ULL, 483390ULL, 2 },
-    { 2, 64ULL, 0ULL, 33337ULL, 2 },
-    { 2, 64ULL, 0ULL, 480287ULL, 2 },
-    { 2, 64ULL, 0ULL, 33182ULL, 2 },
-    { 2, 64ULL, 0ULL, 480415ULL, 2 },
-    { 2, 64ULL, 0ULL, 33100ULL, 2 },
-    { 2, 64ULL, 0ULL, 484680ULL, 2 },
-    { 2, 64ULL, 0ULL, 33043ULL, 2 },
-    { 2, 64ULL, 0ULL, 481819ULL, 2 },
-    { 2, 64ULL, 0ULL, 31864ULL, 2 },
-    { 2, 64ULL, 0ULL, 483838ULL, 2 },
-    { 2, 64ULL, 0ULL, 31695ULL, 2 },
-    { 2, 64ULL, 0ULL, 477947ULL, 2 },
-    { 2, 64ULL, 0ULL, 31520ULL, 2 },
-    { 2, 64ULL, 0ULL, 473707ULL, 2 },
-    { 2, 64ULL, 0ULL, 31980ULL, 2 },
-    { 2, 64ULL, 0ULL, 472864ULL, 2 },
-    { 2, 64ULL, 0ULL, 32050ULL, 2 },
-    { 2, 64ULL, 0ULL, 471953ULL, 2 },
-    { 2, 64ULL, 0ULL, 31984ULL, 2 },
-    { 2, 64ULL, 0ULL, 470707ULL, 2 },
-    { 2, 64ULL, 0ULL, 31953ULL, 2 },
-    { 2, 64ULL, 0ULL, 467673ULL, 2 },
-    { 2, 64ULL, 0ULL, 31869ULL, 2 },
-    { 2, 64ULL, 0ULL, 467187ULL, 2 },
-    { 2, 64ULL, 0ULL, 31939ULL, 2 },
-    { 2, 64ULL, 0ULL, 466635ULL, 2 },
-    { 2, 64ULL, 0ULL, 32022ULL, 2 },
-    { 2, 64ULL, 0ULL, 461035ULL, 2 },
-    { 2, 64ULL, 0ULL, 31992ULL, 2 },
-    { 2, 64ULL, 0ULL, 458479ULL, 2 },
-    { 2, 64ULL, 0ULL, 32063ULL, 2 },
-    { 2, 64ULL, 0ULL, 456183ULL, 2 },
-    { 2, 64ULL, 0ULL, 32133ULL, 2 },
-    { 2, 64ULL, 0ULL, 452946ULL, 2 },
-    { 2, 64ULL, 0ULL, 33023ULL, 2 },
-    { 2, 64ULL, 0ULL, 448653ULL, 2 },
-    { 2, 64ULL, 0ULL, 33202ULL, 2 },
-    { 2, 64ULL, 0ULL, 456097ULL, 2 },
-    { 2, 64ULL, 0ULL, 31800ULL, 2 },
-    { 2, 64ULL, 0ULL, 450917ULL, 2 },
-    { 2, 64ULL, 0ULL, 31749ULL, 2 },
-    { 2, 64ULL, 0ULL, 453540ULL, 2 },
-    { 2, 64ULL, 0ULL, 31711ULL, 2 },
-    { 2, 64ULL, 0ULL, 448279ULL, 2 },
-    { 2, 64ULL, 0ULL, 31205ULL, 2 },
-    { 2, 64ULL, 0ULL, 447684ULL, 2 },
-    { 2, 64ULL, 0ULL, 31407ULL, 2 },
-    { 2, 64ULL, 0ULL, 448617ULL, 2 },
-    { 2, 64ULL, 0ULL, 31349ULL, 2 },
-    { 2, 64ULL, 0ULL, 446737ULL, 2 },
-    { 2, 64ULL, 0ULL, 31233ULL, 2 },
-    { 2, 64ULL, 0ULL, 443880ULL, 2 },
-    { 2, 64ULL, 0ULL, 31430ULL, 2 },
-    { 2, 64ULL, 0ULL, 444542ULL, 2 },
-    { 2, 64ULL, 0ULL, 31308ULL, 2 },
-    { 2, 64ULL, 0ULL, 441116ULL, 2 },
-    { 2, 64ULL, 0ULL, 31053ULL, 2 },
-    { 2, 64ULL, 0ULL, 440768ULL, 2 },
-    { 2, 64ULL, 0ULL, 31219ULL, 2 },
-    { 2, 64ULL, 0ULL, 437383ULL, 2 },
-    { 2, 64ULL, 0ULL, 31738ULL, 2 },
-    { 2, 64ULL, 0ULL, 436063ULL, 2 },
-    { 2, 64ULL, 0ULL, 31665ULL, 2 },
-    { 2, 64ULL, 0ULL, 434391ULL, 2 },
-    { 2, 64ULL, 0ULL, 31738ULL, 2 },
-    { 2, 64ULL, 0ULL, 431471ULL, 2 },
-    { 2, 64ULL, 0ULL, 31329ULL, 2 },
-    { 2, 64ULL, 0ULL, 429374ULL, 2 },
-    { 2, 64ULL, 0ULL, 31274ULL, 2 },
-    { 2, 64ULL, 0ULL, 431811ULL, 2 },
-    { 2, 64ULL, 0ULL, 31225ULL, 2 },
-    { 2, 64ULL, 0ULL, 433212ULL, 2 },
-    { 2, 64ULL, 0ULL, 32408ULL, 2 },
-    { 2, 64ULL, 0ULL, 432288ULL, 2 },
-    { 2, 64ULL, 0ULL, 32319ULL, 2 },
-    { 2, 64ULL, 0ULL, 427249ULL, 2 },
-    { 2, 64ULL, 0ULL, 32322ULL, 2 },
-    { 2, 64ULL, 0ULL, 428899ULL, 2 },
-    { 2, 64ULL, 0ULL, 32287ULL, 2 },
-    { 2, 64ULL, 0ULL, 428051ULL, 2 },
-    { 2, 64ULL, 0ULL, 32469ULL, 2 },
-    { 2, 64ULL, 0ULL, 430309ULL, 2 },
-    { 2, 64ULL, 0ULL, 32604ULL, 2 },
-    { 2, 64ULL, 0ULL, 427616ULL, 2 },
-    { 2, 64ULL, 0ULL, 32495ULL, 2 },
-    { 2, 64ULL, 0ULL, 424661ULL, 2 },
-    { 2, 64ULL, 0ULL, 31284ULL, 2 },
-    { 2, 64ULL, 0ULL, 424032ULL, 2 },
-    { 2, 64ULL, 0ULL, 31284ULL, 2 },
-    { 2, 64ULL, 0ULL, 423279ULL, 2 },
-    { 2, 64ULL, 0ULL, 31302ULL, 2 },
-    { 2, 64ULL, 0ULL, 421130ULL, 2 },
-    { 2, 64ULL, 0ULL, 32424ULL, 2 },
-    { 2, 64ULL, 0ULL, 421778ULL, 2 },
-    { 2, 64ULL, 0ULL, 32619ULL, 2 },
-    { 2, 64ULL, 0ULL, 421466ULL, 2 },
-    { 2, 64ULL, 0ULL, 32619ULL, 2 },
-    { 2, 64ULL, 0ULL, 421943ULL, 2 },
-    { 1, 0ULL, 65536ULL, 0ULL, 1 },
-    { 1, 0ULL, 512ULL, 0ULL, 1 },
-    { 1, 0ULL, 65536ULL, 0ULL, 1 },
-};
-
-static const struct trace_event tr_kmeans[] = {
-    { 0, 4194304ULL, 0ULL, 0ULL, 1 },
-    { 0, 29920ULL, 0ULL, 0ULL, 1 },
-    { 2, 60ULL, 0ULL, 8342519ULL, 2 },
-    { 0, 10240ULL, 0ULL, 0ULL, 1 },
-    { 2, 76ULL, 0ULL, 18022107ULL, 2 },
-    { 1, 0ULL, 8192ULL, 0ULL, 1 },
-    { 0, 10240ULL, 0ULL, 0ULL, 1 },
-    { 2, 76ULL, 0ULL, 17927284ULL, 2 },
-    { 1, 0ULL, 8192ULL, 0ULL, 1 },
-};
-
-static const struct trace_event tr_lbm[] = {
-    { 0, 1228800ULL, 0ULL, 0ULL, 1 },
-    { 0, 1228800ULL, 0ULL, 0ULL, 1 },
-    { 0, 30832ULL, 0ULL, 0ULL, 1 },
-    { 2, 52ULL, 0ULL, 3198780ULL, 2 },
-    { 1, 0ULL, 1228800ULL, 0ULL, 1 },
-};
-
-static const struct trace_event tr_nearn[] = {
-    { 0, 342112ULL, 0ULL, 0ULL, 1 },
-    { 0, 29536ULL, 0ULL, 0ULL, 1 },
-    { 2, 64ULL, 0ULL, 1219129ULL, 2 },
-    { 1, 0ULL, 171056ULL, 0ULL, 1 },
-};
-
-static const struct trace_event tr_oclprintf[] = {
-    { 0, 29624ULL, 0ULL, 0ULL, 1 },
-    { 2, 112ULL, 0ULL, 74989ULL, 3 },
-};
-
-static const struct trace_event tr_psort[] = {
-    { 0, 2048ULL, 0ULL, 0ULL, 1 },
-    { 0, 29768ULL, 0ULL, 0ULL, 1 },
-    { 2, 52ULL, 0ULL, 1114640ULL, 2 },
-    { 1, 0ULL, 2048ULL, 0ULL, 1 },
-};
-
-static const struct trace_event tr_psum[] = {
-    { 0, 262144ULL, 0ULL, 0ULL, 1 },
-    { 0, 29824ULL, 0ULL, 0ULL, 1 },
-    { 2, 64ULL, 0ULL, 5048647ULL, 2 },
-    { 1, 0ULL, 32768ULL, 0ULL, 1 },
-};
-
-static const struct trace_event tr_saxpy[] = {
-    { 0, 262144ULL, 0ULL, 0ULL, 1 },
-    { 0, 262144ULL, 0ULL, 0ULL, 1 },
-    { 0, 29496ULL, 0ULL, 0ULL, 1 },
-    { 2, 56ULL, 0ULL, 2200793ULL, 2 },
-    { 1, 0ULL, 262144ULL, 0ULL, 1 },
-};
-
-static const struct trace_event tr_sfilter[] = {
-    { 0, 262144ULL, 0ULL, 0ULL, 1 },
-    { 0, 262144ULL, 0ULL, 0ULL, 1 },
-    { 0, 29744ULL, 0ULL, 0ULL, 1 },
-    { 2, 96ULL, 0ULL, 2310785ULL, 2 },
-    { 1, 0ULL, 262144ULL, 0ULL, 1 },
-};
-
-static const struct trace_event tr_sgemm[] = {
-    { 0, 65536ULL, 0ULL, 0ULL, 1 },
-    { 0, 65536ULL, 0ULL, 0ULL, 1 },
-    { 0, 29584ULL, 0ULL, 0ULL, 1 },
-    { 2, 60ULL, 0ULL, 7793804ULL, 2 },
-    { 1, 0ULL, 65536ULL, 0ULL, 1 },
-};
-
-static const struct trace_event tr_sgemm2[] = {
-    { 0, 65536ULL, 0ULL, 0ULL, 1 },
-    { 0, 65536ULL, 0ULL, 0ULL, 1 },
-    { 0, 29952ULL, 0ULL, 0ULL, 1 },
-    { 2, 72ULL, 0ULL, 8409974ULL, 2 },
-    { 1, 0ULL, 65536ULL, 0ULL, 1 },
-};
-
-static const struct trace_event tr_sgemm3[] = {
-    { 0, 65536ULL, 0ULL, 0ULL, 1 },
-    { 0, 65536ULL, 0ULL, 0ULL, 1 },
-    { 0, 30008ULL, 0ULL, 0ULL, 1 },
-    { 2, 72ULL, 0ULL, 9152849ULL, 2 },
-    { 1, 0ULL, 65536ULL, 0ULL, 1 },
-};
-
-static const struct trace_event tr_spmv[] = {
-    { 0, 586756ULL, 0ULL, 0ULL, 1 },
-    { 0, 14550656ULL, 0ULL, 0ULL, 1 },
-    { 0, 14550656ULL, 0ULL, 0ULL, 1 },
-    { 0, 586756ULL, 0ULL, 0ULL, 1 },
-    { 0, 586756ULL, 0ULL, 0ULL, 1 },
-    { 0, 18340ULL, 0ULL, 0ULL, 1 },
-    { 0, 29656ULL, 0ULL, 0ULL, 1 },
-    { 2, 276ULL, 0ULL, 53595074ULL, 3 },
-    { 1, 0ULL, 586756ULL, 0ULL, 1 },
-};
-
-static const struct trace_event tr_stencil[] = {
-    { 0, 131072ULL, 0ULL, 0ULL, 1 },
-    { 0, 131072ULL, 0ULL, 0ULL, 1 },
-    { 0, 29768ULL, 0ULL, 0ULL, 1 },
-    { 2, 72ULL, 0ULL, 1579224ULL, 2 },
-    { 1, 0ULL, 131072ULL, 0ULL, 1 },
-};
-
-static const struct trace_event tr_transpose[] = {
-    { 0, 4194304ULL, 0ULL, 0ULL, 1 },
-    { 0, 30888ULL, 0ULL, 0ULL, 1 },
-    { 2, 64ULL, 0ULL, 31504687ULL, 2 },
-    { 2, 64ULL, 0ULL, 31791918ULL, 2 },
-    { 1, 0ULL, 4194304ULL, 0ULL, 1 },
-};
-
-static const struct trace_event tr_vecadd[] = {
-    { 0, 262144ULL, 0ULL, 0ULL, 1 },
-    { 0, 262144ULL, 0ULL, 0ULL, 1 },
-    { 0, 29496ULL, 0ULL, 0ULL, 1 },
-    { 2, 56ULL, 0ULL, 2209879ULL, 2 },
-    { 1, 0ULL, 262144ULL, 0ULL, 1 },
-};
-
-struct trace_app {
-    const char *name;
-    const struct trace_event *events;
-    std::size_t n;
-};
-
-static const struct trace_app jigsaw_traces[] = {
-    { "bfs", tr_bfs, sizeof(tr_bfs)/sizeof(tr_bfs[0]) },
-    { "blackscholes", tr_blackscholes, sizeof(tr_blackscholes)/sizeof(tr_blackscholes[0]) },
-    { "conv3", tr_conv3, sizeof(tr_conv3)/sizeof(tr_conv3[0]) },
-    { "dotproduct", tr_dotproduct, sizeof(tr_dotproduct)/sizeof(tr_dotproduct[0]) },
-    { "guassian", tr_guassian, sizeof(tr_guassian)/sizeof(tr_guassian[0]) },
-    { "kmeans", tr_kmeans, sizeof(tr_kmeans)/sizeof(tr_kmeans[0]) },
-    { "lbm", tr_lbm, sizeof(tr_lbm)/sizeof(tr_lbm[0]) },
-    { "nearn", tr_nearn, sizeof(tr_nearn)/sizeof(tr_nearn[0]) },
-    { "oclprintf", tr_oclprintf, sizeof(tr_oclprintf)/sizeof(tr_oclprintf[0]) },
-    { "psort", tr_psort, sizeof(tr_psort)/sizeof(tr_psort[0]) },
-    { "psum", tr_psum, sizeof(tr_psum)/sizeof(tr_psum[0]) },
-    { "saxpy", tr_saxpy, sizeof(tr_saxpy)/sizeof(tr_saxpy[0]) },
-    { "sfilter", tr_sfilter, sizeof(tr_sfilter)/sizeof(tr_sfilter[0]) },
-    { "sgemm", tr_sgemm, sizeof(tr_sgemm)/sizeof(tr_sgemm[0]) },
-    { "sgemm2", tr_sgemm2, sizeof(tr_sgemm2)/sizeof(tr_sgemm2[0]) },
-    { "sgemm3", tr_sgemm3, sizeof(tr_sgemm3)/sizeof(tr_sgemm3[0]) },
-    { "spmv", tr_spmv, sizeof(tr_spmv)/sizeof(tr_spmv[0]) },
-    { "stencil", tr_stencil, sizeof(tr_stencil)/sizeof(tr_stencil[0]) },
-    { "transpose", tr_transpose, sizeof(tr_transpose)/sizeof(tr_transpose[0]) },
-    { "vecadd", tr_vecadd, sizeof(tr_vecadd)/sizeof(tr_vecadd[0]) },
-};
-
-} // namespace jigsaw_traces_ns
-
-#endif /* JIGSAW_TRACES_HPP */
@@ -8,14 +8,28 @@
  * all protocol logic sits inline in each program's main.cpp, mirroring the
  * structure of the proven jigsaw_baseline_rdma pair.
  *
- * Control plane: one 64 B mailbox slot per direction — requests at offset
- * 0, responses at offset 64 — so every slot has exactly ONE writer and a
- * node's send-source bytes are never overwritten by incoming traffic.
- * This matters because the stack's retransmitter re-reads local memory
- * when it replays a packet: under strict ping-pong a sender only reuses
- * its slot after the peer's answer proves the previous message was
- * delivered, so any packet that can still be retransmitted has stable
- * source bytes and its replay is byte-identical.
+ * Control plane: a ring of WINDOW_SLOTS mailbox slots per direction
+ * — requests in the first half of the control page, responses in the
+ * second — so every slot has exactly ONE writer and a node's send-source
+ * bytes are never overwritten by incoming traffic. Request `seq` lives in
+ * slot seq % WINDOW_SLOTS of either ring and every request gets its
+ * response in the matching response slot. This matters because the
+ * stack's retransmitter re-reads local memory when it replays a packet:
+ * a sender only reuses a slot after the peer's answer proves the message
+ * it held was delivered (the host keeps at most --window <= WINDOW_SLOTS
+ * requests unanswered; the device reuses a response slot only once the
+ * request WINDOW_SLOTS later arrived, sent after its answer was seen), so
+ * any packet that can still be retransmitted has stable source bytes and
+ * its replay is byte-identical.
+ *
+ * Windowing: writes are posted — the host stages them in consecutive
+ * request slots and pushes the staged run with one RDMA write when it
+ * needs an answer (a read, a full window, or going idle); only reads wait.
+ * The device serves requests strictly in seq order and pushes its run of
+ * responses once no further request is pending (or right after a read),
+ * again coalesced into one write. Responses are placed in order, so the
+ * response to a request acknowledges every request before it (cumulative
+ * acks). A window of 1 is the original strict ping-pong.
  *
  * The publish flag (`seq`, written last; RDMA WRITE places bytes in
  * increasing address order) is a monotonic counter rather than a
@@ -34,20 +48,50 @@
 
 namespace jsfwd {
 
-// QP buffer layout (identical on both nodes). Each mailbox message is sent
-// as a SLOT_BYTES-long write even though the msg struct is 64 B: the
-// shell's go-back-N replayer reproduces full-size packets correctly but
-// not tiny writes (the documented failure behind every captured hang), so
-// the message write is padded to a respectable single-packet size. The
-// padding bytes are zeroed once at init and never touched afterwards, so
-// a replayed message is byte-identical.
+// QP buffer layout (identical on both nodes, so both must be built with
+// the same JSFWD_SMALL_SLOTS setting). By default each message is sent as
+// a 2048 B write even though the msg struct is 64 B: the shell's
+// go-back-N replayer could read a packet back from its retransmission
+// buffer before the packet had been written there, which bursts of tiny
+// writes hit (the failure behind every captured hang). The padding bytes
+// are zeroed once at init and never touched afterwards, so a replayed
+// message is byte-identical. Only one such slot fits per direction, so the
+// window is 1.
+//
+// With JSFWD_SMALL_SLOTS (for shells built with EN_RDMA_RETRANS_FENCE,
+// whose replayer waits for those writes to land) each message is a 64 B slot, with
+// 32 slots per direction; a run of consecutive slots is sent as a single
+// write.
+#ifdef JSFWD_SMALL_SLOTS
+constexpr uint32_t SLOT_BYTES   = 64;                 // per-message write size
+constexpr uint32_t WINDOW_SLOTS = 32;                 // slots per direction
+#else
 constexpr uint32_t SLOT_BYTES   = 2048;               // per-message write size
-constexpr uint32_t REQ_OFF      = 0;                  // host -> device requests
-constexpr uint32_t RESP_OFF     = SLOT_BYTES;         // device -> host responses
+constexpr uint32_t WINDOW_SLOTS = 1;                  // slots per direction
+#endif
 constexpr uint32_t CONTROL_SIZE = 0x1000;             // control page (mailboxes)
+constexpr uint32_t REQ_OFF      = 0;                  // host -> device requests
+constexpr uint32_t RESP_OFF     = CONTROL_SIZE / 2;   // device -> host responses
 constexpr uint32_t PAYLOAD_OFF  = CONTROL_SIZE;       // == ivshmem DMA_REGION_OFFSET
 constexpr uint32_t BUF_BYTES    = 16U * 1024 * 1024;  // == ivshmem SHMEM_SIZE
-static_assert(2 * SLOT_BYTES <= CONTROL_SIZE, "slots must fit the control page");
+static_assert(WINDOW_SLOTS * SLOT_BYTES <= RESP_OFF - REQ_OFF, "request slots must fit their half");
+static_assert(WINDOW_SLOTS * SLOT_BYTES <= CONTROL_SIZE - RESP_OFF, "response slots must fit their half");
+
+// Slot of a request / its response in the QP buffer
+constexpr uint32_t req_off(uint64_t seq) {
+    return REQ_OFF + static_cast<uint32_t>(seq % WINDOW_SLOTS) * SLOT_BYTES;
+}
+constexpr uint32_t resp_off(uint64_t seq) {
+    return RESP_OFF + static_cast<uint32_t>(seq % WINDOW_SLOTS) * SLOT_BYTES;
+}
+
+// Zero-copy mode (host --zero_copy): the host registers its application
+// buffer (the ivshmem region) and the device its staging buffer as MR 1,
+// with the same layout as the QP buffer. Payloads are then pushed MR 1 ->
+// MR 1 with no staging copy on either node; the mailbox slots stay in the
+// QP buffer (MR 0). The device follows the host: it registers its staging
+// buffer unconditionally and pushes into MR 1 iff the host registered one.
+constexpr uint32_t PAYLOAD_MR   = 1;
 
 // Message structure for the control plane
 struct msg {
@@ -58,6 +102,7 @@ struct msg {
     uint64_t seq;        // monotonic publish flag, written last
 };
 static_assert(sizeof(msg) == 64, "msg must be 64 B");
+static_assert(sizeof(msg) <= SLOT_BYTES, "a message must fit its slot");
 
 enum : uint64_t {
     OP_SETUP      = 1,  // value = host vaddr of the app/ivshmem buffer
@@ -22,15 +22,25 @@
  *    buffer are deliberately separate (the staging copy a software
  *    forwarder on commodity hardware cannot avoid).
  *
- * Wire discipline: strict ping-pong, one 64 B slot per direction with a
- * monotonic publish counter (see messages.hpp) so hardware-level replays
- * are recognized and never re-executed. Completion state is cleared on
- * both threads after every request (the baseline server's cadence).
+ * Zero-copy mode follows the host (sw_host* --zero_copy): the staging
+ * buffer is always registered as MR 1 of the NIC thread, and when the host
+ * registered its application buffer too, payloads are pushed MR 1 -> MR 1
+ * in both directions and neither bounce above is needed (see PAYLOAD_MR in
+ * messages.hpp).
+ *
+ * Wire discipline: a ring of SLOT_BYTES slots per direction with a monotonic
+ * publish counter (see messages.hpp) so hardware-level replays are
+ * recognized and never re-executed. Requests are served strictly in seq
+ * order; responses to posted writes are coalesced until no further
+ * request is pending, all others are pushed at once. Completion state is
+ * cleared on both threads after every pushed batch (the baseline server's
+ * cadence).
  *
  * Usage:
  *   ./test            (waits for the host forwarder to connect)
  */
 
+#include <algorithm>
 #include <cstring>
 #include <iostream>
 #include <unistd.h>
@@ -52,6 +62,9 @@ static char *nic_buf;
 static char *device_buf;
 static uint64_t app_base;
 
+// Zero-copy mode: the host pushes into and receives from device_buf directly
+static bool zero_copy = false;
+
 // Shadow copies of the last-written DMA parameter registers, needed to
 // stage payloads and rewrite guest pointers at trigger time.
 static uint64_t sh_src, sh_dst, sh_h2d, sh_d2h;
@@ -78,7 +91,8 @@ static void stage_in(uint64_t src_ptr, uint64_t len) {
                   << off << ", len=0x" << len << std::dec << ")" << std::endl;
         return;
     }
-    memcpy(device_buf + off, nic_buf + off, len);
+    if (!zero_copy)
+        memcpy(device_buf + off, nic_buf + off, len);
 }
 
 // D2H: bounce the accelerator's output into the NIC buffer and push it to
@@ -91,12 +105,17 @@ static void stage_out(uint64_t dst_ptr, uint64_t len) {
                   << off << ", len=0x" << len << std::dec << ")" << std::endl;
         return;
     }
-    memcpy(nic_buf + off, device_buf + off, len);
+    if (!zero_copy)
+        memcpy(nic_buf + off, device_buf + off, len);
     uint64_t aligned = (len + 63) & ~uint64_t(63);
     if (off + aligned > BUF_BYTES)
         aligned = BUF_BYTES - off;
     coyote::rdmaSg sg = {.local_offs = off, .remote_offs = off,
                          .len = static_cast<uint32_t>(aligned)};
+    if (zero_copy) {
+        sg.local_mr = PAYLOAD_MR;
+        sg.remote_mr = PAYLOAD_MR;
+    }
     nic->invoke(coyote::CoyoteOper::REMOTE_RDMA_WRITE, sg);
 }
 
@@ -150,6 +169,24 @@ static uint64_t handle_read(uint64_t addr) {
     return value;
 }
 
+// Pushes the responses to requests [first, last] with one write (two if
+// the run wraps around the ring); responses are placed in order, so the
+// last one acknowledges all of them
+static void push_responses(uint64_t first, uint64_t last) {
+    while (first <= last) {
+        uint64_t n = std::min<uint64_t>(last - first + 1,
+                                        WINDOW_SLOTS - first % WINDOW_SLOTS);
+        coyote::rdmaSg sg = {.local_offs = resp_off(first), .remote_offs = resp_off(first),
+                             .len = static_cast<uint32_t>(n * SLOT_BYTES)};
+        nic->invoke(coyote::CoyoteOper::REMOTE_RDMA_WRITE, sg);
+        first += n;
+    }
+
+    // Cheap local flush every batch, the baseline server's cadence
+    nic->clearCompleted();
+    jig->clearCompleted();
+}
+
 int main(int argc, char *argv[]) {
     std::cout << "Starting Jigsaw SW Forwarder — Device Replayer..." << std::endl;
 
@@ -159,6 +196,18 @@ int main(int argc, char *argv[]) {
     nic = &coyote_nic;
     jig = &coyote_jigsaw;
 
+    // Staging buffer for the accelerator; also mapped into vFPGA 0's TLB
+    // and registered before the QP exchange, for zero-copy hosts
+    device_buf = static_cast<char *>(
+        coyote_jigsaw.getMem({coyote::CoyoteAllocType::HPF, BUF_BYTES}));
+    if (!device_buf) {
+        std::cerr << "device staging buffer allocation failed" << std::endl;
+        return EXIT_FAILURE;
+    }
+    memset(device_buf, 0, BUF_BYTES);  // pre-fault
+    coyote_nic.userMap(device_buf, BUF_BYTES);
+    coyote_nic.registerMr(device_buf, BUF_BYTES);
+
     std::cout << "Waiting for host connection on port " << coyote::DEF_PORT
               << " ..." << std::endl;
     nic_buf = static_cast<char *>(
@@ -169,32 +218,31 @@ int main(int argc, char *argv[]) {
     }
     memset(nic_buf, 0, CONTROL_SIZE);
 
-    // Staging buffer for the accelerator, mapped only into vFPGA 1's TLB
-    device_buf = static_cast<char *>(
-        coyote_jigsaw.getMem({coyote::CoyoteAllocType::HPF, BUF_BYTES}));
-    if (!device_buf) {
-        std::cerr << "device staging buffer allocation failed" << std::endl;
-        return EXIT_FAILURE;
-    }
-    memset(device_buf, 0, BUF_BYTES);  // pre-fault
+    zero_copy = coyote_nic.getNumRemoteMrs() >= PAYLOAD_MR;
+    std::cout << "Payload path: " << (zero_copy ? "zero-copy" : "staging copies") << std::endl;
 
     coyote_jigsaw.setCSR(coyote_jigsaw.getCtid(), COYOTE_PID_REG);
 
-    volatile struct msg *req  = reinterpret_cast<volatile struct msg *>(nic_buf + REQ_OFF);
-    struct msg *resp = reinterpret_cast<struct msg *>(nic_buf + RESP_OFF);
-
     // Initial sync with the host
     coyote_nic.connSync(false);
     std::cout << "Host connected." << std::endl;
 
-    uint64_t last_seq = 0;
+    uint64_t last_seq = 0;     // last request served
+    uint64_t pushed_seq = 0;   // last response on the wire
     uint64_t served = 0;
     bool running = true;
     while (running) {
-        // Poll for a new request: the monotonic publish counter advances
-        // exactly once per request, so a hardware-level replay of an
-        // already-seen message is ignored here.
-        if (req->seq <= last_seq) {
+        // Poll for the next request in its ring slot: the monotonic publish
+        // counter advances exactly once per request, so a hardware-level
+        // replay of an already-seen message is ignored here.
+        volatile struct msg *req =
+            reinterpret_cast<volatile struct msg *>(nic_buf + req_off(last_seq + 1));
+        if (req->seq != last_seq + 1) {
+            // Nothing pending: put the coalesced responses on the wire
+            if (pushed_seq < last_seq) {
+                push_responses(pushed_seq + 1, last_seq);
+                pushed_seq = last_seq;
+            }
             continue;
         }
         last_seq = req->seq;
@@ -224,20 +272,21 @@ int main(int argc, char *argv[]) {
             break;
         }
 
-        // Respond from the dedicated response slot (this node is its only
+        // Respond in the request's response slot (this node is its only
         // writer, so a pending retransmission always re-reads the bytes it
         // originally sent). seq mirrors the request's and is written last.
+        struct msg *resp = reinterpret_cast<struct msg *>(nic_buf + resp_off(last_seq));
         resp->op = op;
         resp->addr = addr;
         resp->value = result;
         resp->seq = last_seq;
-        coyote::rdmaSg sg = {.local_offs = RESP_OFF, .remote_offs = RESP_OFF,
-                             .len = SLOT_BYTES};
-        coyote_nic.invoke(coyote::CoyoteOper::REMOTE_RDMA_WRITE, sg);
 
-        // Cheap local flush every request, the baseline server's cadence
-        coyote_nic.clearCompleted();
-        coyote_jigsaw.clearCompleted();
+        // Posted writes are answered in batches; anything else is waited
+        // for by the host, so it goes out right away
+        if (op != OP_MMIO_WRITE) {
+            push_responses(pushed_seq + 1, last_seq);
+            pushed_seq = last_seq;
+        }
     }
 
     std::cout << "Host posted STOP after " << served << " requests." << std::endl;
@@ -32,6 +32,7 @@
 
 #include <boost/program_options.hpp>
 
+#include <coyote/cTrace.hpp>
 #include <coyote/cThread.hpp>
 
 #include "messages.hpp"
@@ -40,11 +41,6 @@ using namespace jsfwd;
 
 #define CLOCK_PERIOD_NS 4
 
-#include "traces.hpp"
-using namespace jigsaw_traces_ns;
-
-static constexpr uint32_t MIN_DMA_BYTES = 64;
-
 static coyote::cThread *g_jig = nullptr;
 
 static uint64_t rd(DevReg r) {
@@ -54,18 +50,6 @@ static void wr(DevReg r, uint64_t v) {
     g_jig->setCSR(v, dev_reg_index(static_cast<uint64_t>(r)));
 }
 
-static uint64_t clamp_dma(uint64_t raw, uint64_t mem_cap)
-{
-    uint64_t sz = (raw > mem_cap) ? mem_cap : raw;
-    if (sz != 0) {
-        sz = (sz + MIN_DMA_BYTES - 1) & ~static_cast<uint64_t>(MIN_DMA_BYTES - 1);
-        if (sz > mem_cap) {
-            sz = mem_cap & ~static_cast<uint64_t>(MIN_DMA_BYTES - 1);
-        }
-    }
-    return sz;
-}
-
 // Same stuck-operation diagnostics as the device replayer's wait_status.
 static void wait_status(uint64_t mask)
 {
@@ -87,9 +71,8 @@ static void wait_status(uint64_t mask)
 }
 
 // Identical MMIO sequence to the forwarder's do_bulk, executed locally.
-static double do_bulk(uint64_t dma_addr, uint32_t size, bool d2h)
+static void do_bulk(uint64_t dma_addr, uint32_t size, bool d2h)
 {
-    auto start = std::chrono::high_resolution_clock::now();
     uint64_t remaining = size, off = 0;
     while (remaining > 0) {
         uint64_t chunk = remaining > TRACE_CHUNK_BYTES ? TRACE_CHUNK_BYTES : remaining;
@@ -103,13 +86,10 @@ static double do_bulk(uint64_t dma_addr, uint32_t size, bool d2h)
         off += chunk;
         remaining -= chunk;
     }
-    auto end = std::chrono::high_resolution_clock::now();
-    return std::chrono::duration<double>(end - start).count();
 }
 
-// Identical MMIO sequence to the forwarder's do_bundle, executed locally.
-static double do_bundle(uint64_t dma_addr, uint32_t h2d, uint32_t d2h,
-                        uint64_t cycles)
+// Benchmark-only compute-cycle knob, staged outside the timed window.
+static void stage_cycles(uint64_t cycles)
 {
     wr(DevReg::CYCLES_COMPUTE, cycles);
     const uint64_t cycles_readback = rd(DevReg::CYCLES_COMPUTE);
@@ -118,8 +98,11 @@ static double do_bundle(uint64_t dma_addr, uint32_t h2d, uint32_t d2h,
                   << ", read " << cycles_readback << std::endl;
         throw std::runtime_error("CYCLES_COMPUTE readback mismatch");
     }
+}
 
-    auto start = std::chrono::high_resolution_clock::now();
+// Identical MMIO sequence to the forwarder's do_bundle, executed locally.
+static void do_bundle(uint64_t dma_addr, uint32_t h2d, uint32_t d2h)
+{
     wr(DevReg::DMA_SRC_ADDR, dma_addr);
     wr(DevReg::DMA_DST_ADDR, dma_addr);
     wr(DevReg::DMA_H2D_LEN, h2d);
@@ -127,21 +110,22 @@ static double do_bundle(uint64_t dma_addr, uint32_t h2d, uint32_t d2h,
     wr(DevReg::DMA_STATUS, 0);
     wr(DevReg::START_COMPUTE, 1);
     wait_status(STATUS_BUNDLE_DONE_MASK);
-    auto end = std::chrono::high_resolution_clock::now();
-    return std::chrono::duration<double>(end - start).count();
 }
 
 int main(int argc, char *argv[])
 {
     int vfpga_id = 1;
     int trace_runs = 1;
+    std::string trace_dir = JIGSAW_TRACE_DIR;
 
     boost::program_options::options_description opts("Jigsaw Device Selftest Options");
     opts.add_options()
         ("vfpga,v", boost::program_options::value<int>(&vfpga_id),
             "vFPGA id of jigsaw_baseline (1 on build_may11, 0 standalone)")
         ("trace_runs,r", boost::program_options::value<int>(&trace_runs),
-            "Runs per trace application");
+            "Runs per trace application")
+        ("traces,t", boost::program_options::value<std::string>(&trace_dir),
+            "Directory with the traces (*.trace) to replay");
 
     boost::program_options::variables_map vm;
     boost::program_options::store(
@@ -168,58 +152,45 @@ int main(int argc, char *argv[])
     uint64_t dma_addr = reinterpret_cast<uint64_t>(device_buf) + PAYLOAD_OFF;
     uint64_t dma_capacity = BUF_BYTES - PAYLOAD_OFF;
 
-    auto kind_str = [](uint8_t k) -> const char * {
-        switch (k) {
-            case TRACE_BULK_H2D: return "BULK_H2D";
-            case TRACE_BULK_D2H: return "BULK_D2H";
-            case TRACE_BUNDLE:   return "BUNDLE  ";
-            default:             return "UNKNOWN ";
-        }
-    };
+    coyote::cTraceReplay replay(&jig, reinterpret_cast<void *>(dma_addr), dma_capacity);
+    const std::string *trace_name = nullptr;
+    replay.setExecutor(
+        [&](uint64_t, const coyote::traceEvent &ev, uint64_t h2d, uint64_t d2h) {
+            switch (ev.kind) {
+            case coyote::CoyoteTraceKind::BULK_H2D:
+                do_bulk(dma_addr, static_cast<uint32_t>(h2d), false);
+                break;
+            case coyote::CoyoteTraceKind::BULK_D2H:
+                do_bulk(dma_addr, static_cast<uint32_t>(d2h), true);
+                break;
+            case coyote::CoyoteTraceKind::BUNDLE:
+                do_bundle(dma_addr, static_cast<uint32_t>(h2d), static_cast<uint32_t>(d2h));
+                break;
+            }
+        },
+        [&](uint64_t i, const coyote::traceEvent &ev, uint64_t h2d, uint64_t d2h) {
+            std::cerr << "[trace]   " << *trace_name << " ev=" << i
+                      << " kind=" << static_cast<int>(ev.kind)
+                      << " h2d=" << h2d << " d2h=" << d2h
+                      << " cycles=" << ev.cycles << std::endl;
+            if (ev.kind == coyote::CoyoteTraceKind::BUNDLE) {
+                stage_cycles(ev.cycles);
+            }
+        });
 
-    constexpr size_t n_apps = sizeof(jigsaw_traces) / sizeof(jigsaw_traces[0]);
-    for (size_t a = 0; a < n_apps; a++) {
-        const auto &app = jigsaw_traces[a];
-        std::cerr << "[trace] " << app.name << " (" << app.n << " events, "
+    std::vector<coyote::cTraceResult> results;
+    for (const auto &trace : coyote::cTrace::loadDir(trace_dir)) {
+        trace_name = &trace.getName();
+        std::cerr << "[trace] " << trace.getName() << " (" << trace.size() << " events, "
                   << trace_runs << " runs)" << std::endl;
 
         for (int run = 0; run < trace_runs; run++) {
-            for (size_t i = 0; i < app.n; i++) {
-                const auto &ev = app.events[i];
-                double total_s = 0;
-                uint64_t h2d = 0, d2h = 0;
-
-                std::cerr << "[trace]   " << app.name << " ev=" << i << "/" << app.n
-                          << " kind=" << kind_str(ev.kind)
-                          << " h2d=" << ev.h2d_size << " d2h=" << ev.d2h_size
-                          << " cycles=" << ev.cycles << " ... " << std::flush;
-
-                switch (ev.kind) {
-                case TRACE_BULK_H2D:
-                    h2d = clamp_dma(ev.h2d_size, dma_capacity);
-                    total_s = do_bulk(dma_addr, static_cast<uint32_t>(h2d), false);
-                    break;
-                case TRACE_BULK_D2H:
-                    d2h = clamp_dma(ev.d2h_size, dma_capacity);
-                    total_s = do_bulk(dma_addr, static_cast<uint32_t>(d2h), true);
-                    break;
-                case TRACE_BUNDLE:
-                    h2d = clamp_dma(ev.h2d_size, dma_capacity);
-                    d2h = clamp_dma(ev.d2h_size, dma_capacity);
-                    total_s = do_bundle(dma_addr, static_cast<uint32_t>(h2d),
-                                        static_cast<uint32_t>(d2h), ev.cycles);
-                    break;
-                default:
-                    std::cerr << "[warn] unknown kind " << (int)ev.kind << std::endl;
-                    continue;
-                }
-
-                std::cerr << "done " << (total_s * 1e6) << " us" << std::endl;
-            }
-            std::cerr << "[trace] " << app.name << " run " << run << " done"
+            results.push_back(replay.replay(trace));
+            std::cerr << "[trace] " << trace.getName() << " run " << run << " done"
                       << std::endl;
         }
     }
+    coyote::cTraceReplay::writeCsv(std::cout, results);
 
     std::cout << "Selftest completed: full trace replayed locally without a wedge."
               << std::endl;
@@ -9,8 +9,11 @@
  * replayer, which replays them verbatim on the accelerator.
  *
  * Identical wire protocol and primitives to sw_host_no_vm (see
- * messages.hpp): one 64 B slot per direction, monotonic publish counter,
- * strict ping-pong, clearCompleted per round trip, no retries. The
+ * messages.hpp): a ring of SLOT_BYTES slots per direction, monotonic publish
+ * counter, strict ping-pong unless --window allows more requests in
+ * flight (writes are then posted, coalesced and pushed at the latest
+ * before the daemon waits for the guest), clearCompleted per round trip,
+ * no retries. The
  * application buffer served here is the ivshmem region itself: guest DMA
  * pointers are proxy-shmem vaddrs (published at OFFSET_PROXY_SHMEM by
  * init_shared_memory), so they translate to payload offsets with the same
@@ -24,14 +27,23 @@
  * reports "done" and bounced into ivshmem at that poll, before the guest
  * sees the doorbell.
  *
- * Meant to busy-poll on one dedicated core (run under taskset).
+ * With --zero_copy the ivshmem region itself (hugepage-backed) is mapped
+ * into the NIC vFPGA and registered as MR 1, and the device registers its
+ * staging buffer the same way: payloads then move ivshmem -> device buffer
+ * and back in a single RDMA write each, with no staging copy on either
+ * node (see PAYLOAD_MR in messages.hpp).
+ *
+ * Meant to busy-poll on one dedicated core (run under taskset); see
+ * jigsaw_ivshmem/doorbell.hpp for the sleeping and interrupt-driven
+ * doorbell modes (--doorbell).
  *
  * Usage:
- *   taskset -c <core> ./test -i <device_oob_ip>
+ *   taskset -c <core> ./test -i <device_oob_ip> [-w <window>] [--zero_copy]
  */
 
 #include <atomic>
 #include <csignal>
+#include <algorithm>
 #include <cstdlib>
 #include <cstring>
 #include <iostream>
@@ -43,6 +55,8 @@
 #include <coyote/cThread.hpp>
 
 #include "shmem.hpp"
+#include "doorbell.hpp"
+#include "mmio_ring.hpp"
 #include "messages.hpp"
 
 using namespace jsfwd;
@@ -59,8 +73,6 @@ static_assert(DMA_REGION_OFFSET == jsfwd::PAYLOAD_OFF,
 static coyote::cThread *ct;
 static char *nic_buf;
 static char *app_buf;                    // the ivshmem region
-static struct msg *req_slot;             // this node is its only writer
-static volatile struct msg *resp_slot;   // written by the device
 
 // Shadow copies of the last-written DMA parameter registers, needed to
 // stage payloads at trigger time (same role as on the device side).
@@ -71,7 +83,13 @@ static uint64_t sh_src, sh_dst, sh_h2d, sh_d2h;
 // that read's response on the same QP, so the data is already local).
 static struct { bool armed; uint64_t off, len, mask; } d2h_pending;
 
-static uint64_t req_seq = 0;
+// Request window: requests up to `acked` are answered, (acked, flushed]
+// are on the wire and (flushed, posted] are staged in their slots only
+static uint32_t window = 1;
+static uint64_t posted = 0, flushed = 0, acked = 0;
+
+// Zero-copy mode: payloads are pushed from and land directly in ivshmem
+static bool zero_copy = false;
 
 static const uint64_t RESP_TIMEOUT_MS = 5000;
 
@@ -79,33 +97,78 @@ static std::atomic<bool> g_stop{false};
 static void on_sigint(int) { g_stop.store(true); }
 
 // ---------------------------------------------------------------------------
-// Mailbox primitives: one slot per direction, monotonic publish counter
-// (see messages.hpp for why not a clear-and-wait ready flag)
+// Mailbox primitives: a ring of slots per direction, monotonic publish
+// counter, posted writes and cumulative acks (see messages.hpp)
 // ---------------------------------------------------------------------------
-static uint64_t request(uint64_t op, uint64_t addr, uint64_t value)
+static struct msg *req_slot(uint64_t seq)
 {
-    uint64_t seq = ++req_seq;
-    req_slot->op = op;
-    req_slot->addr = addr;
-    req_slot->value = value;
-    req_slot->seq = seq;  // publish flag, written last
-    coyote::rdmaSg sg = {.local_offs = REQ_OFF, .remote_offs = REQ_OFF,
-                         .len = SLOT_BYTES};
-    ct->invoke(coyote::CoyoteOper::REMOTE_RDMA_WRITE, sg);
+    return reinterpret_cast<struct msg *>(nic_buf + req_off(seq));
+}
+
+static volatile struct msg *resp_slot(uint64_t seq)
+{
+    return reinterpret_cast<volatile struct msg *>(nic_buf + resp_off(seq));
+}
+
+// Pushes the staged requests with one write (two if the run wraps around)
+static void flush()
+{
+    while (flushed < posted) {
+        uint64_t first = flushed + 1;
+        uint64_t n = std::min<uint64_t>(posted - flushed,
+                                        WINDOW_SLOTS - first % WINDOW_SLOTS);
+        coyote::rdmaSg sg = {.local_offs = req_off(first), .remote_offs = req_off(first),
+                             .len = static_cast<uint32_t>(n * SLOT_BYTES)};
+        ct->invoke(coyote::CoyoteOper::REMOTE_RDMA_WRITE, sg);
+        flushed += n;
+    }
+}
+
+// Waits until request seq is answered. Responses are placed in order, so
+// the newest one on the wire acknowledges everything before it.
+static void wait_acked(uint64_t seq)
+{
+    if (acked >= seq) return;
+    flush();
 
     uint64_t deadline = now_ms() + RESP_TIMEOUT_MS;
-    while (resp_slot->seq < seq) {
-        if (now_ms() > deadline) {
+    while (acked < seq) {
+        if (resp_slot(flushed)->seq >= flushed) {
+            acked = flushed;
+        } else if (resp_slot(seq)->seq >= seq) {
+            acked = seq;
+        } else if (now_ms() > deadline) {
             std::cerr << "[mbox] FATAL: no response for seq=" << seq
-                      << " op=" << op << " addr=0x" << std::hex << addr
-                      << std::dec << std::endl;
+                      << " op=" << req_slot(seq)->op << " addr=0x" << std::hex
+                      << req_slot(seq)->addr << std::dec << std::endl;
             abort();
         }
     }
-    uint64_t result = resp_slot->value;
     // Cheap local flush every round trip, the baseline pair's cadence
     ct->clearCompleted();
-    return result;
+}
+
+// Stages a request in its slot; only waits if the window is full
+static uint64_t post(uint64_t op, uint64_t addr, uint64_t value)
+{
+    uint64_t seq = posted + 1;
+    if (seq - acked > window)
+        wait_acked(seq - window);
+
+    struct msg *slot = req_slot(seq);
+    slot->op = op;
+    slot->addr = addr;
+    slot->value = value;
+    slot->seq = seq;  // publish flag, written last
+    posted = seq;
+    return seq;
+}
+
+static uint64_t request(uint64_t op, uint64_t addr, uint64_t value)
+{
+    uint64_t seq = post(op, addr, value);
+    wait_acked(seq);
+    return resp_slot(seq)->value;
 }
 
 static bool payload_range_ok(uint64_t off, uint64_t len)
@@ -114,17 +177,25 @@ static bool payload_range_ok(uint64_t off, uint64_t len)
 }
 
 // H2D: bounce guest memory (ivshmem) into the NIC buffer and push it before
-// the trigger request is sent (same QP => payload placed first).
+// the trigger request is sent (same QP => payload placed first). In
+// zero-copy mode the push reads ivshmem directly and lands in the device
+// staging buffer; the guest does not touch the buffer before the trigger's
+// response, so retransmissions still re-read stable bytes.
 static void stage_in(uint64_t src_ptr, uint64_t len)
 {
     uint64_t off = src_ptr - reinterpret_cast<uint64_t>(app_buf);
     if (!payload_range_ok(off, len)) return;
-    memcpy(nic_buf + off, app_buf + off, len);
+    if (!zero_copy)
+        memcpy(nic_buf + off, app_buf + off, len);
     uint64_t aligned = (len + 63) & ~uint64_t(63);
     if (off + aligned > BUF_BYTES)
         aligned = BUF_BYTES - off;
     coyote::rdmaSg sg = {.local_offs = off, .remote_offs = off,
                          .len = static_cast<uint32_t>(aligned)};
+    if (zero_copy) {
+        sg.local_mr = PAYLOAD_MR;
+        sg.remote_mr = PAYLOAD_MR;
+    }
     ct->invoke(coyote::CoyoteOper::REMOTE_RDMA_WRITE, sg);
 }
 
@@ -158,7 +229,7 @@ static void mmio_write(uint64_t addr, uint64_t value)
     default:
         break;
     }
-    (void)request(OP_MMIO_WRITE, addr, value);
+    (void)post(OP_MMIO_WRITE, addr, value);
 }
 
 static uint64_t mmio_read(uint64_t addr)
@@ -167,10 +238,11 @@ static uint64_t mmio_read(uint64_t addr)
     // The device pushes an armed D2H payload before the STATUS response
     // that first reports "done" (same QP, placed first), so the data is in
     // the NIC buffer by the time "done" is visible — bounce it into
-    // ivshmem before the guest can observe the completed poll.
+    // ivshmem before the guest can observe the completed poll. In
+    // zero-copy mode it was written straight into ivshmem.
     if (static_cast<DevReg>(addr) == DevReg::DMA_STATUS && d2h_pending.armed &&
         (value & d2h_pending.mask) == d2h_pending.mask) {
-        if (payload_range_ok(d2h_pending.off, d2h_pending.len))
+        if (!zero_copy && payload_range_ok(d2h_pending.off, d2h_pending.len))
             memcpy(app_buf + d2h_pending.off, nic_buf + d2h_pending.off,
                    d2h_pending.len);
         d2h_pending.armed = false;
@@ -182,6 +254,30 @@ static uint64_t mmio_read(uint64_t addr)
 // Forwarding loop — same doorbell structure as run_shmem_app() in
 // jigsaw_host_controller/sw, with the backend swapped for the wire protocol.
 // ---------------------------------------------------------------------------
+// Serves every request posted to the MMIO ring, in order
+static void drain_mmio_ring()
+{
+    struct mmio_ring_slot req;
+
+    while (mmio_ring_pop(&req))
+    {
+        switch (req.operation)
+        {
+        case OP_READ:
+            shmem_complete_read(mmio_read(req.address));
+            break;
+
+        case OP_WRITE:
+            mmio_write(req.address, req.value);
+            break;
+
+        default:
+            fprintf(stderr, "Unknown operation: %d\n", req.operation);
+            break;
+        }
+    }
+}
+
 static void run_forwarder()
 {
     std::cout << "SHMEM application started. Waiting for messages..." << std::endl;
@@ -190,7 +286,20 @@ static void run_forwarder()
     {
         shmem_arm_write_doorbell();
 
+        // With the MMIO ring the doorbell only wakes us up: it is cleared
+        // before draining, so requests posted meanwhile set it again
+        if (mmio_ring_enabled())
+        {
+            drain_mmio_ring();
+        }
+
+        // Posted writes must not sit in their slots while we wait
+        flush();
         shmem_wait_write_doorbell();
+        if (mmio_ring_enabled())
+        {
+            continue;
+        }
 
         mmio_message_header header;
         shmem_read_header(&header);
@@ -217,12 +326,20 @@ static void run_forwarder()
 // ---------------------------------------------------------------------------
 int main(int argc, char *argv[]) {
     std::string device_ip;
+    doorbell_config doorbell;
 
     boost::program_options::options_description opts("Jigsaw SW Forwarder Options");
     opts.add_options()
         ("ip_address,i",
             boost::program_options::value<std::string>(&device_ip),
-            "Device-side OOB TCP/IP address (for QP exchange)");
+            "Device-side OOB TCP/IP address (for QP exchange)")
+        ("window,w",
+            boost::program_options::value<uint32_t>(&window),
+            "Mailbox requests in flight (1..32; default 1 = strict ping-pong)")
+        ("zero_copy",
+            boost::program_options::bool_switch(&zero_copy),
+            "Push payloads between ivshmem and the device staging buffer without staging copies");
+    doorbell_add_options(opts, doorbell);
 
     boost::program_options::variables_map vm;
     boost::program_options::store(
@@ -233,6 +350,10 @@ int main(int argc, char *argv[]) {
         std::cout << "ERROR: --ip_address (-i) is required\n" << opts << std::endl;
         return EXIT_FAILURE;
     }
+    if (window < 1 || window > WINDOW_SLOTS) {
+        std::cout << "ERROR: --window (-w) must be between 1 and " << WINDOW_SLOTS << std::endl;
+        return EXIT_FAILURE;
+    }
 
     std::cout << "Starting Jigsaw SW Forwarder — Host (VM daemon)..." << std::endl;
     std::cout << "Device OOB IP : " << device_ip << std::endl;
@@ -240,6 +361,23 @@ int main(int argc, char *argv[]) {
     coyote::cThread coyote_thread(DEFAULT_VFPGA_ID, getpid());
     ct = &coyote_thread;
 
+    // Init shared memory with the guest; publishes the proxy DMA base the
+    // guest hands out as DMA pointers (ivshmem base + DMA_REGION_OFFSET).
+    if (doorbell_init(doorbell) != 0) {
+        return EXIT_FAILURE;
+    }
+    app_buf = static_cast<char *>(init_shared_memory());
+    if (!app_buf) {
+        std::cerr << "init_shared_memory failed" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // Zero-copy: the region must be registered before the QP exchange
+    if (zero_copy) {
+        coyote_thread.userMap(app_buf, SHMEM_SIZE);
+        coyote_thread.registerMr(app_buf, SHMEM_SIZE);
+    }
+
     nic_buf = static_cast<char *>(
         coyote_thread.initRDMA(BUF_BYTES, coyote::DEF_PORT, device_ip.c_str()));
     if (!nic_buf) {
@@ -247,14 +385,9 @@ int main(int argc, char *argv[]) {
         return EXIT_FAILURE;
     }
     memset(nic_buf, 0, CONTROL_SIZE);
-    req_slot = reinterpret_cast<struct msg *>(nic_buf + REQ_OFF);
-    resp_slot = reinterpret_cast<volatile struct msg *>(nic_buf + RESP_OFF);
 
-    // Init shared memory with the guest; publishes the proxy DMA base the
-    // guest hands out as DMA pointers (ivshmem base + DMA_REGION_OFFSET).
-    app_buf = static_cast<char *>(init_shared_memory());
-    if (!app_buf) {
-        std::cerr << "init_shared_memory failed" << std::endl;
+    if (zero_copy && coyote_thread.getNumRemoteMrs() < PAYLOAD_MR) {
+        std::cerr << "device did not register its staging buffer, zero-copy unavailable" << std::endl;
         return EXIT_FAILURE;
     }
 
@@ -9,6 +9,11 @@
 #include <cstdint>
 
 #include "shmem.hpp"
+#include "doorbell.hpp"
+#include "mmio_ring.hpp"
+
+static_assert(MMIO_RING_OFFSET + sizeof(struct mmio_ring) <= DMA_REGION_OFFSET,
+              "MMIO ring must fit below the DMA region");
 
 static void *shmem = NULL;
 static volatile uint8_t *read_doorbell = NULL;
@@ -16,7 +21,8 @@ static volatile uint8_t *write_doorbell = NULL;
 
 static int create_or_open_shmem_file()
 {
-    int fd = open(SHMEM_FILE, O_RDWR | O_CREAT, 0666);
+    // With irq doorbells the region is the one handed out by ivshmem-server
+    int fd = doorbell_shm_fd() >= 0 ? dup(doorbell_shm_fd()) : open(SHMEM_FILE, O_RDWR | O_CREAT, 0666);
     if (fd < 0)
     {
         perror("Failed to open or create shared memory file");
@@ -76,6 +82,10 @@ void *init_shared_memory()
     // write proxyShmem address into shmem
     *reinterpret_cast<uint64_t *>((reinterpret_cast<char *>(shmem) + OFFSET_PROXY_SHMEM)) = reinterpret_cast<uint64_t>(shmem) + DMA_REGION_OFFSET;
 
+    // tell the guest driver whether and where to ring the ivshmem doorbell
+    doorbell_publish(reinterpret_cast<volatile uint32_t *>(reinterpret_cast<char *>(shmem) + OFFSET_DOORBELL_PEER));
+    mmio_ring_init(reinterpret_cast<char *>(shmem) + MMIO_RING_OFFSET);
+
     msync(shmem, TOTAL_DOORBELL_SIZE, MS_SYNC);
 
     return shmem;
@@ -88,9 +98,7 @@ void shmem_arm_write_doorbell()
 
 void shmem_wait_write_doorbell()
 {
-    while (__atomic_load_n(write_doorbell, __ATOMIC_ACQUIRE) == 0)
-    {
-    }
+    doorbell_wait(write_doorbell, true, true);
 }
 
 void shmem_read_header(struct mmio_message_header *header)
@@ -103,4 +111,5 @@ void shmem_complete_read(uint64_t value)
 {
     *(uint64_t *)((char *)shmem + 16) = value;
     __atomic_store_n(read_doorbell, 1, __ATOMIC_RELEASE);
+    doorbell_notify_guest();
 }
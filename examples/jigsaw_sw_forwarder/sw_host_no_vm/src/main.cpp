@@ -1,10 +1,11 @@
 /**
  * Jigsaw Software Forwarder — host-side trace harness (no VM)
  *
- * One cThread on the perf_rdma vFPGA (dumb NIC), one 64 B mailbox slot per
- * direction (requests at offset 0, responses at offset 64 — each slot has
- * exactly one writer, see messages.hpp), payloads pushed into the region
- * behind the control page, strict ping-pong.
+ * One cThread on the perf_rdma vFPGA (dumb NIC), a ring of SLOT_BYTES mailbox
+ * slots per direction (each slot has exactly one writer, see
+ * messages.hpp), payloads pushed into the region behind the control page.
+ * Strict ping-pong by default; with --window N up to N requests are in
+ * flight, writes are posted and coalesced, and only reads wait.
  *
  * Drives the same device interactions as jigsaw_host_controller/sw_no_vm
  * (Vortex OpenCL trace replay), but every MMIO access is encapsulated into
@@ -17,13 +18,19 @@
  *
  * DMA payloads bounce through two staging copies (application buffer ->
  * NIC buffer here, NIC buffer -> device buffer on the device node), the
- * cost a software forwarder on commodity hardware cannot avoid.
+ * cost a software forwarder on commodity hardware cannot avoid. With
+ * --zero_copy the application buffer and the device staging buffer are
+ * registered as MR 1 and payloads are pushed between them directly (see
+ * PAYLOAD_MR in messages.hpp); with --chunk_bytes 0 a bulk transfer is a
+ * single MMIO sequence and a single payload push instead of one of each
+ * per MiB.
  *
  * Usage:
- *   ./test -i <device_oob_ip> [-r <trace runs>]
+ *   ./test -i <device_oob_ip> [-r <trace runs>] [-w <window>] [--zero_copy] [--chunk_bytes <bytes>]
  */
 
 #include <chrono>
+#include <algorithm>
 #include <cstdlib>
 #include <cstring>
 #include <iomanip>
@@ -34,6 +41,7 @@
 
 #include <boost/program_options.hpp>
 
+#include <coyote/cTrace.hpp>
 #include <coyote/cThread.hpp>
 
 #include "messages.hpp"
@@ -47,8 +55,6 @@ using namespace jsfwd;
 static coyote::cThread *ct;
 static char *nic_buf;
 static char *app_buf;
-static struct msg *req_slot;             // this node is its only writer
-static volatile struct msg *resp_slot;   // written by the device
 
 // Shadow copies of the last-written DMA parameter registers, needed to
 // stage payloads at trigger time (same role as on the device side).
@@ -59,38 +65,89 @@ static uint64_t sh_src, sh_dst, sh_h2d, sh_d2h;
 // that read's response on the same QP, so the data is already local).
 static struct { bool armed; uint64_t off, len, mask; } d2h_pending;
 
-static uint64_t req_seq = 0;
+// Request window: requests up to `acked` are answered, (acked, flushed]
+// are on the wire and (flushed, posted] are staged in their slots only
+static uint32_t window = 1;
+static uint64_t posted = 0, flushed = 0, acked = 0;
+
+// Zero-copy mode: payloads are pushed from and land directly in app_buf
+static bool zero_copy = false;
 
 static const uint64_t RESP_TIMEOUT_MS = 5000;
 
 // ---------------------------------------------------------------------------
-// Mailbox primitives: one slot per direction, monotonic publish counter
-// (see messages.hpp for why not a clear-and-wait ready flag)
+// Mailbox primitives: a ring of slots per direction, monotonic publish
+// counter, posted writes and cumulative acks (see messages.hpp)
 // ---------------------------------------------------------------------------
-static uint64_t request(uint64_t op, uint64_t addr, uint64_t value)
+static struct msg *req_slot(uint64_t seq)
 {
-    uint64_t seq = ++req_seq;
-    req_slot->op = op;
-    req_slot->addr = addr;
-    req_slot->value = value;
-    req_slot->seq = seq;  // publish flag, written last
-    coyote::rdmaSg sg = {.local_offs = REQ_OFF, .remote_offs = REQ_OFF,
-                         .len = SLOT_BYTES};
-    ct->invoke(coyote::CoyoteOper::REMOTE_RDMA_WRITE, sg);
+    return reinterpret_cast<struct msg *>(nic_buf + req_off(seq));
+}
+
+static volatile struct msg *resp_slot(uint64_t seq)
+{
+    return reinterpret_cast<volatile struct msg *>(nic_buf + resp_off(seq));
+}
+
+// Pushes the staged requests with one write (two if the run wraps around)
+static void flush()
+{
+    while (flushed < posted) {
+        uint64_t first = flushed + 1;
+        uint64_t n = std::min<uint64_t>(posted - flushed,
+                                        WINDOW_SLOTS - first % WINDOW_SLOTS);
+        coyote::rdmaSg sg = {.local_offs = req_off(first), .remote_offs = req_off(first),
+                             .len = static_cast<uint32_t>(n * SLOT_BYTES)};
+        ct->invoke(coyote::CoyoteOper::REMOTE_RDMA_WRITE, sg);
+        flushed += n;
+    }
+}
+
+// Waits until request seq is answered. Responses are placed in order, so
+// the newest one on the wire acknowledges everything before it.
+static void wait_acked(uint64_t seq)
+{
+    if (acked >= seq) return;
+    flush();
 
     uint64_t deadline = now_ms() + RESP_TIMEOUT_MS;
-    while (resp_slot->seq < seq) {
-        if (now_ms() > deadline) {
+    while (acked < seq) {
+        if (resp_slot(flushed)->seq >= flushed) {
+            acked = flushed;
+        } else if (resp_slot(seq)->seq >= seq) {
+            acked = seq;
+        } else if (now_ms() > deadline) {
             std::cerr << "[mbox] FATAL: no response for seq=" << seq
-                      << " op=" << op << " addr=0x" << std::hex << addr
-                      << std::dec << std::endl;
+                      << " op=" << req_slot(seq)->op << " addr=0x" << std::hex
+                      << req_slot(seq)->addr << std::dec << std::endl;
             abort();
         }
     }
-    uint64_t result = resp_slot->value;
     // Cheap local flush every round trip, the baseline pair's cadence
     ct->clearCompleted();
-    return result;
+}
+
+// Stages a request in its slot; only waits if the window is full
+static uint64_t post(uint64_t op, uint64_t addr, uint64_t value)
+{
+    uint64_t seq = posted + 1;
+    if (seq - acked > window)
+        wait_acked(seq - window);
+
+    struct msg *slot = req_slot(seq);
+    slot->op = op;
+    slot->addr = addr;
+    slot->value = value;
+    slot->seq = seq;  // publish flag, written last
+    posted = seq;
+    return seq;
+}
+
+static uint64_t request(uint64_t op, uint64_t addr, uint64_t value)
+{
+    uint64_t seq = post(op, addr, value);
+    wait_acked(seq);
+    return resp_slot(seq)->value;
 }
 
 static bool payload_range_ok(uint64_t off, uint64_t len)
@@ -104,12 +161,17 @@ static void stage_in(uint64_t src_ptr, uint64_t len)
 {
     uint64_t off = src_ptr - reinterpret_cast<uint64_t>(app_buf);
     if (!payload_range_ok(off, len)) return;
-    memcpy(nic_buf + off, app_buf + off, len);
+    if (!zero_copy)
+        memcpy(nic_buf + off, app_buf + off, len);
     uint64_t aligned = (len + 63) & ~uint64_t(63);
     if (off + aligned > BUF_BYTES)
         aligned = BUF_BYTES - off;
     coyote::rdmaSg sg = {.local_offs = off, .remote_offs = off,
                          .len = static_cast<uint32_t>(aligned)};
+    if (zero_copy) {
+        sg.local_mr = PAYLOAD_MR;
+        sg.remote_mr = PAYLOAD_MR;
+    }
     ct->invoke(coyote::CoyoteOper::REMOTE_RDMA_WRITE, sg);
 }
 
@@ -144,7 +206,7 @@ static void mmio_write(uint64_t addr, uint64_t value)
     default:
         break;
     }
-    (void)request(OP_MMIO_WRITE, addr, value);
+    (void)post(OP_MMIO_WRITE, addr, value);
 }
 
 static uint64_t mmio_read(uint64_t addr)
@@ -152,10 +214,11 @@ static uint64_t mmio_read(uint64_t addr)
     uint64_t value = request(OP_MMIO_READ, addr, 0);
     // The device pushes an armed D2H payload before the STATUS response
     // that first reports "done" (same QP, placed first), so the data is in
-    // the NIC buffer by the time "done" is visible — bounce it out.
+    // the NIC buffer by the time "done" is visible — bounce it out (in
+    // zero-copy mode it was written straight into app_buf).
     if (static_cast<DevReg>(addr) == DevReg::DMA_STATUS && d2h_pending.armed &&
         (value & d2h_pending.mask) == d2h_pending.mask) {
-        if (payload_range_ok(d2h_pending.off, d2h_pending.len))
+        if (!zero_copy && payload_range_ok(d2h_pending.off, d2h_pending.len))
             memcpy(app_buf + d2h_pending.off, nic_buf + d2h_pending.off,
                    d2h_pending.len);
         d2h_pending.armed = false;
@@ -164,13 +227,13 @@ static uint64_t mmio_read(uint64_t addr)
 }
 
 // ---------------------------------------------------------------------------
-// Trace Replay (bundled, embedded via traces.hpp)
+// Trace Replay (traces loaded from --traces)
+//
+// Events are replayed one by one here rather than through cTraceReplay's
+// executor, so that the per-event timing and the TRACE_EVENT/TRACE_SUMMARY
+// lines stay identical to the guest driver's; the sizes are clamped by
+// cTraceReplay::clampSize().
 // ---------------------------------------------------------------------------
-#include "traces.hpp"
-using namespace jigsaw_traces_ns;
-
-static constexpr uint32_t MIN_DMA_BYTES = 64;
-
 struct TraceResult {
     std::string app;
     int run_idx;
@@ -181,19 +244,6 @@ struct TraceResult {
     int original_count;
 };
 
-static uint64_t clamp_dma(uint64_t raw, uint64_t mem_cap)
-{
-    uint64_t sz = (raw > mem_cap) ? mem_cap : raw;
-    // Keep raw==0 as 0 so the computation engine skips that phase entirely.
-    if (sz != 0) {
-        sz = (sz + MIN_DMA_BYTES - 1) & ~static_cast<uint64_t>(MIN_DMA_BYTES - 1);
-        if (sz > mem_cap) {
-            sz = mem_cap & ~static_cast<uint64_t>(MIN_DMA_BYTES - 1);
-        }
-    }
-    return sz;
-}
-
 using clk = std::chrono::high_resolution_clock;
 static double secs(clk::time_point a, clk::time_point b)
 {
@@ -226,16 +276,18 @@ static void poll_status(uint64_t mask, const char *what)
     }
 }
 
-// Bulk transfers are sliced into 1 MiB chunks with a full MMIO sequence per
-// chunk — mirroring the guest driver (my_qemu_edu.c TRACE_CHUNK_BYTES).
+// Bulk transfers are sliced into chunk_bytes chunks with a full MMIO
+// sequence per chunk — by default 1 MiB, mirroring the guest driver
+// (my_qemu_edu.c TRACE_CHUNK_BYTES); 0 issues the whole transfer as one
+// sequence, so its payload goes out as a single push.
 // Timed exactly as the driver's replay_one: one window around the whole
 // chunked loop, including the per-chunk trailing STATUS clear.
-static double do_bulk(uint64_t dma_addr, uint32_t size, bool d2h)
+static double do_bulk(uint64_t dma_addr, uint32_t size, bool d2h, uint64_t chunk_bytes)
 {
     auto start = clk::now();
     uint64_t remaining = size, off = 0;
     while (remaining > 0) {
-        uint64_t chunk = remaining > TRACE_CHUNK_BYTES ? TRACE_CHUNK_BYTES : remaining;
+        uint64_t chunk = (chunk_bytes && remaining > chunk_bytes) ? chunk_bytes : remaining;
         mmio_write(static_cast<uint64_t>(DevReg::DMA_SRC_ADDR), dma_addr + off);
         mmio_write(static_cast<uint64_t>(DevReg::DMA_DST_ADDR), dma_addr + off);
         mmio_write(static_cast<uint64_t>(d2h ? DevReg::DMA_D2H_LEN : DevReg::DMA_H2D_LEN),
@@ -280,8 +332,9 @@ static double do_bundle(uint64_t dma_addr, uint32_t h2d, uint32_t d2h,
     return secs(start, end);
 }
 
-// The embedded traces.hpp is byte-identical to the guest driver's
-// long-traces.h, so the driver's `set` column value applies directly and
+// The full-size traces (converted from jigsaw_host_controller's former
+// traces.hpp) are identical to the guest driver's long-traces.h, so the
+// driver's `set` column value applies directly and
 // TRACE_EVENT / TRACE_SUMMARY lines are comparable with driver dmesg logs.
 static constexpr const char *TRACE_SET_LABEL = "long";
 
@@ -291,25 +344,27 @@ static constexpr const char *TRACE_SET_LABEL = "long";
 // Mirrors the guest driver's cycles_scale module parameter; scaled cycles
 // are programmed AND reported, so logs stay self-consistent. Sweep points:
 // 1 (as captured) and 6.
-static void run_traces(uint64_t dma_addr, uint64_t dma_capacity,
-                       int n_runs, uint64_t cycles_scale,
+static void run_traces(const std::vector<coyote::cTrace> &traces,
+                       const coyote::cTraceReplay &replay, uint64_t dma_addr,
+                       int n_runs, uint64_t cycles_scale, uint64_t chunk_bytes,
                        std::vector<TraceResult> &results)
 {
     if (cycles_scale == 0) cycles_scale = 1;
-    std::cout << "TRACE_CSV: cycles_scale=" << cycles_scale << std::endl;
-    auto kind_str = [](uint8_t k) -> const char * {
+    std::cout << "TRACE_CSV: cycles_scale=" << cycles_scale
+              << " chunk_bytes=" << chunk_bytes
+              << " zero_copy=" << zero_copy << " window=" << window << std::endl;
+    auto kind_str = [](coyote::CoyoteTraceKind k) -> const char * {
         switch (k) {
-            case TRACE_BULK_H2D: return "BULK_H2D";
-            case TRACE_BULK_D2H: return "BULK_D2H";
-            case TRACE_BUNDLE:   return "BUNDLE  ";
-            default:             return "UNKNOWN ";
+            case coyote::CoyoteTraceKind::BULK_H2D: return "BULK_H2D";
+            case coyote::CoyoteTraceKind::BULK_D2H: return "BULK_D2H";
+            case coyote::CoyoteTraceKind::BUNDLE:   return "BUNDLE  ";
+            default:                                return "UNKNOWN ";
         }
     };
 
-    constexpr size_t n_apps = sizeof(jigsaw_traces) / sizeof(jigsaw_traces[0]);
-    for (size_t a = 0; a < n_apps; a++) {
-        const auto &app = jigsaw_traces[a];
-        std::cerr << "[trace] " << app.name << " (" << app.n << " events, "
+    for (const auto &trace : traces) {
+        const std::string &app = trace.getName();
+        std::cerr << "[trace] " << app << " (" << trace.size() << " events, "
                   << n_runs << " runs)" << std::endl;
 
         for (int run = 0; run < n_runs; run++) {
@@ -318,48 +373,45 @@ static void run_traces(uint64_t dma_addr, uint64_t dma_capacity,
             uint64_t agg_h2d_ns = 0, agg_d2h_ns = 0, agg_bundle_ns = 0;
             uint64_t agg_h2d_bytes = 0, agg_d2h_bytes = 0, agg_cycles = 0;
 
-            for (size_t i = 0; i < app.n; i++) {
-                const auto &ev = app.events[i];
+            for (size_t i = 0; i < trace.size(); i++) {
+                const auto &ev = trace[i];
                 double total_s = 0;
                 uint64_t h2d = 0, d2h = 0;
                 const uint64_t cycles = ev.cycles / cycles_scale;
 
-                std::cerr << "[trace]   " << app.name << " ev=" << i << "/" << app.n
+                std::cerr << "[trace]   " << app << " ev=" << i << "/" << trace.size()
                           << " kind=" << kind_str(ev.kind)
                           << " h2d=" << ev.h2d_size << " d2h=" << ev.d2h_size
                           << " cycles=" << cycles << " ... " << std::flush;
 
                 switch (ev.kind) {
-                case TRACE_BULK_H2D:
-                    h2d = clamp_dma(ev.h2d_size, dma_capacity);
+                case coyote::CoyoteTraceKind::BULK_H2D:
+                    h2d = replay.clampSize(ev.h2d_size);
                     break;
-                case TRACE_BULK_D2H:
-                    d2h = clamp_dma(ev.d2h_size, dma_capacity);
+                case coyote::CoyoteTraceKind::BULK_D2H:
+                    d2h = replay.clampSize(ev.d2h_size);
                     break;
-                case TRACE_BUNDLE:
-                    h2d = clamp_dma(ev.h2d_size, dma_capacity);
-                    d2h = clamp_dma(ev.d2h_size, dma_capacity);
+                case coyote::CoyoteTraceKind::BUNDLE:
+                    h2d = replay.clampSize(ev.h2d_size);
+                    d2h = replay.clampSize(ev.d2h_size);
                     break;
-                default:
-                    std::cerr << "[warn] unknown kind " << (int)ev.kind << std::endl;
-                    continue;
                 }
 
                 // Same schema as the driver:
                 // TRACE_EVENT: set,app,run,event,kind,h2d_bytes,d2h_bytes,cycles
                 std::cout << "TRACE_EVENT: " << TRACE_SET_LABEL << ","
-                          << app.name << "," << run << "," << i << ","
+                          << app << "," << run << "," << i << ","
                           << static_cast<unsigned>(ev.kind) << "," << h2d << ","
                           << d2h << "," << cycles << std::endl;
 
                 switch (ev.kind) {
-                case TRACE_BULK_H2D:
-                    total_s = do_bulk(dma_addr, static_cast<uint32_t>(h2d), false);
+                case coyote::CoyoteTraceKind::BULK_H2D:
+                    total_s = do_bulk(dma_addr, static_cast<uint32_t>(h2d), false, chunk_bytes);
                     break;
-                case TRACE_BULK_D2H:
-                    total_s = do_bulk(dma_addr, static_cast<uint32_t>(d2h), true);
+                case coyote::CoyoteTraceKind::BULK_D2H:
+                    total_s = do_bulk(dma_addr, static_cast<uint32_t>(d2h), true, chunk_bytes);
                     break;
-                case TRACE_BUNDLE:
+                case coyote::CoyoteTraceKind::BUNDLE:
                     total_s = do_bundle(dma_addr, static_cast<uint32_t>(h2d),
                                         static_cast<uint32_t>(d2h), cycles);
                     break;
@@ -369,17 +421,17 @@ static void run_traces(uint64_t dma_addr, uint64_t dma_capacity,
 
                 uint64_t total_ns = static_cast<uint64_t>(total_s * 1e9);
                 switch (ev.kind) {
-                case TRACE_BULK_H2D:
+                case coyote::CoyoteTraceKind::BULK_H2D:
                     agg_n_bulk_h2d++;
                     agg_h2d_ns    += total_ns;
                     agg_h2d_bytes += ev.h2d_size;  // raw size, as the driver
                     break;
-                case TRACE_BULK_D2H:
+                case coyote::CoyoteTraceKind::BULK_D2H:
                     agg_n_bulk_d2h++;
                     agg_d2h_ns    += total_ns;
                     agg_d2h_bytes += ev.d2h_size;
                     break;
-                case TRACE_BUNDLE:
+                case coyote::CoyoteTraceKind::BUNDLE:
                     agg_n_bundle++;
                     agg_bundle_ns += total_ns;
                     agg_h2d_bytes += ev.h2d_size;
@@ -388,9 +440,9 @@ static void run_traces(uint64_t dma_addr, uint64_t dma_capacity,
                     break;
                 }
 
-                results.push_back({app.name, run, static_cast<int>(i), ev.kind,
+                results.push_back({app, run, static_cast<int>(i), static_cast<uint8_t>(ev.kind),
                                    ev.h2d_size, ev.d2h_size, cycles,
-                                   total_s * 1e6, ev.original_count});
+                                   total_s * 1e6, static_cast<int>(ev.original_count)});
             }
 
             // Same schema as the driver:
@@ -399,14 +451,14 @@ static void run_traces(uint64_t dma_addr, uint64_t dma_capacity,
             //                total_bundle_ns,total_ns,total_h2d_bytes,
             //                total_d2h_bytes,total_cycles
             std::cout << "TRACE_SUMMARY: " << TRACE_SET_LABEL << ","
-                      << app.name << "," << run << "," << app.n << ","
+                      << app << "," << run << "," << trace.size() << ","
                       << agg_n_bulk_h2d << "," << agg_n_bulk_d2h << ","
                       << agg_n_bundle << "," << agg_h2d_ns << ","
                       << agg_d2h_ns << "," << agg_bundle_ns << ","
                       << (agg_h2d_ns + agg_d2h_ns + agg_bundle_ns) << ","
                       << agg_h2d_bytes << "," << agg_d2h_bytes << ","
                       << agg_cycles << std::endl;
-            std::cerr << "[trace] " << app.name << " run " << run << " done"
+            std::cerr << "[trace] " << app << " run " << run << " done"
                       << std::endl;
         }
     }
@@ -418,8 +470,10 @@ static void run_traces(uint64_t dma_addr, uint64_t dma_capacity,
 int main(int argc, char *argv[])
 {
     std::string device_ip;
+    std::string trace_dir = JIGSAW_TRACE_DIR;
     int trace_runs = 5;
     uint64_t cycles_scale = 1;
+    uint64_t chunk_bytes = TRACE_CHUNK_BYTES;
 
     boost::program_options::options_description opts("Jigsaw SW Forwarder (no VM) Options");
     opts.add_options()
@@ -429,9 +483,21 @@ int main(int argc, char *argv[])
         ("trace_runs,r",
             boost::program_options::value<int>(&trace_runs),
             "Runs per trace application")
+        ("traces,t",
+            boost::program_options::value<std::string>(&trace_dir),
+            "Directory with the traces (*.trace) to replay")
         ("cycles_scale,c",
             boost::program_options::value<uint64_t>(&cycles_scale),
-            "Divide bundle compute cycles by this factor (default 1; 6 = Vortex-ASIC-class accelerator)");
+            "Divide bundle compute cycles by this factor (default 1; 6 = Vortex-ASIC-class accelerator)")
+        ("chunk_bytes",
+            boost::program_options::value<uint64_t>(&chunk_bytes),
+            "Bulk transfer chunk size (default 1 MiB as in the guest driver; 0 = one MMIO sequence per transfer)")
+        ("window,w",
+            boost::program_options::value<uint32_t>(&window),
+            "Mailbox requests in flight (1..32; default 1 = strict ping-pong)")
+        ("zero_copy",
+            boost::program_options::bool_switch(&zero_copy),
+            "Push payloads between the application buffer and the device staging buffer without staging copies");
 
     boost::program_options::variables_map vm;
     boost::program_options::store(
@@ -442,6 +508,10 @@ int main(int argc, char *argv[])
         std::cout << "ERROR: --ip_address (-i) is required\n" << opts << std::endl;
         return EXIT_FAILURE;
     }
+    if (window < 1 || window > WINDOW_SLOTS) {
+        std::cout << "ERROR: --window (-w) must be between 1 and " << WINDOW_SLOTS << std::endl;
+        return EXIT_FAILURE;
+    }
 
     std::cout << "Starting Jigsaw SW Forwarder — Host (no VM)..." << std::endl;
     std::cout << "Device OOB IP : " << device_ip << std::endl;
@@ -449,6 +519,20 @@ int main(int argc, char *argv[])
     coyote::cThread coyote_thread(DEFAULT_VFPGA_ID, getpid());
     ct = &coyote_thread;
 
+    // Application buffer standing in for the guest/ivshmem memory the
+    // forwarder serves; payload region mirrors the QP buffer layout.
+    if (posix_memalign(reinterpret_cast<void **>(&app_buf), 4096, BUF_BYTES) != 0) {
+        std::cerr << "application buffer allocation failed" << std::endl;
+        return EXIT_FAILURE;
+    }
+    memset(app_buf, 0xAB, BUF_BYTES);  // pre-fault + recognizable payload
+
+    // Zero-copy: the buffer must be registered before the QP exchange
+    if (zero_copy) {
+        coyote_thread.userMap(app_buf, BUF_BYTES);
+        coyote_thread.registerMr(app_buf, BUF_BYTES);
+    }
+
     nic_buf = static_cast<char *>(
         coyote_thread.initRDMA(BUF_BYTES, coyote::DEF_PORT, device_ip.c_str()));
     if (!nic_buf) {
@@ -456,16 +540,11 @@ int main(int argc, char *argv[])
         return EXIT_FAILURE;
     }
     memset(nic_buf, 0, CONTROL_SIZE);
-    req_slot = reinterpret_cast<struct msg *>(nic_buf + REQ_OFF);
-    resp_slot = reinterpret_cast<volatile struct msg *>(nic_buf + RESP_OFF);
 
-    // Application buffer standing in for the guest/ivshmem memory the
-    // forwarder serves; payload region mirrors the QP buffer layout.
-    if (posix_memalign(reinterpret_cast<void **>(&app_buf), 4096, BUF_BYTES) != 0) {
-        std::cerr << "application buffer allocation failed" << std::endl;
+    if (zero_copy && coyote_thread.getNumRemoteMrs() < PAYLOAD_MR) {
+        std::cerr << "device did not register its staging buffer, zero-copy unavailable" << std::endl;
         return EXIT_FAILURE;
     }
-    memset(app_buf, 0xAB, BUF_BYTES);  // pre-fault + recognizable payload
 
     // Initial sync with the device
     coyote_thread.connSync(true);
@@ -476,8 +555,10 @@ int main(int argc, char *argv[])
     uint64_t dma_addr = reinterpret_cast<uint64_t>(app_buf) + PAYLOAD_OFF;
     uint64_t dma_capacity = BUF_BYTES - PAYLOAD_OFF;
 
+    std::vector<coyote::cTrace> traces = coyote::cTrace::loadDir(trace_dir);
+    coyote::cTraceReplay replay(&coyote_thread, reinterpret_cast<void *>(dma_addr), dma_capacity);
     std::vector<TraceResult> trace_results;
-    run_traces(dma_addr, dma_capacity, trace_runs, cycles_scale, trace_results);
+    run_traces(traces, replay, dma_addr, trace_runs, cycles_scale, chunk_bytes, trace_results);
 
     (void)request(OP_STOP, 0, 0);
 
@@ -0,0 +1,748 @@
+#include <netdb.h>
+#include <time.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+#include "telemetry.hpp"
+
+// Largest payload a header can describe
+#define TELEM_MAX_PAYLOAD 0xffff
+
+static uint64_t now_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+template <typename T>
+static void put(std::string &buf, T val)
+{
+    buf.append(reinterpret_cast<const char *>(&val), sizeof(val));
+}
+
+template <typename T>
+static bool get(const std::string &buf, size_t &pos, T &val)
+{
+    if (pos + sizeof(val) > buf.size())
+    {
+        return false;
+    }
+    memcpy(&val, buf.data() + pos, sizeof(val));
+    pos += sizeof(val);
+    return true;
+}
+
+static void put_varint(std::string &buf, uint64_t val)
+{
+    while (val >= 0x80)
+    {
+        buf.push_back(static_cast<char>((val & 0x7f) | 0x80));
+        val >>= 7;
+    }
+    buf.push_back(static_cast<char>(val));
+}
+
+static bool get_varint(const std::string &buf, size_t &pos, uint64_t &val)
+{
+    val = 0;
+    for (unsigned shift = 0; shift < 64 && pos < buf.size(); shift += 7)
+    {
+        uint8_t byte = static_cast<uint8_t>(buf[pos++]);
+        val |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+static std::string frame(telem_type type, const std::string &payload)
+{
+    telem_hdr hdr = { TELEM_MAGIC, type, static_cast<uint16_t>(std::min<size_t>(payload.size(), TELEM_MAX_PAYLOAD)) };
+    std::string msg(reinterpret_cast<const char *>(&hdr), sizeof(hdr));
+    msg.append(payload, 0, hdr.len);
+    return msg;
+}
+
+static void set_nodelay(int fd)
+{
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+}
+
+// ---------------------------------------------------------------------------
+// Server
+// ---------------------------------------------------------------------------
+TelemetryServer::TelemetryServer(std::vector<std::string> names, sampler_t sampler, command_t on_command)
+    : names(std::move(names)), sampler(std::move(sampler)), on_command(std::move(on_command)) {}
+
+TelemetryServer::~TelemetryServer()
+{
+    stop();
+}
+
+void TelemetryServer::start(uint16_t port)
+{
+    listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listen_fd < 0)
+    {
+        throw std::runtime_error("telemetry socket creation failed");
+    }
+
+    int one = 1;
+    setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port);
+    if (bind(listen_fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0 || listen(listen_fd, 16) < 0)
+    {
+        stop();
+        throw std::runtime_error("telemetry socket bind/listen failed on port " + std::to_string(port));
+    }
+
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epoll_fd < 0 || timer_fd < 0 || wake_fd < 0)
+    {
+        stop();
+        throw std::runtime_error("telemetry event setup failed");
+    }
+
+    for (int fd : { listen_fd, timer_fd, wake_fd })
+    {
+        epoll_event ev = {};
+        ev.events = EPOLLIN;
+        ev.data.fd = fd;
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev);
+    }
+
+    worker = std::thread(&TelemetryServer::loop, this);
+}
+
+void TelemetryServer::stop()
+{
+    if (worker.joinable())
+    {
+        uint64_t one = 1;
+        if (write(wake_fd, &one, sizeof(one)) < 0)
+        {
+            perror("telemetry wakeup");
+        }
+        worker.join();
+    }
+
+    for (auto &it : clients)
+    {
+        ::close(it.first);
+    }
+    clients.clear();
+
+    for (int *fd : { &listen_fd, &epoll_fd, &timer_fd, &wake_fd })
+    {
+        if (*fd >= 0)
+        {
+            ::close(*fd);
+            *fd = -1;
+        }
+    }
+}
+
+void TelemetryServer::loop()
+{
+    epoll_event events[32];
+
+    while (true)
+    {
+        int n = epoll_wait(epoll_fd, events, 32, -1);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            perror("telemetry epoll_wait");
+            return;
+        }
+
+        for (int i = 0; i < n; i++)
+        {
+            int fd = events[i].data.fd;
+            if (fd == wake_fd)
+            {
+                return;
+            }
+            if (fd == listen_fd)
+            {
+                accept_clients();
+                continue;
+            }
+            if (fd == timer_fd)
+            {
+                uint64_t expirations;
+                if (read(timer_fd, &expirations, sizeof(expirations)) == sizeof(expirations))
+                {
+                    push_due();
+                }
+                continue;
+            }
+
+            auto it = clients.find(fd);
+            if (it == clients.end())
+            {
+                continue;
+            }
+            bool ok = !(events[i].events & (EPOLLERR | EPOLLHUP));
+            if (ok && (events[i].events & EPOLLIN))
+            {
+                ok = read_client(fd, it->second);
+            }
+            if (ok && (events[i].events & EPOLLOUT))
+            {
+                ok = flush(fd, it->second);
+            }
+            if (!ok)
+            {
+                drop(fd);
+            }
+        }
+
+        arm_timer();
+    }
+}
+
+void TelemetryServer::accept_clients()
+{
+    while (true)
+    {
+        int fd = accept4(listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0)
+        {
+            return;
+        }
+        set_nodelay(fd);
+
+        epoll_event ev = {};
+        ev.events = EPOLLIN | EPOLLRDHUP;
+        ev.data.fd = fd;
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0)
+        {
+            ::close(fd);
+            continue;
+        }
+        clients[fd] = client();
+        std::cout << "Telemetry client connected (" << clients.size() << " total)." << std::endl;
+    }
+}
+
+bool TelemetryServer::read_client(int fd, client &c)
+{
+    char data[4096];
+    bool closed = false;
+    while (true)
+    {
+        ssize_t n = recv(fd, data, sizeof(data), 0);
+        if (n > 0)
+        {
+            c.rx.append(data, static_cast<size_t>(n));
+            continue;
+        }
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        closed = !(n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK));
+        break;
+    }
+
+    if (!c.framed && !c.rx.empty())
+    {
+        c.framed = true;
+        c.binary = static_cast<uint8_t>(c.rx[0]) == TELEM_MAGIC;
+    }
+
+    // Commands sent right before the peer went away are still served
+    if (!(c.binary ? handle_binary(c) : handle_text(c)) || closed)
+    {
+        return false;
+    }
+    return flush(fd, c);
+}
+
+bool TelemetryServer::handle_binary(client &c)
+{
+    size_t pos = 0;
+    bool keep = true;
+    while (keep)
+    {
+        telem_hdr hdr;
+        size_t payload_pos = pos;
+        if (!get(c.rx, payload_pos, hdr))
+        {
+            break;
+        }
+        if (hdr.magic != TELEM_MAGIC)
+        {
+            std::cerr << "Telemetry: bad magic, dropping client" << std::endl;
+            return false;
+        }
+        if (payload_pos + hdr.len > c.rx.size())
+        {
+            break;
+        }
+
+        std::string payload = c.rx.substr(payload_pos, hdr.len);
+        pos = payload_pos + hdr.len;
+
+        switch (hdr.type)
+        {
+        case TELEM_START:
+        case TELEM_DONE:
+        case TELEM_DUMP:
+            on_command(static_cast<telem_type>(hdr.type), payload);
+            break;
+
+        case TELEM_STOP:
+            keep = false;
+            break;
+
+        case TELEM_SUBSCRIBE:
+        {
+            uint32_t period_us = 0;
+            size_t p = 0;
+            get(payload, p, period_us);
+            c.period_ns = static_cast<uint64_t>(period_us) * 1000;
+            if (c.period_ns)
+            {
+                std::string schema;
+                put(schema, static_cast<uint16_t>(names.size()));
+                for (const auto &name : names)
+                {
+                    schema.append(name);
+                    schema.push_back('\0');
+                }
+                queue(c, TELEM_SCHEMA, schema);
+                c.last.assign(names.size(), 0);
+                c.next_due = now_ns();
+            }
+            break;
+        }
+
+        default:
+            break;
+        }
+    }
+
+    c.rx.erase(0, pos);
+    return keep;
+}
+
+bool TelemetryServer::handle_text(client &c)
+{
+    size_t nl;
+    while ((nl = c.rx.find('\n')) != std::string::npos)
+    {
+        std::string line = c.rx.substr(0, nl);
+        c.rx.erase(0, nl + 1);
+        if (!line.empty() && line.back() == '\r')
+        {
+            line.pop_back();
+        }
+
+        if (line.rfind("START ", 0) == 0)
+        {
+            on_command(TELEM_START, line.substr(6));
+        }
+        else if (line.rfind("DONE ", 0) == 0)
+        {
+            on_command(TELEM_DONE, line.substr(5));
+        }
+        else if (line.rfind("DUMP ", 0) == 0)
+        {
+            on_command(TELEM_DUMP, line.substr(5));
+        }
+        else if (line == "STOP")
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void TelemetryServer::queue(client &c, telem_type type, const std::string &payload)
+{
+    c.tx.append(frame(type, payload));
+}
+
+bool TelemetryServer::flush(int fd, client &c)
+{
+    while (!c.tx.empty())
+    {
+        ssize_t n = send(fd, c.tx.data(), c.tx.size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                watch(fd, c, true);
+                return true;
+            }
+            return false;
+        }
+        c.tx.erase(0, static_cast<size_t>(n));
+    }
+    watch(fd, c, false);
+    return true;
+}
+
+void TelemetryServer::watch(int fd, client &c, bool writing)
+{
+    if (c.writing == writing)
+    {
+        return;
+    }
+    epoll_event ev = {};
+    ev.events = EPOLLIN | EPOLLRDHUP | (writing ? static_cast<uint32_t>(EPOLLOUT) : 0u);
+    ev.data.fd = fd;
+    epoll_ctl(epoll_fd, EPOLL_CTL_MOD, fd, &ev);
+    c.writing = writing;
+}
+
+void TelemetryServer::push_due()
+{
+    uint64_t now = now_ns();
+    bool due = false;
+    for (auto &it : clients)
+    {
+        due |= it.second.period_ns && it.second.next_due <= now;
+    }
+    if (!due)
+    {
+        return;
+    }
+
+    // One sample for all the clients due
+    std::vector<uint64_t> values(names.size(), 0);
+    sampler(values);
+    uint64_t sampled = now_ns();
+
+    std::vector<int> failed;
+    for (auto &it : clients)
+    {
+        client &c = it.second;
+        if (!c.period_ns || c.next_due > now)
+        {
+            continue;
+        }
+
+        // Skip missed periods rather than bursting to catch up
+        c.next_due += c.period_ns;
+        if (c.next_due <= now)
+        {
+            c.next_due = now + c.period_ns;
+        }
+
+        // Backed-up client: skip this frame, the next delta covers it
+        if (c.tx.size() >= TELEM_MAX_TX_BYTES)
+        {
+            continue;
+        }
+
+        std::string bitmap((values.size() + 7) / 8, '\0');
+        std::string deltas;
+        for (size_t i = 0; i < values.size(); i++)
+        {
+            if (values[i] != c.last[i])
+            {
+                bitmap[i / 8] |= static_cast<char>(1 << (i % 8));
+                put_varint(deltas, values[i] - c.last[i]);
+                c.last[i] = values[i];
+            }
+        }
+
+        std::string payload;
+        put(payload, sampled);
+        put(payload, c.seq++);
+        payload.append(bitmap);
+        payload.append(deltas);
+        queue(c, TELEM_DELTA, payload);
+        if (!flush(it.first, c))
+        {
+            failed.push_back(it.first);
+        }
+    }
+
+    for (int fd : failed)
+    {
+        drop(fd);
+    }
+}
+
+void TelemetryServer::arm_timer()
+{
+    uint64_t next = 0;
+    for (auto &it : clients)
+    {
+        if (it.second.period_ns && (!next || it.second.next_due < next))
+        {
+            next = it.second.next_due;
+        }
+    }
+
+    // Absolute expiry; 0 disarms, so an overdue push fires at the earliest 1 ns
+    struct itimerspec its = {};
+    if (next)
+    {
+        its.it_value.tv_sec = next / 1000000000ULL;
+        its.it_value.tv_nsec = next % 1000000000ULL;
+        if (!its.it_value.tv_sec && !its.it_value.tv_nsec)
+        {
+            its.it_value.tv_nsec = 1;
+        }
+    }
+    timerfd_settime(timer_fd, TFD_TIMER_ABSTIME, &its, nullptr);
+}
+
+void TelemetryServer::drop(int fd)
+{
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+    ::close(fd);
+    clients.erase(fd);
+}
+
+// ---------------------------------------------------------------------------
+// Client
+// ---------------------------------------------------------------------------
+TelemetryClient::~TelemetryClient()
+{
+    close();
+}
+
+void TelemetryClient::connect_to(const std::string &host, uint16_t port)
+{
+    std::string port_str = std::to_string(port);
+    addrinfo hints = {};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+
+    addrinfo *result = nullptr;
+    int rc = getaddrinfo(host.c_str(), port_str.c_str(), &hints, &result);
+    if (rc != 0)
+    {
+        throw std::runtime_error(std::string("telemetry getaddrinfo failed: ") + gai_strerror(rc));
+    }
+
+    for (int attempt = 0; attempt < 100 && fd < 0; attempt++)
+    {
+        for (addrinfo *rp = result; rp != nullptr && fd < 0; rp = rp->ai_next)
+        {
+            int candidate = socket(rp->ai_family, rp->ai_socktype | SOCK_CLOEXEC, rp->ai_protocol);
+            if (candidate < 0)
+            {
+                continue;
+            }
+            if (connect(candidate, rp->ai_addr, rp->ai_addrlen) == 0)
+            {
+                fd = candidate;
+                break;
+            }
+            ::close(candidate);
+        }
+
+        if (fd < 0)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        }
+    }
+
+    freeaddrinfo(result);
+    if (fd < 0)
+    {
+        throw std::runtime_error("could not connect to telemetry server");
+    }
+    set_nodelay(fd);
+}
+
+void TelemetryClient::send(telem_type type, const std::string &payload)
+{
+    if (fd < 0)
+    {
+        return;
+    }
+
+    std::string msg = frame(type, payload);
+    const char *ptr = msg.data();
+    size_t remaining = msg.size();
+    while (remaining != 0)
+    {
+        ssize_t written = ::send(fd, ptr, remaining, MSG_NOSIGNAL);
+        if (written < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (written <= 0)
+        {
+            throw std::runtime_error("could not write to telemetry socket");
+        }
+        ptr += written;
+        remaining -= static_cast<size_t>(written);
+    }
+}
+
+void TelemetryClient::subscribe(uint32_t period_us)
+{
+    std::string payload;
+    put(payload, period_us);
+    send(TELEM_SUBSCRIBE, payload);
+
+    if (fd >= 0 && !receiving.exchange(true))
+    {
+        receiver = std::thread(&TelemetryClient::receive_loop, this);
+    }
+}
+
+void TelemetryClient::receive_loop()
+{
+    std::string rx;
+    char data[4096];
+
+    while (receiving.load())
+    {
+        ssize_t n = recv(fd, data, sizeof(data), 0);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            break;
+        }
+        rx.append(data, static_cast<size_t>(n));
+
+        size_t pos = 0;
+        while (true)
+        {
+            telem_hdr hdr;
+            size_t p = pos;
+            if (!get(rx, p, hdr) || p + hdr.len > rx.size())
+            {
+                break;
+            }
+            if (hdr.magic != TELEM_MAGIC)
+            {
+                std::cerr << "Telemetry: bad magic from server" << std::endl;
+                return;
+            }
+            std::string payload = rx.substr(p, hdr.len);
+            pos = p + hdr.len;
+
+            std::lock_guard<std::mutex> lock(mtx);
+            if (hdr.type == TELEM_SCHEMA)
+            {
+                size_t q = 0;
+                uint16_t count = 0;
+                get(payload, q, count);
+                counter_names.clear();
+                while (counter_names.size() < count && q < payload.size())
+                {
+                    size_t end = payload.find('\0', q);
+                    if (end == std::string::npos)
+                    {
+                        end = payload.size();
+                    }
+                    counter_names.push_back(payload.substr(q, end - q));
+                    q = end + 1;
+                }
+                counter_names.resize(count);
+                counter_values.assign(count, 0);
+                have_values = false;
+            }
+            else if (hdr.type == TELEM_DELTA)
+            {
+                size_t q = 0;
+                uint64_t sampled;
+                uint32_t seq;
+                size_t bitmap_len = (counter_values.size() + 7) / 8;
+                if (!get(payload, q, sampled) || !get(payload, q, seq) || q + bitmap_len > payload.size())
+                {
+                    continue;
+                }
+                std::string bitmap = payload.substr(q, bitmap_len);
+                q += bitmap_len;
+                for (size_t i = 0; i < counter_values.size(); i++)
+                {
+                    uint64_t delta;
+                    if ((bitmap[i / 8] >> (i % 8)) & 1)
+                    {
+                        if (!get_varint(payload, q, delta))
+                        {
+                            break;
+                        }
+                        counter_values[i] += delta;
+                    }
+                }
+                have_values = true;
+                received_at = std::chrono::steady_clock::now();
+            }
+        }
+        rx.erase(0, pos);
+    }
+}
+
+bool TelemetryClient::latest(std::vector<std::string> &names, std::vector<uint64_t> &values,
+                             std::chrono::steady_clock::duration &age) const
+{
+    std::lock_guard<std::mutex> lock(mtx);
+    if (!have_values)
+    {
+        return false;
+    }
+    names = counter_names;
+    values = counter_values;
+    age = std::chrono::steady_clock::now() - received_at;
+    return true;
+}
+
+void TelemetryClient::close()
+{
+    if (fd < 0)
+    {
+        return;
+    }
+
+    try
+    {
+        send(TELEM_STOP, "");
+    }
+    catch (...)
+    {
+    }
+
+    receiving.store(false);
+    shutdown(fd, SHUT_RDWR);
+    if (receiver.joinable())
+    {
+        receiver.join();
+    }
+    ::close(fd);
+    fd = -1;
+}
@@ -0,0 +1,178 @@
+#ifndef JIGSAW_TELEMETRY_HPP
+#define JIGSAW_TELEMETRY_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+/*
+ * Debug/telemetry channel between the jigsaw controllers
+ * (jigsaw_device_controller/sw serves, jigsaw_host_controller/sw_no_vm
+ * connects).
+ *
+ * Every message is a 4-byte header followed by the payload:
+ *
+ *   uint8_t magic (TELEM_MAGIC) | uint8_t type | uint16_t payload length
+ *
+ * Client to server:
+ *   TELEM_START, TELEM_DONE, TELEM_DUMP  run label (not NUL-terminated)
+ *   TELEM_STOP                           the client is done; the server closes the connection
+ *   TELEM_SUBSCRIBE                      uint32_t period in us; 0 stops the stream
+ *
+ * Server to client:
+ *   TELEM_SCHEMA  uint16_t counter count, then the NUL-terminated counter names
+ *   TELEM_DELTA   uint64_t sample time (ns, server CLOCK_MONOTONIC) | uint32_t sequence |
+ *                 bitmap of changed counters (1 bit per counter, LSB first) |
+ *                 one LEB128 varint per changed counter: new - previous (mod 2^64)
+ *
+ * The deltas are relative to the last frame sent to the same client (all
+ * zeros before the first), so a client that was skipped while its socket
+ * was backed up still reconstructs the exact values. All fields are
+ * little-endian.
+ *
+ * For netcat and older clients, a connection whose first byte is not
+ * TELEM_MAGIC is served as text: one "START <label>", "DONE <label>",
+ * "DUMP <label>" or "STOP" command per line.
+ */
+
+#define TELEM_MAGIC 0xC7
+
+// Upper bound of the output buffered for a slow client; frames due while it
+// is full are skipped (and folded into the next delta)
+#define TELEM_MAX_TX_BYTES (1 << 20)
+
+enum telem_type : uint8_t
+{
+    TELEM_START = 1,
+    TELEM_DONE = 2,
+    TELEM_DUMP = 3,
+    TELEM_STOP = 4,
+    TELEM_SUBSCRIBE = 5,
+    TELEM_SCHEMA = 0x80,
+    TELEM_DELTA = 0x81
+};
+
+struct __attribute__((packed)) telem_hdr
+{
+    uint8_t magic;
+    uint8_t type;
+    uint16_t len;
+};
+
+/**
+ * @brief Event-driven telemetry server: many clients, one thread
+ *
+ * Clients are served from an epoll loop; pushes are paced with a timerfd
+ * armed for the earliest client due, so nothing polls at a fixed interval.
+ * The counters are sampled once per timer expiry and shared by all the
+ * clients due at that point.
+ */
+class TelemetryServer
+{
+public:
+    /// Reads the current counter values (one per name)
+    using sampler_t = std::function<void(std::vector<uint64_t> &values)>;
+    /// Handles START/DONE/DUMP commands with their label
+    using command_t = std::function<void(telem_type type, const std::string &label)>;
+
+    TelemetryServer(std::vector<std::string> names, sampler_t sampler, command_t on_command);
+    ~TelemetryServer();
+
+    /**
+     * @brief Listens on the port and serves clients from a background thread
+     * until stop(); throws std::runtime_error if the socket cannot be set up
+     */
+    void start(uint16_t port);
+
+    void stop();
+
+private:
+    struct client
+    {
+        bool framed = false;        // protocol known (first byte seen)
+        bool binary = false;
+        bool writing = false;       // waiting for EPOLLOUT
+        std::string rx;
+        std::string tx;
+        uint64_t period_ns = 0;     // 0: not subscribed
+        uint64_t next_due = 0;
+        uint32_t seq = 0;
+        std::vector<uint64_t> last;
+    };
+
+    std::vector<std::string> names;
+    sampler_t sampler;
+    command_t on_command;
+
+    int listen_fd = -1;
+    int epoll_fd = -1;
+    int timer_fd = -1;
+    int wake_fd = -1;
+    std::thread worker;
+    std::unordered_map<int, client> clients;
+
+    void loop();
+    void accept_clients();
+    bool read_client(int fd, client &c);
+    bool handle_binary(client &c);
+    bool handle_text(client &c);
+    bool flush(int fd, client &c);
+    void queue(client &c, telem_type type, const std::string &payload);
+    void push_due();
+    void watch(int fd, client &c, bool writing);
+    void arm_timer();
+    void drop(int fd);
+};
+
+/**
+ * @brief Client side: sends run commands and keeps the latest streamed counters
+ */
+class TelemetryClient
+{
+public:
+    ~TelemetryClient();
+
+    /// Connects, retrying for up to ~5 s while the server comes up; throws std::runtime_error on failure
+    void connect_to(const std::string &host, uint16_t port);
+
+    bool connected() const { return fd >= 0; }
+
+    void start_run(const std::string &label) { send(TELEM_START, label); }
+    void done_run(const std::string &label) { send(TELEM_DONE, label); }
+    void dump(const std::string &label) { send(TELEM_DUMP, label); }
+
+    /// Asks the server to stream counter deltas every period_us and receives them in the background
+    void subscribe(uint32_t period_us);
+
+    /**
+     * @brief Latest streamed counters
+     * @return false if no frame has been received yet
+     */
+    bool latest(std::vector<std::string> &names, std::vector<uint64_t> &values,
+                std::chrono::steady_clock::duration &age) const;
+
+    /// Sends STOP and closes the connection
+    void close();
+
+private:
+    int fd = -1;
+    std::thread receiver;
+    std::atomic<bool> receiving{false};
+
+    mutable std::mutex mtx;
+    std::vector<std::string> counter_names;
+    std::vector<uint64_t> counter_values;
+    bool have_values = false;
+    std::chrono::steady_clock::time_point received_at;
+
+    void send(telem_type type, const std::string &payload);
+    void receive_loop();
+};
+
+#endif // JIGSAW_TELEMETRY_HPP
@@ -0,0 +1,152 @@
+/**
+ * This file is part of the Coyote <https://github.com/fpgasystems/Coyote>
+ *
+ * MIT Licence
+ * Copyright (c) 2021-2025, Systems Group, ETH Zurich
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+`timescale 1ns / 1ps
+
+import lynxTypes::*;
+
+/**
+ * @brief Writes snapshots of a bank of 64-bit counters to a host buffer
+ *
+ * Instead of reading the counters one register at a time (each a non-posted PCIe read), the host points the module
+ * to a writeback buffer and requests snapshots, or lets the module take them periodically. The counters are latched
+ * in a single cycle, so a snapshot is consistent, and written with a LOCAL_WRITE on the host stream. 
+ *
+ * Snapshot layout (SNAP_BEATS data beats): word 0 holds the sequence number of the snapshot (starting from 1), words 
+ * 1..N_COUNTERS the counters and the last word the sequence number again. The host copies the snapshot and accepts 
+ * it if both sequence numbers are equal (and non-zero); otherwise, it was being overwritten and the copy is retried.
+ *
+ * @param N_COUNTERS Number of counters
+ *
+ * @param[in] counters Counter bank
+ * @param[in] snap_vaddr Virtual address of the writeback buffer; 0 disables the snapshots
+ * @param[in] snap_period Cycles between periodic snapshots; 0 only takes snapshots on request
+ * @param[in] snap_req Request a snapshot (single cycle); requests while a snapshot is being written are merged
+ * @param[out] sq_valid/sq_vaddr/sq_len Write request, for the vFPGA's sq_wr (LOCAL_WRITE, STRM_HOST)
+ * @param[in] sq_ready Write request accepted
+ * @param[out] m_axis Snapshot data, for the axis_host_send stream the write request targets
+ */
+module counter_snapshot #(
+    parameter integer N_COUNTERS = 24
+) (
+    input  logic                            aclk,
+    input  logic                            aresetn,
+
+    input  logic [N_COUNTERS-1:0][63:0]     counters,
+
+    input  logic [VADDR_BITS-1:0]           snap_vaddr,
+    input  logic [31:0]                     snap_period,
+    input  logic                            snap_req,
+
+    output logic                            sq_valid,
+    input  logic                            sq_ready,
+    output logic [VADDR_BITS-1:0]           sq_vaddr,
+    output logic [LEN_BITS-1:0]             sq_len,
+
+    AXI4SR.m                                m_axis
+);
+
+localparam integer WORDS_PER_BEAT = AXI_DATA_BITS / 64;
+localparam integer SNAP_BEATS = (N_COUNTERS + 2 + WORDS_PER_BEAT - 1) / WORDS_PER_BEAT;
+localparam integer SNAP_WORDS = SNAP_BEATS * WORDS_PER_BEAT;
+
+typedef enum logic[1:0] {ST_IDLE, ST_REQ, ST_DATA} state_t;
+state_t state_C;
+
+logic [SNAP_WORDS-1:0][63:0] snap_C;
+logic [63:0] seq_C;
+logic [$clog2(SNAP_BEATS+1)-1:0] beat_C;
+logic [31:0] timer_C;
+logic pending_C;
+logic timer_expired;
+
+assign timer_expired = (snap_period != 0) && (timer_C >= snap_period - 1);
+
+always_ff @(posedge aclk) begin
+    if (aresetn == 1'b0) begin
+        state_C <= ST_IDLE;
+        snap_C <= '0;
+        seq_C <= '0;
+        beat_C <= '0;
+        timer_C <= '0;
+        pending_C <= 1'b0;
+    end
+    else begin
+        timer_C <= (snap_period == 0 || timer_expired) ? '0 : timer_C + 1;
+
+        case (state_C)
+            ST_IDLE: begin
+                if (pending_C && snap_vaddr != 0) begin
+                    // Latch all the counters in the same cycle
+                    snap_C <= '0;
+                    snap_C[0] <= seq_C + 1;
+                    for (int i = 0; i < N_COUNTERS; i++) begin
+                        snap_C[1 + i] <= counters[i];
+                    end
+                    snap_C[SNAP_WORDS-1] <= seq_C + 1;
+                    seq_C <= seq_C + 1;
+                    pending_C <= 1'b0;
+                    state_C <= ST_REQ;
+                end
+            end
+
+            ST_REQ: begin
+                if (sq_ready) begin
+                    beat_C <= '0;
+                    state_C <= ST_DATA;
+                end
+            end
+
+            ST_DATA: begin
+                if (m_axis.tready) begin
+                    beat_C <= beat_C + 1;
+                    if (beat_C == SNAP_BEATS - 1) begin
+                        state_C <= ST_IDLE;
+                    end
+                end
+            end
+
+            default: state_C <= ST_IDLE;
+        endcase
+
+        // Requests and timer expiries are merged until the next snapshot is taken
+        if (snap_req || timer_expired) begin
+            pending_C <= 1'b1;
+        end
+    end
+end
+
+assign sq_valid = (state_C == ST_REQ);
+assign sq_vaddr = snap_vaddr;
+assign sq_len = SNAP_BEATS * (AXI_DATA_BITS / 8);
+
+assign m_axis.tvalid = (state_C == ST_DATA);
+assign m_axis.tdata = snap_C[beat_C * WORDS_PER_BEAT +: WORDS_PER_BEAT];
+assign m_axis.tkeep = '1;
+assign m_axis.tlast = (beat_C == SNAP_BEATS - 1);
+assign m_axis.tid = '0;
+
+endmodule
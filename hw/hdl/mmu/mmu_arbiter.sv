@@ -34,6 +34,10 @@ import lynxTypes::*;
  * Round-robin arbitration for the requests stemming from the TLB FSMs. 
  * The output requests are forwarded to the corresponding DMA engines.
  *
+ * Each region can be limited to a bandwidth share (token bucket, in MB/s; 0 is unlimited).
+ * A region is only arbitrated while its bucket is not in deficit, a granted request takes its length.
+ * The bytes granted to each region in the last ms are reported back.
+ *
  *  @param DATA_BITS    Data bus size
  */
 module mmu_arbiter #(
@@ -47,13 +51,22 @@ module mmu_arbiter #(
     dmaIntf.m                           m_req,
 
     // Multiplexing
-    metaIntf.m                          m_mux
+    metaIntf.m                          m_mux,
+
+    // Bandwidth shares
+    input  logic [N_REGIONS-1:0][31:0]  s_share,
+    output logic [N_REGIONS-1:0][31:0]  m_xfer
 );
 
 // Constants
 localparam integer BEAT_LOG_BITS = $clog2(DATA_BITS/8);
 localparam integer BLEN_BITS = LEN_BITS - BEAT_LOG_BITS;
 
+localparam integer SHARE_PERIOD = ACLK_F;           // Buckets are refilled every us, so the share is in B/us (MB/s)
+localparam integer SHARE_BURST_BITS = 4;            // Buckets hold up to 16 us worth of tokens
+localparam integer XFER_WINDOW = 1000;              // Granted bytes are reported per ms
+localparam integer TOKEN_BITS = 32 + SHARE_BURST_BITS + 2;
+
 // Internal
 logic [N_REGIONS-1:0] ready_snk;
 logic [N_REGIONS-1:0] valid_snk;
@@ -74,6 +87,15 @@ logic [N_REGIONS_BITS-1:0] done_vfid;
 
 logic [BLEN_BITS-1:0] n_tr;
 
+// Shares
+logic [$clog2(SHARE_PERIOD)-1:0] share_cnt;
+logic [$clog2(XFER_WINDOW)-1:0] xfer_us;
+logic signed [TOKEN_BITS-1:0] tokens [N_REGIONS];
+logic signed [TOKEN_BITS-1:0] tokens_nxt [N_REGIONS];
+logic [N_REGIONS-1:0] eligible;
+logic [N_REGIONS-1:0] valid_arb;
+logic [N_REGIONS-1:0][31:0] xfer_bytes;
+
 // --------------------------------------------------------------------------------
 // IO
 // --------------------------------------------------------------------------------
@@ -119,15 +141,15 @@ always_comb begin
 
     for(int i = 0; i < N_REGIONS; i++) begin
         if(i+rr_reg >= N_REGIONS) begin
-            if(valid_snk[i+rr_reg-N_REGIONS]) begin
-                valid_src = valid_snk[i+rr_reg-N_REGIONS] && user_seq_in.ready && done_seq_in.ready;
+            if(valid_arb[i+rr_reg-N_REGIONS]) begin
+                valid_src = valid_arb[i+rr_reg-N_REGIONS] && user_seq_in.ready && done_seq_in.ready;
                 vfid = i+rr_reg-N_REGIONS;
                 break;
             end
         end
         else begin
-            if(valid_snk[i+rr_reg]) begin
-                valid_src = valid_snk[i+rr_reg] && user_seq_in.ready && done_seq_in.ready;
+            if(valid_arb[i+rr_reg]) begin
+                valid_src = valid_arb[i+rr_reg] && user_seq_in.ready && done_seq_in.ready;
                 vfid = i+rr_reg;
                 break;
             end
@@ -140,6 +162,64 @@ always_comb begin
     response_snk[done_vfid].done = done_src;
 end
 
+// --------------------------------------------------------------------------------
+// Shares
+// --------------------------------------------------------------------------------
+for(genvar i = 0; i < N_REGIONS; i++) begin
+    assign eligible[i] = (s_share[i] == 0) || !tokens[i][TOKEN_BITS-1];
+end
+assign valid_arb = valid_snk & eligible;
+
+always_comb begin
+    for(int i = 0; i < N_REGIONS; i++) begin
+        tokens_nxt[i] = tokens[i];
+
+        if(s_share[i] == 0) begin
+            tokens_nxt[i] = 0;
+        end
+        else begin
+            if(share_cnt == SHARE_PERIOD-1) begin
+                tokens_nxt[i] = tokens[i] + $signed({{(TOKEN_BITS-32){1'b0}}, s_share[i]});
+                if(tokens_nxt[i] > $signed({2'b0, s_share[i], {SHARE_BURST_BITS{1'b0}}}))
+                    tokens_nxt[i] = $signed({2'b0, s_share[i], {SHARE_BURST_BITS{1'b0}}});
+            end
+
+            // A request can exceed the bucket, the region then waits until the deficit is paid off
+            if(valid_src && ready_src && vfid == i)
+                tokens_nxt[i] = tokens_nxt[i] - $signed({{(TOKEN_BITS-LEN_BITS){1'b0}}, request_snk[i].len});
+        end
+    end
+end
+
+always_ff @(posedge aclk) begin
+    if (aresetn == 1'b0) begin
+        share_cnt <= 0;
+        xfer_us <= 0;
+        for(int i = 0; i < N_REGIONS; i++) begin
+            tokens[i] <= 0;
+        end
+        xfer_bytes <= 0;
+        m_xfer <= 0;
+    end else begin
+        share_cnt <= (share_cnt == SHARE_PERIOD-1) ? 0 : share_cnt + 1;
+        if(share_cnt == SHARE_PERIOD-1) begin
+            xfer_us <= (xfer_us == XFER_WINDOW-1) ? 0 : xfer_us + 1;
+        end
+
+        for(int i = 0; i < N_REGIONS; i++) begin
+            tokens[i] <= tokens_nxt[i];
+
+            if(share_cnt == SHARE_PERIOD-1 && xfer_us == XFER_WINDOW-1) begin
+                m_xfer[i] <= xfer_bytes[i] + ((valid_src && ready_src && vfid == i) ? request_snk[i].len : 0);
+                xfer_bytes[i] <= 0;
+            end
+            else if(valid_src && ready_src && vfid == i) begin
+                xfer_bytes[i] <= xfer_bytes[i] + request_snk[i].len;
+            end
+        end
+    end
+end
+
 assign n_tr = (request_snk[vfid].len - 1) >> BEAT_LOG_BITS;
 assign user_seq_in.valid = valid_src & ready_src;
 assign user_seq_in.data = {request_snk[vfid].last, vfid, n_tr};
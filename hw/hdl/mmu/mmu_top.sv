@@ -138,6 +138,11 @@ module mmu_top #(
 
     metaIntf #(.STYPE(ack_t)) rd_host_done [N_REGIONS] (.*);
     metaIntf #(.STYPE(ack_t)) wr_host_done [N_REGIONS] (.*);
+
+    logic [N_REGIONS-1:0][31:0] rd_hdma_share;
+    logic [N_REGIONS-1:0][31:0] wr_hdma_share;
+    logic [N_REGIONS-1:0][31:0] rd_hdma_xfer;
+    logic [N_REGIONS-1:0][31:0] wr_hdma_xfer;
 `endif
 
 `ifdef EN_MEM
@@ -210,8 +215,8 @@ end
 
 // Arbitration
 `ifdef EN_STRM
-    mmu_arbiter inst_hdma_arb_rd (.aclk(aclk), .aresetn(aresetn), .s_req(rd_HDMA_arb), .m_req(m_rd_HDMA_host), .m_mux(m_mux_host_rd));
-    mmu_arbiter inst_hdma_arb_wr (.aclk(aclk), .aresetn(aresetn), .s_req(wr_HDMA_arb), .m_req(m_wr_HDMA_host), .m_mux(m_mux_host_wr));
+    mmu_arbiter inst_hdma_arb_rd (.aclk(aclk), .aresetn(aresetn), .s_req(rd_HDMA_arb), .m_req(m_rd_HDMA_host), .m_mux(m_mux_host_rd), .s_share(rd_hdma_share), .m_xfer(rd_hdma_xfer));
+    mmu_arbiter inst_hdma_arb_wr (.aclk(aclk), .aresetn(aresetn), .s_req(wr_HDMA_arb), .m_req(m_wr_HDMA_host), .m_mux(m_mux_host_wr), .s_share(wr_hdma_share), .m_xfer(wr_hdma_xfer));
 `endif
 
 `ifdef EN_MEM
@@ -273,6 +278,8 @@ for(genvar i = 0; i < N_REGIONS; i++) begin
     `ifdef EN_STRM
             .s_host_done_rd(rd_host_done[i]),
             .s_host_done_wr(wr_host_done[i]),
+            .m_hdma_share({wr_hdma_share[i], rd_hdma_share[i]}),
+            .s_hdma_xfer({wr_hdma_xfer[i], rd_hdma_xfer[i]}),
     `endif
     `ifdef EN_MEM
             .m_dma_offload(dma_offload[i]),
@@ -32,8 +32,18 @@ import lynxTypes::*;
  * @brief   RDMA retrans multiplexer
  * Used for split-up of the interfaces: 1 Interface towards the HLS stack, 2 interfaces exposed to the roce_stack 
  *
+ * With EN_FENCE, a retransmission of a buffer slot (vfid, pid, offs) is held until the write of that slot to the
+ * retrans buffer completed; see the retransmission fence below. Off by default (EN_RDMA_RETRANS_FENCE in the build).
+ *
+ * @param EN_FENCE      Enable the retransmission fence
+ * @param FENCE_DEPTH   Maximum number of in-flight retrans-buffer writes tracked; further writes wait for a free entry
+ * @param FENCE_TIMEOUT Cycles after which the oldest in-flight write is assumed to have landed, if its status is missing
  */
-module rdma_mux_retrans (
+module rdma_mux_retrans #(
+    parameter integer EN_FENCE = 0,
+    parameter integer FENCE_DEPTH = 32,
+    parameter integer FENCE_TIMEOUT = 65536
+) (
     input  logic            aclk,
     input  logic            aresetn,
     
@@ -45,6 +55,7 @@ module rdma_mux_retrans (
 
     metaIntf.m              m_req_ddr_rd, // Outgoing read commands to the roce_stack
     metaIntf.m              m_req_ddr_wr, // Outgoing write commands to the roce_stack
+    metaIntf.s              s_sts_ddr_wr, // Incoming write status (one per write command) from the roce_stack
     AXI4S.s                 s_axis_ddr, // Incoming data (mem_rd) from the roce_stack 
     AXI4S.m                 m_axis_ddr // Outgoing data (mem_wr) to the roce_stack 
 
@@ -69,6 +80,12 @@ logic actv_next;
 logic rd_snk;
 logic rd_next;
 
+// Retransmission fence: a retransmission may only read its slot once the write of the slot has landed; the reads and
+// the writes are independent data mover channels, so otherwise a packet replayed shortly after it was sent (e.g., on
+// a NAK for a burst of small writes) could be read before it was written, replaying the stale contents of its slot
+logic fence_rd_clear; // No in-flight write to the slot of the request at s_req_net
+logic fence_wr_free; // A free entry to track another write
+
 // Signals to connect to the queues that lead to the control signals toward the top-level module 
 metaIntf #(.STYPE(req_t)) req_user (.*);
 metaIntf #(.STYPE(logic[MEM_CMD_BITS-1:0])) req_ddr_rd (.*);
@@ -105,22 +122,22 @@ always_comb begin
         end
         else begin
             // case: WRITE (probably? But why do you need to request data for this? Shouldn't it be automatically delivered to the stack?)
-            seq_snk_valid = seq_snk_ready & req_ddr_wr.ready & s_req_net.valid;
+            seq_snk_valid = seq_snk_ready & req_ddr_wr.ready & s_req_net.valid & fence_wr_free;
             req_user.valid = 1'b0;
             req_ddr_rd.valid = 1'b0;
             req_ddr_wr.valid = seq_snk_valid;
 
-            s_req_net.ready = seq_snk_ready & req_ddr_wr.ready;
+            s_req_net.ready = seq_snk_ready & req_ddr_wr.ready & fence_wr_free;
         end
     end
     else begin
-        // Retrans - no active signal set in the s_req_net port, indicates a required retransmission
-        seq_snk_valid = seq_snk_ready & req_ddr_rd.ready & s_req_net.valid;
+        // Retrans - no active signal set in the s_req_net port, indicates a required retransmission; held until its slot is written
+        seq_snk_valid = seq_snk_ready & req_ddr_rd.ready & s_req_net.valid & fence_rd_clear;
         req_user.valid = 1'b0;
         req_ddr_rd.valid = seq_snk_valid;
         req_ddr_wr.valid = 1'b0;
 
-        s_req_net.ready = seq_snk_ready & req_ddr_rd.ready;
+        s_req_net.ready = seq_snk_ready & req_ddr_rd.ready & fence_rd_clear;
     end
 end
 
@@ -143,6 +160,74 @@ always_comb begin
     req_user.data = s_req_net.data;
 end
 
+// --------------------------------------------------------------------------------
+// Retransmission fence
+// --------------------------------------------------------------------------------
+assign s_sts_ddr_wr.ready = 1'b1;
+
+if(EN_FENCE) begin
+    // The slots of the in-flight writes, in issue order; the data mover reports one status per write command, in order, 
+    // which retires the oldest entry. Only retransmissions of a slot with an in-flight write are held, so a steady
+    // stream of writes to other slots doesn't hold them back. A missing status only holds the retransmissions of 
+    // that slot, and at most for FENCE_TIMEOUT cycles
+    localparam integer FENCE_BITS = $clog2(FENCE_DEPTH);
+    localparam integer SLOT_BITS = DEST_BITS + PID_BITS + OFFS_BITS;
+
+    logic [SLOT_BITS-1:0] fence_slot [FENCE_DEPTH];
+    logic [FENCE_DEPTH-1:0] fence_vld;
+    logic [FENCE_BITS-1:0] fence_head, fence_tail;
+    logic [$clog2(FENCE_TIMEOUT+1)-1:0] fence_age;
+    logic [SLOT_BITS-1:0] slot_snk;
+    logic fence_push, fence_pop;
+
+    assign slot_snk = {s_req_net.data.vfid, s_req_net.data.pid, s_req_net.data.offs};
+    assign fence_push = req_ddr_wr.valid & req_ddr_wr.ready;
+    assign fence_pop = fence_vld[fence_head] & (s_sts_ddr_wr.valid | (fence_age == FENCE_TIMEOUT));
+    assign fence_wr_free = ~fence_vld[fence_tail];
+
+    always_comb begin
+        fence_rd_clear = 1'b1;
+        for(int i = 0; i < FENCE_DEPTH; i++) begin
+            if(fence_vld[i] && fence_slot[i] == slot_snk) begin
+                fence_rd_clear = 1'b0;
+            end
+        end
+    end
+
+    always_ff @(posedge aclk) begin
+        if(aresetn == 1'b0) begin
+            fence_vld <= 0;
+            fence_head <= 0;
+            fence_tail <= 0;
+            fence_age <= 0;
+        end
+        else begin
+            if(fence_push) begin
+                fence_slot[fence_tail] <= slot_snk;
+                fence_tail <= (fence_tail == FENCE_DEPTH-1) ? 0 : fence_tail + 1;
+            end
+
+            if(fence_pop) begin
+                fence_head <= (fence_head == FENCE_DEPTH-1) ? 0 : fence_head + 1;
+            end
+
+            // The tail only reaches the head once all entries are in flight, so a push and a pop never hit the same entry
+            for(int i = 0; i < FENCE_DEPTH; i++) begin
+                if(fence_push && fence_tail == i) 
+                    fence_vld[i] <= 1'b1;
+                else if(fence_pop && fence_head == i) 
+                    fence_vld[i] <= 1'b0;
+            end
+
+            fence_age <= (fence_pop || !fence_vld[fence_head]) ? 0 : fence_age + 1;
+        end
+    end
+end
+else begin
+    assign fence_rd_clear = 1'b1;
+    assign fence_wr_free = 1'b1;
+end
+
 // Queue for requests with sink and source 
 queue_stream #(
     .QTYPE(logic [1+1+LEN_BITS-1:0]),
@@ -239,7 +239,15 @@ assign rdma_wr_req.data.host              = wr_cmd_data[32+RDMA_QPN_BITS+1+VADDR
 assign rdma_wr_req.data.offs              = wr_cmd_data[32+RDMA_QPN_BITS+1+VADDR_BITS+DEST_BITS+STRM_BITS+LEN_BITS+2+:OFFS_BITS];
 
 // Retransmission mux (buffering)
-rdma_mux_retrans inst_mux_retrans (
+`ifdef EN_RDMA_RETRANS_FENCE
+localparam integer RETRANS_FENCE = 1;
+`else
+localparam integer RETRANS_FENCE = 0;
+`endif
+
+rdma_mux_retrans #(
+  .EN_FENCE(RETRANS_FENCE)
+) inst_mux_retrans (
   .aclk(nclk),
   .aresetn(nresetn),
 
@@ -252,12 +260,12 @@ rdma_mux_retrans inst_mux_retrans (
   
   .m_req_ddr_rd(m_rdma_mem_rd_cmd),
   .m_req_ddr_wr(m_rdma_mem_wr_cmd),
+  .s_sts_ddr_wr(s_rdma_mem_wr_sts),
   .s_axis_ddr(s_axis_rdma_mem_rd),
   .m_axis_ddr(m_axis_rdma_mem_wr)
 );  
 
 assign s_rdma_mem_rd_sts.ready = 1'b1;
-assign s_rdma_mem_wr_sts.ready = 1'b1;
 
 assign m_rdma_wr_req.valid = rdma_wr_req.valid;
 assign m_rdma_wr_req.data = rdma_wr_req.data;
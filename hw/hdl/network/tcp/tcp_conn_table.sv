@@ -184,6 +184,7 @@ always_comb begin : DP
     m_open_rsp.data = 0;
     m_open_rsp.data.vfid = vfid_C;
     m_open_rsp.data.pid = pid_C;
+    m_open_rsp.data.dest = dest_C;
     m_open_rsp.data.success = 1'b0;
 
     rx_addr = 0;
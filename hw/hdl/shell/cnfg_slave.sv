@@ -47,6 +47,8 @@ module cnfg_slave #(
 `ifdef EN_STRM
     metaIntf.s                  s_host_done_rd,
     metaIntf.s                  s_host_done_wr,
+    output logic [63:0]         m_hdma_share,
+    input  logic [63:0]         s_hdma_xfer,
 `endif
     
     // Memory
@@ -240,10 +242,10 @@ logic [PID_BITS-1:0] rdma_clear_addr_wr;
 `endif
 
 `ifdef EN_TCP
-metaIntf #(.STYPE(tcp_listen_rsp_r_t) open_port_sts (.*);
-metaIntf #(.STYPE(tcp_open_rsp_r_t) open_port_sts (.*);
+metaIntf #(.STYPE(tcp_listen_rsp_r_t)) open_port_sts (.*);
+metaIntf #(.STYPE(tcp_open_rsp_r_t)) open_conn_sts (.*);
 
-logic [1:0] open_port_sts_response;
+logic [63:0] open_port_sts_response;
 logic [63:0] open_conn_sts_response;
 `endif
 
@@ -337,6 +339,14 @@ localparam integer SYNC_CARD_OFFS_REG                       = 30;
 // 41 (RO) : Status
 localparam integer SYNC_STAT_REG                            = 32;
 
+// HOST DMA
+// 42 (RW) : Bandwidth share, in MB/s; 0 is unlimited
+localparam integer HDMA_SHARE_REG                           = 33;
+    localparam integer HDMA_RD_OFFS             = 0;
+    localparam integer HDMA_WR_OFFS             = 32;
+// 43 (RO) : Bytes transferred in the last ms
+localparam integer HDMA_XFER_REG                            = 34;
+
 // NETWORK
 // 48 (W1S) : ARP lookup
 localparam integer NET_ARP_REG                              = 36;
@@ -374,6 +384,7 @@ always_ff @(posedge aclk) begin
         slv_reg[ISR_REG][7:0] <= 0;
         slv_reg[OFFL_CTRL_REG][31:0] <= 0;
         slv_reg[SYNC_CTRL_REG][31:0] <= 0;
+        slv_reg[HDMA_SHARE_REG] <= 0;
 
         local_post <= 1'b0;
         remote_post <= 1'b0;
@@ -695,6 +706,15 @@ always_ff @(posedge aclk) begin
                     end
 `endif
 
+`ifdef EN_STRM
+                HDMA_SHARE_REG: // Host DMA share
+                    for (int i = 0; i < AXIL_DATA_BITS/8; i++) begin
+                        if(s_axi_ctrl.wstrb[i]) begin
+                            slv_reg[HDMA_SHARE_REG][(i*8)+:8] <= s_axi_ctrl.wdata[(i*8)+:8];
+                        end
+                    end
+`endif
+
 `ifdef EN_NET
                 NET_ARP_REG: // ARP lookup
                     for (int i = 0; i < 4; i++) begin
@@ -751,7 +771,7 @@ always_ff @(posedge aclk) begin
                 TCP_OPEN_PORT_REG: // Open port command
                     for (int i = 0; i < AXIL_DATA_BITS/8; i++) begin
                         if(s_axi_ctrl.wstrb[i]) begin
-                            slv_reg[TCP_OPEN_PORT_CMD_REG][(i*8)+:8] <= s_axi_ctrl.wdata[(i*8)+:8];
+                            slv_reg[TCP_OPEN_PORT_REG][(i*8)+:8] <= s_axi_ctrl.wdata[(i*8)+:8];
                             m_open_port_cmd.valid <= 1'b1;
                         end
                     end
@@ -762,11 +782,11 @@ always_ff @(posedge aclk) begin
                 TCP_OPEN_CONN_REG: // Open conn command
                     for (int i = 0; i < AXIL_DATA_BITS/8; i++) begin
                         if(s_axi_ctrl.wstrb[i]) begin
-                            slv_reg[TCP_OPEN_CONN_CMD_REG][(i*8)+:8] <= s_axi_ctrl.wdata[(i*8)+:8];
+                            slv_reg[TCP_OPEN_CONN_REG][(i*8)+:8] <= s_axi_ctrl.wdata[(i*8)+:8];
                             m_open_conn_cmd.valid <= 1'b1;
                         end
                     end
-                TCP_OPEN_CONN_STAT_REG: // Open port status
+                TCP_OPEN_CONN_STAT_REG: // Open conn status
                     if(s_axi_ctrl.wstrb[0]) begin
                         open_conn_sts.ready <= s_axi_ctrl.wdata[0];
                     end
@@ -870,6 +890,13 @@ always_ff @(posedge aclk) begin
             axi_rdata[PADDR_BITS-1:0] <= slv_reg[SYNC_HOST_OFFS_REG][PADDR_BITS-1:0];
 `endif
 
+`ifdef EN_STRM
+        HDMA_SHARE_REG:
+            axi_rdata <= slv_reg[HDMA_SHARE_REG];
+        HDMA_XFER_REG:
+            axi_rdata <= s_hdma_xfer;
+`endif
+
 `ifdef EN_NET
         NET_ARP_REG:
             axi_rdata[0] <= m_arp_lookup_request.ready;
@@ -900,7 +927,7 @@ always_ff @(posedge aclk) begin
         TCP_OPEN_CONN_REG: 
             axi_rdata[0] <= m_open_conn_cmd.ready;
         TCP_OPEN_CONN_STAT_REG:
-            axi_rdata[1:0] <= open_port_sts_response[1:0];
+            axi_rdata[63:0] <= open_conn_sts_response;
 `endif 
 
 
@@ -1212,6 +1239,11 @@ assign host_req.data.req_2.rsrvd        = 0;
 
 assign host_req.valid = local_post || remote_post;
 
+`ifdef EN_STRM
+// Host DMA share, enforced in the host DMA arbiter
+assign m_hdma_share = slv_reg[HDMA_SHARE_REG];
+`endif
+
 // Command queues
 axis_data_fifo_req_256_used inst_cmd_queue (
   .s_axis_aresetn(aresetn),
@@ -1403,21 +1435,22 @@ assign m_open_conn_cmd.data.dest = slv_reg[TCP_OPEN_CONN_REG][48+PID_BITS+:DEST_
 assign m_open_conn_cmd.data.close = slv_reg[TCP_OPEN_CONN_REG][48+PID_BITS+DEST_BITS+:1];
 
 // Open sts
-metaIntf #(.STYPE(tcp_listen_rsp_r_t)) open_port_sts (.*);
-metaIntf #(.STYPE(tcp_open_rsp_r_t)) open_conn_sts (.*);
-
 queue_meta #(.QDEPTH(16)) inst_open_port_q (.aclk(aclk), .aresetn(aresetn), .s_meta(s_open_port_sts), .m_meta(open_port_sts));
 queue_meta #(.QDEPTH(16)) inst_open_conn_q (.aclk(aclk), .aresetn(aresetn), .s_meta(s_open_conn_sts), .m_meta(open_conn_sts));
 
 always_comb begin
-    open_port_sts_response[0] = open_port_sts.data.open_port_success;
+    open_port_sts_response = 0;
+    open_port_sts_response[0] = open_port_sts.data.open_port_success[0];
     open_port_sts_response[1] = open_port_sts.valid;
 end
 
+// The pid and dest identify the session the response belongs to
 always_comb begin
-    open_conn_sts_response[0] = open_conn_sts.data.success;
+    open_conn_sts_response = 0;
+    open_conn_sts_response[0] = open_conn_sts.data.success[0];
     open_conn_sts_response[1] = open_conn_sts.valid;
     open_conn_sts_response[16+:PID_BITS] = open_conn_sts.data.pid;
+    open_conn_sts_response[16+PID_BITS+:DEST_BITS] = open_conn_sts.data.dest;
 end
 
 `endif
@@ -47,6 +47,8 @@ module cnfg_slave_avx #(
 `ifdef EN_STRM
     metaIntf.s                  s_host_done_rd,
     metaIntf.s                  s_host_done_wr,
+    output logic [63:0]         m_hdma_share,
+    input  logic [63:0]         s_hdma_xfer,
 `endif
     
     // Memory
@@ -255,10 +257,10 @@ logic [PID_BITS-1:0] rdma_clear_addr_wr;
 `endif
 
 `ifdef EN_TCP
-metaIntf #(.STYPE(tcp_listen_rsp_r_t) open_port_sts (.*);
-metaIntf #(.STYPE(tcp_open_rsp_r_t) open_port_sts (.*);
+metaIntf #(.STYPE(tcp_listen_rsp_r_t)) open_port_sts (.*);
+metaIntf #(.STYPE(tcp_open_rsp_r_t)) open_conn_sts (.*);
 
-logic [1:0] open_port_sts_response;
+logic [63:0] open_port_sts_response;
 logic [63:0] open_conn_sts_response;
 `endif
 
@@ -347,6 +349,9 @@ localparam integer OFFL_STAT_REG                            = 6;
 localparam integer SYNC_CTRL_REG                            = 7;
 // 35 (RO) : Status
 localparam integer SYNC_STAT_REG                            = 8;
+    // Host DMA
+    localparam integer HDMA_SHARE_OFFS          = 64;  // (RW) Bandwidth share, in MB/s; 0 is unlimited
+    localparam integer HDMA_XFER_OFFS           = 128; // (RO) Bytes transferred in the last ms
 
 // NETWORK
 // 48 (W1S) : ARP lookup
@@ -380,6 +385,7 @@ always_ff @(posedge aclk) begin
         slv_reg[ISR_REG][7:0] <= 0;
         slv_reg[OFFL_CTRL_REG][31:0] <= 0;
         slv_reg[SYNC_CTRL_REG][31:0] <= 0;
+        slv_reg[SYNC_STAT_REG][HDMA_SHARE_OFFS+:64] <= 0;
 
         local_post <= 1'b0;
         remote_post <= 1'b0;
@@ -626,6 +632,15 @@ always_ff @(posedge aclk) begin
                     end
 `endif
 
+`ifdef EN_STRM
+                SYNC_STAT_REG: // Host DMA share
+                    for (int i = HDMA_SHARE_OFFS/8; i < HDMA_SHARE_OFFS/8 + 8; i++) begin
+                        if(s_axim_ctrl.wstrb[i]) begin
+                            slv_reg[SYNC_STAT_REG][(i*8)+:8] <= s_axim_ctrl.wdata[(i*8)+:8];
+                        end
+                    end
+`endif
+
 `ifdef EN_NET
                 NET_ARP_REG: // ARP lookup
                     for (int i = 0; i < 4; i++) begin
@@ -658,22 +673,22 @@ always_ff @(posedge aclk) begin
                 TCP_OPEN_PORT_REG: // Open port command
                     for (int i = 0; i < AVX_DATA_BITS/8; i++) begin
                         if(s_axim_ctrl.wstrb[i]) begin
-                            slv_reg[TCP_OPEN_PORT_CMD_REG][(i*8)+:8] <= s_axim_ctrl.wdata[(i*8)+:8];
+                            slv_reg[TCP_OPEN_PORT_REG][(i*8)+:8] <= s_axim_ctrl.wdata[(i*8)+:8];
                             m_open_port_cmd.valid <= 1'b1;
                         end
                     end
                 TCP_OPEN_PORT_STAT_REG: // Open port status
-                    if(s_axim__ctrl.wstrb[0]) begin
-                        open_port_sts.ready <= s_axim__ctrl.wdata[0];
+                    if(s_axim_ctrl.wstrb[0]) begin
+                        open_port_sts.ready <= s_axim_ctrl.wdata[0];
                     end
                 TCP_OPEN_CONN_REG: // Open conn command
                     for (int i = 0; i < AVX_DATA_BITS/8; i++) begin
                         if(s_axim_ctrl.wstrb[i]) begin
-                            slv_reg[TCP_OPEN_CONN_CMD_REG][(i*8)+:8] <= s_axim_ctrl.wdata[(i*8)+:8];
+                            slv_reg[TCP_OPEN_CONN_REG][(i*8)+:8] <= s_axim_ctrl.wdata[(i*8)+:8];
                             m_open_conn_cmd.valid <= 1'b1;
                         end
                     end
-                TCP_OPEN_CONN_STAT_REG: // Open port status
+                TCP_OPEN_CONN_STAT_REG: // Open conn status
                     if(s_axim_ctrl.wstrb[0]) begin
                         open_conn_sts.ready <= s_axim_ctrl.wdata[0];
                     end
@@ -739,9 +754,16 @@ always_ff @(posedge aclk) begin
             axi_rdata <= slv_reg[OFFL_STAT_REG];
         [SYNC_CTRL_REG:SYNC_CTRL_REG]:
             axi_rdata[31:0] <= offload_queue_used[31:0];
-        [SYNC_STAT_REG:SYNC_STAT_REG]:
+`endif
+        [SYNC_STAT_REG:SYNC_STAT_REG]: begin
+`ifdef EN_MEM
             axi_rdata <= slv_reg[OFFL_STAT_REG];
 `endif
+`ifdef EN_STRM
+            axi_rdata[HDMA_SHARE_OFFS+:64] <= slv_reg[SYNC_STAT_REG][HDMA_SHARE_OFFS+:64];
+            axi_rdata[HDMA_XFER_OFFS+:64] <= s_hdma_xfer;
+`endif
+        end
 
 `ifdef EN_NET
         [NET_ARP_REG:NET_ARP_REG]:
@@ -763,7 +785,7 @@ always_ff @(posedge aclk) begin
         [TCP_OPEN_CONN_REG:TCP_OPEN_CONN_REG]:
             axi_rdata[0] <= m_open_conn_cmd.ready;
         [TCP_OPEN_CONN_STAT_REG:TCP_OPEN_CONN_STAT_REG]:
-            axi_rdata[1:0] <= open_port_sts_response[1:0];
+            axi_rdata[63:0] <= open_conn_sts_response;
 `endif 
 
 
@@ -1072,6 +1094,11 @@ assign host_req.data.req_2.rsrvd        = 0;
 
 assign host_req.valid = local_post || remote_post;
 
+`ifdef EN_STRM
+// Host DMA share, enforced in the host DMA arbiter
+assign m_hdma_share = slv_reg[SYNC_STAT_REG][HDMA_SHARE_OFFS+:64];
+`endif
+
 // Command queues
 axis_data_fifo_req_256_used inst_cmd_queue (
   .s_axis_aresetn(aresetn),
@@ -1262,21 +1289,22 @@ assign m_open_conn_cmd.data.dest = slv_reg[TCP_OPEN_CONN_REG][48+PID_BITS+:DEST_
 assign m_open_conn_cmd.data.close = slv_reg[TCP_OPEN_CONN_REG][48+PID_BITS+DEST_BITS+:1];
 
 // Open sts
-metaIntf #(.STYPE(tcp_listen_rsp_r_t)) open_port_sts (.*);
-metaIntf #(.STYPE(tcp_open_rsp_r_t)) open_conn_sts (.*);
-
 queue_meta #(.QDEPTH(16)) inst_open_port_q (.aclk(aclk), .aresetn(aresetn), .s_meta(s_open_port_sts), .m_meta(open_port_sts));
 queue_meta #(.QDEPTH(16)) inst_open_conn_q (.aclk(aclk), .aresetn(aresetn), .s_meta(s_open_conn_sts), .m_meta(open_conn_sts));
 
 always_comb begin
-    open_port_sts_response[0] = open_port_sts.data.open_port_success;
+    open_port_sts_response = 0;
+    open_port_sts_response[0] = open_port_sts.data.open_port_success[0];
     open_port_sts_response[1] = open_port_sts.valid;
 end
 
+// The pid and dest identify the session the response belongs to
 always_comb begin
-    open_conn_sts_response[0] = open_conn_sts.data.success;
+    open_conn_sts_response = 0;
+    open_conn_sts_response[0] = open_conn_sts.data.success[0];
     open_conn_sts_response[1] = open_conn_sts.valid;
     open_conn_sts_response[16+:PID_BITS] = open_conn_sts.data.pid;
+    open_conn_sts_response[16+PID_BITS+:DEST_BITS] = open_conn_sts.data.dest;
 end
 
 `endif
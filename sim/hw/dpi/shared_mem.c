@@ -0,0 +1,103 @@
+/**
+ * This file is part of the Coyote <https://github.com/fpgasystems/Coyote>
+ *
+ * MIT Licence
+ * Copyright (c) 2025, Systems Group, ETH Zurich
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "svdpi.h"
+
+/**
+ * Staging area shared with the simulation cThread (see BinaryInputWriter), through which the data of MEM_WRITE_SHM operations is passed.
+ * The first SHARED_MEM_HEADER_SIZE bytes hold the position up to which the test bench consumed the data; the rest is a ring of data. 
+ */
+#define SHARED_MEM_HEADER_SIZE 64
+
+static unsigned char *shared_mem = NULL;
+static uint64_t shared_mem_size = 0;
+
+/**
+ * Memory maps the shared staging file at the provided path.
+ * Returns 0 on success and -1 if the file could not be opened or mapped.
+ */
+int open_shared_mem(const char* path) {
+    int fd = open(path, O_RDWR);
+    if (fd == -1) {
+        perror("Error opening shared memory file");
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= SHARED_MEM_HEADER_SIZE) {
+        perror("Shared memory file has no data region");
+        close(fd);
+        return -1;
+    }
+
+    void *addr = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) {
+        perror("Error mapping shared memory file");
+        return -1;
+    }
+
+    shared_mem = (unsigned char *) addr;
+    shared_mem_size = st.st_size;
+    return 0;
+}
+
+/**
+ * Copies size bytes, written by the software at position pos of the ring, into data (which must hold at least size bytes)
+ * and marks them as consumed, so that the software can reuse the space.
+ */
+void read_shared_mem(long long pos, long long size, const svOpenArrayHandle data) {
+    uint64_t cap = shared_mem_size - SHARED_MEM_HEADER_SIZE;
+    const unsigned char *src = shared_mem + SHARED_MEM_HEADER_SIZE + ((uint64_t) pos % cap);
+
+    unsigned char *dst = (unsigned char *) svGetArrayPtr(data);
+    if (dst) {
+        memcpy(dst, src, size);
+    } else {
+        for (long long i = 0; i < size; i++) {
+            *((unsigned char *) svGetArrElemPtr1(data, i)) = src[i];
+        }
+    }
+
+    __atomic_store_n((uint64_t *) shared_mem, (uint64_t) (pos + size), __ATOMIC_RELEASE);
+}
+
+/**
+ * Unmaps the shared staging file mapped with 'open_shared_mem'
+ */
+void close_shared_mem() {
+    if (shared_mem) {
+        munmap(shared_mem, shared_mem_size);
+        shared_mem = NULL;
+    }
+}
@@ -0,0 +1,127 @@
+/**
+ * This file is part of the Coyote <https://github.com/fpgasystems/Coyote>
+ *
+ * MIT Licence
+ * Copyright (c) 2025, Systems Group, ETH Zurich
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+`timescale 1ns / 1ps
+
+/**
+ * @brief   Behavioral models of the AXI4S data FIFO IP cores used by the network stack
+ *
+ * Stand-ins for the Vivado-generated axis_data_fifo_* cores, so that single network modules can be simulated
+ * on their own (e.g., with Verilator, see tb_rdma_mux_retrans). Not timing-accurate; only for simulation.
+ */
+module axis_fifo_model #(
+    parameter integer DATA_BITS = 64,
+    parameter integer DEPTH = 16
+) (
+    input  logic                    aclk,
+    input  logic                    aresetn,
+
+    input  logic                    s_tvalid,
+    output logic                    s_tready,
+    input  logic [DATA_BITS-1:0]    s_tdata,
+
+    output logic                    m_tvalid,
+    input  logic                    m_tready,
+    output logic [DATA_BITS-1:0]    m_tdata
+);
+
+logic [DATA_BITS-1:0] mem [DEPTH];
+logic [$clog2(DEPTH)-1:0] rd_pntr, wr_pntr;
+logic [$clog2(DEPTH):0] n_entries;
+
+assign s_tready = aresetn && (n_entries < DEPTH);
+assign m_tvalid = (n_entries != 0);
+assign m_tdata = mem[rd_pntr];
+
+always_ff @(posedge aclk) begin
+    if(aresetn == 1'b0) begin
+        rd_pntr <= 0;
+        wr_pntr <= 0;
+        n_entries <= 0;
+    end
+    else begin
+        if(s_tvalid && s_tready) begin
+            mem[wr_pntr] <= s_tdata;
+            wr_pntr <= wr_pntr + 1;
+        end
+        if(m_tvalid && m_tready) begin
+            rd_pntr <= rd_pntr + 1;
+        end
+        n_entries <= n_entries + (s_tvalid && s_tready) - (m_tvalid && m_tready);
+    end
+end
+
+endmodule
+
+module axis_data_fifo_512 (
+    input  logic            s_axis_aresetn,
+    input  logic            s_axis_aclk,
+    input  logic            s_axis_tvalid,
+    output logic            s_axis_tready,
+    input  logic [511:0]    s_axis_tdata,
+    input  logic [63:0]     s_axis_tkeep,
+    input  logic            s_axis_tlast,
+    output logic            m_axis_tvalid,
+    input  logic            m_axis_tready,
+    output logic [511:0]    m_axis_tdata,
+    output logic [63:0]     m_axis_tkeep,
+    output logic            m_axis_tlast
+);
+
+axis_fifo_model #(.DATA_BITS(512+64+1)) inst_fifo (
+    .aclk(s_axis_aclk), .aresetn(s_axis_aresetn),
+    .s_tvalid(s_axis_tvalid), .s_tready(s_axis_tready), .s_tdata({s_axis_tlast, s_axis_tkeep, s_axis_tdata}),
+    .m_tvalid(m_axis_tvalid), .m_tready(m_axis_tready), .m_tdata({m_axis_tlast, m_axis_tkeep, m_axis_tdata})
+);
+
+endmodule
+
+`define AXIS_DATA_FIFO_META_MODEL(BITS) \
+module axis_data_fifo_meta_``BITS ( \
+    input  logic            s_axis_aresetn, \
+    input  logic            s_axis_aclk, \
+    input  logic            s_axis_tvalid, \
+    output logic            s_axis_tready, \
+    input  logic [BITS-1:0] s_axis_tdata, \
+    output logic            m_axis_tvalid, \
+    input  logic            m_axis_tready, \
+    output logic [BITS-1:0] m_axis_tdata \
+); \
+axis_fifo_model #(.DATA_BITS(BITS)) inst_fifo ( \
+    .aclk(s_axis_aclk), .aresetn(s_axis_aresetn), \
+    .s_tvalid(s_axis_tvalid), .s_tready(s_axis_tready), .s_tdata(s_axis_tdata), \
+    .m_tvalid(m_axis_tvalid), .m_tready(m_axis_tready), .m_tdata(m_axis_tdata) \
+); \
+endmodule
+
+`AXIS_DATA_FIFO_META_MODEL(8)
+`AXIS_DATA_FIFO_META_MODEL(16)
+`AXIS_DATA_FIFO_META_MODEL(32)
+`AXIS_DATA_FIFO_META_MODEL(64)
+`AXIS_DATA_FIFO_META_MODEL(96)
+`AXIS_DATA_FIFO_META_MODEL(128)
+`AXIS_DATA_FIFO_META_MODEL(256)
+`AXIS_DATA_FIFO_META_MODEL(512)
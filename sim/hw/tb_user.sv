@@ -49,6 +49,7 @@ module tb_user;
     string path_name;
     string input_file_name;
     string output_file_name;
+    string shm_file_name;
 
     // Clock generation
     always #(CLK_PERIOD/2) aclk = ~aclk;
@@ -272,6 +273,7 @@ module tb_user;
 
         input_file_name = {path_name, "input.bin"};
         output_file_name = {path_name, "output.bin"};
+        shm_file_name = {path_name, "input.shm"};
 
         // Scoreboard
         scb = new(output_file_name);
@@ -358,6 +360,7 @@ module tb_user;
             ctrl_mbx,
             ctrl_sim.polling_done,
             input_file_name,
+            shm_file_name,
             mem_sim,
             scb
         );
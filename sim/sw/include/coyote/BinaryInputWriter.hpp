@@ -28,7 +28,12 @@
 #define _COYOTE_BINARY_INPUT_WRITER_HPP_
 
 #include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <cstring>
 #include <mutex>
+#include <thread>
 
 #include <coyote/Common.hpp>
 
@@ -37,8 +42,15 @@ namespace coyote {
 /**
  * This class handles the outgoing communication from the software towards the Vivado simulation. 
  * It writes the binary protocol specified in the sim/README.md for all operations that need communication in that direction to a named pipe that the simulation reads from.
+ * In batched mode, operations are accumulated in a user-space buffer, which is only flushed to the pipe on operations the caller waits on 
+ * (GET_CSR, CHECK_COMPLETED, SLEEP), on memory sent in response to a HOST_READ of the simulation, or when the buffer is full.
+ * If a shared staging file is opened (openShm), the data of memory writes is copied into it rather than through the pipe (MEM_WRITE_SHM); 
+ * the file starts with a header holding the position up to which the test bench consumed the data, followed by a ring of data.
+ * If a recording is opened (openRecord), all operations are also written to a file, which coyote_sim_replay feeds to the test bench 
+ * again later on, without the software; see sim/README.md.
  */
 class BinaryInputWriter {
+public:
     enum InputOperations {
         SET_CSR,         // cThread.setCSR
         GET_CSR,         // cThread.getCSR
@@ -48,9 +60,15 @@ class BinaryInputWriter {
         SLEEP,           // Sleep for a certain duration before processing the next command
         CHECK_COMPLETED, // Return how many requests have been completed for a given CoyoteOper
         CLEAR_COMPLETED, // Clear completed counters
-        USER_UNMAP       // cThread.userUnmap
+        USER_UNMAP,      // cThread.userUnmap
+        MEM_WRITE_SHM = 12, // Memory writes mem[i] = ..., with the data in the shared staging file
+        SET_TIMING,         // Enable or disable the timing reports of completed requests
+        RECORDED_HOST_READ  // Only in recordings: memory sent in response to a HOST_READ of the simulation, see openRecord()
     };
 
+    /// Magic number at the start of a recording
+    static constexpr char RECORD_MAGIC[8] = {'C', 'Y', 'T', 'S', 'I', 'M', 'R', '1'};
+
     typedef struct __attribute__((packed)) {
         uint64_t addr;
         uint64_t data;
@@ -67,6 +85,12 @@ class BinaryInputWriter {
         uint64_t size;
     } vaddr_size_t;
 
+    typedef struct __attribute__((packed)) {
+        uint64_t vaddr;
+        uint64_t size;
+        uint64_t pos;
+    } vaddr_size_pos_t;
+
     typedef struct __attribute__((packed)) {
         uint8_t opcode;
         uint8_t strm;
@@ -82,35 +106,129 @@ class BinaryInputWriter {
         uint8_t do_polling;
     } check_completed_t;
 
+private:
     std::mutex write_mtx;
 
-    void writeData(uint8_t op_type, uint64_t size, void *ptr) {
+    // Writes an operation; unless batched, every operation is flushed, otherwise only the ones that are waited on (blocking)
+    void writeData(uint8_t op_type, uint64_t size, void *ptr, bool blocking = false) {
         std::lock_guard<std::mutex> lock(write_mtx);
         fwrite(&op_type, 1, 1, fp);
         if (size > 0) fwrite(ptr, size, 1, fp);
-        fflush(fp);
+        if (!batched || blocking) fflush(fp);
+        record(op_type, size, ptr);
+    }
+
+    // Writes an operation to the recording, if any; must be called with write_mtx held
+    void record(uint8_t op_type, uint64_t size, const void *ptr, uint64_t data_size = 0, const void *data = nullptr) {
+        if (!rec) return;
+        fwrite(&op_type, 1, 1, rec);
+        if (size > 0) fwrite(ptr, size, 1, rec);
+        if (data_size > 0) fwrite(data, data_size, 1, rec);
     }
 
     FILE *fp;
+    FILE *rec = nullptr;
+
+    bool batched = false;
+
+    // Shared staging file; pos is a free-running position in the ring, the test bench stores its own in the header once consumed
+    uint8_t *shm = nullptr;
+    uint64_t shm_size = 0;
+    uint64_t shm_pos = 0;
+
+    uint64_t shmConsumed() {
+        return __atomic_load_n(reinterpret_cast<uint64_t *>(shm), __ATOMIC_ACQUIRE);
+    }
 
 public:
+    /// Size of the user-space buffer in batched mode
+    static constexpr size_t BATCH_BUFFER_SIZE = 1 << 20;
+
+    /// Size of the shared staging file and of its header; must match SHARED_MEM_HEADER_SIZE in sim/hw/dpi/shared_mem.c
+    static constexpr size_t SHM_SIZE = 256 << 20;
+    static constexpr size_t SHM_HEADER_SIZE = 64;
+
     BinaryInputWriter() {}
 
     ~BinaryInputWriter() {}
 
-    int open(const char *file_name) {
+    int open(const char *file_name, bool batched = false) {
         fp = fopen(file_name, "wb");
         if (fp == NULL) {
             ERROR("Unable to open named pipe")
             return -1;
         }
-        DEBUG("Opened named pipe successfully")
+
+        // stdio then only writes to the pipe once the buffer is full or flushed explicitly
+        this->batched = batched;
+        if (batched && setvbuf(fp, NULL, _IOFBF, BATCH_BUFFER_SIZE) != 0) {
+            WARNING("Unable to set the buffer for batched mode, operations will be flushed individually")
+            this->batched = false;
+        }
+        DEBUG("Opened named pipe successfully, batched " << this->batched)
+        return 0;
+    }
+
+    /**
+     * Records all the following operations to a file; memory writes are recorded with their data, also when it is passed 
+     * through the shared staging file, so that the recording can be replayed on its own (see coyote_sim_replay)
+     */
+    int openRecord(const char *file_name) {
+        rec = fopen(file_name, "wb");
+        if (rec == NULL) {
+            ERROR("Unable to open recording " << file_name)
+            return -1;
+        }
+        fwrite(RECORD_MAGIC, sizeof(RECORD_MAGIC), 1, rec);
+        DEBUG("Recording to " << file_name)
+        return 0;
+    }
+
+    /// Creates and maps the shared staging file; must be called before open(...), since the test bench maps it once the input pipe is opened
+    int openShm(const char *file_name) {
+        int fd = ::open(file_name, O_RDWR | O_CREAT | O_TRUNC, 0666);
+        if (fd < 0) {
+            WARNING("Unable to create shared memory file, memory writes go through the named pipe")
+            return -1;
+        }
+
+        // The file is sparse, so only the part of the ring in use takes up memory
+        void *addr = MAP_FAILED;
+        if (ftruncate(fd, SHM_SIZE) == 0) {
+            addr = mmap(NULL, SHM_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        }
+        ::close(fd);
+        if (addr == MAP_FAILED) {
+            WARNING("Unable to map shared memory file, memory writes go through the named pipe")
+            return -1;
+        }
+
+        shm = reinterpret_cast<uint8_t *>(addr);
+        shm_size = SHM_SIZE;
+        shm_pos = 0;
+        DEBUG("Mapped shared memory file successfully")
         return 0;
     }
 
+    /// Writes all the buffered operations to the simulation
+    void flush() {
+        std::lock_guard<std::mutex> lock(write_mtx);
+        fflush(fp);
+    }
+
     void close() {
         fclose(fp);
         DEBUG("Closed named pipe")
+
+        if (rec) {
+            fclose(rec);
+            rec = nullptr;
+        }
+
+        if (shm) {
+            munmap(shm, shm_size);
+            shm = nullptr;
+        }
     }
 
     void setCSR(uint32_t addr, uint64_t data) {
@@ -121,7 +239,7 @@ public:
 
     void getCSR(uint32_t addr) {
         get_csr_op_t ctrl_op = {addr * 8, 0, 0};
-        writeData(GET_CSR, sizeof(get_csr_op_t), &ctrl_op);
+        writeData(GET_CSR, sizeof(get_csr_op_t), &ctrl_op, true);
         DEBUG("Wrote getCSR(" << addr << ")")
     }
 
@@ -137,15 +255,51 @@ public:
         DEBUG("Wrote userUnmap(" << vaddr << ")")
     }
 
-    void writeMem(uint64_t vaddr, uint64_t size, void *ptr) {
+    // The memory sent in response to a HOST_READ is waited on by the simulation, hence blocking
+    void writeMem(uint64_t vaddr, uint64_t size, void *ptr, bool blocking = false) {
         uint8_t op_type = MEM_WRITE;
         vaddr_size_t vs = {vaddr, size};
         {
-            std::lock_guard<std::mutex> lock(write_mtx);
+            std::unique_lock<std::mutex> lock(write_mtx);
+
+            // Responses to HOST_READs are recorded apart, the replay sends them once the simulation asks for them again
+            uint8_t rec_op_type = blocking ? RECORDED_HOST_READ : MEM_WRITE;
+
+            // Through the shared staging file, if the data fits in the ring without wrapping around
+            uint64_t cap = shm_size - SHM_HEADER_SIZE;
+            while (shm && size > 0 && size <= cap) {
+                uint64_t pos = (shm_pos % cap + size > cap) ? shm_pos + (cap - shm_pos % cap) : shm_pos;
+                if (pos + size - shmConsumed() <= cap) {
+                    std::memcpy(shm + SHM_HEADER_SIZE + pos % cap, ptr, size);
+                    shm_pos = pos + size;
+
+                    op_type = MEM_WRITE_SHM;
+                    vaddr_size_pos_t vsp = {vaddr, size, pos};
+                    fwrite(&op_type, 1, 1, fp);
+                    fwrite(&vsp, sizeof(vaddr_size_pos_t), 1, fp);
+                    if (!batched || blocking) fflush(fp);
+                    record(rec_op_type, sizeof(vaddr_size_t), &vs, size, ptr);
+                    DEBUG("Wrote writeMem(" << vaddr << ", " << size << ", ...) through shared memory")
+                    return;
+                }
+
+                // The simulation may wait on a blocking write, so it can't wait for the ring to drain
+                if (blocking) {
+                    break;
+                }
+
+                // Until the test bench consumes enough of the ring; it may need the buffered operations to get there
+                fflush(fp);
+                lock.unlock();
+                std::this_thread::yield();
+                lock.lock();
+            }
+
             fwrite(&op_type, 1, 1, fp);
             fwrite(&vs, sizeof(vaddr_size_t), 1, fp);
             fwrite(ptr, size, 1, fp);
-            fflush(fp);
+            if (!batched || blocking) fflush(fp);
+            record(rec_op_type, sizeof(vaddr_size_t), &vs, size, ptr);
         }
         DEBUG("Wrote writeMem(" << vaddr << ", " << size << ", ...)")
     }
@@ -157,13 +311,13 @@ public:
     }
 
     void sleep(uint64_t duration) {
-        writeData(SLEEP, sizeof(uint64_t), &duration);
+        writeData(SLEEP, sizeof(uint64_t), &duration, true);
         DEBUG("Wrote sleep(" << duration << ")")
     }
 
     void checkCompleted(uint8_t opcode, uint64_t count, uint8_t do_polling) {
         check_completed_t cc = {opcode, count, do_polling};
-        writeData(CHECK_COMPLETED, sizeof(check_completed_t), &cc);
+        writeData(CHECK_COMPLETED, sizeof(check_completed_t), &cc, true);
         DEBUG("Wrote checkCompleted(" << (int) opcode << ", " << count << ", " << (int) do_polling << ")")
     }
 
@@ -171,6 +325,12 @@ public:
         writeData(CLEAR_COMPLETED, 0, nullptr);
         DEBUG("Wrote clearCompleted()")
     }
+
+    void setTiming(bool enable) {
+        uint8_t data = enable;
+        writeData(SET_TIMING, sizeof(data), &data);
+        DEBUG("Wrote setTiming(" << enable << ")")
+    }
 };
 
 }
@@ -29,11 +29,14 @@
 
 #include <stdio.h>
 #include <functional>
-#include <unordered_map>
+#include <mutex>
+#include <vector>
 
 #include <coyote/cOps.hpp>
 #include <coyote/Common.hpp>
 #include <coyote/BlockingQueue.hpp>
+#include <coyote/SpscQueue.hpp>
+#include <coyote/SimTlb.hpp>
 
 namespace coyote {
 
@@ -43,7 +46,7 @@ namespace coyote {
  * communication in that direction from a named pipe that the simulation writes to.
  */
 class BinaryOutputReader {
-private:
+public:
     typedef struct __attribute__((packed)) {
         uint64_t vaddr;
         uint64_t size;
@@ -54,22 +57,43 @@ private:
         uint32_t value;
     } irq_t;
 
+    typedef struct __attribute__((packed)) {
+        uint8_t  opcode;
+        uint8_t  rd;
+        uint8_t  strm;
+        uint8_t  dest;
+        uint64_t vaddr;
+        uint64_t len;
+        uint64_t issue;
+        uint64_t first;
+        uint64_t last;
+        uint64_t completion;
+    } timing_t;
+
     enum OutputOperations {
         GET_CSR,         // Result of cThread.getCSR()
         HOST_WRITE,      // Host write through axis_host_send
         IRQ,             // Interrupt through notify interface
         CHECK_COMPLETED, // Result of cThread.checkCompleted()
-        HOST_READ        // Host read through sq_rd
+        HOST_READ,       // Host read through sq_rd
+        TIMING           // Timing of a completed request, if enabled with BinaryInputWriter.setTiming()
     };
 
-    size_t op_type_size[5] = {sizeof(uint64_t), sizeof(vaddr_size_t), sizeof(irq_t), sizeof(uint32_t), sizeof(vaddr_size_t)};
+    static constexpr size_t op_type_size[6] = {sizeof(uint64_t), sizeof(vaddr_size_t), sizeof(irq_t), sizeof(uint32_t), sizeof(vaddr_size_t), sizeof(timing_t)};
+
+private:
+    std::mutex timings_mtx;
+    std::vector<simReqTiming> timings;
 
-    std::unordered_map<void *, uint32_t> *tlb_pages;
+    SimTlb *tlb;
 
     FILE *fp;
 
-    BlockingQueue<uint64_t> csr_queue;
-    BlockingQueue<uint32_t> completed_queue;
+    // Results are only sent in response to a request and the callers wait for them one at a time, 
+    // so they are handed over through lock-free rings. Interrupts arrive unsolicited and may pile up 
+    // without an interrupt handler, so they stay in an unbounded queue.
+    SpscQueue<uint64_t> csr_queue;
+    SpscQueue<uint32_t> completed_queue;
     BlockingQueue<uint32_t> irq_queue;
 
     // InputWriter to transfer data back to the simulation with writeMem(...) after it requested a 
@@ -77,22 +101,14 @@ private:
     BinaryInputWriter &input_writer;
 
     void boundsCheck(uint64_t vaddr, uint64_t size) {
-        bool bounds_check_success = false;
-        for (auto &mapped_page : *tlb_pages) {
-            auto mapped_page_vaddr = reinterpret_cast<uint64_t>(mapped_page.first);
-            auto mapped_page_size = mapped_page.second;
-            if (mapped_page_vaddr <= vaddr && mapped_page_vaddr + mapped_page_size >= vaddr + size) {
-                bounds_check_success = true;
-            }
-        }
-        if (!bounds_check_success) {FATAL("Bounds check failed. No mapped pages in the range [" << vaddr << ", " << vaddr + size << ")") std::terminate();}
+        if (!tlb->contains(vaddr, size)) {FATAL("Bounds check failed. No mapped pages in the range [" << vaddr << ", " << vaddr + size << ")") std::terminate();}
     }
 
 public:
     BinaryOutputReader(BinaryInputWriter &input_writer) : input_writer(input_writer) {}
 
-    void setTLBPages(std::unordered_map<void *, uint32_t> *tlb_pages) {
-        this->tlb_pages = tlb_pages;
+    void setTLB(SimTlb *tlb) {
+        this->tlb = tlb;
     }
 
     int open(const char *file_name) {
@@ -154,7 +170,26 @@ public:
 
                     boundsCheck(meta.vaddr, meta.size);
 
-                    input_writer.writeMem(meta.vaddr, meta.size, reinterpret_cast<void *>(meta.vaddr));
+                    input_writer.writeMem(meta.vaddr, meta.size, reinterpret_cast<void *>(meta.vaddr), true);
+                    break;}
+                case TIMING: {
+                    timing_t raw;
+                    std::memcpy(&raw, data, sizeof(raw));
+
+                    simReqTiming timing;
+                    timing.oper = static_cast<CoyoteOper>(raw.opcode);
+                    timing.rd = raw.rd;
+                    timing.strm = raw.strm;
+                    timing.dest = raw.dest;
+                    timing.vaddr = raw.vaddr;
+                    timing.len = raw.len;
+                    timing.issue_cycle = raw.issue;
+                    timing.first_beat_cycle = raw.first;
+                    timing.last_beat_cycle = raw.last;
+                    timing.completion_cycle = raw.completion;
+
+                    std::lock_guard<std::mutex> lock(timings_mtx);
+                    timings.push_back(timing);
                     break;}
                 default: 
                     FATAL("Unknown operator type " << (int) op_type)
@@ -195,6 +230,17 @@ public:
     bool getNextIRQ(uint32_t &out) {
         return irq_queue.pop(out);
     }
+
+    /// Returns the timing of all requests reported so far
+    std::vector<simReqTiming> getTimings() {
+        std::lock_guard<std::mutex> lock(timings_mtx);
+        return timings;
+    }
+
+    void clearTimings() {
+        std::lock_guard<std::mutex> lock(timings_mtx);
+        timings.clear();
+    }
 };
 
 }
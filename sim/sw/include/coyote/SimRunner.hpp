@@ -0,0 +1,59 @@
+/**
+ * This file is part of the Coyote <https://github.com/fpgasystems/Coyote>
+ *
+ * MIT Licence
+ * Copyright (c) 2025, Systems Group, ETH Zurich
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _COYOTE_SIM_RUNNER_HPP_
+#define _COYOTE_SIM_RUNNER_HPP_
+
+#include <string>
+
+namespace coyote {
+
+/**
+ * Interface of the simulation backends that run the testbench in <build_dir>/sim.
+ * The backends only differ in how the testbench is compiled and launched; the
+ * communication with the testbench always goes through the BinaryInputWriter and BinaryOutputReader.
+ */
+class SimRunner {
+public:
+    virtual ~SimRunner() {}
+
+    /// Prepares the backend for the simulation in the given directory
+    virtual int openProject(const char *sim_dir) = 0;
+
+    /// Compiles the testbench (if needed); returns once it is ready to be run
+    virtual int compileProject() = 0;
+
+    /**
+     * Runs the simulation; returns once the simulation terminated
+     * If persistent, the test bench keeps running after the software closed the input file and waits 
+     * for the next process to open it again (simulation server, see coyote_sim_server)
+     */
+    virtual int runSimulation(std::string simulation_time = "-all", bool persistent = false) = 0;
+};
+
+}
+
+#endif
@@ -0,0 +1,121 @@
+/**
+ * This file is part of the Coyote <https://github.com/fpgasystems/Coyote>
+ *
+ * MIT Licence
+ * Copyright (c) 2025, Systems Group, ETH Zurich
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _COYOTE_SIM_SERVER_HPP_
+#define _COYOTE_SIM_SERVER_HPP_
+
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+
+#include <coyote/Common.hpp>
+#include <coyote/SimRunner.hpp>
+#include <coyote/VivadoRunner.hpp>
+#include <coyote/VerilatorRunner.hpp>
+
+namespace coyote {
+
+/// File in <build_dir>/sim holding the process ID of a running simulation server (coyote_sim_server)
+constexpr const char *SIM_SERVER_PID_FILE = "server.pid";
+
+/// File in <build_dir>/sim that processes attached to a simulation server hold an exclusive lock on
+constexpr const char *SIM_SERVER_LOCK_FILE = "server.lock";
+
+/// Returns the simulation directory <COYOTE_SIM_DIR>/sim; terminates if COYOTE_SIM_DIR is not set
+inline std::filesystem::path getSimPath() {
+    auto raw_sim_dir = std::getenv("COYOTE_SIM_DIR");
+    if (raw_sim_dir == nullptr) {
+        FATAL("you must set the COYOTE_SIM_DIR environment variable to the directory "
+              "build directory where you ran `make sim` (usually, build_hw)")
+        std::terminate();
+    }
+
+    std::filesystem::path p(raw_sim_dir);
+    auto sim_path = p.is_absolute() ? p : std::filesystem::current_path() / p;
+    return sim_path / "sim";
+}
+
+/// (Re-)creates the named pipes input.bin and output.bin the software and the test bench communicate through
+inline int createSimPipes(const std::filesystem::path &sim_path) {
+    std::string input_file_name((sim_path / "input.bin").string());
+    std::string output_file_name((sim_path / "output.bin").string());
+
+    std::filesystem::remove(input_file_name);
+    std::filesystem::remove(output_file_name);
+    int status = mkfifo(input_file_name.c_str(), 0666);
+    if (status == 0) status = mkfifo(output_file_name.c_str(), 0666);
+
+    if (status < 0) {
+        ERROR(strerror(errno))
+        return -1;
+    }
+    DEBUG("Created named pipes input.bin and output.bin in " << sim_path)
+    return 0;
+}
+
+/// Creates the simulation backend; with COYOTE_SIM_BACKEND=verilator, the precompiled Verilator model, otherwise Vivado
+inline std::unique_ptr<SimRunner> createSimRunner() {
+    auto raw_backend = std::getenv("COYOTE_SIM_BACKEND");
+    if (raw_backend && std::string(raw_backend) == "verilator") {
+        return std::make_unique<VerilatorRunner>();
+    }
+    return std::make_unique<VivadoRunner>();
+}
+
+/// Checks whether a simulation server is running in the given simulation directory
+inline bool isSimServerRunning(const std::filesystem::path &sim_path) {
+    std::ifstream pid_file(sim_path / SIM_SERVER_PID_FILE);
+    pid_t pid;
+    return (pid_file >> pid) && kill(pid, 0) == 0;
+}
+
+/**
+ * Waits until no other process is attached to the simulation server, since the test bench serves one process at a time.
+ * Returns the file descriptor holding the lock, which is released once it is closed.
+ */
+inline int lockSimServer(const std::filesystem::path &sim_path) {
+    int fd = open((sim_path / SIM_SERVER_LOCK_FILE).c_str(), O_RDWR | O_CREAT, 0666);
+    if (fd < 0 || flock(fd, LOCK_EX) < 0) {
+        ERROR("Could not lock the simulation server: " << strerror(errno))
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+}
+
+#endif
@@ -0,0 +1,87 @@
+/**
+ * This file is part of the Coyote <https://github.com/fpgasystems/Coyote>
+ *
+ * MIT Licence
+ * Copyright (c) 2025, Systems Group, ETH Zurich
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _COYOTE_SIM_TLB_HPP_
+#define _COYOTE_SIM_TLB_HPP_
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <shared_mutex>
+
+namespace coyote {
+
+/**
+ * Buffers mapped in the simulated TLB, kept as an interval map (start -> end) sorted by start address.
+ * cThread::userMap/userUnmap add and remove the buffers, while the BinaryOutputReader checks every 
+ * memory access of the simulation against them; a lookup only has to look at the last buffer starting 
+ * at or before the access, so it is O(log n) in the number of mapped buffers.
+ */
+class SimTlb {
+public:
+    /// Adds the buffer [vaddr, vaddr + len); returns false if a buffer is already mapped at vaddr
+    bool map(uint64_t vaddr, uint64_t len) {
+        std::unique_lock<std::shared_mutex> lock(mtx);
+        return regions.emplace(vaddr, vaddr + len).second;
+    }
+
+    /// Removes the buffer mapped at vaddr; returns false if there is none
+    bool unmap(uint64_t vaddr) {
+        std::unique_lock<std::shared_mutex> lock(mtx);
+        return regions.erase(vaddr) > 0;
+    }
+
+    /// Returns true if [vaddr, vaddr + size) lies within a single mapped buffer
+    bool contains(uint64_t vaddr, uint64_t size) const {
+        std::shared_lock<std::shared_mutex> lock(mtx);
+        auto it = regions.upper_bound(vaddr);
+        if (it == regions.begin()) {
+            return false;
+        }
+        --it;
+        if (it->second >= vaddr + size) {
+            return true;
+        }
+
+        // Buffers may overlap (e.g., a sub-range of a larger buffer mapped again), in which case an earlier 
+        // buffer can still cover the access. Only reached when the check is about to fail, so the scan is fine.
+        while (it != regions.begin()) {
+            --it;
+            if (it->second >= vaddr + size) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    mutable std::shared_mutex mtx;
+    std::map<uint64_t, uint64_t> regions;
+};
+
+}
+
+#endif
@@ -0,0 +1,111 @@
+/**
+ * This file is part of the Coyote <https://github.com/fpgasystems/Coyote>
+ *
+ * MIT Licence
+ * Copyright (c) 2025, Systems Group, ETH Zurich
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _COYOTE_SPSC_QUEUE_HPP_
+#define _COYOTE_SPSC_QUEUE_HPP_
+
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+/**
+ * Lock-free single-producer/single-consumer ring. Used to hand results from the thread running the 
+ * BinaryOutputReader to the thread waiting for them, without taking a lock for every element.
+ * 
+ * pop spins for a while and only then blocks on a condition variable; the producer only takes the 
+ * lock to wake the consumer up if it announced that it is blocked. push yields while the ring is full, 
+ * so the capacity has to cover all elements that can be outstanding at once.
+ * Several consumer threads may use the queue as long as they are serialized (e.g., with a mutex).
+ */
+template <typename T, size_t CAPACITY = 1024>
+class SpscQueue {
+    static_assert((CAPACITY & (CAPACITY - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    void push(T const &value) noexcept {
+        size_t t = tail.load(std::memory_order_relaxed);
+        while (t - head.load(std::memory_order_acquire) == CAPACITY) {
+            std::this_thread::yield();
+        }
+
+        ring[t & (CAPACITY - 1)] = value;
+        tail.store(t + 1, std::memory_order_seq_cst);
+
+        if (waiting.load(std::memory_order_seq_cst)) {
+            std::lock_guard<std::mutex> lock(mtx);
+            cv.notify_one();
+        }
+    }
+
+    bool pop(T &out) {
+        size_t h = head.load(std::memory_order_relaxed);
+
+        for (int i = 0; i < SPIN_ITERATIONS && !available(h); i++) {
+            std::this_thread::yield();
+        }
+
+        if (!available(h)) {
+            std::unique_lock<std::mutex> lock(mtx);
+            waiting.store(true, std::memory_order_seq_cst);
+            cv.wait(lock, [this, h]{ return available(h); });
+            waiting.store(false, std::memory_order_relaxed);
+        }
+
+        if (tail.load(std::memory_order_acquire) == h) { // Stopped and empty
+            return false;
+        }
+
+        out = std::move(ring[h & (CAPACITY - 1)]);
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    void stop() noexcept {
+        stopped.store(true, std::memory_order_seq_cst);
+        std::lock_guard<std::mutex> lock(mtx);
+        cv.notify_all();
+    }
+
+private:
+    static constexpr int SPIN_ITERATIONS = 1024;
+
+    bool available(size_t h) const {
+        return tail.load(std::memory_order_seq_cst) != h || stopped.load(std::memory_order_seq_cst);
+    }
+
+    T ring[CAPACITY];
+
+    alignas(64) std::atomic<size_t> head{0};
+    alignas(64) std::atomic<size_t> tail{0};
+    alignas(64) std::atomic<bool>   waiting{false};
+    std::atomic<bool>               stopped{false};
+
+    std::mutex              mtx;
+    std::condition_variable cv;
+};
+
+#endif
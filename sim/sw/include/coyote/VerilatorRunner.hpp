@@ -0,0 +1,102 @@
+/**
+ * This file is part of the Coyote <https://github.com/fpgasystems/Coyote>
+ *
+ * MIT Licence
+ * Copyright (c) 2025, Systems Group, ETH Zurich
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _COYOTE_VERILATOR_RUNNER_HPP_
+#define _COYOTE_VERILATOR_RUNNER_HPP_
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <sys/wait.h>
+#include <filesystem>
+
+#include <coyote/Common.hpp>
+#include <coyote/SimRunner.hpp>
+
+namespace coyote {
+
+/**
+ * Runs the testbench as a Verilator model that was compiled ahead of time with `make sim_verilator`.
+ * Unlike the VivadoRunner, nothing is compiled when the cThread is constructed: the model is a plain
+ * executable that is started directly, which takes a fraction of a second instead of minutes.
+ */
+class VerilatorRunner : public SimRunner {
+    const char *MODEL_DIR = "verilator"; // Sub-directory of <build_dir>/sim the model is compiled to
+    const char *MODEL_NAME = "Vtb_user"; // Name of the executable of the model
+    const char *LOG_NAME = "simulate.log"; // Output of the model, stored next to the executable
+
+    std::filesystem::path model_path;
+
+public:
+    VerilatorRunner() {}
+
+    int openProject(const char *sim_dir) override {
+        model_path = std::filesystem::path(sim_dir) / MODEL_DIR / MODEL_NAME;
+        DEBUG("Using Verilator model " << model_path)
+        return 0;
+    }
+
+    int compileProject() override {
+        if (access(model_path.c_str(), X_OK)) {
+            ERROR("Could not find the Verilator model " << model_path << ", run `make sim_verilator` in the hardware build directory first")
+            return -1;
+        }
+        return 0;
+    }
+
+    int runSimulation(std::string simulation_time = "-all", bool persistent = false) override { // The model always runs until $finish
+        std::string log_path((model_path.parent_path() / LOG_NAME).string());
+
+        pid_t pid = fork();
+        if (0 > pid) {
+            ERROR(strerror(errno));
+            return -1;
+        }
+
+        if (pid == 0) { // If this is the child process
+            int log_fd = open(log_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666);
+            if (log_fd >= 0) {
+                dup2(log_fd, STDOUT_FILENO);
+                dup2(log_fd, STDERR_FILENO);
+                close(log_fd);
+            }
+            const char *argv[] = {model_path.c_str(), persistent ? "+persistent" : NULL, NULL};
+            execv(argv[0], const_cast<char *const *>(argv)); // Replace it with execution of the model
+            _exit(127);
+        }
+
+        int status = 0;
+        waitpid(pid, &status, 0);
+        DEBUG("Verilator model exited with code " << status << "...")
+        return (WIFEXITED(status) && WEXITSTATUS(status) == 0) ? 0 : -1;
+    }
+};
+
+}
+
+#endif
@@ -39,10 +39,11 @@
 #include <vector>
 
 #include <coyote/Common.hpp>
+#include <coyote/SimRunner.hpp>
 
 namespace coyote {
 
-class VivadoRunner {
+class VivadoRunner : public SimRunner {
     const char *COMMAND_PROMPT = "Vivado%"; // Command prompt string that Vivado prints on the terminal whenever it is ready for the next Tcl command
     const int COMMAND_PROMPT_SIZE = 7; // Size of the command prompt string
 
@@ -137,7 +138,7 @@ public:
         close(master);
     }
 
-    int openProject(const char *sim_dir) {
+    int openProject(const char *sim_dir) override {
         this->sim_dir = sim_dir;
         auto status = initialize();
         if (status < 0) return status;
@@ -161,7 +162,7 @@ public:
         return result;
     }
 
-    int compileProject() {
+    int compileProject() override {
         return executeCommands({
             "set_property -name xsim.compile.xvlog.more_options -value {-d EN_RANDOMIZATION -d EN_INTERACTIVE} -objects [get_filesets sim_1]",
             "set_property -name xsim.compile.xsc.mt_level -value {16} -objects [get_filesets sim_1]",
@@ -170,11 +171,13 @@ public:
             "launch_simulation -simset [get_filesets sim_1] -step elaborate -noclean_dir -mode behavioral"});
     }
 
-    int runSimulation(std::string simulation_time = "-all") { // TODO
+    int runSimulation(std::string simulation_time = "-all", bool persistent = false) override { // TODO
         std::filesystem::path vcd_path(sim_dir);
         vcd_path /= "sim_dump.vcd";
+        std::string xsim_options(persistent ? "-testplusarg persistent" : "");
         return executeCommands({
             "set_property -name {xsim.simulate.runtime} -value {} -objects [get_filesets sim_1]",
+            "set_property -name {xsim.simulate.xsim.more_options} -value {" + xsim_options + "} -objects [get_filesets sim_1]",
             "launch_simulation -simset [get_filesets sim_1] -step simulate -noclean_dir -mode behavioral",
             "restart",
             "open_vcd " + vcd_path.string(),
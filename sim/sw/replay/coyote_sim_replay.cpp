@@ -0,0 +1,317 @@
+/**
+ * This file is part of the Coyote <https://github.com/fpgasystems/Coyote>
+ *
+ * MIT Licence
+ * Copyright (c) 2025, Systems Group, ETH Zurich
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <coyote/Common.hpp>
+#include <coyote/BinaryInputWriter.hpp>
+#include <coyote/BinaryOutputReader.hpp>
+#include <coyote/BlockingQueue.hpp>
+#include <coyote/SimServer.hpp>
+
+using namespace coyote;
+
+/**
+ * Replays a recording of the operations of a software process (COYOTE_SIM_RECORD, see BinaryInputWriter::openRecord) 
+ * on the test bench in <COYOTE_SIM_DIR>/sim, without the software. Attaches to the simulation server, if one is running, 
+ * and otherwise starts the simulation, as the cThread of the simulation target does.
+ *
+ * The operations are passed on in order; like the software, the replay waits for the result of every getCSR and 
+ * checkCompleted before passing on the next operation. Memory read by the simulation (HOST_READ) is answered with 
+ * the data recorded for it, in order; memory written by the simulation is dropped.
+ *
+ * Usage: COYOTE_SIM_DIR=path/to/build_hw coyote_sim_replay <recording> [-v]
+ */
+
+typedef BinaryInputWriter BIW;
+typedef BinaryOutputReader BOR;
+
+/// Operation of the recording; data points into the mapped recording
+struct recOp {
+    uint8_t type;
+    const uint8_t *args;
+    const uint8_t *data;
+};
+
+static size_t recArgsSize(uint8_t type) {
+    switch (type) {
+        case BIW::SET_CSR: return sizeof(BIW::set_csr_op_t);
+        case BIW::GET_CSR: return sizeof(BIW::get_csr_op_t);
+        case BIW::USER_MAP: case BIW::MEM_WRITE: case BIW::RECORDED_HOST_READ: return sizeof(BIW::vaddr_size_t);
+        case BIW::INVOKE: return sizeof(BIW::req_t);
+        case BIW::SLEEP: case BIW::USER_UNMAP: return sizeof(uint64_t);
+        case BIW::CHECK_COMPLETED: return sizeof(BIW::check_completed_t);
+        case BIW::CLEAR_COMPLETED: return 0;
+        case BIW::SET_TIMING: return sizeof(uint8_t);
+        default: return SIZE_MAX;
+    }
+}
+
+/// Splits the recording into the operations passed to the simulation and the responses to its memory reads
+static bool parseRecording(const uint8_t *rec, size_t size, std::vector<recOp> &ops, std::deque<recOp> &host_reads) {
+    if (size < sizeof(BIW::RECORD_MAGIC) || memcmp(rec, BIW::RECORD_MAGIC, sizeof(BIW::RECORD_MAGIC)) != 0) {
+        ERROR("Not a recording of the simulation target")
+        return false;
+    }
+
+    size_t pos = sizeof(BIW::RECORD_MAGIC);
+    while (pos < size) {
+        recOp op = {rec[pos], rec + pos + 1, nullptr};
+        size_t args_size = recArgsSize(op.type);
+        if (args_size == SIZE_MAX || pos + 1 + args_size > size) {
+            ERROR("Corrupt recording at byte " << pos)
+            return false;
+        }
+        pos += 1 + args_size;
+
+        if (op.type == BIW::MEM_WRITE || op.type == BIW::RECORDED_HOST_READ) {
+            BIW::vaddr_size_t vs;
+            memcpy(&vs, op.args, sizeof(vs));
+            if (pos + vs.size > size) {
+                ERROR("Truncated memory write in the recording at byte " << pos)
+                return false;
+            }
+            op.data = rec + pos;
+            pos += vs.size;
+        }
+
+        if (op.type == BIW::RECORDED_HOST_READ) {
+            host_reads.push_back(op);
+        } else {
+            ops.push_back(op);
+        }
+    }
+    return true;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        std::cerr << "Usage: COYOTE_SIM_DIR=path/to/build_hw " << argv[0] << " <recording> [-v]" << std::endl;
+        return EXIT_FAILURE;
+    }
+    bool verbose = argc > 2 && std::string(argv[2]) == "-v";
+
+    // The recording is mapped as a whole, the memory reads of the simulation may be answered ahead of the other operations
+    int rec_fd = open(argv[1], O_RDONLY);
+    struct stat rec_stat;
+    if (rec_fd < 0 || fstat(rec_fd, &rec_stat) < 0) {
+        ERROR("Unable to open recording " << argv[1])
+        return EXIT_FAILURE;
+    }
+    size_t rec_size = rec_stat.st_size;
+    void *rec = rec_size ? mmap(NULL, rec_size, PROT_READ, MAP_PRIVATE, rec_fd, 0) : MAP_FAILED;
+    close(rec_fd);
+    if (rec == MAP_FAILED) {
+        ERROR("Unable to map recording " << argv[1])
+        return EXIT_FAILURE;
+    }
+
+    std::vector<recOp> ops;
+    std::deque<recOp> host_reads;
+    if (!parseRecording(static_cast<const uint8_t *>(rec), rec_size, ops, host_reads)) return EXIT_FAILURE;
+    std::cout << "Replaying " << ops.size() << " operations, " << host_reads.size() << " host reads" << std::endl;
+
+    // Attach to the simulation server or start the simulation
+    auto sim_path = getSimPath();
+    std::string input_file_name((sim_path / "input.bin").string());
+    std::string output_file_name((sim_path / "output.bin").string());
+    std::unique_ptr<SimRunner> sim_runner;
+    std::thread sim_thread;
+    int server_lock_fd = -1;
+    if (isSimServerRunning(sim_path)) {
+        server_lock_fd = lockSimServer(sim_path);
+        if (server_lock_fd < 0) return EXIT_FAILURE;
+    } else {
+        int status = createSimPipes(sim_path);
+        sim_runner = createSimRunner();
+        if (status == 0) status = sim_runner->openProject(sim_path.c_str());
+        if (status == 0) status = sim_runner->compileProject();
+        if (status < 0) {
+            FATAL("Could not open or compile simulation project")
+            return EXIT_FAILURE;
+        }
+        sim_thread = std::thread([&sim_runner] { sim_runner->runSimulation(); });
+    }
+
+    // Output of the simulation: results are handed to the replay, memory reads answered from the recording
+    BinaryInputWriter input_writer;
+    BlockingQueue<uint64_t> results;
+    uint64_t n_irqs = 0, n_timings = 0, n_unanswered = 0;
+    std::thread out_thread([&] {
+        FILE *fp = fopen(output_file_name.c_str(), "rb");
+        if (fp == NULL) {
+            ERROR("Unable to open named pipe")
+            results.stop();
+            return;
+        }
+
+        int op_type;
+        while ((op_type = getc(fp)) != EOF && op_type <= BOR::TIMING) {
+            uint8_t args[sizeof(BOR::timing_t)];
+            if (fread(args, BOR::op_type_size[op_type], 1, fp) != 1) break;
+
+            switch (op_type) {
+                case BOR::GET_CSR: {
+                    uint64_t result;
+                    memcpy(&result, args, sizeof(result));
+                    results.push(result);
+                    break;}
+                case BOR::CHECK_COMPLETED: {
+                    uint32_t result;
+                    memcpy(&result, args, sizeof(result));
+                    results.push(result);
+                    break;}
+                case BOR::HOST_WRITE: {
+                    BOR::vaddr_size_t meta;
+                    memcpy(&meta, args, sizeof(meta));
+                    for (uint64_t i = 0; i < meta.size; i++) getc(fp);
+                    break;}
+                case BOR::HOST_READ: {
+                    BOR::vaddr_size_t meta;
+                    memcpy(&meta, args, sizeof(meta));
+                    if (host_reads.empty()) {
+                        // Not in the recording (e.g., the simulation diverged); answered with zeros to keep it going
+                        n_unanswered++;
+                        std::vector<uint8_t> zeros(meta.size, 0);
+                        input_writer.writeMem(meta.vaddr, meta.size, zeros.data(), true);
+                    } else {
+                        recOp op = host_reads.front();
+                        host_reads.pop_front();
+                        BIW::vaddr_size_t vs;
+                        memcpy(&vs, op.args, sizeof(vs));
+                        if (vs.vaddr != meta.vaddr || vs.size != meta.size) {
+                            WARNING("Host read of " << meta.size << " bytes at " << meta.vaddr << " answered with the recorded read of " << vs.size << " bytes at " << vs.vaddr)
+                        }
+                        input_writer.writeMem(vs.vaddr, vs.size, const_cast<uint8_t *>(op.data), true);
+                    }
+                    break;}
+                case BOR::IRQ:
+                    n_irqs++;
+                    break;
+                case BOR::TIMING:
+                    n_timings++;
+                    break;
+            }
+        }
+        fclose(fp);
+        results.stop();
+    });
+
+    input_writer.openShm((sim_path / "input.shm").c_str());
+    if (input_writer.open(input_file_name.c_str(), true) < 0) return EXIT_FAILURE;
+
+    auto start = std::chrono::steady_clock::now();
+    size_t n_replayed = 0;
+    for (auto &op : ops) {
+        uint64_t result = 0;
+        bool waits = false;
+        switch (op.type) {
+            case BIW::SET_CSR: {
+                BIW::set_csr_op_t args;
+                memcpy(&args, op.args, sizeof(args));
+                input_writer.setCSR(args.addr / 8, args.data);
+                break;}
+            case BIW::GET_CSR: {
+                BIW::get_csr_op_t args;
+                memcpy(&args, op.args, sizeof(args));
+                input_writer.getCSR(args.addr / 8);
+                waits = true;
+                break;}
+            case BIW::USER_MAP: {
+                BIW::vaddr_size_t args;
+                memcpy(&args, op.args, sizeof(args));
+                input_writer.userMap(args.vaddr, args.size);
+                break;}
+            case BIW::USER_UNMAP: {
+                uint64_t vaddr;
+                memcpy(&vaddr, op.args, sizeof(vaddr));
+                input_writer.userUnmap(vaddr);
+                break;}
+            case BIW::MEM_WRITE: {
+                BIW::vaddr_size_t args;
+                memcpy(&args, op.args, sizeof(args));
+                input_writer.writeMem(args.vaddr, args.size, const_cast<uint8_t *>(op.data));
+                break;}
+            case BIW::INVOKE: {
+                BIW::req_t args;
+                memcpy(&args, op.args, sizeof(args));
+                input_writer.invoke(args.opcode, args.strm, args.dest, args.vaddr, args.len, args.last);
+                break;}
+            case BIW::SLEEP: {
+                uint64_t duration;
+                memcpy(&duration, op.args, sizeof(duration));
+                input_writer.sleep(duration);
+                break;}
+            case BIW::CHECK_COMPLETED: {
+                BIW::check_completed_t args;
+                memcpy(&args, op.args, sizeof(args));
+                input_writer.checkCompleted(args.opcode, args.count, args.do_polling);
+                waits = true;
+                break;}
+            case BIW::CLEAR_COMPLETED:
+                input_writer.clearCompleted();
+                break;
+            case BIW::SET_TIMING:
+                input_writer.setTiming(op.args[0]);
+                break;
+        }
+
+        if (waits) {
+            if (!results.pop(result)) {
+                ERROR("Simulation ended after " << n_replayed << " of " << ops.size() << " operations")
+                break;
+            }
+            if (verbose) {
+                std::cout << (op.type == BIW::GET_CSR ? "getCSR: " : "checkCompleted: ") << result << std::endl;
+            }
+        }
+        n_replayed++;
+    }
+    input_writer.close();
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    out_thread.join();
+    if (sim_thread.joinable()) sim_thread.join();
+    if (server_lock_fd >= 0) close(server_lock_fd);
+    munmap(rec, rec_size);
+
+    std::cout << "Replayed " << n_replayed << " of " << ops.size() << " operations in " << elapsed << " s; " 
+              << n_irqs << " interrupts, " << n_timings << " timing reports";
+    if (n_unanswered) std::cout << ", " << n_unanswered << " host reads not in the recording";
+    if (!host_reads.empty()) std::cout << ", " << host_reads.size() << " recorded host reads not requested";
+    std::cout << std::endl;
+    return n_replayed == ops.size() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,82 @@
+/**
+ * This file is part of the Coyote <https://github.com/fpgasystems/Coyote>
+ *
+ * MIT Licence
+ * Copyright (c) 2025, Systems Group, ETH Zurich
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <signal.h>
+#include <unistd.h>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include <coyote/Common.hpp>
+#include <coyote/SimServer.hpp>
+
+using namespace coyote;
+
+/**
+ * Simulation server: keeps the simulation of <COYOTE_SIM_DIR>/sim running, so that consecutive software 
+ * processes linked against the simulation library attach to it instead of compiling and starting their own.
+ * The test bench is run with +persistent and waits for the next process whenever one has closed the input pipe.
+ * Only one process is attached at a time; further processes wait on server.lock in the cThread constructor until it is their turn.
+ */
+
+static char pid_file_name[4096];
+
+static void removePidFile(int signal) {
+    unlink(pid_file_name);
+    _exit(128 + signal);
+}
+
+int main(int argc, char *argv[]) {
+    auto sim_path = getSimPath();
+    if (isSimServerRunning(sim_path)) {
+        ERROR("A simulation server is already running in " << sim_path)
+        return EXIT_FAILURE;
+    }
+
+    if (createSimPipes(sim_path) < 0) return EXIT_FAILURE;
+
+    auto sim_runner = createSimRunner();
+    int status = sim_runner->openProject(sim_path.c_str());
+    if (status == 0) status = sim_runner->compileProject();
+    if (status < 0) {
+        FATAL("Could not open or compile simulation project")
+        return EXIT_FAILURE;
+    }
+
+    // Clients attach as long as the PID file exists and the process is alive
+    std::string pid_path((sim_path / SIM_SERVER_PID_FILE).string());
+    strncpy(pid_file_name, pid_path.c_str(), sizeof(pid_file_name) - 1);
+    std::ofstream(pid_path) << getpid() << std::endl;
+    signal(SIGINT, removePidFile);
+    signal(SIGTERM, removePidFile);
+
+    std::cout << "Simulation server running in " << sim_path << ", stop it with Ctrl+C" << std::endl;
+    status = sim_runner->runSimulation("-all", true);
+
+    unlink(pid_file_name);
+    return status < 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
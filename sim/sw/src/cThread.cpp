@@ -28,24 +28,33 @@
 #include <string>
 #include <malloc.h>
 #include <atomic>
+#include <unordered_set>
+#include <map>
+#include <fstream>
 
 #include <coyote/cThread.hpp>
 #include <coyote/Common.hpp>
 #include <coyote/BinaryInputWriter.hpp>
 #include <coyote/BinaryOutputReader.hpp>
-#include <coyote/VivadoRunner.hpp>
+#include <coyote/SimServer.hpp>
 #include <coyote/Broadcast.hpp>
 
 namespace coyote {
 
+/**
+ * State of the simulation, shared by all cThreads of the process: the first cThread starts the simulation 
+ * (or attaches to a running simulation server), the following ones share its pipes and get the next ctid.
+ * The simulation is torn down once the last cThread is destroyed.
+ */
 class cThread::AdditionalState {
 public:
     BinaryInputWriter input_writer;
     BinaryOutputReader output_reader;
-    VivadoRunner vivado_runner;
-    std::unordered_map<void *, uint32_t> tlb_pages;
+    std::unique_ptr<SimRunner> sim_runner;
+    SimTlb tlb;
+    std::unordered_set<const cThread *> write_combining; // Only kept, see setWriteCombining()
 
-    std::thread sim_thread; // Thread starting and then interacting with the Vivado process
+    std::thread sim_thread; // Thread starting and then interacting with the simulator process (not used with a simulation server)
     std::thread out_thread; // Thread running the BinaryOutputReader
     std::thread irq_thread; // Thread handling interrupts
 
@@ -54,11 +63,112 @@ public:
 
     Broadcast<return_t> return_broadcast;
     std::atomic<size_t> thread_counter{fix_thread_ids::NUM_FIX_THREAD_IDS};
+    std::atomic<int32_t> ctid_counter{0};
+    int server_lock_fd = -1; // Lock on the simulation server, if attached to one
 
     AdditionalState() :
         input_writer(),
         output_reader(input_writer) {}
 
+    ~AdditionalState() {
+        input_writer.close();
+
+        if (sim_thread.joinable())
+            sim_thread.join();
+        out_thread.join();
+
+        if (irq_thread.joinable())
+            irq_thread.join();
+
+        if (server_lock_fd >= 0)
+            close(server_lock_fd);
+    }
+
+    /// Returns the state of the running simulation, or starts the simulation if there is none
+    static std::shared_ptr<AdditionalState> attach() {
+        static std::mutex attach_mtx;
+        static std::weak_ptr<AdditionalState> current;
+
+        std::lock_guard<std::mutex> lock(attach_mtx);
+        auto state = current.lock();
+        if (!state) {
+            state = std::make_shared<AdditionalState>();
+            state->start();
+            current = state;
+        }
+        return state;
+    }
+
+    /**
+     * Starts the simulation, unless a simulation server runs in the simulation directory, 
+     * and opens the named pipes to communicate with it.
+     */
+    void start() {
+        auto sim_path = getSimPath();
+        std::string input_file_name((sim_path / "input.bin").string());
+        std::string output_file_name((sim_path / "output.bin").string());
+
+        if (isSimServerRunning(sim_path)) {
+            DEBUG("Attaching to the simulation server in " << sim_path)
+            server_lock_fd = lockSimServer(sim_path);
+            if (server_lock_fd < 0) {
+                FATAL("Could not attach to the simulation server")
+                std::terminate();
+            }
+        } else {
+            int status = createSimPipes(sim_path);
+
+            sim_runner = createSimRunner();
+            if (status == 0) status = sim_runner->openProject(sim_path.c_str());
+            if (status == 0) status = sim_runner->compileProject();
+
+            if (status < 0) {
+                FATAL("Could not open or compile simulation project")
+                std::terminate();
+            }
+
+            // Run simulation in its own thread
+            sim_thread = std::thread([this] { 
+                auto status = sim_runner->runSimulation();
+                return_broadcast.broadcast({SIM_THREAD_ID, status});
+            });
+        }
+
+        output_reader.setTLB(&tlb);
+        out_thread = std::thread([this, output_file_name] {
+            auto status = output_reader.open(output_file_name.c_str());
+            if (status < 0) {
+                return_broadcast.broadcast({OUT_THREAD_ID, status}); 
+                return;
+            }
+
+            status = output_reader.readUntilEOF();
+            output_reader.close();
+            return_broadcast.broadcast({OUT_THREAD_ID, status});
+        });
+
+        // The data of memory writes is passed through a shared file, rather than the named pipe
+        input_writer.openShm((sim_path / "input.shm").c_str());
+
+        // With COYOTE_SIM_RECORD set, all operations are also recorded to the given file, to be replayed with coyote_sim_replay
+        auto raw_record = std::getenv("COYOTE_SIM_RECORD");
+        if (raw_record && *raw_record) {
+            input_writer.openRecord(raw_record);
+        }
+
+        // With COYOTE_SIM_BATCHED set, operations are only passed to the simulation once they are waited on (see BinaryInputWriter)
+        auto raw_batched = std::getenv("COYOTE_SIM_BATCHED");
+        bool batched = raw_batched && std::string(raw_batched) != "0";
+        executeUnlessCrash([this, &input_file_name, batched] {
+            input_writer.open(input_file_name.c_str(), batched);
+        });
+
+        // Clear
+        executeUnlessCrash([this] { 
+            input_writer.clearCompleted();
+        });
+    }
+
     /**
      * Executes the provided lambda until either it terminates, the simulation or output reader 
      * threads terminate, or another thread returns a non-zero status (i.e., crashes).
@@ -79,7 +189,7 @@ public:
         } while (result.id != thread_id && result.id >= fix_thread_ids::NUM_FIX_THREAD_IDS && result.status == 0);
         return_broadcast.unregister_receiver();
 
-        if (result.id != thread_id) { // VivadoRunner or OutputReader crashed
+        if (result.id != thread_id) { // SimRunner or OutputReader crashed
             FATAL("Thread with id " << (int) result.id << " crashed")
             std::terminate();
         }
@@ -88,75 +198,18 @@ public:
     }
 };
 
-cThread::cThread(int32_t vfid, pid_t hpid, uint32_t device, std::function<void(int)> uisr):
-  hpid(hpid), vfid(vfid),
+cThread::cThread(int32_t vfid, pid_t hpid, uint32_t device, std::function<void(int)> uisr, CoyoteNotify notify, cNotifyReactor *reactor):
+  hpid(hpid), vfid(vfid), device(device), uisr(uisr), notify_mode(notify),
   vlock(boost::interprocess::open_or_create, ("vpga_mtx_user_" + std::to_string(std::time(nullptr))).c_str()),
-  additional_state(std::make_unique<AdditionalState>()) { // Timestamp for plock to prevent multiple users aquiring the same lock at the same time which does not matter for the simulation, only for hardware
-    auto raw_sim_dir = std::getenv("COYOTE_SIM_DIR");
-    if (raw_sim_dir == nullptr) {
-        FATAL("you must set the COYOTE_SIM_DIR environment variable to the directory "
-              "build directory where you ran `make sim` (usually, build_hw)")
-        std::terminate();
-    }
-
-    std::filesystem::path p(raw_sim_dir);
-    auto sim_path = p.is_absolute() ? p : std::filesystem::current_path() / p;
-
-    sim_path /= "sim";
-    std::string input_file_name((sim_path / "input.bin").string());
-    std::string output_file_name((sim_path / "output.bin").string());
-    
-    std::filesystem::remove(input_file_name);
-    std::filesystem::remove(output_file_name);
-    int status = mkfifo(input_file_name.c_str(), 0666);
-    if (status == 0) status = mkfifo(output_file_name.c_str(), 0666);
-    
-    if (status < 0) {
-        FATAL(strerror(errno))
-        std::terminate();
-    }
-    DEBUG("Created named pipes input.bin and output.bin in " << sim_path)
-
-    auto &input_writer = additional_state->input_writer;
-    auto &output_reader = additional_state->output_reader;
-    auto &vivado_runner = additional_state->vivado_runner;
-    auto &return_broadcast = additional_state->return_broadcast;
-
-    status = vivado_runner.openProject(sim_path.c_str());
-    if (status == 0) status = vivado_runner.compileProject();
-
-    if (status < 0) {
-        FATAL("Could not open or compile Vivado project")
-        std::terminate();
-    }
-
-    // Run Vivado simulation in its own thread
-    additional_state->sim_thread = std::thread([&vivado_runner, &return_broadcast] { 
-        auto status = vivado_runner.runSimulation();
-        return_broadcast.broadcast({SIM_THREAD_ID, status});
-    });
-
-    output_reader.setTLBPages(&additional_state->tlb_pages);
-    additional_state->out_thread = std::thread([&output_file_name, &output_reader, &return_broadcast] {
-        auto status = output_reader.open(output_file_name.c_str());
-        if (status < 0) {
-            return_broadcast.broadcast({OUT_THREAD_ID, status}); 
-            return;
-        }
-
-        status = output_reader.readUntilEOF();
-        output_reader.close();
-        return_broadcast.broadcast({OUT_THREAD_ID, status});
-    });
-
-    status = additional_state->executeUnlessCrash([&input_file_name, &input_writer] {
-        input_writer.open(input_file_name.c_str());
-    });
-
-    ctid = 0; // Hardcoded for now
+  additional_state(AdditionalState::attach()) { // Timestamp for plock to prevent multiple users aquiring the same lock at the same time which does not matter for the simulation, only for hardware
+    // The test bench simulates a single vFPGA context, the ctids only tell the cThreads of a process apart
+    ctid = additional_state->ctid_counter++;
 
     // Events - check if there's a pointer provided for user-defined interrupt service routine
-    if (uisr) {
+    // The simulation has no notification rings; interrupts are delivered by the interrupt thread in all the notification modes
+    // The interrupt thread is shared as well, it calls the routine of the first cThread that provided one
+    if (uisr && !additional_state->irq_thread.joinable()) {
+        auto &output_reader = additional_state->output_reader;
         additional_state->irq_thread = std::thread([&output_reader, uisr] {
             bool status(true);
             uint32_t value;
@@ -171,8 +224,6 @@ cThread::cThread(int32_t vfid, pid_t hpid, uint32_t device, std::function<void(i
         });
     }
 
-    // Clear
-    clearCompleted();
     DEBUG("Constructor(" << vfid << ", " << hpid << ") finished")
 }
 
@@ -183,19 +234,53 @@ cThread::~cThread() {
 	}
 	mapped_pages.clear();
 
-    additional_state->input_writer.close();
+    additional_state->write_combining.erase(this);
+}
+
+void cThread::postCmd(uint64_t offs_3, uint64_t offs_2, uint64_t offs_1, uint64_t offs_0) {
+    // Do nothing because protected function
+}
+
+void cThread::postCmdBatch(const std::vector<std::array<uint64_t, 4>> &cmds) {
+    // Do nothing because protected function
+}
 
-    additional_state->sim_thread.join();
-    additional_state->out_thread.join();
+uint32_t cThread::waitCmdCredits() {
+    // Do nothing because protected function
+    return CMD_FIFO_DEPTH;
+}
 
-    if (additional_state->irq_thread.joinable())
-        additional_state->irq_thread.join();
+std::array<uint64_t, 4> cThread::localCmd(CoyoteOper oper, const localSg &sg, uint64_t offs, uint64_t len, bool last) const {
+    // Do nothing because protected function
+    return {0, 0, 0, 0};
 }
 
-void cThread::postCmd(uint64_t offs_3, uint64_t offs_2, uint64_t offs_1, uint64_t offs_0) {
+std::array<uint64_t, 4> cThread::rdmaCmd(CoyoteOper oper, const rdmaSg &sg, uint64_t offs, uint64_t len, bool last) const {
+    // Do nothing because protected function
+    return {0, 0, 0, 0};
+}
+
+void cThread::buildLocalCmds(std::vector<std::array<uint64_t, 4>> &cmds, CoyoteOper oper, const localSg &sg, bool last) const {
+    // Do nothing because protected function
+}
+
+void cThread::buildTransferCmds(std::vector<std::array<uint64_t, 4>> &cmds, const localSg &src_sg, const localSg &dst_sg, bool last) const {
     // Do nothing because protected function
 }
 
+void cThread::buildRdmaCmds(std::vector<std::array<uint64_t, 4>> &cmds, CoyoteOper oper, const rdmaSg &sg, bool last) const {
+    // Do nothing because protected function
+}
+
+void cThread::bindNuma(void *mem, size_t size, int32_t node) const {
+    // Do nothing because protected function
+}
+
+void* cThread::allocHugePages(uint64_t size, int32_t numa_node) {
+    // Do nothing because protected function
+    return nullptr;
+}
+
 void cThread::mmapFpga() {
     // Do nothing because protected function
 }
@@ -204,19 +289,21 @@ void cThread::munmapFpga() {
     // Do nothing because protected function
 }
 
-void cThread::userMap(void *vaddr, uint32_t len, int32_t mem_block) {
+void cThread::userMap(void *vaddr, uint64_t len, int32_t mem_block, uint32_t mem_stripe, bool resident, CoyoteAccess access) {
     if (mem_block != -1) {
         WARNING("Non-default values for mem_block " << mem_block << "are currently ignored");
     }
-    additional_state->tlb_pages.emplace(vaddr, len);
+    additional_state->tlb.map(reinterpret_cast<uint64_t>(vaddr), len);
+    mapped_regions[reinterpret_cast<uint64_t>(vaddr)] = reinterpret_cast<uint64_t>(vaddr) + len;
     additional_state->executeUnlessCrash([&] { 
         additional_state->input_writer.userMap(reinterpret_cast<uint64_t>(vaddr), len);
     });
 }
 
 void cThread::userUnmap(void *vaddr) {
-    auto status = additional_state->tlb_pages.erase(vaddr);
-    if (status < 1) {
+    auto status = additional_state->tlb.unmap(reinterpret_cast<uint64_t>(vaddr));
+    mapped_regions.erase(reinterpret_cast<uint64_t>(vaddr));
+    if (!status) {
         ERROR("Tried to userUnmap non-existent page at vaddr " << vaddr)
     }
     additional_state->executeUnlessCrash([&] { 
@@ -224,6 +311,48 @@ void cThread::userUnmap(void *vaddr) {
     });
 }
 
+void cThread::prefault(void *vaddr, uint64_t len, uint32_t stream) {
+    // Do nothing because the simulation has no page faults
+    DEBUG("prefault(" << reinterpret_cast<uint64_t>(vaddr) << ", " << len << ", " << stream << ") finished")
+}
+
+void cThread::prefault(const std::vector<std::pair<void*, uint64_t>> &buffs, uint32_t stream) {
+    for (auto &buff : buffs) {
+        prefault(buff.first, buff.second, stream);
+    }
+}
+
+void cThread::userMemBatch(const std::vector<memOpSg> &ops, int32_t mem_block, uint32_t mem_stripe) {
+    // The simulation has no driver calls to batch, so the operations are issued one by one
+    for (auto &op : ops) {
+        switch (op.op) {
+            case CoyoteMemOp::MAP: 
+                userMap(op.addr, op.len, mem_block, mem_stripe);
+                break;
+            case CoyoteMemOp::UNMAP:
+                userUnmap(op.addr);
+                break;
+            case CoyoteMemOp::OFFLOAD:
+            case CoyoteMemOp::OFFLOAD_HOST_UNCHANGED:
+                invoke(CoyoteOper::LOCAL_OFFLOAD, syncSg{op.addr, op.len, op.op == CoyoteMemOp::OFFLOAD_HOST_UNCHANGED});
+                break;
+            case CoyoteMemOp::SYNC:
+                invoke(CoyoteOper::LOCAL_SYNC, syncSg{op.addr, op.len});
+                break;
+        }
+    }
+}
+
+void cThread::setFaultAhead(void *vaddr, int64_t window) {
+    // Do nothing because the simulation has no page faults
+    DEBUG("setFaultAhead(" << reinterpret_cast<uint64_t>(vaddr) << ", " << window << ") finished")
+}
+
+void cThread::setAutoRegister(bool enable) {
+    // Do nothing because the simulation accesses any user buffer directly
+    DEBUG("setAutoRegister(" << enable << ") finished")
+}
+
 void* cThread::getMem(CoyoteAlloc&& alloc) {
     if (alloc.remote) {ASSERT("Networking not implemented in simulation target")}
 
@@ -233,7 +362,8 @@ void* cThread::getMem(CoyoteAlloc&& alloc) {
 	if(alloc.size > 0) {
 		switch (alloc.alloc) { // Further steps depend on the allocation type that is selected in the allocation struct 
             // Regular allocation 
-			case CoyoteAllocType::REG : {
+            // The simulation has no separate card memory, so card-only buffers are regular host memory
+			case CoyoteAllocType::REG : case CoyoteAllocType::CARD : {
 				mem = aligned_alloc(PAGE_SIZE, alloc.size);
 				userMap(mem, alloc.size);
 				
@@ -258,6 +388,31 @@ void* cThread::getMem(CoyoteAlloc&& alloc) {
                 userMap(mem, alloc.size);
 				
 			    break;
+            }
+            case CoyoteAllocType::AUTO : { // Huge pages, falling back to transparent huge pages
+                mem = mmap(NULL, alloc.size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+                alloc.alloc = CoyoteAllocType::HPF;
+                if (mem == MAP_FAILED) {
+                    if (posix_memalign(&mem, HUGE_PAGE_SIZE, alloc.size) != 0) {
+                        FATAL("Cannot obtain huge pages or transparent huge pages")
+                        std::terminate();
+                    }
+                    alloc.alloc = CoyoteAllocType::THP;
+                }
+                userMap(mem, alloc.size);
+
+                break;
+            }
+            case CoyoteAllocType::HPF_1G : {
+                alloc.size = ((alloc.size + HUGE_PAGE_1G_SIZE - 1) >> HUGE_PAGE_1G_SHIFT) << HUGE_PAGE_1G_SHIFT;
+                mem = mmap(NULL, alloc.size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | (HUGE_PAGE_1G_SHIFT << MAP_HUGE_SHIFT), -1, 0);
+                if (mem == MAP_FAILED) {
+                    FATAL("Cannot obtain 1GB huge pages with mmap")
+                    std::terminate();
+                }
+                userMap(mem, alloc.size);
+
+                break;
             }
 			default: FATAL("CoyoteAllocType not supported in simulation") std::terminate();
 		}
@@ -272,18 +427,23 @@ void* cThread::getMem(CoyoteAlloc&& alloc) {
 	return mem;
 }
 
+void cThread::reserveHugePages(uint64_t size, int32_t numa_node) {
+    // Nothing to reserve, the simulation allocates huge pages on demand
+    DEBUG("reserveHugePages(" << size << ") finished")
+}
+
 void cThread::freeMem(void* vaddr) {
 	if (mapped_pages.find(vaddr) != mapped_pages.end()) {
 		auto mapped = mapped_pages[vaddr];
 		
 		switch (mapped.alloc) {
-            case CoyoteAllocType::REG: case CoyoteAllocType::THP: {
+            case CoyoteAllocType::REG: case CoyoteAllocType::THP: case CoyoteAllocType::CARD: {
                 userUnmap(vaddr);
                 free(vaddr);
 
                 break;
             }
-            case CoyoteAllocType::HPF: {
+            case CoyoteAllocType::HPF: case CoyoteAllocType::HPF_1G: {
                 userUnmap(vaddr);
                 munmap(vaddr, mapped.size);
 
@@ -297,6 +457,73 @@ void cThread::freeMem(void* vaddr) {
     DEBUG("freeMem(" << reinterpret_cast<uint64_t>(vaddr) << ") finished")
 }
 
+void cThread::syncCardMem(void *host_mem, void *card_mem, uint64_t size) {
+    memcpy(host_mem, card_mem, size);
+    DEBUG("syncCardMem(" << reinterpret_cast<uint64_t>(host_mem) << ", " << reinterpret_cast<uint64_t>(card_mem) << ", " << size << ") finished")
+}
+
+void cThread::offloadCardMem(void *card_mem, void *host_mem, uint64_t size) {
+    memcpy(card_mem, host_mem, size);
+    DEBUG("offloadCardMem(" << reinterpret_cast<uint64_t>(card_mem) << ", " << reinterpret_cast<uint64_t>(host_mem) << ", " << size << ") finished")
+}
+
+uint64_t cThread::shareCardMem(void *card_mem) {
+    ASSERT("Sharing card memory not implemented in simulation target")
+    return 0;
+}
+
+void* cThread::attachCardMem(uint64_t handle) {
+    ASSERT("Sharing card memory not implemented in simulation target")
+    return nullptr;
+}
+
+uint64_t cThread::persistCardMem(void *card_mem, const std::string &name) {
+    ASSERT("Persistent card memory not implemented in simulation target")
+    return 0;
+}
+
+void* cThread::attachCardMem(const std::string &name) {
+    ASSERT("Persistent card memory not implemented in simulation target")
+    return nullptr;
+}
+
+void cThread::unpersistCardMem(const std::string &name) {
+    ASSERT("Persistent card memory not implemented in simulation target")
+}
+
+int cThread::exportP2PWindow() {
+    ASSERT("Peer-to-peer DMA not implemented in simulation target")
+    return -1;
+}
+
+void* cThread::importP2PWindow(int dmabuf_fd) {
+    ASSERT("Peer-to-peer DMA not implemented in simulation target")
+    return nullptr;
+}
+
+bool cThread::isMapped(const void *vaddr, uint64_t len) const {
+    // Find the last region starting at or before vaddr and check it also covers the end of the buffer
+    uint64_t start = reinterpret_cast<uint64_t>(vaddr);
+    auto it = mapped_regions.upper_bound(start);
+    if (it == mapped_regions.begin()) {
+        return false;
+    }
+    --it;
+    return start + len <= it->second;
+}
+
+const CoyoteAlloc* cThread::getAlloc(const void *vaddr) const {
+    auto it = mapped_pages.upper_bound(const_cast<void*>(vaddr));
+    if (it == mapped_pages.begin()) {
+        return nullptr;
+    }
+    --it;
+    if (reinterpret_cast<uint64_t>(vaddr) >= reinterpret_cast<uint64_t>(it->first) + it->second.size) {
+        return nullptr;
+    }
+    return &it->second;
+}
+
 void cThread::setCSR(uint64_t val, uint32_t offs) {
     additional_state->executeUnlessCrash([&] { 
         additional_state->input_writer.setCSR(offs, val);
@@ -317,6 +544,32 @@ uint64_t cThread::getCSR(uint32_t offs) const {
     return result;
 }
 
+void cThread::setCSRs(const std::vector<std::pair<uint32_t, uint64_t>> &csrs) {
+    for (const auto &csr : csrs) {
+        if (csr.first >= N_CTRL_REGS) {
+            throw std::runtime_error("ERROR: cThread::setCSRs() called with CSR offset " + std::to_string(csr.first) + " outside of the control region, exiting...");
+        }
+        setCSR(csr.second, csr.first);
+    }
+}
+
+void cThread::getCSRs(std::vector<std::pair<uint32_t, uint64_t>> &csrs) const {
+    for (auto &csr : csrs) {
+        if (csr.first >= N_CTRL_REGS) {
+            throw std::runtime_error("ERROR: cThread::getCSRs() called with CSR offset " + std::to_string(csr.first) + " outside of the control region, exiting...");
+        }
+        csr.second = getCSR(csr.first);
+    }
+}
+
+csrWindow cThread::mapCSRs(uint32_t base, uint32_t n_regs) {
+    if (base >= N_CTRL_REGS || n_regs > N_CTRL_REGS - base) {
+        throw std::runtime_error("ERROR: cThread::mapCSRs() called with a window outside of the control region, exiting...");
+    }
+    // Registers are not memory-mapped in simulation; the window forwards to setCSR() and getCSR()
+    return csrWindow(this, nullptr, base, n_regs);
+}
+
 void cThread::invoke(CoyoteOper oper, syncSg sg) {
     DEBUG("cThread: Call invoke for a sync/offload operation with address " << sg.addr << ", length " << sg.len)
     
@@ -356,6 +609,9 @@ void cThread::invoke(CoyoteOper oper, syncSg sg) {
     }
 
     additional_state->executeUnlessCrash([&] { 
+        // Same lock as in checkCompleted(...), the results are handed over in order to one waiting thread at a time
+        std::lock_guard<std::mutex> lock(additional_state->check_completed_mtx);
+
         additional_state->input_writer.checkCompleted((uint8_t) oper, prevCompleted + 1, true);
         DEBUG("Blocking checkCompleted for sync or offload")
         additional_state->output_reader.checkCompletedResult();
@@ -364,6 +620,12 @@ void cThread::invoke(CoyoteOper oper, syncSg sg) {
     DEBUG("invoke(...) finished")
 }
 
+uint32_t cThread::invokeAsync(CoyoteOper oper, syncSg sg) {
+    // The simulation processes syncs and off-loads synchronously; the completion counters are kept by the simulation
+    invoke(oper, sg);
+    return checkCompleted(oper);
+}
+
 void cThread::invoke(CoyoteOper oper, localSg sg, bool last) {
     // Argument checks
     DEBUG("cThread: Call invoke for a one-side local operation with address " << sg.addr << ", length " << sg.len)
@@ -372,8 +634,15 @@ void cThread::invoke(CoyoteOper oper, localSg sg, bool last) {
         throw std::runtime_error("ERROR: cThread::invoke() called with localSg flags, but the operation is not a LOCAL_READ or LOCAL_WRITE; exiting...");
     }
 
+    // Transfers over MAX_TRANSFER_SIZE are split into multiple commands, only the final one carrying the last flag
     if (sg.len > MAX_TRANSFER_SIZE) {
-        throw std::runtime_error("ERROR: cThread::invoke() - transfers over 128MB are currently not supported in Coyote, exiting...");
+        for (uint64_t offs = 0; offs < sg.len; offs += MAX_TRANSFER_SIZE) {
+            localSg chunk = sg;
+            chunk.addr = (void *) ((uint64_t) sg.addr + offs);
+            chunk.len = std::min<uint64_t>(sg.len - offs, MAX_TRANSFER_SIZE);
+            invoke(oper, chunk, last && (offs + chunk.len == sg.len));
+        }
+        return;
     }
 
     // Trigger the operation
@@ -421,8 +690,11 @@ void cThread::invoke(CoyoteOper oper, localSg src_sg, localSg dst_sg, bool last)
         throw std::runtime_error("ERROR: cThread::invoke() called with two localSg flags, but the operation is not a LOCAL_TRANSFER; exiting...");
     }
 
+    // Transfers over MAX_TRANSFER_SIZE are split into multiple commands, only the final one carrying the last flag
     if (src_sg.len > MAX_TRANSFER_SIZE || dst_sg.len > MAX_TRANSFER_SIZE) {
-        throw std::runtime_error("ERROR: cThread::invoke() - transfers over 128MB are currently not supported in Coyote, exiting...");
+        invoke(CoyoteOper::LOCAL_READ, src_sg, last);
+        invoke(CoyoteOper::LOCAL_WRITE, dst_sg, last);
+        return;
     }
 
     // Trigger the operation
@@ -453,6 +725,17 @@ void cThread::invoke(CoyoteOper oper, localSg src_sg, localSg dst_sg, bool last)
     });
 }
 
+void cThread::invoke(CoyoteOper oper, cardCopySg sg, bool last) {
+    if (!isLocalCardCopy(oper)) {
+        throw std::runtime_error("ERROR: cThread::invoke() called with cardCopySg flags, but the operation is not a LOCAL_CARD_COPY; exiting...");
+    }
+
+    // Same as in hardware, the copy goes through the card streams of the vFPGA
+    localSg src_sg = { .addr = sg.src_addr, .len = sg.len, .stream = STRM_CARD, .dest = sg.dest };
+    localSg dst_sg = { .addr = sg.dst_addr, .len = sg.len, .stream = STRM_CARD, .dest = sg.dest };
+    invoke(oper, src_sg, dst_sg, last);
+}
+
 void cThread::invoke(CoyoteOper oper, rdmaSg sg, bool last) {
     ASSERT("Networking not implemented in simulation target!")
 }
@@ -461,10 +744,105 @@ void cThread::invoke(CoyoteOper oper, tcpSg sg, bool last) {
     ASSERT("Networking not implemented in simulation target!")
 }
 
+localPrep cThread::prepare(CoyoteOper oper, const localSg &sg, bool last) const {
+    if (!isLocalRead(oper) && !isLocalWrite(oper)) {
+        throw std::runtime_error("ERROR: cThread::prepare() called with localSg flags, but the operation is not a LOCAL_READ or LOCAL_WRITE; exiting...");
+    }
+
+    if (isLocalRead(oper) && isLocalWrite(oper)) {
+        throw std::runtime_error("ERROR: cThread::prepare() called with one localSg for a LOCAL_TRANSFER; exiting...");
+    }
+
+    // The simulation has no command encoding; the prepared operation just keeps the entries
+    localPrep prep;
+    prep.oper = oper;
+    prep.last = last;
+    if (isLocalRead(oper)) {
+        prep.src_sg = sg;
+    } else {
+        prep.dst_sg = sg;
+    }
+    return prep;
+}
+
+localPrep cThread::prepare(CoyoteOper oper, const localSg &src_sg, const localSg &dst_sg, bool last) const {
+    if (!(isLocalRead(oper) && isLocalWrite(oper))) {
+        throw std::runtime_error("ERROR: cThread::prepare() called with two localSg flags, but the operation is not a LOCAL_TRANSFER; exiting...");
+    }
+
+    localPrep prep;
+    prep.oper = oper;
+    prep.src_sg = src_sg;
+    prep.dst_sg = dst_sg;
+    prep.last = last;
+    return prep;
+}
+
+void cThread::invoke(const localPrep &prep) {
+    invokePrepared(prep, 0, prep.src_sg.len, prep.dst_sg.len);
+}
+
+void cThread::invoke(const localPrep &prep, uint64_t offs, uint64_t len) {
+    invokePrepared(prep, offs, len, len);
+}
+
+void cThread::invokePrepared(const localPrep &prep, uint64_t offs, uint64_t src_len, uint64_t dst_len) {
+    localSg src_sg = prep.src_sg, dst_sg = prep.dst_sg;
+    src_sg.addr = (void *) ((uint64_t) src_sg.addr + offs);
+    src_sg.len = src_len;
+    dst_sg.addr = (void *) ((uint64_t) dst_sg.addr + offs);
+    dst_sg.len = dst_len;
+
+    if (isLocalRead(prep.oper) && isLocalWrite(prep.oper)) {
+        invoke(prep.oper, src_sg, dst_sg, prep.last);
+    } else {
+        invoke(prep.oper, isLocalRead(prep.oper) ? src_sg : dst_sg, prep.last);
+    }
+}
+
+void cThread::invokeLocalBatch(CoyoteOper oper, const localSg *sgs, size_t n) {
+    if (isLocalRead(oper) && isLocalWrite(oper)) {
+        throw std::runtime_error("ERROR: cThread::invokeBatch() does not support LOCAL_TRANSFER; exiting...");
+    }
+
+    // The simulation has no doorbell cost, so the batch is simply forwarded entry by entry
+    for (size_t i = 0; i < n; i++) {
+        invoke(oper, sgs[i], i == n - 1);
+    }
+    DEBUG("invokeBatch(...) finished")
+}
+
+void cThread::invokeBatch(CoyoteOper oper, const std::vector<localSg> &sgs) {
+    invokeLocalBatch(oper, sgs.data(), sgs.size());
+}
+
+void cThread::invoke(CoyoteOper oper, const localSg *sgs, size_t n) {
+    for (size_t i = 1; i < n; i++) {
+        if (sgs[i].dest != sgs[0].dest || sgs[i].stream != sgs[0].stream) {
+            throw std::runtime_error("ERROR: cThread::invoke() - all the entries of a vectored operation must target the same stream and dest, exiting...");
+        }
+    }
+
+    invokeLocalBatch(oper, sgs, n);
+}
+
+void cThread::invokeBatch(CoyoteOper oper, const std::vector<rdmaSg> &sgs) {
+    ASSERT("Networking not implemented in simulation target!")
+}
+
+void cThread::invokeChain(CoyoteOper oper, const rdmaSg &tmpl, const std::vector<rdmaChainSg> &chain) {
+    ASSERT("Networking not implemented in simulation target!")
+}
+
 uint32_t cThread::checkCompleted(CoyoteOper oper) const {
     if (isRemoteRdma(oper)) {ASSERT("Networking not implemented in simulation target!")}
     if (isRemoteTcp(oper)) {ASSERT("Networking not implemented in simulation target!")}
 
+    // Card copies are LOCAL_TRANSFERs on the card streams; the testbench only knows the latter
+    if (isLocalCardCopy(oper)) {
+        oper = CoyoteOper::LOCAL_TRANSFER;
+    }
+
     // Based on the type of operation, check completion via a read access to the configuration registers 
     uint32_t result;
     additional_state->executeUnlessCrash([&] { 
@@ -479,6 +857,22 @@ uint32_t cThread::checkCompleted(CoyoteOper oper) const {
     return result;
 }
 
+uint32_t cThread::checkCompleted(CoyoteOper oper, uint32_t qp) const {
+    ASSERT("Networking not implemented in simulation target!")
+}
+
+bool cThread::waitCompleted(CoyoteOper oper, uint32_t target, std::chrono::nanoseconds timeout, std::chrono::nanoseconds spin) const {
+    // There is no writeback cache line to monitor in simulation; each check is a round trip to the simulator anyway
+    auto start = std::chrono::steady_clock::now();
+    while (checkCompleted(oper) < target) {
+        if (timeout.count() >= 0 && std::chrono::steady_clock::now() - start >= timeout) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::nanoseconds(SLEEP_TIME));
+    }
+    return true;
+}
+
 void cThread::clearCompleted() {
     additional_state->executeUnlessCrash([&] { 
         additional_state->input_writer.clearCompleted();
@@ -490,7 +884,23 @@ void cThread::doArpLookup(uint32_t ip_addr) {
     ASSERT("Networking not implemented in simulation target")
 }
 
-void cThread::writeQpContext(uint32_t port) {
+#ifdef EN_TCP_EXPERIMENTAL
+bool cThread::tcpListen(uint16_t port, uint32_t dest) {
+    ASSERT("Networking not implemented in simulation target")
+    return false;
+}
+
+bool cThread::tcpOpen(uint32_t ip_addr, uint16_t port, uint32_t dest) {
+    ASSERT("Networking not implemented in simulation target")
+    return false;
+}
+
+void cThread::tcpClose(uint32_t dest) {
+    ASSERT("Networking not implemented in simulation target")
+}
+#endif
+
+void cThread::writeQpContext(uint32_t port, uint32_t qp) {
     ASSERT("Networking not implemented in simulation target")
 }
  
@@ -507,11 +917,41 @@ void cThread::connSync(bool client) {
     ASSERT("Networking not implemented in simulation target")
 }
 
+void cThread::rdmaSync(uint32_t qp) {
+    ASSERT("Networking not implemented in simulation target")
+}
+
+void cThread::rdmaBarrier(const std::vector<uint32_t> &qps, uint32_t rank) {
+    ASSERT("Networking not implemented in simulation target")
+}
+
 void* cThread::initRDMA(uint32_t buffer_size, uint16_t port, const char* server_address) {
     ASSERT("Networking not implemented in simulation target")
     return nullptr;
 }
 
+std::vector<uint32_t> cThread::connectPeers(const std::vector<std::string> &peers, uint32_t rank, void *buffer, uint32_t size, uint16_t port) {
+    ASSERT("Networking not implemented in simulation target")
+}
+
+uint32_t cThread::registerMr(void *vaddr, uint64_t size) {
+    ASSERT("Networking not implemented in simulation target")
+}
+
+uint32_t cThread::getNumRemoteMrs(uint32_t qp) const { return 0; }
+
+uint32_t cThread::addQp() {
+    ASSERT("Networking not implemented in simulation target")
+}
+
+void cThread::connectQp(uint32_t qp, void *buffer, uint32_t size, uint16_t port, const char* server_address) {
+    ASSERT("Networking not implemented in simulation target")
+}
+
+void cThread::reconnectQp(uint32_t qp, uint16_t port, const char* server_address) {
+    ASSERT("Networking not implemented in simulation target")
+}
+
 void cThread::closeConn() {
     ASSERT("Networking not implemented in simulation target")
 }
@@ -524,13 +964,72 @@ void cThread::unlock() {
     ASSERT("Scheduling not implemented in simulation target")
 }
 
+void cThread::reset(pid_t hpid) {
+    ASSERT("Scheduling not implemented in simulation target")
+}
+
+void cThread::setLockBackend(CoyoteLock backend) { lock_backend = backend; }
+
+CoyoteLock cThread::getLockBackend() const { return lock_backend; }
+
+void cThread::setBackoff(CoyoteBackoff policy) { backoff = policy; }
+
+CoyoteBackoff cThread::getBackoff() const { return backoff; }
+
+// Commands are passed to the simulator through a pipe, so there is no write-combined mapping to set up
+void cThread::setWriteCombining(bool enable) {
+    if (enable) additional_state->write_combining.insert(this); else additional_state->write_combining.erase(this);
+}
+
+bool cThread::getWriteCombining() const { return additional_state->write_combining.count(this) > 0; }
+
+// RDMA WRITEs are not paced in simulation, since networking is not implemented; the settings are only kept
+void cThread::setRdmaPacing(CoyotePacing mode, uint32_t max_window) {
+    if (!max_window) {
+        throw std::runtime_error("ERROR: cThread::setRdmaPacing() called with an empty window");
+    }
+    pacing_mode = mode;
+    pacing_max_window = max_window;
+}
+
+CoyotePacing cThread::getRdmaPacing() const { return pacing_mode; }
+
+uint32_t cThread::getRdmaWindow(uint32_t qp) const { return pacing_max_window; }
+
+uint32_t cThread::pollNotifications() {
+    // Interrupts are delivered by the interrupt thread in the simulation, see the constructor
+    return 0;
+}
+
+uint32_t cThread::getDroppedNotifications() const { return 0; }
+
+CoyoteNotify cThread::getNotifyMode() const { return notify_mode; }
+
+int32_t cThread::getNumaNode() const { return numa_node; }
+
 int32_t cThread::getVfid() const { return vfid;};
 
 int32_t cThread::getCtid() const { return ctid; };
 
 pid_t  cThread::getHpid() const { return hpid; };
 
-ibvQp* cThread::getQpair() const { return qpair.get(); }
+ibvQp* cThread::getQpair(uint32_t qp) const { return qpAt(qp); }
+
+uint32_t cThread::getNumQps() const { return 1 + extra_qpairs.size(); }
+
+ibvQp* cThread::qpAt(uint32_t qp) const {
+    if (qp == 0) {
+        return qpair.get();
+    }
+    if (qp > extra_qpairs.size()) {
+        throw std::runtime_error("ERROR: QP index out of range");
+    }
+    return extra_qpairs[qp - 1].second.get();
+}
+
+int32_t cThread::qpCtid(uint32_t qp) const {
+    return qp == 0 ? ctid : extra_qpairs.at(qp - 1).first;
+}
 
 void cThread::printDebug() const {
     std::cout << std::setw(35) << "Sent local reads: \t-" << std::endl;
@@ -543,4 +1042,61 @@ void cThread::printDebug() const {
     std::cout << std::setw(35) << "Notifications received: \t-" << std::endl;	
 } 
 
+void cThread::setTimingTrace(bool enable) {
+    if (enable) additional_state->output_reader.clearTimings();
+    additional_state->executeUnlessCrash([&] { 
+        additional_state->input_writer.setTiming(enable);
+    });
+}
+
+std::vector<simReqTiming> cThread::getTimings() const {
+    return additional_state->output_reader.getTimings();
+}
+
+void cThread::printTimingSummary() const {
+    struct summary_t {
+        uint64_t n_reqs = 0;
+        uint64_t latency = 0, max_latency = 0;   // Issue to completion
+        uint64_t transfer = 0, max_transfer = 0; // First to last data beat
+    };
+    std::map<std::pair<int, bool>, summary_t> summaries;
+
+    for (auto &timing : getTimings()) {
+        auto &summary = summaries[{static_cast<int>(timing.oper), timing.rd}];
+        uint64_t latency = timing.completion_cycle - timing.issue_cycle;
+        uint64_t transfer = timing.last_beat_cycle - timing.first_beat_cycle;
+        summary.n_reqs++;
+        summary.latency += latency;
+        summary.max_latency = std::max(summary.max_latency, latency);
+        summary.transfer += transfer;
+        summary.max_transfer = std::max(summary.max_transfer, transfer);
+    }
+
+    std::cout << "-- TIMING - ID: cThread ID" << ctid << ", vFPGA ID" << vfid << " (in clock cycles)" << std::endl;
+    std::cout << "-----------------------------------------------" << std::endl;
+    for (auto &entry : summaries) {
+        auto &summary = entry.second;
+        std::cout << "Oper " << entry.first.first << (entry.first.second ? " (read)" : " (write)") << ": " << summary.n_reqs << " requests" << std::endl;
+        std::cout << std::setw(35) << "Avg. latency: \t" << summary.latency / summary.n_reqs << std::endl;
+        std::cout << std::setw(35) << "Max. latency: \t" << summary.max_latency << std::endl;
+        std::cout << std::setw(35) << "Avg. transfer: \t" << summary.transfer / summary.n_reqs << std::endl;
+        std::cout << std::setw(35) << "Max. transfer: \t" << summary.max_transfer << std::endl;
+    }
+    std::cout << std::endl;
+}
+
+void cThread::writeTimingCsv(const std::string &file_name) const {
+    std::ofstream csv(file_name);
+    if (!csv) {
+        throw std::runtime_error("ERROR: Could not open " + file_name);
+    }
+
+    csv << "oper,rd,strm,dest,vaddr,len,issue_cycle,first_beat_cycle,last_beat_cycle,completion_cycle" << std::endl;
+    for (auto &timing : getTimings()) {
+        csv << static_cast<int>(timing.oper) << "," << timing.rd << "," << timing.strm << "," << timing.dest << "," 
+            << timing.vaddr << "," << timing.len << "," << timing.issue_cycle << "," << timing.first_beat_cycle << "," 
+            << timing.last_beat_cycle << "," << timing.completion_cycle << std::endl;
+    }
+}
+
 }
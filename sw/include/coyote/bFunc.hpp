@@ -30,6 +30,7 @@
 #include <string>
 #include <vector>
 
+#include <coyote/cTask.hpp>
 #include <coyote/cThread.hpp>
 
 namespace coyote {
@@ -52,7 +53,7 @@ class bFunc {
 public:
     virtual ~bFunc() {}
 
-    virtual std::vector<char> run(cThread* coyote_thread, const std::vector<std::vector<char>>& args) = 0;
+    virtual std::vector<char> run(cThread* coyote_thread, const cTaskArgs& args) = 0;
 
     virtual int32_t getFid() const = 0;
 
@@ -62,9 +63,15 @@ public:
 
     virtual void setBitstreamPointer(std::pair<void*, uint32_t> bitstream_pointer) = 0;
     
-    virtual std::vector<size_t> getArgumentSizes() const = 0;
+    virtual const std::vector<size_t>& getArgumentSizes() const = 0;
     
     virtual size_t getReturnSize() const = 0;
+
+    /// Whether tasks of this function can execute concurrently with other concurrent tasks (of other Coyote threads) on the same vFPGA
+    virtual bool isConcurrent() const = 0;
+
+    /// Whether the function is a pure function of its arguments, so that its results can be cached by the cService (see cResultCache)
+    virtual bool isCacheable() const = 0;
 };
 
 }
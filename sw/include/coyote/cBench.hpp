@@ -29,28 +29,221 @@
 
 #include <chrono>
 #include <vector>
+#include <thread>
+#include <atomic>
+#include <random>
+#include <string>
+#include <ostream>
+#include <stdexcept>
 #include <algorithm>
+#include <pthread.h>
+#include <sched.h>
 
 #include <coyote/cDefs.hpp>
+#include <coyote/cStats.hpp>
+#include <coyote/cTimer.hpp>
 
 namespace coyote {
 
+/**
+ * @brief Latencies and throughput of a benchmark run; of one thread, or merged over the threads of the run
+ *
+ * Latencies are kept in a cHdrHistogram, so that long runs need constant memory and the results of several threads 
+ * can be merged; the percentiles are accurate to within 2^-sub_bits of the value, while the average, minimum and maximum are exact
+ */
+class cBenchResult {
+
+private:
+    double elapsed = { 0 };
+    uint64_t bytes_per_op = { 0 };
+    uint64_t bytes = { 0 };
+    cHdrHistogram latencies;
+
+public:
+    /// Default constructor; bytes_per_op is used for getGBps(), sub_bits sets the precision of the percentiles (see cHdrHistogram)
+    cBenchResult(uint64_t bytes_per_op = 0, int sub_bits = HDR_HIST_SUB_BITS);
+
+    /// Records the latency (in ns) of one operation
+    void record(double latency);
+
+    /**
+     * @brief Merges the result of another thread of the same run
+     *
+     * The operations, bytes and latencies are summed up; since the threads of a run start at the same time, 
+     * the elapsed time of the merged result is the longest of the threads'
+     */
+    void merge(const cBenchResult &other);
+
+    /// Sets the (wall-clock) time taken by the run, in ns
+    void setElapsed(double elapsed);
+
+    /// Returns the number of recorded operations
+    uint64_t getOps() const;
+
+    /// Returns the (wall-clock) time taken by the run, in ns
+    double getElapsed() const;
+
+    /// Returns the throughput, in operations per second
+    double getOpsPerSec() const;
+
+    /// Returns the throughput, in GB/s (10^9 bytes per second)
+    double getGBps() const;
+
+    /// Returns the latency histogram
+    const cHdrHistogram& getLatencies() const;
+
+    /// Returns the mean latency, in ns
+    double getAvg() const;
+
+    /// Returns the minimum latency, in ns
+    double getMin() const;
+
+    /// Returns the maximum latency, in ns
+    double getMax() const;
+
+    /**
+     * @brief Returns a latency percentile, in ns (nearest-rank)
+     *
+     * @param p Percentile, in (0, 100]
+     */
+    double getPercentile(double p) const;
+};
+
+/// @brief Load of a benchmark run, see cBench::run()
+struct cBenchLoad {
+    /// Number of threads generating load concurrently
+    unsigned int n_threads = { 1 };
+
+    /// If non-zero, each thread runs for (at least) this long instead of n_runs operations
+    std::chrono::nanoseconds duration = std::chrono::nanoseconds(0);
+
+    /**
+     * Open-loop arrival rate per thread, in operations per second; the operations arrive as a Poisson process, and the latency 
+     * of an operation is measured from its arrival, so it includes the time spent waiting for the previous ones to complete.
+     * If 0, the load is closed-loop: each thread issues the next operation as soon as the previous completed
+     */
+    double rate = { 0 };
+
+    /// Bytes transferred by each operation, for the throughput in GB/s
+    uint64_t bytes_per_op = { 0 };
+
+    /// If not empty, the bytes transferred by each operation of thread t are thread_bytes_per_op[t] (e.g., tenants with different transfer sizes)
+    std::vector<uint64_t> thread_bytes_per_op;
+
+    /// If not empty, thread t is pinned to CPU cpus[t % cpus.size()] for the whole run (warm-ups included)
+    std::vector<int> cpus;
+};
+
 /**
  * @brief Helper class for benchmarking various functions in Coyote
  *
  * At a high-level, it executes some function a number of times and records its duration
  * Then, it can be used for outputting run-time statistics, such as average, minimum, maximum etc.
+ * Besides measuring one invocation at a time (execute()), it can generate load from several threads, for a fixed duration 
+ * and with an open-loop arrival rate (run()); the results can be exported as CSV or JSON.
  */
 class cBench {
 
 private:
     unsigned int n_runs;
     unsigned int n_warmups;
+    bool keep_samples;
+    int sub_bits = { HDR_HIST_SUB_BITS };
+    CoyoteTimer timer = { CoyoteTimer::CHRONO };
     std::vector<double> measured_times;
+
+    /// Result of the last run, per thread
+    std::vector<cBenchResult> thread_results;
+
+    /// Result of the last run, merged over all threads
+    cBenchResult merged_result;
+
+    /// Merges the results of the threads, after a run
+    void mergeResults();
+
+    /// Writes one result as a CSV row or JSON object
+    static void writeCsvRow(std::ostream &out, const std::string &thread, const cBenchResult &result);
+    static void writeJsonObject(std::ostream &out, const cBenchResult &result);
+
+    /**
+     * @brief Load generated by one thread of run()
+     *
+     * The threads run their warm-ups, then wait for each other (on ready), so that the measured phases overlap
+     */
+    template <class BenchFunc, class PrepFunc>
+    void runThread(unsigned int tid, const cBenchLoad &load, BenchFunc const &bench_func, PrepFunc const &prep_func, std::atomic<unsigned int> &ready) {
+        cBenchResult &result = thread_results[tid];
+
+        if (!load.cpus.empty()) {
+            cpu_set_t cpu_set;
+            CPU_ZERO(&cpu_set);
+            CPU_SET(load.cpus[tid % load.cpus.size()], &cpu_set);
+            if (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set)) {
+                std::cerr << "WARNING: Failed to pin benchmark thread " << tid << " to CPU " << load.cpus[tid % load.cpus.size()] << std::endl;
+            }
+        }
+
+        for (unsigned int i = 0; i < this->n_warmups; i++) {
+            prep_func(tid);
+            bench_func(tid);
+        }
+
+        ready++;
+        while (ready < load.n_threads) {
+            std::this_thread::yield();
+        }
+
+        // All times in ticks of the time source; the arrivals are drawn in ns and converted
+        double ns_per_tick = ticksToNs(1);
+        uint64_t duration = (uint64_t) (load.duration.count() / ns_per_tick);
+        std::mt19937_64 rng(tid);
+        std::exponential_distribution<double> inter_arrival(load.rate > 0 ? load.rate / 1e9 : 1.0);
+        uint64_t begin_time = timestamp();
+        double arrival = begin_time;
+        for (uint64_t i = 0; ; i++) {
+            if (duration ? timestamp() - begin_time >= duration : i >= this->n_runs) {
+                break;
+            }
+
+            prep_func(tid);
+
+            // Open loop: wait for the arrival of this operation, unless it is already overdue
+            uint64_t start_time = timestamp();
+            if (load.rate > 0) {
+                arrival += inter_arrival(rng) / ns_per_tick;
+                while (timestamp() < (uint64_t) arrival) {
+                    std::this_thread::yield();
+                }
+                start_time = (uint64_t) arrival;
+            }
+
+            bench_func(tid);
+            uint64_t end_time = timestamp();
+            result.record(ticksToNs(end_time - start_time));
+        }
+
+        result.setElapsed(ticksToNs(timestamp() - begin_time));
+    }
+
+    /// Reads the time source set by setTimer(), in ticks (ns for CoyoteTimer::CHRONO)
+    inline uint64_t timestamp() const {
+        if (timer == CoyoteTimer::TSC) {
+            return cTsc::now();
+        }
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::high_resolution_clock::now().time_since_epoch()).count();
+    }
+
+    /// Converts ticks of the time source to ns
+    inline double ticksToNs(uint64_t ticks) const { return timer == CoyoteTimer::TSC ? cTsc::toNs(ticks) : (double) ticks; }
     
 public:
-    /// Default constructor; user can define number of test runs and also the number of warm-up runs, which don't affect time measurements
-    cBench(unsigned int n_runs = 1000, unsigned int n_warmups = 100);
+    /**
+     * @brief Default constructor; user can define number of test runs and also the number of warm-up runs, which don't affect time measurements
+     *
+     * The statistics are always computed from latency histograms (constant memory); keep_samples additionally keeps every 
+     * time measured by execute(), for getAll(); it should be disabled for long (soak) runs, since it needs 8 bytes per run
+     */
+    cBench(unsigned int n_runs = 1000, unsigned int n_warmups = 100, bool keep_samples = true);
 
     /**
      * Benchmark function execution (measure the duration)
@@ -72,6 +265,10 @@ public:
     void execute(BenchFunc const &bench_func, BenchArgs... bench_args, PrepFunc const &prep_func, PrepArgs... prep_args) {
         // Clear previous results
         measured_times.clear();
+        thread_results.assign(1, cBenchResult(0, sub_bits));
+        if (keep_samples) {
+            measured_times.reserve(this->n_runs);
+        }
 
         // Run a few warm-up runs; this is particularly useful for AVX architectures and code running on GPUs
         for (int i = 0; i < this->n_warmups; i++) {
@@ -80,21 +277,88 @@ public:
         }
 
         // Run the benchmark for a given number of repetitions
+        double elapsed = 0;
         for (int i = 0; i < this->n_runs; i++) {
             // Calculate elapsed time - start timer, execute the function (which is given as an argument) and stop timer afterwards 
             prep_func(prep_args...);
-            auto begin_time = std::chrono::high_resolution_clock::now();
+            uint64_t begin_time = timestamp();
             bench_func(bench_args...);
-            auto end_time = std::chrono::high_resolution_clock::now();
-            double measured_time = std::chrono::duration_cast<std::chrono::nanoseconds>(end_time - begin_time).count();
-            measured_times.emplace_back(measured_time);
+            uint64_t end_time = timestamp();
+            double measured_time = ticksToNs(end_time - begin_time);
+            if (keep_samples) {
+                measured_times.emplace_back(measured_time);
+            }
+            thread_results[0].record(measured_time);
+            elapsed += measured_time;
+        }
+
+        // Only the benchmarked function is timed, so the throughput excludes the prep work
+        thread_results[0].setElapsed(elapsed);
+        mergeResults();
+    }
+
+    /**
+     * @brief Benchmarks a function under load: from several threads, for a fixed duration and/or at a given arrival rate
+     *
+     * Each thread runs n_warmups warm-up operations, and then n_runs operations (or operations for load.duration); 
+     * before every operation, the prep function is executed. Both functions are called with the index of the thread, 
+     * in [0, load.n_threads), so that each thread can use its own resources (e.g., its own cThread).
+     * The elapsed time of a thread covers the complete measured phase, including the prep work.
+     * With load.cpus set, each thread is pinned to its own CPU, so that the threads do not interfere on the host side.
+     *
+     * @param load Load to generate
+     * @param bench_func Function to be benchmarked, void(unsigned int thread)
+     * @param prep_func Function executed before each operation of a thread, void(unsigned int thread); not timed
+     */
+    template <class BenchFunc, class PrepFunc>
+    void run(const cBenchLoad &load, BenchFunc const &bench_func, PrepFunc const &prep_func) {
+        if (!load.n_threads) {
+            throw std::runtime_error("ERROR: cBench::run() called without threads");
         }
 
-        // Sort the results after logging to a file; enables easier calculation of the statistics below
-        std::sort(measured_times.begin(), measured_times.end());
+        if (!load.thread_bytes_per_op.empty() && load.thread_bytes_per_op.size() != load.n_threads) {
+            throw std::runtime_error("ERROR: cBench::run() called with bytes per operation for " + std::to_string(load.thread_bytes_per_op.size()) + 
+                                     " threads, but " + std::to_string(load.n_threads) + " threads");
+        }
+
+        measured_times.clear();
+        thread_results.clear();
+        for (unsigned int t = 0; t < load.n_threads; t++) {
+            thread_results.emplace_back(load.thread_bytes_per_op.empty() ? load.bytes_per_op : load.thread_bytes_per_op[t], sub_bits);
+        }
+
+        std::atomic<unsigned int> ready(0);
+        std::vector<std::thread> threads;
+        for (unsigned int t = 1; t < load.n_threads; t++) {
+            threads.emplace_back([&, t] { runThread(t, load, bench_func, prep_func, ready); });
+        }
+        runThread(0, load, bench_func, prep_func, ready);
+        for (std::thread &t : threads) {
+            t.join();
+        }
+
+        mergeResults();
     }
 
-    /// Returns all recorded execution times as a vector
+    /**
+     * @brief Sets the precision of the latency histograms of the following runs
+     *
+     * @param sub_bits Log2 of the number of buckets per power of two, see cHdrHistogram; HDR_HIST_SUB_BITS by default
+     */
+    void setPrecision(int sub_bits);
+
+    /**
+     * @brief Sets the time source of the following runs
+     *
+     * CoyoteTimer::TSC reduces the overhead per measurement to a few ns, which matters for sub-microsecond operations; 
+     * the TSC is calibrated on the first use (see cTsc), so this call may take TSC_CALIBRATION_TIME
+     */
+    void setTimer(CoyoteTimer timer);
+
+    /// Getter: time source
+    CoyoteTimer getTimer() const;
+
+    /// Returns all recorded execution times of execute() as a vector, in the order of execution; empty unless keep_samples is set
     std::vector<double> getAll();
     
     /// Returns the mean execution time; averaged over n_runs
@@ -120,6 +384,27 @@ public:
 
     /// Returns the P99 execution time out of the n_runs recorded times
     double getP99();
+
+    /// Returns the P99.9 execution time out of the n_runs recorded times
+    double getP999();
+
+    /// Returns the P99.99 execution time out of the n_runs recorded times
+    double getP9999();
+
+    /// Returns the result of the last run (execute() or run()), merged over all its threads
+    const cBenchResult& getResult() const;
+
+    /// Returns the result of one thread of the last run
+    const cBenchResult& getResult(unsigned int thread) const;
+
+    /// Returns the number of threads of the last run
+    unsigned int getThreads() const;
+
+    /// Writes the results of the last run as CSV: a header (if requested), one row per thread and one for the merged result
+    void writeCsv(std::ostream &out, bool header = true) const;
+
+    /// Writes the results of the last run as a JSON object, with the per-thread results and the merged result
+    void writeJson(std::ostream &out) const;
 };
 }
 
@@ -0,0 +1,197 @@
+/*
+ * This file is part of the Coyote <https://github.com/fpgasystems/Coyote>
+ *
+ * MIT Licence
+ * Copyright (c) 2025, Systems Group, ETH Zurich
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _COYOTE_CBUFFER_HPP_
+#define _COYOTE_CBUFFER_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
+#if __cplusplus >= 202002L && __has_include(<span>)
+#include <span>
+#endif
+
+#include <coyote/cOps.hpp>
+#include <coyote/cThread.hpp>
+
+namespace coyote {
+
+/**
+ * @brief Typed, non-owning view of (a part of) a buffer mapped into the vFPGA's TLB
+ *
+ * A pointer and an element count, with the scatter-gather entries of the viewed range; the lengths are computed from the
+ * element count, so they can never get out of sync with the data. Views are cheap to copy and to take sub-views of, 
+ * but they don't keep the buffer alive; they must not outlive the cBuffer (or the mapping) they were taken from.
+ */
+template <typename T>
+class cBufferView {
+
+protected:
+    /// First element of the view
+    T *ptr = { nullptr };
+
+    /// Number of elements in the view
+    size_t n = { 0 };
+
+public:
+    cBufferView() = default;
+
+    cBufferView(T *ptr, size_t n) : ptr(ptr), n(n) {}
+
+    /// Pointer to the first element
+    T* data() const { return ptr; }
+
+    /// Number of elements
+    size_t size() const { return n; }
+
+    /// Size of the view, in bytes
+    uint64_t bytes() const { return n * sizeof(T); }
+
+    bool empty() const { return n == 0; }
+
+    T* begin() const { return ptr; }
+    T* end() const { return ptr + n; }
+
+    /// Unchecked element access, as for raw pointers; the loops over views vectorize the same
+    T& operator[](size_t i) const { return ptr[i]; }
+
+    /**
+     * @brief Returns a view of count elements, starting from element offset
+     *
+     * @param offset First element of the sub-view
+     * @param count Number of elements; clamped to the end of this view
+     */
+    cBufferView<T> subview(size_t offset, size_t count = SIZE_MAX) const {
+        if (offset > n) {
+            throw std::out_of_range("ERROR: cBufferView::subview() offset out of range, exiting...");
+        }
+        return cBufferView<T>(ptr + offset, std::min(count, n - offset));
+    }
+
+    /**
+     * @brief Scatter-gather entry of the viewed range, for local transfers (LOCAL_READ, LOCAL_WRITE, LOCAL_TRANSFER)
+     *
+     * @param stream Buffer stream: HOST or CARD
+     * @param dest Target AXI4 destination stream in the vFPGA
+     */
+    localSg sg(uint32_t stream = STRM_HOST, uint32_t dest = 0) const {
+        return localSg { (void *) ptr, bytes(), stream, dest };
+    }
+
+    /// Scatter-gather entry of the viewed range, for syncing and off-loading it (LOCAL_SYNC, LOCAL_OFFLOAD)
+    syncSg sync(bool host_unchanged = false) const {
+        return syncSg { (void *) ptr, bytes(), host_unchanged };
+    }
+
+    /// Views of non-const elements convert to views of const elements
+    operator cBufferView<const T>() const { return cBufferView<const T>(ptr, n); }
+
+#if __cplusplus >= 202002L && __has_include(<span>)
+    /// Viewed range as a std::span (C++20)
+    std::span<T> span() const { return std::span<T>(ptr, n); }
+#endif
+
+};
+
+/**
+ * @brief Typed buffer of n elements, allocated with cThread::getMem() and freed (unmapped) when the buffer is destroyed
+ *
+ * Replaces the untyped getMem()/freeMem() pairs; the buffer is move-only, so every allocation has exactly one owner.
+ * The buffer itself is a view of all its elements, see cBufferView, e.g.:
+ *
+ *     cBuffer<int> src(&cthread, n), dst(&cthread, n);
+ *     for (size_t i = 0; i < src.size(); i++) { src[i] = i; }
+ *     localSg src_sg = src.sg(), dst_sg = dst.subview(0, n / 2).sg();
+ *     cthread.invoke(CoyoteOper::LOCAL_TRANSFER, src_sg, dst_sg);
+ *
+ * @note T must be trivially copyable, since the elements are read and written by the vFPGA; they are not constructed
+ */
+template <typename T>
+class cBuffer : public cBufferView<T> {
+    static_assert(std::is_trivially_copyable<T>::value, "cBuffer elements must be trivially copyable");
+
+    /// cThread into whose TLB the buffer is mapped
+    cThread *cthread = { nullptr };
+
+public:
+    cBuffer() = default;
+
+    /**
+     * @brief Allocates and maps a buffer of n elements
+     *
+     * @param cthread cThread, into whose TLB the buffer is mapped; must outlive the buffer
+     * @param n Number of elements
+     * @param alloc Allocation parameters (type, NUMA node, memory block etc.); the size is set from n
+     */
+    cBuffer(cThread *cthread, size_t n, CoyoteAlloc alloc = { CoyoteAllocType::HPF }) : cthread(cthread) {
+        alloc.size = n * sizeof(T);
+        this->ptr = static_cast<T*>(cthread->getMem(std::move(alloc)));
+        if (this->ptr == nullptr) {
+            throw std::runtime_error("ERROR: cBuffer could not be allocated, exiting...");
+        }
+        this->n = n;
+    }
+
+    ~cBuffer() { release(); }
+
+    cBuffer(const cBuffer&) = delete;
+    cBuffer& operator=(const cBuffer&) = delete;
+
+    cBuffer(cBuffer &&other) noexcept : cBufferView<T>(other.ptr, other.n), cthread(other.cthread) {
+        other.ptr = nullptr;
+        other.n = 0;
+    }
+
+    cBuffer& operator=(cBuffer &&other) noexcept {
+        if (this != &other) {
+            release();
+            std::swap(this->ptr, other.ptr);
+            std::swap(this->n, other.n);
+            cthread = other.cthread;
+        }
+        return *this;
+    }
+
+    /// View of all the elements
+    cBufferView<T> view() const { return cBufferView<T>(this->ptr, this->n); }
+
+    /// Frees the buffer (if any) before the destructor; the buffer is then empty
+    void release() {
+        if (this->ptr != nullptr) {
+            cthread->freeMem(this->ptr);
+            this->ptr = nullptr;
+            this->n = 0;
+        }
+    }
+
+};
+
+}
+
+#endif // _COYOTE_CBUFFER_HPP_
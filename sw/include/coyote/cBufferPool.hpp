@@ -0,0 +1,122 @@
+/*
+ * This file is part of the Coyote <https://github.com/fpgasystems/Coyote>
+ *
+ * MIT Licence
+ * Copyright (c) 2025, Systems Group, ETH Zurich
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _COYOTE_CBUFFERPOOL_HPP_
+#define _COYOTE_CBUFFERPOOL_HPP_
+
+#include <map>
+#include <mutex>
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+
+#include <coyote/cDefs.hpp>
+#include <coyote/cOps.hpp>
+#include <coyote/cThread.hpp>
+
+namespace coyote {
+
+/**
+ * @brief Pool of pre-allocated, pre-mapped buffers for a cThread
+ *
+ * Every cThread::getMem() call allocates memory and maps it into the vFPGA's TLB (IOCTL_MAP_USER_MEM), 
+ * which pins the pages in the driver; cThread::freeMem() undoes all of it. For services allocating buffers per request
+ * this dominates the run-time. Instead, the pool obtains large slabs through cThread::getMem() (so they are tracked in
+ * the cThread's mapped pages and can be used with cThread::invoke() as any other buffer) and carves them into buffers
+ * of power-of-two size classes. Allocating and releasing buffers from the pool requires no system calls.
+ *
+ * @note The slabs are released when the pool is destroyed, so the pool must not outlive its cThread
+ */
+class cBufferPool {
+
+private:
+    /// cThread into whose TLB the slabs are mapped
+    cThread *cthread;
+
+    /// Type of memory used for the slabs; REG, THP or HPF
+    CoyoteAllocType type;
+
+    /// Default size of a slab, in bytes
+    uint32_t slab_size;
+
+    /// All the slabs obtained from the cThread
+    std::vector<void*> slabs;
+
+    /// Free buffers, for each size class
+    std::map<uint32_t, std::vector<void*>> free_buffs;
+
+    /// Buffers currently handed out, and their size class
+    std::unordered_map<void*, uint32_t> used_buffs;
+
+    /// Pool lock; allocations and releases can happen from multiple threads
+    std::mutex plock;
+
+    /// Returns the size class (smallest power of two >= size, at least PAGE_SIZE) for a given size
+    static uint32_t sizeClass(uint32_t size);
+
+    /// Allocates a new slab and carves it into free buffers of the size class cls; must be called with plock held
+    void grow(uint32_t cls);
+
+public:
+    /**
+     * @brief Default constructor
+     *
+     * @param cthread cThread for which the buffers are allocated
+     * @param type Memory type of the slabs; must be REG, THP or HPF
+     * @param slab_size Size of a slab in bytes; rounded up to a multiple of the (huge) page size. Size classes larger than the slab size use one slab per buffer
+     */
+    cBufferPool(cThread *cthread, CoyoteAllocType type = CoyoteAllocType::HPF, uint32_t slab_size = 16 * HUGE_PAGE_SIZE);
+
+    /// Default destructor; releases all the slabs, including any buffers that weren't returned to the pool
+    ~cBufferPool();
+
+    /**
+     * @brief Pre-allocates buffers, so that later allocations don't need to allocate new slabs
+     *
+     * @param size Buffer size, in bytes
+     * @param n Number of buffers of this size to have available
+     */
+    void reserve(uint32_t size, uint32_t n);
+
+    /**
+     * @brief Obtains a buffer from the pool; allocating a new slab only if there are no free buffers of a matching size class
+     *
+     * @param size Buffer size, in bytes
+     * @return Pointer to the buffer, which is already mapped into the vFPGA's TLB 
+     */
+    void* alloc(uint32_t size);
+
+    /**
+     * @brief Returns a buffer to the pool
+     *
+     * @param buff Buffer, as returned by alloc()
+     */
+    void release(void *buff);
+};
+
+}
+
+#endif // _COYOTE_CBUFFERPOOL_HPP_
@@ -0,0 +1,106 @@
+/*
+ * This file is part of the Coyote <https://github.com/fpgasystems/Coyote>
+ *
+ * MIT Licence
+ * Copyright (c) 2025, Systems Group, ETH Zurich
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _COYOTE_CCMDRING_HPP_
+#define _COYOTE_CCMDRING_HPP_
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+#include <coyote/cDefs.hpp>
+
+namespace coyote {
+
+/**
+ * @brief Shared submission context of a vFPGA: a bounded, lock-free multi-producer ring of DMA commands
+ *
+ * All the cThreads of a process which target the same vFPGA share one ring (see cThread::postCmd()). Any thread pushes
+ * its commands to the ring and then tries to become the drainer; the drainer writes the queued commands of all the threads
+ * to the vFPGA (CTRL_REG), back-to-back. Since only the drainer accesses the command FIFO, the FIFO credits are shared,
+ * so threads do not oversubscribe the FIFO, and the (multi-register) command writes of different threads never interleave.
+ * Commands of a thread are written in the order they were pushed.
+ *
+ * @note The ring is a Vyukov-style bounded queue; a slot's sequence number tells whether it's free, or written and ready to drain
+ */
+class cCmdRing {
+
+private:
+    /// A slot of the ring
+    struct cmdSlot {
+        /// Equal to the position for a free slot, to the position + 1 for a written one
+        std::atomic<uint64_t> seq;
+
+        /// Command, ordered as {offs_3, offs_2, offs_1, offs_0}, see cThread::postCmd()
+        std::array<uint64_t, 4> cmd;
+    };
+
+    /// Next position to write; advanced by the producers
+    alignas(64) std::atomic<uint64_t> head;
+
+    /// Next position to drain; only accessed by the drainer
+    alignas(64) uint64_t tail;
+
+    /// Set while a thread is draining the ring
+    alignas(64) std::atomic<bool> draining;
+
+    /// Slots of the ring
+    alignas(64) cmdSlot slots[CMD_RING_SIZE];
+
+public:
+    /// Number of outstanding commands in the vFPGA command FIFO, as tracked by the software; only accessed by the drainer
+    uint32_t cmd_cnt = { 0 };
+
+    /// Default constructor; creates an empty ring
+    cCmdRing();
+
+    /**
+     * @brief Producer: appends a command
+     *
+     * @param cmd Command, ordered as {offs_3, offs_2, offs_1, offs_0}
+     * @return true if the command was pushed, false if the ring is full
+     */
+    bool push(const std::array<uint64_t, 4> &cmd);
+
+    /**
+     * @brief Drainer: removes the oldest command
+     *
+     * @param cmd Set to the command
+     * @return true if a command was removed, false if there is no (completely written) command
+     */
+    bool pop(std::array<uint64_t, 4> &cmd);
+
+    /// Tries to become the drainer; returns true on success, in which case release() must be called once done
+    bool tryAcquire();
+
+    /// Stops draining; returns true if commands were pushed meanwhile, i.e., the caller should try to drain again
+    bool release();
+
+};
+
+}
+
+#endif // _COYOTE_CCMDRING_HPP_
@@ -0,0 +1,261 @@
+/*
+ * This file is part of the Coyote <https://github.com/fpgasystems/Coyote>
+ *
+ * MIT Licence
+ * Copyright (c) 2025, Systems Group, ETH Zurich
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _COYOTE_CCOLLECTIVE_HPP_
+#define _COYOTE_CCOLLECTIVE_HPP_
+
+#include <vector>
+#include <cstdint>
+#include <functional>
+
+#include <coyote/cDefs.hpp>
+#include <coyote/cOps.hpp>
+#include <coyote/cThread.hpp>
+
+namespace coyote {
+
+/// Element type of a reduction, see cCollective::allreduce()
+enum class CoyoteReduceType {
+    INT32,
+    INT64,
+    FLOAT,
+    DOUBLE
+};
+
+/// Reduction operator, see cCollective::allreduce()
+enum class CoyoteReduceOp {
+    SUM,
+    MIN,
+    MAX
+};
+
+/// Algorithm of a collective; ring is bandwidth-optimal, while the (binary) tree needs fewer steps, i.e., a lower latency
+enum class CoyoteCollectiveAlgo {
+    RING,
+    TREE
+};
+
+/**
+ * @brief Collective operations (allreduce, allgather, broadcast, barrier) over the RDMA QPs connecting the nodes of a job
+ *
+ * A cCollective uses the QPs set up by cThread::connectPeers(), all of which share one buffer; the data of a collective is 
+ * at the same offset of the buffer on all the nodes. The collective also occupies a region of the buffer (see getRegionSize()), 
+ * holding, with an identical layout on all the nodes:
+ *  - Staging rings: transfers are split into segments, which are RDMA-written into the receiver's staging rings and then 
+ *    combined (reduced or copied) into the data; so, up to depth segments per peer are in flight, pipelining the transfers 
+ *  - Flags: one per segment, written after it, with the per-peer sequence number; RDMA WRITEs on a QP are placed in order, 
+ *    so a segment is complete once its flag is visible
+ *  - Credits: the number of segments consumed, returned by the receiver after combining each segment
+ *
+ * The RDMA stack replays a lost packet by re-reading the local memory, so a staging slot or flag is only reused once its 
+ * write has completed, and the data is only overwritten once all of the node's writes have completed.
+ *
+ * @note All the nodes must construct their cCollective (which clears the region) before any of them starts a collective
+ * @note The collectives are blocking and must be called in the same order on all the nodes; the QPs must not be used 
+ *       for other RDMA writes meanwhile, since their completion counters are used to track the collective's writes
+ */
+class cCollective {
+
+public:
+    /// Combines a received segment (src) into the data (dst), both len bytes; see setReducer()
+    typedef std::function<void(void *dst, const void *src, uint64_t len)> reduceFn;
+
+private:
+    /// Staging rings; the one used for a transfer is given by the sender's role in the receiver's ring or tree
+    static constexpr uint32_t const STAGE_RING = 0;
+    static constexpr uint32_t const STAGE_CHILD = 1;
+    static constexpr uint32_t const STAGE_PARENT = 3;
+    static constexpr uint32_t const STAGE_ROOT = 4;
+    static constexpr uint32_t const N_STAGES = 5;
+
+    /// Size of a flag or credit slot, in bytes
+    static constexpr uint64_t const SLOT_SIZE = 64;
+
+    /// cThread holding the QPs
+    cThread *cthread;
+
+    /// QP index for each rank, as returned by cThread::connectPeers()
+    std::vector<uint32_t> qps;
+
+    /// Rank of this node and number of nodes in the job
+    uint32_t rank, n_ranks;
+
+    /// Offset of the collective's region in the buffer
+    uint64_t offset;
+
+    /// Segment size, in bytes, and number of segments in flight per peer
+    uint64_t seg_size;
+    uint32_t depth;
+
+    /// Local base address of the buffer (shared by all the QPs)
+    char *buffer;
+
+    /// Size of the buffer, in bytes
+    uint64_t buffer_size;
+
+    /// Custom reduction, replacing the host-side one if set
+    reduceFn reducer;
+
+    /// Number of segments sent to, and consumed from, each peer
+    std::vector<uint64_t> seq_out, seq_in;
+
+    /// Number of RDMA writes issued on each peer's QP, and the QP's completion counter when the collective was created
+    std::vector<uint32_t> wr_out, wr_base;
+
+    /// Value of wr_out after each of the last depth segments sent to each peer, indexed by peer * depth + slot
+    std::vector<uint32_t> seg_wr;
+
+    /// Chain of the last segment sent, kept to reuse the allocation
+    std::vector<rdmaChainSg> chain;
+
+    /// Offsets of the staging rings, flags and credits within the region
+    uint64_t stageOffs(uint32_t stage, uint64_t slot) const { return ((uint64_t) stage * depth + slot) * seg_size; }
+    uint64_t rxFlagOffs(uint32_t peer, uint64_t slot) const { return N_STAGES * depth * seg_size + ((uint64_t) peer * depth + slot) * SLOT_SIZE; }
+    uint64_t txFlagOffs(uint32_t peer, uint64_t slot) const { return rxFlagOffs(n_ranks, 0) + ((uint64_t) peer * depth + slot) * SLOT_SIZE; }
+    uint64_t rxCreditOffs(uint32_t peer) const { return txFlagOffs(n_ranks, 0) + (uint64_t) peer * SLOT_SIZE; }
+    uint64_t txCreditOffs(uint32_t peer) const { return rxCreditOffs(n_ranks) + (uint64_t) peer * SLOT_SIZE; }
+
+    /// Flag or credit at an offset of the region
+    volatile uint64_t* slotAt(uint64_t offs) const { return (volatile uint64_t*) (buffer + offset + offs); }
+
+    /// Number of completed RDMA writes on a peer's QP, since the collective was created
+    uint32_t completedWrites(uint32_t peer) const;
+
+    /// Sends a segment (at most seg_size bytes, from offset local_offs of the buffer) to a peer's staging ring, if the peer has a free slot
+    bool trySend(uint32_t peer, uint32_t stage, uint64_t local_offs, uint64_t len);
+
+    /// Returns the next segment received from a peer, in one of the staging rings, or nullptr if it hasn't arrived yet
+    const char* tryRecv(uint32_t peer, uint32_t stage) const;
+
+    /// Releases the segment returned by tryRecv(), returning its credit to the peer
+    void release(uint32_t peer);
+
+    /// Waits until all the RDMA writes issued by this node have completed, so that their source memory can be modified
+    void quiet();
+
+    /// Number of segments of a transfer; a transfers of 0 bytes still sends a (flag-only) segment, e.g., for barrier()
+    uint64_t numSegments(uint64_t len) const { return len ? (len + seg_size - 1) / seg_size : 1; }
+
+    /// Length of segment i of a transfer
+    uint64_t segmentLen(uint64_t len, uint64_t i) const { return std::min(seg_size, len - std::min(len, i * seg_size)); }
+
+    /// One step of a ring collective: sends a block to the next rank, while combining the block from the previous rank into the data
+    void ringStep(uint64_t send_offs, uint64_t send_len, uint64_t recv_offs, uint64_t recv_len, const reduceFn &combine);
+
+    /// Reduces the data of all the ranks into rank 0, along a binary tree
+    void treeReduce(uint64_t data_offs, uint64_t len, const reduceFn &combine);
+
+    /**
+     * @brief Broadcasts the data of the root to all the ranks, along the binary tree rooted at rank 0
+     *
+     * Any other root first relays its data to rank 0. A staging ring must always be written by the same peer, since the credits
+     * are per peer; with a tree rooted at the root, the parents (and so the writers of STAGE_PARENT) would change with the root.
+     * Instead, only rank 0's STAGE_ROOT is written by different roots, and a root can only start a broadcast once it received 
+     * all of the previous one, i.e., once rank 0 consumed all of the previous root's segments.
+     */
+    void treeBroadcast(uint64_t data_offs, uint64_t len, uint32_t root);
+
+    /// Checks that a block of data lies within the buffer
+    void checkData(uint64_t data_offs, uint64_t len) const;
+
+public:
+    /**
+     * @brief Creates the collectives for the QPs of a job, and clears its region of the buffer
+     *
+     * @param cthread cThread holding the QPs, connected with cThread::connectPeers()
+     * @param qps QP index for each rank, as returned by cThread::connectPeers()
+     * @param rank Rank of this node
+     * @param offset Offset of the collective's region in the buffer; the region must fit the buffer (see getRegionSize())
+     * @param seg_size Segment size, in bytes (multiple of 64)
+     * @param depth Number of segments in flight per peer
+     */
+    cCollective(
+        cThread *cthread, const std::vector<uint32_t> &qps, uint32_t rank, uint64_t offset = 0, 
+        uint64_t seg_size = COLLECTIVE_SEGMENT_SIZE, uint32_t depth = COLLECTIVE_DEPTH
+    );
+
+    /// Size of the region used by a collective, in bytes
+    static uint64_t getRegionSize(uint32_t n_ranks, uint64_t seg_size = COLLECTIVE_SEGMENT_SIZE, uint32_t depth = COLLECTIVE_DEPTH) {
+        return N_STAGES * depth * seg_size + 2 * (uint64_t) n_ranks * (depth + 1) * SLOT_SIZE;
+    }
+
+    /**
+     * @brief Sets a custom reduction, used by allreduce() instead of the host-side one
+     *
+     * For example, a reduction kernel in the vFPGA can combine the segments on the card, by invoking a CoyoteOper::LOCAL_TRANSFER
+     * from the staging slot and the data to the data, and waiting for its completion. The staging slots and the data are in the 
+     * (mapped) buffer, so they can be passed to the kernel directly. The reduction is called with len bytes of whole elements.
+     *
+     * @param fn Reduction; an empty function restores the host-side reduction
+     */
+    void setReducer(reduceFn fn) { reducer = fn; }
+
+    /**
+     * @brief Reduces the data of all the ranks, leaving the result on all the ranks
+     *
+     * @param data_offs Offset of the data in the buffer; same on all the ranks, outside of the collective's region
+     * @param count Number of elements
+     * @param type Element type
+     * @param op Reduction operator
+     * @param algo RING (reduce-scatter and allgather) or TREE (reduce to rank 0 and broadcast)
+     */
+    void allreduce(
+        uint64_t data_offs, uint64_t count, CoyoteReduceType type, 
+        CoyoteReduceOp op = CoyoteReduceOp::SUM, CoyoteCollectiveAlgo algo = CoyoteCollectiveAlgo::RING
+    );
+
+    /**
+     * @brief Gathers the block of each rank on all the ranks, along a ring
+     *
+     * @param data_offs Offset of the data in the buffer; rank i's block is at data_offs + i * block_size, which is also where its 
+     *                  block is before the call
+     * @param block_size Size of each rank's block, in bytes
+     */
+    void allgather(uint64_t data_offs, uint64_t block_size);
+
+    /**
+     * @brief Broadcasts the data of one rank to all the ranks, along a binary tree
+     *
+     * @param data_offs Offset of the data in the buffer
+     * @param len Length of the data, in bytes
+     * @param root Rank holding the data
+     */
+    void broadcast(uint64_t data_offs, uint64_t len, uint32_t root = 0);
+
+    /// Waits until all the ranks have called barrier()
+    void barrier();
+
+    /// Getter: Rank of this node
+    uint32_t getRank() const { return rank; }
+
+    /// Getter: Number of nodes in the job
+    uint32_t getNumRanks() const { return n_ranks; }
+
+};
+
+}
+
+#endif // _COYOTE_CCOLLECTIVE_HPP_
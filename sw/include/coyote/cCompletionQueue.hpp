@@ -0,0 +1,145 @@
+/*
+ * This file is part of the Coyote <https://github.com/fpgasystems/Coyote>
+ *
+ * MIT Licence
+ * Copyright (c) 2025, Systems Group, ETH Zurich
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _COYOTE_CCOMPLETIONQUEUE_HPP_
+#define _COYOTE_CCOMPLETIONQUEUE_HPP_
+
+#include <deque>
+#include <chrono>
+#include <vector>
+#include <cstdint>
+
+#include <coyote/cDefs.hpp>
+#include <coyote/cOps.hpp>
+#include <coyote/cThread.hpp>
+
+namespace coyote {
+
+/**
+ * @brief Per-cThread completion queue, matching completions to individual requests
+ *
+ * cThread::checkCompleted() only exposes a cumulative counter per operation class (local read, local write, RDMA read, RDMA write).
+ * This class issues each request on the cThread with the last flag set and hands back a ticket. Since the hardware completes
+ * requests of the same class in order, a ticket is complete once the counter of its class reaches the value it had when issued.
+ * Therefore, many requests can be kept in flight and consumed in order, without having to call cThread::clearCompleted().
+ *
+ * @note The completion queue takes a snapshot of a class's counter when it is first used; all operations of that class 
+ * on the cThread should go through the queue afterwards, otherwise the expected counter values will be inaccurate
+ */
+class cCompletionQueue {
+
+private:
+    /// Operation classes, each with a dedicated completion counter; indices match the ones from the writeback region (RD_WBACK etc.)
+    static constexpr unsigned int const N_CLASSES = N_WBACKS;
+
+    /// In-flight request: its ticket and the value of the class's completion counter that marks it as completed
+    struct pendingReq {
+        uint64_t ticket;
+        uint32_t target;
+    };
+
+    /// cThread on which the requests are issued
+    cThread *cthread;
+
+    /// Next ticket to be handed out
+    uint64_t next_ticket = { 0 };
+
+    /// Number of requests issued per operation class (modulo 2^32, same as the hardware counters)
+    uint32_t issued[N_CLASSES] = { 0 };
+
+    /// Set once the counter of a class has been snapshotted, see prime()
+    bool primed[N_CLASSES] = { false };
+
+    /// In-flight requests per operation class, in issue order 
+    std::deque<pendingReq> pending[N_CLASSES];
+
+    /// Maps a class index to an operation, which can be passed to cThread::checkCompleted()
+    static CoyoteOper classOper(unsigned int cls);
+
+    /// Snapshots the completion counter of a class on its first use
+    void prime(unsigned int cls);
+
+    /// Returns true if the counter value cnt has reached target, accounting for wrap-around of the 32-bit counters
+    static bool reached(uint32_t cnt, uint32_t target);
+
+    /// Registers a newly issued request of a given class and returns its ticket
+    uint64_t push(unsigned int cls);
+
+public:
+    /**
+     * @brief Default constructor
+     *
+     * @param cthread cThread on which the requests are issued; must outlive the completion queue
+     */
+    cCompletionQueue(cThread *cthread);
+
+    /**
+     * @brief Invokes a one-sided local operation (LOCAL_READ or LOCAL_WRITE)
+     * @return Ticket of the request
+     */
+    uint64_t invoke(CoyoteOper oper, localSg sg);
+
+    /**
+     * @brief Invokes a two-sided local operation (LOCAL_TRANSFER); the request is completed once the write-side completes
+     * @return Ticket of the request
+     */
+    uint64_t invoke(CoyoteOper oper, localSg src_sg, localSg dst_sg);
+
+    /**
+     * @brief Invokes an RDMA operation (REMOTE_RDMA_READ or REMOTE_RDMA_WRITE)
+     * @return Ticket of the request
+     */
+    uint64_t invoke(CoyoteOper oper, rdmaSg sg);
+
+    /**
+     * @brief Retrieves completed requests
+     *
+     * Reads each of the completion counters (with outstanding requests) once and returns the tickets of the completed requests
+     * in ascending order. A returned ticket is removed from the queue and is not returned again.
+     *
+     * @param max_n Maximum number of tickets to return
+     * @return Completed tickets 
+     */
+    std::vector<uint64_t> poll(size_t max_n = SIZE_MAX);
+
+    /**
+     * @brief Waits until a given request has completed
+     *
+     * @param ticket Ticket, as returned by invoke()
+     * @param timeout Maximum time to wait; by default, waits indefinitely
+     * @return True if the request completed, false if the timeout expired
+     *
+     * @note The ticket is not removed from the queue; it will still be returned by the next poll()
+     */
+    bool wait(uint64_t ticket, std::chrono::microseconds timeout = std::chrono::microseconds::max());
+
+    /// Returns the number of in-flight (not yet polled) requests
+    size_t size() const;
+};
+
+}
+
+#endif // _COYOTE_CCOMPLETIONQUEUE_HPP_
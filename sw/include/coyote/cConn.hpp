@@ -27,19 +27,36 @@
 #ifndef _COYOTE_CCONN_HPP_
 #define _COYOTE_CCONN_HPP_
 
+#include <deque>
+#include <mutex>
 #include <atomic>
+#include <future>
+#include <functional>
+#include <unordered_map>
+#include <condition_variable>
 #include <string>
 #include <vector>
 #include <iostream>
 #include <unistd.h>
 #include <sys/un.h>
+#include <sys/uio.h>
 #include <sys/socket.h>
 
 #include <coyote/cTask.hpp>
 #include <coyote/cDefs.hpp>
+#include <coyote/cShmRing.hpp>
 
 namespace coyote {
 
+/// Load of a Coyote service and the functions it serves, as returned by cConn::queryLoad()
+struct cServiceLoad {
+    /// Outstanding tasks and admission limits of the service
+    cLoadReport report;
+
+    /// IDs of the functions registered with the service
+    std::vector<int32_t> fids;
+};
+
 /**
  * @brief Coyote connection class
  * 
@@ -60,31 +77,277 @@ private:
     /// A map of submitted tasks
     std::map<int32_t, std::unique_ptr<cTask>> tasks;
 
+    /// Lock, protecting the map of tasks; the map is written by the submitting thread(s) and the completion thread 
+    std::mutex tasks_lock;
+
+    /// Signalled by the completion thread whenever a task is completed
+    std::condition_variable tasks_cv;
+
+    /// Functions called on completion of the tasks submitted with submit() or submitCallback(); such tasks are released once called
+    std::unordered_map<int32_t, std::function<void(cTask*)>> callbacks;
+
+    /// Tasks submitted with iTask() that completed since the last call to pollCompleted()
+    std::deque<int32_t> completed_tasks;
+
+    /// Number of submitted tasks, whose responses have not been received yet
+    uint32_t in_flight = { 0 };
+
+    /// Maximum number of tasks in flight; further submissions block until a task completes, see setWindow()
+    uint32_t window = { CONN_MAX_IN_FLIGHT };
+
+    /// Shared-memory channel with the service (see cShmRing); nullptr if the connection only uses the socket
+    cShmChannel *shm = nullptr;
+
+    /// Doorbell (eventfd) of the shared-memory request ring; rung by the client
+    int req_efd = -1;
+
+    /// Doorbell (eventfd) of the shared-memory response ring; rung by the service
+    int resp_efd = -1;
+
+    /// Cleared once the connection to the service is lost; further submissions then fail immediately
+    std::atomic<bool> connected = { true };
+
     /// A dedicated thread that periodically checks for completed tasks
     std::thread completion_thread;
 
     /// Set to true when the completion thread is running
     bool run_thread;
 
+    /// Scheduling class of the tasks submitted without an explicit one, see setTaskClass()
+    cTaskClass task_class;
+
+    /// Serializes writes to the socket, so that frames from different threads are never interleaved
+    std::mutex send_lock;
+
+    /// Set to true between beginBatch() and flushBatch(); requests are then accumulated in batch_buff instead of being sent
+    bool batching = false;
+
+    /// Framed requests accumulated while batching
+    std::vector<char> batch_buff;
+
+    /// Shared-memory buffers of return values (see DEF_RESP_SHARED), received on the socket but not yet matched to their response; only accessed by the completion thread
+    std::deque<int> shared_fds;
+
     /**
      * @brief Periodically checks for completed tasks and update the task map
      */
     void checkCompletedTasks();
 
+    /**
+     * @brief Parses all the complete response frames in a buffer and marks the corresponding tasks as completed
+     *
+     * @param buff Buffer holding a stream of response frames; an incomplete frame at the end is moved to the front
+     * @param len Number of valid bytes in buff; updated to the size of the incomplete frame
+     */
+    void parseResponses(std::vector<char> &buff, size_t &len);
+
+    /**
+     * @brief Completes all the outstanding tasks with DEF_RET_ERROR; called once the connection to the service is lost
+     *
+     * Their futures and callbacks report the failure, instead of waiting forever, so that callers (e.g., cConnGroup) can fail over.
+     */
+    void failOutstandingTasks();
+
+    /**
+     * @brief Registers the client's PID with the service and starts the completion thread; common part of the constructors
+     *
+     * @param use_shm If true, a shared-memory channel is created and passed to the service alongside the PID
+     */
+    void registerClient(bool use_shm);
+
+    /**
+     * @brief Creates the shared-memory channel and its doorbells; passed to the service when registering the PID
+     *
+     * @return Shared-memory file descriptor, to be passed to the service; -1 on failure, in which case only the socket is used
+     */
+    int createShm();
+
+    /**
+     * @brief Pushes a frame to the service through the shared-memory request ring, ringing the doorbell if needed
+     *
+     * @return true if the frame was pushed; false if there is no shared-memory channel or the ring is full
+     */
+    bool pushShm(const struct iovec *iov, int iovcnt);
+
+    /**
+     * @brief Writes a gather list to the socket, retrying on partial writes
+     *
+     * @param iov Array of buffers to be sent back-to-back; modified in-place
+     * @param iovcnt Number of buffers in iov
+     *
+     * @note Throws a runtime_error if the socket cannot be written
+     */
+    void sendAll(struct iovec *iov, int iovcnt);
+
+    /// Sends the requests buffered in batch_buff (if any); must be called with send_lock held
+    void sendBatch();
+
+    /// Reserves a slot in the window of tasks in flight, blocking until one is available
+    void acquireWindow();
+
+    /**
+     * @brief Registers and sends a task (the common path of all the submission functions)
+     *
+     * @param opcode Request opcode; DEF_OP_SUBMIT_TASK, or DEF_OP_QUERY_LOAD for queryLoad()
+     * @param fid Function ID of the request
+     * @param cls Scheduling class of the task, sent with the request
+     * @param ret_size Size of the return value
+     * @param callback If set, called by the completion thread once the task completes; the task is then released
+     * @param msg Function arguments
+     * @return Unique task ID
+     */
+    template<typename... args>
+    int32_t submitTask(int32_t opcode, int32_t fid, const cTaskClass &cls, size_t ret_size, std::function<void(cTask*)> callback, args&... msg) {
+        acquireWindow();
+        int32_t tid = task_counter++;
+
+        tasks_lock.lock();
+        if (!connected) {
+            in_flight--;
+            tasks_lock.unlock();
+            throw std::runtime_error("ERROR: Connection to the server was lost");
+        }
+        tasks.emplace(tid, std::make_unique<cTask>(tid, fid, ret_size));
+        if (callback) {
+            callbacks.emplace(tid, std::move(callback));
+        }
+        tasks_lock.unlock();
+
+        try {
+            sendRequest(opcode, fid, tid, cls, msg...);
+        } catch (...) {
+            std::lock_guard<std::mutex> guard(tasks_lock);
+            tasks.erase(tid);
+            callbacks.erase(tid);
+            in_flight--;
+            throw;
+        }
+        return tid;
+    }
+
+    /// Utility function; size of a return value, as passed to the cTask (VAR_ARG_SIZE for variable-length return values)
+    template<typename ret>
+    static constexpr size_t retSize() { return isVarArg<ret>::value ? VAR_ARG_SIZE : sizeof(ret); }
+
+    /// Utility function; deserializes the return value of a completed task, either fixed-size or variable-length (see isVarArg)
+    template<typename ret>
+    static ret decodeRetVal(const cTask *task) {
+        if constexpr (isVarArg<ret>::value) {
+            using elem_type = typename ret::value_type;
+            ret ret_val(task->getRetDataSize() / sizeof(elem_type));
+            memcpy(ret_val.data(), task->getRetData(), ret_val.size() * sizeof(elem_type));
+            return ret_val;
+        } else {
+            ret ret_val;
+            memcpy(&ret_val, task->getRetData(), sizeof(ret));
+            return ret_val;
+        }
+    }
+
+    /// Utility function; throws the error for a task with a non-zero return code
+    static void throwRetCode(int32_t tid, int32_t ret_code) {
+        if (ret_code == DEF_RET_BUSY) {
+            throw std::runtime_error(
+                std::string("ERROR: Server is busy and rejected task with tid: ") + std::to_string(tid) +
+                std::string("; too many outstanding tasks, please back off and retry")
+            );
+        }
+        throw std::runtime_error(
+            std::string("ERROR: Server returned non-zero code for task with tid: ") + std::to_string(tid) +
+            std::string("; please ensure the function ID is correct and registered with the server, ") +
+            std::string("as well as that the correct number and type of arguments is being transmitted.").c_str()
+        );
+    }
+
+    /**
+     * @brief Utility function; appends an argument to the gather list of a request
+     *
+     * Fixed-size arguments are sent as-is; variable-length arguments (see isVarArg) 
+     * are sent as their size in bytes, followed by the elements.
+     *
+     * @param iov Gather list of the request
+     * @param iovcnt Number of buffers in iov; incremented by one (fixed-size) or two (variable-length)
+     * @param size Storage for the size prefix of a variable-length argument; must outlive the gather list
+     * @param x The argument
+     */
+    template<typename T>
+    static void appendArg(struct iovec *iov, int &iovcnt, uint32_t &size, T &x) {
+        if constexpr (isVarArg<T>::value) {
+            size = x.size() * sizeof(typename T::value_type);
+            iov[iovcnt++] = { &size, sizeof(uint32_t) };
+            iov[iovcnt++] = { (void *) x.data(), size };
+        } else {
+            static_assert(std::is_trivially_copyable<T>::value, "Function arguments must be trivially copyable or std::vectors of trivially copyable types");
+            iov[iovcnt++] = { (void *) &x, sizeof(T) };
+        }
+    }
+
+    /**
+     * @brief Sends (or, when batching, buffers) a framed request: a cReqHeader (including the task's scheduling class) followed by all the arguments
+     *
+     * When not batching, the header and the arguments are gathered directly from the caller's variables
+     * and pushed to the shared-memory ring or, if the ring is full, sent with a single writev.
+     */
+    template<typename... args>
+    void sendRequest(int32_t opcode, int32_t fid, int32_t tid, const cTaskClass &cls, args&... msg) {
+        cReqHeader header = { opcode, fid, tid, 0, cls.priority, cls.deadline_us };
+        struct iovec iov[1 + 2 * sizeof...(args)];
+        [[maybe_unused]] uint32_t sizes[1 + sizeof...(args)];
+        int iovcnt = 1, idx = 0;
+        iov[0] = { &header, sizeof(cReqHeader) };
+        (appendArg(iov, iovcnt, sizes[idx++], msg), ...);
+        size_t payload_size = 0;
+        for (int i = 1; i < iovcnt; i++) {
+            payload_size += iov[i].iov_len;
+        }
+        if (payload_size > MAX_MSG_PAYLOAD_SIZE) {
+            throw std::runtime_error("ERROR: Function arguments exceed the maximum request size, MAX_MSG_PAYLOAD_SIZE");
+        }
+        header.payload_size = payload_size;
+
+        std::lock_guard<std::mutex> guard(send_lock);
+        if (batching) {
+            for (int i = 0; i < iovcnt; i++) {
+                const char *ptr = (const char *) iov[i].iov_base;
+                batch_buff.insert(batch_buff.end(), ptr, ptr + iov[i].iov_len);
+            }
+        } else if (!pushShm(iov, iovcnt)) {
+            sendAll(iov, iovcnt);
+        }
+    }
+
 public:
 
     /** 
      * @brief Default constructor for local connections
      *
      * When called, this constructor create a local connection to a Coyote service, as implemented in cService.hpp
+     * Requests and responses are exchanged through a shared-memory channel (see cShmRing), and the socket is 
+     * only used for the set-up, and as a fall-back when the channel is full (or cannot be created).
      *
      * @param sock_name The name of the Coyote socket, as registed by the server
      */
     cConn(std::string sock_name);
 
+    /** 
+     * @brief Constructor for remote connections
+     *
+     * Creates a TCP connection to a remote Coyote service (i.e., a cService created with remote = true);
+     * the requests and responses use the same framing as for local connections.
+     *
+     * @param server_address IP address or host name of the node running the service
+     * @param port Port of the service
+     *
+     * @note Arguments and return values are sent in the native byte order, so both nodes must have the same endianness
+     */
+    cConn(std::string server_address, uint16_t port);
+
     /// Default destructor; sends a request to close the connection
     ~cConn();
 
+    /// Returns false once the connection to the service has been lost, e.g., since the service stopped
+    bool isConnected() const { return connected; }
+
     /**
      * @brief Checks if a task with the given ID is completed
      *
@@ -106,61 +369,41 @@ public:
      * @note Users must ensure they pass the correct template arguments, matching the function signature
      * on the server; the server simply serializes a byte array into the target arguments; so if 
      * incorrect templates are passed, a wrong value may be returned. 
+     * @note Bulk data can be passed as std::vector arguments (see isVarArg), up to MAX_MSG_PAYLOAD_SIZE per request
+     */
+    template<typename ret, typename... args>
+    ret task(int32_t fid, args... msg) {
+        return task<ret>(task_class, fid, msg...);
+    }
+
+    /**
+     * @brief Submits a task with the given scheduling class; blocking - waits until the task is completed
+     *
+     * @param cls Priority class and deadline of the task, e.g., { TASK_PRIORITY_INTERACTIVE, 50 } for an interactive task, 
+     *            which should complete within 50 us; see cSched for how the classes are scheduled
+     * @param fid Function ID of the request
+     * @param msg Variable number of arguments to be sent to the server
+     * @return The return value of executed function
+     *
+     * @note Same restrictions on the template arguments as for task(int32_t, ...)
      */
     template<typename ret, typename... args>
-    ret task(int32_t fid, args... msg) {        
+    ret task(const cTaskClass &cls, int32_t fid, args... msg) {        
         DBG1("cConn: Submitting a blocking task; fid" << fid); 
        
         /*
-         * Add task to the map with a unique ID. In general, the cTask consturctor 
-         * expects the function arguments and a cThread; here, however, they are not needed, 
-         * since the function is executed on the server side. The purpose of the cTask
-         * in this class is to poll on its completion and return the result.
+         * Submit the task asynchronously and wait on its future. In general, the cTask consturctor expects the function arguments 
+         * and a cThread; here, however, they are not needed, since the function is executed on the server side. 
+         * The purpose of the cTask in this class is to track its completion and hold the result.
+         * Any pending batch is flushed, since this call blocks until completion.
         */
-        int32_t tid = task_counter++;
-
-        tasks.emplace(tid, std::make_unique<cTask>(tid, fid, sizeof(ret)));
-                
-        // Send opcode, function ID and task ID to server
-        int32_t req[3];
-        req[0] = DEF_OP_SUBMIT_TASK;
-        req[1] = fid;
-        req[2] = tid;
-        if (write(sockfd, &req, 3 * sizeof(int32_t)) != 3 * sizeof(int32_t)) {
-            throw std::runtime_error("ERROR: Failed to send request to server");
-        }
-
-        // Send the payload using parameter pack expansion and a lambda function 
-        auto f_wr = [&](auto& x){
-            using arg_type = decltype(x);
-            size_t arg_size = sizeof(arg_type);
-
-            if (write(sockfd, &x, arg_size) != arg_size) {
-                throw std::runtime_error("ERROR: Failed to send function arguments to server");
-            }
-        };
-        (f_wr(msg), ...);
-
-        // Wait until the task has been marked as completed
-        while (!tasks[tid]->isCompleted()) {
-            std::this_thread::sleep_for(std::chrono::microseconds(SLEEP_INTERVAL_CLIENT_CONN_MANAGER)); 
-        }
-
-        // Check return code & if zero, parse return value
-        int32_t ret_code = tasks[tid]->getRetCode();
-        if (ret_code != 0) {
-            throw std::runtime_error(
-                std::string("ERROR: Server returned non-zero code for task with tid: ") + std::to_string(tid) +
-                std::string("; please ensure the function ID is correct and registered with the server, ") +
-                std::string("as well as that the correct number and type of arguments is being transmitted.").c_str()
-            );
+        std::future<ret> future = submit<ret>(cls, fid, msg...);
+        if (batching) {
+            flushBatch();
         }
 
-        ret ret_val;
-        std::vector<char> tmp = tasks[tid]->getRetVal();
-        memcpy(&ret_val, tmp.data(), sizeof(ret));
-
-        DBG1("cConn: Request completed; return code" << ret_code << " return value: " << ret_val); 
+        ret ret_val = future.get();
+        DBG1("cConn: Request completed"); 
         return ret_val;
     }
 
@@ -169,6 +412,7 @@ public:
      *
      * Users should use isTaskCompleted(int32_t tid) to query the status of the task
      * and if complete, getTaskRetVal(int32_t tid) to retrieve the return value.   
+     * Between beginBatch() and flushBatch(), the request is only buffered on the client.
      *
      * @param fid Function ID of the request
      * @param msg Variable number of arguments to be sent to the server
@@ -180,34 +424,161 @@ public:
      * @note Users must ensure they pass the correct template arguments, matching the function signature
      * on the server; the server simply serializes a byte array into the target arguments; so if 
      * incorrect templates are passed, a wrong value may be returned. 
+     * @note Bulk data can be passed as std::vector arguments (see isVarArg), up to MAX_MSG_PAYLOAD_SIZE per request
      */
     template<typename ret, typename... args>
     int32_t iTask(int32_t fid, args... msg) {        
         DBG1("cConn: Submitting a non-blocking task; fid" << fid); 
-       
-        int32_t tid = task_counter++;
-        tasks.emplace(tid, std::make_unique<cTask>(tid, fid, sizeof(ret)));
-        int32_t req[3];
-        req[0] = DEF_OP_SUBMIT_TASK;
-        req[1] = fid;
-        req[2] = tid;
-        if (write(sockfd, &req, 3 * sizeof(int32_t)) != 3 * sizeof(int32_t)) {
-            throw std::runtime_error("ERROR: Failed to send request to server");
-        }
+        return submitTask(DEF_OP_SUBMIT_TASK, fid, task_class, retSize<ret>(), nullptr, msg...);
+    }
 
-        auto f_wr = [&](auto& x){
-            using arg_type = decltype(x);
-            size_t arg_size = sizeof(arg_type);
+    /**
+     * @brief Submits a task to the Coyote service; asynchronous - returns a future holding the return value
+     *
+     * Many tasks can be in flight at once, up to the window set with setWindow(); once the window is full,
+     * the call blocks until a task completes. The task is released once the future has been fulfilled.
+     *
+     * @param fid Function ID of the request
+     * @param msg Variable number of arguments to be sent to the server
+     * @return Future holding the return value of the executed function; the future holds a runtime_error
+     * if the server returns a non-zero code (e.g., function not found, wrong arguments, etc.)
+     *
+     * @note Same restrictions on the template arguments as for task(...)
+     */
+    template<typename ret, typename... args>
+    std::future<ret> submit(int32_t fid, args... msg) {
+        return submit<ret>(task_class, fid, msg...);
+    }
 
-            if (write(sockfd, &x, arg_size) != arg_size) {
-                throw std::runtime_error("ERROR: Failed to send function arguments to server");
+    /**
+     * @brief Submits a task with the given scheduling class; asynchronous - returns a future holding the return value
+     *
+     * @param cls Priority class and deadline of the task
+     * @param fid Function ID of the request
+     * @param msg Variable number of arguments to be sent to the server
+     * @return Future holding the return value of the executed function
+     *
+     * @note Same restrictions on the template arguments as for task(...)
+     */
+    template<typename ret, typename... args>
+    std::future<ret> submit(const cTaskClass &cls, int32_t fid, args... msg) {
+        DBG1("cConn: Submitting an asynchronous task; fid" << fid); 
+        auto promise = std::make_shared<std::promise<ret>>();
+        std::future<ret> future = promise->get_future();
+        submitTask(DEF_OP_SUBMIT_TASK, fid, cls, retSize<ret>(), [promise](cTask *task) {
+            if (task->getRetCode() != 0) {
+                try {
+                    throwRetCode(task->getTid(), task->getRetCode());
+                } catch (...) {
+                    promise->set_exception(std::current_exception());
+                }
+            } else {
+                promise->set_value(decodeRetVal<ret>(task));
             }
-        };
-        (f_wr(msg), ...);
+        }, msg...);
+        return future;
+    }
 
-        return tid;
+    /**
+     * @brief Submits a task to the Coyote service; asynchronous - calls a function once the task completes
+     *
+     * The callback is called from the completion thread, so it should return quickly and must not block
+     * on other tasks of this connection (e.g., by calling task(...)). The task is released once it has been called.
+     * 
+     * @param fid Function ID of the request
+     * @param callback Called with the return code (non-zero on failure, in which case the return value is undefined; DEF_RET_BUSY if
+     *                 the service rejected the task, since it has too many outstanding tasks) and return value
+     * @param msg Variable number of arguments to be sent to the server
+     * @return Unique task ID
+     *
+     * @note Same restrictions on the template arguments as for task(...)
+     */
+    template<typename ret, typename... args>
+    int32_t submitCallback(int32_t fid, std::function<void(int32_t, ret)> callback, args... msg) {
+        DBG1("cConn: Submitting an asynchronous task with callback; fid" << fid); 
+        return submitTask(DEF_OP_SUBMIT_TASK, fid, task_class, retSize<ret>(), [callback](cTask *task) {
+            ret ret_val = {};
+            if (task->getRetCode() == 0) {
+                ret_val = decodeRetVal<ret>(task);
+            }
+            callback(task->getRetCode(), ret_val);
+        }, msg...);
     }
 
+    /**
+     * @brief Returns the IDs of the tasks submitted with iTask() that completed since the last call
+     *
+     * Allows polling the completions of many tasks in bulk, instead of checking each task with isTaskCompleted().
+     *
+     * @param max_tasks Maximum number of task IDs to return
+     * @return IDs of the completed tasks, in order of completion
+     */
+    std::vector<int32_t> pollCompleted(size_t max_tasks = SIZE_MAX);
+
+    /**
+     * @brief Releases a task submitted with iTask(), once its return value is no longer needed
+     *
+     * @param tid Task ID, as obtained from iTask()
+     * @return true if the task was released, false if it was not found or is still in flight
+     */
+    bool releaseTask(int32_t tid);
+
+    /**
+     * @brief Returns the raw return value of a completed task submitted with iTask(), without copying it
+     *
+     * Large return values of local connections are received in a shared-memory buffer (see SHARED_RESULT_THRESHOLD), 
+     * so bulk results can be consumed in-place, e.g., std::vector return values, with getTaskReturnValue() copying them.
+     *
+     * @param tid Task ID, as obtained from iTask()
+     * @return Pointer to the return value and its size in bytes; valid until the task is released with releaseTask()
+     *
+     * @note This function can throw a runtime_error if the task is not found, still in flight or the server returned a non-zero code for it
+     */
+    std::pair<const void*, size_t> getTaskResult(int32_t tid);
+
+    /**
+     * @brief Sets the maximum number of tasks in flight; submissions block while the window is full
+     *
+     * @param window Maximum number of tasks in flight (at least 1)
+     */
+    void setWindow(uint32_t window);
+
+    /**
+     * @brief Sets the scheduling class of the tasks submitted without an explicit one (including iTask() and submitCallback())
+     *
+     * By default, tasks are of class TASK_PRIORITY_NORMAL, without a deadline. 
+     *
+     * @param cls Priority class and deadline (in us from the submission) of the tasks
+     *
+     * @note Not synchronized with concurrent submissions; set it before submitting tasks or use the overloads taking a class
+     */
+    void setTaskClass(const cTaskClass &cls) { task_class = cls; }
+
+    /**
+     * @brief Starts a batch of requests
+     *
+     * Until flushBatch() is called, requests submitted with iTask() are buffered on the client 
+     * and then sent to the server at once; pipelining many (small) tasks into a single system call.
+     */
+    void beginBatch();
+
+    /**
+     * @brief Sends all the requests buffered since beginBatch() with a single write and ends the batch
+     *
+     * @note This function can throw a runtime_error if the requests cannot be sent to the server
+     */
+    void flushBatch();
+
+    /**
+     * @brief Queries the load of the service, i.e., its outstanding tasks, admission limits and registered functions
+     *
+     * The query is not subject to the service's admission control, so it also succeeds while the service is overloaded.
+     * Used by cConnGroup to route tasks across several services.
+     *
+     * @return Future holding the load report; holds a runtime_error if the service cannot answer the query
+     */
+    std::future<cServiceLoad> queryLoad();
+
 
     /**
      * @brief Obtains the task return value from the server
@@ -228,6 +599,7 @@ public:
      */
     template<typename ret>
     ret getTaskReturnValue(int32_t tid) {
+        std::lock_guard<std::mutex> guard(tasks_lock);
         if (tasks.find(tid) == tasks.end()) {
             throw std::runtime_error(
                 std::string("ERROR: Task with id: ") + std::to_string(tid) +
@@ -237,19 +609,11 @@ public:
         
         int32_t ret_code = tasks[tid]->getRetCode();
         if (ret_code != 0) {
-            throw std::runtime_error(
-                std::string("ERROR: Server returned non-zero code for task with tid: ") + std::to_string(tid) +
-                std::string("; please ensure the function ID is correct and registered with the server, ") +
-                std::string("as well as that the correct number and type of arguments is being transmitted.").c_str()
-            );
+            throwRetCode(tid, ret_code);
         }
 
-        ret ret_val;
-        std::vector<char> tmp = tasks[tid]->getRetVal();
-        memcpy(&ret_val, tmp.data(), sizeof(ret));
-
-        DBG1("cConn: Request completed; return code" << ret_code << " return value: " << ret_val); 
-        return ret_val;
+        DBG1("cConn: Request completed; return code" << ret_code); 
+        return decodeRetVal<ret>(tasks[tid].get());
 
     }
 
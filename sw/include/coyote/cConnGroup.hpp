@@ -0,0 +1,275 @@
+/*
+ * This file is part of the Coyote <https://github.com/fpgasystems/Coyote>
+ *
+ * MIT Licence
+ * Copyright (c) 2025, Systems Group, ETH Zurich
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _COYOTE_CCONN_GROUP_HPP_
+#define _COYOTE_CCONN_GROUP_HPP_
+
+#include <mutex>
+#include <tuple>
+#include <chrono>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <functional>
+
+#include <coyote/cConn.hpp>
+#include <coyote/cDefs.hpp>
+
+namespace coyote {
+
+/**
+ * @brief Group of connections to several Coyote services, balancing the tasks across them
+ *
+ * With a service per vFPGA or per node, a client would otherwise pick the target of each task itself. Instead, the group 
+ * holds a cConn to each service and routes every task to the least-loaded service which has the requested function registered.
+ * The load of a service is its outstanding tasks, relative to its admission limit (see cService::setAdmissionLimits); 
+ * it's queried periodically (cConn::queryLoad(), at most every CONN_GROUP_LOAD_INTERVAL and without blocking the submission), 
+ * with the group's own tasks in flight being tracked exactly in-between.
+ *
+ * Tasks are failed over: if the service rejects a task (e.g., DEF_RET_BUSY from its admission control), returns an error, 
+ * or the connection to it is lost, the task is resubmitted to the next-best service which has not tried it yet. A service 
+ * whose connection was lost is skipped and reconnected after CONN_GROUP_RETRY_INTERVAL.
+ *
+ * @note Since a task may be executed on any service of the group (and, after a failure, more than once), 
+ *       the functions should be registered with the same semantics on all the services and be idempotent
+ * @note All the tasks must have completed before the group is destroyed
+ */
+class cConnGroup {
+
+private:
+
+    /// @brief A service of the group and its connection
+    struct groupService {
+        /// Socket name of a local service; empty for remote services
+        std::string sock_name;
+
+        /// IP address or host name of a remote service; empty for local services
+        std::string address;
+
+        /// Port of a remote service
+        uint16_t port = { 0 };
+
+        /// Connection to the service; nullptr while the service is unreachable
+        std::unique_ptr<cConn> conn;
+
+        /// Connections which failed; kept until the group is destroyed, since their completion threads may still be calling back into the group
+        std::vector<std::unique_ptr<cConn>> retired;
+
+        /// Last load report of the service; only valid if has_load is set
+        cServiceLoad load;
+
+        /// Set once a load report has been received over the current connection
+        bool has_load = { false };
+
+        /// Outstanding load query, if any
+        std::future<cServiceLoad> load_query;
+
+        /// Time the last load query was issued
+        std::chrono::steady_clock::time_point load_time;
+
+        /// Time after which an unreachable service is reconnected
+        std::chrono::steady_clock::time_point retry_time;
+
+        /// Tasks of the group in flight on the service
+        uint32_t in_flight = { 0 };
+
+        /// Description of the service, for error messages
+        std::string getName() const { return address.empty() ? sock_name : address + ":" + std::to_string(port); }
+    };
+
+    /// Services of the group; never removed, so that indices (and pointers) remain valid
+    std::vector<std::unique_ptr<groupService>> services;
+
+    /// Lock, protecting the services; accessed by the submitting thread(s) and the connections' completion threads
+    std::mutex lock;
+
+    /// Service from which the next search starts; rotated, so that services with the same load are used in turns
+    uint32_t next = { 0 };
+
+    /// @brief State of a task submitted to the group; kept until the task completes on some service
+    template<typename ret, typename... args>
+    struct groupRequest {
+        /// Function ID
+        int32_t fid;
+
+        /// Function arguments, kept for resubmission
+        std::tuple<args...> msg;
+
+        /// Fulfilled once the task completes on a service, or fails on all of them
+        std::promise<ret> promise;
+
+        /// Services which have already tried the task, by index
+        std::vector<bool> tried;
+
+        /// Error returned by the last service which tried the task
+        std::string error;
+
+        groupRequest(int32_t fid, args... msg) : fid(fid), msg(std::move(msg)...) {}
+    };
+
+    /// Opens the connection to a service; returns false (and schedules a retry) if the service is unreachable; called with lock held
+    bool connect(groupService &service);
+
+    /**
+     * @brief Picks the service a task should be submitted to and reserves a slot on it
+     *
+     * Also collects load reports, issues new load queries and reconnects unreachable services, as needed.
+     *
+     * @param fid Function ID of the task
+     * @param tried Services which have already tried the task; skipped
+     * @param conn Set to the connection of the picked service
+     * @return Index of the picked service; -1 if no (untried) service can execute the function
+     */
+    int32_t route(int32_t fid, const std::vector<bool> &tried, cConn *&conn);
+
+    /// Releases the slot reserved by route(), once the task completed or could not be submitted
+    void release(int32_t idx);
+
+    /// Marks a connection as failed; the service is skipped until it's reconnected
+    void fail(int32_t idx, cConn *conn);
+
+    /// Submits a task to the best service which has not tried it yet; on failure, called again from the completion callback
+    template<typename ret, typename... args>
+    void dispatch(std::shared_ptr<groupRequest<ret, args...>> req) {
+        while (true) {
+            cConn *conn = nullptr;
+            int32_t idx = route(req->fid, req->tried, conn);
+            if (idx == -1) {
+                req->promise.set_exception(std::make_exception_ptr(std::runtime_error(
+                    req->error.empty() ? 
+                        "ERROR: No service of the group can execute function with fid: " + std::to_string(req->fid) : 
+                        req->error
+                )));
+                return;
+            }
+            if (req->tried.size() <= (size_t) idx) {
+                req->tried.resize(idx + 1, false);
+            }
+            req->tried[idx] = true;
+
+            std::function<void(int32_t, ret)> callback = [this, req, idx, conn](int32_t ret_code, ret ret_val) {
+                release(idx);
+                if (ret_code == 0) {
+                    req->promise.set_value(std::move(ret_val));
+                    return;
+                }
+
+                if (!conn->isConnected()) {
+                    fail(idx, conn);
+                    req->error = "ERROR: Connection to service " + std::to_string(idx) + " of the group was lost";
+                } else if (ret_code == DEF_RET_BUSY) {
+                    req->error = "ERROR: All the services of the group are busy; too many outstanding tasks, please back off and retry";
+                } else {
+                    req->error = "ERROR: Server returned non-zero code for task with fid: " + std::to_string(req->fid) + " on all the services of the group";
+                }
+                DBG1("cConnGroup: Task with fid " << req->fid << " failed on service " << idx << " with code " << ret_code << "; failing over");
+                dispatch(req);
+            };
+
+            try {
+                std::apply([&](auto&... msg) { conn->template submitCallback<ret>(req->fid, callback, msg...); }, req->msg);
+                return;
+            } catch (const std::exception &e) {
+                release(idx);
+                fail(idx, conn);
+                req->error = e.what();
+            }
+        }
+    }
+
+public:
+
+    /// Default constructor; services are added with addService()
+    cConnGroup() = default;
+
+    /**
+     * @brief Adds a local service to the group
+     *
+     * @param sock_name The name of the Coyote socket, as registered by the server (see cConn)
+     *
+     * @note If the service cannot be reached, it's added nonetheless and connected once it comes up
+     */
+    void addService(std::string sock_name);
+
+    /**
+     * @brief Adds a remote service to the group
+     *
+     * @param server_address IP address or host name of the node running the service
+     * @param port Port of the service
+     *
+     * @note If the service cannot be reached, it's added nonetheless and connected once it comes up
+     */
+    void addService(std::string server_address, uint16_t port);
+
+    /// Returns the number of services in the group
+    size_t getNumServices();
+
+    /// Returns the number of services in the group which are currently connected
+    size_t getNumConnected();
+
+    /**
+     * @brief Submits a task to the group; asynchronous - returns a future holding the return value
+     *
+     * The task is routed to the least-loaded service with the function registered, and failed over to the other services on errors.
+     *
+     * @param fid Function ID of the request
+     * @param msg Variable number of arguments to be sent to the server
+     * @return Future holding the return value of the executed function; holds a runtime_error if the task failed on all the services
+     *
+     * @note Same restrictions on the template arguments as for cConn::task(...)
+     * @note Failed-over tasks are resubmitted from the completion thread of the failed connection, 
+     *       so the window of the next service (see cConn::setWindow()) should not be full
+     */
+    template<typename ret, typename... args>
+    std::future<ret> submit(int32_t fid, args... msg) {
+        DBG1("cConnGroup: Submitting an asynchronous task; fid" << fid);
+        auto req = std::make_shared<groupRequest<ret, args...>>(fid, msg...);
+        std::future<ret> future = req->promise.get_future();
+        dispatch(req);
+        return future;
+    }
+
+    /**
+     * @brief Submits a task to the group; blocking - waits until the task is completed
+     *
+     * @param fid Function ID of the request
+     * @param msg Variable number of arguments to be sent to the server
+     * @return The return value of executed function
+     *
+     * @note This function throws a runtime_error if the task failed on all the services
+     */
+    template<typename ret, typename... args>
+    ret task(int32_t fid, args... msg) {
+        return submit<ret>(fid, msg...).get();
+    }
+
+};
+
+}
+
+#endif // _COYOTE_CCONN_GROUP_HPP_
@@ -29,11 +29,13 @@
 
 #include <chrono> 
 #include <cstring> 
+#include <vector>
 #include <cstdint>
 #include <iomanip>
 #include <netdb.h>
 #include <iostream>  
 #include <sys/ioctl.h> 
+#include <type_traits>
 
 using namespace std::chrono_literals;
 
@@ -100,6 +102,43 @@ namespace coyote {
 // Retrieves notification value
 #define IOCTL_GET_NOTIFICATION_VALUE        _IOR('F', 19, unsigned long)
 
+// Pin and install the TLB entries for a batch of user buffers up-front, to avoid page faults on first access
+#define IOCTL_PREFAULT_USER_MEM             _IOW('F', 20, unsigned long)
+
+// Set the fault-ahead window of a mapped buffer, i.e., how much past a page fault is mapped in the same fault
+#define IOCTL_SET_FAULT_AHEAD               _IOW('F', 21, unsigned long)
+
+// Set the delivery mode of user interrupts (notifications): eventfd, coalesced or polled
+#define IOCTL_SET_NOTIFY_MODE               _IOW('F', 22, unsigned long)
+
+// Map, unmap, off-load or sync a batch of user buffers, in a single call
+#define IOCTL_BATCH_USER_MEM                _IOW('F', 23, unsigned long)
+
+// Look up an IP address in the driver's neighbor table, to find whether its ARP lookup was already issued (and when)
+#define IOCTL_NEIGH_LOOKUP                  _IOWR('F', 24, unsigned long)
+
+// Map or unmap a card-only buffer (CoyoteAllocType::CARD), and copy between it and a host buffer
+#define IOCTL_MAP_CARD_MEM                  _IOW('F', 25, unsigned long)
+#define IOCTL_UNMAP_CARD_MEM                _IOW('F', 26, unsigned long)
+#define IOCTL_COPY_CARD_MEM                 _IOW('F', 27, unsigned long)
+
+// Share the card memory of a card-only buffer, and attach to shared card memory by handle
+#define IOCTL_SHARE_CARD_MEM                _IOWR('F', 28, unsigned long)
+#define IOCTL_ATTACH_CARD_MEM               _IOWR('F', 29, unsigned long)
+
+// Export the vFPGA's peer-to-peer window as a dmabuf, which a vFPGA on another card maps with IOCTL_MAP_DMABUF
+#define IOCTL_EXPORT_P2P_WINDOW             _IOR('F', 30, unsigned long)
+
+// Make shared card memory persistent under a name, look it up by name (e.g., after a restart) and drop its persistence
+#define IOCTL_PERSIST_CARD_MEM              _IOWR('F', 31, unsigned long)
+#define IOCTL_LOOKUP_CARD_MEM               _IOWR('F', 32, unsigned long)
+#define IOCTL_UNPERSIST_CARD_MEM            _IOW('F', 33, unsigned long)
+#define CARD_MEM_NAME_LEN                   64 // Including the terminating NUL; must match the driver
+
+// The map, unmap, batch, off-load, sync and notification processed IOCTLs can also be submitted through io_uring (Linux >= 5.19), 
+// as IORING_OP_URING_CMD on the vFPGA file descriptor: cmd_op is the IOCTL number and the IOCTL arguments are placed, 
+// as 64-bit values, in the SQE command area; more than two arguments require a ring set up with IORING_SETUP_SQE128
+
 // Allocate memory for partial reconfiguration
 #define IOCTL_ALLOC_HOST_RECONFIG_MEM       _IOW('P', 1, unsigned long)
 
@@ -118,6 +157,18 @@ namespace coyote {
 // Retrieve PR and writeback statistics (no. of read/write requests, completions, data beats from/to the XDMA/QDMA) 
 #define IOCTL_PR_WB_STATS                   _IOR('P', 6, unsigned long)
 
+// Trigger reconfiguration of a vFPGA, without waiting for completion; completion is signalled through an eventfd
+#define IOCTL_RECONFIGURE_APP_ASYNC         _IOW('P', 7, unsigned long)
+
+// Retrieve the result of the last asynchronous reconfiguration of a vFPGA
+#define IOCTL_RECONFIGURE_APP_RESULT        _IOR('P', 8, unsigned long)
+
+// Add a loaded bitstream to the driver's bitstream cache, shared by all processes
+#define IOCTL_ADD_RECONFIG_CACHE            _IOW('P', 9, unsigned long)
+
+// Look up a bitstream in the driver's bitstream cache, by the hash of its contents
+#define IOCTL_GET_RECONFIG_CACHE            _IOW('P', 10, unsigned long)
+
 #define BUFF_NEEDS_EXP_SYNC_RET_CODE 99
 
 ///////////////////////////////////////////////////
@@ -232,17 +283,52 @@ enum class CnfgLegRegs : uint32_t {
 #define CONN_CONTEXT_RQPN_OFFS              (16)
 #define CONN_CONTEXT_PORT_OFFS              (40)
 
+#define TCP_LISTEN_PID_OFFS                 (0)
+#define TCP_LISTEN_DEST_OFFS                (6)
+#define TCP_LISTEN_PORT_OFFS                (32)
+#define TCP_OPEN_IP_OFFS                    (0)
+#define TCP_OPEN_PORT_OFFS                  (32)
+#define TCP_OPEN_PID_OFFS                   (48)
+#define TCP_OPEN_DEST_OFFS                  (54)
+#define TCP_OPEN_CLOSE                      (1UL << 58)
+#define TCP_STAT_SUCCESS                    (1UL << 0)
+#define TCP_STAT_VALID                      (1UL << 1)
+#define TCP_STAT_PID_OFFS                   (16)
+#define TCP_STAT_DEST_OFFS                  (22)
+
 // Numbers etc.
 #define NaN std::numeric_limits<double>::quiet_NaN();
 
+// Log2 of the number of buckets per power of two of a cHdrHistogram, by default (precision of 1/256) and at most
+constexpr int const HDR_HIST_SUB_BITS = 8;
+constexpr int const HDR_HIST_MAX_SUB_BITS = 12;
+
+// Calibration of the TSC against the steady clock (see cTsc), number of CSR reads per correlation with a vFPGA cycle counter 
+// (see cFpgaClock) and the default vFPGA clock period (250 MHz), in ns
+constexpr std::chrono::milliseconds const TSC_CALIBRATION_TIME(20);
+constexpr unsigned int const FPGA_CLOCK_SYNC_READS = 32;
+constexpr double const FPGA_CLOCK_PERIOD_NS = 4.0;
+
 // DMA and command constants
 constexpr int const CMD_FIFO_DEPTH = 32;
 constexpr int const CMD_FIFO_THR = 10;
+constexpr unsigned long const CMD_RING_SIZE = 256; // commands queued per vFPGA in the shared submission ring of a process, see cCmdRing; a power of two
 constexpr unsigned long const MAX_TRANSFER_SIZE = 128 * 1024 * 1024;
 
+// Number of pause iterations between two reads of the command FIFO occupancy, for CoyoteBackoff::PAUSE
+constexpr int const CMD_FIFO_PAUSE_SPINS = 64;
+
 // Sleep time in nanoseconds for buszy wait loops; used while waiting for hardware to complete
 constexpr long const SLEEP_TIME = 100L;
 
+// Default time spent in low-latency waits (umwait or pause) by cThread::waitCompleted() before backing off to sleeps, 
+// and the longest single umwait, in TSC ticks (the kernel may cap it further, see /sys/devices/system/cpu/umwait_control)
+constexpr std::chrono::microseconds const WAIT_SPIN_TIME(50);
+constexpr uint64_t const UMWAIT_TICKS = 100000;
+
+// Maximum time to wait for the TCP stack to respond to a listen or open request
+constexpr std::chrono::seconds const TCP_OPEN_TIMEOUT(10);
+
 // Maximum number of user interrupts to process simultaneously
 constexpr int const MAX_EVENTS = 1;
 
@@ -251,6 +337,20 @@ constexpr unsigned long long const PAGE_SIZE = (4ULL * 1024ULL);
 constexpr unsigned long long const HUGE_PAGE_SIZE = (2ULL * 1024ULL * 1024ULL);
 constexpr unsigned long const PAGE_SHIFT = 12UL;
 constexpr unsigned long const HUGE_PAGE_SHIFT = 21UL;
+constexpr unsigned long long const HUGE_PAGE_1G_SIZE = (1024ULL * 1024ULL * 1024ULL);
+constexpr unsigned long const HUGE_PAGE_1G_SHIFT = 30UL;
+
+// NUMA placement of host allocations (CoyoteAlloc::numa_node); NONE leaves the placement to the kernel, AUTO uses the node of the FPGA's PCIe root port
+constexpr int const NUMA_NODE_NONE = -1;
+constexpr int const NUMA_NODE_AUTO = -2;
+
+// Bitstream loading (cRcnfg::readBitstream); files are read in chunks of BITSTREAM_LOAD_CHUNK bytes by up to BITSTREAM_LOAD_THREADS threads
+// Bitstreams are hashed in the same chunks; the driver verifies the hash of cached bitstreams, so the chunk size must match RECONFIG_CACHE_HASH_CHUNK
+constexpr unsigned long const BITSTREAM_LOAD_CHUNK = 16 * 1024 * 1024;
+constexpr unsigned int const BITSTREAM_LOAD_THREADS = 4;
+
+// Bitstreams of the functions registered with cSched::addFunctions(...) are loaded by up to BITSTREAM_LOAD_FUNCS threads, one file per thread
+constexpr unsigned int const BITSTREAM_LOAD_FUNCS = 8;
 
 // Maximum number of Coyote threads per vFPGA
 constexpr int const N_CTID_MAX = 64;
@@ -264,14 +364,95 @@ constexpr int const N_CTID_MAX = 64;
 constexpr unsigned long const CTRL_REGION_SIZE = 64 * 1024;
 constexpr unsigned long const CNFG_REGION_SIZE = 64 * 1024;
 constexpr unsigned long const CNFG_AVX_REGION_SIZE = 256 * 1024;
+constexpr unsigned long const CNFG_AVX_WC_REGION_SIZE = PAGE_SIZE;
 constexpr unsigned long const WBACK_REGION_SIZE = 4 * N_CTID_MAX * sizeof(uint32_t);
 
+// Number of 64-bit vFPGA CSRs in the control region
+constexpr uint32_t const N_CTRL_REGS = CTRL_REGION_SIZE / sizeof(uint64_t);
+
 constexpr unsigned long const MMAP_WB = 0x0 << PAGE_SHIFT;
 constexpr unsigned long const MMAP_CNFG = 0x1 << PAGE_SHIFT;
 constexpr unsigned long const MMAP_CNFG_AVX = 0x2 << PAGE_SHIFT;
 constexpr unsigned long const MMAP_CTRL = 0x3 << PAGE_SHIFT;
+constexpr unsigned long const MMAP_NOTIFY = 0x4 << PAGE_SHIFT;
+constexpr unsigned long const MMAP_STATS = 0x5 << PAGE_SHIFT;
+constexpr unsigned long const MMAP_CNFG_AVX_WC = 0x6 << PAGE_SHIFT;
 constexpr unsigned long const MMAP_RECONFIG = 0x100 << PAGE_SHIFT;
 
+/**
+ * Notification ring of a Coyote thread, written by the driver's ISR in the coalesced and polling notification modes (see CoyoteNotify)
+ * The rings of all the Coyote threads of a vFPGA are memory mapped (MMAP_NOTIFY); the layout must match struct notify_ring in the driver
+ */
+constexpr uint32_t const NOTIFY_RING_ENTRIES = 512;
+
+struct notifyRing {
+    uint32_t head;      // Number of values pushed by the driver
+    uint32_t tail;      // Number of values consumed by the user space
+    uint32_t armed;     // Set before waiting on the eventfd (coalesced mode); the driver only signals the eventfd if set
+    uint32_t dropped;   // Number of values dropped since the ring was full
+    uint32_t reserved[12];
+    int32_t values[NOTIFY_RING_ENTRIES];
+};
+
+constexpr unsigned long const NOTIFY_RINGS_SIZE = ((N_CTID_MAX * sizeof(notifyRing) + PAGE_SIZE - 1) / PAGE_SIZE) * PAGE_SIZE;
+
+/**
+ * Statistics of a Coyote thread, maintained by the driver; the counters are cleared and generation is incremented whenever the ctid is registered
+ * The statistics of all the Coyote threads of a vFPGA are memory mapped, read-only (MMAP_STATS); the layout must match struct vfpga_ctid_stats in the driver
+ */
+struct vfpgaCtidStats {
+    uint64_t generation;        // Incremented whenever the ctid is registered
+    uint64_t hpid;              // Host process ID of the thread
+    uint64_t pfaults[2];        // Page faults (TLB misses), by stream (STRM_CARD, STRM_HOST)
+    uint64_t pfault_errors;     // Page faults which could not be handled
+    uint64_t pfault_ns;         // Total time spent handling the page faults, in ns
+    uint64_t tlb_maps;          // TLB entries written
+    uint64_t tlb_invalidations; // TLB invalidations (of a buffer each)
+    uint64_t migrations[2];     // Buffer migrations, by destination stream (STRM_CARD, STRM_HOST)
+    uint64_t offloads;          // Explicit off-loads
+    uint64_t syncs;             // Explicit syncs
+    uint64_t notifications;     // User interrupts
+    uint64_t pingpong_splits;   // Buffers split (migrated by range only) because they ping-ponged between the host and the card
+    uint64_t mmu_invalidations; // Buffers invalidated by the driver's MMU notifier (lazy unpinning), e.g., since they were unmapped or freed
+    uint64_t reserved[1];
+};
+
+constexpr uint64_t const VFPGA_STATS_VERSION = 1;
+
+// Flags of the statistics page: the driver tracks user buffers with an MMU notifier (lazy unpinning), so freed buffers are invalidated
+constexpr uint64_t const VFPGA_STATS_FLAG_LAZY_UNPIN = 0x1;
+
+struct vfpgaStatsPage {
+    uint64_t version;           // VFPGA_STATS_VERSION
+    uint64_t flags;             // VFPGA_STATS_FLAG_*
+    uint64_t reserved[6];
+    vfpgaCtidStats ctids[N_CTID_MAX];
+};
+
+constexpr unsigned long const VFPGA_STATS_SIZE = ((sizeof(vfpgaStatsPage) + PAGE_SIZE - 1) / PAGE_SIZE) * PAGE_SIZE;
+
+// Size (in bytes) of each flag of the RDMA barriers (cThread::rdmaSync() and cThread::rdmaBarrier()); there are two flags per QP
+constexpr uint64_t const SYNC_SLOT_SIZE = 64;
+constexpr uint64_t const SYNC_REGION_SIZE = ((2 * N_CTID_MAX * SYNC_SLOT_SIZE + PAGE_SIZE - 1) / PAGE_SIZE) * PAGE_SIZE;
+
+// Pacing of RDMA WRITEs (cThread::setRdmaPacing()): default max. window per QP (in writes), the RTT (relative to the minimum RTT) 
+// considered a sign of congestion, and the interval between two reads of the network stats (for the retransmissions)
+constexpr uint32_t const RDMA_PACING_MAX_WINDOW = 64;
+constexpr double const RDMA_PACING_RTT_FACTOR = 2.0;
+constexpr std::chrono::microseconds const RDMA_PACING_STATS_INTERVAL(100);
+
+// Network stats, as returned by IOCTL_NET_STATS; the high 32 bits of NET_STAT_RETRANS_REG are the number of retransmissions
+constexpr int const N_NET_STAT_REGS = 10;
+constexpr int const NET_STAT_RETRANS_REG = 6;
+
+// Default number of slots and slot size (in bytes) of a cMsgQueue; every message is written as a full slot, see cMsgQueue
+constexpr uint32_t const MSG_QUEUE_SLOTS = 64;
+constexpr uint32_t const MSG_QUEUE_SLOT_SIZE = 2048;
+
+// Default segment size (in bytes) and number of segments in flight per peer of a cCollective, see cCollective
+constexpr uint64_t const COLLECTIVE_SEGMENT_SIZE = 256 * 1024;
+constexpr uint32_t const COLLECTIVE_DEPTH = 4;
+
 // Writeback region constants; there are deidcated writebacks for reads, writes, remote reads and remote writes
 constexpr unsigned long const N_WBACKS = 4;
 constexpr unsigned long const RD_WBACK = 0;
@@ -282,6 +463,22 @@ constexpr unsigned long const WR_RDMA_WBACK = 3;
 // Maximum number of user arguments for IOCTL calls passed from the user space to the driver
 constexpr auto const MAX_USER_ARGS = 32;
 
+// Maximum number of buffers in a single IOCTL_PREFAULT_USER_MEM call; must match MAX_N_PREFAULT_RANGES in the driver
+constexpr auto const MAX_N_PREFAULT_RANGES = 64;
+
+// Maximum number of operations in a single IOCTL_BATCH_USER_MEM call; must match MAX_N_BATCH_OPS in the driver
+constexpr auto const MAX_N_BATCH_OPS = 256;
+
+// Flag of IOCTL_MAP_USER_MEM: the buffer is already resident, see cThread::userMap(); must match MAP_USER_RESIDENT in the driver
+constexpr unsigned long const MAP_USER_RESIDENT = 0x1;
+
+// Flags of IOCTL_MAP_USER_MEM: access hints of the buffer, see CoyoteAccess; must match MAP_USER_READ_ONLY and MAP_USER_WRITE_ONLY in the driver
+constexpr unsigned long const MAP_USER_READ_ONLY = 0x2;
+constexpr unsigned long const MAP_USER_WRITE_ONLY = 0x4;
+
+// Fault-ahead window that falls back to the device-wide window (/sys/kernel/coyote_sysfs_<dev>/cyt_attr_fault_ahead)
+constexpr int64_t const FAULT_AHEAD_DEFAULT = -1;
+
 // Data source/destination stream in the vFPGA; e.g., axis_host_(recv|send). axis_card_(recv|send)
 constexpr unsigned long const STRM_CARD = 0;
 constexpr unsigned long const STRM_HOST = 1;
@@ -297,16 +494,147 @@ constexpr unsigned long const DEF_PORT = 18488;
 
 // Background daemons
 constexpr unsigned long const RECV_BUFF_SIZE = 1024;
-constexpr unsigned long const DAEMON_CLEAN_CONNS_SLEEP = 500; // us
 constexpr unsigned long const DAEMON_ACCEPT_CONN_SLEEP = 50; // us
-constexpr unsigned long const DAEMON_PROCESS_REQUESTS_SLEEP = 10; // us
+constexpr unsigned long const DAEMON_N_REACTORS = 1; // event-loop threads handling the client sockets, see cService::setReactors
+constexpr unsigned long const DAEMON_THREAD_POOL_SIZE = 4; // idle cThreads kept per region for new clients, see cService::setThreadPool and cThreadPool
+constexpr unsigned long const DAEMON_MAX_EVENTS = 64; // max. socket events handled per epoll_wait
+constexpr unsigned long const DAEMON_EPOLL_TIMEOUT = 100; // ms
+constexpr unsigned long const SCHED_MAX_BATCH = 32; // max. tasks executed per reconfiguration, see cSched::setReorderPolicy
+constexpr unsigned long const SCHED_MAX_WAIT = 100000; // us
+constexpr unsigned long const SCHED_N_WORKERS = 4; // worker threads per cSched, see cSched::setWorkers
+constexpr unsigned long const SCHED_WFQ_QUANTUM = 1 << 20; // virtual time charged per task of weight 1 in the weighted fair queuing, see cSched
+constexpr unsigned long const SCHED_PRIORITY_AGING = 50000; // us a pending task waits before it's promoted by one priority class (starvation protection), see cSched
+
+// Priority classes of tasks, see cTask::setPriority; strictly ordered, lower values are scheduled first
+constexpr uint32_t const TASK_PRIORITY_INTERACTIVE = 0;
+constexpr uint32_t const TASK_PRIORITY_NORMAL = 1;
+constexpr uint32_t const TASK_PRIORITY_BATCH = 2;
+constexpr uint32_t const SCHED_N_PRIORITIES = 3;
 constexpr unsigned long const MAX_NUM_CLIENTS = 64;
+
+// Number of connection attempts to a peer in cThread::connectPeers(), and the interval between them; i.e., how long peers may take to start
+constexpr uint32_t const BOOTSTRAP_CONNECT_RETRIES = 3000;
+constexpr std::chrono::milliseconds const BOOTSTRAP_RETRY_INTERVAL(10);
 constexpr unsigned long const DEF_OP_CLOSE_CONN = 0;
 constexpr unsigned long const DEF_OP_SUBMIT_TASK = 1;
-constexpr unsigned long const SLEEP_INTERVAL_CLIENT_CONN_MANAGER = 500; // us
+constexpr unsigned long const DEF_OP_QUERY_LOAD = 2; // answered with a cLoadReport, followed by the IDs of the registered functions; see cConn::queryLoad
+constexpr int32_t const DEF_RET_ERROR = 1; // response code: the task failed or could not be submitted
+constexpr int32_t const DEF_RET_BUSY = 2; // response code: the task was rejected by the service's admission control; the client should back off and retry
+constexpr uint32_t const DEF_RESP_SHARED = 1; // response flag: the return value is in a shared-memory buffer (memfd), passed as SCM_RIGHTS with the response; the payload is its size (uint64_t)
+constexpr unsigned long const DAEMON_MAX_CLIENT_TASKS = 1024; // max. outstanding tasks per cService client, see cService::setAdmissionLimits
+constexpr unsigned long const DAEMON_MAX_TASKS = 16384; // max. outstanding tasks across all cService clients
+constexpr unsigned long const DAEMON_RX_BUFF_SIZE = 64 * 1024; // initial per-connection receive buffer; holds many pipelined messages
+constexpr unsigned long const MAX_MSG_PAYLOAD_SIZE = 64 * 1024 * 1024; // upper bound on the payload of a single framed message, including variable-length arguments
+constexpr unsigned long const CONN_MAX_IN_FLIGHT = 1024; // default window of tasks in flight per cConn, see cConn::setWindow
+constexpr std::chrono::milliseconds const CONN_GROUP_LOAD_INTERVAL(10); // age of a service's load report after which cConnGroup queries it again
+constexpr std::chrono::milliseconds const CONN_GROUP_RETRY_INTERVAL(1000); // time cConnGroup waits before reconnecting to a failed service
+constexpr unsigned long const SHM_RING_SIZE = 256 * 1024; // size of each direction of the cConn <-> cService shared-memory channel; larger frames go over the socket
+constexpr unsigned long const SHARED_RESULT_THRESHOLD = 1024 * 1024; // return values of local clients from this size on are passed in a shared-memory buffer, see DEF_RESP_SHARED
+constexpr unsigned long const DEF_RESULT_CACHE_SIZE = 16 * 1024 * 1024; // default memory bound of the cService result cache (for cacheable functions), see cService::setResultCacheSize
+constexpr unsigned long const STATS_N_BUCKETS = 48; // power-of-two latency buckets per histogram (1 ns up to ~39 h), see cHistogram
+constexpr unsigned long const TRACE_RING_EVENTS = 64 * 1024; // events kept per thread by cTracer (older events are overwritten), see cTracer
+constexpr unsigned long const LOG_RING_ENTRIES = 4096; // messages queued by cLog before they are dropped (power of two), see cLog
+constexpr unsigned long const LOG_MSG_SIZE = 256; // longest message (including the terminator) logged by cLog, see cLog
+constexpr unsigned long const TASK_ARGS_INLINE_SIZE = 128; // bytes of task arguments stored without a heap allocation, see cTaskArgs
+constexpr unsigned long const TASK_ARGS_INLINE_COUNT = 8; // number of task arguments stored without a heap allocation, see cTaskArgs
 static constexpr struct timeval SERVER_RECV_TIMEOUT = {.tv_sec = 0, .tv_usec = 5000}; 
 static constexpr struct timeval CLIENT_RECV_TIMEOUT = {.tv_sec = 0, .tv_usec = 500}; 
 
+// Argument size reported by bFunc::getArgumentSizes() for variable-length arguments; in a request, these are prefixed by their size in bytes (uint32_t)
+constexpr size_t const VAR_ARG_SIZE = SIZE_MAX;
+
+/**
+ * @brief Identifies variable-length function arguments
+ *
+ * Besides trivially copyable (fixed-size) types, cFunc and cConn support std::vector arguments of trivially 
+ * copyable elements, e.g., std::vector<char>, for bulk payloads whose size is only known at run-time.
+ */
+template<typename T> struct isVarArg : std::false_type {};
+template<typename T> struct isVarArg<std::vector<T>> : std::is_trivially_copyable<T> {};
+
+/**
+ * @brief Header of a framed request, sent from cConn to cService
+ *
+ * The header is followed by payload_size bytes, holding the function arguments back-to-back (variable-length 
+ * arguments prefixed by their size), such that a complete request (or many of them) can be transferred with a single system call.
+ */
+struct cReqHeader {
+    /// Request opcode (DEF_OP_CLOSE_CONN, DEF_OP_SUBMIT_TASK or DEF_OP_QUERY_LOAD)
+    int32_t opcode;
+
+    /// Function ID
+    int32_t fid;
+
+    /// Client-side task ID
+    int32_t tid;
+
+    /// Size of the payload following the header, in bytes
+    uint32_t payload_size;
+
+    /// Priority class of the task (TASK_PRIORITY_*), see cTaskClass
+    uint32_t priority;
+
+    /// Deadline of the task, in us from its submission to the service; 0 if none
+    uint32_t deadline_us;
+};
+
+/**
+ * @brief Scheduling class of a task submitted through cConn, carried in its cReqHeader
+ *
+ * The scheduler (cSched) strictly prefers higher priority classes and, within a class, executes the tasks 
+ * with the earliest deadlines first; tasks without a deadline follow those with one.
+ */
+struct cTaskClass {
+    /// Priority class (TASK_PRIORITY_*)
+    uint32_t priority = TASK_PRIORITY_NORMAL;
+
+    /// Deadline, in us from the submission of the task; 0 if none
+    uint32_t deadline_us = 0;
+};
+
+/**
+ * @brief Header of a framed response, sent from cService to cConn
+ *
+ * The header is followed by payload_size bytes holding the function return value;
+ * the payload is empty if the return code is non-zero. Large return values of local clients are
+ * not sent in-line, but in a shared-memory buffer (see DEF_RESP_SHARED), so that only its size travels over the socket.
+ */
+struct cRespHeader {
+    /// Return code; a non-zero value indicates a failure on the server side
+    int32_t ret_code;
+
+    /// Client-side task ID
+    int32_t tid;
+
+    /// Size of the payload following the header, in bytes
+    uint32_t payload_size;
+
+    /// Response flags; DEF_RESP_SHARED or 0
+    uint32_t flags;
+};
+
+/**
+ * @brief Load of a cService, as returned for DEF_OP_QUERY_LOAD
+ *
+ * In the response, the report is followed by n_fids function IDs (int32_t); used by cConnGroup to route tasks.
+ */
+struct cLoadReport {
+    /// Outstanding (submitted, but not completed) tasks across all clients
+    uint32_t n_outstanding;
+
+    /// Admission limit on the outstanding tasks across all clients, see cService::setAdmissionLimits
+    uint32_t max_tasks;
+
+    /// Outstanding tasks of the querying client
+    uint32_t n_client_outstanding;
+
+    /// Admission limit on the outstanding tasks per client
+    uint32_t max_client_tasks;
+
+    /// Number of function IDs following the report
+    uint32_t n_fids;
+};
+
 /// @brief RDMA Queue (QP) --- keeps all the necessary information of a single node in RDMA connections
 struct ibvQ {
     /// Node IP address
@@ -363,6 +691,24 @@ struct ibvQ {
     }
 };
 
+/// @brief RDMA memory region (MR) --- a buffer which can be targeted by RDMA operations, exchanged with the remote node when connecting
+struct ibvMr {
+    /// Buffer virtual address
+    uint64_t vaddr;
+
+    /// Buffer size, in bytes
+    uint64_t size;
+
+    /// Memory rkey; 0, since remote addresses are translated by the remote vFPGA's TLB (as for ibvQ::rkey)
+    uint32_t rkey;
+
+    /// Padding, keeping the layout identical on both sides of the connection
+    uint32_t reserved;
+};
+
+// Maximum number of registered MRs per cThread, see cThread::registerMr()
+constexpr uint32_t const MAX_N_MRS = 256;
+
 /// @brief RDMA Queue Pair (QP) --- a combination of a local and a remote ibvQ that uniquely identify an RDMA connection
 struct ibvQp {
 public:
@@ -418,6 +764,9 @@ typedef struct __attribute__((packed)) {
 
     /// Set to true if either RDMA or TCP is enabled
     bool en_net = { false };
+
+    /// Host memory is accessed cache-coherently by the vFPGA (Enzian/ECI); set by the driver, not in CMake
+    bool coherent = { false };
     
     /// Number of host DMA channels (typically, 3: streming data, sync/offload and writeback)
     int32_t n_hdma_chan = { 0 };
@@ -434,6 +783,7 @@ typedef struct __attribute__((packed)) {
         en_strm = (cnfg >> 2) & 0x1;
         en_mem = (cnfg >> 3) & 0x1;
         en_pr = (cnfg >> 4) & 0x1;
+        coherent = (cnfg >> 5) & 0x1;
         en_rdma = (cnfg >> 16) & 0x1;
         en_tcp = (cnfg >> 17) & 0x1;
         n_hdma_chan = (cnfg >> 32) & 0xff;
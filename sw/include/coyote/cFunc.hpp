@@ -45,7 +45,8 @@ namespace coyote {
  * Each function is associated with a specific application bitstream
  * and the corresponding software-side function to be executed.
  * The functions are implemented using variadic templates to allow for
- * a variable number of parameters to be passed. This class is expected
+ * a variable number of parameters to be passed. The parameters, as well as the return value, are either 
+ * trivially copyable types or std::vectors of them, for bulk payloads (see isVarArg). This class is expected
  * to be used in conjuction with Coyote services (cService) and requests (cReq).
  * For an example, refer to Example 9 in examples/.
  *
@@ -78,13 +79,35 @@ private:
      */
     std::function<ret(cThread*, args...)> fn;
 
+    /// Whether the function can execute concurrently with other concurrent functions, see isConcurrent()
+    bool concurrent;
+
+    /// Whether the results of the function can be cached, see isCacheable()
+    bool cacheable;
+
+    /// Sizes of the arguments, see getArgumentSizes(); computed once, since they're needed to parse every request
+    std::vector<size_t> arg_sizes = { (isVarArg<args>::value ? VAR_ARG_SIZE : sizeof(args))... };
+
 public:
 
-    /// Default constructor; converts the app_bitstream path to an absolute path
-    cFunc(int32_t fid, std::string app_bitstream, std::function<ret(cThread*, args...)> fn) {
+    /**
+     * @brief Default constructor; converts the app_bitstream path to an absolute path
+     *
+     * @param fid Unique function identifier
+     * @param app_bitstream Path to the application bitstream
+     * @param fn Body of the software function
+     * @param concurrent Set if the function doesn't need exclusive access to the vFPGA, i.e., its tasks can
+     *                   execute in parallel with other concurrent tasks (e.g., it only uses its own Coyote thread
+     *                   and the vFPGA logic handles multiple Coyote threads); by default, tasks execute one at a time
+     * @param cacheable Set if the function is idempotent, i.e., its return value only depends on its arguments (e.g., hash or 
+     *                  lookup kernels); the cService then answers repeated requests from its result cache, without executing them
+     */
+    cFunc(int32_t fid, std::string app_bitstream, std::function<ret(cThread*, args...)> fn, bool concurrent = false, bool cacheable = false) {
         this->fid = fid;
         this->app_bitstream = std::filesystem::absolute(app_bitstream).string();
         this->fn = fn;
+        this->concurrent = concurrent;
+        this->cacheable = cacheable;
     }
 
     /// Default destructor
@@ -94,33 +117,38 @@ public:
      * @brief Executes the function with the given arguments
      *
      * @param coyote_thread Pointer to the cThread object
-     * @param x List of arguments passed as vector of char buffers, one buffer per argument
+     * @param x Serialized arguments, one char buffer per argument
      * @return The result of the function execution, serialized into a char buffer
      *
      * @note The cService holds a list of functions registered with the background service
      * To do so, we need to implement a base (non-tempalated) bFunc class (otherwise
      * it becomes very hard to store the functions in a map). However, since the base
      * class is not templated, this function must also be non-templated. Therefore,
-     * the run function takes the arguments as a vector of char buffers (std::vector<char>).
+     * the run function takes the arguments as char buffers (stored back-to-back in a cTaskArgs).
      * Each char buffer is then unpacked into the corresponding argument. There are alternatives
      * to this implementation (e.g., using std::any); however, using char buffer provides one of the
      * simplest solutions, with no reliance on complex data types. Additionally, when the function
      * arguments are received in the server (processRequests() function), they are naurally written to a 
      * char buffer, since they are contigious, byte-addressable and easily cast to other data types. 
      */
-    std::vector<char> run(cThread* coyote_thread, const std::vector<std::vector<char>>& x) override {
+    std::vector<char> run(cThread* coyote_thread, const cTaskArgs& x) override {
         if (x.size() != sizeof...(args)) {
             throw std::invalid_argument("mismatch in argument count, exiting...");
         }
 
-        // Unpack the arguments and call the function
+        // Unpack the arguments and call the function; they are moved into the call, so variable-length arguments aren't copied again
         std::tuple<args...> function_arguments = unpackArgs(x, std::make_index_sequence<sizeof...(args)>{});
-        ret tmp = std::apply(fn, std::tuple_cat(std::make_tuple(coyote_thread), function_arguments));
-
-        // Copy the return value to a vector of char
-        std::vector<char> ret_val(sizeof(ret));
-        memcpy(ret_val.data(), &tmp, sizeof(ret));
-        return ret_val;
+        ret tmp = std::apply([&](args&... a) { return fn(coyote_thread, std::move(a)...); }, function_arguments);
+
+        // Copy the return value to a vector of char; variable-length return values hold exactly their elements
+        if constexpr (isVarArg<ret>::value) {
+            const char *data = (const char *) tmp.data();
+            return std::vector<char>(data, data + tmp.size() * sizeof(typename ret::value_type));
+        } else {
+            std::vector<char> ret_val(sizeof(ret));
+            memcpy(ret_val.data(), &tmp, sizeof(ret));
+            return ret_val;
+        }
     }
 
     /**
@@ -146,13 +174,14 @@ public:
      * @brief Returns a vector of sizes, one for of the function arguments
      * 
      * Example: For args = {int64_t, float, bool}, the return is std::vector<size_t> = {8, 4, 1}
+     * Variable-length arguments (std::vector<T>, see isVarArg) are reported as VAR_ARG_SIZE
      *
      * @return A vector of sizes of the function argument
      */ 
-    std::vector<size_t> getArgumentSizes() const override { return { sizeof(args)... }; }
+    const std::vector<size_t>& getArgumentSizes() const override { return arg_sizes; }
 
-    /// Similar to above, returns the size of the return value of the function
-    size_t getReturnSize() const override { return sizeof(ret); }
+    /// Similar to above, returns the size of the return value of the function; VAR_ARG_SIZE for variable-length return values
+    size_t getReturnSize() const override { return isVarArg<ret>::value ? VAR_ARG_SIZE : sizeof(ret); }
 
     /// Getter: Function ID
     int32_t getFid() const override { return fid; }
@@ -160,18 +189,24 @@ public:
     /// Getter: Bitstream path
     std::string getBitstreamPath() const override { return app_bitstream; }
 
+    /// Getter: Whether the tasks of the function can execute concurrently
+    bool isConcurrent() const override { return concurrent; }
+
+    /// Getter: Whether the results of the function can be cached
+    bool isCacheable() const override { return cacheable; }
+
 private:
     /**
-     * @brief Utility function; unpacks the arguments from a vector of char buffers into a tuple
+     * @brief Utility function; unpacks the arguments from their char buffers into a tuple
      *
      * This function uses parameter pack expansion and lambda function to unpack the arguments
      * 
-     * @param x Vector of char buffers, one for each argument
+     * @param x Serialized arguments, one char buffer for each argument
      * @param I Index sequence for unpacking
      * @return A tuple containing the unpacked arguments
      */
     template<std::size_t... I>
-    std::tuple<args...> unpackArgs(const std::vector<std::vector<char>>& x, std::index_sequence<I...>) {
+    std::tuple<args...> unpackArgs(const cTaskArgs& x, std::index_sequence<I...>) {
         /*
          * First, define a lambda function that converts one of the char buffers
          * into the corresponding argument type. The lambda function has access to all
@@ -186,9 +221,17 @@ private:
          */
         
         return std::tuple<args...>([&]() {
-            args value;
-            memcpy(&value, x[I].data(), sizeof(args));
-            return value;
+            if constexpr (isVarArg<args>::value) {
+                // Variable-length argument; the char buffer holds exactly the elements
+                using elem_type = typename args::value_type;
+                args value(x[I].size() / sizeof(elem_type));
+                memcpy(value.data(), x[I].data(), value.size() * sizeof(elem_type));
+                return value;
+            } else {
+                args value;
+                memcpy(&value, x[I].data(), sizeof(args));
+                return value;
+            }
         }()...);
     }
 
@@ -82,4 +82,40 @@ hsa_status_t find_gpu(hsa_agent_t agent, void *data);
 
 #endif
 
+#ifdef EN_CUDA
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+
+#include <cuda.h>
+
+namespace coyote {
+
+/**
+ * @brief Allocates memory on an NVIDIA GPU and exports it as a dmabuf, for peer-to-peer DMA with the vFPGA
+ *
+ * The memory is allocated with cuMemAlloc, in the primary context of the GPU, and the returned address is aligned 
+ * to the host page size, as required by cuMemGetHandleForAddressRange; the dmabuf covers the whole (page-aligned) buffer.
+ *
+ * @param size Size of the buffer, in bytes
+ * @param gpu_dev_id CUDA device ordinal of the GPU
+ * @param dmabuf_fd File descriptor of the exported dmabuf (output)
+ * @return Address of the buffer, or nullptr if it could not be allocated or exported
+ */
+void* cuda_alloc_dmabuf(size_t size, uint32_t gpu_dev_id, int32_t *dmabuf_fd);
+
+/**
+ * @brief Closes the dmabuf of a buffer allocated with cuda_alloc_dmabuf and releases the memory
+ *
+ * @param mem Address of the buffer, as returned by cuda_alloc_dmabuf
+ * @param dmabuf_fd File descriptor of the dmabuf
+ * @return true on success
+ */
+bool cuda_free_dmabuf(void *mem, int32_t dmabuf_fd);
+
+}
+
+#endif
+
 #endif // _COYOTE_CGPU_HPP_
\ No newline at end of file
@@ -0,0 +1,203 @@
+/*
+ * This file is part of the Coyote <https://github.com/fpgasystems/Coyote>
+ *
+ * MIT Licence
+ * Copyright (c) 2025, Systems Group, ETH Zurich
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _COYOTE_CGPU_PIPELINE_HPP_
+#define _COYOTE_CGPU_PIPELINE_HPP_
+
+#ifdef EN_GPU
+
+#include <deque>
+#include <vector>
+#include <cstdint>
+#include <functional>
+
+#include <hsa.h>
+#include <hip/hip_runtime.h>
+
+#include <coyote/cOps.hpp>
+#include <coyote/cThread.hpp>
+
+namespace coyote {
+
+/// Default number of slots (in-flight items) of a GPU pipeline
+#define GPU_PIPELINE_DEFAULT_SLOTS 4
+
+/**
+ * @brief A slot of a cGpuPipeline: a pair of GPU buffers, exported and attached to the vFPGA once, and the stream of its GPU kernels
+ */
+struct cGpuSlot {
+    /// Index of the slot in the ring
+    uint32_t idx;
+
+    /// Item being processed by the slot, in submission order
+    uint64_t item;
+
+    /// GPU buffer written by the first GPU stage and streamed to the vFPGA
+    void *src;
+
+    /// GPU buffer written by the vFPGA and consumed by the second GPU stage
+    void *dst;
+
+    /// Number of bytes of the item (at most the slot size)
+    uint64_t len;
+
+    /// HIP stream on which the GPU stages of the slot are enqueued
+    hipStream_t stream;
+
+    /// HSA signal of the vFPGA stage; 1 while the item is being processed by the vFPGA, set to 0 once the vFPGA completed it
+    /// (e.g., for AQL barrier packets of other HSA queues which depend on the vFPGA output)
+    hsa_signal_t fpga_done;
+};
+
+/**
+ * @brief GPU -> vFPGA -> GPU streaming pipeline, without host bounce buffers
+ *
+ * A ring of slots, each with a source and a destination GPU buffer, allocated with CoyoteAllocType::GPU and attached 
+ * to the vFPGA (IOCTL_MAP_DMABUF) once, when the pipeline is created. Each submitted item goes through three stages:
+ * a GPU kernel writing the slot's source buffer, a LOCAL_TRANSFER from the source to the destination buffer through the 
+ * vFPGA (peer-to-peer, over PCIe) and a GPU kernel consuming the destination buffer. The GPU stages are enqueued on the 
+ * slot's HIP stream and tracked with events, so the host never waits for a GPU kernel; progress() moves the slots across 
+ * the stages as their GPU kernels and vFPGA transfers complete, so up to n_slots items are in flight at once.
+ *
+ * @note The pipeline owns the LOCAL_TRANSFER completions of its cThread: no other LOCAL_TRANSFERs should be issued 
+ *       on the cThread, nor its counters cleared (clearCompleted()), while the pipeline is in use
+ * @note Not thread-safe; submit(), progress() and drain() should be called from the same thread
+ */
+class cGpuPipeline {
+
+public:
+    /// GPU stage; enqueues kernels for a slot on slot.stream (it should not block on them)
+    using gpuStage = std::function<void(cGpuSlot &slot)>;
+
+    /**
+     * @brief Default constructor; allocates and attaches the GPU buffers of all the slots
+     *
+     * @param thread Coyote thread used for the vFPGA stage and the GPU buffers; must outlive the pipeline
+     * @param slot_size Size of each buffer, in bytes (the maximum item size)
+     * @param n_slots Number of slots, i.e., maximum number of items in flight
+     * @param gpu_id GPU on which the buffers are allocated and the kernels run
+     */
+    cGpuPipeline(cThread &thread, uint64_t slot_size, uint32_t n_slots = GPU_PIPELINE_DEFAULT_SLOTS, uint32_t gpu_id = 0);
+
+    /// Destructor; drains the pipeline and releases the buffers, streams, events and signals
+    ~cGpuPipeline();
+
+    cGpuPipeline(const cGpuPipeline &) = delete;
+    cGpuPipeline& operator=(const cGpuPipeline &) = delete;
+
+    /// Sets the GPU stage producing the slot's source buffer; without it, items go straight to the vFPGA (e.g., the buffer was filled by the caller)
+    void setPreStage(gpuStage stage);
+
+    /// Sets the GPU stage consuming the slot's destination buffer; without it, a slot is released once the vFPGA completed
+    void setPostStage(gpuStage stage);
+
+    /// Sets the streams of the vFPGA stage (default: 0 for both buffers, i.e. host streams, as for GPU memory in general)
+    void setStreams(uint32_t src_dest, uint32_t dst_dest);
+
+    /**
+     * @brief Submits an item; waits (while making progress) for a free slot, then enqueues its first stage
+     *
+     * @param len Number of bytes of the item; must not exceed the slot size
+     * @return Index of the item, in submission order (starting from 0)
+     */
+    uint64_t submit(uint64_t len);
+
+    /**
+     * @brief Moves the slots whose current stage completed to the next one, without blocking
+     * @return Number of items which completed (left the pipeline) in this call
+     */
+    uint32_t progress();
+
+    /// Makes progress until all the submitted items left the pipeline
+    void drain();
+
+    /// Convenience wrapper: submits n_items items of len bytes and drains the pipeline
+    void run(uint64_t n_items, uint64_t len);
+
+    /// Returns the number of items which went through all the stages
+    uint64_t getCompleted() const { return n_completed; }
+
+    /// Returns the number of items currently in the pipeline
+    uint32_t getInFlight() const { return (uint32_t) (n_submitted - n_completed); }
+
+    /// Returns a slot; e.g., to initialise its buffers before the pipeline is used
+    cGpuSlot& getSlot(uint32_t idx) { return slots.at(idx).slot; }
+
+    /// Returns the number of slots
+    uint32_t getSlots() const { return slots.size(); }
+
+private:
+    /// Stage of a slot
+    enum class slotState { FREE, PRE, FPGA, POST };
+
+    struct slotEntry {
+        cGpuSlot slot;
+        slotState state;
+        hipEvent_t event;
+    };
+
+    /// Coyote thread of the vFPGA stage
+    cThread &thread;
+
+    /// Size of each buffer, in bytes
+    uint64_t slot_size;
+
+    /// GPU stages
+    gpuStage pre_stage, post_stage;
+
+    /// Streams of the source and destination buffers of the vFPGA stage
+    uint32_t src_dest = { 0 }, dst_dest = { 0 };
+
+    /// All the slots, in ring order
+    std::vector<slotEntry> slots;
+
+    /// Next slot to be used; slots are used (and released) in ring order, so the vFPGA completions are in the same order
+    uint32_t next_slot = { 0 };
+    
+    /// Slots in the vFPGA stage, in issue order (the completions of a cThread's LOCAL_TRANSFERs are counted in order)
+    std::deque<uint32_t> fpga_queue;
+
+    /// LOCAL_TRANSFERs issued by and completed for the pipeline; the completions are relative to the counter when the pipeline was created
+    uint32_t fpga_base = { 0 }, fpga_completed = { 0 };
+
+    /// Number of items submitted and completed
+    uint64_t n_submitted = { 0 }, n_completed = { 0 };
+
+    /// Issues the vFPGA stage of a slot
+    void startFpga(slotEntry &entry);
+
+    /// Enqueues the second GPU stage of a slot (or releases it, without a second stage)
+    void startPost(slotEntry &entry);
+
+    /// Returns true if the GPU kernels enqueued on a slot so far completed
+    bool gpuDone(slotEntry &entry);
+};
+
+}
+
+#endif
+
+#endif // _COYOTE_CGPU_PIPELINE_HPP_
@@ -0,0 +1,85 @@
+/*
+ * This file is part of the Coyote <https://github.com/fpgasystems/Coyote>
+ *
+ * MIT Licence
+ * Copyright (c) 2025, Systems Group, ETH Zurich
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _COYOTE_CLOG_HPP_
+#define _COYOTE_CLOG_HPP_
+
+#include <atomic>
+#include <syslog.h>
+
+#include <coyote/cDefs.hpp>
+
+namespace coyote {
+
+/**
+ * @brief Asynchronous, level-filtered logging to syslog, for the scheduler and the service
+ *
+ * A message is formatted into a slot of a bounded, lock-free ring, shared by all threads, and written to syslog by
+ * a background thread; so, logging never takes a lock or makes a system call on the calling thread. Messages below
+ * the level are discarded before they are formatted, at the cost of one relaxed load. If the ring is full, messages
+ * are dropped (and the number of dropped messages is logged), rather than blocking the caller.
+ *
+ * Use it through the CYT_LOG macro, which has the same arguments as syslog(), e.g.:
+ *    CYT_LOG(LOG_NOTICE, "Executing tid %d", tid);
+ *
+ * The background thread is started on the first message, and restarted in a child process after fork();
+ * pending messages are written out at exit, or with flush().
+ */
+class cLog {
+
+private:
+    /// Most verbose priority logged (LOG_EMERG, the most severe, is 0)
+    static std::atomic<int> level;
+
+public:
+    /// Sets the most verbose priority which is logged, e.g., LOG_WARNING to only log warnings and errors
+    static void setLevel(int priority) { level.store(priority, std::memory_order_relaxed); }
+
+    /// Returns the most verbose priority which is logged; by default, LOG_INFO
+    static int getLevel() { return level.load(std::memory_order_relaxed); }
+
+    /// Whether messages of a priority are logged
+    static bool enabled(int priority) { return priority <= level.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Formats a message (printf-style) and queues it for syslog
+     *
+     * Messages longer than LOG_MSG_SIZE are truncated
+     */
+    static void log(int priority, const char *format, ...) __attribute__((format(printf, 2, 3)));
+
+    /// Blocks until all the messages queued so far are written to syslog, for at most one second
+    static void flush();
+
+};
+
+}
+
+/// Logs a message through cLog, if its priority is enabled; the arguments are only evaluated in that case
+#define CYT_LOG(priority, ...) \
+    do { if (coyote::cLog::enabled(priority)) { coyote::cLog::log(priority, __VA_ARGS__); } } while (0)
+
+#endif // _COYOTE_CLOG_HPP_
@@ -0,0 +1,159 @@
+/*
+ * This file is part of the Coyote <https://github.com/fpgasystems/Coyote>
+ *
+ * MIT Licence
+ * Copyright (c) 2025, Systems Group, ETH Zurich
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _COYOTE_CMSGQUEUE_HPP_
+#define _COYOTE_CMSGQUEUE_HPP_
+
+#include <cstdint>
+
+#include <coyote/cDefs.hpp>
+#include <coyote/cOps.hpp>
+#include <coyote/cThread.hpp>
+
+namespace coyote {
+
+/**
+ * @brief Two-sided messaging over an RDMA connection, with pre-posted receive rings and credit-based flow control
+ *
+ * RDMA SENDs are delivered to the vFPGA's streams, not to host memory, so host-to-host messaging is built from one-sided
+ * RDMA WRITEs into a receive ring in the peer's buffer. The queue occupies a region of a connected QP's buffer, with an 
+ * identical layout on both nodes (see getRegionSize()):
+ *  - RX ring: n_slots slots, written by the peer; each slot is [length | payload | sequence number]
+ *  - TX ring: n_slots slots, the source of the messages to the peer's RX ring
+ *  - RX credit slot: written by the peer, holding the number of messages it consumed 
+ *  - TX credit slot: the source of the credit updates to the peer
+ *
+ * Every message is written as a full slot, with the sequence number last; since RDMA WRITEs place the bytes in increasing 
+ * address order, a message is complete once its sequence number is visible. Sequence numbers are monotonic, so that packets
+ * replayed by the RDMA stack (which re-reads the local memory) are recognised as already seen. A TX slot is only reused 
+ * once the peer returned its credit, i.e., once the message was consumed, so a replayed message is byte-identical.
+ * Credits are returned once half of the ring has been consumed, or explicitly with flushCredits().
+ *
+ * @note Both nodes must construct their queue (which clears the region) before either sends, e.g., followed by a cThread::connSync()
+ * @note Not thread-safe; use one queue per sending/receiving thread, each in its own region
+ */
+class cMsgQueue {
+
+private:
+    /// cThread whose QP carries the messages
+    cThread *cthread;
+
+    /// QP index within the cThread, see cThread::addQp()
+    uint32_t qp;
+
+    /// Offset of the queue's region in the QP's buffer (region 0)
+    uint64_t offset;
+
+    /// Number of slots in each ring
+    uint32_t n_slots;
+
+    /// Size of a slot, in bytes
+    uint32_t slot_size;
+
+    /// Local base address of the queue's region
+    char *base;
+
+    /// Number of messages sent and received
+    uint64_t n_sent = { 0 };
+    uint64_t n_received = { 0 };
+
+    /// Number of consumed messages last reported to the peer
+    uint64_t n_credited = { 0 };
+
+    /// Offsets of the rings and credit slots within the region
+    uint64_t rxOffs(uint64_t idx) const { return (idx % n_slots) * slot_size; }
+    uint64_t txOffs(uint64_t idx) const { return (uint64_t) n_slots * slot_size + (idx % n_slots) * slot_size; }
+    uint64_t rxCreditOffs() const { return 2ULL * n_slots * slot_size; }
+    uint64_t txCreditOffs() const { return 2ULL * n_slots * slot_size + slot_size; }
+
+    /// Sequence number trailer of a slot
+    volatile uint64_t* seqAt(uint64_t offs) const { return (volatile uint64_t*) (base + offs + slot_size - sizeof(uint64_t)); }
+
+    /// Writes a slot of the local region to the same offset of the peer's region
+    void writeSlot(uint64_t local_offs, uint64_t remote_offs);
+
+public:
+    /**
+     * @brief Creates a message queue in a region of a connected QP's buffer, and clears the region
+     *
+     * @param cthread cThread whose QP carries the messages; the QP must be connected (e.g., initRDMA() or connectQp())
+     * @param qp QP index within the cThread
+     * @param offset Offset of the queue's region in the QP's buffer; the region must fit the buffer (see getRegionSize())
+     * @param n_slots Number of slots in each ring, i.e., the maximum number of unconsumed messages
+     * @param slot_size Size of a slot, in bytes (multiple of 64); the largest message is slot_size - 16 bytes
+     */
+    cMsgQueue(cThread *cthread, uint32_t qp = 0, uint64_t offset = 0, uint32_t n_slots = MSG_QUEUE_SLOTS, uint32_t slot_size = MSG_QUEUE_SLOT_SIZE);
+
+    /// Size of the region used by a queue, in bytes
+    static uint64_t getRegionSize(uint32_t n_slots = MSG_QUEUE_SLOTS, uint32_t slot_size = MSG_QUEUE_SLOT_SIZE) {
+        return 2ULL * n_slots * slot_size + 2ULL * slot_size;
+    }
+
+    /**
+     * @brief Sends a message, if the peer has a free slot
+     *
+     * @param data Message
+     * @param len Message length, at most getMaxMessageSize()
+     * @return true if the message was sent, false if all the slots are taken (the peer hasn't consumed enough messages)
+     */
+    bool trySend(const void *data, uint32_t len);
+
+    /// Sends a message, spinning until the peer has a free slot
+    void send(const void *data, uint32_t len);
+
+    /**
+     * @brief Receives the next message, if one arrived
+     *
+     * @param data Buffer for the message
+     * @param max_len Size of the buffer; throws if the message doesn't fit
+     * @param len Length of the received message
+     * @return true if a message was received, false otherwise
+     */
+    bool tryRecv(void *data, uint32_t max_len, uint32_t &len);
+
+    /// Receives the next message, spinning until one arrives; returns its length
+    uint32_t recv(void *data, uint32_t max_len);
+
+    /// Returns the credits for all the consumed messages to the peer; otherwise, they are returned once half of the ring was consumed
+    void flushCredits();
+
+    /// Getter: Largest message, in bytes
+    uint32_t getMaxMessageSize() const { return slot_size - 2 * sizeof(uint64_t); }
+
+    /// Getter: Number of messages sent
+    uint64_t getSent() const { return n_sent; }
+
+    /// Getter: Number of messages received
+    uint64_t getReceived() const { return n_received; }
+
+    /// Getter: Number of messages which can be sent before the peer returns further credits
+    uint32_t getCredits() const;
+
+};
+
+}
+
+#endif // _COYOTE_CMSGQUEUE_HPP_
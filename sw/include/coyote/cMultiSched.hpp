@@ -0,0 +1,220 @@
+/*
+ * This file is part of the Coyote <https://github.com/fpgasystems/Coyote>
+ *
+ * MIT Licence
+ * Copyright (c) 2025, Systems Group, ETH Zurich
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _COYOTE_CMULTISCHED_HPP_
+#define _COYOTE_CMULTISCHED_HPP_
+
+#include <map>
+#include <set>
+#include <mutex>
+#include <chrono>
+#include <vector>
+#include <cstdint>
+#include <utility>
+#include <functional>
+#include <syslog.h>
+#include <unordered_map>
+
+#include <coyote/bFunc.hpp>
+#include <coyote/cTask.hpp>
+#include <coyote/cSched.hpp>
+
+namespace coyote {
+
+/// @brief A vFPGA region managed by the cMultiSched, identified by its device and vFPGA ID
+struct cRegion {
+    /// Device number
+    uint32_t device = { 0 };
+
+    /// vFPGA ID
+    int32_t vfid = { 0 };
+};
+
+/**
+ * @brief Coyote multi-vFPGA scheduler
+ *
+ * Load-balances tasks across several vFPGA regions, possibly on different devices.
+ * Each region is still driven by its own cSched instance (and thread), which executes the
+ * tasks dispatched to it and reconfigures the region where needed; this class only decides
+ * to which region a task is dispatched. Since app bitstreams are built for a specific region,
+ * functions are registered per region and a task can only be dispatched to the regions
+ * which have its function registered. Among those, tasks are dispatched to:
+ * (1) an idle region which already holds the function's bitstream,
+ * (2) otherwise, the least recently used idle region (which is then reconfigured),
+ * (3) otherwise, i.e., if all regions are busy, the region with the fewest outstanding tasks,
+ *     counting a required reconfiguration as one additional task.
+ *
+ * Additionally, when a task is dispatched and no other idle region holds its function's bitstream,
+ * the least recently used idle region is reconfigured with it in the background (see cSched::preload),
+ * so that the next task of the function doesn't wait for a reconfiguration.
+ *
+ * Since tasks execute on the cThread of the region they were dispatched to, pickRegion(...)
+ * is called before creating the task, and the task is then submitted with addTask(region, ...).
+ */
+class cMultiSched {
+
+private:
+    /// A region and its scheduler
+    struct regionSched {
+        /// Region described by its device and vFPGA ID
+        cRegion region;
+
+        /// Scheduler of the region; shared with any other user of cSched::getInstance for the same region
+        cSched *scheduler;
+        
+        /// Last time a task was dispatched to the region; used to reconfigure the least recently used region
+        std::chrono::steady_clock::time_point last_used;
+    };
+
+    /// The regions managed by this scheduler
+    std::vector<regionSched> regions;
+
+    /// A map from task ID to the index of the region it was dispatched to
+    std::unordered_map<int32_t, uint32_t> task_regions;
+
+    /// Lock, protecting task_regions and the last-used timestamps of the regions
+    std::mutex lock;
+
+    /**
+     * @brief Utility function to find the scheduler a task was dispatched to
+     *
+     * @param tid Task ID 
+     * @return Scheduler of the region the task was dispatched to; nullptr if the task is unknown
+     */
+    cSched* taskScheduler(int32_t tid);
+
+public:
+    /**
+     * @brief Creates a scheduler for a set of vFPGA regions
+     *
+     * @param regions Regions (device and vFPGA ID) managed by the scheduler
+     * @param reorder If true, the schedulers of the regions reorder tasks to minimize the number of reconfigurations
+     */
+    cMultiSched(std::vector<cRegion> regions, bool reorder = true);
+
+    /// @brief Starts the schedulers of all the regions
+    void start();
+
+    /// @brief Stops the schedulers of all the regions
+    void stop();
+
+    /// @brief Returns the number of regions managed by the scheduler
+    uint32_t getNumRegions() const { return regions.size(); }
+
+    /**
+     * @brief Returns the region (device and vFPGA ID) with the given index
+     *
+     * @param idx Region index, in the range [0, getNumRegions())
+     */
+    cRegion getRegion(uint32_t idx) const { return regions.at(idx).region; }
+
+    /// @brief Enables lazy loading of function bitstreams in all the regions; see cSched::setLazyBitstreams(...)
+    void setLazyBitstreams(bool lazy);
+
+    /// @brief Enables or disables per-task logging in all the regions; see cSched::setTaskLogging(...)
+    void setTaskLogging(bool log_tasks);
+
+    /**
+     * @brief Returns the metrics of the tasks executed in a region, by function ID; see cSched::getMetrics()
+     *
+     * @param idx Index of the region
+     */
+    std::map<int32_t, cTaskMetrics> getMetrics(uint32_t idx) { return regions.at(idx).scheduler->getMetrics(); }
+
+    /**
+     * @brief Sets the function called whenever a task completes, in any of the regions; see cSched::setCompletionCallback(...)
+     *
+     * @param callback Function called with the completed task; must be set before start()
+     */
+    void setCompletionCallback(std::function<void(cTask*)> callback);
+
+    /**
+     * @brief Adds a user function to a region
+     *
+     * @param idx Index of the region
+     * @param fn Unique pointer to the bFunc object; its bitstream must be the one built for this region
+     * @return Same as cSched::addFunction(...); additionally, 3 if the region index is invalid
+     */
+    int addFunction(uint32_t idx, std::unique_ptr<bFunc> fn);
+
+    /**
+     * @brief Adds several user functions to a region, loading their bitstreams in parallel
+     *
+     * @param idx Index of the region
+     * @param fns Functions to add; their bitstreams must be the ones built for this region
+     * @return One return code per function, as for cSched::addFunctions(...); all 3 if the region index is invalid
+     */
+    std::vector<int> addFunctions(uint32_t idx, std::vector<std::unique_ptr<bFunc>> fns);
+
+    /**
+     * @brief Checks if a function with the given ID is registered in any of the regions
+     *
+     * @param fid Function ID to check
+     */
+    bool isFunctionRegistered(int32_t fid);
+
+    /**
+     * @brief Gets the function with the given ID, from the first region it is registered in
+     *
+     * @param fid Function ID to get
+     * @return Pointer to the bFunc object if found, nullptr otherwise
+     */
+    bFunc* getFunction(int32_t fid);
+
+    /// Returns the IDs of the functions registered in any of the regions, in ascending order
+    std::vector<int32_t> getFunctionIds();
+
+    /**
+     * @brief Picks the region a task of the given function should be dispatched to
+     *
+     * @param fid Function ID of the task
+     * @return Index of the region to dispatch to; -1 if the function is not registered in any region
+     */
+    int32_t pickRegion(int32_t fid);
+
+    /**
+     * @brief Submits a task to a region
+     *
+     * @param idx Index of the region, as returned by pickRegion(...)
+     * @param task Unique pointer to the task; must execute on a cThread of the region
+     * @return true if the task was added successfully, false otherwise
+     */
+    bool addTask(uint32_t idx, std::unique_ptr<cTask> task);
+
+    /// @brief Checks if a task with a given ID is completed; see cSched::isTaskCompleted(...)
+    bool isTaskCompleted(int32_t tid);
+
+    /// @brief Gets the task with the given ID; see cSched::getTask(...)
+    cTask* getTask(int32_t tid);
+
+    /// @brief Retires a completed task; see cSched::releaseTask(...)
+    bool releaseTask(int32_t tid);
+
+};
+
+}
+
+#endif // _COYOTE_CMULTISCHED_HPP_
@@ -0,0 +1,173 @@
+/*
+ * This file is part of the Coyote <https://github.com/fpgasystems/Coyote>
+ *
+ * MIT Licence
+ * Copyright (c) 2025, Systems Group, ETH Zurich
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _COYOTE_CNOTIFYREACTOR_HPP_
+#define _COYOTE_CNOTIFYREACTOR_HPP_
+
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+
+#include <coyote/cDefs.hpp>
+
+namespace coyote {
+
+/**
+ * @brief Notification reactor, handling the user interrupts (notifications) of many cThreads in a single thread
+ *
+ * By default, every cThread with a user interrupt service routine (uisr) has its own eventfd, epoll instance and 
+ * interrupt thread. With many cThreads, most of these threads are idle and each notification wakes up a different one.
+ * cThreads constructed with a reactor (see cThread::cThread()) instead register their eventfds with it: one epoll loop 
+ * per process (or per NUMA node) waits for all of them and dispatches the uisr calls on an executor.
+ *
+ * The uisr calls of a cThread are never concurrent and are made in the order of the notifications, regardless of the
+ * executor; notifications arriving while a uisr call is outstanding are handled by the same dispatched job.
+ *
+ * @note Both the EVENTFD and COALESCED notification modes are supported; POLL doesn't use a thread in the first place
+ */
+class cNotifyReactor {
+
+public:
+    /// Executor of the dispatched jobs; e.g., posts them to a thread pool. By default, the jobs run in the reactor thread
+    using executor_t = std::function<void(std::function<void()>)>;
+
+private:
+    /// Instances of the reactor, by NUMA node (-1 for the process-wide reactor)
+    static std::map<int32_t, cNotifyReactor*> reactors;
+
+    /// Notification source: the eventfd of a cThread and what is needed to handle its notifications
+    struct source {
+        /// vFPGA char device file descriptor of the cThread, for acknowledging the notifications (EVENTFD mode)
+        int fd;
+
+        /// Eventfd of the cThread
+        int efd;
+
+        /// Coyote thread ID of the cThread
+        int32_t ctid;
+
+        /// Notification ring of the cThread, in the COALESCED mode; nullptr otherwise
+        notifyRing *ring;
+
+        /// User interrupt service routine of the cThread
+        std::function<void(int)> uisr;
+
+        /// Wake-ups not handled yet; a job is dispatched on the first one and handles all the later ones, too
+        std::atomic<uint32_t> pending = { 0 };
+
+        /// Set once the source is removed; no more jobs are dispatched for it
+        std::atomic<bool> removed = { false };
+    };
+
+    /// NUMA node of the reactor; -1 if not bound to a node
+    int32_t node;
+
+    /// Epoll instance, waiting for the eventfds of all the sources
+    int epoll_fd = { -1 };
+
+    /// Eventfd for stopping the reactor thread
+    int terminate_efd = { -1 };
+
+    /// Sources, by eventfd
+    std::unordered_map<int, std::shared_ptr<source>> sources;
+
+    /// Executor of the dispatched jobs
+    executor_t executor;
+
+    /// Protects sources and executor
+    std::mutex rlock;
+
+    /// The reactor thread, running the epoll loop
+    std::thread reactor_thread;
+
+    /// Private constructor; the reactors are obtained through getInstance()
+    cNotifyReactor(int32_t node);
+
+    /// The main function of the reactor thread
+    void react();
+
+    /// Job dispatched for a source; handles its notifications until no wake-ups are pending
+    static void handle(const std::shared_ptr<source> &src);
+
+    /// Dispatches the job of a source, unless one is outstanding already
+    void dispatch(const std::shared_ptr<source> &src);
+
+public:
+    /**
+     * @brief Returns the reactor for a NUMA node, creating and starting it if it doesn't exist yet
+     *
+     * @param node NUMA node; the reactor thread runs on the CPUs of the node. -1 (default) for the process-wide reactor, not bound to any node
+     * @return Pointer to a cNotifyReactor instance
+     */
+    static cNotifyReactor* getInstance(int32_t node = -1);
+
+    /// Default destructor; stops the reactor thread
+    ~cNotifyReactor();
+
+    /**
+     * @brief Sets the executor of the dispatched jobs
+     *
+     * @param executor Function which runs (or schedules) the given job; nullptr runs the jobs in the reactor thread
+     */
+    void setExecutor(executor_t executor);
+
+    /**
+     * @brief Registers the eventfd of a cThread; called by the cThread
+     *
+     * @param fd vFPGA char device file descriptor of the cThread
+     * @param efd Eventfd of the cThread
+     * @param ctid Coyote thread ID of the cThread
+     * @param ring Notification ring of the cThread in the COALESCED mode; nullptr otherwise
+     * @param uisr User interrupt service routine of the cThread
+     */
+    void add(int fd, int efd, int32_t ctid, notifyRing *ring, std::function<void(int)> uisr);
+
+    /**
+     * @brief Removes the eventfd of a cThread; called by the cThread when it is destroyed
+     *
+     * @param efd Eventfd of the cThread
+     * @note Blocks until the outstanding job of the cThread (if any) completes; must not be called from its uisr
+     */
+    void remove(int efd);
+
+    /**
+     * @brief Calls the uisr for all the values in a notification ring, in order
+     *
+     * @param ring Notification ring
+     * @param uisr User interrupt service routine
+     * @return Number of values consumed
+     */
+    static uint32_t drain(notifyRing *ring, const std::function<void(int)> &uisr);
+};
+
+}
+
+#endif // _COYOTE_CNOTIFYREACTOR_HPP_
@@ -27,6 +27,8 @@
 #ifndef _COYOTE_COPS_HPP_
 #define _COYOTE_COPS_HPP_
 
+#include <array>
+
 #include <coyote/cDefs.hpp>
 
 namespace coyote {
@@ -36,6 +38,10 @@ namespace coyote {
 //////////////////////////////////////////////////
 
 /// @brief Various Coyote operations that allow users to move data from/to host memory, FPGA memory and remote nodes
+///
+/// @note There are no RDMA atomics (fetch-and-add, compare-and-swap): the RoCE transport (rocev2_ip) is built from the
+/// hw/services/network submodule, which neither parses AtomicETH requests nor generates atomic acknowledgements.
+/// REMOTE_RDMA_FETCH_ADD and REMOTE_RDMA_CMP_SWAP can only be added once the stack supports them.
 enum class CoyoteOper {
     /// No operation
     NOOP = 0,
@@ -64,17 +70,23 @@ enum class CoyoteOper {
     /// Two-sided RDMA send operation
     REMOTE_RDMA_SEND = 8, 
     
-    /// TCP send operation; NOTE: Currently unsupported due to bugs; to be brought back in future releases of Coyote
-    REMOTE_TCP_SEND = 9  
+    /// TCP send operation on a session opened with cThread::tcpOpen() or cThread::tcpListen(); NOTE: experimental, only with EN_TCP_EXPERIMENTAL
+    REMOTE_TCP_SEND = 9,
+
+    /// Copies data between two buffers in FPGA memory (HBM/DDR), without crossing PCIe; see cardCopySg
+    /// NOTE: The data flows through the vFPGA card streams (axis_card_recv[i] => axis_card_send[i]), which the vFPGA must loop back
+    LOCAL_CARD_COPY = 10
 };
 
 /*
  * Various helper function to check the type of operation
  */
 
-inline constexpr bool isLocalRead(CoyoteOper oper) { return oper == CoyoteOper::LOCAL_READ || oper == CoyoteOper::LOCAL_TRANSFER; }
+inline constexpr bool isLocalRead(CoyoteOper oper) { return oper == CoyoteOper::LOCAL_READ || oper == CoyoteOper::LOCAL_TRANSFER || oper == CoyoteOper::LOCAL_CARD_COPY; }
+
+inline constexpr bool isLocalWrite(CoyoteOper oper) { return oper == CoyoteOper::LOCAL_WRITE || oper == CoyoteOper::LOCAL_TRANSFER || oper == CoyoteOper::LOCAL_CARD_COPY; }
 
-inline constexpr bool isLocalWrite(CoyoteOper oper) { return oper == CoyoteOper::LOCAL_WRITE || oper == CoyoteOper::LOCAL_TRANSFER; }
+inline constexpr bool isLocalCardCopy(CoyoteOper oper) { return oper == CoyoteOper::LOCAL_CARD_COPY; }
 
 inline constexpr bool isLocalSync(CoyoteOper oper) { return oper == CoyoteOper::LOCAL_OFFLOAD || oper == CoyoteOper::LOCAL_SYNC; }
 
@@ -90,6 +102,51 @@ inline constexpr bool isRemoteWriteOrSend(CoyoteOper oper) { return oper == Coyo
 
 inline constexpr bool isRemoteTcp(CoyoteOper oper) { return oper == CoyoteOper::REMOTE_TCP_SEND; }
 
+/// @brief Back-off policy used by cThread while waiting for free slots in the vFPGA command FIFO
+enum class CoyoteBackoff {
+    /// Sleep for SLEEP_TIME between re-reading the FIFO occupancy (default); lowest CPU usage
+    SLEEP = 0,
+
+    /// Re-read the FIFO occupancy immediately; lowest latency, but a PCIe read per iteration
+    POLL = 1,
+
+    /// Spin with a CPU pause hint for CMD_FIFO_PAUSE_SPINS iterations between re-reads of the FIFO occupancy
+    PAUSE = 2
+};
+
+/// @brief Backend of the vFPGA lock, see cThread::lock()
+enum class CoyoteLock {
+    /// Named (inter-process) mutex; excludes the users of the vFPGA in all processes (default)
+    SYSTEM = 0,
+
+    /// In-process mutex, shared by the cThreads of the process on the same vFPGA; only excludes users within the process
+    PROCESS = 1
+};
+
+/// @brief Delivery mode of user interrupts (notifications), see cThread::cThread()
+enum class CoyoteNotify {
+    /// Each notification wakes up the interrupt thread through an eventfd and is acknowledged with an IOCTL (default)
+    EVENTFD = 0,
+
+    /// The driver pushes notifications to a ring shared with the user space; the interrupt thread is woken up once per batch
+    COALESCED = 1,
+
+    /// The driver pushes notifications to the ring, but never wakes up a thread; they are handled by cThread::pollNotifications()
+    POLL = 2
+};
+
+/// @brief Pacing of the RDMA WRITEs issued by a cThread, see cThread::setRdmaPacing()
+enum class CoyotePacing {
+    /// No pacing; the writes are only limited by the command FIFO credits (default)
+    NONE = 0,
+
+    /// At most a fixed number of writes (the window) outstanding per QP
+    WINDOW = 1,
+
+    /// Window per QP adapted with AIMD from the RTT of the completions and the retransmissions of the network stack
+    ADAPTIVE = 2
+};
+
 ///////////////////////////////////////////////////
 //                 COYOTE MEMORY                //
 //////////////////////////////////////////////////
@@ -110,7 +167,55 @@ enum class CoyoteAllocType {
     PRM = 3,
 
     /// Memory on the GPU (for GPU-FPGA DMA)
-    GPU = 4 
+    GPU = 4,
+
+    /// 1GB huge pages, independent of the shell's large TLB page size; the size is rounded up to a multiple of 1GB
+    /// NOTE: Requires 1GB pages to be reserved on the host (e.g., hugepagesz=1G hugepages=N on the kernel command line)
+    HPF_1G = 5,
+
+    /// Card memory only (HBM/DDR), without any host memory backing the buffer; the size is rounded up to a multiple of the shell's large TLB page
+    /// NOTE: The buffer must not be accessed from the CPU; its contents can be copied with cThread::syncCardMem() and cThread::offloadCardMem()
+    CARD = 6,
+
+    /// Peer-to-peer window of a vFPGA on another card in the same host; obtained with cThread::importP2PWindow(), not with getMem()
+    /// NOTE: The buffer must not be accessed from the CPU; it is only reachable by the vFPGA, directly over PCIe
+    PEER = 7,
+
+    /// Huge pages where available: HPF (from the pool reserved with cThread::reserveHugePages() first), else THP, else REG;
+    /// a warning is printed on fallback and the obtained backing is recorded in the allocation (see cThread::getAlloc())
+    AUTO = 8
+};
+
+/// @brief Operations on user buffers, in a batch of buffer operations (see cThread::userMemBatch); must match BATCH_OP_* in the driver
+enum class CoyoteMemOp {
+    /// Map the buffer into the vFPGA's TLB, same as cThread::userMap()
+    MAP = 0,
+
+    /// Unmap the buffer from the vFPGA's TLB, same as cThread::userUnmap()
+    UNMAP = 1,
+
+    /// Off-load the buffer to card memory, same as CoyoteOper::LOCAL_OFFLOAD
+    OFFLOAD = 2,
+
+    /// Off-load the buffer to card memory, with the host copy unchanged since the last sync/off-load (see syncSg::host_unchanged)
+    OFFLOAD_HOST_UNCHANGED = 3,
+
+    /// Sync the buffer from card memory, same as CoyoteOper::LOCAL_SYNC
+    SYNC = 4
+};
+
+/// @brief How the vFPGA accesses a mapped host buffer (see cThread::userMap()); must match MAP_USER_READ_ONLY and MAP_USER_WRITE_ONLY in the driver
+enum class CoyoteAccess {
+    /// The vFPGA reads and writes the buffer (default)
+    READ_WRITE = 0,
+
+    /// The vFPGA only reads the buffer (host-to-card); its pages are pinned without write access and never marked dirty on release,
+    /// and a copy migrated to card memory is never copied back
+    READ_ONLY = 0x2,
+
+    /// The vFPGA only writes the buffer (card-to-host); its contents are not copied to card memory on migrations,
+    /// so the parts not written by the vFPGA are undefined once the buffer resided on the card
+    WRITE_ONLY = 0x4
 };
 
 struct CoyoteAlloc {
@@ -118,7 +223,7 @@ struct CoyoteAlloc {
 	CoyoteAllocType alloc = { CoyoteAllocType::REG };
 
 	/// Size of the allocated memory 
-	uint32_t size = { 0 };
+	uint64_t size = { 0 };
 
     /// Is this buffer used for remote operations?
     bool remote = { false };
@@ -133,8 +238,19 @@ struct CoyoteAlloc {
     /// TODO: Add a pointer to some docs, once available
     int32_t mem_block = { -1 };
 
+    /// Number of memory blocks to interleave (stripe) the card memory across, one (huge) page at a time, starting from mem_block (or block 0);
+    /// the blocks are spread evenly over the memory, so that large buffers can use the aggregate bandwidth of multiple HBM channels.
+    /// Only applicable to Versal devices without block memory (EN_BLOCK_MEM); 1 (default) disables striping
+    uint32_t mem_stripe = { 1 };
+
     /// Pointer to the allocated memory; the struct keeps track of it so that it can be freed automatically after use
     void *mem = { nullptr };
+
+    /// NUMA node to place host memory (REG, THP, HPF) on; NUMA_NODE_NONE (default), NUMA_NODE_AUTO (node of the FPGA) or a node ID
+    int32_t numa_node = { NUMA_NODE_NONE };
+
+    /// Access of the vFPGA to host memory (REG, THP, HPF, HPF_1G), see CoyoteAccess
+    CoyoteAccess access = { CoyoteAccess::READ_WRITE };
 };
 
 ///////////////////////////////////////////////////
@@ -153,6 +269,24 @@ struct syncSg {
 
     /// Size of the buffer in bytes
     uint64_t len = { 0 };
+
+    /**
+     * Off-load only: set if the host copy of the buffer was not written (by the CPU or by the vFPGA over the host stream)
+     * since the last sync/off-load; the driver can then re-use the card copy, if it is still resident, instead of copying the buffer
+     */
+    bool host_unchanged = { false };
+};
+
+/// @brief Entry of a batch of buffer operations (see cThread::userMemBatch)
+struct memOpSg {
+    /// Buffer address
+    void* addr = { nullptr };
+
+    /// Size of the buffer in bytes
+    uint64_t len = { 0 };
+
+    /// Operation on the buffer
+    CoyoteMemOp op = { CoyoteMemOp::MAP };
 };
 
 /// @brief Scatter-gather entry for local operations (LOCAL_READ, LOCAL_WRITE, LOCAL_TRANSFER)
@@ -160,8 +294,8 @@ struct localSg {
     /// Buffer address
     void* addr = { nullptr };
 
-    /// Buffer length in bytes
-    uint32_t len = { 0 };
+    /// Buffer length in bytes; transfers over MAX_TRANSFER_SIZE are split into multiple commands by the cThread
+    uint64_t len = { 0 };
 
     /// Buffer stream: HOST or CARD
     uint32_t stream = { STRM_HOST };
@@ -170,6 +304,25 @@ struct localSg {
     uint32_t dest = { 0 };
 };
 
+/** 
+ * @brief Scatter-gather entry for on-card copies (LOCAL_CARD_COPY)
+ * NOTE: Both buffers must be resident in card memory (CoyoteAllocType::CARD, or off-loaded with LOCAL_OFFLOAD);
+ * completions are counted together with the local writes, i.e., checkCompleted(LOCAL_CARD_COPY) == checkCompleted(LOCAL_TRANSFER)
+ */
+struct cardCopySg {
+    /// Source buffer address
+    void* src_addr = { nullptr };
+
+    /// Destination buffer address
+    void* dst_addr = { nullptr };
+
+    /// Length of the copy in bytes; copies over MAX_TRANSFER_SIZE are split into multiple commands by the cThread
+    uint64_t len = { 0 };
+
+    /// Card stream of the vFPGA used for the copy; a value of i will use axis_card_recv[i] and axis_card_send[i]
+    uint32_t dest = { 0 };
+};
+
 /** 
  * @brief Scatter-gather entry for RDMA operations (REMOTE_READ, REMOTE_WRITE)
  * NOTE: No field for source/dest address, since these are defined when exchanging queue pair information
@@ -191,17 +344,95 @@ struct rdmaSg {
     /// Target AXI4 destination stream; a value of i will write write data to axis_(host|card)_send[i] in the remote vFPGA
     uint32_t remote_dest = { 0 };
 
-    /// Lenght of the RDMA transfer, in bytes
-    uint32_t len = { 0 };
+    /// Lenght of the RDMA transfer, in bytes; transfers over MAX_TRANSFER_SIZE are split into multiple commands by the cThread
+    uint64_t len = { 0 };
+
+    /// Index of the cThread's QP used for the transfer, see cThread::addQp(); 0 (the cThread's own QP) by default
+    uint32_t qp = { 0 };
+
+    /// Local memory region of local_offs, see cThread::registerMr(); 0 (the QP's buffer) by default
+    uint32_t local_mr = { 0 };
+
+    /// Remote memory region of remote_offs, as registered by the remote node; 0 (the remote QP's buffer) by default
+    uint32_t remote_mr = { 0 };
+};
+
+/** 
+ * @brief Element of an RDMA chain, see cThread::invokeChain()
+ * Only the offsets and the length vary between the elements; QP, memory regions, streams and destinations are shared by the chain
+ */
+struct rdmaChainSg {
+    /// Offset from the local buffer (or memory region) address
+    uint64_t local_offs = { 0 };
+
+    /// Offset from the remote buffer (or memory region) address
+    uint64_t remote_offs = { 0 };
+
+    /// Length of the transfer, in bytes
+    uint64_t len = { 0 };
+};
+
+/**
+ * @brief Prepared local operation, see cThread::prepare()
+ * The command fields which are the same for every call (Coyote thread ID, streams, destinations, last flag) are encoded
+ * and checked once; invoking the prepared operation only adds the offset to the addresses and the length to the commands.
+ */
+struct localPrep {
+    /// Operation: LOCAL_READ, LOCAL_WRITE or LOCAL_TRANSFER
+    CoyoteOper oper = { CoyoteOper::NOOP };
+
+    /// Command {offs_3, offs_2, offs_1, offs_0}, with the prepared addresses and without the lengths
+    std::array<uint64_t, 4> cmd = { 0, 0, 0, 0 };
+
+    /// Prepared source (LOCAL_READ, LOCAL_TRANSFER) and destination (LOCAL_WRITE, LOCAL_TRANSFER) entries
+    localSg src_sg, dst_sg;
+
+    /// Whether the operation is marked as last, i.e., increments the completion counter
+    bool last = { true };
 };
 
 /// @brief Scatter-gather entry for TCP operations (REMOTE_TCP_SEND)
 struct tcpSg {
+    /// Stream the data is sent from
     uint32_t stream = { STRM_TCP };
+
+    /// Session of the cThread, as passed to cThread::tcpOpen() or cThread::tcpListen()
     uint32_t dest = { 0 };
+
+    /// Number of bytes to send
     uint32_t len = { 0 };
 };
 
+/** 
+ * @brief Timing of a request completed in simulation, see cThread::setTimingTrace()
+ * All times are in clock cycles since the start of the simulation
+ */
+struct simReqTiming {
+    /// Operation the request belongs to
+    CoyoteOper oper = { CoyoteOper::NOOP };
+
+    /// Read (data sent to the vFPGA) or write (data received from the vFPGA)
+    bool rd = { false };
+
+    /// Stream and index of the stream the data was moved on
+    uint32_t strm = { 0 };
+    uint32_t dest = { 0 };
+
+    /// Buffer address and length of the request
+    uint64_t vaddr = { 0 };
+    uint64_t len = { 0 };
+
+    /// Request issued, by the software (invoke) or by the vFPGA (sq_rd/sq_wr)
+    uint64_t issue_cycle = { 0 };
+
+    /// First and last data beat
+    uint64_t first_beat_cycle = { 0 };
+    uint64_t last_beat_cycle = { 0 };
+
+    /// Completion processed
+    uint64_t completion_cycle = { 0 };
+};
+
 
 }
 
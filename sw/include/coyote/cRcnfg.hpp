@@ -27,13 +27,16 @@
 #ifndef _COYOTE_CRCNFG_HPP_
 #define _COYOTE_CRCNFG_HPP_
 
+#include <mutex>
 #include <atomic>
+#include <string>
+#include <vector>
 #include <fcntl.h> 
 #include <fstream>
 #include <unistd.h> 
 #include <sys/mman.h>
 #include <unordered_map> 
-#include <boost/interprocess/sync/named_mutex.hpp>
+#include <unordered_set> 
 
 #include <coyote/cOps.hpp>
 #include <coyote/cDefs.hpp>
@@ -77,15 +80,39 @@ protected:
 	/// A unique generator for crid
     static std::atomic_uint32_t crid_gen;
 
-    /// Global mutex, ensuring no two processes are simultaneously allocating bitstream memory on the same object
-    boost::interprocess::named_mutex mlock;
+    /**
+     * Serializes the bitstream memory allocations of this process; the driver keeps at most one allocated, but not yet mapped,
+     * buffer per process. Other processes allocate (and reconfigure other vFPGAs) independently; the driver arbitrates the ICAP
+     */
+    static std::mutex alloc_lock;
 
 	/*
 	 * Map to keep track of pages allocated to hold partial bitstreams
-	 * By keeping track, de-allocation can be done internally and is not a responsibility of the user
+	 * By keeping track, de-allocation can be done internally and is not a responsibility of the user; protected by alloc_lock
 	 */
 	std::unordered_map<void*, CoyoteAlloc> mapped_pages;
 
+	/*
+	 * Cache of bitstreams loaded with readBitstream(path), so that a bitstream used by several functions
+	 * (or reconfigurations) is only loaded once. Entries are indexed by the identity of the file (device, inode, size and 
+	 * modification time) and by a hash of the contents (to detect copies of the same bitstream under a different path).
+	 * Across processes, bitstreams are shared through the driver's bitstream cache (see getCachedMem)
+	 */
+	std::unordered_map<std::string, bitstream_t> bitstream_files;
+	std::unordered_map<uint64_t, std::vector<bitstream_t>> bitstream_hashes;
+
+	/// Reusable staging buffer for stageBitstream(path), its size in hugepages and the identity of the staged file
+	bitstream_t staging = { nullptr, 0 };
+	uint32_t staging_pages = { 0 };
+	std::string staging_file;
+
+	/// Protects the bitstream cache and the staging buffer
+	std::mutex bitstream_lock;
+
+	/// Completion eventfds of asynchronous reconfigurations, one per vFPGA (created on first use), and the vFPGAs with one in progress
+	std::unordered_map<uint32_t, int> reconfig_efds;
+	std::unordered_set<uint32_t> reconfig_pending;
+
 	/// Helper function, pops and returns the first byte from the input stream (fb)
 	uint8_t readByte(std::ifstream& fb); 
 	
@@ -97,6 +124,33 @@ protected:
 	 */
 	bitstream_t readBitstream(std::ifstream& fb);
 
+	/**
+	 * @brief Read bitstream from a file, that can be used for reconfiguration
+	 *
+	 * The file is read straight into the bitstream memory, in chunks by multiple threads (see BITSTREAM_LOAD_CHUNK).
+	 * Loaded bitstreams are cached; the same file, or another file with the same contents, is only loaded once.
+	 * Thread-safe; different files are loaded in parallel when called from several threads.
+	 * Bitstreams are also added to the driver's bitstream cache, so other processes map the same (read-only) copy instead of loading it.
+	 * 
+	 * @param bitstream_path Path to the bitstream file
+	 * @return bitstream, an in-memory object of type bitstream with virtual address and length
+	 *
+	 * @note The returned memory is owned by this object and must not be released by the caller
+	 */
+	bitstream_t readBitstream(const std::string &bitstream_path);
+
+	/**
+	 * @brief Stage a bitstream for reconfiguration, without keeping it resident
+	 *
+	 * Unlike readBitstream(path), the file is loaded into a single staging buffer which is re-used
+	 * (and grown, if needed) for every staged bitstream; so, the returned bitstream is only valid until the next call.
+	 * Bitstreams already loaded with readBitstream(path) or already staged are not read again.
+	 *
+	 * @param bitstream_path Path to the bitstream file
+	 * @return bitstream, an in-memory object of type bitstream with virtual address and length
+	 */
+	bitstream_t stageBitstream(const std::string &bitstream_path);
+
 	/**
 	 * @brief Base reconfiguration function, can be used to reconfigure the whole shell or individual vFPGAs
 	 * 
@@ -105,12 +159,30 @@ protected:
 	 */
     void reconfigureBase(bitstream_t bitstream, uint32_t vfid = -1);
 
+	/**
+	 * @brief Base asynchronous reconfiguration function; starts the reconfiguration of a vFPGA and returns immediately
+	 * 
+	 * @param bitstream partial bitstream to use for reconfiguration; must stay valid until the reconfiguration completes
+	 * @param vfid vFPGA to reconfigure
+	 * @return eventfd, readable once the reconfiguration completes
+	 */
+	int reconfigureBaseAsync(bitstream_t bitstream, uint32_t vfid);
+
 	/**
 	 * @brief Allocates a buffer for storing partial bitstream
 	 * @param alloc Allocation parameters; most importantly number of pages for the buffer
 	 */
 	void* getMem(CoyoteAlloc&& alloc);
 
+	/**
+	 * @brief Maps a bitstream from the driver's bitstream cache, shared by all processes
+	 *
+	 * @param hash Hash of the bitstream contents (see hashBytes in cRcnfg.cpp)
+	 * @param len Bitstream length, in bytes
+	 * @return read-only memory holding the cached bitstream, released with freeMem; nullptr if the bitstream isn't cached
+	 */
+	void* getCachedMem(uint64_t hash, uint32_t len);
+
 	/**
 	 * @brief Releases dynamically allocated memory (allocated using the above function)
 	 * Similar to the standard C/C++ free() function
@@ -148,6 +220,28 @@ public:
 	 * @param vfid vFPGA ID to be reconfigured
 	 */
 	 void reconfigureApp(std::string bitstream_path, int vfid);
+
+	/**
+	 * @brief Asynchronous app reconfiguration
+	 * Loads the partial bitstream into the internal memory and starts reconfiguration of the specific vFPGA, without
+	 * waiting for it to complete; meanwhile, other vFPGAs can be used and the next tasks prepared.
+	 * Only one asynchronous reconfiguration per vFPGA can be in progress; all reconfigurations are still serialized in the driver
+	 * 
+	 * @param bitstream_path Path to partial bitstream
+	 * @param vfid vFPGA ID to be reconfigured
+	 * @return eventfd, which becomes readable once the reconfiguration completes (e.g., to be used with poll/epoll);
+	 *	it is owned by this object, and the reconfiguration must still be completed with waitReconfiguration
+	 */
+	int reconfigureAppAsync(std::string bitstream_path, int vfid);
+
+	/**
+	 * @brief Waits until an asynchronous reconfiguration completes
+	 * 
+	 * @param vfid vFPGA ID which is being reconfigured
+	 * @throws std::runtime_error if the reconfiguration failed
+	 * @note Returns immediately if no asynchronous reconfiguration of the vFPGA is in progress
+	 */
+	void waitReconfiguration(int vfid);
 };
 
 }
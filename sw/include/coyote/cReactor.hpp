@@ -0,0 +1,161 @@
+/*
+ * This file is part of the Coyote <https://github.com/fpgasystems/Coyote>
+ *
+ * MIT Licence
+ * Copyright (c) 2025, Systems Group, ETH Zurich
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _COYOTE_CREACTOR_HPP_
+#define _COYOTE_CREACTOR_HPP_
+
+#include <map>
+#include <deque>
+#include <mutex>
+#include <future>
+#include <memory>
+#include <thread>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <condition_variable>
+
+#include <coyote/cDefs.hpp>
+#include <coyote/cOps.hpp>
+#include <coyote/cThread.hpp>
+#include <coyote/cCompletionQueue.hpp>
+
+namespace coyote {
+
+/**
+ * @brief Completion reactor, providing asynchronous (future-based) invocations on cThreads
+ *
+ * Instead of every caller spinning on cThread::checkCompleted(), requests are submitted through the reactor,
+ * which returns an std::future that becomes ready once the request completes. A single reactor thread per device
+ * polls the completion counters of all the cThreads with outstanding requests (via a cCompletionQueue per cThread)
+ * and fulfills the futures; when there are no outstanding requests, the reactor thread sleeps on a condition variable.
+ * Submitting only queues the request; the reactor thread issues it, so submitters never wait behind the MMIO writes of others.
+ * Therefore, many transfers (across many cThreads and pipelines) can overlap, without dedicating a core to each of them.
+ *
+ * @note Submissions to the same cThread are serialized by the reactor, so a cThread can be shared between submitting threads
+ * @note All requests on a cThread should go through the reactor once it is used, see cCompletionQueue for details
+ */
+class cReactor {
+
+private:
+    /// Instances of the reactor, one per device
+    static std::map<uint32_t, cReactor*> reactors;
+
+    /// Outstanding state for a cThread: its completion queue, the promises for the tickets in it and the number of queued, not yet issued, requests
+    struct threadState {
+        std::unique_ptr<cCompletionQueue> cq;
+        std::unordered_map<uint64_t, std::promise<void>> promises;
+        size_t n_queued = { 0 };
+    };
+
+    /// Submitted request, waiting to be issued by the reactor thread
+    struct submission {
+        cThread *cthread;
+        cCompletionQueue *cq;
+        std::function<uint64_t(cCompletionQueue&)> issue;
+        std::promise<void> promise;
+        uint64_t ticket;
+        bool failed;
+    };
+
+    /// Device number associated with the reactor
+    uint32_t device;
+
+    /// All the cThreads that submitted requests through the reactor
+    std::unordered_map<cThread*, threadState> threads;
+
+    /// Submitted requests, in submission order; issued by the reactor thread
+    std::deque<submission> submissions;
+
+    /// Number of outstanding (queued or issued) requests, across all cThreads
+    size_t n_outstanding = { 0 };
+
+    /// Protects the state above; held while queueing and while polling, but not while issuing
+    std::mutex rlock;
+
+    /// Wakes up the reactor thread when new requests are submitted
+    std::condition_variable rcv;
+
+    /// A dedicated thread that polls for completions
+    std::thread reactor_thread;
+
+    /// A flag indicating whether the reactor thread is running
+    bool reactor_running;
+
+    /// Default constructor; private to ensure the class is implemented as a singleton
+    cReactor(uint32_t device);
+
+    /// The main function of the reactor thread
+    void react();
+
+    /// Issues the queued requests on the reactor thread; rlock is released while issuing
+    void issueSubmissions(std::unique_lock<std::mutex> &guard);
+
+    /// Queues a request, issued by the provided function on the cThread's completion queue
+    std::future<void> submit(cThread *cthread, const std::function<uint64_t(cCompletionQueue&)> &issue);
+
+public:
+    /**
+     * @brief Returns the reactor for this device; creating and starting it, if it doesn't exist yet ("singleton" implementation)
+     *
+     * @param device Device number, for systems with multiple vFPGAs
+     * @return Pointer to a cReactor instance
+     */
+    static cReactor* getInstance(uint32_t device = 0);
+
+    /// Default destructor; stops the reactor thread
+    ~cReactor();
+
+    /**
+     * @brief Asynchronously invokes a one-sided local operation (LOCAL_READ or LOCAL_WRITE)
+     * @return Future which becomes ready once the operation completes; holds an exception if the submission failed
+     */
+    std::future<void> invokeAsync(cThread *cthread, CoyoteOper oper, localSg sg);
+
+    /**
+     * @brief Asynchronously invokes a two-sided local operation (LOCAL_TRANSFER)
+     * @return Future which becomes ready once the operation completes; holds an exception if the submission failed
+     */
+    std::future<void> invokeAsync(cThread *cthread, CoyoteOper oper, localSg src_sg, localSg dst_sg);
+
+    /**
+     * @brief Asynchronously invokes an RDMA operation (REMOTE_RDMA_READ or REMOTE_RDMA_WRITE)
+     * @return Future which becomes ready once the operation completes; holds an exception if the submission failed
+     */
+    std::future<void> invokeAsync(cThread *cthread, CoyoteOper oper, rdmaSg sg);
+
+    /**
+     * @brief Removes a cThread from the reactor; must be called before the cThread is destroyed
+     *
+     * @param cthread cThread to be removed
+     * @note Blocks until all the outstanding requests of the cThread complete
+     */
+    void release(cThread *cthread);
+};
+
+}
+
+#endif // _COYOTE_CREACTOR_HPP_
@@ -0,0 +1,141 @@
+/*
+ * This file is part of the Coyote <https://github.com/fpgasystems/Coyote>
+ *
+ * MIT Licence
+ * Copyright (c) 2025, Systems Group, ETH Zurich
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _COYOTE_CRESULTCACHE_HPP_
+#define _COYOTE_CRESULTCACHE_HPP_
+
+#include <list>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+
+#include <coyote/cDefs.hpp>
+#include <coyote/cTask.hpp>
+
+namespace coyote {
+
+/**
+ * @brief Bounded LRU cache of task results, used by the cService for idempotent (cacheable) functions
+ *
+ * Results are keyed on the function ID and the serialized arguments of the task (as in cTask::getArgs()),
+ * so a repeated request can be answered without scheduling it on the vFPGA. The memory of the cache 
+ * (keys and return values) is bounded; once full, the least recently used results are evicted.
+ *
+ * @note The cache is thread-safe: it is looked up by the reactors and populated by the scheduler threads
+ */
+class cResultCache {
+
+private:
+    /// Cached result: key (function ID and arguments) and the serialized return value
+    struct cacheEntry {
+        std::string key;
+        std::vector<char> ret_val;
+    };
+
+    /// Cached results, from the most to the least recently used
+    std::list<cacheEntry> entries;
+
+    /// Index of the cached results, by key
+    std::unordered_map<std::string, std::list<cacheEntry>::iterator> index;
+
+    /// Lock, protecting entries, index and the counters
+    std::mutex lock;
+
+    /// Maximum number of bytes (keys and return values) held by the cache; 0 disables it
+    size_t capacity;
+
+    /// Number of bytes currently held by the cache
+    size_t size = { 0 };
+
+    /// Number of lookups which found a result
+    uint64_t hits = { 0 };
+
+    /// Number of lookups which did not find a result
+    uint64_t misses = { 0 };
+
+    /// Number of results evicted to make space for newer ones
+    uint64_t evictions = { 0 };
+
+    /// Builds the key of a task; each argument is prefixed by its size, so that different argument splits never collide
+    static std::string makeKey(int32_t fid, const cTaskArgs &args);
+
+    /// Removes least recently used results until the cache holds at most target bytes; must be called with lock held
+    void evict(size_t target);
+
+public:
+    /**
+     * @brief Default constructor
+     *
+     * @param capacity Maximum number of bytes (keys and return values) held by the cache; 0 disables it
+     */
+    cResultCache(size_t capacity = DEF_RESULT_CACHE_SIZE) : capacity(capacity) {}
+
+    /**
+     * @brief Looks up the result of a task and, if found, marks it as the most recently used
+     *
+     * @param fid Function ID
+     * @param args Serialized function arguments, one buffer per argument
+     * @param ret_val Set to the cached return value, if found
+     * @return true on a hit, false on a miss
+     */
+    bool get(int32_t fid, const cTaskArgs &args, std::vector<char> &ret_val);
+
+    /**
+     * @brief Stores the result of a (successfully) completed task, evicting older results if needed
+     *
+     * @param fid Function ID
+     * @param args Serialized function arguments, one buffer per argument
+     * @param ret_val Serialized return value
+     *
+     * @note Results larger than the capacity of the cache are not stored
+     */
+    void put(int32_t fid, const cTaskArgs &args, const std::vector<char> &ret_val);
+
+    /// Sets the capacity (in bytes) of the cache, evicting results if it shrinks; 0 disables (and clears) the cache
+    void setCapacity(size_t capacity);
+
+    /// Getter: Capacity of the cache, in bytes
+    size_t getCapacity();
+
+    /// Getter: Number of bytes currently held by the cache
+    size_t getSize();
+
+    /// Getter: Number of lookups which found a result
+    uint64_t getHits();
+
+    /// Getter: Number of lookups which did not find a result
+    uint64_t getMisses();
+
+    /// Getter: Number of results evicted to make space for newer ones
+    uint64_t getEvictions();
+
+};
+
+}
+
+#endif // _COYOTE_CRESULTCACHE_HPP_
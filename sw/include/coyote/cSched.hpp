@@ -28,15 +28,24 @@
 #define _COYOTE_CSCHED_HPP_
 
 #include <map>
+#include <set>
+#include <deque>
 #include <mutex>
+#include <chrono>
 #include <vector>
 #include <fstream>
 #include <cstdint>
+#include <algorithm>
+#include <functional>
 #include <syslog.h>
+#include <unordered_map>
+#include <condition_variable>
 
+#include <coyote/cLog.hpp>
 #include <coyote/bFunc.hpp>
 #include <coyote/cTask.hpp>
 #include <coyote/cRcnfg.hpp>
+#include <coyote/cStats.hpp>
 
 namespace coyote {
 
@@ -50,12 +59,21 @@ namespace coyote {
  * it is possible to write code that interacts directly with the scheduler), which dispatches the tasks 
  * based on a scheduling policy. Where needed, the scheduler will also reconfigure the vFPGA bitstream
  * with the one correct for the function. Currently, there are two scheduling policieies implemented:
- * (1) first-come, first-served (FCFS) and (2) minimize reconfigurations. The second one will always
- * execute all the tasks with the same bitstream, avoiding the latency inccured by partial reconfiguration,
- * before proceeding to the next task with a different bitstream.
+ * (1) first-come, first-served (FCFS) and (2) minimize reconfigurations. The second one executes the
+ * pending tasks of the loaded bitstream in batches, avoiding the latency inccured by partial reconfiguration;
+ * a batch ends after max_batch tasks or when a task of another bitstream has waited longer than max_wait
+ * (but not before the batch did at least as much work as the measured reconfiguration time). The next batch
+ * is the one with the oldest starving task or, otherwise, the one with the most pending tasks.
+ * In both cases, the order of the pending tasks is weighted-fair across the Coyote threads that submitted them (see flowState),
+ * so that a burst of tasks from one thread (e.g., one cService client) doesn't delay the tasks of the others.
  *
- * TODO:
- * - Implement more scheduling policies, such as priority-based scheduling
+ * On top of both policies, tasks have a priority class and, optionally, a deadline (see cTask::setPriority() and cTask::setDeadline()).
+ * Classes are strictly ordered: only the bitstreams with a pending task of the most urgent class are considered, and within a bitstream,
+ * the tasks of that class are started first. Within a class, tasks with a deadline go first, earliest deadline first (EDF), followed by the
+ * others in the weighted fair order. With reordering, a bitstream other than the loaded one is only preferred for its deadline if the 
+ * deadline is earlier than the current bitstream's even after a reconfiguration (i.e., postponed by the measured reconfiguration time).
+ * To protect the lower classes from starvation, a pending task is promoted by one class for every SCHED_PRIORITY_AGING us it waits.
+ * Executing tasks are never preempted, so a task may still wait for the longest running task of a (concurrent) function.
  */
 class cSched: public cRcnfg {
 
@@ -81,28 +99,149 @@ private:
     /// A map of the functions loaded to the scheduler, each identified by a unique function ID
     std::map<int32_t, std::unique_ptr<bFunc>> functions;
 
-    /// A list of tasks submitted to the scheduler
-    std::vector<std::unique_ptr<cTask>> tasks;
+    /**
+     * @brief Tasks submitted to the scheduler, indexed by task ID
+     *
+     * A task stays in the map from submission until it is retired with releaseTask(),
+     * i.e., after its result has been consumed; this keeps the map bounded by the number of in-flight tasks
+     */
+    std::unordered_map<int32_t, std::unique_ptr<cTask>> tasks;
+
+    /// A task waiting in a run queue
+    struct pendingTask {
+        /// Task ID
+        int32_t tid;
+
+        /// Virtual start time of the task, see flowState; defines the (weighted fair) order of the tasks without a deadline
+        uint64_t tag;
+
+        /// Submission sequence number; breaks ties between equal tags
+        uint64_t seq;
+
+        /// Submission time, used for aging
+        std::chrono::steady_clock::time_point submitted;
+
+        /// Deadline of the task; time_point::max() if it has none
+        std::chrono::steady_clock::time_point deadline;
+
+        /// Order of the tasks within a priority class: earliest deadline first, then by tag
+        bool operator<(const pendingTask &other) const {
+            return deadline != other.deadline ? deadline < other.deadline : (tag != other.tag ? tag < other.tag : seq < other.seq);
+        }
+    };
+
+    /// Run queue of a bitstream; the tasks that are yet to be executed, one queue per priority class, each ordered by pendingTask::operator<
+    struct runQueue {
+        /// Pending tasks, by priority class
+        std::deque<pendingTask> classes[SCHED_N_PRIORITIES];
+
+        /// Number of pending tasks, across the classes
+        size_t size = { 0 };
+    };
+
+    /// Run queues, one per bitstream. Empty queues are removed
+    std::map<std::string, runQueue> run_queues;
 
-    /// A simple map from task ID to its position in the tasks vector; simply used for faster lookups of individual tasks
-    std::map<int32_t, int> task_id_map;
+    /**
+     * @brief Returns the priority class of a pending task, after the promotions for the time it waited (see SCHED_PRIORITY_AGING)
+     *
+     * @param task Pending task
+     * @param priority Its (original) priority class
+     * @param now Current time
+     */
+    static uint32_t effectivePriority(const pendingTask &task, uint32_t priority, std::chrono::steady_clock::time_point now) {
+        uint64_t promotions = (now - task.submitted) / std::chrono::microseconds(SCHED_PRIORITY_AGING);
+        return promotions >= priority ? 0 : priority - promotions;
+    }
 
     /**
-     * @brief Task lock; there are multiple concurrent threads that access the tasks 
-     * vector, and since vectors can relocate data (e.g., when adding new elements),
-     * this can lead to undefined behaviour. E.g., the scheduler thread iterates
-     * through the tasks vector, while the addTask() function could be called in the meantime,
-     * which would cause the vector to be resized and may cause the iterators to become invalid.
+     * @brief Weighted fair queuing state of a flow, i.e., the tasks of one Coyote thread (for cService, one client)
+     *
+     * Pending tasks are ordered by start-time fair queuing: a task's tag is the later of the scheduler's virtual time
+     * and the finish tag of the flow's previous task, and the flow's finish tag advances by SCHED_WFQ_QUANTUM / weight.
+     * The virtual time is the tag of the last started task. Hence, a flow submitting a burst of tasks cannot delay the
+     * tasks of other flows by more than one task each, and flows share the vFPGA in proportion to their weights (see cTask::setWeight).
+     * Within a flow, the tags increase, so the tasks of a Coyote thread of the same priority class and without deadlines still execute in order of submission.
+     */
+    struct flowState {
+        /// Finish tag of the flow's last submitted task
+        uint64_t finish;
+
+        /// Number of the flow's tasks in the run queues; the state of a flow without pending tasks is dropped
+        size_t n_pending;
+    };
+
+    /// Flows with pending tasks, indexed by the Coyote thread of the tasks
+    std::unordered_map<cThread*, flowState> flows;
+
+    /// Virtual time of the weighted fair queuing; the tag of the last started task
+    uint64_t virtual_time = { 0 };
+
+    /// Number of tasks submitted so far; used as the sequence number of the next task
+    uint64_t n_submitted = { 0 };
+
+    /// Number of tasks in the run queues
+    size_t n_pending = { 0 };
+
+    /// Number of tasks being executed by the workers (including the reconfiguration for them)
+    size_t n_executing = { 0 };
+
+    /// Set while a reconfiguration or an exclusive task is in progress; no other task is started meanwhile
+    bool barrier = { false };
+
+    /// Coyote threads of the executing tasks; a Coyote thread executes one task at a time
+    std::set<cThread*> busy_threads;
+
+    /// Function whose bitstream should be loaded while the vFPGA is idle, see preload(); -1 if none
+    int32_t preload_fid = { -1 };
+
+    /// Reordering policy: maximum number of tasks executed per reconfiguration 
+    uint32_t max_batch = { SCHED_MAX_BATCH };
+
+    /// Reordering policy: waiting time after which a task of another bitstream ends the current batch
+    std::chrono::microseconds max_wait = { std::chrono::microseconds(SCHED_MAX_WAIT) };
+
+    /// Number of tasks executed since the last reconfiguration
+    uint32_t batch_size = { 0 };
+
+    /// Time spent executing tasks since the last reconfiguration
+    std::chrono::nanoseconds batch_busy = { std::chrono::nanoseconds(0) };
+
+    /// Moving average of the measured reconfiguration time
+    std::chrono::nanoseconds reconfig_time = { std::chrono::nanoseconds(0) };
+
+    /**
+     * @brief Task lock; protects the tasks map, the run queue and the completion state of the tasks,
+     * since tasks are submitted and queried (e.g., from cService) concurrently with the scheduler thread.
+     * The lock is not held while a task executes, so that submissions and queries are never blocked by a long-running task.
      */ 
     std::mutex tlock;
 
-    /// A dedicated thread that runs the scheduler
-    std::thread scheduler_thread;
+    /// Signalled when a task is added to the run queue, a task completes or the scheduler is stopped
+    std::condition_variable tcv;
+
+    /// Number of worker threads which execute tasks
+    uint32_t n_workers = { SCHED_N_WORKERS };
+
+    /// If set, function bitstreams are not kept resident, but staged just before reconfiguration, see setLazyBitstreams()
+    bool lazy_bitstreams = { false };
+
+    /// Metrics of the executed tasks, by function ID; protected by tlock
+    std::map<int32_t, cTaskMetrics> metrics;
+
+    /// If set, every task submission and execution is logged to syslog; off by default, since it's a cost on the hot path
+    bool log_tasks = { false };
 
-    /// A flag indicating whether the scheduler thread is running
+    /// If set, called by the workers for every completed task, see setCompletionCallback()
+    std::function<void(cTask*)> completion_callback;
+
+    /// Worker threads that run the scheduler
+    std::vector<std::thread> workers;
+
+    /// A flag indicating whether the scheduler threads are running
     bool scheduler_running;
 
-    /// The currently loaded bitstream
+    /// The currently loaded bitstream; only written while reconfiguring (i.e., with the barrier set), with tlock held
     std::string current_bitstream;
 
     /// Default constructor; private to ensure the class is implemented as a singleton
@@ -111,22 +250,62 @@ private:
     /**
      * @brief A utility function that is reaused throughut the scheduler
      * Does the following checks:
-     * 1. Checks if the task ID is present in the task_id_map
+     * 1. Checks if the task ID is present in the tasks map
      * 2. Checks whether the task is non-NULL
-     * 3. As a common sanity check, ensures the ID in the map and the ID in the vector match
-     *  If not, something went seriously wrong when inserting the task to the list of tasks.
+     * 3. As a common sanity check, ensures the ID in the map and the ID of the task match
+     *  If not, something went seriously wrong when inserting the task to the map of tasks.
      *
      * @param tid Task ID to check
      * @return true if the task is found and valid, false otherwise
+     *
+     * @note Must be called with tlock held
      */
     bool taskChecker(int32_t tid);
 
     /**
-     * @brief The main function of the scheduler
+     * @brief Picks the next task to execute from the run queues and removes it from its queue
+     *
+     * The head of a run queue is its most urgent task: the one of the highest (effective) priority class, earliest deadline and lowest tag.
+     * Without reordering, the next queue is the one with the most urgent head; with reordering, it is picked in batches per bitstream
+     * among the queues whose head is of the most urgent class, as described in the class documentation. From that queue, the first
+     * task (in order of class, then deadline and tag) whose Coyote thread is idle is picked. Only the pending tasks are considered, 
+     * so the cost doesn't grow with the number of tasks processed.
+     *
+     * @param tid Set to the task ID of the next task; -1 for a pre-load (reconfiguration without a task), see preload()
+     * @param reconfigure Set if the next task requires a reconfiguration
+     * @return true if a task can be started now; false if there is none or the next one must wait 
+     *         (for a barrier, for the executing tasks to drain before a barrier or for its Coyote thread)
+     *
+     * @note Must be called with tlock held
+     */
+    bool nextTask(int32_t &tid, bool &reconfigure);
+
+    /**
+     * @brief Reconfigures the vFPGA with the bitstream of a function and starts a new batch
+     *
+     * @param fn Function whose bitstream is loaded
+     * @param guard Lock on tlock; must be unlocked when called and is locked on successful return
+     *
+     * @note Throws if the reconfiguration failed
+     */
+    void loadBitstream(bFunc *fn, std::unique_lock<std::mutex> &guard);
+
+    /**
+     * @brief Invokes the completion callback (if any) for a completed task
      *
-     * It iterates through the list of outstanding tasks and
-     * executed the outstanding ones. The scheduling policy depends
-     * on the variable scheduling_policy, passed to the class constructor.
+     * @param task Completed task
+     * @param guard Lock on tlock; must be locked when called, released during the callback and locked again on return
+     */
+    void notifyCompletion(cTask *task, std::unique_lock<std::mutex> &guard);
+
+    /**
+     * @brief The main function of the scheduler, executed by each of the worker threads
+     *
+     * It sleeps until a task can be started and executes it. The scheduling policy depends
+     * on the variable reorder, passed to the class constructor. Tasks of concurrent functions
+     * (see bFunc::isConcurrent()) from different Coyote threads execute in parallel, as long as
+     * their bitstream is loaded. Reconfigurations and tasks of other functions are barriers; 
+     * they start once the executing tasks completed and no other task starts before they complete.
      * This function will also reconfigure the vFPGA bitstream, if needed.
      */
     void schedule();
@@ -173,6 +352,65 @@ public:
      */
     void stop();
 
+    /**
+     * @brief Speculatively reconfigures the idle vFPGA with the bitstream of a function, ahead of its tasks
+     *
+     * The reconfiguration starts in the background once the vFPGA is idle;
+     * it is dropped if a task is submitted before it started.
+     *
+     * @param fid Function ID whose bitstream should be loaded
+     * @return true if the pre-load was scheduled, false if the vFPGA is busy, already holds the bitstream, 
+     *         the function is unknown or partial reconfiguration isn't enabled
+     */
+    bool preload(int32_t fid);
+
+    /**
+     * @brief Enables lazy loading of function bitstreams
+     *
+     * By default, addFunction(...) loads each function's bitstream into pinned (PRM) memory and keeps it resident, 
+     * so that reconfigurations start immediately. With lazy loading, bitstreams are instead read into a single, re-used 
+     * staging buffer just before the reconfiguration; this keeps the resident memory at the size of the largest bitstream,
+     * at the cost of reading the bitstream for each reconfiguration (which is accounted for in the reconfiguration time).
+     *
+     * @param lazy Enable (true) or disable (false) lazy loading; applies to functions added afterwards
+     */
+    void setLazyBitstreams(bool lazy) { lazy_bitstreams = lazy; }
+
+    /**
+     * @brief Sets the number of worker threads, i.e., the maximum number of concurrently executing tasks
+     *
+     * @param n_workers Number of workers (at least 1); must be set before start()
+     */
+    void setWorkers(uint32_t n_workers);
+
+    /// Enables (true) or disables (false) logging every task submission and execution to syslog; errors are always logged
+    void setTaskLogging(bool log_tasks) { this->log_tasks = log_tasks; }
+
+    /**
+     * @brief Returns the metrics of the tasks executed so far on this vFPGA
+     *
+     * @return Copy of the metrics (queueing delay, reconfiguration and execution time, completed and failed tasks) by function ID
+     */
+    std::map<int32_t, cTaskMetrics> getMetrics();
+
+    /**
+     * @brief Sets a function which is called whenever a task completes, e.g., to push the result to a client
+     *
+     * The callback is invoked from the worker thread that completed the task, without holding the scheduler lock.
+     * The task remains valid until it is retired with releaseTask(), which the callback itself is allowed to call.
+     *
+     * @param callback Function called with the completed task; must be set before start()
+     */
+    void setCompletionCallback(std::function<void(cTask*)> callback) { completion_callback = std::move(callback); }
+
+    /**
+     * @brief Sets the batching policy used when reordering is enabled
+     *
+     * @param max_batch Maximum number of tasks executed per reconfiguration (at least 1) 
+     * @param max_wait_us Time, in us, after which a pending task of another bitstream ends the current batch 
+     */
+    void setReorderPolicy(uint32_t max_batch, uint64_t max_wait_us);
+
     /**
      * @brief Adds a task to list of tasks to be executed by the scheduler
      *
@@ -199,6 +437,22 @@ public:
      */
     cTask* getTask(int32_t tid);
 
+    /**
+     * @brief Retires a completed task, releasing its arguments and return value
+     *
+     * @param tid Task ID to release
+     * @return true if the task was released, false if it was not found or is still pending
+     *
+     * @note Pointers obtained from getTask(tid) are invalid after this call
+     */
+    bool releaseTask(int32_t tid);
+
+    /// @brief Returns the number of tasks that are pending or executing on the vFPGA
+    size_t getLoad();
+
+    /// @brief Returns the path of the bitstream currently loaded to the vFPGA
+    std::string getCurrentBitstream();
+
     /**
      * @brief Checks if a function with the given ID is registered in the scheduler
      *
@@ -214,6 +468,9 @@ public:
      */
     bFunc* getFunction(int32_t fid);
 
+    /// Returns the IDs of all the functions registered in the scheduler, in ascending order
+    std::vector<int32_t> getFunctionIds();
+
     /**
      * @brief Adds an arbitrary user function to the scheduler
      *
@@ -223,38 +480,19 @@ public:
      *
      * @param fn Unique pointer to the bFunc object representing the function
      * @return 0 if the function was added successfully, 1 if bitstream cannot be opened, 2 if the function ID already exists 
-     *
-     * @note Implemented in the header file, since the function is a template.
      */
-    int addFunction(std::unique_ptr<bFunc> fn) {
-        int32_t fid = fn->getFid();
-        if (functions.find(fid) == functions.end()) {
-            functions.emplace(fid, std::move(fn));
-
-            std::ifstream bitstream_file(functions[fid]->getBitstreamPath(), std::ios::ate | std::ios::binary);
-            if (!bitstream_file) {
-		        syslog(LOG_ERR, "Function %d bitstream could not be opened; please check the provided bitstream path", fid);
-                functions.erase(fid);
-                return 1;
-	        }
-
-            try {
-                functions[fid]->setBitstreamPointer(readBitstream(bitstream_file));
-            } catch (const std::exception &e) {
-                syslog(LOG_ERR, "Exception while loading function fid %d bitstream: %s", fid, e.what());
-                functions.erase(fid);
-                return 1;
-            }
+    int addFunction(std::unique_ptr<bFunc> fn);
 
-            bitstream_file.close();
-            syslog(LOG_NOTICE, "Added function with fid %d", fid);
-            return 0;
-        
-        } else {
-            syslog(LOG_WARNING, "Function with fid %d already exists, skipping...", fid);
-            return 2;
-        }
-    }
+    /**
+     * @brief Adds several user functions, loading their bitstreams in parallel
+     *
+     * Same as calling addFunction(...) for each function, but up to BITSTREAM_LOAD_FUNCS bitstreams are read at once,
+     * so that a service with a large function catalogue is ready sooner. Returns once all the bitstreams are loaded.
+     *
+     * @param fns Functions to add
+     * @return One return code per function, in order, as for addFunction(...)
+     */
+    std::vector<int> addFunctions(std::vector<std::unique_ptr<bFunc>> fns);
 
 };
 
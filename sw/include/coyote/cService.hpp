@@ -28,18 +28,38 @@
 #define _COYOTE_CSERVICE_HPP_
 
 #include <map>
+#include <chrono>
+#include <iomanip>
+#include <sstream>
 #include <mutex>
+#include <memory>
+#include <thread>
 #include <vector>
 #include <string>
+#include <fcntl.h>
 #include <signal.h>
 #include <unistd.h>
+#include <netdb.h>
 #include <sys/un.h>
 #include <syslog.h>
 #include <sys/stat.h>
-
+#include <sys/uio.h>
+#include <sys/mman.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <arpa/inet.h>
+#include <netinet/tcp.h>
+#include <unordered_map>
+
+#include <coyote/cLog.hpp>
 #include <coyote/cFunc.hpp>
 #include <coyote/cSched.hpp>
 #include <coyote/cThread.hpp>
+#include <coyote/cThreadPool.hpp>
+#include <coyote/cShmRing.hpp>
+#include <coyote/cStats.hpp>
+#include <coyote/cResultCache.hpp>
+#include <coyote/cMultiSched.hpp>
 
 namespace coyote {
 
@@ -51,15 +71,16 @@ namespace coyote {
  * On the client side, the users can connect to this service
  * through the helper class cConn and submit requests to the loaded 
  * functions. The service will automatically reconfigure the vFPGA
- * with the correct bistream. The requests can be local or remote.
+ * with the correct bistream. The requests can be local (Unix socket) or remote (TCP).
+ * A service can also span several vFPGA regions (possibly on different devices),
+ * in which case tasks are load-balanced across the regions (see cMultiSched).
+ * The client sockets are handled by a small number of event-loop threads (reactors), 
+ * and the response of a task is pushed to its client as soon as the task completes.
  * 
  * @note There is currently a bug in terminating the signals. Since the signal handler
  * is static and limited in parameters, is it not aware of what instance should be terminated.
  * Therefore, for now, the signal handler terminates all instances of the service. Users should
  * only terminate the service once all vFPGAs have finished processing requests.
- *
- * TODO:
- *  - Remote connections
  */
 class cService {
 
@@ -71,7 +92,7 @@ private:
      * We only allow one instance of the service per vFPGA on a single device, 
      * to ensure that mutliple services do not run in parallel on the same vFPGA,
      * which can lead to multiple reconfigurations, execution conflicts etc.
-     * The map of the key is the device ID concatenated with the vFPGA ID.
+     * The map of the key is the device ID concatenated with the vFPGA ID, for each of the service's regions.
      */
     static std::map<std::string, cService*> services;
 
@@ -90,53 +111,142 @@ private:
     /// Whether the service receives requests from a remote node or locally
     bool remote;
 
-    /// vFPGA ID associated with the service
-    int32_t vfid;
-
-    /// Device number, for systems with multiple vFPGAs
-    uint32_t device;
+    /// vFPGA regions (device and vFPGA ID) associated with the service
+    std::vector<cRegion> regions;
 
     /// Port for remote connections
     uint16_t port;
 
-    /// A map of the connected clients and their corresponding Coyote threads which are used for executing the functions
-    std::map<int, std::unique_ptr<cThread>> coyote_threads;
+    /// @brief State of a connected client
+    struct clientConn {
+        /// Connection file descriptor
+        int connfd;
 
-    /// Dedicated threads which process the requests for each connected client; one for incoming request and one for writing the result back
-    std::map<int, std::pair<std::thread, std::thread>> connection_threads;
+        /// Process ID of the client; its Coyote threads are created on behalf of this process
+        pid_t rpid;
 
-    /// Scheduler instance; handles the execution of tasks as well as reconfiguration, where required
-    cSched *scheduler;
-    
-    /// An atomic variable; used for generating unique IDs for tasks on the server side
-    std::atomic<int32_t> task_counter;
+        /// Index of the reactor (event-loop thread) handling the client's socket
+        uint32_t reactor;
+
+        /// Coyote threads of the client, one per region, used for executing the functions; created on the first task for the region
+        std::vector<cThreadPool::pooledThread> coyote_threads;
+
+        /// Received bytes not yet processed, i.e., an incomplete request; only accessed by the client's reactor
+        std::vector<char> recv_buff;
+
+        /// Number of valid bytes in recv_buff
+        size_t recv_len = { 0 };
+
+        /// Lock, protecting send_buff and closed; responses are pushed from the scheduler threads
+        std::mutex send_lock;
+
+        /// Framed responses which could not be written yet, since the socket was full; flushed on EPOLLOUT
+        std::vector<char> send_buff;
+
+        /// Set once the connection has been closed; the responses of its outstanding tasks are dropped
+        bool closed = { false };
+
+        /// Whether the client is on the same node (Unix socket); large return values are then shared through memory, see sendSharedResponse()
+        bool local = { false };
+
+        /// Shared-memory channel set up by the client (see cShmRing); nullptr if the client only uses the socket
+        cShmChannel *shm = { nullptr };
+
+        /// Doorbell (eventfd) of the shared-memory request ring; rung by the client and watched by the reactor
+        int req_efd = { -1 };
+
+        /// Doorbell (eventfd) of the shared-memory response ring; rung by the service
+        int resp_efd = { -1 };
+
+        /// Received bytes from the shared-memory request ring not yet processed; a separate stream from the socket's
+        std::vector<char> shm_recv_buff;
+
+        /// Number of valid bytes in shm_recv_buff
+        size_t shm_recv_len = { 0 };
+
+        /// Number of the client's outstanding tasks (submitted, but not yet completed); protected by pending_lock
+        uint32_t n_pending = { 0 };
+
+        /// Weight of the client's tasks in the scheduler's weighted fair queuing, see setClientWeight()
+        uint32_t weight = { 1 };
+    };
+
+    /// Connected clients, indexed by their connection file descriptor (and, for clients with a shared-memory channel, their request doorbell)
+    std::unordered_map<int, std::shared_ptr<clientConn>> clients;
+
+    /// Lock, protecting clients; clients are added by the accepting thread and removed by the reactors
+    std::mutex clients_lock;
 
     /**
-     * @brief A map of client-submitted tasks
+     * @brief Outstanding tasks, indexed by the server-side task ID
+     *
      * When a client submits a task, it holds an ID which is written back with the task result, 
      * so that the client can link the result to the task (see cConn::checkCompletedTasks() for details). 
      * However, there is no guarantee that the client-submitted task ID is globally unique (because of multiple clients), 
-     * so for each task, the cService also stores a server-generated task ID.
+     * so for each task, the cService generates a server-side ID and stores the client and its task ID here.
+     * The entry also keeps the client's state (and its Coyote threads) alive until the task completes.
      */
-    std::map<int, std::vector<std::pair<int32_t, int32_t>>> tasks;
+    std::unordered_map<int32_t, std::pair<std::shared_ptr<clientConn>, int32_t>> pending_tasks;
 
-    /** @brief Task map locks
-     * Since the map is written by the processRequests() thread and read by the  
-     * sendResponses() thread, thread safety must be ensured when accesing the map.
-     */
-    std::map<int, std::unique_ptr<std::mutex>> task_locks;
+    /// Lock, protecting pending_tasks and the clients' counts of outstanding tasks
+    std::mutex pending_lock;
+
+    /// Admission control: maximum number of outstanding tasks per client; further tasks are rejected with DEF_RET_BUSY
+    uint32_t max_client_tasks = { DAEMON_MAX_CLIENT_TASKS };
+
+    /// Admission control: maximum number of outstanding tasks across all clients
+    uint32_t max_tasks = { DAEMON_MAX_TASKS };
+
+    /// Scheduling weights of clients, by PID, see setClientWeight(); clients not in the map have weight 1
+    std::unordered_map<pid_t, uint32_t> client_weights;
+
+    /// Lock, protecting client_weights
+    std::mutex weights_lock;
+
+    /// Number of reactors, i.e., event-loop threads which handle all the client sockets
+    uint32_t n_reactors = { DAEMON_N_REACTORS };
+
+    /// Epoll instance of each reactor
+    std::vector<int> epoll_fds;
+
+    /// Reactor threads
+    std::vector<std::thread> reactors;
 
-    /// A list of connection to be cleaned up; if the bool value is true, the connection is stale and should be cleaned up; false indicated it's been cleaned up
-    std::map<int, bool> conns_to_clean;
+    /// A boolean flag indicating whether the reactors are running
+    bool run_reactors = { false };
 
-    /// Dedicated thread that periodically iterates conns_to_clean and release stale connection threads and resources
-    std::thread cleanup_thread;
+    /// Reactor to which the next accepted connection is assigned; connections are distributed in a round-robin fashion
+    uint32_t next_reactor = { 0 };
 
-    /// A boolean flag indicating whether the clean-up thread is running
-    bool run_cleanup_thread;
+    /// Scheduler instance; dispatches tasks to the regions, which handle the execution of tasks as well as reconfiguration, where required
+    std::unique_ptr<cMultiSched> scheduler;
+    
+    /// Idle Coyote threads of each region, handed out to new clients, since creating a cThread per client is expensive; see setThreadPool()
+    std::vector<std::unique_ptr<cThreadPool>> thread_pools;
+
+    /// Number of idle Coyote threads kept per region
+    uint32_t thread_pool_size = { DAEMON_THREAD_POOL_SIZE };
+
+    /// Results of cacheable functions (see bFunc::isCacheable()); repeated requests are answered without executing them
+    cResultCache result_cache;
+
+    /// Service-level metrics by function ID (response delay, completed, failed, rejected and cached tasks); see getStatsReport()
+    std::map<int32_t, cTaskMetrics> metrics;
+
+    /// Lock, protecting metrics
+    std::mutex stats_lock;
+
+    /// Time the service was started; used for the throughput in the stats report
+    std::chrono::steady_clock::time_point start_time;
+
+    /// If set, every request and response is logged to syslog; off by default, since it's a cost on the hot path
+    bool log_tasks = { false };
+
+    /// An atomic variable; used for generating unique IDs for tasks on the server side
+    std::atomic<int32_t> task_counter;
 
     /// Default constructor; private to ensure the class is implemented as a singleton
-    cService(std::string name, bool remote, int32_t vfid, uint32_t device, bool reorder, uint16_t port);
+    cService(std::string name, bool remote, std::vector<cRegion> regions, bool reorder, uint16_t port);
 
     /**
      * @brief Handles signals sent to the background service
@@ -155,35 +265,138 @@ private:
     /// Initializes the socket for connections to this service, either local or remote
     void initSocket();
 
-    /// Function that periodically iterates and releases resources (e.g., threads) held by stale connections
-    void cleanConns();
-
     /// Accepts a local connection (IPC) to this service
     void acceptConnectionLocal();
 
-    /// Accepts a connection from a remote client to this service
+    /// Accepts a connection from a remote client (TCP) to this service
     void acceptConnectionRemote();
 
     /**
-     * @brief Processes client requests in a dedicated thread
+     * @brief Creates the state for a newly accepted client and hands its socket over to one of the reactors
      *
-     * This function continuously loops to accept incoming requests
-     * for a connected client. It stores the requests in a list and
-     * can close the connection if the client sends a close request.
+     * @param connfd Connection file descriptor of the client
+     * @param rpid PID under which the client's cThreads are registered with the driver
+     * @param msg Registration message of a local client, possibly holding a shared-memory channel; nullptr for remote clients
+     */
+    void registerClient(int connfd, pid_t rpid, struct msghdr *msg);
+
+    /**
+     * @brief Maps the shared-memory channel passed by a client (if any) alongside its PID
      *
-     * @param connfd The connection file descriptor for the client
+     * @param conn Client connection
+     * @param msg Message holding the PID, with the channel and its doorbells as SCM_RIGHTS ancillary data
      */
-    void processRequests(int connfd);
+    void attachShm(clientConn &conn, struct msghdr &msg);
 
     /**
-     * @brief Send client responses in a dedicated thread
+     * @brief Event loop of a reactor
+     *
+     * Waits for events on the sockets of the clients assigned to the reactor: incoming requests 
+     * are read and submitted to the scheduler, while pending responses are flushed once the socket is writable.
      *
-     * This function continuously loops to check whether a client task
-     * has been completed and sends the response back to the client.
+     * @param reactor Index of the reactor
+     */
+    void runReactor(uint32_t reactor);
+
+    /// Looks up a connected client by its connection file descriptor; nullptr if not connected (anymore)
+    std::shared_ptr<clientConn> getClient(int connfd);
+
+    /**
+     * @brief Reads all the available data from the client's socket and handles the complete requests
+     *
+     * @param conn Client connection
+     * @return false if the connection should be closed (close request, disconnect or protocol error), true otherwise
+     */
+    bool processRequests(const std::shared_ptr<clientConn> &conn);
+
+    /**
+     * @brief Drains the client's shared-memory request ring and handles the complete requests; called when its doorbell is rung
+     *
+     * @param conn Client connection
+     * @return false if the connection should be closed (close request or protocol error), true otherwise
+     */
+    bool processShmRequests(const std::shared_ptr<clientConn> &conn);
+
+    /**
+     * @brief Handles all the complete request frames in a receive buffer
+     *
+     * @param conn Client connection
+     * @param buff Buffer holding a stream of request frames; an incomplete frame at the end is moved to the front
+     * @param len Number of valid bytes in buff; updated to the size of the incomplete frame
+     * @return false if the connection should be closed (close request or protocol error), true otherwise
+     */
+    bool handleRequests(const std::shared_ptr<clientConn> &conn, std::vector<char> &buff, size_t &len);
+
+    /**
+     * @brief Handles a single framed request, as received by processRequests()
      *
-     * @param connfd The connection file descriptor for the client
+     * @param conn Client connection
+     * @param header Request header (opcode, function ID, client task ID and payload size)
+     * @param payload Function arguments, back-to-back; exactly header.payload_size bytes
+     * @return false if the client requested to close the connection, true otherwise
      */
-    void sendResponses(int connfd);
+    bool handleRequest(const std::shared_ptr<clientConn> &conn, const cReqHeader &header, const char *payload);
+
+    /**
+     * @brief Frames a response and writes it to the client, without blocking
+     *
+     * If the client set up a shared-memory channel, the response is pushed to its ring. Otherwise, or if the ring is full,
+     * it is written to the socket. If the socket is full, the rest of the response is buffered and the socket is 
+     * registered for EPOLLOUT, so that the reactor sends it once the socket is writable.
+     *
+     * @param conn Client connection
+     * @param header Response header
+     * @param payload Return value; header.payload_size bytes
+     */
+    void sendResponse(clientConn &conn, const cRespHeader &header, const char *payload);
+
+    /**
+     * @brief Buffers the unsent remainder of a response and registers the socket for EPOLLOUT; called with send_lock held
+     *
+     * @param conn Client connection
+     * @param iov Framed response
+     * @param iovcnt Number of entries in iov
+     * @param sent Bytes of the response already written to the socket
+     */
+    void bufferResponse(clientConn &conn, struct iovec *iov, int iovcnt, size_t sent);
+
+    /**
+     * @brief Shares a large return value with a local client, instead of copying it through the socket
+     *
+     * The return value is written to an anonymous memory file (memfd), whose descriptor is passed to the client 
+     * with the response header (SCM_RIGHTS); the client maps it, so only the header and the size travel over the socket.
+     *
+     * @param conn Client connection
+     * @param client_tid Task ID, as set by the client
+     * @param ret_val Return value
+     * @return false if the return value could not be shared and must be sent inline, true otherwise
+     */
+    bool sendSharedResponse(clientConn &conn, int32_t client_tid, const std::vector<char> &ret_val);
+
+    /**
+     * @brief Writes buffered responses of a client; called by the reactor on EPOLLOUT
+     *
+     * @param conn Client connection
+     * @return false if the socket cannot be written, true otherwise
+     */
+    bool flushResponses(clientConn &conn);
+
+    /**
+     * @brief Pushes the response of a completed task to its client; registered as the scheduler's completion callback 
+     *
+     * @param task Completed task; retired from the scheduler once the response has been framed
+     */
+    void completeTask(cTask *task);
+
+    /**
+     * @brief Serves the stats report on a local socket, <socket name>.stats (e.g., socat - UNIX-CONNECT:/tmp/coyote-daemon-...-<name>.stats)
+     *
+     * Each connection to the socket receives the report returned by getStatsReport() as plain text, after which it's closed
+     */
+    void serveStats();
+
+    /// Removes a client from its reactor, closes its socket and releases its state (after its outstanding tasks complete)
+    void closeClient(const std::shared_ptr<clientConn> &conn);
 
 public:
 
@@ -200,14 +413,32 @@ public:
      * @param port Port for remote connections
      */
     static cService* getInstance(std::string name, bool remote, int32_t vfid, uint32_t device = 0, bool reorder = true, uint16_t port = DEF_PORT) {
-        std::string tmp_id = std::to_string(device) + "-" + std::to_string(vfid);
+        return getInstance(name, remote, std::vector<cRegion>{{device, vfid}}, reorder, port);
+    }
+
+    /**
+     * @brief Creates an instance of the service spanning multiple vFPGAs
+     *
+     * If an instance already exists, return the existing instance ("singleton" implementation)
+     *
+     * @param name Unique name for the service
+     * @param remote Local or remote service
+     * @param regions vFPGA regions (device and vFPGA ID) associated with the service; tasks are load-balanced across them
+     * @param reorder Allow the schedulers to reorder tasks, to minimize reconfigurations
+     * @param port Port for remote connections
+     */
+    static cService* getInstance(std::string name, bool remote, std::vector<cRegion> regions, bool reorder = true, uint16_t port = DEF_PORT) {
+        std::string tmp_id;
+        for (cRegion &region : regions) {
+            tmp_id += (tmp_id.empty() ? "" : ",") + std::to_string(region.device) + "-" + std::to_string(region.vfid);
+        }
         
         if (services.find(tmp_id) != services.end()) {
             if (services[tmp_id] == nullptr) {
-               services[tmp_id] = new cService(name, remote, vfid, device, reorder, port);
+               services[tmp_id] = new cService(name, remote, regions, reorder, port);
             }
         } else {
-            services[tmp_id] = new cService(name, remote, vfid, device, reorder, port);
+            services[tmp_id] = new cService(name, remote, regions, reorder, port);
         }
 
         return services[tmp_id];
@@ -220,9 +451,104 @@ public:
      * This function initializes the daemon, sets up the socket for communication,
      * and starts the scheduler thread to handle incoming requests.
      * It will also accept connections from clients and register them.
+     * Once requests can be served, the service logs that it is ready and, if started by a service manager 
+     * with readiness notifications (NOTIFY_SOCKET, e.g., systemd's Type=notify), notifies it.
      */
     void start();
 
+    /**
+     * @brief Sets the number of reactors, i.e., event-loop threads which handle all the client sockets
+     *
+     * @param n_reactors Number of reactors (at least 1); must be set before start()
+     */
+    void setReactors(uint32_t n_reactors) {
+        this->n_reactors = n_reactors ? n_reactors : 1;
+    }
+
+    /**
+     * @brief Sets the number of idle Coyote threads kept per region; these are created on start() and recycled once clients disconnect
+     *
+     * @param thread_pool_size Number of idle threads per region (0 disables pooling); must be set before start()
+     */
+    void setThreadPool(uint32_t thread_pool_size) {
+        this->thread_pool_size = thread_pool_size;
+    }
+
+    /**
+     * @brief Sets the admission control limits; tasks beyond the limits are rejected with DEF_RET_BUSY, so that clients back off
+     *
+     * Bounding the outstanding tasks keeps the scheduler's queues (and hence the latency of all the clients) bounded under overload.
+     *
+     * @param max_client_tasks Maximum number of outstanding (submitted, but not completed) tasks per client
+     * @param max_tasks Maximum number of outstanding tasks across all clients
+     */
+    void setAdmissionLimits(uint32_t max_client_tasks, uint32_t max_tasks) {
+        std::lock_guard<std::mutex> guard(pending_lock);
+        this->max_client_tasks = max_client_tasks;
+        this->max_tasks = max_tasks;
+    }
+
+    /**
+     * @brief Sets the scheduling weight of a local client; the tasks of a client with weight w get w times the vFPGA share of a client with weight 1
+     *
+     * @param rpid PID of the client process
+     * @param weight Weight (at least 1); applies to clients connecting afterwards
+     *
+     * @note Remote clients always have weight 1, since their PIDs are not meaningful on this node
+     */
+    void setClientWeight(pid_t rpid, uint32_t weight) {
+        std::lock_guard<std::mutex> guard(weights_lock);
+        client_weights[rpid] = weight ? weight : 1;
+    }
+
+    /**
+     * @brief Enables (true) or disables (false) logging every request, task execution and response to syslog
+     *
+     * @note Off by default, since logging is a cost on the hot path; aggregate metrics are always available, see getStatsReport()
+     */
+    void setTaskLogging(bool log_tasks) {
+        this->log_tasks = log_tasks;
+        scheduler->setTaskLogging(log_tasks);
+    }
+
+    /**
+     * @brief Returns a plain-text report of the service's metrics
+     *
+     * The report holds the throughput counters (completed, failed, rejected and cached tasks) and the histograms 
+     * (count, mean, p50, p99 and max) of the response delay per function, as well as the queueing delay, reconfiguration time 
+     * and execution time per vFPGA and function. Once the service is started, it's also served on a local socket, see serveStats().
+     */
+    std::string getStatsReport();
+
+    /**
+     * @brief Sets the memory bound of the result cache, which holds the results of cacheable functions
+     *
+     * @param size Maximum number of bytes (arguments and return values) held by the cache; 0 disables it
+     */
+    void setResultCacheSize(size_t size) {
+        result_cache.setCapacity(size);
+    }
+
+    /// Getter: Number of requests answered from the result cache
+    uint64_t getResultCacheHits() {
+        return result_cache.getHits();
+    }
+
+    /// Getter: Number of requests to cacheable functions which had to be executed
+    uint64_t getResultCacheMisses() {
+        return result_cache.getMisses();
+    }
+
+    /**
+     * @brief Enables lazy loading of function bitstreams, reducing the pinned memory held by large function catalogues
+     *
+     * @param lazy Enable (true) or disable (false) lazy loading; must be set before adding functions
+     * @note See cSched::setLazyBitstreams(...) for details
+     */
+    void setLazyBitstreams(bool lazy) {
+        scheduler->setLazyBitstreams(lazy);
+    }
+
     /**
     * @brief Adds an arbitrary user function to the service
     * 
@@ -230,9 +556,49 @@ public:
     * @return 0 if the function was added successfully, 1 if bitstream cannot be opened, 2 if the function ID already exists 
     *
     * @note Implemented in the header file since it is a templated function
+    * @note For services spanning multiple vFPGAs, the function is added to the first region; see the overload below
     */
     int addFunction(std::unique_ptr<bFunc> fn) {
-        return scheduler->addFunction(std::move(fn));
+        return scheduler->addFunction(0, std::move(fn));
+    }
+
+    /**
+    * @brief Adds an arbitrary user function to one of the service's regions
+    * 
+    * Since app bitstreams are built for a specific vFPGA, a function that should run in several regions
+    * is added once per region, with the same function ID and the bitstream built for that region.
+    *
+    * @param idx Index of the region, in the order the regions were passed to getInstance(...)
+    * @param fn Unique pointer to the bFunc object representing the function
+    * @return 0 if the function was added successfully, 1 if bitstream cannot be opened, 2 if the function ID already exists, 3 if the region doesn't exist
+    */
+    int addFunction(uint32_t idx, std::unique_ptr<bFunc> fn) {
+        return scheduler->addFunction(idx, std::move(fn));
+    }
+
+    /**
+    * @brief Adds several user functions to the service, loading their bitstreams in parallel
+    *
+    * Registering a large function catalogue this way, rather than one addFunction(...) call per function, 
+    * shortens the time until the service is ready; see cSched::addFunctions(...)
+    *
+    * @param fns Functions to add
+    * @return One return code per function, in order, as for addFunction(...)
+    * @note For services spanning multiple vFPGAs, the functions are added to the first region; see the overload below
+    */
+    std::vector<int> addFunctions(std::vector<std::unique_ptr<bFunc>> fns) {
+        return scheduler->addFunctions(0, std::move(fns));
+    }
+
+    /**
+    * @brief Adds several user functions to one of the service's regions, loading their bitstreams in parallel
+    *
+    * @param idx Index of the region, in the order the regions were passed to getInstance(...)
+    * @param fns Functions to add
+    * @return One return code per function, in order, as for addFunction(idx, ...)
+    */
+    std::vector<int> addFunctions(uint32_t idx, std::vector<std::unique_ptr<bFunc>> fns) {
+        return scheduler->addFunctions(idx, std::move(fns));
     }
 
 };
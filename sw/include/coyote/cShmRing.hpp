@@ -0,0 +1,113 @@
+/*
+ * This file is part of the Coyote <https://github.com/fpgasystems/Coyote>
+ *
+ * MIT Licence
+ * Copyright (c) 2025, Systems Group, ETH Zurich
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _COYOTE_CSHMRING_HPP_
+#define _COYOTE_CSHMRING_HPP_
+
+#include <atomic>
+#include <cstdint>
+#include <sys/uio.h>
+
+#include <coyote/cDefs.hpp>
+
+namespace coyote {
+
+/**
+ * @brief Single-producer, single-consumer byte ring, placed in memory shared between a client (cConn) and the cService
+ *
+ * The ring carries the same stream of frames as the socket (see cReqHeader and cRespHeader), 
+ * so both ends parse it the same way; however, a frame is always pushed as a whole.
+ * Since the ring is polled, the consumer only needs to be woken up (through a doorbell, an eventfd)
+ * when it's about to block: the consumer announces this with prepareWait() and the producer checks it
+ * with needsWakeUp() after each push. Therefore, while both sides are busy, no system calls are needed.
+ *
+ * @note The class only holds plain data and atomics, so it can be constructed directly in a shared mapping
+ */
+class cShmRing {
+
+private:
+    /// Number of bytes written since the ring was created; only written by the producer
+    alignas(64) std::atomic<uint64_t> head;
+
+    /// Number of bytes read since the ring was created; only written by the consumer
+    alignas(64) std::atomic<uint64_t> tail;
+
+    /// Set by the consumer before blocking on the doorbell; cleared by the producer which rings it
+    alignas(64) std::atomic<uint32_t> waiting;
+
+    /// Ring data
+    alignas(64) char data[SHM_RING_SIZE];
+
+public:
+    /// Default constructor; creates an empty ring, with the consumer waiting for the first frame
+    cShmRing() : head(0), tail(0), waiting(1) {}
+
+    /**
+     * @brief Producer: appends a frame, gathered from a list of buffers
+     *
+     * @param iov Buffers forming the frame
+     * @param iovcnt Number of buffers in iov
+     * @return true if the frame was pushed, false if there was not enough space (nothing is pushed in that case)
+     */
+    bool push(const struct iovec *iov, int iovcnt);
+
+    /**
+     * @brief Consumer: copies up to size bytes out of the ring
+     *
+     * @param buff Destination buffer
+     * @param size Size of the destination buffer
+     * @return Number of bytes copied; 0 if the ring is empty
+     */
+    size_t pop(char *buff, size_t size);
+
+    /**
+     * @brief Consumer: announces that it's about to block on the doorbell
+     *
+     * @return true if the ring is empty and the consumer can block; false if data arrived in the meantime
+     */
+    bool prepareWait();
+
+    /**
+     * @brief Producer: checks whether the consumer is blocked (or about to block) and needs the doorbell
+     *
+     * @return true if the producer should ring the doorbell
+     */
+    bool needsWakeUp();
+
+};
+
+/// @brief Shared-memory channel between a client and the cService; one ring per direction
+struct cShmChannel {
+    /// Requests, from the client to the service
+    cShmRing req;
+
+    /// Responses, from the service to the client
+    cShmRing resp;
+};
+
+}
+
+#endif // _COYOTE_CSHMRING_HPP_
@@ -0,0 +1,248 @@
+/*
+ * This file is part of the Coyote <https://github.com/fpgasystems/Coyote>
+ *
+ * MIT Licence
+ * Copyright (c) 2025, Systems Group, ETH Zurich
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _COYOTE_CSTATS_HPP_
+#define _COYOTE_CSTATS_HPP_
+
+#include <array>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include <coyote/cDefs.hpp>
+
+namespace coyote {
+
+/**
+ * @brief Latency histogram with logarithmic (power-of-two) buckets, in nanoseconds
+ *
+ * Recording a sample is a handful of instructions and the memory is fixed, so histograms can be updated
+ * on every task; percentiles are estimated from the bucket bounds, i.e., they are accurate to within a factor of two.
+ *
+ * @note Not thread-safe; the owner protects the histogram with its own lock
+ */
+class cHistogram {
+
+private:
+    /// Bucket i counts the samples in [2^(i-1), 2^i) ns; the last bucket also holds all larger samples
+    std::array<uint64_t, STATS_N_BUCKETS> buckets = {};
+
+    /// Number of samples
+    uint64_t count = { 0 };
+
+    /// Sum of all samples, in ns
+    uint64_t sum = { 0 };
+
+    /// Largest sample, in ns
+    uint64_t max = { 0 };
+
+public:
+    /// Records a sample; negative durations are recorded as 0
+    void record(std::chrono::nanoseconds sample);
+
+    /// Adds all samples of another histogram to this one, e.g., to aggregate the histograms of several functions
+    void merge(const cHistogram &other);
+
+    /// Getter: Number of samples
+    uint64_t getCount() const { return count; }
+
+    /// Getter: Mean of the samples, in ns; 0 if there are none
+    uint64_t getMean() const { return count ? sum / count : 0; }
+
+    /// Getter: Largest sample, in ns
+    uint64_t getMax() const { return max; }
+
+    /**
+     * @brief Estimates a percentile of the samples
+     *
+     * @param p Percentile, in [0, 100]
+     * @return Upper bound of the bucket holding the percentile (capped by the largest sample), in ns; 0 if there are no samples
+     */
+    uint64_t getPercentile(double p) const;
+
+    /// Formats the histogram as a single line, e.g., "n=10 mean=12.5us p50=16.4us p99=32.8us max=20.1us"
+    std::string toString() const;
+
+};
+
+/**
+ * @brief Latency histogram with log-linear (HDR-style) buckets, in nanoseconds
+ *
+ * Every power of two is split into 2^sub_bits linear buckets (samples below 2^sub_bits ns have a bucket each), so 
+ * percentiles are accurate to within 2^-sub_bits of the value, also in the tail (e.g., p99.99), whereas cHistogram is only 
+ * accurate to within a factor of two. The memory is fixed at construction ((65 - sub_bits) * 2^sub_bits counters), 
+ * independently of the number of samples, and histograms of the same precision can be merged, e.g., those of several threads.
+ *
+ * @note Not thread-safe; each thread records into its own histogram and the histograms are merged afterwards
+ */
+class cHdrHistogram {
+
+private:
+    /// Log2 of the number of buckets per power of two
+    int sub_bits;
+
+    /// Sample counts, by bucket; allocated on the first sample
+    std::vector<uint64_t> buckets;
+
+    /// Number of samples
+    uint64_t count = { 0 };
+
+    /// Sum of all samples, in ns
+    double sum = { 0 };
+
+    /// Smallest and largest sample, in ns
+    double min = { 0 }, max = { 0 };
+
+    /// Bucket of a sample
+    size_t bucketIdx(uint64_t ns) const;
+
+    /// Representative value of a bucket, in ns; the middle of its range
+    double bucketValue(size_t idx) const;
+
+public:
+    /**
+     * @brief Default constructor
+     *
+     * @param sub_bits Log2 of the number of buckets per power of two, in [1, HDR_HIST_MAX_SUB_BITS]; sets the precision
+     */
+    cHdrHistogram(int sub_bits = HDR_HIST_SUB_BITS);
+
+    /// Records a sample, in ns; negative samples are recorded as 0
+    void record(double ns);
+
+    /// Adds all samples of another histogram to this one; throws if the precision differs
+    void merge(const cHdrHistogram &other);
+
+    /// Removes all samples
+    void reset();
+
+    /// Getter: Precision, as log2 of the number of buckets per power of two
+    int getSubBits() const { return sub_bits; }
+
+    /// Getter: Number of samples
+    uint64_t getCount() const { return count; }
+
+    /// Getter: Mean of the samples (exact), in ns; NaN if there are none
+    double getMean() const;
+
+    /// Getter: Smallest sample (exact), in ns; NaN if there are none
+    double getMin() const;
+
+    /// Getter: Largest sample (exact), in ns; NaN if there are none
+    double getMax() const;
+
+    /**
+     * @brief Estimates a percentile of the samples (nearest rank)
+     *
+     * @param p Percentile, in (0, 100]
+     * @return Middle of the bucket holding the percentile (bounded by the smallest and largest sample), in ns; NaN if there are no samples
+     */
+    double getPercentile(double p) const;
+};
+
+/// @brief Metrics of the tasks of one function (on one vFPGA, when collected by cSched)
+struct cTaskMetrics {
+    /// Time from the submission of a task until it started executing (including the wait for a reconfiguration)
+    cHistogram queue_delay;
+
+    /// Duration of the reconfigurations for the function's bitstream
+    cHistogram reconfig_time;
+
+    /// Execution time of the tasks
+    cHistogram exec_time;
+
+    /// Time from the submission of a task until its response was sent to the client; only collected by cService
+    cHistogram response_delay;
+
+    /// Number of tasks which completed successfully
+    uint64_t n_completed = { 0 };
+
+    /// Number of tasks which failed (non-zero return code)
+    uint64_t n_failed = { 0 };
+
+    /// Number of tasks with a deadline which completed after it (see cTask::setDeadline); only collected by cSched
+    uint64_t n_missed = { 0 };
+
+    /// Number of tasks rejected by the admission control; only collected by cService
+    uint64_t n_rejected = { 0 };
+
+    /// Number of tasks answered from the result cache; only collected by cService
+    uint64_t n_cached = { 0 };
+
+    /// Adds the metrics of other to these ones
+    void merge(const cTaskMetrics &other);
+};
+
+/**
+ * @brief Read-only view of the statistics page of a vFPGA, maintained by the driver (see vfpgaStatsPage)
+ *
+ * The page is memory mapped once, so the counters of all the Coyote threads of the vFPGA can be sampled at a high rate, 
+ * without system calls and without registering a Coyote thread; e.g., by a monitoring agent. The per-ctid completion 
+ * counters are not part of the page, since the vFPGA writes them to the writeback region (see cThread::checkCompleted())
+ */
+class cVfpgaStats {
+
+private:
+    /// vFPGA device file descriptor
+    int fd = { -1 };
+
+    /// Mapped statistics page
+    const volatile vfpgaStatsPage *page = { nullptr };
+
+public:
+    /**
+     * @brief Default constructor; opens the vFPGA device and maps its statistics page
+     *
+     * @param vfid vFPGA ID
+     * @param device Device number, for systems with multiple FPGAs
+     */
+    cVfpgaStats(uint32_t vfid, uint32_t device = 0);
+
+    /// Default destructor; unmaps the page and closes the device
+    ~cVfpgaStats();
+
+    cVfpgaStats(const cVfpgaStats&) = delete;
+    cVfpgaStats& operator=(const cVfpgaStats&) = delete;
+
+    /**
+     * @brief Reads a consistent snapshot of the statistics of a Coyote thread
+     *
+     * The counters are read until the generation is the same before and after, so the snapshot never mixes two threads 
+     * which used the same ctid; the counters themselves are updated independently, so they may be off by in-flight events
+     *
+     * @param ctid Coyote thread ID
+     * @return Statistics of the thread; all-zero if the ctid was never registered
+     */
+    vfpgaCtidStats read(uint32_t ctid) const;
+
+    /// Returns the mapped statistics page, e.g., for reading the counters of all the threads directly
+    const volatile vfpgaStatsPage* getPage() const { return page; }
+};
+
+}
+
+#endif // _COYOTE_CSTATS_HPP_
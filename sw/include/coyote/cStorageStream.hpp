@@ -0,0 +1,160 @@
+/*
+ * This file is part of the Coyote <https://github.com/fpgasystems/Coyote>
+ *
+ * MIT Licence
+ * Copyright (c) 2025, Systems Group, ETH Zurich
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _COYOTE_CSTORAGE_STREAM_HPP_
+#define _COYOTE_CSTORAGE_STREAM_HPP_
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include <linux/io_uring.h>
+
+#include <coyote/cDefs.hpp>
+#include <coyote/cOps.hpp>
+#include <coyote/cThread.hpp>
+
+namespace coyote {
+
+/// Default size of a chunk read from storage and streamed to the vFPGA, in bytes; one 2 MB huge page
+#define STORAGE_DEFAULT_CHUNK (2 * 1024 * 1024)
+
+/// Default number of chunks in flight (read from storage or streamed to the vFPGA)
+#define STORAGE_DEFAULT_DEPTH 8
+
+/// Alignment of O_DIRECT reads (file offset, length and buffer), in bytes; covers the logical block size of NVMe drives
+#define STORAGE_DIRECT_ALIGN 4096
+
+/**
+ * @brief Streams files from storage (e.g., NVMe) into a vFPGA, through a pool of pinned buffers
+ *
+ * The file is read in chunks with O_DIRECT through io_uring, into a ring of depth buffers which are allocated, mapped 
+ * to the vFPGA's TLB and registered with io_uring once, when the stream is created. Thus, the data is written to host 
+ * memory once (by the drive's DMA) and read once (by the vFPGA's DMA), without any copies by the CPU, nor page-cache 
+ * copies, nor per-read page pinning. Each chunk is sent with a LOCAL_READ on axis_host_recv[dest] as soon as it was 
+ * read (and all the chunks before it were sent), while the reads of the following chunks are still in flight; a 
+ * buffer is re-used for a new read once its LOCAL_READ completed. The chunks are sent in file order, each as a separate
+ * packet (the last beat of each chunk is marked with tlast).
+ *
+ * @note The stream relies on the cThread's LOCAL_READ completion counter, so no other local reads should be issued on 
+ * the cThread (nor clearCompleted() called) during stream(); the kernel's output, if any, is handled by the application
+ * @note NVMe peer-to-peer DMA into card memory is not supported; the data always goes through the pinned host buffers
+ */
+class cStorageStream {
+
+private:
+    /// cThread into whose TLB the buffers are mapped
+    cThread *cthread;
+
+    /// Target AXI4 destination stream in the vFPGA
+    uint32_t dest;
+
+    /// Size of a chunk (and of the buffers), in bytes
+    uint32_t chunk_size;
+
+    /// Buffers of the ring slots
+    std::vector<void*> buffs;
+
+    /// Whether the buffers are registered with io_uring (IORING_OP_READ_FIXED); otherwise, plain reads are used
+    bool fixed_buffs = false;
+
+    /// io_uring file descriptor
+    int ring_fd = -1;
+
+    /// Submission and completion queue rings, and submission queue entries, as mapped from the kernel
+    void *sq_ring = nullptr, *cq_ring = nullptr;
+    size_t sq_ring_size = 0, cq_ring_size = 0;
+    struct io_uring_sqe *sqes = nullptr;
+    size_t sqes_size = 0;
+
+    /// Pointers into the rings
+    unsigned *sq_tail, *sq_mask, *sq_array;
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_cqe *cqes;
+
+    /// Number of submitted reads whose completions were not yet reaped
+    uint32_t reads_pending = 0;
+
+    /// Maps the io_uring instance and, if possible, registers the buffers with it
+    void setupRing(uint32_t entries);
+
+    /// Queues a read of len bytes at the given file offset into a buffer, to be submitted with the next submitReads()
+    void queueRead(int file_fd, uint32_t slot, uint32_t buff_offs, uint64_t file_offs, uint32_t len, uint64_t user_data);
+
+    /// Submits the queued reads; if wait is set, also blocks until at least one read completed
+    void submitReads(uint32_t n, bool wait);
+
+public:
+    /**
+     * @brief Default constructor; allocates and maps the buffers and sets up the io_uring instance
+     *
+     * @param cthread cThread, whose vFPGA consumes the data
+     * @param chunk_size Size of a chunk, in bytes; a multiple of STORAGE_DIRECT_ALIGN, at most MAX_TRANSFER_SIZE
+     * @param depth Number of buffers, i.e., the maximum number of chunks in flight
+     * @param dest Target AXI4 destination stream in the vFPGA
+     * @param type Memory type of the buffers; must be REG, THP or HPF
+     *
+     * @note A chunk size and depth of 0 take the chunk size, depth and memory type of LOCAL_READ from the tuning profile 
+     *       (cTuneProfile::getDefault()), or STORAGE_DEFAULT_CHUNK, STORAGE_DEFAULT_DEPTH and type without one
+     */
+    cStorageStream(
+        cThread *cthread, uint32_t chunk_size = 0, uint32_t depth = 0,
+        uint32_t dest = 0, CoyoteAllocType type = CoyoteAllocType::HPF
+    );
+
+    /// Default destructor; releases the io_uring instance and the buffers
+    ~cStorageStream();
+
+    cStorageStream(const cStorageStream &) = delete;
+    cStorageStream& operator=(const cStorageStream &) = delete;
+
+    /**
+     * @brief Streams a range of a file into the vFPGA; returns once all of it was sent (i.e., its LOCAL_READs completed)
+     *
+     * @param path File to be streamed; opened with O_DIRECT, if the file system supports it
+     * @param offset Offset of the range in the file, in bytes; need not be aligned
+     * @param len Length of the range, in bytes; 0 streams the file until its end
+     * @return Number of bytes streamed, which is less than len if the file ends before the range
+     */
+    uint64_t stream(const std::string &path, uint64_t offset = 0, uint64_t len = 0);
+
+    /**
+     * @brief Streams a range of an already opened file into the vFPGA; see stream(path, offset, len)
+     *
+     * @param file_fd File descriptor; opened with O_DIRECT, for the data to bypass the page cache
+     */
+    uint64_t stream(int file_fd, uint64_t offset, uint64_t len);
+
+    /// Number of buffers, i.e., the maximum number of chunks in flight
+    uint32_t getDepth() const { return buffs.size(); }
+
+    /// Size of a chunk, in bytes
+    uint32_t getChunkSize() const { return chunk_size; }
+};
+
+}
+
+#endif // _COYOTE_CSTORAGE_STREAM_HPP_
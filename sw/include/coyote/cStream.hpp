@@ -0,0 +1,164 @@
+/*
+ * This file is part of the Coyote <https://github.com/fpgasystems/Coyote>
+ *
+ * MIT Licence
+ * Copyright (c) 2025, Systems Group, ETH Zurich
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _COYOTE_CSTREAM_HPP_
+#define _COYOTE_CSTREAM_HPP_
+
+#include <vector>
+#include <cstdint>
+
+#include <coyote/cDefs.hpp>
+#include <coyote/cOps.hpp>
+#include <coyote/cThread.hpp>
+
+namespace coyote {
+
+/// Default number of ring slots of a stream, without a tuning profile
+#define STREAM_DEFAULT_DEPTH 4
+
+/**
+ * @brief Host-side stream through a vFPGA kernel, with a ring of pre-mapped input and output buffers
+ *
+ * Every element pushed into the stream is sent to the vFPGA with a LOCAL_READ on axis_host_recv[dest] and its result
+ * is written back with a LOCAL_WRITE from axis_host_send[dest], into the output buffer of the same ring slot. Each element
+ * is a separate packet (the last beat of each transfer is marked with tlast) and increments the completion counters once, 
+ * so the stream can match the completions to its elements without any further bookkeeping by the application.
+ *
+ * Flow control is credit-based: the ring has depth slots, a slot is taken by push() and only returned once its result
+ * has been consumed, i.e., on the pop() following the one that returned it. Thus, up to depth elements are in flight, 
+ * keeping the kernel busy while the application consumes earlier results, without any double-buffering in the application.
+ *
+ * @note The stream relies on the cThread's LOCAL_READ and LOCAL_WRITE completion counters, so no other local reads or writes 
+ * should be issued on the cThread (nor clearCompleted() called) while the stream has elements in flight
+ * @note The kernel must produce exactly one output packet per input packet, of at most out_size bytes
+ */
+class cStream {
+
+private:
+    /// cThread into whose TLB the ring buffers are mapped
+    cThread *cthread;
+
+    /// Target AXI4 destination stream in the vFPGA
+    uint32_t dest;
+
+    /// Size of the input and output buffers, in bytes
+    uint32_t in_size, out_size;
+
+    /// Input and output buffers of the ring slots
+    std::vector<void*> in_buffs, out_buffs;
+
+    /// Length of the output of each slot, in bytes
+    std::vector<uint32_t> out_lens;
+
+    /// Number of elements pushed and popped since the stream was created
+    uint64_t n_pushed = 0, n_popped = 0;
+
+    /// Whether the slot of the last popped element is still held by the application
+    bool holding = false;
+
+    /// Completion counters of LOCAL_READ and LOCAL_WRITE when the stream was created
+    uint32_t base_rd, base_wr;
+
+    /// Returns the ring slot of the n-th element
+    uint32_t slot(uint64_t n) const { return n % in_buffs.size(); }
+
+    /// Issues the transfers of the next element, whose input is already in its slot
+    void submit(uint32_t len, uint32_t out_len);
+
+public:
+    /**
+     * @brief Default constructor; allocates and maps the ring buffers
+     *
+     * @param cthread cThread, whose vFPGA holds the streaming kernel
+     * @param in_size Maximum size of an input element, in bytes
+     * @param out_size Maximum size of an output element, in bytes; 0 makes it equal to in_size
+     * @param depth Number of ring slots, i.e., the maximum number of elements in flight; 0 takes the depth and the memory type 
+     *        of LOCAL_TRANSFER from the tuning profile (cTuneProfile::getDefault()), or STREAM_DEFAULT_DEPTH and type without one
+     * @param dest Target AXI4 destination stream in the vFPGA
+     * @param type Memory type of the ring buffers; must be REG, THP or HPF
+     */
+    cStream(
+        cThread *cthread, uint32_t in_size, uint32_t out_size = 0, uint32_t depth = 0, 
+        uint32_t dest = 0, CoyoteAllocType type = CoyoteAllocType::HPF
+    );
+
+    /// Default destructor; waits for the elements in flight and releases the ring buffers
+    ~cStream();
+
+    /**
+     * @brief Returns the input buffer of the next free slot, so that it can be filled in place and pushed with push(len)
+     *
+     * @return Input buffer, of in_size bytes, or nullptr if there are no free slots (elements must be popped first)
+     */
+    void* getBuffer();
+
+    /**
+     * @brief Pushes the element previously written into the buffer returned by getBuffer()
+     *
+     * @param len Length of the element, in bytes
+     * @param out_len Length of the kernel's output for this element; 0 makes it equal to len
+     * @return False if there are no free slots, in which case nothing is pushed
+     */
+    bool push(uint32_t len, uint32_t out_len = 0);
+
+    /**
+     * @brief Copies an element into the next free slot and pushes it
+     *
+     * @param data Element to be pushed; can be reused as soon as the function returns
+     * @param len Length of the element, in bytes
+     * @param out_len Length of the kernel's output for this element; 0 makes it equal to len
+     * @return False if there are no free slots, in which case nothing is pushed
+     */
+    bool push(const void *data, uint32_t len, uint32_t out_len = 0);
+
+    /**
+     * @brief Waits for the oldest element in flight to complete and returns its output
+     *
+     * @return Output buffer and length of the element; the buffer remains valid until the next call to pop() or release()
+     * @throws std::runtime_error if there are no elements in flight
+     */
+    localSg pop();
+
+    /**
+     * @brief Checks, without blocking, whether the oldest element in flight has completed
+     *
+     * @return True if the next pop() would return immediately
+     */
+    bool ready() const;
+
+    /// Returns the slot of the last popped element, so it can be pushed again before the next pop()
+    void release();
+
+    /// Number of free slots, i.e., elements that can be pushed without popping
+    uint32_t credits() const;
+
+    /// Number of elements pushed, but not yet popped
+    uint32_t inFlight() const { return n_pushed - n_popped; }
+};
+
+}
+
+#endif // _COYOTE_CSTREAM_HPP_
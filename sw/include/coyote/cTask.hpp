@@ -28,6 +28,8 @@
 #define _COYOTE_CTASK_HPP_
 
 #include <map>
+#include <memory>
+#include <chrono>
 #include <vector>
 #include <cstdint>
 
@@ -35,6 +37,82 @@
 
 namespace coyote {
 
+/// @brief A serialized function argument (or return value), viewed in place
+struct cArgView {
+    const char *ptr;
+    size_t len;
+
+    const char* data() const { return ptr; }
+    size_t size() const { return len; }
+};
+
+/**
+ * @brief Serialized arguments of a task, stored back-to-back in a single buffer
+ *
+ * Arguments are exposed as views (cArgView) into the buffer, which cFunc deserializes from directly. Up to 
+ * TASK_ARGS_INLINE_COUNT arguments, of up to TASK_ARGS_INLINE_SIZE bytes in total, are stored in the object itself, 
+ * so a task of a function with small arguments needs no heap allocation for them; larger arguments (e.g., bulk
+ * variable-length ones) take a single allocation for all of them.
+ */
+class cTaskArgs {
+
+private:
+    /// Location of an argument in the buffer
+    struct argEntry {
+        uint32_t offs;
+        uint32_t size;
+    };
+
+    /// Number of arguments and their total size, in bytes
+    size_t n_args = { 0 };
+    size_t n_bytes = { 0 };
+
+    /// In-line storage, and the heap storage, used instead if an argument list doesn't fit in-line
+    char inline_data[TASK_ARGS_INLINE_SIZE];
+    argEntry inline_entries[TASK_ARGS_INLINE_COUNT];
+    std::unique_ptr<char[]> heap_data;
+    std::unique_ptr<argEntry[]> heap_entries;
+
+    char* buffer() { return heap_data ? heap_data.get() : inline_data; }
+    const char* buffer() const { return heap_data ? heap_data.get() : inline_data; }
+    argEntry* entries() { return heap_entries ? heap_entries.get() : inline_entries; }
+    const argEntry* entries() const { return heap_entries ? heap_entries.get() : inline_entries; }
+
+    /// Sets the capacity for n arguments of n_bytes bytes in total; previous arguments are discarded
+    void reserve(size_t n, size_t n_bytes);
+
+public:
+    /// Default constructor; no arguments
+    cTaskArgs() {}
+
+    /// Packs arguments held in separate buffers, e.g., built by the application
+    cTaskArgs(const std::vector<std::vector<char>> &args);
+
+    cTaskArgs(cTaskArgs&&) = default;
+    cTaskArgs& operator=(cTaskArgs&&) = default;
+    cTaskArgs(const cTaskArgs&) = delete;
+    cTaskArgs& operator=(const cTaskArgs&) = delete;
+
+    /**
+     * @brief Copies the arguments out of a request payload, with a single copy
+     *
+     * @param payload Arguments back-to-back, with variable-length arguments prefixed by their size (uint32_t), see cReqHeader
+     * @param payload_size Size of the payload, in bytes
+     * @param arg_sizes Sizes of the arguments, as in bFunc::getArgumentSizes()
+     * @return false if the payload doesn't match the argument sizes; the arguments are then empty
+     */
+    bool parse(const char *payload, size_t payload_size, const std::vector<size_t> &arg_sizes);
+
+    /// Number of arguments
+    size_t size() const { return n_args; }
+
+    /// The i-th argument; valid as long as this object isn't modified or destroyed
+    cArgView operator[](size_t i) const { 
+        const argEntry &entry = entries()[i];
+        return { buffer() + entry.offs, entry.size };
+    }
+};
+
 /**
  * @brief A task represents a single request to execute a function
  *
@@ -58,8 +136,8 @@ private:
     /// Pointer to the cThread that executes this task (it is passed to the cFunc as the first argument)
     cThread* cthread;
 
-    /// Arguments for the function to be executed; see cFunc for detail on why a vector of char buffers is used
-    std::vector<std::vector<char>> fn_args;
+    /// Arguments for the function to be executed, serialized; see cFunc for detail on why char buffers are used
+    cTaskArgs fn_args;
 
     /// Function return value; see cFunc for detail on why a char buffer is is used
     std::vector<char> ret_val;
@@ -67,12 +145,37 @@ private:
     /// Size of the function return value; primarily a util value used for deserializing the char buffer
     size_t ret_val_size;
 
+    /// Return value mapped from a shared-memory buffer (see DEF_RESP_SHARED) instead of held in ret_val; unmapped with the task
+    void *shared_ret_val = { nullptr };
+
+    /// Size of shared_ret_val, in bytes
+    size_t shared_ret_val_size = { 0 };
+
     /// Function return code; a non-zero value indicates an error in the function execution
     int32_t ret_code;
 
+    /// Time the task was created, i.e., submitted; used for the queueing and response delay metrics (see cStats)
+    std::chrono::steady_clock::time_point submit_time;
+
+    /// Weight of the task's flow (its Coyote thread) in the scheduler's weighted fair queuing; see cSched
+    uint32_t weight = { 1 };
+
+    /// Priority class of the task (TASK_PRIORITY_*); see cSched
+    uint32_t priority = { TASK_PRIORITY_NORMAL };
+
+    /// Deadline of the task; time_point::max() if it has none
+    std::chrono::steady_clock::time_point deadline = { std::chrono::steady_clock::time_point::max() };
+
 public:
     /// Default constructor; sets the unique task ID and the associated function, sets the args, init other params to default value
-    cTask(int32_t tid, int32_t fid, size_t ret_val_size, cThread* cthread = nullptr, std::vector<std::vector<char>> fn_args = {});
+    cTask(int32_t tid, int32_t fid, size_t ret_val_size, cThread* cthread = nullptr, cTaskArgs fn_args = {});
+
+    /// Default destructor; unmaps the shared return value, if any
+    ~cTask();
+
+    // Tasks own their (shared) return value, so they are never copied
+    cTask(const cTask&) = delete;
+    cTask& operator=(const cTask&) = delete;
 
     /// Getter: Task ID
     int32_t getTid() const;
@@ -90,13 +193,27 @@ public:
     cThread* getCThread() const;
 
     /// Getter: Function arguments
-    std::vector<std::vector<char>> getArgs() const;
+    const cTaskArgs& getArgs() const;
 
     /// Getter: Function return value
-    std::vector<char> getRetVal() const;
+    const std::vector<char>& getRetVal() const;
 
     /// Setter: Function return value
-    void setRetVal(const std::vector<char> retval);
+    void setRetVal(std::vector<char> retval);
+
+    /**
+     * @brief Setter: Function return value, mapped from a shared-memory buffer; the task takes over the mapping
+     *
+     * @param addr Address of the mapping (obtained with mmap)
+     * @param size Size of the mapping, i.e., of the return value, in bytes
+     */
+    void setSharedRetVal(void *addr, size_t size);
+
+    /// Pointer to the function return value, held either in-line (getRetVal()) or in a shared-memory buffer
+    const char* getRetData() const;
+
+    /// Size of the function return value pointed to by getRetData(), in bytes
+    size_t getRetDataSize() const;
 
     /// Getter: Function return value size
     size_t getRetValSize() const;
@@ -106,6 +223,27 @@ public:
 
     /// Setter: Function return code
     void setRetCode(int32_t retcode);
+
+    /// Getter: Submission (creation) time of the task
+    std::chrono::steady_clock::time_point getSubmitTime() const;
+
+    /// Getter: Scheduling weight
+    uint32_t getWeight() const;
+
+    /// Setter: Scheduling weight (at least 1); a flow with weight w receives w times the share of a flow with weight 1
+    void setWeight(uint32_t weight);
+
+    /// Getter: Priority class
+    uint32_t getPriority() const;
+
+    /// Setter: Priority class (TASK_PRIORITY_*); classes beyond the lowest one are clamped to it
+    void setPriority(uint32_t priority);
+
+    /// Getter: Deadline; time_point::max() if the task has none
+    std::chrono::steady_clock::time_point getDeadline() const;
+
+    /// Setter: Deadline, relative to the submission of the task; a zero deadline removes it
+    void setDeadline(std::chrono::microseconds deadline);
 };
 
 }
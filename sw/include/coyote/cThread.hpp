@@ -27,13 +27,24 @@
 #ifndef _COYOTE_CTHREAD_HPP_
 #define _COYOTE_CTHREAD_HPP_
 
+#include <array>
+#include <algorithm>
 #include <thread>
 #include <chrono>
 #include <string>
 #include <random>
 #include <fstream>
 #include <iostream>
+#include <map>
+#include <set>
 #include <functional>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <exception>
+#include <stdexcept>
+#include <condition_variable>
 #include <unordered_map> 
 
 #include <fcntl.h>
@@ -45,7 +56,9 @@
 #include <sys/ioctl.h>
 #include <sys/epoll.h>
 #include <sys/eventfd.h>
+#include <sys/syscall.h>
 #include <linux/mman.h>
+#include <linux/mempolicy.h>
 
 #include <boost/interprocess/sync/named_mutex.hpp>
 
@@ -58,9 +71,112 @@
 #include <coyote/cDefs.hpp>
 #include <coyote/cOps.hpp>
 #include <coyote/cGpu.hpp>
+#include <coyote/cCmdRing.hpp>
 
 namespace coyote {
 
+class cThread;
+class cNotifyReactor;
+
+/**
+ * @brief Direct view of a contiguous range of vFPGA control registers, obtained through cThread::mapCSRs()
+ *
+ * Accesses are bounds-checked against the window and go straight to the mapped registers, without a call into the cThread;
+ * register indices are relative to the start of the window. Meant for hot paths accessing a fixed register file,
+ * e.g., device emulation forwarding guest register accesses to a vFPGA.
+ *
+ * Registers only ever written by software (host-owned, e.g., DMA addresses and lengths) can be shadowed with setHostOwned():
+ * writes go through to the vFPGA and update a shadow copy, from which subsequent reads are served without a PCIe round trip.
+ * Registers updated by the hardware (status, self-clearing command bits) must not be shadowed; shadow copies of host-owned
+ * registers must be dropped with invalidate() whenever the vFPGA may have changed them, e.g., after a reset or reconfiguration.
+ */
+class csrWindow {
+public:
+	/// Empty window; every access is out of bounds
+	csrWindow() {}
+
+	/// First register of the window (absolute CSR offset)
+	uint32_t getBase() const { return base; }
+
+	/// Number of registers in the window
+	uint32_t size() const { return n_regs; }
+
+	/// Whether an absolute CSR offset falls into the window
+	bool contains(uint32_t offs) const { return offs >= base && offs - base < n_regs; }
+
+	/// Sets the register at index idx of the window; throws std::out_of_range outside of the window
+	inline void set(uint32_t idx, uint64_t val);
+
+	/// Reads the register at index idx of the window; throws std::out_of_range outside of the window
+	inline uint64_t get(uint32_t idx) const;
+
+	/// Sets multiple registers of the window, given by index and value, in order (see cThread::setCSRs())
+	inline void set(const std::vector<std::pair<uint32_t, uint64_t>> &csrs);
+
+	/// Marks the register at index idx as host-owned (shadowed) or not; the shadow copy is filled by the next set() or get()
+	void setHostOwned(uint32_t idx, bool owned = true) {
+		check(idx);
+		if (shadow_state.empty()) {
+			shadow.assign(n_regs, 0);
+			shadow_state.assign(n_regs, SHADOW_NONE);
+		}
+		shadow_state[idx] = owned ? SHADOW_INVALID : SHADOW_NONE;
+	}
+
+	/// Drops the shadow copy of the register at index idx; the next get() reads the vFPGA again
+	void invalidate(uint32_t idx) {
+		check(idx);
+		if (!shadow_state.empty() && shadow_state[idx] == SHADOW_VALID) {
+			shadow_state[idx] = SHADOW_INVALID;
+		}
+	}
+
+	/// Drops all shadow copies of the window
+	void invalidate() {
+		for (auto &state : shadow_state) {
+			if (state == SHADOW_VALID) {
+				state = SHADOW_INVALID;
+			}
+		}
+	}
+
+private:
+	friend class cThread;
+
+	csrWindow(cThread *thread, volatile uint64_t *regs, uint32_t base, uint32_t n_regs) :
+		thread(thread), regs(regs), base(base), n_regs(n_regs) {}
+
+	uint32_t check(uint32_t idx) const {
+		if (idx >= n_regs) {
+			throw std::out_of_range("ERROR: csrWindow: register " + std::to_string(idx) + " outside of a window of " + std::to_string(n_regs) + " registers");
+		}
+		return idx;
+	}
+
+	/// Owning thread; used for access when the registers are not mapped (simulation)
+	cThread *thread = { nullptr };
+
+	/// Mapped registers, starting at base; nullptr in simulation
+	volatile uint64_t *regs = { nullptr };
+
+	uint32_t base = { 0 };
+	uint32_t n_regs = { 0 };
+
+	/// Shadow states of the registers, allocated by the first setHostOwned()
+	enum : uint8_t { SHADOW_NONE = 0, SHADOW_INVALID = 1, SHADOW_VALID = 2 };
+
+	/// Shadow copies and states of the registers; filled on reads, hence mutable
+	mutable std::vector<uint64_t> shadow;
+	mutable std::vector<uint8_t> shadow_state;
+
+	void updateShadow(uint32_t idx, uint64_t val) const {
+		if (!shadow_state.empty() && shadow_state[idx] != SHADOW_NONE) {
+			shadow[idx] = val;
+			shadow_state[idx] = SHADOW_VALID;
+		}
+	}
+};
+
 /**
  * @brief The cThread class is the core component of Coyote for interacting with vFPGAs
  *
@@ -82,6 +198,12 @@ protected:
 	
 	/// Host process ID
 	pid_t hpid = { 0 };
+
+	/// Device number, for systems with multiple FPGAs
+	uint32_t device = { 0 };
+
+	/// NUMA node of the FPGA, as reported by sysfs; -1 if unknown
+	int32_t numa_node = { -1 };
 	
 	/// Shell configuration, as set by the user in CMake config
 	fpgaCnfg fcnfg; 
@@ -89,8 +211,154 @@ protected:
 	/// RDMA queue pair
     std::unique_ptr<ibvQp> qpair; 
 
-	/// Number data transfer commands sent to the vFPGA
-	uint32_t cmd_cnt = { 0 };
+	/**
+	 * Additional RDMA queue pairs (QP index 1 onwards), see addQp()
+	 * The vFPGA identifies a QP by its Coyote thread ID, so each QP holds its own ctid, registered for the same host process
+	 */
+	std::vector<std::pair<int32_t, std::unique_ptr<ibvQp>>> extra_qpairs;
+
+	/// Memory regions registered with registerMr() (MR index 1 onwards); MR 0 is always the QP's own buffer
+	std::vector<ibvMr> local_mrs;
+
+	/// Memory regions registered by the remote node of each QP, by QP index (MR index 1 onwards); received when the QP is connected
+	std::vector<std::vector<ibvMr>> remote_mrs;
+
+	/**
+	 * Flags of the RDMA barriers, see rdmaSync(); for each QP, a flag written by the remote node and the source of the 
+	 * writes to the remote node's flag. Allocated when the first QP is connected, and freed with the other buffers
+	 */
+	void *sync_mem = { nullptr };
+
+	/// Address of the remote node's flag, number of barriers signalled to and by the remote node, for each QP
+	std::vector<uint64_t> remote_sync, sync_sent, sync_recvd;
+
+	/// Memory region index of the barriers' flags (in localMrAddr() and remoteMrAddr()); never exposed to the users
+	static constexpr uint32_t const SYNC_MR = UINT32_MAX;
+
+	/// Allocates the flags of the RDMA barriers, if not yet allocated, and sizes the per-QP tables for n_qps QPs
+	void initSync(uint32_t n_qps);
+
+	/// Signals a barrier to the remote node of a QP
+	void signalSync(uint32_t qp);
+
+	/// Waits for the remote node of a QP to signal a barrier
+	void waitSync(uint32_t qp);
+
+	/// Descriptors of the last invokeChain(), kept to reuse the allocation across calls
+	std::vector<std::array<uint64_t, 4>> chain_cmds;
+
+	/// @brief Pacing state of a QP, see setRdmaPacing()
+	struct qpPacing {
+		/// Max. number of outstanding writes; fractional, since it grows by 1 / window per completion (CoyotePacing::ADAPTIVE)
+		double window;
+
+		/// Value of checkCompleted(CoyoteOper::REMOTE_RDMA_WRITE, qp) when the completions were last polled
+		uint32_t completed;
+
+		/// Issue times of the outstanding writes, oldest first
+		std::deque<std::chrono::steady_clock::time_point> in_flight;
+
+		/// Smoothed and minimum RTT (in us) of the writes; 0 until the first completion
+		double srtt = { 0 }, min_rtt = { 0 };
+
+		/// Time of the last window decrease; the window is halved at most once per RTT
+		std::chrono::steady_clock::time_point last_decrease;
+
+		/// Retransmissions of the network stack last seen by the QP (CoyotePacing::ADAPTIVE)
+		uint32_t retrans = { 0 };
+	};
+
+	/// Pacing mode and max. window of the RDMA WRITEs
+	CoyotePacing pacing_mode = { CoyotePacing::NONE };
+	uint32_t pacing_max_window = { RDMA_PACING_MAX_WINDOW };
+
+	/// Pacing state, by QP index; sized on the first paced write to a QP
+	std::vector<qpPacing> pacing;
+
+	/// Retransmissions of the network stack, and the time they were last read (CoyotePacing::ADAPTIVE)
+	uint32_t net_retrans = { 0 };
+	std::chrono::steady_clock::time_point net_stats_time;
+
+	/// Waits until a write can be issued on a QP, as set by setRdmaPacing(), and records it as outstanding
+	void paceRdma(uint32_t qp);
+
+	/// Retires the completed writes of a QP from its pacing state and, with CoyotePacing::ADAPTIVE, adapts the window
+	void updatePacing(uint32_t qp);
+
+	/// Writes the QP context registers of a QP, without waiting for the vFPGA to apply them; see writeQpContext()
+	void writeQpRegs(uint32_t port, uint32_t qp);
+
+	/// Writes the ARP lookup register, without waiting for the lookup; see doArpLookup()
+	void writeArpReg(uint32_t ip_addr);
+
+	/// Copies between a card-only buffer and a host buffer, towards the card (to_card) or the host
+	void copyCardMem(void *card_mem, void *host_mem, uint64_t size, bool to_card);
+
+	/// Reserves an address range (without memory) for a card-only buffer, aligned to the large TLB pages; size is rounded up accordingly
+	void* reserveCardRange(uint64_t &size);
+
+	/// Checks the driver's neighbor table for an IP address; returns the time left until its lookup completes and sets issue if it must be looked up
+	std::chrono::nanoseconds neighLookup(uint32_t ip_addr, bool &issue);
+
+#ifdef EN_TCP_EXPERIMENTAL
+	/// Writes a TCP session command (listen or open/close) and, if wait is set, returns the status popped from the response queue
+	uint64_t tcpCommand(bool listen, uint64_t cmd, bool wait);
+#endif
+
+	/// Sends the registered memory regions over an out-of-band connection, and receives the remote node's; the client sends first
+	void exchangeMrs(int sock, uint32_t qp, bool client);
+
+	/// Base virtual address of a local memory region for the given QP; throws if out of range
+	uint64_t localMrAddr(uint32_t qp, uint32_t mr) const;
+
+	/// Base virtual address of a remote memory region of the given QP; throws if out of range
+	uint64_t remoteMrAddr(uint32_t qp, uint32_t mr) const;
+
+	/// Returns the QP with the given index (0 is qpair); throws if out of range
+	ibvQp* qpAt(uint32_t qp) const;
+
+	/// Returns the Coyote thread ID serving the QP with the given index
+	int32_t qpCtid(uint32_t qp) const;
+
+	/// Completion counter of a Coyote thread ID (this cThread's or one its QPs'), see checkCompleted()
+	uint32_t readCompleted(CoyoteOper oper, int32_t tid) const;
+
+	/// Writeback slot of the completion counter read by readCompleted(), nullptr if the counter is not written back
+	volatile uint32_t *wbackSlot(CoyoteOper oper, int32_t tid) const;
+
+	/// Clears the completion counters of a Coyote thread ID, see clearCompleted()
+	void clearCounters(int32_t tid);
+
+	/// @brief State shared by all the cThreads of this process on the same vFPGA
+	struct vfpgaContext {
+		/**
+		 * @brief Shared submission ring of the vFPGA, see postCmd() and cCmdRing
+		 *
+		 * The ring also tracks the number of outstanding commands in the vFPGA command FIFO (only re-read from the hardware when
+		 * the remaining credits run out), so the credits are shared by all the threads
+		 */
+		cCmdRing cmd_ring;
+
+		/// In-process vFPGA lock, used by lock() with CoyoteLock::PROCESS
+		std::mutex vfpga_lock;
+
+#ifdef EN_TCP_EXPERIMENTAL
+		/// Serializes the TCP listen and open requests of the process, since the responses are shared by all the vFPGA's users
+		std::mutex tcp_lock;
+#endif
+	};
+
+	/// Context of this cThread's vFPGA
+	std::shared_ptr<vfpgaContext> vfpga_ctx;
+
+	/// Contexts of the vFPGAs used by this process, by device and vFPGA ID; a context lives while a cThread uses it
+	static std::map<std::pair<uint32_t, int32_t>, std::weak_ptr<vfpgaContext>> vfpga_ctxs;
+
+	/// Lock, protecting vfpga_ctxs
+	static std::mutex vfpga_ctxs_lock;
+
+	/// Back-off policy when waiting for command FIFO credits
+	CoyoteBackoff backoff = { CoyoteBackoff::SLEEP };
 
 	/// User interrupt file descriptor
 	int32_t efd = { -1 };
@@ -101,9 +369,49 @@ protected:
 	/// Dedicated thread for handling user interrupts
 	std::thread event_thread;
 
+	/// Shared reactor handling the user interrupts instead of event_thread, if any
+	cNotifyReactor *notify_reactor = { nullptr };
+
+	/// User interrupt service routine, if any
+	std::function<void(int)> uisr;
+
+	/// Delivery mode of user interrupts
+	CoyoteNotify notify_mode = { CoyoteNotify::EVENTFD };
+
+	/// Notification rings of the vFPGA, memory mapped in the coalesced and polling modes
+	notifyRing *notify_rings = { nullptr };
+
+	/// Notification ring of this cThread, within notify_rings
+	notifyRing *notify_ring = { nullptr };
+
+	/// Pending asynchronous syncs/off-loads, issued in order by sync_thread; see invokeAsync()
+	std::deque<std::pair<CoyoteOper, syncSg>> sync_queue;
+
+	/// Protects sync_queue, sync_running and sync_error
+	std::mutex sync_lock;
+
+	/// Wakes up sync_thread on new requests and the blocking invoke() calls on completions
+	std::condition_variable sync_cv;
+
+	/// Dedicated thread for issuing the (blocking) sync/off-load requests to the driver; started by the first invokeAsync()
+	std::thread sync_thread;
+
+	/// Set to true while sync_thread is running
+	bool sync_running = { false };
+
+	/// Number of submitted and completed syncs/off-loads, indexed by syncIdx(); reported by checkCompleted()
+	std::atomic<uint32_t> sync_submitted[2] = {};
+	std::atomic<uint32_t> sync_completed[2] = {};
+
+	/// First error raised by an asynchronous sync/off-load, re-thrown by the next invoke() or invokeAsync() on a sync/off-load
+	std::exception_ptr sync_error;
+
 	/// vFPGA config registers, if AVX is enabled, as implemented in cnfg_slave_avx.sv; used mainly for starting DMA commands
 	#ifdef EN_AVX
 	volatile __m256i *cnfg_reg_avx = { 0 };
+
+	/// Write-combined mapping of the command register (CnfgAvxRegs::CTRL_REG), see setWriteCombining(); write-only
+	volatile __m256i *cnfg_reg_wc = { 0 };
 	#endif
 
 	/// vFPGA config registers, if AVX is disabled, as implemented in cnfg_slave.sv; used mainly for starting DMA commands
@@ -115,8 +423,23 @@ protected:
 	/// Pointer to writeback region, if enabled
 	volatile uint32_t *wback = { 0 };
 
-	/// A map of all the pages that have been allocated and mapped for this thread
-	std::unordered_map<void*, CoyoteAlloc> mapped_pages;
+	/// A map of all the pages that have been allocated and mapped for this thread; ordered by address, see getAlloc()
+	std::map<void*, CoyoteAlloc> mapped_pages;
+
+	/// Interval index of all the regions mapped into the vFPGA's TLB by this thread, (start address -> end address); see isMapped()
+	std::map<uint64_t, uint64_t> mapped_regions;
+
+	/// Read-only statistics page of the vFPGA (MMAP_STATS); nullptr if the driver doesn't expose it
+	const volatile vfpgaStatsPage *stats_page = { nullptr };
+
+	/// Set if unmapped buffers passed to invoke() are registered implicitly, see setAutoRegister()
+	bool auto_register = { false };
+
+	/// Regions registered implicitly by invoke(), (start address -> end address); a subset of mapped_regions
+	std::map<uint64_t, uint64_t> auto_regions;
+
+	/// Value of the MMU invalidation counter of this cThread when auto_regions was last validated
+	uint64_t auto_invalidations = { 0 };
 
 	/** 
 	 * Out-of-band connection file descriptor to a remote node
@@ -139,6 +462,9 @@ protected:
 
 	/// Set to true if the vFPGA lock is acquired by this cThread; used to release the lock in the destructor
 	bool lock_acquired = { false };
+
+	/// Backend of lock() and unlock(), see setLockBackend()
+	CoyoteLock lock_backend = { CoyoteLock::SYSTEM };
 	
 	/// Utility function, memory mapping all the vFPGA control registers and writeback regions
 	void mmapFpga();
@@ -146,10 +472,52 @@ protected:
 	/// Utility function, unmapping all the vFPGA control registers and writeback regions
 	void munmapFpga();
 
+	/**
+	 * @brief Waits until there is space in the vFPGA command FIFO; must only be called by the drainer of the shared ring
+	 *
+	 * The locally tracked command count is used first; only once the credits are exhausted 
+	 * the FIFO occupancy is re-read from the vFPGA, backing off as set by setBackoff() in-between reads.
+	 * @return Number of commands that can be posted without waiting
+	 */
+	uint32_t waitCmdCredits();
+
+	/// Backs off once, as set by setBackoff(), between two polls of the vFPGA
+	void backOff() const;
+
+	/**
+	 * @brief Registers a buffer passed to invoke() in the vFPGA's TLB, unless it is already mapped; see setAutoRegister()
+	 *
+	 * Regions released by the driver's MMU notifier (munmap, free) since the last call are dropped first, so they are registered again on next use
+	 */
+	void autoRegister(const void *vaddr, uint64_t len);
+
+	/// Writes a single command, ordered as {offs_3, offs_2, offs_1, offs_0}, to the vFPGA command registers; must only be called by the drainer
+	void writeCmd(const std::array<uint64_t, 4> &cmd);
+
+	/// Writes the commands queued in the shared ring (by any thread) to the vFPGA, unless another thread is already doing so
+	void drainCmds();
+
+	/// Appends a command to the shared ring; if the ring is full, helps draining it (or backs off) until there is space
+	void pushCmd(const std::array<uint64_t, 4> &cmd);
+
+	/**
+	 * @brief Sets the NUMA memory policy for a host allocation, before its pages are faulted in and pinned
+	 *
+	 * @param mem Start of the allocation
+	 * @param size Size of the allocation, in bytes
+	 * @param node Requested node, see CoyoteAlloc::numa_node 
+	 */
+	void bindNuma(void *mem, size_t size, int32_t node) const;
+
+	/// Obtains huge pages of the shell's large TLB page size, from the pool of reserveHugePages() if possible; nullptr (with errno set) on failure
+	void* allocHugePages(uint64_t size, int32_t numa_node);
+
 	/**
 	 * @brief Posts a DMA command to the vFPGA
 	 *
 	 * This function triggers a DMA command by writing the provided offsets to the appropriate control registers.
+	 * The command is queued in the vFPGA's shared ring and written by whichever thread drains it, so threads sharing
+	 * the vFPGA submit without a lock and without oversubscribing the command FIFO.
 	 * @param offs_3 Destination address
 	 * @param offs_2 Destination control signals (e.g., size, offset, stream etc.)
 	 * @param offs_1 Source address
@@ -158,6 +526,47 @@ protected:
 	 */
 	void postCmd(uint64_t offs_3, uint64_t offs_2, uint64_t offs_1, uint64_t offs_0);
 
+	/**
+	 * @brief Posts a batch of DMA commands to the vFPGA
+	 *
+	 * Functionally equivalent to calling postCmd() for each entry; all the commands are queued before draining the ring, 
+	 * so the descriptors are written back-to-back.
+	 * @param cmds Commands to be posted, each entry ordered as {offs_3, offs_2, offs_1, offs_0}
+	 */
+	void postCmdBatch(const std::vector<std::array<uint64_t, 4>> &cmds);
+
+	/// Utility function, builds the command {offs_3, offs_2, offs_1, offs_0} for (a chunk of) a one-sided local operation; as passed to postCmd()
+	std::array<uint64_t, 4> localCmd(CoyoteOper oper, const localSg &sg, uint64_t offs, uint64_t len, bool last) const;
+
+	/// Utility function, builds the command {offs_3, offs_2, offs_1, offs_0} for (a chunk of) an RDMA operation; as passed to postCmd()
+	std::array<uint64_t, 4> rdmaCmd(CoyoteOper oper, const rdmaSg &sg, uint64_t offs, uint64_t len, bool last) const;
+
+	/**
+	 * @brief Appends the commands for a one-sided local operation to cmds
+	 *
+	 * Transfers larger than MAX_TRANSFER_SIZE are split into multiple sub-descriptors, of which only the final one 
+	 * carries the last flag (if set), so that the complete transfer results in a single completion.
+	 */
+	void buildLocalCmds(std::vector<std::array<uint64_t, 4>> &cmds, CoyoteOper oper, const localSg &sg, bool last) const;
+
+	/// Same as buildLocalCmds(), but for a two-sided LOCAL_TRANSFER; the source and destination are split independently
+	void buildTransferCmds(std::vector<std::array<uint64_t, 4>> &cmds, const localSg &src_sg, const localSg &dst_sg, bool last) const;
+
+	/// Utility function, invokes a prepared local operation on the regular path, splitting transfers over MAX_TRANSFER_SIZE
+	void invokePrepared(const localPrep &prep, uint64_t offs, uint64_t src_len, uint64_t dst_len);
+
+	/// Utility function, implements invokeBatch() and the vectored invoke() for one-sided local operations
+	void invokeLocalBatch(CoyoteOper oper, const localSg *sgs, size_t n);
+
+	/// Utility function, issues a sync/off-load request to the driver and blocks until it completes
+	void issueSync(CoyoteOper oper, syncSg sg);
+
+	/// The main function of sync_thread; issues the queued syncs/off-loads until the cThread is destroyed
+	void processSyncs();
+
+	/// Same as buildLocalCmds(), but for RDMA operations
+	void buildRdmaCmds(std::vector<std::array<uint64_t, 4>> &cmds, CoyoteOper oper, const rdmaSg &sg, bool last) const;
+
 	/**
 	 * @brief Sends an ack to the connected remote node via the out-of-band channel
 	 *
@@ -178,15 +587,57 @@ protected:
 	public:
 	/**
 	 * @brief Writes an IP address to a config register so it can be used for ARP lookup
+	 *
+	 * The driver keeps track of the addresses looked up on the device; an address already looked up
+	 * (by any cThread or process) is not looked up again, and this only waits for its lookup to complete, if needed
+	 *
 	 * @param ip_addr IP address to be looked up
 	 */
     void doArpLookup(uint32_t ip_addr);
+
+#ifdef EN_TCP_EXPERIMENTAL
+	/*
+	 * TCP sessions; only built with EN_TCP_EXPERIMENTAL, since the shell's TCP data path (EN_TCP) does not elaborate yet
+	 */
+
+	/**
+	 * @brief Listens on a TCP port of the FPGA's network stack
+	 *
+	 * The sessions of a cThread are identified by their dest (up to 16), which routes the received data to the 
+	 * vFPGA's TCP stream with the same dest, and is passed as tcpSg::dest to send data on the session.
+	 * A connection accepted on the port is bound to the given session.
+	 *
+	 * @param port Port to listen on
+	 * @param dest Session of this cThread the accepted connection is bound to
+	 * @return true if the port was opened, false if it is already in use
+	 * @note Throws if the stack doesn't respond within TCP_OPEN_TIMEOUT; TCP support is experimental
+	 */
+	bool tcpListen(uint16_t port, uint32_t dest = 0);
+
+	/**
+	 * @brief Opens a TCP connection from the FPGA's network stack, see tcpListen() for sessions
+	 *
+	 * @param ip_addr IPv4 address of the remote node
+	 * @param port Port of the remote node
+	 * @param dest Session of this cThread the connection is bound to
+	 * @return true if the connection was established
+	 * @note Throws if the stack doesn't respond within TCP_OPEN_TIMEOUT; TCP support is experimental
+	 */
+	bool tcpOpen(uint32_t ip_addr, uint16_t port, uint32_t dest = 0);
+
+	/**
+	 * @brief Closes the TCP connection of a session
+	 * @param dest Session of this cThread, as passed to tcpOpen() or tcpListen()
+	 */
+	void tcpClose(uint32_t dest = 0);
+#endif
 	
 	/**
 	 * @brief Writes the exchanged QP information to the vFPGA config registers
-	 * @param ip_addr IP address to be looked up
+	 * @param port Port of the out-of-band connection, used as the UDP source port of the QP
+	 * @param qp QP index (0 is the cThread's own QP, see addQp())
 	 */
-	void writeQpContext(uint32_t port);
+	void writeQpContext(uint32_t port, uint32_t qp = 0);
 	
 
 	/**
@@ -195,8 +646,11 @@ protected:
 	 * @param hpid Host process ID
 	 * @param device Device number, for systems with multiple vFPGAs
 	 * @param uisr User interrupt (notifications) service routine, called when an interrupt from the vFPGA is received
+	 * @param notify Delivery mode of the notifications; with CoyoteNotify::POLL, uisr is only called from pollNotifications()
+	 * @param reactor Shared reactor handling the notifications (see cNotifyReactor::getInstance()); nullptr (default) starts a 
+	 *		dedicated interrupt thread for this cThread
 	 */
-	cThread(int32_t vfid, pid_t hpid, uint32_t device = 0, std::function<void(int)> uisr = nullptr);
+	cThread(int32_t vfid, pid_t hpid, uint32_t device = 0, std::function<void(int)> uisr = nullptr, CoyoteNotify notify = CoyoteNotify::EVENTFD, cNotifyReactor *reactor = nullptr);
 	
 	/**
 	 * @brief Default destructor for the cThread
@@ -205,15 +659,36 @@ protected:
 	 */
 	~cThread();
 
+	/**
+	 * @brief Recycles the cThread for a (possibly different) host process, without tearing it down
+	 *
+	 * Releases all the buffers allocated or mapped by this cThread, closes the RDMA connection (if any) and re-registers the 
+	 * Coyote thread with the driver for the given process, which assigns a new ctid. The device, the memory mappings of the 
+	 * vFPGA registers and the shell configuration are kept, so this is much cheaper than constructing a new cThread; see cThreadPool.
+	 *
+	 * @param hpid Host process ID for which the cThread is registered
+	 *
+	 * @note Throws if the cThread has a user interrupt routine or outstanding asynchronous syncs/off-loads
+	 */
+	void reset(pid_t hpid);
+
 	/**
 	 * @brief Maps a buffer to the vFPGAs TLB
 	 *
+	 * The buffer may span several mappings (VMAs) and overlap buffers which are already mapped (e.g., parts of a large
+	 * arena handed out piece by piece); the pinned pages of the overlapped buffers are re-used and only the rest is pinned.
+	 *
 	 * @param vaddr Virtual address of the buffer
 	 * @param len Length of the buffer, in bytes
 	 * @param mem_block What memory block to store this memory in; only applicable to Versal devices
 	 *		When -1, the driver picks the first PC with sufficient space
+	 * @param mem_stripe Number of memory blocks to interleave the card memory across, one (huge) page at a time, see CoyoteAlloc::mem_stripe
+	 * @param resident Set if the buffer is already resident, e.g., mlocked or mapped with MAP_POPULATE (ideally backed by huge pages);
+	 *		the driver then maps exactly the buffer, without the fault-ahead window, and pins it with the lockless fast path
+	 * @param access How the vFPGA accesses the buffer, see CoyoteAccess; with a read-only or write-only hint the buffer is also mapped exactly.
+	 *		The hint only applies to pages newly pinned by this call; pages already mapped keep their own hint
 	 */
-	void userMap(void *vaddr, uint32_t len, int32_t mem_block = -1);
+	void userMap(void *vaddr, uint64_t len, int32_t mem_block = -1, uint32_t mem_stripe = 1, bool resident = false, CoyoteAccess access = CoyoteAccess::READ_WRITE);
 
 	/**
 	 * @brief Unmaps a buffer from the the vFPGAs TLB
@@ -222,6 +697,61 @@ protected:
 	 */
 	void userUnmap(void *vaddr);
 
+	/**
+	 * @brief Installs all the TLB entries of a buffer up-front, so that the first vFPGA accesses don't raise page faults
+	 *
+	 * @param vaddr Virtual address of the buffer; should already be mapped with getMem() or userMap()
+	 * @param len Length of the buffer, in bytes
+	 * @param stream Where the buffer should reside, STRM_HOST or STRM_CARD; for STRM_CARD the buffer is migrated to card memory
+	 */
+	void prefault(void *vaddr, uint64_t len, uint32_t stream = STRM_HOST);
+
+	/**
+	 * @brief Installs all the TLB entries of multiple buffers up-front; the driver holds the MMU lock once per batch
+	 *
+	 * @param buffs Virtual address and length, in bytes, of each buffer
+	 * @param stream Where the buffers should reside, STRM_HOST or STRM_CARD
+	 */
+	void prefault(const std::vector<std::pair<void*, uint64_t>> &buffs, uint32_t stream = STRM_HOST);
+
+	/**
+	 * @brief Maps, unmaps, off-loads or syncs multiple buffers, in order, with a single driver call per MAX_N_BATCH_OPS operations
+	 *
+	 * The driver takes the buffer lock once per call and consecutive unmaps share a single TLB invalidation,
+	 * so setting up or tearing down many buffers (e.g., warming up a buffer pool) is much faster than one call per buffer.
+	 * Off-loads and syncs are ordered after any outstanding invokeAsync() requests.
+	 *
+	 * @param ops Buffers and the operation on each of them
+	 * @param mem_block Memory block of the mapped buffers, see userMap(); only applicable to Versal devices
+	 * @param mem_stripe Memory stripe of the mapped buffers, see userMap()
+	 * @throws std::runtime_error on the first failed operation; the operations before it have completed
+	 */
+	void userMemBatch(const std::vector<memOpSg> &ops, int32_t mem_block = -1, uint32_t mem_stripe = 1);
+
+	/**
+	 * @brief Sets the fault-ahead window of a mapped buffer
+	 *
+	 * On a vFPGA page fault inside the buffer, the driver also maps the following window bytes,
+	 * so sequential scans take one page fault per window instead of one per transfer
+	 *
+	 * @param vaddr Starting virtual address of the buffer, as passed to userMap() or returned by getMem()
+	 * @param window Fault-ahead window, in bytes; FAULT_AHEAD_DEFAULT to use the device-wide window
+	 */
+	void setFaultAhead(void *vaddr, int64_t window);
+
+	/**
+	 * @brief Enables or disables implicit registration of buffers passed to invoke()
+	 *
+	 * When enabled, local operations on buffers that were neither obtained through getMem() nor mapped with userMap()
+	 * register the enclosing pages with userMap() on first use; later operations on the same pages are a lookup only.
+	 * Enabled by default if the driver was loaded with en_lazy_unpin=1, which drops the registration (and the cached entry)
+	 * as soon as the pages are unmapped or freed by the application. Without en_lazy_unpin, the driver keeps such buffers
+	 * pinned until userUnmap() is called, so the application must call userUnmap() before freeing an implicitly registered buffer.
+	 *
+	 * @param enable Set to register unmapped buffers implicitly
+	 */
+	void setAutoRegister(bool enable);
+
 	/**
 	 * @brief Allocates memory for this cThread and maps it into the vFPGA's TLB
 	 *
@@ -230,6 +760,18 @@ protected:
 	 */
     void* getMem(CoyoteAlloc&& alloc);
 	
+	/**
+	 * @brief Reserves huge pages for the process; HPF and AUTO allocations of all cThreads in the process are served from them first
+	 *
+	 * The pages are reserved and faulted in up front, so that later allocations neither fail once the system's huge page pool 
+	 * runs out nor fault. If the system's pool is too small, it is grown first, which requires root (see /proc/sys/vm/nr_hugepages).
+	 * Can be called multiple times to grow the reservation; the pages are kept until the process exits and aren't cleared on reuse.
+	 *
+	 * @param size Size of the reservation, in bytes; rounded up to the shell's large TLB page size
+	 * @param numa_node NUMA node to place the pages on, see CoyoteAlloc::numa_node
+	 */
+	void reserveHugePages(uint64_t size, int32_t numa_node = NUMA_NODE_NONE);
+	
 	/**
 	 * @brief Frees and unmaps previously allocated memory
 	 *
@@ -237,6 +779,113 @@ protected:
 	 */
 	void freeMem(void* vaddr);
 
+	/**
+	 * @brief Copies data from a card-only buffer (CoyoteAllocType::CARD) to a host buffer
+	 *
+	 * @param host_mem Destination, in a host buffer mapped by this cThread (e.g., obtained with getMem()); page-aligned
+	 * @param card_mem Source, in a card-only buffer; page-aligned
+	 * @param size Number of bytes to copy; a multiple of the page size
+	 */
+	void syncCardMem(void *host_mem, void *card_mem, uint64_t size);
+
+	/**
+	 * @brief Copies data from a host buffer to a card-only buffer (CoyoteAllocType::CARD)
+	 *
+	 * @param card_mem Destination, in a card-only buffer; page-aligned
+	 * @param host_mem Source, in a host buffer mapped by this cThread (e.g., obtained with getMem()); page-aligned
+	 * @param size Number of bytes to copy; a multiple of the page size
+	 */
+	void offloadCardMem(void *card_mem, void *host_mem, uint64_t size);
+
+	/**
+	 * @brief Shares a card-only buffer (CoyoteAllocType::CARD) with other cThreads on the same card, including those of other vFPGAs and processes
+	 *
+	 * The card memory is reference-counted; it is released once the buffer and all the attached copies are freed with freeMem()
+	 *
+	 * @param card_mem Card-only buffer, as returned by getMem()
+	 * @return Handle, to be passed to attachCardMem(); the same for repeated calls
+	 *
+	 * @note Attached cThreads have full access to the card memory; read-only sharing is up to the application
+	 */
+	uint64_t shareCardMem(void *card_mem);
+
+	/**
+	 * @brief Maps card memory shared with shareCardMem() into this cThread's TLB, as a card-only buffer
+	 *
+	 * @param handle Handle returned by shareCardMem(), possibly in another process
+	 * @return Pointer to the card-only buffer; to be released with freeMem()
+	 */
+	void* attachCardMem(uint64_t handle);
+
+	/**
+	 * @brief Makes the card memory of a card-only buffer persistent under a name; it then outlives this process, as long as the driver is loaded
+	 *
+	 * A restarted process finds the card memory again with attachCardMem(name), with its contents, instead of reloading them.
+	 * The buffer is shared as with shareCardMem(), and can still be freed with freeMem(); only the card memory is kept.
+	 *
+	 * @param card_mem Card-only buffer, as returned by getMem()
+	 * @param name Name of the card memory, unique on the card; at most CARD_MEM_NAME_LEN - 1 characters
+	 * @return Handle of the shared card memory, see shareCardMem()
+	 */
+	uint64_t persistCardMem(void *card_mem, const std::string &name);
+
+	/**
+	 * @brief Maps persistent card memory into this cThread's TLB, as a card-only buffer
+	 *
+	 * @param name Name passed to persistCardMem(), possibly by a process which has exited since
+	 * @return Pointer to the card-only buffer; to be released with freeMem()
+	 * @throws std::runtime_error if there is no persistent card memory with the name
+	 */
+	void* attachCardMem(const std::string &name);
+
+	/**
+	 * @brief Drops the persistence of named card memory; it is released now, or once the last buffer mapping it is freed
+	 *
+	 * @param name Name passed to persistCardMem()
+	 */
+	void unpersistCardMem(const std::string &name);
+
+	/**
+	 * @brief Exports this vFPGA's peer-to-peer window as a dmabuf, so that a vFPGA on another card can DMA to it directly
+	 *
+	 * The window is the vFPGA's user control region (axi_ctrl); card memory and streams are not exposed over PCIe.
+	 * Data moves card to card through the PCIe switch (or root complex), without using host memory bandwidth.
+	 *
+	 * @return dmabuf file descriptor, to be passed to importP2PWindow() of a cThread on the other card; the caller closes it
+	 *
+	 * @note Requires Linux >= 6.2 and a PCIe topology that supports peer-to-peer transactions between the two cards
+	 */
+	int exportP2PWindow();
+
+	/**
+	 * @brief Maps the peer-to-peer window of a vFPGA on another card into this cThread's TLB
+	 *
+	 * Local transfers (LOCAL_READ, LOCAL_WRITE) to the returned buffer go directly to the other card
+	 *
+	 * @param dmabuf_fd dmabuf file descriptor, as returned by exportP2PWindow(); it can be closed once this returns
+	 * @return Pointer to the window (CoyoteAllocType::PEER); to be released with freeMem()
+	 */
+	void* importP2PWindow(int dmabuf_fd);
+
+	/**
+	 * @brief Checks whether a buffer lies entirely inside a region mapped into the vFPGA's TLB by this cThread
+	 *
+	 * @param vaddr Start address of the buffer
+	 * @param len Length of the buffer, in bytes
+	 * @return True if [vaddr, vaddr + len) is covered by a region mapped with userMap() or getMem()
+	 *
+	 * @note O(log n) in the number of mapped regions; buffers spanning multiple adjacent regions are reported as unmapped 
+	 */
+	bool isMapped(const void *vaddr, uint64_t len) const;
+
+	/**
+	 * @brief Returns the allocation (obtained through getMem()) covering an address
+	 *
+	 * @param vaddr Any address inside the allocation, e.g., a sub-buffer view of a large allocation
+	 * @return Pointer to the allocation parameters, or nullptr if the address is not part of an allocation of this cThread
+	 */
+	const CoyoteAlloc* getAlloc(const void *vaddr) const;
+
 	/**
 	 * @brief Sets a control register in the vFPGA at the specified offset
 	 *
@@ -252,6 +901,35 @@ protected:
 	 * @return Value of the register at the specified offset
 	 */
 	uint64_t getCSR(uint32_t offs) const ;
+
+	/**
+	 * @brief Sets multiple control registers in the vFPGA, in order
+	 *
+	 * @param csrs Register offsets and the values to be set
+	 *
+	 * @note Runs of four consecutive, 32 B-aligned registers are written with a single 256-bit store if AVX is enabled, 
+	 * which the ctrl interconnect splits into the individual 64-bit register writes, in ascending order
+	 */
+	void setCSRs(const std::vector<std::pair<uint32_t, uint64_t>> &csrs);
+
+	/**
+	 * @brief Reads multiple registers from the vFPGA
+	 *
+	 * @param csrs Register offsets; the values read are stored next to them
+	 *
+	 * @note Runs of four consecutive, 32 B-aligned registers are read with a single 256-bit load if AVX is enabled,
+	 * i.e., with a single PCIe round trip instead of four
+	 */
+	void getCSRs(std::vector<std::pair<uint32_t, uint64_t>> &csrs) const;
+
+	/**
+	 * @brief Maps a contiguous range of control registers for direct, bounds-checked access (see csrWindow)
+	 *
+	 * @param base First register of the range
+	 * @param n_regs Number of registers in the range
+	 * @return Window over the registers; valid for the lifetime of the cThread
+	 */
+	csrWindow mapCSRs(uint32_t base, uint32_t n_regs);
 	
 	// The following functions are various implementation of the invoke function, which are used to trigger data movement operations
 	// There are different implementation for the different types of operations (sync, local, rdma, tcp) to ensure type safety at compile-time
@@ -262,10 +940,26 @@ protected:
 	 * @param oper Operation be invoked, in this case must be either CoyoteOper::LOCAL_SYNC or CoyoteOper::LOCAL_OFFLOAD
 	 * @param sg Scatter-gather entry, specifying the memory address and length for the operation
 	 *
-	 * @note Syncs and off-loads are blocking (synchronous) by design
+	 * @note Syncs and off-loads are blocking (synchronous) by design; see invokeAsync() for the non-blocking variant
+	 * @note On cache-coherent platforms (Enzian/ECI) without card memory, syncs and off-loads are no-ops, since the vFPGA accesses host memory directly
 	 */
 	void invoke(CoyoteOper oper, syncSg sg);
 
+	/**
+	 * @brief Submits a Coyote sync or offload operation, without waiting for it to complete
+	 *
+	 * The requests are queued and issued in order by a dedicated thread, so that the caller can overlap
+	 * the migration with other work (e.g., compute on data which is already resident in card memory)
+	 *
+	 * @param oper Operation be invoked, in this case must be either CoyoteOper::LOCAL_SYNC or CoyoteOper::LOCAL_OFFLOAD
+	 * @param sg Scatter-gather entry, specifying the memory address and length for the operation
+	 * @return Ticket of the request; the request has completed once checkCompleted(oper) >= ticket
+	 *
+	 * @note A failed request still counts as completed; its error is re-thrown by the next invoke() or invokeAsync() of a sync/off-load
+	 * @note Blocking invoke() calls on a sync/off-load are queued behind the outstanding asynchronous requests
+	 */
+	uint32_t invokeAsync(CoyoteOper oper, syncSg sg);
+
 	/**
 	 * @brief Invokes a one-sided local Coyote operation with the specified scatter-gather list (sg)
 	 *
@@ -275,6 +969,7 @@ protected:
 	 *
  	 * @note Local operations are non-blocking (asynchronous) by design, so users should poll for completion using checkCompleted()
 	 * @note Whenever last is passed as true, the completion counter for the operation is incremented by 1 and an acknowledgement is sent on the hardware-side cq_* interface of the vFPGA with ack_t.host = 1; otherwise it is not
+	 * @note Transfers over MAX_TRANSFER_SIZE are split into multiple commands, but still only increment the completion counter by 1
 	 */
 	void invoke(CoyoteOper oper, localSg sg, bool last = true);
 
@@ -291,6 +986,21 @@ protected:
 	 */
 	void invoke(CoyoteOper oper, localSg src_sg, localSg dst_sg, bool last = true);
 
+	/**
+	 * @brief Copies data between two buffers in card memory, on the card
+	 *
+	 * The copy is issued as a LOCAL_TRANSFER on the card streams of the vFPGA: card memory => axis_card_recv[sg.dest] => 
+	 * axis_card_send[sg.dest] => card memory, so the data never crosses PCIe, unlike a LOCAL_SYNC followed by a LOCAL_OFFLOAD.
+	 *
+	 * @param oper Operation be invoked, in this case must be CoyoteOper::LOCAL_CARD_COPY
+	 * @param sg Scatter-gather entry, specifying the source and destination card buffers, length and card stream
+	 * @param last Indicates whether this is the last operation in a sequence (default: true)
+	 *
+	 * @note The vFPGA must loop axis_card_recv[sg.dest] back to axis_card_send[sg.dest] (e.g., perf_local in examples/01_hello_world)
+	 * @note Completions are counted with the local writes; poll with checkCompleted(CoyoteOper::LOCAL_CARD_COPY)
+	 */
+	void invoke(CoyoteOper oper, cardCopySg sg, bool last = true);
+
 	/**
 	 * @brief Invokes an RDMA operation with the specified scatter-gather list (sg)
 	 *
@@ -310,10 +1020,97 @@ protected:
 	 * @param sg Scatter-gather entry, specifying the TCP operation parameters 
 	 * @param last Indicates whether this is the last operation in a sequence (default: true)
 	 *
-	 * @note TCP operations aren't fully stable in Coyote 0.2.1, to be updated in the future
+	 * @note The session (sg.dest) must have been opened with tcpOpen() or tcpListen(); TCP operations are experimental (EN_TCP_EXPERIMENTAL)
 	 */
 	void invoke(CoyoteOper oper, tcpSg sg, bool last = true);
 
+	/**
+	 * @brief Prepares a one-sided local operation, to be invoked repeatedly with invoke(const localPrep&, ...)
+	 *
+	 * The operation and the shell configuration are checked and the command is encoded once; invoking the prepared
+	 * operation then only adds the offset and the length to the command and writes it to the vFPGA, without any further checks.
+	 * This is meant for tight loops of small transfers, which only differ in the position within a buffer (or the buffer itself).
+	 *
+	 * @param oper Operation be prepared, in this case must be either CoyoteOper::LOCAL_READ or CoyoteOper::LOCAL_WRITE
+	 * @param sg Scatter-gather entry, specifying the memory address, (default) length, stream and destination for the operation
+	 * @param last Indicates whether the operations are marked as last (default: true), as for invoke()
+	 * @return Prepared operation; only valid for this cThread, until it is reset()
+	 */
+	localPrep prepare(CoyoteOper oper, const localSg &sg, bool last = true) const;
+
+	/// Same as prepare(oper, sg, last), but for a two-sided CoyoteOper::LOCAL_TRANSFER
+	localPrep prepare(CoyoteOper oper, const localSg &src_sg, const localSg &dst_sg, bool last = true) const;
+
+	/**
+	 * @brief Invokes a prepared local operation, on the prepared addresses and with the prepared lengths
+	 *
+	 * @param prep Operation, as returned by prepare()
+	 */
+	void invoke(const localPrep &prep);
+
+	/**
+	 * @brief Invokes a prepared local operation, on a different part of the buffer(s) or on another buffer
+	 *
+	 * @param prep Operation, as returned by prepare()
+	 * @param offs Offset, in bytes, added to the prepared address(es); may be the distance to a different buffer
+	 * @param len Length of the transfer, in bytes; for LOCAL_TRANSFER, the length of both the source and the destination
+	 *
+	 * @note Transfers over MAX_TRANSFER_SIZE take the regular path and are split into multiple commands, as in invoke()
+	 */
+	void invoke(const localPrep &prep, uint64_t offs, uint64_t len);
+
+	/**
+	 * @brief Invokes a batch of one-sided local Coyote operations
+	 *
+	 * The whole batch is validated before any command is issued and the descriptors are then written to the vFPGA
+	 * back-to-back, with only the final one being marked as last. This amortizes the submission cost for many small transfers.
+	 *
+	 * @param oper Operation be invoked, in this case must be either CoyoteOper::LOCAL_READ or CoyoteOper::LOCAL_WRITE
+	 * @param sgs Scatter-gather entries, specifying the memory address, length and stream for each operation
+	 *
+	 * @note As with invoke(), the completion counter is only incremented once for the whole batch
+	 */
+	void invokeBatch(CoyoteOper oper, const std::vector<localSg> &sgs);
+
+	/**
+	 * @brief Invokes a vectored (gather/scatter) one-sided local Coyote operation
+	 *
+	 * All the entries must target the same stream and destination; the descriptors are written back-to-back 
+	 * with only the final one marked as last, so the vFPGA sees one logical stream without any host-side copies 
+	 * of the (non-contiguous) buffers into a staging buffer.
+	 *
+	 * @param oper Operation be invoked, in this case must be either CoyoteOper::LOCAL_READ (gather) or CoyoteOper::LOCAL_WRITE (scatter)
+	 * @param sgs Array of scatter-gather entries
+	 * @param n Number of entries in sgs
+	 */
+	void invoke(CoyoteOper oper, const localSg *sgs, size_t n);
+
+	/**
+	 * @brief Invokes a batch of RDMA operations
+	 *
+	 * The whole batch is validated before any command is issued and the descriptors are then written to the vFPGA
+	 * back-to-back, with only the final one being marked as last.
+	 *
+	 * @param oper Operation be invoked, in this case must be CoyoteOper::RDMA_WRITE or CoyoteOper::RDMA_READ
+	 * @param sgs Scatter-gather entries, specifying the RDMA operation parameters for each operation
+	 *
+	 * @note As with invoke(), the completion counter is only incremented once for the whole batch
+	 */
+	void invokeBatch(CoyoteOper oper, const std::vector<rdmaSg> &sgs);
+
+	/**
+	 * @brief Invokes a chain of RDMA operations on the same QP, resulting in a single completion
+	 *
+	 * Same as invokeBatch(), but for the common scatter pattern in which only the offsets and lengths vary: the chain is 
+	 * validated once and the descriptors are built into a buffer kept by the cThread, so no allocations are made per call.
+	 * Only the final element carries the last flag, so checkCompleted(oper, tmpl.qp) is incremented once for the chain. 
+	 *
+	 * @param oper Operation be invoked, in this case must be CoyoteOper::REMOTE_RDMA_WRITE or CoyoteOper::REMOTE_RDMA_READ
+	 * @param tmpl QP, memory regions, streams and destinations shared by the chain; its offsets and length are ignored
+	 * @param chain Offsets and lengths of the operations
+	 */
+	void invokeChain(CoyoteOper oper, const rdmaSg &tmpl, const std::vector<rdmaChainSg> &chain);
+
 	/**
 	 * @brief Returns the number of completed operations for a given Coyote operation type
 	 *
@@ -322,8 +1119,38 @@ protected:
 	 */
 	uint32_t checkCompleted(CoyoteOper oper) const;
 
+	/**
+	 * @brief Checks the number of completed RDMA operations on one of the cThread's QPs
+	 *
+	 * @param oper Remote operation (REMOTE_RDMA_READ, REMOTE_RDMA_WRITE, REMOTE_RDMA_SEND)
+	 * @param qp QP index; checkCompleted(oper, 0) is the same as checkCompleted(oper)
+	 * @return Cumulative number of completed operations on the QP, since the last clearCompleted() call
+	 */
+	uint32_t checkCompleted(CoyoteOper oper, uint32_t qp) const;
+
+	/**
+	 * @brief Waits until the number of completed operations reaches a target
+	 *
+	 * For the first spin time, the completion counter is re-read after a low-latency wait: on shells with 
+	 * writeback and CPUs with WAITPKG, the core sleeps with umwait until the DMA write to the counter's cache line 
+	 * (or the umwait deadline); otherwise, it spins with a pause hint. Afterwards, it sleeps for SLEEP_TIME between 
+	 * reads, releasing the core to other threads.
+	 *
+	 * @param oper Operation to be queried, as in checkCompleted()
+	 * @param target Number of completed operations to wait for
+	 * @param timeout Maximum time to wait; negative (default) waits indefinitely
+	 * @param spin Time spent in low-latency waits before backing off to sleeps; WAIT_SPIN_TIME by default
+	 * @return true if the target was reached, false on timeout
+	 */
+	bool waitCompleted(
+		CoyoteOper oper, uint32_t target, std::chrono::nanoseconds timeout = std::chrono::nanoseconds(-1), 
+		std::chrono::nanoseconds spin = WAIT_SPIN_TIME
+	) const;
+
 	/**
 	 * @brief Clears all the completion counters (for all operations)
+	 *
+	 * @note Outstanding asynchronous syncs/off-loads (see invokeAsync()) should complete before the counters are cleared
 	 */
 	void clearCompleted();
 
@@ -333,6 +1160,30 @@ protected:
 	 */
     void connSync(bool client);
 
+	/**
+	 * @brief Synchronizes with the remote node of a QP, over RDMA
+	 *
+	 * Same as connSync(), but with an RDMA WRITE to a flag in each direction, rather than a round trip over the 
+	 * out-of-band TCP connection; it also works for QPs without an out-of-band connection (e.g., connectPeers()).
+	 * The flags are in a small buffer of the cThread, exchanged when the QP is connected, so the QP's buffer is not used. 
+	 * The barrier's writes are not marked as last, so they don't increment the completion counters of either node (e.g., 
+	 * checkCompleted(CoyoteOper::LOCAL_WRITE) for incoming writes); it can be called between operations which are being counted.
+	 *
+	 * @param qp QP index; both nodes must call rdmaSync() on the QP
+	 */
+	void rdmaSync(uint32_t qp = 0);
+
+	/**
+	 * @brief Synchronizes all the nodes of a job, with a dissemination barrier over the QPs from connectPeers()
+	 *
+	 * In ceil(log2(n)) rounds, each node signals the node 2^k ranks ahead and waits for the one 2^k ranks behind, 
+	 * so none of the nodes returns before all of them called rdmaBarrier().
+	 *
+	 * @param qps QP index for each rank, as returned by connectPeers()
+	 * @param rank Rank of this node
+	 */
+	void rdmaBarrier(const std::vector<uint32_t> &qps, uint32_t rank);
+
 	/**
 	 * @brief Sets up the cThread for RDMA operations
 	 *
@@ -347,6 +1198,84 @@ protected:
 	 */
 	void* initRDMA(uint32_t buffer_size, uint16_t port, const char* server_address = nullptr);
 	
+	/**
+	 * @brief Adds a QP to the cThread, so that one cThread can hold connections to several remote nodes (e.g., for an all-to-all shuffle)
+	 *
+	 * The vFPGA tells QPs apart by the Coyote thread ID, so every added QP registers a new ctid with the driver (N_CTID_MAX per vFPGA).
+	 * Buffers mapped by this cThread are usable by all of its QPs, since the ctids belong to the same host process.
+	 * The QP is connected with connectQp(); RDMA operations select it with rdmaSg::qp.
+	 *
+	 * @return Index of the new QP
+	 */
+	uint32_t addQp();
+
+	/**
+	 * @brief Connects a QP to a remote node, exchanging the QP information over a one-off out-of-band connection
+	 *
+	 * Unlike initRDMA(), the buffer is provided by the caller (e.g., a slice of one buffer shared by all the QPs) 
+	 * and the out-of-band connection is closed once the QPs are exchanged. Both sides must call connectQp() with the same port.
+	 *
+	 * @param qp QP index, as returned by addQp(); 0 re-connects the cThread's own QP
+	 * @param buffer Local buffer of the QP, previously obtained with getMem() or mapped with userMap()
+	 * @param size Size of the local buffer, in bytes
+	 * @param port Port for the out-of-band connection
+	 * @param server_address Address of the remote node; if not provided, this cThread acts as the server and waits for it
+	 */
+	void connectQp(uint32_t qp, void *buffer, uint32_t size, uint16_t port, const char* server_address = nullptr);
+
+	/**
+	 * @brief Re-connects a QP after the remote node restarted, without re-creating the cThread
+	 *
+	 * The local buffer, the registered memory regions and the ctid are kept. The QP information is exchanged again with the 
+	 * restarted node, which connects with initRDMA() or connectQp(), as on the first connection. The QP gets a fresh local PSN,
+	 * and its completion counters are cleared. Only the QP context is rewritten; the ARP lookup is skipped if the remote node 
+	 * came back on the same IP address. For the QP of initRDMA(), the out-of-band connection is replaced and stays open for 
+	 * closeConn(); the server accepts on the socket it already listens on.
+	 *
+	 * @param qp QP index; 0 for the QP set up with initRDMA()
+	 * @param port Port for the out-of-band connection, as on the first connection
+	 * @param server_address Address of the remote node; if not provided, this cThread acts as the server and waits for it.
+	 *        The client retries until the server listens again
+	 */
+	void reconnectQp(uint32_t qp, uint16_t port, const char* server_address = nullptr);
+
+	/**
+	 * @brief Registers a memory region (MR) for RDMA, so that one-sided operations can target it without staging copies
+	 *
+	 * The registered regions are exchanged with the remote node in initRDMA() and connectQp(), so they must be registered 
+	 * before connecting; RDMA operations then name a region with rdmaSg::local_mr and rdmaSg::remote_mr. Region 0 is always 
+	 * the QP's own buffer (e.g., the one returned by initRDMA()). The buffer must stay mapped while the cThread is connected.
+	 *
+	 * @param vaddr Buffer virtual address; must be mapped in the vFPGA's TLB (e.g., obtained with getMem())
+	 * @param size Buffer size, in bytes
+	 * @return Index of the region
+	 */
+	uint32_t registerMr(void *vaddr, uint64_t size);
+
+	/// Getter: Number of memory regions registered by the remote node of a QP, excluding the QP's buffer (region 0)
+	uint32_t getNumRemoteMrs(uint32_t qp = 0) const;
+
+	/**
+	 * @brief Connects this node to all the other nodes of a job, with one QP per peer
+	 *
+	 * All the nodes call connectPeers() with the same list of addresses and port. Each node listens on the port and accepts 
+	 * the connections of all the higher ranks, while it connects to all the lower ranks in parallel, retrying until they listen.
+	 * Once all the QPs (and the memory regions, see registerMr()) are exchanged, the QP contexts are written and the ARP lookups 
+	 * issued back-to-back, waiting for the vFPGA only once, rather than once per peer.
+	 *
+	 * @param peers Addresses of all the nodes of the job, in rank order (including this node)
+	 * @param rank Rank of this node, i.e., its index in peers
+	 * @param buffer Local buffer, used by all the QPs (region 0); slices can be targeted with the offsets or with registered regions
+	 * @param size Size of the local buffer, in bytes
+	 * @param port Port for the out-of-band connections; same on all the nodes
+	 * @return QP index for each rank; the first peer is served by the cThread's own QP (0), the others by QPs added with addQp()
+	 *         The entry of this node's own rank is set to UINT32_MAX
+	 */
+	std::vector<uint32_t> connectPeers(const std::vector<std::string> &peers, uint32_t rank, void *buffer, uint32_t size, uint16_t port);
+
+	/// Getter: Number of QPs (1 + the QPs added with addQp())
+	uint32_t getNumQps() const;
+
 	/**
 	 * @brief Opposite of initRDMA; releases the the out-of-band connection which was used to exchange QP
 	 */
@@ -359,6 +1288,7 @@ protected:
 	 * However, this may not always be desirable, as shown in Example 8 multi-threading.
 	 * Generally, this method is typically not required and may mainly be needed when there are multiple
 	 * software processes/threads targetting the same vFPGA simultaneously which can lead to undefined behaviour
+	 * The lock is either an inter-process named mutex or an in-process mutex, see setLockBackend()
 	 */
 	void lock();
 
@@ -367,6 +1297,86 @@ protected:
 	 */
 	void unlock();
 
+	/**
+	 * @brief Sets the backend of lock() and unlock()
+	 *
+	 * By default, the vFPGA is locked with a named (inter-process) mutex, which goes through a shared-memory file.
+	 * When all the users of the vFPGA live in one process (e.g., a cService), the in-process mutex shared by the 
+	 * process' cThreads on the vFPGA (a futex) is much cheaper; cThreads with different backends don't exclude each other.
+	 *
+	 * @param backend Lock backend; CoyoteLock::SYSTEM by default
+	 * @note Throws if the lock is currently held by this cThread
+	 */
+	void setLockBackend(CoyoteLock backend);
+
+	/// Getter: backend of lock() and unlock()
+	CoyoteLock getLockBackend() const;
+
+	/**
+	 * @brief Sets the back-off policy used while waiting for free slots in the vFPGA command FIFO
+	 *
+	 * @param policy Back-off policy; CoyoteBackoff::SLEEP by default
+	 */
+	void setBackoff(CoyoteBackoff policy);
+
+	/// Getter: command FIFO back-off policy
+	CoyoteBackoff getBackoff() const;
+
+	/**
+	 * @brief Enables or disables write-combined command submission
+	 *
+	 * When enabled, commands are written through a write-combined mapping of the command register,
+	 * so that each 256-bit command reaches the vFPGA as a single PCIe write, followed by a store fence;
+	 * with the default (uncached) mapping, the CPU may split the AVX store into several smaller writes.
+	 * Only available on shells built with AVX support; should be set before any commands are issued.
+	 *
+	 * @param enable Use the write-combined mapping (true) or the uncached one (false, default)
+	 */
+	void setWriteCombining(bool enable);
+
+	/// Getter: whether commands are submitted through the write-combined mapping
+	bool getWriteCombining() const;
+
+	/**
+	 * @brief Sets the pacing of the RDMA WRITEs issued by this cThread (on all its QPs)
+	 *
+	 * With pacing, invoke(), invokeBatch() and invokeChain() wait before issuing a REMOTE_RDMA_WRITE with the last flag 
+	 * until less than the window of writes are outstanding on its QP (i.e., issued, but not yet counted by checkCompleted()); 
+	 * writes without the last flag are not counted, and thus not paced. With CoyotePacing::ADAPTIVE, the window of each QP 
+	 * starts at max_window, is increased by one per RTT, and halved when the smoothed RTT exceeds RDMA_PACING_RTT_FACTOR times 
+	 * the minimum RTT, or when the network stack retransmits (shell-wide stats, so writes of other processes may also cause it).
+	 *
+	 * @param mode Pacing mode; CoyotePacing::NONE by default
+	 * @param max_window Max. number of outstanding writes per QP; at least 1
+	 * @note clearCompleted() resets the outstanding writes, so it should only be called when no paced writes are in flight
+	 */
+	void setRdmaPacing(CoyotePacing mode, uint32_t max_window = RDMA_PACING_MAX_WINDOW);
+
+	/// Getter: pacing mode of RDMA WRITEs
+	CoyotePacing getRdmaPacing() const;
+
+	/// Getter: current pacing window of a QP, in writes (the max. window if no write was paced on the QP yet)
+	uint32_t getRdmaWindow(uint32_t qp = 0) const;
+
+	/**
+	 * @brief Handles the pending user interrupts (notifications), calling the uisr for each of them, in order
+	 *
+	 * Only available with CoyoteNotify::POLL, where no thread is woken up on notifications; 
+	 * the caller should poll often enough to keep the ring (NOTIFY_RING_ENTRIES) from overflowing, see getDroppedNotifications()
+	 *
+	 * @return Number of handled notifications
+	 */
+	uint32_t pollNotifications();
+
+	/// Getter: Number of notifications the driver dropped since the ring was full (coalesced and polling modes only)
+	uint32_t getDroppedNotifications() const;
+
+	/// Getter: Delivery mode of user interrupts
+	CoyoteNotify getNotifyMode() const;
+
+	/// Getter: NUMA node the FPGA is attached to; -1 if unknown (e.g., non-NUMA systems)
+	int32_t getNumaNode() const;
+
 	/// Getter: vFPGA ID (vfid)
 	int32_t getVfid() const;
 
@@ -376,23 +1386,80 @@ protected:
 	/// Getter: Host process ID (hpid)
 	pid_t getHpid() const;
 
-	/// Getter: queue pair (QP)
-	ibvQp* getQpair() const;
+	/// Getter: queue pair (QP) with the given index (0 by default, the cThread's own QP)
+	ibvQp* getQpair(uint32_t qp = 0) const;
 	
 	/// Utility function, prints stats about this cThread including the number of commands invalidations etc.
 	void printDebug() const;
 
+	/**
+	 * @brief Enables or disables the timing reports of completed requests (issue, first and last data beat, completion)
+	 *
+	 * Only available in simulation, where the test bench reports the timing of every completed request, in clock cycles; 
+	 * enabling clears the timings collected so far. Throws a std::runtime_error in hardware.
+	 *
+	 * @param enable Whether to collect the timing of completed requests
+	 */
+	void setTimingTrace(bool enable);
+
+	/// Getter: Timing of the requests completed since the timing reports were enabled (simulation only)
+	std::vector<simReqTiming> getTimings() const;
+
+	/// Utility function, prints the number of requests and their average and maximum latencies (in clock cycles) by operation (simulation only)
+	void printTimingSummary() const;
+
+	/// Utility function, writes the timing of all requests completed since the timing reports were enabled to a CSV file (simulation only)
+	void writeTimingCsv(const std::string &file_name) const;
+
 private:
     // We use this "pointer to implementation" pattern here to be able to attach additional state to
     // the cThread in the simulation implementation of cThread. Before doing this, we had to use 
     // global variables which caused issues with order of destruction potentially destroying the 
     // simulation threads before they were joined. This is the minimally invasive way of doing this
     // to be able to have a second implementation of cThread without duplicating the cThread 
-    // header.
+    // header. It is shared, since all cThreads of a process attach to the same simulation.
     class AdditionalState;
-    std::unique_ptr<AdditionalState> additional_state;
+    std::shared_ptr<AdditionalState> additional_state;
 };
 
+inline void csrWindow::set(uint32_t idx, uint64_t val) {
+	check(idx);
+	if (regs) {
+		regs[idx] = val;
+	} else {
+		thread->setCSR(val, base + idx);
+	}
+	updateShadow(idx, val);
+}
+
+inline uint64_t csrWindow::get(uint32_t idx) const {
+	check(idx);
+	if (!shadow_state.empty() && shadow_state[idx] == SHADOW_VALID) {
+		return shadow[idx];
+	}
+
+	uint64_t val = regs ? regs[idx] : thread->getCSR(base + idx);
+	updateShadow(idx, val);
+	return val;
+}
+
+inline void csrWindow::set(const std::vector<std::pair<uint32_t, uint64_t>> &csrs) {
+	if (csrs.empty()) {
+		return;
+	}
+
+	std::vector<std::pair<uint32_t, uint64_t>> abs_csrs;
+	abs_csrs.reserve(csrs.size());
+	for (const auto &csr : csrs) {
+		abs_csrs.emplace_back(base + check(csr.first), csr.second);
+	}
+
+	thread->setCSRs(abs_csrs);
+	for (const auto &csr : csrs) {
+		updateShadow(csr.first, csr.second);
+	}
+}
+
 }
 
 #endif // _COYOTE_CTHREAD_HPP_
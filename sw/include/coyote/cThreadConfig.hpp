@@ -0,0 +1,122 @@
+/*
+ * This file is part of the Coyote <https://github.com/fpgasystems/Coyote>
+ *
+ * MIT Licence
+ * Copyright (c) 2025, Systems Group, ETH Zurich
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _COYOTE_CTHREADCONFIG_HPP_
+#define _COYOTE_CTHREADCONFIG_HPP_
+
+#include <vector>
+#include <cstdint>
+#include <sched.h>
+
+namespace coyote {
+
+/// Threads started by Coyote itself, which can be configured separately
+enum class CoyoteThreadRole {
+    /// Interrupt handler of a cThread (without a cNotifyReactor), "cyt-event"
+    EVENT = 0,
+
+    /// Executes the asynchronous syncs and off-loads of a cThread, "cyt-sync"
+    SYNC = 1,
+
+    /// Scheduler workers of a vFPGA (cSched), "cyt-sched"
+    SCHEDULER = 2,
+
+    /// Reactors handling the client sockets of a cService, "cyt-svc"
+    SERVICE = 3,
+
+    /// Serves the statistics socket of a cService, "cyt-stats"
+    STATS = 4,
+
+    /// Receives the task completions of a cConn (client side), "cyt-conn"
+    CONN = 5,
+
+    /// Interrupt reactors (cNotifyReactor, cReactor), "cyt-notify"
+    REACTOR = 6,
+
+    /// Bitstream loaders (cRcnfg, cSched::addFunctions), "cyt-load"
+    LOADER = 7,
+
+    /// Writes the messages of cLog to syslog, "cyt-log"
+    LOG = 8
+};
+
+/// Number of thread roles
+constexpr unsigned int const N_THREAD_ROLES = 9;
+
+/// @brief Placement and scheduling of the threads of a role
+struct cThreadAttr {
+    /// CPUs the threads may run on; empty to leave the affinity unchanged (i.e., inherited from the creating thread)
+    std::vector<int> cpus;
+
+    /// Scheduling policy (SCHED_OTHER, SCHED_BATCH, SCHED_IDLE, SCHED_FIFO or SCHED_RR); real-time policies need CAP_SYS_NICE
+    int policy = SCHED_OTHER;
+
+    /// Static priority for SCHED_FIFO and SCHED_RR (1 - 99); must be 0 for the other policies
+    int priority = 0;
+};
+
+/**
+ * @brief Process-wide configuration of the threads started by Coyote
+ *
+ * Each library thread names itself (pthread_setname_np, e.g., "cyt-sched-2" for a scheduler worker of vFPGA 2, as shown by
+ * top -H) and applies the attributes of its role as it starts; so, the configuration only applies to threads started
+ * after it is set, and should be set before the Coyote objects are created. This keeps Coyote's threads off the isolated
+ * cores of latency-critical application threads, or runs them with a real-time policy on cores of their own.
+ *
+ * Applying the attributes is best-effort: a failure (e.g., SCHED_FIFO without CAP_SYS_NICE) is logged and the thread
+ * continues with the default attributes.
+ */
+class cThreadConfig {
+
+public:
+    /**
+     * @brief Sets the attributes of the threads of a role
+     *
+     * @param role Role of the threads
+     * @param attr Attributes of the threads
+     * @throws std::runtime_error if a CPU, the policy or the priority is invalid
+     */
+    static void set(CoyoteThreadRole role, const cThreadAttr &attr);
+
+    /// Sets the same attributes for all roles; see set(...)
+    static void setAll(const cThreadAttr &attr);
+
+    /// Returns the attributes of the threads of a role
+    static cThreadAttr get(CoyoteThreadRole role);
+
+    /**
+     * @brief Names the calling thread and applies the attributes of its role; called by every thread Coyote starts
+     *
+     * @param role Role of the calling thread
+     * @param id Appended to the name (e.g., the vFPGA or Coyote thread ID), if non-negative
+     */
+    static void apply(CoyoteThreadRole role, int64_t id = -1);
+
+};
+
+}
+
+#endif // _COYOTE_CTHREADCONFIG_HPP_
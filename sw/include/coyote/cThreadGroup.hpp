@@ -0,0 +1,213 @@
+/*
+ * This file is part of the Coyote <https://github.com/fpgasystems/Coyote>
+ *
+ * MIT Licence
+ * Copyright (c) 2025, Systems Group, ETH Zurich
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _COYOTE_CTHREADGROUP_HPP_
+#define _COYOTE_CTHREADGROUP_HPP_
+
+#include <map>
+#include <deque>
+#include <memory>
+#include <vector>
+#include <chrono>
+#include <cstdint>
+#include <unistd.h>
+
+#include <coyote/cDefs.hpp>
+#include <coyote/cOps.hpp>
+#include <coyote/cThread.hpp>
+
+namespace coyote {
+
+/// @brief A vFPGA of a cThreadGroup, see cThreadGroup::cThreadGroup()
+struct cGroupMember {
+    /// Device number of the FPGA
+    uint32_t device = { 0 };
+
+    /// vFPGA ID on the device
+    int32_t vfid = { 0 };
+};
+
+/**
+ * @brief Group of cThreads on several FPGAs (and/or vFPGAs), used as one logical accelerator
+ *
+ * The group opens one cThread per member and splits each local operation into contiguous shards, one per member, 
+ * which are issued to all the members before any of them is waited for, so the transfers run on the cards in parallel. 
+ * Buffers obtained through the group's getMem() are sharded once, at allocation: each shard is placed on the NUMA node 
+ * of its member's card and only mapped into that member's TLB; operations on these buffers are split at the shard boundaries. 
+ * Other buffers are split evenly, at page boundaries, and each shard is mapped by its member on the first access.
+ *
+ * The completions are aggregated: checkCompleted() counts the group operations for which all the shards completed.
+ *
+ * @note The vFPGAs must run the same (data-parallel) kernel, and each shard is processed independently of the others
+ * @note The completion counters of the members must only be updated through the group, e.g., no operations should be 
+ *       invoked on the members directly while group operations are outstanding
+ */
+class cThreadGroup {
+
+private:
+    /// Contiguous part of an operation, handled by one member
+    struct shardSg {
+        /// Index of the member
+        size_t member;
+
+        /// Offset from the start of the operation, in bytes
+        uint64_t offs;
+
+        /// Length, in bytes
+        uint64_t len;
+    };
+
+    /// Buffer allocated by getMem(), split into consecutive shards of shard_size bytes; shard i belongs to member i
+    struct groupAlloc {
+        /// Size of the mapping, in bytes (a multiple of shard_size)
+        uint64_t size;
+
+        /// Size of each shard, in bytes
+        uint64_t shard_size;
+    };
+
+    /// One cThread per member, in the order given to the constructor
+    std::vector<std::unique_ptr<cThread>> threads;
+
+    /// Buffers allocated by getMem(), by start address
+    std::map<uint64_t, groupAlloc> allocs;
+
+    /// Number of operations invoked on each member, by operation; the completion target of the member's shards
+    std::map<CoyoteOper, std::vector<uint32_t>> issued;
+
+    /// Outstanding group operations, by operation; each holds the completion target of every member (0 if it holds no shard)
+    std::map<CoyoteOper, std::deque<std::vector<uint32_t>>> outstanding;
+
+    /// Completed group operations, by operation, since the last clearCompleted()
+    std::map<CoyoteOper, uint32_t> completed;
+
+    /// Splits [addr, addr + len) into shards, along the boundaries of the group buffer containing it, if any
+    void split(uint64_t addr, uint64_t len, std::vector<shardSg> &shards) const;
+
+    /// Records a group operation, whose shards were issued to the given members
+    void track(CoyoteOper oper, const std::vector<shardSg> &shards);
+
+    /// Retires the group operations of which all the shards completed
+    void poll(CoyoteOper oper);
+
+public:
+    /**
+     * @brief Opens one cThread per member
+     *
+     * @param members Device and vFPGA of each member; the shards of an operation are assigned in this order
+     * @param hpid Host process ID
+     */
+    cThreadGroup(const std::vector<cGroupMember> &members, pid_t hpid);
+
+    /**
+     * @brief Opens one cThread on the same vFPGA of the first n_devices devices
+     *
+     * @param vfid vFPGA ID, on every device
+     * @param hpid Host process ID
+     * @param n_devices Number of devices
+     */
+    cThreadGroup(int32_t vfid, pid_t hpid, uint32_t n_devices);
+
+    /// Default destructor; releases the buffers allocated with getMem()
+    ~cThreadGroup();
+
+    /**
+     * @brief Allocates a buffer sharded over the members
+     *
+     * The buffer is contiguous in virtual memory; shard i is placed on the NUMA node of member i's card and mapped into its TLB.
+     * The shards are a multiple of the huge page size, so small buffers may not cover all the members.
+     *
+     * @param alloc Allocation parameters; only host memory (REG, THP or HPF) can be sharded, and numa_node is ignored
+     * @return Pointer to the buffer; to be released with freeMem()
+     */
+    void* getMem(CoyoteAlloc&& alloc);
+
+    /// Releases a buffer allocated with getMem()
+    void freeMem(void *vaddr);
+
+    /**
+     * @brief Returns the size of the shards of a buffer allocated with getMem(), i.e., the offset of shard i is i * getShardSize()
+     *
+     * @param vaddr Start of the buffer
+     */
+    uint64_t getShardSize(const void *vaddr) const;
+
+    /**
+     * @brief Invokes a one-sided local operation, split into one shard per member
+     *
+     * @param oper Operation, LOCAL_READ or LOCAL_WRITE
+     * @param sg Scatter-gather entry of the complete operation
+     * @return Number of members handling a shard of the operation
+     */
+    size_t invoke(CoyoteOper oper, localSg sg);
+
+    /**
+     * @brief Invokes a two-sided local operation, split into one shard per member
+     *
+     * The source and destination are split at the same offsets, along the shards of the source
+     *
+     * @param oper Operation, LOCAL_TRANSFER
+     * @param src_sg Source of the complete operation
+     * @param dst_sg Destination of the complete operation; the same length as the source
+     * @return Number of members handling a shard of the operation
+     */
+    size_t invoke(CoyoteOper oper, localSg src_sg, localSg dst_sg);
+
+    /**
+     * @brief Returns the number of completed group operations, i.e., the operations of which all the shards completed
+     *
+     * @param oper Operation to be queried
+     * @return Cumulative number of completed group operations, since the last clearCompleted() call
+     */
+    uint32_t checkCompleted(CoyoteOper oper);
+
+    /**
+     * @brief Waits until the number of completed group operations reaches a target
+     *
+     * @param oper Operation to be queried
+     * @param target Number of completed group operations to wait for
+     * @param timeout Maximum time to wait; negative (default) waits indefinitely
+     * @return true if the target was reached, false on timeout
+     */
+    bool waitCompleted(CoyoteOper oper, uint32_t target, std::chrono::nanoseconds timeout = std::chrono::nanoseconds(-1));
+
+    /// Clears the completion counters of the group and all the members; no group operations should be outstanding
+    void clearCompleted();
+
+    /// Sets a control register on all the members, e.g., a kernel parameter
+    void setCSR(uint64_t val, uint32_t offs);
+
+    /// Getter: Number of members
+    size_t size() const;
+
+    /// Getter: cThread of a member
+    cThread* getThread(size_t member) const;
+
+};
+
+}
+
+#endif // _COYOTE_CTHREADGROUP_HPP_
@@ -0,0 +1,110 @@
+/*
+ * This file is part of the Coyote <https://github.com/fpgasystems/Coyote>
+ *
+ * MIT Licence
+ * Copyright (c) 2025, Systems Group, ETH Zurich
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _COYOTE_CTHREADPOOL_HPP_
+#define _COYOTE_CTHREADPOOL_HPP_
+
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <functional>
+#include <unistd.h>
+
+#include <coyote/cDefs.hpp>
+#include <coyote/cThread.hpp>
+
+namespace coyote {
+
+/**
+ * @brief Pool of recycled cThreads for one vFPGA
+ *
+ * Constructing a cThread opens the device, registers a Coyote thread with the driver, reads the shell configuration 
+ * and maps the vFPGA registers, which is expensive for services creating a cThread per client (see cService). 
+ * Instead, the pool hands out idle cThreads, which are re-registered for the requesting process (see cThread::reset()), 
+ * and takes them back once they are released, up to its capacity. Idle cThreads are registered for the process owning the pool.
+ *
+ * @note Only cThreads without a user interrupt routine are pooled
+ */
+class cThreadPool {
+
+public:
+    /// A cThread handed out by the pool; returned to the pool (or destroyed, if the pool is full or gone) when released
+    using pooledThread = std::unique_ptr<cThread, std::function<void(cThread*)>>;
+
+private:
+    /// State of the pool; shared with the handed-out threads, so that they can be returned even while the pool is being destroyed
+    struct poolState {
+        /// vFPGA ID of the pooled threads
+        int32_t vfid;
+
+        /// Device of the pooled threads
+        uint32_t device;
+
+        /// Maximum number of idle threads
+        size_t capacity;
+
+        /// Idle threads, ready to be handed out
+        std::vector<std::unique_ptr<cThread>> idle;
+
+        /// Lock, protecting idle
+        std::mutex lock;
+    };
+
+    std::shared_ptr<poolState> state;
+
+    /// Returns a released thread to the pool, after recycling it for the pool's process; destroys it if that's not possible
+    static void recycle(const std::weak_ptr<poolState> &pool, cThread *thread);
+
+public:
+    /**
+     * @brief Creates an (empty) pool
+     *
+     * @param vfid vFPGA ID of the threads
+     * @param device Device number, for systems with multiple vFPGAs
+     * @param capacity Maximum number of idle threads kept by the pool
+     */
+    cThreadPool(int32_t vfid, uint32_t device = 0, size_t capacity = DAEMON_THREAD_POOL_SIZE);
+
+    /// Creates idle threads until the pool is at its capacity, so that the first users don't wait for a cThread to be constructed
+    void fill();
+
+    /**
+     * @brief Hands out a thread, registered for the given process; a new cThread is constructed if there is no idle one
+     *
+     * @param hpid Host process ID for which the thread is registered
+     * @return The thread; returned to the pool once the pointer is destroyed
+     */
+    pooledThread acquire(pid_t hpid);
+
+    /// Getter: Number of idle threads
+    size_t getIdle();
+
+};
+
+}
+
+#endif // _COYOTE_CTHREADPOOL_HPP_
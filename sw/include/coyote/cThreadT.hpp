@@ -0,0 +1,262 @@
+/*
+ * This file is part of the Coyote <https://github.com/fpgasystems/Coyote>
+ *
+ * MIT Licence
+ * Copyright (c) 2025, Systems Group, ETH Zurich
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _COYOTE_CTHREADT_HPP_
+#define _COYOTE_CTHREADT_HPP_
+
+#include <array>
+#include <cstdint>
+#include <utility>
+#include <stdexcept>
+
+#include <coyote/cOps.hpp>
+#include <coyote/cDefs.hpp>
+#include <coyote/cThread.hpp>
+
+namespace coyote {
+
+/**
+ * @brief Compile-time description of a shell configuration, for use with cThreadT
+ *
+ * The flags correspond to the fields of fpgaCnfg with the same name, as parsed from the
+ * driver when the cThread is created.
+ *
+ * @tparam AVX Shell was synthesized with AVX (256-bit) configuration registers
+ * @tparam WB Shell was synthesized with completion writeback to host memory
+ * @tparam STRM Shell was synthesized with streams from host memory
+ * @tparam MEM Shell was synthesized with card memory
+ */
+template <bool AVX, bool WB, bool STRM = true, bool MEM = false>
+struct cShellTraits {
+    static constexpr bool en_avx = AVX;
+    static constexpr bool en_wb = WB;
+    static constexpr bool en_strm = STRM;
+    static constexpr bool en_mem = MEM;
+};
+
+/**
+ * @brief A cThread specialized for a known shell configuration
+ *
+ * The generic cThread checks the shell features (AVX registers, writeback) on every command
+ * it writes and every completion counter it reads. When the shell is known at compile time,
+ * cThreadT removes these checks: commands to local memory are written and completions are polled
+ * with straight-line code for the given shell. On construction, the traits are verified against 
+ * the configuration parsed from the driver; a mismatch throws.
+ *
+ * All other functionality is inherited unchanged from cThread. Hardware only; the simulation
+ * target should use the generic cThread.
+ *
+ * @tparam Traits Shell configuration, see cShellTraits
+ */
+template <typename Traits>
+class cThreadT : public cThread {
+    #ifndef EN_AVX
+    static_assert(!Traits::en_avx, "cThreadT: traits with AVX registers require the library to be built with EN_AVX");
+    #endif
+    static_assert(Traits::en_strm || Traits::en_mem, "cThreadT: the shell must have streams from host memory or card memory");
+
+public:
+    /// Same arguments as the cThread constructor; throws if the shell does not match the traits
+    template <typename... Args>
+    explicit cThreadT(Args&&... args) : cThread(std::forward<Args>(args)...) {
+        if (fcnfg.en_avx != Traits::en_avx || fcnfg.en_wb != Traits::en_wb || 
+            fcnfg.en_strm != Traits::en_strm || fcnfg.en_mem != Traits::en_mem) {
+            throw std::runtime_error("ERROR: cThreadT, shell configuration does not match the traits, exiting...");
+        }
+    }
+
+    using cThread::invoke;
+    using cThread::checkCompleted;
+
+    /// Same as cThread::invoke(CoyoteOper, localSg, bool)
+    void invoke(CoyoteOper oper, localSg sg, bool last = true) {
+        if (sg.len > MAX_TRANSFER_SIZE || !(isLocalRead(oper) ^ isLocalWrite(oper))) {
+            cThread::invoke(oper, sg, last);
+            return;
+        }
+
+        pushCmd(localCmd(oper, sg, 0, sg.len, last));
+        drain();
+    }
+
+    /// Same as cThread::invoke(CoyoteOper, localSg, localSg, bool)
+    void invoke(CoyoteOper oper, localSg src_sg, localSg dst_sg, bool last = true) {
+        if (src_sg.len > MAX_TRANSFER_SIZE || dst_sg.len > MAX_TRANSFER_SIZE || !(isLocalRead(oper) && isLocalWrite(oper))) {
+            cThread::invoke(oper, src_sg, dst_sg, last);
+            return;
+        }
+
+        std::array<uint64_t, 4> src_cmd = localCmd(CoyoteOper::LOCAL_READ, src_sg, 0, src_sg.len, last);
+        std::array<uint64_t, 4> dst_cmd = localCmd(CoyoteOper::LOCAL_WRITE, dst_sg, 0, dst_sg.len, last);
+        pushCmd({dst_cmd[0], dst_cmd[1], src_cmd[2], src_cmd[3]});
+        drain();
+    }
+
+    /// Same as cThread::invoke(const localPrep&)
+    void invoke(const localPrep &prep) {
+        if (prep.src_sg.len > MAX_TRANSFER_SIZE || prep.dst_sg.len > MAX_TRANSFER_SIZE) {
+            cThread::invoke(prep);
+            return;
+        }
+
+        std::array<uint64_t, 4> cmd = prep.cmd;
+        cmd[1] |= prep.dst_sg.len << CTRL_LEN_OFFS;
+        cmd[3] |= prep.src_sg.len << CTRL_LEN_OFFS;
+        pushCmd(cmd);
+        drain();
+    }
+
+    /// Same as cThread::invoke(const localPrep&, uint64_t, uint64_t)
+    void invoke(const localPrep &prep, uint64_t offs, uint64_t len) {
+        if (len > MAX_TRANSFER_SIZE) {
+            cThread::invoke(prep, offs, len);
+            return;
+        }
+
+        std::array<uint64_t, 4> cmd = prep.cmd;
+        if (isLocalWrite(prep.oper)) {
+            cmd[0] += offs;
+            cmd[1] |= len << CTRL_LEN_OFFS;
+        }
+        if (isLocalRead(prep.oper)) {
+            cmd[2] += offs;
+            cmd[3] |= len << CTRL_LEN_OFFS;
+        }
+        pushCmd(cmd);
+        drain();
+    }
+
+    /// Same as cThread::checkCompleted(CoyoteOper); syncs and off-loads are forwarded to cThread
+    uint32_t checkCompleted(CoyoteOper coper) const {
+        // Same order as cThread::readCompleted(): writes before reads, since LOCAL_TRANSFER is both
+        if (isLocalSync(coper)) {
+            return cThread::checkCompleted(coper);
+        } else if (isLocalWrite(coper)) {
+            return readCounter<WR_WBACK, 1>(static_cast<uint32_t>(CnfgLegRegs::STAT_DMA_REG), true);
+        } else if (isLocalRead(coper)) {
+            return readCounter<RD_WBACK, 0>(static_cast<uint32_t>(CnfgLegRegs::STAT_DMA_REG), false);
+        } else if (isRemoteRead(coper)) {
+            return readCounter<RD_RDMA_WBACK, 2>(static_cast<uint32_t>(CnfgLegRegs::STAT_RDMA_REG), false);
+        } else if (isRemoteWriteOrSend(coper)) {
+            return readCounter<WR_RDMA_WBACK, 3>(static_cast<uint32_t>(CnfgLegRegs::STAT_RDMA_REG), true);
+        } else {
+            return 0;
+        }
+    }
+
+private:
+    /**
+     * @brief Reads a completion counter of this thread
+     *
+     * @tparam WBACK Writeback slot of the counter
+     * @tparam AVX_IDX 32-bit lane of the counter in the AVX status register
+     * @param leg_reg Legacy status register holding the counter
+     * @param leg_high Counter is in the upper 32 bits of the legacy register
+     */
+    template <int WBACK, int AVX_IDX>
+    uint32_t readCounter(uint32_t leg_reg, bool leg_high) const {
+        if constexpr (Traits::en_wb) {
+            return wback[ctid + WBACK * N_CTID_MAX];
+        } 
+        #ifdef EN_AVX
+        else if constexpr (Traits::en_avx) {
+            return _mm256_extract_epi32(cnfg_reg_avx[static_cast<uint32_t>(CnfgAvxRegs::STAT_DMA_REG) + ctid], AVX_IDX);
+        }
+        #endif
+        else {
+            return leg_high ? HIGH_32(cnfg_reg[leg_reg + ctid]) : LOW_32(cnfg_reg[leg_reg + ctid]);
+        }
+    }
+
+    /// Same as cThread::waitCmdCredits(), for the register layout of the traits
+    uint32_t credits() {
+        uint32_t &cmd_cnt = vfpga_ctx->cmd_ring.cmd_cnt;
+        while (cmd_cnt > (CMD_FIFO_DEPTH - CMD_FIFO_THR)) {
+            #ifdef EN_AVX
+            if constexpr (Traits::en_avx) {
+                cmd_cnt = LOW_32(_mm256_extract_epi32(cnfg_reg_avx[static_cast<uint32_t>(CnfgAvxRegs::CTRL_REG)], 0x0));
+            } else
+            #endif
+            {
+                cmd_cnt = cnfg_reg[static_cast<uint32_t>(CnfgLegRegs::CTRL_REG)];
+            }
+
+            if (cmd_cnt > (CMD_FIFO_DEPTH - CMD_FIFO_THR)) {
+                backOff();
+            }
+        }
+
+        return (CMD_FIFO_DEPTH - CMD_FIFO_THR) - cmd_cnt + 1;
+    }
+
+    /// Same as cThread::writeCmd(), for the register layout of the traits
+    void write(const std::array<uint64_t, 4> &cmd) {
+        #ifdef EN_AVX
+        if constexpr (Traits::en_avx) {
+            // Write-combining depends on the platform mapping, not the shell, so it is still checked at run-time
+            if (cnfg_reg_wc) {
+                cnfg_reg_wc[static_cast<uint32_t>(CnfgAvxRegs::CTRL_REG)] = _mm256_set_epi64x(cmd[0], cmd[1], cmd[2], cmd[3]);
+                _mm_sfence();
+            } else {
+                cnfg_reg_avx[static_cast<uint32_t>(CnfgAvxRegs::CTRL_REG)] = _mm256_set_epi64x(cmd[0], cmd[1], cmd[2], cmd[3]);
+            }
+        } else
+        #endif
+        {
+            cnfg_reg[static_cast<uint32_t>(CnfgLegRegs::VADDR_WR_REG)] = cmd[0];
+            cnfg_reg[static_cast<uint32_t>(CnfgLegRegs::CTRL_REG_2)] = cmd[1];
+            cnfg_reg[static_cast<uint32_t>(CnfgLegRegs::VADDR_RD_REG)] = cmd[2];
+            cnfg_reg[static_cast<uint32_t>(CnfgLegRegs::CTRL_REG)] = cmd[3];
+        }
+    }
+
+    /// Same as cThread::drainCmds(), using the specialized credit and write paths
+    void drain() {
+        while (vfpga_ctx->cmd_ring.tryAcquire()) {
+            std::array<uint64_t, 4> cmd;
+            bool pending = true;
+            while (pending) {
+                uint32_t n = credits();
+                for (uint32_t i = 0; i < n; i++) {
+                    if (!vfpga_ctx->cmd_ring.pop(cmd)) {
+                        pending = false;
+                        break;
+                    }
+                    write(cmd);
+                    vfpga_ctx->cmd_ring.cmd_cnt++;
+                }
+            }
+
+            if (!vfpga_ctx->cmd_ring.release()) {
+                break;
+            }
+        }
+    }
+};
+
+}
+
+#endif // _COYOTE_CTHREADT_HPP_
@@ -0,0 +1,166 @@
+/*
+ * This file is part of the Coyote <https://github.com/fpgasystems/Coyote>
+ *
+ * MIT Licence
+ * Copyright (c) 2025, Systems Group, ETH Zurich
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _COYOTE_CTIMER_HPP_
+#define _COYOTE_CTIMER_HPP_
+
+#include <chrono>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include <coyote/cDefs.hpp>
+
+namespace coyote {
+
+class cThread;
+
+/// @brief Time source of cBench
+enum class CoyoteTimer {
+    /// std::chrono::high_resolution_clock (default); portable, but a few tens of ns per reading
+    CHRONO = 0,
+
+    /// The CPU time-stamp counter, read with rdtscp and converted with the calibration of cTsc; a few ns per reading
+    TSC = 1
+};
+
+/**
+ * @brief Time-stamp counter (TSC) of the CPU, calibrated against the steady clock
+ *
+ * The counter is read with rdtscp followed by lfence, so a reading waits for the preceding instructions and is not 
+ * reordered with the following ones. The conversion to ns assumes an invariant TSC (constant rate, synchronised across 
+ * the cores), as on all recent x86 CPUs; see isInvariant(). On other architectures, the steady clock is used instead.
+ */
+class cTsc {
+
+public:
+    /// Reads the time-stamp counter, in ticks
+    static inline uint64_t now() {
+        #if defined(__x86_64__) || defined(__i386__)
+        unsigned int aux;
+        uint64_t ticks = __rdtscp(&aux);
+        _mm_lfence();
+        return ticks;
+        #else
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+        #endif
+    }
+
+    /// Returns the duration of a tick, in ns; calibrated on the first call, which takes TSC_CALIBRATION_TIME
+    static double getNsPerTick();
+
+    /// Converts a number of ticks to ns
+    static double toNs(uint64_t ticks) { return (double) ticks * getNsPerTick(); }
+
+    /// Returns true if the CPU reports an invariant TSC (CPUID leaf 0x80000007); virtual machines may not report it
+    static bool isInvariant();
+};
+
+/// @brief Split of the latency of a vFPGA operation issued by the host, in ns; see cFpgaClock::split()
+struct cLatencySplit {
+    /// Time for the host to issue the operation (e.g., invoke() or setCSR())
+    double submission;
+
+    /// Time until the vFPGA started the operation; the PCIe transfer and the queueing in the shell
+    double pcie_in;
+
+    /// Time taken by the vFPGA (its cycle counts, at the clock period)
+    double kernel;
+
+    /// Time until the host observed the completion (e.g., polling checkCompleted() or a CSR)
+    double pcie_out;
+};
+
+/**
+ * @brief Correlates the host TSC with a free-running cycle counter of a vFPGA, read through cThread::getCSR()
+ *
+ * A correlation reads the counter FPGA_CLOCK_SYNC_READS times, between two TSC readings each, and keeps the read with the 
+ * shortest round trip; the counter value is attributed to the middle of that round trip, so the error is at most half a round 
+ * trip (about half a PCIe read). Two correlations that are far apart in time give the actual clock period, see sync().
+ * The counter must be a 64-bit cycle counter; narrower counters must not wrap between the correlation and the conversions.
+ */
+class cFpgaClock {
+
+private:
+    /// Thread through which the counter is read, and the offset of the counter register
+    cThread &cthread;
+    uint32_t csr_offs;
+
+    /// Clock period of the vFPGA, in ns; nominal until the second sync()
+    double period;
+
+    /// First and last correlation: host TSC (at the middle of the read) and counter value
+    uint64_t first_tsc = { 0 }, first_cycles = { 0 };
+    uint64_t last_tsc = { 0 }, last_cycles = { 0 };
+
+    /// Shortest round trip of a counter read, in ns
+    double read_latency = { 0 };
+
+public:
+    /**
+     * @brief Default constructor; correlates the clocks once, with the nominal clock period
+     *
+     * @param cthread Coyote thread through which the counter is read
+     * @param csr_offs Offset of the cycle counter register of the vFPGA
+     * @param period Nominal clock period of the vFPGA, in ns
+     */
+    cFpgaClock(cThread &cthread, uint32_t csr_offs, double period = FPGA_CLOCK_PERIOD_NS);
+
+    /**
+     * @brief Correlates the clocks again; the clock period is then estimated from the first and this correlation, 
+     * which should be at least a second apart for an accurate estimate (e.g., one before and one after a benchmark)
+     */
+    void sync();
+
+    /// Converts a counter value to a host TSC value (in ticks), from the last correlation
+    uint64_t toTsc(uint64_t cycles) const;
+
+    /// Converts a host TSC value (in ticks) to a counter value, from the last correlation
+    uint64_t toCycles(uint64_t tsc) const;
+
+    /**
+     * @brief Splits the latency of an operation into submission, PCIe and kernel time
+     *
+     * @param tsc_issue Host TSC before issuing the operation
+     * @param tsc_issued Host TSC after issuing the operation
+     * @param cycles_start Counter value when the vFPGA started the operation (e.g., latched by the kernel into a CSR)
+     * @param cycles_end Counter value when the vFPGA completed the operation
+     * @param tsc_completed Host TSC when the completion was observed
+     */
+    cLatencySplit split(uint64_t tsc_issue, uint64_t tsc_issued, uint64_t cycles_start, uint64_t cycles_end, uint64_t tsc_completed) const;
+
+    /// Getter: Clock period of the vFPGA, in ns
+    double getPeriod() const { return period; }
+
+    /// Getter: Shortest round trip of a counter read (i.e., of a PCIe read of a CSR), in ns
+    double getReadLatency() const { return read_latency; }
+};
+
+}
+
+#endif // _COYOTE_CTIMER_HPP_
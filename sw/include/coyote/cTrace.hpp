@@ -0,0 +1,273 @@
+/*
+ * This file is part of the Coyote <https://github.com/fpgasystems/Coyote>
+ *
+ * MIT Licence
+ * Copyright (c) 2025, Systems Group, ETH Zurich
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _COYOTE_CTRACE_HPP_
+#define _COYOTE_CTRACE_HPP_
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <ostream>
+#include <functional>
+
+#include <coyote/cDefs.hpp>
+#include <coyote/cOps.hpp>
+#include <coyote/cBench.hpp>
+#include <coyote/cThread.hpp>
+
+namespace coyote {
+
+/// Kinds of trace events
+enum class CoyoteTraceKind: uint8_t {
+    BULK_H2D = 0,   ///< Standalone host-to-device transfer (e.g., data preload)
+    BULK_D2H = 1,   ///< Standalone device-to-host transfer (e.g., result readback)
+    BUNDLE = 2      ///< Host-to-device transfer, compute and device-to-host transfer, issued as one request
+};
+
+/// Number of trace event kinds
+constexpr unsigned int const N_TRACE_KINDS = 3;
+
+/// Magic number at the start of a trace file
+constexpr char const TRACE_MAGIC[8] = {'C', 'Y', 'T', 'T', 'R', 'A', 'C', 'E'};
+
+/// Version of the trace file format
+constexpr uint32_t const TRACE_VERSION = 1;
+
+/// Event flag: the event consumes the results of the previous events, so it is only issued once all of them completed
+constexpr uint8_t const TRACE_FLAG_DEPENDS = 0x1;
+
+/// File extension of traces, as picked up by cTrace::loadDir()
+constexpr char const TRACE_FILE_EXT[] = ".trace";
+
+/**
+ * @brief One event of a trace, exactly as stored in a trace file
+ *
+ * A trace file consists of a traceHeader, followed by header.n_events events; all fields are little-endian
+ */
+struct traceEvent {
+    CoyoteTraceKind kind;
+
+    /// Event flags (TRACE_FLAG_*)
+    uint8_t flags;
+    uint8_t reserved[2];
+
+    /// Number of raw events folded into this one, when the trace was recorded
+    uint32_t original_count;
+
+    /// Bytes transferred host-to-device (BULK_H2D, BUNDLE)
+    uint64_t h2d_size;
+
+    /// Bytes transferred device-to-host (BULK_D2H, BUNDLE)
+    uint64_t d2h_size;
+
+    /// Compute cycles between the two transfers (BUNDLE only)
+    uint64_t cycles;
+};
+static_assert(sizeof(traceEvent) == 32, "traceEvent must match the trace file layout");
+
+/// @brief Header of a trace file
+struct traceHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t n_events;
+};
+static_assert(sizeof(traceHeader) == 24, "traceHeader must match the trace file layout");
+
+/**
+ * @brief A recorded trace, memory-mapped from a trace file
+ *
+ * The events are not copied, so that large traces can be opened cheaply; the name of the trace is the stem of the file name.
+ * New traces can be added by dropping a file into a trace directory (see loadDir()), without recompiling the application.
+ */
+class cTrace {
+
+private:
+    std::string name;
+    void *map = { nullptr };
+    size_t map_size = { 0 };
+    const traceEvent *events = { nullptr };
+    uint64_t n_events = { 0 };
+
+public:
+    /**
+     * @brief Opens and maps a trace file
+     *
+     * @param path Path to the trace file
+     * @throws std::runtime_error if the file can't be opened or is not a valid trace
+     */
+    cTrace(const std::string &path);
+
+    /// Default destructor; unmaps the file
+    ~cTrace();
+
+    cTrace(const cTrace&) = delete;
+    cTrace& operator=(const cTrace&) = delete;
+    cTrace(cTrace &&other) noexcept;
+    cTrace& operator=(cTrace &&other) noexcept;
+
+    /// Returns the name of the trace
+    const std::string& getName() const { return name; }
+
+    /// Returns the number of events
+    uint64_t size() const { return n_events; }
+
+    /// Returns the i-th event
+    const traceEvent& operator[](uint64_t i) const { return events[i]; }
+
+    const traceEvent* begin() const { return events; }
+    const traceEvent* end() const { return events + n_events; }
+
+    /// Returns the largest transfer (in either direction) of any event, i.e., the buffer size needed to replay it unclamped
+    uint64_t getMaxBytes() const;
+
+    /**
+     * @brief Writes a trace file
+     *
+     * @param path Path to the trace file; overwritten, if it exists
+     * @param events Events of the trace
+     */
+    static void write(const std::string &path, const std::vector<traceEvent> &events);
+
+    /**
+     * @brief Opens all the traces (files ending in .trace) of a directory
+     *
+     * @param dir Trace directory
+     * @return Traces, sorted by name
+     */
+    static std::vector<cTrace> loadDir(const std::string &dir);
+};
+
+/// @brief Result of replaying a trace once; latencies are per event, in ns
+struct cTraceResult {
+    /// Name of the trace
+    std::string trace;
+
+    /// Number of replayed events, per kind (indexed by CoyoteTraceKind)
+    uint64_t n_events[N_TRACE_KINDS] = { 0 };
+
+    /// Sum of the event latencies, per kind, in ns
+    double kind_time[N_TRACE_KINDS] = { 0 };
+
+    /// Bytes moved in each direction, after clamping to the replay buffer
+    uint64_t h2d_bytes = { 0 };
+    uint64_t d2h_bytes = { 0 };
+
+    /// Compute cycles requested by the BUNDLE events
+    uint64_t cycles = { 0 };
+
+    /// Event latencies and wall-clock time of the replay
+    cBenchResult result;
+
+    /// Returns the throughput of the replay, in GB/s (10^9 bytes per second), counting both directions
+    double getGBps() const;
+};
+
+/**
+ * @brief Replays recorded traces on a vFPGA
+ *
+ * By default, the events are issued through cThread::invoke: BULK_H2D as LOCAL_READ, BULK_D2H as LOCAL_WRITE 
+ * and BUNDLE as LOCAL_TRANSFER, from and to one buffer in host memory. Up to depth requests are kept in flight; 
+ * with depth 1, every event waits for the previous one. The compute cycles of the BUNDLE events are up to the vFPGA 
+ * and are only reported. Events flagged with TRACE_FLAG_DEPENDS wait for all previous events, regardless of the depth.
+ *
+ * In pipelined mode, the buffer is split into two halves, used by alternate events; an event only waits for the previous 
+ * event on its half (and for all of them, if flagged as dependent), so that the host-to-device transfer of the next event 
+ * overlaps with the device-to-host transfer of the current one, while no buffer is overwritten by two requests in flight.
+ *
+ * vFPGAs which move the data themselves (e.g., driven by their own control registers) can instead set an executor, 
+ * which carries out one event synchronously; the replay then times each call of the executor. Set-up which should 
+ * not be timed (e.g., benchmark-only registers) can be done in an optional prepare function, called before the executor.
+ */
+class cTraceReplay {
+
+public:
+    /**
+     * @brief Carries out one event, returning once it completed
+     *
+     * @param idx Index of the event in the trace
+     * @param event The event, as recorded
+     * @param h2d_size Host-to-device bytes, clamped to the replay buffer (see clampSize())
+     * @param d2h_size Device-to-host bytes, clamped to the replay buffer
+     */
+    typedef std::function<void(uint64_t idx, const traceEvent &event, uint64_t h2d_size, uint64_t d2h_size)> executor_t;
+
+private:
+    cThread *cthread;
+    void *mem;
+    uint64_t mem_size;
+    unsigned int depth;
+    bool pipelined = { false };
+    executor_t executor;
+    executor_t prepare;
+
+    /// Returns the size of the buffer available to one event; half of it in pipelined mode
+    uint64_t slotSize() const;
+
+    /// Replays the trace through cThread::invoke, keeping up to depth requests (or two, in pipelined mode) in flight
+    void replayInvoke(const cTrace &trace, cTraceResult &res);
+
+    /// Replays the trace through the executor, one event at a time
+    void replayExecutor(const cTrace &trace, cTraceResult &res);
+
+public:
+    /**
+     * @brief Default constructor
+     *
+     * @param cthread cThread on which the events are issued; must outlive the replay
+     * @param mem Buffer the events transfer from and to, e.g., obtained from cThread::getMem()
+     * @param mem_size Size of the buffer, in bytes; larger transfers are clamped
+     * @param depth Maximum number of outstanding requests (invoke only)
+     */
+    cTraceReplay(cThread *cthread, void *mem, uint64_t mem_size, unsigned int depth = 1);
+
+    /// Sets the maximum number of outstanding requests
+    void setDepth(unsigned int depth);
+
+    /// Enables or disables the pipelined (double-buffered) mode; invoke only, since executors are synchronous
+    void setPipelined(bool pipelined);
+
+    /// Replaces the invoke-based replay with an executor and an (untimed) prepare function; an empty executor restores the default
+    void setExecutor(executor_t executor, executor_t prepare = nullptr);
+
+    /**
+     * @brief Clamps a transfer to the replay buffer
+     *
+     * Zero stays zero, so that the corresponding phase is skipped; other sizes are rounded up to a cache line 
+     * (a non-aligned length desyncs the 512-bit data streams) and capped at the buffer size (half of it, in pipelined mode)
+     */
+    uint64_t clampSize(uint64_t size) const;
+
+    /// Replays a trace once and returns its result
+    cTraceResult replay(const cTrace &trace);
+
+    /// Writes results as CSV, one row per result; header adds a row with the column names
+    static void writeCsv(std::ostream &out, const std::vector<cTraceResult> &results, bool header = true);
+};
+
+}
+
+#endif // _COYOTE_CTRACE_HPP_
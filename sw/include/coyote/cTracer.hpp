@@ -0,0 +1,187 @@
+/*
+ * This file is part of the Coyote <https://github.com/fpgasystems/Coyote>
+ *
+ * MIT Licence
+ * Copyright (c) 2025, Systems Group, ETH Zurich
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _COYOTE_CTRACER_HPP_
+#define _COYOTE_CTRACER_HPP_
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <cstdint>
+
+#include <coyote/cDefs.hpp>
+
+namespace coyote {
+
+/// @brief Event recorded by cTracer; the strings must outlive the tracer (e.g., string literals)
+struct cTraceEvent {
+    /// Start of the event, in ns (steady clock)
+    uint64_t ts;
+
+    /// Duration, in ns; complete events ('X') only
+    uint64_t dur;
+
+    /// Category and name, as shown in the trace viewer
+    const char *cat;
+    const char *name;
+
+    /// Up to two named arguments; unused arguments have a null name
+    const char *arg_names[2];
+    uint64_t args[2];
+
+    /// Counter events ('C'): separates the tracks of counters with the same name, e.g., the Coyote thread ID
+    uint64_t id;
+
+    /// Phase, as in the Chrome trace format: 'X' (complete), 'i' (instant) or 'C' (counter)
+    char ph;
+};
+
+/**
+ * @brief Low-overhead event tracing for cThread, cSched and cRcnfg, exported in the Chrome trace (JSON) format
+ *
+ * Each thread records into its own ring of TRACE_RING_EVENTS events, without locks, so tracing can stay on for
+ * production-like runs; once a ring is full, its oldest events are overwritten. While tracing is disabled, the
+ * instrumentation costs a single relaxed load. The trace can be dumped at any point, also while tracing, and opened
+ * in Perfetto (ui.perfetto.dev) or chrome://tracing.
+ *
+ * Tracing is enabled with enable() or, without changing the application, by setting COYOTE_TRACE=<path>; the trace
+ * is then dumped to the path when the process exits.
+ *
+ * Recorded events:
+ *  - cThread: invocations (with the time spent submitting them), stalls on command FIFO credits, blocking waits for
+ *             completions, and the completion counters reached by those waits, as counter tracks
+ *  - cRcnfg:  reconfigurations, synchronous and asynchronous
+ *  - cSched:  task executions and bitstream loads
+ */
+class cTracer {
+
+private:
+    /// Whether events are recorded
+    static std::atomic<bool> active;
+
+    /// Appends an event to the ring of the calling thread
+    static void record(const cTraceEvent &event);
+
+public:
+    /**
+     * @brief Starts recording events
+     *
+     * @param events_per_thread Capacity of the ring of each thread, rounded up to a power of two; only applies to
+     *                          threads which have not recorded an event yet
+     */
+    static void enable(size_t events_per_thread = TRACE_RING_EVENTS);
+
+    /// Stops recording events; the recorded events are kept until clear()
+    static void disable();
+
+    /// Whether events are recorded
+    static bool enabled() { return active.load(std::memory_order_relaxed); }
+
+    /// Discards all the recorded events
+    static void clear();
+
+    /**
+     * @brief Writes the recorded events of all threads to a file, in the Chrome trace (JSON) format
+     *
+     * Can be called while tracing; events which are overwritten while being written out are skipped
+     *
+     * @param path Output file
+     * @return Number of events written
+     */
+    static size_t dump(const std::string &path);
+
+    /// Current time, in ns, on the clock of the events
+    static uint64_t now() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    /// Records a complete event (a slice) from begin to end, in ns; see now()
+    static void complete(
+        const char *cat, const char *name, uint64_t begin, uint64_t end,
+        const char *arg0_name = nullptr, uint64_t arg0 = 0, const char *arg1_name = nullptr, uint64_t arg1 = 0
+    ) {
+        if (enabled()) {
+            record({begin, end > begin ? end - begin : 0, cat, name, {arg0_name, arg1_name}, {arg0, arg1}, 0, 'X'});
+        }
+    }
+
+    /// Records an instant event
+    static void instant(
+        const char *cat, const char *name,
+        const char *arg0_name = nullptr, uint64_t arg0 = 0, const char *arg1_name = nullptr, uint64_t arg1 = 0
+    ) {
+        if (enabled()) {
+            record({now(), 0, cat, name, {arg0_name, arg1_name}, {arg0, arg1}, 0, 'i'});
+        }
+    }
+
+    /// Records the new value of a counter; id separates the tracks of counters with the same name
+    static void counter(const char *cat, const char *name, uint64_t id, uint64_t value) {
+        if (enabled()) {
+            record({now(), 0, cat, name, {"value", nullptr}, {value, 0}, id, 'C'});
+        }
+    }
+
+};
+
+/**
+ * @brief Records a complete event for its scope, e.g., a function call
+ *
+ * The start time is only taken when tracing is enabled at construction; the arguments can be set (or updated) until
+ * the end of the scope
+ */
+class cTraceScope {
+
+private:
+    const char *cat;
+    const char *name;
+    const char *arg_names[2];
+    uint64_t args[2];
+    uint64_t begin;
+
+public:
+    cTraceScope(
+        const char *cat, const char *name,
+        const char *arg0_name = nullptr, uint64_t arg0 = 0, const char *arg1_name = nullptr, uint64_t arg1 = 0
+    ) : cat(cat), name(name), arg_names{arg0_name, arg1_name}, args{arg0, arg1}, begin(cTracer::enabled() ? cTracer::now() : 0) {}
+
+    ~cTraceScope() {
+        if (begin) {
+            cTracer::complete(cat, name, begin, cTracer::now(), arg_names[0], args[0], arg_names[1], args[1]);
+        }
+    }
+
+    cTraceScope(const cTraceScope&) = delete;
+    cTraceScope& operator=(const cTraceScope&) = delete;
+
+    /// Sets an argument (0 or 1) of the event
+    void setArg(int idx, const char *arg_name, uint64_t value) { arg_names[idx] = arg_name; args[idx] = value; }
+
+};
+
+}
+
+#endif // _COYOTE_CTRACER_HPP_
@@ -0,0 +1,155 @@
+/*
+ * This file is part of the Coyote <https://github.com/fpgasystems/Coyote>
+ *
+ * MIT Licence
+ * Copyright (c) 2025, Systems Group, ETH Zurich
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _COYOTE_CTUNER_HPP_
+#define _COYOTE_CTUNER_HPP_
+
+#include <map>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <ostream>
+
+#include <coyote/cOps.hpp>
+#include <coyote/cThread.hpp>
+
+namespace coyote {
+
+/// Environment variable with the path of the tuning profile read by the streaming APIs (see cTuneProfile::getDefault())
+#define TUNE_PROFILE_ENV "COYOTE_TUNE_PROFILE"
+
+/// @brief Best parameters of an operation class, as found by cTuner
+struct cTuneEntry {
+    /// Size of each operation, in bytes (e.g., the chunk size of a stream)
+    uint64_t chunk_size = { 0 };
+
+    /// Number of operations in flight
+    uint32_t depth = { 0 };
+
+    /// Type of the buffers
+    CoyoteAllocType alloc = { CoyoteAllocType::REG };
+
+    /// Throughput measured with these parameters, in GB/s
+    double gbps = { 0 };
+};
+
+/**
+ * @brief Tuned parameters of a shell, per operation class (LOCAL_READ, LOCAL_WRITE, LOCAL_TRANSFER)
+ *
+ * Stored as a text file, one line per operation class: <operation> <chunk size> <depth> <allocation type> <GB/s>; 
+ * lines starting with # are comments. The profile is specific to the shell and the host it was measured on.
+ */
+class cTuneProfile {
+
+private:
+    std::map<CoyoteOper, cTuneEntry> entries;
+
+public:
+    /// Returns true if the profile holds parameters for the operation class
+    bool has(CoyoteOper oper) const { return entries.count(oper); }
+
+    /// Returns the parameters of an operation class; throws std::runtime_error if there are none
+    const cTuneEntry& get(CoyoteOper oper) const;
+
+    /// Sets the parameters of an operation class
+    void set(CoyoteOper oper, const cTuneEntry &entry) { entries[oper] = entry; }
+
+    /// Writes the profile to a file; throws std::runtime_error on failure
+    void save(const std::string &path) const;
+
+    /// Reads a profile from a file; throws std::runtime_error if the file can't be read or is malformed
+    static cTuneProfile load(const std::string &path);
+
+    /**
+     * @brief Returns the profile of the process, read once from the file in TUNE_PROFILE_ENV
+     *
+     * Empty if the variable isn't set, or the file can't be read (with a warning); the streaming APIs (cStream, 
+     * cStorageStream) then use their built-in defaults
+     */
+    static const cTuneProfile& getDefault();
+};
+
+/// @brief Parameters swept by cTuner::tune()
+struct cTuneOptions {
+    /// Operation classes to tune; LOCAL_READ needs a vFPGA which consumes its input, LOCAL_WRITE one which produces output
+    /// and LOCAL_TRANSFER one which loops its input back (e.g., perf_local of examples/01_hello_world)
+    std::vector<CoyoteOper> opers = { CoyoteOper::LOCAL_TRANSFER };
+
+    /// Candidate sizes of each operation, in bytes
+    std::vector<uint64_t> chunk_sizes = { 4 * 1024, 16 * 1024, 64 * 1024, 256 * 1024, 1024 * 1024, 4 * 1024 * 1024 };
+
+    /// Candidate numbers of operations in flight
+    std::vector<uint32_t> depths = { 1, 2, 4, 8, 16 };
+
+    /// Candidate buffer types; types which can't be allocated on the host (e.g., HPF without reserved huge pages) are skipped
+    std::vector<CoyoteAllocType> allocs = { CoyoteAllocType::REG, CoyoteAllocType::THP, CoyoteAllocType::HPF };
+
+    /// Bytes moved by each measurement; the buffers are of this size
+    uint64_t bytes = { 64 * 1024 * 1024 };
+
+    /// Measurements (and warm-ups) per candidate, see cBench
+    unsigned int n_runs = { 5 };
+    unsigned int n_warmups = { 1 };
+
+    /// Target AXI4 destination stream in the vFPGA
+    uint32_t dest = { 0 };
+};
+
+/**
+ * @brief Finds the chunk size, depth and allocation type with the highest throughput, by short cBench sweeps on the deployed shell
+ *
+ * Every combination of the candidates is measured: the buffers are allocated with the candidate type, and the bytes 
+ * of a measurement are moved in operations of the candidate size, with up to depth of them in flight.
+ *
+ * @note The sweeps rely on the cThread's local completion counters, so nothing else should run on the cThread meanwhile
+ */
+class cTuner {
+
+public:
+    /**
+     * @brief Measures the throughput of one candidate
+     *
+     * @param cthread Coyote thread of the vFPGA
+     * @param oper Operation class
+     * @param candidate Chunk size, depth and allocation type to be measured (gbps is ignored)
+     * @param options Bytes per measurement, number of runs and destination stream
+     * @return Throughput, in GB/s; 0 if the buffers couldn't be allocated
+     */
+    static double measure(cThread &cthread, CoyoteOper oper, const cTuneEntry &candidate, const cTuneOptions &options);
+
+    /**
+     * @brief Sweeps all the candidates of each operation class and returns the best ones
+     *
+     * @param cthread Coyote thread of the vFPGA
+     * @param options Candidates and operation classes
+     * @param log If not null, every measurement is written to it
+     */
+    static cTuneProfile tune(cThread &cthread, const cTuneOptions &options = cTuneOptions(), std::ostream *log = nullptr);
+};
+
+}
+
+#endif // _COYOTE_CTUNER_HPP_
@@ -0,0 +1,144 @@
+/*
+ * This file is part of the Coyote <https://github.com/fpgasystems/Coyote>
+ *
+ * MIT Licence
+ * Copyright (c) 2025, Systems Group, ETH Zurich
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _COYOTE_CVFPGA_PIPELINE_HPP_
+#define _COYOTE_CVFPGA_PIPELINE_HPP_
+
+#include <atomic>
+#include <thread>
+#include <cstdint>
+
+#include <coyote/cOps.hpp>
+#include <coyote/cThread.hpp>
+
+namespace coyote {
+
+/// Default number of slots of the ring buffer of a vFPGA pipeline
+#define VFPGA_PIPELINE_DEFAULT_SLOTS 8
+
+/**
+ * @brief vFPGA -> vFPGA streaming pipeline, through a ring buffer in card memory
+ *
+ * Connects the card output stream of one vFPGA (the producer, axis_card_send[src_dest]) to the card input stream 
+ * of another vFPGA (the consumer, axis_card_recv[dst_dest]). The ring buffer is allocated in card memory by the producer 
+ * and attached by the consumer (shareCardMem() and attachCardMem()), so the data never leaves the card.
+ *
+ * Each item, of slot_size bytes, goes through one slot: a LOCAL_WRITE by the producer fills it and a LOCAL_READ by the consumer
+ * drains it. Flow control is credit-based, on the completion counters of the two cThreads: a slot is handed to the consumer
+ * once the producer's write completed and back to the producer once the consumer's read completed. The counters are written back
+ * by the shell, so moving the credits does not read any registers; progress() only issues commands as credits become available.
+ * Once started, the pipeline runs on its own thread, so the application configures it once and only waits for it to complete.
+ *
+ * @note The pipeline owns the LOCAL_WRITE completions of the producer and the LOCAL_READ completions of the consumer: no other 
+ *       local operations should be issued on the two cThreads, nor their counters cleared, while the pipeline is running
+ * @note The producer must emit exactly slot_size bytes per item (the last beat with tlast), and the consumer must accept them
+ */
+class cVfpgaPipeline {
+
+public:
+    /**
+     * @brief Default constructor; allocates the ring buffer in card memory and maps it to both vFPGAs
+     *
+     * @param producer Coyote thread of the vFPGA producing the items; must outlive the pipeline
+     * @param consumer Coyote thread of the vFPGA consuming the items; must outlive the pipeline, and be on the same card as the producer
+     * @param slot_size Size of each item, in bytes
+     * @param n_slots Number of slots of the ring buffer, i.e., the maximum number of items between the two vFPGAs
+     * @param src_dest Card stream of the producer (axis_card_send[src_dest])
+     * @param dst_dest Card stream of the consumer (axis_card_recv[dst_dest])
+     */
+    cVfpgaPipeline(
+        cThread &producer, cThread &consumer, uint64_t slot_size, uint32_t n_slots = VFPGA_PIPELINE_DEFAULT_SLOTS,
+        uint32_t src_dest = 0, uint32_t dst_dest = 0
+    );
+
+    /// Destructor; stops the pipeline, waiting for the commands in flight, and releases the ring buffer
+    ~cVfpgaPipeline();
+
+    cVfpgaPipeline(const cVfpgaPipeline &) = delete;
+    cVfpgaPipeline& operator=(const cVfpgaPipeline &) = delete;
+
+    /**
+     * @brief Starts streaming n_items items on the pipeline's own thread
+     *
+     * @param n_items Number of items to stream; 0 streams until stop() is called
+     */
+    void start(uint64_t n_items = 0);
+
+    /// Stops the pipeline's thread; no further commands are issued, but the ones in flight are not cancelled
+    void stop();
+
+    /// Waits until all the items passed to start() were consumed; must not be called for unbounded pipelines
+    void wait();
+
+    /**
+     * @brief Issues the commands for which credits became available, without blocking; for pipelines driven by the application
+     *
+     * @param n_items Number of items to stream in total; 0 for an unbounded pipeline
+     * @return Number of items which were consumed in this call
+     */
+    uint32_t progress(uint64_t n_items = 0);
+
+    /// Returns the number of items written to the ring buffer by the producer
+    uint64_t getProduced() const { return wr_done.load(std::memory_order_relaxed); }
+
+    /// Returns the number of items read from the ring buffer by the consumer
+    uint64_t getConsumed() const { return rd_done.load(std::memory_order_relaxed); }
+
+    /// Returns the address of the ring buffer on the producer's side; slot i starts at i * slot_size
+    void* getRing() const { return src_ring; }
+
+private:
+    /// Coyote threads of the two vFPGAs
+    cThread &producer, &consumer;
+
+    /// Size of each slot, in bytes, and the number of slots
+    uint64_t slot_size;
+    uint32_t n_slots;
+
+    /// Card streams of the producer and the consumer
+    uint32_t src_dest, dst_dest;
+
+    /// Ring buffer, as mapped by the producer and by the consumer
+    void *src_ring = { nullptr }, *dst_ring = { nullptr };
+
+    /// Producer LOCAL_WRITE and consumer LOCAL_READ completions when the pipeline was created; counts are relative to them
+    uint32_t wr_base, rd_base;
+
+    /// Writes and reads issued, and completed
+    uint64_t wr_issued = { 0 }, rd_issued = { 0 };
+    std::atomic<uint64_t> wr_done = { 0 }, rd_done = { 0 };
+
+    /// Thread driving the pipeline, see start()
+    std::thread runner;
+    std::atomic<bool> running = { false };
+
+    /// Returns slot of the n-th item
+    void* slot(void *ring, uint64_t n) const { return static_cast<char*>(ring) + (n % n_slots) * slot_size; }
+};
+
+}
+
+#endif // _COYOTE_CVFPGA_PIPELINE_HPP_
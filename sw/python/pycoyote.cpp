@@ -0,0 +1,341 @@
+/*
+ * This file is part of the Coyote <https://github.com/fpgasystems/Coyote>
+ *
+ * MIT Licence
+ * Copyright (c) 2025, Systems Group, ETH Zurich
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// Python bindings of the Coyote software; built as the coyote module when the library is configured with EN_PYTHON
+
+#include <mutex>
+#include <iostream>
+#include <exception>
+#include <functional>
+#include <unistd.h>
+
+#include <pybind11/pybind11.h>
+#include <pybind11/stl.h>
+#include <pybind11/chrono.h>
+
+#include <coyote/cThread.hpp>
+#include <coyote/cBench.hpp>
+
+namespace py = pybind11;
+using namespace coyote;
+
+namespace {
+
+/**
+ * @brief Memory allocated by a cThread with getMem(), exported to Python through the buffer protocol
+ *
+ * The memory is released once the buffer and all the views of it (e.g., NumPy arrays created with numpy.frombuffer()) are gone;
+ * card-only and peer memory can't be accessed by the CPU, so it can only be passed to invoke()
+ */
+class pyBuffer {
+
+public:
+    pyBuffer(cThread *thread, void *mem, uint64_t size, CoyoteAllocType type) : thread(thread), mem(mem), size(size), type(type) {}
+
+    ~pyBuffer() {
+        try {
+            thread->freeMem(mem);
+        } catch (const std::exception &e) {
+            std::cerr << "WARNING: failed to release Coyote buffer: " << e.what() << std::endl;
+        }
+    }
+
+    pyBuffer(const pyBuffer&) = delete;
+    pyBuffer& operator=(const pyBuffer&) = delete;
+
+    bool hostAccessible() const { return type != CoyoteAllocType::CARD && type != CoyoteAllocType::PEER && type != CoyoteAllocType::GPU; }
+
+    cThread *thread;
+    void *mem;
+    uint64_t size;
+    CoyoteAllocType type;
+};
+
+/// Contiguous memory of a Python object (a pyBuffer or any object supporting the buffer protocol); the object must outlive the range
+struct pyRange {
+    void *addr = { nullptr };
+    uint64_t len = { 0 };
+};
+
+pyRange getRange(const py::object &obj, bool writable) {
+    if (py::isinstance<pyBuffer>(obj)) {
+        const pyBuffer &buff = obj.cast<const pyBuffer&>();
+        return { buff.mem, buff.size };
+    }
+
+    py::buffer_info info = py::reinterpret_borrow<py::buffer>(obj).request(writable);
+
+    // Only C-contiguous buffers map onto a single range of memory
+    py::ssize_t stride = info.itemsize;
+    for (py::ssize_t i = info.ndim - 1; i >= 0; i--) {
+        if (info.shape[i] > 1 && info.strides[i] != stride) {
+            throw py::value_error("Coyote buffers must be C-contiguous");
+        }
+        stride *= info.shape[i];
+    }
+
+    return { info.ptr, static_cast<uint64_t>(info.size * info.itemsize) };
+}
+
+}
+
+PYBIND11_MODULE(coyote, m) {
+    m.doc() = "Python bindings of the Coyote software; buffers are exchanged through the buffer protocol, without copies";
+
+    m.attr("STRM_CARD") = STRM_CARD;
+    m.attr("STRM_HOST") = STRM_HOST;
+
+    py::enum_<CoyoteOper>(m, "CoyoteOper")
+        .value("NOOP", CoyoteOper::NOOP)
+        .value("LOCAL_READ", CoyoteOper::LOCAL_READ)
+        .value("LOCAL_WRITE", CoyoteOper::LOCAL_WRITE)
+        .value("LOCAL_TRANSFER", CoyoteOper::LOCAL_TRANSFER)
+        .value("LOCAL_OFFLOAD", CoyoteOper::LOCAL_OFFLOAD)
+        .value("LOCAL_SYNC", CoyoteOper::LOCAL_SYNC)
+        .value("REMOTE_RDMA_READ", CoyoteOper::REMOTE_RDMA_READ)
+        .value("REMOTE_RDMA_WRITE", CoyoteOper::REMOTE_RDMA_WRITE)
+        .value("REMOTE_RDMA_SEND", CoyoteOper::REMOTE_RDMA_SEND)
+        .value("REMOTE_TCP_SEND", CoyoteOper::REMOTE_TCP_SEND)
+        .value("LOCAL_CARD_COPY", CoyoteOper::LOCAL_CARD_COPY);
+
+    py::enum_<CoyoteAllocType>(m, "CoyoteAllocType")
+        .value("REG", CoyoteAllocType::REG)
+        .value("THP", CoyoteAllocType::THP)
+        .value("HPF", CoyoteAllocType::HPF)
+        .value("PRM", CoyoteAllocType::PRM)
+        .value("HPF_1G", CoyoteAllocType::HPF_1G)
+        .value("CARD", CoyoteAllocType::CARD)
+        .value("AUTO", CoyoteAllocType::AUTO);
+
+    py::enum_<CoyoteAccess>(m, "CoyoteAccess")
+        .value("READ_WRITE", CoyoteAccess::READ_WRITE)
+        .value("READ_ONLY", CoyoteAccess::READ_ONLY)
+        .value("WRITE_ONLY", CoyoteAccess::WRITE_ONLY);
+
+    py::enum_<CoyoteTimer>(m, "CoyoteTimer")
+        .value("CHRONO", CoyoteTimer::CHRONO)
+        .value("TSC", CoyoteTimer::TSC);
+
+    py::class_<pyBuffer>(m, "Buffer", py::buffer_protocol())
+        .def_buffer([](pyBuffer &buff) -> py::buffer_info {
+            if (!buff.hostAccessible()) {
+                throw py::buffer_error("Coyote buffer is not accessible by the CPU");
+            }
+            return py::buffer_info(
+                buff.mem, sizeof(uint8_t), py::format_descriptor<uint8_t>::format(), 1, 
+                { static_cast<py::ssize_t>(buff.size) }, { static_cast<py::ssize_t>(sizeof(uint8_t)) }
+            );
+        })
+        .def("__len__", [](const pyBuffer &buff) { return buff.size; })
+        .def_property_readonly("addr", [](const pyBuffer &buff) { return reinterpret_cast<uint64_t>(buff.mem); })
+        .def_property_readonly("type", [](const pyBuffer &buff) { return buff.type; });
+
+    // Buffers keep their cThread alive (keep_alive), so the cThread is always destroyed after its buffers are released;
+    // hpid defaults to the calling process, evaluated on construction so that forked processes use their own PID
+    py::class_<cThread>(m, "cThread")
+        .def(py::init([](int32_t vfid, pid_t hpid, uint32_t device, py::object uisr) {
+            std::function<void(int)> handler = nullptr;
+            if (!uisr.is_none()) {
+                // User interrupts are handled on the cThread's interrupt thread, which must hold the GIL to call into Python
+                py::function func = uisr.cast<py::function>();
+                handler = [func](int value) {
+                    py::gil_scoped_acquire gil;
+                    func(value);
+                };
+            }
+            return new cThread(vfid, hpid ? hpid : getpid(), device, handler);
+        }), py::arg("vfid"), py::arg("hpid") = 0, py::arg("device") = 0, py::arg("uisr") = py::none())
+
+        .def("getMem", [](cThread &thread, CoyoteAllocType type, uint64_t size, int32_t mem_block, uint32_t mem_stripe, int32_t numa_node) {
+            CoyoteAlloc alloc;
+            alloc.alloc = type;
+            alloc.size = size;
+            alloc.mem_block = mem_block;
+            alloc.mem_stripe = mem_stripe;
+            alloc.numa_node = numa_node;
+
+            void *mem;
+            {
+                py::gil_scoped_release release;
+                mem = thread.getMem(std::move(alloc));
+            }
+            if (!mem) {
+                throw std::runtime_error("ERROR: cThread::getMem() failed");
+            }
+            // AUTO allocations record the obtained backing
+            return new pyBuffer(&thread, mem, size, thread.getAlloc(mem)->alloc);
+        }, py::arg("type"), py::arg("size"), py::arg("mem_block") = -1, py::arg("mem_stripe") = 1, py::arg("numa_node") = NUMA_NODE_NONE, 
+           py::keep_alive<0, 1>())
+
+        .def("reserveHugePages", [](cThread &thread, uint64_t size, int32_t numa_node) {
+            py::gil_scoped_release release;
+            thread.reserveHugePages(size, numa_node);
+        }, py::arg("size"), py::arg("numa_node") = NUMA_NODE_NONE)
+
+        .def("userMap", [](cThread &thread, py::object buff, bool resident, CoyoteAccess access) {
+            pyRange range = getRange(buff, false);
+            py::gil_scoped_release release;
+            thread.userMap(range.addr, range.len, -1, 1, resident, access);
+        }, py::arg("buff"), py::arg("resident") = false, py::arg("access") = CoyoteAccess::READ_WRITE)
+
+        .def("userUnmap", [](cThread &thread, py::object buff) {
+            pyRange range = getRange(buff, false);
+            py::gil_scoped_release release;
+            thread.userUnmap(range.addr);
+        }, py::arg("buff"))
+
+        .def("isMapped", [](const cThread &thread, py::object buff) {
+            pyRange range = getRange(buff, false);
+            return thread.isMapped(range.addr, range.len);
+        }, py::arg("buff"))
+
+        .def("setAutoRegister", &cThread::setAutoRegister, py::arg("enable"))
+
+        // One-sided local operations and syncs/off-loads; registered first, so that a buffer as the third argument selects the two-sided overload
+        .def("invoke", [](cThread &thread, CoyoteOper oper, py::object buff, uint32_t stream, uint32_t dest, bool last) {
+            pyRange range = getRange(buff, oper == CoyoteOper::LOCAL_WRITE);
+            py::gil_scoped_release release;
+            if (isLocalSync(oper)) {
+                syncSg sg;
+                sg.addr = range.addr;
+                sg.len = range.len;
+                thread.invoke(oper, sg);
+            } else {
+                localSg sg;
+                sg.addr = range.addr;
+                sg.len = range.len;
+                sg.stream = stream;
+                sg.dest = dest;
+                thread.invoke(oper, sg, last);
+            }
+        }, py::arg("oper"), py::arg("buff"), py::arg("stream") = STRM_HOST, py::arg("dest") = 0, py::arg("last") = true)
+
+        .def("invoke", [](cThread &thread, CoyoteOper oper, py::object src, py::object dst, uint32_t src_stream, uint32_t dst_stream, uint32_t dest, bool last) {
+            pyRange src_range = getRange(src, false);
+            pyRange dst_range = getRange(dst, true);
+            py::gil_scoped_release release;
+            localSg src_sg, dst_sg;
+            src_sg.addr = src_range.addr;
+            src_sg.len = src_range.len;
+            src_sg.stream = src_stream;
+            src_sg.dest = dest;
+            dst_sg.addr = dst_range.addr;
+            dst_sg.len = dst_range.len;
+            dst_sg.stream = dst_stream;
+            dst_sg.dest = dest;
+            thread.invoke(oper, src_sg, dst_sg, last);
+        }, py::arg("oper"), py::arg("src"), py::arg("dst"), py::arg("src_stream") = STRM_HOST, py::arg("dst_stream") = STRM_HOST, 
+           py::arg("dest") = 0, py::arg("last") = true)
+
+        .def("checkCompleted", [](const cThread &thread, CoyoteOper oper, uint32_t qp) {
+            return thread.checkCompleted(oper, qp);
+        }, py::arg("oper"), py::arg("qp") = 0)
+
+        .def("waitCompleted", &cThread::waitCompleted, py::arg("oper"), py::arg("target"), 
+             py::arg("timeout") = std::chrono::nanoseconds(-1), py::arg("spin") = WAIT_SPIN_TIME, py::call_guard<py::gil_scoped_release>())
+
+        .def("clearCompleted", &cThread::clearCompleted)
+        .def("setCSR", &cThread::setCSR, py::arg("val"), py::arg("offs"))
+        .def("getCSR", &cThread::getCSR, py::arg("offs"))
+        .def("lock", &cThread::lock, py::call_guard<py::gil_scoped_release>())
+        .def("unlock", &cThread::unlock)
+        .def("getCtid", &cThread::getCtid)
+        .def("getHpid", &cThread::getHpid)
+        .def("printDebug", &cThread::printDebug);
+
+    py::class_<cBenchLoad>(m, "cBenchLoad")
+        .def(py::init<>())
+        .def_readwrite("n_threads", &cBenchLoad::n_threads)
+        .def_readwrite("duration", &cBenchLoad::duration)
+        .def_readwrite("rate", &cBenchLoad::rate)
+        .def_readwrite("bytes_per_op", &cBenchLoad::bytes_per_op)
+        .def_readwrite("thread_bytes_per_op", &cBenchLoad::thread_bytes_per_op)
+        .def_readwrite("cpus", &cBenchLoad::cpus);
+
+    py::class_<cBenchResult>(m, "cBenchResult")
+        .def("getOps", &cBenchResult::getOps)
+        .def("getElapsed", &cBenchResult::getElapsed)
+        .def("getOpsPerSec", &cBenchResult::getOpsPerSec)
+        .def("getGBps", &cBenchResult::getGBps)
+        .def("getAvg", &cBenchResult::getAvg)
+        .def("getMin", &cBenchResult::getMin)
+        .def("getMax", &cBenchResult::getMax)
+        .def("getPercentile", &cBenchResult::getPercentile, py::arg("p"));
+
+    py::class_<cBench>(m, "cBench")
+        .def(py::init<unsigned int, unsigned int, bool>(), py::arg("n_runs") = 1000, py::arg("n_warmups") = 100, py::arg("keep_samples") = true)
+
+        // The benchmarked functions run on the calling thread, holding the GIL; the cThread calls inside them release it
+        .def("execute", [](cBench &bench, py::function bench_func, py::object prep_func) {
+            if (prep_func.is_none()) {
+                bench.execute([&]() { bench_func(); }, []() {});
+            } else {
+                bench.execute([&]() { bench_func(); }, [&]() { prep_func(); });
+            }
+        }, py::arg("bench_func"), py::arg("prep_func") = py::none())
+
+        // Each load thread takes the GIL to call into Python; the first error stops nothing, but is re-raised after the run
+        .def("run", [](cBench &bench, const cBenchLoad &load, py::function bench_func, py::object prep_func) {
+            std::exception_ptr error;
+            std::mutex error_lock;
+            auto call = [&](const py::object &func, unsigned int tid) {
+                py::gil_scoped_acquire gil;
+                try {
+                    func(tid);
+                } catch (...) {
+                    std::lock_guard<std::mutex> guard(error_lock);
+                    if (!error) {
+                        error = std::current_exception();
+                    }
+                }
+            };
+
+            {
+                py::gil_scoped_release release;
+                bench.run(
+                    load,
+                    [&](unsigned int tid) { call(bench_func, tid); },
+                    [&](unsigned int tid) { if (!prep_func.is_none()) call(prep_func, tid); }
+                );
+            }
+
+            if (error) {
+                std::rethrow_exception(error);
+            }
+        }, py::arg("load"), py::arg("bench_func"), py::arg("prep_func") = py::none())
+
+        .def("setTimer", &cBench::setTimer, py::arg("timer"))
+        .def("getAll", &cBench::getAll)
+        .def("getAvg", &cBench::getAvg)
+        .def("getMin", &cBench::getMin)
+        .def("getMax", &cBench::getMax)
+        .def("getP50", &cBench::getP50)
+        .def("getP95", &cBench::getP95)
+        .def("getP99", &cBench::getP99)
+        .def("getThreads", &cBench::getThreads)
+        .def("getResult", [](const cBench &bench) { return bench.getResult(); })
+        .def("getResult", [](const cBench &bench, unsigned int thread) { return bench.getResult(thread); }, py::arg("thread"));
+}
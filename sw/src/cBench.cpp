@@ -24,39 +24,150 @@
  * SOFTWARE.
  */
  
+#include <cmath>
+
 #include <coyote/cBench.hpp>
 
 namespace coyote {
 
-cBench::cBench(unsigned int n_runs, unsigned int n_warmups) { 
+cBenchResult::cBenchResult(uint64_t bytes_per_op, int sub_bits) : bytes_per_op(bytes_per_op), latencies(sub_bits) {}
+
+void cBenchResult::record(double latency) { 
+    latencies.record(latency); 
+    bytes += bytes_per_op;
+}
+
+void cBenchResult::merge(const cBenchResult &other) {
+    latencies.merge(other.latencies);
+    elapsed = std::max(elapsed, other.elapsed);
+    bytes += other.bytes;
+    bytes_per_op = other.bytes_per_op;
+}
+
+void cBenchResult::setElapsed(double elapsed) { this->elapsed = elapsed; }
+
+uint64_t cBenchResult::getOps() const { return latencies.getCount(); }
+
+double cBenchResult::getElapsed() const { return elapsed; }
+
+double cBenchResult::getOpsPerSec() const { if (elapsed > 0) return (double) getOps() * 1e9 / elapsed; else return NaN; }
+
+double cBenchResult::getGBps() const { if (elapsed > 0) return (double) bytes / elapsed; else return NaN; }
+
+const cHdrHistogram& cBenchResult::getLatencies() const { return latencies; }
+
+double cBenchResult::getAvg() const { return latencies.getMean(); }
+
+double cBenchResult::getMin() const { return latencies.getMin(); }
+
+double cBenchResult::getMax() const { return latencies.getMax(); }
+
+double cBenchResult::getPercentile(double p) const { return latencies.getPercentile(p); }
+
+cBench::cBench(unsigned int n_runs, unsigned int n_warmups, bool keep_samples) { 
     this->n_runs = n_runs; 
     this->n_warmups = n_warmups;
+    this->keep_samples = keep_samples;
 } 
 
-double cBench::getAvg() { 
-    if(measured_times.empty()) { return NaN; }
-    
-    double avg_time = 0;
-    for (const double &t : measured_times) {
-        avg_time += t;
+void cBench::setPrecision(int sub_bits) {
+    if (sub_bits < 1 || sub_bits > HDR_HIST_MAX_SUB_BITS) {
+        throw std::runtime_error("ERROR: cBench::setPrecision() called with an invalid precision of " + std::to_string(sub_bits) + " bits");
+    }
+    this->sub_bits = sub_bits;
+}
+
+void cBench::mergeResults() {
+    merged_result = cBenchResult(0, sub_bits);
+    for (const cBenchResult &result : thread_results) {
+        merged_result.merge(result);
+    }
+}
+
+double cBench::getAvg() { return merged_result.getAvg(); }
+
+void cBench::setTimer(CoyoteTimer timer) {
+    if (timer == CoyoteTimer::TSC) {
+        cTsc::getNsPerTick();
     }
-    return avg_time / (double) measured_times.size(); 
+    this->timer = timer;
 }
 
+CoyoteTimer cBench::getTimer() const { return timer; }
+
 std::vector<double> cBench::getAll() { return measured_times; }
 
-double cBench::getMin() { if(!measured_times.empty()) return measured_times[0]; else return NaN; }
+double cBench::getMin() { return merged_result.getMin(); }
+
+double cBench::getMax() { return merged_result.getMax(); }
+
+double cBench::getP25() { return merged_result.getPercentile(25); }
+
+double cBench::getP50() { return merged_result.getPercentile(50); }
 
-double cBench::getMax() { if(!measured_times.empty()) return measured_times[measured_times.size()-1]; else return NaN; }
+double cBench::getP75() { return merged_result.getPercentile(75); }
 
-double cBench::getP25() { if(!measured_times.empty()) return measured_times[(measured_times.size()/4)-1]; else return NaN; }
+double cBench::getP95() { return merged_result.getPercentile(95); }
 
-double cBench::getP50() { if(!measured_times.empty()) return measured_times[(measured_times.size()/2)-1]; else return NaN; }
+double cBench::getP99() { return merged_result.getPercentile(99); }
 
-double cBench::getP75() { if(!measured_times.empty()) return measured_times[((measured_times.size()*3)/4)-1]; else return NaN; }
+double cBench::getP999() { return merged_result.getPercentile(99.9); }
+
+double cBench::getP9999() { return merged_result.getPercentile(99.99); }
+
+const cBenchResult& cBench::getResult() const { return merged_result; }
+
+const cBenchResult& cBench::getResult(unsigned int thread) const { 
+    if (thread >= thread_results.size()) {
+        throw std::runtime_error("ERROR: cBench::getResult() called for thread " + std::to_string(thread) + ", which is not part of the last run");
+    }
+    return thread_results[thread]; 
+}
 
-double cBench::getP95() { if(!measured_times.empty()) return measured_times[((measured_times.size()*95)/100)-1]; else return NaN; }
+unsigned int cBench::getThreads() const { return thread_results.size(); }
 
-double cBench::getP99() { if(!measured_times.empty()) return measured_times[((measured_times.size()*99)/100)-1]; else return NaN; }
+void cBench::writeCsvRow(std::ostream &out, const std::string &thread, const cBenchResult &result) {
+    out << thread << "," << result.getOps() << "," << result.getElapsed() << "," << result.getOpsPerSec() << "," << result.getGBps() << ","
+        << result.getAvg() << "," << result.getMin() << "," << result.getPercentile(50) << "," << result.getPercentile(90) << ","
+        << result.getPercentile(99) << "," << result.getPercentile(99.9) << "," << result.getPercentile(99.99) << "," << result.getMax() << std::endl;
+}
+
+void cBench::writeCsv(std::ostream &out, bool header) const {
+    if (header) {
+        out << "thread,ops,elapsed_ns,ops_per_s,gbps,avg_ns,min_ns,p50_ns,p90_ns,p99_ns,p999_ns,p9999_ns,max_ns" << std::endl;
+    }
+    for (size_t t = 0; t < thread_results.size(); t++) {
+        writeCsvRow(out, std::to_string(t), thread_results[t]);
+    }
+    writeCsvRow(out, "all", merged_result);
+}
+
+void cBench::writeJsonObject(std::ostream &out, const cBenchResult &result) {
+    // JSON has no NaN, so the statistics of empty results are written as null
+    auto num = [&out](double v) -> std::ostream& { if (std::isnan(v)) out << "null"; else out << v; return out; };
+    out << "{\"ops\": " << result.getOps() << ", \"elapsed_ns\": "; num(result.getElapsed());
+    out << ", \"ops_per_s\": "; num(result.getOpsPerSec());
+    out << ", \"gbps\": "; num(result.getGBps());
+    out << ", \"avg_ns\": "; num(result.getAvg());
+    out << ", \"min_ns\": "; num(result.getMin());
+    out << ", \"p50_ns\": "; num(result.getPercentile(50));
+    out << ", \"p90_ns\": "; num(result.getPercentile(90));
+    out << ", \"p99_ns\": "; num(result.getPercentile(99));
+    out << ", \"p999_ns\": "; num(result.getPercentile(99.9));
+    out << ", \"p9999_ns\": "; num(result.getPercentile(99.99));
+    out << ", \"max_ns\": "; num(result.getMax());
+    out << "}";
+}
+
+void cBench::writeJson(std::ostream &out) const {
+    out << "{\"threads\": [";
+    for (size_t t = 0; t < thread_results.size(); t++) {
+        out << (t ? ", " : "");
+        writeJsonObject(out, thread_results[t]);
+    }
+    out << "], \"all\": ";
+    writeJsonObject(out, merged_result);
+    out << "}" << std::endl;
+}
 
 }
@@ -0,0 +1,118 @@
+/*
+ * This file is part of the Coyote <https://github.com/fpgasystems/Coyote>
+ *
+ * MIT Licence
+ * Copyright (c) 2025, Systems Group, ETH Zurich
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <coyote/cBufferPool.hpp>
+
+namespace coyote {
+
+cBufferPool::cBufferPool(cThread *cthread, CoyoteAllocType type, uint32_t slab_size): cthread(cthread), type(type) {
+    if (!cthread) {
+        throw std::runtime_error("ERROR: cBufferPool created without a valid cThread, exiting...");
+    }
+
+    if (type != CoyoteAllocType::REG && type != CoyoteAllocType::THP && type != CoyoteAllocType::HPF) {
+        throw std::runtime_error("ERROR: cBufferPool only supports REG, THP and HPF memory, exiting...");
+    }
+
+    uint64_t align = (type == CoyoteAllocType::REG) ? PAGE_SIZE : HUGE_PAGE_SIZE;
+    this->slab_size = static_cast<uint32_t>(((std::max<uint64_t>(slab_size, 1) + align - 1) / align) * align);
+}
+
+cBufferPool::~cBufferPool() {
+    std::lock_guard<std::mutex> guard(plock);
+    for (void *slab : slabs) {
+        cthread->freeMem(slab);
+    }
+    slabs.clear();
+    free_buffs.clear();
+    used_buffs.clear();
+}
+
+uint32_t cBufferPool::sizeClass(uint32_t size) {
+    uint64_t cls = PAGE_SIZE;
+    while (cls < size) {
+        cls <<= 1;
+    }
+
+    if (cls > std::numeric_limits<uint32_t>::max()) {
+        throw std::runtime_error("ERROR: cBufferPool - requested buffer size is too large, exiting...");
+    }
+    return static_cast<uint32_t>(cls);
+}
+
+void cBufferPool::grow(uint32_t cls) {
+    uint64_t align = (type == CoyoteAllocType::REG) ? PAGE_SIZE : HUGE_PAGE_SIZE;
+    uint32_t size = cls > slab_size ? static_cast<uint32_t>(((cls + align - 1) / align) * align) : slab_size;
+
+    void *slab = cthread->getMem({type, size});
+    if (!slab) {
+        throw std::runtime_error("ERROR: cBufferPool - could not allocate a new slab, exiting...");
+    }
+    slabs.push_back(slab);
+    DBG2("cBufferPool: allocated slab at " << slab << " of size " << size << " for class " << cls);
+
+    // Hand out the buffers in order of increasing address
+    std::vector<void*> &buffs = free_buffs[cls];
+    for (uint64_t offs = size / cls * cls; offs > 0; offs -= cls) {
+        buffs.push_back((void*) ((uint64_t) slab + offs - cls));
+    }
+}
+
+void cBufferPool::reserve(uint32_t size, uint32_t n) {
+    std::lock_guard<std::mutex> guard(plock);
+    uint32_t cls = sizeClass(size);
+    while (free_buffs[cls].size() < n) {
+        grow(cls);
+    }
+}
+
+void* cBufferPool::alloc(uint32_t size) {
+    std::lock_guard<std::mutex> guard(plock);
+    uint32_t cls = sizeClass(size);
+
+    std::vector<void*> &buffs = free_buffs[cls];
+    if (buffs.empty()) {
+        grow(cls);
+    }
+
+    void *buff = buffs.back();
+    buffs.pop_back();
+    used_buffs.emplace(buff, cls);
+    return buff;
+}
+
+void cBufferPool::release(void *buff) {
+    std::lock_guard<std::mutex> guard(plock);
+    auto it = used_buffs.find(buff);
+    if (it == used_buffs.end()) {
+        throw std::runtime_error("ERROR: cBufferPool::release() called with a buffer that was not obtained from the pool, exiting...");
+    }
+
+    free_buffs[it->second].push_back(buff);
+    used_buffs.erase(it);
+}
+
+}
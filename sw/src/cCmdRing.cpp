@@ -0,0 +1,86 @@
+/*
+ * This file is part of the Coyote <https://github.com/fpgasystems/Coyote>
+ *
+ * MIT Licence
+ * Copyright (c) 2025, Systems Group, ETH Zurich
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <coyote/cCmdRing.hpp>
+
+namespace coyote {
+
+static_assert((CMD_RING_SIZE & (CMD_RING_SIZE - 1)) == 0, "CMD_RING_SIZE must be a power of two");
+
+cCmdRing::cCmdRing() : head(0), tail(0), draining(false) {
+    for (uint64_t i = 0; i < CMD_RING_SIZE; i++) {
+        slots[i].seq.store(i, std::memory_order_relaxed);
+    }
+}
+
+bool cCmdRing::push(const std::array<uint64_t, 4> &cmd) {
+    uint64_t pos = head.load(std::memory_order_relaxed);
+    while (true) {
+        cmdSlot &slot = slots[pos & (CMD_RING_SIZE - 1)];
+        uint64_t seq = slot.seq.load(std::memory_order_acquire);
+        int64_t diff = (int64_t) seq - (int64_t) pos;
+
+        if (diff == 0) {
+            // The slot is free; claim it and write the command
+            if (head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                slot.cmd = cmd;
+                // Sequentially consistent, so that a drainer which is about to stop (see release()) either sees the command, or the pusher sees it stopped 
+                slot.seq.store(pos + 1, std::memory_order_seq_cst);
+                return true;
+            }
+        } else if (diff < 0) {
+            // The slot still holds a command that wasn't drained; the ring is full
+            return false;
+        } else {
+            pos = head.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+bool cCmdRing::pop(std::array<uint64_t, 4> &cmd) {
+    cmdSlot &slot = slots[tail & (CMD_RING_SIZE - 1)];
+    if (slot.seq.load(std::memory_order_acquire) != tail + 1) {
+        return false;
+    }
+
+    cmd = slot.cmd;
+    slot.seq.store(tail + CMD_RING_SIZE, std::memory_order_release);
+    tail++;
+    return true;
+}
+
+bool cCmdRing::tryAcquire() {
+    return !draining.load(std::memory_order_seq_cst) && !draining.exchange(true, std::memory_order_seq_cst);
+}
+
+bool cCmdRing::release() {
+    // Another thread may become the drainer as soon as the flag is cleared, so the tail must be read before
+    uint64_t pos = tail;
+    draining.store(false, std::memory_order_seq_cst);
+    return slots[pos & (CMD_RING_SIZE - 1)].seq.load(std::memory_order_seq_cst) == pos + 1;
+}
+
+}
@@ -0,0 +1,370 @@
+/*
+ * This file is part of the Coyote <https://github.com/fpgasystems/Coyote>
+ *
+ * MIT Licence
+ * Copyright (c) 2025, Systems Group, ETH Zurich
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <coyote/cCollective.hpp>
+
+namespace coyote {
+
+/// Host-side reduction of len bytes of elements of type T
+template<typename T>
+static void reduceBlock(CoyoteReduceOp op, void *dst, const void *src, uint64_t len) {
+    T *d = (T*) dst;
+    const T *s = (const T*) src;
+    for (uint64_t i = 0; i < len / sizeof(T); i++) {
+        switch (op) {
+            case CoyoteReduceOp::SUM: d[i] += s[i]; break;
+            case CoyoteReduceOp::MIN: d[i] = std::min(d[i], s[i]); break;
+            case CoyoteReduceOp::MAX: d[i] = std::max(d[i], s[i]); break;
+        }
+    }
+}
+
+static uint64_t reduceTypeSize(CoyoteReduceType type) {
+    switch (type) {
+        case CoyoteReduceType::INT32: return sizeof(int32_t);
+        case CoyoteReduceType::INT64: return sizeof(int64_t);
+        case CoyoteReduceType::FLOAT: return sizeof(float);
+        case CoyoteReduceType::DOUBLE: return sizeof(double);
+        default: throw std::runtime_error("ERROR: cCollective - unknown reduction type");
+    }
+}
+
+cCollective::cCollective(cThread *cthread, const std::vector<uint32_t> &qps, uint32_t rank, uint64_t offset, uint64_t seg_size, uint32_t depth) :
+    cthread(cthread), qps(qps), rank(rank), n_ranks(qps.size()), offset(offset), seg_size(seg_size), depth(depth) {
+    if (!cthread) {
+        throw std::runtime_error("ERROR: cCollective requires a cThread");
+    }
+    if (rank >= n_ranks) {
+        throw std::runtime_error("ERROR: cCollective - rank " + std::to_string(rank) + " out of range");
+    }
+    if (!depth || !seg_size || seg_size % 64) {
+        throw std::runtime_error("ERROR: cCollective requires a depth of at least one and a segment size which is a multiple of 64 bytes");
+    }
+
+    // All the QPs of connectPeers() share the buffer of QP 0
+    ibvQp *qpair = cthread->getQpair(0);
+    buffer = (char*) qpair->local.vaddr;
+    buffer_size = qpair->local.size;
+    if (!buffer || offset + getRegionSize(n_ranks, seg_size, depth) > buffer_size) {
+        throw std::runtime_error("ERROR: cCollective region doesn't fit the buffer");
+    }
+    memset(buffer + offset, 0, getRegionSize(n_ranks, seg_size, depth));
+
+    seq_out.resize(n_ranks, 0);
+    seq_in.resize(n_ranks, 0);
+    wr_out.resize(n_ranks, 0);
+    wr_base.resize(n_ranks, 0);
+    seg_wr.resize((size_t) n_ranks * depth, 0);
+    for (uint32_t i = 0; i < n_ranks; i++) {
+        if (i != rank) {
+            wr_base[i] = cthread->checkCompleted(CoyoteOper::REMOTE_RDMA_WRITE, qps[i]);
+        }
+    }
+}
+
+uint32_t cCollective::completedWrites(uint32_t peer) const {
+    return cthread->checkCompleted(CoyoteOper::REMOTE_RDMA_WRITE, qps[peer]) - wr_base[peer];
+}
+
+bool cCollective::trySend(uint32_t peer, uint32_t stage, uint64_t local_offs, uint64_t len) {
+    uint64_t seq = seq_out[peer];
+    uint64_t slot = seq % depth;
+
+    // The peer must have consumed the segment previously in the slot, and its write must have completed (so that it isn't replayed)
+    if (seq - *slotAt(rxCreditOffs(peer)) >= depth) {
+        return false;
+    }
+    if (seq >= depth && (int32_t) (completedWrites(peer) - seg_wr[peer * depth + slot]) < 0) {
+        return false;
+    }
+
+    // Segment and then its flag, in one chain; the flags of the peer are indexed by the sender's rank
+    *slotAt(txFlagOffs(peer, slot)) = seq + 1;
+    chain.clear();
+    if (len) {
+        chain.push_back({local_offs, offset + stageOffs(stage, slot), len});
+    }
+    chain.push_back({offset + txFlagOffs(peer, slot), offset + rxFlagOffs(rank, slot), SLOT_SIZE});
+
+    rdmaSg tmpl;
+    tmpl.qp = qps[peer];
+    cthread->invokeChain(CoyoteOper::REMOTE_RDMA_WRITE, tmpl, chain);
+
+    seg_wr[peer * depth + slot] = ++wr_out[peer];
+    seq_out[peer]++;
+    return true;
+}
+
+const char* cCollective::tryRecv(uint32_t peer, uint32_t stage) const {
+    uint64_t slot = seq_in[peer] % depth;
+    if (*slotAt(rxFlagOffs(peer, slot)) != seq_in[peer] + 1) {
+        return nullptr;
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return buffer + offset + stageOffs(stage, slot);
+}
+
+void cCollective::release(uint32_t peer) {
+    // Credits are cumulative, so a replayed (older) credit update is harmless
+    seq_in[peer]++;
+    *slotAt(txCreditOffs(peer)) = seq_in[peer];
+
+    rdmaSg sg;
+    sg.local_offs = offset + txCreditOffs(peer);
+    sg.remote_offs = offset + rxCreditOffs(rank);
+    sg.len = SLOT_SIZE;
+    sg.qp = qps[peer];
+    cthread->invoke(CoyoteOper::REMOTE_RDMA_WRITE, sg);
+    wr_out[peer]++;
+}
+
+void cCollective::quiet() {
+    for (uint32_t i = 0; i < n_ranks; i++) {
+        if (i != rank) {
+            while ((int32_t) (completedWrites(i) - wr_out[i]) < 0) {
+                _mm_pause();
+            }
+        }
+    }
+}
+
+void cCollective::checkData(uint64_t data_offs, uint64_t len) const {
+    if (data_offs + len > buffer_size) {
+        throw std::runtime_error("ERROR: cCollective - data exceeds the buffer");
+    }
+    if (len && data_offs < offset + getRegionSize(n_ranks, seg_size, depth) && offset < data_offs + len) {
+        throw std::runtime_error("ERROR: cCollective - data overlaps the collective's region");
+    }
+}
+
+void cCollective::ringStep(uint64_t send_offs, uint64_t send_len, uint64_t recv_offs, uint64_t recv_len, const reduceFn &combine) {
+    uint32_t next = (rank + 1) % n_ranks;
+    uint32_t prev = (rank + n_ranks - 1) % n_ranks;
+    uint64_t n_send = numSegments(send_len), n_recv = numSegments(recv_len);
+
+    // Segments are sent as soon as there are credits and combined as soon as they arrive, so the transfers in both directions overlap
+    uint64_t sent = 0, recvd = 0;
+    while (sent < n_send || recvd < n_recv) {
+        bool progress = false;
+        if (sent < n_send && trySend(next, STAGE_RING, send_offs + sent * seg_size, segmentLen(send_len, sent))) {
+            sent++;
+            progress = true;
+        }
+
+        const char *seg = (recvd < n_recv) ? tryRecv(prev, STAGE_RING) : nullptr;
+        if (seg) {
+            combine(buffer + recv_offs + recvd * seg_size, seg, segmentLen(recv_len, recvd));
+            release(prev);
+            recvd++;
+            progress = true;
+        }
+
+        if (!progress) {
+            _mm_pause();
+        }
+    }
+}
+
+void cCollective::treeReduce(uint64_t data_offs, uint64_t len, const reduceFn &combine) {
+    uint64_t n_seg = numSegments(len);
+    uint32_t parent = (rank - 1) / 2;
+    uint32_t children[2] = { 2 * rank + 1, 2 * rank + 2 };
+    uint32_t n_children = (children[0] < n_ranks) + (children[1] < n_ranks);
+
+    // The segments are reduced in the same order (first child, then second child) on every run, for reproducible floating-point results
+    uint64_t recvd[2] = { 0, 0 }, sent = 0;
+    while (true) {
+        bool progress = false;
+        for (uint32_t i = 0; i < n_children; i++) {
+            if (recvd[i] < n_seg && (i == 0 || recvd[1] < recvd[0])) {
+                const char *seg = tryRecv(children[i], STAGE_CHILD + i);
+                if (seg) {
+                    combine(buffer + data_offs + recvd[i] * seg_size, seg, segmentLen(len, recvd[i]));
+                    release(children[i]);
+                    recvd[i]++;
+                    progress = true;
+                }
+            }
+        }
+
+        // A segment is passed on to the parent once all the children's segments were reduced into it
+        uint64_t reduced = n_children ? recvd[n_children - 1] : n_seg;
+        if (rank && sent < reduced && trySend(parent, STAGE_CHILD + (rank - 1) % 2, data_offs + sent * seg_size, segmentLen(len, sent))) {
+            sent++;
+            progress = true;
+        }
+
+        if (reduced == n_seg && (!rank || sent == n_seg)) {
+            break;
+        }
+        if (!progress) {
+            _mm_pause();
+        }
+    }
+}
+
+void cCollective::treeBroadcast(uint64_t data_offs, uint64_t len, uint32_t root) {
+    uint64_t n_seg = numSegments(len);
+
+    // Segments arrive from the parent, or, on rank 0, from the root (if it isn't rank 0 itself)
+    bool has_src = rank ? true : (root != 0);
+    uint32_t src = rank ? (rank - 1) / 2 : root;
+    uint32_t src_stage = rank ? STAGE_PARENT : STAGE_ROOT;
+
+    // Segments are sent to the children and, from the root, to rank 0
+    uint32_t dsts[3], dst_stages[3], n_dsts = 0;
+    for (uint32_t child = 2 * rank + 1; child <= 2 * rank + 2 && child < n_ranks; child++) {
+        dsts[n_dsts] = child;
+        dst_stages[n_dsts++] = STAGE_PARENT;
+    }
+    if (rank == root && root != 0) {
+        dsts[n_dsts] = 0;
+        dst_stages[n_dsts++] = STAGE_ROOT;
+    }
+
+    uint64_t recvd = has_src ? 0 : n_seg, sent[3] = { 0, 0, 0 };
+    while (true) {
+        bool progress = false;
+        const char *seg = (recvd < n_seg) ? tryRecv(src, src_stage) : nullptr;
+        if (seg) {
+            // The root already holds the data
+            if (rank != root) {
+                memcpy(buffer + data_offs + recvd * seg_size, seg, segmentLen(len, recvd));
+            }
+            release(src);
+            recvd++;
+            progress = true;
+        }
+
+        // Segments are forwarded as soon as they arrive
+        uint64_t avail = (rank == root) ? n_seg : recvd;
+        bool done = (recvd == n_seg);
+        for (uint32_t i = 0; i < n_dsts; i++) {
+            if (sent[i] < avail && trySend(dsts[i], dst_stages[i], data_offs + sent[i] * seg_size, segmentLen(len, sent[i]))) {
+                sent[i]++;
+                progress = true;
+            }
+            done = done && (sent[i] == n_seg);
+        }
+
+        if (done) {
+            break;
+        }
+        if (!progress) {
+            _mm_pause();
+        }
+    }
+}
+
+void cCollective::allreduce(uint64_t data_offs, uint64_t count, CoyoteReduceType type, CoyoteReduceOp op, CoyoteCollectiveAlgo algo) {
+    uint64_t elem_size = reduceTypeSize(type);
+    checkData(data_offs, count * elem_size);
+    if (n_ranks == 1) {
+        return;
+    }
+
+    reduceFn combine = reducer;
+    if (!combine) {
+        combine = [type, op](void *dst, const void *src, uint64_t len) {
+            switch (type) {
+                case CoyoteReduceType::INT32: reduceBlock<int32_t>(op, dst, src, len); break;
+                case CoyoteReduceType::INT64: reduceBlock<int64_t>(op, dst, src, len); break;
+                case CoyoteReduceType::FLOAT: reduceBlock<float>(op, dst, src, len); break;
+                case CoyoteReduceType::DOUBLE: reduceBlock<double>(op, dst, src, len); break;
+            }
+        };
+    }
+
+    if (algo == CoyoteCollectiveAlgo::TREE) {
+        treeReduce(data_offs, count * elem_size, combine);
+        quiet();
+        treeBroadcast(data_offs, count * elem_size, 0);
+        quiet();
+        return;
+    }
+
+    // Ring: the data is split into one chunk per rank (of whole elements); after the reduce-scatter, rank r holds the reduced chunk r + 1
+    auto chunkOffs = [&](uint32_t i) { 
+        i %= n_ranks; 
+        return data_offs + (i * (count / n_ranks) + std::min<uint64_t>(i, count % n_ranks)) * elem_size; 
+    };
+    auto chunkLen = [&](uint32_t i) { 
+        i %= n_ranks; 
+        return (count / n_ranks + (i < count % n_ranks)) * elem_size; 
+    };
+    reduceFn copy = [](void *dst, const void *src, uint64_t len) { memcpy(dst, src, len); };
+
+    for (uint32_t s = 0; s < n_ranks - 1; s++) {
+        uint32_t send_chunk = rank + n_ranks - s, recv_chunk = rank + 2 * n_ranks - s - 1;
+        ringStep(chunkOffs(send_chunk), chunkLen(send_chunk), chunkOffs(recv_chunk), chunkLen(recv_chunk), combine);
+    }
+
+    // The chunks sent during the reduce-scatter are overwritten by the allgather
+    quiet();
+
+    for (uint32_t s = 0; s < n_ranks - 1; s++) {
+        uint32_t send_chunk = rank + n_ranks + 1 - s, recv_chunk = rank + n_ranks - s;
+        ringStep(chunkOffs(send_chunk), chunkLen(send_chunk), chunkOffs(recv_chunk), chunkLen(recv_chunk), copy);
+    }
+    quiet();
+}
+
+void cCollective::allgather(uint64_t data_offs, uint64_t block_size) {
+    checkData(data_offs, block_size * n_ranks);
+    
+    reduceFn copy = [](void *dst, const void *src, uint64_t len) { memcpy(dst, src, len); };
+    for (uint32_t s = 0; s + 1 < n_ranks; s++) {
+        uint64_t send_block = (rank + n_ranks - s) % n_ranks, recv_block = (rank + 2 * n_ranks - s - 1) % n_ranks;
+        ringStep(data_offs + send_block * block_size, block_size, data_offs + recv_block * block_size, block_size, copy);
+    }
+    quiet();
+}
+
+void cCollective::broadcast(uint64_t data_offs, uint64_t len, uint32_t root) {
+    checkData(data_offs, len);
+    if (root >= n_ranks) {
+        throw std::runtime_error("ERROR: cCollective::broadcast() - root " + std::to_string(root) + " out of range");
+    }
+    if (n_ranks == 1) {
+        return;
+    }
+
+    treeBroadcast(data_offs, len, root);
+    quiet();
+}
+
+void cCollective::barrier() {
+    if (n_ranks == 1) {
+        return;
+    }
+
+    // Flag-only segments up and down the tree
+    treeReduce(0, 0, [](void*, const void*, uint64_t) {});
+    treeBroadcast(0, 0, 0);
+    quiet();
+}
+
+}
@@ -0,0 +1,161 @@
+/*
+ * This file is part of the Coyote <https://github.com/fpgasystems/Coyote>
+ *
+ * MIT Licence
+ * Copyright (c) 2025, Systems Group, ETH Zurich
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <coyote/cCompletionQueue.hpp>
+
+namespace coyote {
+
+cCompletionQueue::cCompletionQueue(cThread *cthread): cthread(cthread) {
+    if (!cthread) {
+        throw std::runtime_error("ERROR: cCompletionQueue created without a valid cThread, exiting...");
+    }
+}
+
+CoyoteOper cCompletionQueue::classOper(unsigned int cls) {
+    switch (cls) {
+        case RD_WBACK: return CoyoteOper::LOCAL_READ;
+        case WR_WBACK: return CoyoteOper::LOCAL_WRITE;
+        case RD_RDMA_WBACK: return CoyoteOper::REMOTE_RDMA_READ;
+        case WR_RDMA_WBACK: return CoyoteOper::REMOTE_RDMA_WRITE;
+        default: return CoyoteOper::NOOP;
+    }
+}
+
+void cCompletionQueue::prime(unsigned int cls) {
+    // Snapshot the current counter on first use, so that previously issued operations don't need to be cleared
+    if (!primed[cls]) {
+        issued[cls] = cthread->checkCompleted(classOper(cls));
+        primed[cls] = true;
+    }
+}
+
+bool cCompletionQueue::reached(uint32_t cnt, uint32_t target) {
+    return static_cast<int32_t>(cnt - target) >= 0;
+}
+
+uint64_t cCompletionQueue::push(unsigned int cls) {
+    uint64_t ticket = next_ticket++;
+    pending[cls].push_back({ticket, issued[cls]});
+    DBG2("cCompletionQueue: issued ticket " << ticket << ", class " << cls << ", target " << issued[cls]);
+    return ticket;
+}
+
+uint64_t cCompletionQueue::invoke(CoyoteOper oper, localSg sg) {
+    unsigned int cls = isLocalWrite(oper) ? WR_WBACK : RD_WBACK;
+    prime(cls);
+
+    cthread->invoke(oper, sg, true);
+    issued[cls]++;
+    return push(cls);
+}
+
+uint64_t cCompletionQueue::invoke(CoyoteOper oper, localSg src_sg, localSg dst_sg) {
+    prime(RD_WBACK);
+    prime(WR_WBACK);
+
+    cthread->invoke(oper, src_sg, dst_sg, true);
+
+    // Both sides of a transfer carry the last flag, so both counters are incremented; but only the write marks completion
+    issued[RD_WBACK]++;
+    issued[WR_WBACK]++;
+    return push(WR_WBACK);
+}
+
+uint64_t cCompletionQueue::invoke(CoyoteOper oper, rdmaSg sg) {
+    unsigned int cls = isRemoteRead(oper) ? RD_RDMA_WBACK : WR_RDMA_WBACK;
+    prime(cls);
+
+    cthread->invoke(oper, sg, true);
+    issued[cls]++;
+    return push(cls);
+}
+
+std::vector<uint64_t> cCompletionQueue::poll(size_t max_n) {
+    std::vector<uint64_t> completed;
+
+    for (unsigned int cls = 0; cls < N_CLASSES; cls++) {
+        if (pending[cls].empty()) {
+            continue;
+        }
+
+        // Single counter read for all the outstanding requests of this class
+        uint32_t cnt = cthread->checkCompleted(classOper(cls));
+        for (const auto &req : pending[cls]) {
+            if (!reached(cnt, req.target)) {
+                break;
+            }
+            completed.push_back(req.ticket);
+        }
+    }
+
+    // Return the oldest tickets first; those not returned are kept in the queue for the next call
+    std::sort(completed.begin(), completed.end());
+    if (completed.size() > max_n) {
+        completed.resize(max_n);
+    }
+
+    for (unsigned int cls = 0; cls < N_CLASSES; cls++) {
+        while (!pending[cls].empty() && std::binary_search(completed.begin(), completed.end(), pending[cls].front().ticket)) {
+            pending[cls].pop_front();
+        }
+    }
+
+    return completed;
+}
+
+bool cCompletionQueue::wait(uint64_t ticket, std::chrono::microseconds timeout) {
+    for (unsigned int cls = 0; cls < N_CLASSES; cls++) {
+        for (const auto &req : pending[cls]) {
+            if (req.ticket != ticket) {
+                continue;
+            }
+
+            auto begin = std::chrono::steady_clock::now();
+            while (!reached(cthread->checkCompleted(classOper(cls)), req.target)) {
+                if (timeout != std::chrono::microseconds::max() && std::chrono::steady_clock::now() - begin > timeout) {
+                    return false;
+                }
+            }
+            return true;
+        }
+    }
+
+    // Not in-flight, so it was either already polled or never issued
+    if (ticket >= next_ticket) {
+        throw std::runtime_error("ERROR: cCompletionQueue::wait() called with a ticket that was not issued, exiting...");
+    }
+    return true;
+}
+
+size_t cCompletionQueue::size() const {
+    size_t n = 0;
+    for (unsigned int cls = 0; cls < N_CLASSES; cls++) {
+        n += pending[cls].size();
+    }
+    return n;
+}
+
+}
@@ -24,7 +24,14 @@
  * SOFTWARE.
  */
 
+#include <poll.h>
+#include <netdb.h>
+#include <netinet/tcp.h>
+#include <sys/mman.h>
+#include <sys/eventfd.h>
+
 #include <coyote/cConn.hpp>
+#include <coyote/cThreadConfig.hpp>
 
 namespace coyote {      
     
@@ -45,6 +52,49 @@ cConn::cConn(std::string sock_name) {
         throw std::runtime_error("ERROR: Failed to connect to the server, socket_name: " + sock_name);
     }
 
+    registerClient(true);
+}
+
+cConn::cConn(std::string server_address, uint16_t port) {
+    DBG3("cConn: Called the constructor for a remote connection (AF_INET), server " << server_address << ":" << port); 
+
+    struct addrinfo *res;
+    struct addrinfo hints = {};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    std::string service = std::to_string(port);
+    if (getaddrinfo(server_address.c_str(), service.c_str(), &hints, &res) != 0) {
+        throw std::runtime_error("ERROR: getaddrinfo() failed for " + server_address);
+    }
+
+    for (struct addrinfo *t = res; t; t = t->ai_next) {
+        sockfd = ::socket(t->ai_family, t->ai_socktype, t->ai_protocol);
+        if (sockfd >= 0) {
+            if (!::connect(sockfd, t->ai_addr, t->ai_addrlen)) {
+                break;
+            } else {
+                ::close(sockfd);
+                sockfd = -1;
+            }
+        }
+    }
+    freeaddrinfo(res);
+
+    if (sockfd < 0) {
+        throw std::runtime_error("ERROR: Failed to connect to the server: " + server_address + ":" + std::to_string(port));
+    }
+
+    // Requests are small and latency-sensitive, so disable Nagle's algorithm
+    int one = 1;
+    if (setsockopt(sockfd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one)) < 0) {
+        std::cerr << "WARNING: Failed to set TCP_NODELAY" << std::endl;
+    }
+
+    // Shared memory is, naturally, only available to local clients
+    registerClient(false);
+}
+
+void cConn::registerClient(bool use_shm) {
     /*
     // Since there is a dedicated thread that listens for task completions,
     // set a timout for the socket, to avoid blocking other call while waiting for the server to respond
@@ -53,9 +103,36 @@ cConn::cConn(std::string sock_name) {
     }
     */
     
-    // Register the PID with the server
+    /*
+     * Register the PID with the server; if the shared-memory channel was created, its file descriptor 
+     * and the two doorbells are passed to the server alongside the PID (as SCM_RIGHTS ancillary data)
+     */
     pid_t pid = getpid();
-    if (write(sockfd, &pid, sizeof(pid_t)) != sizeof(pid_t)) {
+    int shm_fd = use_shm ? createShm() : -1;
+
+    struct iovec iov = { &pid, sizeof(pid_t) };
+    struct msghdr msg = {};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+
+    int fds[3] = { shm_fd, req_efd, resp_efd };
+    alignas(struct cmsghdr) char cmsg_buff[CMSG_SPACE(sizeof(fds))];
+    if (shm_fd != -1) {
+        msg.msg_control = cmsg_buff;
+        msg.msg_controllen = sizeof(cmsg_buff);
+        struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+        memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+    }
+
+    ssize_t n = sendmsg(sockfd, &msg, 0);
+    if (shm_fd != -1) {
+        // The server holds its own reference now; the mapping stays valid after closing
+        close(shm_fd);
+    }
+    if (n != sizeof(pid_t)) {
         throw std::runtime_error("ERROR: Failed to send PID to the server");
     }
 
@@ -68,67 +145,400 @@ cConn::cConn(std::string sock_name) {
 
 cConn::~cConn() {
     DBG3("cConn: Called the destructor, closing the connection");
-    /*
-     * When function request are submitted, the client sends three values: opcode (DEF_OP_SUBMIT_TASK), function ID and task ID.
-     * However, to close the connection, only one value needs to be sent (the opcode). The alternative is to first send the
-     * opcode (DEF_OP_CLOSE_CONN or DEF_OP_SUBMIT_TASK) and in the case of the request, then send the function and task ID. 
-     * However, this adds unnecessary latency due to IPC as well as complexity to the code. Therefore, send three values here
-     * even though only the first one is used to close the connection; the rest are ignored.
-     */
-    int32_t req[3];
-    req[0] = DEF_OP_CLOSE_CONN;
-    if (write(sockfd, &req, 3 * sizeof(int32_t)) != 3 * sizeof(int32_t)) {
+    
+    // Send any requests still buffered in a batch, followed by a (payload-less) close request; 
+    // the close request follows the same path as the last requests, so that the server handles them first
+    run_thread = false;
+    try {
+        if (batching) {
+            flushBatch();
+        }
+
+        cReqHeader header = { (int32_t) DEF_OP_CLOSE_CONN, 0, 0, 0 };
+        struct iovec iov = { &header, sizeof(cReqHeader) };
+        std::lock_guard<std::mutex> guard(send_lock);
+        if (!pushShm(&iov, 1)) {
+            sendAll(&iov, 1);
+        }
+    } catch (const std::exception &e) {
         std::cerr << "ERROR: Failed to send close connection request to the server" << std::endl;
     }
-    close(sockfd);
-    std::cout << "Successfully closed connection to the server" << std::endl;
 
-    // Terminate completion thread
-    run_thread = false;
+    // Terminate completion thread; it stops once the server closes its end of the socket
     if (completion_thread.joinable()) {
         completion_thread.join();
     }
+    close(sockfd);
+    for (int fd : shared_fds) {
+        close(fd);
+    }
+    std::cout << "Successfully closed connection to the server" << std::endl;
+
+    if (shm != nullptr) {
+        munmap(shm, sizeof(cShmChannel));
+        close(req_efd);
+        close(resp_efd);
+    }
+}
+
+int cConn::createShm() {
+    int shm_fd = memfd_create("coyote-conn", MFD_CLOEXEC);
+    if (shm_fd == -1) {
+        return -1;
+    }
+
+    void *mem = MAP_FAILED;
+    if (ftruncate(shm_fd, sizeof(cShmChannel)) == 0) {
+        mem = mmap(nullptr, sizeof(cShmChannel), PROT_READ | PROT_WRITE, MAP_SHARED, shm_fd, 0);
+    }
+    req_efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    resp_efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    if (mem == MAP_FAILED || req_efd == -1 || resp_efd == -1) {
+        std::cerr << "WARNING: Failed to set up the shared-memory channel; using the socket only" << std::endl;
+        if (mem != MAP_FAILED) { munmap(mem, sizeof(cShmChannel)); }
+        if (req_efd != -1) { close(req_efd); }
+        if (resp_efd != -1) { close(resp_efd); }
+        req_efd = resp_efd = -1;
+        close(shm_fd);
+        return -1;
+    }
+
+    shm = new (mem) cShmChannel();
+    DBG3("cConn: Created shared-memory channel of " << sizeof(cShmChannel) << " bytes");
+    return shm_fd;
+}
+
+bool cConn::pushShm(const struct iovec *iov, int iovcnt) {
+    if (shm == nullptr || !shm->req.push(iov, iovcnt)) {
+        return false;
+    }
+
+    if (shm->req.needsWakeUp()) {
+        eventfd_write(req_efd, 1);
+    }
+    return true;
+}
+
+void cConn::sendAll(struct iovec *iov, int iovcnt) {
+    // MSG_NOSIGNAL: a service which went away is reported as an error, rather than terminating the client with SIGPIPE
+    while (iovcnt > 0) {
+        struct msghdr msg = {};
+        msg.msg_iov = iov;
+        msg.msg_iovlen = iovcnt;
+        ssize_t n = sendmsg(sockfd, &msg, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) { continue; }
+            throw std::runtime_error("ERROR: Failed to send request to server");
+        }
+
+        // Partial write; skip the buffers that were fully sent and advance into the first incomplete one
+        while (iovcnt > 0 && (size_t) n >= iov->iov_len) {
+            n -= iov->iov_len;
+            iov++;
+            iovcnt--;
+        }
+        if (iovcnt > 0) {
+            iov->iov_base = (char *) iov->iov_base + n;
+            iov->iov_len -= n;
+        }
+    }
+}
+
+void cConn::beginBatch() {
+    std::lock_guard<std::mutex> guard(send_lock);
+    batching = true;
+}
+
+void cConn::sendBatch() {
+    if (batch_buff.empty()) {
+        return;
+    }
+
+    DBG1("cConn: Flushing a batch of " << batch_buff.size() << " bytes");
+    struct iovec iov = { batch_buff.data(), batch_buff.size() };
+    if (!pushShm(&iov, 1)) {
+        sendAll(&iov, 1);
+    }
+    batch_buff.clear();
+}
+
+void cConn::flushBatch() {
+    std::lock_guard<std::mutex> guard(send_lock);
+    batching = false;
+    sendBatch();
+}
+
+std::future<cServiceLoad> cConn::queryLoad() {
+    auto promise = std::make_shared<std::promise<cServiceLoad>>();
+    std::future<cServiceLoad> future = promise->get_future();
+    submitTask(DEF_OP_QUERY_LOAD, -1, cTaskClass(), VAR_ARG_SIZE, [promise](cTask *task) {
+        cServiceLoad load = {};
+        size_t size = task->getRetDataSize();
+        if (task->getRetCode() != 0 || size < sizeof(cLoadReport)) {
+            promise->set_exception(std::make_exception_ptr(std::runtime_error("ERROR: Service did not answer the load query")));
+            return;
+        }
+
+        const char *data = (const char *) task->getRetData();
+        memcpy(&load.report, data, sizeof(cLoadReport));
+        size_t n_fids = std::min((size - sizeof(cLoadReport)) / sizeof(int32_t), (size_t) load.report.n_fids);
+        load.fids.resize(n_fids);
+        memcpy(load.fids.data(), data + sizeof(cLoadReport), n_fids * sizeof(int32_t));
+        promise->set_value(std::move(load));
+    });
+    return future;
+}
+
+void cConn::acquireWindow() {
+    std::unique_lock<std::mutex> guard(tasks_lock);
+    if (in_flight >= window) {
+        // Buffered requests count towards the window; send them, so that they can complete and free up slots
+        guard.unlock();
+        send_lock.lock();
+        sendBatch();
+        send_lock.unlock();
+        guard.lock();
+
+        tasks_cv.wait(guard, [&] { return in_flight < window; });
+    }
+    in_flight++;
+}
+
+void cConn::setWindow(uint32_t window) {
+    std::lock_guard<std::mutex> guard(tasks_lock);
+    this->window = window ? window : 1;
+    tasks_cv.notify_all();
+}
+
+std::vector<int32_t> cConn::pollCompleted(size_t max_tasks) {
+    std::lock_guard<std::mutex> guard(tasks_lock);
+    size_t n = std::min(max_tasks, completed_tasks.size());
+    std::vector<int32_t> tids(completed_tasks.begin(), completed_tasks.begin() + n);
+    completed_tasks.erase(completed_tasks.begin(), completed_tasks.begin() + n);
+    return tids;
+}
+
+bool cConn::releaseTask(int32_t tid) {
+    std::lock_guard<std::mutex> guard(tasks_lock);
+    auto task = tasks.find(tid);
+    if (task == tasks.end() || !task->second->isCompleted()) {
+        return false;
+    }
+    tasks.erase(task);
+    return true;
+}
+
+std::pair<const void*, size_t> cConn::getTaskResult(int32_t tid) {
+    std::lock_guard<std::mutex> guard(tasks_lock);
+    auto task = tasks.find(tid);
+    if (task == tasks.end() || !task->second->isCompleted()) {
+        throw std::runtime_error("ERROR: Task with id: " + std::to_string(tid) + " not found or not completed when getting its result");
+    }
+
+    if (task->second->getRetCode() != 0) {
+        throwRetCode(tid, task->second->getRetCode());
+    }
+    return { task->second->getRetData(), task->second->getRetDataSize() };
 }
 
 void cConn::checkCompletedTasks() {
     DBG3("cConn: Starting the completion listener thread");
+    cThreadConfig::apply(CoyoteThreadRole::CONN);
     
-    while (run_thread) {
-        // Check if the server wrote the task ID and the completion code; if yes, process task completion
-        char recv_buff[RECV_BUFF_SIZE];
-        if (read(sockfd, recv_buff, 2 * sizeof(int32_t)) == 2 * sizeof(int32_t)) {
-
-            int32_t task_id, ret_code;
-            memcpy(&ret_code, recv_buff, sizeof(int32_t));
-            memcpy(&task_id, recv_buff + sizeof(int32_t), sizeof(int32_t));
-            if (tasks.find(task_id) != tasks.end()) {
-                // Task exists & ret_code is zero; receive the return value from the server
-                if (ret_code == 0) {
-                    size_t ret_val_size = tasks[task_id]->getRetValSize();
-                    if (read(sockfd, recv_buff, ret_val_size) != ret_val_size) {
-                        throw std::runtime_error("ERROR: Failed to read return value from server, tid " + std::to_string(task_id));
-                    }
-                    std::vector<char> ret_val(recv_buff, recv_buff + ret_val_size);
-                    tasks[task_id]->setRetVal(ret_val);
-                    tasks[task_id]->setRetCode(ret_code);
-                    tasks[task_id]->setCompleted(true);
-
-                // Task exists, but server sent non-zero return code; mark as completed but don't store return value
-                } else {
-                    tasks[task_id]->setRetCode(ret_code);
-                    tasks[task_id]->setCompleted(true);
+    /*
+     * The server sends the responses as a stream of frames (a cRespHeader, followed by the return value), 
+     * possibly many of them at once, through the shared-memory ring or the socket. Since the two are independent
+     * streams, each has its own buffer. The ring is drained before blocking; then, the thread waits until the
+     * server rings the doorbell or writes to the socket. The socket also signals when the server closed the connection.
+     */
+    std::vector<char> sock_buff(DAEMON_RX_BUFF_SIZE), shm_buff(DAEMON_RX_BUFF_SIZE);
+    size_t sock_len = 0, shm_len = 0;
+    struct pollfd fds[2] = { { sockfd, POLLIN, 0 }, { resp_efd, POLLIN, 0 } };
+    while (true) {
+        if (shm != nullptr) {
+            size_t n;
+            while ((n = shm->resp.pop(shm_buff.data() + shm_len, shm_buff.size() - shm_len)) > 0) {
+                shm_len += n;
+                parseResponses(shm_buff, shm_len);
+            }
+            if (!shm->resp.prepareWait()) {
+                continue;
+            }
+        }
+
+        if (poll(fds, shm != nullptr ? 2 : 1, -1) < 0) {
+            if (errno == EINTR) { continue; }
+            break;
+        }
+
+        if (fds[1].revents & POLLIN) {
+            eventfd_t val;
+            eventfd_read(resp_efd, &val);
+        }
+
+        if (fds[0].revents) {
+            // Shared-memory return values arrive as file descriptors, attached to their response
+            struct iovec iov = { sock_buff.data() + sock_len, sock_buff.size() - sock_len };
+            struct msghdr msg = {};
+            alignas(struct cmsghdr) char cmsg_buff[CMSG_SPACE(sizeof(int))];
+            msg.msg_iov = &iov;
+            msg.msg_iovlen = 1;
+            msg.msg_control = cmsg_buff;
+            msg.msg_controllen = sizeof(cmsg_buff);
+
+            ssize_t n = recvmsg(sockfd, &msg, MSG_CMSG_CLOEXEC);
+            for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg); n > 0 && cmsg != nullptr; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+                if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS) {
+                    int fd;
+                    memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+                    shared_fds.push_back(fd);
                 }
-            }   
-            
+            }
+
+            if (n == 0 || (n < 0 && errno != EINTR)) {
+                break;
+            } else if (n > 0) {
+                sock_len += n;
+                parseResponses(sock_buff, sock_len);
+            }
         }
-        
-        std::this_thread::sleep_for(std::chrono::microseconds(SLEEP_INTERVAL_CLIENT_CONN_MANAGER)); 
     }
 
+    if (run_thread) {
+        std::cerr << "ERROR: Connection to the server was closed unexpectedly" << std::endl;
+        failOutstandingTasks();
+    }
     DBG3("cConn: Completion thread stopped");
 }
 
+void cConn::parseResponses(std::vector<char> &buff, size_t &len) {
+    // Tasks with a callback are removed from the map and their callbacks are called once the lock has been released
+    std::vector<std::pair<std::function<void(cTask*)>, std::unique_ptr<cTask>>> finished;
+    
+    size_t offset = 0;
+    bool completed = false;
+    std::unique_lock<std::mutex> guard(tasks_lock);
+    while (len - offset >= sizeof(cRespHeader)) {
+        cRespHeader header;
+        memcpy(&header, buff.data() + offset, sizeof(cRespHeader));
+        size_t frame_size = sizeof(cRespHeader) + header.payload_size;
+        if (len - offset < frame_size) {
+            if (frame_size > buff.size()) {
+                buff.resize(frame_size);
+            }
+            break;
+        }
+
+        // Shared return value; map the buffer which was received with the response (the mapping outlives the descriptor)
+        const char *ret_val = buff.data() + offset + sizeof(cRespHeader);
+        void *shared_ret_val = nullptr;
+        uint64_t shared_size = 0;
+        if (header.flags & DEF_RESP_SHARED) {
+            if (shared_fds.empty() || header.payload_size != sizeof(uint64_t)) {
+                std::cerr << "ERROR: Shared return value of task " << header.tid << " was not received" << std::endl;
+                header.ret_code = DEF_RET_ERROR;
+            } else {
+                memcpy(&shared_size, ret_val, sizeof(uint64_t));
+                shared_ret_val = mmap(nullptr, shared_size, PROT_READ, MAP_SHARED, shared_fds.front(), 0);
+                close(shared_fds.front());
+                shared_fds.pop_front();
+                if (shared_ret_val == MAP_FAILED) {
+                    std::cerr << "ERROR: Shared return value of task " << header.tid << " could not be mapped" << std::endl;
+                    shared_ret_val = nullptr;
+                    header.ret_code = DEF_RET_ERROR;
+                }
+            }
+        }
+
+        // Task exists; store return value (only sent if the return code is zero) and mark as completed
+        auto task = tasks.find(header.tid);
+        if (task != tasks.end()) {
+            if (header.ret_code == 0) {
+                if (shared_ret_val != nullptr) {
+                    task->second->setSharedRetVal(shared_ret_val, shared_size);
+                    shared_ret_val = nullptr;
+                } else {
+                    task->second->setRetVal(std::vector<char>(ret_val, ret_val + header.payload_size));
+                }
+            }
+            task->second->setRetCode(header.ret_code);
+            task->second->setCompleted(true);
+            in_flight--;
+            completed = true;
+
+            auto callback = callbacks.find(header.tid);
+            if (callback != callbacks.end()) {
+                finished.emplace_back(std::move(callback->second), std::move(task->second));
+                callbacks.erase(callback);
+                tasks.erase(task);
+            } else {
+                completed_tasks.push_back(header.tid);
+            }
+        }
+        if (shared_ret_val != nullptr) {
+            munmap(shared_ret_val, shared_size);
+        }
+        offset += frame_size;
+    }
+    guard.unlock();
+
+    // Move the incomplete frame (if any) to the start of the buffer
+    if (offset) {
+        memmove(buff.data(), buff.data() + offset, len - offset);
+        len -= offset;
+    }
+
+    if (completed) {
+        tasks_cv.notify_all();
+    }
+    for (auto &[callback, task] : finished) {
+        try {
+            callback(task.get());
+        } catch (const std::exception &e) {
+            std::cerr << "ERROR: Completion callback of task " << task->getTid() << " threw an exception: " << e.what() << std::endl;
+        }
+    }
+}
+
+void cConn::failOutstandingTasks() {
+    std::vector<std::pair<std::function<void(cTask*)>, std::unique_ptr<cTask>>> finished;
+    std::unique_lock<std::mutex> guard(tasks_lock);
+    connected = false;
+    for (auto task = tasks.begin(); task != tasks.end();) {
+        if (task->second->isCompleted()) {
+            task++;
+            continue;
+        }
+
+        task->second->setRetCode(DEF_RET_ERROR);
+        task->second->setCompleted(true);
+        in_flight--;
+
+        auto callback = callbacks.find(task->first);
+        if (callback != callbacks.end()) {
+            finished.emplace_back(std::move(callback->second), std::move(task->second));
+            callbacks.erase(callback);
+            task = tasks.erase(task);
+        } else {
+            completed_tasks.push_back(task->first);
+            task++;
+        }
+    }
+    guard.unlock();
+
+    tasks_cv.notify_all();
+    for (auto &[callback, task] : finished) {
+        try {
+            callback(task.get());
+        } catch (const std::exception &e) {
+            std::cerr << "ERROR: Completion callback of task " << task->getTid() << " threw an exception: " << e.what() << std::endl;
+        }
+    }
+}
+
 bool cConn::isTaskCompleted(int32_t tid) {
+    std::lock_guard<std::mutex> guard(tasks_lock);
     if (tasks.find(tid) != tasks.end()) {
         return tasks[tid]->isCompleted();
     } else {
@@ -0,0 +1,173 @@
+/*
+ * This file is part of the Coyote <https://github.com/fpgasystems/Coyote>
+ *
+ * MIT Licence
+ * Copyright (c) 2025, Systems Group, ETH Zurich
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <algorithm>
+
+#include <coyote/cConnGroup.hpp>
+
+namespace coyote {
+
+void cConnGroup::addService(std::string sock_name) {
+    std::lock_guard<std::mutex> guard(lock);
+    services.emplace_back(std::make_unique<groupService>());
+    services.back()->sock_name = sock_name;
+    connect(*services.back());
+}
+
+void cConnGroup::addService(std::string server_address, uint16_t port) {
+    std::lock_guard<std::mutex> guard(lock);
+    services.emplace_back(std::make_unique<groupService>());
+    services.back()->address = server_address;
+    services.back()->port = port;
+    connect(*services.back());
+}
+
+size_t cConnGroup::getNumServices() {
+    std::lock_guard<std::mutex> guard(lock);
+    return services.size();
+}
+
+size_t cConnGroup::getNumConnected() {
+    std::lock_guard<std::mutex> guard(lock);
+    size_t n = 0;
+    for (auto &service : services) {
+        if (service->conn && service->conn->isConnected()) {
+            n++;
+        }
+    }
+    return n;
+}
+
+bool cConnGroup::connect(groupService &service) {
+    try {
+        if (service.address.empty()) {
+            service.conn = std::make_unique<cConn>(service.sock_name);
+        } else {
+            service.conn = std::make_unique<cConn>(service.address, service.port);
+        }
+    } catch (const std::exception &e) {
+        std::cerr << "WARNING: Service " << service.getName() << " is unreachable; retrying in " << 
+            CONN_GROUP_RETRY_INTERVAL.count() << " ms" << std::endl;
+        service.retry_time = std::chrono::steady_clock::now() + CONN_GROUP_RETRY_INTERVAL;
+        return false;
+    }
+
+    service.has_load = false;
+    service.load_query = std::future<cServiceLoad>();
+    service.load_time = std::chrono::steady_clock::time_point();
+    return true;
+}
+
+int32_t cConnGroup::route(int32_t fid, const std::vector<bool> &tried, cConn *&conn) {
+    std::lock_guard<std::mutex> guard(lock);
+    auto now = std::chrono::steady_clock::now();
+
+    int32_t best = -1;
+    double best_load = 0;
+    for (size_t n = 0; n < services.size(); n++) {
+        size_t i = (next + n) % services.size();
+        groupService &service = *services[i];
+        if (i < tried.size() && tried[i]) {
+            continue;
+        }
+
+        // Unreachable or lost services are reconnected once their retry interval has passed
+        if (service.conn && !service.conn->isConnected()) {
+            service.retired.emplace_back(std::move(service.conn));
+            service.retry_time = now + CONN_GROUP_RETRY_INTERVAL;
+        }
+        if (!service.conn && (now < service.retry_time || !connect(service))) {
+            continue;
+        }
+
+        // Collect the answer to the last load query and issue a new one once the report is stale; the query never blocks
+        // (the window of the connection can't be full, since the group's tasks in flight are below it)
+        if (service.load_query.valid() && service.load_query.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+            try {
+                service.load = service.load_query.get();
+                service.has_load = true;
+            } catch (const std::exception &e) {
+                DBG1("cConnGroup: Load query of service " << service.getName() << " failed: " << e.what());
+            }
+        }
+        if (!service.load_query.valid() && now - service.load_time >= CONN_GROUP_LOAD_INTERVAL && service.in_flight + 1 < CONN_MAX_IN_FLIGHT) {
+            try {
+                service.load_query = service.conn->queryLoad();
+                service.load_time = now;
+            } catch (const std::exception &e) {
+                service.retired.emplace_back(std::move(service.conn));
+                service.retry_time = now + CONN_GROUP_RETRY_INTERVAL;
+                continue;
+            }
+        }
+
+        // Until the first report arrives, the service is assumed to have the function registered and only the group's tasks outstanding
+        uint32_t outstanding = service.in_flight;
+        uint32_t capacity = DAEMON_MAX_TASKS;
+        if (service.has_load) {
+            if (std::find(service.load.fids.begin(), service.load.fids.end(), fid) == service.load.fids.end()) {
+                continue;
+            }
+
+            // The report includes the group's own tasks at the time of the query; these are replaced by the current count
+            const cLoadReport &report = service.load.report;
+            outstanding += report.n_outstanding - std::min(report.n_client_outstanding, report.n_outstanding);
+            capacity = std::max(std::min(report.max_tasks, report.max_client_tasks), (uint32_t) 1);
+        }
+
+        double load = (double) outstanding / capacity;
+        if (best == -1 || load < best_load) {
+            best = i;
+            best_load = load;
+        }
+    }
+
+    if (best == -1) {
+        return -1;
+    }
+
+    next = (best + 1) % services.size();
+    services[best]->in_flight++;
+    conn = services[best]->conn.get();
+    return best;
+}
+
+void cConnGroup::release(int32_t idx) {
+    std::lock_guard<std::mutex> guard(lock);
+    services[idx]->in_flight--;
+}
+
+void cConnGroup::fail(int32_t idx, cConn *conn) {
+    std::lock_guard<std::mutex> guard(lock);
+    groupService &service = *services[idx];
+    if (service.conn.get() == conn) {
+        std::cerr << "WARNING: Lost connection to service " << service.getName() << "; failing over to the other services of the group" << std::endl;
+        service.retired.emplace_back(std::move(service.conn));
+        service.retry_time = std::chrono::steady_clock::now() + CONN_GROUP_RETRY_INTERVAL;
+    }
+}
+
+}
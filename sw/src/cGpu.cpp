@@ -87,3 +87,83 @@ hsa_status_t find_gpu(hsa_agent_t agent, void *data) {
 }
 
 #endif
+
+#ifdef EN_CUDA
+
+#include <iostream>
+#include <unistd.h>
+
+namespace coyote {
+
+void* cuda_alloc_dmabuf(size_t size, uint32_t gpu_dev_id, int32_t *dmabuf_fd) {
+    // Allocations are made in the primary context of the GPU, the same as the one used by the CUDA run-time
+    CUdevice dev;
+    CUcontext ctx;
+    if (cuInit(0) != CUDA_SUCCESS || cuDeviceGet(&dev, gpu_dev_id) != CUDA_SUCCESS) {
+        std::cerr << "GPU not found. You have specified a GPU with an ID that could not be found; please provide a correct GPU ID" << std::endl;
+        return nullptr;
+    }
+    if (cuDevicePrimaryCtxRetain(&ctx, dev) != CUDA_SUCCESS || cuCtxSetCurrent(ctx) != CUDA_SUCCESS) {
+        std::cerr << "ERROR: cuda_alloc_dmabuf() - could not set the context of the GPU" << std::endl;
+        return nullptr;
+    }
+
+    int dmabuf_supported = 0;
+    cuDeviceGetAttribute(&dmabuf_supported, CU_DEVICE_ATTRIBUTE_DMA_BUF_SUPPORTED, dev);
+    if (!dmabuf_supported) {
+        std::cerr << "ERROR: cuda_alloc_dmabuf() - the GPU (or its driver) does not support dmabuf export" << std::endl;
+        cuDevicePrimaryCtxRelease(dev);
+        return nullptr;
+    }
+
+    // cuMemAlloc only guarantees a 256 B alignment, while the exported range must be aligned to the host page size;
+    // hence, one more page is allocated and the address is aligned up (the base is recovered when freeing the buffer)
+    size_t pg_size = sysconf(_SC_PAGESIZE);
+    size_t len = (size + pg_size - 1) / pg_size * pg_size;
+    CUdeviceptr base;
+    if (cuMemAlloc(&base, len + pg_size) != CUDA_SUCCESS) {
+        std::cerr << "ERROR: cuda_alloc_dmabuf() - cuMemAlloc failed to allocate GPU memory!" << std::endl;
+        cuDevicePrimaryCtxRelease(dev);
+        return nullptr;
+    }
+    CUdeviceptr mem = (base + pg_size - 1) / pg_size * pg_size;
+    
+    if (cuMemGetHandleForAddressRange(dmabuf_fd, mem, len, CU_MEM_RANGE_HANDLE_TYPE_DMA_BUF_FD, 0) != CUDA_SUCCESS) {
+        std::cerr << "ERROR: cuda_alloc_dmabuf() - GPU DMA Buff export failed!" << std::endl;
+        cuMemFree(base);
+        cuDevicePrimaryCtxRelease(dev);
+        return nullptr;
+    }
+
+    return reinterpret_cast<void *>(mem);
+}
+
+bool cuda_free_dmabuf(void *mem, int32_t dmabuf_fd) {
+    bool ok = true;
+    if (close(dmabuf_fd)) {
+        std::cerr << "ERROR: cuda_free_dmabuf() - Exported dmabuf could not be closed!" << std::endl;
+        ok = false;
+    }
+
+    // Recover the base of the allocation (the buffer was aligned up) and the GPU it belongs to, to release the primary context
+    CUdeviceptr base;
+    CUdevice dev;
+    int ordinal;
+    if (
+        cuPointerGetAttribute(&base, CU_POINTER_ATTRIBUTE_RANGE_START_ADDR, reinterpret_cast<CUdeviceptr>(mem)) != CUDA_SUCCESS ||
+        cuPointerGetAttribute(&ordinal, CU_POINTER_ATTRIBUTE_DEVICE_ORDINAL, reinterpret_cast<CUdeviceptr>(mem)) != CUDA_SUCCESS ||
+        cuMemFree(base) != CUDA_SUCCESS
+    ) {
+        std::cerr << "GPU buffers not freed properly!" << std::endl;
+        return false;
+    }
+
+    if (cuDeviceGet(&dev, ordinal) == CUDA_SUCCESS) {
+        cuDevicePrimaryCtxRelease(dev);
+    }
+    return ok;
+}
+
+}
+
+#endif
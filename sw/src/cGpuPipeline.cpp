@@ -0,0 +1,209 @@
+/*
+ * This file is part of the Coyote <https://github.com/fpgasystems/Coyote>
+ *
+ * MIT Licence
+ * Copyright (c) 2025, Systems Group, ETH Zurich
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <coyote/cGpuPipeline.hpp>
+
+#ifdef EN_GPU
+
+#include <string>
+#include <thread>
+#include <iostream>
+#include <stdexcept>
+
+namespace coyote {
+
+cGpuPipeline::cGpuPipeline(cThread &thread, uint64_t slot_size, uint32_t n_slots, uint32_t gpu_id) : thread(thread), slot_size(slot_size) {
+    if (!n_slots || !slot_size) {
+        throw std::runtime_error("ERROR: cGpuPipeline() - the number of slots and their size must be non-zero");
+    }
+
+    if (hipSetDevice(gpu_id) != hipSuccess) {
+        throw std::runtime_error("ERROR: cGpuPipeline() - could not select the GPU");
+    }
+
+    // The buffers are exported as dmabufs and attached to the vFPGA once; items only reuse them
+    slots.resize(n_slots);
+    for (uint32_t i = 0; i < n_slots; i++) {
+        slotEntry &entry = slots[i];
+        entry.state = slotState::FREE;
+        entry.slot.idx = i;
+        entry.slot.item = 0;
+        entry.slot.len = 0;
+        entry.slot.src = thread.getMem({CoyoteAllocType::GPU, slot_size, false, gpu_id});
+        entry.slot.dst = thread.getMem({CoyoteAllocType::GPU, slot_size, false, gpu_id});
+        if (!entry.slot.src || !entry.slot.dst) {
+            throw std::runtime_error("ERROR: cGpuPipeline() - could not allocate the GPU buffers");
+        }
+
+        if (hipStreamCreateWithFlags(&entry.slot.stream, hipStreamNonBlocking) != hipSuccess) {
+            throw std::runtime_error("ERROR: cGpuPipeline() - could not create a HIP stream");
+        }
+        if (hipEventCreateWithFlags(&entry.event, hipEventDisableTiming) != hipSuccess) {
+            throw std::runtime_error("ERROR: cGpuPipeline() - could not create a HIP event");
+        }
+        if (hsa_signal_create(0, 0, nullptr, &entry.slot.fpga_done) != HSA_STATUS_SUCCESS) {
+            throw std::runtime_error("ERROR: cGpuPipeline() - could not create an HSA signal");
+        }
+    }
+
+    fpga_base = thread.checkCompleted(CoyoteOper::LOCAL_TRANSFER);
+}
+
+cGpuPipeline::~cGpuPipeline() {
+    try {
+        drain();
+    } catch (const std::exception &e) {
+        std::cerr << "ERROR: ~cGpuPipeline() - " << e.what() << std::endl;
+    }
+
+    for (slotEntry &entry : slots) {
+        hsa_signal_destroy(entry.slot.fpga_done);
+        hipEventDestroy(entry.event);
+        hipStreamDestroy(entry.slot.stream);
+        thread.freeMem(entry.slot.src);
+        thread.freeMem(entry.slot.dst);
+    }
+}
+
+void cGpuPipeline::setPreStage(gpuStage stage) {
+    pre_stage = std::move(stage);
+}
+
+void cGpuPipeline::setPostStage(gpuStage stage) {
+    post_stage = std::move(stage);
+}
+
+void cGpuPipeline::setStreams(uint32_t src_dest, uint32_t dst_dest) {
+    this->src_dest = src_dest;
+    this->dst_dest = dst_dest;
+}
+
+bool cGpuPipeline::gpuDone(slotEntry &entry) {
+    hipError_t err = hipEventQuery(entry.event);
+    if (err == hipErrorNotReady) {
+        return false;
+    }
+    if (err != hipSuccess) {
+        throw std::runtime_error("ERROR: cGpuPipeline - GPU stage of slot " + std::to_string(entry.slot.idx) + " failed: " + hipGetErrorString(err));
+    }
+    return true;
+}
+
+void cGpuPipeline::startFpga(slotEntry &entry) {
+    // The vFPGA reads and writes the GPU memory directly, through the attached dmabufs
+    hsa_signal_store_screlease(entry.slot.fpga_done, 1);
+    localSg src_sg = { .addr = entry.slot.src, .len = entry.slot.len, .dest = src_dest };
+    localSg dst_sg = { .addr = entry.slot.dst, .len = entry.slot.len, .dest = dst_dest };
+    thread.invoke(CoyoteOper::LOCAL_TRANSFER, src_sg, dst_sg);
+    fpga_queue.push_back(entry.slot.idx);
+    entry.state = slotState::FPGA;
+}
+
+void cGpuPipeline::startPost(slotEntry &entry) {
+    if (post_stage) {
+        post_stage(entry.slot);
+        if (hipEventRecord(entry.event, entry.slot.stream) != hipSuccess) {
+            throw std::runtime_error("ERROR: cGpuPipeline - could not record a HIP event");
+        }
+        entry.state = slotState::POST;
+    } else {
+        entry.state = slotState::FREE;
+        n_completed++;
+    }
+}
+
+uint32_t cGpuPipeline::progress() {
+    uint64_t completed = n_completed;
+
+    // vFPGA completions, in issue order; the second GPU stage of a slot is enqueued as soon as its transfer completed
+    uint32_t fpga_total = thread.checkCompleted(CoyoteOper::LOCAL_TRANSFER) - fpga_base;
+    while (fpga_completed != fpga_total && !fpga_queue.empty()) {
+        slotEntry &entry = slots[fpga_queue.front()];
+        fpga_queue.pop_front();
+        fpga_completed++;
+        hsa_signal_store_screlease(entry.slot.fpga_done, 0);
+        startPost(entry);
+    }
+
+    // GPU stages
+    for (slotEntry &entry : slots) {
+        if (entry.state == slotState::PRE && gpuDone(entry)) {
+            startFpga(entry);
+        } else if (entry.state == slotState::POST && gpuDone(entry)) {
+            entry.state = slotState::FREE;
+            n_completed++;
+        }
+    }
+
+    return (uint32_t) (n_completed - completed);
+}
+
+uint64_t cGpuPipeline::submit(uint64_t len) {
+    if (len > slot_size) {
+        throw std::runtime_error("ERROR: cGpuPipeline::submit() - the item is larger than the slot size");
+    }
+
+    slotEntry &entry = slots[next_slot];
+    while (entry.state != slotState::FREE) {
+        if (!progress()) {
+            std::this_thread::yield();
+        }
+    }
+    next_slot = (next_slot + 1) % slots.size();
+
+    entry.slot.item = n_submitted++;
+    entry.slot.len = len;
+    if (pre_stage) {
+        pre_stage(entry.slot);
+        if (hipEventRecord(entry.event, entry.slot.stream) != hipSuccess) {
+            throw std::runtime_error("ERROR: cGpuPipeline::submit() - could not record a HIP event");
+        }
+        entry.state = slotState::PRE;
+    } else {
+        startFpga(entry);
+    }
+
+    return entry.slot.item;
+}
+
+void cGpuPipeline::drain() {
+    while (n_completed != n_submitted) {
+        if (!progress()) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+void cGpuPipeline::run(uint64_t n_items, uint64_t len) {
+    for (uint64_t i = 0; i < n_items; i++) {
+        submit(len);
+    }
+    drain();
+}
+
+}
+
+#endif
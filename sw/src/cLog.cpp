@@ -0,0 +1,217 @@
+/*
+ * This file is part of the Coyote <https://github.com/fpgasystems/Coyote>
+ *
+ * MIT Licence
+ * Copyright (c) 2025, Systems Group, ETH Zurich
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <new>
+#include <mutex>
+#include <thread>
+#include <cstdio>
+#include <cstdarg>
+#include <cstdlib>
+#include <condition_variable>
+
+#include <pthread.h>
+
+#include <coyote/cLog.hpp>
+#include <coyote/cThreadConfig.hpp>
+
+namespace coyote {
+
+static_assert((LOG_RING_ENTRIES & (LOG_RING_ENTRIES - 1)) == 0, "LOG_RING_ENTRIES must be a power of two");
+
+namespace {
+
+/// A message in the ring; seq tells whether the slot is free (== position) or holds a message (== position + 1)
+struct logSlot {
+    std::atomic<uint64_t> seq;
+    int priority;
+    char msg[LOG_MSG_SIZE];
+};
+
+/// State of the logger; never destroyed, so that messages can be logged (and flushed) while static objects are destroyed
+struct logState {
+    logSlot slots[LOG_RING_ENTRIES];
+
+    /// Next position to be claimed by a producer, and next position to be written out by the drain thread
+    alignas(64) std::atomic<uint64_t> enq_pos = { 0 };
+    alignas(64) std::atomic<uint64_t> deq_pos = { 0 };
+
+    /// Messages dropped since the last report, since the ring was full
+    std::atomic<uint64_t> dropped = { 0 };
+
+    /// Whether the drain thread runs (in this process) and whether it waits for messages
+    std::atomic<bool> started = { false };
+    std::atomic<bool> sleeping = { false };
+
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::condition_variable flush_cv;
+
+    logState() {
+        for (uint64_t i = 0; i < LOG_RING_ENTRIES; i++) {
+            slots[i].seq.store(i, std::memory_order_relaxed);
+        }
+    }
+};
+
+logState& state() {
+    static logState *st = new logState();
+    return *st;
+}
+
+/// Writes out all the published messages; returns false if there were none
+bool drain(logState &st) {
+    bool drained = false;
+    uint64_t pos = st.deq_pos.load(std::memory_order_relaxed);
+    while (true) {
+        logSlot &slot = st.slots[pos & (LOG_RING_ENTRIES - 1)];
+        if (slot.seq.load(std::memory_order_acquire) != pos + 1) {
+            break;
+        }
+
+        syslog(slot.priority, "%s", slot.msg);
+        slot.seq.store(pos + LOG_RING_ENTRIES, std::memory_order_release);
+        st.deq_pos.store(++pos, std::memory_order_release);
+        drained = true;
+    }
+
+    uint64_t dropped = st.dropped.exchange(0, std::memory_order_relaxed);
+    if (dropped) {
+        syslog(LOG_WARNING, "cLog: %lu messages dropped, since the log ring was full", static_cast<unsigned long>(dropped));
+    }
+    return drained;
+}
+
+void drainLoop() {
+    cThreadConfig::apply(CoyoteThreadRole::LOG);
+    logState &st = state();
+    while (true) {
+        if (drain(st)) {
+            std::lock_guard<std::mutex> guard(st.mtx);
+            st.flush_cv.notify_all();
+            continue;
+        }
+
+        // Producers only notify while the thread is sleeping; the timeout covers a message published just before
+        std::unique_lock<std::mutex> guard(st.mtx);
+        st.sleeping.store(true);
+        uint64_t pos = st.deq_pos.load(std::memory_order_relaxed);
+        if (st.slots[pos & (LOG_RING_ENTRIES - 1)].seq.load(std::memory_order_acquire) != pos + 1) {
+            st.cv.wait_for(guard, std::chrono::milliseconds(50));
+        }
+        st.sleeping.store(false);
+    }
+}
+
+void afterFork() {
+    // Only the forking thread exists in the child; the drain thread is started again on the next message.
+    // The queued messages are left to the parent, which writes them out, so they are not logged twice
+    logState &st = state();
+    uint64_t enq = st.enq_pos.load();
+    for (uint64_t pos = st.deq_pos.load(); pos < enq; pos++) {
+        st.slots[pos & (LOG_RING_ENTRIES - 1)].seq.store(pos + LOG_RING_ENTRIES);
+    }
+    st.deq_pos.store(enq);
+    st.dropped.store(0);
+    new (&st.mtx) std::mutex();
+    new (&st.cv) std::condition_variable();
+    new (&st.flush_cv) std::condition_variable();
+    st.sleeping.store(false);
+    st.started.store(false);
+}
+
+void startDrain() {
+    static std::once_flag once;
+    std::call_once(once, [] {
+        pthread_atfork(nullptr, nullptr, afterFork);
+        atexit(cLog::flush);
+    });
+
+    logState &st = state();
+    std::lock_guard<std::mutex> guard(st.mtx);
+    if (!st.started.load()) {
+        std::thread(drainLoop).detach();
+        st.started.store(true, std::memory_order_release);
+    }
+}
+
+}
+
+std::atomic<int> cLog::level(LOG_INFO);
+
+void cLog::log(int priority, const char *format, ...) {
+    logState &st = state();
+    if (!st.started.load(std::memory_order_acquire)) {
+        startDrain();
+    }
+
+    // Claim a slot; if the oldest message was not written out yet, the ring is full
+    uint64_t pos = st.enq_pos.load(std::memory_order_relaxed);
+    logSlot *slot;
+    while (true) {
+        slot = &st.slots[pos & (LOG_RING_ENTRIES - 1)];
+        int64_t diff = static_cast<int64_t>(slot->seq.load(std::memory_order_acquire) - pos);
+        if (diff == 0) {
+            if (st.enq_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                break;
+            }
+        } else if (diff < 0) {
+            st.dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        } else {
+            pos = st.enq_pos.load(std::memory_order_relaxed);
+        }
+    }
+
+    slot->priority = priority;
+    va_list args;
+    va_start(args, format);
+    vsnprintf(slot->msg, LOG_MSG_SIZE, format, args);
+    va_end(args);
+    slot->seq.store(pos + 1, std::memory_order_seq_cst);
+
+    if (st.sleeping.load(std::memory_order_seq_cst)) {
+        std::lock_guard<std::mutex> guard(st.mtx);
+        st.cv.notify_one();
+    }
+}
+
+void cLog::flush() {
+    logState &st = state();
+    if (!st.started.load(std::memory_order_acquire)) {
+        return;
+    }
+
+    // Bounded, since a message claimed by a thread which never finishes it (e.g., interrupted by exit()) stalls the drain
+    uint64_t target = st.enq_pos.load();
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+    std::unique_lock<std::mutex> guard(st.mtx);
+    st.cv.notify_one();
+    while (st.deq_pos.load(std::memory_order_acquire) < target && std::chrono::steady_clock::now() < deadline) {
+        st.flush_cv.wait_for(guard, std::chrono::milliseconds(10));
+    }
+}
+
+}
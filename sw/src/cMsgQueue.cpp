@@ -0,0 +1,128 @@
+/*
+ * This file is part of the Coyote <https://github.com/fpgasystems/Coyote>
+ *
+ * MIT Licence
+ * Copyright (c) 2025, Systems Group, ETH Zurich
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <coyote/cMsgQueue.hpp>
+
+namespace coyote {
+
+cMsgQueue::cMsgQueue(cThread *cthread, uint32_t qp, uint64_t offset, uint32_t n_slots, uint32_t slot_size) :
+    cthread(cthread), qp(qp), offset(offset), n_slots(n_slots), slot_size(slot_size) {
+    if (!cthread) {
+        throw std::runtime_error("ERROR: cMsgQueue requires a cThread");
+    }
+    if (!n_slots || slot_size < 64 || slot_size % 64) {
+        throw std::runtime_error("ERROR: cMsgQueue requires at least one slot and a slot size which is a multiple of 64 bytes");
+    }
+
+    ibvQp *qpair = cthread->getQpair(qp);
+    if (!qpair->local.vaddr || offset + getRegionSize(n_slots, slot_size) > qpair->local.size) {
+        throw std::runtime_error("ERROR: cMsgQueue region doesn't fit the buffer of QP " + std::to_string(qp));
+    }
+
+    base = (char*) qpair->local.vaddr + offset;
+    memset(base, 0, getRegionSize(n_slots, slot_size));
+}
+
+void cMsgQueue::writeSlot(uint64_t local_offs, uint64_t remote_offs) {
+    rdmaSg sg;
+    sg.local_offs = offset + local_offs;
+    sg.remote_offs = offset + remote_offs;
+    sg.len = slot_size;
+    sg.qp = qp;
+    cthread->invoke(CoyoteOper::REMOTE_RDMA_WRITE, sg);
+}
+
+uint32_t cMsgQueue::getCredits() const {
+    uint64_t consumed = *seqAt(rxCreditOffs());
+    return n_slots - (uint32_t) (n_sent - consumed);
+}
+
+bool cMsgQueue::trySend(const void *data, uint32_t len) {
+    if (len > getMaxMessageSize()) {
+        throw std::runtime_error("ERROR: cMsgQueue message of " + std::to_string(len) + " bytes exceeds the slot size");
+    }
+    if (!getCredits()) {
+        return false;
+    }
+
+    // Fill the TX slot (length, payload, then the sequence number) and write it to the peer's RX slot
+    char *slot = base + txOffs(n_sent);
+    memcpy(slot, &len, sizeof(uint32_t));
+    memcpy(slot + sizeof(uint64_t), data, len);
+    *seqAt(txOffs(n_sent)) = n_sent + 1;
+
+    writeSlot(txOffs(n_sent), rxOffs(n_sent));
+    n_sent++;
+    return true;
+}
+
+void cMsgQueue::send(const void *data, uint32_t len) {
+    while (!trySend(data, len)) {
+        _mm_pause();
+    }
+}
+
+bool cMsgQueue::tryRecv(void *data, uint32_t max_len, uint32_t &len) {
+    // The sequence number is placed last, so all of the message is visible once it matches
+    if (*seqAt(rxOffs(n_received)) != n_received + 1) {
+        return false;
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+
+    const char *slot = base + rxOffs(n_received);
+    memcpy(&len, slot, sizeof(uint32_t));
+    if (len > max_len || len > getMaxMessageSize()) {
+        throw std::runtime_error("ERROR: cMsgQueue received a message of " + std::to_string(len) + " bytes, exceeding the buffer");
+    }
+    memcpy(data, slot + sizeof(uint64_t), len);
+    n_received++;
+
+    if (n_received - n_credited >= std::max<uint32_t>(1, n_slots / 2)) {
+        flushCredits();
+    }
+    return true;
+}
+
+uint32_t cMsgQueue::recv(void *data, uint32_t max_len) {
+    uint32_t len;
+    while (!tryRecv(data, max_len, len)) {
+        _mm_pause();
+    }
+    return len;
+}
+
+void cMsgQueue::flushCredits() {
+    if (n_credited == n_received) {
+        return;
+    }
+
+    // The count is monotonic, so a replay of an older update carrying a smaller count is harmless
+    *seqAt(txCreditOffs()) = n_received;
+    writeSlot(txCreditOffs(), rxCreditOffs());
+    n_credited = n_received;
+}
+
+}
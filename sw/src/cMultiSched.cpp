@@ -0,0 +1,228 @@
+/*
+ * This file is part of the Coyote <https://github.com/fpgasystems/Coyote>
+ *
+ * MIT Licence
+ * Copyright (c) 2025, Systems Group, ETH Zurich
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <coyote/cMultiSched.hpp>
+
+namespace coyote {
+
+cMultiSched::cMultiSched(std::vector<cRegion> regions, bool reorder) {
+    if (regions.empty()) {
+        throw std::runtime_error("ERROR: cMultiSched requires at least one vFPGA region");
+    }
+
+    for (cRegion &region : regions) {
+        this->regions.push_back({region, cSched::getInstance(region.vfid, region.device, reorder), std::chrono::steady_clock::now()});
+    }
+}
+
+cSched* cMultiSched::taskScheduler(int32_t tid) {
+    std::lock_guard<std::mutex> guard(lock);
+    auto it = task_regions.find(tid);
+    if (it == task_regions.end()) {
+        return nullptr;
+    }
+    return regions[it->second].scheduler;
+}
+
+void cMultiSched::start() {
+    for (regionSched &r : regions) {
+        r.scheduler->start();
+    }
+}
+
+void cMultiSched::stop() {
+    for (regionSched &r : regions) {
+        r.scheduler->stop();
+    }
+}
+
+void cMultiSched::setLazyBitstreams(bool lazy) {
+    for (regionSched &r : regions) {
+        r.scheduler->setLazyBitstreams(lazy);
+    }
+}
+
+void cMultiSched::setTaskLogging(bool log_tasks) {
+    for (regionSched &r : regions) {
+        r.scheduler->setTaskLogging(log_tasks);
+    }
+}
+
+void cMultiSched::setCompletionCallback(std::function<void(cTask*)> callback) {
+    for (regionSched &r : regions) {
+        r.scheduler->setCompletionCallback(callback);
+    }
+}
+
+int cMultiSched::addFunction(uint32_t idx, std::unique_ptr<bFunc> fn) {
+    if (idx >= regions.size()) {
+        CYT_LOG(LOG_WARNING, "Region with index %u does not exist, cannot add function", idx);
+        return 3;
+    }
+    return regions[idx].scheduler->addFunction(std::move(fn));
+}
+
+std::vector<int> cMultiSched::addFunctions(uint32_t idx, std::vector<std::unique_ptr<bFunc>> fns) {
+    if (idx >= regions.size()) {
+        CYT_LOG(LOG_WARNING, "Region with index %u does not exist, cannot add functions", idx);
+        return std::vector<int>(fns.size(), 3);
+    }
+    return regions[idx].scheduler->addFunctions(std::move(fns));
+}
+
+bool cMultiSched::isFunctionRegistered(int32_t fid) {
+    for (regionSched &r : regions) {
+        if (r.scheduler->isFunctionRegistered(fid)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bFunc* cMultiSched::getFunction(int32_t fid) {
+    for (regionSched &r : regions) {
+        if (r.scheduler->isFunctionRegistered(fid)) {
+            return r.scheduler->getFunction(fid);
+        }
+    }
+    CYT_LOG(LOG_WARNING, "Function with ID %d not found in any region, returning nullptr", fid);
+    return nullptr;
+}
+
+std::vector<int32_t> cMultiSched::getFunctionIds() {
+    std::set<int32_t> fids;
+    for (regionSched &r : regions) {
+        for (int32_t fid : r.scheduler->getFunctionIds()) {
+            fids.insert(fid);
+        }
+    }
+    return std::vector<int32_t>(fids.begin(), fids.end());
+}
+
+int32_t cMultiSched::pickRegion(int32_t fid) {
+    std::lock_guard<std::mutex> guard(lock);
+
+    // Rank of a region: 0 if idle and holding the right bitstream, 1 if idle, 2 if busy
+    // Lower ranks are preferred; within a rank, busy regions are compared by their cost and the rest by their last use
+    int32_t best = -1;
+    int best_rank = 0;
+    size_t best_cost = 0;
+    for (uint32_t i = 0; i < regions.size(); i++) {
+        cSched *scheduler = regions[i].scheduler;
+        if (!scheduler->isFunctionRegistered(fid)) {
+            continue;
+        }
+
+        bool loaded = scheduler->getCurrentBitstream() == scheduler->getFunction(fid)->getBitstreamPath();
+        size_t load = scheduler->getLoad();
+        int rank = load ? 2 : (loaded ? 0 : 1);
+        size_t cost = load + (loaded ? 0 : 1);
+
+        bool better = best == -1 || rank < best_rank || (
+            rank == best_rank && (
+                (rank == 2 && cost < best_cost) || 
+                ((rank != 2 || cost == best_cost) && regions[i].last_used < regions[best].last_used)
+            )
+        );
+        if (better) {
+            best = i;
+            best_rank = rank;
+            best_cost = cost;
+        }
+    }
+
+    if (best == -1) {
+        return best;
+    }
+
+    regions[best].last_used = std::chrono::steady_clock::now();
+    CYT_LOG(
+        LOG_NOTICE, "Dispatching task of fid %d to device %u, vfid %d (rank %d, outstanding tasks %zu)", 
+        fid, regions[best].region.device, regions[best].region.vfid, best_rank, best_cost
+    );
+
+    // Keep another idle region warm with this function's bitstream, so that its next task doesn't wait for a reconfiguration:
+    // unless an idle region already holds the bitstream, the least recently used idle region is reconfigured in the background
+    int32_t spare = -1;
+    bool warm = false;
+    for (uint32_t i = 0; i < regions.size() && !warm; i++) {
+        cSched *scheduler = regions[i].scheduler;
+        if (i == best || !scheduler->isFunctionRegistered(fid) || scheduler->getLoad()) {
+            continue;
+        }
+
+        warm = scheduler->getCurrentBitstream() == scheduler->getFunction(fid)->getBitstreamPath();
+        if (spare == -1 || regions[i].last_used < regions[spare].last_used) {
+            spare = i;
+        }
+    }
+
+    if (!warm && spare != -1 && regions[spare].scheduler->preload(fid)) {
+        regions[spare].last_used = std::chrono::steady_clock::now();
+        CYT_LOG(LOG_NOTICE, "Pre-loading fid %d to device %u, vfid %d", fid, regions[spare].region.device, regions[spare].region.vfid);
+    }
+
+    return best;
+}
+
+bool cMultiSched::addTask(uint32_t idx, std::unique_ptr<cTask> task) {
+    if (idx >= regions.size() || task == nullptr) {
+        CYT_LOG(LOG_WARNING, "Invalid region index %u or null task, cannot add task", idx);
+        return false;
+    }
+
+    int32_t tid = task->getTid();
+    if (!regions[idx].scheduler->addTask(std::move(task))) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> guard(lock);
+    task_regions[tid] = idx;
+    return true;
+}
+
+bool cMultiSched::isTaskCompleted(int32_t tid) {
+    cSched *scheduler = taskScheduler(tid);
+    return scheduler != nullptr && scheduler->isTaskCompleted(tid);
+}
+
+cTask* cMultiSched::getTask(int32_t tid) {
+    cSched *scheduler = taskScheduler(tid);
+    return scheduler != nullptr ? scheduler->getTask(tid) : nullptr;
+}
+
+bool cMultiSched::releaseTask(int32_t tid) {
+    cSched *scheduler = taskScheduler(tid);
+    if (scheduler == nullptr || !scheduler->releaseTask(tid)) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> guard(lock);
+    task_regions.erase(tid);
+    return true;
+}
+
+}
@@ -0,0 +1,295 @@
+/*
+ * This file is part of the Coyote <https://github.com/fpgasystems/Coyote>
+ *
+ * MIT Licence
+ * Copyright (c) 2025, Systems Group, ETH Zurich
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#include <sched.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/ioctl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+#include <coyote/cNotifyReactor.hpp>
+#include <coyote/cThreadConfig.hpp>
+
+namespace coyote {
+
+std::map<int32_t, cNotifyReactor*> coyote::cNotifyReactor::reactors;
+
+static std::mutex reactors_lock;
+
+/// Binds the calling thread to the CPUs of a NUMA node, as listed in sysfs (e.g., 0-15,32-47); best effort
+static void bindToNode(int32_t node) {
+    std::ifstream cpulist_file("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+    std::string cpulist;
+    if (!std::getline(cpulist_file, cpulist)) {
+        return;
+    }
+
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    std::stringstream ss(cpulist);
+    std::string range;
+    while (std::getline(ss, range, ',')) {
+        size_t dash = range.find('-');
+        int first = std::stoi(range.substr(0, dash));
+        int last = dash == std::string::npos ? first : std::stoi(range.substr(dash + 1));
+        for (int cpu = first; cpu <= last && cpu < CPU_SETSIZE; cpu++) {
+            CPU_SET(cpu, &cpu_set);
+        }
+    }
+
+    if (pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set)) {
+        DBG1("cNotifyReactor: could not bind the reactor thread to NUMA node " << node);
+    }
+}
+
+cNotifyReactor::cNotifyReactor(int32_t node): node(node) {
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd == -1) {
+        throw std::runtime_error("ERROR: cNotifyReactor could not create epoll file, exiting...");
+    }
+
+    terminate_efd = eventfd(0, EFD_CLOEXEC);
+    if (terminate_efd == -1) {
+        close(epoll_fd);
+        throw std::runtime_error("ERROR: cNotifyReactor could not create eventfd, exiting...");
+    }
+
+    struct epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.fd = terminate_efd;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, terminate_efd, &event)) {
+        close(terminate_efd);
+        close(epoll_fd);
+        throw std::runtime_error("ERROR: cNotifyReactor failed to add terminate_efd event to epoll, exiting...");
+    }
+
+    reactor_thread = std::thread(&cNotifyReactor::react, this);
+}
+
+cNotifyReactor::~cNotifyReactor() {
+    eventfd_write(terminate_efd, 1);
+    if (reactor_thread.joinable()) {
+        reactor_thread.join();
+    }
+
+    close(terminate_efd);
+    close(epoll_fd);
+}
+
+cNotifyReactor* cNotifyReactor::getInstance(int32_t node) {
+    std::lock_guard<std::mutex> guard(reactors_lock);
+    if (reactors.find(node) == reactors.end() || reactors[node] == nullptr) {
+        reactors[node] = new cNotifyReactor(node);
+    }
+    return reactors[node];
+}
+
+void cNotifyReactor::setExecutor(executor_t executor) {
+    std::lock_guard<std::mutex> guard(rlock);
+    this->executor = std::move(executor);
+}
+
+void cNotifyReactor::add(int fd, int efd, int32_t ctid, notifyRing *ring, std::function<void(int)> uisr) {
+    DBG1("cNotifyReactor: Adding eventfd " << efd << " of ctid " << ctid);
+
+    std::shared_ptr<source> src = std::make_shared<source>();
+    src->fd = fd;
+    src->efd = efd;
+    src->ctid = ctid;
+    src->ring = ring;
+    src->uisr = std::move(uisr);
+
+    {
+        std::lock_guard<std::mutex> guard(rlock);
+        sources[efd] = src;
+    }
+
+    struct epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.fd = efd;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, efd, &event)) {
+        std::lock_guard<std::mutex> guard(rlock);
+        sources.erase(efd);
+        throw std::runtime_error("ERROR: cNotifyReactor failed to add efd event to epoll, exiting...");
+    }
+
+    // Coalesced mode: the ring must be drained and armed once, before the driver signals the eventfd
+    if (ring) {
+        dispatch(src);
+    }
+}
+
+void cNotifyReactor::remove(int efd) {
+    DBG1("cNotifyReactor: Removing eventfd " << efd);
+
+    std::shared_ptr<source> src;
+    {
+        std::lock_guard<std::mutex> guard(rlock);
+        auto it = sources.find(efd);
+        if (it == sources.end()) {
+            return;
+        }
+        src = it->second;
+        sources.erase(it);
+    }
+    epoll_ctl(epoll_fd, EPOLL_CTL_DEL, efd, nullptr);
+
+    // The job uses the cThread's file descriptor and ring, so it must complete before the cThread goes away
+    // The reactor thread may still hold the source; once removed is set, it doesn't dispatch another job
+    src->removed.store(true);
+    while (src->pending.load() != 0) {
+        std::this_thread::yield();
+    }
+}
+
+uint32_t cNotifyReactor::drain(notifyRing *ring, const std::function<void(int)> &uisr) {
+    uint32_t tail = ring->tail;
+    uint32_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    for (uint32_t i = tail; i != head; i++) {
+        uisr(ring->values[i & (NOTIFY_RING_ENTRIES - 1)]);
+    }
+
+    // Release the slots only after the values were consumed, since the driver overwrites them
+    __atomic_store_n(&ring->tail, head, __ATOMIC_RELEASE);
+    return head - tail;
+}
+
+void cNotifyReactor::handle(const std::shared_ptr<source> &src) {
+    uint32_t n = src->pending.load();
+    while (true) {
+        if (src->ring) {
+            // Coalesced mode: drain the ring and arm it; re-check it afterwards, since values pushed
+            // before the driver saw the ring armed don't signal the eventfd
+            do {
+                drain(src->ring, src->uisr);
+                __atomic_store_n(&src->ring->armed, 1, __ATOMIC_SEQ_CST);
+            } while (__atomic_load_n(&src->ring->head, __ATOMIC_SEQ_CST) != src->ring->tail);
+        } else {
+            // Get the interrupt value via IOCTL and acknowledge it once the uisr returns, same as the cThread's interrupt thread
+            uint64_t tmp[MAX_USER_ARGS];
+            tmp[0] = src->ctid;
+            if (ioctl(src->fd, IOCTL_GET_NOTIFICATION_VALUE, &tmp)) {
+                std::cerr << "ERROR: IOCTL_GET_NOTIFICATION_VALUE failed, ctid: " << src->ctid << std::endl;
+            } else {
+                uint32_t isr_val = tmp[0];
+                DBG1("cNotifyReactor: Caught an event for ctid " << src->ctid << " which is " << isr_val);
+                src->uisr(isr_val);
+
+                tmp[0] = src->ctid;
+                if (ioctl(src->fd, IOCTL_SET_NOTIFICATION_PROCESSED, &tmp)) {
+                    std::cerr << "ERROR: IOCTL_SET_NOTIFICATION_PROCESSED failed, ctid: " << src->ctid << std::endl;
+                }
+            }
+        }
+
+        // Done, unless more wake-ups arrived in the meantime
+        uint32_t prev = src->pending.fetch_sub(n);
+        if (prev == n) {
+            break;
+        }
+        n = prev - n;
+    }
+}
+
+void cNotifyReactor::dispatch(const std::shared_ptr<source> &src) {
+    // A job is outstanding; it handles this wake-up, too
+    if (src->pending.fetch_add(1) != 0) {
+        return;
+    }
+    if (src->removed.load()) {
+        src->pending.fetch_sub(1);
+        return;
+    }
+
+    executor_t exec;
+    {
+        std::lock_guard<std::mutex> guard(rlock);
+        exec = executor;
+    }
+
+    if (exec) {
+        exec([src] { handle(src); });
+    } else {
+        handle(src);
+    }
+}
+
+void cNotifyReactor::react() {
+    DBG1("cNotifyReactor: Starting reactor thread for NUMA node " << node);
+    if (node >= 0) {
+        bindToNode(node);
+    }
+
+    // A configured CPU set takes precedence over the NUMA node
+    cThreadConfig::apply(CoyoteThreadRole::REACTOR, node);
+
+    struct epoll_event events[DAEMON_MAX_EVENTS];
+    bool running = true;
+    while (running) {
+        int event_count = epoll_wait(epoll_fd, events, DAEMON_MAX_EVENTS, -1);
+        if (event_count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::cerr << "ERROR: cNotifyReactor epoll_wait failed, stopping the reactor thread" << std::endl;
+            break;
+        }
+
+        for (int i = 0; i < event_count; i++) {
+            int efd = events[i].data.fd;
+            if (efd == terminate_efd) {
+                DBG1("cNotifyReactor: caught a termination event");
+                running = false;
+                continue;
+            }
+
+            std::shared_ptr<source> src;
+            {
+                std::lock_guard<std::mutex> guard(rlock);
+                auto it = sources.find(efd);
+                if (it == sources.end()) {
+                    continue;
+                }
+                src = it->second;
+            }
+
+            eventfd_t val;
+            if (eventfd_read(efd, &val) != 0) {
+                continue;
+            }
+            dispatch(src);
+        }
+    }
+
+    DBG1("cNotifyReactor: Stopping reactor thread for NUMA node " << node);
+}
+
+}
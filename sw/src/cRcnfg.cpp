@@ -24,12 +24,20 @@
  * SOFTWARE.
  */
 
+#include <thread>
+#include <cstring>
+#include <sys/stat.h>
+#include <sys/eventfd.h>
+
 #include <coyote/cRcnfg.hpp>
+#include <coyote/cTracer.hpp>
+#include <coyote/cThreadConfig.hpp>
 
 namespace coyote {
 std::atomic<uint32_t> cRcnfg::crid_gen; 
+std::mutex cRcnfg::alloc_lock;
 
-cRcnfg::cRcnfg(unsigned int device): mlock(boost::interprocess::open_or_create, "reconfig_mtx") {
+cRcnfg::cRcnfg(unsigned int device) {
 	DBG2("cRcnfg: Constructor called");
 
 	// Issue driver call to obtain the file descriptor for this (physical) FPGA
@@ -45,12 +53,24 @@ cRcnfg::cRcnfg(unsigned int device): mlock(boost::interprocess::open_or_create,
 }
 
 cRcnfg::~cRcnfg() {
-	// Free dynamically allocated memory, remove mutex and close file descriptor
+	// Free dynamically allocated memory and close file descriptor
 	DBG2("cRcnfg: Destructor called");
-	for (auto &it: mapped_pages) {
-		freeMem(it.first);
+
+	// The bitstream memory must not be released while the driver may still read it
+	while (!reconfig_pending.empty()) {
+		try {
+			waitReconfiguration(*reconfig_pending.begin());
+		} catch (const std::exception &e) {
+			DBG1("cRcnfg: " << e.what());
+		}
+	}
+	for (auto &efd : reconfig_efds) {
+		close(efd.second);
+	}
+
+	while (!mapped_pages.empty()) {
+		freeMem(mapped_pages.begin()->first);
 	}
-	boost::interprocess::named_mutex::remove("reconfig_mtx");
 	close(reconfig_dev_fd);
 }
 
@@ -61,7 +81,7 @@ void* cRcnfg::getMem(CoyoteAlloc&& alloc) {
 	void *mem_non_aligned = nullptr;
 	if (alloc.size > 0) {
 		if (alloc.alloc == CoyoteAllocType::PRM) {
-			mlock.lock();
+			std::unique_lock<std::mutex> guard(alloc_lock);
 
 			// Arguments be passed to the driver's IOCTL call
 			uint64_t tmp[MAX_USER_ARGS];
@@ -78,12 +98,11 @@ void* cRcnfg::getMem(CoyoteAlloc&& alloc) {
 				throw std::runtime_error("ERROR: reconfig_dev mmap() failed");
 			}
 
-			mlock.unlock();
-
 			// Align memory to hugepage and and store to the memory map (to keep information for future de-allocation)
 			mem = (void *)((((reinterpret_cast<uint64_t>(mem_non_aligned) + HUGE_PAGE_SIZE - 1) >> HUGE_PAGE_SHIFT)) << HUGE_PAGE_SHIFT);
 			alloc.mem = mem_non_aligned;
 			mapped_pages.emplace(mem, alloc);
+			guard.unlock();
 			DBG2("cRcnfg: Allocated memory mapped at 0x" << std::hex << reinterpret_cast<uint64_t>(mem) << std::dec);
 		} else {
 			throw std::runtime_error("ERROR: Unauthorized memory allocation; partial bitsream memory must use PRM (programmable region memory) allocation");
@@ -93,15 +112,50 @@ void* cRcnfg::getMem(CoyoteAlloc&& alloc) {
 	return mem;
 }
 
+void* cRcnfg::getCachedMem(uint64_t hash, uint32_t len) {
+	DBG2("cRcnfg: getCachedMem called to look up bitstream 0x" << std::hex << hash << std::dec);
+
+	std::unique_lock<std::mutex> guard(alloc_lock);
+
+	// Arguments be passed to the driver's IOCTL call; the driver returns the number of pages of the cached bitstream (0 if not cached)
+	uint64_t tmp[MAX_USER_ARGS];
+	tmp[0] = hash;
+	tmp[1] = static_cast<uint64_t>(len);
+	tmp[2] = static_cast<uint64_t>(pid);
+	tmp[3] = static_cast<uint64_t>(crid);
+
+	if (ioctl(reconfig_dev_fd, IOCTL_GET_RECONFIG_CACHE, &tmp)) {
+		throw std::runtime_error("ERROR: IOCTL_GET_RECONFIG_CACHE failed");
+	}
+	if (!tmp[0]) {
+		return nullptr;
+	}
+
+	// Cached bitstreams are shared with other processes, so they are mapped read-only
+	uint32_t n_pages = static_cast<uint32_t>(tmp[0]);
+	void *mem_non_aligned = mmap(NULL, (n_pages + 1) * HUGE_PAGE_SIZE, PROT_READ, MAP_SHARED, reconfig_dev_fd, MMAP_RECONFIG);
+	if (mem_non_aligned == MAP_FAILED) {
+		throw std::runtime_error("ERROR: reconfig_dev mmap() failed");
+	}
+
+	void *mem = (void *)((((reinterpret_cast<uint64_t>(mem_non_aligned) + HUGE_PAGE_SIZE - 1) >> HUGE_PAGE_SHIFT)) << HUGE_PAGE_SHIFT);
+	CoyoteAlloc alloc = {CoyoteAllocType::PRM, n_pages};
+	alloc.mem = mem_non_aligned;
+	mapped_pages.emplace(mem, alloc);
+	guard.unlock();
+	DBG2("cRcnfg: Cached bitstream mapped at 0x" << std::hex << reinterpret_cast<uint64_t>(mem) << std::dec);
+
+	return mem;
+}
+
 void cRcnfg::freeMem(void* virtual_address) {
 	DBG2("cRcnfg: releasePages called"); 
 
 	// Check mapping exist and is of current type (PRM)
+	std::unique_lock<std::mutex> guard(alloc_lock);
 	if (mapped_pages.find(virtual_address) != mapped_pages.end()) {
 		auto mapped = mapped_pages[virtual_address];
 		if (mapped.alloc == CoyoteAllocType::PRM) {
-				mlock.lock();
-
 				// Unmap and de-allocate bitstream memory
 				uint64_t tmp[MAX_USER_ARGS];
 				tmp[0] = reinterpret_cast<uint64_t>(virtual_address);
@@ -116,7 +170,7 @@ void cRcnfg::freeMem(void* virtual_address) {
 					throw std::runtime_error("ERROR: IOCTL_FREE_HOST_RECONFIG_MEM() failed");
 				}
 
-				mlock.unlock();
+				mapped_pages.erase(virtual_address);
 		} else {
 			throw std::runtime_error("ERROR: Unauthorized memory deallocation");
 		}     
@@ -138,21 +192,268 @@ bitstream_t cRcnfg::readBitstream(std::ifstream& fb) {
 	uint32_t n_pages = (len + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE;
 	void *vaddr = getMem({CoyoteAllocType::PRM, n_pages}); 
 
-	// Read the input-stream bytewise
-	uint8_t *vaddr_8 = reinterpret_cast<uint8_t *>(vaddr); 
-	for (uint32_t i = 0; i < len; i++) {
-		vaddr_8[i] = readByte(fb);
+	// Read the input-stream straight into the bitstream memory, in large chunks
+	char *vaddr_8 = reinterpret_cast<char *>(vaddr); 
+	for (uint32_t offs = 0; offs < len; offs += BITSTREAM_LOAD_CHUNK) {
+		std::streamsize chunk = std::min<uint64_t>(len - offs, BITSTREAM_LOAD_CHUNK);
+		if (!fb.read(vaddr_8 + offs, chunk)) {
+			throw std::runtime_error("ERROR: Bitstream could not be read");
+		}
 	}
 
 	DBG2("cRcnfg: Shell bitstream loaded");
 	return std::make_pair(vaddr, len);
 }
 
+// FNV-1a, 64-bit
+static uint64_t hashBytes(const uint8_t *data, uint64_t len, uint64_t hash = 0xcbf29ce484222325ULL) {
+	for (uint64_t i = 0; i < len; i++) {
+		hash = (hash ^ data[i]) * 0x100000001b3ULL;
+	}
+	return hash;
+}
+
+// Opens a bitstream file; returns the file descriptor and sets file_id to the identity of the file (device, inode, size and modification time)
+static int openBitstream(const std::string &bitstream_path, struct stat &st, std::string &file_id) {
+	int fd = open(bitstream_path.c_str(), O_RDONLY);
+	if (fd == -1 || fstat(fd, &st)) {
+		if (fd != -1) { close(fd); }
+		throw std::runtime_error("ERROR: Bitstream file " + bitstream_path + " could not be opened");
+	}
+
+	file_id = 
+		std::to_string(st.st_dev) + ":" + std::to_string(st.st_ino) + ":" + std::to_string(st.st_size) + ":" + 
+		std::to_string(st.st_mtim.tv_sec) + "." + std::to_string(st.st_mtim.tv_nsec);
+	return fd;
+}
+
+// Runs fn(i, offs, chunk) for each chunk of len bytes (see BITSTREAM_LOAD_CHUNK); each thread handles every n_threads-th chunk
+// Returns false if fn failed for any chunk; the remaining chunks are then skipped
+template <typename F>
+static bool forEachChunk(uint32_t len, F fn) {
+	uint32_t n_chunks = (len + BITSTREAM_LOAD_CHUNK - 1) / BITSTREAM_LOAD_CHUNK;
+	uint32_t n_threads = std::max<uint32_t>(std::min<uint32_t>(n_chunks, BITSTREAM_LOAD_THREADS), 1);
+	std::atomic<bool> failed(false);
+	auto chunkThread = [&](uint32_t first) {
+		for (uint32_t i = first; i < n_chunks && !failed; i += n_threads) {
+			uint64_t offs = (uint64_t) i * BITSTREAM_LOAD_CHUNK;
+			uint64_t chunk = std::min<uint64_t>(len - offs, BITSTREAM_LOAD_CHUNK);
+			if (!fn(i, offs, chunk)) {
+				failed = true;
+			}
+		}
+	};
+
+	std::vector<std::thread> threads;
+	for (uint32_t t = 1; t < n_threads; t++) {
+		threads.emplace_back([&, t] {
+			cThreadConfig::apply(CoyoteThreadRole::LOADER);
+			chunkThread(t);
+		});
+	}
+	chunkThread(0);
+	for (std::thread &thread : threads) {
+		thread.join();
+	}
+
+	return !failed;
+}
+
+// Hash of a bitstream, from the hashes of its chunks; the driver computes the same hash to verify cached bitstreams
+static uint64_t bitstreamHash(const std::vector<uint64_t> &chunk_hashes, uint32_t len) {
+	return hashBytes(reinterpret_cast<const uint8_t *>(chunk_hashes.data()), chunk_hashes.size() * sizeof(uint64_t), len);
+}
+
+// Reads the file in chunks, straight into the bitstream memory, and hashes each chunk
+// Returns false if the file could not be read
+static bool loadChunks(int fd, uint8_t *vaddr, uint32_t len, std::vector<uint64_t> &chunk_hashes) {
+	chunk_hashes.assign((len + BITSTREAM_LOAD_CHUNK - 1) / BITSTREAM_LOAD_CHUNK, 0);
+	return forEachChunk(len, [&](uint32_t i, uint64_t offs, uint64_t chunk) {
+		for (uint64_t done = 0; done < chunk; ) {
+			ssize_t n = pread(fd, vaddr + offs + done, chunk - done, offs + done);
+			if (n <= 0) {
+				return false;
+			}
+			done += n;
+		}
+		chunk_hashes[i] = hashBytes(vaddr + offs, chunk);
+		return true;
+	});
+}
+
+bitstream_t cRcnfg::readBitstream(const std::string &bitstream_path) {
+	DBG2("cRcnfg: Called readBitstream to read bitstream from " << bitstream_path);
+
+	/*
+	 * The lock only protects the bitstream cache; files are hashed and read without it, so that several bitstreams 
+	 * can be loaded in parallel (see cSched::addFunctions). If the same file is loaded by two threads at once, 
+	 * the first to finish adds it to the cache and the other one releases its copy.
+	 */
+	struct stat st;
+	std::string file_id;
+	int fd = openBitstream(bitstream_path, st, file_id);
+	std::unique_lock<std::mutex> guard(bitstream_lock);
+	if (bitstream_files.find(file_id) != bitstream_files.end()) {
+		close(fd);
+		DBG2("cRcnfg: Bitstream " << bitstream_path << " already loaded");
+		return bitstream_files[file_id];
+	}
+	guard.unlock();
+
+	// Map the file, to look up its contents without loading them into bitstream memory
+	uint32_t len = st.st_size;
+	if (len == 0) {
+		close(fd);
+		throw std::runtime_error("ERROR: Bitstream file " + bitstream_path + " is empty");
+	}
+	void *file_data = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (file_data == MAP_FAILED) {
+		close(fd);
+		throw std::runtime_error("ERROR: Bitstream file " + bitstream_path + " could not be mapped");
+	}
+	const uint8_t *file_8 = reinterpret_cast<const uint8_t *>(file_data);
+
+	std::vector<uint64_t> chunk_hashes((len + BITSTREAM_LOAD_CHUNK - 1) / BITSTREAM_LOAD_CHUNK);
+	forEachChunk(len, [&](uint32_t i, uint64_t offs, uint64_t chunk) {
+		chunk_hashes[i] = hashBytes(file_8 + offs, chunk);
+		return true;
+	});
+	uint64_t hash = bitstreamHash(chunk_hashes, len);
+
+	// Copy of a previously loaded bitstream; re-use it (loaded bitstreams are only released with this object)
+	bitstream_t bitstream = std::make_pair(nullptr, len);
+	guard.lock();
+	std::vector<bitstream_t> candidates = bitstream_hashes[hash];
+	guard.unlock();
+	for (bitstream_t &cached : candidates) {
+		if (std::get<1>(cached) == len && !memcmp(std::get<0>(cached), file_8, len)) {
+			DBG2("cRcnfg: Bitstream " << bitstream_path << " has the same contents as a loaded bitstream");
+			bitstream = cached;
+			break;
+		}
+	}
+
+	// Bitstream cached by the driver, loaded by this or another process; the contents are compared, since the hash isn't collision-resistant
+	bool shared = std::get<0>(bitstream) != nullptr;
+	if (!shared) {
+		void *cached = getCachedMem(hash, len);
+		if (cached && !memcmp(cached, file_8, len)) {
+			DBG2("cRcnfg: Bitstream " << bitstream_path << " mapped from the bitstream cache");
+			std::get<0>(bitstream) = cached;
+		} else if (cached) {
+			freeMem(cached);
+		}
+	}
+	munmap(file_data, len);
+
+	if (!std::get<0>(bitstream)) {
+		// Allocate host-side, kernel memory to hold the bitsream and load it
+		uint32_t n_pages = (len + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE;
+		uint8_t *vaddr = reinterpret_cast<uint8_t *>(getMem({CoyoteAllocType::PRM, n_pages})); 
+
+		bool loaded = loadChunks(fd, vaddr, len, chunk_hashes);
+		if (!loaded) {
+			close(fd);
+			freeMem(vaddr);
+			throw std::runtime_error("ERROR: Bitstream file " + bitstream_path + " could not be read");
+		}
+		hash = bitstreamHash(chunk_hashes, len);
+		std::get<0>(bitstream) = vaddr;
+
+		// Add the bitstream to the driver's bitstream cache and switch to the cached copy, so the private one can be released
+		// If it can't be cached (e.g., all the cached bitstreams are in use), the private copy is used
+		uint64_t tmp[MAX_USER_ARGS];
+		tmp[0] = reinterpret_cast<uint64_t>(vaddr);
+		tmp[1] = static_cast<uint64_t>(len);
+		tmp[2] = static_cast<uint64_t>(pid);
+		tmp[3] = static_cast<uint64_t>(crid);
+		tmp[4] = hash;
+		if (ioctl(reconfig_dev_fd, IOCTL_ADD_RECONFIG_CACHE, &tmp)) {
+			DBG1("cRcnfg: Bitstream " << bitstream_path << " could not be added to the bitstream cache");
+		} else {
+			void *cached = getCachedMem(hash, len);
+			if (cached && !memcmp(cached, vaddr, len)) {
+				freeMem(vaddr);
+				std::get<0>(bitstream) = cached;
+			} else if (cached) {
+				freeMem(cached);
+			}
+		}
+	}
+	close(fd);
+
+	// Another thread may have loaded the same file in the meantime
+	guard.lock();
+	auto loaded = bitstream_files.find(file_id);
+	if (loaded != bitstream_files.end()) {
+		bitstream_t winner = loaded->second;
+		guard.unlock();
+		if (!shared && std::get<0>(winner) != std::get<0>(bitstream)) {
+			freeMem(std::get<0>(bitstream));
+		}
+		return winner;
+	}
+
+	if (!shared) {
+		bitstream_hashes[hash].push_back(bitstream);
+	}
+	bitstream_files[file_id] = bitstream;
+	DBG2("cRcnfg: Bitstream " << bitstream_path << " loaded");
+	return bitstream;
+}
+
+bitstream_t cRcnfg::stageBitstream(const std::string &bitstream_path) {
+	DBG2("cRcnfg: Called stageBitstream to stage bitstream from " << bitstream_path);
+	std::lock_guard<std::mutex> guard(bitstream_lock);
+
+	// Already staged or loaded with readBitstream
+	struct stat st;
+	std::string file_id;
+	int fd = openBitstream(bitstream_path, st, file_id);
+	if (staging_file == file_id) {
+		close(fd);
+		return staging;
+	}
+	if (bitstream_files.find(file_id) != bitstream_files.end()) {
+		close(fd);
+		return bitstream_files[file_id];
+	}
+
+	// Grow the staging buffer, if needed
+	uint32_t len = st.st_size;
+	uint32_t n_pages = (len + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE;
+	if (n_pages > staging_pages) {
+		if (std::get<0>(staging)) {
+			freeMem(std::get<0>(staging));
+		}
+
+		// Reset first, so that the staging buffer isn't left dangling if the allocation fails
+		staging = std::make_pair(nullptr, 0);
+		staging_pages = 0;
+		staging = std::make_pair(getMem({CoyoteAllocType::PRM, n_pages}), 0);
+		staging_pages = n_pages;
+	}
+
+	std::vector<uint64_t> chunk_hashes;
+	staging_file.clear();
+	bool loaded = loadChunks(fd, reinterpret_cast<uint8_t *>(std::get<0>(staging)), len, chunk_hashes);
+	close(fd);
+	if (!loaded) {
+		throw std::runtime_error("ERROR: Bitstream file " + bitstream_path + " could not be read");
+	}
+
+	std::get<1>(staging) = len;
+	staging_file = file_id;
+	DBG2("cRcnfg: Bitstream " << bitstream_path << " staged");
+	return staging;
+}
+
 void cRcnfg::reconfigureBase(bitstream_t bitstream, uint32_t vfid) {
 	DBG2(
 		"cRcnfg: reconfigureBase called with virtual address 0x" << std::hex << std::get<0>(bitstream) 
 		<< std::dec << ", length " << std::get<1>(bitstream) << " and vFPGA ID " << vfid
 	);
+	cTraceScope trace("cRcnfg", static_cast<int32_t>(vfid) != -1 ? "reconfigureApp" : "reconfigureShell", "vfid", vfid, "len", std::get<1>(bitstream));
 
 	// Arguments to be passed to the driver's IOCTL call
 	uint64_t tmp[MAX_USER_ARGS];
@@ -178,6 +479,72 @@ void cRcnfg::reconfigureBase(bitstream_t bitstream, uint32_t vfid) {
 	}
 }
 
+int cRcnfg::reconfigureBaseAsync(bitstream_t bitstream, uint32_t vfid) {
+	DBG2(
+		"cRcnfg: reconfigureBaseAsync called with virtual address 0x" << std::hex << std::get<0>(bitstream) 
+		<< std::dec << ", length " << std::get<1>(bitstream) << " and vFPGA ID " << vfid
+	);
+
+	if (reconfig_pending.count(vfid)) {
+		throw std::runtime_error("ERROR: An asynchronous reconfiguration of vFPGA " + std::to_string(vfid) + " is already in progress");
+	}
+
+	auto efd = reconfig_efds.find(vfid);
+	if (efd == reconfig_efds.end()) {
+		int fd = eventfd(0, EFD_CLOEXEC);
+		if (fd == -1) {
+			throw std::runtime_error("ERROR: Failed to create the reconfiguration eventfd");
+		}
+		efd = reconfig_efds.emplace(vfid, fd).first;
+	}
+
+	// Arguments to be passed to the driver's IOCTL call
+	uint64_t tmp[MAX_USER_ARGS];
+	tmp[0] = reinterpret_cast<uint64_t>(std::get<0>(bitstream));
+	tmp[1] = static_cast<uint64_t>(std::get<1>(bitstream));
+	tmp[2] = static_cast<uint64_t>(pid);
+	tmp[3] = static_cast<uint64_t>(crid);
+	tmp[4] = static_cast<uint64_t>(vfid);
+	tmp[5] = static_cast<uint64_t>(efd->second);
+
+	DBG2("cRcnfg: Starting asynchronous app reconfiguration");
+	if (ioctl(reconfig_dev_fd, IOCTL_RECONFIGURE_APP_ASYNC, &tmp)) {
+		throw std::runtime_error("ERROR: IOCTL_RECONFIGURE_APP_ASYNC failed");
+	}
+	reconfig_pending.insert(vfid);
+	if (cTracer::enabled()) {
+		cTracer::instant("cRcnfg", "reconfigureAppAsync", "vfid", vfid, "len", std::get<1>(bitstream));
+	}
+
+	return efd->second;
+}
+
+void cRcnfg::waitReconfiguration(int vfid) {
+	if (!reconfig_pending.count(vfid)) {
+		return;
+	}
+	cTraceScope trace("cRcnfg", "waitReconfiguration", "vfid", static_cast<uint64_t>(vfid));
+
+	// The driver increments the eventfd counter once the reconfiguration completed
+	uint64_t value;
+	while (read(reconfig_efds[vfid], &value, sizeof(value)) != sizeof(value)) {
+		if (errno != EINTR) {
+			throw std::runtime_error("ERROR: Failed to read the reconfiguration eventfd");
+		}
+	}
+	reconfig_pending.erase(vfid);
+
+	uint64_t tmp[MAX_USER_ARGS];
+	tmp[0] = static_cast<uint64_t>(vfid);
+	if (ioctl(reconfig_dev_fd, IOCTL_RECONFIGURE_APP_RESULT, &tmp)) {
+		throw std::runtime_error("ERROR: IOCTL_RECONFIGURE_APP_RESULT failed");
+	}
+	if (tmp[0]) {
+		throw std::runtime_error("ERROR: Asynchronous reconfiguration of vFPGA " + std::to_string(vfid) + " failed");
+	}
+	DBG2("cRcnfg: Asynchronous app reconfiguration completed");
+}
+
 void cRcnfg::reconfigureShell(std::string bitstream_path) {
 	DBG2("cRcnfg: Called reconfigureShell"); 
 	
@@ -186,22 +553,32 @@ void cRcnfg::reconfigureShell(std::string bitstream_path) {
 	if (!bitstream_file) {
 		throw std::runtime_error("ERROR: Shell bitstream could not be opened; please check the provided bitstream path...");
 	}
-	bitstream_t bitstream = readBitstream(bitstream_file);
 	bitstream_file.close();
-	reconfigureBase(bitstream);
+	reconfigureBase(readBitstream(bitstream_path));
 }
 
 void cRcnfg::reconfigureApp(std::string bitstream_path, int vfid) {
 	DBG2("cRcnfg: Called reconfigureApp"); 
 	
-	// Read bitstream from file and trigger reconfiguration
+	// Read bitstream from file (or re-use it, if already loaded) and trigger reconfiguration
+	std::ifstream bitstream_file(bitstream_path, std::ios::ate | std::ios::binary);
+	if (!bitstream_file) {
+		throw std::runtime_error("ERROR: App bitstream could not be opened; please check the provided bitstream path...");
+	}
+	bitstream_file.close();
+	reconfigureBase(readBitstream(bitstream_path), vfid);
+}
+
+int cRcnfg::reconfigureAppAsync(std::string bitstream_path, int vfid) {
+	DBG2("cRcnfg: Called reconfigureAppAsync"); 
+	
+	// Bitstreams read with readBitstream(path) stay resident, so they remain valid until the reconfiguration completes
 	std::ifstream bitstream_file(bitstream_path, std::ios::ate | std::ios::binary);
 	if (!bitstream_file) {
 		throw std::runtime_error("ERROR: App bitstream could not be opened; please check the provided bitstream path...");
 	}
-	bitstream_t bitstream = readBitstream(bitstream_file);
 	bitstream_file.close();
-	reconfigureBase(bitstream, vfid);
+	return reconfigureBaseAsync(readBitstream(bitstream_path), vfid);
 }
 
 }
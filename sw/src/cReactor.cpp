@@ -0,0 +1,185 @@
+/*
+ * This file is part of the Coyote <https://github.com/fpgasystems/Coyote>
+ *
+ * MIT Licence
+ * Copyright (c) 2025, Systems Group, ETH Zurich
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <coyote/cReactor.hpp>
+#include <coyote/cThreadConfig.hpp>
+
+namespace coyote {
+
+std::map<uint32_t, cReactor*> coyote::cReactor::reactors;
+
+static std::mutex reactors_lock;
+
+cReactor::cReactor(uint32_t device): device(device), reactor_running(true) {
+    reactor_thread = std::thread(&cReactor::react, this);
+}
+
+cReactor::~cReactor() {
+    {
+        std::lock_guard<std::mutex> guard(rlock);
+        reactor_running = false;
+    }
+    rcv.notify_all();
+
+    if (reactor_thread.joinable()) {
+        reactor_thread.join();
+    }
+}
+
+cReactor* cReactor::getInstance(uint32_t device) {
+    std::lock_guard<std::mutex> guard(reactors_lock);
+    if (reactors.find(device) == reactors.end() || reactors[device] == nullptr) {
+        reactors[device] = new cReactor(device);
+    }
+    return reactors[device];
+}
+
+void cReactor::react() {
+    DBG1("cReactor: Starting reactor thread for device " << device);
+    cThreadConfig::apply(CoyoteThreadRole::REACTOR, device);
+
+    std::unique_lock<std::mutex> guard(rlock);
+    while (reactor_running) {
+        // Nothing outstanding; sleep until something is submitted
+        if (n_outstanding == 0) {
+            rcv.wait(guard, [this] { return n_outstanding > 0 || !reactor_running; });
+            continue;
+        }
+
+        issueSubmissions(guard);
+
+        for (auto &thread : threads) {
+            if (thread.second.promises.empty()) {
+                continue;
+            }
+
+            for (uint64_t ticket : thread.second.cq->poll()) {
+                auto it = thread.second.promises.find(ticket);
+                if (it != thread.second.promises.end()) {
+                    it->second.set_value();
+                    thread.second.promises.erase(it);
+                    n_outstanding--;
+                }
+            }
+        }
+
+        // Give submitters a chance to acquire the lock, before polling again; new submissions are issued right away
+        rcv.wait_for(guard, std::chrono::nanoseconds(SLEEP_TIME), [this] { return !submissions.empty() || !reactor_running; });
+    }
+
+    DBG1("cReactor: Stopping reactor thread for device " << device);
+}
+
+void cReactor::issueSubmissions(std::unique_lock<std::mutex> &guard) {
+    if (submissions.empty()) {
+        return;
+    }
+
+    // The completion queues are only used by the reactor thread, so the requests can be issued without the lock
+    std::deque<submission> batch;
+    batch.swap(submissions);
+    guard.unlock();
+
+    for (auto &req : batch) {
+        try {
+            req.ticket = req.issue(*req.cq);
+            req.failed = false;
+        } catch (...) {
+            // Invalid requests are reported through the future, same as completions
+            req.promise.set_exception(std::current_exception());
+            req.failed = true;
+        }
+    }
+
+    // Completions are only polled after the promises are in place, so none of them can be missed
+    guard.lock();
+    for (auto &req : batch) {
+        threadState &state = threads[req.cthread];
+        state.n_queued--;
+        if (req.failed) {
+            n_outstanding--;
+        } else {
+            state.promises.emplace(req.ticket, std::move(req.promise));
+        }
+    }
+}
+
+std::future<void> cReactor::submit(cThread *cthread, const std::function<uint64_t(cCompletionQueue&)> &issue) {
+    if (!cthread) {
+        throw std::runtime_error("ERROR: cReactor::invokeAsync() called without a valid cThread, exiting...");
+    }
+
+    std::promise<void> promise;
+    std::future<void> future = promise.get_future();
+
+    {
+        std::lock_guard<std::mutex> guard(rlock);
+        threadState &state = threads[cthread];
+        if (!state.cq) {
+            state.cq = std::make_unique<cCompletionQueue>(cthread);
+        }
+
+        // Only queued here; the reactor thread issues it, so the lock isn't held during the MMIO writes
+        submissions.push_back({cthread, state.cq.get(), issue, std::move(promise), 0, false});
+        state.n_queued++;
+        n_outstanding++;
+    }
+
+    rcv.notify_one();
+    return future;
+}
+
+std::future<void> cReactor::invokeAsync(cThread *cthread, CoyoteOper oper, localSg sg) {
+    return submit(cthread, [oper, sg](cCompletionQueue &cq) { return cq.invoke(oper, sg); });
+}
+
+std::future<void> cReactor::invokeAsync(cThread *cthread, CoyoteOper oper, localSg src_sg, localSg dst_sg) {
+    return submit(cthread, [oper, src_sg, dst_sg](cCompletionQueue &cq) { return cq.invoke(oper, src_sg, dst_sg); });
+}
+
+std::future<void> cReactor::invokeAsync(cThread *cthread, CoyoteOper oper, rdmaSg sg) {
+    return submit(cthread, [oper, sg](cCompletionQueue &cq) { return cq.invoke(oper, sg); });
+}
+
+void cReactor::release(cThread *cthread) {
+    while (true) {
+        {
+            std::lock_guard<std::mutex> guard(rlock);
+            auto it = threads.find(cthread);
+            if (it == threads.end()) {
+                return;
+            }
+            
+            if (it->second.promises.empty() && it->second.n_queued == 0) {
+                threads.erase(it);
+                return;
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::nanoseconds(SLEEP_TIME));
+    }
+}
+
+}
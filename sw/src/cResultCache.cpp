@@ -0,0 +1,137 @@
+/*
+ * This file is part of the Coyote <https://github.com/fpgasystems/Coyote>
+ *
+ * MIT Licence
+ * Copyright (c) 2025, Systems Group, ETH Zurich
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <cstring>
+
+#include <coyote/cResultCache.hpp>
+
+namespace coyote {
+
+std::string cResultCache::makeKey(int32_t fid, const cTaskArgs &args) {
+    size_t key_size = sizeof(int32_t);
+    for (size_t i = 0; i < args.size(); i++) {
+        key_size += sizeof(uint32_t) + args[i].size();
+    }
+
+    std::string key(key_size, '\0');
+    char *ptr = key.data();
+    memcpy(ptr, &fid, sizeof(int32_t));
+    ptr += sizeof(int32_t);
+    for (size_t i = 0; i < args.size(); i++) {
+        cArgView arg = args[i];
+        uint32_t arg_size = arg.size();
+        memcpy(ptr, &arg_size, sizeof(uint32_t));
+        ptr += sizeof(uint32_t);
+        if (arg_size) {
+            memcpy(ptr, arg.data(), arg_size);
+            ptr += arg_size;
+        }
+    }
+    return key;
+}
+
+void cResultCache::evict(size_t target) {
+    while (size > target && !entries.empty()) {
+        cacheEntry &victim = entries.back();
+        size -= victim.key.size() + victim.ret_val.size();
+        index.erase(victim.key);
+        entries.pop_back();
+        evictions++;
+    }
+}
+
+bool cResultCache::get(int32_t fid, const cTaskArgs &args, std::vector<char> &ret_val) {
+    std::lock_guard<std::mutex> guard(lock);
+    if (!capacity) {
+        return false;
+    }
+
+    auto it = index.find(makeKey(fid, args));
+    if (it == index.end()) {
+        misses++;
+        return false;
+    }
+
+    // Move the result to the front of the list; splice doesn't invalidate the iterators in the index
+    entries.splice(entries.begin(), entries, it->second);
+    ret_val = it->second->ret_val;
+    hits++;
+    return true;
+}
+
+void cResultCache::put(int32_t fid, const cTaskArgs &args, const std::vector<char> &ret_val) {
+    std::lock_guard<std::mutex> guard(lock);
+    std::string key = makeKey(fid, args);
+    size_t entry_size = key.size() + ret_val.size();
+    if (entry_size > capacity) {
+        return;
+    }
+
+    // Several identical tasks may have been in flight at once; the first to complete populates the cache
+    auto it = index.find(key);
+    if (it != index.end()) {
+        entries.splice(entries.begin(), entries, it->second);
+        return;
+    }
+
+    evict(capacity - entry_size);
+    entries.push_front({std::move(key), ret_val});
+    index.emplace(entries.front().key, entries.begin());
+    size += entry_size;
+}
+
+void cResultCache::setCapacity(size_t capacity) {
+    std::lock_guard<std::mutex> guard(lock);
+    this->capacity = capacity;
+    evict(capacity);
+}
+
+size_t cResultCache::getCapacity() {
+    std::lock_guard<std::mutex> guard(lock);
+    return capacity;
+}
+
+size_t cResultCache::getSize() {
+    std::lock_guard<std::mutex> guard(lock);
+    return size;
+}
+
+uint64_t cResultCache::getHits() {
+    std::lock_guard<std::mutex> guard(lock);
+    return hits;
+}
+
+uint64_t cResultCache::getMisses() {
+    std::lock_guard<std::mutex> guard(lock);
+    return misses;
+}
+
+uint64_t cResultCache::getEvictions() {
+    std::lock_guard<std::mutex> guard(lock);
+    return evictions;
+}
+
+}
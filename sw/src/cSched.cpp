@@ -25,6 +25,8 @@
  */
 
 #include <coyote/cSched.hpp>
+#include <coyote/cTracer.hpp>
+#include <coyote/cThreadConfig.hpp>
 
 namespace coyote {
 
@@ -41,194 +43,519 @@ cSched::cSched(int32_t vfid, uint32_t device, bool reorder, std::string current_
     fcnfg.en_pr = tmp[0];
 
     if (!fcnfg.en_pr) {
-        syslog(LOG_WARNING, "Partial reconfiguration is not enabled; scheduler will only execute functions that match the current bitstream");
+        CYT_LOG(LOG_WARNING, "Partial reconfiguration is not enabled; scheduler will only execute functions that match the current bitstream");
     } 
 
 }
 
 bool cSched::taskChecker(int32_t tid) {
-    if (task_id_map.find(tid) == task_id_map.end()) {
+    auto it = tasks.find(tid);
+    if (it == tasks.end()) {
         // Don't add print here; as this condition can happen often causing too many prints
         return false;
     }
-    if (tasks[task_id_map[tid]] == nullptr) {
-        syslog(LOG_WARNING, "Task with ID %d is null", tid);
+    if (it->second == nullptr) {
+        CYT_LOG(LOG_WARNING, "Task with ID %d is null", tid);
         return false;
     }
-    if (tasks[task_id_map[tid]]->getTid() != tid) {
-        syslog(LOG_ERR, "UNEXPECTED BUG: ID from task map and list entry differ, map entry tid: %d", tid);
+    if (it->second->getTid() != tid) {
+        CYT_LOG(LOG_ERR, "UNEXPECTED BUG: ID from task map and task entry differ, map entry tid: %d", tid);
         return false;
     }
     return true;
 }
 
-void cSched::schedule() {
-    syslog(LOG_NOTICE, "Starting scheduler thread for vfid %d", vfid);
-    while (scheduler_running) {
-        tlock.lock();
-        int next_idx = -1;
-
-        for (int i = 0; i < tasks.size(); i++) {
-            // Check task is non-null and non-completed
-            if (tasks[i] == nullptr) {
+void cSched::loadBitstream(bFunc *fn, std::unique_lock<std::mutex> &guard) {
+    cTraceScope trace("cSched", "loadBitstream", "fid", static_cast<uint64_t>(fn->getFid()), "vfid", vfid);
+    auto begin = std::chrono::steady_clock::now();
+    bitstream_t bitstream = fn->getBitstreamPointer();
+    if (!std::get<0>(bitstream)) {
+        bitstream = stageBitstream(fn->getBitstreamPath());
+    }
+    reconfigureBase(bitstream, vfid);
+    auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin);
+
+    // Start a new batch and update the cost of a reconfiguration, used by the reordering policy
+    guard.lock();
+    current_bitstream = fn->getBitstreamPath();
+    reconfig_time = reconfig_time.count() ? (3 * reconfig_time + elapsed) / 4 : elapsed;
+    batch_size = 0;
+    batch_busy = std::chrono::nanoseconds(0);
+    CYT_LOG(LOG_NOTICE, "Reconfiguration complete in %lld us", (long long) (elapsed.count() / 1000));
+}
+
+bool cSched::nextTask(int32_t &tid, bool &reconfigure) {
+    // A reconfiguration / exclusive task is in progress
+    if (barrier) {
+        return false;
+    }
+
+    // Without pending tasks, a requested pre-load can start once the vFPGA is idle (signalled with tid = -1)
+    if (run_queues.empty()) {
+        if (preload_fid == -1 || n_executing) {
+            return false;
+        }
+        tid = -1;
+        reconfigure = true;
+        return true;
+    }
+
+    // The head of each run queue, i.e., its most urgent task, and the most urgent class among them (strict priority)
+    struct queueHead {
+        std::map<std::string, runQueue>::iterator queue;
+        const pendingTask *task;
+        uint32_t priority;
+    };
+    auto now = std::chrono::steady_clock::now();
+    std::vector<queueHead> heads;
+    uint32_t top = SCHED_N_PRIORITIES;
+    for (auto it = run_queues.begin(); it != run_queues.end(); it++) {
+        queueHead head = {it, nullptr, SCHED_N_PRIORITIES};
+        for (uint32_t c = 0; c < SCHED_N_PRIORITIES; c++) {
+            if (it->second.classes[c].empty()) {
                 continue;
             }
+            const pendingTask &task = it->second.classes[c].front();
+            uint32_t priority = effectivePriority(task, c, now);
+            if (head.task == nullptr || priority < head.priority || (priority == head.priority && task < *head.task)) {
+                head.task = &task;
+                head.priority = priority;
+            }
+        }
+        heads.push_back(head);
+        top = std::min(top, head.priority);
+    }
 
-            if (tasks[i]->isCompleted()) {
+    const queueHead *next = nullptr;
+    bool starving = false;
+    if (!reorder) {
+        for (const queueHead &head : heads) {
+            if (head.priority == top && (next == nullptr || *head.task < *next->task)) {
+                next = &head;
+            }
+        }
+    } else {
+        // Among the queues with a task of the most urgent class: the current bitstream's and, among the other bitstreams,
+        // the one with the oldest task, the one with the most pending tasks and the one with the earliest deadline
+        const queueHead *current = nullptr, *other_oldest = nullptr, *other_largest = nullptr, *other_earliest = nullptr;
+        for (const queueHead &head : heads) {
+            if (head.priority != top) {
                 continue;
             }
-
-            // Sanity check
-            cThread* cthread = tasks[i]->getCThread();
-            if (cthread == nullptr || functions.find(tasks[i]->getFid()) == functions.end()) {
-                syslog(LOG_ERR, "UNEXPECTED BUG: Task with ID %d is missing its function signature or corresponding cThread, skipping", tasks[i]->getTid());
-                tasks[i]->setRetCode(1);
-                tasks[i]->setCompleted(true);
-                continue;   
+            if (head.queue->first == current_bitstream) {
+                current = &head;
+                continue;
+            }
+            if (other_oldest == nullptr || head.task->submitted < other_oldest->task->submitted) {
+                other_oldest = &head;
             }
+            if (other_largest == nullptr || head.queue->second.size > other_largest->queue->second.size) {
+                other_largest = &head;
+            }
+            if (other_earliest == nullptr || head.task->deadline < other_earliest->task->deadline) {
+                other_earliest = &head;
+            }
+        }
+
+        starving = other_oldest != nullptr && now - other_oldest->task->submitted > max_wait;
+
+        // EDF across bitstreams: another bitstream goes first if its deadline, postponed by a reconfiguration, is still the earlier one
+        bool deadline_first = other_earliest != nullptr && other_earliest->task->deadline != std::chrono::steady_clock::time_point::max() && 
+            (current == nullptr || other_earliest->task->deadline + reconfig_time < current->task->deadline);
+
+        // Otherwise, keep executing the current batch, unless it's finished or there is a starving task;
+        // the latter only ends the batch once it did at least as much work as a reconfiguration costs
+        bool end_batch = batch_size >= max_batch || (starving && batch_busy >= reconfig_time);
+        if (deadline_first) {
+            next = other_earliest;
+        } else if (current != nullptr && (!end_batch || other_oldest == nullptr)) {
+            next = current;
+        } else {
+            next = starving ? other_oldest : other_largest;
+        }
+    }
+    runQueue &queue = next->queue->second;
+    reconfigure = next->queue->first != current_bitstream;
+
+    // The first task of the queue whose Coyote thread is idle, in order of (effective) class; the tasks of a Coyote thread 
+    // within a class execute in order of submission, unless they have deadlines
+    uint32_t order[SCHED_N_PRIORITIES], priorities[SCHED_N_PRIORITIES];
+    for (uint32_t c = 0; c < SCHED_N_PRIORITIES; c++) {
+        order[c] = c;
+        priorities[c] = queue.classes[c].empty() ? SCHED_N_PRIORITIES : effectivePriority(queue.classes[c].front(), c, now);
+    }
+    std::stable_sort(order, order + SCHED_N_PRIORITIES, [&](uint32_t a, uint32_t b) { return priorities[a] < priorities[b]; });
 
-            if (!reorder) {
-                // If reordering is not enabled, process the first task found
-                next_idx = i;
+    std::deque<pendingTask> *entry_class = nullptr;
+    auto entry = queue.classes[0].end();
+    for (uint32_t c : order) {
+        for (auto it = queue.classes[c].begin(); it != queue.classes[c].end(); it++) {
+            if (!busy_threads.count(tasks[it->tid]->getCThread())) {
+                entry_class = &queue.classes[c];
+                entry = it;
                 break;
-            } else {
-                // Roerdering enabled => minimize the number of reconfigurations needed
-                // However, if all tasks require reconfiguration, process the first one
-                if (next_idx == -1) {
-                    next_idx = i;
-                }
-                
-                std::string target_bitstream = functions[tasks[i]->getFid()]->getBitstreamPath();
-                if (current_bitstream != target_bitstream) {
-                    // Skip this task, requires a different bitstream
-                    continue; 
-                } else {
-                    // Process this task, its bitstream matches the current one
-                    next_idx = i; 
-                    break;
-                }
             }
         }
-        
-        // Process next task, if there is one
-        if (next_idx != -1) {
-            // If the bitstream is not loaded, reconfigure the vFPGA
-            std::string target_bitstream = functions[tasks[next_idx]->getFid()]->getBitstreamPath();
-            if (current_bitstream != target_bitstream) {
-                if (fcnfg.en_pr) {
-                    try {
-                        syslog(LOG_NOTICE, "Reconfiguring vFPGA %d, with bitstream %s for task with ID %d", vfid, target_bitstream.c_str(), tasks[next_idx]->getTid());
-                        reconfigureBase(functions[tasks[next_idx]->getFid()]->getBitstreamPointer(), vfid);
-                        current_bitstream = target_bitstream;
-                        syslog(LOG_NOTICE, "Reconfiguration complete");
-                    } catch (const std::exception &e) {
-                        syslog(LOG_ERR, "Exception during reconfiguration: %s", e.what());
-                        tasks[next_idx]->setRetCode(1);
-                        tasks[next_idx]->setCompleted(true);
-                    }
-                } else {
-                    syslog(LOG_WARNING, "Partial reconfiguration is not enabled, however, task with ID %d requires a different bitstream, skipping", tasks[next_idx]->getTid());
-                    tasks[next_idx]->setRetCode(1);
-                    tasks[next_idx]->setCompleted(true);
-                }
+        if (entry_class != nullptr) {
+            break;
+        }
+    }
+    if (entry_class == nullptr) {
+        return false;
+    }
+
+    // Reconfigurations and exclusive tasks act as a barrier; they wait until all the executing tasks completed
+    auto fn = functions.find(tasks[entry->tid]->getFid());
+    bool concurrent = !reconfigure && fn != functions.end() && fn->second->isConcurrent();
+    if (!concurrent && n_executing) {
+        return false;
+    }
+
+    if (reconfigure && reorder) {
+        CYT_LOG(
+            LOG_NOTICE, "Ending batch of %u tasks on vfid %d; next bitstream %s has %zu pending tasks%s", 
+            batch_size, vfid, next->queue->first.c_str(), queue.size, starving ? " (starving)" : ""
+        );
+    }
+
+    tid = entry->tid;
+    virtual_time = std::max(virtual_time, entry->tag);
+    auto flow = flows.find(tasks[tid]->getCThread());
+    if (flow != flows.end() && --flow->second.n_pending == 0) {
+        flows.erase(flow);
+    }
+    entry_class->erase(entry);
+    n_pending--;
+    if (--queue.size == 0) {
+        run_queues.erase(next->queue);
+    }
+    return true;
+}
+
+void cSched::schedule() {
+    cThreadConfig::apply(CoyoteThreadRole::SCHEDULER, vfid);
+    std::unique_lock<std::mutex> guard(tlock);
+    while (true) {
+        int32_t tid;
+        bool reconfigure = false;
+        while (scheduler_running && !nextTask(tid, reconfigure)) {
+            tcv.wait(guard);
+        }
+        if (!scheduler_running) {
+            break;
+        }
+
+        // Speculative reconfiguration, requested through preload(); there is no task to execute
+        if (tid == -1) {
+            bFunc *fn = functions[preload_fid].get();
+            preload_fid = -1;
+            n_executing++;
+            barrier = true;
+            guard.unlock();
+
+            try {
+                CYT_LOG(LOG_NOTICE, "Pre-loading vFPGA %d with bitstream %s", vfid, fn->getBitstreamPath().c_str());
+                auto begin = std::chrono::steady_clock::now();
+                loadBitstream(fn, guard);
+                metrics[fn->getFid()].reconfig_time.record(std::chrono::steady_clock::now() - begin);
+            } catch (const std::exception &e) {
+                CYT_LOG(LOG_ERR, "Exception during reconfiguration: %s", e.what());
+                guard.lock();
             }
-            
-            // Execute the task
-            if (!tasks[next_idx]->isCompleted()) {
-                syslog(LOG_NOTICE, "Executing tid %d, fid %d, vfid %d", tasks[next_idx]->getTid(), functions[tasks[next_idx]->getFid()]->getFid(), vfid);
-                cThread* cthread = tasks[next_idx]->getCThread();
+
+            n_executing--;
+            barrier = false;
+            tcv.notify_all();
+            continue;
+        }
+
+        if (!taskChecker(tid)) {
+            CYT_LOG(LOG_ERR, "UNEXPECTED BUG: Task with ID %d is in the run queue, but not in the map of tasks, skipping", tid);
+            continue;
+        }
+        cTask *task = tasks[tid].get();
+        
+        // Sanity check
+        cThread* cthread = task->getCThread();
+        if (cthread == nullptr || functions.find(task->getFid()) == functions.end()) {
+            CYT_LOG(LOG_ERR, "UNEXPECTED BUG: Task with ID %d is missing its function signature or corresponding cThread, skipping", tid);
+            task->setRetCode(1);
+            task->setCompleted(true);
+            notifyCompletion(task, guard);
+            continue;   
+        }
+        bFunc *fn = functions[task->getFid()].get();
+        auto start_time = std::chrono::steady_clock::now();
+
+        // The task is no longer in the run queue, so it can be executed without holding the lock;
+        // its entry in the map is stable, since pending tasks cannot be released
+        bool exclusive = reconfigure || !fn->isConcurrent();
+        n_executing++;
+        barrier = exclusive;
+        busy_threads.insert(cthread);
+        guard.unlock();
+
+        // Another task may be ready for an idle worker
+        if (!exclusive) {
+            tcv.notify_one();
+        }
+
+        // If the bitstream is not loaded, reconfigure the vFPGA
+        int32_t ret_code = 0;
+        std::vector<char> ret_val;
+        std::string target_bitstream = fn->getBitstreamPath();
+        std::chrono::nanoseconds reconfig(0);
+        if (reconfigure) {
+            if (fcnfg.en_pr) {
                 try {
-                    cthread->lock();
-                    std::vector<char> ret_val = functions[tasks[next_idx]->getFid()]->run(cthread, tasks[next_idx]->getArgs());
-                    cthread->unlock();
-                    tasks[next_idx]->setRetVal(ret_val);
-                    tasks[next_idx]->setRetCode(0);
-                    tasks[next_idx]->setCompleted(true);
-                    syslog(LOG_NOTICE, "Executed task with ID %d", tasks[next_idx]->getTid());
+                    CYT_LOG(LOG_NOTICE, "Reconfiguring vFPGA %d, with bitstream %s for task with ID %d", vfid, target_bitstream.c_str(), tid);
+                    auto begin = std::chrono::steady_clock::now();
+                    loadBitstream(fn, guard);
+                    reconfig = std::chrono::steady_clock::now() - begin;
+
+                    // Once the bitstream is loaded, concurrent tasks no longer need to wait for this one
+                    barrier = !fn->isConcurrent();
+                    guard.unlock();
+                    tcv.notify_all();
                 } catch (const std::exception &e) {
-                    cthread->unlock();      // Unlock in case function execution failed
-                    tasks[next_idx]->setRetCode(1);
-                    tasks[next_idx]->setCompleted(true);
-                    syslog(LOG_ERR, "Unknown error executing task with ID %d: %s", tasks[next_idx]->getTid(), e.what());
+                    CYT_LOG(LOG_ERR, "Exception during reconfiguration: %s", e.what());
+                    ret_code = 1;
                 }
+            } else {
+                CYT_LOG(LOG_WARNING, "Partial reconfiguration is not enabled, however, task with ID %d requires a different bitstream, skipping", tid);
+                ret_code = 1;
+            }
+        }
+        
+        // Execute the task
+        std::chrono::nanoseconds busy(0);
+        if (!ret_code) {
+            if (log_tasks) {
+                CYT_LOG(LOG_NOTICE, "Executing tid %d, fid %d, vfid %d", tid, fn->getFid(), vfid);
             }
+            auto begin = std::chrono::steady_clock::now();
+            cTraceScope trace("cSched", "task", "tid", static_cast<uint64_t>(tid), "fid", static_cast<uint64_t>(fn->getFid()));
+            try {
+                cthread->lock();
+                ret_val = fn->run(cthread, task->getArgs());
+                cthread->unlock();
+                if (log_tasks) {
+                    CYT_LOG(LOG_NOTICE, "Executed task with ID %d", tid);
+                }
+            } catch (const std::exception &e) {
+                cthread->unlock();      // Unlock in case function execution failed
+                ret_code = 1;
+                CYT_LOG(LOG_ERR, "Unknown error executing task with ID %d: %s", tid, e.what());
+            }
+            busy = std::chrono::steady_clock::now() - begin;
+        }
+
+        guard.lock();
+        n_executing--;
+        if (exclusive) {
+            barrier = false;
+        }
+        busy_threads.erase(cthread);
+        if (busy.count()) {
+            batch_size++;
+            batch_busy += busy;
+        }
+
+        // The queueing delay includes the wait for the barrier, but not the reconfiguration itself
+        cTaskMetrics &fn_metrics = metrics[fn->getFid()];
+        fn_metrics.queue_delay.record(start_time - task->getSubmitTime());
+        if (reconfig.count()) {
+            fn_metrics.reconfig_time.record(reconfig);
+        }
+        if (!ret_code) {
+            fn_metrics.exec_time.record(busy);
+            fn_metrics.n_completed++;
+        } else {
+            fn_metrics.n_failed++;
+        }
+        if (std::chrono::steady_clock::now() > task->getDeadline()) {
+            fn_metrics.n_missed++;
         }
 
-        tlock.unlock();
-        std::this_thread::sleep_for(std::chrono::nanoseconds(DAEMON_PROCESS_REQUESTS_SLEEP));
+        if (!ret_code) {
+            task->setRetVal(std::move(ret_val));
+        }
+        task->setRetCode(ret_code);
+        task->setCompleted(true);
+
+        // The completion may release a barrier or a Coyote thread, so any idle worker may be able to proceed
+        tcv.notify_all();
+        notifyCompletion(task, guard);
     }
+}
 
-    syslog(LOG_NOTICE, "Stopping scheduler thread for vfid %d", vfid);
+void cSched::notifyCompletion(cTask *task, std::unique_lock<std::mutex> &guard) {
+    if (completion_callback) {
+        guard.unlock();
+        completion_callback(task);
+        guard.lock();
+    }
 }
 
 void cSched::start() {
+    std::lock_guard<std::mutex> guard(tlock);
     if (scheduler_running) {
-        syslog(LOG_NOTICE, "Scheduler thread for vfid %d is already running, not starting again", vfid);
+        CYT_LOG(LOG_NOTICE, "Scheduler threads for vfid %d are already running, not starting again", vfid);
         return;
     }
     scheduler_running = true;
-    scheduler_thread = std::thread(&cSched::schedule, this);
+
+    CYT_LOG(LOG_NOTICE, "Starting %u scheduler threads for vfid %d", n_workers, vfid);
+    for (uint32_t i = 0; i < n_workers; i++) {
+        workers.emplace_back(&cSched::schedule, this);
+    }
 }
 
 void cSched::stop() {
-    if (!scheduler_running) {
-        syslog(LOG_NOTICE, "Scheduler thread for vfid %d is not running, nothing to stop", vfid);
-        return;
+    {
+        std::lock_guard<std::mutex> guard(tlock);
+        if (!scheduler_running) {
+            CYT_LOG(LOG_NOTICE, "Scheduler threads for vfid %d are not running, nothing to stop", vfid);
+            return;
+        }
+        scheduler_running = false;
+    }
+    tcv.notify_all();
+
+    for (std::thread &worker : workers) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+    workers.clear();
+    CYT_LOG(LOG_NOTICE, "Stopped scheduler threads for vfid %d", vfid);
+}
+
+bool cSched::preload(int32_t fid) {
+    std::lock_guard<std::mutex> guard(tlock);
+    if (!fcnfg.en_pr || !scheduler_running || functions.find(fid) == functions.end()) {
+        return false;
     }
-    scheduler_running = false;
-    if (scheduler_thread.joinable()) {
-        scheduler_thread.join();
+
+    // Only idle vFPGAs are pre-loaded, and only if they don't hold the bitstream already
+    if (n_pending || n_executing || current_bitstream == functions[fid]->getBitstreamPath()) {
+        return false;
+    }
+
+    preload_fid = fid;
+    tcv.notify_one();
+    return true;
+}
+
+void cSched::setWorkers(uint32_t n_workers) {
+    std::lock_guard<std::mutex> guard(tlock);
+    if (scheduler_running) {
+        CYT_LOG(LOG_WARNING, "Scheduler threads for vfid %d are already running, number of workers not changed", vfid);
+        return;
     }
+    this->n_workers = std::max<uint32_t>(n_workers, 1);
+}
+
+void cSched::setReorderPolicy(uint32_t max_batch, uint64_t max_wait_us) {
+    std::lock_guard<std::mutex> guard(tlock);
+    this->max_batch = std::max<uint32_t>(max_batch, 1);
+    this->max_wait = std::chrono::microseconds(max_wait_us);
 }
 
 bool cSched::addTask(std::unique_ptr<cTask> task) {
     if (task == nullptr) {
-        syslog(LOG_WARNING, "Task is null, cannot add to scheduler");
+        CYT_LOG(LOG_WARNING, "Task is null, cannot add to scheduler");
         return false;
     }
 
     int32_t tid = task->getTid();
-    if (task_id_map.find(tid) != task_id_map.end()) {
-        syslog(LOG_WARNING, "Task with ID %d already exists in the scheduler", task->getTid());
+    if (!isFunctionRegistered(task->getFid())) {
+        CYT_LOG(LOG_WARNING, "Function for task %d with fid %d is not registered in the scheduler", tid, task->getFid());
         return false;
     }
 
-    if (!isFunctionRegistered(task->getFid())) {
-        syslog(LOG_WARNING, "Function for task %d with fid %d is not registered in the scheduler", task->getTid(), task->getFid());
-        return false;
+    {
+        std::lock_guard<std::mutex> guard(tlock);
+        if (tasks.find(tid) != tasks.end()) {
+            CYT_LOG(LOG_WARNING, "Task with ID %d already exists in the scheduler", tid);
+            return false;
+        }
+
+        // IMPORTANT: Due to the move, after the following line, this function has no ownership of the task pointer
+        // Therefore, any operation, such as task->(...), will cause a segmentation fault
+        // Note the use of tid instead of task->getTid() to avoid dereferencing the moved task pointer
+        int32_t fid = task->getFid();
+        cThread *flow_id = task->getCThread();
+        uint64_t cost = SCHED_WFQ_QUANTUM / task->getWeight();
+        uint32_t priority = std::min(task->getPriority(), SCHED_N_PRIORITIES - 1);
+        std::chrono::steady_clock::time_point deadline = task->getDeadline();
+        tasks.emplace(tid, std::move(task)); 
+
+        // Tag the task with its virtual start time and insert it in tag order (see flowState)
+        auto flow = flows.find(flow_id);
+        if (flow == flows.end()) {
+            flow = flows.emplace(flow_id, flowState{virtual_time, 0}).first;
+        }
+        pendingTask pending = {tid, std::max(virtual_time, flow->second.finish), n_submitted++, std::chrono::steady_clock::now(), deadline};
+        flow->second.finish = pending.tag + std::max<uint64_t>(cost, 1);
+        flow->second.n_pending++;
+
+        // Insert the task in its class of the bitstream's run queue, by deadline and tag
+        runQueue &queue = run_queues[functions[fid]->getBitstreamPath()];
+        std::deque<pendingTask> &queue_class = queue.classes[priority];
+        queue_class.insert(std::upper_bound(queue_class.begin(), queue_class.end(), pending), pending);
+        queue.size++;
+        n_pending++;
+
+        // Submitted tasks take precedence over a speculative reconfiguration that didn't start yet
+        preload_fid = -1;
     }
+    tcv.notify_one();
 
-    tlock.lock();
-    // IMPORTANT: Due to the move, after the following line, this function has no ownership of the task pointer
-    // Therefore, any operation, such as task->(...), will cause a segmentation fault
-    // Note the use of tid instead of task->getTid() to avoid dereferencing the moved task pointer
-    tasks.push_back(std::move(task)); 
-    task_id_map.emplace(tid, tasks.size() - 1);
-    tlock.unlock();
-    syslog(LOG_NOTICE, "Added task with ID %d to the scheduler", tid);
+    if (log_tasks) {
+        CYT_LOG(LOG_NOTICE, "Added task with ID %d to the scheduler", tid);
+    }
     return true;
 }
 
+std::map<int32_t, cTaskMetrics> cSched::getMetrics() {
+    std::lock_guard<std::mutex> guard(tlock);
+    return metrics;
+}
+
 bool cSched::isTaskCompleted(int32_t tid) {
-    tlock.lock();
+    std::lock_guard<std::mutex> guard(tlock);
     if (!taskChecker(tid)) {
-        tlock.unlock();
         return false;
     }
-    bool completed = tasks[task_id_map[tid]]->isCompleted();
-    tlock.unlock();
-    return completed;
+    return tasks[tid]->isCompleted();
 }
 
 cTask* cSched::getTask(int32_t tid) {
-    tlock.lock();
+    std::lock_guard<std::mutex> guard(tlock);
     if (!taskChecker(tid)) {
-        tlock.unlock();
         return nullptr;
     }
-    cTask* task = tasks[task_id_map[tid]].get();
-    tlock.unlock();
-    return task;
+    return tasks[tid].get();
+}
+
+bool cSched::releaseTask(int32_t tid) {
+    std::lock_guard<std::mutex> guard(tlock);
+    if (!taskChecker(tid) || !tasks[tid]->isCompleted()) {
+        return false;
+    }
+    tasks.erase(tid);
+    return true;
+}
+
+size_t cSched::getLoad() {
+    std::lock_guard<std::mutex> guard(tlock);
+    return n_pending + n_executing;
+}
+
+std::string cSched::getCurrentBitstream() {
+    std::lock_guard<std::mutex> guard(tlock);
+    return current_bitstream;
 }
 
 bool cSched::isFunctionRegistered(int32_t fid) {
@@ -237,10 +564,95 @@ bool cSched::isFunctionRegistered(int32_t fid) {
 
 bFunc* cSched::getFunction(int32_t fid) {
     if (functions.find(fid) == functions.end()) {
-        syslog(LOG_WARNING, "Function with ID %d not found in the scheduler, returning nullptr", fid);
+        CYT_LOG(LOG_WARNING, "Function with ID %d not found in the scheduler, returning nullptr", fid);
         return nullptr;
     }
     return functions[fid].get();
 }
 
+std::vector<int32_t> cSched::getFunctionIds() {
+    std::vector<int32_t> fids;
+    for (auto &func : functions) {
+        fids.push_back(func.first);
+    }
+    return fids;
+}
+
+int cSched::addFunction(std::unique_ptr<bFunc> fn) {
+    std::vector<std::unique_ptr<bFunc>> fns;
+    fns.emplace_back(std::move(fn));
+    return addFunctions(std::move(fns))[0];
+}
+
+std::vector<int> cSched::addFunctions(std::vector<std::unique_ptr<bFunc>> fns) {
+    // Register the functions first; the bitstreams are then loaded in parallel, one file per loader thread
+    std::vector<int> ret_codes(fns.size(), 0);
+    std::vector<size_t> added;
+    std::vector<bFunc*> added_fns;
+    for (size_t i = 0; i < fns.size(); i++) {
+        int32_t fid = fns[i]->getFid();
+        if (functions.find(fid) != functions.end()) {
+            CYT_LOG(LOG_WARNING, "Function with fid %d already exists, skipping...", fid);
+            ret_codes[i] = 2;
+            continue;
+        }
+        added.push_back(i);
+        added_fns.push_back(fns[i].get());
+        functions.emplace(fid, std::move(fns[i]));
+    }
+
+    std::vector<std::string> errors(added.size());
+    std::vector<char> unopened(added.size(), false);
+    std::atomic<size_t> next(0);
+    auto loader = [&]() {
+        for (size_t i = next++; i < added.size(); i = next++) {
+            bFunc *fn = added_fns[i];
+            std::ifstream bitstream_file(fn->getBitstreamPath(), std::ios::ate | std::ios::binary);
+            if (!bitstream_file) {
+                unopened[i] = true;
+                continue;
+            }
+
+            // With lazy loading, the bitstream is staged when the vFPGA is reconfigured (see loadBitstream)
+            try {
+                if (lazy_bitstreams) {
+                    fn->setBitstreamPointer(std::make_pair(nullptr, 0));
+                } else {
+                    fn->setBitstreamPointer(readBitstream(fn->getBitstreamPath()));
+                }
+            } catch (const std::exception &e) {
+                errors[i] = e.what();
+            }
+        }
+    };
+
+    std::vector<std::thread> loaders;
+    size_t n_loaders = lazy_bitstreams ? 1 : std::min<size_t>(added.size(), BITSTREAM_LOAD_FUNCS);
+    for (size_t t = 1; t < n_loaders; t++) {
+        loaders.emplace_back([&] {
+            cThreadConfig::apply(CoyoteThreadRole::LOADER);
+            loader();
+        });
+    }
+    loader();
+    for (std::thread &t : loaders) {
+        t.join();
+    }
+
+    for (size_t i = 0; i < added.size(); i++) {
+        int32_t fid = added_fns[i]->getFid();
+        if (unopened[i]) {
+            CYT_LOG(LOG_ERR, "Function %d bitstream could not be opened; please check the provided bitstream path", fid);
+        } else if (!errors[i].empty()) {
+            CYT_LOG(LOG_ERR, "Exception while loading function fid %d bitstream: %s", fid, errors[i].c_str());
+        } else {
+            CYT_LOG(LOG_NOTICE, "Added function with fid %d", fid);
+            continue;
+        }
+        functions.erase(fid);
+        ret_codes[added[i]] = 1;
+    }
+    return ret_codes;
+}
+
 }
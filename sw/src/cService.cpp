@@ -25,18 +25,24 @@
  */
 
 #include <coyote/cService.hpp>
+#include <coyote/cThreadConfig.hpp>
 
 namespace coyote {
 
 std::map<std::string, cService*> coyote::cService::services;
 
-cService::cService(std::string name, bool remote, int32_t vfid, uint32_t device, bool reorder, uint16_t port):
-    remote(remote), vfid(vfid), device(device), port(port), is_running(false) {
-    service_id = ("coyote-daemon-dev-" + std::to_string(device) + "-vfid-" + std::to_string(vfid) + "-" + name).c_str();
+cService::cService(std::string name, bool remote, std::vector<cRegion> regions, bool reorder, uint16_t port):
+    remote(remote), regions(regions), port(port), is_running(false) {
+    service_id = "coyote-daemon";
+    for (cRegion &region : regions) {
+        service_id += "-dev-" + std::to_string(region.device) + "-vfid-" + std::to_string(region.vfid);
+    }
+    service_id += "-" + name;
     socket_name = ("/tmp/" + service_id).c_str();
     sockfd = -1;
     task_counter = 0;
-    scheduler = cSched::getInstance(vfid, device, reorder);
+    scheduler = std::make_unique<cMultiSched>(regions, reorder);
+    scheduler->setCompletionCallback([this](cTask *task) { completeTask(task); });
 }
 
 void cService::sigHandler(int signum) {
@@ -45,7 +51,7 @@ void cService::sigHandler(int signum) {
             cservice->daemonSigHandler(signum);
             delete cservice;
             cservice = nullptr;
-            syslog(LOG_NOTICE, "Released service %s memory", key.c_str());
+            CYT_LOG(LOG_NOTICE, "Released service %s memory", key.c_str());
         }
     }
     exit(EXIT_SUCCESS);
@@ -54,22 +60,28 @@ void cService::sigHandler(int signum) {
 void cService::daemonSigHandler(int signum) {
     // Handle termination signals; cleanup resources and stop active threads
     if (signum == SIGTERM || signum == SIGKILL) {
-        syslog(LOG_NOTICE, "SIGTERM received, exiting...\n");
-
-        scheduler->stop();
+        CYT_LOG(LOG_NOTICE, "SIGTERM received, exiting...\n");
 
-        // TODO: Do we need to add active connection to conns_to_clean?
-        run_cleanup_thread = false;
-        if (cleanup_thread.joinable()) {
-            cleanup_thread.join();
+        // Stop the reactors first, so that no new tasks are submitted to the scheduler
+        run_reactors = false;
+        for (std::thread &reactor : reactors) {
+            if (reactor.joinable()) {
+                reactor.join();
+            }
         }
+        for (int epoll_fd : epoll_fds) {
+            close(epoll_fd);
+        }
+
+        scheduler->stop();
 
         unlink(socket_name.c_str());
+        cLog::flush();
         closelog();
-        syslog(LOG_NOTICE, "Daemon %s terminated", service_id.c_str());
+        CYT_LOG(LOG_NOTICE, "Daemon %s terminated", service_id.c_str());
     // And ignore others...
     } else {
-        syslog(LOG_NOTICE, "Signal %d not handled, ignoring", signum);
+        CYT_LOG(LOG_NOTICE, "Signal %d not handled, ignoring", signum);
     }   
 }
 
@@ -102,7 +114,7 @@ void cService::initDaemon() {
 
     // Set-up syslog
     openlog(service_id.c_str(), LOG_NOWAIT | LOG_PID, LOG_USER);
-    syslog(LOG_NOTICE, "Successfully started daemon %s", service_id.c_str());
+    CYT_LOG(LOG_NOTICE, "Successfully started daemon %s", service_id.c_str());
 
     close(STDIN_FILENO);
     close(STDOUT_FILENO);
@@ -111,36 +123,42 @@ void cService::initDaemon() {
 
 void cService::initSocket() {
     if (remote) {
-        syslog(LOG_NOTICE, "Initializating socket for remote connections");
+        CYT_LOG(LOG_NOTICE, "Initializating socket for remote connections");
 
         // Create the socket and check if it's successful
         sockfd = ::socket(AF_INET, SOCK_STREAM, 0);
         if (sockfd == -1) {
-            syslog(LOG_ERR, "Error creating server socket");
+            CYT_LOG(LOG_ERR, "Error creating server socket");
             exit(EXIT_FAILURE);
         }
 
+        // Allow restarting the service straight away, without waiting for old connections in TIME_WAIT
+        int one = 1;
+        if (setsockopt(sockfd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) < 0) {
+            CYT_LOG(LOG_WARNING, "Could not set SO_REUSEADDR for the server socket");
+        }
+
         // Bind the socket to any IP of the node and the target port
         struct sockaddr_in server;
         server.sin_family = AF_INET;
         server.sin_addr.s_addr = INADDR_ANY;
         server.sin_port = htons(port);
         if (::bind(sockfd, (struct sockaddr*) &server, sizeof(server)) < 0) {
-            syslog(LOG_ERR, "Error binding socket");
+            CYT_LOG(LOG_ERR, "Error binding socket");
             exit(EXIT_FAILURE);
         }
 
         if (sockfd < 0) {
-            syslog(LOG_ERR, "Error listening to port socket %d", port);
+            CYT_LOG(LOG_ERR, "Error listening to port socket %d", port);
             exit(EXIT_FAILURE);
         }
 
     } else {
-        syslog(LOG_NOTICE, "Initializating socket for local connections");
+        CYT_LOG(LOG_NOTICE, "Initializating socket for local connections");
 
         // Create a local socket for IPC and check success
         if ((sockfd = socket(AF_UNIX, SOCK_STREAM, 0)) == -1) {
-            syslog(LOG_ERR, "Error creating server socket");
+            CYT_LOG(LOG_ERR, "Error creating server socket");
             exit(EXIT_FAILURE);
         }
 
@@ -151,275 +169,621 @@ void cService::initSocket() {
         unlink(server.sun_path);
         socklen_t len = strlen(server.sun_path) + sizeof(server.sun_family);
         if (bind(sockfd, (struct sockaddr *) &server, len) == -1) {
-            syslog(LOG_ERR, "Error binding socket");
+            CYT_LOG(LOG_ERR, "Error binding socket");
             exit(EXIT_FAILURE);
         }
     }
 
-    // Try to listen to the socket 
-    if (listen(sockfd, MAX_NUM_CLIENTS) == -1) {
-        syslog(LOG_ERR, "Error listening on socket");
+    // Try to listen to the socket; with the event loop, the number of clients is only limited by the the connection backlog
+    if (listen(sockfd, SOMAXCONN) == -1) {
+        CYT_LOG(LOG_ERR, "Error listening on socket");
         exit(EXIT_FAILURE);
     }
 
-    syslog(LOG_NOTICE, "Socket initialized");
+    CYT_LOG(LOG_NOTICE, "Socket initialized");
 
 }
 
-void cService::cleanConns() {
-    syslog(LOG_NOTICE, "Starting cleanConns thread");
-
-    while (run_cleanup_thread) {
-        // Iterate over the connection and release the ones that are stale
-        auto tmp = conns_to_clean.begin();
-        while (tmp != conns_to_clean.end()) {
-            int connfd = (*tmp).first;
-            bool is_stale = (*tmp).second;
-
-            if (is_stale) {
-                syslog(LOG_NOTICE, "Releasing resources for connection %d", connfd);
-                // Join the thread for processing requests and sending responses
-                if (connection_threads.find(connfd) != connection_threads.end()) {
-                    if (connection_threads[connfd].first.joinable()) {
-                        connection_threads[connfd].first.join();
-                    }
-                    if (connection_threads[connfd].second.joinable()) {
-                        connection_threads[connfd].second.join();
-                    }
-                    connection_threads.erase(connfd);
-                }
-                
-                // Release the Coyote thread
-                if (coyote_threads.find(connfd) != coyote_threads.end()) {
-                    coyote_threads.erase(connfd);
-                }
+std::shared_ptr<cService::clientConn> cService::getClient(int connfd) {
+    std::lock_guard<std::mutex> guard(clients_lock);
+    auto client = clients.find(connfd);
+    return client == clients.end() ? nullptr : client->second;
+}
 
-                // Delete the task entry and the corresponding lock associated to this client
-                if (tasks.find(connfd) != tasks.end()) {
-                    tasks.erase(connfd);
-                }
+void cService::runReactor(uint32_t reactor) {
+    cThreadConfig::apply(CoyoteThreadRole::SERVICE, reactor);
+    CYT_LOG(LOG_NOTICE, "Starting reactor %u", reactor);
+
+    struct epoll_event events[DAEMON_MAX_EVENTS];
+    while (run_reactors) {
+        int n = epoll_wait(epoll_fds[reactor], events, DAEMON_MAX_EVENTS, DAEMON_EPOLL_TIMEOUT);
+        for (int i = 0; i < n; i++) {
+            std::shared_ptr<clientConn> conn = getClient(events[i].data.fd);
+            if (conn == nullptr) {
+                continue;
+            }
 
-                if (task_locks.find(connfd) != task_locks.end()) {
-                    task_locks.erase(connfd);
+            // Doorbell of the shared-memory request ring
+            if (events[i].data.fd == conn->req_efd) {
+                if (!processShmRequests(conn)) {
+                    closeClient(conn);
                 }
+                continue;
+            }
 
-                // Delete the is_stale entry for this confd; done in case there are future connections with the same connfd value. 
-                // See acceptConnectionLocal() function for an explanation when this could happen.
-                tmp = conns_to_clean.erase(tmp);
-                syslog(LOG_NOTICE, "Resources released");
+            bool keep = !(events[i].events & (EPOLLERR | EPOLLHUP));
+            if (keep && (events[i].events & EPOLLOUT)) {
+                keep = flushResponses(*conn);
+            }
+            if (keep && (events[i].events & (EPOLLIN | EPOLLRDHUP))) {
+                keep = processRequests(conn);
+            }
+            if (!keep) {
+                closeClient(conn);
+            }
+        }
+    }
 
-                if (tmp != conns_to_clean.end()) {
-                    tmp++;
-                }
+    CYT_LOG(LOG_NOTICE, "Reactor %u stopped", reactor);
+}
+
+bool cService::processRequests(const std::shared_ptr<clientConn> &conn) {
+    /*
+     * Requests arrive as a stream of frames (a cReqHeader followed by the arguments, see cConn), and a client
+     * can pipeline many of them in a single write. Therefore, read everything that is available (the socket is
+     * non-blocking) and handle all the complete frames; an incomplete frame is kept until the rest of it arrives.
+     */
+    while (true) {
+        ssize_t n = read(conn->connfd, conn->recv_buff.data() + conn->recv_len, conn->recv_buff.size() - conn->recv_len);
+        if (n == 0) {
+            CYT_LOG(LOG_NOTICE, "Client with connfd %d disconnected", conn->connfd);
+            return false;
+        } else if (n < 0) {
+            if (errno == EINTR) { continue; }
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+        conn->recv_len += n;
+
+        if (!handleRequests(conn, conn->recv_buff, conn->recv_len)) {
+            return false;
+        }
+    }
+}
+
+bool cService::processShmRequests(const std::shared_ptr<clientConn> &conn) {
+    eventfd_t val;
+    eventfd_read(conn->req_efd, &val);
+
+    // Drain the ring until it is empty after announcing the wait; afterwards, the client rings the doorbell for the next request
+    do {
+        size_t n;
+        while ((n = conn->shm->req.pop(conn->shm_recv_buff.data() + conn->shm_recv_len, conn->shm_recv_buff.size() - conn->shm_recv_len)) > 0) {
+            conn->shm_recv_len += n;
+            if (!handleRequests(conn, conn->shm_recv_buff, conn->shm_recv_len)) {
+                return false;
             }
         }
+    } while (!conn->shm->req.prepareWait());
+
+    return true;
+}
 
-        std::this_thread::sleep_for(std::chrono::microseconds(DAEMON_CLEAN_CONNS_SLEEP));
+bool cService::handleRequests(const std::shared_ptr<clientConn> &conn, std::vector<char> &buff, size_t &len) {
+    size_t offset = 0;
+    bool keep = true;
+    while (keep && len - offset >= sizeof(cReqHeader)) {
+        cReqHeader header;
+        memcpy(&header, buff.data() + offset, sizeof(cReqHeader));
+        if (header.payload_size > MAX_MSG_PAYLOAD_SIZE) {
+            // The stream can no longer be parsed; there is no other option but to drop the client
+            CYT_LOG(LOG_ERR, "Received a request of %u bytes from client %d, exceeding the limit; closing connection", header.payload_size, conn->connfd);
+            return false;
+        }
+
+        size_t frame_size = sizeof(cReqHeader) + header.payload_size;
+        if (len - offset < frame_size) {
+            if (frame_size > buff.size()) {
+                buff.resize(frame_size);
+            }
+            break;
+        }
+
+        keep = handleRequest(conn, header, buff.data() + offset + sizeof(cReqHeader));
+        offset += frame_size;
     }
+
+    // Move the incomplete frame (if any) to the start of the buffer
+    if (offset) {
+        memmove(buff.data(), buff.data() + offset, len - offset);
+        len -= offset;
+    }
+
+    // The buffer grows to fit large requests (with bulk arguments); release the memory once they have been handled
+    if (buff.size() > DAEMON_RX_BUFF_SIZE && len == 0) {
+        buff.resize(DAEMON_RX_BUFF_SIZE);
+        buff.shrink_to_fit();
+    }
+    return keep;
 }
 
-void cService::processRequests(int connfd) {
-    bool running = true;
-    syslog(LOG_NOTICE, "Starting connection thread for client with connfd %d", connfd);
-
-    while (running) {
-        char recv_buf[RECV_BUFF_SIZE];
-        if (read(connfd, recv_buf, 3 * sizeof(int32_t)) == 3 * sizeof(int32_t)) {
-            // Read opcode (DEF_OP_CLOSE_CONN or DEF_OP_SUBMIT_TASK)
-            int32_t request[3];
-            memcpy(&request, recv_buf, 3 * sizeof(int32_t));
-            int32_t opcode = request[0];
-
-            switch (opcode) {
-                case DEF_OP_CLOSE_CONN: {
-                    syslog(LOG_NOTICE, "Received close connection request for client with connfd %d", connfd);
-                    close(connfd);
-                    running = false;
-                    break;
-                }
+bool cService::handleRequest(const std::shared_ptr<clientConn> &conn, const cReqHeader &header, const char *payload) {
+    switch (header.opcode) {
+        case DEF_OP_CLOSE_CONN: {
+            CYT_LOG(LOG_NOTICE, "Received close connection request for client with connfd %d", conn->connfd);
+            return false;
+        }
 
-                case DEF_OP_SUBMIT_TASK: {
-                    // Read function and task ID; check if the function ID has been registered with the service; 
-                    // If not, return appropriate (error) code and stop function execution
-                    int32_t fid = request[1];
-                    int32_t client_tid = request[2];
-                    
-                    // If the function is not found, stop execution
-                    if (!scheduler->isFunctionRegistered(fid)) {
-                        syslog(LOG_WARNING, "Client %d requested unkown function, fid: %d with client_tid: %d, stopping request...", connfd, fid, client_tid);
-                        bool send_buff[RECV_BUFF_SIZE];
-                        int32_t ret_code = 1;
-                        memcpy(send_buff, &ret_code, sizeof(int32_t));
-                        memcpy(send_buff + sizeof(int32_t), &client_tid, sizeof(int32_t));
-                        if (write(connfd, &send_buff, 2 * sizeof(int32_t)) != 2 * sizeof(int32_t)) {
-                            syslog(LOG_ERR, "Return code could not be sent, connfd: %d, client_tid: %d", connfd, client_tid);
-                        } 
-                        break;
-                    }
-                    
-                    // Otherwise, function is found and the task can be submitted to the scheduler
-                    bFunc *requested_func = scheduler->getFunction(fid);
-                    if (requested_func == nullptr) {
-                        syslog(LOG_ERR, "UNEXPECTED BUG: Function with fid: %d marked as registered, but scheduler returned nullptr?!", fid);
-                        continue;
-                    }
-                    syslog(LOG_NOTICE, "Client %d requested function fid: %d with client_tid: %d", connfd, fid, client_tid);
-
-                    // Parse client arguments and store into a vector of char buffers; one for each function argument
-                    int32_t ret_code = 0;
-                    std::vector<std::vector<char>> arguments;     
-                    std::vector<size_t> argument_sizes = requested_func->getArgumentSizes();
-
-                    for (size_t &arg_size: argument_sizes) {
-                        char recv_buff[RECV_BUFF_SIZE];
-                        if (read(connfd, recv_buff, arg_size) == arg_size) {
-                            std::vector<char> arg(recv_buff, recv_buff + arg_size);
-                            arguments.emplace_back(arg);
-                        } else {
-                            // Failed to parse arguments; inform client and stop execution
-                            syslog(LOG_WARNING, "Could not parse function arguments, fid: %d, connfd: %d, returning 1", fid, connfd);
-                            bool send_buff[RECV_BUFF_SIZE];
-                            ret_code = 1;
-                            memcpy(send_buff, &ret_code, sizeof(int32_t));
-                            memcpy(send_buff + sizeof(int32_t), &client_tid, sizeof(int32_t));
-                            if (write(connfd, &send_buff, 2 * sizeof(int32_t)) != 2 * sizeof(int32_t)) {
-                                syslog(LOG_ERR, "Return code could not be sent, connfd: %d, client_tid: %d", connfd, client_tid);
-                            }
-                            break;
-                        }
-                    }
+        case DEF_OP_SUBMIT_TASK: {
+            // Check if the function ID has been registered with the service; 
+            // If not, return appropriate (error) code and stop function execution
+            int32_t fid = header.fid;
+            int32_t client_tid = header.tid;
+            cRespHeader error = { DEF_RET_ERROR, client_tid, 0 };
+            if (!scheduler->isFunctionRegistered(fid)) {
+                CYT_LOG(LOG_WARNING, "Client %d requested unkown function, fid: %d with client_tid: %d, stopping request...", conn->connfd, fid, client_tid);
+                sendResponse(*conn, error, nullptr);
+                return true;
+            }
+            
+            // Otherwise, function is found and the task can be submitted to the scheduler
+            bFunc *requested_func = scheduler->getFunction(fid);
+            if (requested_func == nullptr) {
+                CYT_LOG(LOG_ERR, "UNEXPECTED BUG: Function with fid: %d marked as registered, but scheduler returned nullptr?!", fid);
+                sendResponse(*conn, error, nullptr);
+                return true;
+            }
+            if (log_tasks) {
+                CYT_LOG(LOG_NOTICE, "Client %d requested function fid: %d with client_tid: %d", conn->connfd, fid, client_tid);
+            }
 
-                    // If ret code is not zero, it means that the arguments could not be parsed; stop execution
-                    if (ret_code) { break; }
-
-                    // Check entries for this client connections exist --- they always should as they are created when client connects
-                    // However, double check to avoid segmentation faults that can crash the server
-                    if (tasks.find(connfd) == tasks.end() || task_locks.find(connfd) == task_locks.end()) {
-                        syslog(LOG_ERR, "UNEXPECTED BUG: No task entry found in map for connfd: %d", connfd);
-                        ret_code = 1;
-                        bool send_buff[RECV_BUFF_SIZE];
-                        memcpy(send_buff, &ret_code, sizeof(int32_t));
-                        memcpy(send_buff + sizeof(int32_t), &client_tid, sizeof(int32_t));
-                        if (write(connfd, &send_buff, 2 * sizeof(int32_t)) != 2 * sizeof(int32_t)) {
-                            syslog(LOG_ERR, "Return code could not be sent, connfd: %d, client_tid: %d", connfd, client_tid);
-                        }
-                        break;
-                    }
+            /*
+             * The payload holds all the arguments back-to-back, with variable-length arguments prefixed by their size;
+             * it is copied into the task's argument storage as a whole, and the arguments are deserialized from there.
+             * Since the frame carries its own length, a malformed payload only fails this request, not the rest of the stream.
+             */
+            cTaskArgs arguments;
+            bool parsed = arguments.parse(payload, header.payload_size, requested_func->getArgumentSizes());
+
+            if (!parsed) {
+                CYT_LOG(
+                    LOG_WARNING, "Could not parse function arguments, fid: %d, connfd: %d, payload of %u bytes doesn't match the signature, returning 1", 
+                    fid, conn->connfd, header.payload_size
+                );
+                sendResponse(*conn, error, nullptr);
+                return true;
+            }
 
-                    // Create a new task and add it to the scheduler; if for some reason the task could not be added, return an error code to the client
-                    int32_t server_tid = task_counter++;
-                    task_locks[connfd]->lock();
-                    tasks[connfd].emplace_back(client_tid, server_tid);
-                    task_locks[connfd]->unlock();
-
-                    std::unique_ptr<cTask> task = std::make_unique<cTask>(server_tid, fid,  requested_func->getReturnSize(), coyote_threads[connfd].get(), std::move(arguments));
-                    bool task_added = scheduler->addTask(std::move(task));
-
-                    if (!task_added) {
-                        syslog(
-                            LOG_ERR, 
-                            "Could not add task with server_tid: %d, client_tid: %d, fid: %d, connfd: %d; most likely a server error; returning error code",
-                            server_tid, client_tid, fid, connfd
-                        );
-                        bool send_buff[RECV_BUFF_SIZE];
-                        ret_code = 1;
-                        memcpy(send_buff, &ret_code, sizeof(int32_t));
-                        memcpy(send_buff + sizeof(int32_t), &client_tid, sizeof(int32_t));
-                        if (write(connfd, &send_buff, 2 * sizeof(int32_t)) != 2 * sizeof(int32_t)) {
-                            syslog(LOG_ERR, "Return code could not be sent, connfd: %d, client_tid: %d", connfd, client_tid);
-                        }
-                        break;
+            // Idempotent functions: answer a repeated request straight from the result cache
+            std::vector<char> cached_ret_val;
+            if (requested_func->isCacheable() && result_cache.get(fid, arguments, cached_ret_val)) {
+                cRespHeader header = { 0, client_tid, (uint32_t) cached_ret_val.size() };
+                sendResponse(*conn, header, cached_ret_val.data());
+                if (log_tasks) {
+                    CYT_LOG(LOG_NOTICE, "Served task with client_tid: %d, fid: %d, connfd: %d from the result cache", client_tid, fid, conn->connfd);
+                }
+                stats_lock.lock();
+                metrics[fid].n_cached++;
+                stats_lock.unlock();
+                return true;
+            }
+
+            // Pick the region and, if this is the client's first task there, get a Coyote thread for the region from its pool
+            int32_t region = scheduler->pickRegion(fid);
+            int32_t server_tid = task_counter++;
+            bool task_added = false;
+            if (region != -1) {
+                try {
+                    if (!conn->coyote_threads[region]) {
+                        conn->coyote_threads[region] = thread_pools[region]->acquire(conn->rpid);
+
+                        // All the Coyote threads executing on the service's vFPGAs live in the daemon, so an in-process lock suffices
+                        conn->coyote_threads[region]->setLockBackend(CoyoteLock::PROCESS);
                     }
 
-                    syslog(
-                        LOG_NOTICE, 
-                        "Added task with server_tid: %d, client_tid: %d, fid: %d, connfd: %d to scheduler queue",
-                        server_tid, client_tid, fid, connfd
-                    );
-                    break;
-                    
+                    // Admission control; register the task before submitting it, since the response is pushed as soon as the task completes
+                    pending_lock.lock();
+                    if (conn->n_pending >= max_client_tasks || pending_tasks.size() >= max_tasks) {
+                        pending_lock.unlock();
+                        CYT_LOG(LOG_WARNING, "Rejected task with client_tid: %d from client %d, too many outstanding tasks", client_tid, conn->connfd);
+                        cRespHeader busy = { DEF_RET_BUSY, client_tid, 0 };
+                        sendResponse(*conn, busy, nullptr);
+                        stats_lock.lock();
+                        metrics[fid].n_rejected++;
+                        stats_lock.unlock();
+                        return true;
+                    }
+                    pending_tasks.emplace(server_tid, std::make_pair(conn, client_tid));
+                    conn->n_pending++;
+                    pending_lock.unlock();
+
+                    std::unique_ptr<cTask> task = std::make_unique<cTask>(server_tid, fid,  requested_func->getReturnSize(), conn->coyote_threads[region].get(), std::move(arguments));
+                    task->setWeight(conn->weight);
+                    task->setPriority(header.priority);
+                    task->setDeadline(std::chrono::microseconds(header.deadline_us));
+                    task_added = scheduler->addTask(region, std::move(task));
+                } catch (const std::exception &e) {
+                    CYT_LOG(LOG_ERR, "Could not create a Coyote thread for client %d: %s", conn->connfd, e.what());
                 }
-                
-                default: {
-                    syslog(LOG_WARNING, "Received unknown request from client %d with opcode %d, ignoring...", connfd, opcode);
-                    break;
+            }
+
+            if (!task_added) {
+                CYT_LOG(
+                    LOG_ERR, 
+                    "Could not add task with server_tid: %d, client_tid: %d, fid: %d, connfd: %d; most likely a server error; returning error code",
+                    server_tid, client_tid, fid, conn->connfd
+                );
+                pending_lock.lock();
+                if (pending_tasks.erase(server_tid)) {
+                    conn->n_pending--;
                 }
+                pending_lock.unlock();
+                sendResponse(*conn, error, nullptr);
+                return true;
             }
 
+            CYT_LOG(
+                LOG_NOTICE, 
+                "Added task with server_tid: %d, client_tid: %d, fid: %d, connfd: %d to scheduler queue",
+                server_tid, client_tid, fid, conn->connfd
+            );
+            return true;
+        }
+
+        case DEF_OP_QUERY_LOAD: {
+            // Load report for client-side routing (see cConnGroup); not subject to admission control, so that busy services can still be queried
+            std::vector<int32_t> fids = scheduler->getFunctionIds();
+            cLoadReport report = { 0, max_tasks, 0, max_client_tasks, (uint32_t) fids.size() };
+            pending_lock.lock();
+            report.n_outstanding = pending_tasks.size();
+            report.n_client_outstanding = conn->n_pending;
+            pending_lock.unlock();
+
+            std::vector<char> payload(sizeof(cLoadReport) + fids.size() * sizeof(int32_t));
+            memcpy(payload.data(), &report, sizeof(cLoadReport));
+            memcpy(payload.data() + sizeof(cLoadReport), fids.data(), fids.size() * sizeof(int32_t));
+            cRespHeader resp = { 0, header.tid, (uint32_t) payload.size() };
+            sendResponse(*conn, resp, payload.data());
+            return true;
+        }
+
+        default: {
+            CYT_LOG(LOG_WARNING, "Received unknown request from client %d with opcode %d, ignoring...", conn->connfd, header.opcode);
+            return true;
+        }
+    }
+}
+
+void cService::sendResponse(clientConn &conn, const cRespHeader &header, const char *payload) {
+    std::lock_guard<std::mutex> guard(conn.send_lock);
+    if (conn.closed) {
+        return;
+    }
+
+    // Clients with a shared-memory channel get the response through the ring, unless it is full
+    struct iovec iov[2] = { { (void *) &header, sizeof(cRespHeader) }, { (void *) payload, header.payload_size } };
+    if (conn.shm != nullptr && conn.shm->resp.push(iov, header.payload_size ? 2 : 1)) {
+        if (conn.shm->resp.needsWakeUp()) {
+            eventfd_write(conn.resp_efd, 1);
+        }
+        return;
+    }
+
+    // Responses on the socket must be sent in order; if some are already buffered, append to them; the reactor sends them on EPOLLOUT
+    if (!conn.send_buff.empty()) {
+        const char *header_ptr = (const char *) &header;
+        conn.send_buff.insert(conn.send_buff.end(), header_ptr, header_ptr + sizeof(cRespHeader));
+        conn.send_buff.insert(conn.send_buff.end(), payload, payload + header.payload_size);
+        return;
+    }
+
+    // Otherwise, try to write the header and the return value directly from the task, with a single writev
+    size_t total = sizeof(cRespHeader) + header.payload_size;
+    ssize_t n;
+    do {
+        n = writev(conn.connfd, iov, header.payload_size ? 2 : 1);
+    } while (n < 0 && errno == EINTR);
+
+    if (n < 0) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            CYT_LOG(LOG_ERR, "Response could not be sent, connfd: %d, client_tid: %d", conn.connfd, header.tid);
+            return;
         }
+        n = 0;
+    }
 
-        std::this_thread::sleep_for(std::chrono::nanoseconds(DAEMON_PROCESS_REQUESTS_SLEEP));
+    // Socket full; buffer the remainder and wait until the socket becomes writable
+    if ((size_t) n < total) {
+        bufferResponse(conn, iov, header.payload_size ? 2 : 1, n);
+    }
+}
 
+bool cService::sendSharedResponse(clientConn &conn, int32_t client_tid, const std::vector<char> &ret_val) {
+    // Write the return value to a memory file; the client maps it read-only
+    int fd = memfd_create("coyote-result", MFD_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    size_t written = 0;
+    if (ftruncate(fd, ret_val.size()) == 0) {
+        while (written < ret_val.size()) {
+            ssize_t n = write(fd, ret_val.data() + written, ret_val.size() - written);
+            if (n < 0 && errno == EINTR) { continue; }
+            if (n <= 0) { break; }
+            written += n;
+        }
+    }
+    if (written < ret_val.size()) {
+        close(fd);
+        return false;
+    }
+
+    std::lock_guard<std::mutex> guard(conn.send_lock);
+    if (conn.closed) {
+        close(fd);
+        return true;
     }
 
-    conns_to_clean.emplace(connfd, true);
-    syslog(LOG_NOTICE, "Connection %d closing ...", connfd);
+    // The descriptor is attached to the first byte of the response, so it must be written directly, not buffered
+    if (!conn.send_buff.empty()) {
+        close(fd);
+        return false;
+    }
 
+    cRespHeader header = { 0, client_tid, sizeof(uint64_t), DEF_RESP_SHARED };
+    uint64_t size = ret_val.size();
+    struct iovec iov[2] = { { (void *) &header, sizeof(cRespHeader) }, { (void *) &size, sizeof(uint64_t) } };
+
+    struct msghdr msg = {};
+    alignas(struct cmsghdr) char cmsg_buff[CMSG_SPACE(sizeof(int))] = {};
+    msg.msg_iov = iov;
+    msg.msg_iovlen = 2;
+    msg.msg_control = cmsg_buff;
+    msg.msg_controllen = sizeof(cmsg_buff);
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+
+    ssize_t n;
+    do {
+        n = sendmsg(conn.connfd, &msg, MSG_NOSIGNAL);
+    } while (n < 0 && errno == EINTR);
+    close(fd);
+
+    if (n < 0) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            CYT_LOG(LOG_ERR, "Shared response could not be sent, connfd: %d, client_tid: %d", conn.connfd, client_tid);
+            return true;
+        }
+        return false;
+    }
+
+    if ((size_t) n < sizeof(cRespHeader) + sizeof(uint64_t)) {
+        bufferResponse(conn, iov, 2, n);
+    }
+    return true;
 }
 
-void cService::sendResponses(int connfd) {
-    syslog(LOG_NOTICE, "Starting response thread for client with connfd %d", connfd);
-    bool run_response_thread = true;
-    
-    while (run_response_thread) {
-        // Move sleep here instead of at the end; in case the following if skips this iteration
-        std::this_thread::sleep_for(std::chrono::nanoseconds(DAEMON_PROCESS_REQUESTS_SLEEP));
-
-        // For completness sake, check if there is an entry for this connection in the tasks map
-        // However, this should always be the case, as the connection thread is started only after the entry is created
-        bool entry_found = tasks.find(connfd) != tasks.end() && task_locks.find(connfd) != task_locks.end() ? true : false;
-        if (!entry_found) {
-            continue;
-        }
-
-        // Lock the mutex and iterate over the tasks for this connection
-        task_locks[connfd]->lock();
-        auto tmp = tasks[connfd].begin();
-        while (tmp != tasks[connfd].end()) {
-            int32_t client_tid = (*tmp).first;
-            int32_t server_tid = (*tmp).second;
-            
-            if (scheduler->isTaskCompleted(server_tid)) {
-                cTask *task = scheduler->getTask(server_tid);
-                if (task == nullptr) {
-                    syslog(LOG_ERR, "UNEXPECTED BUG: Task with server_tid: %d, connfd: %d marked as completed, but scheduler returned nullptr?!", server_tid, connfd);
-                    continue;
-                }
-                
-                // Function completed sucessfully, write success return code and task ID 
-                bool send_buff[RECV_BUFF_SIZE];
-                int32_t ret_code = 0;
-                memcpy(send_buff, &ret_code, sizeof(int32_t));
-                memcpy(send_buff + sizeof(int32_t), &client_tid, sizeof(int32_t));
-                if (write(connfd, &send_buff, 2 * sizeof(int32_t)) != 2 * sizeof(int32_t)) {
-                    syslog(LOG_ERR, "Return code could not be sent, connfd: %d, client_tid: %d", connfd, client_tid);
-                    break;
-                }
-                    
-                size_t return_size = task->getRetValSize();
-                if (write(connfd, task->getRetVal().data(), return_size) != return_size) {
-                    syslog(LOG_ERR, "Return value could not be sent, connfd: %d, client_tid: %d", connfd, client_tid);
-                }
+void cService::bufferResponse(clientConn &conn, struct iovec *iov, int iovcnt, size_t sent) {
+    for (int i = 0; i < iovcnt; i++) {
+        size_t skip = std::min(sent, iov[i].iov_len);
+        sent -= skip;
+        conn.send_buff.insert(conn.send_buff.end(), (char *) iov[i].iov_base + skip, (char *) iov[i].iov_base + iov[i].iov_len);
+    }
 
-                // Remove the task from the list to avoid sending the response again
-                tmp = tasks[connfd].erase(tmp);
-                syslog(LOG_NOTICE, "Sent response for task with server_tid: %d, client_tid: %d, connfd: %d", server_tid, client_tid, connfd);
-            
-            }
+    struct epoll_event event = {};
+    event.events = EPOLLIN | EPOLLRDHUP | EPOLLOUT;
+    event.data.fd = conn.connfd;
+    if (epoll_ctl(epoll_fds[conn.reactor], EPOLL_CTL_MOD, conn.connfd, &event) < 0) {
+        CYT_LOG(LOG_ERR, "Could not register connfd %d for EPOLLOUT", conn.connfd);
+    }
+}
 
-            if (tmp != tasks[connfd].end()) {
-                tmp++;
+bool cService::flushResponses(clientConn &conn) {
+    std::lock_guard<std::mutex> guard(conn.send_lock);
+    size_t sent = 0;
+    while (sent < conn.send_buff.size()) {
+        ssize_t n = write(conn.connfd, conn.send_buff.data() + sent, conn.send_buff.size() - sent);
+        if (n < 0) {
+            if (errno == EINTR) { continue; }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) { 
+                CYT_LOG(LOG_ERR, "Responses could not be sent, connfd: %d", conn.connfd);
+                return false; 
             }
+            break;
         }
-        
-        task_locks[connfd]->unlock();
-        
-        // If the connection has been marked for cleaning, stop the thread
-        // A connection can be marked for cleaning has sent a disconnect request (DEF_OP_CLOSE_CONN in processRequests())
-        if (conns_to_clean.find(connfd) != conns_to_clean.end()) {
-            run_response_thread = !conns_to_clean[connfd];
+        sent += n;
+    }
+    conn.send_buff.erase(conn.send_buff.begin(), conn.send_buff.begin() + sent);
+
+    // All the responses have been sent; stop waiting for the socket to become writable
+    if (conn.send_buff.empty()) {
+        struct epoll_event event = {};
+        event.events = EPOLLIN | EPOLLRDHUP;
+        event.data.fd = conn.connfd;
+        epoll_ctl(epoll_fds[conn.reactor], EPOLL_CTL_MOD, conn.connfd, &event);
+    }
+    return true;
+}
+
+void cService::completeTask(cTask *task) {
+    int32_t server_tid = task->getTid();
+    
+    // Look up (and remove) the client which submitted the task
+    pending_lock.lock();
+    auto pending = pending_tasks.find(server_tid);
+    if (pending == pending_tasks.end()) {
+        pending_lock.unlock();
+        CYT_LOG(LOG_WARNING, "Completed task with server_tid: %d does not belong to any client", server_tid);
+        return;
+    }
+    std::shared_ptr<clientConn> conn = std::move(pending->second.first);
+    int32_t client_tid = pending->second.second;
+    pending_tasks.erase(pending);
+    conn->n_pending--;
+    pending_lock.unlock();
+
+    // Frame the return code, task ID and the return value (if the task succeeded) and push it to the client
+    int32_t ret_code = task->getRetCode();
+    if (!ret_code) {
+        bFunc *func = scheduler->getFunction(task->getFid());
+        if (func != nullptr && func->isCacheable()) {
+            result_cache.put(task->getFid(), task->getArgs(), task->getRetVal());
         }
     }
+    // Large return values are shared through memory with local clients; the others are sent inline, if they fit into a message
+    const std::vector<char> &ret_val = task->getRetVal();
+    bool shared = !ret_code && conn->local && ret_val.size() >= SHARED_RESULT_THRESHOLD && sendSharedResponse(*conn, client_tid, ret_val);
+    if (!shared) {
+        if (!ret_code && ret_val.size() > MAX_MSG_PAYLOAD_SIZE) {
+            CYT_LOG(LOG_ERR, "Return value of task with server_tid: %d exceeds the maximum message size, size: %zu", server_tid, ret_val.size());
+            ret_code = DEF_RET_ERROR;
+        }
+        cRespHeader header = { ret_code, client_tid, ret_code ? 0 : (uint32_t) ret_val.size() };
+        sendResponse(*conn, header, ret_val.data());
+    }
+    if (log_tasks) {
+        CYT_LOG(LOG_NOTICE, "Sent response for task with server_tid: %d, client_tid: %d, connfd: %d", server_tid, client_tid, conn->connfd);
+    }
+
+    stats_lock.lock();
+    cTaskMetrics &fn_metrics = metrics[task->getFid()];
+    fn_metrics.response_delay.record(std::chrono::steady_clock::now() - task->getSubmitTime());
+    if (ret_code) {
+        fn_metrics.n_failed++;
+    } else {
+        fn_metrics.n_completed++;
+    }
+    stats_lock.unlock();
+
+    // Retire the task from the scheduler; if the client has disconnected, this may also release its state
+    scheduler->releaseTask(server_tid);
+}
+
+void cService::closeClient(const std::shared_ptr<clientConn> &conn) {
+    CYT_LOG(LOG_NOTICE, "Connection %d closing ...", conn->connfd);
+
+    // Remove the client before closing the socket, since the OS may re-use the connfd for a new client straight away
+    epoll_ctl(epoll_fds[conn->reactor], EPOLL_CTL_DEL, conn->connfd, nullptr);
+    if (conn->shm != nullptr) {
+        epoll_ctl(epoll_fds[conn->reactor], EPOLL_CTL_DEL, conn->req_efd, nullptr);
+    }
+    clients_lock.lock();
+    clients.erase(conn->connfd);
+    if (conn->shm != nullptr) {
+        clients.erase(conn->req_efd);
+    }
+    clients_lock.unlock();
+
+    // The state (and Coyote threads) are released once completeTask() drops the last reference, after any outstanding tasks complete
+    conn->send_lock.lock();
+    conn->closed = true;
+    close(conn->connfd);
+    if (conn->shm != nullptr) {
+        munmap(conn->shm, sizeof(cShmChannel));
+        close(conn->req_efd);
+        close(conn->resp_efd);
+        conn->shm = nullptr;
+    }
+    conn->send_lock.unlock();
+    if (result_cache.getCapacity()) {
+        CYT_LOG(
+            LOG_NOTICE, "Result cache: %lu hits, %lu misses, %lu evictions, %zu bytes held", 
+            result_cache.getHits(), result_cache.getMisses(), result_cache.getEvictions(), result_cache.getSize()
+        );
+    }
+}
+
+void cService::attachShm(clientConn &conn, struct msghdr &msg) {
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+    if (cmsg == nullptr || cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) {
+        return;
+    }
+
+    // Expecting three file descriptors: the shared memory and the request/response doorbells
+    int fds[3];
+    size_t n_fds = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+    memcpy(fds, CMSG_DATA(cmsg), std::min(n_fds, (size_t) 3) * sizeof(int));
+    if (n_fds != 3) {
+        CYT_LOG(LOG_WARNING, "Client with connfd %d passed %zu file descriptors, expected 3; using the socket only", conn.connfd, n_fds);
+        for (size_t i = 0; i < std::min(n_fds, (size_t) 3); i++) {
+            close(fds[i]);
+        }
+        return;
+    }
+
+    struct stat shm_stat;
+    void *mem = MAP_FAILED;
+    if (fstat(fds[0], &shm_stat) == 0 && (size_t) shm_stat.st_size >= sizeof(cShmChannel)) {
+        mem = mmap(nullptr, sizeof(cShmChannel), PROT_READ | PROT_WRITE, MAP_SHARED, fds[0], 0);
+    }
+    close(fds[0]);
+
+    if (mem == MAP_FAILED) {
+        CYT_LOG(LOG_WARNING, "Could not map the shared-memory channel of client with connfd %d; using the socket only", conn.connfd);
+        close(fds[1]);
+        close(fds[2]);
+        return;
+    }
+
+    conn.shm = (cShmChannel *) mem;
+    conn.req_efd = fds[1];
+    conn.resp_efd = fds[2];
+    conn.shm_recv_buff.resize(DAEMON_RX_BUFF_SIZE);
+    CYT_LOG(LOG_NOTICE, "Attached shared-memory channel for client with connfd %d", conn.connfd);
+}
+
+void cService::registerClient(int connfd, pid_t rpid, struct msghdr *msg) {
+    /*
+     * Set-up the state for this client and hand its socket over to one of the reactors
+     * Each client is uniquely identified by its connection file descriptor (connfd);
+     * At any given time, no two clients will have the same value of connfd
+     * However, it's possible that a connfd with the same value is opened later (the cService has
+     * no control over the connection file descriptors, they are assigned by the OS). Therefore, 
+     * the client is removed from the map of clients before its socket is closed, see closeClient().
+     */ 
+    std::shared_ptr<clientConn> conn = std::make_shared<clientConn>();
+    conn->connfd = connfd;
+    conn->rpid = rpid;
+    conn->reactor = next_reactor;
+    conn->coyote_threads.resize(regions.size());
+    conn->recv_buff.resize(DAEMON_RX_BUFF_SIZE);
+    next_reactor = (next_reactor + 1) % n_reactors;
+    if (msg != nullptr) {
+        conn->local = true;
+        attachShm(*conn, *msg);
+
+        std::lock_guard<std::mutex> guard(weights_lock);
+        auto weight = client_weights.find(rpid);
+        if (weight != client_weights.end()) {
+            conn->weight = weight->second;
+        }
+    }
+
+    fcntl(connfd, F_SETFL, fcntl(connfd, F_GETFL, 0) | O_NONBLOCK);
+    clients_lock.lock();
+    clients.insert({connfd, conn});
+    clients_lock.unlock();
+
+    struct epoll_event event = {};
+    event.events = EPOLLIN | EPOLLRDHUP;
+    event.data.fd = connfd;
+    bool added = epoll_ctl(epoll_fds[conn->reactor], EPOLL_CTL_ADD, connfd, &event) == 0;
+    if (added && conn->shm != nullptr) {
+        clients_lock.lock();
+        clients.insert({conn->req_efd, conn});
+        clients_lock.unlock();
+
+        event.events = EPOLLIN;
+        event.data.fd = conn->req_efd;
+        added = epoll_ctl(epoll_fds[conn->reactor], EPOLL_CTL_ADD, conn->req_efd, &event) == 0;
+    }
+
+    if (!added) {
+        CYT_LOG(LOG_ERR, "Could not add connfd %d to reactor %u", connfd, conn->reactor);
+        closeClient(conn);
+    }
 }
 
 void cService::acceptConnectionLocal() {
@@ -430,74 +794,239 @@ void cService::acceptConnectionLocal() {
     // Try to accept an incoming connection
     if ((connfd = accept(sockfd, (struct sockaddr *) &client_addr, &len)) != -1) {
     
-        syslog(LOG_NOTICE, "Accepted local connection, connfd: %d", connfd);
+        CYT_LOG(LOG_NOTICE, "Accepted local connection, connfd: %d", connfd);
 
         /**
-         * The service often receives data from the clients (e.g., request opcode, function arguments etc.)
-         * There is a clear sequence of steps, as implemented in processRequests() function, that the service
-         * expects to receive from the client. If the client fails to send data or the correct arguments for the 
-         * function, it can leave the server hanging. Therefore, set a timeout for the connection to prevent this.
+         * The first message of the client is its "remote" process ID. If the client fails to send it,
+         * it can leave the server hanging; therefore, set a timeout for the connection to prevent this.
          */
         if (setsockopt(connfd, SOL_SOCKET, SO_RCVTIMEO, &SERVER_RECV_TIMEOUT, sizeof(SERVER_RECV_TIMEOUT)) < 0) {
-            syslog(LOG_WARNING, "Could not set timeout for connfd: %d", connfd);
+            CYT_LOG(LOG_WARNING, "Could not set timeout for connfd: %d", connfd);
         }
 
-        // Read "remote" process ID of the client
+        // Read "remote" process ID of the client; optionally accompanied by a shared-memory channel and its doorbells (see cConn)
         int n;
         pid_t rpid;
-        char recv_buf[RECV_BUFF_SIZE];
-        if ((n = read(connfd, recv_buf, sizeof(pid_t))) == sizeof(pid_t)) {
-            memcpy(&rpid, recv_buf, sizeof(pid_t));
-            syslog(LOG_NOTICE, "Registered pid: %d", rpid);
+        struct iovec iov = { &rpid, sizeof(pid_t) };
+        struct msghdr msg = {};
+        alignas(struct cmsghdr) char cmsg_buff[CMSG_SPACE(3 * sizeof(int))];
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+        msg.msg_control = cmsg_buff;
+        msg.msg_controllen = sizeof(cmsg_buff);
+        if ((n = recvmsg(connfd, &msg, MSG_CMSG_CLOEXEC)) == sizeof(pid_t)) {
+            CYT_LOG(LOG_NOTICE, "Registered pid: %d", rpid);
+
+            registerClient(connfd, rpid, &msg);
+        } else {
+            ::close(connfd);
+            CYT_LOG(LOG_WARNING, "Failed to register client, connfd: %d, received: %d", connfd, n);
+        }
+
+    }
+}
 
+void cService::acceptConnectionRemote() {
+    sockaddr_in client_addr;
+    socklen_t len = sizeof(client_addr); 
+    int connfd;
+
+    // Try to accept an incoming connection
+    if ((connfd = accept(sockfd, (struct sockaddr *) &client_addr, &len)) != -1) {
+        char addr[INET_ADDRSTRLEN];
+        inet_ntop(AF_INET, &client_addr.sin_addr, addr, sizeof(addr));
+        CYT_LOG(LOG_NOTICE, "Accepted remote connection from %s, connfd: %d", addr, connfd);
+
+        // Requests and responses are small and latency-sensitive, so disable Nagle's algorithm
+        int one = 1;
+        if (setsockopt(connfd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one)) < 0) {
+            CYT_LOG(LOG_WARNING, "Could not set TCP_NODELAY for connfd: %d", connfd);
+        }
+
+        // Same as for local connections, the client first sends its PID; protect against clients that never send it
+        if (setsockopt(connfd, SOL_SOCKET, SO_RCVTIMEO, &SERVER_RECV_TIMEOUT, sizeof(SERVER_RECV_TIMEOUT)) < 0) {
+            CYT_LOG(LOG_WARNING, "Could not set timeout for connfd: %d", connfd);
+        }
+
+        pid_t rpid;
+        ssize_t n = recv(connfd, &rpid, sizeof(pid_t), MSG_WAITALL);
+        if (n == sizeof(pid_t)) {
             /*
-             * Set-up resources for this client and start the thread to process incodming requests
-             * Each client is uniquely identified by its connection file descriptor (connfd);
-             * At any given time, no two clients will have the same value of connfd
-             * However, it's possible that a connfd with the same value is opened later (the cService has
-             * no control over the connection file descriptors, they are assigned by the OS). Therefore, 
-             * when a client disconnect, it's important to remove their resources. This is done by the
-             * cleanConns() function, which periodically checks the conns_to_clean map and releases the resources.
-             */ 
-            task_locks.insert({connfd, std::make_unique<std::mutex>()});
-            tasks.insert({connfd, std::vector<std::pair<int32_t, int32_t>>()});
-            coyote_threads.insert({connfd, std::make_unique<cThread>(vfid, rpid, device)});
-            connection_threads.insert({
-                connfd, 
-                std::make_pair<std::thread, std::thread>(                        
-                    std::thread(&cService::processRequests, this, connfd),
-                    std::thread(&cService::sendResponses, this, connfd)
-                )
-            });
-            
+             * The PID of a remote client is meaningless on this node; hence, the cThreads of 
+             * remote clients are registered with the driver under the PID of the service itself
+             */
+            CYT_LOG(LOG_NOTICE, "Registered remote client with pid: %d", rpid);
+            registerClient(connfd, getpid(), nullptr);
         } else {
             ::close(connfd);
-            syslog(LOG_WARNING, "Failed to register client, connfd: %d, received: %d", connfd, n);
+            CYT_LOG(LOG_WARNING, "Failed to register remote client, connfd: %d, received: %zd", connfd, n);
         }
+    }
+}
 
+
+std::string cService::getStatsReport() {
+    std::ostringstream report;
+    std::chrono::duration<double> uptime = std::chrono::steady_clock::now() - start_time;
+
+    // Service-level metrics: responses, admission control and result cache, response delay per function
+    std::map<int32_t, cTaskMetrics> service_metrics;
+    stats_lock.lock();
+    service_metrics = metrics;
+    stats_lock.unlock();
+
+    cTaskMetrics total;
+    for (auto &[fid, fn_metrics] : service_metrics) {
+        total.merge(fn_metrics);
+    }
+    report << "service " << service_id << " uptime " << std::fixed << std::setprecision(1) << uptime.count() << " s\n";
+    report << "  tasks: completed " << total.n_completed << " failed " << total.n_failed << " rejected " << total.n_rejected 
+           << " cached " << total.n_cached << " throughput " << (uptime.count() > 0 ? (total.n_completed + total.n_cached) / uptime.count() : 0) << " tasks/s\n";
+    report << "  result cache: hits " << result_cache.getHits() << " misses " << result_cache.getMisses() 
+           << " evictions " << result_cache.getEvictions() << " bytes " << result_cache.getSize() << "\n";
+    report << "  response_delay " << total.response_delay.toString() << "\n";
+    for (auto &[fid, fn_metrics] : service_metrics) {
+        report << "  fid " << fid << ": completed " << fn_metrics.n_completed << " failed " << fn_metrics.n_failed 
+               << " rejected " << fn_metrics.n_rejected << " cached " << fn_metrics.n_cached << "\n";
+        report << "    response_delay " << fn_metrics.response_delay.toString() << "\n";
+    }
+
+    // Scheduler metrics, per vFPGA and function
+    for (uint32_t i = 0; i < scheduler->getNumRegions(); i++) {
+        cRegion region = scheduler->getRegion(i);
+        std::map<int32_t, cTaskMetrics> region_metrics = scheduler->getMetrics(i);
+        cTaskMetrics region_total;
+        for (auto &[fid, fn_metrics] : region_metrics) {
+            region_total.merge(fn_metrics);
+        }
+
+        report << "vfpga device " << region.device << " vfid " << region.vfid << ": completed " << region_total.n_completed 
+               << " failed " << region_total.n_failed << " missed deadlines " << region_total.n_missed 
+               << " reconfigurations " << region_total.reconfig_time.getCount() << "\n";
+        report << "  queue_delay " << region_total.queue_delay.toString() << "\n";
+        report << "  reconfig_time " << region_total.reconfig_time.toString() << "\n";
+        report << "  exec_time " << region_total.exec_time.toString() << "\n";
+        for (auto &[fid, fn_metrics] : region_metrics) {
+            report << "  fid " << fid << ": completed " << fn_metrics.n_completed << " failed " << fn_metrics.n_failed 
+                   << " missed deadlines " << fn_metrics.n_missed << "\n";
+            report << "    queue_delay " << fn_metrics.queue_delay.toString() << "\n";
+            report << "    reconfig_time " << fn_metrics.reconfig_time.toString() << "\n";
+            report << "    exec_time " << fn_metrics.exec_time.toString() << "\n";
+        }
     }
 
-    std::this_thread::sleep_for(std::chrono::microseconds(DAEMON_ACCEPT_CONN_SLEEP));
+    return report.str();
 }
 
-void cService::acceptConnectionRemote() {
-    std::this_thread::sleep_for(std::chrono::microseconds(DAEMON_ACCEPT_CONN_SLEEP));
+void cService::serveStats() {
+    cThreadConfig::apply(CoyoteThreadRole::STATS);
+
+    // Local socket next to the service's socket; each connection receives the current report, after which it's closed
+    std::string stats_socket_name = socket_name + ".stats";
+    int stats_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (stats_fd == -1) {
+        CYT_LOG(LOG_ERR, "Error creating stats socket");
+        return;
+    }
+
+    struct sockaddr_un server;
+    server.sun_family = AF_UNIX;
+    strcpy(server.sun_path, stats_socket_name.c_str());
+    unlink(server.sun_path);
+    socklen_t len = strlen(server.sun_path) + sizeof(server.sun_family);
+    if (bind(stats_fd, (struct sockaddr *) &server, len) == -1 || listen(stats_fd, SOMAXCONN) == -1) {
+        CYT_LOG(LOG_ERR, "Error binding stats socket %s", stats_socket_name.c_str());
+        ::close(stats_fd);
+        return;
+    }
+    CYT_LOG(LOG_NOTICE, "Serving stats on %s", stats_socket_name.c_str());
+
+    while (true) {
+        int connfd = accept(stats_fd, nullptr, nullptr);
+        if (connfd == -1) {
+            if (errno == EINTR) { continue; }
+            CYT_LOG(LOG_ERR, "Error accepting on stats socket, stopping stats");
+            break;
+        }
+
+        std::string report = getStatsReport();
+        size_t sent = 0;
+        while (sent < report.size()) {
+            ssize_t n = send(connfd, report.data() + sent, report.size() - sent, MSG_NOSIGNAL);
+            if (n <= 0) { break; }
+            sent += n;
+        }
+        ::close(connfd);
+    }
+    ::close(stats_fd);
 }
 
+// Tells the service manager that the daemon is ready (the sd_notify protocol, e.g., systemd's Type=notify); a no-op without NOTIFY_SOCKET
+static void notifyReady() {
+    const char *path = getenv("NOTIFY_SOCKET");
+    if (!path || (path[0] != '/' && path[0] != '@') || strlen(path) >= sizeof(sockaddr_un::sun_path)) {
+        return;
+    }
+
+    int fd = ::socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (fd == -1) {
+        CYT_LOG(LOG_WARNING, "Could not create the notification socket");
+        return;
+    }
+
+    // Names starting with @ are in the abstract namespace
+    struct sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+    if (path[0] == '@') {
+        addr.sun_path[0] = '\0';
+    }
+    socklen_t addr_len = offsetof(struct sockaddr_un, sun_path) + strlen(path);
+    const char msg[] = "READY=1";
+    if (sendto(fd, msg, sizeof(msg) - 1, 0, (struct sockaddr *) &addr, addr_len) < 0) {
+        CYT_LOG(LOG_WARNING, "Could not notify the service manager of readiness");
+    }
+    ::close(fd);
+}
 
 void cService::start() {
     if (is_running) {
-        syslog(LOG_NOTICE, "Service %s is already running, not starting again...", service_id.c_str());
+        CYT_LOG(LOG_NOTICE, "Service %s is already running, not starting again...", service_id.c_str());
         return;
     }
 
-    // Set-up daemon and communication socket; start a thread that periodically release stale connection threads and resources
+    // Set-up daemon and communication socket; start the scheduler and the reactors handling the client sockets
     is_running = true;
     initDaemon();
+
+    // Pre-create the idle Coyote threads in the daemon, since the threads' file descriptors and mappings are per process
+    for (cRegion &region : regions) {
+        thread_pools.emplace_back(std::make_unique<cThreadPool>(region.vfid, region.device, thread_pool_size));
+        thread_pools.back()->fill();
+    }
+
     initSocket();
-    run_cleanup_thread = true;
-    std::thread cleanup_thread = std::thread(&cService::cleanConns, this);
     scheduler->start();
+    start_time = std::chrono::steady_clock::now();
+    std::thread(&cService::serveStats, this).detach();
+
+    // Start the reactors, which handle all the client sockets
+    run_reactors = true;
+    for (uint32_t i = 0; i < n_reactors; i++) {
+        int epoll_fd = epoll_create1(0);
+        if (epoll_fd < 0) {
+            CYT_LOG(LOG_ERR, "Error creating epoll instance");
+            exit(EXIT_FAILURE);
+        }
+        epoll_fds.emplace_back(epoll_fd);
+    }
+    for (uint32_t i = 0; i < n_reactors; i++) {
+        reactors.emplace_back(&cService::runReactor, this, i);
+    }
+
+    // The functions' bitstreams were loaded when they were added, and the socket is listening; so, requests can be served from here on
+    CYT_LOG(LOG_NOTICE, "Service %s ready", service_id.c_str());
+    notifyReady();
 
     // Keep accepting connections
     try {
@@ -509,12 +1038,12 @@ void cService::start() {
             }
         }
     } catch (const std::exception &e) {
-        syslog(LOG_ERR, "Exception in main loop: %s", e.what());
+        CYT_LOG(LOG_ERR, "Exception in main loop: %s", e.what());
     } catch (...) {
-        syslog(LOG_ERR, "Unknown exception in main loop");
+        CYT_LOG(LOG_ERR, "Unknown exception in main loop");
     }
 
-    syslog(LOG_WARNING, "Daemon exiting unexpectedly");
+    CYT_LOG(LOG_WARNING, "Daemon exiting unexpectedly");
 }
 
 }
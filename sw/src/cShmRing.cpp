@@ -0,0 +1,97 @@
+/*
+ * This file is part of the Coyote <https://github.com/fpgasystems/Coyote>
+ *
+ * MIT Licence
+ * Copyright (c) 2025, Systems Group, ETH Zurich
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <cstring>
+#include <algorithm>
+
+#include <coyote/cShmRing.hpp>
+
+namespace coyote {
+
+bool cShmRing::push(const struct iovec *iov, int iovcnt) {
+    size_t size = 0;
+    for (int i = 0; i < iovcnt; i++) {
+        size += iov[i].iov_len;
+    }
+
+    uint64_t h = head.load(std::memory_order_relaxed);
+    uint64_t t = tail.load(std::memory_order_acquire);
+    if (SHM_RING_SIZE - (h - t) < size) {
+        return false;
+    }
+
+    // Copy the buffers, wrapping around the end of the ring where needed
+    for (int i = 0; i < iovcnt; i++) {
+        const char *src = (const char *) iov[i].iov_base;
+        size_t len = iov[i].iov_len;
+        while (len > 0) {
+            size_t offset = h % SHM_RING_SIZE;
+            size_t chunk = std::min(len, SHM_RING_SIZE - offset);
+            memcpy(data + offset, src, chunk);
+            src += chunk;
+            len -= chunk;
+            h += chunk;
+        }
+    }
+
+    // Sequentially consistent, so that the store is ordered before the producer's check in needsWakeUp()
+    head.store(h, std::memory_order_seq_cst);
+    return true;
+}
+
+size_t cShmRing::pop(char *buff, size_t size) {
+    uint64_t t = tail.load(std::memory_order_relaxed);
+    uint64_t h = head.load(std::memory_order_acquire);
+    size = std::min(size, (size_t) (h - t));
+
+    size_t copied = 0;
+    while (copied < size) {
+        size_t offset = (t + copied) % SHM_RING_SIZE;
+        size_t chunk = std::min(size - copied, SHM_RING_SIZE - offset);
+        memcpy(buff + copied, data + offset, chunk);
+        copied += chunk;
+    }
+
+    tail.store(t + size, std::memory_order_release);
+    return size;
+}
+
+bool cShmRing::prepareWait() {
+    waiting.store(1, std::memory_order_seq_cst);
+
+    // Re-check after announcing; a frame pushed before the announcement wouldn't ring the doorbell
+    if (head.load(std::memory_order_seq_cst) != tail.load(std::memory_order_relaxed)) {
+        waiting.store(0, std::memory_order_relaxed);
+        return false;
+    }
+    return true;
+}
+
+bool cShmRing::needsWakeUp() {
+    return waiting.load(std::memory_order_seq_cst) && waiting.exchange(0, std::memory_order_seq_cst);
+}
+
+}
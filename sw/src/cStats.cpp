@@ -0,0 +1,233 @@
+/*
+ * This file is part of the Coyote <https://github.com/fpgasystems/Coyote>
+ *
+ * MIT Licence
+ * Copyright (c) 2025, Systems Group, ETH Zurich
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <stdexcept>
+#include <algorithm>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include <coyote/cStats.hpp>
+
+namespace coyote {
+
+void cHistogram::record(std::chrono::nanoseconds sample) {
+    uint64_t ns = sample.count() > 0 ? (uint64_t) sample.count() : 0;
+    size_t bucket = std::min<size_t>(ns ? 64 - __builtin_clzll(ns) : 0, STATS_N_BUCKETS - 1);
+    buckets[bucket]++;
+    count++;
+    sum += ns;
+    max = std::max(max, ns);
+}
+
+void cHistogram::merge(const cHistogram &other) {
+    for (size_t i = 0; i < STATS_N_BUCKETS; i++) {
+        buckets[i] += other.buckets[i];
+    }
+    count += other.count;
+    sum += other.sum;
+    max = std::max(max, other.max);
+}
+
+uint64_t cHistogram::getPercentile(double p) const {
+    if (!count) {
+        return 0;
+    }
+
+    // Rank of the percentile, at least the first sample
+    uint64_t rank = std::max<uint64_t>((uint64_t) (p / 100.0 * count + 0.5), 1);
+    uint64_t seen = 0;
+    for (size_t i = 0; i < STATS_N_BUCKETS; i++) {
+        seen += buckets[i];
+        if (seen >= rank) {
+            return i ? std::min<uint64_t>(1ULL << i, max) : 0;
+        }
+    }
+    return max;
+}
+
+std::string cHistogram::toString() const {
+    char line[160];
+    snprintf(
+        line, sizeof(line), "n=%lu mean=%.1fus p50=%.1fus p99=%.1fus max=%.1fus", 
+        (unsigned long) count, getMean() / 1000.0, getPercentile(50) / 1000.0, getPercentile(99) / 1000.0, max / 1000.0
+    );
+    return std::string(line);
+}
+
+cHdrHistogram::cHdrHistogram(int sub_bits) : sub_bits(sub_bits) {
+    if (sub_bits < 1 || sub_bits > HDR_HIST_MAX_SUB_BITS) {
+        throw std::runtime_error("ERROR: cHdrHistogram created with an invalid precision of " + std::to_string(sub_bits) + " bits");
+    }
+}
+
+size_t cHdrHistogram::bucketIdx(uint64_t ns) const {
+    uint64_t sub_buckets = 1ULL << sub_bits;
+    if (ns < sub_buckets) {
+        return ns;
+    }
+
+    // The bucket group is given by the most significant bit, the bucket within the group by the sub_bits bits below it
+    int msb = 63 - __builtin_clzll(ns);
+    uint64_t mantissa = ns >> (msb - sub_bits);
+    return (msb - sub_bits + 1) * sub_buckets + (mantissa - sub_buckets);
+}
+
+double cHdrHistogram::bucketValue(size_t idx) const {
+    uint64_t sub_buckets = 1ULL << sub_bits;
+    if (idx < sub_buckets) {
+        return idx;
+    }
+
+    int shift = idx / sub_buckets - 1;
+    uint64_t mantissa = idx % sub_buckets + sub_buckets;
+    return (double) (mantissa << shift) + (double) ((1ULL << shift) - 1) / 2.0;
+}
+
+void cHdrHistogram::record(double ns) {
+    if (ns < 0) {
+        ns = 0;
+    }
+    if (buckets.empty()) {
+        buckets.resize((65 - sub_bits) << sub_bits, 0);
+    }
+
+    buckets[bucketIdx((uint64_t) ns)]++;
+    min = count ? std::min(min, ns) : ns;
+    max = count ? std::max(max, ns) : ns;
+    sum += ns;
+    count++;
+}
+
+void cHdrHistogram::merge(const cHdrHistogram &other) {
+    if (other.sub_bits != sub_bits) {
+        throw std::runtime_error("ERROR: cHdrHistogram::merge() called with histograms of different precision");
+    }
+    if (!other.count) {
+        return;
+    }
+
+    if (buckets.empty()) {
+        buckets.resize(other.buckets.size(), 0);
+    }
+    for (size_t i = 0; i < buckets.size(); i++) {
+        buckets[i] += other.buckets[i];
+    }
+    min = count ? std::min(min, other.min) : other.min;
+    max = count ? std::max(max, other.max) : other.max;
+    sum += other.sum;
+    count += other.count;
+}
+
+void cHdrHistogram::reset() {
+    std::fill(buckets.begin(), buckets.end(), 0);
+    count = 0;
+    sum = 0;
+}
+
+double cHdrHistogram::getMean() const { if (count) return sum / (double) count; else return NaN; }
+
+double cHdrHistogram::getMin() const { if (count) return min; else return NaN; }
+
+double cHdrHistogram::getMax() const { if (count) return max; else return NaN; }
+
+double cHdrHistogram::getPercentile(double p) const {
+    if (!count) { return NaN; }
+
+    // Nearest rank: the smallest value such that at least p% of the samples are no larger, at least the first sample
+    uint64_t rank = std::max<uint64_t>((uint64_t) std::ceil(p / 100.0 * (double) count), 1);
+    uint64_t seen = 0;
+    for (size_t i = 0; i < buckets.size(); i++) {
+        seen += buckets[i];
+        if (seen >= rank) {
+            return std::min(std::max(bucketValue(i), min), max);
+        }
+    }
+    return max;
+}
+
+void cTaskMetrics::merge(const cTaskMetrics &other) {
+    queue_delay.merge(other.queue_delay);
+    reconfig_time.merge(other.reconfig_time);
+    exec_time.merge(other.exec_time);
+    response_delay.merge(other.response_delay);
+    n_completed += other.n_completed;
+    n_failed += other.n_failed;
+    n_missed += other.n_missed;
+    n_rejected += other.n_rejected;
+    n_cached += other.n_cached;
+}
+
+cVfpgaStats::cVfpgaStats(uint32_t vfid, uint32_t device) {
+    std::string region = "/dev/coyote_fpga_" + std::to_string(device) + "_v" + std::to_string(vfid);
+    fd = open(region.c_str(), O_RDONLY);
+    if (fd == -1) {
+        throw std::runtime_error("ERROR: Could not open vFPGA device " + region);
+    }
+
+    void *addr = mmap(NULL, VFPGA_STATS_SIZE, PROT_READ, MAP_SHARED, fd, MMAP_STATS);
+    if (addr == MAP_FAILED) {
+        close(fd);
+        throw std::runtime_error("ERROR: statistics page mmap failed");
+    }
+    page = (const volatile vfpgaStatsPage*) addr;
+
+    if (page->version != VFPGA_STATS_VERSION) {
+        munmap((void*) page, VFPGA_STATS_SIZE);
+        close(fd);
+        throw std::runtime_error("ERROR: statistics page has version " + std::to_string(page->version) + ", expected " + std::to_string(VFPGA_STATS_VERSION));
+    }
+}
+
+cVfpgaStats::~cVfpgaStats() {
+    munmap((void*) page, VFPGA_STATS_SIZE);
+    close(fd);
+}
+
+vfpgaCtidStats cVfpgaStats::read(uint32_t ctid) const {
+    if (ctid >= N_CTID_MAX) {
+        throw std::runtime_error("ERROR: cVfpgaStats::read() called for ctid " + std::to_string(ctid) + ", out of range");
+    }
+
+    const volatile vfpgaCtidStats &src = page->ctids[ctid];
+    vfpgaCtidStats stats;
+    uint64_t generation;
+    do {
+        generation = src.generation;
+        const volatile uint64_t *from = (const volatile uint64_t*) &src;
+        uint64_t *to = (uint64_t*) &stats;
+        for (size_t i = 0; i < sizeof(vfpgaCtidStats) / sizeof(uint64_t); i++) {
+            to[i] = from[i];
+        }
+    } while (src.generation != generation);
+
+    return stats;
+}
+
+}
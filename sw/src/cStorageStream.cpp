@@ -0,0 +1,322 @@
+/*
+ * This file is part of the Coyote <https://github.com/fpgasystems/Coyote>
+ *
+ * MIT Licence
+ * Copyright (c) 2025, Systems Group, ETH Zurich
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <coyote/cStorageStream.hpp>
+#include <coyote/cTuner.hpp>
+
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+
+namespace coyote {
+
+cStorageStream::cStorageStream(cThread *cthread, uint32_t chunk_size, uint32_t depth, uint32_t dest, CoyoteAllocType type):
+    cthread(cthread), dest(dest), chunk_size(chunk_size) {
+    if (!cthread) {
+        throw std::runtime_error("ERROR: cStorageStream created without a valid cThread, exiting...");
+    }
+
+    // Without an explicit chunk size and depth, the tuned parameters of the shell are used, if there are any;
+    // the tuned chunk size is rounded down to the alignment of O_DIRECT reads
+    if (!chunk_size && !depth) {
+        const cTuneProfile &profile = cTuneProfile::getDefault();
+        if (profile.has(CoyoteOper::LOCAL_READ)) {
+            const cTuneEntry &entry = profile.get(CoyoteOper::LOCAL_READ);
+            uint64_t tuned_chunk = std::min<uint64_t>(entry.chunk_size, MAX_TRANSFER_SIZE) / STORAGE_DIRECT_ALIGN * STORAGE_DIRECT_ALIGN;
+            chunk_size = std::max<uint64_t>(tuned_chunk, STORAGE_DIRECT_ALIGN);
+            depth = entry.depth;
+            type = entry.alloc;
+        } else {
+            chunk_size = STORAGE_DEFAULT_CHUNK;
+            depth = STORAGE_DEFAULT_DEPTH;
+        }
+        this->chunk_size = chunk_size;
+    }
+
+    if (type != CoyoteAllocType::REG && type != CoyoteAllocType::THP && type != CoyoteAllocType::HPF) {
+        throw std::runtime_error("ERROR: cStorageStream only supports REG, THP and HPF memory, exiting...");
+    }
+
+    if (!chunk_size || chunk_size % STORAGE_DIRECT_ALIGN || chunk_size > MAX_TRANSFER_SIZE || !depth) {
+        throw std::runtime_error("ERROR: cStorageStream requires a non-zero depth and a chunk size aligned to STORAGE_DIRECT_ALIGN, exiting...");
+    }
+
+    for (uint32_t i = 0; i < depth; i++) {
+        void *buff = cthread->getMem({type, chunk_size});
+        if (!buff) {
+            throw std::runtime_error("ERROR: cStorageStream could not allocate its buffers, exiting...");
+        }
+        buffs.emplace_back(buff);
+    }
+
+    setupRing(depth);
+}
+
+cStorageStream::~cStorageStream() {
+    // Closing the ring also unregisters the buffers
+    if (sqes) { munmap(sqes, sqes_size); }
+    if (cq_ring && cq_ring != sq_ring) { munmap(cq_ring, cq_ring_size); }
+    if (sq_ring) { munmap(sq_ring, sq_ring_size); }
+    if (ring_fd >= 0) { close(ring_fd); }
+
+    for (void *buff : buffs) {
+        cthread->freeMem(buff);
+    }
+}
+
+void cStorageStream::setupRing(uint32_t entries) {
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    ring_fd = syscall(__NR_io_uring_setup, entries, &params);
+    if (ring_fd < 0) {
+        throw std::runtime_error("ERROR: cStorageStream could not set up io_uring, exiting...");
+    }
+
+    sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        sq_ring_size = cq_ring_size = std::max(sq_ring_size, cq_ring_size);
+    }
+
+    sq_ring = mmap(NULL, sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQ_RING);
+    if (sq_ring == MAP_FAILED) {
+        sq_ring = nullptr;
+        throw std::runtime_error("ERROR: cStorageStream could not map the io_uring submission queue, exiting...");
+    }
+
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        cq_ring = sq_ring;
+    } else {
+        cq_ring = mmap(NULL, cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_CQ_RING);
+        if (cq_ring == MAP_FAILED) {
+            cq_ring = nullptr;
+            throw std::runtime_error("ERROR: cStorageStream could not map the io_uring completion queue, exiting...");
+        }
+    }
+
+    sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    void *sqes_mem = mmap(NULL, sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQES);
+    if (sqes_mem == MAP_FAILED) {
+        throw std::runtime_error("ERROR: cStorageStream could not map the io_uring submission entries, exiting...");
+    }
+    sqes = static_cast<struct io_uring_sqe*>(sqes_mem);
+
+    char *sq = static_cast<char*>(sq_ring), *cq = static_cast<char*>(cq_ring);
+    sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    sq_mask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    cq_mask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    cqes = reinterpret_cast<struct io_uring_cqe*>(cq + params.cq_off.cqes);
+
+    // Registered buffers are pinned once, rather than on every read; this can fail, e.g., due to RLIMIT_MEMLOCK
+    std::vector<struct iovec> iovs;
+    for (void *buff : buffs) {
+        iovs.push_back({ .iov_base = buff, .iov_len = chunk_size });
+    }
+    fixed_buffs = !syscall(__NR_io_uring_register, ring_fd, IORING_REGISTER_BUFFERS, iovs.data(), iovs.size());
+    DBG1("cStorageStream: io_uring set up with " << params.sq_entries << " entries, registered buffers: " << fixed_buffs);
+}
+
+void cStorageStream::queueRead(int file_fd, uint32_t slot, uint32_t buff_offs, uint64_t file_offs, uint32_t len, uint64_t user_data) {
+    unsigned tail = *sq_tail;
+    unsigned idx = tail & *sq_mask;
+    struct io_uring_sqe *sqe = &sqes[idx];
+
+    memset(sqe, 0, sizeof(struct io_uring_sqe));
+    sqe->opcode = fixed_buffs ? IORING_OP_READ_FIXED : IORING_OP_READ;
+    sqe->fd = file_fd;
+    sqe->addr = reinterpret_cast<uint64_t>(buffs[slot]) + buff_offs;
+    sqe->len = len;
+    sqe->off = file_offs;
+    sqe->buf_index = fixed_buffs ? slot : 0;
+    sqe->user_data = user_data;
+
+    sq_array[idx] = idx;
+    __atomic_store_n(sq_tail, tail + 1, __ATOMIC_RELEASE);
+    reads_pending++;
+}
+
+void cStorageStream::submitReads(uint32_t n, bool wait) {
+    while (syscall(__NR_io_uring_enter, ring_fd, n, wait ? 1 : 0, wait ? IORING_ENTER_GETEVENTS : 0, NULL, 0) < 0) {
+        if (errno != EINTR) {
+            throw std::runtime_error("ERROR: cStorageStream could not submit the reads to io_uring, exiting...");
+        }
+    }
+}
+
+uint64_t cStorageStream::stream(const std::string &path, uint64_t offset, uint64_t len) {
+    // Not all file systems support O_DIRECT (e.g., tmpfs); the data then goes through the page cache
+    int file_fd = open(path.c_str(), O_RDONLY | O_DIRECT);
+    if (file_fd < 0 && errno == EINVAL) {
+        file_fd = open(path.c_str(), O_RDONLY);
+    }
+    if (file_fd < 0) {
+        throw std::runtime_error("ERROR: cStorageStream could not open " + path + ", exiting...");
+    }
+
+    uint64_t streamed;
+    try {
+        streamed = stream(file_fd, offset, len);
+    } catch (...) {
+        close(file_fd);
+        throw;
+    }
+
+    close(file_fd);
+    return streamed;
+}
+
+uint64_t cStorageStream::stream(int file_fd, uint64_t offset, uint64_t len) {
+    if (!len) {
+        off_t file_size = lseek(file_fd, 0, SEEK_END);
+        if (file_size < 0) {
+            throw std::runtime_error("ERROR: cStorageStream could not obtain the file size, exiting...");
+        }
+        len = static_cast<uint64_t>(file_size) > offset ? file_size - offset : 0;
+    }
+    if (!len) {
+        return 0;
+    }
+
+    // The reads are aligned for O_DIRECT; the head of the first and the tail of the last chunk are not sent
+    uint64_t start = offset & ~static_cast<uint64_t>(STORAGE_DIRECT_ALIGN - 1);
+    uint64_t end = offset + len;
+    uint64_t n_last = (end - start + chunk_size - 1) / chunk_size;
+    uint32_t depth = buffs.size();
+
+    // Bytes read into each slot and whether its chunk was fully read (or the file ended)
+    std::vector<uint32_t> got(depth, 0);
+    std::vector<bool> ready(depth, false);
+
+    // Chunks whose read was queued, sent to the vFPGA and whose LOCAL_READ completed
+    uint64_t n_read = 0, n_sent = 0, n_done = 0;
+    uint32_t base = cthread->checkCompleted(CoyoteOper::LOCAL_READ);
+    uint64_t streamed = 0;
+
+    auto chunkBegin = [&](uint64_t chunk) -> uint64_t { return start + chunk * chunk_size; };
+    auto chunkEnd = [&](uint64_t chunk) -> uint64_t { return std::min(chunkBegin(chunk) + chunk_size, end); };
+
+    while (n_sent < n_last || n_done < n_sent || reads_pending) {
+        bool progress = false;
+
+        // Counters are compared relative to their values at the start, so that wrap-arounds are handled
+        uint32_t completed = cthread->checkCompleted(CoyoteOper::LOCAL_READ) - base;
+        if (completed != static_cast<uint32_t>(n_done)) {
+            n_done += static_cast<uint32_t>(completed - static_cast<uint32_t>(n_done));
+            progress = true;
+        }
+
+        // Read the following chunks into the buffers whose LOCAL_READ completed
+        uint32_t queued = 0;
+        while (n_read < n_last && n_read - n_done < depth) {
+            uint32_t s = n_read % depth;
+            uint64_t want = (chunkEnd(n_read) - chunkBegin(n_read) + STORAGE_DIRECT_ALIGN - 1) & ~static_cast<uint64_t>(STORAGE_DIRECT_ALIGN - 1);
+            got[s] = 0;
+            ready[s] = false;
+            queueRead(file_fd, s, 0, chunkBegin(n_read), want, n_read);
+            n_read++;
+            queued++;
+        }
+
+        // Reap the completed reads; short reads are continued, unless the file ended
+        unsigned head = *cq_head;
+        while (head != __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE)) {
+            struct io_uring_cqe *cqe = &cqes[head & *cq_mask];
+            uint64_t chunk = cqe->user_data;
+            int32_t res = cqe->res;
+            head++;
+            reads_pending--;
+            progress = true;
+
+            // Chunks past the end of the file, read before it was known to end
+            if (chunk >= n_last) {
+                continue;
+            }
+
+            if (res < 0) {
+                __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+                throw std::runtime_error("ERROR: cStorageStream read failed: " + std::string(strerror(-res)) + ", exiting...");
+            }
+
+            uint32_t s = chunk % depth;
+            uint64_t want = (chunkEnd(chunk) - chunkBegin(chunk) + STORAGE_DIRECT_ALIGN - 1) & ~static_cast<uint64_t>(STORAGE_DIRECT_ALIGN - 1);
+            got[s] += res;
+            if (res > 0 && got[s] < want) {
+                queueRead(file_fd, s, got[s], chunkBegin(chunk) + got[s], want - got[s], chunk);
+                queued++;
+            } else {
+                ready[s] = true;
+            }
+        }
+        __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+
+        // Send the read chunks, in file order
+        while (n_sent < n_last && ready[n_sent % depth]) {
+            uint32_t s = n_sent % depth;
+            uint64_t chunk_len = chunkEnd(n_sent) - chunkBegin(n_sent);
+            uint64_t data_begin = (n_sent == 0) ? offset - start : 0;
+            uint64_t data_end = std::min<uint64_t>(got[s], chunk_len);
+            bool file_end = got[s] < chunk_len;
+            ready[s] = false;
+            progress = true;
+
+            if (data_end > data_begin) {
+                localSg sg = { .addr = static_cast<char*>(buffs[s]) + data_begin, .len = data_end - data_begin, .stream = STRM_HOST, .dest = dest };
+                cthread->invoke(CoyoteOper::LOCAL_READ, sg);
+                streamed += data_end - data_begin;
+                n_sent++;
+            }
+
+            // The file ended in this chunk; the reads of the following chunks are still reaped, but not sent
+            if (file_end) {
+                n_last = n_sent;
+                break;
+            }
+        }
+
+        if (queued) {
+            submitReads(queued, false);
+        } else if (!progress) {
+            // Block on whichever is outstanding: the reads (in the kernel) or the LOCAL_READs (with low-latency waits)
+            if (reads_pending && n_done == n_sent) {
+                submitReads(0, true);
+            } else if (n_done < n_sent) {
+                cthread->waitCompleted(
+                    CoyoteOper::LOCAL_READ, base + static_cast<uint32_t>(n_done + 1), 
+                    reads_pending ? WAIT_SPIN_TIME : std::chrono::nanoseconds(-1)
+                );
+            }
+        }
+    }
+
+    DBG1("cStorageStream: streamed " << streamed << " bytes in " << n_sent << " chunks");
+    return streamed;
+}
+
+}
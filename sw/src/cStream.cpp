@@ -0,0 +1,164 @@
+/*
+ * This file is part of the Coyote <https://github.com/fpgasystems/Coyote>
+ *
+ * MIT Licence
+ * Copyright (c) 2025, Systems Group, ETH Zurich
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <coyote/cStream.hpp>
+#include <coyote/cTuner.hpp>
+
+namespace coyote {
+
+cStream::cStream(cThread *cthread, uint32_t in_size, uint32_t out_size, uint32_t depth, uint32_t dest, CoyoteAllocType type): 
+    cthread(cthread), dest(dest), in_size(in_size), out_size(out_size ? out_size : in_size) {
+    if (!cthread) {
+        throw std::runtime_error("ERROR: cStream created without a valid cThread, exiting...");
+    }
+
+    // Without an explicit depth, the tuned parameters of the shell are used, if there are any
+    if (!depth) {
+        const cTuneProfile &profile = cTuneProfile::getDefault();
+        if (profile.has(CoyoteOper::LOCAL_TRANSFER)) {
+            depth = profile.get(CoyoteOper::LOCAL_TRANSFER).depth;
+            type = profile.get(CoyoteOper::LOCAL_TRANSFER).alloc;
+        } else {
+            depth = STREAM_DEFAULT_DEPTH;
+        }
+    }
+
+    if (type != CoyoteAllocType::REG && type != CoyoteAllocType::THP && type != CoyoteAllocType::HPF) {
+        throw std::runtime_error("ERROR: cStream only supports REG, THP and HPF memory, exiting...");
+    }
+
+    if (!in_size || !depth) {
+        throw std::runtime_error("ERROR: cStream requires a non-zero buffer size and depth, exiting...");
+    }
+
+    for (uint32_t i = 0; i < depth; i++) {
+        void *in_buff = cthread->getMem({type, this->in_size});
+        void *out_buff = cthread->getMem({type, this->out_size});
+        if (!in_buff || !out_buff) {
+            throw std::runtime_error("ERROR: cStream could not allocate its buffers, exiting...");
+        }
+        in_buffs.emplace_back(in_buff);
+        out_buffs.emplace_back(out_buff);
+    }
+    out_lens.resize(depth, 0);
+
+    base_rd = cthread->checkCompleted(CoyoteOper::LOCAL_READ);
+    base_wr = cthread->checkCompleted(CoyoteOper::LOCAL_WRITE);
+}
+
+cStream::~cStream() {
+    while (inFlight()) {
+        pop();
+    }
+
+    for (uint32_t i = 0; i < in_buffs.size(); i++) {
+        cthread->freeMem(in_buffs[i]);
+        cthread->freeMem(out_buffs[i]);
+    }
+}
+
+uint32_t cStream::credits() const {
+    return in_buffs.size() - inFlight() - (holding ? 1 : 0);
+}
+
+void* cStream::getBuffer() {
+    return credits() ? in_buffs[slot(n_pushed)] : nullptr;
+}
+
+void cStream::submit(uint32_t len, uint32_t out_len) {
+    out_len = out_len ? out_len : len;
+    if (!len || len > in_size || out_len > out_size) {
+        throw std::runtime_error("ERROR: cStream element larger than its buffers, exiting...");
+    }
+
+    uint32_t s = slot(n_pushed);
+    out_lens[s] = out_len;
+
+    // The write is issued first, so that the output buffer is ready once the kernel starts producing
+    localSg out_sg = { .addr = out_buffs[s], .len = out_len, .stream = STRM_HOST, .dest = dest };
+    localSg in_sg = { .addr = in_buffs[s], .len = len, .stream = STRM_HOST, .dest = dest };
+    cthread->invoke(CoyoteOper::LOCAL_WRITE, out_sg);
+    cthread->invoke(CoyoteOper::LOCAL_READ, in_sg);
+
+    n_pushed++;
+}
+
+bool cStream::push(uint32_t len, uint32_t out_len) {
+    if (!credits()) {
+        return false;
+    }
+
+    submit(len, out_len);
+    return true;
+}
+
+bool cStream::push(const void *data, uint32_t len, uint32_t out_len) {
+    if (!credits()) {
+        return false;
+    }
+
+    if (len > in_size) {
+        throw std::runtime_error("ERROR: cStream element larger than its buffers, exiting...");
+    }
+
+    memcpy(in_buffs[slot(n_pushed)], data, len);
+    submit(len, out_len);
+    return true;
+}
+
+bool cStream::ready() const {
+    if (!inFlight()) {
+        return false;
+    }
+
+    // Counters are compared relative to their values at creation, so that wrap-arounds are handled
+    uint32_t target = static_cast<uint32_t>(n_popped + 1);
+    return static_cast<uint32_t>(cthread->checkCompleted(CoyoteOper::LOCAL_WRITE) - base_wr) >= target &&
+           static_cast<uint32_t>(cthread->checkCompleted(CoyoteOper::LOCAL_READ) - base_rd) >= target;
+}
+
+localSg cStream::pop() {
+    if (!inFlight()) {
+        throw std::runtime_error("ERROR: cStream::pop() called without any elements in flight, exiting...");
+    }
+
+    // The previously popped slot is implicitly consumed
+    holding = false;
+
+    while (!ready()) {}
+
+    uint32_t s = slot(n_popped);
+    n_popped++;
+    holding = true;
+
+    return { .addr = out_buffs[s], .len = out_lens[s], .stream = STRM_HOST, .dest = dest };
+}
+
+void cStream::release() {
+    holding = false;
+}
+
+}
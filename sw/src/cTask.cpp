@@ -24,12 +24,82 @@
  * SOFTWARE.
  */
  
+#include <cstring>
+#include <algorithm>
+#include <sys/mman.h>
+
 #include <coyote/cTask.hpp>
 
 namespace coyote {
 
-cTask::cTask(int32_t tid, int32_t fid, size_t ret_val_size, cThread* cthread, std::vector<std::vector<char>> fn_args) 
-    : tid(tid), fid(fid), is_completed(false), ret_val_size(ret_val_size), cthread(cthread), fn_args(std::move(fn_args)), ret_code(-1) {}
+void cTaskArgs::reserve(size_t n, size_t n_bytes) {
+    n_args = 0;
+    this->n_bytes = 0;
+    if (n_bytes > TASK_ARGS_INLINE_SIZE) {
+        heap_data.reset(new char[n_bytes]);
+    } else {
+        heap_data.reset();
+    }
+    if (n > TASK_ARGS_INLINE_COUNT) {
+        heap_entries.reset(new argEntry[n]);
+    } else {
+        heap_entries.reset();
+    }
+}
+
+cTaskArgs::cTaskArgs(const std::vector<std::vector<char>> &args) {
+    size_t total = 0;
+    for (const std::vector<char> &arg : args) {
+        total += arg.size();
+    }
+    reserve(args.size(), total);
+
+    for (const std::vector<char> &arg : args) {
+        if (!arg.empty()) {
+            memcpy(buffer() + n_bytes, arg.data(), arg.size());
+        }
+        entries()[n_args++] = { static_cast<uint32_t>(n_bytes), static_cast<uint32_t>(arg.size()) };
+        n_bytes += arg.size();
+    }
+}
+
+bool cTaskArgs::parse(const char *payload, size_t payload_size, const std::vector<size_t> &arg_sizes) {
+    // The size prefixes are copied along, so the payload is copied as a whole and the arguments point past the prefixes
+    reserve(arg_sizes.size(), payload_size);
+    size_t offs = 0;
+    for (size_t arg_size : arg_sizes) {
+        if (arg_size == VAR_ARG_SIZE) {
+            uint32_t var_size;
+            if (payload_size - offs < sizeof(uint32_t)) { n_args = 0; return false; }
+            memcpy(&var_size, payload + offs, sizeof(uint32_t));
+            offs += sizeof(uint32_t);
+            arg_size = var_size;
+        }
+
+        if (payload_size - offs < arg_size) { n_args = 0; return false; }
+        entries()[n_args++] = { static_cast<uint32_t>(offs), static_cast<uint32_t>(arg_size) };
+        offs += arg_size;
+    }
+
+    if (offs != payload_size) {
+        n_args = 0;
+        return false;
+    }
+    if (payload_size) {
+        memcpy(buffer(), payload, payload_size);
+    }
+    n_bytes = payload_size;
+    return true;
+}
+
+cTask::cTask(int32_t tid, int32_t fid, size_t ret_val_size, cThread* cthread, cTaskArgs fn_args) 
+    : tid(tid), fid(fid), is_completed(false), ret_val_size(ret_val_size), cthread(cthread), fn_args(std::move(fn_args)), ret_code(-1), submit_time(std::chrono::steady_clock::now()) {}
+
+cTask::~cTask() {
+    if (shared_ret_val != nullptr) {
+        munmap(shared_ret_val, shared_ret_val_size);
+    }
+}
 
 int32_t cTask::getTid() const {
     return tid;
@@ -51,16 +121,32 @@ cThread* cTask::getCThread() const {
     return cthread;
 }
 
-std::vector<std::vector<char>> cTask::getArgs() const {
+const cTaskArgs& cTask::getArgs() const {
     return fn_args;
 }
 
-std::vector<char> cTask::getRetVal() const {
+const std::vector<char>& cTask::getRetVal() const {
     return ret_val;
 }
 
-void cTask::setRetVal(const std::vector<char> retval) {
-    ret_val = retval;
+void cTask::setRetVal(std::vector<char> retval) {
+    ret_val = std::move(retval);
+}
+
+void cTask::setSharedRetVal(void *addr, size_t size) {
+    if (shared_ret_val != nullptr) {
+        munmap(shared_ret_val, shared_ret_val_size);
+    }
+    shared_ret_val = addr;
+    shared_ret_val_size = size;
+}
+
+const char* cTask::getRetData() const {
+    return shared_ret_val != nullptr ? (const char *) shared_ret_val : ret_val.data();
+}
+
+size_t cTask::getRetDataSize() const {
+    return shared_ret_val != nullptr ? shared_ret_val_size : ret_val.size();
 }
 
 size_t cTask::getRetValSize() const {
@@ -75,4 +161,32 @@ void cTask::setRetCode(int32_t retcode) {
     ret_code = retcode;
 }
 
+std::chrono::steady_clock::time_point cTask::getSubmitTime() const {
+    return submit_time;
+}
+
+uint32_t cTask::getWeight() const {
+    return weight;
+}
+
+void cTask::setWeight(uint32_t weight) {
+    this->weight = weight ? weight : 1;
+}
+
+uint32_t cTask::getPriority() const {
+    return priority;
+}
+
+void cTask::setPriority(uint32_t priority) {
+    this->priority = std::min(priority, SCHED_N_PRIORITIES - 1);
+}
+
+std::chrono::steady_clock::time_point cTask::getDeadline() const {
+    return deadline;
+}
+
+void cTask::setDeadline(std::chrono::microseconds deadline) {
+    this->deadline = deadline.count() ? submit_time + deadline : std::chrono::steady_clock::time_point::max();
+}
+
 }
@@ -25,12 +25,191 @@
  */
 
 #include <coyote/cThread.hpp>
+#include <coyote/cNotifyReactor.hpp>
+#include <coyote/cTracer.hpp>
+#include <coyote/cThreadConfig.hpp>
+
+#ifdef EN_AVX
+#include <cpuid.h>
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
 
 namespace coyote {
 
-/// Event handler function which processes user interrupts in a dedicated thread
-int eventHandler(int fd, int efd, int terminate_efd, std::function<void(int)> uisr, int32_t ctid) {
+#ifdef EN_AVX
+/// True if the CPU supports umonitor/umwait (WAITPKG, CPUID leaf 7, ECX bit 5)
+static bool hasWaitpkg() {
+    static const bool waitpkg = [] {
+        unsigned int eax, ebx, ecx, edx;
+        if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) {
+            return false;
+        }
+        return (ecx & (1 << 5)) != 0;
+    }();
+    return waitpkg;
+}
+
+/// Arms the monitor on the cache line of addr; compiled for WAITPKG only, callers must check hasWaitpkg()
+__attribute__((target("waitpkg"))) static inline void umonitorLine(volatile uint32_t *addr) {
+    _umonitor(const_cast<uint32_t*>(addr));
+}
+
+/// Waits in C0.1 until the monitored line is written or the TSC deadline passes
+__attribute__((target("waitpkg"))) static inline void umwaitLine(uint64_t deadline) {
+    _umwait(1, deadline);
+}
+#endif
+
+/// Opens an out-of-band connection to a remote node; retries (e.g., while the remote node isn't listening yet) every BOOTSTRAP_RETRY_INTERVAL
+static int oobConnect(const std::string &address, uint16_t port, uint32_t retries) {
+    std::string service = std::to_string(port);
+    struct addrinfo *res;
+    struct addrinfo hints = {};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(address.c_str(), service.c_str(), &hints, &res) != 0) {
+        throw std::runtime_error("ERROR: getaddrinfo() failed for " + address);
+    }
+
+    int sock = -1;
+    for (uint32_t i = 0; i <= retries && sock < 0; i++) {
+        if (i) {
+            std::this_thread::sleep_for(BOOTSTRAP_RETRY_INTERVAL);
+        }
+        for (struct addrinfo *t = res; t; t = t->ai_next) {
+            sock = ::socket(t->ai_family, t->ai_socktype, t->ai_protocol);
+            if (sock >= 0) {
+                if (!::connect(sock, t->ai_addr, t->ai_addrlen)) {
+                    break;
+                }
+                ::close(sock);
+                sock = -1;
+            }
+        }
+    }
+    freeaddrinfo(res);
+
+    if (sock < 0) {
+        throw std::runtime_error("ERROR: Could not connect to: " + address + ":" + std::to_string(port));
+    }
+    return sock;
+}
+
+/// Opens a socket listening for out-of-band connections on the given port
+static int oobListen(uint16_t port, int backlog) {
+    int sock = ::socket(AF_INET, SOCK_STREAM, 0); 
+    if (sock == -1) {
+        throw std::runtime_error("ERROR: Could not create a socket");
+    }
+
+    int reuse = 1;
+    setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    struct sockaddr_in server = {}; 
+    server.sin_family = AF_INET; 
+    server.sin_port = htons(port); 
+    server.sin_addr.s_addr = INADDR_ANY; 
+    if (::bind(sock, (struct sockaddr*) &server, sizeof(server)) < 0 || listen(sock, backlog) == -1) {
+        ::close(sock);
+        throw std::runtime_error("ERROR: Could not listen to a port: " + std::to_string(port));
+    }
+    return sock;
+}
+
+/// Process-wide huge page pool (cThread::reserveHugePages()); regions are kept until the process exits, free ranges are kept coalesced
+static std::mutex hpool_mtx;
+static uint64_t hpool_page_size = 0;
+static std::vector<std::pair<uint64_t, uint64_t>> hpool_regions;     // [start, end) of the reserved regions
+static std::map<uint64_t, uint64_t> hpool_free;                      // start -> end of the free ranges
+
+/// Takes size bytes, rounded up to whole pages, from the pool; nullptr if the pool has no pages of page_size or no free range large enough
+static void* hpoolGet(uint64_t size, uint64_t page_size) {
+    std::lock_guard<std::mutex> lock(hpool_mtx);
+    if (hpool_page_size != page_size) {
+        return nullptr;
+    }
+
+    size = (size + page_size - 1) & ~(page_size - 1);
+    for (auto it = hpool_free.begin(); it != hpool_free.end(); it++) {
+        if (it->second - it->first >= size) {
+            uint64_t start = it->first;
+            uint64_t end = it->second;
+            hpool_free.erase(it);
+            if (start + size < end) {
+                hpool_free[start + size] = end;
+            }
+            return reinterpret_cast<void*>(start);
+        }
+    }
+    return nullptr;
+}
+
+/// Returns memory obtained with hpoolGet() to the pool; false if the memory is not part of the pool
+static bool hpoolPut(void *mem, uint64_t size) {
+    std::lock_guard<std::mutex> lock(hpool_mtx);
+    uint64_t start = reinterpret_cast<uint64_t>(mem);
+    bool pooled = std::any_of(hpool_regions.begin(), hpool_regions.end(), [start](const std::pair<uint64_t, uint64_t> &r) { 
+        return start >= r.first && start < r.second; 
+    });
+    if (!pooled) {
+        return false;
+    }
+
+    uint64_t end = start + ((size + hpool_page_size - 1) & ~(hpool_page_size - 1));
+    auto next = hpool_free.find(end);
+    if (next != hpool_free.end()) {
+        end = next->second;
+        hpool_free.erase(next);
+    }
+    auto prev = hpool_free.lower_bound(start);
+    if (prev != hpool_free.begin() && (--prev)->second == start) {
+        start = prev->first;
+        hpool_free.erase(prev);
+    }
+    hpool_free[start] = end;
+    return true;
+}
+
+/// Grows the system's pool of huge pages of page_size, so that n_pages more can be reserved; requires root
+static bool growHugePagePool(uint64_t page_size, uint64_t n_pages) {
+    std::string dir = "/sys/kernel/mm/hugepages/hugepages-" + std::to_string(page_size >> 10) + "kB/";
+    uint64_t nr = 0, free = 0, resv = 0;
+    std::ifstream(dir + "nr_hugepages") >> nr;
+    std::ifstream(dir + "free_hugepages") >> free;
+    std::ifstream(dir + "resv_hugepages") >> resv;
+
+    uint64_t avail = free > resv ? free - resv : 0;
+    if (avail >= n_pages) {
+        return false;
+    }
+
+    std::ofstream out(dir + "nr_hugepages");
+    out << nr + n_pages - avail << std::flush;
+    if (!out) {
+        std::cerr << "WARNING: could not grow the system's huge page pool to " << nr + n_pages - avail << " pages; requires root, see " << dir << std::endl;
+        return false;
+    }
+    DBG1("cThread: grew the system's huge page pool to " << nr + n_pages - avail << " pages");
+    return true;
+}
+
+/// True if transparent huge pages can be obtained with MADV_HUGEPAGE, i.e., THP is not disabled system-wide
+static bool thpEnabled() {
+    static const bool enabled = [] {
+        std::string mode;
+        std::getline(std::ifstream("/sys/kernel/mm/transparent_hugepage/enabled"), mode);
+        return mode.find("[never]") == std::string::npos;
+    }();
+    return enabled;
+}
+
+/// Event handler function which processes user interrupts in a dedicated thread; ring is set in the coalesced mode
+int eventHandler(int fd, int efd, int terminate_efd, std::function<void(int)> uisr, int32_t ctid, notifyRing *ring) {
     DBG1("cThread: Called eventHandler"); 
+    cThreadConfig::apply(CoyoteThreadRole::EVENT, ctid);
 
     // Create events to listen on
 	struct epoll_event event, events[MAX_EVENTS]; 
@@ -55,6 +234,16 @@ int eventHandler(int fd, int efd, int terminate_efd, std::function<void(int)> ui
 
     bool running = true;
 	while (running) {
+        // Coalesced mode: drain the ring and arm it before going to sleep; re-check it afterwards, since values pushed
+        // before the driver saw the ring armed don't signal the eventfd
+        if (ring) {
+            cNotifyReactor::drain(ring, uisr);
+            __atomic_store_n(&ring->armed, 1, __ATOMIC_SEQ_CST);
+            if (__atomic_load_n(&ring->head, __ATOMIC_SEQ_CST) != ring->tail) {
+                continue;
+            }
+        }
+
 		int event_count = epoll_wait(epoll_fd, events, MAX_EVENTS, -1);
 
 		for (int i = 0; i < event_count; i++) {
@@ -66,6 +255,11 @@ int eventHandler(int fd, int efd, int terminate_efd, std::function<void(int)> ui
                     throw std::runtime_error("ERROR: Failed to read interrupt");
                 }
 
+                // Coalesced mode: the values are in the ring, drained at the top of the loop
+                if (ring) {
+                    continue;
+                }
+
                 /* 
                  * Get the interrupt value via IOCTL.
                  * NOTE: Older versions of Coyote used to get the interrupt value directly from
@@ -103,8 +297,12 @@ int eventHandler(int fd, int efd, int terminate_efd, std::function<void(int)> ui
 
 static unsigned seed = std::chrono::system_clock::now().time_since_epoch().count();
 
-cThread::cThread(int32_t vfid, pid_t hpid, uint32_t device, std::function<void(int)> uisr):
-  hpid(hpid), vfid(vfid),
+std::map<std::pair<uint32_t, int32_t>, std::weak_ptr<cThread::vfpgaContext>> cThread::vfpga_ctxs;
+
+std::mutex cThread::vfpga_ctxs_lock;
+
+cThread::cThread(int32_t vfid, pid_t hpid, uint32_t device, std::function<void(int)> uisr, CoyoteNotify notify, cNotifyReactor *reactor):
+  hpid(hpid), vfid(vfid), device(device), uisr(uisr), notify_mode(notify),
   vlock(boost::interprocess::open_or_create, ("mutex_dev_" + std::to_string(device) + "_vfpa_" + std::to_string(vfid)).c_str()),
   additional_state(nullptr) {
 	DBG1("cThread: opening vFPGA " << vfid << ", hpid " << hpid);
@@ -132,8 +330,44 @@ cThread::cThread(int32_t vfid, pid_t hpid, uint32_t device, std::function<void(i
     fcnfg.parseCnfg(tmp[0]);
     fcnfg.parseCtrlReg(tmp[1]);
 
-    // Register user interrupt service routine (uisr) and start the interrupt processing thread
-    if (uisr) {
+    // Join the shared context (submission ring and in-process lock) of the vFPGA, or create it if this is the first cThread of the process on the vFPGA
+    {
+        std::lock_guard<std::mutex> guard(vfpga_ctxs_lock);
+        std::weak_ptr<vfpgaContext> &ctx = vfpga_ctxs[std::make_pair(device, vfid)];
+        vfpga_ctx = ctx.lock();
+        if (!vfpga_ctx) {
+            vfpga_ctx = std::make_shared<vfpgaContext>();
+            ctx = vfpga_ctx;
+        }
+    }
+
+    // NUMA node of the FPGA; the vFPGA devices are children of the PCI device in sysfs
+    std::ifstream numa_file("/sys/class/coyote_fpga_" + std::to_string(device) + "/coyote_fpga_" + std::to_string(device) + "_v" + std::to_string(vfid) + "/device/numa_node");
+    if (!(numa_file >> numa_node)) {
+        numa_node = -1;
+    }
+    DBG1("cThread: FPGA NUMA node " << numa_node);
+
+    // Switch the notifications to the ring, if requested, and map the vFPGA's rings; the driver allocates them in the first IOCTL_SET_NOTIFY_MODE
+    if (uisr && notify != CoyoteNotify::EVENTFD) {
+        tmp[0] = ctid;
+        tmp[1] = (uint64_t) notify;
+        if (ioctl(fd, IOCTL_SET_NOTIFY_MODE, &tmp)) {
+            throw std::runtime_error("ERROR: IOCTL_SET_NOTIFY_MODE failed");
+        }
+
+        notify_rings = (notifyRing*) mmap(NULL, NOTIFY_RINGS_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, MMAP_NOTIFY);
+        if (notify_rings == MAP_FAILED) {
+            notify_rings = nullptr;
+            throw std::runtime_error("ERROR: notification rings mmap failed");
+        }
+        notify_ring = &notify_rings[ctid];
+        DBG1("cThread: mapped notification rings at: " << std::hex << reinterpret_cast<uint64_t>(notify_rings) << std::dec);
+    }
+
+    // Register user interrupt service routine (uisr) and start the interrupt processing thread; not needed when polling
+    // With a shared reactor, the eventfd is handled by the reactor's thread instead of a dedicated one
+    if (uisr && notify != CoyoteNotify::POLL) {
         DBG1("cThread: user interrupt service routine provided, trying to create efd and terminate_efd"); 
         
 		efd = eventfd(0, 0);
@@ -141,12 +375,17 @@ cThread::cThread(int32_t vfid, pid_t hpid, uint32_t device, std::function<void(i
             throw std::runtime_error("ERROR: cThread could not create eventfd"); 
         }
 
-		terminate_efd = eventfd(0, 0);
-		if (terminate_efd == -1) { 
-            throw std::runtime_error("ERROR: cThread could not create eventfd"); 
-        }
+        if (reactor) {
+            notify_reactor = reactor;
+            notify_reactor->add(fd, efd, ctid, notify_ring, uisr);
+        } else {
+            terminate_efd = eventfd(0, 0);
+            if (terminate_efd == -1) { 
+                throw std::runtime_error("ERROR: cThread could not create eventfd"); 
+            }
 
-        event_thread = std::thread(eventHandler, fd, efd, terminate_efd, uisr, ctid);
+            event_thread = std::thread(eventHandler, fd, efd, terminate_efd, uisr, ctid, notify_ring);
+        }
 
         tmp[0] = ctid; 
 		tmp[1] = efd;
@@ -196,17 +435,24 @@ cThread::~cThread() {
 	DBG1("cThread: destructor, ctid: " << ctid << ", vfid: " << vfid << ", hpid: " << hpid);
 
     // Release the lock, if acquired
-    if (lock_acquired) {
-        vlock.unlock();
-        lock_acquired = false;
+    unlock();
+
+    // Complete the outstanding syncs/off-loads and stop the thread issuing them
+    {
+        std::lock_guard<std::mutex> guard(sync_lock);
+        sync_running = false;
+    }
+    sync_cv.notify_all();
+    if (sync_thread.joinable()) {
+        sync_thread.join();
     }
 
     // Free user pages and unmap the mapped regions
 	uint64_t tmp[MAX_USER_ARGS];
     tmp[0] = ctid;
 
-	for(auto& it: mapped_pages) {
-		freeMem(it.first);
+	while (!mapped_pages.empty()) {
+		freeMem(mapped_pages.begin()->first);
 	}
 	mapped_pages.clear();
 	munmapFpga();
@@ -214,21 +460,37 @@ cThread::~cThread() {
     // Unregister Coyote thread ID
 	ioctl(fd, IOCTL_UNREGISTER_CTID, &tmp);
 
+    // Unregister the Coyote thread IDs of the additional QPs
+    for (const auto &extra : extra_qpairs) {
+        uint64_t qp_tmp[MAX_USER_ARGS];
+        qp_tmp[0] = extra.first;
+        ioctl(fd, IOCTL_UNREGISTER_CTID, &qp_tmp);
+    }
+
     // Terminate user interrupt thread and release the variables
     if (efd != -1) {
 		ioctl(fd, IOCTL_UNREGISTER_EVENTFD, &tmp);
 
-		eventfd_write(terminate_efd, 1);
-        if (event_thread.joinable()) {
-		    event_thread.join();
+        if (notify_reactor) {
+            notify_reactor->remove(efd);
+        } else {
+            eventfd_write(terminate_efd, 1);
+            if (event_thread.joinable()) {
+                event_thread.join();
+            }
+            close(terminate_efd);
         }
 
 		close(efd);
-		close(terminate_efd);
 
         ioctl(fd, IOCTL_SET_NOTIFICATION_PROCESSED, &tmp);
 	}
 
+    // Unmap the notification rings; the driver switched the ctid back to the eventfd when it was unregistered
+    if (notify_rings) {
+        munmap((void*) notify_rings, NOTIFY_RINGS_SIZE);
+    }
+
     // Disable RDMA, if enabled and set-up
     if (fcnfg.en_rdma && is_connected) {
         closeConn();
@@ -237,13 +499,70 @@ cThread::~cThread() {
 	close(fd);
 }
 
-void cThread::postCmd(uint64_t offs_3, uint64_t offs_2, uint64_t offs_1, uint64_t offs_0) {
-    DBG1(
-        "cThread: Called postCmd with offsets: " << 
-        std::hex << offs_3 << ", " << offs_2 << ", " << offs_1 << ", " << offs_0 << std::dec
-    );
+void cThread::reset(pid_t hpid) {
+	DBG1("cThread: Called reset, ctid: " << ctid << ", new hpid: " << hpid);
+
+    // The interrupt thread, the eventfd and the notification mode are registered for the current ctid
+    if (uisr) {
+        throw std::runtime_error("ERROR: cThreads with a user interrupt service routine cannot be reset");
+    }
+    {
+        std::lock_guard<std::mutex> guard(sync_lock);
+        if (!sync_queue.empty()) {
+            throw std::runtime_error("ERROR: cThread cannot be reset with outstanding asynchronous syncs/off-loads");
+        }
+        sync_error = nullptr;
+    }
+    unlock();
+
+    // Release the buffers of the previous user
+	while (!mapped_pages.empty()) {
+		freeMem(mapped_pages.begin()->first);
+	}
+	while (!mapped_regions.empty()) {
+		userUnmap(reinterpret_cast<void*>(mapped_regions.begin()->first));
+	}
+
+    if (fcnfg.en_rdma && is_connected) {
+        closeConn();
+    }
+
+    // Re-register the Coyote thread for the new host process; the additional QPs of the previous user are dropped
+	uint64_t tmp[MAX_USER_ARGS];
+    for (const auto &extra : extra_qpairs) {
+        tmp[0] = extra.first;
+        ioctl(fd, IOCTL_UNREGISTER_CTID, &tmp);
+    }
+    extra_qpairs.clear();
+    local_mrs.clear();
+    remote_mrs.clear();
+    sync_mem = nullptr;
+    remote_sync.clear();
+    sync_sent.clear();
+    sync_recvd.clear();
+    pacing.clear();
+
+    tmp[0] = ctid;
+	ioctl(fd, IOCTL_UNREGISTER_CTID, &tmp);
+
+    tmp[0] = hpid;
+	if (ioctl(fd, IOCTL_REGISTER_CTID, &tmp)) { 
+        throw std::runtime_error("ERROR: IOCTL_REGISTER_CTID failed"); 
+    }
+    this->ctid = tmp[1];
+    this->hpid = hpid;
+	DBG1("cThread: re-registered ctid " << ctid);
+
+    if (fcnfg.en_rdma) {
+        qpair->local.qpn = ((vfid & N_REG_MASK) << PID_BITS) | (ctid & PID_MASK); 
+    }
+
+    clearCompleted();
+}
 
-    // Check outstanding commands; to avoid oversaturating the command FIFO
+uint32_t cThread::waitCmdCredits() {
+    uint32_t &cmd_cnt = vfpga_ctx->cmd_ring.cmd_cnt;
+    uint64_t stall_begin = cmd_cnt > (CMD_FIFO_DEPTH - CMD_FIFO_THR) && cTracer::enabled() ? cTracer::now() : 0;
     while (cmd_cnt > (CMD_FIFO_DEPTH - CMD_FIFO_THR)) {
         #ifdef EN_AVX
         cmd_cnt = fcnfg.en_avx ? LOW_32(_mm256_extract_epi32(cnfg_reg_avx[static_cast<uint32_t>(CnfgAvxRegs::CTRL_REG)], 0x0)) :
@@ -253,26 +572,110 @@ void cThread::postCmd(uint64_t offs_3, uint64_t offs_2, uint64_t offs_1, uint64_
         #endif
 
         if (cmd_cnt > (CMD_FIFO_DEPTH - CMD_FIFO_THR)) {
-            std::this_thread::sleep_for(std::chrono::nanoseconds(SLEEP_TIME));
+            backOff();
         }
     }
 
-    // Send the commands
+    if (stall_begin) {
+        cTracer::complete("cThread", "cmd credits stall", stall_begin, cTracer::now(), "ctid", ctid);
+    }
+    return (CMD_FIFO_DEPTH - CMD_FIFO_THR) - cmd_cnt + 1;
+}
+
+void cThread::backOff() const {
+    switch (backoff) {
+        case CoyoteBackoff::POLL:
+            break;
+        case CoyoteBackoff::PAUSE:
+            // Not tied to EN_AVX; without a spin hint the loop is empty and gets optimized away
+            for (int i = 0; i < CMD_FIFO_PAUSE_SPINS; i++) {
+                #if defined(__x86_64__) || defined(__i386__)
+                _mm_pause();
+                #elif defined(__aarch64__)
+                asm volatile("yield" ::: "memory");
+                #else
+                asm volatile("" ::: "memory");
+                #endif
+            }
+            break;
+        default:
+            std::this_thread::sleep_for(std::chrono::nanoseconds(SLEEP_TIME));
+            break;
+    }
+}
+
+void cThread::writeCmd(const std::array<uint64_t, 4> &cmd) {
     #ifdef EN_AVX
-    if (fcnfg.en_avx) {
-        cnfg_reg_avx[static_cast<uint32_t>(CnfgAvxRegs::CTRL_REG)] = _mm256_set_epi64x(offs_3, offs_2, offs_1, offs_0);
+    if (cnfg_reg_wc) {
+        // The fence flushes the write-combining buffer; otherwise, the next command would be merged into this one
+        cnfg_reg_wc[static_cast<uint32_t>(CnfgAvxRegs::CTRL_REG)] = _mm256_set_epi64x(cmd[0], cmd[1], cmd[2], cmd[3]);
+        _mm_sfence();
+    } else if (fcnfg.en_avx) {
+        cnfg_reg_avx[static_cast<uint32_t>(CnfgAvxRegs::CTRL_REG)] = _mm256_set_epi64x(cmd[0], cmd[1], cmd[2], cmd[3]);
     } else {
     #endif
-        cnfg_reg[static_cast<uint32_t>(CnfgLegRegs::VADDR_WR_REG)] = offs_3;
-        cnfg_reg[static_cast<uint32_t>(CnfgLegRegs::CTRL_REG_2)] = offs_2;
-        cnfg_reg[static_cast<uint32_t>(CnfgLegRegs::VADDR_RD_REG)] = offs_1;
-        cnfg_reg[static_cast<uint32_t>(CnfgLegRegs::CTRL_REG)] = offs_0;
+        cnfg_reg[static_cast<uint32_t>(CnfgLegRegs::VADDR_WR_REG)] = cmd[0];
+        cnfg_reg[static_cast<uint32_t>(CnfgLegRegs::CTRL_REG_2)] = cmd[1];
+        cnfg_reg[static_cast<uint32_t>(CnfgLegRegs::VADDR_RD_REG)] = cmd[2];
+        cnfg_reg[static_cast<uint32_t>(CnfgLegRegs::CTRL_REG)] = cmd[3];
     #ifdef EN_AVX
     }
     #endif
+}
+
+void cThread::drainCmds() {
+    /*
+     * Write as many queued commands as there are credits, back-to-back, and repeat until the ring is empty.
+     * If another thread is draining, it also writes the commands pushed by this thread; release() reports
+     * commands pushed just as the drainer stopped, so none are left behind.
+     */
+    while (vfpga_ctx->cmd_ring.tryAcquire()) {
+        std::array<uint64_t, 4> cmd;
+        bool pending = true;
+        while (pending) {
+            uint32_t n = waitCmdCredits();
+            for (uint32_t i = 0; i < n; i++) {
+                if (!vfpga_ctx->cmd_ring.pop(cmd)) {
+                    pending = false;
+                    break;
+                }
+                writeCmd(cmd);
+                vfpga_ctx->cmd_ring.cmd_cnt++;
+            }
+        }
+
+        if (!vfpga_ctx->cmd_ring.release()) {
+            break;
+        }
+    }
+}
+
+void cThread::pushCmd(const std::array<uint64_t, 4> &cmd) {
+    while (!vfpga_ctx->cmd_ring.push(cmd)) {
+        drainCmds();
+        std::this_thread::yield();
+    }
+}
+
+void cThread::postCmd(uint64_t offs_3, uint64_t offs_2, uint64_t offs_1, uint64_t offs_0) {
+    DBG1(
+        "cThread: Called postCmd with offsets: " << 
+        std::hex << offs_3 << ", " << offs_2 << ", " << offs_1 << ", " << offs_0 << std::dec
+    );
+
+    cTraceScope trace("cThread", "postCmd", "ctid", ctid);
+    pushCmd({offs_3, offs_2, offs_1, offs_0});
+    drainCmds();
+}
+
+void cThread::postCmdBatch(const std::vector<std::array<uint64_t, 4>> &cmds) {
+    DBG1("cThread: Called postCmdBatch with " << cmds.size() << " commands");
+    cTraceScope trace("cThread", "postCmdBatch", "ctid", ctid, "cmds", cmds.size());
 
-    // Increment
-    cmd_cnt++;
+    for (const std::array<uint64_t, 4> &cmd : cmds) {
+        pushCmd(cmd);
+    }
+    drainCmds();
 }
 
 void cThread::mmapFpga() {
@@ -316,6 +719,18 @@ void cThread::mmapFpga() {
 
 		DBG1("cThread: mapped writeback regions at: " << std::hex << reinterpret_cast<uint64_t>(wback) << std::dec);
 	}
+
+	// Statistics; optional, only used to track invalidations of implicitly registered buffers
+	void *stats = mmap(NULL, VFPGA_STATS_SIZE, PROT_READ, MAP_SHARED, fd, MMAP_STATS);
+	if (stats != MAP_FAILED) {
+		stats_page = static_cast<const volatile vfpgaStatsPage*>(stats);
+		if (stats_page->version != VFPGA_STATS_VERSION) {
+			munmap(stats, VFPGA_STATS_SIZE);
+			stats_page = nullptr;
+		}
+	}
+	auto_register = stats_page && (stats_page->flags & VFPGA_STATS_FLAG_LAZY_UNPIN);
+	DBG1("cThread: implicit buffer registration " << (auto_register ? "enabled" : "disabled"));
 }
 
 void cThread::munmapFpga() {
@@ -323,6 +738,7 @@ void cThread::munmapFpga() {
 
 	// Config
     #ifdef EN_AVX
+	setWriteCombining(false);
 	if (fcnfg.en_avx) {
 		if (munmap((void*)cnfg_reg_avx, CNFG_AVX_REGION_SIZE) != 0) {
 			throw std::runtime_error("ERROR: cnfg_reg_avx munmap failed");
@@ -348,22 +764,60 @@ void cThread::munmapFpga() {
         }
 	}
 
+	// Statistics
+	if (stats_page) {
+		if (munmap((void*)stats_page, VFPGA_STATS_SIZE) != 0) {
+			throw std::runtime_error("ERROR: stats_page munmap failed");
+        }
+	}
+
     #ifdef EN_AVX
 	cnfg_reg_avx = 0;
     #endif
 	cnfg_reg = 0;
 	ctrl_reg = 0;
 	wback = 0;
+	stats_page = nullptr;
+}
+
+void cThread::bindNuma(void *mem, size_t size, int32_t node) const {
+    if (node == NUMA_NODE_NONE) {
+        return;
+    }
+
+    if (node == NUMA_NODE_AUTO) {
+        if (numa_node < 0) {
+            DBG1("cThread: NUMA node of the FPGA unknown, skipping NUMA binding");
+            return;
+        }
+        node = numa_node;
+    }
+
+    // Preferred (rather than strict) policy, so that allocations still succeed if the node has no free (huge) pages left
+    // Already faulted pages (e.g., the recycled heap memory of THP allocations) are migrated
+    unsigned long nodemask[16] = { 0 };
+    if (node >= static_cast<int32_t>(8 * sizeof(nodemask))) {
+        throw std::runtime_error("ERROR: cThread::getMem() - invalid NUMA node " + std::to_string(node));
+    }
+    nodemask[node / (8 * sizeof(unsigned long))] |= 1UL << (node % (8 * sizeof(unsigned long)));
+    
+    if (syscall(SYS_mbind, mem, size, MPOL_PREFERRED, nodemask, 8 * sizeof(nodemask), MPOL_MF_MOVE)) {
+        std::cerr << "WARNING: cThread::getMem() - mbind to NUMA node " << node << " failed, errno " << errno << std::endl;
+    } else {
+        DBG1("cThread: bound memory at " << mem << " to NUMA node " << node);
+    }
 }
 
-void cThread::userMap(void *vaddr, uint32_t len, int32_t mem_block) {
-    DBG1("cThread: Called userMap to map user buffer, vaddr " << vaddr << ", length " << len << ", memory block " << mem_block << " and ctid " << ctid);
+void cThread::userMap(void *vaddr, uint64_t len, int32_t mem_block, uint32_t mem_stripe, bool resident, CoyoteAccess access) {
+    DBG1("cThread: Called userMap to map user buffer, vaddr " << vaddr << ", length " << len << ", memory block " << mem_block << ", memory stripe " << mem_stripe << ", resident " << resident << ", access " << static_cast<int>(access) << " and ctid " << ctid);
 
     uint64_t tmp[MAX_USER_ARGS];
 	tmp[0] = reinterpret_cast<uint64_t>(vaddr);
 	tmp[1] = static_cast<uint64_t>(len);
 	tmp[2] = static_cast<uint64_t>(ctid);
 	tmp[3] = static_cast<uint64_t>(mem_block);
+	tmp[4] = static_cast<uint64_t>(mem_stripe);
+	tmp[5] = (resident ? MAP_USER_RESIDENT : 0) | static_cast<uint64_t>(access);
 
     int ret_val = ioctl(fd, IOCTL_MAP_USER_MEM, &tmp);
 	if (ret_val) {
@@ -373,6 +827,8 @@ void cThread::userMap(void *vaddr, uint32_t len, int32_t mem_block) {
             std::cerr << "WARNING: userMap detected that the mapped buffer may need explicit synchronization due to caching effects; see dmesg for more details" << std::endl;
         }
     }
+
+    mapped_regions[reinterpret_cast<uint64_t>(vaddr)] = reinterpret_cast<uint64_t>(vaddr) + len;
 }
 
 void cThread::userUnmap(void *vaddr) {
@@ -385,6 +841,156 @@ void cThread::userUnmap(void *vaddr) {
     if (ioctl(fd, IOCTL_UNMAP_USER_MEM, &tmp)) {
         throw std::runtime_error("ERROR: IOCTL_UNMAP_USER_MEM failed");
     }
+
+    mapped_regions.erase(reinterpret_cast<uint64_t>(vaddr));
+    auto_regions.erase(reinterpret_cast<uint64_t>(vaddr));
+}
+
+void cThread::setAutoRegister(bool enable) {
+    DBG1("cThread: Called setAutoRegister, enable " << enable);
+    auto_register = enable;
+}
+
+void cThread::autoRegister(const void *vaddr, uint64_t len) {
+    if (!auto_register || !len) {
+        return;
+    }
+
+    // Drop the regions released by the MMU notifier since the last check; the counter is per cThread, so other regions may be dropped
+    // as well, which only costs a redundant userMap() (the driver finds the pages already mapped)
+    if (stats_page) {
+        uint64_t invalidations = stats_page->ctids[ctid].mmu_invalidations;
+        if (invalidations != auto_invalidations) {
+            for (auto &region : auto_regions) {
+                mapped_regions.erase(region.first);
+            }
+            auto_regions.clear();
+            auto_invalidations = invalidations;
+        }
+    }
+
+    if (isMapped(vaddr, len)) {
+        return;
+    }
+
+    // Register the enclosing pages, so that neighbouring buffers on the same pages hit the cache
+    uint64_t start = reinterpret_cast<uint64_t>(vaddr) & ~(PAGE_SIZE - 1);
+    uint64_t end = (reinterpret_cast<uint64_t>(vaddr) + len + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+    DBG1("cThread: implicitly registering buffer " << std::hex << start << " - " << end << std::dec);
+    userMap(reinterpret_cast<void*>(start), end - start);
+    auto_regions[start] = end;
+}
+
+void cThread::prefault(void *vaddr, uint64_t len, uint32_t stream) {
+    prefault(std::vector<std::pair<void*, uint64_t>>{{vaddr, len}}, stream);
+}
+
+void cThread::prefault(const std::vector<std::pair<void*, uint64_t>> &buffs, uint32_t stream) {
+    DBG1("cThread: Called prefault for " << buffs.size() << " buffers, stream " << stream << " and ctid " << ctid);
+
+    // The driver accepts at most MAX_N_PREFAULT_RANGES buffers per call
+    for (size_t i = 0; i < buffs.size(); i += MAX_N_PREFAULT_RANGES) {
+        size_t n = std::min(buffs.size() - i, (size_t) MAX_N_PREFAULT_RANGES);
+
+        uint64_t ranges[2 * MAX_N_PREFAULT_RANGES];
+        for (size_t j = 0; j < n; j++) {
+            ranges[2 * j] = reinterpret_cast<uint64_t>(buffs[i + j].first);
+            ranges[2 * j + 1] = buffs[i + j].second;
+        }
+
+        uint64_t tmp[MAX_USER_ARGS];
+        tmp[0] = reinterpret_cast<uint64_t>(ranges);
+        tmp[1] = static_cast<uint64_t>(n);
+        tmp[2] = static_cast<uint64_t>(ctid);
+        tmp[3] = static_cast<uint64_t>(stream);
+
+        int ret_val = ioctl(fd, IOCTL_PREFAULT_USER_MEM, &tmp);
+        if (ret_val) {
+            if (ret_val != BUFF_NEEDS_EXP_SYNC_RET_CODE) {
+                throw std::runtime_error("ERROR: IOCTL_PREFAULT_USER_MEM failed");
+            } else {
+                std::cerr << "WARNING: prefault detected that the buffers may need explicit synchronization due to caching effects; see dmesg for more details" << std::endl;
+            }
+        }
+    }
+}
+
+void cThread::userMemBatch(const std::vector<memOpSg> &ops, int32_t mem_block, uint32_t mem_stripe) {
+    DBG1("cThread: Called userMemBatch for " << ops.size() << " operations, memory block " << mem_block << ", memory stripe " << mem_stripe << " and ctid " << ctid);
+
+    // Flatten to (virtual address, length, operation) triples; the driver takes a 32-bit length for syncs/off-loads, so large buffers are split
+    std::vector<uint64_t> triples;
+    bool has_sync = false;
+    for (const memOpSg &op : ops) {
+        if (op.op == CoyoteMemOp::MAP || op.op == CoyoteMemOp::UNMAP) {
+            triples.insert(triples.end(), {reinterpret_cast<uint64_t>(op.addr), op.len, static_cast<uint64_t>(op.op)});
+            continue;
+        }
+
+        if (!fcnfg.en_mem) {
+            throw std::runtime_error("ERROR: cThread::userMemBatch() called with a sync/offload operation, but the shell was not synthesized with card memory support, exiting...");
+        }
+        has_sync = true;
+        for (uint64_t offs = 0; offs < op.len || offs == 0; offs += MAX_TRANSFER_SIZE) {
+            uint64_t len = std::min<uint64_t>(op.len - offs, MAX_TRANSFER_SIZE);
+            triples.insert(triples.end(), {reinterpret_cast<uint64_t>(op.addr) + offs, len, static_cast<uint64_t>(op.op)});
+            if (op.len == 0) {
+                break;
+            }
+        }
+    }
+
+    // Syncs and off-loads are ordered after the outstanding asynchronous ones
+    if (has_sync) {
+        std::unique_lock<std::mutex> guard(sync_lock);
+        sync_cv.wait(guard, [&] { 
+            return sync_completed[0] == sync_submitted[0] && sync_completed[1] == sync_submitted[1]; 
+        });
+    }
+
+    // The driver accepts at most MAX_N_BATCH_OPS operations per call
+    size_t n_triples = triples.size() / 3;
+    for (size_t i = 0; i < n_triples; i += MAX_N_BATCH_OPS) {
+        size_t n = std::min(n_triples - i, (size_t) MAX_N_BATCH_OPS);
+
+        uint64_t tmp[MAX_USER_ARGS];
+        tmp[0] = reinterpret_cast<uint64_t>(&triples[3 * i]);
+        tmp[1] = static_cast<uint64_t>(n);
+        tmp[2] = static_cast<uint64_t>(ctid);
+        tmp[3] = static_cast<uint64_t>(mem_block);
+        tmp[4] = static_cast<uint64_t>(mem_stripe);
+
+        int ret_val = ioctl(fd, IOCTL_BATCH_USER_MEM, &tmp);
+        if (ret_val) {
+            if (ret_val != BUFF_NEEDS_EXP_SYNC_RET_CODE) {
+                throw std::runtime_error("ERROR: IOCTL_BATCH_USER_MEM failed");
+            } else {
+                std::cerr << "WARNING: userMemBatch detected that the mapped buffers may need explicit synchronization due to caching effects; see dmesg for more details" << std::endl;
+            }
+        }
+
+        for (size_t j = i; j < i + n; j++) {
+            uint64_t vaddr = triples[3 * j];
+            if (triples[3 * j + 2] == static_cast<uint64_t>(CoyoteMemOp::MAP)) {
+                mapped_regions[vaddr] = vaddr + triples[3 * j + 1];
+            } else if (triples[3 * j + 2] == static_cast<uint64_t>(CoyoteMemOp::UNMAP)) {
+                mapped_regions.erase(vaddr);
+            }
+        }
+    }
+}
+
+void cThread::setFaultAhead(void *vaddr, int64_t window) {
+    DBG1("cThread: Called setFaultAhead for buffer " << vaddr << ", window " << window << " and ctid " << ctid);
+
+    uint64_t tmp[MAX_USER_ARGS];
+    tmp[0] = reinterpret_cast<uint64_t>(vaddr);
+    tmp[1] = static_cast<uint64_t>(ctid);
+    tmp[2] = static_cast<uint64_t>(window);
+
+    if (ioctl(fd, IOCTL_SET_FAULT_AHEAD, &tmp)) {
+        throw std::runtime_error("ERROR: IOCTL_SET_FAULT_AHEAD failed; is the buffer mapped?");
+    }
 }
 
 void* cThread::getMem(CoyoteAlloc&& alloc) {
@@ -398,7 +1004,8 @@ void* cThread::getMem(CoyoteAlloc&& alloc) {
 			case CoyoteAllocType::REG : {
                 DBG1("cThread: Obtain regular memory"); 
                 mem = mmap(NULL, alloc.size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
-				userMap(mem, alloc.size, alloc.mem_block);
+                bindNuma(mem, alloc.size, alloc.numa_node);
+				userMap(mem, alloc.size, alloc.mem_block, alloc.mem_stripe, false, alloc.access);
 				break;
             }
 
@@ -410,7 +1017,9 @@ void* cThread::getMem(CoyoteAlloc&& alloc) {
                     std::cerr << "ERROR: cThread::getMem() - Failed to allocate transparent hugepages!" << std::endl;;
                     return nullptr;
                 }
-                userMap(mem, alloc.size, alloc.mem_block);
+                madvise(mem, alloc.size, MADV_HUGEPAGE);
+                bindNuma(mem, alloc.size, alloc.numa_node);
+                userMap(mem, alloc.size, alloc.mem_block, alloc.mem_stripe, false, alloc.access);
                 break;
             }
 
@@ -418,27 +1027,74 @@ void* cThread::getMem(CoyoteAlloc&& alloc) {
             case CoyoteAllocType::HPF: {
                 DBG1("cThread: Obtain huge page memory");
 
-                mem = MAP_FAILED;
-                int  huge_flag = (fcnfg.ctrl_reg.pg_l_bits << MAP_HUGE_SHIFT);
+                mem = allocHugePages(alloc.size, alloc.numa_node);
+                if (mem) {
+                    DBG1("cThread: Allocated huge pages successfully");
+                } else {
+                    int err = errno;
+                    fprintf(stderr,
+                        "cThread: Hugepage allocation failed: Shell pg_l_bits=%u (requested page size = %lu KB), "
+                        "alloc.size=%zu, errno=%d (%s)\n",
+                        fcnfg.ctrl_reg.pg_l_bits,
+                        1UL << fcnfg.ctrl_reg.pg_l_bits,
+                        (size_t) alloc.size,
+                        err,
+                        strerror(err)
+                    );
+                    return nullptr;
+                }
+
+                userMap(mem, alloc.size, alloc.mem_block, alloc.mem_stripe, false, alloc.access);
+                break;
+            }
+
+            // Huge pages where available, falling back to transparent huge pages and then to regular pages
+            case CoyoteAllocType::AUTO: {
+                DBG1("cThread: Obtain huge page memory, with fallback");
 
+                mem = allocHugePages(alloc.size, alloc.numa_node);
+                if (mem) {
+                    alloc.alloc = CoyoteAllocType::HPF;
+                } else {
+                    int err = errno;
+                    if (thpEnabled() && !posix_memalign(&mem, HUGE_PAGE_SIZE, alloc.size)) {
+                        madvise(mem, alloc.size, MADV_HUGEPAGE);
+                        alloc.alloc = CoyoteAllocType::THP;
+                    } else {
+                        mem = mmap(NULL, alloc.size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+                        if (mem == MAP_FAILED) {
+                            std::cerr << "ERROR: cThread::getMem() - Failed to allocate " << alloc.size << " bytes!" << std::endl;
+                            return nullptr;
+                        }
+                        alloc.alloc = CoyoteAllocType::REG;
+                    }
+                    std::cerr << "WARNING: cThread::getMem() - no huge pages available (errno " << err << ", " << strerror(err) << "), fell back to " 
+                              << (alloc.alloc == CoyoteAllocType::THP ? "transparent huge pages" : "regular pages") << " for " << alloc.size << " bytes" << std::endl;
+                    bindNuma(mem, alloc.size, alloc.numa_node);
+                }
+
+                userMap(mem, alloc.size, alloc.mem_block, alloc.mem_stripe, false, alloc.access);
+                break;
+            }
+
+            // Allocation of 1GB huge pages
+            case CoyoteAllocType::HPF_1G: {
+                DBG1("cThread: Obtain 1GB huge page memory");
+
+                uint64_t size = ((alloc.size + HUGE_PAGE_1G_SIZE - 1) >> HUGE_PAGE_1G_SHIFT) << HUGE_PAGE_1G_SHIFT;
                 mem = mmap(
                     NULL,
-                    alloc.size,
+                    size,
                     PROT_READ | PROT_WRITE,
-                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | huge_flag,
+                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | (HUGE_PAGE_1G_SHIFT << MAP_HUGE_SHIFT),
                     -1,
                     0
                 );
 
-                if (mem != MAP_FAILED) {
-                    DBG1("cThread: Allocated huge pages successfully");
-                } else {
+                if (mem == MAP_FAILED) {
                     int err = errno;
                     fprintf(stderr,
-                        "cThread: Hugepage allocation failed: Shell pg_l_bits=%u (requested page size = %lu KB), "
-                        "alloc.size=%zu, errno=%d (%s)\n",
-                        fcnfg.ctrl_reg.pg_l_bits,
-                        1UL << fcnfg.ctrl_reg.pg_l_bits,
+                        "cThread: 1GB hugepage allocation failed: alloc.size=%zu, errno=%d (%s)\n",
                         (size_t) alloc.size,
                         err,
                         strerror(err)
@@ -446,12 +1102,44 @@ void* cThread::getMem(CoyoteAlloc&& alloc) {
                     return nullptr;
                 }
 
-                userMap(mem, alloc.size, alloc.mem_block);
+                alloc.size = size;
+                bindNuma(mem, alloc.size, alloc.numa_node);
+                userMap(mem, alloc.size, alloc.mem_block, alloc.mem_stripe, false, alloc.access);
                 break;
             }
 
+            // Card memory allocation; only the virtual address range is reserved on the host, the driver maps it to card memory
+            case CoyoteAllocType::CARD: {
+                DBG1("cThread: Obtain card memory");
+                if (!fcnfg.en_mem) {
+                    throw std::runtime_error("ERROR: cThread::getMem() - card memory requested, but the shell is built without memory");
+                }
 
-            // GPU memory allocation
+                uint64_t size = alloc.size;
+                mem = reserveCardRange(size);
+                if (!mem) {
+                    std::cerr << "ERROR: cThread::getMem() - Failed to reserve the address range for card memory!" << std::endl;
+                    return nullptr;
+                }
+
+                uint64_t start = reinterpret_cast<uint64_t>(mem);
+                uint64_t tmp[MAX_USER_ARGS];
+                tmp[0] = start;
+                tmp[1] = size;
+                tmp[2] = static_cast<uint64_t>(ctid);
+                tmp[3] = static_cast<uint64_t>(alloc.mem_block);
+                tmp[4] = static_cast<uint64_t>(alloc.mem_stripe);
+                if (ioctl(fd, IOCTL_MAP_CARD_MEM, &tmp)) {
+                    munmap(mem, size);
+                    throw std::runtime_error("ERROR: IOCTL_MAP_CARD_MEM failed");
+                }
+
+                mapped_regions[start] = start + size;
+                alloc.size = size;
+                break;
+            }
+
+            // GPU memory allocation
             case CoyoteAllocType::GPU : { 
             #ifdef EN_GPU
                 /*
@@ -515,15 +1203,42 @@ void* cThread::getMem(CoyoteAlloc&& alloc) {
 		            throw std::runtime_error("ERROR: IOCTL_MAP_DMABUF failed");
                 }
                 
+                mapped_regions[reinterpret_cast<uint64_t>(mem)] = reinterpret_cast<uint64_t>(mem) + alloc.size;
                 DBG1("Allocated GPU buffer at: " << std::hex << (reinterpret_cast<uint64_t>(mem)) << ", offset: "<< std::dec << offset);
 
+                alloc.mem = mem;
+            #elif defined(EN_CUDA)
+                // NVIDIA GPUs: the memory is allocated and exported as a dmabuf through the CUDA driver API; 
+                // the buffer is page-aligned, so the dmabuf starts at the returned address
+                mem = cuda_alloc_dmabuf(alloc.size, alloc.gpu_dev_id, &alloc.gpu_dmabuf_fd);
+                if (!mem) {
+                    return nullptr;
+                }
+
+                uint64_t tmp[MAX_USER_ARGS];
+                tmp[0] = alloc.gpu_dmabuf_fd;
+                tmp[1] = reinterpret_cast<uint64_t>(mem);
+                tmp[2] = static_cast<uint64_t>(ctid);
+                tmp[3] = static_cast<uint64_t>(alloc.mem_block);
+                if (ioctl(fd, IOCTL_MAP_DMABUF, &tmp)) {
+                    cuda_free_dmabuf(mem, alloc.gpu_dmabuf_fd);
+		            throw std::runtime_error("ERROR: IOCTL_MAP_DMABUF failed");
+                }
+
+                mapped_regions[reinterpret_cast<uint64_t>(mem)] = reinterpret_cast<uint64_t>(mem) + alloc.size;
+                DBG1("Allocated CUDA GPU buffer at: " << std::hex << (reinterpret_cast<uint64_t>(mem)) << std::dec);
+
                 alloc.mem = mem;
             #else
-                throw std::runtime_error("ERROR: GPU support not enabled; please compile the software with DEN_GPU=1");
+                throw std::runtime_error("ERROR: GPU support not enabled; please compile the software with DEN_GPU=1 (AMD) or DEN_CUDA=1 (NVIDIA)");
             #endif
                 break;
             }
 
+            case CoyoteAllocType::PEER: {
+                throw std::runtime_error("ERROR: cThread::getMem() - peer-to-peer windows are mapped with cThread::importP2PWindow()");
+            }
+
 			default:
 				break;
 		}
@@ -559,8 +1274,33 @@ void cThread::freeMem(void* vaddr) {
                 free(vaddr);
                 break;
             }
-            case CoyoteAllocType::HPF : {
+            case CoyoteAllocType::HPF : case CoyoteAllocType::HPF_1G : {
                 userUnmap(vaddr);
+                if (mapped.alloc == CoyoteAllocType::HPF_1G || !hpoolPut(vaddr, mapped.size)) {
+                    munmap(vaddr, mapped.size);
+                }
+                break;
+            }
+            case CoyoteAllocType::CARD : {
+                uint64_t tmp[MAX_USER_ARGS];
+                tmp[0] = reinterpret_cast<uint64_t>(vaddr);
+                tmp[1] = static_cast<uint64_t>(ctid);
+                if (ioctl(fd, IOCTL_UNMAP_CARD_MEM, &tmp)) {
+                    throw std::runtime_error("ERROR: IOCTL_UNMAP_CARD_MEM failed");
+                }
+                mapped_regions.erase(reinterpret_cast<uint64_t>(vaddr));
+                munmap(vaddr, mapped.size);
+                break;
+            }
+            case CoyoteAllocType::PEER : {
+                // Detach the DMABuff; the window itself is owned by the exporting vFPGA
+                uint64_t tmp[MAX_USER_ARGS];
+                tmp[0] = reinterpret_cast<uint64_t>(vaddr);
+                tmp[1] = static_cast<uint64_t>(ctid);
+                if (ioctl(fd, IOCTL_UNMAP_DMABUF, &tmp)) {
+                    throw std::runtime_error("ERROR: ioctl_unmap_dmabuf() failed");
+                }
+                mapped_regions.erase(reinterpret_cast<uint64_t>(vaddr));
                 munmap(vaddr, mapped.size);
                 break;
             }
@@ -573,6 +1313,7 @@ void cThread::freeMem(void* vaddr) {
                 if (ioctl(fd, IOCTL_UNMAP_DMABUF, &tmp)) {
                     throw std::runtime_error("ERROR: ioctl_unmap_dmabuf() failed");
                 }
+                mapped_regions.erase(reinterpret_cast<uint64_t>(mapped.mem));
 
                 hsa_status_t err = hsa_amd_portable_close_dmabuf(mapped.gpu_dmabuf_fd);
                 if (err != HSA_STATUS_SUCCESS) {
@@ -584,8 +1325,18 @@ void cThread::freeMem(void* vaddr) {
                 if (err != HSA_STATUS_SUCCESS) {
                     std::cerr << "GPU buffers not freed properly!" << std::endl;
                 }
+            #elif defined(EN_CUDA)
+                // Detach the DMABuff, then close it and release the memory
+                uint64_t tmp[MAX_USER_ARGS];
+                tmp[0] = reinterpret_cast<uint64_t>(mapped.mem);
+                tmp[1] = static_cast<uint64_t>(ctid);
+                if (ioctl(fd, IOCTL_UNMAP_DMABUF, &tmp)) {
+                    throw std::runtime_error("ERROR: ioctl_unmap_dmabuf() failed");
+                }
+                mapped_regions.erase(reinterpret_cast<uint64_t>(mapped.mem));
+                cuda_free_dmabuf(mapped.mem, mapped.gpu_dmabuf_fd);
             #else
-                throw std::runtime_error("ERROR: GPU support not enabled; please compile the software with DEN_GPU=1");
+                throw std::runtime_error("ERROR: GPU support not enabled; please compile the software with DEN_GPU=1 (AMD) or DEN_CUDA=1 (NVIDIA)");
             #endif
                 break;
             }
@@ -598,359 +1349,1410 @@ void cThread::freeMem(void* vaddr) {
             qpair->local.vaddr = 0;
             qpair->local.size =  0;  
         }
+
+        mapped_pages.erase(vaddr);
 	}
 }
 
-void cThread::setCSR(uint64_t val, uint32_t offs) {
-    ctrl_reg[offs] = val; 
+void cThread::reserveHugePages(uint64_t size, int32_t numa_node) {
+    uint64_t page_size = 1ULL << fcnfg.ctrl_reg.pg_l_bits;
+    size = (size + page_size - 1) & ~(page_size - 1);
+    DBG1("cThread: Called reserveHugePages for " << size / page_size << " pages of " << page_size << " bytes, NUMA node " << numa_node);
+    if (!size) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(hpool_mtx);
+        if (hpool_page_size && hpool_page_size != page_size) {
+            throw std::runtime_error("ERROR: cThread::reserveHugePages() - the pool was already reserved with a different huge page size");
+        }
+    }
+
+    // Huge pages of private mappings are reserved by mmap(), so the pool can't run out once mapped
+    int huge_flag = (fcnfg.ctrl_reg.pg_l_bits << MAP_HUGE_SHIFT);
+    void *mem = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | huge_flag, -1, 0);
+    if (mem == MAP_FAILED && errno == ENOMEM && growHugePagePool(page_size, size / page_size)) {
+        mem = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | huge_flag, -1, 0);
+    }
+    if (mem == MAP_FAILED) {
+        throw std::runtime_error("ERROR: cThread::reserveHugePages() - could not reserve " + std::to_string(size / page_size) + 
+                                 " huge pages, errno " + std::to_string(errno) + "; see /proc/sys/vm/nr_hugepages");
+    }
+
+    // Fault the pages in on the requested node up front, so that allocations from the pool don't fault
+    bindNuma(mem, size, numa_node);
+    for (uint64_t offs = 0; offs < size; offs += page_size) {
+        static_cast<volatile char*>(mem)[offs] = 0;
+    }
+
+    std::lock_guard<std::mutex> lock(hpool_mtx);
+    uint64_t start = reinterpret_cast<uint64_t>(mem);
+    hpool_page_size = page_size;
+    hpool_regions.emplace_back(start, start + size);
+    hpool_free[start] = start + size;
 }
 
-uint64_t cThread::getCSR(uint32_t offs) const {
-    return ctrl_reg[offs];
+void* cThread::allocHugePages(uint64_t size, int32_t numa_node) {
+    uint64_t page_size = 1ULL << fcnfg.ctrl_reg.pg_l_bits;
+    void *mem = hpoolGet(size, page_size);
+    if (mem) {
+        DBG1("cThread: Obtained huge pages from the reserved pool");
+        return mem;
+    }
+
+    int huge_flag = (fcnfg.ctrl_reg.pg_l_bits << MAP_HUGE_SHIFT);
+    mem = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | huge_flag, -1, 0);
+    if (mem == MAP_FAILED) {
+        return nullptr;
+    }
+    bindNuma(mem, size, numa_node);
+    return mem;
 }
 
-void cThread::invoke(CoyoteOper oper, syncSg sg) {
-    DBG1("cThread: Call invoke for a sync/offload operation with address " << sg.addr << ", length " << sg.len);
+void* cThread::reserveCardRange(uint64_t &size) {
+    // Aligned to the large TLB pages, so that the buffer is mapped with large TLB entries
+    uint64_t align = 1ULL << fcnfg.ctrl_reg.pg_l_bits;
+    size = (size + align - 1) & ~(align - 1);
+    void *range = mmap(NULL, size + align, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (range == MAP_FAILED) {
+        return nullptr;
+    }
 
-    // Argument checks
-    if (!isLocalSync(oper)) {
-        throw std::runtime_error("ERROR: cThread::invoke() called with syncSg flags, but the operation is not a LOCAL_SYNC or LOCAL_OFFLOAD; exiting...");
+    // Release the unaligned head and the tail of the reservation
+    uint64_t start = (reinterpret_cast<uint64_t>(range) + align - 1) & ~(align - 1);
+    if (start != reinterpret_cast<uint64_t>(range)) {
+        munmap(range, start - reinterpret_cast<uint64_t>(range));
     }
+    munmap(reinterpret_cast<void*>(start + size), reinterpret_cast<uint64_t>(range) + align - start);
+    return reinterpret_cast<void*>(start);
+}
 
-    if (!fcnfg.en_mem) {
-        throw std::runtime_error("ERROR: cThread::invoke() called for a sync/offload operation,but the shell was not synthesized with card memory support, exiting...");
+uint64_t cThread::shareCardMem(void *card_mem) {
+    DBG1("cThread: Called shareCardMem for card buffer " << card_mem);
+
+    auto it = mapped_pages.find(card_mem);
+    if (it == mapped_pages.end() || it->second.alloc != CoyoteAllocType::CARD) {
+        throw std::runtime_error("ERROR: cThread::shareCardMem() - the buffer was not obtained with CoyoteAllocType::CARD");
     }
 
-    if (sg.len > MAX_TRANSFER_SIZE) {
-        throw std::runtime_error("ERROR: cThread::invoke() - transfers over 128MB are currently not supported in Coyote, exiting...");
+    uint64_t tmp[MAX_USER_ARGS];
+    tmp[0] = reinterpret_cast<uint64_t>(card_mem);
+    tmp[1] = static_cast<uint64_t>(ctid);
+    if (ioctl(fd, IOCTL_SHARE_CARD_MEM, &tmp)) {
+        throw std::runtime_error("ERROR: IOCTL_SHARE_CARD_MEM failed");
     }
 
-    // Trigger the operation
-    if (oper == CoyoteOper::LOCAL_OFFLOAD) {
-        uint64_t tmp[MAX_USER_ARGS];
-        tmp[0] = reinterpret_cast<uint64_t>(sg.addr);
-        tmp[1] = reinterpret_cast<uint64_t>(sg.len);
-        tmp[2] = ctid;
-        if (ioctl(fd, IOCTL_OFFLOAD_REQ, &tmp)) {
-            throw std::runtime_error("ERROR: IOCTL_OFFLOAD_REQ failed");
-        }  
-    } else if (oper == CoyoteOper::LOCAL_SYNC) {
-        uint64_t tmp[MAX_USER_ARGS];
-        tmp[0] = reinterpret_cast<uint64_t>(sg.addr);
-        tmp[1] = reinterpret_cast<uint64_t>(sg.len);
-        tmp[2] = ctid;
-        if (ioctl(fd, IOCTL_SYNC_REQ, &tmp)) {
-            throw std::runtime_error("ERROR: IOCTL_SYNC_REQ failed");
-        }
-    } else {
-        std::cerr << "ERROR: cThread::invoke() called with an unsupported operation type; returning..." << std::endl;
-        return;
+    DBG1("cThread: card buffer shared with handle " << std::hex << tmp[0] << std::dec);
+    return tmp[0];
+}
+
+void* cThread::attachCardMem(uint64_t handle) {
+    DBG1("cThread: Called attachCardMem for handle " << std::hex << handle << std::dec);
+
+    // Query the size of the shared card memory first, to reserve a range for it
+    uint64_t tmp[MAX_USER_ARGS];
+    tmp[0] = handle;
+    tmp[1] = 0;
+    tmp[2] = static_cast<uint64_t>(ctid);
+    if (ioctl(fd, IOCTL_ATTACH_CARD_MEM, &tmp)) {
+        throw std::runtime_error("ERROR: IOCTL_ATTACH_CARD_MEM failed; is the handle valid for this card?");
+    }
+
+    uint64_t size = tmp[0];
+    void *mem = reserveCardRange(size);
+    if (!mem) {
+        throw std::runtime_error("ERROR: cThread::attachCardMem() - Failed to reserve the address range for card memory");
+    }
+
+    tmp[0] = handle;
+    tmp[1] = reinterpret_cast<uint64_t>(mem);
+    tmp[2] = static_cast<uint64_t>(ctid);
+    if (ioctl(fd, IOCTL_ATTACH_CARD_MEM, &tmp)) {
+        munmap(mem, size);
+        throw std::runtime_error("ERROR: IOCTL_ATTACH_CARD_MEM failed");
     }
+
+    // Released with freeMem(), same as the buffer it was shared from
+    CoyoteAlloc alloc;
+    alloc.alloc = CoyoteAllocType::CARD;
+    alloc.size = size;
+    alloc.mem = mem;
+    mapped_pages.emplace(mem, alloc);
+    mapped_regions[reinterpret_cast<uint64_t>(mem)] = reinterpret_cast<uint64_t>(mem) + size;
+
+    return mem;
 }
 
-void cThread::invoke(CoyoteOper oper, localSg sg, bool last) {
-    // Argument checks
-    DBG1("cThread: Call invoke for a one-side local operation with address " << sg.addr << ", length " << sg.len);
+uint64_t cThread::persistCardMem(void *card_mem, const std::string &name) {
+    DBG1("cThread: Called persistCardMem for card buffer " << card_mem << ", name " << name);
 
-    if (!isLocalRead(oper) && !isLocalWrite(oper)) {
-        throw std::runtime_error("ERROR: cThread::invoke() called with localSg flags, but the operation is not a LOCAL_READ or LOCAL_WRITE; exiting...");
+    auto it = mapped_pages.find(card_mem);
+    if (it == mapped_pages.end() || it->second.alloc != CoyoteAllocType::CARD) {
+        throw std::runtime_error("ERROR: cThread::persistCardMem() - the buffer was not obtained with CoyoteAllocType::CARD");
     }
 
-    if (!fcnfg.en_strm && !fcnfg.en_mem) {
-        throw std::runtime_error("ERROR: cThread::invoke() called for a local operation, but the shell was not synthesized with streams from host memory, exiting...");
+    if (name.empty() || name.size() >= CARD_MEM_NAME_LEN) {
+        throw std::runtime_error("ERROR: cThread::persistCardMem() - the name must have between 1 and CARD_MEM_NAME_LEN - 1 characters");
     }
 
-    if (sg.len > MAX_TRANSFER_SIZE) {
-        throw std::runtime_error("ERROR: cThread::invoke() - transfers over 128MB are currently not supported in Coyote, exiting...");
+    uint64_t tmp[MAX_USER_ARGS];
+    tmp[0] = reinterpret_cast<uint64_t>(card_mem);
+    tmp[1] = static_cast<uint64_t>(ctid);
+    tmp[2] = reinterpret_cast<uint64_t>(name.c_str());
+    if (ioctl(fd, IOCTL_PERSIST_CARD_MEM, &tmp)) {
+        throw std::runtime_error("ERROR: IOCTL_PERSIST_CARD_MEM failed; is the name already taken?");
     }
 
-    // Trigger the operation
-    if (oper == CoyoteOper::LOCAL_READ) {
-        uint64_t ctrl_cmd_src =
-            ((ctid & CTRL_PID_MASK) << CTRL_PID_OFFS) |
-            ((sg.dest & CTRL_DEST_MASK) << CTRL_DEST_OFFS) |
-            (last ? CTRL_LAST : 0x0) |
-            ((sg.stream & CTRL_STRM_MASK) << CTRL_STRM_OFFS) | 
-            (CTRL_START) | 
-            (0x0) | 
-            (static_cast<uint64_t>(sg.len) << CTRL_LEN_OFFS);
-        
-        uint64_t addr_cmd_src = reinterpret_cast<uint64_t>(sg.addr);
+    return tmp[0];
+}
 
-        postCmd(0, 0, addr_cmd_src, ctrl_cmd_src);
+void* cThread::attachCardMem(const std::string &name) {
+    DBG1("cThread: Called attachCardMem for name " << name);
 
-    } else if (oper == CoyoteOper::LOCAL_WRITE) {
-        uint64_t ctrl_cmd_dst =
-            ((ctid & CTRL_PID_MASK) << CTRL_PID_OFFS) |
-            ((sg.dest & CTRL_DEST_MASK) << CTRL_DEST_OFFS) |
-            (last ? CTRL_LAST : 0x0) |
-            ((sg.stream & CTRL_STRM_MASK) << CTRL_STRM_OFFS) | 
-            (CTRL_START) | 
-            (0x0) | 
-            (static_cast<uint64_t>(sg.len) << CTRL_LEN_OFFS);
+    uint64_t tmp[MAX_USER_ARGS];
+    tmp[0] = reinterpret_cast<uint64_t>(name.c_str());
+    if (ioctl(fd, IOCTL_LOOKUP_CARD_MEM, &tmp)) {
+        throw std::runtime_error("ERROR: cThread::attachCardMem() - no persistent card memory named " + name);
+    }
 
-        uint64_t addr_cmd_dst = reinterpret_cast<uint64_t>(sg.addr);
+    return attachCardMem(tmp[0]);
+}
 
-        postCmd(addr_cmd_dst, ctrl_cmd_dst, 0, 0);
+void cThread::unpersistCardMem(const std::string &name) {
+    DBG1("cThread: Called unpersistCardMem for name " << name);
 
-    } else {
-        std::cerr << "ERROR: cThread::invoke() called with an unsupported operation type; returning..." << std::endl;
-        return;
+    uint64_t tmp[MAX_USER_ARGS];
+    tmp[0] = reinterpret_cast<uint64_t>(name.c_str());
+    if (ioctl(fd, IOCTL_UNPERSIST_CARD_MEM, &tmp)) {
+        throw std::runtime_error("ERROR: cThread::unpersistCardMem() - no persistent card memory named " + name);
     }
 }
 
-void cThread::invoke(CoyoteOper oper, localSg src_sg, localSg dst_sg, bool last) {
-    // Argument checks
-    DBG1(
-        "cThread: Call invoke for a two-sided local operation with source address " 
-        << src_sg.addr << ", source length " << src_sg.len << "destination address "
-        << dst_sg.addr << ", destination length " << dst_sg.len
-    );
+int cThread::exportP2PWindow() {
+    DBG1("cThread: Called exportP2PWindow");
 
-    if (!(isLocalRead(oper) && isLocalWrite(oper))) {
-        throw std::runtime_error("ERROR: cThread::invoke() called with two localSg flags, but the operation is not a LOCAL_TRANSFER; exiting...");
+    uint64_t tmp[MAX_USER_ARGS];
+    if (ioctl(fd, IOCTL_EXPORT_P2P_WINDOW, &tmp)) {
+        throw std::runtime_error("ERROR: IOCTL_EXPORT_P2P_WINDOW failed");
     }
 
-    if (!fcnfg.en_strm && !fcnfg.en_mem) {
-        throw std::runtime_error("ERROR: cThread::invoke() called for a local operation but the shell was not synthesized with streams from host memory, exiting...");
+    return static_cast<int>(tmp[0]);
+}
+
+void* cThread::importP2PWindow(int dmabuf_fd) {
+    DBG1("cThread: Called importP2PWindow for dmabuf " << dmabuf_fd);
+
+    off_t size = lseek(dmabuf_fd, 0, SEEK_END);
+    if (size <= 0) {
+        throw std::runtime_error("ERROR: cThread::importP2PWindow() - the size of the dmabuf could not be obtained");
     }
 
-    if (src_sg.len > MAX_TRANSFER_SIZE || dst_sg.len > MAX_TRANSFER_SIZE) {
-        throw std::runtime_error("ERROR: cThread::invoke() - transfers over 128MB are currently not supported in Coyote, exiting...");
+    // The window is mapped at a reserved address range, so that it doesn't overlap with any buffer of this process
+    void *mem = mmap(NULL, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (mem == MAP_FAILED) {
+        throw std::runtime_error("ERROR: cThread::importP2PWindow() - Failed to reserve the address range for the window");
     }
 
-    // Trigger the operation
-    if (oper == CoyoteOper::LOCAL_TRANSFER) {
-        uint64_t ctrl_cmd_src =
-            ((ctid & CTRL_PID_MASK) << CTRL_PID_OFFS) |
-            ((src_sg.dest & CTRL_DEST_MASK) << CTRL_DEST_OFFS) |
-            (last ? CTRL_LAST : 0x0) |
-            ((src_sg.stream & CTRL_STRM_MASK) << CTRL_STRM_OFFS) | 
-            (CTRL_START) | 
-            (0x0) | 
-            (static_cast<uint64_t>(src_sg.len) << CTRL_LEN_OFFS);
-
-        uint64_t ctrl_cmd_dst =
-            ((ctid & CTRL_PID_MASK) << CTRL_PID_OFFS) |
-            ((dst_sg.dest & CTRL_DEST_MASK) << CTRL_DEST_OFFS) |
-            (last ? CTRL_LAST : 0x0) |
-            ((dst_sg.stream & CTRL_STRM_MASK) << CTRL_STRM_OFFS) | 
-            (CTRL_START) | 
-            (0x0) | 
-            (static_cast<uint64_t>(dst_sg.len) << CTRL_LEN_OFFS);
-
-        uint64_t addr_cmd_src = reinterpret_cast<uint64_t>(src_sg.addr);
-        uint64_t addr_cmd_dst = reinterpret_cast<uint64_t>(dst_sg.addr);
-
-        postCmd(addr_cmd_dst, ctrl_cmd_dst, addr_cmd_src, ctrl_cmd_src);
+    uint64_t tmp[MAX_USER_ARGS];
+    tmp[0] = static_cast<uint64_t>(dmabuf_fd);
+    tmp[1] = reinterpret_cast<uint64_t>(mem);
+    tmp[2] = static_cast<uint64_t>(ctid);
+    tmp[3] = static_cast<uint64_t>(-1);
+    if (ioctl(fd, IOCTL_MAP_DMABUF, &tmp)) {
+        munmap(mem, size);
+        throw std::runtime_error("ERROR: IOCTL_MAP_DMABUF failed; do both cards support peer-to-peer DMA?");
+    }
 
-    } else {
-        std::cerr << "ERROR: cThread::invoke() called with an unsupported operation type; returning..." << std::endl;
-        return;
+    CoyoteAlloc alloc;
+    alloc.alloc = CoyoteAllocType::PEER;
+    alloc.size = size;
+    alloc.mem = mem;
+    mapped_pages.emplace(mem, alloc);
+    mapped_regions[reinterpret_cast<uint64_t>(mem)] = reinterpret_cast<uint64_t>(mem) + size;
+
+    return mem;
+}
+
+void cThread::syncCardMem(void *host_mem, void *card_mem, uint64_t size) {
+    DBG1("cThread: Called syncCardMem from card buffer " << card_mem << " to host buffer " << host_mem << ", size " << size);
+    copyCardMem(card_mem, host_mem, size, false);
+}
+
+void cThread::offloadCardMem(void *card_mem, void *host_mem, uint64_t size) {
+    DBG1("cThread: Called offloadCardMem from host buffer " << host_mem << " to card buffer " << card_mem << ", size " << size);
+    copyCardMem(card_mem, host_mem, size, true);
+}
+
+void cThread::copyCardMem(void *card_mem, void *host_mem, uint64_t size, bool to_card) {
+    const CoyoteAlloc *card_alloc = getAlloc(card_mem);
+    if (!card_alloc || card_alloc->alloc != CoyoteAllocType::CARD) {
+        throw std::runtime_error("ERROR: cThread::copyCardMem() - the card buffer was not obtained with CoyoteAllocType::CARD");
+    }
+    if (!isMapped(host_mem, size)) {
+        throw std::runtime_error("ERROR: cThread::copyCardMem() - the host buffer is not mapped in the vFPGA's TLB");
+    }
+
+    uint64_t tmp[MAX_USER_ARGS];
+    tmp[0] = reinterpret_cast<uint64_t>(card_mem);
+    tmp[1] = reinterpret_cast<uint64_t>(host_mem);
+    tmp[2] = size;
+    tmp[3] = static_cast<uint64_t>(ctid);
+    tmp[4] = to_card ? 0 : 1;   // Destination; CARD_ACCESS or HOST_ACCESS in the driver
+    if (ioctl(fd, IOCTL_COPY_CARD_MEM, &tmp)) {
+        throw std::runtime_error("ERROR: IOCTL_COPY_CARD_MEM failed; are the buffers page-aligned?");
     }
 }
 
-void cThread::invoke(CoyoteOper oper, rdmaSg sg, bool last) {
-    // Argument checks
-    DBG1("cThread: Call invoke for a RDMA operation with length " << sg.len);
+bool cThread::isMapped(const void *vaddr, uint64_t len) const {
+    // Find the last region starting at or before vaddr and check it also covers the end of the buffer
+    uint64_t start = reinterpret_cast<uint64_t>(vaddr);
+    auto it = mapped_regions.upper_bound(start);
+    if (it == mapped_regions.begin()) {
+        return false;
+    }
+    --it;
+    return start + len <= it->second;
+}
 
-    if (!isRemoteRdma(oper)) {
-        throw std::runtime_error("ERROR: cThread::invoke() called with rdmaSg flags, but the operation is not a REMOTE_READ or REMOTE_WRITE; exiting...");
+const CoyoteAlloc* cThread::getAlloc(const void *vaddr) const {
+    auto it = mapped_pages.upper_bound(const_cast<void*>(vaddr));
+    if (it == mapped_pages.begin()) {
+        return nullptr;
+    }
+    --it;
+    if (reinterpret_cast<uint64_t>(vaddr) >= reinterpret_cast<uint64_t>(it->first) + it->second.size) {
+        return nullptr;
     }
+    return &it->second;
+}
 
-    if (!fcnfg.en_rdma) {
-        throw std::runtime_error("ERROR: cThread::invoke() called for an RDMA operation but the shell was not synthesized with RDMA support, exiting...");
+void cThread::setCSR(uint64_t val, uint32_t offs) {
+    ctrl_reg[offs] = val; 
+}
+
+uint64_t cThread::getCSR(uint32_t offs) const {
+    return ctrl_reg[offs];
+}
+
+/// Whether csrs[i..i+3] are four consecutive registers starting at a 32 B boundary, i.e., a single 256-bit ctrl access
+static inline bool isCSRQuad(const std::vector<std::pair<uint32_t, uint64_t>> &csrs, size_t i) {
+    if (i + 4 > csrs.size() || csrs[i].first % 4 != 0) {
+        return false;
+    }
+    for (size_t j = 1; j < 4; j++) {
+        if (csrs[i + j].first != csrs[i].first + j) {
+            return false;
+        }
     }
+    return true;
+}
 
-    if (sg.len > MAX_TRANSFER_SIZE) {
-        throw std::runtime_error("ERROR: cThread::invoke() - transfers over 128MB are currently not supported in Coyote, exiting...");
+static inline void checkCSRs(const std::vector<std::pair<uint32_t, uint64_t>> &csrs, const char *fn) {
+    for (const auto &csr : csrs) {
+        if (csr.first >= N_CTRL_REGS) {
+            throw std::runtime_error(std::string("ERROR: cThread::") + fn + "() called with CSR offset " + std::to_string(csr.first) + " outside of the control region, exiting...");
+        }
     }
+}
 
-    // Trigger the operation
-    if (qpair->local.ip_addr == qpair->remote.ip_addr) {
-        DBG1("cThread: remote and local node for RDMA operation are identical; calling memcpy");
-        
-        void *local_addr = (void*) ((uint64_t) qpair->local.vaddr + sg.local_offs);
-        void *remote_addr = (void*) ((uint64_t) qpair->remote.vaddr + sg.remote_offs);
-        memcpy(remote_addr, local_addr, sg.len);
+void cThread::setCSRs(const std::vector<std::pair<uint32_t, uint64_t>> &csrs) {
+    checkCSRs(csrs, "setCSRs");
 
-    } else {
-        // Local command and address
-        uint64_t ctrl_cmd_l =
-            (((static_cast<uint64_t>(oper) - REMOTE_OFFS_OPS) & CTRL_OPCODE_MASK) << CTRL_OPCODE_OFFS) |
-            ((ctid & CTRL_PID_MASK) << CTRL_PID_OFFS) |
-            ((sg.local_dest & CTRL_DEST_MASK) << CTRL_DEST_OFFS) |
-            (last ? CTRL_LAST : 0x0) |
-            ((sg.local_stream & CTRL_STRM_MASK) << CTRL_STRM_OFFS) | 
-            (0x0) | 
-            (static_cast<uint64_t>(sg.len) << CTRL_LEN_OFFS);
-        
-        uint64_t addr_cmd_l = static_cast<uint64_t>((uint64_t) qpair->local.vaddr + sg.local_offs);
+    size_t i = 0;
+    while (i < csrs.size()) {
+        #ifdef EN_AVX
+        if (fcnfg.en_avx && isCSRQuad(csrs, i)) {
+            _mm256_store_si256(
+                (__m256i*) &ctrl_reg[csrs[i].first], 
+                _mm256_set_epi64x(csrs[i + 3].second, csrs[i + 2].second, csrs[i + 1].second, csrs[i].second)
+            );
+            i += 4;
+            continue;
+        }
+        #endif
+        ctrl_reg[csrs[i].first] = csrs[i].second;
+        i++;
+    }
+}
+
+void cThread::getCSRs(std::vector<std::pair<uint32_t, uint64_t>> &csrs) const {
+    checkCSRs(csrs, "getCSRs");
+
+    size_t i = 0;
+    while (i < csrs.size()) {
+        #ifdef EN_AVX
+        if (fcnfg.en_avx && isCSRQuad(csrs, i)) {
+            alignas(32) uint64_t vals[4];
+            _mm256_store_si256((__m256i*) vals, _mm256_load_si256((const __m256i*) &ctrl_reg[csrs[i].first]));
+            for (size_t j = 0; j < 4; j++) {
+                csrs[i + j].second = vals[j];
+            }
+            i += 4;
+            continue;
+        }
+        #endif
+        csrs[i].second = ctrl_reg[csrs[i].first];
+        i++;
+    }
+}
+
+csrWindow cThread::mapCSRs(uint32_t base, uint32_t n_regs) {
+    if (base >= N_CTRL_REGS || n_regs > N_CTRL_REGS - base) {
+        throw std::runtime_error("ERROR: cThread::mapCSRs() called with a window outside of the control region, exiting...");
+    }
+    return csrWindow(this, ctrl_reg + base, base, n_regs);
+}
+
+/// Names of the operations in the trace, indexed by CoyoteOper
+static const char *const TRACE_OPER_NAMES[] = {
+    "NOOP", "LOCAL_READ", "LOCAL_WRITE", "LOCAL_TRANSFER", "LOCAL_OFFLOAD", "LOCAL_SYNC",
+    "REMOTE_RDMA_READ", "REMOTE_RDMA_WRITE", "REMOTE_RDMA_SEND", "REMOTE_TCP_SEND", "LOCAL_CARD_COPY"
+};
+
+static inline const char* traceName(CoyoteOper oper) { return TRACE_OPER_NAMES[static_cast<int>(oper)]; }
+
+/// Index of a sync/off-load in cThread::sync_submitted and cThread::sync_completed
+static inline int syncIdx(CoyoteOper oper) { return oper == CoyoteOper::LOCAL_OFFLOAD ? 0 : 1; }
+
+void cThread::invoke(CoyoteOper oper, syncSg sg) {
+    DBG1("cThread: Call invoke for a sync/offload operation with address " << sg.addr << ", length " << sg.len);
+
+    // Argument checks
+    if (!isLocalSync(oper)) {
+        throw std::runtime_error("ERROR: cThread::invoke() called with syncSg flags, but the operation is not a LOCAL_SYNC or LOCAL_OFFLOAD; exiting...");
+    }
+
+    // On cache-coherent platforms without card memory, the vFPGA accesses the buffers in host memory directly; there is nothing to migrate
+    if (fcnfg.coherent && !fcnfg.en_mem) {
+        return;
+    }
 
-        // Remote command and address
-        uint64_t ctrl_cmd_r =                    
-            (((static_cast<uint64_t>(oper) - REMOTE_OFFS_OPS) & CTRL_OPCODE_MASK) << CTRL_OPCODE_OFFS) |
-            ((ctid & CTRL_PID_MASK) << CTRL_PID_OFFS) |
-            ((sg.remote_dest & CTRL_DEST_MASK) << CTRL_DEST_OFFS) |
-            (last ? CTRL_LAST : 0x0) |
-            ((STRM_RDMA & CTRL_STRM_MASK) << CTRL_STRM_OFFS) | 
-            (CTRL_START) |
-            (0x0) | 
-            (static_cast<uint64_t>(sg.len) << CTRL_LEN_OFFS);
+    if (!fcnfg.en_mem) {
+        throw std::runtime_error("ERROR: cThread::invoke() called for a sync/offload operation,but the shell was not synthesized with card memory support, exiting...");
+    }
 
-        uint64_t addr_cmd_r = static_cast<uint64_t>((uint64_t) qpair->remote.vaddr + sg.remote_offs); 
+    cTraceScope trace("cThread", traceName(oper), "len", sg.len, "ctid", ctid);
 
-        // Order - based on the distinction between Read and Write, determine what is source and what is destination 
-        uint64_t ctrl_cmd_src = isRemoteRead(oper) ? ctrl_cmd_r : ctrl_cmd_l;
-        uint64_t addr_cmd_src = isRemoteRead(oper) ? addr_cmd_r : addr_cmd_l;
-        uint64_t ctrl_cmd_dst = isRemoteRead(oper) ? ctrl_cmd_l : ctrl_cmd_r;
-        uint64_t addr_cmd_dst = isRemoteRead(oper) ? addr_cmd_l : addr_cmd_r;
+    // If there are asynchronous requests, queue the request behind them (to preserve ordering) and wait for it
+    std::unique_lock<std::mutex> guard(sync_lock);
+    if (sync_running) {
+        guard.unlock();
+        uint32_t ticket = invokeAsync(oper, sg);
 
-        postCmd(addr_cmd_dst, ctrl_cmd_dst, addr_cmd_src, ctrl_cmd_src);
+        guard.lock();
+        sync_cv.wait(guard, [&] { return sync_completed[syncIdx(oper)] >= ticket; });
+        if (sync_error) {
+            std::exception_ptr err = sync_error;
+            sync_error = nullptr;
+            std::rethrow_exception(err);
+        }
+        return;
     }
+    guard.unlock();
+
+    sync_submitted[syncIdx(oper)]++;
+    issueSync(oper, sg);
+    sync_completed[syncIdx(oper)]++;
 }
 
-void cThread::invoke(CoyoteOper oper, tcpSg sg, bool last) {
+uint32_t cThread::invokeAsync(CoyoteOper oper, syncSg sg) {
+    DBG1("cThread: Call invokeAsync for a sync/offload operation with address " << sg.addr << ", length " << sg.len);
+
     // Argument checks
-    DBG1("cThread: Call invoke for a TCP operation with length " << sg.len);
+    if (!isLocalSync(oper)) {
+        throw std::runtime_error("ERROR: cThread::invokeAsync() called with syncSg flags, but the operation is not a LOCAL_SYNC or LOCAL_OFFLOAD; exiting...");
+    }
 
-    if (!isRemoteTcp(oper)) {
-        throw std::runtime_error("ERROR: cThread::invoke() called with tcpSg flags, but the operation is not a TCP_SEND; exiting...");
+    // As in invoke(), there is nothing to migrate on cache-coherent platforms without card memory; the request completes right away
+    // Nothing is ever queued in this case, so the completion counter can't overtake an outstanding request
+    if (fcnfg.coherent && !fcnfg.en_mem) {
+        std::lock_guard<std::mutex> guard(sync_lock);
+        sync_completed[syncIdx(oper)] = ++sync_submitted[syncIdx(oper)];
+        return sync_completed[syncIdx(oper)];
     }
 
-    if (!fcnfg.en_tcp) {
-        throw std::runtime_error("ERROR: cThread::invoke() called for a TCP operation, but the shell was not synthesized with TCP support, exiting...");
+    if (!fcnfg.en_mem) {
+        throw std::runtime_error("ERROR: cThread::invokeAsync() called for a sync/offload operation,but the shell was not synthesized with card memory support, exiting...");
     }
 
-    if (sg.len > MAX_TRANSFER_SIZE) {
-        throw std::runtime_error("ERROR: cThread::invoke() - transfers over 128MB are currently not supported in Coyote, exiting...");
+    std::lock_guard<std::mutex> guard(sync_lock);
+    if (sync_error) {
+        std::exception_ptr err = sync_error;
+        sync_error = nullptr;
+        std::rethrow_exception(err);
     }
 
-    // Trigger the operation
-    uint64_t ctrl_cmd_src = 0;
-    uint64_t ctrl_cmd_dst = 
-        ((ctid & CTRL_PID_MASK) << CTRL_PID_OFFS) |
-        ((sg.stream & CTRL_STRM_MASK) << CTRL_STRM_OFFS) | 
-        ((sg.dest & CTRL_DEST_MASK) << CTRL_DEST_OFFS) |
-        (last ? CTRL_LAST : 0x0) |
-        (CTRL_START) |
-        (static_cast<uint64_t>(sg.len) << CTRL_LEN_OFFS);
+    // Start the thread issuing the requests, if not running yet
+    if (!sync_running) {
+        sync_running = true;
+        sync_thread = std::thread(&cThread::processSyncs, this);
+    }
 
-    uint64_t addr_cmd_src = 0;
-    uint64_t addr_cmd_dst = 0;
+    sync_queue.emplace_back(oper, sg);
+    uint32_t ticket = ++sync_submitted[syncIdx(oper)];
+    sync_cv.notify_all();
 
-    postCmd(addr_cmd_dst, ctrl_cmd_dst, addr_cmd_src, ctrl_cmd_src);
+    return ticket;
 }
 
-uint32_t cThread::checkCompleted(CoyoteOper coper) const {
-    DBG1("cThread: Called checkCompleted");
-    /*
-     * The order of these if-else clauses is very important in this function
-     * LOCAL_TRANSFER are two-sided operations, which means isLocalRead and isLocalWrite
-     * will be true at the same time for LOCAL_TRANSFER operations.
-     * However, by definition, writes happen after reads, so if we check for reads first,
-     * it may return true before the write is actually completed. So here, we must check 
-     * for writes first, then reads, and finally remote operations.
-     */
-	if (isLocalWrite(coper)) {
+void cThread::processSyncs() {
+    cThreadConfig::apply(CoyoteThreadRole::SYNC, ctid);
+    std::unique_lock<std::mutex> guard(sync_lock);
+    while (true) {
+        sync_cv.wait(guard, [&] { return !sync_queue.empty() || !sync_running; });
+        
+        // Outstanding requests are drained before the thread stops
+        if (sync_queue.empty()) {
+            break;
+        }
+
+        std::pair<CoyoteOper, syncSg> req = sync_queue.front();
+        sync_queue.pop_front();
+
+        // The lock is not held while the request is processed, so that new requests can be submitted
+        guard.unlock();
+        std::exception_ptr err = nullptr;
+        try {
+            issueSync(req.first, req.second);
+        } catch (...) {
+            err = std::current_exception();
+        }
+        guard.lock();
+
+        if (err && !sync_error) {
+            sync_error = err;
+        }
+        sync_completed[syncIdx(req.first)]++;
+        sync_cv.notify_all();
+    }
+}
+
+void cThread::issueSync(CoyoteOper oper, syncSg sg) {
+    // Trigger the operation; the driver takes a 32-bit length, so large buffers are synced/off-loaded in chunks
+    for (uint64_t offs = 0; offs < sg.len || offs == 0; offs += MAX_TRANSFER_SIZE) {
+        uint64_t tmp[MAX_USER_ARGS];
+        tmp[0] = reinterpret_cast<uint64_t>(sg.addr) + offs;
+        tmp[1] = std::min<uint64_t>(sg.len - offs, MAX_TRANSFER_SIZE);
+        tmp[2] = ctid;
+        tmp[3] = sg.host_unchanged;
+
+        if (oper == CoyoteOper::LOCAL_OFFLOAD) {
+            if (ioctl(fd, IOCTL_OFFLOAD_REQ, &tmp)) {
+                throw std::runtime_error("ERROR: IOCTL_OFFLOAD_REQ failed");
+            }  
+        } else if (oper == CoyoteOper::LOCAL_SYNC) {
+            if (ioctl(fd, IOCTL_SYNC_REQ, &tmp)) {
+                throw std::runtime_error("ERROR: IOCTL_SYNC_REQ failed");
+            }
+        } else {
+            std::cerr << "ERROR: cThread::invoke() called with an unsupported operation type; returning..." << std::endl;
+            return;
+        }
+
+        if (sg.len == 0) {
+            break;
+        }
+    }
+}
+
+std::array<uint64_t, 4> cThread::localCmd(CoyoteOper oper, const localSg &sg, uint64_t offs, uint64_t len, bool last) const {
+    uint64_t ctrl_cmd =
+        ((ctid & CTRL_PID_MASK) << CTRL_PID_OFFS) |
+        ((sg.dest & CTRL_DEST_MASK) << CTRL_DEST_OFFS) |
+        (last ? CTRL_LAST : 0x0) |
+        ((sg.stream & CTRL_STRM_MASK) << CTRL_STRM_OFFS) | 
+        (CTRL_START) | 
+        (0x0) | 
+        (len << CTRL_LEN_OFFS);
+    
+    uint64_t addr_cmd = reinterpret_cast<uint64_t>(sg.addr) + offs;
+
+    if (isLocalWrite(oper)) {
+        return {addr_cmd, ctrl_cmd, 0, 0};
+    } else {
+        return {0, 0, addr_cmd, ctrl_cmd};
+    }
+}
+
+std::array<uint64_t, 4> cThread::rdmaCmd(CoyoteOper oper, const rdmaSg &sg, uint64_t offs, uint64_t len, bool last) const {
+    // The QP is selected by the Coyote thread ID in the commands
+    int32_t tid = qpCtid(sg.qp);
+
+    // Local command and address
+    uint64_t ctrl_cmd_l =
+        (((static_cast<uint64_t>(oper) - REMOTE_OFFS_OPS) & CTRL_OPCODE_MASK) << CTRL_OPCODE_OFFS) |
+        ((tid & CTRL_PID_MASK) << CTRL_PID_OFFS) |
+        ((sg.local_dest & CTRL_DEST_MASK) << CTRL_DEST_OFFS) |
+        (last ? CTRL_LAST : 0x0) |
+        ((sg.local_stream & CTRL_STRM_MASK) << CTRL_STRM_OFFS) | 
+        (0x0) | 
+        (len << CTRL_LEN_OFFS);
+    
+    uint64_t addr_cmd_l = localMrAddr(sg.qp, sg.local_mr) + sg.local_offs + offs;
+
+    // Remote command and address
+    uint64_t ctrl_cmd_r =                    
+        (((static_cast<uint64_t>(oper) - REMOTE_OFFS_OPS) & CTRL_OPCODE_MASK) << CTRL_OPCODE_OFFS) |
+        ((tid & CTRL_PID_MASK) << CTRL_PID_OFFS) |
+        ((sg.remote_dest & CTRL_DEST_MASK) << CTRL_DEST_OFFS) |
+        (last ? CTRL_LAST : 0x0) |
+        ((STRM_RDMA & CTRL_STRM_MASK) << CTRL_STRM_OFFS) | 
+        (CTRL_START) |
+        (0x0) | 
+        (len << CTRL_LEN_OFFS);
+
+    uint64_t addr_cmd_r = remoteMrAddr(sg.qp, sg.remote_mr) + sg.remote_offs + offs;
+
+    // Order - based on the distinction between Read and Write, determine what is source and what is destination 
+    if (isRemoteRead(oper)) {
+        return {addr_cmd_l, ctrl_cmd_l, addr_cmd_r, ctrl_cmd_r};
+    } else {
+        return {addr_cmd_r, ctrl_cmd_r, addr_cmd_l, ctrl_cmd_l};
+    }
+}
+
+void cThread::buildLocalCmds(std::vector<std::array<uint64_t, 4>> &cmds, CoyoteOper oper, const localSg &sg, bool last) const {
+    // Transfers over MAX_TRANSFER_SIZE are split into sub-descriptors; only the final one may carry the last flag, 
+    // so that the whole transfer is reported as one logical completion
+    uint64_t n_chunks = std::max<uint64_t>(1, (sg.len + MAX_TRANSFER_SIZE - 1) / MAX_TRANSFER_SIZE);
+    for (uint64_t i = 0; i < n_chunks; i++) {
+        uint64_t offs = i * MAX_TRANSFER_SIZE;
+        cmds.push_back(localCmd(oper, sg, offs, std::min<uint64_t>(sg.len - offs, MAX_TRANSFER_SIZE), last && (i == n_chunks - 1)));
+    }
+}
+
+void cThread::buildTransferCmds(std::vector<std::array<uint64_t, 4>> &cmds, const localSg &src_sg, const localSg &dst_sg, bool last) const {
+    // Split both sides independently and pair up the sub-descriptors; if one side has more chunks, the remaining ones are one-sided
+    std::vector<std::array<uint64_t, 4>> src_cmds, dst_cmds;
+    buildLocalCmds(src_cmds, CoyoteOper::LOCAL_READ, src_sg, last);
+    buildLocalCmds(dst_cmds, CoyoteOper::LOCAL_WRITE, dst_sg, last);
+
+    for (size_t i = 0; i < std::max(src_cmds.size(), dst_cmds.size()); i++) {
+        std::array<uint64_t, 4> cmd = {0, 0, 0, 0};
+        if (i < dst_cmds.size()) {
+            cmd[0] = dst_cmds[i][0];
+            cmd[1] = dst_cmds[i][1];
+        }
+        if (i < src_cmds.size()) {
+            cmd[2] = src_cmds[i][2];
+            cmd[3] = src_cmds[i][3];
+        }
+        cmds.push_back(cmd);
+    }
+}
+
+void cThread::buildRdmaCmds(std::vector<std::array<uint64_t, 4>> &cmds, CoyoteOper oper, const rdmaSg &sg, bool last) const {
+    uint64_t n_chunks = std::max<uint64_t>(1, (sg.len + MAX_TRANSFER_SIZE - 1) / MAX_TRANSFER_SIZE);
+    for (uint64_t i = 0; i < n_chunks; i++) {
+        uint64_t offs = i * MAX_TRANSFER_SIZE;
+        cmds.push_back(rdmaCmd(oper, sg, offs, std::min<uint64_t>(sg.len - offs, MAX_TRANSFER_SIZE), last && (i == n_chunks - 1)));
+    }
+}
+
+void cThread::invoke(CoyoteOper oper, localSg sg, bool last) {
+    // Argument checks
+    DBG1("cThread: Call invoke for a one-side local operation with address " << sg.addr << ", length " << sg.len);
+
+    if (!isLocalRead(oper) && !isLocalWrite(oper)) {
+        throw std::runtime_error("ERROR: cThread::invoke() called with localSg flags, but the operation is not a LOCAL_READ or LOCAL_WRITE; exiting...");
+    }
+
+    if (isLocalRead(oper) && isLocalWrite(oper)) {
+        std::cerr << "ERROR: cThread::invoke() called with an unsupported operation type; returning..." << std::endl;
+        return;
+    }
+
+    if (!fcnfg.en_strm && !fcnfg.en_mem) {
+        throw std::runtime_error("ERROR: cThread::invoke() called for a local operation, but the shell was not synthesized with streams from host memory, exiting...");
+    }
+
+    autoRegister(sg.addr, sg.len);
+
+    // Trigger the operation; large transfers are split into multiple sub-descriptors
+    cTraceScope trace("cThread", traceName(oper), "len", sg.len, "ctid", ctid);
+    if (sg.len <= MAX_TRANSFER_SIZE) {
+        std::array<uint64_t, 4> cmd = localCmd(oper, sg, 0, sg.len, last);
+        postCmd(cmd[0], cmd[1], cmd[2], cmd[3]);
+    } else {
+        std::vector<std::array<uint64_t, 4>> cmds;
+        buildLocalCmds(cmds, oper, sg, last);
+        postCmdBatch(cmds);
+    }
+}
+
+void cThread::invoke(CoyoteOper oper, localSg src_sg, localSg dst_sg, bool last) {
+    // Argument checks
+    DBG1(
+        "cThread: Call invoke for a two-sided local operation with source address " 
+        << src_sg.addr << ", source length " << src_sg.len << "destination address "
+        << dst_sg.addr << ", destination length " << dst_sg.len
+    );
+
+    if (!(isLocalRead(oper) && isLocalWrite(oper))) {
+        throw std::runtime_error("ERROR: cThread::invoke() called with two localSg flags, but the operation is not a LOCAL_TRANSFER; exiting...");
+    }
+
+    if (isLocalCardCopy(oper) && (src_sg.stream != STRM_CARD || dst_sg.stream != STRM_CARD)) {
+        throw std::runtime_error("ERROR: cThread::invoke() called for a LOCAL_CARD_COPY, but the source or destination is not in card memory; exiting...");
+    }
+
+    if (!fcnfg.en_strm && !fcnfg.en_mem) {
+        throw std::runtime_error("ERROR: cThread::invoke() called for a local operation but the shell was not synthesized with streams from host memory, exiting...");
+    }
+
+    autoRegister(src_sg.addr, src_sg.len);
+    autoRegister(dst_sg.addr, dst_sg.len);
+
+    // Trigger the operation; large transfers are split into multiple sub-descriptors
+    cTraceScope trace("cThread", traceName(oper), "len", src_sg.len, "ctid", ctid);
+    if (src_sg.len <= MAX_TRANSFER_SIZE && dst_sg.len <= MAX_TRANSFER_SIZE) {
+        std::array<uint64_t, 4> src_cmd = localCmd(CoyoteOper::LOCAL_READ, src_sg, 0, src_sg.len, last);
+        std::array<uint64_t, 4> dst_cmd = localCmd(CoyoteOper::LOCAL_WRITE, dst_sg, 0, dst_sg.len, last);
+        postCmd(dst_cmd[0], dst_cmd[1], src_cmd[2], src_cmd[3]);
+    } else {
+        std::vector<std::array<uint64_t, 4>> cmds;
+        buildTransferCmds(cmds, src_sg, dst_sg, last);
+        postCmdBatch(cmds);
+    }
+}
+
+void cThread::invoke(CoyoteOper oper, cardCopySg sg, bool last) {
+    // Argument checks
+    DBG1("cThread: Call invoke for a card copy from " << sg.src_addr << " to " << sg.dst_addr << ", length " << sg.len);
+
+    if (!isLocalCardCopy(oper)) {
+        throw std::runtime_error("ERROR: cThread::invoke() called with cardCopySg flags, but the operation is not a LOCAL_CARD_COPY; exiting...");
+    }
+
+    if (!fcnfg.en_mem) {
+        throw std::runtime_error("ERROR: cThread::invoke() called for a LOCAL_CARD_COPY, but the shell was not synthesized with card memory, exiting...");
+    }
+
+    // Card memory => axis_card_recv[dest] => axis_card_send[dest] => card memory
+    localSg src_sg = { .addr = sg.src_addr, .len = sg.len, .stream = STRM_CARD, .dest = sg.dest };
+    localSg dst_sg = { .addr = sg.dst_addr, .len = sg.len, .stream = STRM_CARD, .dest = sg.dest };
+    invoke(oper, src_sg, dst_sg, last);
+}
+
+void cThread::invoke(CoyoteOper oper, rdmaSg sg, bool last) {
+    // Argument checks
+    DBG1("cThread: Call invoke for a RDMA operation with length " << sg.len);
+
+    if (!isRemoteRdma(oper)) {
+        throw std::runtime_error("ERROR: cThread::invoke() called with rdmaSg flags, but the operation is not a REMOTE_READ or REMOTE_WRITE; exiting...");
+    }
+
+    if (!fcnfg.en_rdma) {
+        throw std::runtime_error("ERROR: cThread::invoke() called for an RDMA operation but the shell was not synthesized with RDMA support, exiting...");
+    }
+
+    // Trigger the operation
+    cTraceScope trace("cThread", traceName(oper), "len", sg.len, "qp", sg.qp);
+    ibvQp *qp = qpAt(sg.qp);
+    if (qp->local.ip_addr == qp->remote.ip_addr) {
+        DBG1("cThread: remote and local node for RDMA operation are identical; calling memcpy");
+        
+        void *local_addr = (void*) (localMrAddr(sg.qp, sg.local_mr) + sg.local_offs);
+        void *remote_addr = (void*) (remoteMrAddr(sg.qp, sg.remote_mr) + sg.remote_offs);
+        memcpy(remote_addr, local_addr, sg.len);
+
+    } else {
+        if (last && isRemoteWrite(oper)) {
+            paceRdma(sg.qp);
+        }
+
+        if (sg.len <= MAX_TRANSFER_SIZE) {
+            std::array<uint64_t, 4> cmd = rdmaCmd(oper, sg, 0, sg.len, last);
+            postCmd(cmd[0], cmd[1], cmd[2], cmd[3]);
+        } else {
+            std::vector<std::array<uint64_t, 4>> cmds;
+            buildRdmaCmds(cmds, oper, sg, last);
+            postCmdBatch(cmds);
+        }
+    }
+}
+
+void cThread::invoke(CoyoteOper oper, tcpSg sg, bool last) {
+    // Argument checks
+    DBG1("cThread: Call invoke for a TCP operation with length " << sg.len);
+
+    if (!isRemoteTcp(oper)) {
+        throw std::runtime_error("ERROR: cThread::invoke() called with tcpSg flags, but the operation is not a TCP_SEND; exiting...");
+    }
+
+    if (!fcnfg.en_tcp) {
+        throw std::runtime_error("ERROR: cThread::invoke() called for a TCP operation, but the shell was not synthesized with TCP support, exiting...");
+    }
+
+    if (sg.len > MAX_TRANSFER_SIZE) {
+        throw std::runtime_error("ERROR: cThread::invoke() - transfers over 128MB are currently not supported in Coyote, exiting...");
+    }
+
+    // Trigger the operation
+    cTraceScope trace("cThread", traceName(oper), "len", sg.len, "ctid", ctid);
+    uint64_t ctrl_cmd_src = 0;
+    uint64_t ctrl_cmd_dst = 
+        ((ctid & CTRL_PID_MASK) << CTRL_PID_OFFS) |
+        ((sg.stream & CTRL_STRM_MASK) << CTRL_STRM_OFFS) | 
+        ((sg.dest & CTRL_DEST_MASK) << CTRL_DEST_OFFS) |
+        (last ? CTRL_LAST : 0x0) |
+        (CTRL_START) |
+        (static_cast<uint64_t>(sg.len) << CTRL_LEN_OFFS);
+
+    uint64_t addr_cmd_src = 0;
+    uint64_t addr_cmd_dst = 0;
+
+    postCmd(addr_cmd_dst, ctrl_cmd_dst, addr_cmd_src, ctrl_cmd_src);
+}
+
+localPrep cThread::prepare(CoyoteOper oper, const localSg &sg, bool last) const {
+    DBG1("cThread: Call prepare for a one-sided local operation with address " << sg.addr << ", length " << sg.len);
+
+    if (!isLocalRead(oper) && !isLocalWrite(oper)) {
+        throw std::runtime_error("ERROR: cThread::prepare() called with localSg flags, but the operation is not a LOCAL_READ or LOCAL_WRITE; exiting...");
+    }
+
+    if (isLocalRead(oper) && isLocalWrite(oper)) {
+        throw std::runtime_error("ERROR: cThread::prepare() called with one localSg for a LOCAL_TRANSFER; exiting...");
+    }
+
+    if (!fcnfg.en_strm && !fcnfg.en_mem) {
+        throw std::runtime_error("ERROR: cThread::prepare() called for a local operation, but the shell was not synthesized with streams from host memory, exiting...");
+    }
+
+    // The length is left out of the command; it's added on every invoke
+    localPrep prep;
+    prep.oper = oper;
+    prep.cmd = localCmd(oper, sg, 0, 0, last);
+    prep.last = last;
+    if (isLocalRead(oper)) {
+        prep.src_sg = sg;
+    } else {
+        prep.dst_sg = sg;
+    }
+    return prep;
+}
+
+localPrep cThread::prepare(CoyoteOper oper, const localSg &src_sg, const localSg &dst_sg, bool last) const {
+    DBG1("cThread: Call prepare for a two-sided local operation with source address " << src_sg.addr << ", destination address " << dst_sg.addr);
+
+    if (!(isLocalRead(oper) && isLocalWrite(oper))) {
+        throw std::runtime_error("ERROR: cThread::prepare() called with two localSg flags, but the operation is not a LOCAL_TRANSFER; exiting...");
+    }
+
+    if (!fcnfg.en_strm && !fcnfg.en_mem) {
+        throw std::runtime_error("ERROR: cThread::prepare() called for a local operation but the shell was not synthesized with streams from host memory, exiting...");
+    }
+
+    localPrep prep;
+    prep.oper = oper;
+    std::array<uint64_t, 4> src_cmd = localCmd(CoyoteOper::LOCAL_READ, src_sg, 0, 0, last);
+    std::array<uint64_t, 4> dst_cmd = localCmd(CoyoteOper::LOCAL_WRITE, dst_sg, 0, 0, last);
+    prep.cmd = {dst_cmd[0], dst_cmd[1], src_cmd[2], src_cmd[3]};
+    prep.src_sg = src_sg;
+    prep.dst_sg = dst_sg;
+    prep.last = last;
+    return prep;
+}
+
+void cThread::invoke(const localPrep &prep) {
+    // Same as the offset-based invoke, but the two sides of a transfer can have different lengths
+    if (prep.src_sg.len > MAX_TRANSFER_SIZE || prep.dst_sg.len > MAX_TRANSFER_SIZE) {
+        invokePrepared(prep, 0, prep.src_sg.len, prep.dst_sg.len);
+        return;
+    }
+
+    std::array<uint64_t, 4> cmd = prep.cmd;
+    cmd[1] |= prep.dst_sg.len << CTRL_LEN_OFFS;
+    cmd[3] |= prep.src_sg.len << CTRL_LEN_OFFS;
+    pushCmd(cmd);
+    drainCmds();
+}
+
+void cThread::invoke(const localPrep &prep, uint64_t offs, uint64_t len) {
+    if (len > MAX_TRANSFER_SIZE) {
+        invokePrepared(prep, offs, len, len);
+        return;
+    }
+
+    // Only the words of the sides taking part in the operation are set; the others must stay zero
+    std::array<uint64_t, 4> cmd = prep.cmd;
+    if (isLocalWrite(prep.oper)) {
+        cmd[0] += offs;
+        cmd[1] |= len << CTRL_LEN_OFFS;
+    }
+    if (isLocalRead(prep.oper)) {
+        cmd[2] += offs;
+        cmd[3] |= len << CTRL_LEN_OFFS;
+    }
+    pushCmd(cmd);
+    drainCmds();
+}
+
+void cThread::invokePrepared(const localPrep &prep, uint64_t offs, uint64_t src_len, uint64_t dst_len) {
+    localSg src_sg = prep.src_sg, dst_sg = prep.dst_sg;
+    src_sg.addr = reinterpret_cast<void*>(reinterpret_cast<uint64_t>(src_sg.addr) + offs);
+    src_sg.len = src_len;
+    dst_sg.addr = reinterpret_cast<void*>(reinterpret_cast<uint64_t>(dst_sg.addr) + offs);
+    dst_sg.len = dst_len;
+
+    std::vector<std::array<uint64_t, 4>> cmds;
+    if (isLocalRead(prep.oper) && isLocalWrite(prep.oper)) {
+        buildTransferCmds(cmds, src_sg, dst_sg, prep.last);
+    } else {
+        buildLocalCmds(cmds, prep.oper, isLocalRead(prep.oper) ? src_sg : dst_sg, prep.last);
+    }
+    postCmdBatch(cmds);
+}
+
+void cThread::invokeLocalBatch(CoyoteOper oper, const localSg *sgs, size_t n) {
+    // Argument checks, for the complete batch before anything is issued
+    if (!isLocalRead(oper) && !isLocalWrite(oper)) {
+        throw std::runtime_error("ERROR: cThread::invokeBatch() called with localSg flags, but the operation is not a LOCAL_READ or LOCAL_WRITE; exiting...");
+    }
+
+    if (isLocalRead(oper) && isLocalWrite(oper)) {
+        throw std::runtime_error("ERROR: cThread::invokeBatch() does not support LOCAL_TRANSFER; exiting...");
+    }
+
+    if (!fcnfg.en_strm && !fcnfg.en_mem) {
+        throw std::runtime_error("ERROR: cThread::invokeBatch() called for a local operation, but the shell was not synthesized with streams from host memory, exiting...");
+    }
+
+    // Build the descriptors; only the final one carries the last flag
+    std::vector<std::array<uint64_t, 4>> cmds;
+    cmds.reserve(n);
+    for (size_t i = 0; i < n; i++) {
+        autoRegister(sgs[i].addr, sgs[i].len);
+        buildLocalCmds(cmds, oper, sgs[i], i == n - 1);
+    }
+
+    postCmdBatch(cmds);
+}
+
+void cThread::invokeBatch(CoyoteOper oper, const std::vector<localSg> &sgs) {
+    DBG1("cThread: Call invokeBatch for " << sgs.size() << " one-sided local operations");
+    invokeLocalBatch(oper, sgs.data(), sgs.size());
+}
+
+void cThread::invoke(CoyoteOper oper, const localSg *sgs, size_t n) {
+    DBG1("cThread: Call vectored invoke with " << n << " entries");
+
+    if (n == 0) {
+        return;
+    }
+
+    // All entries must be part of the same logical stream 
+    for (size_t i = 1; i < n; i++) {
+        if (sgs[i].dest != sgs[0].dest || sgs[i].stream != sgs[0].stream) {
+            throw std::runtime_error("ERROR: cThread::invoke() - all the entries of a vectored operation must target the same stream and dest, exiting...");
+        }
+    }
+
+    invokeLocalBatch(oper, sgs, n);
+}
+
+void cThread::invokeBatch(CoyoteOper oper, const std::vector<rdmaSg> &sgs) {
+    DBG1("cThread: Call invokeBatch for " << sgs.size() << " RDMA operations");
+
+    // Argument checks, for the complete batch before anything is issued
+    if (!isRemoteRdma(oper)) {
+        throw std::runtime_error("ERROR: cThread::invokeBatch() called with rdmaSg flags, but the operation is not a REMOTE_READ or REMOTE_WRITE; exiting...");
+    }
+
+    if (!fcnfg.en_rdma) {
+        throw std::runtime_error("ERROR: cThread::invokeBatch() called for an RDMA operation but the shell was not synthesized with RDMA support, exiting...");
+    }
+
+    // Identical local and remote node (decided per QP); same as in invoke(), fall back to memcpy
+    std::vector<bool> loopback(sgs.size());
+    size_t last_cmd = sgs.size();
+    for (size_t i = 0; i < sgs.size(); i++) {
+        ibvQp *qp = qpAt(sgs[i].qp);
+        loopback[i] = (qp->local.ip_addr == qp->remote.ip_addr);
+        if (!loopback[i]) {
+            last_cmd = i;
+        }
+    }
+
+    // Build the descriptors; only the final one carries the last flag
+    std::vector<std::array<uint64_t, 4>> cmds;
+    cmds.reserve(sgs.size());
+    for (size_t i = 0; i < sgs.size(); i++) {
+        if (loopback[i]) {
+            DBG1("cThread: remote and local node for RDMA operation are identical; calling memcpy");
+            void *local_addr = (void*) (localMrAddr(sgs[i].qp, sgs[i].local_mr) + sgs[i].local_offs);
+            void *remote_addr = (void*) (remoteMrAddr(sgs[i].qp, sgs[i].remote_mr) + sgs[i].remote_offs);
+            memcpy(remote_addr, local_addr, sgs[i].len);
+        } else {
+            buildRdmaCmds(cmds, oper, sgs[i], i == last_cmd);
+        }
+    }
+
+    if (!cmds.empty()) {
+        // The batch completes once, on the QP of its final operation
+        if (isRemoteWrite(oper)) {
+            paceRdma(sgs[last_cmd].qp);
+        }
+        postCmdBatch(cmds);
+    }
+}
+
+void cThread::invokeChain(CoyoteOper oper, const rdmaSg &tmpl, const std::vector<rdmaChainSg> &chain) {
+    DBG1("cThread: Call invokeChain for " << chain.size() << " RDMA operations on QP " << tmpl.qp);
+
+    // Argument checks, once for the complete chain
+    if (!isRemoteRdma(oper)) {
+        throw std::runtime_error("ERROR: cThread::invokeChain() called with rdmaChainSg flags, but the operation is not a REMOTE_READ or REMOTE_WRITE; exiting...");
+    }
+
+    if (!fcnfg.en_rdma) {
+        throw std::runtime_error("ERROR: cThread::invokeChain() called for an RDMA operation but the shell was not synthesized with RDMA support, exiting...");
+    }
+
+    if (chain.empty()) {
+        return;
+    }
+
+    // Identical local and remote node; same as in invoke(), fall back to memcpy
+    ibvQp *qp = qpAt(tmpl.qp);
+    if (qp->local.ip_addr == qp->remote.ip_addr) {
+        DBG1("cThread: remote and local node for RDMA operation are identical; calling memcpy");
+        uint64_t local_base = localMrAddr(tmpl.qp, tmpl.local_mr);
+        uint64_t remote_base = remoteMrAddr(tmpl.qp, tmpl.remote_mr);
+        for (const rdmaChainSg &elem : chain) {
+            if (isRemoteRead(oper)) {
+                memcpy((void*) (local_base + elem.local_offs), (void*) (remote_base + elem.remote_offs), elem.len);
+            } else {
+                memcpy((void*) (remote_base + elem.remote_offs), (void*) (local_base + elem.local_offs), elem.len);
+            }
+        }
+        return;
+    }
+
+    // Build the descriptors; only the final one carries the last flag
+    rdmaSg sg = tmpl;
+    chain_cmds.clear();
+    for (size_t i = 0; i < chain.size(); i++) {
+        sg.local_offs = chain[i].local_offs;
+        sg.remote_offs = chain[i].remote_offs;
+        sg.len = chain[i].len;
+        buildRdmaCmds(chain_cmds, oper, sg, i == chain.size() - 1);
+    }
+
+    if (isRemoteWrite(oper)) {
+        paceRdma(tmpl.qp);
+    }
+    postCmdBatch(chain_cmds);
+}
+
+void cThread::paceRdma(uint32_t qp) {
+    if (pacing_mode == CoyotePacing::NONE) {
+        return;
+    }
+
+    // The QPs before this one exist as well, since QP indices are contiguous
+    while (pacing.size() <= qp) {
+        qpPacing state;
+        state.window = pacing_max_window;
+        state.completed = checkCompleted(CoyoteOper::REMOTE_RDMA_WRITE, (uint32_t) pacing.size());
+        state.retrans = net_retrans;
+        pacing.push_back(state);
+    }
+
+    updatePacing(qp);
+    while (pacing[qp].in_flight.size() >= (size_t) pacing[qp].window) {
+        backOff();
+        updatePacing(qp);
+    }
+
+    pacing[qp].in_flight.push_back(std::chrono::steady_clock::now());
+}
+
+void cThread::updatePacing(uint32_t qp) {
+    qpPacing &state = pacing[qp];
+    auto now = std::chrono::steady_clock::now();
+
+    // Retire the completed writes, oldest first; the counter also includes the writes and sends which were not paced, hence the bound
+    uint32_t completed = checkCompleted(CoyoteOper::REMOTE_RDMA_WRITE, qp);
+    size_t n_completed = std::min((size_t) (completed - state.completed), state.in_flight.size());
+    state.completed = completed;
+
+    for (size_t i = 0; i < n_completed; i++) {
+        double rtt = std::chrono::duration<double, std::micro>(now - state.in_flight.front()).count();
+        state.in_flight.pop_front();
+
+        if (pacing_mode == CoyotePacing::ADAPTIVE) {
+            state.srtt = state.srtt ? 0.875 * state.srtt + 0.125 * rtt : rtt;
+            state.min_rtt = state.min_rtt ? std::min(state.min_rtt, rtt) : rtt;
+            state.window = std::min(state.window + 1.0 / state.window, (double) pacing_max_window);
+        }
+    }
+
+    if (pacing_mode != CoyotePacing::ADAPTIVE) {
+        return;
+    }
+
+    // Congestion: either the RTT grew well beyond its minimum (queueing in the network), or the network stack retransmitted
+    bool congested = state.srtt > RDMA_PACING_RTT_FACTOR * state.min_rtt;
+
+    if (now - net_stats_time >= RDMA_PACING_STATS_INTERVAL) {
+        unsigned long stats[N_NET_STAT_REGS];
+        if (!ioctl(fd, IOCTL_NET_STATS, &stats)) {
+            net_retrans = HIGH_32(stats[NET_STAT_RETRANS_REG]);
+        }
+        net_stats_time = now;
+    }
+    if (state.retrans != net_retrans) {
+        congested = true;
+        state.retrans = net_retrans;
+    }
+
+    if (congested && now - state.last_decrease >= std::chrono::duration<double, std::micro>(state.srtt)) {
+        DBG2("cThread: congestion on QP " << qp << ", halving the pacing window from " << state.window);
+        state.window = std::max(state.window / 2, 1.0);
+        state.last_decrease = now;
+    }
+}
+
+uint32_t cThread::readCompleted(CoyoteOper coper, int32_t tid) const {
+    /*
+     * The order of these if-else clauses is very important in this function
+     * LOCAL_TRANSFER are two-sided operations, which means isLocalRead and isLocalWrite
+     * will be true at the same time for LOCAL_TRANSFER operations.
+     * However, by definition, writes happen after reads, so if we check for reads first,
+     * it may return true before the write is actually completed. So here, we must check 
+     * for writes first, then reads, and finally remote operations.
+     */
+	if (isLocalWrite(coper)) {
 		if (fcnfg.en_wb) {
-            return wback[ctid + WR_WBACK * N_CTID_MAX];
+            return wback[tid + WR_WBACK * N_CTID_MAX];
 		} else {
             #ifdef EN_AVX
 			if (fcnfg.en_avx) 
-				return _mm256_extract_epi32(cnfg_reg_avx[static_cast<uint32_t>(CnfgAvxRegs::STAT_DMA_REG) + ctid], 1);
+				return _mm256_extract_epi32(cnfg_reg_avx[static_cast<uint32_t>(CnfgAvxRegs::STAT_DMA_REG) + tid], 1);
 			else
             #endif
-				return (HIGH_32(cnfg_reg[static_cast<uint32_t>(CnfgLegRegs::STAT_DMA_REG) + ctid]));
+				return (HIGH_32(cnfg_reg[static_cast<uint32_t>(CnfgLegRegs::STAT_DMA_REG) + tid]));
 		}
 	} else if (isLocalRead(coper)) {
 		if (fcnfg.en_wb) {
-			return wback[ctid + RD_WBACK * N_CTID_MAX];
+			return wback[tid + RD_WBACK * N_CTID_MAX];
 		} else {
             #ifdef EN_AVX
 			if (fcnfg.en_avx)
-            	return _mm256_extract_epi32(cnfg_reg_avx[static_cast<uint32_t>(CnfgAvxRegs::STAT_DMA_REG) + ctid], 0);
+            	return _mm256_extract_epi32(cnfg_reg_avx[static_cast<uint32_t>(CnfgAvxRegs::STAT_DMA_REG) + tid], 0);
 			else 
             #endif
-				return (LOW_32(cnfg_reg[static_cast<uint32_t>(CnfgLegRegs::STAT_DMA_REG) + ctid]));
+				return (LOW_32(cnfg_reg[static_cast<uint32_t>(CnfgLegRegs::STAT_DMA_REG) + tid]));
 		}
 	} else if (isRemoteRead(coper)) {
 		if (fcnfg.en_wb) {
-			return wback[ctid + RD_RDMA_WBACK*N_CTID_MAX];
+			return wback[tid + RD_RDMA_WBACK*N_CTID_MAX];
 		} else {
             #ifdef EN_AVX
 			if (fcnfg.en_avx) 
-				return _mm256_extract_epi32(cnfg_reg_avx[static_cast<uint32_t>(CnfgAvxRegs::STAT_DMA_REG) + ctid], 2);
+				return _mm256_extract_epi32(cnfg_reg_avx[static_cast<uint32_t>(CnfgAvxRegs::STAT_DMA_REG) + tid], 2);
 			else 
             #endif
-				return (LOW_32(cnfg_reg[static_cast<uint32_t>(CnfgLegRegs::STAT_RDMA_REG) + ctid]));
+				return (LOW_32(cnfg_reg[static_cast<uint32_t>(CnfgLegRegs::STAT_RDMA_REG) + tid]));
 		}
 	} else if (isRemoteWriteOrSend(coper)) {
         if (fcnfg.en_wb) {
-            return wback[ctid + WR_RDMA_WBACK*N_CTID_MAX];
+            return wback[tid + WR_RDMA_WBACK*N_CTID_MAX];
         } else {
             #ifdef EN_AVX
             if (fcnfg.en_avx) 
-                return _mm256_extract_epi32(cnfg_reg_avx[static_cast<uint32_t>(CnfgAvxRegs::STAT_DMA_REG) + ctid], 3);
+                return _mm256_extract_epi32(cnfg_reg_avx[static_cast<uint32_t>(CnfgAvxRegs::STAT_DMA_REG) + tid], 3);
             else
             #endif
-                return (HIGH_32(cnfg_reg[static_cast<uint32_t>(CnfgLegRegs::STAT_RDMA_REG) + ctid]));  
+                return (HIGH_32(cnfg_reg[static_cast<uint32_t>(CnfgLegRegs::STAT_RDMA_REG) + tid]));  
         }
     } else {
         return 0;
     }
 }
 
-void cThread::clearCompleted() {
-    DBG1("cThread: Called clearCompleted"); 
-    
-    if (fcnfg.en_wb) {
-        for (int i = 0; i < N_WBACKS; i++) {
-            wback[ctid + i * N_CTID_MAX] = 0;
-        }
-    }
+volatile uint32_t *cThread::wbackSlot(CoyoteOper coper, int32_t tid) const {
+    // Same order as readCompleted(); writes first, since LOCAL_TRANSFER is both a read and a write
+    if (!fcnfg.en_wb) {
+        return nullptr;
+    } else if (isLocalWrite(coper)) {
+        return &wback[tid + WR_WBACK * N_CTID_MAX];
+    } else if (isLocalRead(coper)) {
+        return &wback[tid + RD_WBACK * N_CTID_MAX];
+    } else if (isRemoteRead(coper)) {
+        return &wback[tid + RD_RDMA_WBACK * N_CTID_MAX];
+    } else if (isRemoteWriteOrSend(coper)) {
+        return &wback[tid + WR_RDMA_WBACK * N_CTID_MAX];
+    } else {
+        return nullptr;
+    }
+}
+
+uint32_t cThread::checkCompleted(CoyoteOper coper) const {
+    DBG1("cThread: Called checkCompleted");
+
+    // Syncs and off-loads are tracked by the software, since they are issued through the driver
+    if (isLocalSync(coper)) {
+        return sync_completed[syncIdx(coper)];
+    }
+    return readCompleted(coper, ctid);
+}
+
+uint32_t cThread::checkCompleted(CoyoteOper coper, uint32_t qp) const {
+    DBG1("cThread: Called checkCompleted for QP " << qp);
+
+    if (!isRemoteRdma(coper)) {
+        throw std::runtime_error("ERROR: cThread::checkCompleted() called with a QP, but the operation is not an RDMA operation");
+    }
+    return readCompleted(coper, qpCtid(qp));
+}
+
+bool cThread::waitCompleted(CoyoteOper coper, uint32_t target, std::chrono::nanoseconds timeout, std::chrono::nanoseconds spin) const {
+    DBG1("cThread: Called waitCompleted with target " << target);
+    cTraceScope trace("cThread", "waitCompleted", "target", target, "ctid", ctid);
+
+    auto start = std::chrono::steady_clock::now();
+    #ifdef EN_AVX
+    volatile uint32_t *slot = isLocalSync(coper) || !hasWaitpkg() ? nullptr : wbackSlot(coper, ctid);
+    #endif
+
+    while (true) {
+        #ifdef EN_AVX
+        // The monitor is armed before the counter is read, so a write in between still ends the umwait
+        if (slot) {
+            umonitorLine(slot);
+        }
+        #endif
+        uint32_t completed = checkCompleted(coper);
+        if (completed >= target) {
+            if (cTracer::enabled()) {
+                cTracer::counter("cThread", traceName(coper), ctid, completed);
+            }
+            return true;
+        }
+
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        if (timeout.count() >= 0 && elapsed >= timeout) {
+            return false;
+        }
+
+        if (elapsed < spin) {
+            #ifdef EN_AVX
+            if (slot) {
+                umwaitLine(__rdtsc() + UMWAIT_TICKS);
+            } else {
+                _mm_pause();
+            }
+            #endif
+        } else {
+            std::this_thread::sleep_for(std::chrono::nanoseconds(SLEEP_TIME));
+        }
+    }
+}
+
+void cThread::clearCompleted() {
+    DBG1("cThread: Called clearCompleted"); 
+
+    for (int i = 0; i < 2; i++) {
+        sync_submitted[i] = 0;
+        sync_completed[i] = 0;
+    }
+
+    clearCounters(ctid);
+    for (const auto &extra : extra_qpairs) {
+        clearCounters(extra.first);
+    }
+
+    for (qpPacing &state : pacing) {
+        state.completed = 0;
+        state.in_flight.clear();
+    }
+}
+
+void cThread::clearCounters(int32_t tid) {
+    if (fcnfg.en_wb) {
+        for (int i = 0; i < N_WBACKS; i++) {
+            wback[tid + i * N_CTID_MAX] = 0;
+        }
+    }
+
+    #ifdef EN_AVX
+	if (fcnfg.en_avx) {
+		cnfg_reg_avx[static_cast<uint32_t>(CnfgAvxRegs::CTRL_REG)] = _mm256_set_epi64x(0, CTRL_CLR_STAT | ((tid & CTRL_PID_MASK) << CTRL_PID_OFFS), 0, CTRL_CLR_STAT | ((tid & CTRL_PID_MASK) << CTRL_PID_OFFS));
+    } else {
+    #endif
+        cnfg_reg[static_cast<uint32_t>(CnfgLegRegs::CTRL_REG_2)] = CTRL_CLR_STAT | ((tid & CTRL_PID_MASK) << CTRL_PID_OFFS);
+        cnfg_reg[static_cast<uint32_t>(CnfgLegRegs::CTRL_REG)] = CTRL_CLR_STAT | ((tid & CTRL_PID_MASK) << CTRL_PID_OFFS);
+    #ifdef EN_AVX
+    }
+    #endif
+}
+
+void cThread::doArpLookup(uint32_t ip_addr) {
+    DBG3("cThread: Called doArpLookup for IP address " << ip_addr); 
+
+    bool issue;
+    std::chrono::nanoseconds wait = neighLookup(ip_addr, issue);
+    if (issue) {
+        writeArpReg(ip_addr);
+    }
+    std::this_thread::sleep_for(wait);
+}
+
+std::chrono::nanoseconds cThread::neighLookup(uint32_t ip_addr, bool &issue) {
+    uint64_t tmp[2];
+    tmp[0] = ip_addr;
+    if (ioctl(fd, IOCTL_NEIGH_LOOKUP, &tmp)) {
+        // Driver without a neighbor table; always look the address up
+        issue = true;
+        return std::chrono::microseconds(SLEEP_TIME);
+    }
+
+    issue = tmp[0];
+    return std::chrono::nanoseconds(tmp[1]);
+}
+
+void cThread::writeArpReg(uint32_t ip_addr) {
+    #ifdef EN_AVX
+    if (fcnfg.en_avx) {
+        cnfg_reg_avx[static_cast<uint32_t>(CnfgAvxRegs::NET_ARP_REG)] = _mm256_set_epi64x(0, 0, 0, ip_addr);
+    } else {
+    #endif
+        cnfg_reg[static_cast<uint32_t>(CnfgLegRegs::NET_ARP_REG)] = ip_addr;
+    #ifdef EN_AVX
+    }
+    #endif
+}
+
+#ifdef EN_TCP_EXPERIMENTAL
+bool cThread::tcpListen(uint16_t port, uint32_t dest) {
+    DBG3("cThread: Called tcpListen for port " << port << ", session " << dest);
+
+    if (!fcnfg.en_tcp) {
+        throw std::runtime_error("ERROR: cThread::tcpListen() called, but the shell was not synthesized with TCP support, exiting...");
+    }
+
+    uint64_t cmd = 
+        ((static_cast<uint64_t>(ctid) & PID_MASK) << TCP_LISTEN_PID_OFFS) |
+        ((static_cast<uint64_t>(dest) & CTRL_DEST_MASK) << TCP_LISTEN_DEST_OFFS) |
+        (static_cast<uint64_t>(port) << TCP_LISTEN_PORT_OFFS);
+
+    std::lock_guard<std::mutex> lock(vfpga_ctx->tcp_lock);
+    return tcpCommand(true, cmd, true) & TCP_STAT_SUCCESS;
+}
+
+bool cThread::tcpOpen(uint32_t ip_addr, uint16_t port, uint32_t dest) {
+    DBG3("cThread: Called tcpOpen for IP address " << ip_addr << ", port " << port << ", session " << dest);
+
+    if (!fcnfg.en_tcp) {
+        throw std::runtime_error("ERROR: cThread::tcpOpen() called, but the shell was not synthesized with TCP support, exiting...");
+    }
+
+    uint64_t cmd = 
+        (static_cast<uint64_t>(ip_addr) << TCP_OPEN_IP_OFFS) |
+        (static_cast<uint64_t>(port) << TCP_OPEN_PORT_OFFS) |
+        ((static_cast<uint64_t>(ctid) & PID_MASK) << TCP_OPEN_PID_OFFS) |
+        ((static_cast<uint64_t>(dest) & CTRL_DEST_MASK) << TCP_OPEN_DEST_OFFS);
+
+    std::lock_guard<std::mutex> lock(vfpga_ctx->tcp_lock);
+    uint64_t stat = tcpCommand(false, cmd, true);
+
+    // Requests from other processes on the same vFPGA are not serialized with ours
+    if (((stat >> TCP_STAT_PID_OFFS) & PID_MASK) != (static_cast<uint64_t>(ctid) & PID_MASK) || 
+        ((stat >> TCP_STAT_DEST_OFFS) & CTRL_DEST_MASK) != (dest & CTRL_DEST_MASK)) {
+        throw std::runtime_error("ERROR: cThread::tcpOpen() received the response of another session, exiting...");
+    }
+    return stat & TCP_STAT_SUCCESS;
+}
+
+void cThread::tcpClose(uint32_t dest) {
+    DBG3("cThread: Called tcpClose for session " << dest);
 
-    #ifdef EN_AVX
-	if (fcnfg.en_avx) {
-		cnfg_reg_avx[static_cast<uint32_t>(CnfgAvxRegs::CTRL_REG)] = _mm256_set_epi64x(0, CTRL_CLR_STAT | ((ctid & CTRL_PID_MASK) << CTRL_PID_OFFS), 0, CTRL_CLR_STAT | ((ctid & CTRL_PID_MASK) << CTRL_PID_OFFS));
-    } else {
-    #endif
-        cnfg_reg[static_cast<uint32_t>(CnfgLegRegs::CTRL_REG_2)] = CTRL_CLR_STAT | ((ctid & CTRL_PID_MASK) << CTRL_PID_OFFS);
-        cnfg_reg[static_cast<uint32_t>(CnfgLegRegs::CTRL_REG)] = CTRL_CLR_STAT | ((ctid & CTRL_PID_MASK) << CTRL_PID_OFFS);
-    #ifdef EN_AVX
+    if (!fcnfg.en_tcp) {
+        throw std::runtime_error("ERROR: cThread::tcpClose() called, but the shell was not synthesized with TCP support, exiting...");
     }
-    #endif
-}
 
-void cThread::doArpLookup(uint32_t ip_addr) {
-    DBG3("cThread: Called doArpLookup for IP address " << ip_addr); 
+    uint64_t cmd = 
+        ((static_cast<uint64_t>(ctid) & PID_MASK) << TCP_OPEN_PID_OFFS) |
+        ((static_cast<uint64_t>(dest) & CTRL_DEST_MASK) << TCP_OPEN_DEST_OFFS) |
+        TCP_OPEN_CLOSE;
 
+    std::lock_guard<std::mutex> lock(vfpga_ctx->tcp_lock);
+    tcpCommand(false, cmd, false);
+}
+
+uint64_t cThread::tcpCommand(bool listen, uint64_t cmd, bool wait) {
     #ifdef EN_AVX
     if (fcnfg.en_avx) {
-        cnfg_reg_avx[static_cast<uint32_t>(CnfgAvxRegs::NET_ARP_REG)] = _mm256_set_epi64x(0, 0, 0, ip_addr);
+        cnfg_reg_avx[static_cast<uint32_t>(listen ? CnfgAvxRegs::TCP_OPEN_PORT_REG : CnfgAvxRegs::TCP_OPEN_CONN_REG)] = _mm256_set_epi64x(0, 0, 0, cmd);
     } else {
     #endif
-        cnfg_reg[static_cast<uint32_t>(CnfgLegRegs::NET_ARP_REG)] = ip_addr;
+        cnfg_reg[static_cast<uint32_t>(listen ? CnfgLegRegs::TCP_OPEN_PORT_REG : CnfgLegRegs::TCP_OPEN_CONN_REG)] = cmd;
     #ifdef EN_AVX
     }
     #endif
 
-	usleep(SLEEP_TIME);
+    if (!wait) {
+        return 0;
+    }
+
+    // Poll the head of the response queue; writing 1 to the status register pops it
+    auto start = std::chrono::steady_clock::now();
+    while (true) {
+        uint64_t stat;
+        #ifdef EN_AVX
+        if (fcnfg.en_avx) {
+            uint32_t reg = static_cast<uint32_t>(listen ? CnfgAvxRegs::TCP_OPEN_PORT_STAT_REG : CnfgAvxRegs::TCP_OPEN_CONN_STAT_REG);
+            stat = _mm256_extract_epi64(cnfg_reg_avx[reg], 0x0);
+            if (stat & TCP_STAT_VALID) {
+                cnfg_reg_avx[reg] = _mm256_set_epi64x(0, 0, 0, 1);
+                return stat;
+            }
+        } else {
+        #endif
+            uint32_t reg = static_cast<uint32_t>(listen ? CnfgLegRegs::TCP_OPEN_PORT_STAT_REG : CnfgLegRegs::TCP_OPEN_CONN_STAT_REG);
+            stat = cnfg_reg[reg];
+            if (stat & TCP_STAT_VALID) {
+                cnfg_reg[reg] = 1;
+                return stat;
+            }
+        #ifdef EN_AVX
+        }
+        #endif
+
+        if (std::chrono::steady_clock::now() - start > TCP_OPEN_TIMEOUT) {
+            throw std::runtime_error("ERROR: cThread, no response from the TCP stack, exiting...");
+        }
+        usleep(SLEEP_TIME);
+    }
+}
+#endif
+
+void cThread::writeQpContext(uint32_t port, uint32_t qp_idx) {
+    DBG3("cThread: Called writeQpContext for QP " << qp_idx); 
+
+    if (fcnfg.en_rdma) {
+        writeQpRegs(port, qp_idx);
+        usleep(SLEEP_TIME);
+    }
 }
 
-void cThread::writeQpContext(uint32_t port) {
-    DBG3("cThread: Called writeQpContext"); 
+void cThread::writeQpRegs(uint32_t port, uint32_t qp_idx) {
+    ibvQp *qp = qpAt(qp_idx);
 
     uint64_t offs[3];
     if (fcnfg.en_rdma) {
         // Derive register values from QP number, rkey, PSN and virtual address 
-        offs[0] = ((static_cast<uint64_t>(qpair->local.qpn) & 0xffffff) << QP_CONTEXT_QPN_OFFS) |
-                  ((static_cast<uint64_t>(qpair->remote.rkey) & 0xffffffff) << QP_CONTEXT_RKEY_OFFS);
+        offs[0] = ((static_cast<uint64_t>(qp->local.qpn) & 0xffffff) << QP_CONTEXT_QPN_OFFS) |
+                  ((static_cast<uint64_t>(qp->remote.rkey) & 0xffffffff) << QP_CONTEXT_RKEY_OFFS);
 
-        offs[1] = ((static_cast<uint64_t>(qpair->local.psn) & 0xffffff) << QP_CONTEXT_LPSN_OFFS) | 
-                  ((static_cast<uint64_t>(qpair->remote.psn) & 0xffffff) << QP_CONTEXT_RPSN_OFFS);
+        offs[1] = ((static_cast<uint64_t>(qp->local.psn) & 0xffffff) << QP_CONTEXT_LPSN_OFFS) | 
+                  ((static_cast<uint64_t>(qp->remote.psn) & 0xffffff) << QP_CONTEXT_RPSN_OFFS);
 
-        offs[2] = ((static_cast<uint64_t>((uint64_t) qpair->remote.vaddr) & 0xffffffffffff) << QP_CONTEXT_VADDR_OFFS);
+        offs[2] = ((static_cast<uint64_t>((uint64_t) qp->remote.vaddr) & 0xffffffffffff) << QP_CONTEXT_VADDR_OFFS);
 
     	
         // Write this information to the vFPGA configuration registers
@@ -968,14 +2770,14 @@ void cThread::writeQpContext(uint32_t port) {
 
         // Write connection context - port (given as function argument), local and remote QPN, GID etc. to the config registers 
         offs[0] = ((static_cast<uint64_t>(port) & 0xffff) << CONN_CONTEXT_PORT_OFFS) | 
-                  ((static_cast<uint64_t>(qpair->remote.qpn) & 0xffffff) << CONN_CONTEXT_RQPN_OFFS) | 
-                  ((static_cast<uint64_t>(qpair->local.qpn) & 0xffff) << CONN_CONTEXT_LQPN_OFFS);
+                  ((static_cast<uint64_t>(qp->remote.qpn) & 0xffffff) << CONN_CONTEXT_RQPN_OFFS) | 
+                  ((static_cast<uint64_t>(qp->local.qpn) & 0xffff) << CONN_CONTEXT_LQPN_OFFS);
 
-        offs[1] = (htols(static_cast<uint64_t>(qpair->remote.gidToUint(8)) & 0xffffffff) << 32) |
-                  (htols(static_cast<uint64_t>(qpair->remote.gidToUint(0)) & 0xffffffff) << 0);
+        offs[1] = (htols(static_cast<uint64_t>(qp->remote.gidToUint(8)) & 0xffffffff) << 32) |
+                  (htols(static_cast<uint64_t>(qp->remote.gidToUint(0)) & 0xffffffff) << 0);
 
-        offs[2] = (htols(static_cast<uint64_t>(qpair->remote.gidToUint(24)) & 0xffffffff) << 32) | 
-                  (htols(static_cast<uint64_t>(qpair->remote.gidToUint(16)) & 0xffffffff) << 0);
+        offs[2] = (htols(static_cast<uint64_t>(qp->remote.gidToUint(24)) & 0xffffffff) << 32) | 
+                  (htols(static_cast<uint64_t>(qp->remote.gidToUint(16)) & 0xffffffff) << 0);
 
         #ifdef EN_AVX
         if (fcnfg.en_avx) {
@@ -988,8 +2790,6 @@ void cThread::writeQpContext(uint32_t port) {
         #ifdef EN_AVX
         }
         #endif
-        
-        usleep(SLEEP_TIME);
     }
 }
  
@@ -1026,6 +2826,66 @@ void cThread::connSync(bool client) {
     }
 }
 
+void cThread::initSync(uint32_t n_qps) {
+    if (!sync_mem) {
+        sync_mem = getMem({CoyoteAllocType::REG, SYNC_REGION_SIZE});
+        memset(sync_mem, 0, SYNC_REGION_SIZE);
+    }
+    if (remote_sync.size() < n_qps) {
+        remote_sync.resize(n_qps, 0);
+        sync_sent.resize(n_qps, 0);
+        sync_recvd.resize(n_qps, 0);
+    }
+}
+
+void cThread::signalSync(uint32_t qp) {
+    // The flag holds the number of barriers this node entered; since it only grows, a replayed write is harmless
+    sync_sent[qp]++;
+    *((volatile uint64_t*) localMrAddr(qp, SYNC_MR)) = sync_sent[qp];
+
+    rdmaSg sg;
+    sg.len = SYNC_SLOT_SIZE;
+    sg.qp = qp;
+    sg.local_mr = SYNC_MR;
+    sg.remote_mr = SYNC_MR;
+
+    // Not marked as last, so neither node counts a completion; the operations counted by the users are not affected
+    invoke(CoyoteOper::REMOTE_RDMA_WRITE, sg, false);
+}
+
+void cThread::waitSync(uint32_t qp) {
+    sync_recvd[qp]++;
+    volatile uint64_t *flag = (volatile uint64_t*) ((char*) sync_mem + 2 * qp * SYNC_SLOT_SIZE);
+    while (*flag < sync_recvd[qp]) {
+        _mm_pause();
+    }
+}
+
+void cThread::rdmaSync(uint32_t qp) {
+    DBG3("cThread: Called rdmaSync for QP " << qp);
+
+    if (qp >= remote_sync.size() || !remote_sync[qp]) {
+        throw std::runtime_error("ERROR: cThread::rdmaSync() called for QP " + std::to_string(qp) + ", which is not connected");
+    }
+    signalSync(qp);
+    waitSync(qp);
+}
+
+void cThread::rdmaBarrier(const std::vector<uint32_t> &qps, uint32_t rank) {
+    DBG3("cThread: Called rdmaBarrier for rank " << rank << " of " << qps.size());
+
+    uint32_t n_ranks = qps.size();
+    if (rank >= n_ranks) {
+        throw std::runtime_error("ERROR: cThread::rdmaBarrier() - rank " + std::to_string(rank) + " out of range");
+    }
+
+    // Dissemination: the distances 2^k < n are distinct modulo n, so no QP is used twice within a barrier
+    for (uint32_t dist = 1; dist < n_ranks; dist *= 2) {
+        signalSync(qps[(rank + dist) % n_ranks]);
+        waitSync(qps[(rank + n_ranks - dist) % n_ranks]);
+    }
+}
+
 void* cThread::initRDMA(uint32_t buffer_size, uint16_t port, const char* server_address) {
     // Served address provided, so this node is the client
     if (server_address) {
@@ -1081,6 +2941,9 @@ void* cThread::initRDMA(uint32_t buffer_size, uint16_t port, const char* server_
         }
         memcpy(&(qpair->remote), recv_buff, sizeof(ibvQ));
 
+        // Exchange the registered memory regions
+        exchangeMrs(connfd, 0, true);
+
         // Write necessary information to the hardware registers
         writeQpContext(port);
         doArpLookup(qpair->remote.ip_addr);
@@ -1146,6 +3009,9 @@ void* cThread::initRDMA(uint32_t buffer_size, uint16_t port, const char* server_
                 throw std::runtime_error("ERROR: Failed to send queue to client");
             }
 
+            // Exchange the registered memory regions
+            exchangeMrs(connfd, 0, false);
+
             //  Write necessary information to the hardware registers
             writeQpContext(port); 
             doArpLookup(qpair->remote.ip_addr); 
@@ -1160,6 +3026,423 @@ void* cThread::initRDMA(uint32_t buffer_size, uint16_t port, const char* server_
 
 }
 
+uint32_t cThread::addQp() {
+    DBG3("cThread: Called addQp");
+
+    if (!fcnfg.en_rdma) {
+        throw std::runtime_error("ERROR: cThread::addQp() called, but the shell was not synthesized with RDMA support");
+    }
+
+    // Each QP is served by its own Coyote thread ID, registered for the same host process
+    uint64_t tmp[MAX_USER_ARGS];
+    tmp[0] = hpid;
+    if (ioctl(fd, IOCTL_REGISTER_CTID, &tmp)) { 
+        throw std::runtime_error("ERROR: IOCTL_REGISTER_CTID failed"); 
+    }
+    int32_t qp_ctid = tmp[1];
+
+    // Same IP address and GID as the cThread's own QP; the QPN is obtained from the vfid and the QP's ctid
+    std::unique_ptr<ibvQp> qp = std::make_unique<ibvQp>();
+    qp->local = qpair->local;
+    qp->local.qpn = ((vfid & N_REG_MASK) << PID_BITS) | (qp_ctid & PID_MASK);
+    qp->local.vaddr = 0;
+    qp->local.size = 0;
+
+    std::default_random_engine rand_gen(seed + qp_ctid);
+    std::uniform_int_distribution<int> distr(0, std::numeric_limits<std::uint32_t>::max());
+    qp->local.psn = distr(rand_gen) & 0xFFFFFF;
+
+    extra_qpairs.emplace_back(qp_ctid, std::move(qp));
+    clearCounters(qp_ctid);
+
+    DBG2("cThread: added QP " << extra_qpairs.size() << " with ctid " << qp_ctid << " and QPN " << extra_qpairs.back().second->local.qpn);
+    return extra_qpairs.size();
+}
+
+void cThread::connectQp(uint32_t qp_idx, void *buffer, uint32_t size, uint16_t port, const char* server_address) {
+    DBG3("cThread: Called connectQp for QP " << qp_idx);
+
+    ibvQp *qp = qpAt(qp_idx);
+    qp->local.vaddr = buffer;
+    qp->local.size = size;
+
+    int qp_connfd = -1;
+    if (server_address) {
+        // Client: connect to the remote node, send the local QP first
+        qp_connfd = oobConnect(server_address, port, 0);
+
+        if (::write(qp_connfd, &(qp->local), sizeof(ibvQ)) != sizeof(ibvQ) || 
+            ::read(qp_connfd, &(qp->remote), sizeof(ibvQ)) != sizeof(ibvQ)) {
+            ::close(qp_connfd);
+            throw std::runtime_error("ERROR: Failed to exchange queue with the server");
+        }
+
+        try {
+            exchangeMrs(qp_connfd, qp_idx, true);
+        } catch (...) {
+            ::close(qp_connfd);
+            throw;
+        }
+
+    } else {
+        // Server: accept a single connection on the port, receive the remote QP first
+        int qp_sockfd = oobListen(port, 1);
+        qp_connfd = ::accept(qp_sockfd, NULL, 0);
+        ::close(qp_sockfd);
+        if (qp_connfd == -1) {
+            throw std::runtime_error("ERROR: Failed to accept connection from client");
+        }
+
+        if (::read(qp_connfd, &(qp->remote), sizeof(ibvQ)) != sizeof(ibvQ) || 
+            ::write(qp_connfd, &(qp->local), sizeof(ibvQ)) != sizeof(ibvQ)) {
+            ::close(qp_connfd);
+            throw std::runtime_error("ERROR: Failed to exchange queue with the client");
+        }
+
+        try {
+            exchangeMrs(qp_connfd, qp_idx, false);
+        } catch (...) {
+            ::close(qp_connfd);
+            throw;
+        }
+    }
+    ::close(qp_connfd);
+
+    // Write necessary information to the hardware registers
+    writeQpContext(port, qp_idx);
+    doArpLookup(qp->remote.ip_addr);
+
+    DBG2("cThread: connected QP " << qp_idx << ", local QPN " << qp->local.qpn << ", remote QPN " << qp->remote.qpn);
+}
+
+void cThread::reconnectQp(uint32_t qp_idx, uint16_t port, const char* server_address) {
+    DBG3("cThread: Called reconnectQp for QP " << qp_idx);
+
+    ibvQp *qp = qpAt(qp_idx);
+    if (!qp->local.vaddr) {
+        throw std::runtime_error("ERROR: cThread::reconnectQp() - QP " + std::to_string(qp_idx) + " was never connected");
+    }
+
+    // Fresh PSN, so that packets of the old connection which are still in flight are dropped
+    std::default_random_engine rand_gen(std::chrono::system_clock::now().time_since_epoch().count() + qpCtid(qp_idx));
+    std::uniform_int_distribution<int> distr(0, std::numeric_limits<std::uint32_t>::max());
+    qp->local.psn = distr(rand_gen) & 0xFFFFFF;
+
+    // The out-of-band connection of initRDMA() is replaced, and kept open for closeConn(); the server keeps listening on its socket
+    bool persistent = qp_idx == 0 && is_connected;
+    if (persistent) {
+        ::close(connfd);
+        connfd = -1;
+        is_connected = false;
+    }
+
+    uint32_t remote_ip = qp->remote.ip_addr;
+    int qp_connfd = -1;
+    if (server_address) {
+        // Client: the restarted peer may not be listening yet, so keep retrying
+        qp_connfd = oobConnect(server_address, port, BOOTSTRAP_CONNECT_RETRIES);
+
+        if (::write(qp_connfd, &(qp->local), sizeof(ibvQ)) != sizeof(ibvQ) || 
+            ::read(qp_connfd, &(qp->remote), sizeof(ibvQ)) != sizeof(ibvQ)) {
+            ::close(qp_connfd);
+            throw std::runtime_error("ERROR: Failed to exchange queue with the server");
+        }
+    } else {
+        int qp_sockfd = (persistent && sockfd != -1) ? sockfd : oobListen(port, 1);
+        qp_connfd = ::accept(qp_sockfd, NULL, 0);
+        if (qp_sockfd != sockfd) {
+            ::close(qp_sockfd);
+        }
+        if (qp_connfd == -1) {
+            throw std::runtime_error("ERROR: Failed to accept connection from client");
+        }
+
+        if (::read(qp_connfd, &(qp->remote), sizeof(ibvQ)) != sizeof(ibvQ) || 
+            ::write(qp_connfd, &(qp->local), sizeof(ibvQ)) != sizeof(ibvQ)) {
+            ::close(qp_connfd);
+            throw std::runtime_error("ERROR: Failed to exchange queue with the client");
+        }
+    }
+
+    try {
+        exchangeMrs(qp_connfd, qp_idx, server_address != nullptr);
+    } catch (...) {
+        ::close(qp_connfd);
+        throw;
+    }
+
+    if (persistent) {
+        connfd = qp_connfd;
+        is_connected = true;
+    } else {
+        ::close(qp_connfd);
+    }
+
+    // Operations towards the old peer never complete; start counting from zero
+    clearCounters(qpCtid(qp_idx));
+    if (qp_idx < pacing.size()) {
+        pacing[qp_idx].completed = 0;
+        pacing[qp_idx].in_flight.clear();
+    }
+
+    // Only the QP context changes; the neighbor entry is still valid, unless the peer came back on another address
+    writeQpContext(port, qp_idx);
+    if (qp->remote.ip_addr != remote_ip) {
+        doArpLookup(qp->remote.ip_addr);
+    }
+
+    DBG2("cThread: reconnected QP " << qp_idx << ", local QPN " << qp->local.qpn << ", remote QPN " << qp->remote.qpn);
+}
+
+std::vector<uint32_t> cThread::connectPeers(const std::vector<std::string> &peers, uint32_t rank, void *buffer, uint32_t size, uint16_t port) {
+    DBG3("cThread: Called connectPeers with " << peers.size() << " nodes, rank " << rank);
+
+    if (rank >= peers.size()) {
+        throw std::runtime_error("ERROR: cThread::connectPeers() - rank " + std::to_string(rank) + " out of range");
+    }
+    if (!fcnfg.en_rdma) {
+        throw std::runtime_error("ERROR: cThread::connectPeers() called, but the shell was not synthesized with RDMA support");
+    }
+
+    // Set-up one QP per peer before starting the exchanges, since the QP and MR tables are not resized concurrently
+    std::vector<uint32_t> qps(peers.size(), UINT32_MAX);
+    bool first = true;
+    for (uint32_t i = 0; i < peers.size(); i++) {
+        if (i != rank) {
+            qps[i] = first ? 0 : addQp();
+            first = false;
+
+            ibvQp *qp = qpAt(qps[i]);
+            qp->local.vaddr = buffer;
+            qp->local.size = size;
+        }
+    }
+    if (remote_mrs.size() < getNumQps()) {
+        remote_mrs.resize(getNumQps());
+    }
+    initSync(getNumQps());
+
+    // Exchanges the QP information and the memory regions with a peer; the connecting side (higher rank) sends first
+    auto exchange = [&](int sock, bool client, uint32_t peer) {
+        ibvQp *qp = qpAt(qps[peer]);
+        bool ok = client ? 
+            (::write(sock, &(qp->local), sizeof(ibvQ)) == sizeof(ibvQ) && ::read(sock, &(qp->remote), sizeof(ibvQ)) == sizeof(ibvQ)) :
+            (::read(sock, &(qp->remote), sizeof(ibvQ)) == sizeof(ibvQ) && ::write(sock, &(qp->local), sizeof(ibvQ)) == sizeof(ibvQ));
+        if (!ok) {
+            throw std::runtime_error("ERROR: Failed to exchange queue with node " + std::to_string(peer));
+        }
+        exchangeMrs(sock, qps[peer], client);
+    };
+
+    std::mutex error_lock;
+    std::exception_ptr error;
+    auto guarded = [&](std::function<void()> fn) {
+        try {
+            fn();
+        } catch (...) {
+            std::lock_guard<std::mutex> guard(error_lock);
+            if (!error) {
+                error = std::current_exception();
+            }
+        }
+    };
+
+    // Accept the connections of the higher ranks; the peers announce their rank first
+    int listen_sock = -1;
+    uint32_t n_higher = peers.size() - rank - 1;
+    if (n_higher) {
+        listen_sock = oobListen(port, n_higher);
+
+        // Give up on peers which didn't connect within the same time the connecting side retries for
+        struct timeval timeout;
+        auto wait_us = std::chrono::duration_cast<std::chrono::microseconds>(BOOTSTRAP_RETRY_INTERVAL * (BOOTSTRAP_CONNECT_RETRIES + 1)).count();
+        timeout.tv_sec = wait_us / 1000000;
+        timeout.tv_usec = wait_us % 1000000;
+        setsockopt(listen_sock, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    }
+    std::thread acceptor([&] {
+        for (uint32_t i = 0; i < n_higher; i++) {
+            int sock = ::accept(listen_sock, NULL, 0);
+            if (sock == -1) {
+                guarded([] { throw std::runtime_error("ERROR: Failed to accept connection from a peer"); });
+                return;
+            }
+            guarded([&] {
+                uint32_t peer;
+                if (::read(sock, &peer, sizeof(uint32_t)) != sizeof(uint32_t) || peer <= rank || peer >= peers.size()) {
+                    throw std::runtime_error("ERROR: Received an invalid rank from a peer");
+                }
+                exchange(sock, false, peer);
+            });
+            ::close(sock);
+        }
+    });
+
+    // Connect to the lower ranks, in parallel
+    std::vector<std::thread> connectors;
+    for (uint32_t i = 0; i < rank; i++) {
+        connectors.emplace_back([&, i] {
+            guarded([&] {
+                int sock = oobConnect(peers[i], port, BOOTSTRAP_CONNECT_RETRIES);
+                try {
+                    if (::write(sock, &rank, sizeof(uint32_t)) != sizeof(uint32_t)) {
+                        throw std::runtime_error("ERROR: Failed to send rank to node " + std::to_string(i));
+                    }
+                    exchange(sock, true, i);
+                } catch (...) {
+                    ::close(sock);
+                    throw;
+                }
+                ::close(sock);
+            });
+        });
+    }
+
+    for (auto &connector : connectors) {
+        connector.join();
+    }
+    
+    // If a connection failed, the remaining peers may never connect; unblock the acceptor
+    if (error && listen_sock != -1) {
+        ::shutdown(listen_sock, SHUT_RDWR);
+    }
+    acceptor.join();
+    if (listen_sock != -1) {
+        ::close(listen_sock);
+    }
+    if (error) {
+        std::rethrow_exception(error);
+    }
+
+    // Write all the QP contexts and issue the ARP lookups (once per IP address, unless already looked up), then wait for the vFPGA once
+    std::set<uint32_t> ips;
+    for (uint32_t i = 0; i < peers.size(); i++) {
+        if (i != rank) {
+            writeQpRegs(port, qps[i]);
+            ips.insert(qpAt(qps[i])->remote.ip_addr);
+        }
+    }
+    std::chrono::nanoseconds wait = std::chrono::microseconds(SLEEP_TIME);
+    for (uint32_t ip : ips) {
+        bool issue;
+        wait = std::max(wait, neighLookup(ip, issue));
+        if (issue) {
+            writeArpReg(ip);
+        }
+    }
+    std::this_thread::sleep_for(wait);
+
+    DBG2("cThread: connected to " << peers.size() - 1 << " peers");
+    return qps;
+}
+
+uint32_t cThread::registerMr(void *vaddr, uint64_t size) {
+    DBG3("cThread: Called registerMr for " << vaddr << ", size " << size);
+
+    if (!isMapped(vaddr, size)) {
+        throw std::runtime_error("ERROR: cThread::registerMr() called for a buffer which is not mapped in the vFPGA's TLB");
+    }
+    if (local_mrs.size() >= MAX_N_MRS) {
+        throw std::runtime_error("ERROR: cThread::registerMr() - at most " + std::to_string(MAX_N_MRS) + " memory regions can be registered");
+    }
+
+    local_mrs.push_back({(uint64_t) vaddr, size, 0, 0});
+    return local_mrs.size();
+}
+
+uint32_t cThread::getNumRemoteMrs(uint32_t qp) const {
+    return qp < remote_mrs.size() ? remote_mrs[qp].size() : 0;
+}
+
+void cThread::exchangeMrs(int sock, uint32_t qp, bool client) {
+    // Fully sends/receives a buffer; the tables may exceed a single segment
+    auto sendAll = [sock](const void *buff, size_t len) {
+        for (size_t done = 0; done < len; ) {
+            ssize_t n = ::write(sock, (const char*) buff + done, len - done);
+            if (n <= 0) {
+                throw std::runtime_error("ERROR: Failed to send memory regions");
+            }
+            done += n;
+        }
+    };
+    auto recvAll = [sock](void *buff, size_t len) {
+        for (size_t done = 0; done < len; ) {
+            ssize_t n = ::read(sock, (char*) buff + done, len - done);
+            if (n <= 0) {
+                throw std::runtime_error("ERROR: Failed to receive memory regions");
+            }
+            done += n;
+        }
+    };
+
+    // The flags of the RDMA barriers are exchanged with the regions
+    initSync(qp + 1);
+    memset((char*) sync_mem + 2 * qp * SYNC_SLOT_SIZE, 0, SYNC_SLOT_SIZE);
+    sync_sent[qp] = 0;
+    sync_recvd[qp] = 0;
+
+    auto send = [&]() {
+        uint32_t n_mrs = local_mrs.size();
+        sendAll(&n_mrs, sizeof(uint32_t));
+        sendAll(local_mrs.data(), n_mrs * sizeof(ibvMr));
+
+        uint64_t sync_addr = (uint64_t) sync_mem + 2 * qp * SYNC_SLOT_SIZE;
+        sendAll(&sync_addr, sizeof(uint64_t));
+    };
+    auto recv = [&]() {
+        uint32_t n_mrs;
+        recvAll(&n_mrs, sizeof(uint32_t));
+        if (n_mrs > MAX_N_MRS) {
+            throw std::runtime_error("ERROR: Remote node sent too many memory regions");
+        }
+
+        if (remote_mrs.size() <= qp) {
+            remote_mrs.resize(qp + 1);
+        }
+        remote_mrs[qp].resize(n_mrs);
+        recvAll(remote_mrs[qp].data(), n_mrs * sizeof(ibvMr));
+        recvAll(&remote_sync[qp], sizeof(uint64_t));
+    };
+
+    if (client) {
+        send();
+        recv();
+    } else {
+        recv();
+        send();
+    }
+    DBG2("cThread: exchanged memory regions for QP " << qp << ", local " << local_mrs.size() << ", remote " << remote_mrs[qp].size());
+}
+
+uint64_t cThread::localMrAddr(uint32_t qp, uint32_t mr) const {
+    if (mr == 0) {
+        return (uint64_t) qpAt(qp)->local.vaddr;
+    }
+    if (mr == SYNC_MR) {
+        return (uint64_t) sync_mem + (2 * qp + 1) * SYNC_SLOT_SIZE;
+    }
+    if (mr > local_mrs.size()) {
+        throw std::runtime_error("ERROR: Local memory region " + std::to_string(mr) + " is not registered");
+    }
+    return local_mrs[mr - 1].vaddr;
+}
+
+uint64_t cThread::remoteMrAddr(uint32_t qp, uint32_t mr) const {
+    if (mr == 0) {
+        return (uint64_t) qpAt(qp)->remote.vaddr;
+    }
+    if (mr == SYNC_MR) {
+        if (qp >= remote_sync.size() || !remote_sync[qp]) {
+            throw std::runtime_error("ERROR: QP " + std::to_string(qp) + " is not connected");
+        }
+        return remote_sync[qp];
+    }
+    if (qp >= remote_mrs.size() || mr > remote_mrs[qp].size()) {
+        throw std::runtime_error("ERROR: Remote memory region " + std::to_string(mr) + " of QP " + std::to_string(qp) + " is not registered");
+    }
+    return remote_mrs[qp][mr - 1].vaddr;
+}
+
 void cThread::closeConn() {
     DBG3("cThread: Called closeConn to release the out-of-band connection");
 
@@ -1202,7 +3485,11 @@ void cThread::closeConn() {
 void cThread::lock() {
     DBG3("cThread: Called lock");
     if (!lock_acquired) {
-        vlock.lock();
+        if (lock_backend == CoyoteLock::PROCESS) {
+            vfpga_ctx->vfpga_lock.lock();
+        } else {
+            vlock.lock();
+        }
         lock_acquired = true;
     }
 }
@@ -1210,18 +3497,129 @@ void cThread::lock() {
 void cThread::unlock() {
     DBG3("cThread: Called unlock");
     if (lock_acquired) {
-        vlock.unlock();
+        if (lock_backend == CoyoteLock::PROCESS) {
+            vfpga_ctx->vfpga_lock.unlock();
+        } else {
+            vlock.unlock();
+        }
         lock_acquired = false;
     }
 }
 
+void cThread::setLockBackend(CoyoteLock backend) {
+    if (lock_acquired) {
+        throw std::runtime_error("ERROR: Cannot change the lock backend while the vFPGA lock is held");
+    }
+    lock_backend = backend;
+}
+
+CoyoteLock cThread::getLockBackend() const { return lock_backend; }
+
+void cThread::setBackoff(CoyoteBackoff policy) { backoff = policy; }
+
+CoyoteBackoff cThread::getBackoff() const { return backoff; }
+
+void cThread::setWriteCombining(bool enable) {
+    #ifdef EN_AVX
+    if (enable && !cnfg_reg_wc) {
+        if (!fcnfg.en_avx) {
+            throw std::runtime_error("ERROR: cThread::setWriteCombining() requires a shell built with AVX support");
+        }
+
+        void *addr = mmap(NULL, CNFG_AVX_WC_REGION_SIZE, PROT_WRITE, MAP_SHARED, fd, MMAP_CNFG_AVX_WC);
+        if (addr == MAP_FAILED) {
+            throw std::runtime_error("ERROR: cnfg_reg_wc mmap failed");
+        }
+        cnfg_reg_wc = (__m256i*) addr;
+        DBG1("cThread: mapped cnfg_reg_wc at: " << std::hex << reinterpret_cast<uint64_t>(addr) << std::dec);
+    } else if (!enable && cnfg_reg_wc) {
+        if (munmap((void*)cnfg_reg_wc, CNFG_AVX_WC_REGION_SIZE) != 0) {
+            throw std::runtime_error("ERROR: cnfg_reg_wc munmap failed");
+        }
+        cnfg_reg_wc = 0;
+    }
+    #else
+    if (enable) {
+        throw std::runtime_error("ERROR: cThread::setWriteCombining() requires the library to be built with EN_AVX");
+    }
+    #endif
+}
+
+bool cThread::getWriteCombining() const {
+    #ifdef EN_AVX
+    return cnfg_reg_wc != 0;
+    #else
+    return false;
+    #endif
+}
+
+void cThread::setRdmaPacing(CoyotePacing mode, uint32_t max_window) {
+    if (!max_window) {
+        throw std::runtime_error("ERROR: cThread::setRdmaPacing() called with an empty window");
+    }
+
+    pacing_mode = mode;
+    pacing_max_window = max_window;
+    pacing.clear();
+
+    // Baseline of the retransmissions, so that only the ones from now on are taken as congestion
+    if (mode == CoyotePacing::ADAPTIVE) {
+        unsigned long stats[N_NET_STAT_REGS];
+        if (!ioctl(fd, IOCTL_NET_STATS, &stats)) {
+            net_retrans = HIGH_32(stats[NET_STAT_RETRANS_REG]);
+        }
+        net_stats_time = std::chrono::steady_clock::now();
+    }
+}
+
+CoyotePacing cThread::getRdmaPacing() const { return pacing_mode; }
+
+uint32_t cThread::getRdmaWindow(uint32_t qp) const { 
+    return qp < pacing.size() ? (uint32_t) pacing[qp].window : pacing_max_window; 
+}
+
+uint32_t cThread::pollNotifications() {
+    if (!notify_ring || notify_mode != CoyoteNotify::POLL) {
+        throw std::runtime_error("ERROR: pollNotifications requires a uisr and CoyoteNotify::POLL");
+    }
+    return cNotifyReactor::drain(notify_ring, uisr);
+}
+
+uint32_t cThread::getDroppedNotifications() const { return notify_ring ? __atomic_load_n(&notify_ring->dropped, __ATOMIC_RELAXED) : 0; }
+
+CoyoteNotify cThread::getNotifyMode() const { return notify_mode; }
+
+int32_t cThread::getNumaNode() const { return numa_node; }
+
 int32_t cThread::getVfid() const { return vfid;};
 
 int32_t cThread::getCtid() const { return ctid; };
 
 pid_t  cThread::getHpid() const { return hpid; };
 
-ibvQp* cThread::getQpair() const { return qpair.get(); }
+ibvQp* cThread::getQpair(uint32_t qp) const { return qpAt(qp); }
+
+uint32_t cThread::getNumQps() const { return 1 + extra_qpairs.size(); }
+
+ibvQp* cThread::qpAt(uint32_t qp) const {
+    if (qp == 0) {
+        return qpair.get();
+    }
+    if (qp > extra_qpairs.size()) {
+        throw std::runtime_error("ERROR: QP index " + std::to_string(qp) + " out of range, cThread has " + std::to_string(getNumQps()) + " QPs");
+    }
+    return extra_qpairs[qp - 1].second.get();
+}
+
+int32_t cThread::qpCtid(uint32_t qp) const {
+    if (qp == 0) {
+        return ctid;
+    }
+    if (qp > extra_qpairs.size()) {
+        throw std::runtime_error("ERROR: QP index " + std::to_string(qp) + " out of range, cThread has " + std::to_string(getNumQps()) + " QPs");
+    }
+    return extra_qpairs[qp - 1].first;
+}
 	
 void cThread::printDebug() const {
 	std::cout << "-- STATISTICS - ID: cThread ID" << ctid << ", vFPGA ID" << vfid << std::endl;
@@ -1254,6 +3652,24 @@ void cThread::printDebug() const {
 	std::cout << std::endl;
 }
 
+void cThread::setTimingTrace(bool enable) {
+    if (enable) {
+        throw std::runtime_error("ERROR: Timing reports are only available in simulation");
+    }
+}
+
+std::vector<simReqTiming> cThread::getTimings() const {
+    throw std::runtime_error("ERROR: Timing reports are only available in simulation");
+}
+
+void cThread::printTimingSummary() const {
+    throw std::runtime_error("ERROR: Timing reports are only available in simulation");
+}
+
+void cThread::writeTimingCsv([[maybe_unused]] const std::string &file_name) const {
+    throw std::runtime_error("ERROR: Timing reports are only available in simulation");
+}
+
 // Empty additional state class because we only need this for the simulation environment.
 class cThread::AdditionalState {};
 
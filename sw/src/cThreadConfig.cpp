@@ -0,0 +1,116 @@
+/*
+ * This file is part of the Coyote <https://github.com/fpgasystems/Coyote>
+ *
+ * MIT Licence
+ * Copyright (c) 2025, Systems Group, ETH Zurich
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <mutex>
+#include <string>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+#include <pthread.h>
+
+#include <coyote/cLog.hpp>
+#include <coyote/cThreadConfig.hpp>
+
+namespace coyote {
+
+/// Thread name prefixes, indexed by CoyoteThreadRole
+static const char *const THREAD_ROLE_NAMES[N_THREAD_ROLES] = {
+    "cyt-event", "cyt-sync", "cyt-sched", "cyt-svc", "cyt-stats", "cyt-conn", "cyt-notify", "cyt-load", "cyt-log"
+};
+
+/// Maximum length of a thread name, without the terminating null (pthread_setname_np)
+static const size_t THREAD_NAME_LEN = 15;
+
+static std::mutex config_lock;
+static cThreadAttr configs[N_THREAD_ROLES];
+
+void cThreadConfig::set(CoyoteThreadRole role, const cThreadAttr &attr) {
+    for (int cpu : attr.cpus) {
+        if (cpu < 0 || cpu >= CPU_SETSIZE) {
+            throw std::runtime_error("ERROR: cThreadConfig::set() called with an invalid CPU " + std::to_string(cpu));
+        }
+    }
+
+    if (
+        attr.policy != SCHED_OTHER && attr.policy != SCHED_BATCH && attr.policy != SCHED_IDLE &&
+        attr.policy != SCHED_FIFO && attr.policy != SCHED_RR
+    ) {
+        throw std::runtime_error("ERROR: cThreadConfig::set() called with an unsupported scheduling policy " + std::to_string(attr.policy));
+    }
+
+    if (attr.priority < sched_get_priority_min(attr.policy) || attr.priority > sched_get_priority_max(attr.policy)) {
+        throw std::runtime_error("ERROR: cThreadConfig::set() called with priority " + std::to_string(attr.priority) + ", which is out of range for the policy");
+    }
+
+    std::lock_guard<std::mutex> guard(config_lock);
+    configs[static_cast<int>(role)] = attr;
+}
+
+void cThreadConfig::setAll(const cThreadAttr &attr) {
+    for (unsigned int i = 0; i < N_THREAD_ROLES; i++) {
+        set(static_cast<CoyoteThreadRole>(i), attr);
+    }
+}
+
+cThreadAttr cThreadConfig::get(CoyoteThreadRole role) {
+    std::lock_guard<std::mutex> guard(config_lock);
+    return configs[static_cast<int>(role)];
+}
+
+void cThreadConfig::apply(CoyoteThreadRole role, int64_t id) {
+    const char *role_name = THREAD_ROLE_NAMES[static_cast<int>(role)];
+
+    // The role name is cut if needed, so that the ID stays visible
+    std::string suffix = id >= 0 ? "-" + std::to_string(id) : "";
+    size_t max_role = suffix.size() < THREAD_NAME_LEN ? THREAD_NAME_LEN - suffix.size() : 0;
+    std::string name = (std::string(role_name).substr(0, max_role) + suffix).substr(0, THREAD_NAME_LEN);
+    pthread_setname_np(pthread_self(), name.c_str());
+
+    cThreadAttr attr = get(role);
+    if (!attr.cpus.empty()) {
+        cpu_set_t cpu_set;
+        CPU_ZERO(&cpu_set);
+        for (int cpu : attr.cpus) {
+            CPU_SET(cpu, &cpu_set);
+        }
+        int ret = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+        if (ret) {
+            CYT_LOG(LOG_WARNING, "Could not set the CPU affinity of thread %s: %s", name.c_str(), strerror(ret));
+        }
+    }
+
+    if (attr.policy != SCHED_OTHER) {
+        struct sched_param param = {};
+        param.sched_priority = attr.priority;
+        int ret = pthread_setschedparam(pthread_self(), attr.policy, &param);
+        if (ret) {
+            CYT_LOG(LOG_WARNING, "Could not set the scheduling policy of thread %s: %s", name.c_str(), strerror(ret));
+        }
+    }
+}
+
+}
@@ -0,0 +1,299 @@
+/*
+ * This file is part of the Coyote <https://github.com/fpgasystems/Coyote>
+ *
+ * MIT Licence
+ * Copyright (c) 2025, Systems Group, ETH Zurich
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <coyote/cThreadGroup.hpp>
+
+namespace coyote {
+
+cThreadGroup::cThreadGroup(const std::vector<cGroupMember> &members, pid_t hpid) {
+    if (members.empty()) {
+        throw std::runtime_error("ERROR: cThreadGroup created without members");
+    }
+
+    for (const cGroupMember &member : members) {
+        threads.emplace_back(new cThread(member.vfid, hpid, member.device));
+        DBG1("cThreadGroup: opened device " << member.device << ", vFPGA " << member.vfid << ", NUMA node " << threads.back()->getNumaNode());
+    }
+}
+
+cThreadGroup::cThreadGroup(int32_t vfid, pid_t hpid, uint32_t n_devices) : cThreadGroup([&] {
+    std::vector<cGroupMember> members(n_devices);
+    for (uint32_t i = 0; i < n_devices; i++) {
+        members[i].device = i;
+        members[i].vfid = vfid;
+    }
+    return members;
+}(), hpid) {}
+
+cThreadGroup::~cThreadGroup() {
+    while (!allocs.empty()) {
+        try {
+            freeMem(reinterpret_cast<void*>(allocs.begin()->first));
+        } catch (const std::exception &e) {
+            std::cerr << "WARNING: cThreadGroup failed to release a buffer: " << e.what() << std::endl;
+            allocs.erase(allocs.begin());
+        }
+    }
+}
+
+void* cThreadGroup::getMem(CoyoteAlloc&& alloc) {
+    DBG1("cThreadGroup: Called getMem to obtain a sharded buffer with size " << alloc.size);
+    if (!alloc.size) {
+        return nullptr;
+    }
+
+    if (alloc.alloc != CoyoteAllocType::REG && alloc.alloc != CoyoteAllocType::THP && alloc.alloc != CoyoteAllocType::HPF) {
+        throw std::runtime_error("ERROR: cThreadGroup::getMem() - only host memory (REG, THP, HPF) can be sharded");
+    }
+
+    // Shards are a multiple of the huge page size, so that no (huge) page straddles two NUMA nodes
+    uint64_t shard_size = (alloc.size + threads.size() - 1) / threads.size();
+    shard_size = ((shard_size + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE) * HUGE_PAGE_SIZE;
+    size_t n_shards = (alloc.size + shard_size - 1) / shard_size;
+    uint64_t size = n_shards * shard_size;
+
+    char *mem = nullptr;
+    if (alloc.alloc == CoyoteAllocType::HPF) {
+        void *ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (ptr == MAP_FAILED) {
+            std::cerr << "ERROR: cThreadGroup::getMem() - huge page allocation failed, errno " << errno << std::endl;
+            return nullptr;
+        }
+        mem = static_cast<char*>(ptr);
+    } else {
+        // Over-allocate and trim, so that the shards are aligned to huge pages
+        void *ptr = mmap(NULL, size + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (ptr == MAP_FAILED) {
+            std::cerr << "ERROR: cThreadGroup::getMem() - allocation failed, errno " << errno << std::endl;
+            return nullptr;
+        }
+        uint64_t base = reinterpret_cast<uint64_t>(ptr);
+        uint64_t aligned = (base + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+        if (aligned > base) {
+            munmap(ptr, aligned - base);
+        }
+        if (aligned + size < base + size + HUGE_PAGE_SIZE) {
+            munmap(reinterpret_cast<void*>(aligned + size), base + HUGE_PAGE_SIZE - aligned);
+        }
+        mem = reinterpret_cast<char*>(aligned);
+
+        if (alloc.alloc == CoyoteAllocType::THP) {
+            madvise(mem, size, MADV_HUGEPAGE);
+        }
+    }
+
+    // Each shard prefers the NUMA node of its card, before its pages are faulted in and pinned by the member's mapping
+    for (size_t i = 0; i < n_shards; i++) {
+        char *shard = mem + i * shard_size;
+        int32_t node = threads[i]->getNumaNode();
+        if (node >= 0 && node < static_cast<int32_t>(8 * sizeof(unsigned long) * 16)) {
+            unsigned long nodemask[16] = { 0 };
+            nodemask[node / (8 * sizeof(unsigned long))] |= 1UL << (node % (8 * sizeof(unsigned long)));
+            if (syscall(SYS_mbind, shard, shard_size, MPOL_PREFERRED, nodemask, 8 * sizeof(nodemask), MPOL_MF_MOVE)) {
+                std::cerr << "WARNING: cThreadGroup::getMem() - mbind to NUMA node " << node << " failed, errno " << errno << std::endl;
+            }
+        }
+
+        threads[i]->userMap(shard, shard_size);
+    }
+
+    allocs[reinterpret_cast<uint64_t>(mem)] = { size, shard_size };
+    DBG1("cThreadGroup: allocated " << n_shards << " shards of " << shard_size << " bytes at " << static_cast<void*>(mem));
+    return mem;
+}
+
+void cThreadGroup::freeMem(void *vaddr) {
+    auto it = allocs.find(reinterpret_cast<uint64_t>(vaddr));
+    if (it == allocs.end()) {
+        throw std::runtime_error("ERROR: cThreadGroup::freeMem() called for a buffer not allocated by the group");
+    }
+
+    groupAlloc alloc = it->second;
+    allocs.erase(it);
+    for (size_t i = 0; i < alloc.size / alloc.shard_size; i++) {
+        threads[i]->userUnmap(static_cast<char*>(vaddr) + i * alloc.shard_size);
+    }
+    munmap(vaddr, alloc.size);
+}
+
+uint64_t cThreadGroup::getShardSize(const void *vaddr) const {
+    auto it = allocs.find(reinterpret_cast<uint64_t>(vaddr));
+    if (it == allocs.end()) {
+        throw std::runtime_error("ERROR: cThreadGroup::getShardSize() called for a buffer not allocated by the group");
+    }
+    return it->second.shard_size;
+}
+
+void cThreadGroup::split(uint64_t addr, uint64_t len, std::vector<shardSg> &shards) const {
+    shards.clear();
+
+    // Inside a group buffer, the shards are given by the allocation; otherwise, the operation is split evenly at page boundaries
+    uint64_t base = addr, shard_size = 0;
+    auto it = allocs.upper_bound(addr);
+    if (it != allocs.begin() && addr + len <= std::prev(it)->first + std::prev(it)->second.size) {
+        base = std::prev(it)->first;
+        shard_size = std::prev(it)->second.shard_size;
+    } else {
+        shard_size = (len + threads.size() - 1) / threads.size();
+        shard_size = std::max<uint64_t>(PAGE_SIZE, ((shard_size + PAGE_SIZE - 1) / PAGE_SIZE) * PAGE_SIZE);
+    }
+
+    uint64_t offs = 0;
+    while (offs < len) {
+        size_t member = (addr + offs - base) / shard_size;
+        uint64_t end = std::min<uint64_t>(len, base + (member + 1) * shard_size - addr);
+        shards.push_back({ member, offs, end - offs });
+        offs = end;
+    }
+}
+
+void cThreadGroup::track(CoyoteOper oper, const std::vector<shardSg> &shards) {
+    std::vector<uint32_t> &counts = issued[oper];
+    counts.resize(threads.size(), 0);
+
+    std::vector<uint32_t> targets(threads.size(), 0);
+    for (const shardSg &shard : shards) {
+        targets[shard.member] = ++counts[shard.member];
+    }
+    outstanding[oper].push_back(std::move(targets));
+}
+
+size_t cThreadGroup::invoke(CoyoteOper oper, localSg sg) {
+    if (isLocalRead(oper) == isLocalWrite(oper)) {
+        throw std::runtime_error("ERROR: cThreadGroup::invoke() called with one localSg, but the operation is not a LOCAL_READ or LOCAL_WRITE");
+    }
+
+    // All the shards are issued before returning, so the members process them in parallel
+    std::vector<shardSg> shards;
+    split(reinterpret_cast<uint64_t>(sg.addr), sg.len, shards);
+    for (const shardSg &shard : shards) {
+        localSg shard_sg = sg;
+        shard_sg.addr = static_cast<char*>(sg.addr) + shard.offs;
+        shard_sg.len = shard.len;
+        threads[shard.member]->invoke(oper, shard_sg);
+    }
+
+    track(oper, shards);
+    return shards.size();
+}
+
+size_t cThreadGroup::invoke(CoyoteOper oper, localSg src_sg, localSg dst_sg) {
+    if (!isLocalRead(oper) || !isLocalWrite(oper)) {
+        throw std::runtime_error("ERROR: cThreadGroup::invoke() called with two localSg, but the operation is not a LOCAL_TRANSFER");
+    }
+
+    if (src_sg.len != dst_sg.len) {
+        throw std::runtime_error("ERROR: cThreadGroup::invoke() called with a source and destination of different lengths");
+    }
+
+    std::vector<shardSg> shards;
+    split(reinterpret_cast<uint64_t>(src_sg.addr), src_sg.len, shards);
+    for (const shardSg &shard : shards) {
+        localSg shard_src = src_sg, shard_dst = dst_sg;
+        shard_src.addr = static_cast<char*>(src_sg.addr) + shard.offs;
+        shard_src.len = shard.len;
+        shard_dst.addr = static_cast<char*>(dst_sg.addr) + shard.offs;
+        shard_dst.len = shard.len;
+        threads[shard.member]->invoke(oper, shard_src, shard_dst);
+    }
+
+    track(oper, shards);
+    return shards.size();
+}
+
+void cThreadGroup::poll(CoyoteOper oper) {
+    // The shards on each member complete in order, so the group operations complete in order as well
+    std::deque<std::vector<uint32_t>> &pending = outstanding[oper];
+    while (!pending.empty()) {
+        const std::vector<uint32_t> &targets = pending.front();
+        for (size_t i = 0; i < threads.size(); i++) {
+            if (targets[i] && threads[i]->checkCompleted(oper) < targets[i]) {
+                return;
+            }
+        }
+        pending.pop_front();
+        completed[oper]++;
+    }
+}
+
+uint32_t cThreadGroup::checkCompleted(CoyoteOper oper) {
+    poll(oper);
+    return completed[oper];
+}
+
+bool cThreadGroup::waitCompleted(CoyoteOper oper, uint32_t target, std::chrono::nanoseconds timeout) {
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    std::deque<std::vector<uint32_t>> &pending = outstanding[oper];
+    while (checkCompleted(oper) < target) {
+        if (pending.empty()) {
+            return false;
+        }
+
+        // Wait for the slowest member of the oldest group operation
+        const std::vector<uint32_t> &targets = pending.front();
+        for (size_t i = 0; i < threads.size(); i++) {
+            if (!targets[i]) {
+                continue;
+            }
+
+            std::chrono::nanoseconds remaining = timeout;
+            if (timeout.count() >= 0) {
+                remaining = std::max(std::chrono::nanoseconds(0), std::chrono::duration_cast<std::chrono::nanoseconds>(deadline - std::chrono::steady_clock::now()));
+            }
+            if (!threads[i]->waitCompleted(oper, targets[i], remaining)) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+void cThreadGroup::clearCompleted() {
+    for (std::unique_ptr<cThread> &thread : threads) {
+        thread->clearCompleted();
+    }
+    issued.clear();
+    outstanding.clear();
+    completed.clear();
+}
+
+void cThreadGroup::setCSR(uint64_t val, uint32_t offs) {
+    for (std::unique_ptr<cThread> &thread : threads) {
+        thread->setCSR(val, offs);
+    }
+}
+
+size_t cThreadGroup::size() const { return threads.size(); }
+
+cThread* cThreadGroup::getThread(size_t member) const {
+    if (member >= threads.size()) {
+        throw std::runtime_error("ERROR: cThreadGroup::getThread() called for member " + std::to_string(member) + ", but the group has " + std::to_string(threads.size()));
+    }
+    return threads[member].get();
+}
+
+}
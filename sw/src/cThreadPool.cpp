@@ -0,0 +1,103 @@
+/*
+ * This file is part of the Coyote <https://github.com/fpgasystems/Coyote>
+ *
+ * MIT Licence
+ * Copyright (c) 2025, Systems Group, ETH Zurich
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <coyote/cThreadPool.hpp>
+
+namespace coyote {
+
+cThreadPool::cThreadPool(int32_t vfid, uint32_t device, size_t capacity) : state(std::make_shared<poolState>()) {
+    state->vfid = vfid;
+    state->device = device;
+    state->capacity = capacity;
+}
+
+void cThreadPool::fill() {
+    while (getIdle() < state->capacity) {
+        std::unique_ptr<cThread> thread = std::make_unique<cThread>(state->vfid, getpid(), state->device);
+        std::lock_guard<std::mutex> guard(state->lock);
+        state->idle.emplace_back(std::move(thread));
+    }
+}
+
+cThreadPool::pooledThread cThreadPool::acquire(pid_t hpid) {
+    std::unique_ptr<cThread> thread;
+    {
+        std::lock_guard<std::mutex> guard(state->lock);
+        if (!state->idle.empty()) {
+            thread = std::move(state->idle.back());
+            state->idle.pop_back();
+        }
+    }
+
+    // Idle threads are registered for this process; re-register them if requested for another one
+    if (thread && thread->getHpid() != hpid) {
+        try {
+            thread->reset(hpid);
+        } catch (const std::exception &e) {
+            thread.reset();
+        }
+    }
+    if (!thread) {
+        thread = std::make_unique<cThread>(state->vfid, hpid, state->device);
+    }
+
+    std::weak_ptr<poolState> pool = state;
+    return pooledThread(thread.release(), [pool](cThread *released) { recycle(pool, released); });
+}
+
+void cThreadPool::recycle(const std::weak_ptr<poolState> &pool, cThread *thread) {
+    std::unique_ptr<cThread> owned(thread);
+    std::shared_ptr<poolState> state = pool.lock();
+    if (!state) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> guard(state->lock);
+        if (state->idle.size() >= state->capacity) {
+            return;
+        }
+    }
+
+    // Release the previous user's buffers and registration, so that nothing of it is kept while the thread is idle
+    try {
+        owned->reset(getpid());
+    } catch (const std::exception &e) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> guard(state->lock);
+    if (state->idle.size() < state->capacity) {
+        state->idle.emplace_back(std::move(owned));
+    }
+}
+
+size_t cThreadPool::getIdle() {
+    std::lock_guard<std::mutex> guard(state->lock);
+    return state->idle.size();
+}
+
+}
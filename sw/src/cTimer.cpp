@@ -0,0 +1,118 @@
+/*
+ * This file is part of the Coyote <https://github.com/fpgasystems/Coyote>
+ *
+ * MIT Licence
+ * Copyright (c) 2025, Systems Group, ETH Zurich
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+#include <coyote/cTimer.hpp>
+#include <coyote/cThread.hpp>
+
+namespace coyote {
+
+double cTsc::getNsPerTick() {
+    #if defined(__x86_64__) || defined(__i386__)
+    // Calibrated once per process; the TSC rate is constant, so the ratio of the two clocks over a longer interval suffices
+    static const double ns_per_tick = [] {
+        auto begin_time = std::chrono::steady_clock::now();
+        uint64_t begin_ticks = now();
+        std::this_thread::sleep_for(TSC_CALIBRATION_TIME);
+        auto end_time = std::chrono::steady_clock::now();
+        uint64_t end_ticks = now();
+        return std::chrono::duration<double, std::nano>(end_time - begin_time).count() / (double) (end_ticks - begin_ticks);
+    }();
+    return ns_per_tick;
+    #else
+    return 1.0;
+    #endif
+}
+
+bool cTsc::isInvariant() {
+    #if defined(__x86_64__) || defined(__i386__)
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx)) {
+        return false;
+    }
+    return edx & (1 << 8);
+    #else
+    return false;
+    #endif
+}
+
+cFpgaClock::cFpgaClock(cThread &cthread, uint32_t csr_offs, double period) : cthread(cthread), csr_offs(csr_offs), period(period) {
+    if (period <= 0) {
+        throw std::runtime_error("ERROR: cFpgaClock created with a non-positive clock period");
+    }
+    sync();
+    first_tsc = last_tsc;
+    first_cycles = last_cycles;
+}
+
+void cFpgaClock::sync() {
+    uint64_t best_rtt = UINT64_MAX;
+    for (unsigned int i = 0; i < FPGA_CLOCK_SYNC_READS; i++) {
+        uint64_t tsc_before = cTsc::now();
+        uint64_t cycles = cthread.getCSR(csr_offs);
+        uint64_t tsc_after = cTsc::now();
+
+        if (tsc_after - tsc_before < best_rtt) {
+            best_rtt = tsc_after - tsc_before;
+            last_tsc = tsc_before + best_rtt / 2;
+            last_cycles = cycles;
+        }
+    }
+    read_latency = cTsc::toNs(best_rtt);
+
+    // Actual clock period from the two correlations; it only differs from the nominal one by the drift of the oscillators
+    if (first_tsc && last_cycles > first_cycles) {
+        period = cTsc::toNs(last_tsc - first_tsc) / (double) (last_cycles - first_cycles);
+    }
+}
+
+uint64_t cFpgaClock::toTsc(uint64_t cycles) const {
+    double delta_ns = (double) (int64_t) (cycles - last_cycles) * period;
+    return last_tsc + (int64_t) (delta_ns / cTsc::getNsPerTick());
+}
+
+uint64_t cFpgaClock::toCycles(uint64_t tsc) const {
+    double delta_ns = (double) (int64_t) (tsc - last_tsc) * cTsc::getNsPerTick();
+    return last_cycles + (int64_t) (delta_ns / period);
+}
+
+cLatencySplit cFpgaClock::split(uint64_t tsc_issue, uint64_t tsc_issued, uint64_t cycles_start, uint64_t cycles_end, uint64_t tsc_completed) const {
+    // Signed, since the error of the correlation (up to half a CSR read) may exceed a short PCIe leg
+    double ns_per_tick = cTsc::getNsPerTick();
+    cLatencySplit latency;
+    latency.submission = (double) (tsc_issued - tsc_issue) * ns_per_tick;
+    latency.pcie_in = (double) (int64_t) (toTsc(cycles_start) - tsc_issued) * ns_per_tick;
+    latency.kernel = (double) (cycles_end - cycles_start) * period;
+    latency.pcie_out = (double) (int64_t) (tsc_completed - toTsc(cycles_end)) * ns_per_tick;
+    return latency;
+}
+
+}
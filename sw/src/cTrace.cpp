@@ -0,0 +1,352 @@
+/*
+ * This file is part of the Coyote <https://github.com/fpgasystems/Coyote>
+ *
+ * MIT Licence
+ * Copyright (c) 2025, Systems Group, ETH Zurich
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <coyote/cTrace.hpp>
+
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <algorithm>
+#include <filesystem>
+#include <stdexcept>
+#include <unordered_map>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <coyote/cCompletionQueue.hpp>
+
+namespace coyote {
+
+/// Minimum (and granularity of the) transfer size during replay; one 64-byte beat of the data streams
+static constexpr uint64_t const TRACE_MIN_BYTES = 64;
+
+cTrace::cTrace(const std::string &path) {
+    name = std::filesystem::path(path).stem().string();
+
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd == -1) {
+        throw std::runtime_error("ERROR: Failed to open trace " + path + ", exiting...");
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) == -1 || (size_t) st.st_size < sizeof(traceHeader)) {
+        close(fd);
+        throw std::runtime_error("ERROR: Trace " + path + " is too short, exiting...");
+    }
+
+    map_size = st.st_size;
+    map = mmap(NULL, map_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        map = nullptr;
+        throw std::runtime_error("ERROR: Failed to map trace " + path + ", exiting...");
+    }
+
+    const traceHeader *header = static_cast<const traceHeader*>(map);
+    if (std::memcmp(header->magic, TRACE_MAGIC, sizeof(TRACE_MAGIC)) != 0 || header->version != TRACE_VERSION ||
+        map_size != sizeof(traceHeader) + header->n_events * sizeof(traceEvent)) {
+        munmap(map, map_size);
+        map = nullptr;
+        throw std::runtime_error("ERROR: " + path + " is not a valid trace (version " + std::to_string(TRACE_VERSION) + "), exiting...");
+    }
+
+    events = reinterpret_cast<const traceEvent*>(static_cast<const char*>(map) + sizeof(traceHeader));
+    n_events = header->n_events;
+    for (uint64_t i = 0; i < n_events; i++) {
+        if (static_cast<unsigned int>(events[i].kind) >= N_TRACE_KINDS) {
+            munmap(map, map_size);
+            map = nullptr;
+            throw std::runtime_error("ERROR: Event " + std::to_string(i) + " of trace " + path + " has an unknown kind, exiting...");
+        }
+    }
+
+    DBG1("cTrace: mapped trace " << name << ", events " << n_events);
+}
+
+cTrace::~cTrace() {
+    if (map) {
+        munmap(map, map_size);
+    }
+}
+
+cTrace::cTrace(cTrace &&other) noexcept:
+    name(std::move(other.name)), map(other.map), map_size(other.map_size), events(other.events), n_events(other.n_events) {
+    other.map = nullptr;
+    other.events = nullptr;
+    other.n_events = 0;
+}
+
+cTrace& cTrace::operator=(cTrace &&other) noexcept {
+    if (this != &other) {
+        if (map) {
+            munmap(map, map_size);
+        }
+        name = std::move(other.name);
+        map = other.map;
+        map_size = other.map_size;
+        events = other.events;
+        n_events = other.n_events;
+        other.map = nullptr;
+        other.events = nullptr;
+        other.n_events = 0;
+    }
+    return *this;
+}
+
+uint64_t cTrace::getMaxBytes() const {
+    uint64_t max_bytes = 0;
+    for (const traceEvent &ev : *this) {
+        max_bytes = std::max(max_bytes, std::max(ev.h2d_size, ev.d2h_size));
+    }
+    return max_bytes;
+}
+
+void cTrace::write(const std::string &path, const std::vector<traceEvent> &events) {
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        throw std::runtime_error("ERROR: Failed to create trace " + path + ", exiting...");
+    }
+
+    traceHeader header = {};
+    std::memcpy(header.magic, TRACE_MAGIC, sizeof(TRACE_MAGIC));
+    header.version = TRACE_VERSION;
+    header.n_events = events.size();
+
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(events.data()), events.size() * sizeof(traceEvent));
+    if (!out) {
+        throw std::runtime_error("ERROR: Failed to write trace " + path + ", exiting...");
+    }
+}
+
+std::vector<cTrace> cTrace::loadDir(const std::string &dir) {
+    if (!std::filesystem::is_directory(dir)) {
+        throw std::runtime_error("ERROR: Trace directory " + dir + " does not exist, exiting...");
+    }
+
+    std::vector<std::string> paths;
+    for (const auto &entry : std::filesystem::directory_iterator(dir)) {
+        if (entry.is_regular_file() && entry.path().extension() == TRACE_FILE_EXT) {
+            paths.push_back(entry.path().string());
+        }
+    }
+    std::sort(paths.begin(), paths.end());
+
+    std::vector<cTrace> traces;
+    traces.reserve(paths.size());
+    for (const std::string &path : paths) {
+        traces.emplace_back(path);
+    }
+    return traces;
+}
+
+double cTraceResult::getGBps() const {
+    double elapsed = result.getElapsed();
+    return elapsed > 0 ? (h2d_bytes + d2h_bytes) / elapsed : 0;
+}
+
+cTraceReplay::cTraceReplay(cThread *cthread, void *mem, uint64_t mem_size, unsigned int depth):
+    cthread(cthread), mem(mem), mem_size(mem_size), depth(std::max(depth, 1u)) {
+    if (!cthread) {
+        throw std::runtime_error("ERROR: cTraceReplay created without a valid cThread, exiting...");
+    }
+    if (!mem || mem_size < 2 * TRACE_MIN_BYTES) {
+        throw std::runtime_error("ERROR: cTraceReplay needs a buffer of at least " + std::to_string(2 * TRACE_MIN_BYTES) + " bytes, exiting...");
+    }
+}
+
+void cTraceReplay::setDepth(unsigned int depth) {
+    this->depth = std::max(depth, 1u);
+}
+
+void cTraceReplay::setPipelined(bool pipelined) {
+    this->pipelined = pipelined;
+}
+
+void cTraceReplay::setExecutor(executor_t executor, executor_t prepare) {
+    this->executor = std::move(executor);
+    this->prepare = std::move(prepare);
+}
+
+uint64_t cTraceReplay::slotSize() const {
+    return (pipelined ? mem_size / 2 : mem_size) & ~(TRACE_MIN_BYTES - 1);
+}
+
+uint64_t cTraceReplay::clampSize(uint64_t size) const {
+    if (size == 0) {
+        return 0;
+    }
+
+    uint64_t cap = slotSize();
+    size = (size + TRACE_MIN_BYTES - 1) & ~(TRACE_MIN_BYTES - 1);
+    return std::min(size, cap);
+}
+
+void cTraceReplay::replayInvoke(const cTrace &trace, cTraceResult &res) {
+    typedef std::chrono::high_resolution_clock clock;
+    cCompletionQueue cq(cthread);
+
+    // Issue time and kind of each in-flight request, by ticket
+    std::unordered_map<uint64_t, std::pair<clock::time_point, CoyoteTraceKind>> in_flight;
+
+    // Buffer slots; in pipelined mode, alternate events use the two halves of the buffer and a slot is only reused
+    // once the request on it completed
+    unsigned int n_slots = pipelined ? 2 : 1;
+    unsigned int max_in_flight = pipelined ? n_slots : depth;
+    uint64_t slot_size = slotSize();
+    uint64_t slot_ticket[2] = { 0 };
+    bool slot_used[2] = { false };
+
+    // Waits until at least one of the in-flight requests completes and records the latencies of all completed ones
+    auto retire = [&]() {
+        std::vector<uint64_t> done;
+        do {
+            done = cq.poll();
+        } while (done.empty());
+
+        clock::time_point now = clock::now();
+        for (uint64_t ticket : done) {
+            auto it = in_flight.find(ticket);
+            double latency = std::chrono::duration<double, std::nano>(now - it->second.first).count();
+            res.result.record(latency);
+            res.kind_time[static_cast<unsigned int>(it->second.second)] += latency;
+            in_flight.erase(it);
+        }
+    };
+
+    clock::time_point begin = clock::now();
+    unsigned int slot = 0;
+    for (uint64_t i = 0; i < trace.size(); i++) {
+        const traceEvent &ev = trace[i];
+        uint64_t h2d = ev.kind != CoyoteTraceKind::BULK_D2H ? clampSize(ev.h2d_size) : 0;
+        uint64_t d2h = ev.kind != CoyoteTraceKind::BULK_H2D ? clampSize(ev.d2h_size) : 0;
+        if (!h2d && !d2h) {
+            continue;
+        }
+
+        // Dependent events wait for everything before them; otherwise, only for a free slot and the depth
+        if (ev.flags & TRACE_FLAG_DEPENDS) {
+            while (!in_flight.empty()) {
+                retire();
+            }
+        }
+        while (pipelined && slot_used[slot] && in_flight.count(slot_ticket[slot])) {
+            retire();
+        }
+        while (in_flight.size() >= max_in_flight) {
+            retire();
+        }
+
+        void *buf = static_cast<char*>(mem) + slot * slot_size;
+        localSg src_sg = { .addr = buf, .len = h2d };
+        localSg dst_sg = { .addr = buf, .len = d2h };
+        uint64_t ticket;
+        if (h2d && d2h) {
+            ticket = cq.invoke(CoyoteOper::LOCAL_TRANSFER, src_sg, dst_sg);
+        } else if (h2d) {
+            ticket = cq.invoke(CoyoteOper::LOCAL_READ, src_sg);
+        } else {
+            ticket = cq.invoke(CoyoteOper::LOCAL_WRITE, dst_sg);
+        }
+        in_flight[ticket] = {clock::now(), ev.kind};
+
+        slot_ticket[slot] = ticket;
+        slot_used[slot] = true;
+        slot = (slot + 1) % n_slots;
+    }
+
+    while (!in_flight.empty()) {
+        retire();
+    }
+    res.result.setElapsed(std::chrono::duration<double, std::nano>(clock::now() - begin).count());
+}
+
+void cTraceReplay::replayExecutor(const cTrace &trace, cTraceResult &res) {
+    typedef std::chrono::high_resolution_clock clock;
+
+    clock::time_point begin = clock::now();
+    for (uint64_t i = 0; i < trace.size(); i++) {
+        const traceEvent &ev = trace[i];
+        uint64_t h2d = ev.kind != CoyoteTraceKind::BULK_D2H ? clampSize(ev.h2d_size) : 0;
+        uint64_t d2h = ev.kind != CoyoteTraceKind::BULK_H2D ? clampSize(ev.d2h_size) : 0;
+
+        if (prepare) {
+            prepare(i, ev, h2d, d2h);
+        }
+
+        clock::time_point start = clock::now();
+        executor(i, ev, h2d, d2h);
+        double latency = std::chrono::duration<double, std::nano>(clock::now() - start).count();
+
+        res.result.record(latency);
+        res.kind_time[static_cast<unsigned int>(ev.kind)] += latency;
+    }
+    res.result.setElapsed(std::chrono::duration<double, std::nano>(clock::now() - begin).count());
+}
+
+cTraceResult cTraceReplay::replay(const cTrace &trace) {
+    cTraceResult res;
+    res.trace = trace.getName();
+
+    // Event counts and volumes don't depend on how the events are carried out
+    for (const traceEvent &ev : trace) {
+        res.n_events[static_cast<unsigned int>(ev.kind)]++;
+        if (ev.kind != CoyoteTraceKind::BULK_D2H) { res.h2d_bytes += clampSize(ev.h2d_size); }
+        if (ev.kind != CoyoteTraceKind::BULK_H2D) { res.d2h_bytes += clampSize(ev.d2h_size); }
+        if (ev.kind == CoyoteTraceKind::BUNDLE) { res.cycles += ev.cycles; }
+    }
+
+    if (executor) {
+        if (pipelined) {
+            throw std::runtime_error("ERROR: Pipelined trace replay is only supported through cThread::invoke, exiting...");
+        }
+        replayExecutor(trace, res);
+    } else {
+        replayInvoke(trace, res);
+    }
+
+    DBG1("cTraceReplay: replayed trace " << res.trace << ", elapsed " << res.result.getElapsed() << " ns");
+    return res;
+}
+
+void cTraceReplay::writeCsv(std::ostream &out, const std::vector<cTraceResult> &results, bool header) {
+    if (header) {
+        out << "trace,n_bulk_h2d,n_bulk_d2h,n_bundle,bulk_h2d_ns,bulk_d2h_ns,bundle_ns,h2d_bytes,d2h_bytes,cycles,"
+            << "elapsed_ns,gbps,avg_ns,min_ns,p50_ns,p99_ns,max_ns" << std::endl;
+    }
+    for (const cTraceResult &r : results) {
+        out << r.trace << "," << r.n_events[0] << "," << r.n_events[1] << "," << r.n_events[2] << ","
+            << r.kind_time[0] << "," << r.kind_time[1] << "," << r.kind_time[2] << ","
+            << r.h2d_bytes << "," << r.d2h_bytes << "," << r.cycles << ","
+            << r.result.getElapsed() << "," << r.getGBps() << "," << r.result.getAvg() << "," << r.result.getMin() << ","
+            << r.result.getPercentile(50) << "," << r.result.getPercentile(99) << "," << r.result.getMax() << std::endl;
+    }
+}
+
+}
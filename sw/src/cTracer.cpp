@@ -0,0 +1,240 @@
+/*
+ * This file is part of the Coyote <https://github.com/fpgasystems/Coyote>
+ *
+ * MIT Licence
+ * Copyright (c) 2025, Systems Group, ETH Zurich
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <mutex>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#include <coyote/cTracer.hpp>
+
+namespace coyote {
+
+namespace {
+
+/// Events of a single thread; only the owning thread writes, dump() reads concurrently
+struct traceRing {
+    std::vector<cTraceEvent> events;
+
+    /// Number of events ever recorded; the next event goes to events[head & (size - 1)]
+    std::atomic<uint64_t> head = { 0 };
+
+    /// Events before this index were discarded by clear()
+    std::atomic<uint64_t> base = { 0 };
+
+    /// Kernel thread ID and name, at the first event
+    pid_t tid;
+    std::string name;
+};
+
+struct traceRegistry {
+    std::mutex mtx;
+    std::vector<traceRing*> rings;
+    size_t capacity = TRACE_RING_EVENTS;
+    std::string exit_path;
+};
+
+// Never destroyed, since threads may still record events while static objects are destroyed; likewise, the rings
+// of exited threads are kept, so their events can still be dumped
+traceRegistry& registry() {
+    static traceRegistry *reg = new traceRegistry();
+    return *reg;
+}
+
+thread_local traceRing *thread_ring = nullptr;
+
+traceRing* newRing() {
+    traceRegistry &reg = registry();
+    std::lock_guard<std::mutex> guard(reg.mtx);
+
+    traceRing *ring = new traceRing();
+    size_t capacity = 1;
+    while (capacity < reg.capacity) {
+        capacity <<= 1;
+    }
+    ring->events.resize(capacity);
+    ring->tid = static_cast<pid_t>(syscall(SYS_gettid));
+    char name[16] = {};
+    if (pthread_getname_np(pthread_self(), name, sizeof(name)) == 0) {
+        ring->name = name;
+    }
+
+    reg.rings.push_back(ring);
+    return ring;
+}
+
+void writeEscaped(FILE *out, const char *str) {
+    fputc('"', out);
+    for (const char *c = str; *c; c++) {
+        if (*c == '"' || *c == '\\') {
+            fputc('\\', out);
+            fputc(*c, out);
+        } else if (static_cast<unsigned char>(*c) < 0x20) {
+            fprintf(out, "\\u%04x", *c);
+        } else {
+            fputc(*c, out);
+        }
+    }
+    fputc('"', out);
+}
+
+void dumpAtExit() {
+    const std::string &path = registry().exit_path;
+    try {
+        size_t n = cTracer::dump(path);
+        std::cerr << "Coyote trace: " << n << " events written to " << path << std::endl;
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+    }
+}
+
+// COYOTE_TRACE=<path> traces the whole run and dumps the trace at exit
+struct traceFromEnv {
+    traceFromEnv() {
+        const char *path = getenv("COYOTE_TRACE");
+        if (path && *path) {
+            registry().exit_path = path;
+            cTracer::enable();
+            atexit(dumpAtExit);
+        }
+    }
+} trace_from_env;
+
+}
+
+std::atomic<bool> cTracer::active(false);
+
+void cTracer::record(const cTraceEvent &event) {
+    traceRing *ring = thread_ring;
+    if (!ring) {
+        ring = thread_ring = newRing();
+    }
+
+    uint64_t head = ring->head.load(std::memory_order_relaxed);
+    ring->events[head & (ring->events.size() - 1)] = event;
+    ring->head.store(head + 1, std::memory_order_release);
+}
+
+void cTracer::enable(size_t events_per_thread) {
+    {
+        traceRegistry &reg = registry();
+        std::lock_guard<std::mutex> guard(reg.mtx);
+        reg.capacity = std::max<size_t>(events_per_thread, 1);
+    }
+    active.store(true);
+}
+
+void cTracer::disable() {
+    active.store(false);
+}
+
+void cTracer::clear() {
+    traceRegistry &reg = registry();
+    std::lock_guard<std::mutex> guard(reg.mtx);
+    for (traceRing *ring : reg.rings) {
+        ring->base.store(ring->head.load(std::memory_order_acquire));
+    }
+}
+
+size_t cTracer::dump(const std::string &path) {
+    FILE *out = fopen(path.c_str(), "w");
+    if (!out) {
+        throw std::runtime_error("ERROR: Could not open the trace file " + path);
+    }
+
+    traceRegistry &reg = registry();
+    std::lock_guard<std::mutex> guard(reg.mtx);
+
+    pid_t pid = getpid();
+    size_t n_events = 0;
+    bool first = true;
+    fprintf(out, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+
+    for (traceRing *ring : reg.rings) {
+        // Copy the events out first; those overwritten in the meantime are skipped
+        uint64_t size = ring->events.size();
+        uint64_t head = ring->head.load(std::memory_order_acquire);
+        uint64_t start = std::max(ring->base.load(), head > size ? head - size : 0);
+        std::vector<cTraceEvent> events;
+        events.reserve(head - start);
+        for (uint64_t i = start; i < head; i++) {
+            events.push_back(ring->events[i & (size - 1)]);
+        }
+        uint64_t new_head = ring->head.load(std::memory_order_acquire);
+        size_t skip = new_head > size + start ? std::min<uint64_t>(new_head - size - start, events.size()) : 0;
+
+        if (!ring->name.empty()) {
+            fprintf(out, "%s{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":", first ? "" : ",\n", pid, ring->tid);
+            writeEscaped(out, ring->name.c_str());
+            fprintf(out, "}}");
+            first = false;
+        }
+
+        for (size_t i = skip; i < events.size(); i++) {
+            const cTraceEvent &ev = events[i];
+            fprintf(out, "%s{\"ph\":\"%c\",\"cat\":", first ? "" : ",\n", ev.ph);
+            writeEscaped(out, ev.cat);
+            fprintf(out, ",\"name\":");
+            writeEscaped(out, ev.name);
+            fprintf(out, ",\"pid\":%d,\"tid\":%d,\"ts\":%.3f", pid, ring->tid, ev.ts / 1000.0);
+            if (ev.ph == 'X') {
+                fprintf(out, ",\"dur\":%.3f", ev.dur / 1000.0);
+            } else if (ev.ph == 'i') {
+                fprintf(out, ",\"s\":\"t\"");
+            } else if (ev.ph == 'C') {
+                fprintf(out, ",\"id\":\"%lu\"", static_cast<unsigned long>(ev.id));
+            }
+
+            fprintf(out, ",\"args\":{");
+            for (int a = 0; a < 2; a++) {
+                if (ev.arg_names[a]) {
+                    if (a && ev.arg_names[0]) {
+                        fputc(',', out);
+                    }
+                    writeEscaped(out, ev.arg_names[a]);
+                    fprintf(out, ":%lu", static_cast<unsigned long>(ev.args[a]));
+                }
+            }
+            fprintf(out, "}}");
+            first = false;
+            n_events++;
+        }
+    }
+
+    fprintf(out, "\n]}\n");
+    if (fclose(out)) {
+        throw std::runtime_error("ERROR: Could not write the trace file " + path);
+    }
+    return n_events;
+}
+
+}
@@ -0,0 +1,236 @@
+/*
+ * This file is part of the Coyote <https://github.com/fpgasystems/Coyote>
+ *
+ * MIT Licence
+ * Copyright (c) 2025, Systems Group, ETH Zurich
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <coyote/cTuner.hpp>
+
+#include <mutex>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <stdexcept>
+
+#include <coyote/cBench.hpp>
+
+namespace coyote {
+
+/// Names in the profile file, indexed by CoyoteOper and CoyoteAllocType
+static const char *const TUNE_OPER_NAMES[] = { "NOOP", "LOCAL_READ", "LOCAL_WRITE", "LOCAL_TRANSFER" };
+static const char *const TUNE_ALLOC_NAMES[] = { "REG", "THP", "HPF", "PRM", "GPU", "HPF_1G", "CARD", "PEER", "AUTO" };
+
+template <size_t N>
+static int tuneIndex(const char *const (&names)[N], const std::string &name) {
+    for (size_t i = 0; i < N; i++) {
+        if (name == names[i]) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static bool isTunable(CoyoteOper oper) {
+    return oper == CoyoteOper::LOCAL_READ || oper == CoyoteOper::LOCAL_WRITE || oper == CoyoteOper::LOCAL_TRANSFER;
+}
+
+const cTuneEntry& cTuneProfile::get(CoyoteOper oper) const {
+    auto it = entries.find(oper);
+    if (it == entries.end()) {
+        throw std::runtime_error("ERROR: cTuneProfile::get() - no parameters for the operation in the profile");
+    }
+    return it->second;
+}
+
+void cTuneProfile::save(const std::string &path) const {
+    std::ofstream out(path);
+    if (!out) {
+        throw std::runtime_error("ERROR: cTuneProfile::save() - could not open " + path);
+    }
+
+    out << "# Coyote tuning profile: <operation> <chunk size> <depth> <allocation type> <GB/s>" << std::endl;
+    for (const auto &[oper, entry] : entries) {
+        out << TUNE_OPER_NAMES[static_cast<int>(oper)] << " " << entry.chunk_size << " " << entry.depth << " " 
+            << TUNE_ALLOC_NAMES[static_cast<int>(entry.alloc)] << " " << entry.gbps << std::endl;
+    }
+
+    if (!out) {
+        throw std::runtime_error("ERROR: cTuneProfile::save() - could not write " + path);
+    }
+}
+
+cTuneProfile cTuneProfile::load(const std::string &path) {
+    std::ifstream in(path);
+    if (!in) {
+        throw std::runtime_error("ERROR: cTuneProfile::load() - could not open " + path);
+    }
+
+    cTuneProfile profile;
+    std::string line;
+    unsigned int line_nr = 0;
+    while (std::getline(in, line)) {
+        line_nr++;
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+
+        std::istringstream fields(line);
+        std::string oper_name, alloc_name;
+        cTuneEntry entry;
+        fields >> oper_name >> entry.chunk_size >> entry.depth >> alloc_name >> entry.gbps;
+
+        int oper = tuneIndex(TUNE_OPER_NAMES, oper_name);
+        int alloc = tuneIndex(TUNE_ALLOC_NAMES, alloc_name);
+        if (!fields || oper <= 0 || alloc < 0 || !entry.chunk_size || !entry.depth) {
+            throw std::runtime_error("ERROR: cTuneProfile::load() - malformed line " + std::to_string(line_nr) + " in " + path);
+        }
+
+        entry.alloc = static_cast<CoyoteAllocType>(alloc);
+        profile.set(static_cast<CoyoteOper>(oper), entry);
+    }
+
+    return profile;
+}
+
+const cTuneProfile& cTuneProfile::getDefault() {
+    static cTuneProfile profile;
+    static std::once_flag loaded;
+
+    std::call_once(loaded, [] {
+        const char *path = getenv(TUNE_PROFILE_ENV);
+        if (!path || !*path) {
+            return;
+        }
+
+        try {
+            profile = load(path);
+        } catch (const std::exception &e) {
+            std::cerr << "WARNING: " << e.what() << "; using the default parameters" << std::endl;
+        }
+    });
+
+    return profile;
+}
+
+double cTuner::measure(cThread &cthread, CoyoteOper oper, const cTuneEntry &candidate, const cTuneOptions &options) {
+    if (!isTunable(oper)) {
+        throw std::runtime_error("ERROR: cTuner::measure() - only LOCAL_READ, LOCAL_WRITE and LOCAL_TRANSFER can be tuned");
+    }
+
+    if (!candidate.chunk_size || !candidate.depth || candidate.chunk_size > MAX_TRANSFER_SIZE || candidate.chunk_size > options.bytes) {
+        throw std::runtime_error("ERROR: cTuner::measure() - invalid chunk size or depth");
+    }
+
+    // The source is read by LOCAL_READ and LOCAL_TRANSFER, the destination written by LOCAL_WRITE and LOCAL_TRANSFER
+    void *src = nullptr, *dst = nullptr;
+    try {
+        if (isLocalRead(oper)) {
+            src = cthread.getMem({candidate.alloc, options.bytes});
+        }
+        if (isLocalWrite(oper)) {
+            dst = cthread.getMem({candidate.alloc, options.bytes});
+        }
+    } catch (const std::exception &e) {
+        std::cerr << "WARNING: cTuner::measure() - " << e.what() << std::endl;
+    }
+
+    if ((isLocalRead(oper) && !src) || (isLocalWrite(oper) && !dst)) {
+        if (src) { cthread.freeMem(src); }
+        if (dst) { cthread.freeMem(dst); }
+        return 0;
+    }
+
+    uint64_t n_ops = options.bytes / candidate.chunk_size;
+    auto run = [&] {
+        // Completions are compared relative to the counter at the start, so that wrap-arounds are handled
+        uint32_t base = cthread.checkCompleted(oper);
+        uint64_t issued = 0, completed = 0;
+        while (completed < n_ops) {
+            while (issued < n_ops && issued - completed < candidate.depth) {
+                uint64_t offs = issued * candidate.chunk_size;
+                localSg src_sg = { .addr = static_cast<char*>(src) + offs, .len = candidate.chunk_size, .dest = options.dest };
+                localSg dst_sg = { .addr = static_cast<char*>(dst) + offs, .len = candidate.chunk_size, .dest = options.dest };
+                if (oper == CoyoteOper::LOCAL_TRANSFER) {
+                    cthread.invoke(oper, src_sg, dst_sg);
+                } else {
+                    cthread.invoke(oper, isLocalRead(oper) ? src_sg : dst_sg);
+                }
+                issued++;
+            }
+            completed = static_cast<uint32_t>(cthread.checkCompleted(oper) - base);
+        }
+    };
+
+    cBench bench(options.n_runs, options.n_warmups, false);
+    bench.execute(run, [] {});
+
+    if (src) { cthread.freeMem(src); }
+    if (dst) { cthread.freeMem(dst); }
+
+    // Bytes per ns is GB/s
+    return (double) (n_ops * candidate.chunk_size) / bench.getAvg();
+}
+
+cTuneProfile cTuner::tune(cThread &cthread, const cTuneOptions &options, std::ostream *log) {
+    cTuneProfile profile;
+
+    for (CoyoteOper oper : options.opers) {
+        cTuneEntry best;
+        for (CoyoteAllocType alloc : options.allocs) {
+            bool alloc_failed = false;
+            for (uint64_t chunk_size : options.chunk_sizes) {
+                if (alloc_failed || chunk_size > MAX_TRANSFER_SIZE || chunk_size > options.bytes) {
+                    continue;
+                }
+
+                for (uint32_t depth : options.depths) {
+                    cTuneEntry candidate = { .chunk_size = chunk_size, .depth = depth, .alloc = alloc };
+                    candidate.gbps = measure(cthread, oper, candidate, options);
+                    if (log) {
+                        *log << TUNE_OPER_NAMES[static_cast<int>(oper)] << " " << TUNE_ALLOC_NAMES[static_cast<int>(alloc)] 
+                             << " chunk " << chunk_size << " depth " << depth << ": " << candidate.gbps << " GB/s" << std::endl;
+                    }
+
+                    // A failed allocation reports 0 GB/s; the other candidates of the type would fail the same way
+                    if (!candidate.gbps) {
+                        alloc_failed = true;
+                        break;
+                    }
+
+                    if (candidate.gbps > best.gbps) {
+                        best = candidate;
+                    }
+                }
+            }
+        }
+
+        if (best.gbps > 0) {
+            profile.set(oper, best);
+        }
+    }
+
+    return profile;
+}
+
+}
@@ -0,0 +1,135 @@
+/*
+ * This file is part of the Coyote <https://github.com/fpgasystems/Coyote>
+ *
+ * MIT Licence
+ * Copyright (c) 2025, Systems Group, ETH Zurich
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <coyote/cVfpgaPipeline.hpp>
+
+#include <iostream>
+#include <stdexcept>
+
+namespace coyote {
+
+cVfpgaPipeline::cVfpgaPipeline(cThread &producer, cThread &consumer, uint64_t slot_size, uint32_t n_slots, uint32_t src_dest, uint32_t dst_dest) :
+    producer(producer), consumer(consumer), slot_size(slot_size), n_slots(n_slots), src_dest(src_dest), dst_dest(dst_dest) {
+    if (!n_slots || !slot_size) {
+        throw std::runtime_error("ERROR: cVfpgaPipeline() - the number of slots and their size must be non-zero");
+    }
+
+    // The ring is allocated once, by the producer, and attached by the consumer; both TLBs then point to the same card memory
+    src_ring = producer.getMem({CoyoteAllocType::CARD, slot_size * n_slots});
+    if (!src_ring) {
+        throw std::runtime_error("ERROR: cVfpgaPipeline() - could not allocate the ring buffer in card memory");
+    }
+
+    try {
+        dst_ring = consumer.attachCardMem(producer.shareCardMem(src_ring));
+    } catch (...) {
+        producer.freeMem(src_ring);
+        throw;
+    }
+
+    wr_base = producer.checkCompleted(CoyoteOper::LOCAL_WRITE);
+    rd_base = consumer.checkCompleted(CoyoteOper::LOCAL_READ);
+}
+
+cVfpgaPipeline::~cVfpgaPipeline() {
+    stop();
+
+    // The ring can only be released once the vFPGAs are done with it
+    try {
+        while (getProduced() < wr_issued || getConsumed() < rd_issued) {
+            progress(wr_issued);
+        }
+    } catch (const std::exception &e) {
+        std::cerr << "ERROR: ~cVfpgaPipeline() - " << e.what() << std::endl;
+    }
+
+    consumer.freeMem(dst_ring);
+    producer.freeMem(src_ring);
+}
+
+uint32_t cVfpgaPipeline::progress(uint64_t n_items) {
+    // Counters are compared relative to their values at creation, so that wrap-arounds of the 32-bit counters are handled
+    uint32_t wr_now = producer.checkCompleted(CoyoteOper::LOCAL_WRITE) - wr_base;
+    uint32_t rd_now = consumer.checkCompleted(CoyoteOper::LOCAL_READ) - rd_base;
+    uint64_t produced = getProduced() + static_cast<uint32_t>(wr_now - static_cast<uint32_t>(getProduced()));
+    uint64_t consumed = getConsumed() + static_cast<uint32_t>(rd_now - static_cast<uint32_t>(getConsumed()));
+    uint32_t n_consumed = consumed - getConsumed();
+    wr_done.store(produced, std::memory_order_relaxed);
+    rd_done.store(consumed, std::memory_order_relaxed);
+
+    // Filled slots are handed to the consumer
+    while (rd_issued < produced) {
+        localSg sg = { .addr = slot(dst_ring, rd_issued), .len = slot_size, .stream = STRM_CARD, .dest = dst_dest };
+        consumer.invoke(CoyoteOper::LOCAL_READ, sg);
+        rd_issued++;
+    }
+
+    // Drained slots are handed back to the producer
+    while (wr_issued - consumed < n_slots && (!n_items || wr_issued < n_items)) {
+        localSg sg = { .addr = slot(src_ring, wr_issued), .len = slot_size, .stream = STRM_CARD, .dest = src_dest };
+        producer.invoke(CoyoteOper::LOCAL_WRITE, sg);
+        wr_issued++;
+    }
+
+    return n_consumed;
+}
+
+void cVfpgaPipeline::start(uint64_t n_items) {
+    if (running.exchange(true)) {
+        throw std::runtime_error("ERROR: cVfpgaPipeline::start() - the pipeline is already running");
+    }
+    if (runner.joinable()) {
+        runner.join();
+    }
+
+    runner = std::thread([this, n_items] {
+        try {
+            while (running.load(std::memory_order_relaxed) && (!n_items || getConsumed() < n_items)) {
+                if (!progress(n_items)) {
+                    std::this_thread::yield();
+                }
+            }
+        } catch (const std::exception &e) {
+            std::cerr << "ERROR: cVfpgaPipeline - " << e.what() << std::endl;
+        }
+        running.store(false);
+    });
+}
+
+void cVfpgaPipeline::stop() {
+    running.store(false);
+    if (runner.joinable()) {
+        runner.join();
+    }
+}
+
+void cVfpgaPipeline::wait() {
+    if (runner.joinable()) {
+        runner.join();
+    }
+}
+
+}
@@ -0,0 +1,302 @@
+/*
+ * This file is part of the Coyote <https://github.com/fpgasystems/Coyote>
+ *
+ * MIT Licence
+ * Copyright (c) 2025, Systems Group, ETH Zurich
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * Exports the device metrics in the Prometheus text format, for fleet-wide monitoring.
+ *
+ * The driver exposes the raw, cumulative (32-bit, wrapping) counters in /sys/kernel/coyote_sysfs_<dev>/cyt_attr_metrics;
+ * this tool samples them at a fixed interval, extends them to 64-bit totals and derives the per-channel throughput 
+ * and operation rates over the last interval. The metrics are served over HTTP (--port) and/or written to a file 
+ * (--output), e.g., for the textfile collector of the node exporter; the file is replaced atomically.
+ */
+
+#include <map>
+#include <string>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <cstdio>
+#include <sstream>
+#include <fstream>
+#include <iostream>
+#include <poll.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <boost/program_options.hpp>
+
+// One sample of a device's counters, keyed as in cyt_attr_metrics
+struct cMetricsSample {
+    uint64_t timestamp_ns = 0;
+    std::map<std::string, uint64_t> values;
+};
+
+// Sampling state of one device
+struct cDeviceState {
+    uint32_t device;
+    bool valid = false;
+    cMetricsSample last;
+
+    /// Counters extended to 64 bits, accumulated since the exporter started
+    std::map<std::string, uint64_t> totals;
+
+    /// Per-second rates of the counters over the last interval
+    std::map<std::string, double> rates;
+};
+
+static bool readSample(uint32_t device, cMetricsSample &sample) {
+    std::ifstream file("/sys/kernel/coyote_sysfs_" + std::to_string(device) + "/cyt_attr_metrics");
+    if (!file) {
+        return false;
+    }
+
+    std::string key;
+    uint64_t value;
+    sample.values.clear();
+    while (file >> key >> value) {
+        if (key == "timestamp_ns") {
+            sample.timestamp_ns = value;
+        } else {
+            sample.values[key] = value;
+        }
+    }
+    return sample.timestamp_ns != 0;
+}
+
+static void update(cDeviceState &state) {
+    cMetricsSample sample;
+    if (!readSample(state.device, sample)) {
+        std::cerr << "WARNING: Metrics of device " << state.device << " could not be read" << std::endl;
+        state.valid = false;
+        return;
+    }
+
+    if (state.valid) {
+        double interval = (sample.timestamp_ns - state.last.timestamp_ns) * 1e-9;
+        for (const auto &[key, value] : sample.values) {
+            auto prev = state.last.values.find(key);
+            if (prev == state.last.values.end() || key == "hdma_beat_bytes") {
+                continue;
+            }
+
+            // The hardware counters are 32 bits wide; the difference modulo 2^32 is correct across one wrap-around
+            uint64_t delta = (value - prev->second) & 0xffffffffULL;
+            state.totals[key] += delta;
+            state.rates[key] = interval > 0 ? delta / interval : 0;
+        }
+    } else {
+        for (const auto &[key, value] : sample.values) {
+            state.totals[key] = value;
+            state.rates[key] = 0;
+        }
+    }
+
+    state.last = std::move(sample);
+    state.valid = true;
+}
+
+static std::string format(const std::vector<cDeviceState> &states) {
+    std::ostringstream out;
+    out << "# HELP coyote_up Whether the metrics of the device could be read\n# TYPE coyote_up gauge\n";
+    for (const cDeviceState &state : states) {
+        out << "coyote_up{device=\"" << state.device << "\"} " << (state.valid ? 1 : 0) << "\n";
+    }
+
+    out << "# HELP coyote_hdma_throughput_gbps Host DMA throughput over the last interval, in GB/s\n# TYPE coyote_hdma_throughput_gbps gauge\n";
+    out << "# HELP coyote_hdma_ops_per_second Completed host DMA requests per second over the last interval\n# TYPE coyote_hdma_ops_per_second gauge\n";
+    out << "# HELP coyote_hdma_bytes_total Bytes moved by the host DMA since the exporter started\n# TYPE coyote_hdma_bytes_total counter\n";
+    for (const cDeviceState &state : states) {
+        if (!state.valid) {
+            continue;
+        }
+
+        uint64_t beat_bytes = state.last.values.count("hdma_beat_bytes") ? state.last.values.at("hdma_beat_bytes") : 64;
+        for (const auto &[key, total] : state.totals) {
+            // Keys are hdma_<channel>_beats_<dir> for the shell channels and pr_beats_<dir> for the reconfiguration channel
+            size_t pos = key.find("_beats_");
+            if (pos == std::string::npos) {
+                continue;
+            }
+            std::string channel = key.rfind("hdma_", 0) == 0 ? key.substr(5, pos - 5) : "pr";
+            std::string dir = key.substr(pos + 7);
+            std::string cmpl_key = key.substr(0, pos) + "_cmpl_" + dir;
+            std::string labels = "{device=\"" + std::to_string(state.device) + "\",channel=\"" + channel + "\",dir=\"" + dir + "\"}";
+
+            out << "coyote_hdma_throughput_gbps" << labels << " " << state.rates.at(key) * beat_bytes * 1e-9 << "\n";
+            out << "coyote_hdma_bytes_total" << labels << " " << total * beat_bytes << "\n";
+            if (state.rates.count(cmpl_key)) {
+                out << "coyote_hdma_ops_per_second" << labels << " " << state.rates.at(cmpl_key) << "\n";
+            }
+        }
+    }
+
+    // Counters exported as they are, except for the extension to 64 bits
+    const std::vector<std::pair<std::string, std::string>> counters = {
+        {"net_retrans", "Retransmissions by the network stack"},
+        {"net_psn_drops", "Packets dropped by the network stack due to an unexpected PSN"},
+        {"net_rx_pkts", "Packets received by the network stack"},
+        {"net_tx_pkts", "Packets sent by the network stack"},
+        {"reconfig_cnt", "Completed partial reconfigurations"},
+        {"reconfig_cache_hits", "Reconfigurations served from the bitstream cache"}
+    };
+    for (const auto &[key, help] : counters) {
+        std::string name = "coyote_" + key + "_total";
+        out << "# HELP " << name << " " << help << "\n# TYPE " << name << " counter\n";
+        for (const cDeviceState &state : states) {
+            if (state.valid && state.totals.count(key)) {
+                out << name << "{device=\"" << state.device << "\"} " << state.totals.at(key) << "\n";
+            }
+        }
+    }
+
+    out << "# HELP coyote_net_retrans_per_second Retransmissions per second over the last interval\n# TYPE coyote_net_retrans_per_second gauge\n";
+    for (const cDeviceState &state : states) {
+        if (state.valid && state.rates.count("net_retrans")) {
+            out << "coyote_net_retrans_per_second{device=\"" << state.device << "\"} " << state.rates.at("net_retrans") << "\n";
+        }
+    }
+
+    return out.str();
+}
+
+static void writeFile(const std::string &path, const std::string &text) {
+    // Written to a temporary file first, so that readers never see a partially written file
+    std::string tmp = path + ".tmp";
+    std::ofstream file(tmp, std::ios::trunc);
+    file << text;
+    file.close();
+    if (!file || std::rename(tmp.c_str(), path.c_str())) {
+        std::cerr << "WARNING: Metrics could not be written to " << path << std::endl;
+    }
+}
+
+static int listenOn(uint16_t port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        throw std::runtime_error("ERROR: Failed to create socket for the metrics endpoint");
+    }
+
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port);
+    if (bind(fd, (sockaddr *) &addr, sizeof(addr)) || listen(fd, 16)) {
+        close(fd);
+        throw std::runtime_error("ERROR: Failed to listen on port " + std::to_string(port));
+    }
+    return fd;
+}
+
+static void serve(int listen_fd, const std::string &text) {
+    int fd = accept(listen_fd, nullptr, nullptr);
+    if (fd < 0) {
+        return;
+    }
+
+    // Any request is answered with the metrics; the request itself is only drained
+    char request[1024];
+    pollfd pfd = {fd, POLLIN, 0};
+    if (poll(&pfd, 1, 100) > 0) {
+        [[maybe_unused]] ssize_t n = read(fd, request, sizeof(request));
+    }
+
+    std::string response = 
+        "HTTP/1.1 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: " + std::to_string(text.size()) + 
+        "\r\nConnection: close\r\n\r\n" + text;
+    size_t sent = 0;
+    while (sent < response.size()) {
+        ssize_t n = write(fd, response.data() + sent, response.size() - sent);
+        if (n <= 0) {
+            break;
+        }
+        sent += n;
+    }
+    close(fd);
+}
+
+int main(int argc, char *argv[]) {
+    std::vector<uint32_t> devices;
+    uint32_t interval_ms;
+    uint16_t port;
+    std::string output;
+
+    boost::program_options::options_description runtime_options("Coyote Metrics Exporter Options");
+    runtime_options.add_options()
+        ("help,h", "Print this message")
+        ("device,d", boost::program_options::value<std::vector<uint32_t>>(&devices)->multitoken(), "FPGA devices to monitor (default: 0)")
+        ("interval,i", boost::program_options::value<uint32_t>(&interval_ms)->default_value(1000), "Sampling interval, in ms")
+        ("port,p", boost::program_options::value<uint16_t>(&port)->default_value(0), "Port of the HTTP endpoint; 0 to disable")
+        ("output,o", boost::program_options::value<std::string>(&output)->default_value(""), "File the metrics are written to after each sample");
+    boost::program_options::variables_map command_line_arguments;
+    boost::program_options::store(boost::program_options::parse_command_line(argc, argv, runtime_options), command_line_arguments);
+    boost::program_options::notify(command_line_arguments);
+
+    if (command_line_arguments.count("help")) {
+        std::cout << runtime_options << std::endl;
+        return EXIT_SUCCESS;
+    }
+    if (!port && output.empty()) {
+        std::cerr << "ERROR: At least one of --port and --output must be set" << std::endl;
+        return EXIT_FAILURE;
+    }
+    if (devices.empty()) {
+        devices.push_back(0);
+    }
+
+    std::vector<cDeviceState> states;
+    for (uint32_t device : devices) {
+        states.push_back({device});
+    }
+    int listen_fd = port ? listenOn(port) : -1;
+
+    auto next = std::chrono::steady_clock::now();
+    while (true) {
+        for (cDeviceState &state : states) {
+            update(state);
+        }
+        std::string text = format(states);
+        if (!output.empty()) {
+            writeFile(output, text);
+        }
+
+        // Until the next sample, either serve the scrapes or sleep
+        next += std::chrono::milliseconds(interval_ms);
+        if (listen_fd < 0) {
+            std::this_thread::sleep_until(next);
+            continue;
+        }
+        for (auto now = std::chrono::steady_clock::now(); now < next; now = std::chrono::steady_clock::now()) {
+            pollfd pfd = {listen_fd, POLLIN, 0};
+            int timeout = std::chrono::duration_cast<std::chrono::milliseconds>(next - now).count();
+            if (poll(&pfd, 1, timeout) > 0) {
+                serve(listen_fd, text);
+            }
+        }
+    }
+}
@@ -0,0 +1,402 @@
+/*
+ * This file is part of the Coyote <https://github.com/fpgasystems/Coyote>
+ *
+ * MIT Licence
+ * Copyright (c) 2025, Systems Group, ETH Zurich
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * Performance regression suite: runs a set of standard scenarios on the deployed shell, writes the results as JSON
+ * and, optionally, compares them against a stored baseline (e.g., the results of the previous driver or shell build).
+ *
+ * Scenarios (--scenario; default: local_read, local_write, local_transfer, card, pfault):
+ *  - local_read, local_write, local_transfer: throughput and latency sweeps of the host streams (H2C, C2H and both);
+ *    the vFPGA must handle the operations, e.g., loop its host streams back, as in examples/01_hello_world
+ *  - card: throughput and latency sweeps of the migrations between host and card memory (LOCAL_OFFLOAD, LOCAL_SYNC)
+ *  - pfault: cost of a (regular) page fault, from the first transfer of a buffer that isn't mapped on the FPGA yet
+ *  - rdma: RDMA READ sweep against --remote, which runs the server of examples/09_perf_rdma with -o 0 and the same sweep
+ *  - notify: latency of user notifications; the vFPGA must raise one when reading 73, as in examples/04_user_interrupts
+ *  - reconfig: duration of an application reconfiguration with --bitstream; run last, since it reloads the vFPGA
+ *
+ * With --baseline, every result is compared to the baseline result of the same name; throughputs may be at most 
+ * --tolerance lower and latencies at most --latency_tolerance higher, otherwise the tool exits with a failure.
+ */
+
+#include <regex>
+#include <atomic>
+#include <string>
+#include <vector>
+#include <thread>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <algorithm>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <boost/program_options.hpp>
+
+#include <coyote/cBench.hpp>
+#include <coyote/cRcnfg.hpp>
+#include <coyote/cThread.hpp>
+
+// Transfers in flight for the throughput measurements, as in the perf examples
+constexpr uint32_t const N_THROUGHPUT_REPS = 32;
+
+// Buffer for the page fault scenario, in regular pages
+constexpr uint32_t const N_PFAULT_PAGES = 512;
+
+/// One measured value; results are identified by name (scenario and size) and metric
+struct cPerfRecord {
+    std::string name;
+    std::string metric;
+    double value;
+    bool higher_is_better;
+};
+
+struct cPerfOptions {
+    int32_t vfid;
+    uint32_t device;
+    uint32_t n_runs;
+    uint64_t min_size, max_size;
+    std::string remote;
+    std::string bitstream;
+};
+
+static void addSweepRecords(std::vector<cPerfRecord> &records, const std::string &name, uint64_t size, double throughput_ns, double latency_ns) {
+    std::string key = name + "/" + std::to_string(size);
+    records.push_back({key, "gbps", (double) N_THROUGHPUT_REPS * size / throughput_ns, true});
+    records.push_back({key, "latency_ns", latency_ns, false});
+}
+
+static void runLocal(coyote::cThread &cthread, coyote::CoyoteOper oper, const std::string &name, const cPerfOptions &options, std::vector<cPerfRecord> &records) {
+    void *src = cthread.getMem({coyote::CoyoteAllocType::HPF, options.max_size});
+    void *dst = cthread.getMem({coyote::CoyoteAllocType::HPF, options.max_size});
+
+    for (uint64_t size = options.min_size; size <= options.max_size; size *= 2) {
+        auto measure = [&](uint32_t transfers) {
+            coyote::localSg src_sg = { .addr = src, .len = size };
+            coyote::localSg dst_sg = { .addr = dst, .len = size };
+            coyote::cBench bench(options.n_runs, options.n_runs / 10, false);
+            bench.execute(
+                [&]() {
+                    for (uint32_t i = 0; i < transfers; i++) {
+                        if (oper == coyote::CoyoteOper::LOCAL_TRANSFER) {
+                            cthread.invoke(oper, src_sg, dst_sg);
+                        } else {
+                            cthread.invoke(oper, oper == coyote::CoyoteOper::LOCAL_READ ? src_sg : dst_sg);
+                        }
+                    }
+                    while (cthread.checkCompleted(oper) != transfers) {}
+                },
+                [&]() { cthread.clearCompleted(); }
+            );
+            return bench.getAvg();
+        };
+
+        addSweepRecords(records, name, size, measure(N_THROUGHPUT_REPS), measure(1));
+    }
+
+    cthread.freeMem(src);
+    cthread.freeMem(dst);
+}
+
+static void runCard(coyote::cThread &cthread, const cPerfOptions &options, std::vector<cPerfRecord> &records) {
+    void *mem = cthread.getMem({coyote::CoyoteAllocType::HPF, options.max_size});
+
+    // Off-loads and syncs are blocking, so the throughput is measured over back-to-back migrations
+    for (coyote::CoyoteOper oper : {coyote::CoyoteOper::LOCAL_OFFLOAD, coyote::CoyoteOper::LOCAL_SYNC}) {
+        std::string name = oper == coyote::CoyoteOper::LOCAL_OFFLOAD ? "card_offload" : "card_sync";
+        for (uint64_t size = options.min_size; size <= options.max_size; size *= 2) {
+            coyote::syncSg sg = { .addr = mem, .len = size };
+            coyote::cBench bench(options.n_runs * N_THROUGHPUT_REPS, options.n_runs / 10, false);
+            bench.execute([&]() { cthread.invoke(oper, sg); }, [] {});
+            addSweepRecords(records, name, size, bench.getAvg() * N_THROUGHPUT_REPS, bench.getAvg());
+        }
+    }
+
+    cthread.freeMem(mem);
+}
+
+static void runPageFault(coyote::cThread &cthread, const cPerfOptions &options, std::vector<cPerfRecord> &records) {
+    uint64_t size = (uint64_t) N_PFAULT_PAGES * getpagesize();
+    void *dst = cthread.getMem({coyote::CoyoteAllocType::HPF, size});
+    coyote::localSg dst_sg = { .addr = dst, .len = size };
+
+    auto transfer = [&](void *src) {
+        coyote::localSg src_sg = { .addr = src, .len = size };
+        cthread.clearCompleted();
+        auto begin = std::chrono::high_resolution_clock::now();
+        cthread.invoke(coyote::CoyoteOper::LOCAL_TRANSFER, src_sg, dst_sg);
+        while (cthread.checkCompleted(coyote::CoyoteOper::LOCAL_TRANSFER) != 1) {}
+        return std::chrono::duration<double, std::nano>(std::chrono::high_resolution_clock::now() - begin).count();
+    };
+
+    // Each run uses a fresh (populated) source, which the FPGA faults in on the first transfer; the second transfer
+    // of the same buffer is the reference without faults
+    double total = 0;
+    for (uint32_t i = 0; i < options.n_runs; i++) {
+        void *src = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+        if (src == MAP_FAILED) {
+            throw std::runtime_error("ERROR: Failed to allocate the page fault buffer");
+        }
+
+        double cold = transfer(src);
+        double warm = transfer(src);
+        total += std::max(cold - warm, 0.0);
+
+        cthread.userUnmap(src);
+        munmap(src, size);
+    }
+
+    records.push_back({"pfault/" + std::to_string(getpagesize()), "ns_per_page", total / options.n_runs / N_PFAULT_PAGES, false});
+    cthread.freeMem(dst);
+}
+
+static void runRdma(coyote::cThread &cthread, const cPerfOptions &options, std::vector<cPerfRecord> &records) {
+    // Same sequence of barriers as the client of examples/09_perf_rdma, so that its server can be used as the remote
+    void *mem = cthread.initRDMA(options.max_size, coyote::DEF_PORT, options.remote.c_str());
+    if (!mem) {
+        throw std::runtime_error("ERROR: Failed to set up the RDMA connection to " + options.remote);
+    }
+
+    for (uint64_t size = options.min_size; size <= options.max_size; size *= 2) {
+        auto measure = [&](uint32_t transfers) {
+            coyote::rdmaSg sg = { .len = size };
+            coyote::cBench bench(options.n_runs, 0, false);
+            bench.execute(
+                [&]() {
+                    for (uint32_t i = 0; i < transfers; i++) {
+                        cthread.invoke(coyote::CoyoteOper::REMOTE_RDMA_READ, sg);
+                    }
+                    while (cthread.checkCompleted(coyote::CoyoteOper::LOCAL_WRITE) != transfers) {}
+                },
+                [&]() { cthread.clearCompleted(); cthread.rdmaSync(); }
+            );
+            return bench.getAvg();
+        };
+
+        addSweepRecords(records, "rdma_read", size, measure(N_THROUGHPUT_REPS), measure(1));
+    }
+
+    cthread.connSync(true);
+}
+
+static void runNotify(const cPerfOptions &options, std::vector<cPerfRecord> &records) {
+    std::atomic<int> received = { -1 };
+    coyote::cThread cthread(options.vfid, getpid(), options.device, [&](int value) { received = value; });
+
+    int *data = (int *) cthread.getMem({coyote::CoyoteAllocType::REG, 64});
+    data[0] = 73;
+    coyote::localSg sg = { .addr = data, .len = 64 };
+
+    // Measured until the notification is handled; the completion of the read is awaited (untimed) before the next one
+    bool pending = false;
+    coyote::cBench bench(options.n_runs, options.n_runs / 10, false);
+    bench.execute(
+        [&]() {
+            cthread.invoke(coyote::CoyoteOper::LOCAL_READ, sg);
+            while (received < 0) {}
+            pending = true;
+        },
+        [&]() {
+            while (pending && cthread.checkCompleted(coyote::CoyoteOper::LOCAL_READ) != 1) {}
+            cthread.clearCompleted();
+            received = -1;
+            pending = false;
+        }
+    );
+
+    records.push_back({"notify", "latency_ns", bench.getAvg(), false});
+    records.push_back({"notify", "p99_ns", bench.getP99(), false});
+    cthread.freeMem(data);
+}
+
+static void runReconfig(const cPerfOptions &options, std::vector<cPerfRecord> &records) {
+    coyote::cRcnfg rcnfg(options.device);
+    coyote::cBench bench(options.n_runs, 1, false);
+    bench.execute([&]() { rcnfg.reconfigureApp(options.bitstream, options.vfid); }, [] {});
+    records.push_back({"reconfig", "latency_ns", bench.getAvg(), false});
+}
+
+static void writeJson(const std::string &path, const cPerfOptions &options, const std::vector<cPerfRecord> &records) {
+    std::ofstream out(path);
+    if (!out) {
+        throw std::runtime_error("ERROR: Could not open " + path);
+    }
+
+    // One result per line, which keeps the files diff-friendly and parseable by readJson()
+    out << "{\"device\": " << options.device << ", \"vfid\": " << options.vfid << ", \"results\": [" << std::endl;
+    for (size_t i = 0; i < records.size(); i++) {
+        out << "  {\"name\": \"" << records[i].name << "\", \"metric\": \"" << records[i].metric << "\", \"value\": " 
+            << std::setprecision(10) << records[i].value << ", \"higher_is_better\": " << (records[i].higher_is_better ? "true" : "false") 
+            << "}" << (i + 1 < records.size() ? "," : "") << std::endl;
+    }
+    out << "]}" << std::endl;
+}
+
+static std::vector<cPerfRecord> readJson(const std::string &path) {
+    std::ifstream in(path);
+    if (!in) {
+        throw std::runtime_error("ERROR: Could not open baseline " + path);
+    }
+
+    // Only the format written by writeJson() is supported
+    static const std::regex record_regex(
+        "\\{\"name\": \"([^\"]*)\", \"metric\": \"([^\"]*)\", \"value\": ([^,]*), \"higher_is_better\": (true|false)\\}"
+    );
+    std::vector<cPerfRecord> records;
+    std::string line;
+    std::smatch match;
+    while (std::getline(in, line)) {
+        if (std::regex_search(line, match, record_regex)) {
+            records.push_back({match[1], match[2], std::stod(match[3]), match[4] == "true"});
+        }
+    }
+    return records;
+}
+
+static unsigned int compare(const std::vector<cPerfRecord> &results, const std::vector<cPerfRecord> &baseline, double tolerance, double latency_tolerance) {
+    unsigned int n_regressions = 0;
+    std::cout << std::left << std::setw(28) << "result" << std::setw(14) << "metric" << std::right << std::setw(14) << "baseline" 
+              << std::setw(14) << "current" << std::setw(10) << "change" << std::endl;
+    for (const cPerfRecord &result : results) {
+        auto base = std::find_if(baseline.begin(), baseline.end(), [&](const cPerfRecord &r) { 
+            return r.name == result.name && r.metric == result.metric; 
+        });
+        if (base == baseline.end() || base->value <= 0) {
+            continue;
+        }
+
+        double change = (result.value - base->value) / base->value;
+        bool regression = result.higher_is_better ? change < -tolerance : change > latency_tolerance;
+        n_regressions += regression;
+        std::cout << std::left << std::setw(28) << result.name << std::setw(14) << result.metric << std::right << std::setw(14) << base->value 
+                  << std::setw(14) << result.value << std::setw(9) << std::fixed << std::setprecision(1) << change * 100 << "%" 
+                  << std::defaultfloat << (regression ? "  REGRESSION" : "") << std::endl;
+    }
+    return n_regressions;
+}
+
+int main(int argc, char *argv[]) {
+    cPerfOptions options;
+    std::vector<std::string> scenarios;
+    std::string output, baseline;
+    double tolerance, latency_tolerance;
+
+    boost::program_options::options_description runtime_options("Coyote Performance Suite Options");
+    runtime_options.add_options()
+        ("help,h", "Print this message")
+        ("vfid,v", boost::program_options::value<int32_t>(&options.vfid)->default_value(0), "vFPGA to run on")
+        ("device,d", boost::program_options::value<uint32_t>(&options.device)->default_value(0), "FPGA device")
+        ("scenario,s", boost::program_options::value<std::vector<std::string>>(&scenarios)->multitoken(), 
+            "Scenarios: local_read, local_write, local_transfer, card, pfault, rdma, notify and/or reconfig")
+        ("runs,r", boost::program_options::value<uint32_t>(&options.n_runs)->default_value(20), "Measurements per point")
+        ("min_size,x", boost::program_options::value<uint64_t>(&options.min_size)->default_value(4096), "Smallest transfer size of the sweeps")
+        ("max_size,X", boost::program_options::value<uint64_t>(&options.max_size)->default_value(1024 * 1024), "Largest transfer size of the sweeps")
+        ("remote", boost::program_options::value<std::string>(&options.remote)->default_value(""), "Address of the remote node (rdma)")
+        ("bitstream", boost::program_options::value<std::string>(&options.bitstream)->default_value(""), "Application bitstream (reconfig)")
+        ("output,o", boost::program_options::value<std::string>(&output)->default_value("coyote_perf.json"), "File the results are written to")
+        ("baseline,b", boost::program_options::value<std::string>(&baseline)->default_value(""), "Results to compare against")
+        ("tolerance", boost::program_options::value<double>(&tolerance)->default_value(0.1), "Allowed relative throughput decrease")
+        ("latency_tolerance", boost::program_options::value<double>(&latency_tolerance)->default_value(0.2), "Allowed relative latency increase");
+    boost::program_options::variables_map command_line_arguments;
+    boost::program_options::store(boost::program_options::parse_command_line(argc, argv, runtime_options), command_line_arguments);
+    boost::program_options::notify(command_line_arguments);
+
+    if (command_line_arguments.count("help")) {
+        std::cout << runtime_options << std::endl;
+        return EXIT_SUCCESS;
+    }
+    if (scenarios.empty()) {
+        scenarios = {"local_read", "local_write", "local_transfer", "card", "pfault"};
+    }
+    auto selected = [&](const std::string &name) { return std::find(scenarios.begin(), scenarios.end(), name) != scenarios.end(); };
+    const std::vector<std::string> known = {"local_read", "local_write", "local_transfer", "card", "pfault", "rdma", "notify", "reconfig"};
+    for (const std::string &name : scenarios) {
+        if (std::find(known.begin(), known.end(), name) == known.end()) {
+            std::cerr << "ERROR: Unknown scenario " << name << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    if (!options.min_size || options.min_size > options.max_size) {
+        std::cerr << "ERROR: Invalid sweep sizes" << std::endl;
+        return EXIT_FAILURE;
+    }
+    if (selected("rdma") && options.remote.empty()) {
+        std::cerr << "ERROR: The rdma scenario requires --remote" << std::endl;
+        return EXIT_FAILURE;
+    }
+    if (selected("reconfig") && options.bitstream.empty()) {
+        std::cerr << "ERROR: The reconfig scenario requires --bitstream" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // The scenarios always run in the same order, independent of the command line
+    std::vector<cPerfRecord> records;
+    {
+        coyote::cThread cthread(options.vfid, getpid(), options.device);
+        const std::vector<std::pair<std::string, coyote::CoyoteOper>> local = {
+            {"local_read", coyote::CoyoteOper::LOCAL_READ}, {"local_write", coyote::CoyoteOper::LOCAL_WRITE}, 
+            {"local_transfer", coyote::CoyoteOper::LOCAL_TRANSFER}
+        };
+        for (const auto &[name, oper] : local) {
+            if (selected(name)) {
+                std::cout << "Running " << name << "..." << std::endl;
+                runLocal(cthread, oper, name, options, records);
+            }
+        }
+        if (selected("card")) {
+            std::cout << "Running card..." << std::endl;
+            runCard(cthread, options, records);
+        }
+        if (selected("pfault")) {
+            std::cout << "Running pfault..." << std::endl;
+            runPageFault(cthread, options, records);
+        }
+        if (selected("rdma")) {
+            std::cout << "Running rdma..." << std::endl;
+            runRdma(cthread, options, records);
+        }
+    }
+    if (selected("notify")) {
+        std::cout << "Running notify..." << std::endl;
+        runNotify(options, records);
+    }
+    if (selected("reconfig")) {
+        std::cout << "Running reconfig..." << std::endl;
+        runReconfig(options, records);
+    }
+
+    writeJson(output, options, records);
+    std::cout << "Results written to " << output << std::endl;
+
+    if (!baseline.empty()) {
+        unsigned int n_regressions = compare(records, readJson(baseline), tolerance, latency_tolerance);
+        if (n_regressions) {
+            std::cerr << "ERROR: " << n_regressions << " result(s) regressed beyond the tolerance" << std::endl;
+            return EXIT_FAILURE;
+        }
+        std::cout << "No regressions against " << baseline << std::endl;
+    }
+
+    return EXIT_SUCCESS;
+}
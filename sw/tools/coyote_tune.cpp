@@ -0,0 +1,95 @@
+/*
+ * This file is part of the Coyote <https://github.com/fpgasystems/Coyote>
+ *
+ * MIT Licence
+ * Copyright (c) 2025, Systems Group, ETH Zurich
+ * All rights reserved.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/**
+ * Tunes the chunk size, depth and allocation type of the local operations on the deployed shell, 
+ * and writes them to a profile; the streaming APIs use it when COYOTE_TUNE_PROFILE points to it.
+ *
+ * The vFPGA must handle the tuned operations, e.g., loop its host streams back for LOCAL_TRANSFER (examples/01_hello_world).
+ */
+
+#include <string>
+#include <vector>
+#include <iostream>
+#include <unistd.h>
+#include <boost/program_options.hpp>
+
+#include <coyote/cThread.hpp>
+#include <coyote/cTuner.hpp>
+
+int main(int argc, char *argv[]) {
+    int32_t vfid;
+    uint32_t device, dest, n_runs;
+    uint64_t bytes;
+    std::string output;
+    std::vector<std::string> opers;
+
+    boost::program_options::options_description runtime_options("Coyote Tuner Options");
+    runtime_options.add_options()
+        ("help,h", "Print this message")
+        ("vfid,v", boost::program_options::value<int32_t>(&vfid)->default_value(0), "vFPGA to tune on")
+        ("device,d", boost::program_options::value<uint32_t>(&device)->default_value(0), "FPGA device")
+        ("oper,o", boost::program_options::value<std::vector<std::string>>(&opers)->multitoken(), "Operations to tune: read, write and/or transfer (default: transfer)")
+        ("dest", boost::program_options::value<uint32_t>(&dest)->default_value(0), "Target AXI4 destination stream in the vFPGA")
+        ("bytes,b", boost::program_options::value<uint64_t>(&bytes)->default_value(64 * 1024 * 1024), "Bytes moved per measurement")
+        ("runs,r", boost::program_options::value<uint32_t>(&n_runs)->default_value(5), "Measurements per candidate")
+        ("output,p", boost::program_options::value<std::string>(&output)->default_value("coyote_tune.profile"), "Profile file to write");
+    boost::program_options::variables_map command_line_arguments;
+    boost::program_options::store(boost::program_options::parse_command_line(argc, argv, runtime_options), command_line_arguments);
+    boost::program_options::notify(command_line_arguments);
+
+    if (command_line_arguments.count("help")) {
+        std::cout << runtime_options << std::endl;
+        return EXIT_SUCCESS;
+    }
+
+    coyote::cTuneOptions options;
+    options.dest = dest;
+    options.bytes = bytes;
+    options.n_runs = n_runs;
+    if (!opers.empty()) {
+        options.opers.clear();
+        for (const std::string &oper : opers) {
+            if (oper == "read") {
+                options.opers.push_back(coyote::CoyoteOper::LOCAL_READ);
+            } else if (oper == "write") {
+                options.opers.push_back(coyote::CoyoteOper::LOCAL_WRITE);
+            } else if (oper == "transfer") {
+                options.opers.push_back(coyote::CoyoteOper::LOCAL_TRANSFER);
+            } else {
+                std::cerr << "ERROR: Unknown operation " << oper << "; must be read, write or transfer" << std::endl;
+                return EXIT_FAILURE;
+            }
+        }
+    }
+
+    coyote::cThread coyote_thread(vfid, getpid(), device);
+    coyote::cTuneProfile profile = coyote::cTuner::tune(coyote_thread, options, &std::cout);
+    profile.save(output);
+
+    std::cout << "Profile written to " << output << "; use it with " << TUNE_PROFILE_ENV << "=" << output << std::endl;
+    return EXIT_SUCCESS;
+}
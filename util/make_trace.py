@@ -0,0 +1,87 @@
+#!/usr/bin/env python3
+# Converts recorded transfer traces into the binary trace files replayed by coyote::cTraceReplay (see sw/include/coyote/cTrace.hpp)
+#
+# Input is either
+#   - a CSV file with one event per line: kind,h2d_size,d2h_size,cycles[,original_count[,depends]], where kind is BULK_H2D, BULK_D2H
+#     or BUNDLE (or 0, 1, 2) and depends (0 or 1) marks events consuming the results of the previous ones; the output is a single trace, or
+#   - a C header with static trace_event arrays, as generated by extract_traces.py; the output is one trace per array (tr_<name>)
+#
+# Usage:
+#   make_trace.py <input.csv> <output.trace>
+#   make_trace.py <traces.hpp> <output_dir>
+
+import os
+import re
+import sys
+import struct
+
+TRACE_MAGIC = b"CYTTRACE"
+TRACE_VERSION = 1
+TRACE_KINDS = {"BULK_H2D": 0, "BULK_D2H": 1, "BUNDLE": 2}
+TRACE_FLAG_DEPENDS = 0x1
+
+HEADER = struct.Struct("<8sIIQ")
+EVENT = struct.Struct("<BB2xIQQQ")
+
+
+def write_trace(path, events):
+    with open(path, "wb") as f:
+        f.write(HEADER.pack(TRACE_MAGIC, TRACE_VERSION, 0, len(events)))
+        for kind, h2d, d2h, cycles, count, flags in events:
+            f.write(EVENT.pack(kind, flags, count, h2d, d2h, cycles))
+
+
+def parse_kind(kind):
+    kind = kind.strip()
+    if kind.isdigit() and int(kind) in TRACE_KINDS.values():
+        return int(kind)
+    if kind.upper() in TRACE_KINDS:
+        return TRACE_KINDS[kind.upper()]
+    raise ValueError("unknown event kind " + kind)
+
+
+def read_csv(path):
+    events = []
+    with open(path) as f:
+        for line in f:
+            line = line.split("#")[0].strip()
+            if not line or line.lower().startswith("kind"):
+                continue
+            fields = [x.strip() for x in line.split(",")]
+            count = int(fields[4]) if len(fields) > 4 else 1
+            flags = TRACE_FLAG_DEPENDS if len(fields) > 5 and int(fields[5]) else 0
+            events.append((parse_kind(fields[0]), int(fields[1]), int(fields[2]), int(fields[3]), count, flags))
+    return events
+
+
+def read_header(path):
+    traces = {}
+    src = open(path).read()
+    for name, body in re.findall(r"trace_event\s+tr_(\w+)\[\]\s*=\s*\{(.*?)\};", src, re.S):
+        events = []
+        for fields in re.findall(r"\{([^{}]*)\}", body):
+            kind, h2d, d2h, cycles, count = [int(x.strip().rstrip("ULul")) for x in fields.split(",")]
+            events.append((kind, h2d, d2h, cycles, count, 0))
+        traces[name] = events
+    return traces
+
+
+def main():
+    if len(sys.argv) != 3:
+        print("Usage: make_trace.py <input.csv> <output.trace> | make_trace.py <traces.hpp> <output_dir>")
+        sys.exit(1)
+    src, dst = sys.argv[1], sys.argv[2]
+
+    if src.endswith((".hpp", ".h")):
+        os.makedirs(dst, exist_ok=True)
+        for name, events in read_header(src).items():
+            write_trace(os.path.join(dst, name + ".trace"), events)
+            print(f"{name}: {len(events)} events")
+    else:
+        events = read_csv(src)
+        write_trace(dst, events)
+        print(f"{os.path.basename(dst)}: {len(events)} events")
+
+
+if __name__ == "__main__":
+    main()